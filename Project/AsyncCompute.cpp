@@ -0,0 +1,130 @@
+#include "AsyncCompute.h"
+#include <stdexcept>
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+AsyncCompute::AsyncCompute(VkDevice device, uint32_t graphicsFamily, uint32_t computeFamily, VkQueue computeQueue, uint32_t frameCount,
+                           const TimelineSemaphore &frameTimeline)
+    : m_computeQueue(computeQueue), m_queueFamilies{graphicsFamily, computeFamily},
+      m_computeTimeline(device), m_frameTimeline(frameTimeline)
+{
+    m_computePool.create(device, computeFamily);
+    m_graphicsPool.create(device, graphicsFamily);
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        m_computeBuffers.push_back(m_computePool.createCommandBuffer());
+        m_graphicsBuffers.push_back(m_graphicsPool.createCommandBuffer());
+    }
+}
+
+AsyncCompute::~AsyncCompute()
+{
+    // Frees the command buffers with the pools
+    m_computePool.destroy();
+    m_graphicsPool.destroy();
+}
+
+// ============================================================================
+// FRAME
+// ============================================================================
+
+void AsyncCompute::beginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= m_computeBuffers.size())
+    {
+        throw std::out_of_range("AsyncCompute frame index out of range!");
+    }
+    m_frameIndex = frameIndex;
+    m_computeBegun = false;
+    m_graphicsBegun = false;
+}
+
+void AsyncCompute::begin(VkCommandBuffer cmd)
+{
+    vkResetCommandBuffer(cmd, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin async compute command buffer!");
+    }
+}
+
+VkCommandBuffer AsyncCompute::computeCommands()
+{
+    VkCommandBuffer cmd = m_computeBuffers[m_frameIndex].getVkCommandBuffer();
+    if (!m_computeBegun)
+    {
+        begin(cmd);
+        m_computeBegun = true;
+    }
+    return cmd;
+}
+
+VkCommandBuffer AsyncCompute::graphicsCommands()
+{
+    VkCommandBuffer cmd = m_graphicsBuffers[m_frameIndex].getVkCommandBuffer();
+    if (!m_graphicsBegun)
+    {
+        begin(cmd);
+        m_graphicsBegun = true;
+    }
+    return cmd;
+}
+
+bool AsyncCompute::submitCompute()
+{
+    if (!m_computeBegun)
+    {
+        return false;
+    }
+
+    VkCommandBuffer cmd = m_computeBuffers[m_frameIndex].getVkCommandBuffer();
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record async compute command buffer!");
+    }
+
+    // Last frame's graphics work reads what this overwrites; its value is 0 (already reached) on the first frame
+    const uint64_t waitValue = m_frameTimeline.getLastValue();
+    const uint64_t signalValue = m_computeTimeline.nextValue();
+    const VkSemaphore waitSemaphore = m_frameTimeline.getHandle();
+    const VkSemaphore signalSemaphore = m_computeTimeline.getHandle();
+    const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = &waitValue;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &waitSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmd;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+
+    if (vkQueueSubmit(m_computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit async compute command buffer!");
+    }
+    return true;
+}
+
+void AsyncCompute::endGraphics()
+{
+    if (vkEndCommandBuffer(graphicsCommands()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record graphics command buffer!");
+    }
+}
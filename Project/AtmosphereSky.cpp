@@ -0,0 +1,337 @@
+#include "AtmosphereSky.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "UploadContext.h"
+#include "VulkanUtil.h"
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void memoryBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+AtmosphereSky::AtmosphereSky(VkDevice device)
+    : m_device(device)
+{
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create atmosphere sampler!");
+    }
+
+    createImages();
+    createDescriptors();
+    createPipelines();
+}
+
+AtmosphereSky::~AtmosphereSky()
+{
+    vkDestroyImageView(m_device, m_cubeArrayView, nullptr);
+    vkDestroyImageView(m_device, m_cubeView, nullptr);
+    GpuMemoryAllocator::get().destroyImage(m_cube);
+    vkDestroyImageView(m_device, m_multiScatterView, nullptr);
+    GpuMemoryAllocator::get().destroyImage(m_multiScatter);
+    vkDestroyImageView(m_device, m_transmittanceView, nullptr);
+    GpuMemoryAllocator::get().destroyImage(m_transmittance);
+
+    vkDestroyPipeline(m_device, m_skyPipeline, nullptr);
+    vkDestroyPipeline(m_device, m_multiScatterPipeline, nullptr);
+    vkDestroyPipeline(m_device, m_transmittancePipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+}
+
+void AtmosphereSky::setExposure(float exposure)
+{
+    if (exposure != m_exposure)
+    {
+        m_exposure = exposure;
+        m_cubeValid = false;
+    }
+}
+
+VkShaderModule AtmosphereSky::loadShader(const char *path) const
+{
+    std::vector<char> code = ShaderRegistry::load(path);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("failed to create shader module: ") + path);
+    }
+    return module;
+}
+
+// ============================================================================
+// RESOURCES
+// ============================================================================
+
+void AtmosphereSky::createImages()
+{
+    auto createImage = [this](uint32_t width, uint32_t height, uint32_t layers, VkImage &image)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.flags = layers == 6 ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = kFormat;
+        imageInfo.extent = {width, height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = layers;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create atmosphere image!");
+        }
+        GpuMemoryAllocator::get().allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    };
+    auto createView = [this](VkImage image, VkImageViewType type, uint32_t layers, VkImageView &view)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = type;
+        viewInfo.format = kFormat;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layers};
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create atmosphere image view!");
+        }
+    };
+
+    createImage(kTransmittanceWidth, kTransmittanceHeight, 1, m_transmittance);
+    createView(m_transmittance, VK_IMAGE_VIEW_TYPE_2D, 1, m_transmittanceView);
+    createImage(kMultiScatterSize, kMultiScatterSize, 1, m_multiScatter);
+    createView(m_multiScatter, VK_IMAGE_VIEW_TYPE_2D, 1, m_multiScatterView);
+    createImage(kCubeSize, kCubeSize, 6, m_cube);
+    createView(m_cube, VK_IMAGE_VIEW_TYPE_CUBE, 6, m_cubeView);
+    createView(m_cube, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 6, m_cubeArrayView);
+
+    // All live in GENERAL; the cube reads black until the first update
+    VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+
+    std::array<VkImageMemoryBarrier, 3> barriers{};
+    const std::array<VkImage, 3> images = {m_transmittance, m_multiScatter, m_cube};
+    for (uint32_t i = 0; i < barriers.size(); i++)
+    {
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].image = images[i];
+        barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, i == 2 ? 6u : 1u};
+        barriers[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    const VkClearColorValue black{};
+    const VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6};
+    vkCmdClearColorImage(cmd, m_cube, VK_IMAGE_LAYOUT_GENERAL, &black, 1, &range);
+
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void AtmosphereSky::createDescriptors()
+{
+    // Transmittance, multiple scattering, cube (storage); transmittance, multiple scattering (sampled)
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i < 3 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create atmosphere descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create atmosphere descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate atmosphere descriptor set!");
+    }
+
+    std::array<VkDescriptorImageInfo, 5> imageInfos = {
+        VkDescriptorImageInfo{VK_NULL_HANDLE, m_transmittanceView, VK_IMAGE_LAYOUT_GENERAL},
+        VkDescriptorImageInfo{VK_NULL_HANDLE, m_multiScatterView, VK_IMAGE_LAYOUT_GENERAL},
+        VkDescriptorImageInfo{VK_NULL_HANDLE, m_cubeArrayView, VK_IMAGE_LAYOUT_GENERAL},
+        VkDescriptorImageInfo{m_sampler, m_transmittanceView, VK_IMAGE_LAYOUT_GENERAL},
+        VkDescriptorImageInfo{m_sampler, m_multiScatterView, VK_IMAGE_LAYOUT_GENERAL}};
+
+    std::array<VkWriteDescriptorSet, 5> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = bindings[i].descriptorType;
+        writes[i].pImageInfo = &imageInfos[i];
+    }
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtmospherePush)};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create atmosphere pipeline layout!");
+    }
+}
+
+// ============================================================================
+// PIPELINES
+// ============================================================================
+
+void AtmosphereSky::createPipelines()
+{
+    vkDestroyPipeline(m_device, m_transmittancePipeline, nullptr);
+    vkDestroyPipeline(m_device, m_multiScatterPipeline, nullptr);
+    vkDestroyPipeline(m_device, m_skyPipeline, nullptr);
+    m_transmittancePipeline = VK_NULL_HANDLE;
+    m_multiScatterPipeline = VK_NULL_HANDLE;
+    m_skyPipeline = VK_NULL_HANDLE;
+
+    auto createPipeline = [this](const char *path, VkPipeline &pipeline)
+    {
+        VkShaderModule module = loadShader(path);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_pipelineLayout;
+
+        VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &pipeline);
+        vkDestroyShaderModule(m_device, module, nullptr);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to create atmosphere pipeline: ") + path);
+        }
+    };
+
+    createPipeline("shaders/atmosphere_transmittance.comp.spv", m_transmittancePipeline);
+    createPipeline("shaders/atmosphere_multiscatter.comp.spv", m_multiScatterPipeline);
+    createPipeline("shaders/atmosphere.comp.spv", m_skyPipeline);
+
+    // The shaders may have changed what they compute
+    m_lutsValid = false;
+    m_cubeValid = false;
+}
+
+// ============================================================================
+// UPDATE
+// ============================================================================
+
+bool AtmosphereSky::needsUpdate(const glm::vec3 &toSun) const
+{
+    static const float kUpdateCos = std::cos(kUpdateAngle);
+    return !m_cubeValid || glm::dot(toSun, m_cubeSun) < kUpdateCos;
+}
+
+void AtmosphereSky::recordUpdate(VkCommandBuffer cmd, const glm::vec3 &toSun)
+{
+    AtmospherePush push{};
+    push.toSun = glm::vec4(toSun, 0.0f);
+    push.exposure = m_exposure;
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtmospherePush), &push);
+
+    if (!m_lutsValid)
+    {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_transmittancePipeline);
+        vkCmdDispatch(cmd, kTransmittanceWidth / kGroupSize, kTransmittanceHeight / kGroupSize, 1);
+        memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_multiScatterPipeline);
+        vkCmdDispatch(cmd, kMultiScatterSize / kGroupSize, kMultiScatterSize / kGroupSize, 1);
+        memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        m_lutsValid = true;
+    }
+
+    // Earlier frames' sky draws may still read the cube
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+    const uint32_t faceGroups = kCubeSize / kGroupSize;
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_skyPipeline);
+    vkCmdDispatch(cmd, faceGroups, faceGroups, 6);
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    m_cubeSun = toSun;
+    m_cubeValid = true;
+}
@@ -0,0 +1,302 @@
+#include "AutoTuner.h"
+#include "Lib/json.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+using json = nlohmann::json;
+
+const std::vector<AutoTuner::Knob> &AutoTuner::knobs()
+{
+    // Roughly cheapest quality loss first, within each ladder the steps that still look close
+    static const std::vector<Knob> table = {
+        {"msaaSamples", {8.0, 4.0, 2.0}},
+        {"resolutionScale", {1.0, 0.75, 0.5}},
+        {"offscreenUpdateInterval", {1.0, 2.0, 4.0}},
+        {"halfResGodRays", {0.0, 1.0}},
+        {"godSampleScale", {1.0, 0.75, 0.5}},
+        {"causticRayCount", {128.0, 64.0, 32.0, 16.0}},
+    };
+    return table;
+}
+
+std::string AutoTuner::describe(const Levels &levels)
+{
+    std::ostringstream out;
+    for (size_t k = 0; k < knobs().size(); k++)
+    {
+        out << (k ? " " : "") << knobs()[k].name << "=" << value(levels, k);
+    }
+    return out.str();
+}
+
+AutoTuner::AutoTuner(double budgetMs)
+{
+    m_result.budgetMs = budgetMs;
+    startTrial(Levels(knobs().size(), 0));
+}
+
+bool AutoTuner::takeLevelsChanged()
+{
+    const bool changed = m_levelsChanged;
+    m_levelsChanged = false;
+    return changed;
+}
+
+bool AutoTuner::takeReferenceRequest()
+{
+    const bool requested = m_referencePending;
+    m_referencePending = false;
+    return requested;
+}
+
+void AutoTuner::startTrial(const Levels &levels)
+{
+    m_trial = levels;
+    m_levelsChanged = true;
+    m_measuring = false;
+    m_frames = 0;
+    m_gpuSamples.clear();
+    m_ssimSamples.clear();
+    m_trialCount++;
+}
+
+void AutoTuner::addFrame(double gpuMs)
+{
+    if (m_done)
+        return;
+
+    if (!m_measuring)
+    {
+        if (++m_frames < kSettleFrames)
+            return;
+        m_measuring = true;
+        // The top settings have settled: the next frame is the one every trial is compared against
+        m_referencePending = m_baseline;
+        return;
+    }
+    if (gpuMs > 0.0)
+    {
+        m_gpuSamples.push_back(gpuMs);
+    }
+    if (++m_frames < kSettleFrames + kMeasureFrames)
+        return;
+
+    // A trial without a single GPU time has not been measured: wait for one, never judge it as 0 ms
+    if (!m_gpuSamples.empty())
+    {
+        finishTrial();
+    }
+    else if (m_frames >= kSettleFrames + kMaxMeasureFrames)
+    {
+        fail();
+    }
+}
+
+void AutoTuner::addQuality(double ssim)
+{
+    if (m_measuring && !m_baseline)
+    {
+        m_ssimSamples.push_back(ssim);
+    }
+}
+
+void AutoTuner::finishTrial()
+{
+    Trial trial;
+    trial.levels = m_trial;
+    auto middle = m_gpuSamples.begin() + m_gpuSamples.size() / 2; // Never empty here (addFrame)
+    std::nth_element(m_gpuSamples.begin(), middle, m_gpuSamples.end());
+    trial.gpuMs = *middle;
+    // Without comparisons (none arrived) the settings count as lossless; the time still decides
+    trial.ssim = m_baseline || m_ssimSamples.empty()
+                     ? m_current.ssim
+                     : std::accumulate(m_ssimSamples.begin(), m_ssimSamples.end(), 0.0) / m_ssimSamples.size();
+
+    if (m_baseline)
+    {
+        m_baseline = false;
+        m_current = trial;
+        m_current.ssim = 1.0;
+        if (m_current.gpuMs <= m_result.budgetMs)
+        {
+            finish(true);
+            return;
+        }
+        nextRound();
+        return;
+    }
+
+    m_candidates[m_candidateIndex] = trial;
+    if (++m_candidateIndex < m_candidates.size())
+    {
+        startTrial(m_candidates[m_candidateIndex].levels);
+        return;
+    }
+    decide();
+}
+
+void AutoTuner::nextRound()
+{
+    m_candidates.clear();
+    m_candidateIndex = 0;
+    for (size_t k = 0; k < knobs().size(); k++)
+    {
+        if (m_current.levels[k] + 1 < knobs()[k].values.size())
+        {
+            Trial candidate;
+            candidate.levels = m_current.levels;
+            candidate.levels[k]++;
+            m_candidates.push_back(candidate);
+        }
+    }
+    if (m_candidates.empty())
+    {
+        finish(false);
+        return;
+    }
+    startTrial(m_candidates.front().levels);
+}
+
+void AutoTuner::decide()
+{
+    // The best image in budget ends the search
+    const Trial *best = nullptr;
+    for (const Trial &trial : m_candidates)
+    {
+        if (trial.gpuMs <= m_result.budgetMs &&
+            (!best || trial.ssim > best->ssim || (trial.ssim == best->ssim && trial.gpuMs < best->gpuMs)))
+            best = &trial;
+    }
+    if (best)
+    {
+        m_current = *best;
+        finish(true);
+        return;
+    }
+
+    // Otherwise the step that buys the most time per SSIM lost, and another round from there
+    double bestEfficiency = 0.0;
+    for (const Trial &trial : m_candidates)
+    {
+        const double saved = m_current.gpuMs - trial.gpuMs;
+        const double efficiency = saved / std::max(m_current.ssim - trial.ssim, kMinSsimLoss);
+        if (saved > 0.0 && efficiency > bestEfficiency)
+        {
+            bestEfficiency = efficiency;
+            best = &trial;
+        }
+    }
+    if (!best)
+    {
+        finish(false);
+        return;
+    }
+    m_current = *best;
+    nextRound();
+}
+
+void AutoTuner::fail()
+{
+    std::cerr << "[AutoTuner] No GPU time after " << kMaxMeasureFrames << " frames, giving up\n";
+    m_done = true;
+    m_failed = true;
+    const Levels top(knobs().size(), 0);
+    if (m_trial != top)
+    {
+        m_trial = top;
+        m_levelsChanged = true;
+    }
+}
+
+void AutoTuner::finish(bool metBudget)
+{
+    m_done = true;
+    m_result.levels = m_current.levels;
+    m_result.gpuMs = m_current.gpuMs;
+    m_result.ssim = m_current.ssim;
+    m_result.metBudget = metBudget;
+    if (m_trial != m_current.levels)
+    {
+        m_trial = m_current.levels;
+        m_levelsChanged = true;
+    }
+}
+
+std::optional<AutoTuner::Preset> AutoTuner::loadPreset(const std::string &filePath, const std::string &deviceKey)
+{
+    std::ifstream file(filePath);
+    if (!file.is_open())
+        return std::nullopt;
+
+    json cacheJson = json::parse(file, nullptr, false);
+    if (cacheJson.is_discarded() || !cacheJson.contains("devices") || !cacheJson["devices"].contains(deviceKey))
+        return std::nullopt;
+
+    Preset preset;
+    try
+    {
+        const json &entry = cacheJson["devices"][deviceKey];
+        preset.budgetMs = entry.at("budgetMs").get<double>();
+        preset.gpuMs = entry.value("gpuMs", 0.0);
+        preset.ssim = entry.value("ssim", 1.0);
+        preset.metBudget = entry.value("metBudget", false);
+        // Stored by value: the nearest level, so a changed ladder still loads
+        const json &settings = entry.at("settings");
+        for (const Knob &knob : knobs())
+        {
+            uint32_t level = 0;
+            if (settings.contains(knob.name))
+            {
+                const double stored = settings[knob.name].get<double>();
+                for (uint32_t i = 1; i < knob.values.size(); i++)
+                {
+                    if (std::abs(knob.values[i] - stored) < std::abs(knob.values[level] - stored))
+                        level = i;
+                }
+            }
+            preset.levels.push_back(level);
+        }
+    }
+    catch (const json::exception &e)
+    {
+        std::cerr << "Malformed auto-tune cache: " << filePath << " (" << e.what() << ")" << std::endl;
+        return std::nullopt;
+    }
+    return preset;
+}
+
+bool AutoTuner::savePreset(const std::string &filePath, const std::string &deviceKey, const Preset &preset)
+{
+    json cacheJson;
+    {
+        std::ifstream existing(filePath);
+        if (existing.is_open())
+            cacheJson = json::parse(existing, nullptr, false);
+    }
+    if (cacheJson.is_discarded() || !cacheJson.is_object())
+        cacheJson = json::object();
+
+    json entry;
+    entry["budgetMs"] = preset.budgetMs;
+    entry["gpuMs"] = preset.gpuMs;
+    entry["ssim"] = preset.ssim;
+    entry["metBudget"] = preset.metBudget;
+    for (size_t k = 0; k < knobs().size(); k++)
+    {
+        entry["settings"][knobs()[k].name] = value(preset.levels, k);
+    }
+    cacheJson["devices"][deviceKey] = entry;
+
+    std::ofstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write auto-tune cache: " << filePath << std::endl;
+        return false;
+    }
+    file << cacheJson.dump(2);
+    return true;
+}
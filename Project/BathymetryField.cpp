@@ -0,0 +1,547 @@
+#include "BathymetryField.h"
+#include "GpuMemoryAllocator.h"
+#include "VulkanUtil.h"
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    constexpr char kMagic[4] = {'X', 'B', 'T', 'Y'};
+    constexpr VkFormat kAtlasFormat = VK_FORMAT_R16_UNORM;
+
+    void memoryBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+// ============================================================================
+// COOKING
+// ============================================================================
+
+void BathymetryField::cook(const std::string &rawPath, uint32_t width, const CookSettings &settings, const std::string &outPath)
+{
+    MappedFile source;
+    if (!source.open(rawPath))
+    {
+        throw std::runtime_error("failed to open bathymetry source: " + rawPath);
+    }
+    if (width < 2 || source.size() < size_t(width) * width * sizeof(uint16_t))
+    {
+        throw std::runtime_error("bathymetry source is smaller than " + std::to_string(width) + "x" + std::to_string(width) +
+                                 " samples: " + rawPath);
+    }
+    const uint16_t *samples = reinterpret_cast<const uint16_t *>(source.data());
+
+    // Level 0 covers the source with whole tiles, a power of two of them per side
+    uint32_t tilesPerSide = 1;
+    uint32_t levelCount = 1;
+    while (tilesPerSide * kTileCells < width - 1)
+    {
+        tilesPerSide *= 2;
+        levelCount++;
+    }
+    if (levelCount > kMaxLevels)
+    {
+        throw std::runtime_error("bathymetry source is too large: " + rawPath);
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFileVersion;
+    header.tileSamples = kTileSamples;
+    header.levelCount = levelCount;
+    header.tilesPerSide = tilesPerSide;
+    header.size = static_cast<float>(tilesPerSide * kTileCells) * settings.sampleSpacing;
+    header.originX = -0.5f * header.size;
+    header.originZ = -0.5f * header.size;
+    header.minElevation = settings.minElevation;
+    header.elevationRange = settings.maxElevation - settings.minElevation;
+
+    // Tiles starting past the source are left out; the field repeats its edge there
+    const uint64_t tileBytes = uint64_t(kTileSamples) * kTileSamples * sizeof(uint16_t);
+    std::vector<uint64_t> offsets;
+    uint64_t tileCount = 0;
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const uint64_t side = std::max(tilesPerSide >> level, 1u);
+        tileCount += side * side;
+    }
+    offsets.reserve(tileCount);
+    uint64_t offset = sizeof(FileHeader) + tileCount * sizeof(uint64_t);
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const uint32_t side = std::max(tilesPerSide >> level, 1u);
+        const uint64_t tileSpan = uint64_t(kTileCells) << level; // Source samples per tile
+        for (uint32_t z = 0; z < side; z++)
+        {
+            for (uint32_t x = 0; x < side; x++)
+            {
+                const bool present = x * tileSpan < width && z * tileSpan < width;
+                offsets.push_back(present ? offset : 0);
+                offset += present ? tileBytes : 0;
+            }
+        }
+    }
+
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out)
+    {
+        throw std::runtime_error("failed to create bathymetry file: " + outPath);
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+
+    auto sampleAt = [&](uint64_t x, uint64_t z)
+    {
+        const uint64_t last = width - 1;
+        return samples[std::min(z, last) * width + std::min(x, last)];
+    };
+
+    // Coarser levels average the four source samples around each of their samples
+    std::vector<uint16_t> tile(size_t(kTileSamples) * kTileSamples);
+    size_t next = 0;
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const uint32_t side = std::max(tilesPerSide >> level, 1u);
+        const uint64_t stride = uint64_t(1) << level;
+        const uint64_t half = stride / 2;
+        for (uint32_t z = 0; z < side; z++)
+        {
+            for (uint32_t x = 0; x < side; x++)
+            {
+                if (offsets[next++] == 0)
+                    continue;
+                for (uint32_t j = 0; j < kTileSamples; j++)
+                {
+                    for (uint32_t i = 0; i < kTileSamples; i++)
+                    {
+                        const uint64_t sx = (uint64_t(x) * kTileCells + i) * stride;
+                        const uint64_t sz = (uint64_t(z) * kTileCells + j) * stride;
+                        uint32_t value = sampleAt(sx, sz);
+                        if (half > 0)
+                        {
+                            value = (value + sampleAt(sx + half, sz) + sampleAt(sx, sz + half) + sampleAt(sx + half, sz + half) + 2) / 4;
+                        }
+                        tile[size_t(j) * kTileSamples + i] = static_cast<uint16_t>(value);
+                    }
+                }
+                out.write(reinterpret_cast<const char *>(tile.data()), static_cast<std::streamsize>(tileBytes));
+            }
+        }
+    }
+    if (!out)
+    {
+        throw std::runtime_error("failed to write bathymetry file: " + outPath);
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+BathymetryField::BathymetryField(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, const std::string &path)
+    : m_device(device), m_frames(std::max(frameCount, 1u))
+{
+    openFile(path);
+    createResources(physicalDevice);
+}
+
+BathymetryField::~BathymetryField()
+{
+    for (Frame &frame : m_frames)
+    {
+        VkUtils::DestroyBuffer(frame.staging);
+    }
+    VkUtils::DestroyBuffer(m_pageBuffer);
+    vkDestroyImageView(m_device, m_atlasView, nullptr);
+    GpuMemoryAllocator::get().destroyImage(m_atlas);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+}
+
+void BathymetryField::openFile(const std::string &path)
+{
+    // The flat field: one level of one tile that is never sampled
+    m_levelOffsets.assign(1, 0);
+    m_header.field = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    m_header.elevation = glm::vec4(0.0f, 0.0f, static_cast<float>(kTileSamples), 1.0f);
+    m_header.detail = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+    if (path.empty() || !m_file.open(path))
+        return;
+
+    FileHeader header{};
+    if (m_file.size() < sizeof(header))
+    {
+        throw std::runtime_error("bathymetry file is truncated: " + path);
+    }
+    std::memcpy(&header, m_file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kFileVersion)
+    {
+        throw std::runtime_error("not a bathymetry file of version " + std::to_string(kFileVersion) + ": " + path);
+    }
+    if (header.tileSamples != kTileSamples || header.levelCount == 0 || header.levelCount > kMaxLevels ||
+        header.tilesPerSide != 1u << (header.levelCount - 1))
+    {
+        throw std::runtime_error("bathymetry file has an unsupported tiling: " + path);
+    }
+
+    m_levelCount = header.levelCount;
+    m_tilesPerSide = header.tilesPerSide;
+    m_levelOffsets.clear();
+    m_tileCount = 0;
+    for (uint32_t level = 0; level < m_levelCount; level++)
+    {
+        m_levelOffsets.push_back(m_tileCount);
+        m_tileCount += tilesPerSide(level) * tilesPerSide(level);
+    }
+    if (m_file.size() < sizeof(header) + size_t(m_tileCount) * sizeof(uint64_t))
+    {
+        throw std::runtime_error("bathymetry file is truncated: " + path);
+    }
+    m_tileOffsets = reinterpret_cast<const uint64_t *>(m_file.data() + sizeof(header));
+    if (!tileSamples(m_tileCount - 1))
+    {
+        throw std::runtime_error("bathymetry file lacks its coarsest tile: " + path);
+    }
+
+    const float spacing = header.size / static_cast<float>(m_tilesPerSide * kTileCells); // Level 0's
+    m_header.field = glm::vec4(header.originX, header.originZ, header.size, static_cast<float>(m_tilesPerSide));
+    m_header.elevation = glm::vec4(header.minElevation, header.elevationRange, static_cast<float>(kTileSamples),
+                                   static_cast<float>(m_levelCount));
+    m_header.detail = glm::vec4(kDetailSamples * spacing, 1.0f, 0.0f, 0.0f);
+    for (uint32_t level = 0; level < m_levelCount; level++)
+    {
+        m_header.levelOffsets[level / 4][level % 4] = m_levelOffsets[level];
+    }
+    std::cout << "Bathymetry: " << path << ", " << m_levelCount << " levels, " << m_tileCount << " tiles\n";
+}
+
+const uint16_t *BathymetryField::tileSamples(uint32_t tile) const
+{
+    const uint64_t offset = m_tileOffsets ? m_tileOffsets[tile] : 0;
+    const uint64_t tileBytes = uint64_t(kTileSamples) * kTileSamples * sizeof(uint16_t);
+    if (offset == 0 || offset + tileBytes > m_file.size())
+        return nullptr;
+    return reinterpret_cast<const uint16_t *>(m_file.data() + offset);
+}
+
+// ============================================================================
+// RESOURCES
+// ============================================================================
+
+void BathymetryField::createResources(VkPhysicalDevice physicalDevice)
+{
+    const uint32_t slotCount = isLoaded() ? kAtlasSlots : 1;
+    if (isLoaded())
+    {
+        VkFormatProperties properties{};
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, kAtlasFormat, &properties);
+        if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+        {
+            throw std::runtime_error("failed to find linear filtering of R16_UNORM for the bathymetry atlas!");
+        }
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bathymetry sampler!");
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = kAtlasFormat;
+    imageInfo.extent = {kTileSamples, kTileSamples, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = slotCount;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &m_atlas) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bathymetry atlas!");
+    }
+    GpuMemoryAllocator::get().allocateImage(m_atlas, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_atlas;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format = kAtlasFormat;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, slotCount};
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_atlasView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bathymetry atlas view!");
+    }
+
+    m_pageBytes = sizeof(BathymetryPageHeader) + VkDeviceSize(m_tileCount) * sizeof(uint32_t);
+    m_pageBuffer = std::get<0>(VkUtils::CreateBuffer(m_device, physicalDevice, m_pageBytes,
+                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+    for (Frame &frame : m_frames)
+    {
+        frame.staging = std::get<0>(VkUtils::CreateBuffer(m_device, physicalDevice, m_pageBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+        frame.mapped = VkUtils::MapBuffer(frame.staging);
+    }
+
+    m_pages.assign(m_tileCount, kNotResident);
+    m_lastWanted.assign(m_tileCount, 0);
+    for (uint32_t slot = slotCount; slot-- > 0;)
+    {
+        m_freeSlots.push_back(slot);
+    }
+
+    // The atlas stays in GENERAL; the copies go out on the graphics queue, as the page table's do
+    VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+    VkImageMemoryBarrier toGeneral{};
+    toGeneral.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toGeneral.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toGeneral.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    toGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toGeneral.image = m_atlas;
+    toGeneral.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, slotCount};
+    toGeneral.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &toGeneral);
+
+    // The coarsest tile goes up with the startup batch and stays
+    if (isLoaded())
+    {
+        const uint32_t coarsest = m_tileCount - 1;
+        const uint32_t slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        stageTile(coarsest, slot);
+        m_pages[coarsest] = slot;
+        m_resident.push_back(coarsest);
+    }
+
+    StagingAllocation staging = UploadContext::get().allocateStaging(m_pageBytes);
+    writePageTable(staging.mapped);
+    VkBufferCopy region{staging.offset, 0, m_pageBytes};
+    vkCmdCopyBuffer(cmd, staging.buffer, m_pageBuffer, 1, &region);
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    m_deviceVersion = m_version;
+}
+
+void BathymetryField::writeDescriptors(VkDescriptorSet waterSet) const
+{
+    VkDescriptorImageInfo atlasInfo{m_sampler, m_atlasView, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorBufferInfo pagesInfo{m_pageBuffer, 0, m_pageBytes};
+
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    for (VkWriteDescriptorSet &write : writes)
+    {
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = waterSet;
+        write.descriptorCount = 1;
+    }
+    writes[0].dstBinding = kAtlasBinding;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &atlasInfo;
+    writes[1].dstBinding = kPagesBinding;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[1].pBufferInfo = &pagesInfo;
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+// ============================================================================
+// STREAMING
+// ============================================================================
+
+void BathymetryField::update(const glm::vec3 &cameraPos)
+{
+    m_updateCount++;
+
+    // Layers evicted 'frameCount' updates ago: no frame in flight reads them any more
+    for (size_t i = 0; i < m_retired.size();)
+    {
+        if (m_retired[i].update <= m_updateCount)
+        {
+            m_freeSlots.push_back(m_retired[i].slot);
+            m_retired[i] = m_retired.back();
+            m_retired.pop_back();
+            continue;
+        }
+        i++;
+    }
+
+    // Finished uploads join the page table
+    for (size_t i = 0; i < m_pending.size();)
+    {
+        if (UploadContext::get().isComplete(m_pending[i].ticket))
+        {
+            m_pages[m_pending[i].tile] = m_pending[i].slot;
+            m_resident.push_back(m_pending[i].tile);
+            m_version++;
+            m_pending[i] = m_pending.back();
+            m_pending.pop_back();
+            continue;
+        }
+        i++;
+    }
+    if (!isLoaded())
+        return;
+
+    // Every tile of a level within the distance the level is sampled at (3d_shader_lod.vert), by xz distance
+    const glm::vec2 origin(m_header.field.x, m_header.field.y);
+    const float fieldSize = m_header.field.z;
+    const glm::vec2 camera(cameraPos.x, cameraPos.z);
+    m_wanted.clear();
+    for (uint32_t level = m_levelCount; level-- > 0;)
+    {
+        const uint32_t side = tilesPerSide(level);
+        const float tileSize = fieldSize / static_cast<float>(side);
+        const float radius = m_header.detail.x * static_cast<float>(2u << level);
+        auto tileRange = [&](float centre, float lowest)
+        {
+            const int first = static_cast<int>(std::floor((centre - radius - lowest) / tileSize));
+            const int last = static_cast<int>(std::floor((centre + radius - lowest) / tileSize));
+            return std::make_pair(static_cast<uint32_t>(std::clamp(first, 0, int(side) - 1)),
+                                  static_cast<uint32_t>(std::clamp(last, 0, int(side) - 1)));
+        };
+        const auto [x0, x1] = tileRange(camera.x, origin.x);
+        const auto [z0, z1] = tileRange(camera.y, origin.y);
+        for (uint32_t z = z0; z <= z1; z++)
+        {
+            for (uint32_t x = x0; x <= x1; x++)
+            {
+                const glm::vec2 lowest = origin + glm::vec2(x, z) * tileSize;
+                const float distance = glm::length(camera - glm::clamp(camera, lowest, lowest + tileSize));
+                if (distance > radius)
+                    continue;
+                const uint32_t tile = tileIndex(level, x, z);
+                m_lastWanted[tile] = m_updateCount;
+                if (m_pages[tile] == kNotResident && tileSamples(tile))
+                {
+                    m_wanted.push_back({m_levelCount - 1 - level, distance, tile});
+                }
+            }
+        }
+    }
+
+    // Tiles in flight are wanted as well, but already on their way
+    for (const PendingTile &pending : m_pending)
+    {
+        for (WantedTile &wanted : m_wanted)
+        {
+            if (wanted.tile == pending.tile)
+                wanted.rank = UINT32_MAX;
+        }
+    }
+    std::sort(m_wanted.begin(), m_wanted.end(), [](const WantedTile &a, const WantedTile &b)
+              { return a.rank != b.rank ? a.rank < b.rank : a.distance < b.distance; });
+
+    // Room for this and the next updates' uploads
+    const size_t uploads = std::min<size_t>(kUploadsPerUpdate, m_wanted.size());
+    while (m_freeSlots.size() + m_retired.size() < uploads && evictOne())
+    {
+    }
+
+    const size_t firstStaged = m_pending.size();
+    for (const WantedTile &wanted : m_wanted)
+    {
+        if (wanted.rank == UINT32_MAX || m_freeSlots.empty() || m_pending.size() - firstStaged == kUploadsPerUpdate)
+            break;
+        const uint32_t slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        stageTile(wanted.tile, slot);
+        m_pending.push_back({wanted.tile, slot, {}});
+    }
+    if (m_pending.size() > firstStaged)
+    {
+        const UploadTicket ticket = UploadContext::get().submit();
+        for (size_t i = firstStaged; i < m_pending.size(); i++)
+        {
+            m_pending[i].ticket = ticket;
+        }
+    }
+}
+
+bool BathymetryField::evictOne()
+{
+    const uint32_t coarsest = m_tileCount - 1;
+    size_t oldest = m_resident.size();
+    for (size_t i = 0; i < m_resident.size(); i++)
+    {
+        const uint32_t tile = m_resident[i];
+        if (tile == coarsest || m_lastWanted[tile] == m_updateCount)
+            continue;
+        if (oldest == m_resident.size() || m_lastWanted[tile] < m_lastWanted[m_resident[oldest]])
+            oldest = i;
+    }
+    if (oldest == m_resident.size())
+        return false;
+
+    const uint32_t tile = m_resident[oldest];
+    m_retired.push_back({m_pages[tile], m_updateCount + m_frames.size()});
+    m_pages[tile] = kNotResident;
+    m_resident[oldest] = m_resident.back();
+    m_resident.pop_back();
+    m_version++;
+    return true;
+}
+
+void BathymetryField::stageTile(uint32_t tile, uint32_t slot)
+{
+    const VkDeviceSize tileBytes = VkDeviceSize(kTileSamples) * kTileSamples * sizeof(uint16_t);
+    const StagingAllocation staging = UploadContext::get().allocateStaging(tileBytes);
+    std::memcpy(staging.mapped, tileSamples(tile), tileBytes); // Pages the tile in from the file
+
+    VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+    // The layer's last reader finished frames ago; the barrier only orders the copy after the batch's earlier ones
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = staging.offset;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, slot, 1};
+    region.imageExtent = {kTileSamples, kTileSamples, 1};
+    vkCmdCopyBufferToImage(cmd, staging.buffer, m_atlas, VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void BathymetryField::writePageTable(void *dst) const
+{
+    std::memcpy(dst, &m_header, sizeof(m_header));
+    std::memcpy(static_cast<std::byte *>(dst) + sizeof(m_header), m_pages.data(), m_pages.size() * sizeof(uint32_t));
+}
+
+void BathymetryField::recordPageUpload(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+    // The frame's slot is free again (its fence signalled before recording)
+    Frame &frame = m_frames[frameIndex];
+    writePageTable(frame.mapped);
+
+    // Earlier frames' floor draws read the table before it is replaced
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    VkBufferCopy region{0, 0, m_pageBytes};
+    vkCmdCopyBuffer(cmd, frame.staging, m_pageBuffer, 1, &region);
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    m_deviceVersion = m_version;
+}
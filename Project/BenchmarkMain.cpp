@@ -0,0 +1,457 @@
+#include "VulkanBase.h"
+#include "FrameMetricsLog.h"
+#include "CpuProfiler.h"
+#include "ParameterSweep.h"
+#include "ThreadAffinity.h"
+#include <algorithm>
+#include <filesystem>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Headless benchmark runner: renders the test suites offscreen and exits once the CSVs are written.
+//   XeRenderBench --suite perf|iq|tradeoff|submission|devicegroup|all [--out <csv>] [--width <px>] [--height <px>]
+//                 [--frames <n>] [--runs <n>] [--synced] [--gpu-iq] [--stream-frames]
+//                 [--baseline <log|csv>] [--max-mean <pct>] [--max-p99 <pct>] [--alpha <p>]
+//                 [--cpu-trace <json>] [--hitch-ms <ms>] [--render-passes] [--gpu <index|name>] [--device-group] [--stereo]
+//   XeRenderBench --sweep <spec.json> [suite options]
+//   XeRenderBench --auto-tune <ms> [--width <px>] [--height <px>] [--gpu <index|name>]
+//   XeRenderBench --convert <log.xrfm> [--out <file.csv|file.json>]
+//   XeRenderBench --compare <baseline> <candidate> [--out <regression.csv>] [thresholds]
+//   XeRenderBench --replay <capture.json> [--pass <name>]... [--repeat <n>] [--frames <n>] [--out <csv>]
+//   XeRenderBench --suite <name> --make-references [--samples <n>] [--references <dir>] [--width <px>] [--height <px>]
+//   XeRenderBench --render <capture.json> [--size <w>x<h>] [--samples <n>] [--width <px>] [--height <px>] [--out <ppm>]
+//   XeRenderBench --shader water|sunrays|underwater... [--sizes <w>x<h>,...] [--repeat <n>] [--samples <n>] [--mode <0-2>] [--out <csv>]
+// Any run that renders takes --telemetry <host:port> (else XERENDER_TELEMETRY) to stream live frame metrics,
+// and --affinity <placement.json> (else XERENDER_AFFINITY) to pin its threads to fixed cores (ThreadAffinity.h).
+// A suite or comparison that regresses against its baseline exits with a failure code.
+
+static void printUsage()
+{
+	std::cout << "Usage: XeRenderBench [options]\n"
+		<< "  --suite <name>    perf, iq, tradeoff, submission, devicegroup or all (default: perf)\n"
+		<< "                    (devicegroup implies --device-group)\n"
+		<< "  --sweep <file>    Run the configs of a parameter sweep spec (ParameterSweep.h) instead of a suite;\n"
+		<< "                    pareto.csv (GPU time vs reference SSIM) is written next to the per-run CSV\n"
+		<< "  --out <file>      Per-run CSV; summary.csv is written next to it\n"
+		<< "                    (default: test_results/water_test_results.csv)\n"
+		<< "  --width <px>      Render width (default: " << VkUtils::WIDTH << ")\n"
+		<< "  --height <px>     Render height (default: " << VkUtils::HEIGHT << ")\n"
+		<< "  --frames <n>      Override measured frames per run\n"
+		<< "  --runs <n>        Override repeat count per config\n"
+		<< "  --synced          Wait for the GPU after every frame instead of keeping frames in flight\n"
+		<< "  --gpu-iq          Frame-to-frame SSIM/PSNR/Delta E of every measured frame, computed on the GPU\n"
+		<< "  --gpu-counters    Pipeline statistics and vendor counters of every frame in the CSVs\n"
+		<< "  --stream-frames   Append per-frame metrics to <out>.xrfm instead of keeping them in memory\n"
+		<< "  --cpu-trace <file>\n"
+		<< "                    CPU zones of the whole run as Chrome trace JSON (builds with XERENDER_CPU_PROFILING)\n"
+		<< "  --hitch-ms <ms>   Frames slower than this write a trace of the frames around them to hitches/\n"
+		<< "  --render-passes   Render passes and framebuffers even where dynamic rendering is supported\n"
+		<< "  --gpu <index|name>\n"
+		<< "                    Device by enumeration index or part of its name (default: XERENDER_GPU,\n"
+		<< "                    else the best scoring device)\n"
+		<< "  --device-group    Span the GPU's device group; configs with alternate frames use every GPU in it\n"
+		<< "                    (experimental)\n"
+		<< "  --stereo          Render both eyes in one multiview main pass, side by side in the frame\n"
+		<< "  --convert <log>   Convert a .xrfm frame log to CSV (or JSON if --out ends in .json) and exit\n"
+		<< "  --baseline <file> After the suite, compare frame times against a frame log or its CSV;\n"
+		<< "                    regression.csv is written next to the per-run CSV\n"
+		<< "  --compare <baseline> <candidate>\n"
+		<< "                    Compare two frame logs (or CSVs) without rendering\n"
+		<< "  --max-mean <pct>  Allowed mean frame time increase (default: 5)\n"
+		<< "  --max-p99 <pct>   Allowed p99 frame time increase (default: 10)\n"
+		<< "  --alpha <p>       Significance level of the Mann-Whitney test (default: 0.01)\n"
+		<< "  --replay <file>   Time passes of a frame capture in isolation instead of running a suite\n"
+		<< "                    (default --out: test_results/pass_replay.csv)\n"
+		<< "  --pass <name>     Pass to replay, repeatable (default: every pass the frame recorded)\n"
+		<< "  --repeat <n>      Times each pass is recorded again per frame (default: 16)\n"
+		<< "  --render <file>   Render a frame capture as one large image in frame-sized tiles (--width/--height)\n"
+		<< "                    instead of running a suite (default --out: renders/render.ppm)\n"
+		<< "  --size <w>x<h>    Size of the rendered image (default: 3840x2160)\n"
+		<< "  --samples <n>     Jittered frames averaged per tile (default: 1), or per reference (default: 16)\n"
+		<< "  --make-references Render the suite's missing image-quality references instead of running it;\n"
+		<< "                    runs at the same size compare their frames against them\n"
+		<< "  --references <dir>\n"
+		<< "                    Where references are stored and looked up (default: references)\n"
+		<< "  --shader <name>   Time water, sunrays or underwater alone at each --sizes instead of running a suite,\n"
+		<< "                    repeatable (default --out: test_results/shader_bench.csv)\n"
+		<< "  --sizes <list>    Target sizes of --shader, as <w>x<h>,... (default: 1280x720,1920x1080,3840x2160)\n"
+		<< "  --mode <0-2>      Underwater shading of --shader: 0=BL, 1=PB, 2=OPT (default: 1)\n"
+		<< "                    --repeat is draws per sample (default: 32), --samples timed samples (default: 16)\n"
+		<< "  --auto-tune <ms>  Search OPT's settings for this GPU frame time instead of running a suite;\n"
+		<< "                    the preset is cached per GPU in autotune_cache.json\n"
+		<< "  --telemetry <host:port>\n"
+		<< "                    Stream frame, GPU pass and memory metrics to a UDP collector once a second\n"
+		<< "                    (default: XERENDER_TELEMETRY, if set)\n"
+		<< "  --affinity <placement.json>\n"
+		<< "                    Pin the render, simulation, job and service threads to the file's cores\n"
+		<< "                    (default: XERENDER_AFFINITY, if set; else threads are not pinned)\n"
+		<< "  --help            Show this message\n";
+}
+
+// "<w>x<h>"; throws std::invalid_argument otherwise
+static VkExtent2D parseSize(const std::string &size)
+{
+	const size_t separator = size.find('x');
+	if (separator == std::string::npos)
+		throw std::invalid_argument(size);
+	return {static_cast<uint32_t>(std::stoul(size.substr(0, separator))), static_cast<uint32_t>(std::stoul(size.substr(separator + 1)))};
+}
+
+static bool appendSuite(const std::string &suite, std::vector<WaterTestConfig> &configs)
+{
+	std::vector<WaterTestConfig> suiteConfigs;
+	if (suite == "perf")
+		suiteConfigs = WaterTestingSystem::generatePerformanceTestConfigs();
+	else if (suite == "iq")
+		suiteConfigs = WaterTestingSystem::generateImageQualityTestConfigs();
+	else if (suite == "tradeoff")
+		suiteConfigs = WaterTestingSystem::generateTradeOffSweepConfigs();
+	else if (suite == "submission")
+		suiteConfigs = WaterTestingSystem::generateSubmissionTestConfigs();
+	else if (suite == "devicegroup")
+		suiteConfigs = WaterTestingSystem::generateDeviceGroupTestConfigs();
+	else if (suite == "all")
+		return appendSuite("perf", configs) && appendSuite("iq", configs);
+	else
+		return false;
+
+	configs.insert(configs.end(), suiteConfigs.begin(), suiteConfigs.end());
+	return true;
+}
+
+int main(int argc, char **argv) {
+	HeadlessOptions options;
+	std::string suite = "perf";
+	std::string sweepPath;
+	std::string affinityPath;
+	int frames = 0;
+	int runs = 0;
+	bool synced = false;
+	bool gpuCounters = false;
+	std::string convertPath;
+	std::string compareBaseline;
+	std::string compareCandidate;
+	bool outSet = false;
+	int samples = 0;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (arg == "--help" || arg == "-h") {
+				printUsage();
+				return EXIT_SUCCESS;
+			}
+			else if (arg == "--synced") {
+				synced = true;
+			}
+			else if (arg == "--gpu-counters") {
+				gpuCounters = true;
+			}
+			else if (arg == "--render-passes") {
+				options.renderPasses = true;
+			}
+			else if (arg == "--gpu-iq") {
+				options.gpuImageCompare = true;
+			}
+			else if (arg == "--stream-frames") {
+				options.streamFrameLog = true;
+			}
+			else if (arg == "--convert" && hasValue) {
+				convertPath = argv[++i];
+			}
+			else if (arg == "--cpu-trace" && hasValue) {
+				options.cpuTracePath = argv[++i];
+				if (!CpuProfiler::kEnabled)
+					std::cerr << "Built without XERENDER_CPU_PROFILING: the CPU trace will be empty\n";
+			}
+			else if (arg == "--hitch-ms" && hasValue) {
+				options.hitchThresholdMs = std::stod(argv[++i]);
+			}
+			else if (arg == "--baseline" && hasValue) {
+				options.baselinePath = argv[++i];
+			}
+			else if (arg == "--compare" && i + 2 < argc) {
+				compareBaseline = argv[++i];
+				compareCandidate = argv[++i];
+			}
+			else if (arg == "--max-mean" && hasValue) {
+				options.regressionThresholds.maxMeanIncreasePct = std::stod(argv[++i]);
+			}
+			else if (arg == "--max-p99" && hasValue) {
+				options.regressionThresholds.maxP99IncreasePct = std::stod(argv[++i]);
+			}
+			else if (arg == "--alpha" && hasValue) {
+				options.regressionThresholds.significance = std::stod(argv[++i]);
+			}
+			else if (arg == "--suite" && hasValue) {
+				suite = argv[++i];
+			}
+			else if (arg == "--sweep" && hasValue) {
+				sweepPath = argv[++i];
+			}
+			else if (arg == "--auto-tune" && hasValue) {
+				options.autoTuneBudgetMs = std::stod(argv[++i]);
+			}
+			else if (arg == "--telemetry" && hasValue) {
+				options.telemetryEndpoint = argv[++i];
+			}
+			else if (arg == "--affinity" && hasValue) {
+				affinityPath = argv[++i];
+			}
+			else if (arg == "--out" && hasValue) {
+				options.outputPath = argv[++i];
+				outSet = true;
+			}
+			else if (arg == "--width" && hasValue) {
+				options.extent.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (arg == "--height" && hasValue) {
+				options.extent.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (arg == "--frames" && hasValue) {
+				frames = std::stoi(argv[++i]);
+			}
+			else if (arg == "--runs" && hasValue) {
+				runs = std::stoi(argv[++i]);
+			}
+			else if (arg == "--replay" && hasValue) {
+				options.replayCapturePath = argv[++i];
+			}
+			else if (arg == "--pass" && hasValue) {
+				options.replayPasses.push_back(argv[++i]);
+			}
+			else if (arg == "--render" && hasValue) {
+				options.renderCapturePath = argv[++i];
+			}
+			else if (arg == "--size" && hasValue) {
+				options.renderSize = parseSize(argv[++i]);
+			}
+			else if (arg == "--shader" && hasValue) {
+				ShaderBench::Shader shader;
+				if (!ShaderBench::parseShader(argv[++i], shader)) {
+					std::cerr << "Unknown shader: " << argv[i] << "\n";
+					return EXIT_FAILURE;
+				}
+				options.shaderBench.push_back(shader);
+			}
+			else if (arg == "--sizes" && hasValue) {
+				const std::string sizes = argv[++i];
+				options.shaderBenchSizes.clear();
+				for (size_t begin = 0; begin <= sizes.size();) {
+					const size_t end = std::min(sizes.find(',', begin), sizes.size());
+					options.shaderBenchSizes.push_back(parseSize(sizes.substr(begin, end - begin)));
+					begin = end + 1;
+				}
+			}
+			else if (arg == "--mode" && hasValue) {
+				const int mode = std::stoi(argv[++i]);
+				if (mode < 0 || mode > 2)
+					throw std::invalid_argument(argv[i]);
+				options.shaderBenchPush.renderingMode = static_cast<float>(mode);
+			}
+			else if (arg == "--samples" && hasValue) {
+				samples = std::stoi(argv[++i]);
+			}
+			else if (arg == "--make-references") {
+				options.renderReferences = true;
+			}
+			else if (arg == "--references" && hasValue) {
+				options.referenceDirectory = argv[++i];
+			}
+			else if (arg == "--repeat" && hasValue) {
+				options.replayRepeat = static_cast<uint32_t>(std::stoul(argv[++i]));
+				options.shaderBenchRepeat = options.replayRepeat;
+			}
+			else if (arg == "--gpu" && hasValue) {
+				options.gpu = argv[++i];
+			}
+			else if (arg == "--device-group") {
+				options.deviceGroup = true;
+			}
+			else if (arg == "--stereo") {
+				options.stereo = true;
+			}
+			else {
+				std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+				printUsage();
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	catch (const std::exception &) {
+		std::cerr << "Invalid numeric argument\n";
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	if (!convertPath.empty()) {
+		const std::string outputPath = outSet ? options.outputPath : std::filesystem::path(convertPath).replace_extension(".csv").string();
+		return FrameMetricsLog::convert(convertPath, outputPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (!compareBaseline.empty()) {
+		FrameTimeSamples baseline;
+		FrameTimeSamples candidate;
+		if (!RegressionCompare::loadFrameTimes(compareBaseline, baseline) ||
+			!RegressionCompare::loadFrameTimes(compareCandidate, candidate))
+			return EXIT_FAILURE;
+
+		const RegressionReport report = RegressionCompare::compare(baseline, candidate, options.regressionThresholds);
+		RegressionCompare::printReport(report);
+		if (outSet)
+			RegressionCompare::writeReport(report, options.outputPath);
+		return report.passed() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// Every mode below renders: place the threads before the renderer starts them
+	if (!ThreadAffinity::configure(affinityPath))
+		return EXIT_FAILURE;
+
+	if (!options.replayCapturePath.empty()) {
+		if (!outSet)
+			options.outputPath = "test_results/pass_replay.csv";
+		if (frames > 0)
+			options.replayFrames = static_cast<uint32_t>(frames);
+
+		try {
+			VulkanBase app(options);
+			app.run();
+
+			if (app.getReplayResultCount() == 0) {
+				std::cerr << "No passes replayed\n";
+				return EXIT_FAILURE;
+			}
+			std::cout << "[Bench] " << app.getReplayResultCount() << " passes written to " << options.outputPath << "\n";
+		}
+		catch (const std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if (options.autoTuneBudgetMs > 0.0) {
+		try {
+			VulkanBase app(options);
+			app.run();
+			if (!app.getAutoTunePreset()) {
+				std::cerr << "Auto-tune did not finish\n";
+				return EXIT_FAILURE;
+			}
+		}
+		catch (const std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if (!options.shaderBench.empty()) {
+		if (!outSet)
+			options.outputPath = "test_results/shader_bench.csv";
+		if (samples > 0)
+			options.shaderBenchSamples = static_cast<uint32_t>(samples);
+
+		try {
+			VulkanBase app(options);
+			app.run();
+			std::cout << "[Bench] Shader timings written to " << options.outputPath << "\n";
+		}
+		catch (const std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if (samples > 0) {
+		options.renderSamples = static_cast<uint32_t>(samples);
+		options.referenceSamples = static_cast<uint32_t>(samples);
+	}
+
+	if (!options.renderCapturePath.empty()) {
+		if (!outSet)
+			options.outputPath = "renders/render.ppm";
+
+		try {
+			VulkanBase app(options);
+			app.run();
+
+			if (!app.isTiledCaptureWritten()) {
+				std::cerr << "Render not written\n";
+				return EXIT_FAILURE;
+			}
+		}
+		catch (const std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if (!sweepPath.empty()) {
+		const std::optional<ParameterSweep> sweep = ParameterSweep::load(sweepPath);
+		if (!sweep)
+			return EXIT_FAILURE;
+		options.configs = sweep->generateConfigs();
+		std::cout << "[Bench] Sweep " << sweep->name << ": " << options.configs.size() << " configs\n";
+	}
+	else if (!appendSuite(suite, options.configs)) {
+		std::cerr << "Unknown suite: " << suite << "\n";
+		printUsage();
+		return EXIT_FAILURE;
+	}
+	if (suite == "devicegroup")
+		options.deviceGroup = true;
+	if (options.extent.width == 0 || options.extent.height == 0) {
+		std::cerr << "Width and height must be non-zero\n";
+		return EXIT_FAILURE;
+	}
+
+	for (WaterTestConfig &config : options.configs) {
+		if (frames > 0)
+			config.totalFrames = config.warmupFrames + frames;
+		if (runs > 0)
+			config.repeatCount = runs;
+		if (synced)
+			config.pipelinedTiming = false;
+		config.captureGpuCounters = gpuCounters;
+	}
+
+	if (options.renderReferences) {
+		try {
+			VulkanBase app(options);
+			app.run();
+			std::cout << "[Bench] " << app.getRenderedReferenceCount() << " references written to " << options.referenceDirectory << "\n";
+		}
+		catch (const std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	try {
+		VulkanBase app(options);
+		app.run();
+
+		if (app.getCompletedTestRunCount() == 0) {
+			std::cerr << "No test runs completed\n";
+			return EXIT_FAILURE;
+		}
+		std::cout << "[Bench] " << app.getCompletedTestRunCount() << " runs written to " << options.outputPath << "\n";
+		if (app.hasRegressionFailure()) {
+			std::cerr << "Regression against " << options.baselinePath << "\n";
+			return EXIT_FAILURE;
+		}
+	}
+	catch (const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+#include "BindlessTable.h"
+#include <array>
+#include <stdexcept>
+#include <string>
+
+// ============================================================================
+// SUPPORT
+// ============================================================================
+
+bool BindlessTable::isSupported(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceVulkan12Features vulkan12{};
+    vulkan12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    if (!vulkan12.runtimeDescriptorArray || !vulkan12.descriptorBindingPartiallyBound ||
+        !vulkan12.descriptorBindingSampledImageUpdateAfterBind || !vulkan12.descriptorBindingStorageBufferUpdateAfterBind ||
+        !vulkan12.descriptorBindingUpdateUnusedWhilePending)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexing{};
+    indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &indexing;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+    // A combined image sampler counts against both the sampler and the sampled-image limits
+    return indexing.maxPerStageDescriptorUpdateAfterBindSamplers >= kMaxTextures &&
+           indexing.maxPerStageDescriptorUpdateAfterBindSampledImages >= kMaxTextures &&
+           indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers >= kMaxBuffers &&
+           indexing.maxDescriptorSetUpdateAfterBindSamplers >= kMaxTextures &&
+           indexing.maxDescriptorSetUpdateAfterBindSampledImages >= kMaxTextures &&
+           indexing.maxDescriptorSetUpdateAfterBindStorageBuffers >= kMaxBuffers;
+}
+
+void BindlessTable::enableFeatures(VkPhysicalDeviceVulkan12Features &features)
+{
+    features.descriptorIndexing = VK_TRUE;
+    features.runtimeDescriptorArray = VK_TRUE;
+    features.descriptorBindingPartiallyBound = VK_TRUE;
+    features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+BindlessTable::BindlessTable(VkDevice device, uint32_t framesInFlight)
+    : m_device(device), m_framesInFlight(framesInFlight)
+{
+    m_textures.capacity = kMaxTextures;
+    m_buffers.capacity = kMaxBuffers;
+
+    // Every stage may index the table; unused stages cost nothing
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = kTextureBinding;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = kMaxTextures;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[1].binding = kBufferBinding;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = kMaxBuffers;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    const VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                           VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                           VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    std::array<VkDescriptorBindingFlags, 2> bindingFlags = {flags, flags};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    flagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_layout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bindless descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, kMaxTextures};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, kMaxBuffers};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_layout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate the bindless descriptor set!");
+    }
+}
+
+BindlessTable::~BindlessTable()
+{
+    vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+}
+
+// ============================================================================
+// SLOTS
+// ============================================================================
+
+uint32_t BindlessTable::Slots::allocate(const char *kind)
+{
+    if (!free.empty())
+    {
+        const uint32_t index = free.back();
+        free.pop_back();
+        return index;
+    }
+    if (next == capacity)
+    {
+        throw std::runtime_error(std::string("bindless table is out of ") + kind + " slots!");
+    }
+    return next++;
+}
+
+void BindlessTable::retire(Slots &slots, uint32_t index)
+{
+    slots.retired.emplace_back(index, m_frame + m_framesInFlight);
+}
+
+uint32_t BindlessTable::addTexture(VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+    const uint32_t index = m_textures.allocate("texture");
+
+    VkDescriptorImageInfo imageInfo{sampler, view, layout};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = kTextureBinding;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    return index;
+}
+
+uint32_t BindlessTable::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    const uint32_t index = m_buffers.allocate("buffer");
+
+    VkDescriptorBufferInfo bufferInfo{buffer, offset, range};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = kBufferBinding;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    return index;
+}
+
+void BindlessTable::removeTexture(uint32_t index)
+{
+    retire(m_textures, index);
+}
+
+void BindlessTable::removeBuffer(uint32_t index)
+{
+    retire(m_buffers, index);
+}
+
+void BindlessTable::beginFrame()
+{
+    m_frame++;
+    for (Slots *slots : {&m_textures, &m_buffers})
+    {
+        // Retired in frame order, so the ready ones are at the front
+        while (!slots->retired.empty() && slots->retired.front().second <= m_frame)
+        {
+            slots->free.push_back(slots->retired.front().first);
+            slots->retired.pop_front();
+        }
+    }
+}
@@ -0,0 +1,254 @@
+#include "CdlodGrid.h"
+#include "Scene.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <cstddef>
+
+CdlodGrid::CdlodGrid(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, float size, float height,
+                     uint32_t levels)
+    : m_size(size), m_height(height), m_levels(std::max(levels, 1u))
+{
+    const float finestNode = m_size / static_cast<float>(1u << (m_levels - 1));
+    for (uint32_t level = 0; level < m_levels; level++)
+    {
+        m_ranges.push_back(kRangeScale * finestNode * static_cast<float>(1u << level));
+    }
+    m_selection.resize(kMaxTiles * 2);
+
+    // ---- Shared tile: (N + 1)^2 cell corners, the full tile's indices then its min-corner quarter's ----
+    const uint32_t N = kTileCells;
+    std::vector<CdlodVertex> vertices;
+    vertices.reserve((N + 1) * (N + 1));
+    for (uint32_t z = 0; z <= N; z++)
+    {
+        for (uint32_t x = 0; x <= N; x++)
+        {
+            vertices.push_back({static_cast<uint16_t>(x), static_cast<uint16_t>(z)});
+        }
+    }
+
+    std::vector<uint32_t> indices;
+    auto addQuads = [&](uint32_t cells)
+    {
+        for (uint32_t z = 0; z < cells; z++)
+        {
+            for (uint32_t x = 0; x < cells; x++)
+            {
+                uint32_t i0 = z * (N + 1) + x;
+                uint32_t i1 = i0 + 1;
+                uint32_t i2 = i0 + (N + 1);
+                uint32_t i3 = i2 + 1;
+
+                indices.insert(indices.end(), {i0, i2, i1, i1, i2, i3});
+            }
+        }
+    };
+    addQuads(N);
+    m_indexCount = static_cast<uint32_t>(indices.size());
+    addQuads(N / 2);
+
+    // (N + 1)^2 vertices: 16-bit indices
+    m_tile = std::make_unique<GpuMesh>(device, physicalDevice, vertices, indices);
+
+    // ---- Per-frame tiles: full tiles from the start, quarters from kMaxTiles ----
+    m_frames.resize(frameCount);
+    for (FrameResources &frame : m_frames)
+    {
+        auto [tileBuffer, tileMemory] = VkUtils::CreateBuffer(
+            device, physicalDevice, sizeof(CdlodTile) * kMaxTiles * 2,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frame.tileBuffer = tileBuffer;
+        frame.tiles = static_cast<CdlodTile *>(VkUtils::MapBuffer(tileBuffer));
+    }
+}
+
+CdlodGrid::~CdlodGrid()
+{
+    for (FrameResources &frame : m_frames)
+    {
+        VkUtils::DestroyBuffer(frame.tileBuffer);
+    }
+}
+
+VkVertexInputBindingDescription CdlodGrid::getVertexBindingDescription()
+{
+    VkVertexInputBindingDescription binding{};
+    binding.binding = 0;
+    binding.stride = sizeof(CdlodVertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return binding;
+}
+
+VkVertexInputAttributeDescription CdlodGrid::getVertexAttributeDescription()
+{
+    VkVertexInputAttributeDescription attribute{};
+    attribute.binding = 0;
+    attribute.location = 0;
+    attribute.format = VK_FORMAT_R16G16_UINT;
+    attribute.offset = offsetof(CdlodVertex, x);
+    return attribute;
+}
+
+VkVertexInputBindingDescription CdlodGrid::getInstanceBindingDescription()
+{
+    VkVertexInputBindingDescription binding{};
+    binding.binding = kInstanceBinding;
+    binding.stride = sizeof(CdlodTile);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    return binding;
+}
+
+std::array<VkVertexInputAttributeDescription, 2> CdlodGrid::getInstanceAttributeDescriptions()
+{
+    std::array<VkVertexInputAttributeDescription, 2> attributes{};
+    attributes[0].binding = kInstanceBinding;
+    attributes[0].location = kInstanceFirstLocation;
+    attributes[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attributes[0].offset = offsetof(CdlodTile, node);
+
+    attributes[1].binding = kInstanceBinding;
+    attributes[1].location = kInstanceFirstLocation + 1;
+    attributes[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attributes[1].offset = offsetof(CdlodTile, morph);
+    return attributes;
+}
+
+// ============================================================================
+// SELECTION
+// ============================================================================
+
+float CdlodGrid::distanceTo(const glm::vec2 &origin, float size, const glm::vec3 &cameraPos) const
+{
+    const glm::vec2 camera(cameraPos.x, cameraPos.z);
+    const glm::vec2 closest = glm::clamp(camera, origin, origin + glm::vec2(size));
+    return glm::length(glm::vec3(closest.x - camera.x, m_height - cameraPos.y, closest.y - camera.y));
+}
+
+bool CdlodGrid::isCulled(const glm::vec2 &origin, float size) const
+{
+    if (!m_frustum)
+        return false;
+
+    Aabb bounds;
+    bounds.min = glm::vec3(origin.x - m_margin.x, m_height - m_margin.y, origin.y - m_margin.x);
+    bounds.max = glm::vec3(origin.x + size + m_margin.x, m_height + m_margin.y, origin.y + size + m_margin.x);
+    return !m_frustum->intersects(bounds);
+}
+
+void CdlodGrid::addTile(FrameResources &frame, const glm::vec2 &origin, float size, uint32_t level, bool quarter)
+{
+    uint32_t &count = quarter ? frame.quarterCount : frame.tileCount;
+    if (count >= kMaxTiles)
+    {
+        return;
+    }
+
+    const float start = kMorphStart * m_ranges[level];
+    const float end = m_ranges[level];
+
+    CdlodTile &tile = m_selection[(quarter ? kMaxTiles : 0) + count++];
+    tile.node = glm::vec4(origin.x, origin.y, size, m_height);
+    tile.morph = glm::vec4(end / (end - start), 1.0f / (end - start), 1.0f / m_size, static_cast<float>(level));
+}
+
+bool CdlodGrid::selectNode(FrameResources &frame, const glm::vec2 &origin, float size, uint32_t level,
+                           const glm::vec3 &cameraPos, float viewDistance)
+{
+    const float distance = distanceTo(origin, size, cameraPos);
+    if (distance > viewDistance)
+    {
+        return true; // Never seen: nothing for the parent to cover
+    }
+    if (isCulled(origin, size))
+    {
+        frame.culledCount++;
+        return true; // Nor is this
+    }
+    if (distance > m_ranges[level])
+    {
+        return false;
+    }
+    if (level == 0 || distance > m_ranges[level - 1])
+    {
+        addTile(frame, origin, size, level, false);
+        return true;
+    }
+
+    // Children the finer level does not reach are drawn as quarters of this node: the quarter
+    // tile keeps this node's size, so its cells match this level's spacing
+    const float half = size * 0.5f;
+    for (uint32_t child = 0; child < 4; child++)
+    {
+        const glm::vec2 childOrigin = origin + glm::vec2(child & 1 ? half : 0.0f, child & 2 ? half : 0.0f);
+        if (!selectNode(frame, childOrigin, half, level - 1, cameraPos, viewDistance))
+        {
+            addTile(frame, childOrigin, size, level, true);
+        }
+    }
+    return true;
+}
+
+void CdlodGrid::select(uint32_t frameIndex, const glm::vec3 &cameraPos, float viewDistance, DrawKey::Order order,
+                       const Frustum *frustum, const glm::vec2 &margin)
+{
+    FrameResources &frame = m_frames[frameIndex];
+    frame.tileCount = 0;
+    frame.quarterCount = 0;
+    frame.culledCount = 0;
+    m_frustum = frustum;
+    m_margin = margin;
+
+    // The root is drawn whole when even the coarsest range does not reach it
+    const glm::vec2 origin(-m_size * 0.5f);
+    if (!selectNode(frame, origin, m_size, m_levels - 1, cameraPos, viewDistance))
+    {
+        addTile(frame, origin, m_size, m_levels - 1, false);
+    }
+    m_frustum = nullptr;
+
+    writeSorted(frame.tiles, 0, frame.tileCount, false, cameraPos, order);
+    writeSorted(frame.tiles + kMaxTiles, kMaxTiles, frame.quarterCount, true, cameraPos, order);
+}
+
+void CdlodGrid::writeSorted(CdlodTile *out, uint32_t first, uint32_t count, bool quarter, const glm::vec3 &cameraPos,
+                            DrawKey::Order order)
+{
+    m_sortEntries.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const CdlodTile &tile = m_selection[first + i];
+        const float extent = quarter ? tile.node.z * 0.5f : tile.node.z;
+        const float distance = distanceTo(glm::vec2(tile.node.x, tile.node.y), extent, cameraPos);
+        m_sortEntries[i] = {DrawKey::quantizeDepth(distance, order), first + i};
+    }
+    DrawKey::sort(m_sortEntries, m_sortScratch);
+
+    // Written once, in order, into the mapped buffer
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = m_selection[m_sortEntries[i].index];
+    }
+}
+
+void CdlodGrid::draw(VkCommandBuffer cmd, uint32_t frameIndex) const
+{
+    const FrameResources &frame = m_frames[frameIndex];
+    if (frame.tileCount + frame.quarterCount == 0)
+    {
+        return;
+    }
+
+    m_tile->bind(cmd);
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, kInstanceBinding, 1, &frame.tileBuffer, &offset);
+
+    if (frame.tileCount > 0)
+    {
+        vkCmdDrawIndexed(cmd, m_indexCount, frame.tileCount, 0, 0, 0);
+    }
+    if (frame.quarterCount > 0)
+    {
+        vkCmdDrawIndexed(cmd, m_indexCount / 4, frame.quarterCount, m_indexCount, 0, kMaxTiles);
+    }
+}
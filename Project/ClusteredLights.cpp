@@ -0,0 +1,195 @@
+#include "ClusteredLights.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "Vertex.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(sizeof(PointLight) == 32, "PointLight must match the std430 struct in the shaders");
+static_assert(sizeof(LightInfo) == 160, "LightInfo must match the std140 block in 3d_shader.frag and water.frag");
+
+ClusteredLights::ClusteredLights(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount)
+    : m_device(device), m_frames(frameCount)
+{
+    m_lightBufferSize = sizeof(PointLight) * kMaxLights * frameCount;
+    auto [lightBuffer, lightMemory] = VkUtils::CreateBuffer(
+        device, physicalDevice, m_lightBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_lightBuffer = lightBuffer;
+    PointLight *mapped = static_cast<PointLight *>(VkUtils::MapBuffer(lightBuffer));
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        m_frames[i].lights = mapped + i * kMaxLights;
+    }
+
+    m_clusterBufferSize = sizeof(uint32_t) * kClusterStride * kClusterCount * frameCount;
+    auto [clusterBuffer, clusterMemory] = VkUtils::CreateBuffer(
+        device, physicalDevice, m_clusterBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_clusterBuffer = clusterBuffer;
+
+    // Lights, cluster lists
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create light cluster descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2};
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create light cluster descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate light cluster descriptor set!");
+    }
+
+    // Whole buffers: the frame's copies are picked through the push constants
+    std::array<VkDescriptorBufferInfo, 2> bufferInfos = {{{m_lightBuffer, 0, m_lightBufferSize},
+                                                          {m_clusterBuffer, 0, m_clusterBufferSize}}};
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterPush)};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create light cluster pipeline layout!");
+    }
+
+    createPipeline();
+}
+
+ClusteredLights::~ClusteredLights()
+{
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+
+    VkUtils::DestroyBuffer(m_lightBuffer);
+    VkUtils::DestroyBuffer(m_clusterBuffer);
+}
+
+void ClusteredLights::createPipeline()
+{
+    if (m_pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(m_device, m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+
+    std::vector<char> code = ShaderRegistry::load("shaders/light_cluster.comp.spv");
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader module: shaders/light_cluster.comp.spv");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &m_pipeline);
+    vkDestroyShaderModule(m_device, module, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create light cluster pipeline!");
+    }
+}
+
+void ClusteredLights::update(uint32_t frameIndex, const std::vector<PointLight> &lights, const glm::mat4 &view, float fovY,
+                             float aspect, float farPlane, LightInfo &lightInfo)
+{
+    if (frameIndex >= m_frames.size())
+    {
+        throw std::out_of_range("ClusteredLights frame index out of range!");
+    }
+
+    FrameResources &frame = m_frames[frameIndex];
+    const uint32_t count = static_cast<uint32_t>(std::min<size_t>(lights.size(), kMaxLights));
+    if (count > 0)
+    {
+        memcpy(frame.lights, lights.data(), sizeof(PointLight) * count);
+    }
+
+    const float tanHalfFov = std::tan(fovY * 0.5f);
+    frame.push.view = view;
+    frame.push.projection = glm::vec4(1.0f / (tanHalfFov * aspect), 1.0f / tanHalfFov, kGridNear,
+                                      static_cast<float>(kSlices) / std::log(farPlane / kGridNear));
+    frame.push.info = glm::uvec4(count, frameIndex * kMaxLights, frameIndex * kClusterCount * kClusterStride, m_clustering ? 1u : 0u);
+
+    lightInfo.clusterView = frame.push.view;
+    lightInfo.clusterProjection = frame.push.projection;
+    lightInfo.clusterInfo = frame.push.info;
+}
+
+void ClusteredLights::recordCull(VkCommandBuffer cmd, uint32_t frameIndex) const
+{
+    const FrameResources &frame = m_frames[frameIndex];
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterPush), &frame.push);
+    vkCmdDispatch(cmd, (kClusterCount + kGroupSize - 1) / kGroupSize, 1, 1);
+
+    // The frame's lists are only read by the passes shading the scene and the water
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
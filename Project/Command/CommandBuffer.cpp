@@ -1,13 +1,13 @@
 #include "CommandBuffer.h"
 
-void CommandBuffer::initialize(VkDevice device, VkCommandPool commandPool) {
+void CommandBuffer::initialize(VkDevice device, VkCommandPool commandPool, VkCommandBufferLevel level) {
     this->device = device;
     this->commandPool = commandPool;
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.level = level;
     allocInfo.commandBufferCount = 1;
 
     vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
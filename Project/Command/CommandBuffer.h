@@ -3,7 +3,7 @@
 
 class CommandBuffer {
 public:
-    void initialize(VkDevice device, VkCommandPool commandPool);
+    void initialize(VkDevice device, VkCommandPool commandPool, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
     void reset();
     void begin(const VkCommandBufferBeginInfo* beginInfo);
     void end();
@@ -16,9 +16,9 @@ void CommandPool::initialize(const VkDevice& device, VkPhysicalDevice physicalDe
     m_VkDevice = device;
 }
 
-CommandBuffer CommandPool::createCommandBuffer() const {
+CommandBuffer CommandPool::createCommandBuffer(VkCommandBufferLevel level) const {
     CommandBuffer cmdBuffer;
-    cmdBuffer.initialize(m_VkDevice, m_CommandPool);
+    cmdBuffer.initialize(m_VkDevice, m_CommandPool, level);
     return cmdBuffer;
 }
 
@@ -31,6 +31,8 @@ void CommandPool::create(VkDevice device, uint32_t queueFamilyIndex) {
     if (vkCreateCommandPool(device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    m_VkDevice = device;
 }
 
 void CommandPool::destroy() {
@@ -38,3 +40,9 @@ void CommandPool::destroy() {
         vkDestroyCommandPool(m_VkDevice, m_CommandPool, nullptr);
     }
 }
+
+void CommandPool::reset() {
+    if (vkResetCommandPool(m_VkDevice, m_CommandPool, 0) != VK_SUCCESS) {
+        throw std::runtime_error("failed to reset command pool!");
+    }
+}
@@ -14,7 +14,9 @@ public:
     // Methods
     void initialize(const VkDevice& device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
     void destroy();
-    CommandBuffer createCommandBuffer() const;
+    // Returns every buffer allocated from the pool to the initial state at once
+    void reset();
+    CommandBuffer createCommandBuffer(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) const;
     VkCommandPool getVkCommandPool() const { return m_CommandPool; }
 private:
     VkCommandPool m_CommandPool;
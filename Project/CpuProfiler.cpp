@@ -0,0 +1,175 @@
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct ZoneEvent
+    {
+        const char *name;
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+
+    struct ThreadRing
+    {
+        uint32_t id = 0;
+        std::string name; // Guarded by the registry mutex
+        std::unique_ptr<ZoneEvent[]> events{new ZoneEvent[CpuProfiler::kEventsPerThread]};
+        std::atomic<uint64_t> written{0}; // Events ever written; the ring holds the last kEventsPerThread
+    };
+
+    std::mutex g_registryMutex;
+    std::vector<std::unique_ptr<ThreadRing>> g_rings; // Outlive their threads, so a trace keeps exited ones
+    std::atomic<bool> g_capturing{false};
+    std::atomic<uint64_t> g_startNs{0};
+
+    ThreadRing &threadRing()
+    {
+        thread_local ThreadRing *ring = []
+        {
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+            g_rings.push_back(std::make_unique<ThreadRing>());
+            ThreadRing *created = g_rings.back().get();
+            created->id = static_cast<uint32_t>(g_rings.size());
+            created->name = "Thread " + std::to_string(created->id);
+            return created;
+        }();
+        return *ring;
+    }
+
+    void writeEscaped(std::ostream &out, const std::string &text)
+    {
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\';
+            out << c;
+        }
+    }
+}
+
+// ============================================================================
+// ZONES
+// ============================================================================
+
+CpuProfiler::Zone::Zone(const char *name)
+    : m_name(name), m_active(g_capturing.load(std::memory_order_relaxed))
+{
+    if (m_active)
+        m_startNs = nowNs();
+}
+
+CpuProfiler::Zone::~Zone()
+{
+    if (!m_active)
+        return;
+
+    const uint64_t endNs = nowNs();
+    ThreadRing &ring = threadRing();
+    const uint64_t index = ring.written.load(std::memory_order_relaxed);
+    ring.events[index % kEventsPerThread] = {m_name, m_startNs, endNs};
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(const std::string &name)
+{
+    ThreadRing &ring = threadRing();
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    ring.name = name;
+}
+
+// ============================================================================
+// CAPTURE
+// ============================================================================
+
+void CpuProfiler::start()
+{
+    g_startNs.store(nowNs(), std::memory_order_relaxed);
+    g_capturing.store(true, std::memory_order_release);
+}
+
+void CpuProfiler::stop()
+{
+    g_capturing.store(false, std::memory_order_release);
+}
+
+bool CpuProfiler::isCapturing()
+{
+    return g_capturing.load(std::memory_order_relaxed);
+}
+
+bool CpuProfiler::writeChromeTrace(const std::string &filePath)
+{
+    std::ofstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "[CpuProfiler] Failed to open file for export: " << filePath << "\n";
+        return false;
+    }
+
+    // Zones from an earlier capture are left out
+    const uint64_t startNs = g_startNs.load(std::memory_order_relaxed);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+         << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}}";
+    const size_t eventCount = writeTraceEvents(file, startNs, startNs, UINT64_MAX);
+    file << "\n]}\n";
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    std::cout << "[CpuProfiler] Wrote " << eventCount << " zones on " << g_rings.size() << " threads to " << filePath << "\n";
+    return true;
+}
+
+size_t CpuProfiler::writeTraceEvents(std::ostream &out, uint64_t originNs, uint64_t fromNs, uint64_t toNs)
+{
+    size_t eventCount = 0;
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    for (const auto &ring : g_rings)
+    {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->id << ",\"args\":{\"name\":\"";
+        writeEscaped(out, ring->name);
+        out << "\"}}";
+
+        // Copy first, then keep only the events the owner cannot have overwritten meanwhile: it may be
+        // writing slot 'written' (index written - kEventsPerThread) without having published it yet
+        const uint64_t written = ring->written.load(std::memory_order_acquire);
+        const uint64_t begin = written > kEventsPerThread ? written - kEventsPerThread : 0;
+        std::vector<ZoneEvent> events(static_cast<size_t>(written - begin));
+        for (uint64_t i = begin; i < written; i++)
+        {
+            events[static_cast<size_t>(i - begin)] = ring->events[i % kEventsPerThread];
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t rewritten = ring->written.load(std::memory_order_relaxed);
+        const uint64_t valid = rewritten >= kEventsPerThread ? rewritten - kEventsPerThread + 1 : 0;
+
+        for (uint64_t i = std::max(begin, valid); i < written; i++)
+        {
+            const ZoneEvent &event = events[static_cast<size_t>(i - begin)];
+            if (event.startNs < fromNs || event.startNs >= toNs)
+                continue;
+
+            out << ",\n{\"name\":\"";
+            writeEscaped(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->id << std::fixed << std::setprecision(3)
+                << ",\"ts\":" << static_cast<double>(static_cast<int64_t>(event.startNs - originNs)) / 1000.0
+                << ",\"dur\":" << static_cast<double>(event.endNs - event.startNs) / 1000.0 << "}";
+            eventCount++;
+        }
+    }
+    return eventCount;
+}
+
+uint64_t CpuProfiler::nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
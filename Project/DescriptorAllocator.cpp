@@ -0,0 +1,212 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <stdexcept>
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t framesInFlight)
+    : m_device(device), m_framesInFlight(framesInFlight)
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+    for (LayoutClass &layoutClass : m_classes)
+    {
+        for (VkDescriptorPool pool : layoutClass.persistent.pools)
+        {
+            vkDestroyDescriptorPool(m_device, pool, nullptr);
+        }
+        for (PoolList &list : layoutClass.transient)
+        {
+            for (VkDescriptorPool pool : list.pools)
+            {
+                vkDestroyDescriptorPool(m_device, pool, nullptr);
+            }
+        }
+    }
+}
+
+// ============================================================================
+// LAYOUT CLASSES
+// ============================================================================
+
+void DescriptorAllocator::registerLayout(VkDescriptorSetLayout layout, const VkDescriptorSetLayoutBinding *bindings,
+                                         uint32_t bindingCount, VkDescriptorSetLayoutCreateFlags flags)
+{
+    // Descriptor counts per type, so that layouts differing only in binding order share a class
+    std::vector<VkDescriptorPoolSize> perSet;
+    for (uint32_t i = 0; i < bindingCount; i++)
+    {
+        auto it = std::find_if(perSet.begin(), perSet.end(), [&](const VkDescriptorPoolSize &size)
+                               { return size.type == bindings[i].descriptorType; });
+        if (it == perSet.end())
+        {
+            perSet.push_back({bindings[i].descriptorType, bindings[i].descriptorCount});
+        }
+        else
+        {
+            it->descriptorCount += bindings[i].descriptorCount;
+        }
+    }
+    std::sort(perSet.begin(), perSet.end(), [](const VkDescriptorPoolSize &a, const VkDescriptorPoolSize &b)
+              { return a.type < b.type; });
+
+    const VkDescriptorPoolCreateFlags poolFlags =
+        (flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT) ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
+
+    for (size_t i = 0; i < m_classes.size(); i++)
+    {
+        const LayoutClass &existing = m_classes[i];
+        const bool sameCounts = existing.perSet.size() == perSet.size() &&
+                                std::equal(perSet.begin(), perSet.end(), existing.perSet.begin(),
+                                           [](const VkDescriptorPoolSize &a, const VkDescriptorPoolSize &b)
+                                           { return a.type == b.type && a.descriptorCount == b.descriptorCount; });
+        if (sameCounts && existing.poolFlags == poolFlags)
+        {
+            m_layoutClasses[layout] = i;
+            return;
+        }
+    }
+
+    LayoutClass layoutClass;
+    layoutClass.perSet = std::move(perSet);
+    layoutClass.poolFlags = poolFlags;
+    layoutClass.transient.resize(m_framesInFlight);
+    m_classes.push_back(std::move(layoutClass));
+    m_layoutClasses[layout] = m_classes.size() - 1;
+}
+
+DescriptorAllocator::LayoutClass &DescriptorAllocator::classOf(VkDescriptorSetLayout layout)
+{
+    auto it = m_layoutClasses.find(layout);
+    if (it == m_layoutClasses.end())
+    {
+        throw std::runtime_error("descriptor set layout was not registered with the allocator!");
+    }
+    return m_classes[it->second];
+}
+
+// ============================================================================
+// POOLS
+// ============================================================================
+
+VkDescriptorPool DescriptorAllocator::createPool(const LayoutClass &layoutClass, PoolList &list)
+{
+    const uint32_t setCount = list.nextSetsPerPool;
+    list.nextSetsPerPool = std::min(setCount * 2, kMaxSetsPerPool);
+
+    std::vector<VkDescriptorPoolSize> poolSizes = layoutClass.perSet;
+    for (VkDescriptorPoolSize &size : poolSizes)
+    {
+        size.descriptorCount *= setCount;
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = layoutClass.poolFlags;
+    poolInfo.maxSets = setCount;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+    list.pools.push_back(pool);
+    return pool;
+}
+
+bool DescriptorAllocator::tryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet &set) const
+{
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    const VkResult result = vkAllocateDescriptorSets(m_device, &allocInfo, &set);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        return false;
+    }
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor set!");
+    }
+    return true;
+}
+
+// ============================================================================
+// ALLOCATION
+// ============================================================================
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    LayoutClass &layoutClass = classOf(layout);
+    PoolList &list = layoutClass.persistent;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    if (!list.pools.empty() && tryAllocate(list.pools.back(), layout, set))
+    {
+        return set;
+    }
+    // Full: the old pool keeps its sets, new ones come from a larger pool
+    if (!tryAllocate(createPool(layoutClass, list), layout, set))
+    {
+        throw std::runtime_error("failed to allocate descriptor set from a fresh pool!");
+    }
+    return set;
+}
+
+VkDescriptorSet DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout)
+{
+    LayoutClass &layoutClass = classOf(layout);
+    PoolList &list = layoutClass.transient[m_frameIndex];
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    // Pools from earlier frames were reset by beginFrame: fill them before growing
+    for (; list.open < list.pools.size(); list.open++)
+    {
+        if (tryAllocate(list.pools[list.open], layout, set))
+        {
+            return set;
+        }
+    }
+    if (!tryAllocate(createPool(layoutClass, list), layout, set))
+    {
+        throw std::runtime_error("failed to allocate descriptor set from a fresh pool!");
+    }
+    return set;
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex)
+{
+    m_frameIndex = frameIndex;
+    for (LayoutClass &layoutClass : m_classes)
+    {
+        PoolList &list = layoutClass.transient[frameIndex];
+        for (VkDescriptorPool pool : list.pools)
+        {
+            vkResetDescriptorPool(m_device, pool, 0);
+        }
+        list.open = 0;
+    }
+}
+
+uint32_t DescriptorAllocator::getPoolCount() const
+{
+    size_t count = 0;
+    for (const LayoutClass &layoutClass : m_classes)
+    {
+        count += layoutClass.persistent.pools.size();
+        for (const PoolList &list : layoutClass.transient)
+        {
+            count += list.pools.size();
+        }
+    }
+    return static_cast<uint32_t>(count);
+}
@@ -0,0 +1,378 @@
+#include "DeterministicCameraPath.h"
+#include "Lib/json.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace
+{
+    // Knot spacing of the centripetal parameterization; keeps coincident keys from dividing by zero
+    float knotInterval(const glm::vec3 &a, const glm::vec3 &b)
+    {
+        return std::max(std::sqrt(glm::length(b - a)), 1e-4f);
+    }
+
+    float catmullRom(const float (&p)[4], float u)
+    {
+        const float u2 = u * u;
+        const float u3 = u2 * u;
+        return 0.5f * (2.0f * p[1] + (p[2] - p[0]) * u + (2.0f * p[0] - 5.0f * p[1] + 4.0f * p[2] - p[3]) * u2 +
+                       (3.0f * p[1] - p[0] - 3.0f * p[2] + p[3]) * u3);
+    }
+}
+
+void DeterministicCameraPath::setKeyframes(std::vector<CameraKeyframe> keyframes)
+{
+    m_keyframes = std::move(keyframes);
+    std::stable_sort(m_keyframes.begin(), m_keyframes.end(), [](const CameraKeyframe &a, const CameraKeyframe &b)
+                     { return a.timestamp < b.timestamp; });
+    build();
+}
+
+void DeterministicCameraPath::build()
+{
+    m_segments.clear();
+    m_arcLength.clear();
+    m_segmentHint = 0;
+    const size_t count = m_keyframes.size();
+    if (count < 2)
+        return;
+
+    // Yaw taken the short way round from each key to the next
+    std::vector<float> yaw(count);
+    yaw[0] = m_keyframes[0].yaw;
+    for (size_t i = 1; i < count; i++)
+    {
+        const float delta = m_keyframes[i].yaw - m_keyframes[i - 1].yaw;
+        yaw[i] = yaw[i - 1] + delta - 360.0f * std::round(delta / 360.0f);
+    }
+
+    // The ends are continued by reflecting their neighbour, so the first and last segments need no special case
+    auto point = [&](ptrdiff_t i)
+    {
+        if (i < 0)
+            return 2.0f * m_keyframes[0].position - m_keyframes[1].position;
+        if (i >= static_cast<ptrdiff_t>(count))
+            return 2.0f * m_keyframes[count - 1].position - m_keyframes[count - 2].position;
+        return m_keyframes[i].position;
+    };
+    auto scalar = [&](auto get, ptrdiff_t i)
+    {
+        if (i < 0)
+            return 2.0f * get(0) - get(1);
+        if (i >= static_cast<ptrdiff_t>(count))
+            return 2.0f * get(count - 1) - get(count - 2);
+        return get(static_cast<size_t>(i));
+    };
+    auto getYaw = [&](size_t i)
+    { return yaw[i]; };
+    auto getPitch = [&](size_t i)
+    { return m_keyframes[i].pitch; };
+
+    m_segments.resize(count - 1);
+    for (size_t s = 0; s < count - 1; s++)
+    {
+        Segment &segment = m_segments[s];
+        for (int k = 0; k < 4; k++)
+        {
+            const ptrdiff_t i = static_cast<ptrdiff_t>(s) + k - 1;
+            segment.points[k] = point(i);
+            segment.yaw[k] = scalar(getYaw, i);
+            segment.pitch[k] = scalar(getPitch, i);
+        }
+        segment.knots[0] = 0.0f;
+        for (int k = 1; k < 4; k++)
+        {
+            segment.knots[k] = segment.knots[k - 1] + knotInterval(segment.points[k - 1], segment.points[k]);
+        }
+    }
+
+    // Arc length by chords between evenly spaced samples of each segment
+    m_arcLength.reserve(m_segments.size() * kArcSamplesPerSegment + 1);
+    m_arcLength.push_back(0.0f);
+    glm::vec3 previous = m_keyframes[0].position;
+    for (size_t s = 0; s < m_segments.size(); s++)
+    {
+        for (uint32_t j = 1; j <= kArcSamplesPerSegment; j++)
+        {
+            const glm::vec3 position = evaluate(s, static_cast<float>(j) / kArcSamplesPerSegment).position;
+            m_arcLength.push_back(m_arcLength.back() + glm::length(position - previous));
+            previous = position;
+        }
+    }
+}
+
+CameraKeyframe DeterministicCameraPath::evaluate(size_t segmentIndex, float u) const
+{
+    const Segment &segment = m_segments[segmentIndex];
+    const glm::vec3(&p)[4] = segment.points;
+    const float(&k)[4] = segment.knots;
+
+    // Barry-Goldman pyramid over the centripetal knots
+    const float t = k[1] + (k[2] - k[1]) * u;
+    const glm::vec3 a1 = ((k[1] - t) * p[0] + (t - k[0]) * p[1]) / (k[1] - k[0]);
+    const glm::vec3 a2 = ((k[2] - t) * p[1] + (t - k[1]) * p[2]) / (k[2] - k[1]);
+    const glm::vec3 a3 = ((k[3] - t) * p[2] + (t - k[2]) * p[3]) / (k[3] - k[2]);
+    const glm::vec3 b1 = ((k[2] - t) * a1 + (t - k[0]) * a2) / (k[2] - k[0]);
+    const glm::vec3 b2 = ((k[3] - t) * a2 + (t - k[1]) * a3) / (k[3] - k[1]);
+
+    CameraKeyframe result;
+    result.position = ((k[2] - t) * b1 + (t - k[1]) * b2) / (k[2] - k[1]);
+    result.yaw = catmullRom(segment.yaw, u);
+    result.pitch = catmullRom(segment.pitch, u);
+    return result;
+}
+
+size_t DeterministicCameraPath::findSegment(float t) const
+{
+    auto contains = [&](size_t s)
+    { return s < m_segments.size() && m_keyframes[s].timestamp <= t && t <= m_keyframes[s + 1].timestamp; };
+
+    if (contains(m_segmentHint))
+        return m_segmentHint;
+    if (contains(m_segmentHint + 1))
+        return ++m_segmentHint;
+
+    // The last key at or before t starts the segment
+    const auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), t, [](float value, const CameraKeyframe &key)
+                                       { return value < key.timestamp; });
+    const size_t index = static_cast<size_t>(std::max<ptrdiff_t>(next - m_keyframes.begin() - 1, 0));
+    m_segmentHint = std::min(index, m_segments.size() - 1);
+    return m_segmentHint;
+}
+
+CameraKeyframe DeterministicCameraPath::interpolate(float t) const
+{
+    if (m_keyframes.empty())
+        return {};
+    if (m_segments.empty())
+        return m_keyframes[0];
+
+    t = std::clamp(t, 0.0f, 1.0f);
+
+    size_t segment = 0;
+    float u = 0.0f;
+    if (constantSpeed && getLength() > 0.0f)
+    {
+        // Distance along the path, located in the arc-length table: the cached segment's samples first
+        const float distance = t * getLength();
+        auto first = m_arcLength.begin() + std::min(m_segmentHint, m_segments.size() - 1) * kArcSamplesPerSegment;
+        auto last = first + kArcSamplesPerSegment + 1;
+        if (distance < *first || distance > *(last - 1))
+        {
+            first = m_arcLength.begin();
+            last = m_arcLength.end();
+        }
+        const size_t sample = std::min<size_t>(std::max<ptrdiff_t>(std::upper_bound(first, last, distance) - m_arcLength.begin() - 1, 0),
+                                               m_arcLength.size() - 2);
+        const float span = m_arcLength[sample + 1] - m_arcLength[sample];
+        const float fraction = span > 0.0f ? (distance - m_arcLength[sample]) / span : 0.0f;
+
+        segment = sample / kArcSamplesPerSegment;
+        u = (static_cast<float>(sample % kArcSamplesPerSegment) + fraction) / kArcSamplesPerSegment;
+        m_segmentHint = segment;
+    }
+    else
+    {
+        segment = findSegment(t);
+        const float start = m_keyframes[segment].timestamp;
+        const float end = m_keyframes[segment + 1].timestamp;
+        u = end > start ? (t - start) / (end - start) : 0.0f;
+    }
+
+    CameraKeyframe result = evaluate(segment, std::clamp(u, 0.0f, 1.0f));
+    result.timestamp = t;
+    return result;
+}
+
+std::optional<DeterministicCameraPath> DeterministicCameraPath::loadFromJson(const std::string &filePath)
+{
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open camera path: " << filePath << std::endl;
+        return std::nullopt;
+    }
+
+    json pathJson = json::parse(file, nullptr, false);
+    if (pathJson.is_discarded() || !pathJson.contains("keyframes"))
+    {
+        std::cerr << "Malformed camera path: " << filePath << std::endl;
+        return std::nullopt;
+    }
+
+    DeterministicCameraPath path;
+    path.name = pathJson.value("name", filePath);
+    path.totalDuration = pathJson.value("duration", path.totalDuration);
+    path.constantSpeed = pathJson.value("constantSpeed", false);
+
+    std::vector<CameraKeyframe> keyframes;
+    try
+    {
+        for (const auto &key : pathJson["keyframes"])
+        {
+            const auto &position = key.at("position");
+            CameraKeyframe keyframe;
+            keyframe.position = glm::vec3(position.at(0).get<float>(), position.at(1).get<float>(), position.at(2).get<float>());
+            keyframe.yaw = key.value("yaw", 0.0f);
+            keyframe.pitch = key.value("pitch", 0.0f);
+            keyframe.timestamp = key.value("time", 0.0f);
+            keyframes.push_back(keyframe);
+        }
+    }
+    catch (const json::exception &e)
+    {
+        std::cerr << "Malformed camera path: " << filePath << " (" << e.what() << ")" << std::endl;
+        return std::nullopt;
+    }
+    if (keyframes.empty())
+    {
+        std::cerr << "Camera path has no keyframes: " << filePath << std::endl;
+        return std::nullopt;
+    }
+    path.setKeyframes(std::move(keyframes));
+    return path;
+}
+
+bool DeterministicCameraPath::saveToJson(const std::string &filePath) const
+{
+    json pathJson;
+    pathJson["name"] = name;
+    pathJson["duration"] = totalDuration;
+    pathJson["constantSpeed"] = constantSpeed;
+    pathJson["keyframes"] = json::array();
+    for (const CameraKeyframe &key : m_keyframes)
+    {
+        pathJson["keyframes"].push_back({{"position", {key.position.x, key.position.y, key.position.z}},
+                                         {"yaw", key.yaw},
+                                         {"pitch", key.pitch},
+                                         {"time", key.timestamp}});
+    }
+
+    std::ofstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write camera path: " << filePath << std::endl;
+        return false;
+    }
+    file << pathJson.dump(2) << "\n";
+    return true;
+}
+
+DeterministicCameraPath DeterministicCameraPath::createUnderwaterPath()
+{
+    DeterministicCameraPath path;
+    path.name = "UnderwaterSweep";
+    path.totalDuration = 10.0f;
+
+    // Full 360° smooth circular orbit around object at center (0,0,0)
+    // Radius = 55, constant depth Y = -25 (underwater), 8 keyframes for smooth interpolation
+    constexpr float R = 55.0f;
+    constexpr float Y = -25.0f;
+    constexpr float R45 = 38.89f; // R * sin(45°) ≈ R * 0.7071
+
+    path.setKeyframes({
+        {glm::vec3(0.0f, Y, R), 0.0f, 5.0f, 0.0f},         // Back (positive Z), looking at center
+        {glm::vec3(R45, Y, R45), 45.0f, 5.0f, 0.125f},     // Back-right
+        {glm::vec3(R, Y, 0.0f), 90.0f, 5.0f, 0.25f},       // Right side
+        {glm::vec3(R45, Y, -R45), 135.0f, 5.0f, 0.375f},   // Front-right
+        {glm::vec3(0.0f, Y, -R), 180.0f, 5.0f, 0.5f},      // Front (negative Z)
+        {glm::vec3(-R45, Y, -R45), -135.0f, 5.0f, 0.625f}, // Front-left
+        {glm::vec3(-R, Y, 0.0f), -90.0f, 5.0f, 0.75f},     // Left side
+        {glm::vec3(-R45, Y, R45), -45.0f, 5.0f, 0.875f},   // Back-left
+        {glm::vec3(0.0f, Y, R), 0.0f, 5.0f, 1.0f}});       // Back (complete loop)
+
+    return path;
+}
+
+DeterministicCameraPath DeterministicCameraPath::createSurfacePath()
+{
+    DeterministicCameraPath path;
+    path.name = "SurfaceSweep";
+    path.totalDuration = 10.0f;
+
+    // Full 360° smooth circular orbit around object at center (0,0,0)
+    // Radius = 55, constant depth Y = -5, 8 keyframes for smooth interpolation
+    constexpr float R = 55.0f;
+    constexpr float Y = -5.0f;
+    constexpr float R45 = 38.89f; // R * sin(45°) ≈ R * 0.7071
+
+    path.setKeyframes({
+        {glm::vec3(0.0f, Y, R), 0.0f, 5.0f, 0.0f},         // Back (positive Z), looking at center
+        {glm::vec3(R45, Y, R45), 45.0f, 5.0f, 0.125f},     // Back-right
+        {glm::vec3(R, Y, 0.0f), 90.0f, 5.0f, 0.25f},       // Right side
+        {glm::vec3(R45, Y, -R45), 135.0f, 5.0f, 0.375f},   // Front-right
+        {glm::vec3(0.0f, Y, -R), 180.0f, 5.0f, 0.5f},      // Front (negative Z)
+        {glm::vec3(-R45, Y, -R45), -135.0f, 5.0f, 0.625f}, // Front-left
+        {glm::vec3(-R, Y, 0.0f), -90.0f, 5.0f, 0.75f},     // Left side
+        {glm::vec3(-R45, Y, R45), -45.0f, 5.0f, 0.875f},   // Back-left
+        {glm::vec3(0.0f, Y, R), -90.0f, 5.0f, 1.0f}});     // Back (complete loop)
+
+    return path;
+}
+
+DeterministicCameraPath DeterministicCameraPath::createDepthTransitionPath()
+{
+    DeterministicCameraPath path;
+    path.name = "DepthTransition";
+    path.totalDuration = 10.0f;
+
+    // Full 360° smooth circular orbit around object at center (0,0,0)
+    // Radius = 55, depth transitions from Y=-5 to Y=-35 while orbiting
+    constexpr float R = 55.0f;
+    constexpr float R45 = 38.89f; // R * sin(45°) ≈ R * 0.7071
+
+    path.setKeyframes({
+        {glm::vec3(0.0f, -5.0f, R), 0.0f, 5.0f, 0.0f},           // Back, shallow
+        {glm::vec3(R45, -9.0f, R45), 45.0f, 3.0f, 0.125f},       // Back-right
+        {glm::vec3(R, -13.0f, 0.0f), 90.0f, 1.0f, 0.25f},        // Right side
+        {glm::vec3(R45, -17.0f, -R45), 135.0f, -1.0f, 0.375f},   // Front-right
+        {glm::vec3(0.0f, -21.0f, -R), 180.0f, -3.0f, 0.5f},      // Front
+        {glm::vec3(-R45, -25.0f, -R45), -135.0f, -3.0f, 0.625f}, // Front-left
+        {glm::vec3(-R, -29.0f, 0.0f), -90.0f, -1.0f, 0.75f},     // Left side
+        {glm::vec3(-R45, -53.0f, R45), -45.0f, 1.0f, 0.875f},    // Back-left
+        {glm::vec3(0.0f, -55.0f, R), 0.0f, 3.0f, 1.0f}});        // Back, deep
+
+    return path;
+}
+
+void CameraPathRecorder::start()
+{
+    m_samples.clear();
+    m_recording = true;
+}
+
+void CameraPathRecorder::sample(const glm::vec3 &position, float yaw, float pitch, double time)
+{
+    if (!m_recording || (!m_samples.empty() && time - m_samples.back().time < kInterval))
+        return;
+    m_samples.push_back({CameraKeyframe{position, yaw, pitch, 0.0f}, time});
+}
+
+DeterministicCameraPath CameraPathRecorder::stop(const std::string &name)
+{
+    m_recording = false;
+
+    DeterministicCameraPath path;
+    path.name = name;
+    if (m_samples.empty())
+        return path;
+
+    const double start = m_samples.front().time;
+    const double duration = m_samples.back().time - start;
+    std::vector<CameraKeyframe> keyframes;
+    keyframes.reserve(m_samples.size());
+    for (const Sample &sample : m_samples)
+    {
+        CameraKeyframe keyframe = sample.keyframe;
+        keyframe.timestamp = duration > 0.0 ? static_cast<float>((sample.time - start) / duration) : 0.0f;
+        keyframes.push_back(keyframe);
+    }
+    path.totalDuration = static_cast<float>(duration);
+    path.setKeyframes(std::move(keyframes));
+    m_samples.clear();
+    return path;
+}
@@ -0,0 +1,116 @@
+#include "DeviceGroup.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+std::vector<VkPhysicalDevice> DeviceGroup::find(VkInstance instance, VkPhysicalDevice physicalDevice)
+{
+    uint32_t groupCount = 0;
+    vkEnumeratePhysicalDeviceGroups(instance, &groupCount, nullptr);
+    std::vector<VkPhysicalDeviceGroupProperties> groups(groupCount);
+    for (VkPhysicalDeviceGroupProperties &group : groups)
+    {
+        group.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GROUP_PROPERTIES;
+    }
+    vkEnumeratePhysicalDeviceGroups(instance, &groupCount, groups.data());
+
+    for (const VkPhysicalDeviceGroupProperties &group : groups)
+    {
+        const VkPhysicalDevice *begin = group.physicalDevices;
+        const VkPhysicalDevice *end = group.physicalDevices + group.physicalDeviceCount;
+        if (std::find(begin, end, physicalDevice) == end)
+        {
+            continue;
+        }
+
+        // Device index 0 is the selected device: it is the one the features were checked on
+        std::vector<VkPhysicalDevice> devices = {physicalDevice};
+        for (const VkPhysicalDevice *member = begin; member != end && devices.size() < kMaxDevices; member++)
+        {
+            if (*member != physicalDevice)
+            {
+                devices.push_back(*member);
+            }
+        }
+        return devices;
+    }
+    return {physicalDevice};
+}
+
+void *DeviceGroup::enable(CreateInfo &info, const std::vector<VkPhysicalDevice> &devices, void *next)
+{
+    info.devices = devices;
+    info.group.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_DEVICE_CREATE_INFO;
+    info.group.pNext = next;
+    info.group.physicalDeviceCount = static_cast<uint32_t>(info.devices.size());
+    info.group.pPhysicalDevices = info.devices.data();
+    return &info.group;
+}
+
+DeviceGroup::DeviceGroup(VkDevice device, const std::vector<VkPhysicalDevice> &devices)
+    : m_deviceCount(static_cast<uint32_t>(devices.size()))
+{
+    if (m_deviceCount == 0 || m_deviceCount > kMaxDevices)
+    {
+        throw std::out_of_range("DeviceGroup device count out of range!");
+    }
+
+    // Peer copies are per heap; the device-local heap is the one that matters
+    if (m_deviceCount > 1)
+    {
+        VkPhysicalDeviceMemoryProperties memory{};
+        vkGetPhysicalDeviceMemoryProperties(devices[0], &memory);
+        for (uint32_t heap = 0; heap < memory.memoryHeapCount; heap++)
+        {
+            if (!(memory.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+            {
+                continue;
+            }
+            VkPeerMemoryFeatureFlags features = 0;
+            vkGetDeviceGroupPeerMemoryFeatures(device, heap, 0, 1, &features);
+            m_peerCopy = (features & VK_PEER_MEMORY_FEATURE_COPY_DST_BIT) != 0;
+            break;
+        }
+    }
+
+    std::cout << "[DeviceGroup] " << m_deviceCount << " device" << (m_deviceCount > 1 ? "s" : "")
+              << ", peer copies " << (m_peerCopy ? "supported" : "not supported") << std::endl;
+}
+
+uint32_t DeviceGroup::getFrameDevice(uint64_t frameNumber) const
+{
+    return m_alternateFrames ? static_cast<uint32_t>(frameNumber % m_deviceCount) : 0;
+}
+
+const void *DeviceGroup::chainBegin(VkDeviceGroupCommandBufferBeginInfo &info, uint32_t deviceIndex,
+                                    const void *next) const
+{
+    info.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_COMMAND_BUFFER_BEGIN_INFO;
+    info.pNext = next;
+    info.deviceMask = 1u << deviceIndex;
+    return &info;
+}
+
+void DeviceGroup::chainSubmit(SubmitChain &chain, VkSubmitInfo &submit, uint32_t deviceIndex) const
+{
+    if (submit.waitSemaphoreCount > chain.waitIndices.size() ||
+        submit.commandBufferCount > chain.commandBufferMasks.size() ||
+        submit.signalSemaphoreCount > chain.signalIndices.size())
+    {
+        throw std::out_of_range("DeviceGroup submission too large!");
+    }
+
+    chain.waitIndices.fill(deviceIndex);
+    chain.commandBufferMasks.fill(1u << deviceIndex);
+    chain.signalIndices.fill(deviceIndex);
+
+    chain.info.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO;
+    chain.info.pNext = submit.pNext;
+    chain.info.waitSemaphoreCount = submit.waitSemaphoreCount;
+    chain.info.pWaitSemaphoreDeviceIndices = chain.waitIndices.data();
+    chain.info.commandBufferCount = submit.commandBufferCount;
+    chain.info.pCommandBufferDeviceMasks = chain.commandBufferMasks.data();
+    chain.info.signalSemaphoreCount = submit.signalSemaphoreCount;
+    chain.info.pSignalSemaphoreDeviceIndices = chain.signalIndices.data();
+    submit.pNext = &chain.info;
+}
@@ -0,0 +1,185 @@
+#include "DeviceSelection.h"
+#include "RayQueryScene.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    uint64_t typeRank(VkPhysicalDeviceType type)
+    {
+        switch (type)
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return 4;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return 3;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return 2;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    const char *typeName(VkPhysicalDeviceType type)
+    {
+        switch (type)
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return "discrete";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return "integrated";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return "virtual";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return "CPU";
+        default:
+            return "other";
+        }
+    }
+
+    uint64_t deviceLocalMiB(VkPhysicalDevice device)
+    {
+        VkPhysicalDeviceMemoryProperties memory{};
+        vkGetPhysicalDeviceMemoryProperties(device, &memory);
+        VkDeviceSize bytes = 0;
+        for (uint32_t i = 0; i < memory.memoryHeapCount; i++)
+        {
+            if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            {
+                bytes += memory.memoryHeaps[i].size;
+            }
+        }
+        return bytes >> 20;
+    }
+
+    std::string lowercase(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+}
+
+std::string DeviceSelection::getOverride(const std::string &commandLine)
+{
+    if (!commandLine.empty())
+    {
+        return commandLine;
+    }
+    const char *environment = std::getenv(kOverrideVariable);
+    return environment ? std::string(environment) : std::string();
+}
+
+uint64_t DeviceSelection::score(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+    VkPhysicalDeviceProperties properties{};
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceProperties(device, &properties);
+    vkGetPhysicalDeviceFeatures(device, &features);
+
+    uint64_t optional = 0;
+    optional += VkUtils::FindQueueFamilies(device, surface).computeFamily.has_value() ? 1 : 0;
+    optional += features.multiDrawIndirect ? 1 : 0;
+    optional += features.tessellationShader ? 1 : 0;
+    optional += RayQueryScene::isSupported(device) ? 1 : 0;
+
+    // Fields: type in 63..48, VRAM MiB in 47..8, optional paths in 7..0
+    const uint64_t vram = std::min<uint64_t>(deviceLocalMiB(device), (uint64_t(1) << 40) - 1);
+    return (typeRank(properties.deviceType) << 48) | (vram << 8) | optional;
+}
+
+std::vector<DeviceSelection::Candidate> DeviceSelection::rank(const std::vector<VkPhysicalDevice> &devices,
+                                                              VkSurfaceKHR surface,
+                                                              const std::function<bool(VkPhysicalDevice)> &isSuitable)
+{
+    std::vector<Candidate> candidates;
+    for (uint32_t i = 0; i < devices.size(); i++)
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(devices[i], &properties);
+
+        Candidate candidate;
+        candidate.device = devices[i];
+        candidate.index = i;
+        candidate.name = properties.deviceName;
+        candidate.suitable = isSuitable(devices[i]);
+        candidate.score = candidate.suitable ? score(devices[i], surface) : 0;
+        candidates.push_back(candidate);
+
+        std::cout << "Found GPU " << i << ": " << candidate.name << " (" << typeName(properties.deviceType) << ", "
+                  << deviceLocalMiB(devices[i]) << " MiB)"
+                  << (candidate.suitable ? "" : " - not suitable") << std::endl;
+    }
+    return candidates;
+}
+
+VkPhysicalDevice DeviceSelection::select(const std::vector<Candidate> &candidates, const std::string &override)
+{
+    if (!override.empty())
+    {
+        const bool byIndex = std::all_of(override.begin(), override.end(),
+                                         [](unsigned char c) { return std::isdigit(c) != 0; });
+        const unsigned long index = byIndex ? std::stoul(override) : 0;
+        const std::string needle = lowercase(override);
+        for (const Candidate &candidate : candidates)
+        {
+            const bool matches = byIndex ? candidate.index == index
+                                         : lowercase(candidate.name).find(needle) != std::string::npos;
+            if (!matches)
+            {
+                continue;
+            }
+            if (!candidate.suitable)
+            {
+                throw std::runtime_error("GPU override '" + override + "' selects " + candidate.name +
+                                         ", which is not suitable!");
+            }
+            std::cout << "Selected GPU " << candidate.index << " by override: " << candidate.name << std::endl;
+            return candidate.device;
+        }
+        throw std::runtime_error("GPU override '" + override + "' matches no device!");
+    }
+
+    const Candidate *best = nullptr;
+    for (const Candidate &candidate : candidates)
+    {
+        // Ties keep the enumeration order
+        if (candidate.suitable && (!best || candidate.score > best->score))
+        {
+            best = &candidate;
+        }
+    }
+    if (!best)
+    {
+        throw std::runtime_error("failed to find a suitable GPU!");
+    }
+    std::cout << "Selected GPU " << best->index << ": " << best->name << std::endl;
+    return best->device;
+}
+
+void DeviceSelection::logDevice(VkPhysicalDevice device, bool asyncCompute)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(device, &properties);
+    const VkPhysicalDeviceLimits &limits = properties.limits;
+
+    std::cout << "[Device] " << properties.deviceName << " (" << typeName(properties.deviceType) << ")\n"
+              << "  API " << VK_API_VERSION_MAJOR(properties.apiVersion) << "."
+              << VK_API_VERSION_MINOR(properties.apiVersion) << "." << VK_API_VERSION_PATCH(properties.apiVersion)
+              << ", driver 0x" << std::hex << properties.driverVersion << std::dec
+              << ", vendor 0x" << std::hex << properties.vendorID << std::dec << "\n"
+              << "  Device-local memory: " << deviceLocalMiB(device) << " MiB\n"
+              << "  Timestamp period: " << limits.timestampPeriod << " ns"
+              << (limits.timestampComputeAndGraphics ? "" : " (not on every graphics/compute queue)") << "\n"
+              << "  Max push constants: " << limits.maxPushConstantsSize << " bytes\n"
+              << "  Max bound descriptor sets: " << limits.maxBoundDescriptorSets << "\n"
+              << "  Min uniform/storage offset alignment: " << limits.minUniformBufferOffsetAlignment << "/"
+              << limits.minStorageBufferOffsetAlignment << "\n"
+              << "  Async compute: " << (asyncCompute ? "yes" : "no") << std::endl;
+}
@@ -0,0 +1,67 @@
+#include "DrawKey.h"
+#include <cstring>
+
+namespace DrawKey
+{
+    uint16_t quantizeDepth(float depth, Order order)
+    {
+        // Also sends NaN and -0 to 0
+        depth = depth > 0.0f ? depth : 0.0f;
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        const uint16_t quantized = static_cast<uint16_t>(bits >> 16);
+        return order == Order::FrontToBack ? quantized : static_cast<uint16_t>(0xFFFF - quantized);
+    }
+
+    uint64_t make(Layer layer, uint32_t pipeline, uint32_t state, uint16_t depth, uint16_t tieBreak)
+    {
+        return (uint64_t(static_cast<uint32_t>(layer) & 0x3) << 62) |
+               (uint64_t(pipeline & ((1u << kPipelineBits) - 1)) << 56) |
+               (uint64_t(state & ((1u << kStateBits) - 1)) << 32) |
+               (uint64_t(depth) << 16) |
+               uint64_t(tieBreak);
+    }
+
+    void sort(std::vector<Entry> &entries, std::vector<Entry> &scratch)
+    {
+        if (entries.size() < 2)
+        {
+            return;
+        }
+
+        // Bits set where some key differs from the first
+        uint64_t varying = 0;
+        const uint64_t first = entries[0].key;
+        for (const Entry &entry : entries)
+        {
+            varying |= entry.key ^ first;
+        }
+
+        scratch.resize(entries.size());
+        for (uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            if (((varying >> shift) & 0xFF) == 0)
+            {
+                continue;
+            }
+
+            uint32_t offsets[256] = {};
+            for (const Entry &entry : entries)
+            {
+                offsets[(entry.key >> shift) & 0xFF]++;
+            }
+            uint32_t sum = 0;
+            for (uint32_t &offset : offsets)
+            {
+                const uint32_t count = offset;
+                offset = sum;
+                sum += count;
+            }
+            for (const Entry &entry : entries)
+            {
+                scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+            }
+            entries.swap(scratch);
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#include "DynamicRendering.h"
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    PFN_vkCmdBeginRenderingKHR g_beginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR g_endRendering = nullptr;
+
+    // Pipelines may be built from loader threads
+    std::mutex g_registryMutex;
+    std::unordered_map<VkRenderPass, RenderingFormats> g_renderPasses; // Nodes are stable, so apply() can point into them
+}
+
+bool DynamicRendering::isSupported(VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    bool found = false;
+    for (const auto &extension : extensions)
+    {
+        found = found || std::strcmp(extension.extensionName, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0;
+    }
+    if (!found)
+        return false;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRendering{};
+    dynamicRendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &dynamicRendering;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    return dynamicRendering.dynamicRendering == VK_TRUE;
+}
+
+void *DynamicRendering::enableFeatures(VkPhysicalDeviceDynamicRenderingFeaturesKHR &features, void *next)
+{
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    features.dynamicRendering = VK_TRUE;
+    features.pNext = next;
+    return &features;
+}
+
+void DynamicRendering::enable(VkDevice device)
+{
+    g_beginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR"));
+    g_endRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR"));
+    if (!g_beginRendering || !g_endRendering)
+    {
+        g_beginRendering = nullptr;
+        g_endRendering = nullptr;
+        throw std::runtime_error("failed to load the dynamic rendering entry points!");
+    }
+}
+
+bool DynamicRendering::isEnabled()
+{
+    return g_beginRendering != nullptr;
+}
+
+// ============================================================================
+// PIPELINES
+// ============================================================================
+
+void DynamicRendering::registerRenderPass(VkRenderPass renderPass, const VkRenderPassCreateInfo &info)
+{
+    if (info.subpassCount == 0)
+        return;
+
+    const VkSubpassDescription &subpass = info.pSubpasses[0];
+    RenderingFormats formats;
+    for (uint32_t i = 0; i < subpass.colorAttachmentCount; i++)
+    {
+        const VkAttachmentDescription &attachment = info.pAttachments[subpass.pColorAttachments[i].attachment];
+        formats.colorFormats.push_back(attachment.format);
+        formats.samples = attachment.samples;
+    }
+    if (subpass.pDepthStencilAttachment && subpass.pDepthStencilAttachment->attachment != VK_ATTACHMENT_UNUSED)
+    {
+        const VkAttachmentDescription &attachment = info.pAttachments[subpass.pDepthStencilAttachment->attachment];
+        formats.depthFormat = attachment.format;
+        formats.samples = attachment.samples;
+    }
+    for (const VkBaseInStructure *next = static_cast<const VkBaseInStructure *>(info.pNext); next; next = next->pNext)
+    {
+        if (next->sType == VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO)
+        {
+            const auto *multiview = reinterpret_cast<const VkRenderPassMultiviewCreateInfo *>(next);
+            formats.viewMask = multiview->subpassCount > 0 ? multiview->pViewMasks[0] : 0;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    g_renderPasses[renderPass] = std::move(formats);
+}
+
+void DynamicRendering::apply(VkGraphicsPipelineCreateInfo &info, VkPipelineRenderingCreateInfoKHR &rendering)
+{
+    if (!isEnabled())
+        return;
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    auto registered = g_renderPasses.find(info.renderPass);
+    if (registered == g_renderPasses.end())
+        return;
+
+    const RenderingFormats &formats = registered->second;
+    rendering = {};
+    rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    rendering.colorAttachmentCount = static_cast<uint32_t>(formats.colorFormats.size());
+    rendering.pColorAttachmentFormats = formats.colorFormats.data();
+    rendering.depthAttachmentFormat = formats.depthFormat;
+    rendering.viewMask = formats.viewMask;
+    rendering.pNext = info.pNext;
+
+    info.pNext = &rendering;
+    info.renderPass = VK_NULL_HANDLE;
+    info.subpass = 0;
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+void DynamicRendering::begin(VkCommandBuffer cmd, const VkRenderingInfoKHR &info)
+{
+    g_beginRendering(cmd, &info);
+}
+
+void DynamicRendering::end(VkCommandBuffer cmd)
+{
+    g_endRendering(cmd);
+}
@@ -0,0 +1,67 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+void DynamicResolution::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    m_scale = 1.0f;
+    m_filteredMs = 0.0;
+    m_staleFrames = 0;
+    m_sampleFrames = 0;
+}
+
+void DynamicResolution::setFixedScale(float scale)
+{
+    setEnabled(false);
+    m_scale = std::clamp(std::round(scale / kStep) * kStep, kStep, 1.0f);
+}
+
+void DynamicResolution::setMinScale(float minScale)
+{
+    m_minScale = std::clamp(minScale, kStep, 1.0f);
+    m_scale = std::max(m_scale, m_minScale);
+}
+
+void DynamicResolution::update(double gpuFrameMs, uint32_t framesInFlight)
+{
+    if (!m_enabled || gpuFrameMs <= 0.0)
+        return;
+
+    if (m_staleFrames > 0)
+    {
+        m_staleFrames--;
+        return;
+    }
+    m_filteredMs = m_filteredMs <= 0.0 ? gpuFrameMs : m_filteredMs + kSmoothing * (gpuFrameMs - m_filteredMs);
+    if (m_sampleFrames > 0)
+    {
+        m_sampleFrames--;
+        return;
+    }
+
+    // Pass cost follows the pixel count, i.e. the square of the scale. Steps are capped so one
+    // spike cannot halve the resolution
+    float next = m_scale;
+    if (m_filteredMs > m_targetMs)
+    {
+        next = m_scale * static_cast<float>(std::max(std::sqrt(m_targetMs / m_filteredMs), 0.9));
+        next = std::floor(next / kStep) * kStep;
+    }
+    else if (m_filteredMs < m_targetMs * kHeadroom)
+    {
+        next = m_scale * static_cast<float>(std::min(std::sqrt(m_targetMs * kHeadroom / m_filteredMs), 1.05));
+        next = std::ceil(next / kStep) * kStep;
+    }
+    next = std::clamp(next, m_minScale, 1.0f);
+
+    if (next != m_scale)
+    {
+        m_scale = next;
+        // The profiler reports frames recorded before this change for the next framesInFlight
+        // frames; skip those, then refill the filter at the new scale before deciding again
+        m_filteredMs = 0.0;
+        m_staleFrames = framesInFlight + 1;
+        m_sampleFrames = kSettleSamples;
+    }
+}
@@ -0,0 +1,98 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#if !defined(NDEBUG)
+namespace
+{
+    thread_local uint64_t t_heapAllocations = 0;
+}
+
+// Replaces the global allocation functions: the array and nothrow forms call this one
+void *operator new(std::size_t size)
+{
+    t_heapAllocations++;
+    for (;;)
+    {
+        if (void *memory = std::malloc(size ? size : 1))
+            return memory;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+#endif
+
+FrameArena::FrameArena(uint32_t frameCount)
+    : m_frames(std::max(frameCount, 1u))
+{
+}
+
+void FrameArena::beginFrame(uint32_t frameIndex)
+{
+    m_current = frameIndex % static_cast<uint32_t>(m_frames.size());
+    Region &region = m_frames[m_current];
+    region.block = 0;
+    region.offset = 0;
+    region.used = 0;
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    Region &region = m_frames[m_current];
+    for (; region.block < region.blocks.size(); region.block++, region.offset = 0)
+    {
+        Block &block = region.blocks[region.block];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        const size_t aligned = ((base + region.offset + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+        if (aligned + size <= block.size)
+        {
+            region.offset = aligned + size;
+            region.used += size;
+            return block.data.get() + aligned;
+        }
+    }
+
+    // Past the last block: a new one, large enough for an oversized request, kept for later frames
+    Block block;
+    block.size = std::max(kBlockSize, size + alignment);
+    block.data.reset(new std::byte[block.size]);
+    region.blocks.push_back(std::move(block));
+    region.block = region.blocks.size() - 1;
+    region.offset = 0;
+    return allocate(size, alignment);
+}
+
+size_t FrameArena::getCapacity() const
+{
+    size_t capacity = 0;
+    for (const Region &region : m_frames)
+    {
+        for (const Block &block : region.blocks)
+        {
+            capacity += block.size;
+        }
+    }
+    return capacity;
+}
+
+uint64_t FrameArena::getHeapAllocations()
+{
+#if !defined(NDEBUG)
+    return t_heapAllocations;
+#else
+    return 0;
+#endif
+}
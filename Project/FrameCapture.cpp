@@ -0,0 +1,324 @@
+#include "FrameCapture.h"
+#include "RenderGraph.h"
+#include "Lib/json.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace
+{
+    constexpr int kVersion = 1;
+
+    const std::pair<const char *, float WaterParamBlock::*> kBlockFloats[] = {
+        {"ambient", &WaterParamBlock::ambient},
+        {"shininess", &WaterParamBlock::shininess},
+        {"causticIntensity", &WaterParamBlock::causticIntensity},
+        {"distortionStrength", &WaterParamBlock::distortionStrength},
+        {"godRayIntensity", &WaterParamBlock::godRayIntensity},
+        {"scatteringIntensity", &WaterParamBlock::scatteringIntensity},
+        {"opacity", &WaterParamBlock::opacity},
+        {"fogDensity", &WaterParamBlock::fogDensity},
+        {"godExposure", &WaterParamBlock::godExposure},
+        {"godDecay", &WaterParamBlock::godDecay},
+        {"godDensity", &WaterParamBlock::godDensity},
+        {"godSampleScale", &WaterParamBlock::godSampleScale},
+        {"causticMapScale", &WaterParamBlock::causticMapScale},
+        {"froxelNear", &WaterParamBlock::froxelNear},
+        {"froxelDepthScale", &WaterParamBlock::froxelDepthScale},
+        {"snowParticles", &WaterParamBlock::snowParticles},
+    };
+
+    json vec4ToJson(const glm::vec4 &v)
+    {
+        return json::array({v.x, v.y, v.z, v.w});
+    }
+
+    glm::vec4 vec4FromJson(const json &j)
+    {
+        return glm::vec4(j.at(0).get<float>(), j.at(1).get<float>(), j.at(2).get<float>(), j.at(3).get<float>());
+    }
+
+    json blockToJson(const WaterParamBlock &block)
+    {
+        json j;
+        j["baseColor"] = vec4ToJson(block.baseColor);
+        j["lightColor"] = vec4ToJson(block.lightColor);
+        for (const auto &field : kBlockFloats)
+        {
+            j[field.first] = block.*field.second;
+        }
+        return j;
+    }
+
+    WaterParamBlock blockFromJson(const json &j)
+    {
+        WaterParamBlock block{};
+        block.baseColor = vec4FromJson(j.at("baseColor"));
+        block.lightColor = vec4FromJson(j.at("lightColor"));
+        for (const auto &field : kBlockFloats)
+        {
+            block.*field.second = j.at(field.first).get<float>();
+        }
+        return block;
+    }
+
+    // The settings that shape the frame; run length, repeats and timing are the replay's own
+    json configToJson(const WaterTestConfig &c)
+    {
+        json j;
+        j["name"] = c.name;
+        j["turbidity"] = static_cast<int>(c.turbidity);
+        j["depth"] = static_cast<int>(c.depth);
+        j["lightMotion"] = static_cast<int>(c.lightMotion);
+        j["renderingMode"] = static_cast<int>(c.renderingMode);
+        j["sceneSubmission"] = static_cast<int>(c.sceneSubmission);
+        j["occlusionCulling"] = c.occlusionCulling;
+        j["sampleCount"] = c.sampleCount;
+        j["causticRayCount"] = c.causticRayCount;
+        j["halfResGodRays"] = c.halfResGodRays;
+        j["specializedShaders"] = c.specializedShaders;
+        j["shadowQuality"] = static_cast<int>(c.shadowQuality);
+        j["shadowRoundRobin"] = c.shadowRoundRobin;
+        j["pointLightCount"] = c.pointLightCount;
+        j["clusteredLighting"] = c.clusteredLighting;
+        j["reflections"] = static_cast<int>(c.reflections);
+        j["offscreenUpdateInterval"] = c.offscreenUpdateInterval;
+        j["depthPrePass"] = c.depthPrePass;
+        j["froxelVolumetrics"] = c.froxelVolumetrics;
+        j["asyncEnabled"] = c.asyncEnabled;
+        j["tilingEnabled"] = c.tilingEnabled;
+        j["variableRateShading"] = c.variableRateShading;
+        j["alternateFrameDevices"] = c.alternateFrameDevices;
+        j["framesInFlight"] = c.framesInFlight;
+        j["msaaSamples"] = c.msaaSamples;
+        j["resolutionScale"] = c.resolutionScale;
+        j["shaderParams"] = json::object();
+        for (const auto &param : c.shaderParams)
+        {
+            j["shaderParams"][param.first] = param.second;
+        }
+        return j;
+    }
+
+    WaterTestConfig configFromJson(const json &j)
+    {
+        WaterTestConfig c;
+        c.name = j.value("name", c.name);
+        c.turbidity = static_cast<TurbidityLevel>(j.value("turbidity", static_cast<int>(c.turbidity)));
+        c.depth = static_cast<DepthLevel>(j.value("depth", static_cast<int>(c.depth)));
+        c.lightMotion = static_cast<LightMotion>(j.value("lightMotion", static_cast<int>(c.lightMotion)));
+        c.renderingMode = static_cast<RenderingMode>(j.value("renderingMode", static_cast<int>(c.renderingMode)));
+        c.sceneSubmission = static_cast<SceneSubmission>(j.value("sceneSubmission", static_cast<int>(c.sceneSubmission)));
+        c.occlusionCulling = j.value("occlusionCulling", c.occlusionCulling);
+        c.sampleCount = j.value("sampleCount", c.sampleCount);
+        c.causticRayCount = j.value("causticRayCount", c.causticRayCount);
+        c.halfResGodRays = j.value("halfResGodRays", c.halfResGodRays);
+        c.specializedShaders = j.value("specializedShaders", c.specializedShaders);
+        c.shadowQuality = static_cast<ShadowTier>(j.value("shadowQuality", static_cast<int>(c.shadowQuality)));
+        c.shadowRoundRobin = j.value("shadowRoundRobin", c.shadowRoundRobin);
+        c.pointLightCount = j.value("pointLightCount", c.pointLightCount);
+        c.clusteredLighting = j.value("clusteredLighting", c.clusteredLighting);
+        c.reflections = static_cast<ReflectionTier>(j.value("reflections", static_cast<int>(c.reflections)));
+        c.offscreenUpdateInterval = j.value("offscreenUpdateInterval", c.offscreenUpdateInterval);
+        c.depthPrePass = j.value("depthPrePass", c.depthPrePass);
+        c.froxelVolumetrics = j.value("froxelVolumetrics", c.froxelVolumetrics);
+        c.asyncEnabled = j.value("asyncEnabled", c.asyncEnabled);
+        c.tilingEnabled = j.value("tilingEnabled", c.tilingEnabled);
+        c.variableRateShading = j.value("variableRateShading", c.variableRateShading);
+        c.alternateFrameDevices = j.value("alternateFrameDevices", c.alternateFrameDevices);
+        c.framesInFlight = j.value("framesInFlight", c.framesInFlight);
+        c.msaaSamples = j.value("msaaSamples", c.msaaSamples);
+        c.resolutionScale = j.value("resolutionScale", c.resolutionScale);
+        if (j.contains("shaderParams"))
+        {
+            for (const auto &param : j["shaderParams"].items())
+            {
+                c.shaderParams.emplace_back(param.key(), param.value().get<float>());
+            }
+        }
+        return c;
+    }
+}
+
+// ============================================================================
+// FRAME CAPTURE
+// ============================================================================
+
+bool FrameCapture::save(const std::string &filePath) const
+{
+    json captureJson;
+    captureJson["version"] = kVersion;
+    captureJson["frame"] = frame;
+    captureJson["time"] = time;
+    captureJson["camera"] = {{"position", {cameraPosition.x, cameraPosition.y, cameraPosition.z}},
+                             {"yaw", cameraYaw},
+                             {"pitch", cameraPitch}};
+    captureJson["extent"] = {extent.width, extent.height};
+    captureJson["config"] = configToJson(config);
+    captureJson["waterParams"] = {{"surface", blockToJson(waterParams.surface)},
+                                  {"underwater", blockToJson(waterParams.underwater)}};
+
+    json passesJson = json::array();
+    for (const FrameCapturePass &pass : passes)
+    {
+        passesJson.push_back({{"name", pass.name}, {"culled", pass.culled}, {"barriers", pass.barriers}, {"gpuMs", pass.gpuMs}});
+    }
+    captureJson["passes"] = passesJson;
+
+    std::ofstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write frame capture: " << filePath << std::endl;
+        return false;
+    }
+    file << std::setw(2) << captureJson << std::endl;
+    return true;
+}
+
+std::optional<FrameCapture> FrameCapture::load(const std::string &filePath)
+{
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open frame capture: " << filePath << std::endl;
+        return std::nullopt;
+    }
+
+    json captureJson = json::parse(file, nullptr, false);
+    if (captureJson.is_discarded() || !captureJson.is_object() || captureJson.value("version", 0) != kVersion)
+    {
+        std::cerr << "Malformed frame capture: " << filePath << std::endl;
+        return std::nullopt;
+    }
+
+    FrameCapture capture;
+    try
+    {
+        capture.frame = captureJson.at("frame").get<uint64_t>();
+        capture.time = captureJson.at("time").get<double>();
+        const json &camera = captureJson.at("camera");
+        const json &position = camera.at("position");
+        capture.cameraPosition = glm::vec3(position.at(0).get<float>(), position.at(1).get<float>(), position.at(2).get<float>());
+        capture.cameraYaw = camera.at("yaw").get<float>();
+        capture.cameraPitch = camera.at("pitch").get<float>();
+        capture.extent = {captureJson.at("extent").at(0).get<uint32_t>(), captureJson.at("extent").at(1).get<uint32_t>()};
+        capture.config = configFromJson(captureJson.at("config"));
+        capture.waterParams.surface = blockFromJson(captureJson.at("waterParams").at("surface"));
+        capture.waterParams.underwater = blockFromJson(captureJson.at("waterParams").at("underwater"));
+        for (const auto &passJson : captureJson.at("passes"))
+        {
+            FrameCapturePass pass;
+            pass.name = passJson.at("name").get<std::string>();
+            pass.culled = passJson.value("culled", false);
+            pass.barriers = passJson.value("barriers", 0u);
+            pass.gpuMs = passJson.value("gpuMs", 0.0f);
+            capture.passes.push_back(std::move(pass));
+        }
+    }
+    catch (const json::exception &e)
+    {
+        std::cerr << "Malformed frame capture: " << filePath << " (" << e.what() << ")" << std::endl;
+        return std::nullopt;
+    }
+    return capture;
+}
+
+// ============================================================================
+// PASS REPLAY
+// ============================================================================
+
+PassReplay::PassReplay(FrameCapture capture, std::vector<std::string> passes, uint32_t repeat, uint32_t frames)
+    : m_capture(std::move(capture)), m_passes(std::move(passes)), m_measuredFrames(frames)
+{
+    const uint32_t passCount = std::max(static_cast<uint32_t>(m_passes.size()), 1u);
+    m_repeat = std::clamp(repeat, 1u, std::max(kMaxScopes / passCount, 1u));
+    m_samples.resize(m_passes.size());
+}
+
+void PassReplay::addFrame(const std::vector<GpuProfileScope> &scopes)
+{
+    m_frameCount++;
+    if (m_frameCount <= kWarmupFrames)
+        return;
+
+    for (size_t i = 0; i < m_passes.size(); i++)
+    {
+        const std::string scopeName = m_passes[i] + RenderGraph::kReplaySuffix;
+        for (const GpuProfileScope &scope : scopes)
+        {
+            if (scope.name == scopeName)
+            {
+                m_samples[i].push_back(scope.durationMs);
+            }
+        }
+    }
+}
+
+float PassReplay::getProgress() const
+{
+    const uint32_t total = kWarmupFrames + m_measuredFrames;
+    return total > 0 ? std::min(static_cast<float>(m_frameCount) / static_cast<float>(total), 1.0f) : 1.0f;
+}
+
+std::vector<PassReplay::PassResult> PassReplay::getResults() const
+{
+    std::vector<PassResult> results;
+    for (size_t i = 0; i < m_passes.size(); i++)
+    {
+        PassResult result;
+        result.name = m_passes[i];
+        for (const FrameCapturePass &pass : m_capture.passes)
+        {
+            if (pass.name == result.name)
+            {
+                result.capturedMs = pass.gpuMs;
+            }
+        }
+
+        std::vector<double> samples = m_samples[i];
+        result.samples = samples.size();
+        if (!samples.empty())
+        {
+            std::sort(samples.begin(), samples.end());
+            double sum = 0.0;
+            for (double sample : samples)
+            {
+                sum += sample;
+            }
+            result.meanMs = sum / static_cast<double>(samples.size());
+            result.medianMs = samples[samples.size() / 2];
+            result.minMs = samples.front();
+            result.p99Ms = samples[std::min(samples.size() - 1, static_cast<size_t>(0.99 * static_cast<double>(samples.size())))];
+        }
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+bool PassReplay::writeCsv(const std::string &filePath) const
+{
+    std::ofstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "[PassReplay] Failed to open file for export: " << filePath << "\n";
+        return false;
+    }
+
+    file << "Pass,Repeat,Samples,MeanGpu_ms,MedianGpu_ms,MinGpu_ms,99thGpu_ms,CapturedGpu_ms\n";
+    for (const PassResult &result : getResults())
+    {
+        file << result.name << ","
+             << m_repeat << ","
+             << result.samples << ","
+             << std::fixed << std::setprecision(4)
+             << result.meanMs << ","
+             << result.medianMs << ","
+             << result.minMs << ","
+             << result.p99Ms << ","
+             << result.capturedMs << "\n";
+    }
+    return true;
+}
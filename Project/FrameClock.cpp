@@ -0,0 +1,73 @@
+#include "FrameClock.h"
+#include <cstddef>
+
+const char *FrameClock::modeName(Mode mode)
+{
+    switch (mode)
+    {
+    case Mode::RealTime:
+        return "RealTime";
+    case Mode::FixedStep:
+        return "FixedStep";
+    case Mode::Replay:
+        return "Replay";
+    }
+    return "Unknown";
+}
+
+void FrameClock::setMode(Mode mode, double fixedStep)
+{
+    if (mode != m_mode || fixedStep != m_fixedStep)
+    {
+        m_stepOriginFrame = m_frame;
+        m_stepOriginTime = m_time;
+    }
+    m_mode = mode;
+    m_fixedStep = fixedStep;
+}
+
+void FrameClock::restart(std::vector<double> replayTimes)
+{
+    m_frame = 0;
+    m_time = 0.0;
+    m_deltaTime = 0.0;
+    m_stepOriginFrame = 0;
+    m_stepOriginTime = 0.0;
+    m_replay = std::move(replayTimes);
+    m_recording.clear();
+    m_recording.push_back(0.0);
+}
+
+double FrameClock::advance(double wallDelta)
+{
+    double time = m_time + wallDelta;
+    if (m_mode == Mode::FixedStep)
+    {
+        time = m_stepOriginTime + static_cast<double>(m_frame + 1 - m_stepOriginFrame) * m_fixedStep;
+    }
+    else if (m_mode == Mode::Replay && !m_replay.empty())
+    {
+        const size_t next = static_cast<size_t>(m_frame + 1);
+        if (next < m_replay.size())
+        {
+            time = m_replay[next];
+        }
+        else
+        {
+            // Past the recorded run: keep its last interval
+            const size_t last = m_replay.size() - 1;
+            const double interval = last > 0 ? m_replay[last] - m_replay[last - 1] : m_fixedStep;
+            time = m_replay[last] + interval * static_cast<double>(next - last);
+        }
+    }
+
+    m_deltaTime = time - m_time;
+    m_time = time;
+    m_frame++;
+
+    if (m_mode == Mode::Replay && m_replay.empty())
+    {
+        m_recording.push_back(m_time);
+    }
+    return m_time;
+}
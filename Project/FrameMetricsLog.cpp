@@ -0,0 +1,328 @@
+#include "FrameMetricsLog.h"
+#include "CpuProfiler.h"
+#include "ThreadAffinity.h"
+#include "WaterTestingSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    const char kMagic[8] = {'X', 'R', 'F', 'M', 'L', 'O', 'G', '\0'};
+
+    std::string jsonEscape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+FrameMetricsLog::FrameMetricsLog(const std::string &path)
+    : m_path(path)
+{
+    m_file = std::fopen(path.c_str(), "ab");
+    if (!m_file)
+    {
+        throw std::runtime_error("FrameMetricsLog: failed to open " + path);
+    }
+
+    // "ab" positions at the end: an empty file is a new log
+    std::fseek(m_file, 0, SEEK_END);
+    if (std::ftell(m_file) == 0)
+    {
+        FrameLogFileHeader header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.recordSize = sizeof(FrameLogFrameRecord);
+        std::fwrite(&header, sizeof(header), 1, m_file);
+    }
+
+    m_active.reserve(kBlockRecords);
+    m_writer = std::thread(&FrameMetricsLog::writerLoop, this);
+}
+
+FrameMetricsLog::~FrameMetricsLog()
+{
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_writer.join();
+    std::fclose(m_file);
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+void FrameMetricsLog::beginRun(const std::string &configName, int runIndex, int totalFrames, int warmupFrames)
+{
+    FrameLogRunRecord run{};
+    run.totalFrames = static_cast<uint32_t>(std::max(totalFrames, 0));
+    run.runIndex = static_cast<uint16_t>(runIndex);
+    run.kind = FrameLogRecordKind::Run;
+    run.warmupFrames = static_cast<uint8_t>(std::clamp(warmupFrames, 0, 255));
+    std::strncpy(run.configName, configName.c_str(), sizeof(run.configName) - 1);
+
+    FrameLogFrameRecord record;
+    std::memcpy(&record, &run, sizeof(record));
+    push(record);
+}
+
+void FrameMetricsLog::append(const FrameMetrics &metrics, int runIndex)
+{
+    FrameLogFrameRecord record{};
+    record.frameIndex = metrics.frameIndex;
+    record.runIndex = static_cast<uint16_t>(runIndex);
+    record.kind = FrameLogRecordKind::Frame;
+    record.flags = (metrics.isWarmupFrame ? FrameLogFrameRecord::kFlagWarmup : 0) |
+                   (metrics.isOutlier ? FrameLogFrameRecord::kFlagOutlier : 0);
+    record.timestampNs = metrics.timestampNs;
+    record.frameTimeMs = static_cast<float>(metrics.frameTimeMs);
+    record.gpuTimeMs = static_cast<float>(metrics.gpuTimeMs);
+    record.cpuTimeMs = static_cast<float>(metrics.cpuTimeMs);
+    record.latencyMs = static_cast<float>(metrics.latencyMs);
+    record.waterPassTimeMs = static_cast<float>(metrics.waterPassTimeMs);
+    record.scenePassTimeMs = static_cast<float>(metrics.scenePassTimeMs);
+    record.postProcessTimeMs = static_cast<float>(metrics.postProcessTimeMs);
+    record.cameraPosition[0] = metrics.cameraPosition.x;
+    record.cameraPosition[1] = metrics.cameraPosition.y;
+    record.cameraPosition[2] = metrics.cameraPosition.z;
+    record.cameraYaw = metrics.cameraYaw;
+    record.cameraPitch = metrics.cameraPitch;
+    push(record);
+}
+
+void FrameMetricsLog::push(const FrameLogFrameRecord &record)
+{
+    m_active.push_back(record);
+    m_recordCount++;
+    if (m_active.size() >= kBlockRecords)
+    {
+        flush();
+    }
+}
+
+void FrameMetricsLog::flush()
+{
+    if (m_active.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back(std::move(m_active));
+        if (!m_free.empty())
+        {
+            m_active = std::move(m_free.back());
+            m_free.pop_back();
+        }
+        else
+        {
+            m_active = Block();
+        }
+    }
+    m_wake.notify_one();
+
+    m_active.clear();
+    m_active.reserve(kBlockRecords);
+}
+
+// ============================================================================
+// WRITER THREAD
+// ============================================================================
+
+void FrameMetricsLog::writerLoop()
+{
+    CPU_THREAD_NAME("Frame log writer");
+    ThreadAffinity::pinCurrentThread(ThreadRole::Service);
+    while (true)
+    {
+        Block block;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Drain the queue before honouring m_stop so nothing appended is lost
+            m_wake.wait(lock, [this]
+                        { return m_stop || !m_pending.empty(); });
+            if (m_pending.empty())
+                return;
+            block = std::move(m_pending.front());
+            m_pending.pop_front();
+        }
+
+        if (std::fwrite(block.data(), sizeof(FrameLogFrameRecord), block.size(), m_file) != block.size())
+        {
+            std::cerr << "[FrameMetricsLog] Failed to write " << block.size() << " records to " << m_path << "\n";
+        }
+        std::fflush(m_file);
+
+        block.clear();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(std::move(block));
+    }
+}
+
+// ============================================================================
+// CONVERSION
+// ============================================================================
+
+bool FrameMetricsLog::openLog(std::ifstream &in, const std::string &logPath)
+{
+    in.open(logPath, std::ios::binary);
+    if (!in.is_open())
+    {
+        std::cerr << "[FrameMetricsLog] Failed to open " << logPath << "\n";
+        return false;
+    }
+
+    FrameLogFileHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.recordSize != sizeof(FrameLogFrameRecord))
+    {
+        std::cerr << "[FrameMetricsLog] " << logPath << " is not a version " << kVersion << " frame log\n";
+        return false;
+    }
+    return true;
+}
+
+bool FrameMetricsLog::read(const std::string &logPath,
+                           const std::function<void(const std::string &configName, const FrameLogFrameRecord &record)> &onFrame)
+{
+    std::ifstream in;
+    if (!openLog(in, logPath))
+        return false;
+
+    std::string configName;
+    FrameLogFrameRecord record;
+    while (in.read(reinterpret_cast<char *>(&record), sizeof(record)))
+    {
+        if (record.kind == FrameLogRecordKind::Run)
+        {
+            FrameLogRunRecord run;
+            std::memcpy(&run, &record, sizeof(run));
+            run.configName[sizeof(run.configName) - 1] = '\0';
+            configName = run.configName;
+            continue;
+        }
+        onFrame(configName, record);
+    }
+    return true;
+}
+
+bool FrameMetricsLog::convert(const std::string &logPath, const std::string &outputPath)
+{
+    std::ifstream in;
+    if (!openLog(in, logPath))
+        return false;
+
+    std::ofstream out(outputPath);
+    if (!out.is_open())
+    {
+        std::cerr << "[FrameMetricsLog] Failed to open " << outputPath << "\n";
+        return false;
+    }
+
+    const bool json = outputPath.size() >= 5 && outputPath.compare(outputPath.size() - 5, 5, ".json") == 0;
+    if (json)
+    {
+        out << "{\"runs\":[";
+    }
+    else
+    {
+        out << "Config,Run,FrameIndex,FrameTime_ms,GpuTime_ms,CpuTime_ms,Latency_ms,Timestamp_ns,"
+            << "WaterPass_ms,ScenePass_ms,PostProcess_ms,"
+            << "CameraX,CameraY,CameraZ,CameraYaw,CameraPitch,"
+            << "IsWarmup,IsOutlier\n";
+    }
+    out << std::fixed << std::setprecision(4);
+
+    std::string configName;
+    bool inRun = false;
+    bool firstFrame = true;
+    FrameLogFrameRecord record;
+    while (in.read(reinterpret_cast<char *>(&record), sizeof(record)))
+    {
+        if (record.kind == FrameLogRecordKind::Run)
+        {
+            FrameLogRunRecord run;
+            std::memcpy(&run, &record, sizeof(run));
+            run.configName[sizeof(run.configName) - 1] = '\0';
+            configName = run.configName;
+            if (json)
+            {
+                out << (inRun ? "]}," : "")
+                    << "{\"config\":\"" << jsonEscape(configName) << "\",\"run\":" << run.runIndex
+                    << ",\"totalFrames\":" << run.totalFrames << ",\"warmupFrames\":" << static_cast<int>(run.warmupFrames)
+                    << ",\"frames\":[";
+            }
+            inRun = true;
+            firstFrame = true;
+            continue;
+        }
+
+        const bool warmup = (record.flags & FrameLogFrameRecord::kFlagWarmup) != 0;
+        const bool outlier = (record.flags & FrameLogFrameRecord::kFlagOutlier) != 0;
+        if (json)
+        {
+            if (!inRun)
+                continue; // Frames before any run record: not part of a run
+            out << (firstFrame ? "" : ",")
+                << "{\"frame\":" << record.frameIndex
+                << ",\"frameTimeMs\":" << record.frameTimeMs
+                << ",\"gpuTimeMs\":" << record.gpuTimeMs
+                << ",\"cpuTimeMs\":" << record.cpuTimeMs
+                << ",\"latencyMs\":" << record.latencyMs
+                << ",\"timestampNs\":" << record.timestampNs
+                << ",\"waterPassMs\":" << record.waterPassTimeMs
+                << ",\"scenePassMs\":" << record.scenePassTimeMs
+                << ",\"postProcessMs\":" << record.postProcessTimeMs
+                << ",\"camera\":[" << record.cameraPosition[0] << "," << record.cameraPosition[1] << ","
+                << record.cameraPosition[2] << "," << record.cameraYaw << "," << record.cameraPitch << "]"
+                << ",\"warmup\":" << (warmup ? "true" : "false")
+                << ",\"outlier\":" << (outlier ? "true" : "false") << "}";
+            firstFrame = false;
+        }
+        else
+        {
+            out << TestReportGenerator::escapeCSV(configName) << ","
+                << record.runIndex << ","
+                << record.frameIndex << ","
+                << record.frameTimeMs << ","
+                << record.gpuTimeMs << ","
+                << record.cpuTimeMs << ","
+                << record.latencyMs << ","
+                << record.timestampNs << ","
+                << record.waterPassTimeMs << ","
+                << record.scenePassTimeMs << ","
+                << record.postProcessTimeMs << ","
+                << record.cameraPosition[0] << ","
+                << record.cameraPosition[1] << ","
+                << record.cameraPosition[2] << ","
+                << record.cameraYaw << ","
+                << record.cameraPitch << ","
+                << (warmup ? 1 : 0) << ","
+                << (outlier ? 1 : 0) << "\n";
+        }
+    }
+
+    if (json)
+    {
+        out << (inRun ? "]}" : "") << "]}\n";
+    }
+    std::cout << "[FrameMetricsLog] Converted " << logPath << " to " << outputPath << "\n";
+    return true;
+}
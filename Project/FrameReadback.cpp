@@ -0,0 +1,214 @@
+#include "FrameReadback.h"
+#include "CpuProfiler.h"
+#include "GpuMemoryAllocator.h"
+#include "ThreadAffinity.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <stb_image_write.h>
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+FrameReadback::FrameReadback(VkDevice device, uint32_t frameCount)
+    : m_device(device)
+{
+    m_slots.resize(frameCount);
+    m_encoder = std::thread(&FrameReadback::encoderLoop, this);
+}
+
+FrameReadback::~FrameReadback()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_encoder.join();
+
+    for (FrameSlot &slot : m_slots)
+    {
+        if (slot.buffer != VK_NULL_HANDLE)
+        {
+            GpuMemoryAllocator::get().destroyBuffer(slot.buffer);
+        }
+    }
+}
+
+void FrameReadback::ensureCapacity(FrameSlot &slot, VkDeviceSize size)
+{
+    if (slot.size >= size)
+        return;
+
+    if (slot.buffer != VK_NULL_HANDLE)
+    {
+        GpuMemoryAllocator::get().destroyBuffer(slot.buffer);
+        slot.buffer = VK_NULL_HANDLE;
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &slot.buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("FrameReadback: failed to create readback buffer!");
+    }
+    GpuMemoryAllocator::get().allocateBuffer(slot.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                          GpuMemoryCategory::Staging);
+    slot.mapped = static_cast<const uint8_t *>(GpuMemoryAllocator::get().mapBuffer(slot.buffer));
+    slot.size = size;
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+void FrameReadback::request(FrameReadbackRequest request)
+{
+    m_requests.push_back(std::move(request));
+}
+
+void FrameReadback::recordCopy(VkCommandBuffer cmd, uint32_t frameIndex, VkImage image, VkFormat format, VkExtent2D extent)
+{
+    if (m_requests.empty())
+        return;
+    if (frameIndex >= m_slots.size())
+    {
+        throw std::out_of_range("FrameReadback frame index out of range!");
+    }
+
+    FrameSlot &slot = m_slots[frameIndex];
+    ensureCapacity(slot, static_cast<VkDeviceSize>(extent.width) * extent.height * 4);
+    slot.format = format;
+    slot.extent = extent;
+    slot.requests = std::move(m_requests);
+    m_requests.clear();
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+    // Make the copy visible to the host once the fence has signalled
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slot.buffer;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+// ============================================================================
+// DELIVERY
+// ============================================================================
+
+void FrameReadback::collect(uint32_t frameIndex)
+{
+    FrameSlot &slot = m_slots[frameIndex];
+    if (slot.requests.empty())
+        return;
+
+    auto image = std::make_shared<FrameReadbackImage>();
+    image->width = slot.extent.width;
+    image->height = slot.extent.height;
+    image->pixels.resize(static_cast<size_t>(slot.extent.width) * slot.extent.height * 4);
+    std::memcpy(image->pixels.data(), slot.mapped, image->pixels.size());
+
+    // Swapchain formats are usually BGRA
+    const bool bgra = slot.format == VK_FORMAT_B8G8R8A8_UNORM || slot.format == VK_FORMAT_B8G8R8A8_SRGB;
+    if (bgra)
+    {
+        for (size_t i = 0; i < image->pixels.size(); i += 4)
+        {
+            std::swap(image->pixels[i], image->pixels[i + 2]);
+        }
+    }
+
+    std::vector<FrameReadbackRequest> requests = std::move(slot.requests);
+    slot.requests.clear();
+
+    bool queued = false;
+    for (const FrameReadbackRequest &request : requests)
+    {
+        if (request.onReady)
+        {
+            request.onReady(*image);
+        }
+        if (!request.encodePath.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_encodeQueue.push_back({request.encodePath, image});
+            queued = true;
+        }
+    }
+    if (queued)
+    {
+        m_wake.notify_one();
+    }
+}
+
+void FrameReadback::collectAll()
+{
+    for (uint32_t i = 0; i < m_slots.size(); i++)
+    {
+        collect(i);
+    }
+}
+
+uint32_t FrameReadback::getPendingEncodes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_encodeQueue.size()) + m_encoding;
+}
+
+// ============================================================================
+// ENCODER THREAD
+// ============================================================================
+
+void FrameReadback::encoderLoop()
+{
+    CPU_THREAD_NAME("Readback encode");
+    ThreadAffinity::pinCurrentThread(ThreadRole::Readback);
+    while (true)
+    {
+        EncodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Drain the queue before honouring m_stop so no requested file is lost
+            m_wake.wait(lock, [this]
+                        { return m_stop || !m_encodeQueue.empty(); });
+            if (m_encodeQueue.empty())
+                return;
+            job = std::move(m_encodeQueue.front());
+            m_encodeQueue.pop_front();
+            m_encoding++;
+        }
+
+        CPU_ZONE("FrameReadback::encode");
+        const FrameReadbackImage &image = *job.image;
+        const int width = static_cast<int>(image.width);
+        const int height = static_cast<int>(image.height);
+        const bool png = job.path.size() >= 4 && job.path.compare(job.path.size() - 4, 4, ".png") == 0;
+        int written = png ? stbi_write_png(job.path.c_str(), width, height, 4, image.pixels.data(), width * 4)
+                          : stbi_write_jpg(job.path.c_str(), width, height, 4, image.pixels.data(), 100);
+        if (!written)
+        {
+            std::cerr << "[FrameReadback] Failed to write " << job.path << "\n";
+        }
+        else
+        {
+            std::cout << "[FrameReadback] Saved " << job.path << "\n";
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_encoding--;
+    }
+}
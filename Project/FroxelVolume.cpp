@@ -0,0 +1,380 @@
+#include "FroxelVolume.h"
+#include "GpuMemoryAllocator.h"
+#include "OceanCaustics.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "UploadContext.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    void memoryBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    // Base-2 radical inverse: successive frames fill the slice evenly
+    float halton2(uint32_t index)
+    {
+        float result = 0.0f;
+        float fraction = 0.5f;
+        for (index += 1; index > 0; index >>= 1)
+        {
+            result += fraction * static_cast<float>(index & 1u);
+            fraction *= 0.5f;
+        }
+        return result;
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+FroxelVolume::FroxelVolume(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, const OceanCaustics &caustics,
+                           std::vector<uint32_t> queueFamilies)
+    : m_device(device), m_queueFamilies(std::move(queueFamilies))
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(16, properties.limits.minUniformBufferOffsetAlignment);
+    m_uniformStride = (sizeof(FrameUniforms) + alignment - 1) & ~(alignment - 1);
+
+    auto [buffer, memory] = VkUtils::CreateBuffer(
+        device, physicalDevice, m_uniformStride * frameCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_uniformBuffer = buffer;
+    m_uniforms = static_cast<uint8_t *>(VkUtils::MapBuffer(buffer));
+
+    // Shared by the history lookup and the water shaders
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create froxel sampler!");
+    }
+
+    createImages();
+    createDescriptors(caustics);
+    createPipelines();
+}
+
+FroxelVolume::~FroxelVolume()
+{
+    vkDestroyImageView(m_device, m_integrated.view, nullptr);
+    GpuMemoryAllocator::get().destroyImage(m_integrated.image);
+    for (Volume &volume : m_injected)
+    {
+        vkDestroyImageView(m_device, volume.view, nullptr);
+        GpuMemoryAllocator::get().destroyImage(volume.image);
+    }
+
+    vkDestroyPipeline(m_device, m_integratePipeline, nullptr);
+    vkDestroyPipeline(m_device, m_injectPipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+    VkUtils::DestroyBuffer(m_uniformBuffer);
+}
+
+VkShaderModule FroxelVolume::loadShader(const char *path) const
+{
+    std::vector<char> code = ShaderRegistry::load(path);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("failed to create shader module: ") + path);
+    }
+    return module;
+}
+
+float FroxelVolume::getDepthScale()
+{
+    return 1.0f / std::log(kFar / kNear);
+}
+
+// ============================================================================
+// RESOURCES
+// ============================================================================
+
+void FroxelVolume::createImages()
+{
+    auto createVolume = [this](Volume &volume)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_3D;
+        imageInfo.format = kFormat;
+        imageInfo.extent = {kWidth, kHeight, kSlices};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        VkUtils::SetImageSharing(imageInfo, m_queueFamilies);
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &volume.image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create froxel volume!");
+        }
+        GpuMemoryAllocator::get().allocateImage(volume.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = volume.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_3D;
+        viewInfo.format = kFormat;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &volume.view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create froxel volume view!");
+        }
+    };
+
+    for (Volume &volume : m_injected)
+    {
+        createVolume(volume);
+    }
+    createVolume(m_integrated);
+
+    // All in GENERAL; until the first frame the integrated volume is clear water
+    VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+
+    std::array<VkImageMemoryBarrier, 3> barriers{};
+    for (uint32_t i = 0; i < barriers.size(); i++)
+    {
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].image = i < 2 ? m_injected[i].image : m_integrated.image;
+        barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        barriers[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    const VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    const VkClearColorValue empty = {{0.0f, 0.0f, 0.0f, 0.0f}};
+    const VkClearColorValue clear = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    for (Volume &volume : m_injected)
+    {
+        vkCmdClearColorImage(cmd, volume.image, VK_IMAGE_LAYOUT_GENERAL, &empty, 1, &range);
+    }
+    vkCmdClearColorImage(cmd, m_integrated.image, VK_IMAGE_LAYOUT_GENERAL, &clear, 1, &range);
+
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void FroxelVolume::createDescriptors(const OceanCaustics &caustics)
+{
+    // Frame uniforms, caustics map, history, injected (this frame), integrated
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i == 0   ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+                                     : i < 3 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+                                             : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create froxel descriptor set layout!");
+    }
+
+    const uint32_t setCount = static_cast<uint32_t>(m_sets.size());
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, setCount};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * setCount};
+    poolSizes[2] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * setCount};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create froxel descriptor pool!");
+    }
+
+    const std::array<VkDescriptorSetLayout, 2> layouts = {m_setLayout, m_setLayout};
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts = layouts.data();
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, m_sets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate froxel descriptor sets!");
+    }
+
+    const VkDescriptorBufferInfo uniformInfo{m_uniformBuffer, 0, sizeof(FrameUniforms)};
+    const VkDescriptorImageInfo causticsInfo{caustics.getSampler(), caustics.getMapView(), VK_IMAGE_LAYOUT_GENERAL};
+    for (uint32_t i = 0; i < setCount; i++)
+    {
+        const std::array<VkDescriptorImageInfo, 3> volumeInfos = {
+            VkDescriptorImageInfo{m_sampler, m_injected[1 - i].view, VK_IMAGE_LAYOUT_GENERAL},
+            VkDescriptorImageInfo{VK_NULL_HANDLE, m_injected[i].view, VK_IMAGE_LAYOUT_GENERAL},
+            VkDescriptorImageInfo{VK_NULL_HANDLE, m_integrated.view, VK_IMAGE_LAYOUT_GENERAL}};
+
+        std::array<VkWriteDescriptorSet, 5> writes{};
+        for (uint32_t b = 0; b < writes.size(); b++)
+        {
+            writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[b].dstSet = m_sets[i];
+            writes[b].dstBinding = b;
+            writes[b].descriptorCount = 1;
+            writes[b].descriptorType = bindings[b].descriptorType;
+        }
+        writes[0].pBufferInfo = &uniformInfo;
+        writes[1].pImageInfo = &causticsInfo;
+        for (uint32_t b = 2; b < writes.size(); b++)
+        {
+            writes[b].pImageInfo = &volumeInfos[b - 2];
+        }
+        vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create froxel pipeline layout!");
+    }
+}
+
+// ============================================================================
+// PIPELINES
+// ============================================================================
+
+void FroxelVolume::createPipelines()
+{
+    vkDestroyPipeline(m_device, m_injectPipeline, nullptr);
+    vkDestroyPipeline(m_device, m_integratePipeline, nullptr);
+    m_injectPipeline = VK_NULL_HANDLE;
+    m_integratePipeline = VK_NULL_HANDLE;
+
+    auto createPipeline = [this](const char *path, VkPipeline &pipeline)
+    {
+        VkShaderModule module = loadShader(path);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_pipelineLayout;
+
+        VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &pipeline);
+        vkDestroyShaderModule(m_device, module, nullptr);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to create froxel pipeline: ") + path);
+        }
+    };
+
+    createPipeline("shaders/froxel_inject.comp.spv", m_injectPipeline);
+    createPipeline("shaders/froxel_integrate.comp.spv", m_integratePipeline);
+}
+
+// ============================================================================
+// PER FRAME
+// ============================================================================
+
+void FroxelVolume::update(uint32_t frameIndex, const glm::mat4 &view, float fovY, float aspect, const Medium &medium)
+{
+    const float tanHalfFov = std::tan(fovY * 0.5f);
+    const glm::vec4 projection(1.0f / (tanHalfFov * aspect), 1.0f / tanHalfFov, kNear, getDepthScale());
+
+    // A new lens moves every froxel: history reprojected through the old one would smear
+    const bool history = m_historyValid && projection == m_prevProjection;
+
+    FrameUniforms uniforms{};
+    uniforms.invView = glm::inverse(view);
+    uniforms.prevView = m_prevView;
+    uniforms.projection = projection;
+    uniforms.toSun = glm::vec4(medium.toSun, medium.anisotropy);
+    uniforms.medium = glm::vec4(medium.extinction, halton2(m_frameNumber % 16), history ? kHistoryWeight : 0.0f, medium.waterHeight);
+    uniforms.ambient = glm::vec4(medium.ambient, medium.causticMapScale);
+    uniforms.sun = glm::vec4(medium.sunRadiance, medium.receiverDepth);
+    memcpy(m_uniforms + frameIndex * m_uniformStride, &uniforms, sizeof(uniforms));
+
+    m_prevView = view;
+    m_prevProjection = projection;
+    m_frameNumber++;
+}
+
+void FroxelVolume::recordVolume(VkCommandBuffer cmd, uint32_t frameIndex, bool computeQueue)
+{
+    const uint32_t offset = static_cast<uint32_t>(frameIndex * m_uniformStride);
+
+    // Last frame's fragments still read the integrated volume (on the compute queue, the semaphore
+    // the submission waits for covers them); the caustics were only made visible to fragments
+    const VkPipelineStageFlags fragmentStage = computeQueue ? 0 : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | fragmentStage, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_sets[m_current], 1, &offset);
+
+    const uint32_t groupsX = (kWidth + kGroupSize - 1) / kGroupSize;
+    const uint32_t groupsY = (kHeight + kGroupSize - 1) / kGroupSize;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_injectPipeline);
+    vkCmdDispatch(cmd, groupsX, groupsY, kSlices);
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    // One invocation marches a whole tile's column
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_integratePipeline);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+    if (!computeQueue)
+    {
+        memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    // This frame's injected volume is the next one's history
+    m_current = 1 - m_current;
+    m_historyValid = true;
+}
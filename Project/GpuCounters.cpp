@@ -0,0 +1,402 @@
+#include "GpuCounters.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint32_t kStatisticCount = 5; // Bits in GpuCounters::kStatistics
+
+    // Counts summed over passes; rates, ratios and readings are not
+    bool isAdditive(VkPerformanceCounterUnitKHR unit)
+    {
+        return unit == VK_PERFORMANCE_COUNTER_UNIT_GENERIC_KHR || unit == VK_PERFORMANCE_COUNTER_UNIT_NANOSECONDS_KHR ||
+               unit == VK_PERFORMANCE_COUNTER_UNIT_BYTES_KHR || unit == VK_PERFORMANCE_COUNTER_UNIT_CYCLES_KHR;
+    }
+
+    double toDouble(const VkPerformanceCounterResultKHR &result, VkPerformanceCounterStorageKHR storage)
+    {
+        switch (storage)
+        {
+        case VK_PERFORMANCE_COUNTER_STORAGE_INT32_KHR:
+            return static_cast<double>(result.int32);
+        case VK_PERFORMANCE_COUNTER_STORAGE_INT64_KHR:
+            return static_cast<double>(result.int64);
+        case VK_PERFORMANCE_COUNTER_STORAGE_UINT32_KHR:
+            return static_cast<double>(result.uint32);
+        case VK_PERFORMANCE_COUNTER_STORAGE_UINT64_KHR:
+            return static_cast<double>(result.uint64);
+        case VK_PERFORMANCE_COUNTER_STORAGE_FLOAT32_KHR:
+            return static_cast<double>(result.float32);
+        case VK_PERFORMANCE_COUNTER_STORAGE_FLOAT64_KHR:
+            return result.float64;
+        default:
+            return 0.0;
+        }
+    }
+}
+
+GpuPassStatistics &GpuPassStatistics::operator+=(const GpuPassStatistics &other)
+{
+    vertexInvocations += other.vertexInvocations;
+    clippingInvocations += other.clippingInvocations;
+    clippingPrimitives += other.clippingPrimitives;
+    fragmentInvocations += other.fragmentInvocations;
+    computeInvocations += other.computeInvocations;
+    return *this;
+}
+
+// ============================================================================
+// SUPPORT
+// ============================================================================
+
+bool GpuCounters::isSupported(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    return features.pipelineStatisticsQuery == VK_TRUE && features.inheritedQueries == VK_TRUE;
+}
+
+void GpuCounters::enableFeatures(VkPhysicalDeviceFeatures &features)
+{
+    features.pipelineStatisticsQuery = VK_TRUE;
+    features.inheritedQueries = VK_TRUE;
+}
+
+bool GpuCounters::isPerformanceQuerySupported(VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    bool found = false;
+    for (const auto &extension : availableExtensions)
+    {
+        found = found || std::strcmp(extension.extensionName, VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME) == 0;
+    }
+    if (!found)
+        return false;
+
+    VkPhysicalDevicePerformanceQueryFeaturesKHR performanceQuery{};
+    performanceQuery.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PERFORMANCE_QUERY_FEATURES_KHR;
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext = &performanceQuery;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    return performanceQuery.performanceCounterQueryPools == VK_TRUE && vulkan12Features.hostQueryReset == VK_TRUE;
+}
+
+void GpuCounters::enablePerformanceQuery(PerformanceQueryFeatures &features, VkPhysicalDeviceVulkan12Features &vulkan12Features)
+{
+    features.performanceQuery.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PERFORMANCE_QUERY_FEATURES_KHR;
+    features.performanceQuery.pNext = vulkan12Features.pNext;
+    features.performanceQuery.performanceCounterQueryPools = VK_TRUE;
+    vulkan12Features.pNext = &features.performanceQuery;
+    vulkan12Features.hostQueryReset = VK_TRUE;
+}
+
+// ============================================================================
+// SCOPE
+// ============================================================================
+
+GpuCounters::Scope::Scope(GpuCounters *counters, VkCommandBuffer cmd, const char *name, bool secondaryContents)
+    : m_counters(counters), m_cmd(cmd), m_scope(counters ? counters->beginScope(cmd, name, secondaryContents) : kInvalidScope)
+{
+}
+
+GpuCounters::Scope::~Scope()
+{
+    if (m_counters)
+    {
+        m_counters->endScope(m_cmd, m_scope);
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+GpuCounters::GpuCounters(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily,
+                         uint32_t frameCount, bool statistics, bool performanceQuery, uint32_t maxScopesPerFrame)
+    : m_device(device), m_frameCount(frameCount), m_maxScopes(maxScopesPerFrame)
+{
+    m_slots.resize(frameCount);
+    if (!statistics)
+        return;
+
+    VkQueryPoolCreateInfo queryInfo{};
+    queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryInfo.queryCount = m_maxScopes * frameCount;
+    queryInfo.pipelineStatistics = kStatistics;
+    if (vkCreateQueryPool(device, &queryInfo, nullptr, &m_statisticsPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("GpuCounters: failed to create pipeline statistics query pool!");
+    }
+
+    if (!performanceQuery)
+        return;
+
+    selectCounters(instance, physicalDevice, queueFamily);
+    if (m_counterIndices.empty())
+        return;
+
+    m_acquireProfilingLock = reinterpret_cast<PFN_vkAcquireProfilingLockKHR>(vkGetDeviceProcAddr(device, "vkAcquireProfilingLockKHR"));
+    m_releaseProfilingLock = reinterpret_cast<PFN_vkReleaseProfilingLockKHR>(vkGetDeviceProcAddr(device, "vkReleaseProfilingLockKHR"));
+    if (!m_acquireProfilingLock || !m_releaseProfilingLock)
+    {
+        throw std::runtime_error("failed to load the VK_KHR_performance_query profiling lock functions!");
+    }
+
+    VkQueryPoolPerformanceCreateInfoKHR performanceInfo{};
+    performanceInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_PERFORMANCE_CREATE_INFO_KHR;
+    performanceInfo.queueFamilyIndex = queueFamily;
+    performanceInfo.counterIndexCount = static_cast<uint32_t>(m_counterIndices.size());
+    performanceInfo.pCounterIndices = m_counterIndices.data();
+
+    queryInfo.pNext = &performanceInfo;
+    queryInfo.queryType = VK_QUERY_TYPE_PERFORMANCE_QUERY_KHR;
+    queryInfo.pipelineStatistics = 0;
+    if (vkCreateQueryPool(device, &queryInfo, nullptr, &m_performancePool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("GpuCounters: failed to create performance query pool!");
+    }
+}
+
+GpuCounters::~GpuCounters()
+{
+    if (m_profilingLocked)
+    {
+        m_releaseProfilingLock(m_device);
+    }
+    if (m_performancePool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(m_device, m_performancePool, nullptr);
+    }
+    if (m_statisticsPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(m_device, m_statisticsPool, nullptr);
+    }
+}
+
+void GpuCounters::selectCounters(VkInstance instance, VkPhysicalDevice physicalDevice, uint32_t queueFamily)
+{
+    auto enumerateCounters = reinterpret_cast<PFN_vkEnumeratePhysicalDeviceQueueFamilyPerformanceQueryCountersKHR>(
+        vkGetInstanceProcAddr(instance, "vkEnumeratePhysicalDeviceQueueFamilyPerformanceQueryCountersKHR"));
+    auto getPassCount = reinterpret_cast<PFN_vkGetPhysicalDeviceQueueFamilyPerformanceQueryPassesKHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceQueueFamilyPerformanceQueryPassesKHR"));
+    if (!enumerateCounters || !getPassCount)
+        return;
+
+    uint32_t count = 0;
+    if (enumerateCounters(physicalDevice, queueFamily, &count, nullptr, nullptr) != VK_SUCCESS || count == 0)
+        return;
+
+    VkPerformanceCounterKHR counterTemplate{};
+    counterTemplate.sType = VK_STRUCTURE_TYPE_PERFORMANCE_COUNTER_KHR;
+    VkPerformanceCounterDescriptionKHR descriptionTemplate{};
+    descriptionTemplate.sType = VK_STRUCTURE_TYPE_PERFORMANCE_COUNTER_DESCRIPTION_KHR;
+    std::vector<VkPerformanceCounterKHR> counters(count, counterTemplate);
+    std::vector<VkPerformanceCounterDescriptionKHR> descriptions(count, descriptionTemplate);
+    if (enumerateCounters(physicalDevice, queueFamily, &count, counters.data(), descriptions.data()) != VK_SUCCESS)
+        return;
+
+    // In the driver's order, as long as the set still fits in one submission; a command buffer scoped
+    // counter would have to begin as the buffer's first command, which a pass never is
+    for (uint32_t i = 0; i < count && m_counterIndices.size() < kMaxVendorCounters; i++)
+    {
+        if (counters[i].scope == VK_PERFORMANCE_COUNTER_SCOPE_COMMAND_BUFFER_KHR || !isAdditive(counters[i].unit))
+            continue;
+
+        std::vector<uint32_t> candidate = m_counterIndices;
+        candidate.push_back(i);
+        VkQueryPoolPerformanceCreateInfoKHR performanceInfo{};
+        performanceInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_PERFORMANCE_CREATE_INFO_KHR;
+        performanceInfo.queueFamilyIndex = queueFamily;
+        performanceInfo.counterIndexCount = static_cast<uint32_t>(candidate.size());
+        performanceInfo.pCounterIndices = candidate.data();
+        uint32_t passes = 0;
+        getPassCount(physicalDevice, &performanceInfo, &passes);
+        if (passes != 1)
+            continue;
+
+        m_counterIndices = std::move(candidate);
+        m_counterStorage.push_back(counters[i].storage);
+        std::string name = descriptions[i].name;
+        std::replace(name.begin(), name.end(), ',', ' '); // CSV column names
+        m_counterNames.push_back(std::move(name));
+    }
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+void GpuCounters::beginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= m_frameCount)
+    {
+        throw std::out_of_range("GpuCounters frame index out of range!");
+    }
+    m_frameIndex = frameIndex;
+
+    collect(frameIndex);
+    m_slots[frameIndex].names.clear();
+    m_slots[frameIndex].performanceScopes.clear();
+
+    m_active = m_requested && m_statisticsPool != VK_NULL_HANDLE;
+    if (!m_active || m_performancePool == VK_NULL_HANDLE)
+        return;
+
+    // Held from before the first command buffer with a performance query begins until destruction
+    if (!m_profilingLocked)
+    {
+        VkAcquireProfilingLockInfoKHR lockInfo{};
+        lockInfo.sType = VK_STRUCTURE_TYPE_ACQUIRE_PROFILING_LOCK_INFO_KHR;
+        lockInfo.timeout = 100'000'000; // 100 ms
+        if (m_acquireProfilingLock(m_device, &lockInfo) != VK_SUCCESS)
+        {
+            std::cerr << "[GpuCounters] Profiling lock unavailable, capturing pipeline statistics only\n";
+            vkDestroyQueryPool(m_device, m_performancePool, nullptr);
+            m_performancePool = VK_NULL_HANDLE;
+            return;
+        }
+        m_profilingLocked = true;
+    }
+    vkResetQueryPool(m_device, m_performancePool, frameIndex * m_maxScopes, m_maxScopes);
+}
+
+void GpuCounters::resetQueries(VkCommandBuffer cmd)
+{
+    if (!m_active)
+        return;
+
+    vkCmdResetQueryPool(cmd, m_statisticsPool, m_frameIndex * m_maxScopes, m_maxScopes);
+}
+
+uint32_t GpuCounters::beginScope(VkCommandBuffer cmd, const char *name, bool secondaryContents)
+{
+    FrameSlot &slot = m_slots[m_frameIndex];
+    if (!m_active || slot.names.size() >= m_maxScopes)
+        return kInvalidScope;
+
+    const uint32_t scope = static_cast<uint32_t>(slot.names.size());
+    const uint32_t query = m_frameIndex * m_maxScopes + scope;
+    const bool performance = m_performancePool != VK_NULL_HANDLE && !secondaryContents;
+    slot.names.emplace_back(name);
+    slot.performanceScopes.push_back(performance);
+
+    vkCmdBeginQuery(cmd, m_statisticsPool, query, 0);
+    if (performance)
+    {
+        vkCmdBeginQuery(cmd, m_performancePool, query, 0);
+    }
+    return scope;
+}
+
+void GpuCounters::endScope(VkCommandBuffer cmd, uint32_t scope)
+{
+    if (scope == kInvalidScope)
+        return;
+
+    const uint32_t query = m_frameIndex * m_maxScopes + scope;
+    if (m_slots[m_frameIndex].performanceScopes[scope])
+    {
+        vkCmdEndQuery(cmd, m_performancePool, query);
+    }
+    vkCmdEndQuery(cmd, m_statisticsPool, query);
+}
+
+// ============================================================================
+// READBACK
+// ============================================================================
+
+void GpuCounters::collect(uint32_t frameIndex)
+{
+    const FrameSlot &slot = m_slots[frameIndex];
+    if (slot.names.empty())
+    {
+        m_lastFrame.clear(); // Not captured: nothing to report
+        return;
+    }
+
+    // The statistics + availability per query. No WAIT_BIT: a pass whose frame was never submitted stays unavailable
+    constexpr uint32_t kStride = kStatisticCount + 1;
+    std::vector<uint64_t> results(slot.names.size() * kStride);
+    VkResult result = vkGetQueryPoolResults(m_device, m_statisticsPool, frameIndex * m_maxScopes, static_cast<uint32_t>(slot.names.size()),
+                                            results.size() * sizeof(uint64_t), results.data(), kStride * sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY)
+        return;
+
+    m_lastFrame.clear();
+    std::vector<VkPerformanceCounterResultKHR> counterResults(m_counterIndices.size());
+    for (uint32_t i = 0; i < slot.names.size(); i++)
+    {
+        const uint64_t *values = &results[i * kStride];
+        if (!values[kStatisticCount])
+            continue;
+
+        PassResult pass;
+        pass.name = slot.names[i];
+        pass.statistics.vertexInvocations = values[0];
+        pass.statistics.clippingInvocations = values[1];
+        pass.statistics.clippingPrimitives = values[2];
+        pass.statistics.fragmentInvocations = values[3];
+        pass.statistics.computeInvocations = values[4];
+
+        // Performance queries have no availability word: VK_SUCCESS is available
+        if (slot.performanceScopes[i] && m_performancePool != VK_NULL_HANDLE &&
+            vkGetQueryPoolResults(m_device, m_performancePool, frameIndex * m_maxScopes + i, 1,
+                                  counterResults.size() * sizeof(VkPerformanceCounterResultKHR), counterResults.data(),
+                                  counterResults.size() * sizeof(VkPerformanceCounterResultKHR), 0) == VK_SUCCESS)
+        {
+            pass.counters.resize(counterResults.size());
+            for (size_t c = 0; c < counterResults.size(); c++)
+            {
+                pass.counters[c] = toDouble(counterResults[c], m_counterStorage[c]);
+            }
+        }
+        m_lastFrame.push_back(std::move(pass));
+    }
+}
+
+GpuPassStatistics GpuCounters::getStatistics(const std::string &name) const
+{
+    GpuPassStatistics total;
+    for (const PassResult &pass : m_lastFrame)
+    {
+        if (pass.name == name)
+        {
+            total += pass.statistics;
+        }
+    }
+    return total;
+}
+
+GpuPassStatistics GpuCounters::getFrameStatistics() const
+{
+    GpuPassStatistics total;
+    for (const PassResult &pass : m_lastFrame)
+    {
+        total += pass.statistics;
+    }
+    return total;
+}
+
+std::vector<double> GpuCounters::getFrameCounters() const
+{
+    std::vector<double> totals(m_counterNames.size(), 0.0);
+    for (const PassResult &pass : m_lastFrame)
+    {
+        for (size_t c = 0; c < pass.counters.size(); c++)
+        {
+            totals[c] += pass.counters[c];
+        }
+    }
+    return totals;
+}
@@ -0,0 +1,624 @@
+#include "GpuCulling.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "Scene.h"
+#include "ShaderRegistry.h"
+#include "UniformArena.h"
+#include "UploadContext.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+GpuCulling::GpuCulling(VkDevice device, VkPhysicalDevice physicalDevice, UniformArena &uniformArena,
+                       uint32_t frameCount, uint32_t maxObjects, bool drawIndirectCount)
+    : m_device(device), m_physicalDevice(physicalDevice), m_uniformArena(uniformArena),
+      m_maxObjects(std::max(maxObjects, 1u)), m_drawIndirectCount(drawIndirectCount)
+{
+    if (m_drawIndirectCount)
+    {
+        m_cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+        m_drawIndirectCount = m_cmdDrawIndexedIndirectCount != nullptr;
+    }
+
+    m_frames.resize(frameCount);
+    for (FrameResources &frame : m_frames)
+    {
+        createObjectBuffers(frame, m_maxObjects);
+
+        auto [countBuffer, countMemory] = VkUtils::CreateBuffer(
+            device, physicalDevice, sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frame.countBuffer = countBuffer;
+        frame.count = static_cast<uint32_t *>(VkUtils::MapBuffer(countBuffer));
+        *frame.count = 0;
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_hiZSampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create Hi-Z sampler!");
+    }
+
+    createCullPipeline();
+    createHiZPipelines();
+}
+
+GpuCulling::~GpuCulling()
+{
+    destroyHiZ();
+
+    vkDestroyPipeline(m_device, m_hiZReducePipeline, nullptr);
+    vkDestroyPipeline(m_device, m_hiZDepthPipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_hiZPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_hiZSetLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_hiZDescriptorPool, nullptr);
+
+    vkDestroyPipeline(m_device, m_cullPipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_cullPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_cullSetLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+
+    vkDestroySampler(m_device, m_hiZSampler, nullptr);
+
+    for (FrameResources &frame : m_frames)
+    {
+        VkUtils::DestroyBuffer(frame.objectBuffer);
+        VkUtils::DestroyBuffer(frame.drawBuffer);
+        VkUtils::DestroyBuffer(frame.countBuffer);
+    }
+}
+
+bool GpuCulling::isSupported(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    return features.multiDrawIndirect && features.drawIndirectFirstInstance;
+}
+
+VkVertexInputBindingDescription GpuCulling::getInstanceBindingDescription()
+{
+    VkVertexInputBindingDescription binding{};
+    binding.binding = kInstanceBinding;
+    binding.stride = sizeof(GpuCullObject);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    return binding;
+}
+
+std::array<VkVertexInputAttributeDescription, 5> GpuCulling::getInstanceAttributeDescriptions()
+{
+    std::array<VkVertexInputAttributeDescription, 5> attributes{};
+    for (uint32_t column = 0; column < 4; column++)
+    {
+        attributes[column].binding = kInstanceBinding;
+        attributes[column].location = kInstanceFirstLocation + column;
+        attributes[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributes[column].offset = offsetof(GpuCullObject, model) + sizeof(glm::vec4) * column;
+    }
+    attributes[4].binding = kInstanceBinding;
+    attributes[4].location = kInstanceFirstLocation + 4;
+    attributes[4].format = VK_FORMAT_R32_UINT;
+    attributes[4].offset = offsetof(GpuCullObject, materialId);
+    return attributes;
+}
+
+VkShaderModule GpuCulling::loadShader(const char *path) const
+{
+    std::vector<char> code = ShaderRegistry::load(path);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("failed to create shader module: ") + path);
+    }
+    return module;
+}
+
+// ============================================================================
+// PIPELINES
+// ============================================================================
+
+void GpuCulling::createCullPipeline()
+{
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    bindings[0].binding = 0; // CullParams, pushed into the uniform arena each frame
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    for (uint32_t i = 1; i <= 3; i++) // Objects, draw commands, draw count
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+    bindings[4].binding = 4; // Hi-Z pyramid
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    for (auto &binding : bindings)
+    {
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_cullSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull descriptor set layout!");
+    }
+
+    uint32_t frameCount = static_cast<uint32_t>(m_frames.size());
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frameCount};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 3};
+    poolSizes[2] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = frameCount;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(frameCount, m_cullSetLayout);
+    std::vector<VkDescriptorSet> sets(frameCount);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = frameCount;
+    allocInfo.pSetLayouts = layouts.data();
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, sets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate cull descriptor sets!");
+    }
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        m_frames[i].cullSet = sets[i];
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_cullSetLayout;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_cullPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull pipeline layout!");
+    }
+
+    VkShaderModule module = loadShader("shaders/scene_cull.comp.spv");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_cullPipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &m_cullPipeline);
+    vkDestroyShaderModule(m_device, module, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull pipeline!");
+    }
+}
+
+void GpuCulling::createHiZPipelines()
+{
+    // Both passes: binding 0 = source (depth or previous mip), binding 1 = destination mip
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    for (auto &binding : bindings)
+    {
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_hiZSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create Hi-Z descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, kMaxHiZMips};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, kMaxHiZMips};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = kMaxHiZMips;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_hiZDescriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create Hi-Z descriptor pool!");
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_hiZSetLayout;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_hiZPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create Hi-Z pipeline layout!");
+    }
+
+    const char *paths[2] = {"shaders/hiz_depth.comp.spv", "shaders/hiz_reduce.comp.spv"};
+    VkPipeline *pipelines[2] = {&m_hiZDepthPipeline, &m_hiZReducePipeline};
+    for (int i = 0; i < 2; i++)
+    {
+        VkShaderModule module = loadShader(paths[i]);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_hiZPipelineLayout;
+
+        VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, pipelines[i]);
+        vkDestroyShaderModule(m_device, module, nullptr);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create Hi-Z pipeline!");
+        }
+    }
+}
+
+void GpuCulling::createObjectBuffers(FrameResources &frame, uint32_t capacity)
+{
+    VkUtils::DestroyBuffer(frame.objectBuffer);
+    VkUtils::DestroyBuffer(frame.drawBuffer);
+
+    auto [objectBuffer, objectMemory] = VkUtils::CreateBuffer(
+        m_device, m_physicalDevice, sizeof(GpuCullObject) * capacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    frame.objectBuffer = objectBuffer;
+    frame.objects = static_cast<GpuCullObject *>(VkUtils::MapBuffer(objectBuffer));
+
+    auto [drawBuffer, drawMemory] = VkUtils::CreateBuffer(
+        m_device, m_physicalDevice, sizeof(VkDrawIndexedIndirectCommand) * capacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    frame.drawBuffer = drawBuffer;
+    frame.capacity = capacity;
+}
+
+void GpuCulling::writeCullSets()
+{
+    for (FrameResources &frame : m_frames)
+    {
+        writeCullSet(frame);
+    }
+}
+
+void GpuCulling::writeCullSet(FrameResources &frame)
+{
+    VkDescriptorBufferInfo paramsInfo{m_uniformArena.getBuffer(), 0, sizeof(CullParams)};
+    VkDescriptorBufferInfo objectInfo{frame.objectBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo drawInfo{frame.drawBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo countInfo{frame.countBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorImageInfo hiZInfo{m_hiZSampler, m_hiZView, VK_IMAGE_LAYOUT_GENERAL};
+
+    std::array<VkWriteDescriptorSet, 5> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = frame.cullSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    writes[0].pBufferInfo = &paramsInfo;
+    writes[1].pBufferInfo = &objectInfo;
+    writes[2].pBufferInfo = &drawInfo;
+    writes[3].pBufferInfo = &countInfo;
+    writes[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[4].pImageInfo = &hiZInfo;
+
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+// ============================================================================
+// HI-Z PYRAMID
+// ============================================================================
+
+void GpuCulling::createHiZ(VkImageView depthView, VkExtent2D extent, VkSampleCountFlagBits samples, bool depthSampleable)
+{
+    destroyHiZ();
+
+    // hiz_depth.comp reads the attachment as sampler2DMS
+    m_hiZAvailable = depthSampleable && samples != VK_SAMPLE_COUNT_1_BIT;
+    m_hiZValid = false;
+
+    // The pyramid exists even when it cannot be built so the cull set always has a valid binding 4
+    m_hiZExtent = extent;
+    m_hiZMipCount = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+    m_hiZMipCount = std::min(m_hiZMipCount, kMaxHiZMips);
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = m_hiZMipCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &m_hiZImage) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create Hi-Z image!");
+    }
+    GpuMemoryAllocator::get().allocateImage(m_hiZImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_hiZImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_hiZMipCount, 0, 1};
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_hiZView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create Hi-Z image view!");
+    }
+
+    m_hiZMipViews.resize(m_hiZMipCount);
+    for (uint32_t mip = 0; mip < m_hiZMipCount; mip++)
+    {
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1};
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_hiZMipViews[mip]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create Hi-Z mip view!");
+        }
+    }
+
+    // One set per mip: level 0 samples the depth attachment, the others the level above
+    std::vector<VkDescriptorSetLayout> layouts(m_hiZMipCount, m_hiZSetLayout);
+    m_hiZSets.resize(m_hiZMipCount);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_hiZDescriptorPool;
+    allocInfo.descriptorSetCount = m_hiZMipCount;
+    allocInfo.pSetLayouts = layouts.data();
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, m_hiZSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate Hi-Z descriptor sets!");
+    }
+
+    for (uint32_t mip = 0; mip < m_hiZMipCount; mip++)
+    {
+        if (mip == 0 && !m_hiZAvailable)
+            continue; // Depth is not sampleable: level 0 is never built
+
+        VkDescriptorImageInfo sourceInfo{};
+        sourceInfo.sampler = m_hiZSampler;
+        sourceInfo.imageView = mip == 0 ? depthView : m_hiZMipViews[mip - 1];
+        sourceInfo.imageLayout = mip == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo destInfo{};
+        destInfo.imageView = m_hiZMipViews[mip];
+        destInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        std::array<VkWriteDescriptorSet, 2> writes{};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = m_hiZSets[mip];
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].pImageInfo = &sourceInfo;
+        writes[1] = writes[0];
+        writes[1].dstBinding = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].pImageInfo = &destInfo;
+        vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    // Cleared to the far plane so an unbuilt pyramid never occludes anything
+    VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_hiZImage;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_hiZMipCount, 0, 1};
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkClearColorValue farDepth = {{1.0f, 0.0f, 0.0f, 0.0f}};
+    vkCmdClearColorImage(cmd, m_hiZImage, VK_IMAGE_LAYOUT_GENERAL, &farDepth, 1, &barrier.subresourceRange);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    writeCullSets();
+}
+
+void GpuCulling::destroyHiZ()
+{
+    if (m_hiZImage == VK_NULL_HANDLE)
+        return;
+
+    vkResetDescriptorPool(m_device, m_hiZDescriptorPool, 0);
+    m_hiZSets.clear();
+
+    for (VkImageView view : m_hiZMipViews)
+    {
+        vkDestroyImageView(m_device, view, nullptr);
+    }
+    m_hiZMipViews.clear();
+    vkDestroyImageView(m_device, m_hiZView, nullptr);
+    m_hiZView = VK_NULL_HANDLE;
+
+    GpuMemoryAllocator::get().destroyImage(m_hiZImage);
+    m_hiZImage = VK_NULL_HANDLE;
+    m_hiZMipCount = 0;
+    m_hiZAvailable = false;
+    m_hiZValid = false;
+}
+
+void GpuCulling::recordHiZBuild(VkCommandBuffer cmd, const glm::mat4 &viewProjection)
+{
+    if (!m_hiZAvailable || !m_occlusionEnabled)
+        return;
+
+    // The depth transition is the caller's; only this frame's cull reads of the pyramid must finish first
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    VkMemoryBarrier mipBarrier{};
+    mipBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    mipBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    mipBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    for (uint32_t mip = 0; mip < m_hiZMipCount; mip++)
+    {
+        uint32_t width = std::max(m_hiZExtent.width >> mip, 1u);
+        uint32_t height = std::max(m_hiZExtent.height >> mip, 1u);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mip == 0 ? m_hiZDepthPipeline : m_hiZReducePipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_hiZPipelineLayout, 0, 1, &m_hiZSets[mip], 0, nullptr);
+        vkCmdDispatch(cmd, (width + kHiZGroupSize - 1) / kHiZGroupSize, (height + kHiZGroupSize - 1) / kHiZGroupSize, 1);
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &mipBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    m_hiZViewProjection = viewProjection;
+    m_hiZValid = true;
+}
+
+// ============================================================================
+// CULL + DRAW
+// ============================================================================
+
+void GpuCulling::updateObjects(uint32_t frameIndex, const Scene &scene)
+{
+    FrameResources &frame = m_frames[frameIndex];
+    if (scene.getObjectCount() > frame.capacity)
+    {
+        // The slot's fence has signalled: nothing in flight reads its buffers or set any more
+        createObjectBuffers(frame, std::max(scene.getObjectCount(), frame.capacity + frame.capacity / 2));
+        writeCullSet(frame);
+    }
+
+    GpuCullObject *objects = frame.objects;
+    m_objectCount = scene.getObjectCount();
+    for (uint32_t i = 0; i < m_objectCount; i++)
+    {
+        const Aabb &bounds = scene.getWorldBounds(i);
+        const MeshRange &range = scene.getMeshRange(scene.getMeshIndex(i));
+
+        GpuCullObject &object = objects[i];
+        object.model = scene.getModelMatrix(i);
+        object.boundingSphere = glm::vec4(bounds.center(), glm::length(bounds.max - bounds.min) * 0.5f);
+        object.firstIndex = range.firstIndex;
+        object.indexCount = range.indexCount;
+        object.vertexOffset = range.vertexOffset;
+        object.visible = scene.isVisible(i) ? 1u : 0u;
+        object.materialId = scene.getMaterialId(i);
+    }
+}
+
+void GpuCulling::recordCull(VkCommandBuffer cmd, uint32_t frameIndex, const glm::mat4 &viewProjection)
+{
+    FrameResources &frame = m_frames[frameIndex];
+
+    CullParams params{};
+    Frustum frustum = Frustum::fromViewProjection(viewProjection);
+    std::copy(std::begin(frustum.planes), std::end(frustum.planes), params.frustumPlanes);
+    params.hiZViewProjection = m_hiZViewProjection;
+    params.hiZSize = glm::vec2(static_cast<float>(m_hiZExtent.width), static_cast<float>(m_hiZExtent.height));
+    params.objectCount = m_objectCount;
+    params.flags = m_drawIndirectCount ? kFlagCompact : 0u;
+    if (m_occlusionEnabled && m_hiZValid)
+    {
+        params.flags |= kFlagOcclusion;
+    }
+    params.hiZMipCount = m_hiZMipCount;
+    uint32_t paramsOffset = m_uniformArena.push(params);
+
+    vkCmdFillBuffer(cmd, frame.countBuffer, 0, sizeof(uint32_t), 0);
+
+    // Count reset before the atomics; last frame's pyramid writes before the occlusion reads
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &frame.cullSet, 1, &paramsOffset);
+    vkCmdDispatch(cmd, (m_objectCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCulling::recordDraw(VkCommandBuffer cmd, uint32_t frameIndex) const
+{
+    const FrameResources &frame = m_frames[frameIndex];
+    if (m_objectCount == 0)
+        return;
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, kInstanceBinding, 1, &frame.objectBuffer, &offset);
+
+    if (m_drawIndirectCount)
+    {
+        m_cmdDrawIndexedIndirectCount(cmd, frame.drawBuffer, 0, frame.countBuffer, 0,
+                                      m_objectCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else
+    {
+        vkCmdDrawIndexedIndirect(cmd, frame.drawBuffer, 0, m_objectCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+uint32_t GpuCulling::getVisibleCount(uint32_t frameIndex) const
+{
+    return *m_frames[frameIndex].count;
+}
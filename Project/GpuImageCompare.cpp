@@ -0,0 +1,450 @@
+#include "GpuImageCompare.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ImageMetrics.h"
+#include "ShaderRegistry.h"
+#include "VulkanUtil.h"
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    // Raw byte copies between the two are allowed, so the shaders read what was stored
+    VkFormat unormEquivalent(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return VK_FORMAT_B8G8R8A8_UNORM;
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        default:
+            return format;
+        }
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+GpuImageCompare::GpuImageCompare(VkDevice device, uint32_t frameCount, VkExtent2D extent, VkFormat format)
+    : m_device(device), m_extent(extent), m_format(unormEquivalent(format))
+{
+    m_slots.resize(frameCount);
+    for (FrameSlot &slot : m_slots)
+    {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = sizeof(float) * 4;
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(device, &bufferInfo, nullptr, &slot.totalsBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image compare result buffer!");
+        }
+        GpuMemoryAllocator::get().allocateBuffer(slot.totalsBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        slot.totals = static_cast<const float *>(GpuMemoryAllocator::get().mapBuffer(slot.totalsBuffer));
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image compare sampler!");
+    }
+
+    createPipelines();
+    createTargets();
+    writeSets();
+}
+
+GpuImageCompare::~GpuImageCompare()
+{
+    destroyTargets();
+
+    vkDestroyPipeline(m_device, m_reducePipeline, nullptr);
+    vkDestroyPipeline(m_device, m_comparePipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+
+    for (FrameSlot &slot : m_slots)
+    {
+        GpuMemoryAllocator::get().destroyBuffer(slot.totalsBuffer);
+    }
+}
+
+void GpuImageCompare::resize(VkExtent2D extent, VkFormat format)
+{
+    destroyTargets();
+    m_extent = extent;
+    m_format = unormEquivalent(format);
+    createTargets();
+    writeSets();
+
+    m_target = 0;
+    m_referenceValid = false;
+    for (FrameSlot &slot : m_slots)
+    {
+        slot.pending = false;
+    }
+}
+
+void GpuImageCompare::setReferenceMode(Reference mode)
+{
+    if (mode == m_mode)
+        return;
+    m_mode = mode;
+    m_referenceValid = false;
+    m_captureRequested = false;
+}
+
+VkShaderModule GpuImageCompare::loadShader(const char *path) const
+{
+    std::vector<char> code = ShaderRegistry::load(path);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("failed to create shader module: ") + path);
+    }
+    return module;
+}
+
+// ============================================================================
+// PIPELINES
+// ============================================================================
+
+void GpuImageCompare::createPipelines()
+{
+    // One layout for both passes: frame, reference, partial sums, totals
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i < 2 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image compare descriptor set layout!");
+    }
+
+    const uint32_t setCount = static_cast<uint32_t>(m_slots.size()) * 2;
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount * 2};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, setCount * 2};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image compare descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(setCount, m_setLayout);
+    std::vector<VkDescriptorSet> sets(setCount);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts = layouts.data();
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, sets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate image compare descriptor sets!");
+    }
+    for (uint32_t i = 0; i < m_slots.size(); i++)
+    {
+        m_slots[i].sets = {sets[i * 2], sets[i * 2 + 1]};
+    }
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t)}; // Partial count, reduce pass only
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image compare pipeline layout!");
+    }
+
+    const char *paths[2] = {"shaders/image_compare.comp.spv", "shaders/image_compare_reduce.comp.spv"};
+    VkPipeline *pipelines[2] = {&m_comparePipeline, &m_reducePipeline};
+    for (int i = 0; i < 2; i++)
+    {
+        VkShaderModule module = loadShader(paths[i]);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_pipelineLayout;
+
+        VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, pipelines[i]);
+        vkDestroyShaderModule(m_device, module, nullptr);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image compare pipeline!");
+        }
+    }
+}
+
+// ============================================================================
+// TARGETS
+// ============================================================================
+
+void GpuImageCompare::createTargets()
+{
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_format;
+        imageInfo.extent = {m_extent.width, m_extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &m_images[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image compare target!");
+        }
+        GpuMemoryAllocator::get().allocateImage(m_images[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_images[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = m_format;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_views[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image compare target view!");
+        }
+        m_written[i] = false;
+    }
+
+    m_groupsX = (m_extent.width + kTileSize - 1) / kTileSize;
+    m_groupsY = (m_extent.height + kTileSize - 1) / kTileSize;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeof(float) * 4 * m_groupsX * m_groupsY;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &m_partialsBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image compare partials buffer!");
+    }
+    GpuMemoryAllocator::get().allocateBuffer(m_partialsBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void GpuImageCompare::destroyTargets()
+{
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        if (m_views[i] != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(m_device, m_views[i], nullptr);
+            m_views[i] = VK_NULL_HANDLE;
+        }
+        if (m_images[i] != VK_NULL_HANDLE)
+        {
+            GpuMemoryAllocator::get().destroyImage(m_images[i]);
+            m_images[i] = VK_NULL_HANDLE;
+        }
+    }
+    if (m_partialsBuffer != VK_NULL_HANDLE)
+    {
+        GpuMemoryAllocator::get().destroyBuffer(m_partialsBuffer);
+        m_partialsBuffer = VK_NULL_HANDLE;
+    }
+}
+
+void GpuImageCompare::writeSets()
+{
+    for (FrameSlot &slot : m_slots)
+    {
+        for (uint32_t target = 0; target < 2; target++)
+        {
+            VkDescriptorImageInfo frameInfo{m_sampler, m_views[target], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            VkDescriptorImageInfo referenceInfo{m_sampler, m_views[1 - target], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            VkDescriptorBufferInfo partialsInfo{m_partialsBuffer, 0, VK_WHOLE_SIZE};
+            VkDescriptorBufferInfo totalsInfo{slot.totalsBuffer, 0, VK_WHOLE_SIZE};
+
+            std::array<VkWriteDescriptorSet, 4> writes{};
+            for (uint32_t i = 0; i < writes.size(); i++)
+            {
+                writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[i].dstSet = slot.sets[target];
+                writes[i].dstBinding = i;
+                writes[i].descriptorCount = 1;
+                writes[i].descriptorType = i < 2 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            }
+            writes[0].pImageInfo = &frameInfo;
+            writes[1].pImageInfo = &referenceInfo;
+            writes[2].pBufferInfo = &partialsInfo;
+            writes[3].pBufferInfo = &totalsInfo;
+
+            vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+    }
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+void GpuImageCompare::recordCopy(VkCommandBuffer cmd, VkImage source, uint32_t image)
+{
+    // Waits for earlier frames' compute reads of this image; chains into the dispatches below
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = m_written[image] ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_images[image];
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.extent = {m_extent.width, m_extent.height, 1};
+    vkCmdCopyImage(cmd, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   m_images[image], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+    m_written[image] = true;
+}
+
+void GpuImageCompare::recordCompare(VkCommandBuffer cmd, uint32_t frameIndex, VkImage source, uint32_t tag)
+{
+    if (frameIndex >= m_slots.size())
+    {
+        throw std::out_of_range("GpuImageCompare frame index out of range!");
+    }
+
+    const uint32_t target = m_target;
+    const uint32_t reference = 1 - target;
+
+    if (m_mode == Reference::Captured)
+    {
+        if (m_captureRequested)
+        {
+            recordCopy(cmd, source, reference);
+            m_referenceValid = true;
+            m_captureRequested = false;
+            return;
+        }
+        if (!m_referenceValid)
+            return;
+    }
+
+    recordCopy(cmd, source, target);
+
+    if (m_mode == Reference::PreviousFrame)
+    {
+        // This frame is the next one's reference
+        m_target = reference;
+        if (!m_referenceValid)
+        {
+            m_referenceValid = true;
+            return;
+        }
+    }
+
+    FrameSlot &slot = m_slots[frameIndex];
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_comparePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &slot.sets[target], 0, nullptr);
+    vkCmdDispatch(cmd, m_groupsX, m_groupsY, 1);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = m_partialsBuffer;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+
+    const uint32_t partialCount = m_groupsX * m_groupsY;
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_reducePipeline);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(partialCount), &partialCount);
+    vkCmdDispatch(cmd, 1, 1, 1);
+
+    // Make the totals visible to the host once the fence has signalled
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.buffer = slot.totalsBuffer;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+
+    slot.tag = tag;
+    slot.pending = true;
+}
+
+// ============================================================================
+// RESULTS
+// ============================================================================
+
+bool GpuImageCompare::collect(uint32_t frameIndex, GpuImageCompareResult &result)
+{
+    FrameSlot &slot = m_slots[frameIndex];
+    if (!slot.pending)
+        return false;
+    slot.pending = false;
+
+    const double pixelCount = static_cast<double>(m_extent.width) * m_extent.height;
+    const bool hasWindows = m_extent.width >= 11 && m_extent.height >= 11;
+    const double windowCount = hasWindows ? static_cast<double>(m_extent.width - 10) * (m_extent.height - 10) : 0.0;
+
+    result.tag = slot.tag;
+    result.mse = slot.totals[0] / (pixelCount * 4.0);
+    result.psnr = ImageMetrics::psnrFromMse(result.mse);
+    result.deltaE = slot.totals[1] / pixelCount;
+    result.ssim = hasWindows ? slot.totals[2] / windowCount : 0.0;
+    return true;
+}
@@ -0,0 +1,643 @@
+#include "GpuMemoryAllocator.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // Block size classes: the first block of a pool starts small and each new
+    // block doubles up to the pool's maximum, so tiny scenes don't reserve
+    // hundreds of MB while big scenes still end up with few, large blocks.
+    constexpr VkDeviceSize DEVICE_LOCAL_BLOCK_SIZE = 256ull * 1024 * 1024;
+    constexpr VkDeviceSize HOST_VISIBLE_BLOCK_SIZE = 64ull * 1024 * 1024;
+    constexpr VkDeviceSize MIN_BLOCK_SIZE = 4ull * 1024 * 1024;
+    constexpr VkDeviceSize SMALL_HEAP_LIMIT = 1024ull * 1024 * 1024;
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
+    }
+}
+
+const char *toString(GpuMemoryCategory category)
+{
+    switch (category)
+    {
+    case GpuMemoryCategory::Texture:
+        return "Textures";
+    case GpuMemoryCategory::Mesh:
+        return "Meshes";
+    case GpuMemoryCategory::RenderTarget:
+        return "Render targets";
+    case GpuMemoryCategory::Staging:
+        return "Staging";
+    default:
+        return "Other";
+    }
+}
+
+GpuMemoryAllocator &GpuMemoryAllocator::get()
+{
+    static GpuMemoryAllocator instance;
+    return instance;
+}
+
+bool GpuMemoryAllocator::isBudgetSupported(VkPhysicalDevice physicalDevice)
+{
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, extensions.data());
+    return std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties &extension)
+                       { return std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; });
+}
+
+void GpuMemoryAllocator::initialize(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t deviceCount, bool deviceAddress,
+                                    bool memoryBudget)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_deviceCount = deviceCount;
+    m_deviceAddress = deviceAddress;
+    m_memoryBudget = memoryBudget;
+    m_categories = {};
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    m_primaryHeap = 0;
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+        if (m_memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+        {
+            m_primaryHeap = m_memoryProperties.memoryTypes[i].heapIndex;
+            break;
+        }
+    }
+
+    m_pools.clear();
+    m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+        VkMemoryPropertyFlags flags = m_memoryProperties.memoryTypes[i].propertyFlags;
+        for (uint32_t tiling = 0; tiling < 2; tiling++)
+        {
+            Pool &pool = m_pools[i * 2 + tiling];
+            pool.memoryTypeIndex = i;
+            pool.linear = (tiling == 0);
+            pool.hostVisible = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+            pool.deviceLocal = (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+            pool.blockSize = chooseBlockSize(i);
+        }
+    }
+
+    std::cout << "[GpuMemoryAllocator] Initialized with " << m_memoryProperties.memoryTypeCount
+              << " memory types, " << m_memoryProperties.memoryHeapCount << " heaps"
+              << (memoryBudget ? ", measuring the budget" : "") << "\n";
+}
+
+void GpuMemoryAllocator::cleanup()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_device == VK_NULL_HANDLE)
+        return;
+
+    size_t leaked = m_bufferAllocations.size() + m_imageAllocations.size();
+    if (leaked > 0)
+    {
+        std::cout << "[GpuMemoryAllocator] Warning: " << leaked << " allocations still alive at shutdown\n";
+    }
+
+    for (auto &pool : m_pools)
+    {
+        for (auto &block : pool.blocks)
+        {
+            if (block->mapped)
+                vkUnmapMemory(m_device, block->memory);
+            vkFreeMemory(m_device, block->memory, nullptr);
+        }
+        pool.blocks.clear();
+    }
+
+    m_pools.clear();
+    m_bufferAllocations.clear();
+    m_imageAllocations.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+uint32_t GpuMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+    // A multi-instance heap holds one copy per device of the group, which cannot be mapped
+    const bool singleInstance = m_deviceCount > 1 && (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+        const VkMemoryType &type = m_memoryProperties.memoryTypes[i];
+        if (singleInstance && (m_memoryProperties.memoryHeaps[type.heapIndex].flags & VK_MEMORY_HEAP_MULTI_INSTANCE_BIT))
+        {
+            continue;
+        }
+        if ((typeFilter & (1 << i)) && (type.propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool GpuMemoryAllocator::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+VkDeviceSize GpuMemoryAllocator::chooseBlockSize(uint32_t memoryTypeIndex) const
+{
+    const VkMemoryType &type = m_memoryProperties.memoryTypes[memoryTypeIndex];
+    VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[type.heapIndex].size;
+
+    VkDeviceSize blockSize = (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+                                 ? HOST_VISIBLE_BLOCK_SIZE
+                                 : DEVICE_LOCAL_BLOCK_SIZE;
+
+    // Small heaps (e.g. 256 MB BAR window) get 1/8 of the heap per block
+    if (heapSize <= SMALL_HEAP_LIMIT)
+    {
+        blockSize = std::min(blockSize, std::max(MIN_BLOCK_SIZE, alignUp(heapSize / 8, 32)));
+    }
+
+    return blockSize;
+}
+
+GpuMemoryAllocator::Block *GpuMemoryAllocator::createBlock(Pool &pool, VkDeviceSize size, bool dedicated, bool mayFail)
+{
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = pool.memoryTypeIndex;
+
+    // Any buffer may be bound to the block, so any block may need to hand out addresses
+    VkMemoryAllocateFlagsInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    flagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+    if (m_deviceAddress)
+    {
+        allocInfo.pNext = &flagsInfo;
+    }
+
+    auto block = std::make_unique<Block>();
+    block->id = m_nextBlockId++;
+    block->size = size;
+    block->dedicated = dedicated;
+
+    const VkResult result = vkAllocateMemory(m_device, &allocInfo, nullptr, &block->memory);
+    if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && mayFail)
+    {
+        return nullptr;
+    }
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate GPU memory block!");
+    }
+
+    if (pool.hostVisible)
+    {
+        if (vkMapMemory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+        {
+            vkFreeMemory(m_device, block->memory, nullptr);
+            throw std::runtime_error("failed to map GPU memory block!");
+        }
+    }
+
+    block->freeRanges.push_back({0, size});
+
+    pool.blocks.push_back(std::move(block));
+    return pool.blocks.back().get();
+}
+
+bool GpuMemoryAllocator::suballocate(Block &block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &outOffset)
+{
+    // Best fit: smallest free range that still holds the aligned request
+    auto best = block.freeRanges.end();
+    VkDeviceSize bestWaste = ~0ull;
+
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it)
+    {
+        VkDeviceSize aligned = alignUp(it->offset, alignment);
+        VkDeviceSize end = it->offset + it->size;
+        if (aligned + size > end)
+            continue;
+
+        VkDeviceSize waste = it->size - size;
+        if (waste < bestWaste)
+        {
+            best = it;
+            bestWaste = waste;
+        }
+    }
+
+    if (best == block.freeRanges.end())
+        return false;
+
+    VkDeviceSize rangeOffset = best->offset;
+    VkDeviceSize rangeEnd = best->offset + best->size;
+    VkDeviceSize aligned = alignUp(rangeOffset, alignment);
+    VkDeviceSize allocEnd = aligned + size;
+
+    // Split into [front padding][allocation][tail]
+    auto insertPos = block.freeRanges.erase(best);
+    if (allocEnd < rangeEnd)
+    {
+        insertPos = block.freeRanges.insert(insertPos, {allocEnd, rangeEnd - allocEnd});
+    }
+    if (aligned > rangeOffset)
+    {
+        block.freeRanges.insert(insertPos, {rangeOffset, aligned - rangeOffset});
+    }
+
+    block.used += size;
+    block.allocationCount++;
+    outOffset = aligned;
+    return true;
+}
+
+void GpuMemoryAllocator::release(Block &block, VkDeviceSize offset, VkDeviceSize size)
+{
+    auto it = std::lower_bound(block.freeRanges.begin(), block.freeRanges.end(), offset,
+                               [](const FreeRange &r, VkDeviceSize o)
+                               { return r.offset < o; });
+    it = block.freeRanges.insert(it, {offset, size});
+
+    // Coalesce with next
+    auto next = it + 1;
+    if (next != block.freeRanges.end() && it->offset + it->size == next->offset)
+    {
+        it->size += next->size;
+        block.freeRanges.erase(next);
+    }
+
+    // Coalesce with previous
+    if (it != block.freeRanges.begin())
+    {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset)
+        {
+            prev->size += it->size;
+            block.freeRanges.erase(it);
+        }
+    }
+
+    block.used -= size;
+    block.allocationCount--;
+}
+
+GpuAllocation GpuMemoryAllocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear,
+                                           GpuMemoryCategory category)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_device == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("GpuMemoryAllocator used before initialize()!");
+    }
+
+    uint32_t typeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    uint32_t poolIndex = typeIndex * 2 + (linear ? 0 : 1);
+    Pool &pool = m_pools[poolIndex];
+
+    GpuAllocation allocation{};
+    allocation.size = requirements.size;
+    allocation.poolIndex = poolIndex;
+    allocation.memoryTypeIndex = typeIndex;
+    allocation.category = category;
+
+    Block *target = nullptr;
+    VkDeviceSize offset = 0;
+
+    // Large resources (render targets at high res, big meshes) get their own block, and so does lazily
+    // allocated memory, which the driver commits per allocation
+    const bool lazy = (m_memoryProperties.memoryTypes[typeIndex].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+    if (requirements.size > pool.blockSize / 2 || lazy)
+    {
+        target = createBlock(pool, requirements.size, true);
+        suballocate(*target, requirements.size, requirements.alignment, offset);
+    }
+    else
+    {
+        for (auto &block : pool.blocks)
+        {
+            if (!block->dedicated && suballocate(*block, requirements.size, requirements.alignment, offset))
+            {
+                target = block.get();
+                break;
+            }
+        }
+
+        if (!target)
+        {
+            // Next size class: double the largest existing block, capped at blockSize
+            VkDeviceSize newSize = std::min(pool.blockSize, MIN_BLOCK_SIZE);
+            for (const auto &block : pool.blocks)
+            {
+                if (!block->dedicated)
+                    newSize = std::min(pool.blockSize, std::max(newSize, block->size * 2));
+            }
+            const VkDeviceSize minimumSize = alignUp(requirements.size, requirements.alignment);
+            newSize = std::max(newSize, minimumSize);
+
+            // A full heap may still hold the request itself: a block of just its size before giving up
+            target = createBlock(pool, newSize, false, newSize > minimumSize);
+            if (!target)
+            {
+                std::cout << "[GpuMemoryAllocator] Out of memory for a " << (newSize >> 20) << " MB block, retrying at "
+                          << (minimumSize >> 10) << " KB\n";
+                target = createBlock(pool, minimumSize, false);
+            }
+            if (!suballocate(*target, requirements.size, requirements.alignment, offset))
+            {
+                throw std::runtime_error("failed to sub-allocate from fresh GPU memory block!");
+            }
+        }
+    }
+
+    allocation.memory = target->memory;
+    allocation.offset = offset;
+    allocation.blockId = target->id;
+    allocation.mapped = target->mapped ? static_cast<char *>(target->mapped) + offset : nullptr;
+
+    GpuCategoryStats &categoryStats = m_categories[static_cast<size_t>(category)];
+    categoryStats.allocationCount++;
+    categoryStats.bytes += allocation.size;
+    return allocation;
+}
+
+void GpuMemoryAllocator::free(const GpuAllocation &allocation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_device == VK_NULL_HANDLE || allocation.poolIndex >= m_pools.size())
+        return;
+
+    Pool &pool = m_pools[allocation.poolIndex];
+    auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                           [&](const std::unique_ptr<Block> &b)
+                           { return b->id == allocation.blockId; });
+    if (it == pool.blocks.end())
+        return;
+
+    Block &block = **it;
+    release(block, allocation.offset, allocation.size);
+
+    GpuCategoryStats &categoryStats = m_categories[static_cast<size_t>(allocation.category)];
+    categoryStats.allocationCount--;
+    categoryStats.bytes -= allocation.size;
+
+    if (block.allocationCount > 0)
+        return;
+
+    // Keep one empty shared block around per pool to avoid alloc/free thrash
+    size_t sharedBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+                                        [](const std::unique_ptr<Block> &b)
+                                        { return !b->dedicated; });
+    if (block.dedicated || sharedBlocks > 1)
+    {
+        if (block.mapped)
+            vkUnmapMemory(m_device, block.memory);
+        vkFreeMemory(m_device, block.memory, nullptr);
+        pool.blocks.erase(it);
+    }
+}
+
+VkDeviceMemory GpuMemoryAllocator::allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, GpuMemoryCategory category)
+{
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
+
+    GpuAllocation allocation = allocate(memRequirements, properties, true, category);
+    vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bufferAllocations[buffer] = allocation;
+    return allocation.memory;
+}
+
+VkDeviceMemory GpuMemoryAllocator::allocateImage(VkImage image, VkMemoryPropertyFlags properties, bool linear,
+                                                 GpuMemoryCategory category)
+{
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_device, image, &memRequirements);
+
+    GpuAllocation allocation = allocate(memRequirements, properties, linear, category);
+    vkBindImageMemory(m_device, image, allocation.memory, allocation.offset);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_imageAllocations[image] = allocation;
+    return allocation.memory;
+}
+
+GpuMemoryCategory GpuMemoryAllocator::categorize(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+    if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+    {
+        return GpuMemoryCategory::Mesh;
+    }
+    const bool hostOnly = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (hostOnly && (usage & (VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)))
+    {
+        return GpuMemoryCategory::Staging;
+    }
+    return GpuMemoryCategory::Other;
+}
+
+GpuMemoryCategory GpuMemoryAllocator::categorize(VkImageUsageFlags usage)
+{
+    const VkImageUsageFlags written = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                      VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    return (usage & written) ? GpuMemoryCategory::RenderTarget : GpuMemoryCategory::Texture;
+}
+
+void GpuMemoryAllocator::destroyBuffer(VkBuffer buffer)
+{
+    if (buffer == VK_NULL_HANDLE)
+        return;
+
+    GpuAllocation allocation{};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_bufferAllocations.find(buffer);
+        if (it != m_bufferAllocations.end())
+        {
+            allocation = it->second;
+            m_bufferAllocations.erase(it);
+        }
+    }
+
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    free(allocation);
+}
+
+void GpuMemoryAllocator::destroyImage(VkImage image)
+{
+    if (image == VK_NULL_HANDLE)
+        return;
+
+    GpuAllocation allocation{};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_imageAllocations.find(image);
+        if (it != m_imageAllocations.end())
+        {
+            allocation = it->second;
+            m_imageAllocations.erase(it);
+        }
+    }
+
+    vkDestroyImage(m_device, image, nullptr);
+    free(allocation);
+}
+
+void *GpuMemoryAllocator::mapBuffer(VkBuffer buffer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_bufferAllocations.find(buffer);
+    if (it == m_bufferAllocations.end() || !it->second.mapped)
+    {
+        throw std::runtime_error("mapBuffer called on a buffer without host-visible memory!");
+    }
+    return it->second.mapped;
+}
+
+void *GpuMemoryAllocator::mapImage(VkImage image)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_imageAllocations.find(image);
+    if (it == m_imageAllocations.end() || !it->second.mapped)
+    {
+        throw std::runtime_error("mapImage called on an image without host-visible memory!");
+    }
+    return it->second.mapped;
+}
+
+GpuMemoryStats GpuMemoryAllocator::collectStats(bool hostVisible) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    GpuMemoryStats stats{};
+    for (const auto &pool : m_pools)
+    {
+        if (pool.hostVisible != hostVisible)
+            continue;
+
+        for (const auto &block : pool.blocks)
+        {
+            stats.blockCount++;
+            if (block->dedicated)
+                stats.dedicatedBlockCount++;
+            stats.allocationCount += block->allocationCount;
+            stats.bytesReserved += block->size;
+            stats.bytesUsed += block->used;
+            for (const auto &range : block->freeRanges)
+            {
+                stats.largestFreeRange = std::max(stats.largestFreeRange, range.size);
+            }
+        }
+    }
+    return stats;
+}
+
+GpuMemoryStats GpuMemoryAllocator::getDeviceLocalStats() const
+{
+    return collectStats(false);
+}
+
+GpuMemoryStats GpuMemoryAllocator::getHostVisibleStats() const
+{
+    return collectStats(true);
+}
+
+GpuCategoryStats GpuMemoryAllocator::getCategoryStats(GpuMemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_categories[static_cast<size_t>(category)];
+}
+
+std::vector<GpuHeapBudget> GpuMemoryAllocator::getHeapBudgets() const
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (m_memoryBudget)
+    {
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &properties);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<GpuHeapBudget> heaps(m_memoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+    {
+        heaps[i].size = m_memoryProperties.memoryHeaps[i].size;
+        heaps[i].deviceLocal = (m_memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+    for (const auto &pool : m_pools)
+    {
+        GpuHeapBudget &heap = heaps[m_memoryProperties.memoryTypes[pool.memoryTypeIndex].heapIndex];
+        for (const auto &block : pool.blocks)
+        {
+            heap.reserved += block->size;
+            heap.used += block->used;
+        }
+    }
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+    {
+        GpuHeapBudget &heap = heaps[i];
+        heap.measured = m_memoryBudget && budgetProperties.heapBudget[i] > 0;
+        if (heap.measured)
+        {
+            // Never less than our own blocks: the driver's numbers can lag behind the allocations
+            heap.budget = budgetProperties.heapBudget[i];
+            heap.usage = std::max(budgetProperties.heapUsage[i], heap.reserved);
+        }
+        else
+        {
+            heap.budget = static_cast<VkDeviceSize>(static_cast<double>(heap.size) * kFallbackBudget);
+            heap.usage = heap.reserved;
+        }
+    }
+    return heaps;
+}
+
+int64_t GpuMemoryAllocator::budgetRemaining() const
+{
+    const std::vector<GpuHeapBudget> heaps = getHeapBudgets();
+    if (m_primaryHeap >= heaps.size())
+    {
+        return 0;
+    }
+    const GpuHeapBudget &heap = heaps[m_primaryHeap];
+    const VkDeviceSize limit = static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * kBudgetTarget);
+    const VkDeviceSize usage = heap.usage - std::min(heap.usage, heap.reserved - heap.used);
+    return static_cast<int64_t>(limit) - static_cast<int64_t>(usage);
+}
+
+VkDeviceSize GpuMemoryAllocator::getBudgetOverrun() const
+{
+    const int64_t remaining = budgetRemaining();
+    return remaining < 0 ? static_cast<VkDeviceSize>(-remaining) : 0;
+}
+
+VkDeviceSize GpuMemoryAllocator::getBudgetHeadroom() const
+{
+    const int64_t remaining = budgetRemaining();
+    return remaining > 0 ? static_cast<VkDeviceSize>(remaining) : 0;
+}
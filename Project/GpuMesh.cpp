@@ -0,0 +1,73 @@
+#include "GpuMesh.h"
+#include "UploadContext.h"
+#include "VulkanUtil.h"
+#include <stdexcept>
+
+GpuMesh::GpuMesh(VkDevice device, VkPhysicalDevice physicalDevice, const void *vertices, VkDeviceSize vertexStride,
+                 uint32_t vertexCount, const std::vector<uint32_t> &indices)
+    : m_indexType(selectIndexType(vertexCount)), m_indexCount(static_cast<uint32_t>(indices.size())),
+      m_vertexCount(vertexCount)
+{
+    if (vertexCount == 0 || indices.empty())
+    {
+        throw std::runtime_error("GpuMesh needs vertices and indices!");
+    }
+
+    const VkDeviceSize vertexSize = vertexStride * vertexCount;
+    auto [vertexBuffer, vertexMemory] = VkUtils::CreateBuffer(
+        device, physicalDevice, vertexSize,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_vertexBuffer = vertexBuffer;
+    UploadContext::get().uploadBuffer(m_vertexBuffer, vertices, vertexSize);
+
+    // Narrowed here so the callers never deal with two index types
+    std::vector<uint16_t> narrow;
+    const void *indexData = indices.data();
+    VkDeviceSize indexSize = indices.size() * sizeof(uint32_t);
+    if (m_indexType == VK_INDEX_TYPE_UINT16)
+    {
+        narrow.reserve(indices.size());
+        for (uint32_t index : indices)
+        {
+            if (index >= vertexCount)
+            {
+                throw std::out_of_range("GpuMesh index out of range!");
+            }
+            narrow.push_back(static_cast<uint16_t>(index));
+        }
+        indexData = narrow.data();
+        indexSize = narrow.size() * sizeof(uint16_t);
+    }
+
+    auto [indexBuffer, indexMemory] = VkUtils::CreateBuffer(
+        device, physicalDevice, indexSize,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_indexBuffer = indexBuffer;
+    UploadContext::get().uploadBuffer(m_indexBuffer, indexData, indexSize);
+}
+
+GpuMesh::~GpuMesh()
+{
+    VkUtils::DestroyBuffer(m_indexBuffer);
+    VkUtils::DestroyBuffer(m_vertexBuffer);
+}
+
+VkIndexType GpuMesh::selectIndexType(uint32_t vertexCount)
+{
+    // 0xFFFF is the 16-bit primitive restart value, so it is never used as an index
+    return vertexCount <= 0xFFFF ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+void GpuMesh::bind(VkCommandBuffer cmd) const
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &m_vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(cmd, m_indexBuffer, 0, m_indexType);
+}
+
+void GpuMesh::draw(VkCommandBuffer cmd, uint32_t instanceCount) const
+{
+    vkCmdDrawIndexed(cmd, m_indexCount, instanceCount, 0, 0, 0);
+}
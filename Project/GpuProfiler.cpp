@@ -0,0 +1,252 @@
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <stdexcept>
+
+// ============================================================================
+// HISTORY
+// ============================================================================
+
+void GpuProfiler::History::push(float value)
+{
+    values[next] = value;
+    next = (next + 1) % kHistorySize;
+    count = std::min(count + 1, kHistorySize);
+}
+
+float GpuProfiler::History::average() const
+{
+    if (count == 0)
+        return 0.0f;
+
+    // Until the ring wraps, the samples are exactly [0, count)
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sum += values[i];
+    }
+    return sum / static_cast<float>(count);
+}
+
+// ============================================================================
+// SCOPE
+// ============================================================================
+
+GpuProfiler::Scope::Scope(GpuProfiler *profiler, VkCommandBuffer cmd, const char *name)
+    : m_profiler(profiler), m_cmd(cmd), m_scope(profiler ? profiler->beginScope(cmd, name) : kInvalidScope)
+{
+}
+
+GpuProfiler::Scope::~Scope()
+{
+    if (m_profiler)
+    {
+        m_profiler->endScope(m_cmd, m_scope);
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+GpuProfiler::GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, uint32_t maxScopesPerFrame)
+    : m_device(device), m_frameCount(frameCount), m_maxScopes(maxScopesPerFrame)
+{
+    m_slots.resize(frameCount);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if (!properties.limits.timestampComputeAndGraphics)
+        return;
+
+    VkQueryPoolCreateInfo queryInfo{};
+    queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount = m_maxScopes * 2 * frameCount;
+
+    if (vkCreateQueryPool(device, &queryInfo, nullptr, &m_queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("GpuProfiler: failed to create timestamp query pool!");
+    }
+    m_timestampPeriod = properties.limits.timestampPeriod;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (m_queryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+    }
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+void GpuProfiler::beginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= m_frameCount)
+    {
+        throw std::out_of_range("GpuProfiler frame index out of range!");
+    }
+    m_frameIndex = frameIndex;
+
+    collect(frameIndex);
+    m_slots[frameIndex].names.clear();
+}
+
+void GpuProfiler::resetQueries(VkCommandBuffer cmd)
+{
+    if (m_queryPool == VK_NULL_HANDLE)
+        return;
+
+    vkCmdResetQueryPool(cmd, m_queryPool, m_frameIndex * m_maxScopes * 2, m_maxScopes * 2);
+}
+
+uint32_t GpuProfiler::reserveScope(const char *name, uint32_t viewCount)
+{
+    std::vector<std::string> &names = m_slots[m_frameIndex].names;
+    viewCount = std::max(viewCount, 1u);
+    if (m_queryPool == VK_NULL_HANDLE || names.size() + viewCount > m_maxScopes)
+        return kInvalidScope;
+
+    // A multiview timestamp spills into the following queries: those scopes stay unnamed, so nothing else uses them
+    const uint32_t scope = static_cast<uint32_t>(names.size());
+    names.emplace_back(name);
+    names.resize(names.size() + viewCount - 1);
+    return scope;
+}
+
+// A slot's queries: the begin timestamps of its scopes, then their end timestamps, so that a scope's views
+// occupy consecutive queries on both sides
+void GpuProfiler::writeBegin(VkCommandBuffer cmd, uint32_t scope, VkPipelineStageFlagBits stage)
+{
+    if (scope == kInvalidScope)
+        return;
+
+    vkCmdWriteTimestamp(cmd, stage, m_queryPool, m_frameIndex * m_maxScopes * 2 + scope);
+}
+
+void GpuProfiler::writeEnd(VkCommandBuffer cmd, uint32_t scope, VkPipelineStageFlagBits stage)
+{
+    if (scope == kInvalidScope)
+        return;
+
+    vkCmdWriteTimestamp(cmd, stage, m_queryPool, m_frameIndex * m_maxScopes * 2 + m_maxScopes + scope);
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer cmd, const char *name)
+{
+    uint32_t scope = reserveScope(name);
+    writeBegin(cmd, scope);
+    return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer cmd, uint32_t scope)
+{
+    writeEnd(cmd, scope);
+}
+
+// ============================================================================
+// READBACK
+// ============================================================================
+
+void GpuProfiler::collect(uint32_t frameIndex)
+{
+    // A frame with nothing to read back reports nothing, never the frame before it again
+    m_lastFrame.clear();
+
+    const std::vector<std::string> &names = m_slots[frameIndex].names;
+    if (m_queryPool == VK_NULL_HANDLE || names.empty())
+        return;
+
+    // Value + availability per query. No WAIT_BIT: unavailable queries (never written) come back as 0
+    struct QueryResult
+    {
+        uint64_t ticks;
+        uint64_t available;
+    };
+    const uint32_t scopeCount = static_cast<uint32_t>(names.size());
+    std::vector<QueryResult> begins(scopeCount);
+    std::vector<QueryResult> ends(scopeCount);
+    auto readQueries = [&](uint32_t firstQuery, std::vector<QueryResult> &results)
+    {
+        const VkResult result = vkGetQueryPoolResults(m_device, m_queryPool, firstQuery, scopeCount, results.size() * sizeof(QueryResult),
+                                                      results.data(), sizeof(QueryResult),
+                                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        return result == VK_SUCCESS || result == VK_NOT_READY;
+    };
+    const uint32_t firstQuery = frameIndex * m_maxScopes * 2;
+    if (!readQueries(firstQuery, begins) || !readQueries(firstQuery + m_maxScopes, ends))
+        return;
+
+    struct Span
+    {
+        uint32_t scope;
+        uint64_t begin;
+        uint64_t end;
+    };
+    std::vector<Span> spans;
+    spans.reserve(names.size());
+    for (uint32_t i = 0; i < scopeCount; i++)
+    {
+        const QueryResult &begin = begins[i];
+        const QueryResult &end = ends[i];
+        if (!names[i].empty() && begin.available && end.available && end.ticks >= begin.ticks)
+        {
+            spans.push_back({i, begin.ticks, end.ticks});
+        }
+    }
+    if (spans.empty())
+        return;
+
+    // Outer scopes first when two start together, so containment gives the depth
+    std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b)
+              { return a.begin != b.begin ? a.begin < b.begin : a.end > b.end; });
+
+    const uint64_t origin = spans.front().begin;
+    const double msPerTick = static_cast<double>(m_timestampPeriod) / 1e6;
+
+    std::vector<uint64_t> openEnds;
+    std::map<std::string, float> frameTotals;
+    for (const Span &span : spans)
+    {
+        while (!openEnds.empty() && span.begin >= openEnds.back())
+        {
+            openEnds.pop_back();
+        }
+
+        GpuProfileScope scope;
+        scope.name = names[span.scope];
+        scope.depth = static_cast<uint32_t>(openEnds.size());
+        scope.startMs = static_cast<double>(span.begin - origin) * msPerTick;
+        scope.durationMs = static_cast<double>(span.end - span.begin) * msPerTick;
+        frameTotals[scope.name] += static_cast<float>(scope.durationMs);
+        m_lastFrame.push_back(std::move(scope));
+
+        openEnds.push_back(span.end);
+    }
+
+    for (const auto &total : frameTotals)
+    {
+        m_history[total.first].push(total.second);
+    }
+}
+
+double GpuProfiler::getScopeMs(const std::string &name) const
+{
+    double total = 0.0;
+    for (const GpuProfileScope &scope : m_lastFrame)
+    {
+        if (scope.name == name)
+        {
+            total += scope.durationMs;
+        }
+    }
+    return total;
+}
+
+const GpuProfiler::History *GpuProfiler::getHistory(const std::string &name) const
+{
+    auto it = m_history.find(name);
+    return it != m_history.end() ? &it->second : nullptr;
+}
@@ -0,0 +1,225 @@
+#include "HitchDetector.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    constexpr int kFramesPid = 2; // CpuProfiler's threads are pid 1
+
+    void writeEscaped(std::ostream &out, const char *text)
+    {
+        for (; *text; text++)
+        {
+            if (*text == '"' || *text == '\\')
+                out << '\\';
+            out << *text;
+        }
+    }
+
+    uint64_t msToNs(double ms)
+    {
+        return static_cast<uint64_t>(std::max(ms, 0.0) * 1e6);
+    }
+
+    // Microseconds from 'originNs'; negative for what started before it
+    double traceUs(uint64_t ns, uint64_t originNs)
+    {
+        return static_cast<double>(static_cast<int64_t>(ns - originNs)) / 1000.0;
+    }
+}
+
+HitchDetector::HitchDetector(std::string outputDirectory, double thresholdMs)
+    : m_outputDirectory(std::move(outputDirectory)), m_thresholdMs(thresholdMs), m_frames(kFrames)
+{
+    m_pendingHitches.reserve(kFramesAfter + 1);
+}
+
+void HitchDetector::markEvent(const char *what)
+{
+    m_events[m_eventCount % kEvents] = {what, CpuProfiler::nowNs()};
+    m_eventCount++;
+}
+
+void HitchDetector::addFrame(uint64_t frameNumber, uint64_t completedNs, double intervalMs, double latencyMs,
+                             double cpuMs, const std::vector<GpuProfileScope> &gpuScopes)
+{
+    Frame &frame = m_frames[m_frameCount % kFrames];
+    frame.number = frameNumber;
+    frame.completedNs = completedNs;
+    frame.intervalMs = intervalMs;
+    frame.latencyMs = latencyMs;
+    frame.cpuMs = cpuMs;
+    frame.passCount = 0;
+    for (const GpuProfileScope &scope : gpuScopes)
+    {
+        if (frame.passCount == kMaxPasses)
+            break;
+        Pass &pass = frame.passes[frame.passCount++];
+        const size_t length = std::min<size_t>(scope.name.size(), kNameLength - 1);
+        std::memcpy(pass.name.data(), scope.name.data(), length);
+        pass.name[length] = '\0';
+        pass.depth = scope.depth;
+        pass.startMs = static_cast<float>(scope.startMs);
+        pass.durationMs = static_cast<float>(scope.durationMs);
+    }
+    const uint64_t index = m_frameCount++;
+
+    const bool judged = m_frameCount > kIgnoreFrames && m_suppressFrames == 0;
+    m_suppressFrames = m_suppressFrames > 0 ? m_suppressFrames - 1 : 0;
+
+    bool traceStarted = false;
+    if (judged && intervalMs > m_thresholdMs)
+    {
+        m_hitchCount++;
+        m_worstMs = std::max(m_worstMs, intervalMs);
+
+        std::ostringstream message;
+        message << "[HitchDetector] Frame " << frameNumber << " took " << std::fixed << std::setprecision(1)
+                << intervalMs << " ms";
+        const std::vector<const char *> events = eventsAround(frame);
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            message << (i ? ", " : " after: ") << events[i];
+        }
+        std::cout << message.str() << "\n";
+
+        if (m_traceCount < kMaxTraces)
+        {
+            traceStarted = m_pendingHitches.empty();
+            if (traceStarted)
+            {
+                m_framesUntilTrace = kFramesAfter;
+            }
+            m_pendingHitches.push_back(index);
+        }
+    }
+
+    if (!traceStarted && !m_pendingHitches.empty() && --m_framesUntilTrace == 0)
+    {
+        writeTrace();
+        m_pendingHitches.clear();
+        m_suppressFrames = kSuppressFrames;
+    }
+}
+
+std::vector<const char *> HitchDetector::eventsAround(const Frame &frame) const
+{
+    const uint64_t toNs = frame.completedNs;
+    const uint64_t fromNs = toNs - std::min(toNs, msToNs(frame.intervalMs + frame.latencyMs));
+
+    std::vector<const char *> events;
+    const uint64_t begin = m_eventCount > kEvents ? m_eventCount - kEvents : 0;
+    for (uint64_t i = begin; i < m_eventCount; i++)
+    {
+        const Event &event = m_events[i % kEvents];
+        if (event.ns >= fromNs && event.ns <= toNs &&
+            std::find_if(events.begin(), events.end(), [&](const char *seen)
+                         { return std::strcmp(seen, event.what) == 0; }) == events.end())
+        {
+            events.push_back(event.what);
+        }
+    }
+    return events;
+}
+
+void HitchDetector::writeTrace()
+{
+    const uint64_t frameCount = std::min<uint64_t>(m_frameCount, kFrames);
+    const uint64_t first = m_frameCount - frameCount;
+    const Frame &oldest = frameAt(first);
+    const Frame &newest = frameAt(m_frameCount - 1);
+    const Frame &hitch = frameAt(m_pendingHitches.front());
+    const uint64_t originNs = oldest.completedNs - std::min(oldest.completedNs, msToNs(oldest.latencyMs));
+    const uint64_t endNs = newest.completedNs + 1;
+
+    std::error_code error;
+    std::filesystem::create_directories(m_outputDirectory, error);
+    const std::string filePath = m_outputDirectory + "/hitch_frame" + std::to_string(hitch.number) + ".json";
+    std::ofstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "[HitchDetector] Failed to open file for export: " << filePath << "\n";
+        return;
+    }
+    file << std::fixed << std::setprecision(3);
+
+    // The hitches this trace was written for, and what happened around them
+    file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"thresholdMs\":" << m_thresholdMs << ",\"hitches\":[";
+    for (size_t h = 0; h < m_pendingHitches.size(); h++)
+    {
+        const Frame &frame = frameAt(m_pendingHitches[h]);
+        file << (h ? "," : "") << "{\"frame\":" << frame.number << ",\"intervalMs\":" << frame.intervalMs
+             << ",\"latencyMs\":" << frame.latencyMs << ",\"cpuMs\":" << frame.cpuMs << ",\"events\":[";
+        const std::vector<const char *> events = eventsAround(frame);
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            file << (i ? ",\"" : "\"");
+            writeEscaped(file, events[i]);
+            file << "\"";
+        }
+        file << "]}";
+    }
+    file << "]},\"traceEvents\":[\n";
+
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+         << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << kFramesPid << ",\"args\":{\"name\":\"Frames\"}},\n"
+         << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << kFramesPid << ",\"tid\":1,\"args\":{\"name\":\"Completion intervals\"}},\n"
+         << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << kFramesPid << ",\"tid\":2,\"args\":{\"name\":\"GPU passes (read back)\"}},\n"
+         << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << kFramesPid << ",\"tid\":3,\"args\":{\"name\":\"Events\"}}";
+
+    for (uint64_t i = first; i < m_frameCount; i++)
+    {
+        const Frame &frame = frameAt(i);
+        const bool isHitch = std::find(m_pendingHitches.begin(), m_pendingHitches.end(), i) != m_pendingHitches.end();
+        file << ",\n{\"name\":\"" << (isHitch ? "HITCH " : "") << "Frame " << frame.number
+             << "\",\"ph\":\"X\",\"pid\":" << kFramesPid << ",\"tid\":1"
+             << ",\"ts\":" << traceUs(frame.completedNs - msToNs(frame.intervalMs), originNs)
+             << ",\"dur\":" << frame.intervalMs * 1000.0
+             << ",\"args\":{\"latencyMs\":" << frame.latencyMs << ",\"cpuMs\":" << frame.cpuMs << "}}";
+
+        // The read-back frame ends at this completion
+        double gpuEndMs = 0.0;
+        for (uint32_t p = 0; p < frame.passCount; p++)
+        {
+            gpuEndMs = std::max(gpuEndMs, static_cast<double>(frame.passes[p].startMs + frame.passes[p].durationMs));
+        }
+        const uint64_t gpuStartNs = frame.completedNs - std::min(frame.completedNs, msToNs(gpuEndMs));
+        for (uint32_t p = 0; p < frame.passCount; p++)
+        {
+            const Pass &pass = frame.passes[p];
+            file << ",\n{\"name\":\"";
+            writeEscaped(file, pass.name.data());
+            file << "\",\"ph\":\"X\",\"pid\":" << kFramesPid << ",\"tid\":2"
+                 << ",\"ts\":" << traceUs(gpuStartNs + msToNs(pass.startMs), originNs)
+                 << ",\"dur\":" << pass.durationMs * 1000.0 << "}";
+        }
+    }
+
+    const uint64_t eventBegin = m_eventCount > kEvents ? m_eventCount - kEvents : 0;
+    for (uint64_t i = eventBegin; i < m_eventCount; i++)
+    {
+        const Event &event = m_events[i % kEvents];
+        if (event.ns < originNs || event.ns >= endNs)
+            continue;
+        file << ",\n{\"name\":\"";
+        writeEscaped(file, event.what);
+        file << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":" << kFramesPid << ",\"tid\":3"
+             << ",\"ts\":" << traceUs(event.ns, originNs) << "}";
+    }
+
+    // The capture keeps running: the profiler leaves out zones its threads overwrite while they are copied
+    const size_t zoneCount = CpuProfiler::writeTraceEvents(file, originNs, originNs, endNs);
+    file << "\n]}\n";
+
+    m_traceCount++;
+    m_lastTracePath = filePath;
+    std::cout << "[HitchDetector] Wrote " << frameCount << " frames, " << zoneCount << " CPU zones around "
+              << m_pendingHitches.size() << " hitch(es) to " << filePath << "\n";
+    markEvent("Hitch trace written");
+}
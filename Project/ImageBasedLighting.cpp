@@ -0,0 +1,539 @@
+#include "ImageBasedLighting.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "UploadContext.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+    constexpr char kCacheMagic[4] = {'X', 'I', 'B', 'L'};
+    constexpr VkDeviceSize kTexelBytes = 8; // RGBA16F
+
+    struct CacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t prefilteredSize;
+        uint32_t prefilteredLevels;
+        uint32_t brdfLutSize;
+        uint32_t shCoefficients;
+        uint64_t prefilteredBytes;
+        uint64_t brdfLutBytes;
+    };
+
+    // FNV-1a over the whole file: the sky is read once per run and a few MB hash in milliseconds
+    uint64_t hashFile(const std::string &path)
+    {
+        const std::vector<char> bytes = VkUtils::readFile(path);
+        uint64_t hash = 14695981039346656037ull;
+        for (char byte : bytes)
+        {
+            hash ^= static_cast<uint8_t>(byte);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+ImageBasedLighting::ImageBasedLighting(VkDevice device, VkPhysicalDevice physicalDevice, VkImageView environment,
+                                       uint32_t environmentSize, uint32_t environmentLevels, const std::string &sourcePath)
+    : m_device(device), m_physicalDevice(physicalDevice)
+{
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create IBL sampler!");
+    }
+
+    createResources();
+
+    const std::string cachePath = sourcePath + ".ibl";
+    const uint64_t sourceHash = hashFile(sourcePath);
+    m_cached = loadCache(cachePath, sourceHash);
+    if (m_cached)
+    {
+        std::cout << "[IBL] Loaded " << cachePath << "\n";
+    }
+    else
+    {
+        filter(environment, environmentSize, environmentLevels, cachePath, sourceHash);
+    }
+}
+
+ImageBasedLighting::~ImageBasedLighting()
+{
+    vkDestroyImageView(m_device, m_brdfLutView, nullptr);
+    GpuMemoryAllocator::get().destroyImage(m_brdfLut);
+    vkDestroyImageView(m_device, m_prefilteredView, nullptr);
+    GpuMemoryAllocator::get().destroyImage(m_prefiltered);
+    VkUtils::DestroyBuffer(m_irradiance);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+}
+
+VkShaderModule ImageBasedLighting::loadShader(const char *path) const
+{
+    std::vector<char> code = ShaderRegistry::load(path);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("failed to create shader module: ") + path);
+    }
+    return module;
+}
+
+// ============================================================================
+// RESOURCES
+// ============================================================================
+
+VkDeviceSize ImageBasedLighting::prefilteredBytes()
+{
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = 0; level < kPrefilteredLevels; level++)
+    {
+        const VkDeviceSize size = std::max(kPrefilteredSize >> level, 1u);
+        bytes += 6 * size * size * kTexelBytes;
+    }
+    return bytes;
+}
+
+VkDeviceSize ImageBasedLighting::brdfLutBytes()
+{
+    return static_cast<VkDeviceSize>(kBrdfLutSize) * kBrdfLutSize * kTexelBytes;
+}
+
+std::vector<VkBufferImageCopy> ImageBasedLighting::prefilteredRegions(VkDeviceSize baseOffset)
+{
+    // One region per level covering all six layers, which lie one after another in the buffer
+    std::vector<VkBufferImageCopy> regions(kPrefilteredLevels);
+    VkDeviceSize offset = baseOffset;
+    for (uint32_t level = 0; level < kPrefilteredLevels; level++)
+    {
+        const uint32_t size = std::max(kPrefilteredSize >> level, 1u);
+        regions[level].bufferOffset = offset;
+        regions[level].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 6};
+        regions[level].imageExtent = {size, size, 1};
+        offset += 6ull * size * size * kTexelBytes;
+    }
+    return regions;
+}
+
+void ImageBasedLighting::createResources()
+{
+    // Storage for the filters, transfer for the cache in both directions
+    const VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    auto createImage = [this, usage](uint32_t size, uint32_t mipLevels, uint32_t layers, VkImageCreateFlags flags, VkImage &image)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.flags = flags;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = kFormat;
+        imageInfo.extent = {size, size, 1};
+        imageInfo.mipLevels = mipLevels;
+        imageInfo.arrayLayers = layers;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create IBL image!");
+        }
+        GpuMemoryAllocator::get().allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    };
+
+    createImage(kPrefilteredSize, kPrefilteredLevels, 6, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, m_prefiltered);
+    createImage(kBrdfLutSize, 1, 1, 0, m_brdfLut);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_prefiltered;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+    viewInfo.format = kFormat;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, kPrefilteredLevels, 0, 6};
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_prefilteredView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create IBL prefiltered view!");
+    }
+
+    viewInfo.image = m_brdfLut;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_brdfLutView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create IBL BRDF LUT view!");
+    }
+
+    std::tie(m_irradiance, std::ignore) = VkUtils::CreateBuffer(
+        m_device, m_physicalDevice, getIrradianceSize(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+// ============================================================================
+// CACHE
+// ============================================================================
+
+bool ImageBasedLighting::loadCache(const std::string &cachePath, uint64_t sourceHash)
+{
+    std::ifstream in(cachePath, std::ios::binary);
+    if (!in.is_open())
+    {
+        return false;
+    }
+
+    CacheHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || header.version != kCacheVersion ||
+        header.sourceHash != sourceHash || header.prefilteredSize != kPrefilteredSize ||
+        header.prefilteredLevels != kPrefilteredLevels || header.brdfLutSize != kBrdfLutSize ||
+        header.shCoefficients != kShCoefficients || header.prefilteredBytes != prefilteredBytes() ||
+        header.brdfLutBytes != brdfLutBytes())
+    {
+        std::cout << "[IBL] " << cachePath << " is stale, filtering the sky again\n";
+        return false;
+    }
+
+    std::vector<char> data(static_cast<size_t>(getIrradianceSize() + prefilteredBytes() + brdfLutBytes()));
+    in.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!in)
+    {
+        std::cout << "[IBL] " << cachePath << " is truncated, filtering the sky again\n";
+        return false;
+    }
+
+    const char *sh = data.data();
+    const char *prefiltered = sh + getIrradianceSize();
+    const char *brdfLut = prefiltered + prefilteredBytes();
+
+    UploadContext &upload = UploadContext::get();
+    upload.uploadBuffer(m_irradiance, sh, getIrradianceSize());
+    upload.uploadImage(m_prefiltered, prefiltered, prefilteredBytes(), prefilteredRegions(0), kPrefilteredLevels, 6);
+    upload.transitionToShaderRead(m_prefiltered, kPrefilteredLevels, 6);
+    upload.uploadImage(m_brdfLut, brdfLut, brdfLutBytes(), kBrdfLutSize, kBrdfLutSize);
+    upload.transitionToShaderRead(m_brdfLut, 1);
+    return true;
+}
+
+// ============================================================================
+// FILTERING
+// ============================================================================
+
+void ImageBasedLighting::filter(VkImageView environment, uint32_t environmentSize, uint32_t environmentLevels,
+                                const std::string &cachePath, uint64_t sourceHash)
+{
+    // Bindings: environment, SH buffer, the storage image this dispatch writes.
+    // One set per prefiltered level and one for the LUT; the irradiance pass borrows level 0's.
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    const VkDescriptorType types[3] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                       VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = types[i];
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    VkDescriptorSetLayout setLayout;
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create IBL descriptor set layout!");
+    }
+
+    constexpr uint32_t setCount = kPrefilteredLevels + 1;
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    for (uint32_t i = 0; i < poolSizes.size(); i++)
+    {
+        poolSizes[i] = {types[i], setCount};
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+    VkDescriptorPool descriptorPool;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create IBL descriptor pool!");
+    }
+
+    std::array<VkDescriptorSetLayout, setCount> setLayouts;
+    setLayouts.fill(setLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts = setLayouts.data();
+    std::array<VkDescriptorSet, setCount> sets;
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, sets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate IBL descriptor sets!");
+    }
+
+    // A 2D-array view of each prefiltered level for imageStore, the LUT's own view for the last set
+    std::array<VkImageView, kPrefilteredLevels> levelViews{};
+    for (uint32_t level = 0; level < kPrefilteredLevels; level++)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_prefiltered;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewInfo.format = kFormat;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 6};
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create IBL level view!");
+        }
+    }
+
+    const VkDescriptorImageInfo environmentInfo{m_sampler, environment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    const VkDescriptorBufferInfo shInfo{m_irradiance, 0, getIrradianceSize()};
+    std::array<VkDescriptorImageInfo, setCount> storageInfos{};
+    std::vector<VkWriteDescriptorSet> writes;
+    for (uint32_t i = 0; i < setCount; i++)
+    {
+        storageInfos[i] = {VK_NULL_HANDLE, i < kPrefilteredLevels ? levelViews[i] : m_brdfLutView, VK_IMAGE_LAYOUT_GENERAL};
+        for (uint32_t binding = 0; binding < bindings.size(); binding++)
+        {
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = sets[i];
+            write.dstBinding = binding;
+            write.descriptorCount = 1;
+            write.descriptorType = types[binding];
+            write.pImageInfo = binding == 0 ? &environmentInfo : binding == 2 ? &storageInfos[i] : nullptr;
+            write.pBufferInfo = binding == 1 ? &shInfo : nullptr;
+            writes.push_back(write);
+        }
+    }
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FilterPush)};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create IBL pipeline layout!");
+    }
+
+    auto createPipeline = [this, pipelineLayout](const char *path)
+    {
+        VkShaderModule module = loadShader(path);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = pipelineLayout;
+
+        VkPipeline pipeline;
+        VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &pipeline);
+        vkDestroyShaderModule(m_device, module, nullptr);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to create IBL pipeline: ") + path);
+        }
+        return pipeline;
+    };
+
+    const VkPipeline irradiancePipeline = createPipeline("shaders/ibl_irradiance.comp.spv");
+    const VkPipeline prefilterPipeline = createPipeline("shaders/ibl_prefilter.comp.spv");
+    const VkPipeline brdfLutPipeline = createPipeline("shaders/ibl_brdf_lut.comp.spv");
+
+    // Results come back through one host-visible buffer laid out like the cache file
+    const VkDeviceSize readbackSize = getIrradianceSize() + prefilteredBytes() + brdfLutBytes();
+    auto [readback, readbackMemory] = VkUtils::CreateBuffer(m_device, m_physicalDevice, readbackSize,
+                                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    (void)readbackMemory;
+
+    VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+
+    // The environment's mips were blitted earlier in this batch and left for the fragment stage
+    VkMemoryBarrier environmentBarrier{};
+    environmentBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    environmentBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    std::array<VkImageMemoryBarrier, 2> toGeneral{};
+    for (uint32_t i = 0; i < toGeneral.size(); i++)
+    {
+        toGeneral[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        toGeneral[i].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        toGeneral[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        toGeneral[i].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        toGeneral[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toGeneral[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    }
+    toGeneral[0].image = m_prefiltered;
+    toGeneral[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, kPrefilteredLevels, 0, 6};
+    toGeneral[1].image = m_brdfLut;
+    toGeneral[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &environmentBarrier, 0, nullptr,
+                         static_cast<uint32_t>(toGeneral.size()), toGeneral.data());
+
+    // The pushed lods are whole levels, clamped to the chain the environment has
+    const float topLevel = static_cast<float>(environmentLevels - 1);
+    auto levelFor = [environmentSize, topLevel](uint32_t size)
+    {
+        return std::clamp(std::floor(std::log2(static_cast<float>(environmentSize) / static_cast<float>(size))), 0.0f, topLevel);
+    };
+
+    FilterPush push{};
+    push.environmentSize = static_cast<float>(environmentSize);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, irradiancePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &sets[0], 0, nullptr);
+    push.sourceLod = levelFor(kIrradianceSourceSize);
+    vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FilterPush), &push);
+    vkCmdDispatch(cmd, 1, 1, 1);
+
+    // Level 0 is the mirror: a copy of the environment mip of its resolution, no samples
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, prefilterPipeline);
+    push.sourceLod = levelFor(kPrefilteredSize);
+    for (uint32_t level = 0; level < kPrefilteredLevels; level++)
+    {
+        const uint32_t size = std::max(kPrefilteredSize >> level, 1u);
+        const uint32_t groups = (size + kGroupSize - 1) / kGroupSize;
+        push.roughness = static_cast<float>(level) / static_cast<float>(kPrefilteredLevels - 1);
+        push.sampleCount = level == 0 ? 0 : kSampleCount;
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &sets[level], 0, nullptr);
+        vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FilterPush), &push);
+        vkCmdDispatch(cmd, groups, groups, 6);
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, brdfLutPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &sets[kPrefilteredLevels], 0, nullptr);
+    push.sampleCount = kSampleCount;
+    vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FilterPush), &push);
+    vkCmdDispatch(cmd, kBrdfLutSize / kGroupSize, kBrdfLutSize / kGroupSize, 1);
+
+    // Read back from GENERAL, then hand everything to the scene's fragment shader
+    VkMemoryBarrier computeToTransfer{};
+    computeToTransfer.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    computeToTransfer.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    computeToTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &computeToTransfer, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy shCopy{0, 0, getIrradianceSize()};
+    vkCmdCopyBuffer(cmd, m_irradiance, readback, 1, &shCopy);
+    const std::vector<VkBufferImageCopy> regions = prefilteredRegions(getIrradianceSize());
+    vkCmdCopyImageToBuffer(cmd, m_prefiltered, VK_IMAGE_LAYOUT_GENERAL, readback,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+    VkBufferImageCopy lutRegion{};
+    lutRegion.bufferOffset = getIrradianceSize() + prefilteredBytes();
+    lutRegion.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    lutRegion.imageExtent = {kBrdfLutSize, kBrdfLutSize, 1};
+    vkCmdCopyImageToBuffer(cmd, m_brdfLut, VK_IMAGE_LAYOUT_GENERAL, readback, 1, &lutRegion);
+
+    std::array<VkImageMemoryBarrier, 2> toShaderRead = toGeneral;
+    for (VkImageMemoryBarrier &barrier : toShaderRead)
+    {
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+    VkMemoryBarrier transferToHost{};
+    transferToHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    transferToHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    transferToHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &transferToHost, 0, nullptr, static_cast<uint32_t>(toShaderRead.size()), toShaderRead.data());
+
+    UploadContext::get().flush();
+    std::cout << "[IBL] Filtered the sky (" << kPrefilteredLevels << " prefiltered levels, " << kSampleCount << " samples)\n";
+
+    // Cache: temporary and rename, as the pipeline and mesh caches do
+    CacheHeader header{};
+    std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.sourceHash = sourceHash;
+    header.prefilteredSize = kPrefilteredSize;
+    header.prefilteredLevels = kPrefilteredLevels;
+    header.brdfLutSize = kBrdfLutSize;
+    header.shCoefficients = kShCoefficients;
+    header.prefilteredBytes = prefilteredBytes();
+    header.brdfLutBytes = brdfLutBytes();
+
+    const std::string tempPath = cachePath + ".tmp";
+    bool written = false;
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (out.is_open())
+        {
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(static_cast<const char *>(VkUtils::MapBuffer(readback)), static_cast<std::streamsize>(readbackSize));
+            written = static_cast<bool>(out);
+        }
+    }
+    if (written)
+    {
+        std::remove(cachePath.c_str());
+        written = std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+    }
+    if (!written)
+    {
+        std::cerr << "[IBL] Failed to write " << cachePath << "\n";
+    }
+
+    VkUtils::DestroyBuffer(readback);
+    vkDestroyPipeline(m_device, brdfLutPipeline, nullptr);
+    vkDestroyPipeline(m_device, prefilterPipeline, nullptr);
+    vkDestroyPipeline(m_device, irradiancePipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, pipelineLayout, nullptr);
+    for (VkImageView view : levelViews)
+    {
+        vkDestroyImageView(m_device, view, nullptr);
+    }
+    vkDestroyDescriptorPool(m_device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, setLayout, nullptr);
+}
@@ -0,0 +1,459 @@
+#include "ImageMetrics.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_METRICS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define IMAGE_METRICS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    constexpr int kWindow = 11;
+    constexpr int kRadius = kWindow / 2;
+    constexpr uint32_t kBandRows = 32;  // Output rows per job
+    constexpr size_t kFlushBlocks = 4096; // 16-byte blocks before 32-bit lane sums could overflow
+
+    constexpr float kC1 = 6.5025f;  // (0.01 * 255)^2
+    constexpr float kC2 = 58.5225f; // (0.03 * 255)^2
+
+    const std::array<float, kWindow> &gaussianWeights()
+    {
+        static const std::array<float, kWindow> weights = []
+        {
+            std::array<float, kWindow> w{};
+            float sum = 0.0f;
+            for (int i = 0; i < kWindow; i++)
+            {
+                const float d = static_cast<float>(i - kRadius);
+                w[i] = std::exp(-(d * d) / (2.0f * 1.5f * 1.5f));
+                sum += w[i];
+            }
+            for (float &v : w)
+            {
+                v /= sum;
+            }
+            return w;
+        }();
+        return weights;
+    }
+
+    void forEachBand(JobSystem *jobs, uint32_t bandCount, const std::function<void(uint32_t)> &fn)
+    {
+        if (!jobs || bandCount < 2)
+        {
+            for (uint32_t band = 0; band < bandCount; band++)
+            {
+                fn(band);
+            }
+            return;
+        }
+        jobs->run(bandCount, [&fn](uint32_t band, uint32_t)
+                  { fn(band); });
+    }
+
+    // ========================================================================
+    // BYTE KERNELS
+    // ========================================================================
+
+    uint64_t sumSquaredDifferences(const uint8_t *a, const uint8_t *b, size_t count)
+    {
+        uint64_t total = 0;
+        size_t i = 0;
+#if IMAGE_METRICS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        while (i + 16 <= count)
+        {
+            const size_t end = std::min(count & ~size_t(15), i + kFlushBlocks * 16);
+            __m128i acc = _mm_setzero_si128();
+            for (; i < end; i += 16)
+            {
+                const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+                const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+                const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+                const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+            }
+            alignas(16) uint32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+            total += uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+        }
+#elif IMAGE_METRICS_NEON
+        while (i + 16 <= count)
+        {
+            const size_t end = std::min(count & ~size_t(15), i + kFlushBlocks * 16);
+            uint32x4_t acc = vdupq_n_u32(0);
+            for (; i < end; i += 16)
+            {
+                const uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+                acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(diff), vget_low_u8(diff)));
+                acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(diff), vget_high_u8(diff)));
+            }
+            total += vaddlvq_u32(acc);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            const int d = int(a[i]) - int(b[i]);
+            total += uint64_t(d * d);
+        }
+        return total;
+    }
+
+    uint64_t sumAbsoluteDifferences(const uint8_t *a, const uint8_t *b, size_t count)
+    {
+        uint64_t total = 0;
+        size_t i = 0;
+#if IMAGE_METRICS_SSE2
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+        }
+        alignas(16) uint64_t lanes[2];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+        total += lanes[0] + lanes[1];
+#elif IMAGE_METRICS_NEON
+        while (i + 16 <= count)
+        {
+            const size_t end = std::min(count & ~size_t(15), i + kFlushBlocks * 16);
+            uint32x4_t acc = vdupq_n_u32(0);
+            for (; i < end; i += 16)
+            {
+                acc = vpadalq_u16(acc, vpaddlq_u8(vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i))));
+            }
+            total += vaddlvq_u32(acc);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            total += uint64_t(std::abs(int(a[i]) - int(b[i])));
+        }
+        return total;
+    }
+
+    // Sums a per-row-band byte kernel over the whole image
+    uint64_t reduceBands(const uint8_t *a, const uint8_t *b, uint32_t width, uint32_t height, JobSystem *jobs,
+                         uint64_t (*kernel)(const uint8_t *, const uint8_t *, size_t))
+    {
+        const size_t rowBytes = size_t(width) * 4;
+        const uint32_t bandCount = (height + kBandRows - 1) / kBandRows;
+        std::vector<uint64_t> partials(bandCount, 0);
+        forEachBand(jobs, bandCount, [&](uint32_t band)
+                    {
+            const uint32_t y0 = band * kBandRows;
+            const uint32_t y1 = std::min(height, y0 + kBandRows);
+            const size_t offset = y0 * rowBytes;
+            partials[band] = kernel(a + offset, b + offset, (y1 - y0) * rowBytes); });
+
+        uint64_t total = 0;
+        for (uint64_t partial : partials)
+        {
+            total += partial;
+        }
+        return total;
+    }
+
+    // ========================================================================
+    // FLOAT KERNELS (SSIM)
+    // ========================================================================
+
+    // out[x] = sum_k w[k] * in[x + k]
+    void convolveRow(const float *in, float *out, uint32_t count, const float *w)
+    {
+        uint32_t x = 0;
+#if IMAGE_METRICS_SSE2
+        for (; x + 4 <= count; x += 4)
+        {
+            __m128 acc = _mm_mul_ps(_mm_loadu_ps(in + x), _mm_set1_ps(w[0]));
+            for (int k = 1; k < kWindow; k++)
+            {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in + x + k), _mm_set1_ps(w[k])));
+            }
+            _mm_storeu_ps(out + x, acc);
+        }
+#elif IMAGE_METRICS_NEON
+        for (; x + 4 <= count; x += 4)
+        {
+            float32x4_t acc = vmulq_n_f32(vld1q_f32(in + x), w[0]);
+            for (int k = 1; k < kWindow; k++)
+            {
+                acc = vmlaq_n_f32(acc, vld1q_f32(in + x + k), w[k]);
+            }
+            vst1q_f32(out + x, acc);
+        }
+#endif
+        for (; x < count; x++)
+        {
+            float acc = 0.0f;
+            for (int k = 0; k < kWindow; k++)
+            {
+                acc += in[x + k] * w[k];
+            }
+            out[x] = acc;
+        }
+    }
+
+    // out[x] = sum_k w[k] * in[k * stride + x]
+    void convolveColumn(const float *in, size_t stride, float *out, uint32_t count, const float *w)
+    {
+        uint32_t x = 0;
+#if IMAGE_METRICS_SSE2
+        for (; x + 4 <= count; x += 4)
+        {
+            __m128 acc = _mm_mul_ps(_mm_loadu_ps(in + x), _mm_set1_ps(w[0]));
+            for (int k = 1; k < kWindow; k++)
+            {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in + k * stride + x), _mm_set1_ps(w[k])));
+            }
+            _mm_storeu_ps(out + x, acc);
+        }
+#elif IMAGE_METRICS_NEON
+        for (; x + 4 <= count; x += 4)
+        {
+            float32x4_t acc = vmulq_n_f32(vld1q_f32(in + x), w[0]);
+            for (int k = 1; k < kWindow; k++)
+            {
+                acc = vmlaq_n_f32(acc, vld1q_f32(in + k * stride + x), w[k]);
+            }
+            vst1q_f32(out + x, acc);
+        }
+#endif
+        for (; x < count; x++)
+        {
+            float acc = 0.0f;
+            for (int k = 0; k < kWindow; k++)
+            {
+                acc += in[k * stride + x] * w[k];
+            }
+            out[x] = acc;
+        }
+    }
+
+    float ssimTerm(float mu1, float mu2, float e11, float e22, float e12)
+    {
+        const float mu11 = mu1 * mu1;
+        const float mu22 = mu2 * mu2;
+        const float mu12 = mu1 * mu2;
+        return ((2.0f * mu12 + kC1) * (2.0f * (e12 - mu12) + kC2)) /
+               ((mu11 + mu22 + kC1) * ((e11 - mu11) + (e22 - mu22) + kC2));
+    }
+
+    // Sum of the SSIM map over one row of window means
+    double sumSsimRow(const float *mu1, const float *mu2, const float *e11, const float *e22, const float *e12, uint32_t count)
+    {
+        double total = 0.0;
+        uint32_t x = 0;
+#if IMAGE_METRICS_SSE2
+        const __m128 c1 = _mm_set1_ps(kC1);
+        const __m128 c2 = _mm_set1_ps(kC2);
+        const __m128 two = _mm_set1_ps(2.0f);
+        __m128 acc = _mm_setzero_ps();
+        for (; x + 4 <= count; x += 4)
+        {
+            const __m128 m1 = _mm_loadu_ps(mu1 + x);
+            const __m128 m2 = _mm_loadu_ps(mu2 + x);
+            const __m128 m11 = _mm_mul_ps(m1, m1);
+            const __m128 m22 = _mm_mul_ps(m2, m2);
+            const __m128 m12 = _mm_mul_ps(m1, m2);
+            const __m128 s11 = _mm_sub_ps(_mm_loadu_ps(e11 + x), m11);
+            const __m128 s22 = _mm_sub_ps(_mm_loadu_ps(e22 + x), m22);
+            const __m128 s12 = _mm_sub_ps(_mm_loadu_ps(e12 + x), m12);
+            const __m128 num = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(two, m12), c1), _mm_add_ps(_mm_mul_ps(two, s12), c2));
+            const __m128 den = _mm_mul_ps(_mm_add_ps(_mm_add_ps(m11, m22), c1), _mm_add_ps(_mm_add_ps(s11, s22), c2));
+            acc = _mm_add_ps(acc, _mm_div_ps(num, den));
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, acc);
+        total += double(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#elif IMAGE_METRICS_NEON
+        const float32x4_t c1 = vdupq_n_f32(kC1);
+        const float32x4_t c2 = vdupq_n_f32(kC2);
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (; x + 4 <= count; x += 4)
+        {
+            const float32x4_t m1 = vld1q_f32(mu1 + x);
+            const float32x4_t m2 = vld1q_f32(mu2 + x);
+            const float32x4_t m11 = vmulq_f32(m1, m1);
+            const float32x4_t m22 = vmulq_f32(m2, m2);
+            const float32x4_t m12 = vmulq_f32(m1, m2);
+            const float32x4_t s11 = vsubq_f32(vld1q_f32(e11 + x), m11);
+            const float32x4_t s22 = vsubq_f32(vld1q_f32(e22 + x), m22);
+            const float32x4_t s12 = vsubq_f32(vld1q_f32(e12 + x), m12);
+            const float32x4_t num = vmulq_f32(vmlaq_n_f32(c1, m12, 2.0f), vmlaq_n_f32(c2, s12, 2.0f));
+            const float32x4_t den = vmulq_f32(vaddq_f32(vaddq_f32(m11, m22), c1), vaddq_f32(vaddq_f32(s11, s22), c2));
+            acc = vaddq_f32(acc, vdivq_f32(num, den));
+        }
+        total += vaddvq_f32(acc);
+#endif
+        for (; x < count; x++)
+        {
+            total += ssimTerm(mu1[x], mu2[x], e11[x], e22[x], e12[x]);
+        }
+        return total;
+    }
+
+    void toLuma(const uint8_t *rgba, float *luma, size_t pixelCount)
+    {
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            const uint8_t *p = rgba + i * 4;
+            luma[i] = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+        }
+    }
+
+    double globalSsim(const std::vector<float> &a, const std::vector<float> &b)
+    {
+        const double n = static_cast<double>(a.size());
+        double mean1 = 0.0, mean2 = 0.0;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            mean1 += a[i];
+            mean2 += b[i];
+        }
+        mean1 /= n;
+        mean2 /= n;
+
+        double var1 = 0.0, var2 = 0.0, covar = 0.0;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            const double d1 = a[i] - mean1;
+            const double d2 = b[i] - mean2;
+            var1 += d1 * d1;
+            var2 += d2 * d2;
+            covar += d1 * d2;
+        }
+        var1 /= n;
+        var2 /= n;
+        covar /= n;
+        return ((2 * mean1 * mean2 + kC1) * (2 * covar + kC2)) / ((mean1 * mean1 + mean2 * mean2 + kC1) * (var1 + var2 + kC2));
+    }
+}
+
+namespace ImageMetrics
+{
+    double meanSquaredError(const uint8_t *a, const uint8_t *b, uint32_t width, uint32_t height, JobSystem *jobs)
+    {
+        const size_t count = size_t(width) * height * 4;
+        if (count == 0)
+            return 0.0;
+        return static_cast<double>(reduceBands(a, b, width, height, jobs, sumSquaredDifferences)) / static_cast<double>(count);
+    }
+
+    double meanAbsoluteDifference(const uint8_t *a, const uint8_t *b, uint32_t width, uint32_t height, JobSystem *jobs)
+    {
+        const size_t count = size_t(width) * height * 4;
+        if (count == 0)
+            return 0.0;
+        return static_cast<double>(reduceBands(a, b, width, height, jobs, sumAbsoluteDifferences)) / static_cast<double>(count);
+    }
+
+    double psnrFromMse(double mse)
+    {
+        if (mse < 1e-10)
+            return 100.0; // Perfect match
+        return 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+
+    double ssim(const uint8_t *a, const uint8_t *b, uint32_t width, uint32_t height, JobSystem *jobs)
+    {
+        const size_t pixelCount = size_t(width) * height;
+        if (pixelCount == 0)
+            return 0.0;
+
+        const uint32_t lumaBands = (height + kBandRows - 1) / kBandRows;
+        std::vector<float> luma1(pixelCount), luma2(pixelCount);
+        forEachBand(jobs, lumaBands, [&](uint32_t band)
+                    {
+            const size_t offset = size_t(band) * kBandRows * width;
+            const size_t count = size_t(std::min(height - band * kBandRows, kBandRows)) * width;
+            toLuma(a + offset * 4, luma1.data() + offset, count);
+            toLuma(b + offset * 4, luma2.data() + offset, count); });
+
+        if (width < uint32_t(kWindow) || height < uint32_t(kWindow))
+            return globalSsim(luma1, luma2);
+
+        const uint32_t outWidth = width - (kWindow - 1);
+        const uint32_t outHeight = height - (kWindow - 1);
+        const uint32_t bandCount = (outHeight + kBandRows - 1) / kBandRows;
+        const float *w = gaussianWeights().data();
+        std::vector<double> partials(bandCount, 0.0);
+
+        forEachBand(jobs, bandCount, [&](uint32_t band)
+                    {
+            const uint32_t y0 = band * kBandRows;
+            const uint32_t y1 = std::min(outHeight, y0 + kBandRows);
+            const uint32_t inRows = (y1 - y0) + (kWindow - 1);
+
+            // Horizontally filtered a, b, a*a, b*b, a*b for the band and its halo
+            std::vector<float> filtered(size_t(5) * inRows * outWidth);
+            std::vector<float> products(size_t(3) * width);
+            float *planes[5];
+            for (int p = 0; p < 5; p++)
+            {
+                planes[p] = filtered.data() + size_t(p) * inRows * outWidth;
+            }
+            for (uint32_t r = 0; r < inRows; r++)
+            {
+                const float *row1 = luma1.data() + size_t(y0 + r) * width;
+                const float *row2 = luma2.data() + size_t(y0 + r) * width;
+                float *sq1 = products.data();
+                float *sq2 = sq1 + width;
+                float *cross = sq2 + width;
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    sq1[x] = row1[x] * row1[x];
+                    sq2[x] = row2[x] * row2[x];
+                    cross[x] = row1[x] * row2[x];
+                }
+                const size_t out = size_t(r) * outWidth;
+                convolveRow(row1, planes[0] + out, outWidth, w);
+                convolveRow(row2, planes[1] + out, outWidth, w);
+                convolveRow(sq1, planes[2] + out, outWidth, w);
+                convolveRow(sq2, planes[3] + out, outWidth, w);
+                convolveRow(cross, planes[4] + out, outWidth, w);
+            }
+
+            // Then vertically, one output row at a time
+            std::vector<float> moments(size_t(5) * outWidth);
+            double sum = 0.0;
+            for (uint32_t r = 0; r < y1 - y0; r++)
+            {
+                for (int p = 0; p < 5; p++)
+                {
+                    convolveColumn(planes[p] + size_t(r) * outWidth, outWidth, moments.data() + size_t(p) * outWidth, outWidth, w);
+                }
+                const float *m = moments.data();
+                sum += sumSsimRow(m, m + outWidth, m + 2 * outWidth, m + 3 * outWidth, m + 4 * outWidth, outWidth);
+            }
+            partials[band] = sum; });
+
+        double total = 0.0;
+        for (double partial : partials)
+        {
+            total += partial;
+        }
+        return total / (double(outWidth) * outHeight);
+    }
+
+    const char *simdPath()
+    {
+#if IMAGE_METRICS_SSE2
+        return "SSE2";
+#elif IMAGE_METRICS_NEON
+        return "NEON";
+#else
+        return "Scalar";
+#endif
+    }
+}
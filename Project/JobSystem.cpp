@@ -0,0 +1,303 @@
+#include "JobSystem.h"
+#include "CpuProfiler.h"
+#include "ThreadAffinity.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // Set on the pool's workers only; everything else is thread 0
+    thread_local const JobSystem *t_system = nullptr;
+    thread_local uint32_t t_threadIndex = 0;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    m_queues.reserve(workerCount + 1);
+    for (uint32_t i = 0; i <= workerCount; i++)
+    {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+uint32_t JobSystem::defaultWorkerCount()
+{
+    // A placement file's worker list gives each worker its own core
+    const uint32_t workerCores = ThreadAffinity::getWorkerCoreCount();
+    if (workerCores > 0)
+        return std::min(workerCores, kMaxWorkers);
+
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    if (hardwareThreads <= 1)
+        return 0;
+    return std::min(hardwareThreads - 1, kMaxWorkers);
+}
+
+uint32_t JobSystem::getThreadIndex() const
+{
+    return t_system == this ? t_threadIndex : 0;
+}
+
+// ============================================================================
+// TASKS
+// ============================================================================
+
+void JobSystem::submit(Task task, JobCounter *counter)
+{
+    if (counter)
+    {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    push(getThreadIndex(), {std::move(task), counter});
+}
+
+void JobSystem::submitAfter(JobCounter &dependency, Task task, JobCounter *counter)
+{
+    {
+        std::lock_guard<std::mutex> lock(dependency.m_mutex);
+        if (!dependency.isDone())
+        {
+            if (counter)
+            {
+                counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+            }
+            dependency.m_continuations.emplace_back(std::move(task), counter);
+            return;
+        }
+    }
+    submit(std::move(task), counter);
+}
+
+void JobSystem::push(uint32_t threadIndex, QueuedTask task)
+{
+    // Counted first: a thread finding m_queued raised but the deque still empty only retries
+    m_queued.fetch_add(1, std::memory_order_release);
+    {
+        WorkQueue &queue = *m_queues[threadIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wake.notify_one();
+}
+
+bool JobSystem::take(uint32_t threadIndex, QueuedTask &task)
+{
+    if (m_queued.load(std::memory_order_acquire) == 0)
+        return false;
+
+    {
+        WorkQueue &own = *m_queues[threadIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    const uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+    for (uint32_t offset = 1; offset < queueCount; offset++)
+    {
+        WorkQueue &victim = *m_queues[(threadIndex + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(uint32_t threadIndex, QueuedTask &task)
+{
+    std::exception_ptr error;
+    try
+    {
+        CPU_ZONE("Job");
+        task.task(threadIndex);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    task.task = nullptr; // Captures released before the waiter can return
+
+    if (task.counter)
+    {
+        finish(threadIndex, *task.counter, error);
+    }
+    else if (error)
+    {
+        std::cerr << "[JobSystem] A task nobody waits for threw an exception" << std::endl;
+    }
+}
+
+void JobSystem::finish(uint32_t threadIndex, JobCounter &counter, std::exception_ptr error)
+{
+    std::vector<std::pair<Task, JobCounter *>> continuations;
+    bool drained = false;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        if (error && !counter.m_error)
+        {
+            counter.m_error = error;
+        }
+        drained = counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        if (drained)
+        {
+            continuations.swap(counter.m_continuations);
+        }
+    }
+    if (!drained)
+        return;
+
+    // The counter may be gone from here on; its continuations were counted when they were submitted
+    for (auto &continuation : continuations)
+    {
+        push(threadIndex, {std::move(continuation.first), continuation.second});
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wake.notify_all();
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    CPU_ZONE("JobSystem::wait");
+    const uint32_t threadIndex = getThreadIndex();
+    while (!counter.isDone())
+    {
+        QueuedTask task;
+        if (take(threadIndex, task))
+        {
+            execute(threadIndex, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this, &counter]
+                    { return counter.isDone() || m_queued.load(std::memory_order_acquire) > 0; });
+    }
+
+    // The last task may still hold the counter's lock: take it once before the counter can go away
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        std::swap(error, counter.m_error);
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+// ============================================================================
+// RANGES
+// ============================================================================
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const RangeJob &job)
+{
+    if (count == 0)
+        return;
+
+    const uint32_t threadIndex = getThreadIndex();
+    const uint32_t targetChunks = getThreadCount() * kChunksPerThread;
+    const uint32_t chunk = std::max(std::max(grain, 1u), (count + targetChunks - 1) / targetChunks);
+    if (chunk >= count || m_workers.empty())
+    {
+        job(0, count, threadIndex);
+        return;
+    }
+
+    // The rest is queued for stealing; the caller starts on the first chunk
+    JobCounter counter;
+    for (uint32_t begin = chunk; begin < count; begin += chunk)
+    {
+        const uint32_t end = std::min(begin + chunk, count);
+        submit([&job, begin, end](uint32_t thread)
+               { job(begin, end, thread); },
+               &counter);
+    }
+
+    // Queued chunks reference 'job': they must finish before this returns, even when the first throws
+    std::exception_ptr error;
+    try
+    {
+        CPU_ZONE("Job");
+        job(0, chunk, threadIndex);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    wait(counter);
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::run(uint32_t jobCount, const Job &job)
+{
+    parallelFor(jobCount, 1, [&job](uint32_t begin, uint32_t end, uint32_t threadIndex)
+                {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            job(i, threadIndex);
+        } });
+}
+
+// ============================================================================
+// WORKERS
+// ============================================================================
+
+void JobSystem::workerLoop(uint32_t threadIndex)
+{
+    CPU_THREAD_NAME("Job " + std::to_string(threadIndex));
+    ThreadAffinity::pinCurrentThread(ThreadRole::Worker, threadIndex);
+    t_system = this;
+    t_threadIndex = threadIndex;
+    for (;;)
+    {
+        QueuedTask task;
+        if (take(threadIndex, task))
+        {
+            execute(threadIndex, task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this]
+                    { return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+        if (m_stop && m_queued.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
@@ -0,0 +1,253 @@
+#include "Ktx2.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const uint8_t kIdentifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    struct Header
+    {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "KTX2 header is 80 bytes");
+
+    struct LevelIndex
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    // Khronos Data Format basic descriptor for the block formats write() supports
+    std::vector<uint32_t> basicDescriptor(VkFormat format)
+    {
+        constexpr uint32_t kModelBC7 = 131;
+        constexpr uint32_t kModelBC5 = 132;
+        constexpr uint32_t kPrimariesBT709 = 1;
+        constexpr uint32_t kTransferLinear = 1;
+        constexpr uint32_t kTransferSRGB = 2;
+
+        uint32_t model = 0;
+        uint32_t transfer = kTransferLinear;
+        uint32_t sampleCount = 0;
+        switch (format)
+        {
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            transfer = kTransferSRGB;
+            [[fallthrough]];
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            model = kModelBC7;
+            sampleCount = 1;
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            model = kModelBC5;
+            sampleCount = 2;
+            break;
+        default:
+            return {};
+        }
+
+        const uint32_t blockSize = 24 + 16 * sampleCount;
+        std::vector<uint32_t> words;
+        words.push_back(4 + blockSize);                      // dfdTotalSize
+        words.push_back(0);                                  // vendorId 0 (Khronos), descriptorType 0 (basic)
+        words.push_back(2u | (blockSize << 16));             // versionNumber 2, descriptorBlockSize
+        words.push_back(model | (kPrimariesBT709 << 8) | (transfer << 16)); // flags 0: straight alpha
+        words.push_back(3u | (3u << 8));                     // 4x4x1x1 texel block, stored as dimension - 1
+        words.push_back(16);                                 // bytesPlane0
+        words.push_back(0);                                  // bytesPlane4..7
+
+        // One 128-bit sample for BC7, a 64-bit red then a 64-bit green for BC5
+        const uint32_t sampleBits = 128 / sampleCount;
+        for (uint32_t sample = 0; sample < sampleCount; sample++)
+        {
+            words.push_back((sample * sampleBits) | ((sampleBits - 1) << 16) | (sample << 24)); // offset, length - 1, channel
+            words.push_back(0);          // samplePosition
+            words.push_back(0);          // sampleLower
+            words.push_back(0xFFFFFFFF); // sampleUpper
+        }
+        return words;
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+namespace Ktx2
+{
+    bool read(const std::string &path, Image &image)
+    {
+        auto file = std::make_shared<MappedFile>();
+        if (!file->open(path))
+        {
+            std::cerr << "[KTX2] Failed to open " << path << "\n";
+            return false;
+        }
+        const uint64_t fileSize = file->size();
+        const std::byte *bytes = file->data();
+
+        Header header{};
+        if (fileSize < sizeof(header))
+        {
+            std::cerr << "[KTX2] " << path << " is not a KTX2 file\n";
+            return false;
+        }
+        std::memcpy(&header, bytes, sizeof(header));
+        if (std::memcmp(header.identifier, kIdentifier, sizeof(kIdentifier)) != 0)
+        {
+            std::cerr << "[KTX2] " << path << " is not a KTX2 file\n";
+            return false;
+        }
+        if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 ||
+            header.faceCount != 1 || header.vkFormat == VK_FORMAT_UNDEFINED)
+        {
+            std::cerr << "[KTX2] " << path << ": only uncompressed single 2D images with a Vulkan format are supported\n";
+            return false;
+        }
+
+        const uint32_t levelCount = header.levelCount == 0 ? 1 : header.levelCount; // 0 asks the loader to build mips
+        if (levelCount > (fileSize - sizeof(header)) / sizeof(LevelIndex))
+        {
+            std::cerr << "[KTX2] " << path << ": truncated level index\n";
+            return false;
+        }
+        std::vector<LevelIndex> levelIndex(levelCount);
+        std::memcpy(levelIndex.data(), bytes + sizeof(header), levelIndex.size() * sizeof(LevelIndex));
+
+        // Levels on 16-byte boundaries can be uploaded where they are; otherwise pack them back to back,
+        // largest first, in one allocation
+        uint64_t total = 0;
+        uint64_t first = fileSize;
+        uint64_t last = 0;
+        bool aligned = true;
+        for (const LevelIndex &level : levelIndex)
+        {
+            if (level.byteOffset > fileSize || level.byteLength > fileSize - level.byteOffset)
+            {
+                std::cerr << "[KTX2] " << path << ": level outside the file\n";
+                return false;
+            }
+            total += alignUp(level.byteLength, 16);
+            first = std::min(first, level.byteOffset);
+            last = std::max(last, level.byteOffset + level.byteLength);
+            aligned = aligned && level.byteOffset % 16 == 0;
+        }
+
+        image.format = static_cast<VkFormat>(header.vkFormat);
+        image.width = header.pixelWidth;
+        image.height = header.pixelHeight == 0 ? 1 : header.pixelHeight;
+        image.levels.resize(levelCount);
+        image.data.clear();
+        image.file.reset();
+
+        if (aligned)
+        {
+            for (uint32_t i = 0; i < levelCount; i++)
+            {
+                image.levels[i] = {levelIndex[i].byteOffset - first, levelIndex[i].byteLength};
+            }
+            image.fileOffset = first;
+            image.fileBytes = last - first;
+            image.file = std::move(file);
+            return true;
+        }
+
+        image.data.resize(static_cast<size_t>(total));
+        uint64_t offset = 0;
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            std::memcpy(image.data.data() + offset, bytes + levelIndex[i].byteOffset, static_cast<size_t>(levelIndex[i].byteLength));
+            image.levels[i] = {offset, levelIndex[i].byteLength};
+            offset += alignUp(levelIndex[i].byteLength, 16);
+        }
+        return true;
+    }
+
+    bool write(const std::string &path, const Image &image)
+    {
+        const std::vector<uint32_t> dfd = basicDescriptor(image.format);
+        if (dfd.empty() || image.levels.empty())
+        {
+            std::cerr << "[KTX2] " << path << ": unsupported format for writing\n";
+            return false;
+        }
+
+        const uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+        Header header{};
+        std::memcpy(header.identifier, kIdentifier, sizeof(kIdentifier));
+        header.vkFormat = static_cast<uint32_t>(image.format);
+        header.typeSize = 1;
+        header.pixelWidth = image.width;
+        header.pixelHeight = image.height;
+        header.faceCount = 1;
+        header.levelCount = levelCount;
+        header.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + levelCount * sizeof(LevelIndex));
+        header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+        // Smallest level first, each on a 16-byte boundary (the block size)
+        std::vector<LevelIndex> levelIndex(levelCount);
+        uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+        for (uint32_t i = levelCount; i-- > 0;)
+        {
+            offset = alignUp(offset, 16);
+            levelIndex[i] = {offset, image.levels[i].size, image.levels[i].size};
+            offset += image.levels[i].size;
+        }
+
+        const std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open())
+            {
+                std::cerr << "[KTX2] Failed to open " << tempPath << "\n";
+                return false;
+            }
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(levelIndex.data()), static_cast<std::streamsize>(levelIndex.size() * sizeof(LevelIndex)));
+            out.write(reinterpret_cast<const char *>(dfd.data()), static_cast<std::streamsize>(header.dfdByteLength));
+
+            const char padding[16] = {};
+            uint64_t written = header.dfdByteOffset + header.dfdByteLength;
+            for (uint32_t i = levelCount; i-- > 0;)
+            {
+                out.write(padding, static_cast<std::streamsize>(levelIndex[i].byteOffset - written));
+                out.write(reinterpret_cast<const char *>(image.bytes() + image.levels[i].offset),
+                          static_cast<std::streamsize>(image.levels[i].size));
+                written = levelIndex[i].byteOffset + levelIndex[i].byteLength;
+            }
+            if (!out)
+            {
+                std::cerr << "[KTX2] Failed to write " << tempPath << "\n";
+                return false;
+            }
+        }
+        std::remove(path.c_str());
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            std::cerr << "[KTX2] Failed to replace " << path << "\n";
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,156 @@
+#include "MaterialTable.h"
+#include "BindlessTable.h"
+#include "TextureStreamer.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(sizeof(MaterialTable::GpuMaterial) == 64, "GpuMaterial must match loadMaterial in 3d_shader.frag");
+static_assert(std::tuple_size<decltype(MaterialDescription::maps)>::value == MaterialTable::MapCount, "One path per map");
+
+namespace
+{
+    // Until a map is resident: mid grey, non-metal, a flat normal and a mid specular
+    constexpr uint32_t kPlaceholders[MaterialTable::MapCount] = {0xFF808080, 0xFF000000, 0xFFFF8080, 0xFF808080};
+    constexpr uint32_t kNoTexture = UINT32_MAX;
+}
+
+MaterialTable::MaterialTable(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, BindlessTable &bindless,
+                             TextureStreamer &streamer, VkSampler sampler)
+    : m_bindless(bindless), m_streamer(streamer), m_sampler(sampler), m_frameVersions(framesInFlight, 0)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(16, properties.limits.minStorageBufferOffsetAlignment);
+    m_stride = (sizeof(GpuMaterial) * kMaxMaterials + alignment - 1) & ~(alignment - 1);
+
+    auto [buffer, memory] = VkUtils::CreateBuffer(
+        device, physicalDevice, m_stride * framesInFlight,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_buffer = buffer;
+    m_mapped = static_cast<uint8_t *>(VkUtils::MapBuffer(buffer));
+
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        m_frameSlots.push_back(m_bindless.addBuffer(m_buffer, frame * m_stride, sizeof(GpuMaterial) * kMaxMaterials));
+    }
+}
+
+MaterialTable::~MaterialTable()
+{
+    for (uint32_t slot : m_frameSlots)
+    {
+        m_bindless.removeBuffer(slot);
+    }
+    for (const Texture &texture : m_textures)
+    {
+        m_bindless.removeTexture(texture.slot);
+    }
+    if (m_buffer != VK_NULL_HANDLE)
+    {
+        VkUtils::DestroyBuffer(m_buffer);
+    }
+}
+
+uint32_t MaterialTable::getTexture(const std::string &path, Map map)
+{
+    auto found = m_texturesByPath.find(path);
+    if (found != m_texturesByPath.end())
+    {
+        return found->second;
+    }
+
+    // Normal maps hold vectors: sampled UNORM so the shader's .rg * 2 - 1 is the tangent-space x and y
+    Texture texture{};
+    texture.handle = m_streamer.request(path, kPlaceholders[map],
+                                        map == MapNormal ? TextureCompressor::Kind::TwoChannel : TextureCompressor::Kind::Color);
+    texture.view = m_streamer.getView(texture.handle);
+    texture.slot = m_bindless.addTexture(texture.view, m_sampler);
+    m_textures.push_back(texture);
+    const uint32_t index = static_cast<uint32_t>(m_textures.size() - 1);
+    m_texturesByPath.emplace(path, index);
+    return index;
+}
+
+uint32_t MaterialTable::add(const MaterialDescription &description)
+{
+    auto existing = std::find(m_descriptions.begin(), m_descriptions.end(), description);
+    if (existing != m_descriptions.end())
+    {
+        return static_cast<uint32_t>(existing - m_descriptions.begin());
+    }
+    if (m_materials.size() >= kMaxMaterials)
+    {
+        throw std::runtime_error("MaterialTable is full!");
+    }
+
+    GpuMaterial material{};
+    material.baseColor = glm::vec4(description.baseColor, 1.0f);
+    material.factors = glm::vec4(description.metalness, description.roughness, 0.0f, 0.0f);
+
+    std::array<uint32_t, MapCount> textures;
+    for (uint32_t map = 0; map < MapCount; map++)
+    {
+        textures[map] = kNoTexture;
+        if (description.maps[map].empty())
+        {
+            continue;
+        }
+        textures[map] = getTexture(description.maps[map], static_cast<Map>(map));
+        material.textures[map] = m_textures[textures[map]].slot;
+        material.flags.x |= 1u << map;
+    }
+
+    m_descriptions.push_back(description);
+    m_materials.push_back(material);
+    m_materialTextures.push_back(textures);
+    m_version++;
+    return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+uint32_t MaterialTable::update(uint32_t frameIndex)
+{
+    if (frameIndex >= m_frameSlots.size())
+    {
+        throw std::out_of_range("MaterialTable frame index out of range!");
+    }
+
+    // A promoted level is a new view: it takes a fresh slot, the old one is freed once no frame reads it
+    bool changed = false;
+    for (Texture &texture : m_textures)
+    {
+        const VkImageView view = m_streamer.getView(texture.handle);
+        if (view == texture.view)
+        {
+            continue;
+        }
+        const uint32_t previous = texture.slot;
+        texture.slot = m_bindless.addTexture(view, m_sampler);
+        m_bindless.removeTexture(previous);
+        texture.view = view;
+        changed = true;
+    }
+    if (changed)
+    {
+        for (size_t i = 0; i < m_materials.size(); i++)
+        {
+            for (uint32_t map = 0; map < MapCount; map++)
+            {
+                if (m_materialTextures[i][map] != kNoTexture)
+                {
+                    m_materials[i].textures[map] = m_textures[m_materialTextures[i][map]].slot;
+                }
+            }
+        }
+        m_version++;
+    }
+
+    if (m_frameVersions[frameIndex] != m_version)
+    {
+        memcpy(m_mapped + frameIndex * m_stride, m_materials.data(), m_materials.size() * sizeof(GpuMaterial));
+        m_frameVersions[frameIndex] = m_version;
+    }
+    return m_frameSlots[frameIndex];
+}
@@ -0,0 +1,700 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    // Triangles touching each vertex, CSR style
+    struct Adjacency
+    {
+        std::vector<uint32_t> offsets; // vertexCount + 1
+        std::vector<uint32_t> triangles;
+    };
+
+    Adjacency buildAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount)
+    {
+        Adjacency adjacency;
+        adjacency.offsets.assign(vertexCount + 1, 0);
+        for (uint32_t index : indices)
+        {
+            adjacency.offsets[index + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            adjacency.offsets[v + 1] += adjacency.offsets[v];
+        }
+
+        std::vector<uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        adjacency.triangles.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            adjacency.triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+        return adjacency;
+    }
+
+    // Area-weighted (unnormalised) face normal
+    glm::vec3 faceNormal(const std::vector<Vertex> &vertices, const uint32_t *corners)
+    {
+        const glm::vec3 &p0 = vertices[corners[0]].pos;
+        return glm::cross(vertices[corners[1]].pos - p0, vertices[corners[2]].pos - p0);
+    }
+
+    void computeMeshletBounds(Meshlet &meshlet, const MeshletData &data, const std::vector<Vertex> &vertices)
+    {
+        const uint32_t *meshletVertices = data.vertices.data() + meshlet.vertexOffset;
+        const uint8_t *meshletTriangles = data.triangles.data() + meshlet.triangleOffset;
+
+        glm::vec3 minBound(vertices[meshletVertices[0]].pos);
+        glm::vec3 maxBound(minBound);
+        for (uint32_t i = 1; i < meshlet.vertexCount; i++)
+        {
+            minBound = glm::min(minBound, vertices[meshletVertices[i]].pos);
+            maxBound = glm::max(maxBound, vertices[meshletVertices[i]].pos);
+        }
+        const glm::vec3 center = (minBound + maxBound) * 0.5f;
+        float radius = 0.0f;
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+        {
+            radius = std::max(radius, glm::length(vertices[meshletVertices[i]].pos - center));
+        }
+        meshlet.sphere = glm::vec4(center, radius);
+
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.triangleCount);
+        glm::vec3 axis(0.0f);
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+        {
+            const uint32_t corners[3] = {meshletVertices[meshletTriangles[t * 3 + 0]],
+                                         meshletVertices[meshletTriangles[t * 3 + 1]],
+                                         meshletVertices[meshletTriangles[t * 3 + 2]]};
+            const glm::vec3 normal = faceNormal(vertices, corners);
+            const float area = glm::length(normal);
+            if (area > 0.0f)
+            {
+                normals.push_back(normal / area);
+                axis += normal;
+            }
+        }
+
+        // Never culled unless every normal lies within ~84 degrees of the axis
+        meshlet.coneApex = glm::vec4(center, 1.0f);
+        meshlet.coneAxis = glm::vec4(0.0f);
+        const float axisLength = glm::length(axis);
+        if (normals.empty() || axisLength == 0.0f)
+        {
+            return;
+        }
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (const glm::vec3 &normal : normals)
+        {
+            minDot = std::min(minDot, glm::dot(normal, axis));
+        }
+        if (minDot <= 0.1f)
+        {
+            return;
+        }
+
+        // Move the apex back along the axis until it lies behind every triangle's plane
+        float maxT = 0.0f;
+        for (uint32_t t = 0, n = 0; t < meshlet.triangleCount; t++)
+        {
+            const uint32_t corners[3] = {meshletVertices[meshletTriangles[t * 3 + 0]],
+                                         meshletVertices[meshletTriangles[t * 3 + 1]],
+                                         meshletVertices[meshletTriangles[t * 3 + 2]]};
+            if (glm::length(faceNormal(vertices, corners)) == 0.0f)
+            {
+                continue;
+            }
+            const glm::vec3 &normal = normals[n++];
+            const float distance = glm::dot(center - vertices[corners[0]].pos, normal);
+            maxT = std::max(maxT, distance / glm::dot(axis, normal));
+        }
+
+        meshlet.coneApex = glm::vec4(center - axis * maxT, std::sqrt(1.0f - minDot * minDot));
+        meshlet.coneAxis = glm::vec4(axis, 0.0f);
+    }
+
+    // Sum of squared distances to a set of planes: p'Ap + 2b.p + c, A symmetric
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+
+        // Plane dot(normal, p) + distance = 0, normal unit length
+        static Quadric fromPlane(const glm::vec3 &normal, float distance)
+        {
+            Quadric q;
+            q.a00 = double(normal.x) * normal.x;
+            q.a01 = double(normal.x) * normal.y;
+            q.a02 = double(normal.x) * normal.z;
+            q.a11 = double(normal.y) * normal.y;
+            q.a12 = double(normal.y) * normal.z;
+            q.a22 = double(normal.z) * normal.z;
+            q.b0 = double(normal.x) * distance;
+            q.b1 = double(normal.y) * distance;
+            q.b2 = double(normal.z) * distance;
+            q.c = double(distance) * distance;
+            return q;
+        }
+
+        void add(const Quadric &other)
+        {
+            a00 += other.a00, a01 += other.a01, a02 += other.a02;
+            a11 += other.a11, a12 += other.a12, a22 += other.a22;
+            b0 += other.b0, b1 += other.b1, b2 += other.b2;
+            c += other.c;
+        }
+
+        double evaluate(const glm::vec3 &p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double error = a00 * x * x + a11 * y * y + a22 * z * z +
+                                 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z + b0 * x + b1 * y + b2 * z) + c;
+            return std::max(error, 0.0);
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+}
+
+namespace MeshOptimizer
+{
+    void optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+    {
+        optimizeVertexCache(indices, vertices.size());
+        optimizeOverdraw(indices, vertices);
+        optimizeVertexFetch(vertices, indices);
+    }
+
+    // ============================================================================
+    // VERTEX CACHE (Tipsify)
+    // ============================================================================
+
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0 || vertexCount == 0)
+        {
+            return;
+        }
+
+        const Adjacency adjacency = buildAdjacency(indices, vertexCount);
+        std::vector<uint32_t> liveTriangles(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+        }
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnds; // Recently used vertices to fall back on
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+
+        uint32_t time = kCacheSize + 1;
+        uint32_t cursor = 0; // Next vertex to scan once the dead-end stack is exhausted
+        int64_t fan = 0;
+
+        while (fan >= 0)
+        {
+            candidates.clear();
+            for (uint32_t a = adjacency.offsets[fan]; a < adjacency.offsets[fan + 1]; a++)
+            {
+                const uint32_t triangle = adjacency.triangles[a];
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+                emitted[triangle] = true;
+
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    const uint32_t v = indices[triangle * 3 + corner];
+                    output.push_back(v);
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    liveTriangles[v]--;
+                    if (time - cacheTime[v] > kCacheSize)
+                    {
+                        cacheTime[v] = time++;
+                    }
+                }
+            }
+
+            // Next fan: the candidate that stays in cache longest while its triangles are emitted
+            fan = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t v : candidates)
+            {
+                if (liveTriangles[v] == 0)
+                {
+                    continue;
+                }
+                int64_t priority = 0;
+                if (time - cacheTime[v] + 2 * liveTriangles[v] <= kCacheSize)
+                {
+                    priority = time - cacheTime[v];
+                }
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    fan = v;
+                }
+            }
+
+            if (fan < 0)
+            {
+                while (!deadEnds.empty() && fan < 0)
+                {
+                    const uint32_t v = deadEnds.back();
+                    deadEnds.pop_back();
+                    if (liveTriangles[v] > 0)
+                    {
+                        fan = v;
+                    }
+                }
+                while (fan < 0 && cursor < vertexCount)
+                {
+                    if (liveTriangles[cursor] > 0)
+                    {
+                        fan = cursor;
+                    }
+                    cursor++;
+                }
+            }
+        }
+
+        indices.swap(output);
+    }
+
+    // ============================================================================
+    // OVERDRAW
+    // ============================================================================
+
+    void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+        {
+            return;
+        }
+
+        // Clusters start where a FIFO cache of kCacheSize misses all three corners: reordering
+        // there leaves the cache behaviour inside each cluster as it was
+        std::vector<uint32_t> clusterStarts;
+        std::vector<uint32_t> cacheStamp(vertices.size(), 0);
+        uint32_t time = kCacheSize + 1;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            uint32_t misses = 0;
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                const uint32_t v = indices[t * 3 + corner];
+                if (time - cacheStamp[v] > kCacheSize)
+                {
+                    cacheStamp[v] = time++;
+                    misses++;
+                }
+            }
+            if (t == 0 || misses == 3)
+            {
+                clusterStarts.push_back(static_cast<uint32_t>(t));
+            }
+        }
+        if (clusterStarts.size() < 2)
+        {
+            return;
+        }
+        clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        struct Cluster
+        {
+            uint32_t first;
+            uint32_t count;
+            glm::vec3 centroid;
+            glm::vec3 normal;
+            float sortKey;
+        };
+        std::vector<Cluster> clusters(clusterStarts.size() - 1);
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            Cluster &cluster = clusters[c];
+            cluster.first = clusterStarts[c];
+            cluster.count = clusterStarts[c + 1] - clusterStarts[c];
+            cluster.centroid = glm::vec3(0.0f);
+            cluster.normal = glm::vec3(0.0f);
+
+            float clusterArea = 0.0f;
+            for (uint32_t t = cluster.first; t < cluster.first + cluster.count; t++)
+            {
+                const uint32_t *corners = &indices[t * 3];
+                const glm::vec3 normal = faceNormal(vertices, corners);
+                const float area = glm::length(normal);
+                const glm::vec3 center = (vertices[corners[0]].pos + vertices[corners[1]].pos + vertices[corners[2]].pos) / 3.0f;
+                cluster.centroid += center * area;
+                cluster.normal += normal;
+                clusterArea += area;
+            }
+            meshCentroid += cluster.centroid;
+            meshArea += clusterArea;
+            cluster.centroid = clusterArea > 0.0f ? cluster.centroid / clusterArea : vertices[indices[cluster.first * 3]].pos;
+            const float normalLength = glm::length(cluster.normal);
+            cluster.normal = normalLength > 0.0f ? cluster.normal / normalLength : glm::vec3(0.0f);
+        }
+        if (meshArea <= 0.0f)
+        {
+            return;
+        }
+        meshCentroid /= meshArea;
+
+        // Clusters facing away from the centre are the ones most likely to be in front
+        for (Cluster &cluster : clusters)
+        {
+            cluster.sortKey = glm::dot(cluster.centroid - meshCentroid, cluster.normal);
+        }
+        std::stable_sort(clusters.begin(), clusters.end(),
+                         [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (const Cluster &cluster : clusters)
+        {
+            output.insert(output.end(), indices.begin() + cluster.first * 3,
+                          indices.begin() + (cluster.first + cluster.count) * 3);
+        }
+        indices.swap(output);
+    }
+
+    // ============================================================================
+    // VERTEX FETCH
+    // ============================================================================
+
+    void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+    {
+        constexpr uint32_t kUnused = ~0u;
+        std::vector<uint32_t> remap(vertices.size(), kUnused);
+        std::vector<Vertex> output;
+        output.reserve(vertices.size());
+
+        for (uint32_t &index : indices)
+        {
+            if (remap[index] == kUnused)
+            {
+                remap[index] = static_cast<uint32_t>(output.size());
+                output.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(output);
+    }
+
+    // ============================================================================
+    // MESHLETS
+    // ============================================================================
+
+    MeshletData buildMeshlets(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+    {
+        MeshletData data;
+        if (indices.size() < 3)
+        {
+            return data;
+        }
+
+        // Slot of each vertex in the open meshlet, kUnused outside it
+        constexpr uint8_t kUnused = 0xFF;
+        std::vector<uint8_t> slot(vertices.size(), kUnused);
+        Meshlet current{};
+
+        auto close = [&]()
+        {
+            if (current.triangleCount == 0)
+            {
+                return;
+            }
+            for (uint32_t i = 0; i < current.vertexCount; i++)
+            {
+                slot[data.vertices[current.vertexOffset + i]] = kUnused;
+            }
+            computeMeshletBounds(current, data, vertices);
+            data.meshlets.push_back(current);
+
+            current = Meshlet{};
+            current.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+            current.triangleOffset = static_cast<uint32_t>(data.triangles.size());
+        };
+
+        for (size_t t = 0; t < indices.size() / 3; t++)
+        {
+            const uint32_t *corners = &indices[t * 3];
+            uint32_t newVertices = 0;
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                // A repeated corner of a degenerate triangle only counts once
+                const bool repeated = (corner > 0 && corners[corner] == corners[0]) ||
+                                      (corner > 1 && corners[corner] == corners[1]);
+                newVertices += slot[corners[corner]] == kUnused && !repeated ? 1 : 0;
+            }
+            if (current.vertexCount + newVertices > kMaxMeshletVertices || current.triangleCount >= kMaxMeshletTriangles)
+            {
+                close();
+            }
+
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                const uint32_t v = corners[corner];
+                if (slot[v] == kUnused)
+                {
+                    slot[v] = static_cast<uint8_t>(current.vertexCount++);
+                    data.vertices.push_back(v);
+                }
+                data.triangles.push_back(slot[v]);
+            }
+            current.triangleCount++;
+        }
+        close();
+
+        return data;
+    }
+
+    // ============================================================================
+    // LEVELS OF DETAIL (quadric error edge collapse)
+    // ============================================================================
+
+    std::vector<uint32_t> simplify(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                   size_t targetIndexCount, float &outError)
+    {
+        outError = 0.0f;
+        std::vector<uint32_t> result(indices);
+        const size_t vertexCount = vertices.size();
+        if (result.size() <= targetIndexCount || vertexCount == 0)
+        {
+            return result;
+        }
+
+        // Vertices split along UV/normal seams share a position: weld them to the first one's index
+        std::vector<uint32_t> weld(vertexCount);
+        {
+            std::unordered_map<glm::vec3, uint32_t> positions;
+            positions.reserve(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                weld[v] = positions.emplace(vertices[v].pos, v).first->second;
+            }
+        }
+
+        // Locked, by welded vertex: seams (collapsing one wedge would tear the others off) and open
+        // borders (a directed edge nothing walks back along), so silhouettes and UV layouts hold
+        std::vector<uint8_t> locked(vertexCount, 0);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            if (weld[v] != v)
+            {
+                locked[weld[v]] = 1;
+            }
+        }
+        auto edgeKey = [](uint32_t a, uint32_t b) { return (uint64_t(a) << 32) | b; };
+        std::unordered_set<uint64_t> edges;
+        edges.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                edges.insert(edgeKey(weld[result[i + e]], weld[result[i + (e + 1) % 3]]));
+            }
+        }
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                const uint32_t a = weld[result[i + e]];
+                const uint32_t b = weld[result[i + (e + 1) % 3]];
+                if (!edges.count(edgeKey(b, a)))
+                {
+                    locked[a] = locked[b] = 1;
+                }
+            }
+        }
+
+        // Unweighted plane quadrics, so the error reads as a distance rather than an area
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            glm::vec3 normal = faceNormal(vertices, &result[i]);
+            const float length = glm::length(normal);
+            if (length == 0.0f)
+            {
+                continue;
+            }
+            normal /= length;
+            const Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, vertices[result[i]].pos));
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                quadrics[weld[result[i + corner]]].add(plane);
+            }
+        }
+
+        // Passes of independent collapses: once a vertex moves, its whole ring waits for the next pass
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<uint8_t> touched(vertexCount);
+        std::vector<Collapse> collapses;
+        double maxCost = 0.0;
+        while (result.size() > targetIndexCount)
+        {
+            const Adjacency adjacency = buildAdjacency(result, vertexCount);
+
+            // Either direction of every edge whose source may move; the target keeps its position
+            collapses.clear();
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    const uint32_t a = result[i + e];
+                    const uint32_t b = result[i + (e + 1) % 3];
+                    if (weld[a] == weld[b])
+                    {
+                        continue;
+                    }
+                    for (const auto &[from, to] : {std::pair<uint32_t, uint32_t>(a, b), std::pair<uint32_t, uint32_t>(b, a)})
+                    {
+                        if (locked[weld[from]])
+                        {
+                            continue;
+                        }
+                        Quadric q = quadrics[weld[from]];
+                        q.add(quadrics[weld[to]]);
+                        collapses.push_back({from, to, q.evaluate(vertices[to].pos)});
+                    }
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                remap[v] = v;
+            }
+            std::fill(touched.begin(), touched.end(), uint8_t(0));
+
+            const size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+            size_t removed = 0;
+            size_t applied = 0;
+            for (const Collapse &collapse : collapses)
+            {
+                if (removed >= trianglesToRemove)
+                {
+                    break;
+                }
+                if (touched[collapse.from] || touched[collapse.to])
+                {
+                    continue;
+                }
+
+                // Moving 'from' onto 'to' must not fold any of its triangles over
+                const glm::vec3 &target = vertices[collapse.to].pos;
+                bool flips = false;
+                size_t collapsing = 0;
+                for (uint32_t n = adjacency.offsets[collapse.from]; n < adjacency.offsets[collapse.from + 1] && !flips; n++)
+                {
+                    const uint32_t *corners = &result[adjacency.triangles[n] * 3];
+                    if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+                    {
+                        collapsing++;
+                        continue;
+                    }
+                    glm::vec3 moved[3];
+                    for (uint32_t corner = 0; corner < 3; corner++)
+                    {
+                        moved[corner] = corners[corner] == collapse.from ? target : vertices[corners[corner]].pos;
+                    }
+                    const glm::vec3 before = faceNormal(vertices, corners);
+                    const glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                    flips = glm::dot(before, after) <= 0.0f;
+                }
+                if (flips)
+                {
+                    continue;
+                }
+
+                remap[collapse.from] = collapse.to;
+                quadrics[weld[collapse.to]].add(quadrics[weld[collapse.from]]);
+                maxCost = std::max(maxCost, collapse.cost);
+                removed += collapsing;
+                applied++;
+
+                touched[collapse.from] = touched[collapse.to] = 1;
+                for (uint32_t n = adjacency.offsets[collapse.from]; n < adjacency.offsets[collapse.from + 1]; n++)
+                {
+                    const uint32_t *corners = &result[adjacency.triangles[n] * 3];
+                    touched[corners[0]] = touched[corners[1]] = touched[corners[2]] = 1;
+                }
+            }
+            if (applied == 0)
+            {
+                break;
+            }
+
+            // Triangles that lost a corner to the collapse are dropped
+            size_t write = 0;
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                const uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+                if (a == b || b == c || a == c)
+                {
+                    continue;
+                }
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+            result.resize(write);
+        }
+
+        outError = static_cast<float>(std::sqrt(maxCost));
+        return result;
+    }
+
+    std::vector<MeshLod> buildLodChain(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+    {
+        std::vector<MeshLod> lods;
+        lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+
+        std::vector<uint32_t> level(indices);
+        float error = 0.0f;
+        while (lods.size() < kMaxLods)
+        {
+            const size_t targetIndexCount = level.size() / 6 * 3;
+            if (targetIndexCount < kMinLodTriangles * 3)
+            {
+                break;
+            }
+            float levelError = 0.0f;
+            std::vector<uint32_t> coarser = simplify(vertices, level, targetIndexCount, levelError);
+            // Locked seams and borders can stall the collapse: a level must drop a quarter of the triangles
+            if (coarser.size() > level.size() / 4 * 3)
+            {
+                break;
+            }
+            optimizeVertexCache(coarser, vertices.size());
+
+            // Measured against the previous level, so the deviations from level 0 add up at worst
+            error += levelError;
+            lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(coarser.size()), error});
+            indices.insert(indices.end(), coarser.begin(), coarser.end());
+            level.swap(coarser);
+        }
+        return lods;
+    }
+}
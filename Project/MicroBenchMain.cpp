@@ -0,0 +1,220 @@
+#include "ModelLoader.h"
+#include "DeterministicCameraPath.h"
+#include "ImageMetrics.h"
+#include "JobSystem.h"
+#include "WaterTestingSystem.h"
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include <nanobench.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// CPU micro-benchmarks of the loaders, the procedural meshes, the test camera path and the metrics, without a GPU.
+//   XeMicroBench [--out <json>] [--filter <text>] [--obj <file>]
+// Every benchmark's timings go to one nanobench JSON file, to be kept per commit and compared; the table goes to stdout.
+// The CDLOD selection behind WaterMesh/OceanBottomMesh writes into mapped device memory and is not covered here.
+
+static void printUsage()
+{
+	std::cout << "Usage: XeMicroBench [options]\n"
+		<< "  --out <file>      Results as nanobench JSON (default: test_results/micro_bench.json)\n"
+		<< "  --filter <text>   Run only the benchmarks whose name contains the text\n"
+		<< "  --obj <file>      Mesh for the loadOBJ benchmark (default: a generated 256x256 sphere)\n"
+		<< "  --help            Show this message\n";
+}
+
+// A UV sphere as OBJ text: rows x rows positions and texcoords, two triangles per quad, so every corner
+// but the first repeats and loadOBJ's dedup table does most of the work
+static void writeSphereObj(const std::string &path, uint32_t rows)
+{
+	std::ofstream out(path);
+	if (!out)
+		throw std::runtime_error("failed to write " + path + "!");
+	const float pi = 3.14159265f;
+	for (uint32_t y = 0; y < rows; y++)
+	{
+		for (uint32_t x = 0; x < rows; x++)
+		{
+			const float u = static_cast<float>(x) / (rows - 1);
+			const float v = static_cast<float>(y) / (rows - 1);
+			out << "v " << std::cos(2.0f * pi * u) * std::sin(pi * v) << ' ' << std::cos(pi * v) << ' '
+				<< std::sin(2.0f * pi * u) * std::sin(pi * v) << '\n';
+			out << "vt " << u << ' ' << v << '\n';
+		}
+	}
+	for (uint32_t y = 0; y + 1 < rows; y++)
+	{
+		for (uint32_t x = 0; x + 1 < rows; x++)
+		{
+			const uint32_t a = y * rows + x + 1; // OBJ indices start at 1
+			const uint32_t b = a + 1;
+			const uint32_t c = a + rows;
+			const uint32_t d = c + 1;
+			out << "f " << a << '/' << a << ' ' << c << '/' << c << ' ' << b << '/' << b << '\n';
+			out << "f " << b << '/' << b << ' ' << c << '/' << c << ' ' << d << '/' << d << '\n';
+		}
+	}
+}
+
+// Smooth gradients plus noise, so SSIM sees structure; 'seed' makes the second image differ from the first
+static std::vector<uint8_t> makeImage(uint32_t width, uint32_t height, uint32_t seed)
+{
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> noise(-8, 8);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint8_t *p = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+			p[0] = static_cast<uint8_t>(std::clamp<int>(x * 255 / width + noise(rng), 0, 255));
+			p[1] = static_cast<uint8_t>(std::clamp<int>(y * 255 / height + noise(rng), 0, 255));
+			p[2] = static_cast<uint8_t>(std::clamp<int>(((x ^ y) & 0xFF) + noise(rng), 0, 255));
+			p[3] = 255;
+		}
+	}
+	return pixels;
+}
+
+// A minute of frames around 8 ms with the odd spike, the first 60 warming up
+static std::vector<FrameMetrics> makeFrames(uint32_t count)
+{
+	std::vector<FrameMetrics> frames(count);
+	std::mt19937 rng(7);
+	std::normal_distribution<double> frameTime(8.0, 0.4);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		FrameMetrics &m = frames[i];
+		m.frameIndex = i;
+		m.frameTimeMs = i % 997 == 0 ? 40.0 : frameTime(rng);
+		m.gpuTimeMs = m.frameTimeMs * 0.8;
+		m.cpuTimeMs = m.frameTimeMs * 0.3;
+		m.latencyMs = m.frameTimeMs * 2.0;
+		m.timestampNs = i * 8000000ull;
+		m.isWarmupFrame = i < 60;
+	}
+	return frames;
+}
+
+int main(int argc, char **argv) {
+	std::string outPath = "test_results/micro_bench.json";
+	std::string filter;
+	std::string objPath;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			printUsage();
+			return EXIT_SUCCESS;
+		}
+		else if (arg == "--out" && i + 1 < argc) {
+			outPath = argv[++i];
+		}
+		else if (arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		}
+		else if (arg == "--obj" && i + 1 < argc) {
+			objPath = argv[++i];
+		}
+		else {
+			std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	try {
+		namespace nb = ankerl::nanobench;
+		nb::Bench bench;
+		bench.title("XeRender CPU").warmup(3).minEpochIterations(5).performanceCounters(true);
+		auto run = [&](const std::string &name, auto &&body) {
+			if (filter.empty() || name.find(filter) != std::string::npos)
+				bench.run(name, body);
+		};
+
+		// ---- Loaders and procedural meshes ----
+		if (objPath.empty()) {
+			objPath = (std::filesystem::temp_directory_path() / "xerender_bench_sphere.obj").string();
+			writeSphereObj(objPath, 256);
+		}
+		run("ModelLoader::loadOBJ", [&] {
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			if (!ModelLoader::loadOBJ(objPath, vertices, indices))
+				throw std::runtime_error("failed to load " + objPath + "!");
+			nb::doNotOptimizeAway(indices.data());
+		});
+		run("ModelLoader::generateSphere 36x18", [&] {
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			ModelLoader::generateSphere(vertices, indices, glm::vec3(0.0f), 1.0f);
+			nb::doNotOptimizeAway(indices.data());
+		});
+		run("ModelLoader::generateSphere 256x128", [&] {
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			ModelLoader::generateSphere(vertices, indices, glm::vec3(0.0f), 1.0f, 256, 128);
+			nb::doNotOptimizeAway(indices.data());
+		});
+		run("ModelLoader::generateCube", [&] {
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			ModelLoader::generateCube(vertices, indices, glm::vec3(0.0f), glm::vec3(1.0f));
+			nb::doNotOptimizeAway(indices.data());
+		});
+
+		// ---- Test camera path: a whole 1000-frame run's worth of samples ----
+		const DeterministicCameraPath path = DeterministicCameraPath::createUnderwaterPath();
+		run("DeterministicCameraPath::interpolate x1000", [&] {
+			for (uint32_t frame = 0; frame < 1000; frame++)
+				nb::doNotOptimizeAway(path.interpolate(frame / 999.0f));
+		});
+
+		// ---- Image metrics at 1080p, on one thread and across the job system ----
+		const uint32_t width = 1920;
+		const uint32_t height = 1080;
+		const std::vector<uint8_t> imageA = makeImage(width, height, 1);
+		const std::vector<uint8_t> imageB = makeImage(width, height, 2);
+		JobSystem jobs(JobSystem::defaultWorkerCount());
+		for (JobSystem *pool : {static_cast<JobSystem *>(nullptr), &jobs}) {
+			const std::string suffix = pool ? " 1080p jobs" : " 1080p";
+			run(std::string("ImageMetrics::ssim") + suffix, [&] {
+				nb::doNotOptimizeAway(ImageMetrics::ssim(imageA.data(), imageB.data(), width, height, pool));
+			});
+			run(std::string("ImageMetrics::psnr") + suffix, [&] {
+				nb::doNotOptimizeAway(ImageMetrics::psnrFromMse(ImageMetrics::meanSquaredError(imageA.data(), imageB.data(), width, height, pool)));
+			});
+		}
+
+		// ---- Run statistics over a long run's frames ----
+		const std::vector<FrameMetrics> frames = makeFrames(7200);
+		WaterTestingSystem testing;
+		WaterTestConfig config;
+		config.name = "bench";
+		run("WaterTestingSystem::aggregateMetrics 7200 frames", [&] {
+			nb::doNotOptimizeAway(testing.aggregateMetrics(frames, config).percentile99);
+		});
+
+		std::filesystem::path out(outPath);
+		if (out.has_parent_path())
+			std::filesystem::create_directories(out.parent_path());
+		std::ofstream json(outPath);
+		if (!json)
+			throw std::runtime_error("failed to write " + outPath + "!");
+		nb::render(nb::templates::json(), bench, json);
+		std::cout << "[MicroBench] " << bench.results().size() << " benchmarks (" << ImageMetrics::simdPath()
+			<< " image metrics) written to " << outPath << "\n";
+	}
+	catch (const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
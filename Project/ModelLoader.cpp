@@ -1,17 +1,271 @@
 ﻿#define TINYOBJLOADER_IMPLEMENTATION
 #include "Lib/tiny_obj_loader.h"
 #include "ModelLoader.h"
+#include "CpuProfiler.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
 #include <iostream>
 #include <unordered_map>
 #include <fstream>
+#include <filesystem>
+#include <cstdio>
 #include "Lib/json.hpp"
 #include <stb_image.h>
 #include "VulkanUtil.h"
-#include "stb_image_write.h" // make sure stb_image_write.h is available
+#include "GpuMemoryAllocator.h"
+#include "UploadContext.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <array>
+#include <cmath>
+#include <cstring>
 
 using json = nlohmann::json;
 
+namespace {
+
+// Open-addressing map from an OBJ index tuple to its output vertex. Corners sharing the same
+// position and UV indices are the same vertex, so the key is the index pair rather than the
+// 68-byte Vertex itself; linear probing over a power-of-two table, Fibonacci-hashed.
+class VertexDedupTable {
+public:
+    explicit VertexDedupTable(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        m_keys.assign(capacity, kEmpty);
+        m_values.resize(capacity);
+        m_mask = capacity - 1;
+        while ((size_t(1) << m_shift) < capacity) m_shift++;
+        m_shift = 64 - m_shift;
+    }
+
+    // Returns the slot's value, inserting 'value' when the key is new
+    uint32_t findOrInsert(uint64_t key, uint32_t value, bool& inserted) {
+        size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> m_shift);
+        while (true) {
+            if (m_keys[slot] == kEmpty) {
+                m_keys[slot] = key;
+                m_values[slot] = value;
+                inserted = true;
+                return value;
+            }
+            if (m_keys[slot] == key) {
+                inserted = false;
+                return m_values[slot];
+            }
+            slot = (slot + 1) & m_mask;
+        }
+    }
+
+private:
+    static constexpr uint64_t kEmpty = ~0ull; // vertex_index is never -1, so no real key matches
+
+    std::vector<uint64_t> m_keys;
+    std::vector<uint32_t> m_values;
+    size_t m_mask = 0;
+    uint32_t m_shift = 0;
+};
+
+// ---- .xmesh: header, then the vertices, indices, meshlets, meshlet vertices, meshlet triangles, LODs ----
+constexpr uint32_t kMeshCacheMagic = 0x48534D58; // "XMSH"
+constexpr uint32_t kMeshCacheVersion = 3;        // 2: optimized order and meshlets, 3: LOD chain
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride; // sizeof(Vertex) when written; a layout change invalidates the cache
+    uint32_t lodCount;     // The indices hold every level, finest first
+    uint64_t sourceSize;
+    int64_t sourceTime;    // Source last_write_time, in the file clock's ticks
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t meshletCount;
+    uint32_t meshletVertexCount;
+    uint32_t meshletTriangleBytes;
+    uint32_t meshletStride; // sizeof(Meshlet)
+};
+
+// Sequential reads from a mapped file: each copies straight from the page cache into its destination
+struct MappedReader {
+    const MappedFile& file;
+    size_t offset = 0;
+
+    bool read(void* out, size_t bytes) {
+        if (bytes > file.size() - offset) return false;
+        if (bytes > 0) memcpy(out, file.data() + offset, bytes); // An empty file has no data pointer
+        offset += bytes;
+        return true;
+    }
+
+    bool skip(size_t bytes) {
+        if (bytes > file.size() - offset) return false;
+        offset += bytes;
+        return true;
+    }
+
+    // Checks the length before sizing the array, so a damaged count fails instead of allocating
+    template <typename T>
+    bool readArray(std::vector<T>& values, uint32_t count) {
+        if (static_cast<size_t>(count) > (file.size() - offset) / sizeof(T)) return false;
+        values.resize(count);
+        return read(values.data(), values.size() * sizeof(T));
+    }
+};
+
+template <typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+bool getSourceStamp(const std::string& path, uint64_t& size, int64_t& time) {
+    std::error_code error;
+    size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    return !error;
+}
+
+bool readMeshCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime,
+                   std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, MeshletData* meshlets,
+                   std::vector<MeshLod>& lods) {
+    MappedFile file;
+    if (!file.open(cachePath)) return false;
+    MappedReader in{file};
+
+    MeshCacheHeader header{};
+    if (!in.read(&header, sizeof(header)) || header.magic != kMeshCacheMagic || header.version != kMeshCacheVersion ||
+        header.vertexStride != sizeof(Vertex) || header.meshletStride != sizeof(Meshlet) ||
+        header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+        return false;
+    }
+
+    // Bulk copies from the mapping straight into the output arrays, no parsing and no stream buffer
+    bool ok = in.readArray(vertices, header.vertexCount) && in.readArray(indices, header.indexCount);
+    if (ok && meshlets) {
+        ok = in.readArray(meshlets->meshlets, header.meshletCount) &&
+             in.readArray(meshlets->vertices, header.meshletVertexCount) &&
+             in.readArray(meshlets->triangles, header.meshletTriangleBytes);
+    }
+    else if (ok) {
+        ok = in.skip(static_cast<size_t>(header.meshletCount) * sizeof(Meshlet) +
+                     static_cast<size_t>(header.meshletVertexCount) * sizeof(uint32_t) + header.meshletTriangleBytes);
+    }
+    ok = ok && in.readArray(lods, header.lodCount);
+    if (!ok) {
+        vertices.clear();
+        indices.clear();
+        lods.clear();
+        if (meshlets) *meshlets = MeshletData{};
+        return false;
+    }
+    return true;
+}
+
+void writeMeshCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime,
+                    const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                    const MeshletData& meshlets, const std::vector<MeshLod>& lods) {
+    MeshCacheHeader header{};
+    header.magic = kMeshCacheMagic;
+    header.version = kMeshCacheVersion;
+    header.vertexStride = sizeof(Vertex);
+    header.lodCount = static_cast<uint32_t>(lods.size());
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    header.vertexCount = static_cast<uint32_t>(vertices.size());
+    header.indexCount = static_cast<uint32_t>(indices.size());
+    header.meshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+    header.meshletVertexCount = static_cast<uint32_t>(meshlets.vertices.size());
+    header.meshletTriangleBytes = static_cast<uint32_t>(meshlets.triangles.size());
+    header.meshletStride = sizeof(Meshlet);
+
+    // Temporary and rename, as PipelineCache does, so a crash never leaves a truncated cache
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open mesh cache: " << tempPath << std::endl;
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(out, vertices);
+        writeArray(out, indices);
+        writeArray(out, meshlets.meshlets);
+        writeArray(out, meshlets.vertices);
+        writeArray(out, meshlets.triangles);
+        writeArray(out, lods);
+        if (!out) {
+            std::cerr << "Failed to write mesh cache: " << tempPath << std::endl;
+            return;
+        }
+    }
+    std::remove(cachePath.c_str());
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Failed to replace mesh cache: " << cachePath << std::endl;
+    }
+}
+
+// Blits every face's chain at once (one region covers all six layers), after the copy in the same
+// upload batch, and leaves the whole image in SHADER_READ_ONLY
+void generateCubemapMips(VkPhysicalDevice physicalDevice, VkImage image, uint32_t faceSize, uint32_t mipLevels) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+        throw std::runtime_error("cubemap format does not support linear blitting!");
+    }
+
+    VkCommandBuffer commandBuffer = UploadContext::get().graphicsCommands();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = image;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 6;
+    barrier.subresourceRange.levelCount = 1;
+
+    int32_t size = static_cast<int32_t>(faceSize);
+    for (uint32_t i = 1; i < mipLevels; i++) {
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+
+        const int32_t next = size > 1 ? size / 2 : 1;
+        VkImageBlit blit{};
+        blit.srcOffsets[1] = { size, size, 1 };
+        blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, 6 };
+        blit.dstOffsets[1] = { next, next, 1 };
+        blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 6 };
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit, VK_FILTER_LINEAR);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+        size = next;
+    }
+
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+} // namespace
+
 bool ModelLoader::loadOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    CPU_ZONE("ModelLoader::loadOBJ");
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -22,10 +276,21 @@ bool ModelLoader::loadOBJ(const std::string& filename, std::vector<Vertex>& vert
         return false;
     }
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    size_t cornerCount = 0;
+    for (const auto& shape : shapes) cornerCount += shape.mesh.indices.size();
+
+    VertexDedupTable uniqueVertices(cornerCount);
+    indices.reserve(indices.size() + cornerCount);
 
     for (const auto& shape : shapes) {
         for (const auto& index : shape.mesh.indices) {
+            const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(index.vertex_index)) << 32) |
+                                 static_cast<uint32_t>(index.texcoord_index);
+
+            bool inserted = false;
+            indices.push_back(uniqueVertices.findOrInsert(key, static_cast<uint32_t>(vertices.size()), inserted));
+            if (!inserted) continue;
+
             Vertex vertex{};
             vertex.pos = {
                 attrib.vertices[3 * index.vertex_index + 0],
@@ -33,79 +298,319 @@ bool ModelLoader::loadOBJ(const std::string& filename, std::vector<Vertex>& vert
                 attrib.vertices[3 * index.vertex_index + 2]
             };
 
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
+            if (index.texcoord_index >= 0) {
+                vertex.texCoord = {
+                    attrib.texcoords[2 * index.texcoord_index + 0],
+                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+                };
+            }
 
             vertex.color = { 1.0f, 1.0f, 1.0f };
+            vertices.push_back(vertex);
+        }
+    }
 
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
+    return true;
+}
 
-            indices.push_back(uniqueVertices[vertex]);
-        }
+bool ModelLoader::loadMesh(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                           MeshletData* meshlets, std::vector<MeshLod>* lods) {
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    if (!getSourceStamp(filename, sourceSize, sourceTime)) {
+        return loadOBJ(filename, vertices, indices); // Let tinyobj report the missing file
+    }
+
+    // Callers without a use for the coarser levels only get level 0's indices
+    std::vector<MeshLod> levels;
+    auto output = [&]() {
+        if (lods) *lods = std::move(levels);
+        else if (!levels.empty()) indices.resize(levels[0].indexCount);
+    };
+
+    const std::string cachePath = filename + ".xmesh";
+    if (readMeshCache(cachePath, sourceSize, sourceTime, vertices, indices, meshlets, levels)) {
+        output();
+        return true;
     }
 
+    if (!loadOBJ(filename, vertices, indices)) {
+        return false;
+    }
+    MeshOptimizer::optimize(vertices, indices);
+    MeshletData built = MeshOptimizer::buildMeshlets(vertices, indices);
+    levels = MeshOptimizer::buildLodChain(vertices, indices);
+    writeMeshCache(cachePath, sourceSize, sourceTime, vertices, indices, built, levels);
+    if (meshlets) *meshlets = std::move(built);
+    output();
+    return true;
+}
+
+namespace {
+
+glm::vec3 readVec3(const json& value, const glm::vec3& fallback) {
+    return value.is_array() && value.size() >= 3 ? glm::vec3(value[0], value[1], value[2]) : fallback;
+}
+
+// position, rotation (XYZ Euler, degrees) and scale, applied scale first
+glm::mat4 readPlacement(const json& object) {
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), readVec3(object.value("position", json()), glm::vec3(0.0f)));
+    const glm::vec3 rotation = glm::radians(readVec3(object.value("rotation", json()), glm::vec3(0.0f)));
+    transform = glm::rotate(transform, rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
+    transform = glm::rotate(transform, rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
+    transform = glm::rotate(transform, rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+    return glm::scale(transform, readVec3(object.value("scale", json()), glm::vec3(1.0f)));
+}
+
+// A byte range of the mapped sidecar, {"offset": bytes, "count": elements}, read in place. False when the
+// range does not fit in the file; an empty range may have no data pointer
+bool sidecarRange(const MappedFile& file, const json& range, size_t elementSize, const std::byte*& data, size_t& count) {
+    if (!range.is_object() || !file.isOpen()) return false;
+    const uint64_t offset = range.value("offset", uint64_t(0));
+    const uint64_t elements = range.value("count", uint64_t(0));
+    if (offset > file.size() || elements > (file.size() - offset) / elementSize) return false;
+    count = static_cast<size_t>(elements);
+    data = count > 0 ? file.data() + offset : nullptr;
+    return true;
+}
+
+// Sidecar vertex: position, normal, texCoord
+struct SidecarVertex {
+    float pos[3];
+    float normal[3];
+    float texCoord[2];
+};
+static_assert(sizeof(SidecarVertex) == 32, "Sidecar vertices are 32 bytes");
+
+// Converted straight from the mapping, which every mesh job shares read-only
+bool loadSidecarMesh(const MappedFile& sidecar, const json& definition,
+                     std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    const std::byte* vertexBytes = nullptr;
+    const std::byte* indexBytes = nullptr;
+    size_t vertexCount = 0, indexCount = 0;
+    if (!sidecarRange(sidecar, definition.value("vertices", json()), sizeof(SidecarVertex), vertexBytes, vertexCount) ||
+        !sidecarRange(sidecar, definition.value("indices", json()), sizeof(uint32_t), indexBytes, indexCount)) {
+        return false;
+    }
+
+    vertices.resize(vertexCount);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        SidecarVertex source; // The ranges carry no alignment guarantee
+        memcpy(&source, vertexBytes + i * sizeof(SidecarVertex), sizeof(SidecarVertex));
+        Vertex& vertex = vertices[i];
+        vertex.pos = glm::vec3(source.pos[0], source.pos[1], source.pos[2]);
+        vertex.normal = glm::vec3(source.normal[0], source.normal[1], source.normal[2]);
+        vertex.texCoord = glm::vec2(source.texCoord[0], source.texCoord[1]);
+        vertex.color = glm::vec3(1.0f);
+        vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+        vertex.bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    indices.resize(indexCount);
+    if (indexCount > 0) memcpy(indices.data(), indexBytes, indexCount * sizeof(uint32_t));
+    for (uint32_t index : indices) {
+        if (index >= vertices.size()) return false;
+    }
     return true;
 }
 
-std::vector<SceneObject> ModelLoader::loadSceneFromJson(const std::string& filePath) {
-    std::vector<SceneObject> sceneObjects;
+} // namespace
+
+SceneDescription ModelLoader::loadSceneFromJson(const std::string& filePath, JobSystem* jobSystem) {
+    CPU_ZONE("ModelLoader::loadSceneFromJson");
+    SceneDescription description;
 
     std::ifstream sceneFile(filePath);
     if (!sceneFile.is_open()) {
         std::cerr << "Failed to open scene file: " << filePath << std::endl;
-        return sceneObjects;
+        return description;
     }
 
-    json sceneJson;
-    sceneFile >> sceneJson;
-
-    std::string sceneName = sceneJson["scene"]["name"];
-    //std::cout << "Loading scene: " << sceneName << std::endl;
+    // Mesh definitions by key: the named ones of scene.meshes, plus one per distinct model or
+    // primitive that v1 objects describe inline, so repeated objects still share their geometry
+    std::vector<json> definitions;
+    std::unordered_map<std::string, uint32_t> definitionIndices;
+    auto defineMesh = [&](const std::string& key, json definition) {
+        auto inserted = definitionIndices.emplace(key, static_cast<uint32_t>(definitions.size()));
+        if (inserted.second) definitions.push_back(std::move(definition));
+        return inserted.first->second;
+    };
 
-    for (const auto& object : sceneJson["scene"]["objects"]) {
-        std::string type = object["type"];
+    struct PendingInstance {
+        std::string mesh;           // Key into definitionIndices, resolved once the file is read
+        glm::mat4 transform;
+        uint32_t materialId;
+        json instanceRange;         // Sidecar range of per-instance matrices, or null
+    };
+    std::vector<PendingInstance> pending;
+    std::string sidecarName;
+
+    auto handleObject = [&](const json& object) {
+        const std::string type = object.value("type", std::string());
+        if (type == "skybox") return; // Handled separately
+
+        PendingInstance instance{std::string(), glm::translate(glm::mat4(1.0f), readVec3(object.value("position", json()), glm::vec3(0.0f))),
+                                 object.value("material", 0u), object.value("instances", json())};
+        if (object.contains("mesh")) {
+            instance.mesh = object["mesh"].get<std::string>();
+            instance.transform = readPlacement(object);
+        }
+        else if (type == "sphere") {
+            const float radius = object.value("radius", 1.0f);
+            instance.mesh = "sphere:" + std::to_string(radius);
+            defineMesh(instance.mesh, json{{"type", "sphere"}, {"radius", radius}});
+        }
+        else if (type == "cube") {
+            // v1 bakes the cube's scale into its vertices; kept so old scenes render the same
+            const glm::vec3 scale = readVec3(object.value("scale", json()), glm::vec3(1.0f));
+            instance.mesh = "cube:" + std::to_string(scale.x) + "," + std::to_string(scale.y) + "," + std::to_string(scale.z);
+            defineMesh(instance.mesh, json{{"type", "cube"}, {"scale", {scale.x, scale.y, scale.z}}});
+        }
+        else if (!object.value("model", std::string()).empty()) {
+            instance.mesh = object["model"].get<std::string>();
+            defineMesh(instance.mesh, json{{"model", instance.mesh}});
+            if (object.contains("scale")) {
+                instance.transform = glm::scale(instance.transform, readVec3(object["scale"], glm::vec3(1.0f)));
+            }
+        }
+        else {
+            return;
+        }
+        pending.push_back(std::move(instance));
+    };
 
-        if (type == "skybox") continue; // Skip the skybox, we'll handle it separately
+    auto handleMaterial = [&](const json& entry) {
+        MaterialDescription material;
+        static const char* const mapKeys[MaterialTable::MapCount] = {"base", "metalness", "normal", "specular"};
+        for (uint32_t map = 0; map < MaterialTable::MapCount; ++map) {
+            material.maps[map] = entry.value(mapKeys[map], std::string());
+        }
+        material.baseColor = readVec3(entry.value("color", json()), glm::vec3(1.0f));
+        material.metalness = entry.value("metallic", 0.0f);
+        material.roughness = entry.value("roughness", 1.0f);
+        description.materials.push_back(std::move(material));
+    };
 
-        std::string modelPath = object.contains("model") ? object["model"].get<std::string>() : "";
+    // Streamed: each entry of scene.objects is handled as soon as it is parsed and then dropped
+    // from the document, so a scene with many objects never holds more than one of them as JSON
+    std::string sceneKey;
+    bool inScene = false;
+    json::parser_callback_t callback = [&](int depth, json::parse_event_t event, json& parsed) {
+        if (event == json::parse_event_t::key && depth == 1) {
+            inScene = parsed == "scene";
+        }
+        else if (event == json::parse_event_t::key && depth == 2 && inScene) {
+            sceneKey = parsed.get<std::string>();
+        }
+        else if (event == json::parse_event_t::object_end && depth == 3 && inScene && sceneKey == "objects") {
+            handleObject(parsed);
+            return false;
+        }
+        else if (event == json::parse_event_t::object_end && depth == 3 && inScene && sceneKey == "materials") {
+            handleMaterial(parsed);
+            return false;
+        }
+        else if (event == json::parse_event_t::object_end && depth == 3 && inScene && sceneKey == "meshes") {
+            if (parsed.contains("name")) defineMesh(parsed["name"].get<std::string>(), parsed);
+            return false;
+        }
+        else if (event == json::parse_event_t::value && depth == 2 && inScene && sceneKey == "binary") {
+            sidecarName = parsed.get<std::string>();
+        }
+        return true;
+    };
+    try {
+        json::parse(sceneFile, callback);
+    }
+    catch (const json::exception& e) {
+        std::cerr << "Failed to parse scene file " << filePath << ": " << e.what() << std::endl;
+        return description;
+    }
 
-        SceneObject sceneObject;  // Create a new SceneObject for each item
+    // The sidecar's path is relative to the scene file
+    const std::string sidecarPath = sidecarName.empty()
+        ? std::string()
+        : (std::filesystem::path(filePath).parent_path() / sidecarName).string();
+    // Mapped once for the mesh jobs and the instances alike; ranges are read where they lie
+    MappedFile sidecar;
+    if (!sidecarPath.empty()) sidecar.open(sidecarPath);
+
+    // Every distinct mesh is built once, in parallel; the instances below only refer to them
+    std::vector<uint8_t> built(definitions.size(), 0);
+    description.meshes.resize(definitions.size());
+    auto buildJob = [&](uint32_t jobIndex, uint32_t) {
+        const json& definition = definitions[jobIndex];
+        SceneObject& mesh = description.meshes[jobIndex];
+        const std::string type = definition.value("type", std::string());
+        if (definition.contains("model")) {
+            built[jobIndex] = loadMesh(definition["model"].get<std::string>(), mesh.vertices, mesh.indices, &mesh.meshlets, &mesh.lods);
+            return;
+        }
+        if (type == "sphere") {
+            generateSphere(mesh.vertices, mesh.indices, glm::vec3(0.0f), definition.value("radius", 1.0f));
+        }
+        else if (type == "cube") {
+            generateCube(mesh.vertices, mesh.indices, glm::vec3(0.0f), readVec3(definition.value("scale", json()), glm::vec3(1.0f)));
+        }
+        else if (!loadSidecarMesh(sidecar, definition, mesh.vertices, mesh.indices)) {
+            return;
+        }
+        // Cheap enough to redo on every load, so primitives and sidecar meshes are not cached
+        MeshOptimizer::optimize(mesh.vertices, mesh.indices);
+        mesh.meshlets = MeshOptimizer::buildMeshlets(mesh.vertices, mesh.indices);
+        mesh.lods = MeshOptimizer::buildLodChain(mesh.vertices, mesh.indices);
+        built[jobIndex] = 1;
+    };
+    if (jobSystem) {
+        jobSystem->run(static_cast<uint32_t>(definitions.size()), buildJob);
+    }
+    else {
+        for (uint32_t i = 0; i < definitions.size(); ++i) buildJob(i, 0);
+    }
 
-        if (type == "sphere" || type == "cube") {
-            //std::cout << "Creating primitive: " << type << std::endl;
-            if (type == "sphere") {
-                float radius = object.contains("radius") ? object["radius"].get<float>() : 1.0f; // Default radius
-                glm::vec3 position = object.contains("position")
-                    ? glm::vec3(object["position"][0], object["position"][1], object["position"][2])
-                    : glm::vec3(0.0f, 0.0f, 0.0f); // Default position
-                generateSphere(sceneObject.vertices, sceneObject.indices, position, radius);
-            }
-            else if (type == "cube") {
-                glm::vec3 scale = object.contains("scale")
-                    ? glm::vec3(object["scale"][0], object["scale"][1], object["scale"][2])
-                    : glm::vec3(1.0f, 1.0f, 1.0f); // Default scale
-                glm::vec3 position = object.contains("position")
-                    ? glm::vec3(object["position"][0], object["position"][1], object["position"][2])
-                    : glm::vec3(0.0f, 0.0f, 0.0f); // Default position
-                generateCube(sceneObject.vertices, sceneObject.indices, position, scale);
-            }
+    // Failed meshes are dropped and the indices of the others compacted
+    std::vector<uint32_t> meshRemap(definitions.size(), UINT32_MAX);
+    std::vector<SceneObject> meshes;
+    for (const auto& entry : definitionIndices) {
+        if (!built[entry.second]) {
+            std::cerr << "Failed to load mesh: " << entry.first << std::endl;
         }
-        else if (!modelPath.empty()) {
-            if (!loadOBJ(modelPath, sceneObject.vertices, sceneObject.indices)) {
-                std::cerr << "Failed to load model: " << modelPath << std::endl;
-                continue;
-            }
+    }
+    for (uint32_t i = 0; i < definitions.size(); ++i) {
+        if (!built[i]) continue;
+        meshRemap[i] = static_cast<uint32_t>(meshes.size());
+        meshes.push_back(std::move(description.meshes[i]));
+    }
+    description.meshes = std::move(meshes);
+
+    for (const PendingInstance& instance : pending) {
+        auto found = definitionIndices.find(instance.mesh);
+        if (found == definitionIndices.end()) {
+            std::cerr << "Scene object uses an undefined mesh: " << instance.mesh << std::endl;
+            continue;
         }
+        const uint32_t mesh = meshRemap[found->second];
+        if (mesh == UINT32_MAX) continue;
 
-        sceneObjects.push_back(sceneObject);  // Add the SceneObject to the vector
+        if (instance.instanceRange.is_null()) {
+            description.instances.push_back({mesh, instance.transform, instance.materialId});
+            continue;
+        }
+        // Bulk placements: column-major 4x4 float matrices, each applied inside the object's own
+        const std::byte* matrices = nullptr;
+        size_t count = 0;
+        if (!sidecarRange(sidecar, instance.instanceRange, sizeof(glm::mat4), matrices, count)) {
+            std::cerr << "Failed to read the instances of mesh " << instance.mesh << " from " << sidecarPath << std::endl;
+            continue;
+        }
+        description.instances.reserve(description.instances.size() + count);
+        for (size_t i = 0; i < count; i++) {
+            glm::mat4 placement;
+            memcpy(&placement, matrices + i * sizeof(glm::mat4), sizeof(glm::mat4));
+            description.instances.push_back({mesh, instance.transform * placement, instance.materialId});
+        }
     }
 
-    return sceneObjects;
+    return description;
 }
 
 
@@ -207,12 +712,33 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
     VkQueue graphicsQueue,
     const std::string& path)
 {
-    CubemapTexture cubemap{};
-
     int width, height, channels;
     stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
     if (!pixels) throw std::runtime_error(std::string("Failed to load cubemap image: ") + path);
 
+    try {
+        CubemapTexture cubemap = CreateCubemapFromHorizontalCross(device, physicalDevice, commandPool, graphicsQueue, pixels, width, height, path);
+        stbi_image_free(pixels);
+        return cubemap;
+    }
+    catch (...) {
+        stbi_image_free(pixels);
+        throw;
+    }
+}
+
+CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
+    VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    VkCommandPool commandPool,
+    VkQueue graphicsQueue,
+    const uint8_t* pixels,
+    int width,
+    int height,
+    const std::string& path)
+{
+    CubemapTexture cubemap{};
+
     // Debug print
     std::cout << "CreateCubemapFromHorizontalCross: loaded image " << path << " size = " << width << "x" << height << std::endl;
 
@@ -242,46 +768,26 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
     }
 
     if (layout == Layout::UNKNOWN || faceSize <= 0) {
-        stbi_image_free(pixels);
         throw std::runtime_error("Unsupported cubemap layout or non-square faces. Image size: " + std::to_string(width) + "x" + std::to_string(height));
     }
 
-    // Prepare 6 face buffers (RGBA)
-    std::array<std::vector<uint8_t>, 6> faces;
-    for (auto& f : faces) f.resize(faceSize * faceSize * 4);
-
-    auto copyRect = [&](int srcX, int srcY, std::vector<uint8_t>& dst) {
-        // srcX, srcY specify top-left pixel of face in source image
-        for (int y = 0; y < faceSize; ++y) {
-            uint8_t* srcRow = pixels + ((srcY + y) * width + srcX) * 4;
-            uint8_t* dstRow = dst.data() + y * faceSize * 4;
-            memcpy(dstRow, srcRow, faceSize * 4);
-        }
-        };
-
-    // Map faces in the order [+X, -X, +Y, -Y, +Z, -Z]
+    // Top-left cell of each face in the image, in the order [+X, -X, +Y, -Y, +Z, -Z]
+    std::array<std::pair<int, int>, 6> faceCells;
     if (layout == Layout::H_STRIP) {
         // faces horizontally left->right
         for (int f = 0; f < 6; ++f)
-            copyRect(f * faceSize, 0, faces[f]);
+            faceCells[f] = { f, 0 };
     }
     else if (layout == Layout::V_STRIP) {
         for (int f = 0; f < 6; ++f)
-            copyRect(0, f * faceSize, faces[f]);
+            faceCells[f] = { 0, f };
     }
     else if (layout == Layout::H_CROSS) {
         // Horizontal cross (4x3) layout assumed in this mapping:
         //   [    ][ +Y ][    ][    ]
         //   [ -X ][ +Z ][ +X ][ -Z ]
         //   [    ][ -Y ][    ][    ]
-        // We'll extract faces accordingly. Coordinates are (col, row) * faceSize
-        // +X = (2,1), -X = (0,1), +Y = (1,0), -Y = (1,2), +Z = (1,1), -Z = (3,1)
-        copyRect(2 * faceSize, 1 * faceSize, faces[0]); // +X
-        copyRect(0 * faceSize, 1 * faceSize, faces[1]); // -X
-        copyRect(1 * faceSize, 0 * faceSize, faces[2]); // +Y
-        copyRect(1 * faceSize, 2 * faceSize, faces[3]); // -Y
-        copyRect(1 * faceSize, 1 * faceSize, faces[4]); // +Z
-        copyRect(3 * faceSize, 1 * faceSize, faces[5]); // -Z
+        faceCells = { { { 2, 1 }, { 0, 1 }, { 1, 0 }, { 1, 2 }, { 1, 1 }, { 3, 1 } } };
     }
     else { // V_CROSS
         // Vertical cross (3x4) layout mapping (common arrangement):
@@ -289,40 +795,17 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
         //   [ -X ][ +Z ][ +X ]
         //   [    ][ -Y ][    ]
         //   [    ][ -Z ][    ]
-        // Coordinates: +X=(2,1) ; -X=(0,1) ; +Y=(1,0) ; -Y=(1,2) ; +Z=(1,1) ; -Z=(1,3)
-        copyRect(2 * faceSize, 1 * faceSize, faces[0]); // +X
-        copyRect(0 * faceSize, 1 * faceSize, faces[1]); // -X
-        copyRect(1 * faceSize, 0 * faceSize, faces[2]); // +Y
-        copyRect(1 * faceSize, 2 * faceSize, faces[3]); // -Y
-        copyRect(1 * faceSize, 1 * faceSize, faces[4]); // +Z
-        copyRect(1 * faceSize, 3 * faceSize, faces[5]); // -Z
+        faceCells = { { { 2, 1 }, { 0, 1 }, { 1, 0 }, { 1, 2 }, { 1, 1 }, { 1, 3 } } };
     }
 
-    // Now create staging buffer and upload combined data (face0..face5 contiguous)
-    size_t layerSize = faceSize * faceSize * 4;
-    size_t totalSize = layerSize * 6;
+    // The whole image goes into the upload ring in one copy; each face is then a strided
+    // region of it (bufferRowLength = image width), so no face is ever copied out on the CPU
+    const VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
+    StagingAllocation staging = UploadContext::get().allocateStaging(imageSize);
+    memcpy(staging.mapped, pixels, static_cast<size_t>(imageSize));
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingMemory;
-    {
-        auto bufferPair = VkUtils::CreateBuffer(
-            device,
-            physicalDevice,
-            totalSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        );
-        stagingBuffer = std::get<0>(bufferPair);
-        stagingMemory = std::get<1>(bufferPair);
-    }
-
-    void* dataDst;
-    vkMapMemory(device, stagingMemory, 0, totalSize, 0, &dataDst);
-    uint8_t* dstPtr = reinterpret_cast<uint8_t*>(dataDst);
-    for (int f = 0; f < 6; ++f) {
-        memcpy(dstPtr + f * layerSize, faces[f].data(), layerSize);
-    }
-    vkUnmapMemory(device, stagingMemory);
+    // Full mip chain, blitted on the GPU below
+    const uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(faceSize))) + 1;
 
     // Create cube image with square face size
     VkImageCreateInfo imgInfo{};
@@ -330,11 +813,11 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
     imgInfo.imageType = VK_IMAGE_TYPE_2D;
     imgInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
     imgInfo.extent = { (uint32_t)faceSize, (uint32_t)faceSize, 1 };
-    imgInfo.mipLevels = 1;
+    imgInfo.mipLevels = mipLevels;
     imgInfo.arrayLayers = 6;
     imgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imgInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imgInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imgInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
     imgInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
     imgInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -342,62 +825,17 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
     if (vkCreateImage(device, &imgInfo, nullptr, &cubemap.image) != VK_SUCCESS)
         throw std::runtime_error("Failed to create cubemap image!");
 
-    VkMemoryRequirements memReq{};
-    vkGetImageMemoryRequirements(device, cubemap.image, &memReq);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memReq.size;
-    allocInfo.memoryTypeIndex = VkUtils::findMemoryType(
-        physicalDevice,
-        memReq.memoryTypeBits,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    );
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &cubemap.memory) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate cubemap memory!");
-
-    vkBindImageMemory(device, cubemap.image, cubemap.memory, 0);
-
-    // Command buffer, transition, buffer->image copy (similar to original, but with correct extents)
-    VkCommandBufferAllocateInfo cmdAlloc{};
-    cmdAlloc.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmdAlloc.commandPool = commandPool;
-    cmdAlloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    cmdAlloc.commandBufferCount = 1;
-
-    VkCommandBuffer cmdBuffer;
-    vkAllocateCommandBuffers(device, &cmdAlloc, &cmdBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    vkBeginCommandBuffer(cmdBuffer, &beginInfo);
-
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.image = cubemap.image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 6;
-
-    vkCmdPipelineBarrier(
-        cmdBuffer,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0, 0, nullptr, 0, nullptr, 1, &barrier
-    );
+    cubemap.memory = GpuMemoryAllocator::get().allocateImage(cubemap.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false,
+                                                           GpuMemoryCategory::Texture);
 
+    // All six faces in one copy, recorded into the shared upload batch
     std::vector<VkBufferImageCopy> regions(6);
     for (uint32_t face = 0; face < 6; ++face) {
+        const VkDeviceSize faceX = static_cast<VkDeviceSize>(faceCells[face].first) * faceSize;
+        const VkDeviceSize faceY = static_cast<VkDeviceSize>(faceCells[face].second) * faceSize;
         VkBufferImageCopy region{};
-        region.bufferOffset = (VkDeviceSize)layerSize * face;
-        region.bufferRowLength = 0;
+        region.bufferOffset = staging.offset + (faceY * width + faceX) * 4;
+        region.bufferRowLength = static_cast<uint32_t>(width);
         region.bufferImageHeight = 0;
         region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         region.imageSubresource.mipLevel = 0;
@@ -408,35 +846,10 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
         regions[face] = region;
     }
 
-    vkCmdCopyBufferToImage(cmdBuffer, stagingBuffer, cubemap.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        static_cast<uint32_t>(regions.size()), regions.data());
-
-    // Transition to SHADER_READ_ONLY
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    vkCmdPipelineBarrier(
-        cmdBuffer,
-        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        0, 0, nullptr, 0, nullptr, 1, &barrier
-    );
-
-    vkEndCommandBuffer(cmdBuffer);
-
-    VkSubmitInfo submit{};
-    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit.commandBufferCount = 1;
-    submit.pCommandBuffers = &cmdBuffer;
-
-    vkQueueSubmit(graphicsQueue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
-    vkFreeCommandBuffers(device, commandPool, 1, &cmdBuffer);
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingMemory, nullptr);
-    stbi_image_free(pixels);
+    UploadContext::get().copyBufferToImage(staging.buffer, cubemap.image, regions, mipLevels, 6);
+    generateCubemapMips(physicalDevice, cubemap.image, static_cast<uint32_t>(faceSize), mipLevels);
+    cubemap.size = static_cast<uint32_t>(faceSize);
+    cubemap.mipLevels = mipLevels;
 
     // Create image view (cube)
     VkImageViewCreateInfo viewInfo{};
@@ -446,7 +859,7 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
     viewInfo.image = cubemap.image;
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 6;
 
@@ -469,7 +882,7 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f; // you only have 1 mip; clamp to 0 for safety
+    samplerInfo.maxLod = static_cast<float>(mipLevels);
     samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
 
@@ -478,23 +891,6 @@ CubemapTexture ModelLoader::CreateCubemapFromHorizontalCross(
     }
 
 
-    for (int f = 0; f < 6; ++f) {
-        std::string fname = "debug_sky_face_" + std::to_string(f) + ".png";
-        int writeOk = stbi_write_png(fname.c_str(), faceSize, faceSize, 4, faces[f].data(), faceSize * 4);
-        if (writeOk) {
-            std::cout << "Wrote cubemap face " << f << " -> " << fname << std::endl;
-        }
-        else {
-            std::cerr << "Failed to write cubemap face " << f << std::endl;
-        }
-        // print first pixel RGBA
-        uint8_t r = faces[f][0];
-        uint8_t g = faces[f][1];
-        uint8_t b = faces[f][2];
-        uint8_t a = faces[f][3];
-    }
-
-
     return cubemap;
 }
 
@@ -0,0 +1,69 @@
+#include "Multiview.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+bool Multiview::isSupported(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceMultiviewFeatures multiview{};
+    multiview.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &multiview;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    VkPhysicalDeviceMultiviewProperties limits{};
+    limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &limits;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    return multiview.multiview == VK_TRUE && limits.maxMultiviewViewCount >= kViewCount;
+}
+
+void *Multiview::enableFeatures(VkPhysicalDeviceMultiviewFeatures &features, void *next)
+{
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+    features.multiview = VK_TRUE;
+    features.pNext = next;
+    return &features;
+}
+
+void Multiview::chainRenderPass(VkRenderPassCreateInfo &info, VkRenderPassMultiviewCreateInfo &multiview)
+{
+    // The views are drawn together, so they are likely to be read together: same mask as the graph's (RenderGraph.cpp)
+    multiview = {};
+    multiview.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+    multiview.subpassCount = 1;
+    multiview.pViewMasks = &kViewMask;
+    multiview.correlationMaskCount = 1;
+    multiview.pCorrelationMasks = &kViewMask;
+    multiview.pNext = info.pNext;
+    info.pNext = &multiview;
+}
+
+Multiview::Eyes Multiview::computeEyes(const glm::mat4 &view, float fovY, float aspect, float nearPlane, float farPlane, float separation)
+{
+    Eyes eyes{};
+    const glm::mat4 toWorld = glm::inverse(view);
+    const glm::vec3 centre = glm::vec3(toWorld[3]);
+    const glm::vec3 right = glm::vec3(toWorld[0]);
+
+    // View 0 is the left eye, the left half of the side-by-side output
+    for (uint32_t eye = 0; eye < kViewCount; eye++)
+    {
+        const float offset = (eye == 0 ? -0.5f : 0.5f) * separation;
+        eyes.view[eye] = glm::translate(glm::mat4(1.0f), glm::vec3(-offset, 0.0f, 0.0f)) * view;
+        eyes.position[eye] = centre + right * offset;
+    }
+
+    // Pulled back along the view axis until the outer side planes run through the eyes; the near and
+    // far planes move with it, so the frustum still spans the eyes' depth range
+    const float tanHalfWidth = std::tan(fovY * 0.5f) * aspect;
+    const float pullBack = 0.5f * separation / tanHalfWidth;
+    eyes.cullView = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -pullBack)) * view;
+    eyes.cullProjection = glm::perspective(fovY, aspect, nearPlane + pullBack, farPlane + pullBack);
+    eyes.cullProjection[1][1] *= -1.0f;
+    return eyes;
+}
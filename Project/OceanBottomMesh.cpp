@@ -1,173 +1,64 @@
 #include "OceanBottomMesh.h"
-#include <stdexcept>
+#include <algorithm>
 
 void OceanBottomMesh::create(VkDevice device,
                        VkPhysicalDevice gpu,
-                       VkCommandPool commandPool,
-                       VkQueue graphicsQueue,
-                       int resolution,
+                       uint32_t frameCount,
                        float worldSize,
-                       float depth)
+                       float depth,
+                       uint32_t lodLevels,
+                       const std::string &bathymetryPath)
 {
-    const int N = resolution;
-    const float half = worldSize * 0.5f;
+    // The coarsest bathymetry tile goes out with the UploadContext batch, as does the tile geometry
+    bathymetry = std::make_unique<BathymetryField>(device, gpu, frameCount, bathymetryPath);
 
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    // Survey elevations are absolute, so the grid sits at zero under them
+    const bool surveyed = bathymetry->isLoaded();
+    grid = std::make_unique<CdlodGrid>(device, gpu, frameCount, worldSize, surveyed ? 0.0f : depth,
+                                       surveyed ? std::max(lodLevels, kSurveyLodLevels) : lodLevels);
+}
 
-    vertices.reserve((N + 1) * (N + 1));
+void OceanBottomMesh::destroy(VkDevice device)
+{
+    grid.reset();
+    bathymetry.reset();
+}
 
-    // -------------------------
-    // Generate vertices for ocean bottom plane
-    // -------------------------
-    for (int y = 0; y <= N; y++)
+void OceanBottomMesh::update(uint32_t frameIndex, const glm::vec3 &cameraPos, float viewDistance)
+{
+    if (grid)
     {
-        for (int x = 0; x <= N; x++)
-        {
-            float px = ((float)x / N) * worldSize - half;
-            float pz = ((float)y / N) * worldSize - half;
-
-            Vertex v{};
-            v.pos = {px, depth, pz}; // Ocean bottom at specified depth
-            v.normal = {0.0f, 1.0f, 0.0f}; // Normal pointing up
-            v.texCoord = {x / float(N), y / float(N)};
-            v.color = {0.2f, 0.3f, 0.4f}; // Dark blue-gray color for ocean bottom
-            v.tangent = {1.0f, 0.0f, 0.0f};
-            v.bitangent = {0.0f, 0.0f, 1.0f};
-
-            vertices.push_back(v);
-        }
+        grid->select(frameIndex, cameraPos, viewDistance);
     }
-
-    // -------------------------
-    // Generate indices (reverse winding order since we're looking from below)
-    // -------------------------
-    for (int y = 0; y < N; y++)
+    if (bathymetry)
     {
-        for (int x = 0; x < N; x++)
-        {
-            uint32_t i0 = y * (N + 1) + x;
-            uint32_t i1 = i0 + 1;
-            uint32_t i2 = i0 + (N + 1);
-            uint32_t i3 = i2 + 1;
-
-            // Reverse winding for bottom-up view
-            indices.push_back(i0);
-            indices.push_back(i1);
-            indices.push_back(i2);
-
-            indices.push_back(i1);
-            indices.push_back(i3);
-            indices.push_back(i2);
-        }
+        bathymetry->update(cameraPos);
     }
-
-    indexCount = indices.size();
-
-    // =============================================================
-    // CREATE VERTEX BUFFER (WITH STAGING)
-    // =============================================================
-
-    VkDeviceSize vertexSize = vertices.size() * sizeof(Vertex);
-
-    // Create staging buffer
-    auto [stagingVB, stagingVBMem] = VkUtils::CreateBuffer(
-        device, gpu, vertexSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    // Upload data
-    void *data = nullptr;
-    vkMapMemory(device, stagingVBMem, 0, vertexSize, 0, &data);
-    memcpy(data, vertices.data(), vertexSize);
-    vkUnmapMemory(device, stagingVBMem);
-
-    // Create actual GPU buffer
-    auto [vb, vbMem] = VkUtils::CreateBuffer(
-        device, gpu, vertexSize,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    vertexBuffer = vb;
-    vertexMemory = vbMem;
-
-    // Copy Staging → GPU
-    VkUtils::CopyBuffer(stagingVB, vertexBuffer, vertexSize, device, commandPool, graphicsQueue);
-
-    // Clean up staging
-    vkDestroyBuffer(device, stagingVB, nullptr);
-    vkFreeMemory(device, stagingVBMem, nullptr);
-
-    // =============================================================
-    // CREATE INDEX BUFFER (WITH STAGING)
-    // =============================================================
-
-    VkDeviceSize indexSize = indices.size() * sizeof(uint32_t);
-
-    auto [stagingIB, stagingIBMem] = VkUtils::CreateBuffer(
-        device, gpu, indexSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    vkMapMemory(device, stagingIBMem, 0, indexSize, 0, &data);
-    memcpy(data, indices.data(), indexSize);
-    vkUnmapMemory(device, stagingIBMem);
-
-    auto [ib, ibMem] = VkUtils::CreateBuffer(
-        device, gpu, indexSize,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    indexBuffer = ib;
-    indexMemory = ibMem;
-
-    VkUtils::CopyBuffer(stagingIB, indexBuffer, indexSize, device, commandPool, graphicsQueue);
-
-    vkDestroyBuffer(device, stagingIB, nullptr);
-    vkFreeMemory(device, stagingIBMem, nullptr);
 }
 
-void OceanBottomMesh::destroy(VkDevice device)
+void OceanBottomMesh::writeDescriptors(VkDescriptorSet waterSet) const
 {
-    if (vertexBuffer != VK_NULL_HANDLE)
+    if (bathymetry)
     {
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vertexBuffer = VK_NULL_HANDLE;
-    }
-    if (vertexMemory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(device, vertexMemory, nullptr);
-        vertexMemory = VK_NULL_HANDLE;
+        bathymetry->writeDescriptors(waterSet);
     }
+}
 
-    if (indexBuffer != VK_NULL_HANDLE)
-    {
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        indexBuffer = VK_NULL_HANDLE;
-    }
-    if (indexMemory != VK_NULL_HANDLE)
+void OceanBottomMesh::recordPageUpload(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+    if (bathymetry)
     {
-        vkFreeMemory(device, indexMemory, nullptr);
-        indexMemory = VK_NULL_HANDLE;
+        bathymetry->recordPageUpload(cmd, frameIndex);
     }
-
-    indexCount = 0;
 }
 
-void OceanBottomMesh::draw(VkCommandBuffer cmd)
+void OceanBottomMesh::draw(VkCommandBuffer cmd, uint32_t frameIndex)
 {
-    // Guard against drawing when buffers are not valid
-    if (vertexBuffer == VK_NULL_HANDLE || indexBuffer == VK_NULL_HANDLE || indexCount == 0)
+    // Guard against drawing when the grid is not created
+    if (!grid)
     {
         return;
     }
 
-    VkBuffer buffers[] = {vertexBuffer};
-    VkDeviceSize offsets[] = {0};
-
-    vkCmdBindVertexBuffers(cmd, 0, 1, buffers, offsets);
-    vkCmdBindIndexBuffer(cmd, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed(cmd, indexCount, 1, 0, 0, 0);
+    grid->draw(cmd, frameIndex);
 }
-
-
@@ -0,0 +1,508 @@
+#include "OceanFFT.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "UploadContext.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr float kGravity = 9.81f;
+    constexpr float kTwoPi = 6.28318530718f;
+
+    constexpr uint32_t kLog2Size = 8; // log2(OceanFFT::kSize)
+    static_assert((1u << kLog2Size) == OceanFFT::kSize, "kLog2Size must match kSize");
+
+    // Everything the simulation touches, for the barriers that open and close it
+    constexpr VkPipelineStageFlags kSimulationStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    constexpr VkPipelineStageFlags kWaterStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+    void memoryBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+OceanFFT::OceanFFT(VkDevice device, std::vector<uint32_t> queueFamilies)
+    : OceanFFT(device, Spectrum{}, std::move(queueFamilies))
+{
+}
+
+OceanFFT::OceanFFT(VkDevice device, const Spectrum &spectrum, std::vector<uint32_t> queueFamilies)
+    : m_device(device), m_queueFamilies(std::move(queueFamilies))
+{
+    m_mipLevels = kLog2Size + 1;
+
+    // The spectrum is only fetched (texelFetch)
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_spectrumSampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create ocean spectrum sampler!");
+    }
+
+    // The maps tile across the whole water plane
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_mapSampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create ocean map sampler!");
+    }
+
+    createPipelines();
+    createImages(spectrum);
+    writeSet();
+}
+
+OceanFFT::~OceanFFT()
+{
+    for (Map &map : m_maps)
+    {
+        vkDestroyImageView(m_device, map.storageView, nullptr);
+        vkDestroyImageView(m_device, map.sampledView, nullptr);
+        GpuMemoryAllocator::get().destroyImage(map.image);
+    }
+    for (uint32_t i = 0; i < m_fields.size(); i++)
+    {
+        vkDestroyImageView(m_device, m_fieldViews[i], nullptr);
+        GpuMemoryAllocator::get().destroyImage(m_fields[i]);
+    }
+    vkDestroyImageView(m_device, m_initialSpectrumView, nullptr);
+    GpuMemoryAllocator::get().destroyImage(m_initialSpectrum);
+
+    vkDestroyPipeline(m_device, m_combinePipeline, nullptr);
+    vkDestroyPipeline(m_device, m_fftPipeline, nullptr);
+    vkDestroyPipeline(m_device, m_spectrumPipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkDestroySampler(m_device, m_mapSampler, nullptr);
+    vkDestroySampler(m_device, m_spectrumSampler, nullptr);
+}
+
+VkShaderModule OceanFFT::loadShader(const char *path) const
+{
+    std::vector<char> code = ShaderRegistry::load(path);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("failed to create shader module: ") + path);
+    }
+    return module;
+}
+
+// ============================================================================
+// PIPELINES
+// ============================================================================
+
+void OceanFFT::createPipelines()
+{
+    // One set for the three stages, each declares what it uses:
+    // initial spectrum, the two spectrum fields, displacement map, normal/foam map
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create ocean descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create ocean descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate ocean descriptor set!");
+    }
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationPush)};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create ocean pipeline layout!");
+    }
+
+    auto createPipeline = [this](const char *path, VkPipeline &pipeline)
+    {
+        VkShaderModule module = loadShader(path);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_pipelineLayout;
+
+        VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &pipeline);
+        vkDestroyShaderModule(m_device, module, nullptr);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to create ocean pipeline: ") + path);
+        }
+    };
+
+    createPipeline("shaders/ocean_spectrum.comp.spv", m_spectrumPipeline);
+    createPipeline("shaders/ocean_fft.comp.spv", m_fftPipeline);
+    createPipeline("shaders/ocean_combine.comp.spv", m_combinePipeline);
+}
+
+// ============================================================================
+// IMAGES
+// ============================================================================
+
+void OceanFFT::createImages(const Spectrum &spectrum)
+{
+    auto createImage = [this](VkFormat format, uint32_t mipLevels, VkImageUsageFlags usage, VkImage &image)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = {kSize, kSize, 1};
+        imageInfo.mipLevels = mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        VkUtils::SetImageSharing(imageInfo, m_queueFamilies);
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create ocean image!");
+        }
+        GpuMemoryAllocator::get().allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    };
+
+    auto createView = [this](VkImage image, VkFormat format, uint32_t mipLevels)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1};
+
+        VkImageView view;
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create ocean image view!");
+        }
+        return view;
+    };
+
+    createImage(VK_FORMAT_R32G32B32A32_SFLOAT, 1, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, m_initialSpectrum);
+    m_initialSpectrumView = createView(m_initialSpectrum, VK_FORMAT_R32G32B32A32_SFLOAT, 1);
+
+    for (uint32_t i = 0; i < m_fields.size(); i++)
+    {
+        createImage(VK_FORMAT_R32G32B32A32_SFLOAT, 1, VK_IMAGE_USAGE_STORAGE_BIT, m_fields[i]);
+        m_fieldViews[i] = createView(m_fields[i], VK_FORMAT_R32G32B32A32_SFLOAT, 1);
+    }
+
+    for (Map &map : m_maps)
+    {
+        createImage(kMapFormat, m_mipLevels,
+                    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                    map.image);
+        map.sampledView = createView(map.image, kMapFormat, m_mipLevels);
+        map.storageView = createView(map.image, kMapFormat, 1);
+    }
+
+    // Phillips spectrum: P(k) = A exp(-1 / (k Lw)^2) / k^4 |k.w|^2, waves far shorter than Lw damped.
+    // Scaled by dk so A does not depend on the grid size or the patch size.
+    const float largestWave = spectrum.windSpeed * spectrum.windSpeed / kGravity;
+    const float smallestWave = largestWave * 0.001f;
+    const glm::vec2 wind = glm::normalize(spectrum.windDirection);
+    const float dk = kTwoPi / kPatchSize;
+
+    std::mt19937 rng(spectrum.seed);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+    std::vector<glm::vec2> h0(kSize * kSize);
+    for (uint32_t m = 0; m < kSize; m++)
+    {
+        for (uint32_t n = 0; n < kSize; n++)
+        {
+            const glm::vec2 k = dk * glm::vec2(static_cast<float>(n) - kSize * 0.5f, static_cast<float>(m) - kSize * 0.5f);
+            const float kLength = glm::length(k);
+
+            float phillips = 0.0f;
+            if (kLength > 1e-6f)
+            {
+                const float alignment = glm::dot(k / kLength, wind);
+                const float k2 = kLength * kLength;
+                phillips = spectrum.amplitude * std::exp(-1.0f / (k2 * largestWave * largestWave)) / (k2 * k2) *
+                           alignment * alignment * std::exp(-k2 * smallestWave * smallestWave);
+            }
+
+            const glm::vec2 xi(gaussian(rng), gaussian(rng));
+            h0[m * kSize + n] = xi * std::sqrt(phillips * 0.5f) * dk;
+        }
+    }
+
+    // zw = conj(h0(-k)); -k wraps onto the grid, which keeps every spectrum Hermitian
+    std::vector<glm::vec4> texels(kSize * kSize);
+    for (uint32_t m = 0; m < kSize; m++)
+    {
+        for (uint32_t n = 0; n < kSize; n++)
+        {
+            const glm::vec2 mirrored = h0[((kSize - m) % kSize) * kSize + (kSize - n) % kSize];
+            texels[m * kSize + n] = glm::vec4(h0[m * kSize + n], mirrored.x, -mirrored.y);
+        }
+    }
+
+    UploadContext &upload = UploadContext::get();
+    const VkDeviceSize spectrumSize = texels.size() * sizeof(glm::vec4);
+    if (m_queueFamilies.size() > 1)
+    {
+        // A CONCURRENT image cannot be handed over from the transfer queue: copy it on the graphics queue
+        StagingAllocation staging = upload.allocateStaging(spectrumSize);
+        std::memcpy(staging.mapped, texels.data(), spectrumSize);
+        VkCommandBuffer copyCmd = upload.graphicsCommands();
+
+        VkImageMemoryBarrier toTransfer{};
+        toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toTransfer.image = m_initialSpectrum;
+        toTransfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = staging.offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = {kSize, kSize, 1};
+        vkCmdCopyBufferToImage(copyCmd, staging.buffer, m_initialSpectrum, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+    else
+    {
+        upload.uploadImage(m_initialSpectrum, texels.data(), spectrumSize, kSize, kSize);
+    }
+    upload.transitionToShaderRead(m_initialSpectrum, 1);
+
+    // Everything else lives in GENERAL; the foam the first frame fades from starts at zero
+    VkCommandBuffer cmd = upload.graphicsCommands();
+
+    std::array<VkImageMemoryBarrier, 4> barriers{};
+    for (uint32_t i = 0; i < barriers.size(); i++)
+    {
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].image = i < 2 ? m_fields[i] : m_maps[i - 2].image;
+        barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, i < 2 ? 1 : m_mipLevels, 0, 1};
+        barriers[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    const VkClearColorValue flat = {{0.0f, 1.0f, 0.0f, 0.0f}};
+    for (Map &map : m_maps)
+    {
+        const VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevels, 0, 1};
+        vkCmdClearColorImage(cmd, map.image, VK_IMAGE_LAYOUT_GENERAL, &flat, 1, &range);
+    }
+
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  kSimulationStages | kWaterStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void OceanFFT::writeSet()
+{
+    VkDescriptorImageInfo spectrumInfo{m_spectrumSampler, m_initialSpectrumView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    std::array<VkDescriptorImageInfo, 4> storageInfos = {
+        VkDescriptorImageInfo{VK_NULL_HANDLE, m_fieldViews[0], VK_IMAGE_LAYOUT_GENERAL},
+        VkDescriptorImageInfo{VK_NULL_HANDLE, m_fieldViews[1], VK_IMAGE_LAYOUT_GENERAL},
+        VkDescriptorImageInfo{VK_NULL_HANDLE, m_maps[0].storageView, VK_IMAGE_LAYOUT_GENERAL},
+        VkDescriptorImageInfo{VK_NULL_HANDLE, m_maps[1].storageView, VK_IMAGE_LAYOUT_GENERAL}};
+
+    std::array<VkWriteDescriptorSet, 5> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[i].pImageInfo = i == 0 ? &spectrumInfo : &storageInfos[i - 1];
+    }
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+// ============================================================================
+// SIMULATION
+// ============================================================================
+
+glm::vec4 OceanFFT::getShaderParams() const
+{
+    // The mip whose texels are as wide as a cell of 's' world units is log2(s) + y
+    const float texelSize = kPatchSize / static_cast<float>(kSize);
+    return glm::vec4(1.0f / kPatchSize, -std::log2(texelSize), 0.0f, 0.0f);
+}
+
+void OceanFFT::recordSimulation(VkCommandBuffer cmd, float time, bool computeQueue)
+{
+    // Frame-rate independent fade; nothing fades on the first frame or when time jumps back
+    const float deltaTime = m_lastTime < 0.0f ? 0.0f : std::max(0.0f, time - m_lastTime);
+    m_lastTime = time;
+
+    SimulationPush push{};
+    push.time = time;
+    push.patchSize = kPatchSize;
+    push.choppiness = m_choppiness;
+    push.foamDecay = std::exp(-deltaTime / kFoamLifetime);
+    push.direction = 0;
+
+    // Last frame's water draws still read the maps, and its foam is read back here. On the compute
+    // queue the draws are covered by the semaphore the submission waits for
+    memoryBarrier(cmd, kSimulationStages | (computeQueue ? 0 : kWaterStages), VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                  kSimulationStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    const VkAccessFlags computeReadWrite = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    const uint32_t groups = kSize / kGroupSize;
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_spectrumPipeline);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationPush), &push);
+    vkCmdDispatch(cmd, groups, groups, 1);
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, computeReadWrite);
+
+    // One workgroup per line and field
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_fftPipeline);
+    for (uint32_t direction = 0; direction < 2; direction++)
+    {
+        push.direction = direction;
+        vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationPush), &push);
+        vkCmdDispatch(cmd, 1, kSize, static_cast<uint32_t>(m_fields.size()));
+        memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, computeReadWrite);
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_combinePipeline);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationPush), &push);
+    vkCmdDispatch(cmd, groups, groups, 1);
+    if (computeQueue)
+    {
+        // Level 0 for the caustics; the semaphore makes it visible to the graphics queue
+        memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        return;
+    }
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+    recordMips(cmd);
+
+    memoryBarrier(cmd, kSimulationStages, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                  kWaterStages, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void OceanFFT::recordMipChain(VkCommandBuffer cmd) const
+{
+    // Level 0 arrived through the semaphore; last frame's draws may still read the levels written here
+    memoryBarrier(cmd, kWaterStages, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+
+    recordMips(cmd);
+
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  kWaterStages, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void OceanFFT::recordMips(VkCommandBuffer cmd) const
+{
+    // Source and destination levels are different subresources, so both can stay in GENERAL
+    for (uint32_t level = 1; level < m_mipLevels; level++)
+    {
+        const int32_t srcSize = static_cast<int32_t>(kSize >> (level - 1));
+        const int32_t dstSize = std::max(srcSize / 2, 1);
+
+        VkImageBlit blit{};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+        blit.srcOffsets[1] = {srcSize, srcSize, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        blit.dstOffsets[1] = {dstSize, dstSize, 1};
+
+        for (const Map &map : m_maps)
+        {
+            vkCmdBlitImage(cmd, map.image, VK_IMAGE_LAYOUT_GENERAL, map.image, VK_IMAGE_LAYOUT_GENERAL, 1, &blit, VK_FILTER_LINEAR);
+        }
+
+        memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    }
+}
@@ -0,0 +1,34 @@
+#include "OffscreenThrottle.h"
+#include <cmath>
+
+void OffscreenThrottle::update(const glm::vec3 &position, const glm::vec3 &front, const glm::mat4 &projection,
+                               const glm::mat4 &view, float scale)
+{
+    // Reprojection moves the old picture, it cannot change its lens: zoom and aspect changes re-render
+    bool due = !m_valid || projection != m_projection;
+    if (!due && m_interval > 0)
+    {
+        due = m_reusedFrames + 1 >= m_interval;
+    }
+    if (!due)
+    {
+        const float cosTurn = glm::dot(glm::normalize(front), m_front);
+        due = glm::distance(position, m_position) > m_moveThreshold ||
+              cosTurn < std::cos(glm::radians(m_turnThresholdDegrees));
+    }
+
+    m_due = due;
+    if (!due)
+    {
+        m_reusedFrames++;
+        return;
+    }
+
+    m_valid = true;
+    m_reusedFrames = 0;
+    m_position = position;
+    m_front = glm::normalize(front);
+    m_projection = projection;
+    m_viewProjection = projection * view;
+    m_scale = scale;
+}
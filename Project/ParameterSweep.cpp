@@ -0,0 +1,382 @@
+#include "ParameterSweep.h"
+#include "Lib/json.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+
+using json = nlohmann::json;
+
+namespace
+{
+    bool isShaderParameter(const std::string &name)
+    {
+        for (const char *parameter : ParameterSweep::kShaderParameters)
+        {
+            if (name == parameter)
+                return true;
+        }
+        return false;
+    }
+
+    std::vector<double> axisValues(const ParameterSweep::Axis &axis)
+    {
+        if (!axis.values.empty())
+            return axis.values;
+        if (axis.steps < 2)
+            return {axis.min};
+        std::vector<double> values(axis.steps);
+        for (uint32_t i = 0; i < axis.steps; i++)
+        {
+            values[i] = axis.min + (axis.max - axis.min) * i / (axis.steps - 1);
+        }
+        return values;
+    }
+
+    // The axis at t in [0, 1): a list's entry covering t, else the point t along the range
+    double axisValueAt(const ParameterSweep::Axis &axis, double t)
+    {
+        if (!axis.values.empty())
+        {
+            const size_t index = std::min(static_cast<size_t>(t * axis.values.size()), axis.values.size() - 1);
+            return axis.values[index];
+        }
+        return axis.min + t * (axis.max - axis.min);
+    }
+}
+
+bool ParameterSweep::isParameter(const std::string &name)
+{
+    if (isShaderParameter(name))
+        return true;
+    for (const char *parameter : kConfigParameters)
+    {
+        if (name == parameter)
+            return true;
+    }
+    return false;
+}
+
+double ParameterSweep::getValue(const WaterTestConfig &config, const std::string &name)
+{
+    if (name == "sampleCount")
+        return config.sampleCount;
+    if (name == "causticRayCount")
+        return config.causticRayCount;
+    if (name == "msaaSamples")
+        return config.msaaSamples;
+    if (name == "pointLightCount")
+        return config.pointLightCount;
+    if (name == "offscreenUpdateInterval")
+        return config.offscreenUpdateInterval;
+    if (name == "framesInFlight")
+        return config.framesInFlight;
+    if (name == "resolutionScale")
+        return config.resolutionScale;
+    for (const auto &param : config.shaderParams)
+    {
+        if (param.first == name)
+            return param.second;
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+void ParameterSweep::setValue(WaterTestConfig &config, const std::string &name, double value)
+{
+    const auto count = static_cast<uint32_t>(std::max(std::lround(value), 0l));
+    if (name == "sampleCount")
+        config.sampleCount = static_cast<int>(count);
+    else if (name == "causticRayCount")
+        config.causticRayCount = static_cast<int>(count);
+    else if (name == "msaaSamples")
+        config.msaaSamples = count;
+    else if (name == "pointLightCount")
+        config.pointLightCount = count;
+    else if (name == "offscreenUpdateInterval")
+        config.offscreenUpdateInterval = count;
+    else if (name == "framesInFlight")
+        config.framesInFlight = std::max(count, 1u);
+    else if (name == "resolutionScale")
+        config.resolutionScale = static_cast<float>(std::clamp(value, 0.0, 1.0));
+    else if (isShaderParameter(name))
+    {
+        for (auto &param : config.shaderParams)
+        {
+            if (param.first == name)
+            {
+                param.second = static_cast<float>(value);
+                return;
+            }
+        }
+        config.shaderParams.emplace_back(name, static_cast<float>(value));
+    }
+}
+
+std::optional<ParameterSweep> ParameterSweep::load(const std::string &filePath)
+{
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open sweep spec: " << filePath << std::endl;
+        return std::nullopt;
+    }
+
+    json specJson = json::parse(file, nullptr, false);
+    if (specJson.is_discarded() || !specJson.contains("parameters") || !specJson["parameters"].is_object())
+    {
+        std::cerr << "Malformed sweep spec: " << filePath << std::endl;
+        return std::nullopt;
+    }
+
+    ParameterSweep sweep;
+    // The trade-off sweep's defaults: clear shallow water, moving light, sweep run lengths
+    sweep.base.renderingMode = RenderingMode::PB;
+    sweep.base.turbidity = TurbidityLevel::Low;
+    sweep.base.depth = DepthLevel::Shallow;
+    sweep.base.lightMotion = LightMotion::Moving;
+    sweep.base.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+    sweep.base.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+    sweep.base.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+    try
+    {
+        sweep.name = specJson.value("name", sweep.name);
+        const std::string sampling = specJson.value("sampling", std::string("grid"));
+        if (sampling == "latin-hypercube")
+            sweep.sampling = Sampling::LatinHypercube;
+        else if (sampling != "grid")
+        {
+            std::cerr << "Unknown sampling in sweep spec: " << sampling << std::endl;
+            return std::nullopt;
+        }
+        sweep.points = std::max(specJson.value("points", sweep.points), 1u);
+        sweep.seed = specJson.value("seed", sweep.seed);
+
+        if (specJson.contains("base"))
+        {
+            const json &base = specJson["base"];
+            WaterTestConfig &c = sweep.base;
+            c.turbidity = static_cast<TurbidityLevel>(base.value("turbidity", static_cast<int>(c.turbidity)));
+            c.depth = static_cast<DepthLevel>(base.value("depth", static_cast<int>(c.depth)));
+            c.lightMotion = static_cast<LightMotion>(base.value("lightMotion", static_cast<int>(c.lightMotion)));
+            c.renderingMode = static_cast<RenderingMode>(base.value("renderingMode", static_cast<int>(c.renderingMode)));
+            c.reflections = static_cast<ReflectionTier>(base.value("reflections", static_cast<int>(c.reflections)));
+            c.totalFrames = base.value("totalFrames", c.totalFrames);
+            c.warmupFrames = base.value("warmupFrames", c.warmupFrames);
+            c.adaptiveWarmup = base.value("adaptiveWarmup", c.adaptiveWarmup);
+            c.repeatCount = base.value("repeatCount", c.repeatCount);
+            c.cameraPathFile = base.value("cameraPath", c.cameraPathFile);
+            for (const auto &field : base.items())
+            {
+                if (isParameter(field.key()))
+                    setValue(c, field.key(), field.value().get<double>());
+            }
+        }
+
+        for (const auto &parameter : specJson["parameters"].items())
+        {
+            if (!isParameter(parameter.key()))
+            {
+                std::cerr << "Unknown sweep parameter: " << parameter.key() << std::endl;
+                return std::nullopt;
+            }
+            Axis axis;
+            axis.name = parameter.key();
+            if (parameter.value().is_array())
+            {
+                axis.values = parameter.value().get<std::vector<double>>();
+            }
+            else
+            {
+                axis.min = parameter.value().at("min").get<double>();
+                axis.max = parameter.value().at("max").get<double>();
+                axis.steps = parameter.value().value("steps", axis.steps);
+            }
+            if ((parameter.value().is_array() && axis.values.empty()) || axis.max < axis.min)
+            {
+                std::cerr << "Sweep parameter " << axis.name << " has no values" << std::endl;
+                return std::nullopt;
+            }
+            sweep.axes.push_back(std::move(axis));
+        }
+    }
+    catch (const json::exception &e)
+    {
+        std::cerr << "Malformed sweep spec: " << filePath << " (" << e.what() << ")" << std::endl;
+        return std::nullopt;
+    }
+    if (sweep.axes.empty())
+    {
+        std::cerr << "Sweep spec has no parameters: " << filePath << std::endl;
+        return std::nullopt;
+    }
+    return sweep;
+}
+
+std::vector<WaterTestConfig> ParameterSweep::generateConfigs() const
+{
+    std::vector<std::vector<double>> points;
+    if (sampling == Sampling::Grid)
+    {
+        // Mixed-radix count over the axes, the last one fastest
+        std::vector<std::vector<double>> values;
+        size_t total = 1;
+        for (const Axis &axis : axes)
+        {
+            values.push_back(axisValues(axis));
+            total *= values.back().size();
+        }
+        for (size_t index = 0; index < total; index++)
+        {
+            std::vector<double> point(axes.size());
+            size_t rest = index;
+            for (size_t a = axes.size(); a-- > 0;)
+            {
+                point[a] = values[a][rest % values[a].size()];
+                rest /= values[a].size();
+            }
+            points.push_back(std::move(point));
+        }
+    }
+    else
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> jitter(0.0, 1.0);
+        points.assign(this->points, std::vector<double>(axes.size()));
+        std::vector<uint32_t> strata(this->points);
+        for (size_t a = 0; a < axes.size(); a++)
+        {
+            std::iota(strata.begin(), strata.end(), 0u);
+            std::shuffle(strata.begin(), strata.end(), rng);
+            for (uint32_t p = 0; p < this->points; p++)
+            {
+                points[p][a] = axisValueAt(axes[a], (strata[p] + jitter(rng)) / this->points);
+            }
+        }
+    }
+
+    std::vector<std::string> swept;
+    for (const Axis &axis : axes)
+    {
+        swept.push_back(axis.name);
+    }
+    std::vector<WaterTestConfig> configs;
+    for (size_t p = 0; p < points.size(); p++)
+    {
+        WaterTestConfig config = base;
+        config.name = name + "_" + std::to_string(p);
+        config.sweptParameters = swept;
+        for (size_t a = 0; a < axes.size(); a++)
+        {
+            setValue(config, axes[a].name, points[p][a]);
+        }
+        configs.push_back(std::move(config));
+    }
+    return configs;
+}
+
+size_t ParameterSweep::writeParetoFront(const std::vector<TestRunResult> &results, const std::string &filePath)
+{
+    struct Point
+    {
+        const WaterTestConfig *config;
+        int runs = 0;
+        double gpuMs = 0.0;
+        int referenceRuns = 0;
+        double referenceSSIM = 0.0;
+        int compareRuns = 0;
+        double compareSSIM = 0.0;
+        bool onFront = false;
+
+        bool hasQuality() const { return referenceRuns > 0; }
+        double ssim() const { return referenceSSIM / std::max(referenceRuns, 1); }
+        double frameSsim() const { return compareSSIM / std::max(compareRuns, 1); }
+    };
+
+    // Configs in suite order, their repeats together
+    std::vector<Point> points;
+    std::vector<std::string> columns;
+    for (const TestRunResult &run : results)
+    {
+        auto it = std::find_if(points.begin(), points.end(), [&](const Point &p)
+                               { return p.config->name == run.config.name; });
+        if (it == points.end())
+        {
+            points.push_back({&run.config});
+            it = points.end() - 1;
+            for (const std::string &name : run.config.sweptParameters)
+            {
+                if (std::find(columns.begin(), columns.end(), name) == columns.end())
+                    columns.push_back(name);
+            }
+        }
+        it->runs++;
+        it->gpuMs += run.aggregated.medianGpuTime;
+        if (run.aggregated.referenceFrameCount > 0)
+        {
+            it->referenceRuns++;
+            it->referenceSSIM += run.aggregated.referenceSSIM;
+        }
+        if (run.aggregated.imageQualityFrameCount > 0)
+        {
+            it->compareRuns++;
+            it->compareSSIM += run.aggregated.avgSSIM;
+        }
+    }
+    for (Point &p : points)
+    {
+        p.gpuMs /= p.runs;
+    }
+
+    // Non-dominated: no other config at most as slow and at least as good, and better in one of them. Quality is
+    // reference SSIM alone; frame-to-frame SSIM is a different measure and is only reported
+    size_t frontSize = 0;
+    for (Point &p : points)
+    {
+        if (!p.hasQuality())
+            continue;
+        p.onFront = std::none_of(points.begin(), points.end(), [&](const Point &q)
+                                 { return &q != &p && q.hasQuality() && q.gpuMs <= p.gpuMs && q.ssim() >= p.ssim() &&
+                                          (q.gpuMs < p.gpuMs || q.ssim() > p.ssim()); });
+        frontSize += p.onFront ? 1 : 0;
+    }
+    if (std::none_of(points.begin(), points.end(), [](const Point &p)
+                     { return p.hasQuality(); }))
+    {
+        std::cerr << "No sweep config has reference images (--make-references), so none is on the Pareto front" << std::endl;
+    }
+
+    std::ofstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write Pareto front: " << filePath << std::endl;
+        return frontSize;
+    }
+    file << "Config";
+    for (const std::string &name : columns)
+    {
+        file << "," << name;
+    }
+    file << ",Runs,GpuTime_ms,ReferenceSSIM,FrameSSIM,Pareto\n";
+    for (const Point &p : points)
+    {
+        file << TestReportGenerator::escapeCSV(p.config->name);
+        for (const std::string &name : columns)
+        {
+            const double value = getValue(*p.config, name);
+            file << ",";
+            if (!std::isnan(value))
+                file << value;
+        }
+        file << "," << p.runs << "," << std::fixed << std::setprecision(4) << p.gpuMs << ",";
+        if (p.hasQuality())
+            file << p.ssim();
+        file << ",";
+        if (p.compareRuns > 0)
+            file << p.frameSsim();
+        file << std::defaultfloat << "," << (p.onFront ? 1 : 0) << "\n";
+    }
+    return frontSize;
+}
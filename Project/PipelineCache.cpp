@@ -0,0 +1,133 @@
+#include "PipelineCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    const char kMagic[8] = {'X', 'R', 'P', 'C', 'A', 'C', 'H', '\0'};
+}
+
+PipelineCache &PipelineCache::get()
+{
+    static PipelineCache instance;
+    return instance;
+}
+
+void PipelineCache::initialize(VkDevice device, VkPhysicalDevice physicalDevice, const std::string &path)
+{
+    m_device = device;
+    m_path = path;
+    vkGetPhysicalDeviceProperties(physicalDevice, &m_properties);
+
+    std::vector<char> data;
+    std::ifstream in(path, std::ios::binary);
+    if (in.is_open())
+    {
+        FileHeader header{};
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (in && matchesDevice(header))
+        {
+            data.resize(static_cast<size_t>(header.dataSize));
+            if (!in.read(data.data(), static_cast<std::streamsize>(data.size())))
+                data.clear();
+        }
+        if (data.empty())
+        {
+            std::cout << "[PipelineCache] " << path << " is stale or from another device, starting empty\n";
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkResult result = vkCreatePipelineCache(device, &createInfo, nullptr, &m_cache);
+    if (result != VK_SUCCESS && !data.empty())
+    {
+        // The driver rejected the blob despite a matching header
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(device, &createInfo, nullptr, &m_cache);
+        data.clear();
+    }
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    std::cout << "[PipelineCache] " << (data.empty() ? "Created empty cache" : "Loaded " + std::to_string(data.size()) + " bytes from " + path) << "\n";
+}
+
+bool PipelineCache::matchesDevice(const FileHeader &header) const
+{
+    return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+           header.vendorID == m_properties.vendorID &&
+           header.deviceID == m_properties.deviceID &&
+           header.driverVersion == m_properties.driverVersion &&
+           std::memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+           header.dataSize > 0;
+}
+
+bool PipelineCache::save() const
+{
+    if (m_cache == VK_NULL_HANDLE)
+        return false;
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) != VK_SUCCESS || size == 0)
+        return false;
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS)
+        return false;
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.vendorID = m_properties.vendorID;
+    header.deviceID = m_properties.deviceID;
+    header.driverVersion = m_properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = size;
+
+    // Write to a temporary and rename so a crash mid-write never leaves a truncated cache
+    const std::string tempPath = m_path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            std::cerr << "[PipelineCache] Failed to open " << tempPath << "\n";
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(data.data(), static_cast<std::streamsize>(size));
+        if (!out)
+        {
+            std::cerr << "[PipelineCache] Failed to write " << tempPath << "\n";
+            return false;
+        }
+    }
+    std::remove(m_path.c_str());
+    if (std::rename(tempPath.c_str(), m_path.c_str()) != 0)
+    {
+        std::cerr << "[PipelineCache] Failed to replace " << m_path << "\n";
+        return false;
+    }
+
+    std::cout << "[PipelineCache] Saved " << size << " bytes to " << m_path << "\n";
+    return true;
+}
+
+void PipelineCache::cleanup()
+{
+    if (m_cache == VK_NULL_HANDLE)
+        return;
+
+    save();
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    m_cache = VK_NULL_HANDLE;
+    m_device = VK_NULL_HANDLE;
+}
@@ -0,0 +1,128 @@
+#include "PresentPacer.h"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// ============================================================================
+// SUPPORT
+// ============================================================================
+
+bool PresentPacer::isSupported(VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    for (const char *required : kExtensions)
+    {
+        bool found = false;
+        for (const auto &extension : availableExtensions)
+        {
+            found = found || std::strcmp(extension.extensionName, required) == 0;
+        }
+        if (!found)
+            return false;
+    }
+
+    Features features{};
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = enableFeatures(features, nullptr);
+    features.presentId.presentId = VK_FALSE; // Filled in by the query
+    features.presentWait.presentWait = VK_FALSE;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    return features.presentId.presentId == VK_TRUE && features.presentWait.presentWait == VK_TRUE;
+}
+
+void *PresentPacer::enableFeatures(Features &features, void *next)
+{
+    features.presentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    features.presentWait.pNext = next;
+    features.presentWait.presentWait = VK_TRUE;
+
+    features.presentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    features.presentId.pNext = &features.presentWait;
+    features.presentId.presentId = VK_TRUE;
+    return &features.presentId;
+}
+
+// ============================================================================
+// PACING
+// ============================================================================
+
+PresentPacer::PresentPacer(VkDevice device)
+    : m_device(device)
+{
+    m_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+    if (!m_waitForPresent)
+    {
+        throw std::runtime_error("failed to load vkWaitForPresentKHR!");
+    }
+}
+
+void PresentPacer::attach(VkPresentInfoKHR &presentInfo, Clock::time_point inputTime)
+{
+    m_presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    m_presentIdInfo.pNext = presentInfo.pNext;
+    m_presentIdInfo.swapchainCount = 1;
+    m_presentId++;
+    m_presentIdInfo.pPresentIds = &m_presentId;
+    presentInfo.pNext = &m_presentIdInfo;
+
+    // A full ring means the oldest present was never reported (minimized window): stop tracking it
+    if (m_pendingCount == kMaxPending)
+    {
+        m_pendingFirst = (m_pendingFirst + 1) % kMaxPending;
+        m_pendingCount--;
+    }
+    m_pending[(m_pendingFirst + m_pendingCount) % kMaxPending] = {m_presentId, inputTime};
+    m_pendingCount++;
+}
+
+void PresentPacer::waitForDisplay(VkSwapchainKHR swapchain, uint64_t timeoutNs)
+{
+    // Older presents first, so they are timed when they were displayed rather than after the wait
+    poll(swapchain);
+    if (m_pendingCount == 0)
+        return;
+
+    const Pending &latest = m_pending[(m_pendingFirst + m_pendingCount - 1) % kMaxPending];
+    if (m_waitForPresent(m_device, swapchain, latest.id, timeoutNs) == VK_SUCCESS)
+    {
+        poll(swapchain);
+    }
+}
+
+void PresentPacer::poll(VkSwapchainKHR swapchain)
+{
+    // Displayed in present order; one that was replaced (MAILBOX) reports once a later one is shown
+    while (m_pendingCount > 0)
+    {
+        const Pending &oldest = m_pending[m_pendingFirst];
+        const VkResult result = m_waitForPresent(m_device, swapchain, oldest.id, 0);
+        if (result == VK_TIMEOUT)
+            break;
+        if (result != VK_SUCCESS)
+        {
+            // Out of date or lost: these presents will not be reported
+            reset();
+            break;
+        }
+
+        recordDisplayed(oldest, Clock::now());
+        m_pendingFirst = (m_pendingFirst + 1) % kMaxPending;
+        m_pendingCount--;
+    }
+}
+
+void PresentPacer::reset()
+{
+    m_pendingFirst = 0;
+    m_pendingCount = 0;
+}
+
+void PresentPacer::recordDisplayed(const Pending &pending, Clock::time_point now)
+{
+    m_lastMs = std::chrono::duration<double, std::milli>(now - pending.inputTime).count();
+    m_filteredMs = m_filteredMs > 0.0 ? m_filteredMs + kSmoothing * (m_lastMs - m_filteredMs) : m_lastMs;
+}
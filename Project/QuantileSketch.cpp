@@ -0,0 +1,131 @@
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+QuantileSketch::QuantileSketch(double relativeAccuracy)
+    : m_accuracy(relativeAccuracy)
+{
+    if (relativeAccuracy <= 0.0 || relativeAccuracy >= 1.0)
+    {
+        throw std::invalid_argument("QuantileSketch accuracy must be in (0, 1)");
+    }
+    m_gamma = (1.0 + relativeAccuracy) / (1.0 - relativeAccuracy);
+    m_logGamma = std::log(m_gamma);
+}
+
+int32_t QuantileSketch::bucketIndex(double value) const
+{
+    // Bucket i holds (gamma^(i-1), gamma^i]
+    return static_cast<int32_t>(std::ceil(std::log(value) / m_logGamma));
+}
+
+void QuantileSketch::add(double value)
+{
+    m_min = m_count == 0 ? value : std::min(m_min, value);
+    m_max = m_count == 0 ? value : std::max(m_max, value);
+    m_count++;
+
+    if (value <= kMinValue)
+    {
+        m_zeroCount++;
+        return;
+    }
+
+    const int32_t index = bucketIndex(value);
+    if (m_buckets.empty())
+    {
+        m_firstIndex = index;
+        m_buckets.push_back(0);
+    }
+    else if (index < m_firstIndex)
+    {
+        m_buckets.insert(m_buckets.begin(), static_cast<size_t>(m_firstIndex - index), 0);
+        m_firstIndex = index;
+    }
+    else if (index >= m_firstIndex + static_cast<int32_t>(m_buckets.size()))
+    {
+        m_buckets.resize(static_cast<size_t>(index - m_firstIndex) + 1, 0);
+    }
+    m_buckets[index - m_firstIndex]++;
+}
+
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    if (other.m_accuracy != m_accuracy)
+    {
+        throw std::invalid_argument("QuantileSketch::merge needs sketches of the same accuracy");
+    }
+    if (other.m_count == 0)
+        return;
+    if (m_count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    m_count += other.m_count;
+    m_zeroCount += other.m_zeroCount;
+    if (other.m_buckets.empty())
+        return;
+    if (m_buckets.empty())
+    {
+        m_buckets = other.m_buckets;
+        m_firstIndex = other.m_firstIndex;
+        return;
+    }
+
+    const int32_t first = std::min(m_firstIndex, other.m_firstIndex);
+    const int32_t end = std::max(m_firstIndex + static_cast<int32_t>(m_buckets.size()),
+                                 other.m_firstIndex + static_cast<int32_t>(other.m_buckets.size()));
+    std::vector<uint64_t> buckets(static_cast<size_t>(end - first), 0);
+    for (size_t i = 0; i < m_buckets.size(); i++)
+    {
+        buckets[m_firstIndex - first + i] += m_buckets[i];
+    }
+    for (size_t i = 0; i < other.m_buckets.size(); i++)
+    {
+        buckets[other.m_firstIndex - first + i] += other.m_buckets[i];
+    }
+    m_buckets = std::move(buckets);
+    m_firstIndex = first;
+}
+
+void QuantileSketch::clear()
+{
+    m_buckets.clear();
+    m_firstIndex = 0;
+    m_zeroCount = 0;
+    m_count = 0;
+    m_min = 0.0;
+    m_max = 0.0;
+}
+
+double QuantileSketch::quantile(double q) const
+{
+    if (m_count == 0)
+        return 0.0;
+    if (q <= 0.0)
+        return m_min;
+    if (q >= 1.0)
+        return m_max;
+
+    const uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(m_count - 1));
+    uint64_t seen = m_zeroCount;
+    if (seen > rank)
+        return std::max(m_min, 0.0);
+
+    for (size_t i = 0; i < m_buckets.size(); i++)
+    {
+        seen += m_buckets[i];
+        if (seen > rank)
+        {
+            // Midpoint in relative terms: within 'accuracy' of every value in the bucket
+            const double upper = std::pow(m_gamma, m_firstIndex + static_cast<int32_t>(i));
+            return std::clamp(2.0 * upper / (m_gamma + 1.0), m_min, m_max);
+        }
+    }
+    return m_max;
+}
@@ -0,0 +1,463 @@
+#include "RayQueryScene.h"
+#include "GpuMemoryAllocator.h"
+#include "MaterialTable.h"
+#include "Scene.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void memoryBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+// ============================================================================
+// DEVICE SUPPORT
+// ============================================================================
+
+const std::vector<const char *> &RayQueryScene::extensions()
+{
+    static const std::vector<const char *> names = {VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
+                                                    VK_KHR_RAY_QUERY_EXTENSION_NAME,
+                                                    VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME};
+    return names;
+}
+
+bool RayQueryScene::isSupported(VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    for (const char *name : extensions())
+    {
+        bool found = false;
+        for (const auto &extension : availableExtensions)
+        {
+            found = found || std::strcmp(extension.extensionName, name) == 0;
+        }
+        if (!found)
+            return false;
+    }
+
+    VkPhysicalDeviceRayQueryFeaturesKHR rayQuery{};
+    rayQuery.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+    VkPhysicalDeviceAccelerationStructureFeaturesKHR accelerationStructure{};
+    accelerationStructure.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+    accelerationStructure.pNext = &rayQuery;
+    VkPhysicalDeviceVulkan12Features vulkan12{};
+    vulkan12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12.pNext = &accelerationStructure;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    if (rayQuery.rayQuery != VK_TRUE || accelerationStructure.accelerationStructure != VK_TRUE ||
+        vulkan12.bufferDeviceAddress != VK_TRUE)
+    {
+        return false;
+    }
+
+    // The packed positions go into the builds as they are
+    VkFormatProperties formatProperties{};
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R16G16B16A16_UNORM, &formatProperties);
+    return (formatProperties.bufferFeatures & VK_FORMAT_FEATURE_ACCELERATION_STRUCTURE_VERTEX_BUFFER_BIT_KHR) != 0;
+}
+
+void *RayQueryScene::enableFeatures(Features &features, void *next)
+{
+    features = {};
+    features.accelerationStructure.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+    features.accelerationStructure.accelerationStructure = VK_TRUE;
+    features.accelerationStructure.pNext = next;
+    features.rayQuery.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+    features.rayQuery.rayQuery = VK_TRUE;
+    features.rayQuery.pNext = &features.accelerationStructure;
+    return &features.rayQuery;
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+RayQueryScene::RayQueryScene(VkDevice device, VkPhysicalDevice physicalDevice)
+    : m_device(device), m_physicalDevice(physicalDevice)
+{
+    loadFunctions();
+
+    VkPhysicalDeviceAccelerationStructurePropertiesKHR limits{};
+    limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &limits;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+    m_scratchAlignment = std::max<VkDeviceSize>(1, limits.minAccelerationStructureScratchOffsetAlignment);
+}
+
+RayQueryScene::~RayQueryScene()
+{
+    destroyGeometry();
+}
+
+void RayQueryScene::loadFunctions()
+{
+    m_createStructure = reinterpret_cast<PFN_vkCreateAccelerationStructureKHR>(
+        vkGetDeviceProcAddr(m_device, "vkCreateAccelerationStructureKHR"));
+    m_destroyStructure = reinterpret_cast<PFN_vkDestroyAccelerationStructureKHR>(
+        vkGetDeviceProcAddr(m_device, "vkDestroyAccelerationStructureKHR"));
+    m_getBuildSizes = reinterpret_cast<PFN_vkGetAccelerationStructureBuildSizesKHR>(
+        vkGetDeviceProcAddr(m_device, "vkGetAccelerationStructureBuildSizesKHR"));
+    m_getStructureAddress = reinterpret_cast<PFN_vkGetAccelerationStructureDeviceAddressKHR>(
+        vkGetDeviceProcAddr(m_device, "vkGetAccelerationStructureDeviceAddressKHR"));
+    m_cmdBuild = reinterpret_cast<PFN_vkCmdBuildAccelerationStructuresKHR>(
+        vkGetDeviceProcAddr(m_device, "vkCmdBuildAccelerationStructuresKHR"));
+    if (!m_createStructure || !m_destroyStructure || !m_getBuildSizes || !m_getStructureAddress || !m_cmdBuild)
+    {
+        throw std::runtime_error("failed to load the acceleration structure functions!");
+    }
+}
+
+// ============================================================================
+// RESOURCES
+// ============================================================================
+
+VkDeviceAddress RayQueryScene::getAddress(VkBuffer buffer) const
+{
+    VkBufferDeviceAddressInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    info.buffer = buffer;
+    return vkGetBufferDeviceAddress(m_device, &info);
+}
+
+RayQueryScene::Structure RayQueryScene::createStructure(VkAccelerationStructureTypeKHR type, VkDeviceSize size)
+{
+    Structure structure;
+    structure.buffer = std::get<0>(VkUtils::CreateBuffer(
+        m_device, m_physicalDevice, size,
+        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+
+    VkAccelerationStructureCreateInfoKHR createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+    createInfo.buffer = structure.buffer;
+    createInfo.size = size;
+    createInfo.type = type;
+    if (m_createStructure(m_device, &createInfo, nullptr, &structure.handle) != VK_SUCCESS)
+    {
+        VkUtils::DestroyBuffer(structure.buffer);
+        throw std::runtime_error("failed to create acceleration structure!");
+    }
+
+    VkAccelerationStructureDeviceAddressInfoKHR addressInfo{};
+    addressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+    addressInfo.accelerationStructure = structure.handle;
+    structure.address = m_getStructureAddress(m_device, &addressInfo);
+    return structure;
+}
+
+void RayQueryScene::destroyStructure(Structure &structure)
+{
+    if (structure.handle != VK_NULL_HANDLE)
+    {
+        m_destroyStructure(m_device, structure.handle, nullptr);
+    }
+    VkUtils::DestroyBuffer(structure.buffer);
+    structure = {};
+}
+
+void RayQueryScene::destroyGeometry()
+{
+    for (Structure &blas : m_blas)
+    {
+        destroyStructure(blas);
+    }
+    m_blas.clear();
+    m_blasGeometry.clear();
+    m_blasRanges.clear();
+    m_blasBuilds.clear();
+    destroyStructure(m_tlas);
+
+    for (uint32_t i = 0; i < kFramesInFlight; i++)
+    {
+        VkUtils::DestroyBuffer(m_instanceBuffers[i]);
+        m_instanceBuffers[i] = VK_NULL_HANDLE;
+        m_instances[i] = nullptr;
+        m_instanceAddresses[i] = 0;
+    }
+    VkUtils::DestroyBuffer(m_objectBuffer);
+    m_objectBuffer = VK_NULL_HANDLE;
+    VkUtils::DestroyBuffer(m_scratchBuffer);
+    m_scratchBuffer = VK_NULL_HANDLE;
+    m_scratchAddress = 0;
+
+    m_instanceCount = 0;
+    m_blasBuilt = false;
+    m_tlasBuilt = false;
+    m_refitsSinceRebuild = 0;
+}
+
+void RayQueryScene::setGeometry(const Scene &scene, const MaterialTable &materials, VkBuffer vertexBuffer, VkBuffer indexBuffer)
+{
+    destroyGeometry();
+    m_vertexBuffer = vertexBuffer;
+    m_indexBuffer = indexBuffer;
+    if (scene.empty())
+        return;
+
+    const VkDeviceAddress vertexAddress = getAddress(vertexBuffer);
+    const VkDeviceAddress indexAddress = getAddress(indexBuffer);
+    const uint32_t vertexCount = static_cast<uint32_t>(scene.getVertices().size());
+
+    // Bottom level: one opaque triangle geometry per mesh, indices rebased by its vertexOffset (firstVertex)
+    const uint32_t meshCount = scene.getMeshCount();
+    m_blas.resize(meshCount);
+    m_blasGeometry.resize(meshCount);
+    m_blasRanges.resize(meshCount);
+    m_blasBuilds.resize(meshCount);
+    std::vector<VkDeviceSize> scratchOffsets(meshCount);
+    VkDeviceSize blasScratch = 0;
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        const MeshRange &range = scene.getMeshRange(mesh);
+
+        VkAccelerationStructureGeometryKHR &geometry = m_blasGeometry[mesh];
+        geometry = {};
+        geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+        geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+        geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+        geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+        geometry.geometry.triangles.vertexFormat = VK_FORMAT_R16G16B16A16_UNORM;
+        geometry.geometry.triangles.vertexData.deviceAddress = vertexAddress;
+        geometry.geometry.triangles.vertexStride = sizeof(PackedVertex);
+        geometry.geometry.triangles.maxVertex = vertexCount > 0 ? vertexCount - 1 : 0;
+        geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+        geometry.geometry.triangles.indexData.deviceAddress = indexAddress;
+
+        VkAccelerationStructureBuildRangeInfoKHR &buildRange = m_blasRanges[mesh];
+        buildRange = {};
+        buildRange.primitiveCount = range.indexCount / 3;
+        buildRange.primitiveOffset = range.firstIndex * static_cast<uint32_t>(sizeof(uint32_t));
+        buildRange.firstVertex = static_cast<uint32_t>(range.vertexOffset);
+
+        VkAccelerationStructureBuildGeometryInfoKHR &build = m_blasBuilds[mesh];
+        build = {};
+        build.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+        build.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+        build.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+        build.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+        build.geometryCount = 1;
+        build.pGeometries = &geometry;
+
+        VkAccelerationStructureBuildSizesInfoKHR sizes{};
+        sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+        m_getBuildSizes(m_device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &build, &buildRange.primitiveCount, &sizes);
+        m_blas[mesh] = createStructure(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, sizes.accelerationStructureSize);
+        build.dstAccelerationStructure = m_blas[mesh].handle;
+
+        scratchOffsets[mesh] = blasScratch;
+        blasScratch += alignUp(sizes.buildScratchSize, m_scratchAlignment);
+    }
+
+    // Top level: room for every object, built and refit in place
+    m_instanceCount = scene.getObjectCount();
+    VkAccelerationStructureGeometryKHR instances{};
+    instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    instances.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    instances.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    VkAccelerationStructureBuildGeometryInfoKHR tlasBuild{};
+    tlasBuild.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    tlasBuild.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    tlasBuild.flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    tlasBuild.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    tlasBuild.geometryCount = 1;
+    tlasBuild.pGeometries = &instances;
+    VkAccelerationStructureBuildSizesInfoKHR tlasSizes{};
+    tlasSizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+    m_getBuildSizes(m_device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &tlasBuild, &m_instanceCount, &tlasSizes);
+    m_tlas = createStructure(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, tlasSizes.accelerationStructureSize);
+
+    // One scratch buffer for both: the top level is only built once the bottom levels are done
+    const VkDeviceSize scratchSize = std::max({blasScratch, tlasSizes.buildScratchSize, tlasSizes.updateScratchSize});
+    m_scratchBuffer = std::get<0>(VkUtils::CreateBuffer(
+        m_device, m_physicalDevice, scratchSize + m_scratchAlignment,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+    m_scratchAddress = alignUp(getAddress(m_scratchBuffer), m_scratchAlignment);
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        m_blasBuilds[mesh].scratchData.deviceAddress = m_scratchAddress + scratchOffsets[mesh];
+    }
+
+    // The instances are rewritten by the host while older frames' builds may still read theirs
+    for (uint32_t i = 0; i < kFramesInFlight; i++)
+    {
+        m_instanceBuffers[i] = std::get<0>(VkUtils::CreateBuffer(
+            m_device, m_physicalDevice, sizeof(VkAccelerationStructureInstanceKHR) * m_instanceCount,
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+        m_instances[i] = static_cast<VkAccelerationStructureInstanceKHR *>(VkUtils::MapBuffer(m_instanceBuffers[i]));
+        m_instanceAddresses[i] = getAddress(m_instanceBuffers[i]);
+    }
+
+    // What a hit needs to find and shade its triangle; objects only change here
+    m_objectBuffer = std::get<0>(VkUtils::CreateBuffer(
+        m_device, m_physicalDevice, sizeof(RayObject) * m_instanceCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    RayObject *objects = static_cast<RayObject *>(VkUtils::MapBuffer(m_objectBuffer));
+    for (uint32_t i = 0; i < m_instanceCount; i++)
+    {
+        const MeshRange &range = scene.getMeshRange(scene.getMeshIndex(i));
+        RayObject object{};
+        object.baseColor = glm::vec4(materials.getDescription(scene.getMaterialId(i)).baseColor, 1.0f);
+        object.firstIndex = range.firstIndex;
+        object.vertexOffset = range.vertexOffset;
+        objects[i] = object;
+    }
+}
+
+void RayQueryScene::writeDescriptors(VkDescriptorSet waterSet) const
+{
+    VkWriteDescriptorSetAccelerationStructureKHR tlasInfo{};
+    tlasInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+    tlasInfo.accelerationStructureCount = 1;
+    tlasInfo.pAccelerationStructures = &m_tlas.handle;
+    const std::array<VkDescriptorBufferInfo, 3> bufferInfos = {{{m_objectBuffer, 0, VK_WHOLE_SIZE},
+                                                                {m_vertexBuffer, 0, VK_WHOLE_SIZE},
+                                                                {m_indexBuffer, 0, VK_WHOLE_SIZE}}};
+
+    std::array<VkWriteDescriptorSet, kWaterBindingCount> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = waterSet;
+        writes[i].dstBinding = kWaterBinding + i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = i > 0 ? &bufferInfos[i - 1] : nullptr;
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+    writes[0].pNext = &tlasInfo;
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+// ============================================================================
+// PER FRAME
+// ============================================================================
+
+void RayQueryScene::writeInstances(uint32_t frameIndex, const Scene &scene)
+{
+    // Objects added since setGeometry are not traced until it runs again
+    const uint32_t count = std::min(m_instanceCount, scene.getObjectCount());
+    VkAccelerationStructureInstanceKHR *instances = m_instances[frameIndex];
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const glm::mat4 model = scene.getModelMatrix(i);
+
+        VkAccelerationStructureInstanceKHR instance{};
+        for (int row = 0; row < 3; row++)
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                instance.transform.matrix[row][column] = model[column][row];
+            }
+        }
+        instance.instanceCustomIndex = i; // RayObject index
+        instance.mask = scene.isVisible(i) ? 0xFF : 0x00;
+        instance.instanceShaderBindingTableRecordOffset = 0;
+        // Mirrored transforms and open meshes: hit whichever side faces the ray
+        instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+        instance.accelerationStructureReference = m_blas[scene.getMeshIndex(i)].address;
+        instances[i] = instance;
+    }
+    for (uint32_t i = count; i < m_instanceCount; i++)
+    {
+        instances[i] = {}; // Mask 0: never hit
+        instances[i].accelerationStructureReference = m_blas[0].address;
+    }
+}
+
+void RayQueryScene::recordUpdate(VkCommandBuffer cmd, uint32_t frameIndex, const Scene &scene)
+{
+    if (!hasGeometry())
+        return;
+    frameIndex %= kFramesInFlight;
+
+    if (!m_blasBuilt)
+    {
+        std::vector<const VkAccelerationStructureBuildRangeInfoKHR *> ranges(m_blasRanges.size());
+        for (size_t i = 0; i < ranges.size(); i++)
+        {
+            ranges[i] = &m_blasRanges[i];
+        }
+        m_cmdBuild(cmd, static_cast<uint32_t>(m_blasBuilds.size()), m_blasBuilds.data(), ranges.data());
+        m_blasBuilt = true;
+        // The top level reads them, and reuses their scratch
+        memoryBarrier(cmd, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+                      VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                      VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
+    }
+
+    const uint64_t version = scene.getTransformVersion();
+    if (m_tlasBuilt && version == m_builtTransformVersion)
+        return;
+
+    const bool refit = m_tlasBuilt && m_refitsSinceRebuild < kRefitsPerRebuild;
+    writeInstances(frameIndex, scene);
+
+    // Earlier frames' traces read the structure this rewrites
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0);
+
+    VkAccelerationStructureGeometryKHR instances{};
+    instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    instances.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    instances.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    instances.geometry.instances.arrayOfPointers = VK_FALSE;
+    instances.geometry.instances.data.deviceAddress = m_instanceAddresses[frameIndex];
+
+    VkAccelerationStructureBuildGeometryInfoKHR build{};
+    build.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    build.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    build.flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    build.mode = refit ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    build.srcAccelerationStructure = refit ? m_tlas.handle : VK_NULL_HANDLE;
+    build.dstAccelerationStructure = m_tlas.handle;
+    build.geometryCount = 1;
+    build.pGeometries = &instances;
+    build.scratchData.deviceAddress = m_scratchAddress;
+
+    VkAccelerationStructureBuildRangeInfoKHR range{};
+    range.primitiveCount = m_instanceCount;
+    const VkAccelerationStructureBuildRangeInfoKHR *ranges = &range;
+    m_cmdBuild(cmd, 1, &build, &ranges);
+
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+
+    if (refit)
+    {
+        m_refitsSinceRebuild++;
+        m_refitCount++;
+    }
+    else
+    {
+        m_refitsSinceRebuild = 0;
+        m_rebuildCount++;
+    }
+    m_tlasBuilt = true;
+    m_builtTransformVersion = version;
+}
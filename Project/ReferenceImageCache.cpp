@@ -0,0 +1,300 @@
+#include "ReferenceImageCache.h"
+#include "CpuProfiler.h"
+#include "ThreadAffinity.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+namespace
+{
+    constexpr uint64_t kVersion = 1; // Part of every scene hash: bump when references must be rendered again
+
+    // FNV-1a over the bytes of each value
+    struct Hasher
+    {
+        uint64_t hash = 14695981039346656037ull;
+
+        void bytes(const void *data, size_t size)
+        {
+            const uint8_t *p = static_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ p[i]) * 1099511628211ull;
+            }
+        }
+        template <typename T>
+        void add(const T &value) { bytes(&value, sizeof(value)); }
+    };
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+ReferenceImageCache::ReferenceImageCache(std::string directory)
+    : m_directory(std::move(directory))
+{
+    m_worker = std::thread(&ReferenceImageCache::workerLoop, this);
+}
+
+ReferenceImageCache::~ReferenceImageCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_worker.join();
+}
+
+// ============================================================================
+// KEYS
+// ============================================================================
+
+uint64_t ReferenceImageCache::hashScene(const WaterTestConfig &config, const DeterministicCameraPath &path,
+                                        VkExtent2D extent, double fixedStep)
+{
+    Hasher hasher;
+    hasher.add(kVersion);
+    hasher.add(static_cast<int>(config.turbidity));
+    hasher.add(static_cast<int>(config.depth));
+    hasher.add(static_cast<int>(config.lightMotion));
+    hasher.add(config.totalFrames);
+    hasher.add(extent.width);
+    hasher.add(extent.height);
+    hasher.add(fixedStep);
+    // The path itself rather than its file name: an edited file or preset renders other frames
+    hasher.add(path.constantSpeed);
+    for (const CameraKeyframe &keyframe : path.getKeyframes())
+    {
+        hasher.add(keyframe.position.x);
+        hasher.add(keyframe.position.y);
+        hasher.add(keyframe.position.z);
+        hasher.add(keyframe.yaw);
+        hasher.add(keyframe.pitch);
+        hasher.add(keyframe.timestamp);
+    }
+    return hasher.hash;
+}
+
+ReferenceKey ReferenceImageCache::makeKey(uint64_t sceneHash, const DeterministicCameraPath &path, uint32_t frame,
+                                          int totalFrames)
+{
+    ReferenceKey key;
+    key.sceneHash = sceneHash;
+    key.frame = frame;
+    const float t = totalFrames > 0 ? static_cast<float>(frame) / totalFrames : 0.0f;
+    const std::vector<CameraKeyframe> &keyframes = path.getKeyframes();
+    while (key.keyframe + 1 < keyframes.size() && keyframes[key.keyframe + 1].timestamp <= t)
+    {
+        ++key.keyframe;
+    }
+    return key;
+}
+
+WaterTestConfig ReferenceImageCache::referenceConfig(const WaterTestConfig &config)
+{
+    WaterTestConfig reference;
+    reference.name = config.name + "_Reference";
+    reference.turbidity = config.turbidity;
+    reference.depth = config.depth;
+    reference.lightMotion = config.lightMotion;
+    reference.cameraPathFile = config.cameraPathFile;
+    reference.totalFrames = config.totalFrames;
+    reference.renderingMode = RenderingMode::PB;
+    reference.sampleCount = 16;
+    reference.causticRayCount = 256;
+    reference.halfResGodRays = false;
+    reference.shadowQuality = ShadowTier::High;
+    reference.shadowRoundRobin = false;
+    reference.reflections = ReflectionTier::Planar;
+    reference.offscreenUpdateInterval = 1;
+    reference.froxelVolumetrics = true;
+    reference.tilingEnabled = false;
+    reference.variableRateShading = false;
+    reference.msaaSamples = 0; // The device's maximum
+    reference.clockMode = FrameClock::Mode::FixedStep;
+    return reference;
+}
+
+std::vector<uint32_t> ReferenceImageCache::referenceFrames(const WaterTestConfig &config)
+{
+    std::vector<uint32_t> frames;
+    for (uint32_t frame = 0; frame < static_cast<uint32_t>(std::max(config.totalFrames, 0)); frame += kFrameInterval)
+    {
+        if (isReferenceFrame(config, frame))
+            frames.push_back(frame);
+    }
+    return frames;
+}
+
+bool ReferenceImageCache::isReferenceFrame(const WaterTestConfig &config, uint32_t frame)
+{
+    // Runs with an adaptive warm-up are measured from their first frame
+    const uint32_t firstFrame = config.adaptiveWarmup ? 0u : static_cast<uint32_t>(std::max(config.warmupFrames, 0));
+    return config.clockMode == FrameClock::Mode::FixedStep && frame % kFrameInterval == 0 && frame >= firstFrame &&
+           frame < static_cast<uint32_t>(std::max(config.totalFrames, 0));
+}
+
+std::string ReferenceImageCache::getPath(const ReferenceKey &key) const
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx/k%03u_f%05u.png", static_cast<unsigned long long>(key.sceneHash),
+                  key.keyframe, key.frame);
+    return m_directory + "/" + name;
+}
+
+bool ReferenceImageCache::exists(const ReferenceKey &key) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto queued = m_queued.find(key);
+        if (m_resident.count(key) || (queued != m_queued.end() && queued->second))
+            return true;
+    }
+    std::error_code error;
+    return std::filesystem::exists(getPath(key), error);
+}
+
+// ============================================================================
+// RESIDENCY
+// ============================================================================
+
+void ReferenceImageCache::prefetch(const ReferenceKey &key)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_resident.count(key) || m_queued.count(key))
+            return;
+        m_queued[key] = false;
+        m_jobs.push_back({key, nullptr});
+    }
+    m_wake.notify_one();
+}
+
+std::shared_ptr<const FrameReadbackImage> ReferenceImageCache::find(const ReferenceKey &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_resident.find(key);
+    if (it == m_resident.end())
+        return nullptr;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return it->second.image;
+}
+
+void ReferenceImageCache::store(const ReferenceKey &key, FrameReadbackImage image)
+{
+    auto shared = std::make_shared<const FrameReadbackImage>(std::move(image));
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        insertLocked(key, shared);
+        m_queued[key] = true;
+        m_jobs.push_back({key, std::move(shared)});
+    }
+    m_wake.notify_one();
+}
+
+void ReferenceImageCache::insertLocked(const ReferenceKey &key, std::shared_ptr<const FrameReadbackImage> image)
+{
+    auto it = m_resident.find(key);
+    if (it != m_resident.end())
+    {
+        m_residentBytes -= it->second.image->pixels.size();
+        m_lru.erase(it->second.lru);
+        m_resident.erase(it);
+    }
+    m_residentBytes += image->pixels.size();
+    m_lru.push_front(key);
+    m_resident[key] = {std::move(image), m_lru.begin()};
+
+    // The newest stays even alone over the budget
+    while (m_residentBytes > kMaxResidentBytes && m_lru.size() > 1)
+    {
+        auto oldest = m_resident.find(m_lru.back());
+        m_residentBytes -= oldest->second.image->pixels.size();
+        m_resident.erase(oldest);
+        m_lru.pop_back();
+    }
+}
+
+uint32_t ReferenceImageCache::getPendingJobs() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_jobs.size()) + m_working;
+}
+
+size_t ReferenceImageCache::getResidentBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_residentBytes;
+}
+
+// ============================================================================
+// WORKER THREAD
+// ============================================================================
+
+void ReferenceImageCache::workerLoop()
+{
+    CPU_THREAD_NAME("Reference images");
+    ThreadAffinity::pinCurrentThread(ThreadRole::Service);
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Drain the queue before honouring m_stop so no reference is lost
+            m_wake.wait(lock, [this]
+                        { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_working++;
+        }
+
+        const std::string path = getPath(job.key);
+        std::shared_ptr<const FrameReadbackImage> decoded;
+        if (job.image)
+        {
+            CPU_ZONE("ReferenceImageCache::encode");
+            std::error_code error;
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+            const FrameReadbackImage &image = *job.image;
+            const int width = static_cast<int>(image.width);
+            if (!stbi_write_png(path.c_str(), width, static_cast<int>(image.height), 4, image.pixels.data(), width * 4))
+            {
+                std::cerr << "[ReferenceImageCache] Failed to write " << path << "\n";
+            }
+        }
+        else
+        {
+            CPU_ZONE("ReferenceImageCache::decode");
+            int width = 0, height = 0, channels = 0;
+            if (stbi_uc *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4))
+            {
+                auto image = std::make_shared<FrameReadbackImage>();
+                image->width = static_cast<uint32_t>(width);
+                image->height = static_cast<uint32_t>(height);
+                image->pixels.assign(pixels, pixels + size_t(width) * height * 4);
+                stbi_image_free(pixels);
+                decoded = std::move(image);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // A store while the decode ran is newer than the file
+        if (decoded && !m_resident.count(job.key))
+        {
+            insertLocked(job.key, std::move(decoded));
+        }
+        auto queued = m_queued.find(job.key);
+        if (queued != m_queued.end() && queued->second == static_cast<bool>(job.image))
+        {
+            m_queued.erase(queued);
+        }
+        m_working--;
+    }
+}
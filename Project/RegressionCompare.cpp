@@ -0,0 +1,382 @@
+#include "RegressionCompare.h"
+#include "FrameMetricsLog.h"
+#include "WaterTestingSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <set>
+#include <sstream>
+
+namespace
+{
+    // Same rule as WaterTestingSystem::aggregateMetrics: mean +- 5 sigma of the run's measured frames
+    void appendCleanRun(std::vector<double> &out, const std::vector<double> &run)
+    {
+        if (run.empty())
+            return;
+        const double mean = std::accumulate(run.begin(), run.end(), 0.0) / run.size();
+        double sum = 0.0;
+        for (double v : run)
+        {
+            sum += (v - mean) * (v - mean);
+        }
+        const double stddev = run.size() > 1 ? std::sqrt(sum / (run.size() - 1)) : 0.0;
+        for (double v : run)
+        {
+            if (!WaterTestingSystem::isOutlier(v, mean, stddev, 5.0))
+                out.push_back(v);
+        }
+    }
+
+    // Consecutive frames with the same config and run index form one run
+    class RunGrouper
+    {
+    public:
+        explicit RunGrouper(FrameTimeSamples &samples) : m_samples(samples) {}
+        ~RunGrouper() { finish(); }
+
+        void add(const std::string &config, int run, double frameTimeMs)
+        {
+            if (config != m_config || run != m_run)
+            {
+                finish();
+                m_config = config;
+                m_run = run;
+            }
+            m_frames.push_back(frameTimeMs);
+        }
+
+        void finish()
+        {
+            if (!m_frames.empty())
+                appendCleanRun(m_samples[m_config], m_frames);
+            m_frames.clear();
+        }
+
+    private:
+        FrameTimeSamples &m_samples;
+        std::string m_config;
+        int m_run = -1;
+        std::vector<double> m_frames;
+    };
+
+    std::vector<std::string> splitCSVLine(const std::string &line)
+    {
+        // Fields as written by TestReportGenerator::escapeCSV
+        std::vector<std::string> fields(1);
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            const char c = line[i];
+            if (quoted)
+            {
+                if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+                {
+                    fields.back() += '"';
+                    i++;
+                }
+                else if (c == '"')
+                    quoted = false;
+                else
+                    fields.back() += c;
+            }
+            else if (c == '"')
+                quoted = true;
+            else if (c == ',')
+                fields.emplace_back();
+            else if (c != '\r')
+                fields.back() += c;
+        }
+        return fields;
+    }
+
+    bool loadFrameTimesCSV(const std::string &path, FrameTimeSamples &samples)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            std::cerr << "[Regression] Failed to open " << path << "\n";
+            return false;
+        }
+
+        std::string line;
+        std::getline(file, line);
+        const std::vector<std::string> header = splitCSVLine(line);
+        auto column = [&header](const char *name)
+        {
+            auto it = std::find(header.begin(), header.end(), name);
+            return it == header.end() ? -1 : static_cast<int>(it - header.begin());
+        };
+        const int configColumn = column("Config");
+        const int runColumn = column("Run");
+        const int frameTimeColumn = column("FrameTime_ms");
+        const int warmupColumn = column("IsWarmup");
+        if (configColumn < 0 || runColumn < 0 || frameTimeColumn < 0 || warmupColumn < 0)
+        {
+            std::cerr << "[Regression] " << path << " has no Config/Run/FrameTime_ms/IsWarmup columns\n";
+            return false;
+        }
+        const size_t needed = static_cast<size_t>(std::max({configColumn, runColumn, frameTimeColumn, warmupColumn})) + 1;
+
+        RunGrouper grouper(samples);
+        while (std::getline(file, line))
+        {
+            const std::vector<std::string> fields = splitCSVLine(line);
+            if (fields.size() < needed || fields[warmupColumn] == "1")
+                continue;
+            try
+            {
+                grouper.add(fields[configColumn], std::stoi(fields[runColumn]), std::stod(fields[frameTimeColumn]));
+            }
+            catch (const std::exception &)
+            {
+                // Malformed row: skipped
+            }
+        }
+        return true;
+    }
+
+    double mean(const std::vector<double> &values)
+    {
+        return values.empty() ? 0.0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    }
+
+    // Nearest rank below, as WaterTestingSystem::calculatePercentile
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+            return 0.0;
+        const size_t index = static_cast<size_t>((p / 100.0) * (values.size() - 1));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    double changePct(double baseline, double candidate)
+    {
+        return baseline > 0.0 ? (candidate - baseline) / baseline * 100.0 : 0.0;
+    }
+
+    const char *verdictName(RegressionVerdict verdict)
+    {
+        switch (verdict)
+        {
+        case RegressionVerdict::Pass:
+            return "PASS";
+        case RegressionVerdict::Regressed:
+            return "REGRESSED";
+        case RegressionVerdict::MissingInCandidate:
+            return "MISSING";
+        case RegressionVerdict::NewInCandidate:
+            return "NEW";
+        }
+        return "";
+    }
+}
+
+// ============================================================================
+// REPORT
+// ============================================================================
+
+int RegressionReport::failureCount() const
+{
+    return static_cast<int>(std::count_if(results.begin(), results.end(), [](const RegressionResult &r)
+                                          { return r.verdict == RegressionVerdict::Regressed ||
+                                                   r.verdict == RegressionVerdict::MissingInCandidate; }));
+}
+
+bool RegressionReport::passed() const
+{
+    return failureCount() == 0;
+}
+
+// ============================================================================
+// LOADING
+// ============================================================================
+
+bool RegressionCompare::loadFrameTimes(const std::string &path, FrameTimeSamples &samples)
+{
+    const bool log = path.size() >= 5 && path.compare(path.size() - 5, 5, ".xrfm") == 0;
+    if (!log)
+        return loadFrameTimesCSV(path, samples);
+
+    RunGrouper grouper(samples);
+    return FrameMetricsLog::read(path, [&grouper](const std::string &configName, const FrameLogFrameRecord &record)
+                                 {
+                                     if ((record.flags & FrameLogFrameRecord::kFlagWarmup) == 0)
+                                         grouper.add(configName, record.runIndex, record.frameTimeMs); });
+}
+
+FrameTimeSamples RegressionCompare::collectFrameTimes(const std::vector<TestRunResult> &runs)
+{
+    FrameTimeSamples samples;
+    for (const TestRunResult &run : runs)
+    {
+        std::vector<double> frameTimes;
+        for (const FrameMetrics &m : run.frameMetrics)
+        {
+            if (!m.isWarmupFrame)
+                frameTimes.push_back(m.frameTimeMs);
+        }
+        appendCleanRun(samples[run.config.name], frameTimes);
+    }
+    return samples;
+}
+
+// ============================================================================
+// STATISTICS
+// ============================================================================
+
+double RegressionCompare::mannWhitneyGreater(const std::vector<double> &baseline, const std::vector<double> &candidate)
+{
+    const double n1 = static_cast<double>(baseline.size());
+    const double n2 = static_cast<double>(candidate.size());
+    if (baseline.empty() || candidate.empty())
+        return 1.0;
+
+    std::vector<std::pair<double, bool>> pooled; // (value, from candidate)
+    pooled.reserve(baseline.size() + candidate.size());
+    for (double v : baseline)
+        pooled.emplace_back(v, false);
+    for (double v : candidate)
+        pooled.emplace_back(v, true);
+    std::sort(pooled.begin(), pooled.end());
+
+    // Rank sum of the candidate, ties sharing their average rank
+    double candidateRankSum = 0.0;
+    double tieTerm = 0.0;
+    for (size_t i = 0; i < pooled.size();)
+    {
+        size_t j = i;
+        size_t fromCandidate = 0;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first)
+        {
+            fromCandidate += pooled[j].second ? 1 : 0;
+            j++;
+        }
+        const double ties = static_cast<double>(j - i);
+        const double averageRank = (static_cast<double>(i + 1) + static_cast<double>(j)) / 2.0;
+        candidateRankSum += averageRank * fromCandidate;
+        tieTerm += ties * ties * ties - ties;
+        i = j;
+    }
+
+    const double n = n1 + n2;
+    const double u = candidateRankSum - n2 * (n2 + 1.0) / 2.0;
+    const double meanU = n1 * n2 / 2.0;
+    const double varianceU = n1 * n2 / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+    if (varianceU <= 0.0)
+        return 1.0; // Every value equal
+
+    const double z = (u - meanU - 0.5) / std::sqrt(varianceU);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+RegressionReport RegressionCompare::compare(const FrameTimeSamples &baseline, const FrameTimeSamples &candidate,
+                                            const RegressionThresholds &thresholds)
+{
+    RegressionReport report;
+    report.thresholds = thresholds;
+
+    std::set<std::string> names;
+    for (const auto &[name, frames] : baseline)
+        names.insert(name);
+    for (const auto &[name, frames] : candidate)
+        names.insert(name);
+
+    static const std::vector<double> kNone;
+    for (const std::string &name : names)
+    {
+        auto b = baseline.find(name);
+        auto c = candidate.find(name);
+        const std::vector<double> &base = b != baseline.end() ? b->second : kNone;
+        const std::vector<double> &cand = c != candidate.end() ? c->second : kNone;
+
+        RegressionResult result;
+        result.configName = name;
+        result.baselineFrames = base.size();
+        result.candidateFrames = cand.size();
+        result.baselineMean = mean(base);
+        result.candidateMean = mean(cand);
+        result.baselineP99 = percentile(base, 99.0);
+        result.candidateP99 = percentile(cand, 99.0);
+
+        if (base.empty())
+        {
+            result.verdict = RegressionVerdict::NewInCandidate;
+        }
+        else if (cand.empty())
+        {
+            result.verdict = RegressionVerdict::MissingInCandidate;
+        }
+        else
+        {
+            result.meanChangePct = changePct(result.baselineMean, result.candidateMean);
+            result.p99ChangePct = changePct(result.baselineP99, result.candidateP99);
+            result.pValue = mannWhitneyGreater(base, cand);
+
+            const bool significant = result.pValue < thresholds.significance;
+            const bool beyondThreshold = result.meanChangePct > thresholds.maxMeanIncreasePct ||
+                                         result.p99ChangePct > thresholds.maxP99IncreasePct;
+            result.verdict = significant && beyondThreshold ? RegressionVerdict::Regressed : RegressionVerdict::Pass;
+        }
+        report.results.push_back(result);
+    }
+    return report;
+}
+
+// ============================================================================
+// OUTPUT
+// ============================================================================
+
+bool RegressionCompare::writeReport(const RegressionReport &report, const std::string &csvPath)
+{
+    std::ofstream file(csvPath);
+    if (!file.is_open())
+    {
+        std::cerr << "[Regression] Failed to open " << csvPath << "\n";
+        return false;
+    }
+
+    file << "Config,Verdict,BaselineFrames,CandidateFrames,BaselineMean_ms,CandidateMean_ms,MeanChange_pct,"
+         << "BaselineP99_ms,CandidateP99_ms,P99Change_pct,PValue\n";
+    for (const RegressionResult &r : report.results)
+    {
+        file << TestReportGenerator::escapeCSV(r.configName) << ","
+             << verdictName(r.verdict) << ","
+             << r.baselineFrames << ","
+             << r.candidateFrames << ","
+             << std::fixed << std::setprecision(3)
+             << r.baselineMean << ","
+             << r.candidateMean << ","
+             << std::setprecision(2) << r.meanChangePct << ","
+             << std::setprecision(3) << r.baselineP99 << ","
+             << r.candidateP99 << ","
+             << std::setprecision(2) << r.p99ChangePct << ","
+             << std::scientific << std::setprecision(3) << r.pValue << std::defaultfloat << "\n";
+    }
+    file << "Result," << (report.passed() ? "PASS" : "FAIL") << "," << report.failureCount() << " failing\n";
+    return true;
+}
+
+void RegressionCompare::printReport(const RegressionReport &report)
+{
+    for (const RegressionResult &r : report.results)
+    {
+        std::ostringstream line;
+        line << "[Regression] " << std::left << std::setw(10) << verdictName(r.verdict) << r.configName;
+        if (r.verdict == RegressionVerdict::Pass || r.verdict == RegressionVerdict::Regressed)
+        {
+            line << std::fixed << std::setprecision(2) << "  mean " << std::showpos << r.meanChangePct << "%"
+                 << "  p99 " << r.p99ChangePct << "%" << std::noshowpos
+                 << std::scientific << std::setprecision(2) << "  p=" << r.pValue;
+        }
+        std::cout << line.str() << "\n";
+    }
+    std::cout << "[Regression] " << (report.passed() ? "PASS" : "FAIL") << ": " << report.failureCount() << " of "
+              << report.results.size() << " configs failing (mean > +" << report.thresholds.maxMeanIncreasePct
+              << "% or p99 > +" << report.thresholds.maxP99IncreasePct << "% at p < "
+              << report.thresholds.significance << ")\n";
+}
@@ -0,0 +1,1147 @@
+#include "RenderGraph.h"
+#include "CpuProfiler.h"
+#include "GpuMemoryAllocator.h"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace
+{
+    constexpr VkAccessFlags kWriteAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                           VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+}
+
+// ============================================================================
+// PASS BUILDER
+// ============================================================================
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::color(RenderGraphResource image, VkAttachmentLoadOp loadOp, VkClearColorValue clear)
+{
+    ImageUse use{};
+    use.image = image;
+    use.type = UseType::Color;
+    use.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    use.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    use.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    use.read = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+    use.write = true;
+    use.loadOp = loadOp;
+    use.clear.color = clear;
+    m_graph.m_passes[m_passIndex].uses.push_back(use);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::depth(RenderGraphResource image, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clear)
+{
+    ImageUse use{};
+    use.image = image;
+    use.type = UseType::Depth;
+    use.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    use.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    use.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    use.read = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+    use.write = true;
+    use.loadOp = loadOp;
+    use.clear.depthStencil = clear;
+    m_graph.m_passes[m_passIndex].uses.push_back(use);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::resolve(RenderGraphResource image)
+{
+    ImageUse use{};
+    use.image = image;
+    use.type = UseType::Resolve;
+    use.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    use.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    use.access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    use.read = false;
+    use.write = true;
+    m_graph.m_passes[m_passIndex].uses.push_back(use);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::sampled(RenderGraphResource image, VkPipelineStageFlags stages, VkImageLayout layout)
+{
+    ImageUse use{};
+    use.image = image;
+    use.type = UseType::Sampled;
+    use.layout = layout;
+    use.stages = stages;
+    use.access = VK_ACCESS_SHADER_READ_BIT;
+    use.read = true;
+    use.write = false;
+    m_graph.m_passes[m_passIndex].uses.push_back(use);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::storage(RenderGraphResource image, VkPipelineStageFlags stages, bool write)
+{
+    // write: the pass overwrites the image, so earlier contents are not needed
+    ImageUse use{};
+    use.image = image;
+    use.type = UseType::Storage;
+    use.layout = VK_IMAGE_LAYOUT_GENERAL;
+    use.stages = stages;
+    use.access = write ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+    use.read = !write;
+    use.write = write;
+    m_graph.m_passes[m_passIndex].uses.push_back(use);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::transferSource(RenderGraphResource image)
+{
+    ImageUse use{};
+    use.image = image;
+    use.type = UseType::Transfer;
+    use.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    use.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    use.access = VK_ACCESS_TRANSFER_READ_BIT;
+    use.read = true;
+    use.write = false;
+    m_graph.m_passes[m_passIndex].uses.push_back(use);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::transferDestination(RenderGraphResource image)
+{
+    ImageUse use{};
+    use.image = image;
+    use.type = UseType::Transfer;
+    use.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    use.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    use.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+    use.read = false;
+    use.write = true;
+    m_graph.m_passes[m_passIndex].uses.push_back(use);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::secondaryContents(bool secondary)
+{
+    m_graph.m_passes[m_passIndex].secondary = secondary;
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::sideEffect()
+{
+    m_graph.m_passes[m_passIndex].sideEffect = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::renderPassOnly()
+{
+    m_graph.m_passes[m_passIndex].renderPassOnly = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::viewMask(uint32_t mask)
+{
+    m_graph.m_passes[m_passIndex].viewMask = mask;
+    return *this;
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+RenderGraph::RenderGraph(VkDevice device, uint32_t frameCount, GpuProfiler *profiler, GpuCounters *counters)
+    : m_device(device), m_frameCount(frameCount), m_profiler(profiler), m_counters(counters)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+    invalidate();
+}
+
+void RenderGraph::invalidate()
+{
+    for (auto &entry : m_framebuffers)
+    {
+        vkDestroyFramebuffer(m_device, entry.second, nullptr);
+    }
+    m_framebuffers.clear();
+
+    for (auto &entry : m_renderPasses)
+    {
+        vkDestroyRenderPass(m_device, entry.second, nullptr);
+    }
+    m_renderPasses.clear();
+
+    for (auto &physical : m_physicalImages)
+    {
+        destroyPhysicalImage(physical);
+    }
+    m_physicalImages.clear();
+    m_memorySlots.clear();
+
+    for (auto &resource : m_resources)
+    {
+        resource.physical = -1;
+    }
+}
+
+// ============================================================================
+// DECLARATION
+// ============================================================================
+
+void RenderGraph::beginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= m_frameCount)
+    {
+        throw std::out_of_range("RenderGraph frame index out of range!");
+    }
+    m_frameIndex = frameIndex;
+
+    // A physical image unused for a full round of frames is no longer referenced by any in-flight frame
+    for (size_t i = m_physicalImages.size(); i-- > 0;)
+    {
+        if (m_physicalImages[i].idleFrames >= m_frameCount)
+        {
+            destroyPhysicalImage(m_physicalImages[i]);
+            m_physicalImages.erase(m_physicalImages.begin() + i);
+
+            // Its last use has completed by now: the next occupant need not wait on it
+            const int32_t erased = static_cast<int32_t>(i);
+            for (MemorySlot &slot : m_memorySlots)
+            {
+                if (slot.occupant == erased)
+                    slot.occupant = -1;
+                else if (slot.occupant > erased)
+                    slot.occupant--;
+            }
+        }
+    }
+
+    m_resources.clear();
+    m_passes.clear();
+    m_splitPass = UINT32_MAX;
+}
+
+RenderGraphResource RenderGraph::importImage(const char *name, VkImage image, VkImageView view, const RenderGraphImageDesc &desc,
+                                             const RenderGraphImageState &initial, const RenderGraphImageState &final)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = true;
+    resource.image = image;
+    resource.view = view;
+    resource.final = final;
+
+    resource.track.layout = initial.layout;
+    if (initial.access & kWriteAccess)
+    {
+        resource.track.writeStages = initial.stages;
+        resource.track.writeAccess = initial.access & kWriteAccess;
+    }
+    else
+    {
+        resource.track.readStages = initial.stages;
+    }
+
+    m_resources.push_back(resource);
+    return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createImage(const char *name, const RenderGraphImageDesc &desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    m_resources.push_back(resource);
+    return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::markOutput(RenderGraphResource image)
+{
+    resource(image).output = true;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const char *name, ExecuteFn execute)
+{
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    m_passes.push_back(std::move(pass));
+    return PassBuilder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+}
+
+RenderGraph::PassBuilder RenderGraph::addOverlay(const char *name, RenderGraphResource target, ExecuteFn execute)
+{
+    PassBuilder builder = addPass(name, std::move(execute));
+    builder.color(target, VK_ATTACHMENT_LOAD_OP_LOAD);
+    m_passes.back().overlay = true;
+    return builder;
+}
+
+RenderGraph::Resource &RenderGraph::resource(RenderGraphResource image)
+{
+    if (image >= m_resources.size())
+    {
+        throw std::out_of_range("RenderGraph resource out of range!");
+    }
+    return m_resources[image];
+}
+
+// ============================================================================
+// COMPILE
+// ============================================================================
+
+void RenderGraph::cullPasses()
+{
+    // Walk backwards: a pass lives if a live consumer (or the frame's output) needs what it writes
+    std::vector<bool> needed(m_resources.size(), false);
+    for (size_t i = 0; i < m_resources.size(); i++)
+    {
+        needed[i] = m_resources[i].output;
+    }
+
+    for (size_t p = m_passes.size(); p-- > 0;)
+    {
+        Pass &pass = m_passes[p];
+        pass.alive = pass.sideEffect;
+        for (const ImageUse &use : pass.uses)
+        {
+            resource(use.image); // Validates the handle
+            pass.alive = pass.alive || (use.write && needed[use.image]);
+        }
+        if (!pass.alive)
+            continue;
+
+        // A full overwrite ends the previous contents' lifetime, a read extends it
+        for (const ImageUse &use : pass.uses)
+        {
+            if (use.write && !use.read)
+                needed[use.image] = false;
+        }
+        for (const ImageUse &use : pass.uses)
+        {
+            if (use.read)
+                needed[use.image] = true;
+        }
+    }
+
+    for (uint32_t p = 0; p < m_passes.size(); p++)
+    {
+        if (!m_passes[p].alive)
+            continue;
+
+        for (const ImageUse &use : m_passes[p].uses)
+        {
+            Resource &res = m_resources[use.image];
+            if (!res.imported && res.firstUse == UINT32_MAX && use.read)
+            {
+                throw std::runtime_error("RenderGraph: transient image '" + res.name + "' is read before it is written!");
+            }
+            res.firstUse = std::min(res.firstUse, p);
+            res.lastUse = std::max(res.lastUse, p);
+            if (use.read)
+            {
+                res.lastRead = std::max(res.lastRead, p + 1);
+            }
+        }
+    }
+}
+
+void RenderGraph::assignTransients()
+{
+    std::vector<uint32_t> transients;
+    for (uint32_t i = 0; i < m_resources.size(); i++)
+    {
+        if (!m_resources[i].imported && m_resources[i].firstUse != UINT32_MAX)
+            transients.push_back(i);
+    }
+    std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b)
+              { return m_resources[a].firstUse < m_resources[b].firstUse; });
+
+    for (auto &physical : m_physicalImages)
+    {
+        physical.busyUntil = 0;
+    }
+    for (auto &slot : m_memorySlots)
+    {
+        slot.busy.clear();
+    }
+
+    for (uint32_t index : transients)
+    {
+        Resource &res = m_resources[index];
+        const uint32_t end = res.lastUse + 1;
+
+        // Reuse any identical image whose previous logical owner is done before this one starts,
+        // and whose memory no other image needs meanwhile
+        int32_t chosen = -1;
+        for (size_t p = 0; p < m_physicalImages.size(); p++)
+        {
+            const PhysicalImage &physical = m_physicalImages[p];
+            if (physical.desc == res.desc && physical.busyUntil <= res.firstUse && isSlotFree(physical.slot, res.firstUse, end))
+            {
+                chosen = static_cast<int32_t>(p);
+                break;
+            }
+        }
+
+        if (chosen < 0)
+        {
+            PhysicalImage physical;
+            physical.desc = res.desc;
+            createPhysicalImage(physical, res.firstUse, end);
+            m_physicalImages.push_back(physical);
+            chosen = static_cast<int32_t>(m_physicalImages.size() - 1);
+        }
+
+        PhysicalImage &physical = m_physicalImages[chosen];
+        physical.busyUntil = end;
+        if (physical.slot >= 0)
+        {
+            m_memorySlots[physical.slot].busy.push_back({res.firstUse, end});
+        }
+        res.physical = chosen;
+        res.image = physical.image;
+        res.view = physical.view;
+
+        m_stats.transientImages++;
+        m_stats.transientBytes += physical.size;
+    }
+
+    VkDeviceSize backingBytes = 0;
+    for (auto &physical : m_physicalImages)
+    {
+        if (physical.busyUntil > 0)
+        {
+            physical.idleFrames = 0;
+            m_stats.physicalImages++;
+            backingBytes += physical.slot < 0 ? physical.size : 0;
+            m_stats.lazyBytes += physical.lazy ? physical.size : 0;
+        }
+        else
+        {
+            physical.idleFrames++;
+        }
+    }
+    for (const auto &slot : m_memorySlots)
+    {
+        if (!slot.busy.empty())
+        {
+            m_stats.memorySlots++;
+            backingBytes += slot.allocation.size;
+        }
+    }
+    // Bytes backing the transients vs. what separate images would have needed
+    m_stats.aliasedBytes = m_stats.transientBytes - std::min(backingBytes, m_stats.transientBytes);
+}
+
+bool RenderGraph::isSlotFree(int32_t slot, uint32_t first, uint32_t end) const
+{
+    if (slot < 0)
+        return true;
+
+    for (const auto &busy : m_memorySlots[slot].busy)
+    {
+        if (first < busy.second && busy.first < end)
+            return false;
+    }
+    return true;
+}
+
+void RenderGraph::mergeOverlays()
+{
+    for (uint32_t o = 0; o < m_passes.size(); o++)
+    {
+        Pass &overlay = m_passes[o];
+        if (!overlay.overlay || !overlay.alive)
+            continue;
+
+        // Only the latest live pass on the image can host it: nothing may come between
+        const RenderGraphResource target = overlay.uses.front().image;
+        for (uint32_t h = o; h-- > 0;)
+        {
+            Pass &host = m_passes[h];
+            const bool usesTarget = std::any_of(host.uses.begin(), host.uses.end(), [target](const ImageUse &use)
+                                                { return use.image == target; });
+            if (!host.alive || !usesTarget)
+                continue;
+
+            uint32_t attachments = 0;
+            bool targetIsColor = false;
+            for (const ImageUse &use : host.uses)
+            {
+                if (use.type == UseType::Color || use.type == UseType::Depth || use.type == UseType::Resolve)
+                    attachments++;
+                targetIsColor = targetIsColor || (use.image == target && use.type == UseType::Color);
+            }
+            const bool sameSubmission = (h < m_splitPass) == (o < m_splitPass);
+            const bool sameBegin = usesDynamicRendering(host) == usesDynamicRendering(overlay);
+            if (attachments == 1 && targetIsColor && !host.secondary && !host.overlay && host.viewMask == 0 && sameSubmission && sameBegin)
+            {
+                overlay.mergedInto = h;
+                host.overlays.push_back(o);
+            }
+            break;
+        }
+    }
+}
+
+// ============================================================================
+// BARRIERS
+// ============================================================================
+
+RenderGraph::ImageTrack &RenderGraph::trackOf(Resource &res)
+{
+    return res.imported ? res.track : m_physicalImages[res.physical].track;
+}
+
+void RenderGraph::claimMemory(uint32_t physicalIndex)
+{
+    PhysicalImage &physical = m_physicalImages[physicalIndex];
+    if (physical.slot < 0)
+        return;
+
+    MemorySlot &slot = m_memorySlots[physical.slot];
+    const int32_t index = static_cast<int32_t>(physicalIndex);
+    if (slot.occupant == index)
+        return;
+
+    // The contents are gone; what the previous occupant did to the memory acts as the last write
+    ImageTrack &track = physical.track;
+    track = ImageTrack{};
+    if (slot.occupant >= 0)
+    {
+        const ImageTrack &previous = m_physicalImages[slot.occupant].track;
+        track.writeStages = previous.writeStages | previous.readStages;
+        track.writeAccess = previous.writeAccess;
+    }
+    slot.occupant = index;
+}
+
+bool RenderGraph::addBarrier(Resource &res, const ImageUse &use, std::vector<VkImageMemoryBarrier> &barriers,
+                             VkPipelineStageFlags &srcStages, VkPipelineStageFlags &dstStages)
+{
+    if (!res.imported)
+    {
+        claimMemory(static_cast<uint32_t>(res.physical));
+    }
+    ImageTrack &track = trackOf(res);
+    bool layoutChange = track.layout != use.layout;
+    VkPipelineStageFlags prior = track.writeStages | track.readStages;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = res.image;
+    barrier.subresourceRange = {res.desc.aspect, 0, 1, 0, VK_REMAINING_ARRAY_LAYERS};
+    barrier.oldLayout = track.layout;
+    barrier.newLayout = use.layout;
+    barrier.srcAccessMask = track.writeAccess;
+    barrier.dstAccessMask = use.access;
+
+    if (use.write || layoutChange)
+    {
+        // Write-after-write/read hazards, or a layout transition
+        if (!layoutChange && prior == 0)
+        {
+            track.writeStages = use.stages;
+            track.writeAccess = use.access & kWriteAccess;
+            return false;
+        }
+
+        // Contents being fully overwritten can be discarded by the transition
+        if (use.write && !use.read)
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        srcStages |= prior != 0 ? prior : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        dstStages |= use.stages;
+        barriers.push_back(barrier);
+
+        track.layout = use.layout;
+        if (use.write)
+        {
+            track.writeStages = use.stages;
+            track.writeAccess = use.access & kWriteAccess;
+            track.visibleStages = 0;
+            track.visibleAccess = 0;
+            track.readStages = 0;
+        }
+        else
+        {
+            // The transition itself acts as the last write, complete before these stages
+            track.writeStages = use.stages;
+            track.writeAccess = 0;
+            track.visibleStages = use.stages;
+            track.visibleAccess = use.access;
+            track.readStages = use.stages;
+        }
+        return true;
+    }
+
+    // Read in the current layout: only the last write has to be made visible, once per stage
+    bool visible = (use.stages & ~track.visibleStages) == 0 && (use.access & ~track.visibleAccess) == 0;
+    track.readStages |= use.stages;
+    if (track.writeStages == 0 || visible)
+        return false;
+
+    srcStages |= track.writeStages;
+    dstStages |= use.stages;
+    barriers.push_back(barrier);
+
+    track.visibleStages |= use.stages;
+    track.visibleAccess |= use.access;
+    return true;
+}
+
+uint32_t RenderGraph::recordBarriers(VkCommandBuffer cmd, uint32_t passIndex)
+{
+    std::vector<VkImageMemoryBarrier> barriers;
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+
+    for (const ImageUse &use : m_passes[passIndex].uses)
+    {
+        addBarrier(m_resources[use.image], use, barriers, srcStages, dstStages);
+    }
+
+    if (!barriers.empty())
+    {
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+                             static_cast<uint32_t>(barriers.size()), barriers.data());
+    }
+    return static_cast<uint32_t>(barriers.size());
+}
+
+void RenderGraph::recordFinalTransitions(VkCommandBuffer cmd)
+{
+    std::vector<VkImageMemoryBarrier> barriers;
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+
+    for (Resource &res : m_resources)
+    {
+        if (!res.imported || res.final.layout == VK_IMAGE_LAYOUT_UNDEFINED || res.track.layout == res.final.layout)
+            continue;
+
+        ImageUse use{};
+        use.layout = res.final.layout;
+        use.stages = res.final.stages != 0 ? res.final.stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        use.access = res.final.access;
+        use.read = true;
+        addBarrier(res, use, barriers, srcStages, dstStages);
+    }
+
+    if (!barriers.empty())
+    {
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+                             static_cast<uint32_t>(barriers.size()), barriers.data());
+        m_stats.barriers += static_cast<uint32_t>(barriers.size());
+    }
+}
+
+// ============================================================================
+// RENDER PASSES / FRAMEBUFFERS
+// ============================================================================
+
+bool RenderGraph::keepsContents(uint32_t passIndex, const ImageUse &use) const
+{
+    const Resource &res = m_resources[use.image];
+    return res.output || (res.imported && res.final.layout != VK_IMAGE_LAYOUT_UNDEFINED) || res.lastRead > passIndex + 1;
+}
+
+VkRenderPass RenderGraph::getRenderPass(const Pass &pass)
+{
+    // Attachment order matches the hand-made passes pipelines are built against: colours, depth, resolves
+    std::vector<const ImageUse *> attachments;
+    for (UseType type : {UseType::Color, UseType::Depth, UseType::Resolve})
+    {
+        for (const ImageUse &use : pass.uses)
+        {
+            if (use.type == type)
+                attachments.push_back(&use);
+        }
+    }
+
+    std::vector<VkAttachmentDescription> descriptions;
+    std::vector<uint32_t> key;
+    uint32_t passIndex = static_cast<uint32_t>(&pass - m_passes.data());
+    uint32_t colorCount = 0;
+    uint32_t resolveCount = 0;
+    bool hasDepth = false;
+
+    for (const ImageUse *use : attachments)
+    {
+        const Resource &res = m_resources[use->image];
+        const bool keep = keepsContents(passIndex, *use);
+
+        VkAttachmentDescription description{};
+        description.format = res.desc.format;
+        description.samples = res.desc.samples;
+        description.loadOp = use->type == UseType::Resolve ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : use->loadOp;
+        description.storeOp = keep ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.initialLayout = use->layout;
+        description.finalLayout = use->layout;
+        descriptions.push_back(description);
+
+        colorCount += use->type == UseType::Color ? 1 : 0;
+        resolveCount += use->type == UseType::Resolve ? 1 : 0;
+        hasDepth = hasDepth || use->type == UseType::Depth;
+
+        key.insert(key.end(), {static_cast<uint32_t>(use->type), static_cast<uint32_t>(description.format),
+                               static_cast<uint32_t>(description.samples), static_cast<uint32_t>(description.loadOp),
+                               static_cast<uint32_t>(description.storeOp), static_cast<uint32_t>(description.initialLayout)});
+    }
+
+    if (resolveCount != 0 && resolveCount != colorCount)
+    {
+        throw std::runtime_error("RenderGraph: pass '" + pass.name + "' needs one resolve per colour attachment!");
+    }
+    key.push_back(pass.viewMask);
+
+    auto cached = m_renderPasses.find(key);
+    if (cached != m_renderPasses.end())
+        return cached->second;
+
+    std::vector<VkAttachmentReference> colorRefs;
+    std::vector<VkAttachmentReference> resolveRefs;
+    VkAttachmentReference depthRef{};
+    for (uint32_t i = 0; i < attachments.size(); i++)
+    {
+        VkAttachmentReference ref{i, attachments[i]->layout};
+        if (attachments[i]->type == UseType::Color)
+            colorRefs.push_back(ref);
+        else if (attachments[i]->type == UseType::Resolve)
+            resolveRefs.push_back(ref);
+        else
+            depthRef = ref;
+    }
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pResolveAttachments = resolveRefs.empty() ? nullptr : resolveRefs.data();
+    subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+    renderPassInfo.pAttachments = descriptions.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    // Every view in the mask is drawn together, so they are also likely to be read together
+    VkRenderPassMultiviewCreateInfo multiviewInfo{};
+    if (pass.viewMask != 0)
+    {
+        multiviewInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+        multiviewInfo.subpassCount = 1;
+        multiviewInfo.pViewMasks = &pass.viewMask;
+        multiviewInfo.correlationMaskCount = 1;
+        multiviewInfo.pCorrelationMasks = &pass.viewMask;
+        renderPassInfo.pNext = &multiviewInfo;
+    }
+
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RenderGraph: failed to create render pass for '" + pass.name + "'!");
+    }
+    m_renderPasses[key] = renderPass;
+    return renderPass;
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView> &views, VkExtent2D extent)
+{
+    std::vector<uint64_t> key;
+    key.push_back(reinterpret_cast<uint64_t>(renderPass));
+    for (VkImageView view : views)
+    {
+        key.push_back(reinterpret_cast<uint64_t>(view));
+    }
+    key.push_back((static_cast<uint64_t>(extent.width) << 32) | extent.height);
+
+    auto cached = m_framebuffers.find(key);
+    if (cached != m_framebuffers.end())
+        return cached->second;
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RenderGraph: failed to create framebuffer!");
+    }
+    m_framebuffers[key] = framebuffer;
+    return framebuffer;
+}
+
+void RenderGraph::createPhysicalImage(PhysicalImage &physical, uint32_t first, uint32_t end)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = physical.desc.format;
+    imageInfo.extent = {physical.desc.extent.width, physical.desc.extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = physical.desc.layers;
+    imageInfo.samples = physical.desc.samples;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = physical.desc.usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &physical.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RenderGraph: failed to create transient image!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, physical.image, &requirements);
+    physical.size = requirements.size;
+
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    const VkMemoryPropertyFlags lazyProperties = properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    physical.lazy = (physical.desc.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) &&
+                    GpuMemoryAllocator::get().hasMemoryType(requirements.memoryTypeBits, lazyProperties);
+    if (physical.lazy)
+    {
+        GpuMemoryAllocator::get().allocateImage(physical.image, lazyProperties);
+    }
+    else
+    {
+        // The smallest free slot the image fits in, at an offset it can be bound at
+        int32_t chosen = -1;
+        for (size_t s = 0; s < m_memorySlots.size(); s++)
+        {
+            const GpuAllocation &allocation = m_memorySlots[s].allocation;
+            const bool fits = allocation.memory != VK_NULL_HANDLE && (requirements.memoryTypeBits & (1u << allocation.memoryTypeIndex)) &&
+                              allocation.size >= requirements.size && allocation.offset % requirements.alignment == 0;
+            if (fits && isSlotFree(static_cast<int32_t>(s), first, end) &&
+                (chosen < 0 || allocation.size < m_memorySlots[chosen].allocation.size))
+            {
+                chosen = static_cast<int32_t>(s);
+            }
+        }
+
+        if (chosen < 0)
+        {
+            auto unused = std::find_if(m_memorySlots.begin(), m_memorySlots.end(), [](const MemorySlot &slot)
+                                       { return slot.allocation.memory == VK_NULL_HANDLE; });
+            if (unused == m_memorySlots.end())
+            {
+                unused = m_memorySlots.insert(unused, MemorySlot{});
+            }
+            unused->allocation = GpuMemoryAllocator::get().allocate(requirements, properties, false, GpuMemoryCategory::RenderTarget);
+            unused->occupant = -1;
+            chosen = static_cast<int32_t>(unused - m_memorySlots.begin());
+        }
+
+        MemorySlot &slot = m_memorySlots[chosen];
+        vkBindImageMemory(m_device, physical.image, slot.allocation.memory, slot.allocation.offset);
+        slot.images++;
+        physical.slot = chosen;
+    }
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = physical.image;
+    viewInfo.viewType = physical.desc.layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = physical.desc.format;
+    // Views only ever see the depth aspect; the stencil bit is for layout transitions
+    viewInfo.subresourceRange.aspectMask = (physical.desc.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_ASPECT_DEPTH_BIT : physical.desc.aspect;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = physical.desc.layers;
+
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &physical.view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RenderGraph: failed to create transient image view!");
+    }
+}
+
+void RenderGraph::destroyPhysicalImage(PhysicalImage &physical)
+{
+    // Framebuffers built on the view go with it
+    for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();)
+    {
+        if (std::find(it->first.begin(), it->first.end(), reinterpret_cast<uint64_t>(physical.view)) != it->first.end())
+        {
+            vkDestroyFramebuffer(m_device, it->second, nullptr);
+            it = m_framebuffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (physical.view != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(m_device, physical.view, nullptr);
+        physical.view = VK_NULL_HANDLE;
+    }
+    if (physical.image != VK_NULL_HANDLE && physical.slot >= 0)
+    {
+        // The slot's memory goes with its last image
+        vkDestroyImage(m_device, physical.image, nullptr);
+        MemorySlot &slot = m_memorySlots[physical.slot];
+        if (--slot.images == 0)
+        {
+            GpuMemoryAllocator::get().free(slot.allocation);
+            slot = MemorySlot{};
+        }
+        physical.image = VK_NULL_HANDLE;
+        physical.slot = -1;
+    }
+    if (physical.image != VK_NULL_HANDLE)
+    {
+        GpuMemoryAllocator::get().destroyImage(physical.image);
+        physical.image = VK_NULL_HANDLE;
+    }
+}
+
+// ============================================================================
+// EXECUTE
+// ============================================================================
+
+void RenderGraph::recordPass(VkCommandBuffer cmd, uint32_t passIndex)
+{
+    const Pass &pass = m_passes[passIndex];
+
+    RenderGraphPassContext context{};
+    context.cmd = cmd;
+    context.contents = pass.secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+
+    std::vector<VkImageView> views;
+    std::vector<VkClearValue> clearValues;
+    for (UseType type : {UseType::Color, UseType::Depth, UseType::Resolve})
+    {
+        for (const ImageUse &use : pass.uses)
+        {
+            if (use.type != type)
+                continue;
+            const Resource &res = m_resources[use.image];
+            views.push_back(res.view);
+            clearValues.push_back(use.clear);
+            if (context.extent.width == 0)
+                context.extent = res.desc.extent;
+        }
+    }
+
+    if (views.empty())
+    {
+        pass.execute(context);
+        return;
+    }
+
+    const bool dynamic = usesDynamicRendering(pass);
+    if (dynamic)
+    {
+        beginRendering(cmd, passIndex, context);
+    }
+    else
+    {
+        context.renderPass = getRenderPass(pass);
+        context.framebuffer = getFramebuffer(context.renderPass, views, context.extent);
+
+        VkRenderPassBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        beginInfo.renderPass = context.renderPass;
+        beginInfo.framebuffer = context.framebuffer;
+        beginInfo.renderArea.extent = context.extent;
+        beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        beginInfo.pClearValues = clearValues.data();
+
+        vkCmdBeginRenderPass(cmd, &beginInfo, context.contents);
+    }
+
+    pass.execute(context);
+    for (uint32_t overlay : pass.overlays)
+    {
+        GpuProfiler::Scope scope(m_profiler, cmd, m_passes[overlay].name.c_str());
+        m_passes[overlay].execute(context);
+    }
+
+    if (dynamic)
+        DynamicRendering::end(cmd);
+    else
+        vkCmdEndRenderPass(cmd);
+}
+
+void RenderGraph::beginRendering(VkCommandBuffer cmd, uint32_t passIndex, RenderGraphPassContext &context)
+{
+    const Pass &pass = m_passes[passIndex];
+    context.formats.viewMask = pass.viewMask;
+
+    std::vector<VkRenderingAttachmentInfoKHR> colors;
+    std::vector<const ImageUse *> resolves;
+    VkRenderingAttachmentInfoKHR depth{};
+    bool hasDepth = false;
+
+    for (const ImageUse &use : pass.uses)
+    {
+        if (use.type == UseType::Resolve)
+        {
+            resolves.push_back(&use);
+            continue;
+        }
+        if (use.type != UseType::Color && use.type != UseType::Depth)
+            continue;
+
+        const Resource &res = m_resources[use.image];
+        VkRenderingAttachmentInfoKHR attachment{};
+        attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        attachment.imageView = res.view;
+        attachment.imageLayout = use.layout;
+        attachment.loadOp = use.loadOp;
+        attachment.storeOp = keepsContents(passIndex, use) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.clearValue = use.clear;
+        context.formats.samples = res.desc.samples;
+
+        if (use.type == UseType::Color)
+        {
+            colors.push_back(attachment);
+            context.formats.colorFormats.push_back(res.desc.format);
+        }
+        else
+        {
+            depth = attachment;
+            hasDepth = true;
+            context.formats.depthFormat = res.desc.format;
+        }
+    }
+
+    // The resolve targets ride on their colour attachments, in the same order as in a render pass
+    if (!resolves.empty() && resolves.size() != colors.size())
+    {
+        throw std::runtime_error("RenderGraph: pass '" + pass.name + "' needs one resolve per colour attachment!");
+    }
+    for (size_t i = 0; i < resolves.size(); i++)
+    {
+        colors[i].resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT_KHR;
+        colors[i].resolveImageView = m_resources[resolves[i]->image].view;
+        colors[i].resolveImageLayout = resolves[i]->layout;
+    }
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.flags = pass.secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+    renderingInfo.renderArea.extent = context.extent;
+    renderingInfo.layerCount = 1; // Ignored under a view mask
+    renderingInfo.viewMask = pass.viewMask;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colors.size());
+    renderingInfo.pColorAttachments = colors.data();
+    renderingInfo.pDepthAttachment = hasDepth ? &depth : nullptr;
+
+    DynamicRendering::begin(cmd, renderingInfo);
+}
+
+void RenderGraph::recordReplay(VkCommandBuffer cmd, uint32_t passIndex)
+{
+    const Pass &pass = m_passes[passIndex];
+    if (pass.secondary || std::find(m_replayPasses.begin(), m_replayPasses.end(), pass.name) == m_replayPasses.end())
+        return;
+
+    const std::string scopeName = pass.name + kReplaySuffix;
+    for (uint32_t i = 0; i < m_replayRepeat; i++)
+    {
+        GpuProfiler::Scope scope(m_profiler, cmd, scopeName.c_str());
+
+        // Nothing of the previous repeat may overlap this one
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                             1, &barrier, 0, nullptr, 0, nullptr);
+        recordBarriers(cmd, passIndex);
+        recordPass(cmd, passIndex);
+    }
+}
+
+void RenderGraph::setReplay(std::vector<std::string> passes, uint32_t repeat)
+{
+    m_replayPasses = std::move(passes);
+    m_replayRepeat = m_replayPasses.empty() ? 0 : repeat;
+}
+
+void RenderGraph::splitSubmission()
+{
+    if (m_splitPass == UINT32_MAX)
+    {
+        m_splitPass = static_cast<uint32_t>(m_passes.size());
+    }
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, VkCommandBuffer afterSplit)
+{
+    CPU_ZONE("RenderGraph::execute");
+    m_stats = RenderGraphStats{};
+    m_timings.clear();
+
+    cullPasses();
+    assignTransients();
+    mergeOverlays();
+
+    for (uint32_t p = 0; p < m_passes.size(); p++)
+    {
+        const Pass &pass = m_passes[p];
+        if (p == m_splitPass && afterSplit != VK_NULL_HANDLE)
+        {
+            cmd = afterSplit;
+        }
+
+        RenderGraphPassTiming timing;
+        timing.name = pass.name;
+        timing.culled = !pass.alive;
+        timing.gpuMs = m_profiler ? static_cast<float>(m_profiler->getScopeMs(pass.name)) : 0.0f;
+
+        if (!pass.alive)
+        {
+            m_stats.culledPasses++;
+            m_timings.push_back(timing);
+            continue;
+        }
+        if (pass.mergedInto != UINT32_MAX)
+        {
+            // Recorded by its host, whose barriers already cover the image
+            timing.merged = true;
+            m_stats.passes++;
+            m_stats.mergedPasses++;
+            m_timings.push_back(timing);
+            continue;
+        }
+
+        {
+            // The pass's barriers are part of its cost
+            GpuProfiler::Scope scope(m_profiler, cmd, pass.name.c_str());
+            GpuCounters::Scope counters(m_counters, cmd, pass.name.c_str(), pass.secondary);
+            timing.barriers = recordBarriers(cmd, p);
+            recordPass(cmd, p);
+        }
+        if (m_replayRepeat > 0)
+        {
+            recordReplay(cmd, p);
+        }
+
+        m_stats.passes++;
+        m_stats.barriers += timing.barriers;
+        m_timings.push_back(timing);
+    }
+
+    // Also when the split comes after the last pass
+    if (m_splitPass != UINT32_MAX && afterSplit != VK_NULL_HANDLE)
+    {
+        cmd = afterSplit;
+    }
+    recordFinalTransitions(cmd);
+}
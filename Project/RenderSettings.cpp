@@ -0,0 +1,46 @@
+#include "RenderSettings.h"
+#include <cstring>
+
+namespace
+{
+    class Fnv1a
+    {
+    public:
+        // Field by field: the struct's padding is never read
+        template <typename T>
+        Fnv1a &add(const T &value)
+        {
+            unsigned char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            for (unsigned char byte : bytes)
+            {
+                m_hash = (m_hash ^ byte) * 1099511628211ull;
+            }
+            return *this;
+        }
+
+        uint64_t get() const { return m_hash; }
+
+    private:
+        uint64_t m_hash = 14695981039346656037ull;
+    };
+}
+
+uint64_t RenderSettings::hash() const
+{
+    Fnv1a h;
+    h.add(renderingMode);
+    h.add(waterSpeed).add(waterBaseColor.x).add(waterBaseColor.y).add(waterBaseColor.z);
+    h.add(waterLightColor.x).add(waterLightColor.y).add(waterLightColor.z);
+    h.add(waterAmbient).add(waterShininess).add(waterCausticIntensity).add(waterDistortionStrength);
+    h.add(waterFresnelR0).add(waterSurfaceOpacity);
+    h.add(underwaterShallowColor.x).add(underwaterShallowColor.y).add(underwaterShallowColor.z);
+    h.add(underwaterDeepColor.x).add(underwaterDeepColor.y).add(underwaterDeepColor.z);
+    h.add(oceanBottomCausticIntensity).add(underwaterGodRayIntensity).add(underwaterScatteringIntensity);
+    h.add(underwaterOpacity).add(underwaterFogDensity);
+    h.add(godExposure).add(godDecay).add(godDensity).add(godSampleScale);
+    h.add(marineSnowIntensity).add(marineSnowSize).add(marineSnowSpeed).add(marineSnowParticles);
+    h.add(chromaticAberrationStrength);
+    h.add(showDebugRays).add(showMarineSnowDebug).add(showChromaticDebug);
+    return h.get();
+}
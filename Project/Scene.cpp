@@ -0,0 +1,529 @@
+#include "Scene.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// ============================================================================
+// BOUNDS / FRUSTUM
+// ============================================================================
+
+Aabb Aabb::empty()
+{
+    Aabb box;
+    box.min = glm::vec3(std::numeric_limits<float>::max());
+    box.max = glm::vec3(-std::numeric_limits<float>::max());
+    return box;
+}
+
+void Aabb::expand(const glm::vec3 &point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void Aabb::expand(const Aabb &other)
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+Aabb Aabb::transformed(const glm::mat4 &transform) const
+{
+    // Arvo: project each axis of the matrix onto the box extents instead of transforming 8 corners
+    Aabb result;
+    result.min = glm::vec3(transform[3]);
+    result.max = glm::vec3(transform[3]);
+
+    for (int col = 0; col < 3; col++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            float a = transform[col][row] * min[col];
+            float b = transform[col][row] * max[col];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    return result;
+}
+
+Frustum Frustum::fromViewProjection(const glm::mat4 &m)
+{
+    // Gribb/Hartmann plane extraction; rows of the column-major matrix
+    auto row = [&m](int r)
+    { return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]); };
+
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0); // Left
+    frustum.planes[1] = row(3) - row(0); // Right
+    frustum.planes[2] = row(3) + row(1); // Bottom (top when Y is flipped, both are kept)
+    frustum.planes[3] = row(3) - row(1); // Top
+    frustum.planes[4] = row(3) + row(2); // Near, -w..w depth: conservative for 0..w as well
+    frustum.planes[5] = row(3) - row(2); // Far
+
+    for (auto &plane : frustum.planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+bool Frustum::intersects(const Aabb &box) const
+{
+    for (const auto &plane : planes)
+    {
+        // Corner furthest along the plane normal
+        glm::vec3 positive(plane.x >= 0.0f ? box.max.x : box.min.x,
+                           plane.y >= 0.0f ? box.max.y : box.min.y,
+                           plane.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// OBJECTS
+// ============================================================================
+
+uint32_t Scene::addObject(const SceneObject &object)
+{
+    return addInstance(addMesh(object), object.transform, object.materialId);
+}
+
+uint32_t Scene::addMesh(const SceneObject &geometry)
+{
+    SceneMesh mesh;
+    mesh.range.firstIndex = static_cast<uint32_t>(m_indices.size());
+    mesh.range.indexCount = static_cast<uint32_t>(geometry.lods.empty() ? geometry.indices.size() : geometry.lods[0].indexCount);
+    mesh.range.vertexOffset = static_cast<int32_t>(m_vertices.size());
+
+    // Every level indexes the same vertices, so they all draw with the mesh's vertexOffset
+    mesh.lods.push_back({mesh.range.firstIndex, mesh.range.indexCount, 0.0f});
+    for (size_t level = 1; level < geometry.lods.size(); level++)
+    {
+        const MeshLod &lod = geometry.lods[level];
+        mesh.lods.push_back({mesh.range.firstIndex + lod.firstIndex, lod.indexCount, lod.error});
+    }
+
+    mesh.localBounds = Aabb::empty();
+    for (const auto &vertex : geometry.vertices)
+    {
+        mesh.localBounds.expand(vertex.pos);
+    }
+    if (geometry.vertices.empty())
+    {
+        mesh.localBounds = Aabb{};
+    }
+
+    // Quantised over the bounds' enclosing cube: a uniform scale keeps mat3(model) usable on normals
+    const glm::vec3 size = mesh.localBounds.max - mesh.localBounds.min;
+    const float extent = std::max(std::max(size.x, size.y), std::max(size.z, 1e-6f));
+    mesh.dequantize = glm::scale(glm::translate(glm::mat4(1.0f), mesh.localBounds.min), glm::vec3(extent));
+
+    // Indices stay mesh-relative; vertexOffset rebases them at draw time
+    m_vertices.reserve(m_vertices.size() + geometry.vertices.size());
+    for (const Vertex &vertex : geometry.vertices)
+    {
+        m_vertices.push_back(PackedVertex::pack(vertex, mesh.localBounds.min, extent));
+    }
+    m_indices.insert(m_indices.end(), geometry.indices.begin(), geometry.indices.end());
+
+    m_meshes.push_back(mesh);
+    return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+uint32_t Scene::addInstance(uint32_t meshIndex, const glm::mat4 &transform, uint32_t materialId)
+{
+    if (meshIndex >= m_meshes.size())
+    {
+        throw std::out_of_range("Scene mesh index out of range!");
+    }
+
+    const uint32_t objectIndex = m_objects.size();
+    const uint32_t node = m_transforms.addNode();
+    m_transforms.setLocalMatrix(node, transform);
+    m_nodeObjects.resize(m_transforms.getNodeCount(), kNoObject);
+    m_nodeObjects[node] = objectIndex;
+
+    m_objects.transforms.push_back(transform);
+    m_objects.worldBounds.push_back(m_meshes[meshIndex].localBounds.transformed(transform));
+    m_objects.meshes.push_back(meshIndex);
+    m_objects.materials.push_back(materialId);
+    m_objects.visible.push_back(1);
+    m_objects.nodes.push_back(node);
+    m_bvhNeedsBuild = true;
+    return objectIndex;
+}
+
+void Scene::add(const SceneDescription &description)
+{
+    const uint32_t firstMesh = getMeshCount();
+    for (const SceneObject &mesh : description.meshes)
+    {
+        addMesh(mesh);
+    }
+    const size_t capacity = m_objects.size() + description.instances.size();
+    m_objects.transforms.reserve(capacity);
+    m_objects.worldBounds.reserve(capacity);
+    m_objects.meshes.reserve(capacity);
+    m_objects.materials.reserve(capacity);
+    m_objects.visible.reserve(capacity);
+    m_objects.nodes.reserve(capacity);
+    for (const SceneInstance &instance : description.instances)
+    {
+        addInstance(firstMesh + instance.mesh, instance.transform, instance.materialId);
+    }
+}
+
+void Scene::clear()
+{
+    m_vertices.clear();
+    m_indices.clear();
+    m_meshes.clear();
+    m_objects = SceneComponents{};
+    m_transforms.clear();
+    m_nodeObjects.clear();
+    m_lightNodes.clear();
+    m_lights.clear();
+    m_bvhNodes.clear();
+    m_bvhItems.clear();
+    m_bvhNeedsBuild = true;
+    m_bvhNeedsRefit = false;
+}
+
+void Scene::setTransform(uint32_t objectIndex, const glm::mat4 &transform)
+{
+    if (objectIndex >= m_objects.size())
+    {
+        throw std::out_of_range("Scene object index out of range!");
+    }
+    m_transforms.setLocalMatrix(m_objects.nodes[objectIndex], transform);
+}
+
+void Scene::setVisible(uint32_t objectIndex, bool visible)
+{
+    if (objectIndex >= m_objects.size())
+    {
+        throw std::out_of_range("Scene object index out of range!");
+    }
+    if (isVisible(objectIndex) != visible)
+    {
+        m_objects.visible[objectIndex] = visible ? 1 : 0;
+        m_transformVersion++;
+    }
+}
+
+// ============================================================================
+// HIERARCHY
+// ============================================================================
+
+uint32_t Scene::addGroup(const glm::mat4 &transform, uint32_t parentNode)
+{
+    const uint32_t node = m_transforms.addNode(parentNode);
+    m_transforms.setLocalMatrix(node, transform);
+    m_nodeObjects.resize(m_transforms.getNodeCount(), kNoObject);
+    return node;
+}
+
+void Scene::setParent(uint32_t objectIndex, uint32_t parentNode)
+{
+    if (objectIndex >= m_objects.size())
+    {
+        throw std::out_of_range("Scene object index out of range!");
+    }
+    m_transforms.setParent(m_objects.nodes[objectIndex], parentNode);
+}
+
+void Scene::updateTransforms()
+{
+    if (!m_transforms.needsUpdate())
+        return;
+
+    bool moved = false;
+    for (uint32_t node : m_transforms.update())
+    {
+        const uint32_t objectIndex = m_nodeObjects[node];
+        if (objectIndex == kNoObject)
+            continue;
+        const glm::mat4 &world = m_transforms.getWorld(node);
+        m_objects.transforms[objectIndex] = world;
+        m_objects.worldBounds[objectIndex] = m_meshes[m_objects.meshes[objectIndex]].localBounds.transformed(world);
+        moved = true;
+    }
+    if (moved)
+    {
+        m_bvhNeedsRefit = true;
+        m_transformVersion++;
+    }
+}
+
+uint32_t Scene::addLight(uint32_t node, const PointLight &light)
+{
+    if (node >= m_transforms.getNodeCount())
+    {
+        throw std::out_of_range("Scene light node out of range!");
+    }
+    m_lightNodes.push_back(node);
+    m_lights.push_back(light);
+    return static_cast<uint32_t>(m_lights.size() - 1);
+}
+
+void Scene::setLight(uint32_t lightIndex, const PointLight &light)
+{
+    if (lightIndex >= m_lights.size())
+    {
+        throw std::out_of_range("Scene light index out of range!");
+    }
+    m_lights[lightIndex] = light;
+}
+
+void Scene::gatherLights(std::vector<PointLight> &outLights)
+{
+    updateTransforms();
+    outLights.reserve(outLights.size() + m_lights.size());
+    for (size_t i = 0; i < m_lights.size(); i++)
+    {
+        PointLight light = m_lights[i];
+        light.position = glm::vec3(m_transforms.getWorld(m_lightNodes[i]) * glm::vec4(light.position, 1.0f));
+        outLights.push_back(light);
+    }
+}
+
+// ============================================================================
+// BVH
+// ============================================================================
+
+void Scene::updateBvh()
+{
+    updateTransforms();
+    if (m_bvhNeedsBuild)
+    {
+        buildBvh();
+    }
+    else if (m_bvhNeedsRefit)
+    {
+        refitBvh();
+    }
+    m_bvhNeedsBuild = false;
+    m_bvhNeedsRefit = false;
+}
+
+void Scene::buildBvh()
+{
+    m_bvhNodes.clear();
+    m_bvhItems.resize(m_objects.size());
+    for (uint32_t i = 0; i < m_objects.size(); i++)
+    {
+        m_bvhItems[i] = i;
+    }
+
+    if (empty())
+        return;
+
+    m_bvhNodes.reserve(m_objects.size() * 2);
+    buildBvhNode(0, static_cast<uint32_t>(m_bvhItems.size()));
+}
+
+uint32_t Scene::buildBvhNode(uint32_t first, uint32_t count)
+{
+    uint32_t nodeIndex = static_cast<uint32_t>(m_bvhNodes.size());
+    m_bvhNodes.emplace_back();
+
+    Aabb bounds = Aabb::empty();
+    Aabb centroids = Aabb::empty();
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const Aabb &box = m_objects.worldBounds[m_bvhItems[i]];
+        bounds.expand(box);
+        centroids.expand(box.center());
+    }
+    m_bvhNodes[nodeIndex].bounds = bounds;
+
+    if (count <= kBvhLeafSize)
+    {
+        m_bvhNodes[nodeIndex].firstItem = first;
+        m_bvhNodes[nodeIndex].itemCount = count;
+        return nodeIndex;
+    }
+
+    // Median split on the widest centroid axis
+    glm::vec3 extent = centroids.max - centroids.min;
+    int axis = 0;
+    if (extent.y > extent[axis])
+        axis = 1;
+    if (extent.z > extent[axis])
+        axis = 2;
+
+    uint32_t half = count / 2;
+    std::nth_element(m_bvhItems.begin() + first, m_bvhItems.begin() + first + half, m_bvhItems.begin() + first + count,
+                     [this, axis](uint32_t a, uint32_t b)
+                     { return m_objects.worldBounds[a].center()[axis] < m_objects.worldBounds[b].center()[axis]; });
+
+    // emplace_back may reallocate: write children through the index, not a reference
+    uint32_t left = buildBvhNode(first, half);
+    uint32_t right = buildBvhNode(first + half, count - half);
+    m_bvhNodes[nodeIndex].left = left;
+    m_bvhNodes[nodeIndex].right = right;
+    return nodeIndex;
+}
+
+void Scene::refitBvh()
+{
+    // Children are stored after their parent, so a reverse sweep sees them first
+    for (size_t n = m_bvhNodes.size(); n-- > 0;)
+    {
+        BvhNode &node = m_bvhNodes[n];
+        Aabb bounds = Aabb::empty();
+        if (node.itemCount > 0)
+        {
+            for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+            {
+                bounds.expand(m_objects.worldBounds[m_bvhItems[i]]);
+            }
+        }
+        else
+        {
+            bounds.expand(m_bvhNodes[node.left].bounds);
+            bounds.expand(m_bvhNodes[node.right].bounds);
+        }
+        node.bounds = bounds;
+    }
+}
+
+// ============================================================================
+// LEVELS OF DETAIL
+// ============================================================================
+
+uint32_t Scene::selectLod(uint32_t objectIndex, const SceneLodView &view, uint32_t current) const
+{
+    const std::vector<MeshLod> &lods = m_meshes[m_objects.meshes[objectIndex]].lods;
+    if (lods.size() <= 1 || view.pixelsPerUnit <= 0.0f)
+        return 0;
+
+    // Errors are in the mesh's units: the transform's largest axis scale takes them to world space
+    const glm::mat4 &transform = m_objects.transforms[objectIndex];
+    const float scale = std::max(glm::length(glm::vec3(transform[0])),
+                                 std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    // From the nearest point of the bounds, so an object around the camera draws at full detail
+    const Aabb &bounds = m_objects.worldBounds[objectIndex];
+    const glm::vec3 nearest = glm::clamp(view.cameraPosition, bounds.min, bounds.max);
+    const float distance = glm::length(view.cameraPosition - nearest);
+    if (distance <= 0.0f)
+        return 0;
+    const float pixelsPerError = view.pixelsPerUnit * scale / distance;
+
+    // Errors only grow down the chain: walk it while the next level still fits the budget
+    auto coarsestWithin = [&](float budget)
+    {
+        uint32_t level = 0;
+        while (level + 1 < lods.size() && lods[level + 1].error * pixelsPerError <= budget)
+            level++;
+        return level;
+    };
+
+    // Finer levels are taken at once, the current one's error being visible already
+    const uint32_t level = coarsestWithin(view.maxPixelError);
+    if (level <= current)
+        return level;
+    return std::max(current, coarsestWithin(view.maxPixelError * kLodHysteresis));
+}
+
+// ============================================================================
+// DRAW LIST
+// ============================================================================
+
+void Scene::buildDrawList(const glm::mat4 &viewProjection, std::vector<SceneDraw> &outDraws, SceneLodView *lod)
+{
+    outDraws.clear();
+    m_lastCullStats = SceneCullStats{};
+
+    updateBvh();
+    if (m_bvhNodes.empty())
+        return;
+
+    if (lod)
+    {
+        lod->levels.resize(m_objects.size(), 0);
+    }
+
+    Frustum frustum = Frustum::fromViewProjection(viewProjection);
+    // Clip w is the view depth, except under an orthographic projection (shadow cascades): then z
+    const bool orthographic = viewProjection[0][3] == 0.0f && viewProjection[1][3] == 0.0f && viewProjection[2][3] == 0.0f;
+    const glm::vec4 depthRow = orthographic ? glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2])
+                                            : glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    uint32_t stack[64];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const BvhNode &node = m_bvhNodes[stack[--stackSize]];
+        m_lastCullStats.nodesVisited++;
+
+        if (!frustum.intersects(node.bounds))
+            continue;
+
+        if (node.itemCount == 0)
+        {
+            stack[stackSize++] = node.right;
+            stack[stackSize++] = node.left;
+            continue;
+        }
+
+        for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+        {
+            uint32_t objectIndex = m_bvhItems[i];
+            const uint32_t meshIndex = m_objects.meshes[objectIndex];
+            const SceneMesh &mesh = m_meshes[meshIndex];
+            if (!m_objects.visible[objectIndex] || mesh.range.indexCount == 0)
+                continue;
+
+            m_lastCullStats.objectsTested++;
+            const Aabb &bounds = m_objects.worldBounds[objectIndex];
+            if (node.itemCount > 1 && !frustum.intersects(bounds))
+                continue;
+
+            SceneDraw draw{};
+            draw.objectIndex = objectIndex;
+            draw.range = mesh.range;
+            if (lod)
+            {
+                draw.lod = selectLod(objectIndex, *lod, lod->levels[objectIndex]);
+                lod->levels[objectIndex] = static_cast<uint8_t>(draw.lod);
+                const MeshLod &level = mesh.lods[draw.lod];
+                draw.range.firstIndex = level.firstIndex;
+                draw.range.indexCount = level.indexCount;
+            }
+            m_lastCullStats.trianglesVisible += draw.range.indexCount / 3;
+
+            // Instances of one mesh and level together, front to back within them
+            draw.depth = glm::dot(depthRow, glm::vec4(bounds.center(), 1.0f));
+            draw.sortKey = DrawKey::make(DrawKey::Layer::Opaque, 0, (meshIndex << 2) | draw.lod,
+                                         DrawKey::quantizeDepth(draw.depth), static_cast<uint16_t>(m_objects.materials[objectIndex]));
+            outDraws.push_back(draw);
+        }
+    }
+
+    m_lastCullStats.objectsVisible = static_cast<uint32_t>(outDraws.size());
+    sortDraws(outDraws);
+}
+
+void Scene::sortDraws(std::vector<SceneDraw> &draws)
+{
+    m_sortEntries.resize(draws.size());
+    for (uint32_t i = 0; i < draws.size(); i++)
+    {
+        m_sortEntries[i] = {draws[i].sortKey, i};
+    }
+    DrawKey::sort(m_sortEntries, m_sortScratch);
+
+    m_drawScratch.resize(draws.size());
+    for (size_t i = 0; i < draws.size(); i++)
+    {
+        m_drawScratch[i] = draws[m_sortEntries[i].index];
+    }
+    draws.swap(m_drawScratch);
+}
@@ -0,0 +1,376 @@
+#include "ScreenSpaceReflections.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "UploadContext.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+static bool hasStencil(VkFormat format)
+{
+    return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+ScreenSpaceReflections::ScreenSpaceReflections(VkDevice device, VkExtent2D extent, VkFormat depthFormat,
+                                               VkSampleCountFlagBits samples, bool depthSampleable)
+    : m_device(device), m_depthFormat(depthFormat), m_samples(samples)
+{
+    // hiz_depth.comp reads the attachment as sampler2DMS
+    m_available = depthSampleable && samples != VK_SAMPLE_COUNT_1_BIT;
+
+    // Fetched per mip by the build and sampled at explicit levels by the trace
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create SSR pyramid sampler!");
+    }
+
+    // Source (depth or previous mip), destination mip
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    for (auto &binding : bindings)
+    {
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create SSR pyramid descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, kMaxMips};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, kMaxMips};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = kMaxMips;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create SSR pyramid descriptor pool!");
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create SSR pyramid pipeline layout!");
+    }
+
+    createPipelines();
+    resize(extent);
+}
+
+ScreenSpaceReflections::~ScreenSpaceReflections()
+{
+    destroyTargets();
+
+    vkDestroyPipeline(m_device, m_depthPipeline, nullptr);
+    vkDestroyPipeline(m_device, m_reducePipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+}
+
+void ScreenSpaceReflections::resize(VkExtent2D extent)
+{
+    destroyTargets();
+    createTargets(extent);
+}
+
+// ============================================================================
+// PIPELINES
+// ============================================================================
+
+void ScreenSpaceReflections::createPipelines()
+{
+    vkDestroyPipeline(m_device, m_depthPipeline, nullptr);
+    vkDestroyPipeline(m_device, m_reducePipeline, nullptr);
+    m_depthPipeline = VK_NULL_HANDLE;
+    m_reducePipeline = VK_NULL_HANDLE;
+
+    // GpuCulling's Hi-Z shaders, specialized to keep the nearest depth
+    const VkBool32 nearest = VK_TRUE;
+    VkSpecializationMapEntry entry{0, 0, sizeof(VkBool32)};
+    VkSpecializationInfo specialization{1, &entry, sizeof(nearest), &nearest};
+
+    const char *paths[2] = {"shaders/hiz_depth.comp.spv", "shaders/hiz_reduce.comp.spv"};
+    VkPipeline *pipelines[2] = {&m_depthPipeline, &m_reducePipeline};
+    for (int i = 0; i < 2; i++)
+    {
+        std::vector<char> code = ShaderRegistry::load(paths[i]);
+        VkShaderModuleCreateInfo moduleInfo{};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = code.size();
+        moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+        VkShaderModule module;
+        if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &module) != VK_SUCCESS)
+        {
+            throw std::runtime_error(std::string("failed to create shader module: ") + paths[i]);
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.stage.pSpecializationInfo = &specialization;
+        pipelineInfo.layout = m_pipelineLayout;
+
+        VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, pipelines[i]);
+        vkDestroyShaderModule(m_device, module, nullptr);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create SSR pyramid pipeline!");
+        }
+    }
+}
+
+// ============================================================================
+// TARGETS
+// ============================================================================
+
+void ScreenSpaceReflections::createTargets(VkExtent2D extent)
+{
+    m_extent = extent;
+    m_mipCount = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+    m_mipCount = std::min(m_mipCount, kMaxMips);
+
+    // The refraction pass' depth; only needed when the pyramid can be built from it
+    if (m_available)
+    {
+        VkImageCreateInfo depthInfo{};
+        depthInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        depthInfo.imageType = VK_IMAGE_TYPE_2D;
+        depthInfo.format = m_depthFormat;
+        depthInfo.extent = {extent.width, extent.height, 1};
+        depthInfo.mipLevels = 1;
+        depthInfo.arrayLayers = 1;
+        depthInfo.samples = m_samples;
+        depthInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        depthInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        depthInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        depthInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &depthInfo, nullptr, &m_depthImage) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create SSR depth image!");
+        }
+        GpuMemoryAllocator::get().allocateImage(m_depthImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkImageViewCreateInfo depthViewInfo{};
+        depthViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        depthViewInfo.image = m_depthImage;
+        depthViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        depthViewInfo.format = m_depthFormat;
+        depthViewInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        if (vkCreateImageView(m_device, &depthViewInfo, nullptr, &m_depthView) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create SSR depth view!");
+        }
+    }
+
+    // The pyramid exists even when it cannot be built so the water set always has a valid binding
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = m_mipCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &m_pyramidImage) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create SSR pyramid image!");
+    }
+    GpuMemoryAllocator::get().allocateImage(m_pyramidImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_pyramidImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipCount, 0, 1};
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_pyramidView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create SSR pyramid view!");
+    }
+
+    m_mipViews.resize(m_mipCount);
+    for (uint32_t mip = 0; mip < m_mipCount; mip++)
+    {
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1};
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_mipViews[mip]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create SSR pyramid mip view!");
+        }
+    }
+
+    if (m_available)
+    {
+        // Level 0 samples the depth attachment, the others the level above
+        std::vector<VkDescriptorSetLayout> layouts(m_mipCount, m_setLayout);
+        m_sets.resize(m_mipCount);
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_descriptorPool;
+        allocInfo.descriptorSetCount = m_mipCount;
+        allocInfo.pSetLayouts = layouts.data();
+        if (vkAllocateDescriptorSets(m_device, &allocInfo, m_sets.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate SSR pyramid descriptor sets!");
+        }
+
+        for (uint32_t mip = 0; mip < m_mipCount; mip++)
+        {
+            VkDescriptorImageInfo sourceInfo{};
+            sourceInfo.sampler = m_sampler;
+            sourceInfo.imageView = mip == 0 ? m_depthView : m_mipViews[mip - 1];
+            sourceInfo.imageLayout = mip == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+            VkDescriptorImageInfo destInfo{};
+            destInfo.imageView = m_mipViews[mip];
+            destInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+            std::array<VkWriteDescriptorSet, 2> writes{};
+            writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[0].dstSet = m_sets[mip];
+            writes[0].dstBinding = 0;
+            writes[0].descriptorCount = 1;
+            writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writes[0].pImageInfo = &sourceInfo;
+            writes[1] = writes[0];
+            writes[1].dstBinding = 1;
+            writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[1].pImageInfo = &destInfo;
+            vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+    }
+
+    // Cleared to the far plane: an unbuilt pyramid is all sky
+    VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_pyramidImage;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipCount, 0, 1};
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkClearColorValue farDepth = {{1.0f, 0.0f, 0.0f, 0.0f}};
+    vkCmdClearColorImage(cmd, m_pyramidImage, VK_IMAGE_LAYOUT_GENERAL, &farDepth, 1, &barrier.subresourceRange);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void ScreenSpaceReflections::destroyTargets()
+{
+    if (m_pyramidImage == VK_NULL_HANDLE)
+        return;
+
+    vkResetDescriptorPool(m_device, m_descriptorPool, 0);
+    m_sets.clear();
+
+    for (VkImageView view : m_mipViews)
+    {
+        vkDestroyImageView(m_device, view, nullptr);
+    }
+    m_mipViews.clear();
+    vkDestroyImageView(m_device, m_pyramidView, nullptr);
+    m_pyramidView = VK_NULL_HANDLE;
+    GpuMemoryAllocator::get().destroyImage(m_pyramidImage);
+    m_pyramidImage = VK_NULL_HANDLE;
+    m_mipCount = 0;
+
+    if (m_depthImage != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(m_device, m_depthView, nullptr);
+        m_depthView = VK_NULL_HANDLE;
+        GpuMemoryAllocator::get().destroyImage(m_depthImage);
+        m_depthImage = VK_NULL_HANDLE;
+    }
+}
+
+// ============================================================================
+// FRAME
+// ============================================================================
+
+RenderGraphResource ScreenSpaceReflections::importDepth(RenderGraph &graph) const
+{
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil(m_depthFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+    RenderGraphImageDesc desc{m_depthFormat, m_extent, m_samples,
+                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, aspect};
+    // Cleared every frame; last read by the previous frame's pyramid build
+    return graph.importImage("RefractionDepth", m_depthImage, m_depthView, desc,
+                             {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0}, {});
+}
+
+void ScreenSpaceReflections::recordPyramidBuild(VkCommandBuffer cmd) const
+{
+    // The depth transition is the caller's; the previous frame's water reads of the pyramid must finish first
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    VkMemoryBarrier mipBarrier{};
+    mipBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    mipBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    mipBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    for (uint32_t mip = 0; mip < m_mipCount; mip++)
+    {
+        uint32_t width = std::max(m_extent.width >> mip, 1u);
+        uint32_t height = std::max(m_extent.height >> mip, 1u);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mip == 0 ? m_depthPipeline : m_reducePipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_sets[mip], 0, nullptr);
+        vkCmdDispatch(cmd, (width + kGroupSize - 1) / kGroupSize, (height + kGroupSize - 1) / kGroupSize, 1);
+
+        // The last level is only read by the water pass
+        const VkPipelineStageFlags dstStage = mip + 1 < m_mipCount ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage,
+                             0, 1, &mipBarrier, 0, nullptr, 0, nullptr);
+    }
+}
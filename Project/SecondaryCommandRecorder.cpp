@@ -0,0 +1,219 @@
+#include "SecondaryCommandRecorder.h"
+#include "JobSystem.h"
+#include <stdexcept>
+
+SecondaryCommandRecorder::SecondaryCommandRecorder(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, JobSystem &jobSystem)
+    : m_device(device), m_jobSystem(jobSystem), m_frameCount(frameCount), m_threadCount(jobSystem.getThreadCount())
+{
+    m_pools.resize(static_cast<size_t>(m_frameCount) * m_threadCount);
+    for (auto &pool : m_pools)
+    {
+        pool.pool.create(device, queueFamilyIndex);
+    }
+    m_cachePools.resize(m_frameCount);
+    m_cached.resize(m_frameCount);
+    for (auto &pool : m_cachePools)
+    {
+        pool.create(device, queueFamilyIndex);
+    }
+}
+
+SecondaryCommandRecorder::~SecondaryCommandRecorder()
+{
+    // Destroying a pool frees its command buffers
+    for (auto &pool : m_pools)
+    {
+        pool.pool.destroy();
+    }
+    for (auto &pool : m_cachePools)
+    {
+        pool.destroy();
+    }
+}
+
+void SecondaryCommandRecorder::beginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= m_frameCount)
+    {
+        throw std::out_of_range("SecondaryCommandRecorder frame index out of range!");
+    }
+    m_frameIndex = frameIndex;
+    m_frameSerial++;
+    m_reusedCount = 0;
+    m_cacheRecordedCount = 0;
+
+    for (uint32_t t = 0; t < m_threadCount; t++)
+    {
+        ThreadPool &pool = threadPool(t);
+        if (pool.used > 0)
+        {
+            pool.pool.reset();
+            pool.used = 0;
+        }
+    }
+}
+
+void SecondaryCommandRecorder::record(VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer, VkExtent2D extent,
+                                      const RecordJobs &jobs, std::vector<VkCommandBuffer> &outBuffers)
+{
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = renderPass;
+    inheritance.subpass = subpass;
+    inheritance.framebuffer = framebuffer;
+    recordJobs(inheritance, cacheKey(renderPass, subpass), extent, jobs, outBuffers);
+}
+
+void SecondaryCommandRecorder::record(const RenderingFormats &formats, VkExtent2D extent, const RecordJobs &jobs,
+                                      std::vector<VkCommandBuffer> &outBuffers)
+{
+    VkCommandBufferInheritanceRenderingInfoKHR rendering{};
+    rendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+    rendering.colorAttachmentCount = static_cast<uint32_t>(formats.colorFormats.size());
+    rendering.pColorAttachmentFormats = formats.colorFormats.data();
+    rendering.depthAttachmentFormat = formats.depthFormat;
+    rendering.rasterizationSamples = formats.samples;
+    rendering.viewMask = formats.viewMask;
+
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.pNext = &rendering;
+
+    uint64_t formatsKey = cacheKey(formats.depthFormat, formats.samples, formats.viewMask);
+    for (VkFormat format : formats.colorFormats)
+    {
+        formatsKey = cacheKey(formatsKey, format);
+    }
+    recordJobs(inheritance, formatsKey, extent, jobs, outBuffers);
+}
+
+void SecondaryCommandRecorder::recordJobs(const VkCommandBufferInheritanceInfo &inheritance, uint64_t inheritanceKey, VkExtent2D extent,
+                                          const RecordJobs &jobs, std::vector<VkCommandBuffer> &outBuffers)
+{
+    outBuffers.assign(jobs.size(), VK_NULL_HANDLE);
+
+    VkCommandBufferInheritanceInfo threadInheritance = inheritance;
+    threadInheritance.pipelineStatistics = m_inheritedStatistics;
+
+    // Cached jobs first, on this thread: the frame's cache pool is not shared with the workers
+    uint32_t cachedCount = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        if (jobs[i].cacheKey == 0)
+            continue;
+        // Without the framebuffer, so the secondary stays valid for every swapchain image
+        VkCommandBufferInheritanceInfo cachedInheritance = threadInheritance;
+        cachedInheritance.framebuffer = VK_NULL_HANDLE;
+        const uint64_t key = cacheKey(jobs[i].cacheKey, inheritanceKey, extent, m_inheritedStatistics);
+        outBuffers[i] = cachedBuffer(key, cachedInheritance, extent, jobs[i].record);
+        cachedCount += outBuffers[i] != VK_NULL_HANDLE;
+    }
+    if (cachedCount == jobs.size())
+    {
+        return;
+    }
+
+    m_jobSystem.run(static_cast<uint32_t>(jobs.size()), [&](uint32_t jobIndex, uint32_t threadIndex)
+                    {
+        if (outBuffers[jobIndex] != VK_NULL_HANDLE)
+        {
+            return; // Cached
+        }
+        ThreadPool &pool = threadPool(threadIndex);
+        if (pool.used == pool.buffers.size())
+        {
+            pool.buffers.push_back(pool.pool.createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+        }
+        CommandBuffer &buffer = pool.buffers[pool.used++];
+
+        begin(buffer, threadInheritance, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, extent);
+        jobs[jobIndex](buffer.getVkCommandBuffer());
+        buffer.end();
+
+        outBuffers[jobIndex] = buffer.getVkCommandBuffer(); });
+}
+
+VkCommandBuffer SecondaryCommandRecorder::cachedBuffer(uint64_t key, const VkCommandBufferInheritanceInfo &inheritance,
+                                                       VkExtent2D extent, const RecordFn &record)
+{
+    std::vector<CachedBuffer> &cached = m_cached[m_frameIndex];
+    CachedBuffer *target = nullptr;
+    for (CachedBuffer &entry : cached)
+    {
+        if (entry.lastUsed == m_frameSerial)
+            continue; // Already executed this frame; not recorded for simultaneous use
+        if (entry.key == key)
+        {
+            entry.lastUsed = m_frameSerial;
+            m_reusedCount++;
+            return entry.buffer.getVkCommandBuffer();
+        }
+        // A free entry, else the least recently used
+        if (!target || (target->key != 0 && (entry.key == 0 || entry.lastUsed < target->lastUsed)))
+            target = &entry;
+    }
+    if (!target)
+    {
+        if (cached.size() == kMaxCached)
+        {
+            return VK_NULL_HANDLE; // Recorded with the frame's other jobs instead
+        }
+        cached.push_back({m_cachePools[m_frameIndex].createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY)});
+        target = &cached.back();
+    }
+
+    // The pool resets individual buffers: beginning one discards what it held, and the slot's fence has signalled
+    begin(target->buffer, inheritance, 0, extent);
+    record(target->buffer.getVkCommandBuffer());
+    target->buffer.end();
+    target->key = key;
+    target->lastUsed = m_frameSerial;
+    m_cacheRecordedCount++;
+    return target->buffer.getVkCommandBuffer();
+}
+
+void SecondaryCommandRecorder::begin(CommandBuffer &buffer, const VkCommandBufferInheritanceInfo &inheritance,
+                                     VkCommandBufferUsageFlags flags, VkExtent2D extent)
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | flags;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    buffer.begin(&beginInfo);
+    setViewport(buffer.getVkCommandBuffer(), extent);
+}
+
+void SecondaryCommandRecorder::invalidateCache()
+{
+    for (auto &cached : m_cached)
+    {
+        for (CachedBuffer &entry : cached)
+        {
+            entry.key = 0;
+        }
+    }
+}
+
+void SecondaryCommandRecorder::setViewport(VkCommandBuffer cmd, VkExtent2D extent)
+{
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.extent = extent;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+uint32_t SecondaryCommandRecorder::getRecordedCount() const
+{
+    uint32_t count = 0;
+    for (uint32_t t = 0; t < m_threadCount; t++)
+    {
+        count += m_pools[m_frameIndex * m_threadCount + t].used;
+    }
+    return count + m_cacheRecordedCount;
+}
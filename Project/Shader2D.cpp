@@ -1,10 +1,11 @@
 #include "Shader2D.h"
+#include "ShaderRegistry.h"
 #include "VulkanUtil.h"
 
 Shader2D::Shader2D(VkDevice device, const std::string& vertPath, const std::string& fragPath)
     : device(device) {
-    auto vertShaderCode = VkUtils::readFile(vertPath);
-    auto fragShaderCode = VkUtils::readFile(fragPath);
+    auto vertShaderCode = ShaderRegistry::load(vertPath);
+    auto fragShaderCode = ShaderRegistry::load(fragPath);
 
     vertShaderModule = createShaderModule(vertShaderCode);
     fragShaderModule = createShaderModule(fragShaderCode);
@@ -1,14 +1,13 @@
 #include "Shader3D.h"
-#include <fstream>
-#include <iostream>
+#include "ShaderRegistry.h"
 #include <stdexcept>
 #include <vector>
 
 Shader3D::Shader3D(VkDevice device, const std::string& vertPath, const std::string& fragPath)
     : device(device) {
 
-    auto vertShaderCode = readFile(vertPath);
-    auto fragShaderCode = readFile(fragPath);
+    auto vertShaderCode = ShaderRegistry::load(vertPath);
+    auto fragShaderCode = ShaderRegistry::load(fragPath);
 
     vertShaderModule = createShaderModule(vertShaderCode);
     fragShaderModule = createShaderModule(fragShaderCode);
@@ -37,23 +36,6 @@ VkShaderModule Shader3D::createShaderModule(const std::vector<char>& code) {
     return shaderModule;
 }
 
-std::vector<char> Shader3D::readFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file: " + filename);
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
-    return buffer;
-}
-
 std::vector<VkPipelineShaderStageCreateInfo> Shader3D::getShaderStages() const {
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
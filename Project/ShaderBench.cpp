@@ -0,0 +1,270 @@
+#include "ShaderBench.h"
+#include "GpuMemoryAllocator.h"
+#include "UploadContext.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+const char *ShaderBench::shaderName(Shader shader)
+{
+    switch (shader)
+    {
+    case Shader::Water:
+        return "water";
+    case Shader::Sunrays:
+        return "sunrays";
+    case Shader::Underwater:
+        return "underwater";
+    }
+    return "unknown";
+}
+
+bool ShaderBench::parseShader(const std::string &name, Shader &shader)
+{
+    for (Shader candidate : {Shader::Water, Shader::Sunrays, Shader::Underwater})
+    {
+        if (name == shaderName(candidate))
+        {
+            shader = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+ShaderBench::ShaderBench(VkDevice device, VkPhysicalDevice physicalDevice, VkDescriptorSetLayout globalSetLayout,
+                         VkDescriptorSetLayout waterSetLayout)
+    : m_device(device)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_timestampPeriod = properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo queryInfo{};
+    queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount = 2;
+    if (vkCreateQueryPool(device, &queryInfo, nullptr, &m_queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader bench query pool!");
+    }
+
+    createRenderPass();
+    // The renderer's pipelines, single-sampled like the low-res effects
+    m_water.create(device, m_renderPass, globalSetLayout, waterSetLayout, VK_SAMPLE_COUNT_1_BIT, false);
+    m_sunrays.create(device, m_renderPass, globalSetLayout, waterSetLayout, VK_SAMPLE_COUNT_1_BIT, true);
+    m_underwater.create(device, m_renderPass, globalSetLayout, waterSetLayout, VK_SAMPLE_COUNT_1_BIT, true);
+}
+
+ShaderBench::~ShaderBench()
+{
+    m_underwater.destroy(m_device);
+    m_sunrays.destroy(m_device);
+    m_water.destroy(m_device);
+    vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+    vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+}
+
+void ShaderBench::createRenderPass()
+{
+    // Not registered with DynamicRendering: the pipelines keep this pass, which run() begins itself
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = kFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorRef;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader bench render pass!");
+    }
+}
+
+ShaderBench::Target ShaderBench::createTarget(VkExtent2D extent) const
+{
+    Target target;
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = kFormat;
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &target.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader bench target!");
+    }
+    GpuMemoryAllocator::get().allocateImage(target.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = target.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = kFormat;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &target.view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader bench target view!");
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &target.view;
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &target.framebuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader bench framebuffer!");
+    }
+    return target;
+}
+
+void ShaderBench::destroyTarget(Target &target) const
+{
+    vkDestroyFramebuffer(m_device, target.framebuffer, nullptr);
+    vkDestroyImageView(m_device, target.view, nullptr);
+    GpuMemoryAllocator::get().destroyImage(target.image);
+    target = Target{};
+}
+
+// ============================================================================
+// MEASUREMENT
+// ============================================================================
+
+std::vector<ShaderBench::Result> ShaderBench::run(Shader shader, const std::vector<VkExtent2D> &sizes, uint32_t repeat,
+                                                  uint32_t samples, const PushConstants &push, const BindSets &bindSets,
+                                                  const DrawGrid &drawGrid)
+{
+    repeat = std::max(repeat, 1u);
+    samples = std::max(samples, 1u);
+
+    // The variant the frame would draw in this mode, debug view included
+    const WaterVariant variant{static_cast<uint32_t>(push.renderingMode), static_cast<uint32_t>(push.debugRays)};
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    switch (shader)
+    {
+    case Shader::Water:
+        m_water.select(variant);
+        pipeline = m_water.pipeline;
+        layout = m_water.layout;
+        break;
+    case Shader::Sunrays:
+        m_sunrays.select(variant);
+        pipeline = m_sunrays.pipeline;
+        layout = m_sunrays.layout;
+        break;
+    case Shader::Underwater:
+        m_underwater.select(variant);
+        pipeline = m_underwater.pipeline;
+        layout = m_underwater.layout;
+        break;
+    }
+
+    std::vector<Result> results;
+    for (const VkExtent2D &extent : sizes)
+    {
+        Target target = createTarget(extent);
+        std::vector<double> sampleMs;
+        // One sample more than measured: the first pays for the variant's first use and the target's first touch
+        for (uint32_t sample = 0; sample <= samples; sample++)
+        {
+            VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+            vkCmdResetQueryPool(cmd, m_queryPool, 0, 2);
+
+            VkClearValue clear{};
+            VkRenderPassBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            beginInfo.renderPass = m_renderPass;
+            beginInfo.framebuffer = target.framebuffer;
+            beginInfo.renderArea = {{0, 0}, extent};
+            beginInfo.clearValueCount = 1;
+            beginInfo.pClearValues = &clear;
+            vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            const VkViewport viewport{0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f};
+            const VkRect2D scissor{{0, 0}, extent};
+            vkCmdSetViewport(cmd, 0, 1, &viewport);
+            vkCmdSetScissor(cmd, 0, 1, &scissor);
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            bindSets(cmd, layout);
+            vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &push);
+
+            // After the clear: the timestamps bracket the draws only
+            vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, 0);
+            for (uint32_t i = 0; i < repeat; i++)
+            {
+                if (shader == Shader::Water)
+                    drawGrid(cmd);
+                else
+                    vkCmdDraw(cmd, 3, 1, 0, 0);
+            }
+            vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, 1);
+            vkCmdEndRenderPass(cmd);
+            UploadContext::get().flush();
+
+            std::array<uint64_t, 2> ticks{};
+            if (vkGetQueryPoolResults(m_device, m_queryPool, 0, 2, sizeof(ticks), ticks.data(), sizeof(uint64_t),
+                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to read shader bench timestamps!");
+            }
+            if (sample > 0)
+                sampleMs.push_back(static_cast<double>(ticks[1] - ticks[0]) * m_timestampPeriod / 1e6);
+        }
+        destroyTarget(target);
+
+        std::sort(sampleMs.begin(), sampleMs.end());
+        Result result{shader, extent, repeat, samples};
+        result.medianMs = sampleMs[sampleMs.size() / 2];
+        result.minMs = sampleMs.front();
+        result.nsPerPixel = result.medianMs * 1e6 / (static_cast<double>(repeat) * extent.width * extent.height);
+        results.push_back(result);
+    }
+    return results;
+}
+
+bool ShaderBench::writeCsv(const std::vector<Result> &results, const std::string &filePath)
+{
+    std::ofstream file(filePath);
+    if (!file.is_open())
+        return false;
+
+    file << "Shader,Width,Height,Repeat,Samples,MedianMs,MinMs,NsPerPixel\n";
+    for (const Result &result : results)
+    {
+        file << shaderName(result.shader) << ',' << result.extent.width << ',' << result.extent.height << ',' << result.repeat << ','
+             << result.samples << ',' << result.medianMs << ',' << result.minMs << ',' << result.nsPerPixel << '\n';
+    }
+    return true;
+}
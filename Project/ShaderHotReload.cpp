@@ -0,0 +1,150 @@
+#include "ShaderHotReload.h"
+#include "ThreadAffinity.h"
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // SHADER_VARIANTS in shaders/CMakeLists.txt: also rebuilt whenever their source is
+    struct ShaderVariant
+    {
+        const char *source;
+        const char *spirvName;
+        const char *arguments;
+    };
+    constexpr ShaderVariant kVariants[] = {
+        {"water.frag", "water_rq.frag.spv", "--target-env vulkan1.2 -DRAY_QUERY"},
+        {"atmosphere.comp", "atmosphere_transmittance.comp.spv", "--target-env vulkan1.2 -DTRANSMITTANCE_LUT"},
+        {"atmosphere.comp", "atmosphere_multiscatter.comp.spv", "--target-env vulkan1.2 -DMULTISCATTER_LUT"},
+    };
+}
+
+ShaderHotReload::ShaderHotReload(fs::path sourceDir, fs::path outputDir, std::string compiler)
+    : m_sourceDir(std::move(sourceDir)), m_outputDir(std::move(outputDir)), m_compiler(std::move(compiler))
+{
+    // Baseline: the build has compiled everything up to now
+    findChanged();
+    m_watcher = std::thread(&ShaderHotReload::watchLoop, this);
+    std::cout << "[Shaders] Watching " << m_sourceDir.string() << " for changes\n";
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_watcher.join();
+}
+
+std::vector<std::string> ShaderHotReload::takeCompiled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> compiled;
+    compiled.swap(m_compiled);
+    return compiled;
+}
+
+bool ShaderHotReload::isShaderSource(const fs::path &path)
+{
+    const std::string extension = path.extension().string();
+    return extension == ".vert" || extension == ".frag" || extension == ".comp" ||
+           extension == ".tesc" || extension == ".tese";
+}
+
+void ShaderHotReload::watchLoop()
+{
+    ThreadAffinity::pinCurrentThread(ThreadRole::Service);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_wake.wait_for(lock, kPollInterval, [this]
+                            { return m_stop; }))
+    {
+        lock.unlock();
+        for (const fs::path &source : findChanged())
+        {
+            std::vector<std::pair<std::string, std::string>> outputs = {{source.filename().string() + ".spv", ""}};
+            for (const ShaderVariant &variant : kVariants)
+            {
+                if (source.filename() == variant.source)
+                {
+                    outputs.emplace_back(variant.spirvName, variant.arguments);
+                }
+            }
+            for (const auto &[spirvName, arguments] : outputs)
+            {
+                if (compile(source, m_outputDir / spirvName, arguments))
+                {
+                    std::cout << "[Shaders] Recompiled " << spirvName << "\n";
+                    std::lock_guard<std::mutex> compiledLock(m_mutex);
+                    m_compiled.push_back(spirvName);
+                }
+                else
+                {
+                    std::cerr << "[Shaders] " << spirvName << " failed to compile; keeping the previous SPIR-V\n";
+                }
+            }
+        }
+        lock.lock();
+    }
+}
+
+std::vector<fs::path> ShaderHotReload::findChanged()
+{
+    std::vector<fs::path> changed;
+    std::error_code error;
+    for (fs::directory_iterator it(m_sourceDir, error), end; !error && it != end; it.increment(error))
+    {
+        const fs::path &path = it->path();
+        if (!isShaderSource(path))
+        {
+            continue;
+        }
+        // A file mid-save may not be readable yet; the next poll sees it again
+        const fs::file_time_type writeTime = fs::last_write_time(path, error);
+        if (error)
+        {
+            error.clear();
+            continue;
+        }
+
+        auto recorded = m_writeTimes.find(path.string());
+        if (recorded == m_writeTimes.end())
+        {
+            m_writeTimes.emplace(path.string(), writeTime);
+            continue; // Not compiled by this watcher; a new shader has no pipeline reading it yet
+        }
+        if (recorded->second != writeTime)
+        {
+            recorded->second = writeTime;
+            changed.push_back(path);
+        }
+    }
+    return changed;
+}
+
+bool ShaderHotReload::compile(const fs::path &source, const fs::path &spirv, const std::string &arguments) const
+{
+    const fs::path temporary = spirv.string() + ".tmp";
+    std::string command = "\"" + m_compiler + "\" -V " + (arguments.empty() ? "" : arguments + " ") + "\"" + source.string() +
+                          "\" -o \"" + temporary.string() + "\"";
+#ifdef _WIN32
+    // cmd.exe strips the outer pair of quotes when the command starts with one
+    command = "\"" + command + "\"";
+#endif
+    if (std::system(command.c_str()) != 0)
+    {
+        std::error_code error;
+        fs::remove(temporary, error);
+        return false;
+    }
+
+    // Only a complete module replaces the one the pipelines load
+    std::error_code error;
+    fs::remove(spirv, error);
+    fs::rename(temporary, spirv, error);
+    return !error;
+}
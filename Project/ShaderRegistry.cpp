@@ -0,0 +1,60 @@
+#include "ShaderRegistry.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+
+namespace
+{
+#ifdef XERENDER_EMBED_SHADERS
+    constexpr std::string_view kShaderDirectory = "shaders/";
+
+    struct EmbeddedSpirv
+    {
+        const unsigned char *data;
+        size_t size;
+    };
+
+    // kSpirv0..N and kSpirv[], one entry per ShaderRegistry::kNames entry in the same order
+#include "EmbeddedShaderData.inc"
+
+    static_assert(std::size(kSpirv) == ShaderRegistry::kNames.size(), "embedded shader table out of step with its names");
+#endif
+
+    // Modules hot reload rebuilt; pipelines may be built on job threads
+    std::mutex g_rebuiltMutex;
+    std::vector<std::string> g_rebuilt;
+
+    bool isRebuilt(std::string_view name)
+    {
+        std::lock_guard<std::mutex> lock(g_rebuiltMutex);
+        return std::find(g_rebuilt.begin(), g_rebuilt.end(), name) != g_rebuilt.end();
+    }
+}
+
+std::vector<char> ShaderRegistry::load(const std::string &path)
+{
+#ifdef XERENDER_EMBED_SHADERS
+    const std::string_view view(path);
+    if (view.substr(0, kShaderDirectory.size()) == kShaderDirectory)
+    {
+        const std::string_view name = view.substr(kShaderDirectory.size());
+        const size_t index = indexOf(name);
+        if (index != kNotFound && !isRebuilt(name))
+        {
+            const EmbeddedSpirv &spirv = kSpirv[index];
+            return std::vector<char>(spirv.data, spirv.data + spirv.size);
+        }
+    }
+#endif
+    return VkUtils::readFile(path);
+}
+
+void ShaderRegistry::preferDisk(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(g_rebuiltMutex);
+    if (std::find(g_rebuilt.begin(), g_rebuilt.end(), name) == g_rebuilt.end())
+    {
+        g_rebuilt.push_back(name);
+    }
+}
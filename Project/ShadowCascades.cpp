@@ -0,0 +1,567 @@
+#include "ShadowCascades.h"
+#include "DynamicRendering.h"
+#include "GpuCulling.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "VulkanUtil.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+ShadowCascades::ShadowCascades(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount)
+    : m_device(device), m_frameCount(frameCount)
+{
+    // 32-bit float depth when it can be rendered and filtered; D16 always can
+    VkFormatProperties properties{};
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_D32_SFLOAT, &properties);
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                          VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((properties.optimalTilingFeatures & required) == required)
+    {
+        m_format = VK_FORMAT_D32_SFLOAT;
+    }
+
+    // Hardware 2x2 PCF; outside a map counts as lit
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shadow sampler!");
+    }
+
+    // Cascade matrices, maps
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = kMaxCascades;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shadow descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes = {{{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+                                                      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, kMaxCascades}}};
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shadow descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate shadow descriptor set!");
+    }
+
+    // One copy of the matrices per frame in flight, like WaterParamsBuffer
+    VkPhysicalDeviceProperties deviceProperties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(16, deviceProperties.limits.minUniformBufferOffsetAlignment);
+    m_uniformStride = (sizeof(ShadowUniforms) + alignment - 1) & ~(alignment - 1);
+    auto [buffer, memory] = VkUtils::CreateBuffer(
+        device, physicalDevice, m_uniformStride * frameCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_uniformBuffer = buffer;
+    m_uniformMapped = static_cast<uint8_t *>(VkUtils::MapBuffer(buffer));
+
+    // Only the position: one light-space matrix per draw
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4)};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shadow pipeline layout!");
+    }
+
+    createPipeline();
+    setQuality(ShadowQuality::Off);
+}
+
+ShadowCascades::~ShadowCascades()
+{
+    destroyTargets();
+
+    if (m_uniformBuffer != VK_NULL_HANDLE)
+    {
+        VkUtils::DestroyBuffer(m_uniformBuffer);
+    }
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+}
+
+ShadowCascades::Tier ShadowCascades::getTier(ShadowQuality quality)
+{
+    switch (quality)
+    {
+    case ShadowQuality::Low:
+        return {2, 1024, 0};
+    case ShadowQuality::Medium:
+        return {3, 2048, 1};
+    case ShadowQuality::High:
+        return {4, 2048, 2};
+    case ShadowQuality::Off:
+    default:
+        return {0, 1, 0};
+    }
+}
+
+void ShadowCascades::setQuality(ShadowQuality quality)
+{
+    const Tier tier = getTier(quality);
+    m_quality = quality;
+    m_filterRadius = tier.filterRadius;
+
+    // Off keeps one 1x1 map so the set stays valid; the shader never reaches it
+    const uint32_t targetCount = std::max(1u, tier.cascades);
+    const bool recreate = m_cascades[0].image == VK_NULL_HANDLE || tier.resolution != m_resolution ||
+                          targetCount != std::max(1u, m_cascadeCount);
+    m_cascadeCount = tier.cascades;
+    if (recreate)
+    {
+        destroyTargets();
+        m_resolution = tier.resolution;
+        createTargets(targetCount, m_resolution);
+        writeSet();
+    }
+
+    // Re-fitted and re-rendered from scratch on the next update
+    m_lightDirection = glm::vec3(0.0f);
+    m_nextCascade = 0;
+}
+
+// ============================================================================
+// PIPELINE
+// ============================================================================
+
+void ShadowCascades::createPipeline()
+{
+    if (m_pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(m_device, m_pipeline, nullptr);
+        vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+        m_renderPass = VK_NULL_HANDLE;
+    }
+
+    // Same single depth attachment as the graph's cascade passes
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = m_format;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthRef{0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.pDepthStencilAttachment = &depthRef;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shadow render pass!");
+    }
+    DynamicRendering::registerRenderPass(m_renderPass, renderPassInfo);
+
+    std::vector<char> code = ShaderRegistry::load("shaders/shadow_depth.vert.spv");
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+    VkShaderModule vertModule;
+    if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &vertModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader module: shaders/shadow_depth.vert.spv");
+    }
+
+    // Depth only: no fragment stage
+    VkPipelineShaderStageCreateInfo stage{};
+    stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stage.module = vertModule;
+    stage.pName = "main";
+
+    // The scene's packed vertices, position only, and the instances' model matrices
+    const std::array<VkVertexInputBindingDescription, 2> bindings = {PackedVertex::getBindingDescription(),
+                                                                     GpuCulling::getInstanceBindingDescription()};
+    const auto instanceAttributes = GpuCulling::getInstanceAttributeDescriptions();
+    const std::array<VkVertexInputAttributeDescription, 5> attributes = {PackedVertex::getAttributeDescriptions()[0], instanceAttributes[0],
+                                                                         instanceAttributes[1], instanceAttributes[2], instanceAttributes[3]};
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+    vertexInput.pVertexBindingDescriptions = bindings.data();
+    vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+    vertexInput.pVertexAttributeDescriptions = attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    // The scene draws double-sided; the slope-scaled bias keeps lit surfaces off their own depth
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_TRUE;
+    rasterizer.depthBiasConstantFactor = 1.25f;
+    rasterizer.depthBiasSlopeFactor = 1.75f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+
+    std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 1;
+    pipelineInfo.pStages = &stage;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_pipelineLayout;
+    pipelineInfo.renderPass = m_renderPass;
+    pipelineInfo.subpass = 0;
+
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    DynamicRendering::apply(pipelineInfo, renderingInfo);
+
+    VkResult result = vkCreateGraphicsPipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &m_pipeline);
+    vkDestroyShaderModule(m_device, vertModule, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shadow pipeline!");
+    }
+}
+
+// ============================================================================
+// TARGETS
+// ============================================================================
+
+void ShadowCascades::createTargets(uint32_t count, uint32_t resolution)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Cascade &cascade = m_cascades[i];
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_format;
+        imageInfo.extent = {resolution, resolution, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &cascade.image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create shadow cascade!");
+        }
+        GpuMemoryAllocator::get().allocateImage(cascade.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = cascade.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = m_format;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &cascade.view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create shadow cascade view!");
+        }
+        cascade.written = false;
+    }
+}
+
+void ShadowCascades::destroyTargets()
+{
+    for (Cascade &cascade : m_cascades)
+    {
+        if (cascade.view != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(m_device, cascade.view, nullptr);
+        }
+        if (cascade.image != VK_NULL_HANDLE)
+        {
+            GpuMemoryAllocator::get().destroyImage(cascade.image);
+        }
+        cascade = Cascade{};
+    }
+}
+
+void ShadowCascades::writeSet()
+{
+    VkDescriptorBufferInfo uniformInfo{m_uniformBuffer, 0, sizeof(ShadowUniforms)};
+
+    // Every element is statically used: the ones past the cascade count repeat the first map
+    std::array<VkDescriptorImageInfo, kMaxCascades> mapInfos{};
+    for (uint32_t i = 0; i < kMaxCascades; i++)
+    {
+        VkImageView view = m_cascades[i].view != VK_NULL_HANDLE ? m_cascades[i].view : m_cascades[0].view;
+        mapInfos[i] = {m_sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    }
+
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = m_set;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    writes[0].pBufferInfo = &uniformInfo;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = m_set;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorCount = kMaxCascades;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[1].pImageInfo = mapInfos.data();
+
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+// ============================================================================
+// FRAME
+// ============================================================================
+
+// glm::ortho maps depth to -1..1; Vulkan clips it to 0..1
+static glm::mat4 orthoZeroToOne(float left, float right, float bottom, float top, float zNear, float zFar)
+{
+    glm::mat4 m(1.0f);
+    m[0][0] = 2.0f / (right - left);
+    m[1][1] = 2.0f / (top - bottom);
+    m[2][2] = -1.0f / (zFar - zNear);
+    m[3][0] = -(right + left) / (right - left);
+    m[3][1] = -(top + bottom) / (top - bottom);
+    m[3][2] = -zNear / (zFar - zNear);
+    return m;
+}
+
+void ShadowCascades::update(const glm::vec3 &cameraPosition, const glm::vec3 &front, const glm::vec3 &up, const glm::vec3 &right,
+                            float fovY, float aspect, float nearPlane, const glm::vec3 &sunPosition)
+{
+    m_due.fill(false);
+    if (m_cascadeCount == 0)
+        return;
+
+    // A moved sun invalidates every cascade; round-robin only amortises camera motion
+    const glm::vec3 lightDirection = glm::normalize(sunPosition);
+    bool renderAll = !m_roundRobin || glm::any(glm::notEqual(lightDirection, m_lightDirection));
+    for (uint32_t i = 0; i < m_cascadeCount; i++)
+    {
+        renderAll = renderAll || !m_cascades[i].written;
+    }
+    m_lightDirection = lightDirection;
+
+    if (renderAll)
+    {
+        for (uint32_t i = 0; i < m_cascadeCount; i++)
+            m_due[i] = true;
+        m_nextCascade = 0;
+    }
+    else
+    {
+        m_due[m_nextCascade] = true;
+        m_nextCascade = (m_nextCascade + 1) % m_cascadeCount;
+    }
+
+    // Fixed orientation around the world origin: snapping in this space is stable frame to frame
+    const glm::vec3 lightUp = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -lightDirection, lightUp);
+
+    // Practical split: halfway between logarithmic and uniform
+    const float tanHalfFov = std::tan(fovY * 0.5f);
+    float sliceNear = nearPlane;
+    glm::vec3 casterMin(std::numeric_limits<float>::max());
+    glm::vec3 casterMax(-std::numeric_limits<float>::max());
+    for (uint32_t i = 0; i < m_cascadeCount; i++)
+    {
+        const float t = static_cast<float>(i + 1) / static_cast<float>(m_cascadeCount);
+        const float logSplit = nearPlane * std::pow(kShadowDistance / nearPlane, t);
+        const float uniformSplit = nearPlane + (kShadowDistance - nearPlane) * t;
+        const float sliceFar = 0.5f * (logSplit + uniformSplit);
+
+        if (!m_due[i])
+        {
+            sliceNear = sliceFar;
+            continue;
+        }
+
+        // Bounding sphere of the slice: its radius does not depend on where the camera looks
+        std::array<glm::vec3, 8> corners;
+        glm::vec3 center(0.0f);
+        for (uint32_t c = 0; c < 8; c++)
+        {
+            const float depth = c < 4 ? sliceNear : sliceFar;
+            const float halfHeight = depth * tanHalfFov;
+            const float halfWidth = halfHeight * aspect;
+            corners[c] = cameraPosition + front * depth + right * ((c & 1) ? halfWidth : -halfWidth) +
+                         up * ((c & 2) ? halfHeight : -halfHeight);
+            center += corners[c] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const glm::vec3 &corner : corners)
+        {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // Whole texels only, so static geometry lands on the same texels as the camera moves
+        const float texelSize = 2.0f * radius / static_cast<float>(m_resolution);
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+        // View-space z is negative ahead of the light; the near side extends towards the sun for casters
+        const glm::vec3 boxMin(lightCenter.x - radius, lightCenter.y - radius, -lightCenter.z - radius - kCasterExtrusion);
+        const glm::vec3 boxMax(lightCenter.x + radius, lightCenter.y + radius, -lightCenter.z + radius);
+        m_cascades[i].viewProjection = orthoZeroToOne(boxMin.x, boxMax.x, boxMin.y, boxMax.y, boxMin.z, boxMax.z) * lightView;
+        casterMin = glm::min(casterMin, boxMin);
+        casterMax = glm::max(casterMax, boxMax);
+
+        sliceNear = sliceFar;
+    }
+
+    m_casterViewProjection = orthoZeroToOne(casterMin.x, casterMax.x, casterMin.y, casterMax.y, casterMin.z, casterMax.z) * lightView;
+}
+
+uint32_t ShadowCascades::getDueCount() const
+{
+    return static_cast<uint32_t>(std::count(m_due.begin(), m_due.begin() + m_cascadeCount, true));
+}
+
+uint32_t ShadowCascades::writeUniforms(uint32_t frameIndex)
+{
+    if (frameIndex >= m_frameCount)
+    {
+        throw std::out_of_range("ShadowCascades frame index out of range!");
+    }
+
+    ShadowUniforms uniforms{};
+    for (uint32_t i = 0; i < kMaxCascades; i++)
+    {
+        uniforms.viewProjection[i] = m_cascades[i].viewProjection;
+    }
+    uniforms.params = glm::vec4(static_cast<float>(m_cascadeCount), static_cast<float>(m_filterRadius),
+                                1.0f / static_cast<float>(m_resolution), 0.0f);
+
+    const VkDeviceSize offset = static_cast<VkDeviceSize>(frameIndex) * m_uniformStride;
+    memcpy(m_uniformMapped + offset, &uniforms, sizeof(ShadowUniforms));
+    return static_cast<uint32_t>(offset);
+}
+
+RenderGraphResource ShadowCascades::importCascade(RenderGraph &graph, uint32_t cascade)
+{
+    static const char *const kNames[kMaxCascades] = {"ShadowCascade0", "ShadowCascade1", "ShadowCascade2", "ShadowCascade3"};
+
+    Cascade &target = m_cascades[cascade];
+    RenderGraphImageDesc desc{m_format, {m_resolution, m_resolution}, VK_SAMPLE_COUNT_1_BIT,
+                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT};
+    // Kept shader-readable between frames: the cascades not due are only sampled
+    const RenderGraphImageState shaderRead{VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0};
+    const RenderGraphImageState initial = target.written ? shaderRead : RenderGraphImageState{};
+    if (m_due[cascade])
+    {
+        target.written = true;
+    }
+    return graph.importImage(kNames[cascade], target.image, target.view, desc, initial, shaderRead);
+}
+
+void ShadowCascades::recordCascade(VkCommandBuffer cmd, uint32_t cascade, const Scene &scene, const std::vector<SceneDraw> &draws,
+                                   VkBuffer vertexBuffer, VkBuffer indexBuffer, VkBuffer instanceBuffer) const
+{
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(cmd, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    const glm::mat4 &viewProjection = m_cascades[cascade].viewProjection;
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &viewProjection);
+    for (const SceneDraw &draw : draws)
+    {
+        const VkDeviceSize instanceOffset = draw.instanceOffset;
+        vkCmdBindVertexBuffers(cmd, GpuCulling::kInstanceBinding, 1, &instanceBuffer, &instanceOffset);
+        vkCmdDrawIndexed(cmd, draw.range.indexCount, draw.instanceCount, draw.range.firstIndex, draw.range.vertexOffset, 0);
+    }
+}
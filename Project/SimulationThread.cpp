@@ -0,0 +1,177 @@
+#include "SimulationThread.h"
+#include "CpuProfiler.h"
+#include "ThreadAffinity.h"
+
+SimulationThread::SimulationThread(const Camera &camera)
+{
+    m_state.camera = camera;
+    m_published = m_state;
+    m_thread = std::thread([this]
+                           { run(); });
+}
+
+SimulationThread::~SimulationThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void SimulationThread::setPipelined(bool pipelined)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pipelined = pipelined;
+}
+
+void SimulationThread::setClockMode(FrameClock::Mode mode, double fixedStep)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_clockMode = mode;
+    m_fixedStep = fixedStep;
+}
+
+void SimulationThread::setCameraPath(CameraPath path)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitForStepLocked(lock);
+    m_cameraPath = std::move(path);
+    if (m_cameraPath)
+        applyPose(m_state.camera, m_cameraPath(m_state.frame));
+}
+
+void SimulationThread::restartClock(std::vector<double> replayTimes)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitForStepLocked(lock);
+    m_clock.restart(std::move(replayTimes));
+    m_state.frame = 0;
+    m_state.time = 0.0;
+    m_state.deltaTime = 0.0f;
+    if (m_cameraPath)
+        applyPose(m_state.camera, m_cameraPath(0));
+    m_restarted = true;
+}
+
+std::vector<double> SimulationThread::getClockRecording()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitForStepLocked(lock);
+    return m_clock.getRecording();
+}
+
+void SimulationThread::waitForStepLocked(std::unique_lock<std::mutex> &lock)
+{
+    m_stepped.wait(lock, [this]
+                   { return !m_stepRequested; });
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+const FrameSnapshot &SimulationThread::advance(const SimulationInput &input)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    waitForStepLocked(lock);
+
+    if (!m_pipelined)
+    {
+        // The worker is idle: step here, from this frame's input. A restarted clock shows frame 0 first
+        if (!m_restarted)
+            step(input, m_clockMode, m_fixedStep);
+        m_restarted = false;
+        m_published = m_state;
+        return m_published;
+    }
+
+    // The previous step's result is published; the next one runs while the frame is recorded
+    m_published = m_state;
+    m_restarted = false;
+    m_input = input;
+    m_inputClockMode = m_clockMode;
+    m_inputFixedStep = m_fixedStep;
+    m_stepRequested = true;
+    m_wake.notify_one();
+    return m_published;
+}
+
+void SimulationThread::run()
+{
+    CPU_THREAD_NAME("Simulation");
+    ThreadAffinity::pinCurrentThread(ThreadRole::Simulation);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]
+                    { return m_stepRequested || m_quit; });
+        if (m_quit)
+            return;
+
+        // m_state is the worker's until the step is marked done
+        const SimulationInput input = m_input;
+        const FrameClock::Mode clockMode = m_inputClockMode;
+        const double fixedStep = m_inputFixedStep;
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            step(input, clockMode, fixedStep);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        m_error = error;
+        m_stepRequested = false;
+        m_stepped.notify_all();
+    }
+}
+
+void SimulationThread::applyPose(Camera &camera, const CameraPose &pose)
+{
+    camera.position = pose.position;
+    camera.setYaw(pose.yaw);
+    camera.setPitch(pose.pitch);
+}
+
+void SimulationThread::step(const SimulationInput &input, FrameClock::Mode clockMode, double fixedStep)
+{
+    CPU_ZONE("SimulationThread::step");
+    m_clock.setMode(clockMode, fixedStep);
+    m_clock.advance(input.deltaTime);
+    const float deltaTime = static_cast<float>(m_clock.getDeltaTime());
+
+    Camera &camera = m_state.camera;
+    if (m_cameraPath)
+    {
+        // At the frame being stepped to, so the pose and the clock always agree
+        applyPose(camera, m_cameraPath(m_clock.getFrame()));
+    }
+    else if (input.cameraPose)
+    {
+        applyPose(camera, *input.cameraPose);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            if (input.heldMoveKeys & (1u << i))
+                camera.processKeyboard(SimulationInput::kMoveKeys[i], deltaTime);
+        }
+        if (input.look != glm::vec2(0.0f))
+            camera.processMouseMovement(input.look.x, input.look.y);
+        if (input.scroll != 0.0f)
+            camera.processMouseScroll(input.scroll);
+    }
+
+    m_state.frame = m_clock.getFrame();
+    m_state.time = m_clock.getTime();
+    m_state.deltaTime = deltaTime;
+}
@@ -1,19 +1,13 @@
 #include "SkyboxPipeline.h"
-#include <fstream>
+#include "DynamicRendering.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include <stdexcept>
 #include <vector>
 
 VkShaderModule SkyboxPipeline::loadShader(VkDevice device, const std::string& path)
 {
-    std::ifstream file(path, std::ios::ate | std::ios::binary);
-    if (!file.is_open())
-        throw std::runtime_error("Failed to open shader file: " + path);
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
+    const std::vector<char> buffer = ShaderRegistry::load(path);
 
     VkShaderModuleCreateInfo info{};
     info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -28,7 +22,6 @@ VkShaderModule SkyboxPipeline::loadShader(VkDevice device, const std::string& pa
 }
 
 void SkyboxPipeline::create(VkDevice device,
-    VkExtent2D extent,
     VkRenderPass renderPass,
     VkDescriptorSetLayout globalDescriptorSetLayout,  // set 0
     VkDescriptorSetLayout skyboxDescriptorSetLayout,  // set 1
@@ -77,25 +70,17 @@ void SkyboxPipeline::create(VkDevice device,
     assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     assembly.primitiveRestartEnable = VK_FALSE;
 
-    // ---- Viewport & Scissor ----
-    VkViewport viewport{};
-    viewport.x = 0.f;
-    viewport.y = 0.f;
-    viewport.width = (float)extent.width;
-    viewport.height = (float)extent.height;
-    viewport.minDepth = 0.f;
-    viewport.maxDepth = 1.f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = extent;
-
+    // ---- Viewport & Scissor: dynamic, set by the pass ----
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     // ---- Rasterizer ----
     VkPipelineRasterizationStateCreateInfo raster{};
@@ -159,9 +144,9 @@ void SkyboxPipeline::create(VkDevice device,
     setLayoutsArr[1] = skyboxDescriptorSetLayout;
 
     VkPushConstantRange pushRange{};
-    pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
     pushRange.offset = 0;
-    pushRange.size = sizeof(float); // skyboxScale
+    pushRange.size = sizeof(PushConstants);
 
     VkPipelineLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -182,6 +167,7 @@ void SkyboxPipeline::create(VkDevice device,
     info.pVertexInputState = &vertexInput;
     info.pInputAssemblyState = &assembly;
     info.pViewportState = &viewportState;
+    info.pDynamicState = &dynamicState;
     info.pRasterizationState = &raster;
     info.pMultisampleState = &ms;
     info.pDepthStencilState = &depth;
@@ -192,7 +178,10 @@ void SkyboxPipeline::create(VkDevice device,
     info.basePipelineHandle = VK_NULL_HANDLE;
     info.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline) != VK_SUCCESS)
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    DynamicRendering::apply(info, renderingInfo);
+
+    if (vkCreateGraphicsPipelines(device, PipelineCache::get().handle(), 1, &info, nullptr, &pipeline) != VK_SUCCESS)
         throw std::runtime_error("Failed to create skybox pipeline!");
 }
 
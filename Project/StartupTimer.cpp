@@ -0,0 +1,62 @@
+#include "StartupTimer.h"
+#include <algorithm>
+#include <cstdio>
+
+StartupTimer::Scope::Scope(StartupTimer &timer, const char *name, uint32_t threadIndex)
+    : m_timer(timer), m_name(name), m_threadIndex(threadIndex), m_start(Clock::now())
+{
+}
+
+StartupTimer::Scope::~Scope()
+{
+    m_timer.record(m_name, m_threadIndex, m_start, Clock::now());
+}
+
+void StartupTimer::record(const char *name, uint32_t threadIndex, Clock::time_point start, Clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phases.push_back({name, threadIndex, sinceStart(start), std::chrono::duration<double, std::milli>(end - start).count()});
+}
+
+bool StartupTimer::markFirstFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_firstFrameMs >= 0.0)
+        return false;
+    m_firstFrameMs = sinceStart(Clock::now());
+    return true;
+}
+
+void StartupTimer::writeReport(std::ostream &out) const
+{
+    std::vector<Phase> phases;
+    double firstFrameMs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        phases = m_phases;
+        firstFrameMs = m_firstFrameMs;
+    }
+    std::stable_sort(phases.begin(), phases.end(), [](const Phase &a, const Phase &b)
+                     { return a.startMs < b.startMs; });
+
+    char line[160];
+    out << "[Startup] Phase                     Start ms   Time ms  Thread\n";
+    double mainMs = 0.0;
+    double jobMs = 0.0;
+    for (const Phase &phase : phases)
+    {
+        char thread[16];
+        if (phase.threadIndex == 0)
+            std::snprintf(thread, sizeof(thread), "main");
+        else
+            std::snprintf(thread, sizeof(thread), "job %u", phase.threadIndex);
+        std::snprintf(line, sizeof(line), "[Startup] %-24s %9.1f %9.1f  %s\n", phase.name, phase.startMs, phase.durationMs, thread);
+        out << line;
+        (phase.threadIndex == 0 ? mainMs : jobMs) += phase.durationMs;
+    }
+
+    // Job phases ran beside the main thread's: their time is what the overlap took off a serial startup
+    std::snprintf(line, sizeof(line), "[Startup] Main thread %.1f ms, jobs %.1f ms alongside; first frame at %.1f ms\n", mainMs, jobMs,
+                  firstFrameMs);
+    out << line;
+}
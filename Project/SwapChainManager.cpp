@@ -1,6 +1,7 @@
 #include "SwapChainManager.h"
 #include "VulkanBase.h"
 #include "VulkanUtil.h"
+#include "GpuMemoryAllocator.h"
 #include <algorithm>
 #include <iostream> // For debugging
 
@@ -13,6 +14,15 @@ SwapChainManager::SwapChainManager(VkDevice device, VkPhysicalDevice physicalDev
     createImageViews();
 }
 
+SwapChainManager::SwapChainManager(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, uint32_t imageCount)
+    : m_device(device), m_physicalDevice(physicalDevice), m_surface(VK_NULL_HANDLE), m_window(nullptr),
+      m_swapChain(VK_NULL_HANDLE), m_offscreen(true), m_offscreenImageCount(imageCount),
+      m_swapChainImageFormat(VK_FORMAT_B8G8R8A8_UNORM), m_swapChainExtent(extent)
+{
+    createSwapChain();
+    createImageViews();
+}
+
 SwapChainManager::~SwapChainManager()
 {
     cleanupSwapChain();
@@ -21,24 +31,33 @@ SwapChainManager::~SwapChainManager()
 void SwapChainManager::createSwapChain()
 {
     // Clean up old swapchain if it exists
-    if (m_swapChain != VK_NULL_HANDLE)
+    if (m_swapChain != VK_NULL_HANDLE || !m_swapChainImages.empty())
     {
         cleanupSwapChain();
     }
 
+    if (m_offscreen)
+    {
+        createOffscreenImages();
+        return;
+    }
+
     // Query swap chain support details
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(m_physicalDevice);
 
     // Choose surface format, present mode, and extent
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+    m_availablePresentModes = swapChainSupport.presentModes;
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    // Determine the number of images in the swap chain
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
+    // Determine the number of images in the swap chain: fewer queue fewer frames ahead of the display
+    m_minImageCount = swapChainSupport.capabilities.minImageCount;
+    m_maxImageCount = swapChainSupport.capabilities.maxImageCount;
+    uint32_t imageCount = m_preferredImageCount != 0 ? std::max(m_preferredImageCount, m_minImageCount) : m_minImageCount + 1;
+    if (m_maxImageCount > 0 && imageCount > m_maxImageCount)
     {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
+        imageCount = m_maxImageCount;
     }
 
     // Fill out swap chain creation info structure
@@ -51,6 +70,16 @@ void SwapChainManager::createSwapChain()
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // Frame readbacks (screenshots, image-quality captures) copy straight out of the swapchain image
+    if (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+    {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    // Stereo frames copy both eyes in (Multiview.h)
+    if (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+    {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
 
     VkUtils::QueueFamilyIndices indices = VkUtils::FindQueueFamilies(m_physicalDevice, m_surface);
     uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
@@ -70,7 +99,7 @@ void SwapChainManager::createSwapChain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE; // If there was an old swapchain, set it here
+    createInfo.oldSwapchain = m_retiredSwapChain; // Lets the driver reuse its resources on a resize
 
     // Create the swap chain
     VkResult result = vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapChain);
@@ -106,6 +135,34 @@ void SwapChainManager::createSwapChain()
 
     m_swapChainImageFormat = surfaceFormat.format;
     m_swapChainExtent = extent;
+    m_presentMode = presentMode;
+}
+
+void SwapChainManager::createOffscreenImages()
+{
+    // Same format the windowed path prefers; transfer source so frames can still be read back
+    m_swapChainImages.resize(m_offscreenImageCount);
+    for (VkImage &image : m_swapChainImages)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_swapChainImageFormat;
+        imageInfo.extent = {m_swapChainExtent.width, m_swapChainExtent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create offscreen target image!");
+        }
+        GpuMemoryAllocator::get().allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
 }
 
 void SwapChainManager::createImageViews()
@@ -136,8 +193,46 @@ void SwapChainManager::createImageViews()
     }
 }
 
+void SwapChainManager::recreateSwapChain()
+{
+    if (m_offscreen)
+    {
+        cleanupSwapChain();
+        createSwapChain();
+        createImageViews();
+        return;
+    }
+
+    // Two resizes in quick succession: the older retiree has had a full drain since
+    destroyRetired();
+    m_retiredSwapChain = m_swapChain;
+    m_retiredImageViews = std::move(m_swapChainImageViews);
+    m_swapChainImageViews.clear();
+    m_swapChainImages.clear();
+    m_swapChain = VK_NULL_HANDLE;
+
+    createSwapChain();
+    createImageViews();
+}
+
+void SwapChainManager::destroyRetired()
+{
+    for (auto imageView : m_retiredImageViews)
+    {
+        vkDestroyImageView(m_device, imageView, nullptr);
+    }
+    m_retiredImageViews.clear();
+
+    if (m_retiredSwapChain != VK_NULL_HANDLE)
+    {
+        vkDestroySwapchainKHR(m_device, m_retiredSwapChain, nullptr);
+        m_retiredSwapChain = VK_NULL_HANDLE;
+    }
+}
+
 void SwapChainManager::cleanupSwapChain()
 {
+    destroyRetired();
 
     for (auto imageView : m_swapChainImageViews)
     {
@@ -150,6 +245,15 @@ void SwapChainManager::cleanupSwapChain()
         vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
         m_swapChain = VK_NULL_HANDLE;
     }
+
+    if (m_offscreen)
+    {
+        for (VkImage image : m_swapChainImages)
+        {
+            GpuMemoryAllocator::get().destroyImage(image);
+        }
+    }
+    m_swapChainImages.clear();
 }
 
 SwapChainSupportDetails SwapChainManager::querySwapChainSupport(VkPhysicalDevice device)
@@ -204,7 +308,13 @@ VkSurfaceFormatKHR SwapChainManager::chooseSwapSurfaceFormat(const std::vector<V
 
 VkPresentModeKHR SwapChainManager::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes)
 {
-    // First, try to find VK_PRESENT_MODE_IMMEDIATE_KHR for maximum performance (no VSync)
+    // The runtime setting, when the surface has it
+    if (std::find(availablePresentModes.begin(), availablePresentModes.end(), m_preferredPresentMode) != availablePresentModes.end())
+    {
+        return m_preferredPresentMode;
+    }
+
+    // Otherwise, try to find VK_PRESENT_MODE_IMMEDIATE_KHR for maximum performance (no VSync)
     for (const auto &availablePresentMode : availablePresentModes)
     {
         if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
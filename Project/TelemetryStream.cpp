@@ -0,0 +1,244 @@
+#include "TelemetryStream.h"
+#include "ThreadAffinity.h"
+#include "Lib/json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace
+{
+    struct TimeStats
+    {
+        uint64_t count = 0;
+        double sum = 0.0;
+        double max = 0.0;
+        std::array<uint32_t, TelemetryStream::kHistogramEdgesMs.size() + 1> histogram{};
+
+        void add(double ms)
+        {
+            count++;
+            sum += ms;
+            max = std::max(max, ms);
+            const auto edge = std::lower_bound(TelemetryStream::kHistogramEdgesMs.begin(), TelemetryStream::kHistogramEdgesMs.end(), ms);
+            histogram[edge - TelemetryStream::kHistogramEdgesMs.begin()]++;
+        }
+
+        json toJson() const
+        {
+            return {{"mean", count ? sum / count : 0.0}, {"max", max}, {"histogram", histogram}};
+        }
+    };
+
+    struct PassStats
+    {
+        double sum = 0.0;
+        uint32_t count = 0;
+    };
+
+    void closeSocket(uintptr_t socket)
+    {
+#ifdef _WIN32
+        closesocket(static_cast<SOCKET>(socket));
+        WSACleanup();
+#else
+        close(static_cast<int>(socket));
+#endif
+    }
+}
+
+void TelemetrySample::addPass(const std::string &name, double ms)
+{
+    if (passCount >= kMaxPasses)
+        return;
+    const size_t length = std::min<size_t>(name.size(), kNameLength - 1);
+    std::memcpy(passNames[passCount].data(), name.data(), length);
+    passNames[passCount][length] = '\0';
+    passMs[passCount] = static_cast<float>(ms);
+    passCount++;
+}
+
+TelemetryStream::TelemetryStream(const std::string &endpoint)
+    : m_endpoint(endpoint)
+{
+    const size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == endpoint.size())
+    {
+        std::cerr << "Telemetry endpoint is not host:port: " << endpoint << std::endl;
+        return;
+    }
+    const std::string host = endpoint.substr(0, colon);
+    const std::string port = endpoint.substr(colon + 1);
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        std::cerr << "Telemetry: WSAStartup failed" << std::endl;
+        return;
+    }
+#endif
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *resolved = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &resolved) != 0 || !resolved)
+    {
+        std::cerr << "Telemetry: cannot resolve " << endpoint << std::endl;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return;
+    }
+    const auto socketHandle = socket(resolved->ai_family, resolved->ai_socktype, resolved->ai_protocol);
+#ifdef _WIN32
+    const bool opened = socketHandle != INVALID_SOCKET;
+#else
+    const bool opened = socketHandle >= 0;
+#endif
+    if (opened && resolved->ai_addrlen <= m_address.size())
+    {
+        m_socket = static_cast<Socket>(socketHandle);
+        std::memcpy(m_address.data(), resolved->ai_addr, resolved->ai_addrlen);
+        m_addressLength = static_cast<uint32_t>(resolved->ai_addrlen);
+    }
+    freeaddrinfo(resolved);
+    if (!isOpen())
+    {
+        std::cerr << "Telemetry: cannot open a UDP socket for " << endpoint << std::endl;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return;
+    }
+
+    m_thread = std::thread(&TelemetryStream::run, this);
+    std::cout << "[Telemetry] Streaming frame metrics to " << endpoint << " (UDP, 1 Hz)\n";
+}
+
+TelemetryStream::~TelemetryStream()
+{
+    m_quit.store(true, std::memory_order_relaxed);
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    if (isOpen())
+    {
+        closeSocket(static_cast<uintptr_t>(m_socket));
+    }
+}
+
+void TelemetryStream::push(const TelemetrySample &sample)
+{
+    const uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= kRingSize)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_ring[head & (kRingSize - 1)] = sample;
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+void TelemetryStream::run()
+{
+    ThreadAffinity::pinCurrentThread(ThreadRole::Service);
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point nextSend = start + std::chrono::milliseconds(kSendIntervalMs);
+
+    TimeStats frameStats, gpuStats, cpuStats;
+    std::map<std::string, PassStats> passes;
+    bool hasMemory = false;
+    uint64_t memoryUsage = 0;
+    uint64_t memoryBudget = 0;
+    uint64_t droppedReported = 0;
+
+    for (bool last = false; !last;)
+    {
+        last = m_quit.load(std::memory_order_relaxed);
+        if (!last)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(kDrainMs));
+        }
+
+        // Drain: the slot is copied out before the tail releases it to the producer
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        const uint64_t head = m_head.load(std::memory_order_acquire);
+        for (; tail != head; tail++)
+        {
+            const TelemetrySample &sample = m_ring[tail & (kRingSize - 1)];
+            frameStats.add(sample.frameMs);
+            gpuStats.add(sample.gpuMs);
+            cpuStats.add(sample.cpuMs);
+            for (uint32_t i = 0; i < sample.passCount; i++)
+            {
+                PassStats &pass = passes[sample.passNames[i].data()];
+                pass.sum += sample.passMs[i];
+                pass.count++;
+            }
+            if (sample.hasMemory)
+            {
+                hasMemory = true;
+                memoryUsage = sample.memoryUsage;
+                memoryBudget = sample.memoryBudget;
+            }
+        }
+        m_tail.store(tail, std::memory_order_release);
+
+        const Clock::time_point now = Clock::now();
+        if (now < nextSend && !last)
+            continue;
+        nextSend = now + std::chrono::milliseconds(kSendIntervalMs);
+
+        const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+        json datagram;
+        datagram["t"] = std::chrono::duration<double>(now - start).count();
+        datagram["frames"] = frameStats.count;
+        datagram["dropped"] = dropped - droppedReported;
+        datagram["frameMs"] = frameStats.toJson();
+        datagram["gpuMs"] = gpuStats.toJson();
+        datagram["cpuMs"] = cpuStats.toJson();
+        datagram["passes"] = json::object();
+        for (const auto &pass : passes)
+        {
+            datagram["passes"][pass.first] = pass.second.sum / pass.second.count;
+        }
+        if (hasMemory)
+        {
+            datagram["memory"] = {{"usage", memoryUsage}, {"budget", memoryBudget}};
+        }
+        const std::string payload = datagram.dump();
+        const auto sent = sendto(m_socket, payload.data(), static_cast<int>(payload.size()), 0,
+                                 reinterpret_cast<const sockaddr *>(m_address.data()), m_addressLength);
+        if (sent >= 0 && static_cast<size_t>(sent) == payload.size())
+        {
+            m_sent.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        droppedReported = dropped;
+        frameStats = TimeStats{};
+        gpuStats = TimeStats{};
+        cpuStats = TimeStats{};
+        passes.clear();
+        hasMemory = false;
+        m_wantMemory.store(true, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,516 @@
+#include "TemporalUpscaler.h"
+#include "DynamicRendering.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    float halton(uint32_t index, uint32_t base)
+    {
+        float result = 0.0f;
+        float fraction = 1.0f;
+        while (index > 0)
+        {
+            fraction /= static_cast<float>(base);
+            result += fraction * static_cast<float>(index % base);
+            index /= base;
+        }
+        return result;
+    }
+
+    // Read by the resolve and the composite; the graph orders them against the writes
+    constexpr VkPipelineStageFlags kHistoryStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+TemporalUpscaler::TemporalUpscaler(VkDevice device, VkExtent2D extent)
+    : m_device(device), m_extent(extent)
+{
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal upscaler sampler!");
+    }
+
+    createLowResRenderPass();
+    createResolvePipeline();
+    createTargets();
+    writeSets();
+}
+
+TemporalUpscaler::~TemporalUpscaler()
+{
+    destroyTargets();
+
+    vkDestroyPipeline(m_device, m_compositePipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_compositeLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_compositeSetLayout, nullptr);
+    vkDestroyPipeline(m_device, m_resolvePipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_resolveLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_resolveSetLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyRenderPass(m_device, m_lowResRenderPass, nullptr);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+}
+
+void TemporalUpscaler::resize(VkExtent2D extent)
+{
+    destroyTargets();
+    m_extent = extent;
+    createTargets();
+    writeSets();
+    m_historyValid = false;
+}
+
+VkShaderModule TemporalUpscaler::loadShader(const char *path) const
+{
+    std::vector<char> code = ShaderRegistry::load(path);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("failed to create shader module: ") + path);
+    }
+    return module;
+}
+
+// ============================================================================
+// PIPELINES
+// ============================================================================
+
+void TemporalUpscaler::createLowResRenderPass()
+{
+    // Same attachment the graph builds for the low-res pass; only used for pipeline compatibility
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = kFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorRef;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_lowResRenderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal upscaler render pass!");
+    }
+    DynamicRendering::registerRenderPass(m_lowResRenderPass, renderPassInfo);
+}
+
+void TemporalUpscaler::createResolvePipeline()
+{
+    // Resolve: current low-res, previous history, history written
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i < 2 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_resolveSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal resolve descriptor set layout!");
+    }
+
+    // Composite: the history it blends
+    VkDescriptorSetLayoutBinding compositeBinding{};
+    compositeBinding.binding = 0;
+    compositeBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    compositeBinding.descriptorCount = 1;
+    compositeBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &compositeBinding;
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_compositeSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal composite descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * 2 + 2};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 4;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal upscaler descriptor pool!");
+    }
+
+    std::array<VkDescriptorSetLayout, 4> layouts = {m_resolveSetLayout, m_resolveSetLayout, m_compositeSetLayout, m_compositeSetLayout};
+    std::array<VkDescriptorSet, 4> sets{};
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(sets.size());
+    allocInfo.pSetLayouts = layouts.data();
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, sets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate temporal upscaler descriptor sets!");
+    }
+    m_resolveSets = {sets[0], sets[1]};
+    m_compositeSets = {sets[2], sets[3]};
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ResolvePush)};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_resolveSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_resolveLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal resolve pipeline layout!");
+    }
+
+    pipelineLayoutInfo.pSetLayouts = &m_compositeSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_compositeLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal composite pipeline layout!");
+    }
+
+    VkShaderModule module = loadShader("shaders/temporal_resolve.comp.spv");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_resolveLayout;
+
+    VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &m_resolvePipeline);
+    vkDestroyShaderModule(m_device, module, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal resolve pipeline!");
+    }
+}
+
+void TemporalUpscaler::createCompositePipeline(VkRenderPass renderPass, VkSampleCountFlagBits samples)
+{
+    if (m_compositePipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(m_device, m_compositePipeline, nullptr);
+        m_compositePipeline = VK_NULL_HANDLE;
+    }
+
+    // Full-screen triangle with screen UVs, shared with the effects
+    VkShaderModule vertModule = loadShader("shaders/sunrays.vert.spv");
+    VkShaderModule fragModule = loadShader("shaders/temporal_composite.frag.spv");
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> stages{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertModule;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragModule;
+    stages[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    // The overlay is resolved already: one shading sample per pixel is enough
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = samples;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+
+    // Premultiplied: fog * alpha + rays, over the scene
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+    pipelineInfo.pStages = stages.data();
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_compositeLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    DynamicRendering::apply(pipelineInfo, renderingInfo);
+
+    VkResult result = vkCreateGraphicsPipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &m_compositePipeline);
+    vkDestroyShaderModule(m_device, fragModule, nullptr);
+    vkDestroyShaderModule(m_device, vertModule, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create temporal composite pipeline!");
+    }
+}
+
+// ============================================================================
+// TARGETS
+// ============================================================================
+
+void TemporalUpscaler::createTargets()
+{
+    m_lowResExtent = {std::max(1u, (m_extent.width + 1) / 2), std::max(1u, (m_extent.height + 1) / 2)};
+
+    auto createTarget = [this](VkExtent2D extent, VkImageUsageFlags usage, VkImage &image, VkImageView &view)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = kFormat;
+        imageInfo.extent = {extent.width, extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create temporal upscaler target!");
+        }
+        GpuMemoryAllocator::get().allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = kFormat;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create temporal upscaler target view!");
+        }
+    };
+
+    createTarget(m_lowResExtent, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, m_lowResImage, m_lowResView);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        createTarget(m_extent, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, m_historyImages[i], m_historyViews[i]);
+    }
+}
+
+void TemporalUpscaler::destroyTargets()
+{
+    auto destroyTarget = [this](VkImage &image, VkImageView &view)
+    {
+        if (view != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(m_device, view, nullptr);
+            view = VK_NULL_HANDLE;
+        }
+        if (image != VK_NULL_HANDLE)
+        {
+            GpuMemoryAllocator::get().destroyImage(image);
+            image = VK_NULL_HANDLE;
+        }
+    };
+
+    destroyTarget(m_lowResImage, m_lowResView);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        destroyTarget(m_historyImages[i], m_historyViews[i]);
+    }
+}
+
+void TemporalUpscaler::writeSets()
+{
+    for (uint32_t target = 0; target < 2; target++)
+    {
+        VkDescriptorImageInfo currentInfo{m_sampler, m_lowResView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        VkDescriptorImageInfo historyInfo{m_sampler, m_historyViews[1 - target], VK_IMAGE_LAYOUT_GENERAL};
+        VkDescriptorImageInfo outputInfo{VK_NULL_HANDLE, m_historyViews[target], VK_IMAGE_LAYOUT_GENERAL};
+        VkDescriptorImageInfo compositeInfo{m_sampler, m_historyViews[target], VK_IMAGE_LAYOUT_GENERAL};
+
+        std::array<VkWriteDescriptorSet, 4> writes{};
+        for (uint32_t i = 0; i < writes.size(); i++)
+        {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = i < 3 ? m_resolveSets[target] : m_compositeSets[target];
+            writes[i].dstBinding = i < 3 ? i : 0;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = i == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        }
+        writes[0].pImageInfo = &currentInfo;
+        writes[1].pImageInfo = &historyInfo;
+        writes[2].pImageInfo = &outputInfo;
+        writes[3].pImageInfo = &compositeInfo;
+
+        vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+}
+
+// ============================================================================
+// FRAME
+// ============================================================================
+
+void TemporalUpscaler::beginFrame(const glm::mat4 &viewProjection)
+{
+    m_target = 1 - m_target;
+
+    // Halton(2, 3) in (-0.5, 0.5) low-res pixels; index 0 is skipped, it sits on the pixel corner
+    m_phase = (m_phase + 1) % kJitterPhases;
+    m_push.jitter = glm::vec2(halton(m_phase + 1, 2), halton(m_phase + 1, 3)) - 0.5f;
+
+    m_push.reprojection = m_prevViewProjection * glm::inverse(viewProjection);
+    m_push.currentWeight = m_currentWeight;
+    m_push.historyValid = m_historyValid ? 1.0f : 0.0f;
+
+    m_prevViewProjection = viewProjection;
+    m_historyValid = true;
+}
+
+RenderGraphResource TemporalUpscaler::importLowRes(RenderGraph &graph) const
+{
+    RenderGraphImageDesc desc{kFormat, m_lowResExtent, VK_SAMPLE_COUNT_1_BIT,
+                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT};
+    // Cleared every frame; last read by the previous frame's resolve
+    return graph.importImage("TemporalLowRes", m_lowResImage, m_lowResView, desc,
+                             {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0}, {});
+}
+
+RenderGraphResource TemporalUpscaler::importHistory(RenderGraph &graph) const
+{
+    RenderGraphImageDesc desc{kFormat, m_extent, VK_SAMPLE_COUNT_1_BIT,
+                              VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT};
+    // Without history the shader never reads it, so whatever it holds can be discarded
+    const RenderGraphImageState initial = m_push.historyValid > 0.0f
+                                              ? RenderGraphImageState{VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT}
+                                              : RenderGraphImageState{VK_IMAGE_LAYOUT_UNDEFINED, kHistoryStages, 0};
+    // Next frame's target: its contents are not needed afterwards
+    return graph.importImage("TemporalHistory", m_historyImages[1 - m_target], m_historyViews[1 - m_target], desc, initial, {});
+}
+
+RenderGraphResource TemporalUpscaler::importResolved(RenderGraph &graph) const
+{
+    RenderGraphImageDesc desc{kFormat, m_extent, VK_SAMPLE_COUNT_1_BIT,
+                              VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT};
+    // Overwritten whole; two frames ago it was the history, read by the resolve and the composite
+    return graph.importImage("TemporalResolved", m_historyImages[m_target], m_historyViews[m_target], desc,
+                             {VK_IMAGE_LAYOUT_UNDEFINED, kHistoryStages, 0},
+                             {VK_IMAGE_LAYOUT_GENERAL, kHistoryStages, 0});
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+void TemporalUpscaler::setLowResViewport(VkCommandBuffer cmd) const
+{
+    // Shifting the viewport moves where every pixel centre lands on the screen UVs
+    VkViewport viewport{};
+    viewport.x = m_push.jitter.x;
+    viewport.y = m_push.jitter.y;
+    viewport.width = static_cast<float>(m_lowResExtent.width);
+    viewport.height = static_cast<float>(m_lowResExtent.height);
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.extent = m_lowResExtent;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+void TemporalUpscaler::recordResolve(VkCommandBuffer cmd) const
+{
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_resolvePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_resolveLayout, 0, 1, &m_resolveSets[m_target], 0, nullptr);
+    vkCmdPushConstants(cmd, m_resolveLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ResolvePush), &m_push);
+    vkCmdDispatch(cmd, (m_extent.width + kGroupSize - 1) / kGroupSize, (m_extent.height + kGroupSize - 1) / kGroupSize, 1);
+}
+
+void TemporalUpscaler::recordComposite(VkCommandBuffer cmd) const
+{
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_compositePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_compositeLayout, 0, 1, &m_compositeSets[m_target], 0, nullptr);
+    vkCmdDraw(cmd, 3, 1, 0, 0);
+}
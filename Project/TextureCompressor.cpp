@@ -0,0 +1,386 @@
+#include "TextureCompressor.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    using Block = std::array<std::array<int, 4>, 16>; // 4x4 texels, RGBA 0..255
+
+    const int kBc7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    float srgbToLinear(float c)
+    {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float c)
+    {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    uint8_t toByte(float c)
+    {
+        return static_cast<uint8_t>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+    }
+
+    // LSB-first writer for one 128-bit block
+    struct BitWriter
+    {
+        uint8_t bytes[16] = {};
+        uint32_t position = 0;
+
+        void put(uint32_t value, uint32_t bits)
+        {
+            for (uint32_t i = 0; i < bits; i++, position++)
+            {
+                bytes[position >> 3] |= static_cast<uint8_t>(((value >> i) & 1u) << (position & 7));
+            }
+        }
+    };
+
+    // ============================================================================
+    // BC7 MODE 6
+    // ============================================================================
+
+    void encodeBc7(const Block &block, uint8_t *out)
+    {
+        float mean[4] = {};
+        for (const auto &texel : block)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                mean[c] += texel[c] / 16.0f;
+            }
+        }
+
+        // Principal axis by power iteration on the covariance
+        float covariance[4][4] = {};
+        for (const auto &texel : block)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+                }
+            }
+        }
+        float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+            }
+            const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (length < 1e-6f)
+            {
+                break;
+            }
+            for (int i = 0; i < 4; i++)
+            {
+                axis[i] = next[i] / length;
+            }
+        }
+
+        float tMin = 0.0f;
+        float tMax = 0.0f;
+        for (const auto &texel : block)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                t += (texel[c] - mean[c]) * axis[c];
+            }
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+
+        float endpoints[2][4];
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+            endpoints[1][c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+        }
+
+        // Try all four p-bit pairs, keep the one with the least squared error
+        int bestQuantized[2][4] = {};
+        int bestP[2] = {};
+        int bestIndices[16] = {};
+        int64_t bestError = INT64_MAX;
+        for (int pBits = 0; pBits < 4; pBits++)
+        {
+            const int p[2] = {pBits & 1, pBits >> 1};
+            int quantized[2][4];
+            int expanded[2][4];
+            for (int e = 0; e < 2; e++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    quantized[e][c] = std::clamp(static_cast<int>(std::lround((endpoints[e][c] - p[e]) / 2.0f)), 0, 127);
+                    expanded[e][c] = (quantized[e][c] << 1) | p[e];
+                }
+            }
+
+            int palette[16][4];
+            for (int i = 0; i < 16; i++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    palette[i][c] = ((64 - kBc7Weights4[i]) * expanded[0][c] + kBc7Weights4[i] * expanded[1][c] + 32) >> 6;
+                }
+            }
+
+            int indices[16];
+            int64_t error = 0;
+            for (int t = 0; t < 16; t++)
+            {
+                int best = 0;
+                int bestDistance = INT32_MAX;
+                for (int i = 0; i < 16; i++)
+                {
+                    int distance = 0;
+                    for (int c = 0; c < 4; c++)
+                    {
+                        const int d = block[t][c] - palette[i][c];
+                        distance += d * d;
+                    }
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = i;
+                    }
+                }
+                indices[t] = best;
+                error += bestDistance;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                std::memcpy(bestQuantized, quantized, sizeof(quantized));
+                bestP[0] = p[0];
+                bestP[1] = p[1];
+                std::memcpy(bestIndices, indices, sizeof(indices));
+            }
+        }
+
+        // The anchor (texel 0) index has an implicit zero top bit
+        if (bestIndices[0] & 8)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                std::swap(bestQuantized[0][c], bestQuantized[1][c]);
+            }
+            std::swap(bestP[0], bestP[1]);
+            for (int &index : bestIndices)
+            {
+                index = 15 - index;
+            }
+        }
+
+        BitWriter writer;
+        writer.put(1u << 6, 7); // Mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            writer.put(static_cast<uint32_t>(bestQuantized[0][c]), 7);
+            writer.put(static_cast<uint32_t>(bestQuantized[1][c]), 7);
+        }
+        writer.put(static_cast<uint32_t>(bestP[0]), 1);
+        writer.put(static_cast<uint32_t>(bestP[1]), 1);
+        writer.put(static_cast<uint32_t>(bestIndices[0]), 3);
+        for (int t = 1; t < 16; t++)
+        {
+            writer.put(static_cast<uint32_t>(bestIndices[t]), 4);
+        }
+        std::memcpy(out, writer.bytes, 16);
+    }
+
+    // ============================================================================
+    // BC4 / BC5
+    // ============================================================================
+
+    void encodeBc4(const Block &block, int channel, uint8_t *out)
+    {
+        int high = 0;
+        int low = 255;
+        for (const auto &texel : block)
+        {
+            high = std::max(high, texel[channel]);
+            low = std::min(low, texel[channel]);
+        }
+
+        // high > low selects the eight-value palette; equal endpoints need no interpolation
+        int palette[8] = {high, low, high, high, high, high, high, high};
+        for (int i = 1; i < 7; i++)
+        {
+            palette[i + 1] = ((7 - i) * high + i * low) / 7;
+        }
+
+        uint64_t bits = static_cast<uint64_t>(high) | (static_cast<uint64_t>(low) << 8);
+        for (int t = 0; t < 16; t++)
+        {
+            int best = 0;
+            for (int i = 1; i < 8; i++)
+            {
+                if (std::abs(block[t][channel] - palette[i]) < std::abs(block[t][channel] - palette[best]))
+                {
+                    best = i;
+                }
+            }
+            bits |= static_cast<uint64_t>(best) << (16 + 3 * t);
+        }
+        for (int i = 0; i < 8; i++)
+        {
+            out[i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+    }
+
+    // ============================================================================
+    // MIPS
+    // ============================================================================
+
+    struct Level
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<float> texels; // RGBA, linear
+    };
+
+    // 'srgb': the color channels are sRGB-encoded and get decoded; otherwise (data maps) every channel is taken as is
+    Level toLinear(const uint8_t *pixels, uint32_t width, uint32_t height, bool srgb)
+    {
+        // Alpha is linear already
+        Level level{width, height, {}};
+        level.texels.resize(static_cast<size_t>(width) * height * 4);
+        for (size_t i = 0; i < level.texels.size(); i++)
+        {
+            const float value = pixels[i] / 255.0f;
+            level.texels[i] = !srgb || (i % 4) == 3 ? value : srgbToLinear(value);
+        }
+        return level;
+    }
+
+    Level downsample(const Level &source)
+    {
+        Level level{std::max(source.width / 2, 1u), std::max(source.height / 2, 1u), {}};
+        level.texels.resize(static_cast<size_t>(level.width) * level.height * 4);
+        for (uint32_t y = 0; y < level.height; y++)
+        {
+            for (uint32_t x = 0; x < level.width; x++)
+            {
+                const uint32_t x0 = std::min(x * 2, source.width - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                const uint32_t y0 = std::min(y * 2, source.height - 1);
+                const uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    auto at = [&](uint32_t sx, uint32_t sy) { return source.texels[(static_cast<size_t>(sy) * source.width + sx) * 4 + c]; };
+                    level.texels[(static_cast<size_t>(y) * level.width + x) * 4 + c] =
+                        (at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1)) * 0.25f;
+                }
+            }
+        }
+        return level;
+    }
+}
+
+namespace TextureCompressor
+{
+    Ktx2::Image compress(const uint8_t *pixels, uint32_t width, uint32_t height, Kind kind)
+    {
+        const bool color = kind == Kind::Color;
+
+        // Color filters in linear light; TwoChannel holds vectors, filtered and stored as they are
+        Level level = toLinear(pixels, width, height, color);
+
+        Ktx2::Image image;
+        image.format = color ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC5_UNORM_BLOCK;
+        image.width = width;
+        image.height = height;
+
+        while (true)
+        {
+            const uint32_t blocksX = (level.width + 3) / 4;
+            const uint32_t blocksY = (level.height + 3) / 4;
+            const uint64_t offset = image.data.size();
+            image.levels.push_back({offset, static_cast<uint64_t>(blocksX) * blocksY * 16});
+            image.data.resize(static_cast<size_t>(offset + image.levels.back().size));
+
+            for (uint32_t by = 0; by < blocksY; by++)
+            {
+                for (uint32_t bx = 0; bx < blocksX; bx++)
+                {
+                    // Edge blocks repeat the last row/column
+                    Block block{};
+                    for (uint32_t t = 0; t < 16; t++)
+                    {
+                        const uint32_t x = std::min(bx * 4 + t % 4, level.width - 1);
+                        const uint32_t y = std::min(by * 4 + t / 4, level.height - 1);
+                        const float *texel = &level.texels[(static_cast<size_t>(y) * level.width + x) * 4];
+                        for (int c = 0; c < 4; c++)
+                        {
+                            block[t][c] = toByte(color && c < 3 ? linearToSrgb(texel[c]) : texel[c]);
+                        }
+                    }
+
+                    uint8_t *out = image.data.data() + offset + (static_cast<size_t>(by) * blocksX + bx) * 16;
+                    if (color)
+                    {
+                        encodeBc7(block, out);
+                    }
+                    else
+                    {
+                        encodeBc4(block, 0, out);
+                        encodeBc4(block, 1, out + 8);
+                    }
+                }
+            }
+
+            if (level.width == 1 && level.height == 1)
+            {
+                break;
+            }
+            level = downsample(level);
+        }
+        return image;
+    }
+
+    Ktx2::Image buildMips(const uint8_t *pixels, uint32_t width, uint32_t height, Kind kind)
+    {
+        const bool color = kind == Kind::Color;
+
+        Ktx2::Image image;
+        image.format = color ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        image.width = width;
+        image.height = height;
+
+        // Level 0 is the source as is; only the smaller levels go through linear light (color only)
+        image.levels.push_back({0, static_cast<uint64_t>(width) * height * 4});
+        image.data.assign(pixels, pixels + image.levels.back().size);
+
+        Level level = toLinear(pixels, width, height, color);
+        while (level.width > 1 || level.height > 1)
+        {
+            level = downsample(level);
+            const uint64_t offset = image.data.size();
+            image.levels.push_back({offset, static_cast<uint64_t>(level.width) * level.height * 4});
+            image.data.resize(static_cast<size_t>(offset + image.levels.back().size));
+
+            uint8_t *out = image.data.data() + offset;
+            for (size_t i = 0; i < level.texels.size(); i++)
+            {
+                out[i] = toByte(!color || (i % 4) == 3 ? level.texels[i] : linearToSrgb(level.texels[i]));
+            }
+        }
+        return image;
+    }
+}
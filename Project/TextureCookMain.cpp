@@ -0,0 +1,116 @@
+#include "Ktx2.h"
+#include "TextureCompressor.h"
+#define STB_IMAGE_IMPLEMENTATION // Its own executable; the renderer defines it in VulkanBase.cpp
+#include <stb_image.h>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+// Offline texture cook: PNG/JPG to pre-mipped, block-compressed KTX2 next to the source, where
+// the texture loaders pick it up instead of decoding the image and building mips.
+//   XeTexCook <image> [--color|--two-channel] [--out <file.ktx2>]
+//   XeTexCook --defaults [<texture dir>]
+
+static void printUsage()
+{
+	std::cout << "Usage: XeTexCook <image> [options]\n"
+		<< "       XeTexCook --defaults [<texture dir>]\n"
+		<< "  --color         BC7 sRGB (default)\n"
+		<< "  --two-channel   BC5 of red and green (normal and dudv maps)\n"
+		<< "  --out <file>    Output path (default: the image with a .ktx2 extension)\n"
+		<< "  --defaults      Cook every texture the renderer loads (default dir: textures)\n"
+		<< "  --help          Show this message\n";
+}
+
+static bool cook(const std::string &input, const std::string &output, TextureCompressor::Kind kind)
+{
+	int width, height, channels;
+	stbi_uc *pixels = stbi_load(input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		std::cerr << "Failed to load " << input << "\n";
+		return false;
+	}
+
+	const Ktx2::Image image = TextureCompressor::compress(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), kind);
+	stbi_image_free(pixels);
+
+	if (!Ktx2::write(output, image))
+	{
+		return false;
+	}
+	std::cout << input << " -> " << output << " (" << width << "x" << height << ", " << image.levels.size()
+		<< " levels, " << image.data.size() << " bytes)\n";
+	return true;
+}
+
+static std::string defaultOutput(const std::string &input)
+{
+	return std::filesystem::path(input).replace_extension(".ktx2").string();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const std::string first = argv[1];
+	if (first == "--help" || first == "-h")
+	{
+		printUsage();
+		return 0;
+	}
+
+	if (first == "--defaults")
+	{
+		// Every image VulkanBase loads through loadTexture, with the kind its shaders expect
+		const std::filesystem::path directory = argc > 2 ? argv[2] : "textures";
+		const std::pair<const char *, TextureCompressor::Kind> textures[] = {
+			{"texture.png", TextureCompressor::Kind::Color},
+			{"vehicle_metalness.png", TextureCompressor::Kind::Color},
+			{"vehicle_normal.png", TextureCompressor::Kind::TwoChannel},
+			{"vehicle_specular.png", TextureCompressor::Kind::Color},
+			{"water_normal.jpg", TextureCompressor::Kind::TwoChannel},
+			{"water_dudv.jpg", TextureCompressor::Kind::TwoChannel},
+			{"water_caustic.jpg", TextureCompressor::Kind::Color},
+		};
+
+		bool ok = true;
+		for (const auto &[name, kind] : textures)
+		{
+			const std::string input = (directory / name).string();
+			ok = cook(input, defaultOutput(input), kind) && ok;
+		}
+		return ok ? 0 : 1;
+	}
+
+	TextureCompressor::Kind kind = TextureCompressor::Kind::Color;
+	std::string output = defaultOutput(first);
+	for (int i = 2; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--color")
+		{
+			kind = TextureCompressor::Kind::Color;
+		}
+		else if (arg == "--two-channel")
+		{
+			kind = TextureCompressor::Kind::TwoChannel;
+		}
+		else if (arg == "--out" && i + 1 < argc)
+		{
+			output = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << arg << "\n";
+			printUsage();
+			return 1;
+		}
+	}
+
+	return cook(first, output, kind) ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include "TextureDecoder.h"
+#include "CpuProfiler.h"
+#include "JobSystem.h"
+#include <stb_image.h>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+void TextureDecoder::freePixels(void *pixels)
+{
+    stbi_image_free(pixels);
+}
+
+TextureDecoder::Decoded TextureDecoder::decodeSource(const std::string &path)
+{
+    Decoded decoded;
+    int width, height, channels;
+    decoded.pixels.reset(stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha));
+    if (!decoded.pixels)
+    {
+        throw std::runtime_error("failed to load texture image: " + path);
+    }
+    decoded.width = static_cast<uint32_t>(width);
+    decoded.height = static_cast<uint32_t>(height);
+    return decoded;
+}
+
+TextureDecoder::Decoded TextureDecoder::decode(const std::string &path, bool allowCooked)
+{
+    CPU_ZONE("TextureDecoder::decode");
+    if (allowCooked)
+    {
+        // Only a cook at least as new as its source; a missing source is fine
+        const std::filesystem::path cookedPath = std::filesystem::path(path).replace_extension(".ktx2");
+        std::error_code error;
+        if (std::filesystem::exists(cookedPath, error))
+        {
+            const bool stale = std::filesystem::exists(path, error) &&
+                               std::filesystem::last_write_time(cookedPath, error) < std::filesystem::last_write_time(path, error);
+            Decoded decoded;
+            if (stale)
+            {
+                std::cout << "[Texture] " << cookedPath.string() << " is older than its source, ignoring it\n";
+            }
+            else if (Ktx2::read(cookedPath.string(), decoded.cooked))
+            {
+                decoded.width = decoded.cooked.width;
+                decoded.height = decoded.cooked.height;
+                return decoded;
+            }
+        }
+    }
+    return decodeSource(path);
+}
+
+void TextureDecoder::prefetch(const std::vector<std::string> &paths, JobSystem *jobs)
+{
+    // Failures stay empty here and rethrow from take(), where the texture is actually needed
+    std::vector<Decoded> results(paths.size());
+    auto decodeJob = [&](uint32_t jobIndex, uint32_t)
+    {
+        try
+        {
+            results[jobIndex] = decode(paths[jobIndex], true);
+        }
+        catch (const std::exception &)
+        {
+        }
+    };
+
+    if (jobs)
+    {
+        jobs->run(static_cast<uint32_t>(paths.size()), decodeJob);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < paths.size(); i++)
+        {
+            decodeJob(i, 0);
+        }
+    }
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (results[i].pixels || results[i].isCooked())
+        {
+            m_prefetched.insert_or_assign(paths[i], std::move(results[i]));
+        }
+    }
+}
+
+TextureDecoder::Decoded TextureDecoder::take(const std::string &path, bool allowCooked)
+{
+    auto it = m_prefetched.find(path);
+    if (it == m_prefetched.end() || (!allowCooked && it->second.isCooked()))
+    {
+        return decode(path, allowCooked);
+    }
+    Decoded decoded = std::move(it->second);
+    m_prefetched.erase(it);
+    return decoded;
+}
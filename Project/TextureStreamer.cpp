@@ -0,0 +1,611 @@
+#include "TextureStreamer.h"
+#include "CpuProfiler.h"
+#include "GpuMemoryAllocator.h"
+#include "TextureCompressor.h"
+#include "TextureDecoder.h"
+#include "ThreadAffinity.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    struct BlockInfo
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t bytes;
+    };
+
+    // Footprint of one texel block: bands are whole block rows
+    BlockInfo getBlockInfo(VkFormat format)
+    {
+        if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK)
+        {
+            const bool eightBytes = format <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+                                    format == VK_FORMAT_BC4_UNORM_BLOCK || format == VK_FORMAT_BC4_SNORM_BLOCK;
+            return {4, 4, eightBytes ? 8u : 16u};
+        }
+        if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+        {
+            // UNORM/SRGB pairs in the order of the enum
+            static const uint32_t kAstcBlocks[14][2] = {{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6},
+                                                        {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}};
+            const uint32_t *block = kAstcBlocks[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+            return {block[0], block[1], 16};
+        }
+        return {1, 1, 4}; // RGBA8: the only uncompressed format cooks and buildMips produce
+    }
+}
+
+TextureStreamer::TextureStreamer(VkDevice device, uint32_t framesInFlight, std::function<bool(VkFormat)> formatUsable,
+                                 VkDeviceSize uploadBudget)
+    : m_device(device), m_framesInFlight(framesInFlight), m_formatUsable(std::move(formatUsable)), m_uploadBudget(uploadBudget)
+{
+    m_worker = std::thread(&TextureStreamer::workerLoop, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_worker.join();
+
+    // Recorded uploads may still reference the images
+    UploadContext::get().flush();
+    destroyRetired(true);
+    for (Texture &texture : m_textures)
+    {
+        vkDestroyImageView(m_device, texture.view, nullptr);
+        GpuMemoryAllocator::get().destroyImage(texture.image);
+        GpuMemoryAllocator::get().destroyImage(texture.placeholder);
+        GpuMemoryAllocator::get().destroyImage(texture.replaced);
+    }
+}
+
+// ============================================================================
+// WORKER
+// ============================================================================
+
+Ktx2::Image TextureStreamer::decode(const std::string &path, TextureCompressor::Kind kind) const
+{
+    CPU_ZONE("TextureStreamer::decode");
+    TextureDecoder::Decoded decoded = TextureDecoder::decode(path, true);
+    if (decoded.isCooked())
+    {
+        if (m_formatUsable(decoded.cooked.format))
+        {
+            return std::move(decoded.cooked);
+        }
+        std::cout << "[Texture] " << path << ": cooked format " << decoded.cooked.format << " not supported, using the source\n";
+        decoded = TextureDecoder::decodeSource(path);
+    }
+    return TextureCompressor::buildMips(decoded.pixels.get(), decoded.width, decoded.height, kind);
+}
+
+void TextureStreamer::workerLoop()
+{
+    CPU_THREAD_NAME("Texture decode");
+    ThreadAffinity::pinCurrentThread(ThreadRole::TextureStreamer);
+    while (true)
+    {
+        uint32_t handle;
+        std::string path;
+        TextureCompressor::Kind kind;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_decodeQueue.empty(); });
+            if (m_stop)
+            {
+                return;
+            }
+            handle = m_decodeQueue.front();
+            m_decodeQueue.pop_front();
+            path = m_textures[handle].path; // request() only appends under this lock
+            kind = m_textures[handle].kind;
+        }
+
+        DecodeResult result{handle, {}, true};
+        try
+        {
+            result.image = decode(path, kind);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[Texture] " << e.what() << ", keeping the placeholder\n";
+            result.ok = false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decodeResults.push_back(std::move(result));
+            m_decodesInFlight--;
+        }
+        m_decoded.notify_all();
+    }
+}
+
+// ============================================================================
+// REQUESTS
+// ============================================================================
+
+uint32_t TextureStreamer::request(const std::string &path, uint32_t placeholderRGBA, TextureCompressor::Kind kind)
+{
+    Texture texture;
+    texture.path = path;
+    texture.kind = kind;
+
+    // One texel, sampled as is (UNORM) whatever the format of the real image
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {1, 1, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &texture.placeholder) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create placeholder texture!");
+    }
+    GpuMemoryAllocator::get().allocateImage(texture.placeholder, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, GpuMemoryCategory::Texture);
+
+    UploadContext::get().uploadImage(texture.placeholder, &placeholderRGBA, sizeof(placeholderRGBA), 1, 1);
+    UploadContext::get().transitionToShaderRead(texture.placeholder, 1);
+    texture.view = createView(texture.placeholder, VK_FORMAT_R8G8B8A8_UNORM, 0, 1);
+
+    uint32_t handle;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        handle = static_cast<uint32_t>(m_textures.size());
+        m_textures.push_back(std::move(texture));
+        m_decodeQueue.push_back(handle);
+        m_decodesInFlight++;
+    }
+    m_wake.notify_one();
+    return handle;
+}
+
+bool TextureStreamer::isFullyResident() const
+{
+    return std::all_of(m_textures.begin(), m_textures.end(), [](const Texture &texture)
+                       { return texture.loaded && (texture.image == VK_NULL_HANDLE || texture.residentLevel == texture.firstLevel); });
+}
+
+// ============================================================================
+// STREAMING
+// ============================================================================
+
+void TextureStreamer::update()
+{
+    CPU_ZONE("TextureStreamer::update");
+    m_updateCount++;
+    destroyRetired(false);
+    adoptDecoded();
+    promoteCompleted(false);
+
+    if (m_updateCount >= m_nextDrop)
+    {
+        const VkDeviceSize overrun = GpuMemoryAllocator::get().getBudgetOverrun();
+        if (overrun > 0)
+        {
+            dropLevels(overrun);
+        }
+    }
+
+    // Coarse levels of every texture before the fine levels of any: smallest level first across all of them
+    auto nextLevelSize = [](const Texture &texture) { return texture.source.levels[texture.stagingLevel].size; };
+    VkDeviceSize remaining = m_uploadBudget;
+    bool staged = true;
+    while (remaining > 0 && staged)
+    {
+        staged = false;
+        Texture *next = nullptr;
+        for (Texture &texture : m_textures)
+        {
+            if (texture.stagingLevel != UINT32_MAX && (!next || nextLevelSize(texture) < nextLevelSize(*next)))
+            {
+                next = &texture;
+            }
+        }
+        if (next)
+        {
+            const VkDeviceSize bytes = stageLevel(*next, remaining);
+            remaining -= std::min(bytes, remaining);
+            staged = bytes > 0;
+        }
+    }
+
+    submitStaged();
+}
+
+void TextureStreamer::finishAll()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_decoded.wait(lock, [this] { return m_decodesInFlight == 0; });
+    }
+    adoptDecoded();
+
+    for (Texture &texture : m_textures)
+    {
+        while (texture.stagingLevel != UINT32_MAX)
+        {
+            stageLevel(texture, 0);
+        }
+    }
+    submitStaged();
+    promoteCompleted(true);
+}
+
+void TextureStreamer::submitStaged()
+{
+    // A no-op ticket when nothing was recorded, but then no level is waiting for one either
+    const UploadTicket ticket = UploadContext::get().submit();
+    for (Texture &texture : m_textures)
+    {
+        for (PendingLevel &pending : texture.pending)
+        {
+            if (!pending.ticket.valid())
+            {
+                pending.ticket = ticket;
+            }
+        }
+    }
+}
+
+void TextureStreamer::adoptDecoded()
+{
+    std::vector<DecodeResult> results;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        results.swap(m_decodeResults);
+    }
+
+    for (DecodeResult &result : results)
+    {
+        Texture &texture = m_textures[result.handle];
+        texture.loaded = true;
+        if (!result.ok || result.image.levels.empty())
+        {
+            continue;
+        }
+        texture.source = std::move(result.image);
+        texture.format = texture.source.format;
+        texture.width = texture.source.width;
+        texture.height = texture.source.height;
+        texture.levelCount = static_cast<uint32_t>(texture.source.levels.size());
+        texture.stagingLevel = texture.levelCount - 1;
+        texture.stagingRow = 0;
+
+        // Only the levels the budget has room for
+        const VkDeviceSize headroom = GpuMemoryAllocator::get().getBudgetHeadroom();
+        auto imageBytes = [&]
+        {
+            VkDeviceSize bytes = 0;
+            for (uint32_t level = texture.firstLevel; level < texture.levelCount; level++)
+            {
+                bytes += levelBytes(texture, level);
+            }
+            return bytes;
+        };
+        while (canDrop(texture) && imageBytes() > headroom)
+        {
+            texture.firstLevel++;
+            m_droppedLevels++;
+        }
+        if (texture.firstLevel > 0)
+        {
+            std::cout << "[TextureStreamer] " << texture.path << ": over the memory budget, streaming from level "
+                      << texture.firstLevel << "\n";
+        }
+        createImage(texture);
+    }
+}
+
+void TextureStreamer::createImage(Texture &texture)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {std::max(texture.width >> texture.firstLevel, 1u), std::max(texture.height >> texture.firstLevel, 1u), 1};
+    imageInfo.mipLevels = texture.levelCount - texture.firstLevel;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = texture.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // TRANSFER_SRC: a drop copies the coarser levels out
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create streamed texture image!");
+    }
+    GpuMemoryAllocator::get().allocateImage(texture.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, GpuMemoryCategory::Texture);
+
+    // Every level to TRANSFER_DST once; each then goes to SHADER_READ on its own as it completes
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture.image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.levelCount - texture.firstLevel, 0, 1};
+    vkCmdPipelineBarrier(UploadContext::get().graphicsCommands(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+VkDeviceSize TextureStreamer::stageLevel(Texture &texture, VkDeviceSize budget)
+{
+    const BlockInfo block = getBlockInfo(texture.source.format);
+    const uint32_t startLevel = texture.stagingLevel;
+    VkDeviceSize staged = 0;
+
+    // One level at most: the caller picks the smallest level of all textures again afterwards
+    while (texture.stagingLevel == startLevel && (budget == 0 || staged < budget))
+    {
+        const uint32_t level = texture.stagingLevel;
+        const uint32_t width = std::max(texture.source.width >> level, 1u);
+        const uint32_t height = std::max(texture.source.height >> level, 1u);
+        const uint32_t blockRows = (height + block.height - 1) / block.height;
+        const VkDeviceSize rowBytes = static_cast<VkDeviceSize>((width + block.width - 1) / block.width) * block.bytes;
+
+        // At least one block row, so a row wider than the budget still makes progress
+        uint32_t rows = blockRows - texture.stagingRow;
+        if (budget != 0)
+        {
+            const VkDeviceSize affordable = (budget - staged) / rowBytes;
+            rows = static_cast<uint32_t>(std::clamp<VkDeviceSize>(affordable, staged == 0 ? 1 : 0, rows));
+            if (rows == 0)
+            {
+                break;
+            }
+        }
+
+        const VkDeviceSize size = rows * rowBytes;
+        const uint8_t *data = texture.source.bytes() + texture.source.levels[level].offset + texture.stagingRow * rowBytes;
+        const StagingAllocation staging = UploadContext::get().allocateStaging(size);
+        std::memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+        const uint32_t firstTexelRow = texture.stagingRow * block.height;
+        VkBufferImageCopy region{};
+        region.bufferOffset = staging.offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - texture.firstLevel, 0, 1};
+        region.imageOffset = {0, static_cast<int32_t>(firstTexelRow), 0};
+        region.imageExtent = {width, std::min(rows * block.height, height - firstTexelRow), 1};
+        // After the allocation: a full ring submits the open batch and starts another
+        VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+        vkCmdCopyBufferToImage(cmd, staging.buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        staged += size;
+
+        texture.stagingRow += rows;
+        if (texture.stagingRow < blockRows)
+        {
+            continue;
+        }
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = texture.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level - texture.firstLevel, 1, 0, 1};
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        texture.pending.push_back({level, {}});
+        texture.stagingRow = 0;
+        if (level == texture.firstLevel)
+        {
+            texture.stagingLevel = UINT32_MAX;
+            texture.source = {}; // Everything is in staging: the CPU copy (or the file mapping) can go
+        }
+        else
+        {
+            texture.stagingLevel = level - 1;
+        }
+    }
+    return staged;
+}
+
+void TextureStreamer::promoteCompleted(bool wait)
+{
+    for (Texture &texture : m_textures)
+    {
+        // Levels complete in staging order, so the last finished one is the finest
+        uint32_t finest = UINT32_MAX;
+        while (!texture.pending.empty())
+        {
+            const PendingLevel &pending = texture.pending.front();
+            if (wait)
+            {
+                UploadContext::get().wait(pending.ticket);
+            }
+            else if (!UploadContext::get().isComplete(pending.ticket))
+            {
+                break;
+            }
+            finest = pending.level;
+            texture.pending.erase(texture.pending.begin());
+        }
+        if (finest == UINT32_MAX)
+        {
+            continue;
+        }
+
+        // The first real level replaces the placeholder image too, and a drop's copy the image it came from
+        const bool first = texture.residentLevel == UINT32_MAX;
+        retire(texture.view, first ? texture.placeholder : texture.replaced);
+        if (first)
+        {
+            texture.placeholder = VK_NULL_HANDLE;
+        }
+        texture.replaced = VK_NULL_HANDLE;
+        texture.residentLevel = finest;
+        texture.view = createView(texture.image, texture.format, finest - texture.firstLevel, texture.levelCount - finest);
+        m_version++;
+    }
+}
+
+// ============================================================================
+// MEMORY BUDGET
+// ============================================================================
+
+VkDeviceSize TextureStreamer::levelBytes(const Texture &texture, uint32_t level) const
+{
+    const BlockInfo block = getBlockInfo(texture.format);
+    const VkDeviceSize width = std::max(texture.width >> level, 1u);
+    const VkDeviceSize height = std::max(texture.height >> level, 1u);
+    return ((width + block.width - 1) / block.width) * ((height + block.height - 1) / block.height) * block.bytes;
+}
+
+bool TextureStreamer::canDrop(const Texture &texture) const
+{
+    return texture.firstLevel + 1 < texture.levelCount &&
+           (std::max(texture.width, texture.height) >> (texture.firstLevel + 1)) >= kMinDropSize;
+}
+
+void TextureStreamer::dropLevels(VkDeviceSize bytes)
+{
+    // Only textures at rest: fully resident to their finest level, nothing staged or copying
+    std::vector<Texture *> candidates;
+    for (Texture &texture : m_textures)
+    {
+        if (texture.image != VK_NULL_HANDLE && texture.stagingLevel == UINT32_MAX && texture.pending.empty() &&
+            texture.residentLevel == texture.firstLevel && canDrop(texture))
+        {
+            candidates.push_back(&texture);
+        }
+    }
+
+    // Largest finest level first: the fewest textures lose detail for the bytes
+    std::sort(candidates.begin(), candidates.end(), [this](const Texture *a, const Texture *b)
+              { return levelBytes(*a, a->firstLevel) > levelBytes(*b, b->firstLevel); });
+
+    VkDeviceSize freed = 0;
+    uint32_t dropped = 0;
+    for (Texture *texture : candidates)
+    {
+        if (freed >= bytes)
+        {
+            break;
+        }
+        freed += levelBytes(*texture, texture->firstLevel);
+        dropFinestLevel(*texture);
+        dropped++;
+    }
+    if (dropped == 0)
+    {
+        return;
+    }
+
+    submitStaged();
+    m_nextDrop = m_updateCount + m_framesInFlight + 1;
+    std::cout << "[TextureStreamer] Over the memory budget by " << (bytes >> 20) << " MB: dropped a level of " << dropped
+              << " textures, " << (freed >> 20) << " MB\n";
+}
+
+void TextureStreamer::dropFinestLevel(Texture &texture)
+{
+    const VkImage source = texture.image;
+    const uint32_t sourceFirst = texture.firstLevel;
+    texture.firstLevel++;
+    m_droppedLevels++;
+    createImage(texture);
+
+    VkCommandBuffer cmd = UploadContext::get().graphicsCommands();
+    const uint32_t levelCount = texture.levelCount - texture.firstLevel;
+
+    // The kept levels of the old image to TRANSFER_SRC and back: frames recorded before the swap still sample it
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = source;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 1, levelCount, 0, 1};
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    std::vector<VkImageCopy> regions(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        const uint32_t level = texture.firstLevel + i;
+        VkImageCopy &region = regions[i];
+        region = {};
+        region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - sourceFirst, 0, 1};
+        region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+        region.extent = {std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u), 1};
+    }
+    vkCmdCopyImage(cmd, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   levelCount, regions.data());
+
+    VkImageMemoryBarrier barriers[2] = {barrier, barrier};
+    barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].image = texture.image;
+    barriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 2, barriers);
+
+    // Swapped in by promoteCompleted once the copy's batch has signalled, the old image retired with its view
+    texture.replaced = source;
+    texture.pending.push_back({texture.firstLevel, {}});
+}
+
+VkImageView TextureStreamer::createView(VkImage image, VkFormat format, uint32_t baseLevel, uint32_t levelCount) const
+{
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1};
+
+    VkImageView view;
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create streamed texture view!");
+    }
+    return view;
+}
+
+void TextureStreamer::retire(VkImageView view, VkImage image)
+{
+    m_retired.push_back({view, image, m_updateCount + m_framesInFlight});
+}
+
+void TextureStreamer::destroyRetired(bool all)
+{
+    while (!m_retired.empty() && (all || m_retired.front().update <= m_updateCount))
+    {
+        vkDestroyImageView(m_device, m_retired.front().view, nullptr);
+        GpuMemoryAllocator::get().destroyImage(m_retired.front().image);
+        m_retired.pop_front();
+    }
+}
@@ -0,0 +1,229 @@
+#include "ThreadAffinity.h"
+#include "Lib/json.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace
+{
+    // Written once by configure() before the threads it places exist, read-only afterwards
+    struct Placement
+    {
+        bool configured = false;
+        std::vector<uint32_t> nodeCores; // Fallback of every role without its own list
+        std::vector<uint32_t> main;
+        std::vector<uint32_t> simulation;
+        std::vector<uint32_t> workers;
+        std::vector<uint32_t> textureStreamer;
+        std::vector<uint32_t> readback;
+        std::vector<uint32_t> services;
+    };
+
+    Placement g_placement;
+
+    bool readCores(const json &placementJson, const char *key, std::vector<uint32_t> &cores)
+    {
+        if (!placementJson.contains(key))
+            return true;
+        const json &list = placementJson[key];
+        if (!list.is_array())
+            return false;
+        for (const json &core : list)
+        {
+            if (!core.is_number_unsigned())
+                return false;
+            cores.push_back(core.get<uint32_t>());
+        }
+        return true;
+    }
+
+    const std::vector<uint32_t> &coresFor(ThreadRole role)
+    {
+        const std::vector<uint32_t> *cores = &g_placement.services;
+        switch (role)
+        {
+        case ThreadRole::Main: cores = &g_placement.main; break;
+        case ThreadRole::Simulation: cores = &g_placement.simulation; break;
+        case ThreadRole::Worker: cores = &g_placement.workers; break;
+        case ThreadRole::TextureStreamer: cores = &g_placement.textureStreamer; break;
+        case ThreadRole::Readback: cores = &g_placement.readback; break;
+        case ThreadRole::Service: break;
+        }
+        return cores->empty() ? g_placement.nodeCores : *cores;
+    }
+}
+
+bool ThreadAffinity::configure(const std::string &path)
+{
+    std::string filePath = path;
+    if (filePath.empty())
+    {
+        const char *environment = std::getenv(kEnvironmentVariable);
+        if (environment)
+            filePath = environment;
+    }
+    if (filePath.empty())
+        return true;
+
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "[ThreadAffinity] Failed to open placement file: " << filePath << "\n";
+        return false;
+    }
+
+    json placementJson = json::parse(file, nullptr, false);
+    if (placementJson.is_discarded() || !placementJson.is_object())
+    {
+        std::cerr << "[ThreadAffinity] Invalid placement file: " << filePath << "\n";
+        return false;
+    }
+
+    Placement placement;
+    if (placementJson.contains("numaNode"))
+    {
+        if (!placementJson["numaNode"].is_number_unsigned())
+        {
+            std::cerr << "[ThreadAffinity] \"numaNode\" is not a node number: " << filePath << "\n";
+            return false;
+        }
+        const uint32_t node = placementJson["numaNode"].get<uint32_t>();
+        placement.nodeCores = getNumaNodeCores(node);
+        if (placement.nodeCores.empty())
+            std::cerr << "[ThreadAffinity] No cores found for NUMA node " << node << ", unlisted roles stay unpinned\n";
+    }
+
+    const bool valid = readCores(placementJson, "main", placement.main) &&
+                       readCores(placementJson, "simulation", placement.simulation) &&
+                       readCores(placementJson, "workers", placement.workers) &&
+                       readCores(placementJson, "textureStreamer", placement.textureStreamer) &&
+                       readCores(placementJson, "readback", placement.readback) &&
+                       readCores(placementJson, "services", placement.services);
+    if (!valid)
+    {
+        std::cerr << "[ThreadAffinity] Core lists must be arrays of processor numbers: " << filePath << "\n";
+        return false;
+    }
+
+    placement.configured = true;
+    g_placement = std::move(placement);
+    pinCurrentThread(ThreadRole::Main);
+    return true;
+}
+
+bool ThreadAffinity::isConfigured()
+{
+    return g_placement.configured;
+}
+
+void ThreadAffinity::pinCurrentThread(ThreadRole role, uint32_t workerIndex)
+{
+    if (!g_placement.configured)
+        return;
+
+    const std::vector<uint32_t> &cores = coresFor(role);
+    if (cores.empty())
+        return;
+
+    // A worker owns one listed core (wrapping if there are more workers than cores); other roles share theirs
+    bool pinned = false;
+    if (role == ThreadRole::Worker && !g_placement.workers.empty())
+    {
+        const uint32_t slot = (workerIndex > 0 ? workerIndex - 1 : 0) % static_cast<uint32_t>(cores.size());
+        pinned = pin({cores[slot]});
+    }
+    else
+    {
+        pinned = pin(cores);
+    }
+
+    if (!pinned)
+        std::cerr << "[ThreadAffinity] Failed to pin thread (role " << static_cast<int>(role) << ")\n";
+}
+
+uint32_t ThreadAffinity::getWorkerCoreCount()
+{
+    return static_cast<uint32_t>(g_placement.workers.size());
+}
+
+std::vector<uint32_t> ThreadAffinity::getNumaNodeCores(uint32_t node)
+{
+    std::vector<uint32_t> cores;
+#ifdef _WIN32
+    GROUP_AFFINITY affinity{};
+    if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity))
+        return cores;
+    for (uint32_t bit = 0; bit < 64; ++bit)
+    {
+        if (affinity.Mask & (KAFFINITY(1) << bit))
+            cores.push_back(affinity.Group * 64u + bit);
+    }
+#else
+    // e.g. "0-7,16-23"
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if (!std::getline(file, list))
+        return cores;
+
+    std::stringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ','))
+    {
+        const size_t dash = range.find('-');
+        try
+        {
+            const uint32_t first = static_cast<uint32_t>(std::stoul(range.substr(0, dash)));
+            const uint32_t last = dash == std::string::npos ? first : static_cast<uint32_t>(std::stoul(range.substr(dash + 1)));
+            for (uint32_t core = first; core <= last; ++core)
+            {
+                cores.push_back(core);
+            }
+        }
+        catch (const std::exception &)
+        {
+            return {};
+        }
+    }
+#endif
+    return cores;
+}
+
+bool ThreadAffinity::pin(const std::vector<uint32_t> &cores)
+{
+#ifdef _WIN32
+    // A thread runs in one processor group: the first listed core's
+    GROUP_AFFINITY affinity{};
+    affinity.Group = static_cast<WORD>(cores.front() / 64);
+    for (uint32_t core : cores)
+    {
+        if (core / 64 == affinity.Group)
+            affinity.Mask |= KAFFINITY(1) << (core % 64);
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (uint32_t core : cores)
+    {
+        if (core < CPU_SETSIZE)
+            CPU_SET(core, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
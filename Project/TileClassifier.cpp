@@ -0,0 +1,236 @@
+#include "TileClassifier.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "VulkanUtil.h"
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    void memoryBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+TileClassifier::TileClassifier(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent)
+    : m_device(device), m_physicalDevice(physicalDevice), m_extent(extent)
+{
+    auto [drawBuffer, drawMemory] = VkUtils::CreateBuffer(
+        device, physicalDevice, sizeof(VkDrawIndirectCommand) * kClassCount,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_drawBuffer = drawBuffer;
+
+    createDescriptors();
+    createTileBuffer();
+    createPipeline();
+}
+
+TileClassifier::~TileClassifier()
+{
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    VkUtils::DestroyBuffer(m_tileBuffer);
+    VkUtils::DestroyBuffer(m_drawBuffer);
+}
+
+void TileClassifier::resize(VkExtent2D extent)
+{
+    m_extent = extent;
+    createTileBuffer();
+}
+
+// ============================================================================
+// RESOURCES
+// ============================================================================
+
+void TileClassifier::createDescriptors()
+{
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create tile classifier descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(bindings.size())};
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create tile classifier descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate tile classifier descriptor set!");
+    }
+
+    // The draw buffer never changes; the tile buffer follows the extent (createTileBuffer)
+    VkDescriptorBufferInfo drawInfo{m_drawBuffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = 1;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &drawInfo;
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClassifyPush)};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create tile classifier pipeline layout!");
+    }
+}
+
+void TileClassifier::createTileBuffer()
+{
+    VkUtils::DestroyBuffer(m_tileBuffer);
+
+    m_tilesX = (m_extent.width + kTileSize - 1) / kTileSize;
+    m_tilesY = (m_extent.height + kTileSize - 1) / kTileSize;
+    const VkDeviceSize tileCount = static_cast<VkDeviceSize>(m_tilesX) * m_tilesY;
+
+    // Any list may hold every tile
+    auto [tileBuffer, tileMemory] = VkUtils::CreateBuffer(
+        m_device, m_physicalDevice, sizeof(glm::vec4) * tileCount * kClassCount,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_tileBuffer = tileBuffer;
+
+    VkDescriptorBufferInfo tileInfo{m_tileBuffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &tileInfo;
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+// ============================================================================
+// PIPELINE
+// ============================================================================
+
+void TileClassifier::createPipeline()
+{
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    m_pipeline = VK_NULL_HANDLE;
+
+    std::vector<char> code = ShaderRegistry::load("shaders/tile_classify.comp.spv");
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader module: shaders/tile_classify.comp.spv");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &m_pipeline);
+    vkDestroyShaderModule(m_device, module, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create tile classifier pipeline!");
+    }
+}
+
+// ============================================================================
+// PER FRAME
+// ============================================================================
+
+void TileClassifier::recordClassification(VkCommandBuffer cmd, const glm::mat4 &view, const glm::mat4 &projection,
+                                          float cameraAboveWater, float nearPlane) const
+{
+    // Last frame's draws read the counts and rects this rewrites
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+
+    // Six vertices per tile quad; the shader counts the instances
+    std::array<VkDrawIndirectCommand, kClassCount> draws{};
+    for (VkDrawIndirectCommand &draw : draws)
+    {
+        draw.vertexCount = 6;
+    }
+    vkCmdUpdateBuffer(cmd, m_drawBuffer, 0, sizeof(draws), draws.data());
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    // Column 1 of the view rotation is world up in view space
+    ClassifyPush push{};
+    push.inverseProjection = glm::inverse(projection);
+    push.worldUp = glm::vec4(view[1][0], view[1][1], view[1][2], 0.0f);
+    push.extent = glm::uvec4(m_extent.width, m_extent.height, m_tilesX * m_tilesY, 0u);
+    push.band = glm::vec4(kBandTop, kBandBottom, 0.0f, 0.0f);
+    // A sample may sit half a pixel from the centre the shader classifies: widen the band by more than that
+    constexpr float kMargin = 0.01f;
+    push.band.x += kMargin;
+    push.band.y -= kMargin;
+    push.waterline = glm::vec4(cameraAboveWater, nearPlane, kWaterlineEdge, 0.0f);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(cmd, m_tilesX, m_tilesY, 1);
+
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                  VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+}
+
+void TileClassifier::recordDraw(VkCommandBuffer cmd, TileClass tileClass) const
+{
+    const uint32_t list = static_cast<uint32_t>(tileClass);
+    const VkDeviceSize tileOffset = sizeof(glm::vec4) * static_cast<VkDeviceSize>(m_tilesX) * m_tilesY * list;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &m_tileBuffer, &tileOffset);
+    vkCmdDrawIndirect(cmd, m_drawBuffer, sizeof(VkDrawIndirectCommand) * list, 1, sizeof(VkDrawIndirectCommand));
+}
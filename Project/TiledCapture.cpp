@@ -0,0 +1,205 @@
+#include "TiledCapture.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+    float halton(uint32_t index, uint32_t base)
+    {
+        float result = 0.0f;
+        float fraction = 1.0f / base;
+        for (; index > 0; index /= base)
+        {
+            result += fraction * (index % base);
+            fraction /= base;
+        }
+        return result;
+    }
+}
+
+TiledCapture::TiledCapture(const TiledCaptureSettings &settings, VkExtent2D tileExtent)
+    : m_settings(settings),
+      m_size{std::max(settings.size.width, 1u), std::max(settings.size.height, 1u)},
+      m_tileExtent{std::max(tileExtent.width, 1u), std::max(tileExtent.height, 1u)},
+      m_tilesX((m_size.width + m_tileExtent.width - 1) / m_tileExtent.width),
+      m_tileCount(m_tilesX * ((m_size.height + m_tileExtent.height - 1) / m_tileExtent.height)),
+      m_samples(std::clamp(settings.samples, 1u, kMaxSamples))
+{
+    m_accumulated.resize(size_t(m_tileExtent.width) * m_tileExtent.height * 3);
+    if (settings.onImage)
+    {
+        if (m_tileCount != 1)
+        {
+            m_error = "an image handed over in memory must fit one frame";
+        }
+        return;
+    }
+
+    std::filesystem::path path(settings.path);
+    std::error_code error;
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path(), error);
+    }
+
+    // Header, then every pixel's place sized up front: tiles are written into their rows as they finish
+    const std::string header = "P6\n" + std::to_string(m_size.width) + " " + std::to_string(m_size.height) + "\n255\n";
+    m_headerSize = static_cast<std::streamoff>(header.size());
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << header;
+        if (!file)
+        {
+            m_error = "cannot create " + settings.path;
+            return;
+        }
+    }
+    std::filesystem::resize_file(path, header.size() + uint64_t(m_size.width) * m_size.height * 3, error);
+    m_file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (error || !m_file)
+    {
+        m_error = "cannot size " + settings.path + " for " + std::to_string(m_size.width) + "x" + std::to_string(m_size.height);
+    }
+}
+
+TiledCapture::Tile TiledCapture::getTile(uint32_t index) const
+{
+    Tile tile;
+    tile.x = (index % m_tilesX) * m_tileExtent.width;
+    tile.y = (index / m_tilesX) * m_tileExtent.height;
+    tile.width = std::min(m_tileExtent.width, m_size.width - tile.x);
+    tile.height = std::min(m_tileExtent.height, m_size.height - tile.y);
+    return tile;
+}
+
+glm::vec2 TiledCapture::getJitter(uint32_t sample) const
+{
+    // One sample stays on the pixel centres, as the frame would
+    if (m_samples == 1)
+        return glm::vec2(0.0f);
+    return glm::vec2(halton(sample + 1, 2), halton(sample + 1, 3)) - 0.5f;
+}
+
+glm::mat4 TiledCapture::tileProjection(const glm::mat4 &projection) const
+{
+    const uint32_t frame = std::min(m_nextFrame, m_tileCount * m_samples - 1);
+    const Tile tile = getTile(frame / m_samples);
+    const glm::vec2 jitter = getJitter(frame % m_samples);
+
+    // Clip space of the full image to the tile's: the tile's pixels, extended to the whole viewport (the last
+    // tiles of a row or column run past the image's edge), become [-1, 1]. Y runs down after the Vulkan flip
+    const float tileWidth = static_cast<float>(m_tileExtent.width);
+    const float tileHeight = static_cast<float>(m_tileExtent.height);
+    glm::mat4 clip(1.0f);
+    clip[0][0] = m_size.width / tileWidth;
+    clip[1][1] = m_size.height / tileHeight;
+    clip[3][0] = (m_size.width - 2.0f * tile.x - tileWidth + 2.0f * jitter.x) / tileWidth;
+    clip[3][1] = (m_size.height - 2.0f * tile.y - tileHeight + 2.0f * jitter.y) / tileHeight;
+    return clip * projection;
+}
+
+bool TiledCapture::takeRequest(FrameReadbackRequest &request)
+{
+    if (failed())
+        return false;
+    if (m_settleFrames > 0)
+    {
+        --m_settleFrames;
+        return false;
+    }
+    if (m_nextFrame >= m_tileCount * m_samples)
+        return false;
+
+    const uint32_t tileIndex = m_nextFrame / m_samples;
+    const uint32_t sample = m_nextFrame % m_samples;
+    request.encodePath.clear();
+    request.onReady = [this, tileIndex, sample](const FrameReadbackImage &image)
+    { addSample(tileIndex, sample, image); };
+    ++m_nextFrame;
+    return true;
+}
+
+void TiledCapture::addSample(uint32_t tileIndex, uint32_t sample, const FrameReadbackImage &image)
+{
+    if (failed())
+        return;
+    if (image.width != m_tileExtent.width || image.height != m_tileExtent.height)
+    {
+        m_error = "the frame was resized during the capture";
+        return;
+    }
+
+    // Delivered in frame order: a tile's samples arrive together, its first one starts the sum
+    if (sample == 0)
+    {
+        std::fill(m_accumulated.begin(), m_accumulated.end(), 0.0f);
+    }
+    const size_t pixelCount = size_t(image.width) * image.height;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        m_accumulated[i * 3 + 0] += image.pixels[i * 4 + 0];
+        m_accumulated[i * 3 + 1] += image.pixels[i * 4 + 1];
+        m_accumulated[i * 3 + 2] += image.pixels[i * 4 + 2];
+    }
+
+    if (sample + 1 == m_samples)
+    {
+        writeTile(getTile(tileIndex));
+    }
+}
+
+void TiledCapture::writeTile(const Tile &tile)
+{
+    const float scale = 1.0f / m_samples;
+    if (m_settings.onImage)
+    {
+        FrameReadbackImage image;
+        image.width = tile.width;
+        image.height = tile.height;
+        image.pixels.resize(size_t(tile.width) * tile.height * 4);
+        for (size_t i = 0; i < image.pixels.size() / 4; ++i)
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                image.pixels[i * 4 + c] = static_cast<uint8_t>(std::min(m_accumulated[i * 3 + c] * scale + 0.5f, 255.0f));
+            }
+            image.pixels[i * 4 + 3] = 255;
+        }
+        ++m_tilesWritten;
+        m_settings.onImage(image);
+        return;
+    }
+
+    std::vector<uint8_t> row(size_t(tile.width) * 3);
+    for (uint32_t y = 0; y < tile.height; ++y)
+    {
+        const float *source = &m_accumulated[size_t(y) * m_tileExtent.width * 3];
+        for (size_t i = 0; i < row.size(); ++i)
+        {
+            row[i] = static_cast<uint8_t>(std::min(source[i] * scale + 0.5f, 255.0f));
+        }
+        const std::streamoff offset = m_headerSize + (std::streamoff(tile.y + y) * m_size.width + tile.x) * 3;
+        m_file.seekp(offset);
+        m_file.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    m_file.flush();
+    if (!m_file)
+    {
+        m_error = "cannot write " + m_settings.path;
+        return;
+    }
+
+    if (++m_tilesWritten == m_tileCount)
+    {
+        m_file.close();
+        std::cout << "[TiledCapture] Wrote " << m_size.width << "x" << m_size.height << " (" << m_tileCount << " tiles x"
+                  << m_samples << ") to " << m_settings.path << "\n";
+    }
+}
+
+float TiledCapture::getProgress() const
+{
+    return m_tilesWritten / static_cast<float>(m_tileCount);
+}
@@ -0,0 +1,67 @@
+#include "TimelineSemaphore.h"
+#include <stdexcept>
+
+bool TimelineSemaphore::isSupported(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    return vulkan12Features.timelineSemaphore == VK_TRUE;
+}
+
+void TimelineSemaphore::enableFeatures(VkPhysicalDeviceVulkan12Features &features)
+{
+    features.timelineSemaphore = VK_TRUE;
+}
+
+TimelineSemaphore::TimelineSemaphore(VkDevice device)
+    : m_device(device)
+{
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
+TimelineSemaphore::~TimelineSemaphore()
+{
+    vkDestroySemaphore(m_device, m_semaphore, nullptr);
+}
+
+uint64_t TimelineSemaphore::getCompletedValue() const
+{
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(m_device, m_semaphore, &value) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to read timeline semaphore!");
+    }
+    return value;
+}
+
+void TimelineSemaphore::wait(uint64_t value) const
+{
+    if (value == 0)
+        return;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+    if (vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to wait for timeline semaphore!");
+    }
+}
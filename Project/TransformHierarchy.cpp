@@ -0,0 +1,316 @@
+#include "TransformHierarchy.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_HIERARCHY_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define TRANSFORM_HIERARCHY_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    // out = parent * T * R * S; out must not alias parent
+    void composeWorld(const glm::mat4 &parent, const glm::vec3 &position, const glm::quat &rotation,
+                      const glm::vec3 &scale, glm::mat4 &out)
+    {
+        glm::mat4 local = glm::mat4_cast(rotation);
+        local[0] *= scale.x;
+        local[1] *= scale.y;
+        local[2] *= scale.z;
+        local[3] = glm::vec4(position, 1.0f);
+
+        // Each output column is the parent's columns weighted by the local column's components
+        const float *p = &parent[0][0];
+#if TRANSFORM_HIERARCHY_SSE2
+        const __m128 p0 = _mm_loadu_ps(p);
+        const __m128 p1 = _mm_loadu_ps(p + 4);
+        const __m128 p2 = _mm_loadu_ps(p + 8);
+        const __m128 p3 = _mm_loadu_ps(p + 12);
+        for (int c = 0; c < 4; ++c)
+        {
+            const float *l = &local[c][0];
+            __m128 column = _mm_mul_ps(p0, _mm_set1_ps(l[0]));
+            column = _mm_add_ps(column, _mm_mul_ps(p1, _mm_set1_ps(l[1])));
+            column = _mm_add_ps(column, _mm_mul_ps(p2, _mm_set1_ps(l[2])));
+            column = _mm_add_ps(column, _mm_mul_ps(p3, _mm_set1_ps(l[3])));
+            _mm_storeu_ps(&out[c][0], column);
+        }
+#elif TRANSFORM_HIERARCHY_NEON
+        const float32x4_t p0 = vld1q_f32(p);
+        const float32x4_t p1 = vld1q_f32(p + 4);
+        const float32x4_t p2 = vld1q_f32(p + 8);
+        const float32x4_t p3 = vld1q_f32(p + 12);
+        for (int c = 0; c < 4; ++c)
+        {
+            const float *l = &local[c][0];
+            float32x4_t column = vmulq_n_f32(p0, l[0]);
+            column = vmlaq_n_f32(column, p1, l[1]);
+            column = vmlaq_n_f32(column, p2, l[2]);
+            column = vmlaq_n_f32(column, p3, l[3]);
+            vst1q_f32(&out[c][0], column);
+        }
+#else
+        (void)p;
+        out = parent * local;
+#endif
+    }
+}
+
+// ============================================================================
+// NODES
+// ============================================================================
+
+uint32_t TransformHierarchy::addNode(uint32_t parent)
+{
+    if (parent != kNoParent && parent >= getNodeCount())
+    {
+        throw std::out_of_range("Transform parent out of range!");
+    }
+
+    // Appended: still depth-first for a root, a child waits for the next relayout
+    const uint32_t node = getNodeCount();
+    const uint32_t nodeSlot = static_cast<uint32_t>(m_nodeAt.size());
+    m_slotOf.push_back(nodeSlot);
+    m_parentOf.push_back(parent);
+
+    m_parentSlot.push_back(parent == kNoParent ? kNoParent : m_slotOf[parent]);
+    m_subtreeEnd.push_back(nodeSlot + 1);
+    m_positions.push_back(glm::vec3(0.0f));
+    m_rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    m_scales.push_back(glm::vec3(1.0f));
+    m_world.push_back(glm::mat4(1.0f));
+    m_flags.push_back(0);
+    m_nodeAt.push_back(node);
+
+    m_layoutDirty |= parent != kNoParent;
+    flag(node);
+    return node;
+}
+
+void TransformHierarchy::setParent(uint32_t node, uint32_t parent)
+{
+    if (node >= getNodeCount() || (parent != kNoParent && parent >= getNodeCount()))
+    {
+        throw std::out_of_range("Transform node out of range!");
+    }
+    for (uint32_t ancestor = parent; ancestor != kNoParent; ancestor = m_parentOf[ancestor])
+    {
+        if (ancestor == node)
+        {
+            throw std::invalid_argument("Transform parent is inside the node's own subtree!");
+        }
+    }
+    if (m_parentOf[node] == parent)
+        return;
+
+    m_parentOf[node] = parent;
+    m_layoutDirty = true;
+    flag(node);
+}
+
+void TransformHierarchy::clear()
+{
+    m_parentSlot.clear();
+    m_subtreeEnd.clear();
+    m_positions.clear();
+    m_rotations.clear();
+    m_scales.clear();
+    m_world.clear();
+    m_flags.clear();
+    m_nodeAt.clear();
+    m_slotOf.clear();
+    m_parentOf.clear();
+    m_flagged.clear();
+    m_updated.clear();
+    m_layoutDirty = false;
+}
+
+// ============================================================================
+// LOCAL TRANSFORMS
+// ============================================================================
+
+void TransformHierarchy::flag(uint32_t node)
+{
+    uint8_t &flagged = m_flags[slot(node)];
+    if (!flagged)
+    {
+        flagged = 1;
+        m_flagged.push_back(node);
+    }
+}
+
+void TransformHierarchy::setLocal(uint32_t node, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale)
+{
+    const uint32_t s = slot(node);
+    m_positions[s] = position;
+    m_rotations[s] = rotation;
+    m_scales[s] = scale;
+    flag(node);
+}
+
+void TransformHierarchy::setLocalMatrix(uint32_t node, const glm::mat4 &local)
+{
+    // Scale is each basis column's length, negative (one axis mirrored) if the basis is left-handed
+    glm::vec3 scale(glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])));
+    if (glm::determinant(glm::mat3(local)) < 0.0f)
+    {
+        scale.x = -scale.x;
+    }
+    glm::mat3 basis(1.0f);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (std::abs(scale[axis]) > 1e-12f)
+            basis[axis] = glm::vec3(local[axis]) / scale[axis];
+    }
+    setLocal(node, glm::vec3(local[3]), glm::normalize(glm::quat_cast(basis)), scale);
+}
+
+void TransformHierarchy::setLocalPosition(uint32_t node, const glm::vec3 &position)
+{
+    m_positions[slot(node)] = position;
+    flag(node);
+}
+
+void TransformHierarchy::setLocalRotation(uint32_t node, const glm::quat &rotation)
+{
+    m_rotations[slot(node)] = rotation;
+    flag(node);
+}
+
+void TransformHierarchy::setLocalScale(uint32_t node, const glm::vec3 &scale)
+{
+    m_scales[slot(node)] = scale;
+    flag(node);
+}
+
+// ============================================================================
+// UPDATE
+// ============================================================================
+
+const std::vector<uint32_t> &TransformHierarchy::update()
+{
+    m_updated.clear();
+    if (m_layoutDirty)
+    {
+        relayout();
+        m_layoutDirty = false;
+    }
+
+    m_flaggedSlots.clear();
+    for (uint32_t node : m_flagged)
+    {
+        m_flaggedSlots.push_back(slot(node));
+        m_flags[slot(node)] = 0;
+    }
+    m_flagged.clear();
+    std::sort(m_flaggedSlots.begin(), m_flaggedSlots.end());
+
+    // Flagged slots inside a subtree already recomputed are covered by it
+    uint32_t covered = 0;
+    for (uint32_t first : m_flaggedSlots)
+    {
+        if (first < covered)
+            continue;
+        covered = m_subtreeEnd[first];
+        updateRange(first, covered);
+    }
+    return m_updated;
+}
+
+void TransformHierarchy::updateRange(uint32_t first, uint32_t end)
+{
+    static const glm::mat4 identity(1.0f);
+    for (uint32_t s = first; s < end; ++s)
+    {
+        const uint32_t parent = m_parentSlot[s];
+        composeWorld(parent == kNoParent ? identity : m_world[parent], m_positions[s], m_rotations[s], m_scales[s], m_world[s]);
+        m_updated.push_back(m_nodeAt[s]);
+    }
+}
+
+void TransformHierarchy::relayout()
+{
+    const uint32_t count = getNodeCount();
+
+    // Children of each node in their current slot order, as offsets into one array; roots under 'count'
+    std::vector<uint32_t> childStart(count + 2, 0);
+    for (uint32_t s = 0; s < count; ++s)
+    {
+        const uint32_t parent = m_parentOf[m_nodeAt[s]];
+        childStart[(parent == kNoParent ? count : parent) + 1]++;
+    }
+    for (uint32_t i = 1; i < childStart.size(); ++i)
+    {
+        childStart[i] += childStart[i - 1];
+    }
+    std::vector<uint32_t> children(count);
+    std::vector<uint32_t> fill(childStart.begin(), childStart.end() - 1);
+    for (uint32_t s = 0; s < count; ++s)
+    {
+        const uint32_t node = m_nodeAt[s];
+        const uint32_t parent = m_parentOf[node];
+        children[fill[parent == kNoParent ? count : parent]++] = node;
+    }
+
+    // Depth-first order, siblings as they were
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    std::vector<uint32_t> stack;
+    for (uint32_t i = childStart[count + 1]; i-- > childStart[count];)
+    {
+        stack.push_back(children[i]);
+    }
+    while (!stack.empty())
+    {
+        const uint32_t node = stack.back();
+        stack.pop_back();
+        order.push_back(node);
+        for (uint32_t i = childStart[node + 1]; i-- > childStart[node];)
+        {
+            stack.push_back(children[i]);
+        }
+    }
+
+    // Subtree sizes, children (later in the order) first
+    std::vector<uint32_t> size(count, 1);
+    for (uint32_t i = count; i-- > 0;)
+    {
+        const uint32_t parent = m_parentOf[order[i]];
+        if (parent != kNoParent)
+            size[parent] += size[order[i]];
+    }
+
+    auto permute = [&order, this](auto &values)
+    {
+        std::remove_reference_t<decltype(values)> sorted;
+        sorted.reserve(values.size());
+        for (uint32_t node : order)
+        {
+            sorted.push_back(values[m_slotOf[node]]);
+        }
+        values.swap(sorted);
+    };
+    permute(m_positions);
+    permute(m_rotations);
+    permute(m_scales);
+    permute(m_world);
+    permute(m_flags);
+
+    for (uint32_t s = 0; s < count; ++s)
+    {
+        m_nodeAt[s] = order[s];
+        m_slotOf[order[s]] = s;
+        m_subtreeEnd[s] = s + size[order[s]];
+    }
+    for (uint32_t s = 0; s < count; ++s)
+    {
+        const uint32_t parent = m_parentOf[order[s]];
+        m_parentSlot[s] = parent == kNoParent ? kNoParent : m_slotOf[parent];
+    }
+}
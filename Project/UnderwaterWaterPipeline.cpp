@@ -1,7 +1,17 @@
 #include "UnderwaterWaterPipeline.h"
+#include "DynamicRendering.h"
+#include "VariableRateShading.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
 #include <stdexcept>
 #include <cstring>
 #include <algorithm>
+#include <cstddef>
+
+static_assert(!ShaderRegistry::kEmbedded ||
+                  (ShaderRegistry::contains("underwater_water.vert.spv") && ShaderRegistry::contains("underwater_water.frag.spv") &&
+                   ShaderRegistry::contains("underwater_tile.vert.spv") && ShaderRegistry::contains("underwater_tile_vrs.vert.spv")),
+              "an underwater pipeline module is missing from shaders/");
 
 static VkVertexInputBindingDescription getBindingDescription()
 {
@@ -32,41 +42,103 @@ VkShaderModule UnderwaterWaterPipeline::createShaderModule(VkDevice device, cons
 
 void UnderwaterWaterPipeline::create(
     VkDevice device,
-    VkExtent2D extent,
     VkRenderPass renderPass,
     VkDescriptorSetLayout globalDescriptorSetLayout,
     VkDescriptorSetLayout waterDescriptorSetLayout,
     VkSampleCountFlagBits msaaSamples,
     bool isSunraysPipeline = true)
 {
-    // Read SPIR-V shaders for underwater water rendering
-    auto vertCode = VkUtils::readFile("shaders/underwater_water.vert.spv");
-    auto fragCode = VkUtils::readFile("shaders/underwater_water.frag.spv");
+    m_device = device;
+    m_renderPass = renderPass;
+    m_samples = msaaSamples;
+
+    // Read SPIR-V shaders for underwater water rendering; every variant specializes the same modules
+    m_vertModule = createShaderModule(device, ShaderRegistry::load("shaders/underwater_water.vert.spv"));
+    m_fragModule = createShaderModule(device, ShaderRegistry::load("shaders/underwater_water.frag.spv"));
+    m_tileVertModule = createShaderModule(device, ShaderRegistry::load("shaders/underwater_tile.vert.spv"));
+
+    // Pipeline layout: accept two descriptor sets (global + water)
+    std::array<VkDescriptorSetLayout, 2> setLayouts = {globalDescriptorSetLayout, waterDescriptorSetLayout};
+
+    // Push constant for underwater water shader: time, scale, debug flags and mode (colors etc. in WaterParams)
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushRange.offset = 0;
+    pushRange.size = 16;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
+    {
+        destroy(device);
+        throw std::runtime_error("Failed to create underwater water pipeline layout.");
+    }
+
+    // The mode switch is the common one; the snow debug view is built when first shown
+    try
+    {
+        for (uint32_t mode = 0; mode < WaterVariant::kRenderingModeCount; mode++)
+        {
+            WaterVariant variant;
+            variant.renderingMode = mode;
+            m_variants[variant] = buildVariant(variant);
+        }
+    }
+    catch (...)
+    {
+        destroy(device);
+        throw;
+    }
+    select(WaterVariant{});
+}
+
+VkPipeline UnderwaterWaterPipeline::buildVariant(const WaterVariant &variant, uint32_t tileClass, bool shadingRate) const
+{
+    // The variant's two constants, then TILE_CLASS
+    struct
+    {
+        WaterVariant variant;
+        uint32_t tileClass;
+    } constants{variant, tileClass};
+    std::array<VkSpecializationMapEntry, 3> mapEntries{};
+    std::copy(WaterVariant::mapEntries().begin(), WaterVariant::mapEntries().end(), mapEntries.begin());
+    mapEntries[2] = {2, offsetof(decltype(constants), tileClass), sizeof(uint32_t)};
 
-    VkShaderModule vertModule = createShaderModule(device, vertCode);
-    VkShaderModule fragModule = createShaderModule(device, fragCode);
+    VkSpecializationInfo specialization{};
+    specialization.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+    specialization.pMapEntries = mapEntries.data();
+    specialization.dataSize = sizeof(constants);
+    specialization.pData = &constants;
 
     VkPipelineShaderStageCreateInfo vertStage{};
     vertStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertStage.module = vertModule;
+    vertStage.module = tileClass == 0 ? m_vertModule : (shadingRate ? m_rateTileVertModule : m_tileVertModule);
     vertStage.pName = "main";
 
     VkPipelineShaderStageCreateInfo fragStage{};
     fragStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragStage.module = fragModule;
+    fragStage.module = m_fragModule;
     fragStage.pName = "main";
+    fragStage.pSpecializationInfo = &specialization;
 
     std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {vertStage, fragStage};
 
-    // Vertex input (fullscreen triangle uses no vertex buffers)
+    // Vertex input (fullscreen triangle uses no vertex buffers; tile quads read one rect per instance)
+    VkVertexInputBindingDescription tileBinding{0, sizeof(glm::vec4), VK_VERTEX_INPUT_RATE_INSTANCE};
+    VkVertexInputAttributeDescription tileAttribute{0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 0};
     VkPipelineVertexInputStateCreateInfo vertexInput{};
     vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInput.vertexBindingDescriptionCount = 0;
-    vertexInput.pVertexBindingDescriptions = nullptr;
-    vertexInput.vertexAttributeDescriptionCount = 0;
-    vertexInput.pVertexAttributeDescriptions = nullptr;
+    vertexInput.vertexBindingDescriptionCount = tileClass == 0 ? 0 : 1;
+    vertexInput.pVertexBindingDescriptions = &tileBinding;
+    vertexInput.vertexAttributeDescriptionCount = tileClass == 0 ? 0 : 1;
+    vertexInput.pVertexAttributeDescriptions = &tileAttribute;
 
     // Input assembly
     VkPipelineInputAssemblyStateCreateInfo assembly{};
@@ -74,25 +146,17 @@ void UnderwaterWaterPipeline::create(
     assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     assembly.primitiveRestartEnable = VK_FALSE;
 
-    // Viewport & scissor
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(extent.width);
-    viewport.height = static_cast<float>(extent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = extent;
-
+    // Viewport & scissor come from the pass (dynamic state)
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     // Rasterizer
     VkPipelineRasterizationStateCreateInfo rasterizer{};
@@ -105,11 +169,11 @@ void UnderwaterWaterPipeline::create(
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rasterizer.depthBiasEnable = VK_FALSE;
 
-    // Multisampling
+    // Multisampling; sample shading would hold coarse tiles to one pixel per fragment
     VkPipelineMultisampleStateCreateInfo multisampling{};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_TRUE;
-    multisampling.rasterizationSamples = msaaSamples;
+    multisampling.sampleShadingEnable = shadingRate ? VK_FALSE : VK_TRUE;
+    multisampling.rasterizationSamples = m_samples;
     multisampling.minSampleShading = 0.25f;
 
     // Depth stencil - fullscreen fog is composited via blending
@@ -141,27 +205,6 @@ void UnderwaterWaterPipeline::create(
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
 
-    // Pipeline layout: accept two descriptor sets (global + water)
-    std::array<VkDescriptorSetLayout, 2> setLayouts = {globalDescriptorSetLayout, waterDescriptorSetLayout};
-
-    // Push constant for underwater water shader: time, scale, colors, and lighting parameters
-    VkPushConstantRange pushRange{};
-    pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushRange.offset = 0;
-    pushRange.size = 96; // Extended to 96 bytes for underwater parameters + god-ray fields
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
-
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create underwater water pipeline layout.");
-    }
-
     // Create graphics pipeline
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -170,38 +213,105 @@ void UnderwaterWaterPipeline::create(
     pipelineInfo.pVertexInputState = &vertexInput;
     pipelineInfo.pInputAssemblyState = &assembly;
     pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.layout = layout;
-    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.renderPass = m_renderPass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    DynamicRendering::apply(pipelineInfo, renderingInfo);
+    VkPipelineFragmentShadingRateStateCreateInfoKHR shadingRateState{};
+    if (shadingRate)
     {
-        vkDestroyPipelineLayout(device, layout, nullptr);
-        throw std::runtime_error("Failed to create underwater water graphics pipeline.");
+        VariableRateShading::chainPipeline(pipelineInfo, shadingRateState);
     }
 
-    // cleanup shader modules
-    vkDestroyShaderModule(device, vertModule, nullptr);
-    vkDestroyShaderModule(device, fragModule, nullptr);
+    VkPipeline built = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &built) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create underwater water graphics pipeline.");
+    }
+    return built;
 }
 
 void UnderwaterWaterPipeline::destroy(VkDevice device)
 {
-    if (pipeline != VK_NULL_HANDLE)
+    for (auto &entry : m_variants)
     {
-        vkDestroyPipeline(device, pipeline, nullptr);
-        pipeline = VK_NULL_HANDLE;
+        vkDestroyPipeline(device, entry.second, nullptr);
     }
+    m_variants.clear();
+    for (auto &entry : m_tileVariants)
+    {
+        for (VkPipeline tilePipeline : entry.second)
+        {
+            vkDestroyPipeline(device, tilePipeline, nullptr);
+        }
+    }
+    m_tileVariants.clear();
+    pipeline = VK_NULL_HANDLE;
+    m_tilePipelines = {};
     if (layout != VK_NULL_HANDLE)
     {
         vkDestroyPipelineLayout(device, layout, nullptr);
         layout = VK_NULL_HANDLE;
     }
+    vkDestroyShaderModule(device, m_vertModule, nullptr);
+    vkDestroyShaderModule(device, m_fragModule, nullptr);
+    vkDestroyShaderModule(device, m_tileVertModule, nullptr);
+    vkDestroyShaderModule(device, m_rateTileVertModule, nullptr);
+    m_vertModule = VK_NULL_HANDLE;
+    m_fragModule = VK_NULL_HANDLE;
+    m_tileVertModule = VK_NULL_HANDLE;
+    m_rateTileVertModule = VK_NULL_HANDLE;
+}
+
+void UnderwaterWaterPipeline::select(WaterVariant variant, bool tiled, bool shadingRate)
+{
+    // Of the debug views, the fog only draws marine snow: views with the same snow state share a pipeline
+    if (variant.debugView != WaterVariant::kRuntime)
+    {
+        variant.debugView = (variant.debugView == 2 || variant.debugView == 3) ? 2 : 0;
+    }
+    auto it = m_variants.find(variant);
+    if (it == m_variants.end())
+    {
+        it = m_variants.emplace(variant, buildVariant(variant)).first;
+    }
+    pipeline = it->second;
+
+    if (tiled)
+    {
+        if (shadingRate && m_rateTileVertModule == VK_NULL_HANDLE)
+        {
+            m_rateTileVertModule = createShaderModule(m_device, ShaderRegistry::load("shaders/underwater_tile_vrs.vert.spv"));
+        }
+        auto tiles = m_tileVariants.find({variant, shadingRate});
+        if (tiles == m_tileVariants.end())
+        {
+            std::array<VkPipeline, TileClassifier::kClassCount> built{};
+            for (uint32_t tileClass = 0; tileClass < TileClassifier::kClassCount; tileClass++)
+            {
+                built[tileClass] = buildVariant(variant, 1 + tileClass, shadingRate);
+            }
+            tiles = m_tileVariants.emplace(std::make_pair(variant, shadingRate), built).first;
+        }
+        m_tilePipelines = tiles->second;
+    }
+}
+
+void UnderwaterWaterPipeline::prebuild(WaterVariant variant, bool tiled, bool shadingRate)
+{
+    const VkPipeline selected = pipeline;
+    const std::array<VkPipeline, TileClassifier::kClassCount> selectedTiles = m_tilePipelines;
+    select(variant, tiled, shadingRate);
+    pipeline = selected;
+    m_tilePipelines = selectedTiles;
 }
 
 void UnderwaterWaterPipeline::bind(VkCommandBuffer cmd)
@@ -210,3 +320,11 @@ void UnderwaterWaterPipeline::bind(VkCommandBuffer cmd)
         return;
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 }
+
+void UnderwaterWaterPipeline::bindTiles(VkCommandBuffer cmd, TileClassifier::TileClass tileClass)
+{
+    VkPipeline tilePipeline = m_tilePipelines[static_cast<uint32_t>(tileClass)];
+    if (tilePipeline == VK_NULL_HANDLE)
+        return;
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, tilePipeline);
+}
@@ -0,0 +1,56 @@
+#include "UniformArena.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+UniformArena::UniformArena(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, VkDeviceSize frameCapacity)
+    : m_device(device), m_frameCount(frameCount)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_alignment = std::max<VkDeviceSize>(16, properties.limits.minUniformBufferOffsetAlignment);
+
+    // Keep every frame region aligned so dynamic offsets stay valid across frames
+    m_frameCapacity = (frameCapacity + m_alignment - 1) & ~(m_alignment - 1);
+
+    auto [buffer, memory] = VkUtils::CreateBuffer(
+        device, physicalDevice, m_frameCapacity * m_frameCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_buffer = buffer;
+    m_mapped = static_cast<uint8_t *>(VkUtils::MapBuffer(buffer));
+}
+
+UniformArena::~UniformArena()
+{
+    if (m_buffer != VK_NULL_HANDLE)
+    {
+        VkUtils::DestroyBuffer(m_buffer);
+    }
+}
+
+void UniformArena::beginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= m_frameCount)
+    {
+        throw std::out_of_range("UniformArena frame index out of range!");
+    }
+    m_frameIndex = frameIndex;
+    m_cursor = 0;
+}
+
+uint32_t UniformArena::push(const void *data, VkDeviceSize size)
+{
+    VkDeviceSize offset = (m_cursor + m_alignment - 1) & ~(m_alignment - 1);
+    if (offset + size > m_frameCapacity)
+    {
+        throw std::runtime_error("UniformArena frame region exhausted!");
+    }
+
+    VkDeviceSize absolute = static_cast<VkDeviceSize>(m_frameIndex) * m_frameCapacity + offset;
+    memcpy(m_mapped + absolute, data, static_cast<size_t>(size));
+    m_cursor = offset + size;
+
+    return static_cast<uint32_t>(absolute);
+}
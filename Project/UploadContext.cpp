@@ -0,0 +1,591 @@
+#include "UploadContext.h"
+#include "VulkanUtil.h"
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+UploadContext &UploadContext::get()
+{
+    static UploadContext instance;
+    return instance;
+}
+
+void UploadContext::initialize(VkDevice device, VkPhysicalDevice physicalDevice,
+                               uint32_t graphicsFamily, VkQueue graphicsQueue,
+                               uint32_t transferFamily, VkQueue transferQueue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_graphicsFamily = graphicsFamily;
+    m_graphicsQueue = graphicsQueue;
+    m_transferFamily = transferFamily;
+    m_transferQueue = transferQueue;
+
+    m_timeline = std::make_unique<TimelineSemaphore>(device);
+
+    m_graphicsPool.create(device, graphicsFamily);
+    if (hasDedicatedTransferQueue())
+    {
+        m_transferPool.create(device, transferFamily);
+    }
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_copyAlignment = std::max<VkDeviceSize>(16, properties.limits.optimalBufferCopyOffsetAlignment);
+
+    auto [ring, ringMemory] = VkUtils::CreateBuffer(
+        device, physicalDevice, kStagingRingSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_ringBuffer = ring;
+    m_ringMapped = static_cast<uint8_t *>(VkUtils::MapBuffer(ring));
+    m_ringHead = 0;
+    m_ringTail = 0;
+
+    std::cout << "[UploadContext] Initialized ("
+              << (hasDedicatedTransferQueue() ? "dedicated transfer queue family " + std::to_string(transferFamily)
+                                              : std::string("graphics queue only"))
+              << ")\n";
+}
+
+void UploadContext::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_device == VK_NULL_HANDLE)
+            return;
+    }
+
+    // Anything still recorded gets submitted so its staging buffers are released
+    flush();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timeline->waitIdle();
+    for (auto &batch : m_inFlight)
+    {
+        releaseBatchLocked(batch);
+    }
+    m_inFlight.clear();
+    m_timeline.reset();
+
+    VkUtils::DestroyBuffer(m_ringBuffer);
+    m_ringBuffer = VK_NULL_HANDLE;
+    m_ringMapped = nullptr;
+
+    m_graphicsPool.destroy();
+    if (hasDedicatedTransferQueue())
+    {
+        m_transferPool.destroy();
+    }
+    m_device = VK_NULL_HANDLE;
+}
+
+// ============================================================================
+// BATCH MANAGEMENT
+// ============================================================================
+
+void UploadContext::beginBatchLocked()
+{
+    if (m_current.recording)
+        return;
+
+    m_current = Batch{};
+    m_current.id = m_nextTicket++;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    allocInfo.commandPool = m_graphicsPool.getVkCommandPool();
+    if (vkAllocateCommandBuffers(m_device, &allocInfo, &m_current.graphicsCmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+    vkBeginCommandBuffer(m_current.graphicsCmd, &beginInfo);
+
+    if (hasDedicatedTransferQueue())
+    {
+        allocInfo.commandPool = m_transferPool.getVkCommandPool();
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &m_current.transferCmd) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate transfer command buffer!");
+        }
+        vkBeginCommandBuffer(m_current.transferCmd, &beginInfo);
+    }
+    else
+    {
+        m_current.transferCmd = m_current.graphicsCmd;
+    }
+
+    m_current.recording = true;
+}
+
+VkCommandBuffer UploadContext::transferCommandsLocked()
+{
+    beginBatchLocked();
+    return m_current.transferCmd;
+}
+
+VkCommandBuffer UploadContext::graphicsCommandsLocked()
+{
+    beginBatchLocked();
+    return m_current.graphicsCmd;
+}
+
+VkCommandBuffer UploadContext::graphicsCommands()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return graphicsCommandsLocked();
+}
+
+void UploadContext::releaseBatchLocked(Batch &batch)
+{
+    for (VkBuffer staging : batch.stagingBuffers)
+    {
+        VkUtils::DestroyBuffer(staging);
+    }
+    batch.stagingBuffers.clear();
+
+    vkFreeCommandBuffers(m_device, m_graphicsPool.getVkCommandPool(), 1, &batch.graphicsCmd);
+    if (batch.transferCmd != batch.graphicsCmd)
+    {
+        vkFreeCommandBuffers(m_device, m_transferPool.getVkCommandPool(), 1, &batch.transferCmd);
+    }
+    if (batch.transferDone != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(m_device, batch.transferDone, nullptr);
+    }
+
+    m_ringTail = batch.ringEnd;
+
+    if (batch.id > m_completedTicket)
+        m_completedTicket = batch.id;
+}
+
+void UploadContext::retireCompletedLocked()
+{
+    // Batches complete in submission order, so one read of the timeline retires them all
+    const uint64_t completed = m_timeline->getCompletedValue();
+    while (!m_inFlight.empty())
+    {
+        Batch &batch = m_inFlight.front();
+        if (batch.timelineValue > completed)
+            break;
+
+        releaseBatchLocked(batch);
+        m_inFlight.pop_front();
+    }
+}
+
+// ============================================================================
+// STAGING RING
+// ============================================================================
+
+bool UploadContext::tryAllocateRingLocked(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &outOffset)
+{
+    // Nothing outstanding: restart at the front so large uploads are not split by the wrap
+    if (m_ringHead == m_ringTail && m_inFlight.empty())
+    {
+        m_ringHead = 0;
+        m_ringTail = 0;
+    }
+
+    VkDeviceSize offset = (m_ringHead + alignment - 1) & ~(alignment - 1);
+
+    if (m_ringHead >= m_ringTail)
+    {
+        // Free space is [head, end) and [0, tail)
+        if (offset + size <= kStagingRingSize)
+        {
+            outOffset = offset;
+            m_ringHead = offset + size;
+            return true;
+        }
+        if (size < m_ringTail)
+        {
+            outOffset = 0;
+            m_ringHead = size;
+            return true;
+        }
+        return false;
+    }
+
+    // Wrapped: free space is [head, tail), kept strictly below tail so head == tail means empty
+    if (offset + size < m_ringTail)
+    {
+        outOffset = offset;
+        m_ringHead = offset + size;
+        return true;
+    }
+    return false;
+}
+
+StagingAllocation UploadContext::allocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+{
+    alignment = std::max(alignment, m_copyAlignment);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    StagingAllocation allocation{};
+
+    if (size + alignment > kStagingRingSize)
+    {
+        // Larger than the whole ring: one-off buffer, released with the batch
+        auto [buffer, memory] = VkUtils::CreateBuffer(
+            m_device, m_physicalDevice, size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        beginBatchLocked();
+        m_current.stagingBuffers.push_back(buffer);
+
+        allocation.buffer = buffer;
+        allocation.mapped = VkUtils::MapBuffer(buffer);
+        return allocation;
+    }
+
+    VkDeviceSize offset = 0;
+    retireCompletedLocked();
+    while (!tryAllocateRingLocked(size, alignment, offset))
+    {
+        if (m_inFlight.empty())
+        {
+            // The open batch itself holds the ring; submit it so its span can retire
+            submitLocked();
+            if (m_inFlight.empty())
+            {
+                throw std::runtime_error("staging ring exhausted with nothing in flight!");
+            }
+        }
+
+        m_timeline->wait(m_inFlight.front().timelineValue);
+        retireCompletedLocked();
+    }
+
+    beginBatchLocked();
+
+    allocation.buffer = m_ringBuffer;
+    allocation.offset = offset;
+    allocation.mapped = m_ringMapped + offset;
+    return allocation;
+}
+
+void UploadContext::uploadBuffer(VkBuffer dst, const void *data, VkDeviceSize size, VkDeviceSize dstOffset)
+{
+    StagingAllocation staging = allocateStaging(size);
+    memcpy(staging.mapped, data, static_cast<size_t>(size));
+    copyBuffer(staging.buffer, dst, size, staging.offset, dstOffset);
+}
+
+void UploadContext::uploadImage(VkImage dst, const void *pixels, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {width, height, 1};
+
+    uploadImage(dst, pixels, size, {region}, mipLevels, 1);
+}
+
+void UploadContext::uploadImage(VkImage dst, const void *pixels, VkDeviceSize size, std::vector<VkBufferImageCopy> regions,
+                                uint32_t mipLevels, uint32_t layerCount)
+{
+    StagingAllocation staging = allocateStaging(size);
+    memcpy(staging.mapped, pixels, static_cast<size_t>(size));
+
+    for (auto &region : regions)
+    {
+        region.bufferOffset += staging.offset;
+    }
+    copyBufferToImage(staging.buffer, dst, regions, mipLevels, layerCount);
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+void UploadContext::releaseBufferOwnership(VkBuffer buffer)
+{
+    if (!hasDedicatedTransferQueue())
+        return;
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = m_transferFamily;
+    barrier.dstQueueFamilyIndex = m_graphicsFamily;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    // Release on the transfer queue...
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(m_current.transferCmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+
+    // ...acquire on the graphics queue
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                            VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(m_current.graphicsCmd,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void UploadContext::releaseImageOwnership(VkImage image, uint32_t mipLevels, uint32_t layerCount)
+{
+    if (!hasDedicatedTransferQueue())
+        return;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = m_transferFamily;
+    barrier.dstQueueFamilyIndex = m_graphicsFamily;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layerCount;
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(m_current.transferCmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    // Acquired for transfer work on graphics (mip blits, final transition)
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(m_current.graphicsCmd,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void UploadContext::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size,
+                               VkDeviceSize srcOffset, VkDeviceSize dstOffset)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    VkCommandBuffer cmd = transferCommandsLocked();
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(cmd, src, dst, 1, &copyRegion);
+
+    releaseBufferOwnership(dst);
+}
+
+void UploadContext::copyBufferToImage(VkBuffer src, VkImage dst, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {width, height, 1};
+
+    copyBufferToImage(src, dst, {region}, mipLevels, 1);
+}
+
+void UploadContext::copyBufferToImage(VkBuffer src, VkImage dst, const std::vector<VkBufferImageCopy> &regions,
+                                      uint32_t mipLevels, uint32_t layerCount)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    VkCommandBuffer cmd = transferCommandsLocked();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dst;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layerCount;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkCmdCopyBufferToImage(cmd, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+
+    releaseImageOwnership(dst, mipLevels, layerCount);
+}
+
+void UploadContext::transitionToShaderRead(VkImage image, uint32_t mipLevels, uint32_t layerCount)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    VkCommandBuffer cmd = graphicsCommandsLocked();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layerCount;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void UploadContext::destroyAfterUpload(VkBuffer stagingBuffer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    beginBatchLocked();
+    m_current.stagingBuffers.push_back(stagingBuffer);
+}
+
+// ============================================================================
+// SUBMISSION
+// ============================================================================
+
+UploadTicket UploadContext::submit()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return submitLocked();
+}
+
+UploadTicket UploadContext::submitLocked()
+{
+    retireCompletedLocked();
+
+    if (!m_current.recording)
+    {
+        return UploadTicket{};
+    }
+
+    Batch batch = m_current;
+    batch.ringEnd = m_ringHead;
+    m_current = Batch{};
+
+    // Make every copy in the batch visible to whatever the next submission reads
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    vkCmdPipelineBarrier(batch.graphicsCmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                         1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    // The graphics half runs last, so its signal covers the whole batch
+    batch.timelineValue = m_timeline->nextValue();
+    const VkSemaphore timeline = m_timeline->getHandle();
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &batch.timelineValue;
+
+    VkSubmitInfo graphicsSubmit{};
+    graphicsSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    graphicsSubmit.pNext = &timelineInfo;
+    graphicsSubmit.commandBufferCount = 1;
+    graphicsSubmit.pCommandBuffers = &batch.graphicsCmd;
+    graphicsSubmit.signalSemaphoreCount = 1;
+    graphicsSubmit.pSignalSemaphores = &timeline;
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    const uint64_t transferWaitValue = 0; // transferDone is binary: the value is ignored
+
+    if (hasDedicatedTransferQueue())
+    {
+        vkEndCommandBuffer(batch.transferCmd);
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &batch.transferDone);
+
+        VkSubmitInfo transferSubmit{};
+        transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        transferSubmit.commandBufferCount = 1;
+        transferSubmit.pCommandBuffers = &batch.transferCmd;
+        transferSubmit.signalSemaphoreCount = 1;
+        transferSubmit.pSignalSemaphores = &batch.transferDone;
+
+        if (vkQueueSubmit(m_transferQueue, 1, &transferSubmit, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit transfer batch!");
+        }
+
+        graphicsSubmit.waitSemaphoreCount = 1;
+        graphicsSubmit.pWaitSemaphores = &batch.transferDone;
+        graphicsSubmit.pWaitDstStageMask = &waitStage;
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues = &transferWaitValue;
+    }
+
+    vkEndCommandBuffer(batch.graphicsCmd);
+
+    if (vkQueueSubmit(m_graphicsQueue, 1, &graphicsSubmit, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit upload batch!");
+    }
+
+    UploadTicket ticket{batch.id};
+    m_inFlight.push_back(batch);
+    return ticket;
+}
+
+void UploadContext::wait(UploadTicket ticket)
+{
+    if (!ticket.valid())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    while (!m_inFlight.empty() && m_inFlight.front().id <= ticket.id)
+    {
+        Batch &batch = m_inFlight.front();
+        m_timeline->wait(batch.timelineValue);
+        releaseBatchLocked(batch);
+        m_inFlight.pop_front();
+    }
+}
+
+bool UploadContext::isComplete(UploadTicket ticket)
+{
+    if (!ticket.valid())
+        return true;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    retireCompletedLocked();
+    return m_completedTicket >= ticket.id;
+}
@@ -0,0 +1,368 @@
+#include "VariableRateShading.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    constexpr VkFormat kHistoryFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+    void memoryBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+// ============================================================================
+// DEVICE SUPPORT
+// ============================================================================
+
+bool VariableRateShading::isSupported(VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    bool found = false;
+    for (const auto &extension : availableExtensions)
+    {
+        found = found || std::strcmp(extension.extensionName, VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME) == 0;
+    }
+    if (!found)
+        return false;
+
+    VkPhysicalDeviceFragmentShadingRateFeaturesKHR rates{};
+    rates.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &rates;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    return rates.pipelineFragmentShadingRate == VK_TRUE && rates.primitiveFragmentShadingRate == VK_TRUE;
+}
+
+void *VariableRateShading::enableFeatures(VkPhysicalDeviceFragmentShadingRateFeaturesKHR &features, void *next)
+{
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR;
+    features.pipelineFragmentShadingRate = VK_TRUE;
+    features.primitiveFragmentShadingRate = VK_TRUE;
+    features.pNext = next;
+    return &features;
+}
+
+void VariableRateShading::chainPipeline(VkGraphicsPipelineCreateInfo &info, VkPipelineFragmentShadingRateStateCreateInfoKHR &state)
+{
+    state = {};
+    state.sType = VK_STRUCTURE_TYPE_PIPELINE_FRAGMENT_SHADING_RATE_STATE_CREATE_INFO_KHR;
+    state.fragmentSize = {1, 1};
+    state.combinerOps[0] = VK_FRAGMENT_SHADING_RATE_COMBINER_OP_REPLACE_KHR; // The primitive's rate over the pipeline's
+    state.combinerOps[1] = VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR;    // No rate attachment
+    state.pNext = info.pNext;
+    info.pNext = &state;
+}
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+VariableRateShading::VariableRateShading(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, VkFormat frameFormat)
+    : m_device(device), m_physicalDevice(physicalDevice), m_extent(extent)
+{
+    // Whole texels only: the shader fetches them
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shading rate history sampler!");
+    }
+
+    createDescriptors();
+    resize(extent, frameFormat);
+    createPipeline();
+}
+
+VariableRateShading::~VariableRateShading()
+{
+    destroyTargets();
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkDestroySampler(m_device, m_sampler, nullptr);
+}
+
+void VariableRateShading::resize(VkExtent2D extent, VkFormat frameFormat)
+{
+    m_extent = extent;
+
+    // The frame is blitted down with a linear filter
+    VkFormatProperties frameProperties{};
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, frameFormat, &frameProperties);
+    VkFormatProperties historyProperties{};
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, kHistoryFormat, &historyProperties);
+    const VkFormatFeatureFlags sourceFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    m_historySupported = (frameProperties.optimalTilingFeatures & sourceFeatures) == sourceFeatures &&
+                         (historyProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0;
+
+    destroyTargets();
+    createTargets();
+    m_historyValid = false;
+}
+
+// ============================================================================
+// RESOURCES
+// ============================================================================
+
+void VariableRateShading::createDescriptors()
+{
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shading rate descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes = {{{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+                                                      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}}};
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shading rate descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate shading rate descriptor set!");
+    }
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(RatePush)};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shading rate pipeline layout!");
+    }
+}
+
+void VariableRateShading::createTargets()
+{
+    m_tilesX = (m_extent.width + kTileSize - 1) / kTileSize;
+    m_tilesY = (m_extent.height + kTileSize - 1) / kTileSize;
+    const VkDeviceSize tileCount = static_cast<VkDeviceSize>(m_tilesX) * m_tilesY;
+
+    auto [rateBuffer, rateMemory] = VkUtils::CreateBuffer(
+        m_device, m_physicalDevice, sizeof(glm::uvec4) + sizeof(uint32_t) * tileCount,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_rateBuffer = rateBuffer;
+
+    // One history texel per 2x2 pixels: 8x8 per tile
+    m_historyExtent = {std::max(1u, (m_extent.width + 1) / 2), std::max(1u, (m_extent.height + 1) / 2)};
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = kHistoryFormat;
+    imageInfo.extent = {m_historyExtent.width, m_historyExtent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &m_historyImage) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shading rate history!");
+    }
+    GpuMemoryAllocator::get().allocateImage(m_historyImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_historyImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = kHistoryFormat;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_historyView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shading rate history view!");
+    }
+
+    VkDescriptorBufferInfo rateInfo{m_rateBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorImageInfo historyInfo{m_sampler, m_historyView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[0].pBufferInfo = &rateInfo;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[1].pImageInfo = &historyInfo;
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void VariableRateShading::destroyTargets()
+{
+    VkUtils::DestroyBuffer(m_rateBuffer);
+    m_rateBuffer = VK_NULL_HANDLE;
+    if (m_historyView != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(m_device, m_historyView, nullptr);
+        m_historyView = VK_NULL_HANDLE;
+    }
+    if (m_historyImage != VK_NULL_HANDLE)
+    {
+        GpuMemoryAllocator::get().destroyImage(m_historyImage);
+        m_historyImage = VK_NULL_HANDLE;
+    }
+}
+
+void VariableRateShading::writeDescriptor(VkDescriptorSet waterSet) const
+{
+    VkDescriptorBufferInfo rateInfo{m_rateBuffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = waterSet;
+    write.dstBinding = kWaterBinding;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &rateInfo;
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+RenderGraphResource VariableRateShading::importHistory(RenderGraph &graph) const
+{
+    RenderGraphImageDesc desc{kHistoryFormat, m_historyExtent, VK_SAMPLE_COUNT_1_BIT,
+                              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT};
+    // Last blitted by the previous frame; without history the shader never reads it
+    const RenderGraphImageState initial = m_historyValid
+                                              ? RenderGraphImageState{VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT}
+                                              : RenderGraphImageState{VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+    // Left as the blit leaves it for the next frame
+    return graph.importImage("ShadingRateHistory", m_historyImage, m_historyView, desc, initial, {});
+}
+
+// ============================================================================
+// PIPELINE
+// ============================================================================
+
+void VariableRateShading::createPipeline()
+{
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    m_pipeline = VK_NULL_HANDLE;
+
+    std::vector<char> code = ShaderRegistry::load("shaders/shading_rate.comp.spv");
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+    VkShaderModule module;
+    if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader module: shaders/shading_rate.comp.spv");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &m_pipeline);
+    vkDestroyShaderModule(m_device, module, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shading rate pipeline!");
+    }
+}
+
+// ============================================================================
+// PER FRAME
+// ============================================================================
+
+void VariableRateShading::recordRates(VkCommandBuffer cmd, const glm::mat4 &view, const glm::mat4 &projection,
+                                      float depthBelowSurface, float fogAbsorption) const
+{
+    // Last frame's draws read the rates this rewrites
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0);
+
+    // Column 1 of the view rotation is world up in view space
+    RatePush push{};
+    push.inverseProjection = glm::inverse(projection);
+    push.worldUp = glm::vec4(view[1][0], view[1][1], view[1][2], 0.0f);
+    push.extent = glm::uvec4(m_extent.width, m_extent.height, m_tilesX, m_historyValid ? 1u : 0u);
+    push.fog = glm::vec4(depthBelowSurface, fogAbsorption, 0.0f, 0.0f);
+    push.thresholds = glm::vec4(kFogOpacity2x2, kFogOpacity4x4, kContrast2x2, kContrast4x4);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(cmd, m_tilesX, m_tilesY, 1);
+
+    memoryBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void VariableRateShading::recordHistory(VkCommandBuffer cmd, VkImage frame)
+{
+    VkImageBlit blit{};
+    blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    blit.srcOffsets[1] = {static_cast<int32_t>(m_extent.width), static_cast<int32_t>(m_extent.height), 1};
+    blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    blit.dstOffsets[1] = {static_cast<int32_t>(m_historyExtent.width), static_cast<int32_t>(m_historyExtent.height), 1};
+    vkCmdBlitImage(cmd, frame, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_historyImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   1, &blit, VK_FILTER_LINEAR);
+    m_historyValid = true;
+}
+
+void VariableRateShading::recordGridDraw(VkCommandBuffer cmd) const
+{
+    // sunrays_tile_vrs.vert places instance i on tile i, row by row
+    vkCmdDraw(cmd, 6, m_tilesX * m_tilesY, 0, 0);
+}
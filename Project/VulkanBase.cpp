@@ -17,6 +17,8 @@
 #include "backends/imgui_impl_vulkan.h"
 
 #include "VulkanBase.h"
+#include "CpuProfiler.h"
+#include "DynamicRendering.h"
 #include "SwapChainManager.h"
 #include "DAEMesh.h"
 #include "Shader2D.h"
@@ -25,11 +27,22 @@
 #include <stdexcept>
 #include <vector>
 #include <set>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <random>
+#include <optional>
 #include <glm/gtc/matrix_transform.hpp>
 #include "ModelLoader.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderRegistry.h"
+#include "UploadContext.h"
+#include "Ktx2.h"
+#include "DeviceSelection.h"
 #include <glm/glm.hpp>
 
 #include <GLFW/glfw3.h>
@@ -43,8 +56,8 @@ const std::vector<const char *> validationLayers = {
 const std::vector<const char *> VulkanBase::deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
-VulkanBase::VulkanBase()
-    : camera(glm::vec3(0.0f, 1.5f, 55.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f),
+VulkanBase::VulkanBase(const std::string &gpu, bool stereo)
+    : gpuOverride(gpu), stereoRendering(stereo), camera(glm::vec3(0.0f, 1.5f, 55.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f),
       currentToggleInfo({VK_TRUE, VK_TRUE, VK_TRUE, VK_FALSE, VK_FALSE, VK_FALSE, VK_FALSE})
 { // Initialize ToggleInfo to default values
     initWindow();
@@ -52,6 +65,21 @@ VulkanBase::VulkanBase()
     initImGui();
 }
 
+VulkanBase::VulkanBase(const HeadlessOptions &options)
+    : headless(true), headlessOptions(options), gpuOverride(options.gpu), stereoRendering(options.stereo),
+      camera(glm::vec3(0.0f, 1.5f, 55.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f),
+      currentToggleInfo({VK_TRUE, VK_TRUE, VK_TRUE, VK_FALSE, VK_FALSE, VK_FALSE, VK_FALSE})
+{
+    // The whole run, loaders included; written out by run()
+    if (!options.cpuTracePath.empty())
+    {
+        CpuProfiler::start();
+    }
+    initWindow();
+    initVulkan();
+    initImGui();
+}
+
 VulkanBase::~VulkanBase()
 {
     cleanup();
@@ -59,12 +87,198 @@ VulkanBase::~VulkanBase()
 
 void VulkanBase::run()
 {
+    simulation = std::make_unique<SimulationThread>(camera);
+    startTelemetry();
+    // Windowed runs are always watched; headless ones only when asked, since a trace write stalls a measured frame
+    const double hitchThresholdMs = headless ? headlessOptions.hitchThresholdMs : HitchDetector::kDefaultThresholdMs;
+    if (hitchThresholdMs > 0.0)
+    {
+        hitchDetector = std::make_unique<HitchDetector>("hitches", hitchThresholdMs);
+        if (CpuProfiler::kEnabled && !CpuProfiler::isCapturing())
+        {
+            CpuProfiler::start();
+        }
+    }
+    if (headless)
+    {
+        runHeadless();
+    }
+    else
+    {
+        // Every start on a tuned machine runs its preset; a search is only needed for another budget
+        autoTunePreset = AutoTuner::loadPreset(autoTuneCachePath, autoTuneDeviceKey());
+        if (autoTunePreset)
+        {
+            applyAutoTuneLevels(autoTunePreset->levels);
+            std::cout << "[VulkanBase] Auto-tuned preset for " << autoTunePreset->budgetMs << " ms: "
+                      << AutoTuner::describe(autoTunePreset->levels) << "\n";
+            if (std::abs(autoTunePreset->budgetMs - requestedAutoTuneMs) < 1e-3)
+            {
+                requestedAutoTuneMs = 0.0;
+            }
+        }
+        mainLoop();
+    }
+    simulation.reset();
+    telemetry.reset(); // Sends the last partial interval
+
+    if (headless && !headlessOptions.cpuTracePath.empty())
+    {
+        CpuProfiler::stop();
+        CpuProfiler::writeChromeTrace(headlessOptions.cpuTracePath);
+    }
+}
+
+void VulkanBase::startTelemetry()
+{
+    // The explicit endpoint first, then the environment, so fleet machines can be pointed at a collector once
+    std::string endpoint = !telemetryEndpoint.empty() ? telemetryEndpoint : headlessOptions.telemetryEndpoint;
+    if (endpoint.empty())
+    {
+        if (const char *env = std::getenv("XERENDER_TELEMETRY"))
+            endpoint = env;
+    }
+    if (endpoint.empty())
+        return;
+
+    telemetry = std::make_unique<TelemetryStream>(endpoint);
+    if (!telemetry->isOpen())
+    {
+        telemetry.reset();
+    }
+}
+
+void VulkanBase::pushTelemetry(const CompletedFrameTiming &completed)
+{
+    TelemetrySample sample;
+    sample.frameMs = completed.intervalMs;
+    sample.cpuMs = completed.cpuMs;
+    // Like the test system's GPU times, the latest frame the profiler has read back
+    for (const GpuProfileScope &scope : gpuProfiler->getLastFrame())
+    {
+        if (scope.depth == 0 && scope.name == "Frame")
+            sample.gpuMs = scope.durationMs;
+        else if (scope.depth == 1)
+            sample.addPass(scope.name, scope.durationMs);
+    }
+    if (telemetry->wantsMemory())
+    {
+        sample.hasMemory = true;
+        for (const GpuHeapBudget &heap : GpuMemoryAllocator::get().getHeapBudgets())
+        {
+            if (heap.deviceLocal)
+            {
+                sample.memoryUsage += heap.usage;
+                sample.memoryBudget += heap.budget;
+            }
+        }
+    }
+    telemetry->push(sample);
+}
+
+void VulkanBase::runHeadless()
+{
+    if (!headlessOptions.shaderBench.empty())
+    {
+        runShaderBench();
+        return;
+    }
+
+    if (headlessOptions.autoTuneBudgetMs > 0.0)
+    {
+        requestAutoTune(headlessOptions.autoTuneBudgetMs);
+        mainLoop();
+        return;
+    }
+
+    if (!headlessOptions.replayCapturePath.empty())
+    {
+        std::optional<FrameCapture> capture = FrameCapture::load(headlessOptions.replayCapturePath);
+        if (!capture)
+        {
+            throw std::runtime_error("failed to load frame capture!");
+        }
+        std::vector<std::string> passes = headlessOptions.replayPasses;
+        if (passes.empty())
+        {
+            for (const FrameCapturePass &pass : capture->passes)
+            {
+                if (!pass.culled)
+                    passes.push_back(pass.name);
+            }
+        }
+        replayOutputPath = headlessOptions.outputPath;
+        startPassReplay(std::move(*capture), std::move(passes), headlessOptions.replayRepeat, headlessOptions.replayFrames);
+        mainLoop();
+        return;
+    }
+
+    // Offline render: the capture's settings and pose as one large image, tile by tile
+    if (!headlessOptions.renderCapturePath.empty())
+    {
+        std::optional<FrameCapture> capture = FrameCapture::load(headlessOptions.renderCapturePath);
+        if (!capture)
+        {
+            throw std::runtime_error("failed to load frame capture!");
+        }
+        applyTestConfiguration(capture->config);
+        prebuildTestPipelines({capture->config});
+
+        TiledCaptureSettings settings;
+        settings.size = headlessOptions.renderSize;
+        settings.samples = headlessOptions.renderSamples;
+        settings.path = headlessOptions.outputPath;
+        startTiledCapture(settings, {capture->cameraPosition, capture->cameraYaw, capture->cameraPitch}, capture->time);
+        if (!tiledCapture)
+        {
+            throw std::runtime_error("failed to start tiled capture!");
+        }
+        mainLoop();
+        return;
+    }
+
+    // Ground truth for the configs' image-quality comparisons, rendered where missing
+    if (headlessOptions.renderReferences)
+    {
+        queueReferenceRenders(headlessOptions.configs);
+        std::cout << "[VulkanBase] Rendering " << pendingReferences.size() << " references to "
+                  << referenceCache->getDirectory() << "\n";
+        startNextReferenceRender();
+        mainLoop();
+        return;
+    }
+
+    if (headlessOptions.configs.empty())
+    {
+        throw std::runtime_error("headless run has no test configs!");
+    }
+
+    std::filesystem::path outputPath(headlessOptions.outputPath);
+    if (outputPath.has_parent_path())
+    {
+        std::filesystem::create_directories(outputPath.parent_path());
+    }
+    testOutputFilePath = headlessOptions.outputPath;
+    autoExportResults = true;
+    gpuImageCompare = headlessOptions.gpuImageCompare;
+    streamFrameLog = headlessOptions.streamFrameLog;
+    regressionBaselinePath = headlessOptions.baselinePath;
+    regressionThresholds = headlessOptions.regressionThresholds;
+
+    // Same queue the testing panel drives; mainLoop returns when endWaterTest clears isTestModeActive
+    startTestSuite(headlessOptions.configs);
     mainLoop();
 }
 
 void VulkanBase::initWindow()
 {
+    StartupTimer::Scope phase(startupTimer, "Window");
     glfwInit();
+    if (headless)
+    {
+        window = nullptr; // GLFW only provides the clock
+        return;
+    }
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     window = glfwCreateWindow(VkUtils::WIDTH, VkUtils::HEIGHT, "XeRender", nullptr, nullptr);
     glfwSetWindowUserPointer(window, this);
@@ -92,34 +306,141 @@ void VulkanBase::initWindow()
 
 void VulkanBase::initVulkan()
 {
+    // Serial phases on this thread; the pipelines that need no scene data compile on the job system beside
+    // the texture, scene and water phases, which are bound by decode, upload recording and allocation instead
+    std::optional<StartupTimer::Scope> phase(std::in_place, startupTimer, "Instance & device");
     createInstance();
     setupDebugMessenger();
-    createSurface();
+    if (!headless)
+    {
+        createSurface();
+    }
     pickPhysicalDevice();
     createLogicalDevice();
-    swapChainManager = std::make_unique<SwapChainManager>(device, physicalDevice, surface, window);
+    DeviceSelection::logDevice(physicalDevice, asyncComputeSupported);
+    GpuMemoryAllocator::get().initialize(device, physicalDevice, deviceGroup ? deviceGroup->getDeviceCount() : 1, rayQuerySupported,
+                                         memoryBudgetSupported);
+    // Before the first pipeline: every vkCreate*Pipelines call goes through it
+    PipelineCache::get().initialize(device, physicalDevice);
+    UploadContext::get().initialize(device, physicalDevice, graphicsQueueFamily, graphicsQueue, transferQueueFamily, transferQueue);
+    frameTimeline = std::make_unique<TimelineSemaphore>(device);
+    if (presentWaitSupported)
+    {
+        presentPacer = std::make_unique<PresentPacer>(device);
+    }
+    if (asyncComputeSupported)
+    {
+        asyncCompute = std::make_unique<AsyncCompute>(device, graphicsQueueFamily, computeQueueFamily, computeQueue, MAX_FRAMES_IN_FLIGHT,
+                                                      *frameTimeline);
+    }
+    phase.emplace(startupTimer, "Swapchain & layouts");
+    swapChainManager = headless ? std::make_unique<SwapChainManager>(device, physicalDevice, headlessOptions.extent, MAX_FRAMES_IN_FLIGHT)
+                                : std::make_unique<SwapChainManager>(device, physicalDevice, surface, window);
     createRenderPass();
     createImGuiRenderPass();
 
+    // Sets of every layout registered with it; pools grow as they fill
+    descriptorAllocator = std::make_unique<DescriptorAllocator>(device, MAX_FRAMES_IN_FLIGHT);
     createDescriptorSetLayout();
+    // Set 2 of the main pipeline layout; the material maps and the irradiance SH are added once they exist
+    bindlessTable = std::make_unique<BindlessTable>(device, MAX_FRAMES_IN_FLIGHT);
     createCommandPool(); // Need commandPool for createWaterResources()
+    createSecondaryRecorder();
+    prefetchTextures();
     // Create water resources and descriptor set layout early so graphics pipeline can include it
     createWaterResources(); // Needs commandPool, so must be after createCommandPool()
     createWaterSampler();   // Create the sampler for water textures
     createWaterDescriptorSetLayout();
+    // Set 3 of the main pipeline layout, so before it
+    shadowCascades = std::make_unique<ShadowCascades>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT);
+    shadowCascades->setQuality(shadowQuality);
+    createSkyboxDescriptorSetLayout(); // Before the skybox pipeline's build below
+
+    phase.emplace(startupTimer, "Main pipelines");
     createGraphicsPipeline();
 
-    createColorResources();
-    createDepthResources();
-    createFrameBuffers();
-    createImGuiFramebuffers();
+    if (renderPass == imguiRenderPass)
+    {
+        throw std::runtime_error("initVulkan: CRITICAL BUG - renderPass equals imguiRenderPass!");
+    }
+    if (renderPass == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("initVulkan: CRITICAL BUG - renderPass is NULL!");
+    }
 
-    createTextureImage();
-    createAdditionalTextures();
+    // The skybox and water pipelines need only the layouts and the render pass: they compile while the
+    // phases below run (the pipeline cache is internally synchronised). Waited for before the upload flush.
+    JobCounter pipelineBuilds;
+    struct PipelineBuildGuard
+    {
+        JobSystem &jobs;
+        JobCounter &counter;
+        ~PipelineBuildGuard()
+        {
+            // Unwinding from a throw below: the builds still reference this frame's counter and members
+            if (!counter.isDone())
+            {
+                try
+                {
+                    jobs.wait(counter);
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+    } pipelineBuildGuard{*jobSystem, pipelineBuilds};
+    auto buildPipeline = [this, &pipelineBuilds](const char *name, std::function<void()> build)
+    {
+        jobSystem->submit([this, name, build = std::move(build)](uint32_t threadIndex)
+                          {
+            StartupTimer::Scope scope(startupTimer, name, threadIndex);
+            build(); }, &pipelineBuilds);
+    };
+
+    skyboxPipeline = std::make_unique<SkyboxPipeline>();
+    buildPipeline("Skybox pipeline", [this]
+                  { skyboxPipeline->create(device, renderPass, descriptorSetLayout, skyboxDescriptorSetLayout, msaaSamples); });
+    waterPipeline = std::make_unique<WaterPipeline>();
+    buildPipeline("Water pipeline", [this]
+                  { waterPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples, false); });
+    if (tessellationSupported)
+    {
+        waterTessPipeline = std::make_unique<WaterPipeline>();
+        buildPipeline("Water tess pipeline", [this]
+                      { waterTessPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples, false, true); });
+    }
+    underwaterWaterPipeline = std::make_unique<UnderwaterWaterPipeline>();
+    buildPipeline("Underwater pipeline", [this]
+                  { underwaterWaterPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples, true); });
+    // Uses sunrays.vert/sunrays.frag via WaterPipeline with isSunraysPipeline=true
+    sunraysPipeline = std::make_unique<WaterPipeline>();
+    buildPipeline("Sunrays pipeline", [this]
+                  { sunraysPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples,
+                                            /*isSunraysPipeline=*/true); });
 
-    createTextureImageView();
+    phase.emplace(startupTimer, "Frame resources");
 
+    createDepthResources();
+    // Timestamp scopes for every graph pass, read back a frame or two later without waiting; room for a pass replay's repeats
+    gpuProfiler = std::make_unique<GpuProfiler>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT, 64 + PassReplay::kMaxScopes);
+    gpuCounters = std::make_unique<GpuCounters>(instance, physicalDevice, device, graphicsQueueFamily, MAX_FRAMES_IN_FLIGHT,
+                                                pipelineStatisticsSupported, performanceQuerySupported);
+    frameReadback = std::make_unique<FrameReadback>(device, MAX_FRAMES_IN_FLIGHT);
+    imageCompare = std::make_unique<GpuImageCompare>(device, MAX_FRAMES_IN_FLIGHT, swapChainManager->getSwapChainExtent(),
+                                                     swapChainManager->getSwapChainImageFormat());
+    // Builds every frame's render passes/framebuffers and owns the transient attachments
+    renderGraph = std::make_unique<RenderGraph>(device, MAX_FRAMES_IN_FLIGHT, gpuProfiler.get(), gpuCounters.get());
+
+    phase.emplace(startupTimer, "Textures & skybox");
+    createTextureImage();
     createTextureSampler();
+    createMaterialTable();
+    // Headless runs measure frames, not streaming: everything resident before the first one
+    if (headless)
+    {
+        textureStreamer->finishAll();
+    }
 
     // ---- SKYBOX INIT (replace previous block) ----
     int w = 0, h = 0, ch = 0;
@@ -136,11 +457,15 @@ void VulkanBase::initVulkan()
     CubemapTexture cb;
     try
     {
+        const TextureDecoder::Decoded skybox = textureDecoder.take("textures/skybox.jpg", false);
         cb = ModelLoader::CreateCubemapFromHorizontalCross(
             device,
             physicalDevice,
             commandPool.getVkCommandPool(),
             graphicsQueue,
+            skybox.pixels.get(),
+            static_cast<int>(skybox.width),
+            static_cast<int>(skybox.height),
             "textures/skybox.jpg");
     }
     catch (const std::exception &e)
@@ -175,160 +500,140 @@ void VulkanBase::initVulkan()
     {
         throw std::runtime_error("initVulkan: Cubemap loader returned null handle(s). Check image layout and loader implementation.");
     }
+    // Same batch as the cube's mips: filters right after them on a cache miss
+    imageBasedLighting = std::make_unique<ImageBasedLighting>(device, physicalDevice, skyboxImageView, cb.size, cb.mipLevels,
+                                                              "textures/skybox.jpg");
 
     // 3) Create skybox mesh
     skyboxMesh = std::make_unique<SkyboxMesh>();
     skyboxMesh->create(device, physicalDevice, commandPool.getVkCommandPool(), graphicsQueue);
 
-    // 4) Create descriptor pool/layout and allocate descriptor set
-    createSkyboxDescriptorPool();      // must create skyboxDescriptorPool (one combined sampler entry)
-    createSkyboxDescriptorSetLayout(); // descriptor set layout for cubemap sampler
-    createSkyboxDescriptorSet();       // will now succeed because imageView & sampler are valid
-
-    // 5) Create skybox pipeline (needs descriptor set layout and renderPass)
-    //  std::cout << "[DEBUG] initVulkan: About to create skybox pipeline\n";
-    //  std::cout << "[DEBUG] initVulkan: renderPass = " << renderPass << "\n";
-    //  std::cout << "[DEBUG] initVulkan: imguiRenderPass = " << imguiRenderPass << "\n";
-    //  std::cout << "[DEBUG] initVulkan: msaaSamples = " << msaaSamples << "\n";
-
-    if (renderPass == imguiRenderPass)
-    {
-        throw std::runtime_error("initVulkan: CRITICAL BUG - renderPass equals imguiRenderPass!");
-    }
-    if (renderPass == VK_NULL_HANDLE)
-    {
-        throw std::runtime_error("initVulkan: CRITICAL BUG - renderPass is NULL!");
-    }
-
-    skyboxPipeline = std::make_unique<SkyboxPipeline>();
-    skyboxPipeline->create(
-        device,
-        swapChainManager->getSwapChainExtent(),
-        renderPass,
-        descriptorSetLayout,
-        skyboxDescriptorSetLayout,
-        msaaSamples);
+    // 4) Allocate the descriptor set (its layout was created before the pipeline builds)
+    createSkyboxDescriptorSet(); // will now succeed because imageView & sampler are valid
+    atmosphereSky = std::make_unique<AtmosphereSky>(device);
+    createAtmosphereSkyDescriptorSet();
 
+    // 5) The skybox pipeline is building on the job system
     // ---- SKYBOX END ----
 
-    sceneObjects = ModelLoader::loadSceneFromJson("res/scene.json");
-
-    // Aggregate the vertex and index data from all SceneObjects
-    uint32_t indexOffset = 0;
-    for (const auto &obj : sceneObjects)
-    {
-        vertices.insert(vertices.end(), obj.vertices.begin(), obj.vertices.end());
-
-        for (const auto &index : obj.indices)
-        {
-            indices.push_back(index + indexOffset);
-        }
-
-        indexOffset += static_cast<uint32_t>(obj.vertices.size());
-    }
+    phase.emplace(startupTimer, "Scene");
+    // Each distinct mesh gets its own range in the shared vertex/index arrays, shared by its instances
+    addSceneDescription(ModelLoader::loadSceneFromJson("res/scene.json", jobSystem.get()));
 
     loadModel();
 
+    // Refraction/reflection targets; rendered by the graph's offscreen passes
     createSceneColorTexture();
-
-    createSceneRenderPassAndFramebuffer();
-
-    createSceneReflectionTexture(); // Creates sceneReflectionImage/View/Sampler
-    createSceneReflectionRenderPassAndFramebuffer();
-
-    createSceneRefractionRenderPassAndFramebuffer(); // Creates sceneRefractionImage/View/RenderPass/Framebuffer
+    createSceneReflectionTexture();
+    screenSpaceReflections = std::make_unique<ScreenSpaceReflections>(device, swapChainManager->getSwapChainExtent(), depthFormat,
+                                                                      msaaSamples, depthSampleable);
 
     createUniformBuffers();
-    createLightInfoBuffers();
-    createToggleInfoBuffers();
+    createGpuCulling();
+    clusteredLights = std::make_unique<ClusteredLights>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT);
 
-    createDescriptorPool();
+    registerBindlessResources();
+    createImGuiDescriptorPool();
 
     createDescriptorSets();
 
     // --------- WATER INIT ---------
+    phase.emplace(startupTimer, "Water & effects");
     waterMesh = std::make_unique<WaterMesh>();
     // Make the water plane much larger so it appears effectively unlimited from the camera.
-    // Note: increasing resolution increases memory and GPU cost. Adjust resolution if needed.
-    waterMesh->create(device, physicalDevice, commandPool.getVkCommandPool(), graphicsQueue, 512, 20000.0f); // 512 resolution, 20k units world size
+    // CDLOD tiles keep the vertex count constant however large it gets.
+    waterMesh->create(device, physicalDevice, MAX_FRAMES_IN_FLIGHT, kWaterGridSize, kWaterLodLevels);
+    // Initial spectrum goes out with the batch flushed below; the water set samples the maps
+    // Shared with the compute queue when the simulation can run there
+    const std::vector<uint32_t> waterQueueFamilies = asyncCompute ? asyncCompute->getQueueFamilies() : std::vector<uint32_t>{};
+    oceanFFT = std::make_unique<OceanFFT>(device, waterQueueFamilies);
+    waterHeights = std::make_unique<WaterHeightField>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT);
+    oceanCaustics = std::make_unique<OceanCaustics>(device, *oceanFFT, waterQueueFamilies);
+    froxelVolume = std::make_unique<FroxelVolume>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT, *oceanCaustics, waterQueueFamilies);
     // Note: createWaterResources() and createWaterDescriptorSetLayout() are now called earlier in initVulkan()
 
     createWaterDescriptorSet();
 
-    // DEBUG: Verify MSAA samples
-    //  std::cout << "\n=== WATER PIPELINE CREATION DEBUG ===\n";
-    //  std::cout << "msaaSamples: " << msaaSamples << " (should be 8)\n";
-    //  std::cout << "renderPass: " << renderPass << "\n";
-    //  std::cout << "imguiRenderPass: " << imguiRenderPass << "\n";
+    // --------- HALF-RES UNDERWATER EFFECTS ---------
+    // The same fog and sunrays shaders, drawn into the upscaler's single-sample low-res target
+    temporalUpscaler = std::make_unique<TemporalUpscaler>(device, swapChainManager->getSwapChainExtent());
+    temporalUpscaler->createCompositePipeline(renderPass, msaaSamples);
+    lowResUnderwaterPipeline = std::make_unique<UnderwaterWaterPipeline>();
+    buildPipeline("Low-res fog pipeline", [this]
+                  { lowResUnderwaterPipeline->create(device, temporalUpscaler->getLowResRenderPass(), descriptorSetLayout,
+                                                     waterDescriptorSetLayout, VK_SAMPLE_COUNT_1_BIT, true); });
+    lowResSunraysPipeline = std::make_unique<WaterPipeline>();
+    buildPipeline("Low-res sunrays pipeline", [this]
+                  { lowResSunraysPipeline->create(device, temporalUpscaler->getLowResRenderPass(), descriptorSetLayout,
+                                                  waterDescriptorSetLayout, VK_SAMPLE_COUNT_1_BIT, /*isSunraysPipeline=*/true); });
+    godRayUpsampler = std::make_unique<GodRayUpsampler>(device, swapChainManager->getSwapChainExtent(), depthImageView,
+                                                        msaaSamples, depthSampleable);
+    godRayUpsampler->createPipeline(swapChainManager->getSwapChainImageFormat());
 
-    if (renderPass == imguiRenderPass)
+    // --------- MARINE SNOW PARTICLES ---------
+    marineSnow = std::make_unique<MarineSnow>(device, physicalDevice);
+    marineSnow->createPipelines(renderPass, msaaSamples);
+
+    // --------- UNDERWATER FOG TILES ---------
+    tileClassifier = std::make_unique<TileClassifier>(device, physicalDevice, swapChainManager->getSwapChainExtent());
+
+    // --------- VARIABLE-RATE UNDERWATER EFFECTS ---------
+    if (variableRateShadingSupported)
     {
-        throw std::runtime_error("initVulkan: CRITICAL BUG - renderPass equals imguiRenderPass during water creation!");
+        shadingRates = std::make_unique<VariableRateShading>(device, physicalDevice, swapChainManager->getSwapChainExtent(),
+                                                             swapChainManager->getSwapChainImageFormat());
+        shadingRates->writeDescriptor(waterDescriptorSet);
     }
-    if (renderPass == VK_NULL_HANDLE)
+
+    // --------- RAY-QUERY REFLECTIONS ---------
+    // Built by the first frame that traces, after the flush below has uploaded the geometry
+    if (rayQuerySupported)
     {
-        throw std::runtime_error("initVulkan: CRITICAL BUG - renderPass is NULL during water creation!");
+        rayQueryScene = std::make_unique<RayQueryScene>(device, physicalDevice);
+        rayQueryScene->setGeometry(scene, *materialTable, vertexBuffer, indexBuffer);
+        rayQueryScene->writeDescriptors(waterDescriptorSet);
     }
 
-    std::cout << "Creating water pipeline with MSAA samples: " << msaaSamples << "\n";
-
-    waterPipeline = std::make_unique<WaterPipeline>();
-    waterPipeline->create(
-        device,
-        swapChainManager->getSwapChainExtent(),
-        renderPass,
-        descriptorSetLayout,
-        waterDescriptorSetLayout,
-        msaaSamples,
-        false);
+    // --------- OCEAN BOTTOM MESH INIT ---------
+    oceanBottomMesh = std::make_unique<OceanBottomMesh>();
+    oceanBottomMesh->create(device, physicalDevice, MAX_FRAMES_IN_FLIGHT, kWaterGridSize, -50.0f, kOceanBottomLodLevels,
+                            kBathymetryPath);
+    oceanBottomMesh->writeDescriptors(waterDescriptorSet);
+    std::cout << "Ocean bottom mesh created successfully"
+              << (oceanBottomMesh->getBathymetry()->isLoaded() ? " (bathymetry streamed)\n" : "\n");
+    // ---------------------------------------------------
 
+    // Rethrows the first build's failure
+    phase.emplace(startupTimer, "Pipeline wait");
+    jobSystem->wait(pipelineBuilds);
     std::cout << "Water pipeline created successfully\n";
     std::cout << "Water pipeline layout: " << waterPipeline->layout << "\n";
     std::cout << "Water pipeline: " << waterPipeline->pipeline << "\n";
-    std::cout << "===================================\n\n";
-    // ---------------------------------------------------
-
-    // --------- UNDERWATER WATER PIPELINE INIT ---------
-    underwaterWaterPipeline = std::make_unique<UnderwaterWaterPipeline>();
-    underwaterWaterPipeline->create(
-        device,
-        swapChainManager->getSwapChainExtent(),
-        renderPass,
-        descriptorSetLayout,
-        waterDescriptorSetLayout,
-        msaaSamples,
-        true);
-    std::cout << "Underwater water pipeline created successfully\n";
-
-    // --------- SUNRAYS FULL-SCREEN PIPELINE INIT ---------
-    // Uses sunrays.vert/sunrays.frag via WaterPipeline with isSunraysPipeline=true
-    sunraysPipeline = std::make_unique<WaterPipeline>();
-    sunraysPipeline->create(
-        device,
-        swapChainManager->getSwapChainExtent(),
-        renderPass,
-        descriptorSetLayout,
-        waterDescriptorSetLayout,
-        msaaSamples,
-        /*isSunraysPipeline=*/true);
-    std::cout << "Sunrays pipeline created successfully\n";
 
-    // --------- OCEAN BOTTOM MESH INIT ---------
-    oceanBottomMesh = std::make_unique<OceanBottomMesh>();
-    oceanBottomMesh->create(device, physicalDevice, commandPool.getVkCommandPool(), graphicsQueue, 256, 20000.0f, -50.0f);
-    std::cout << "Ocean bottom mesh created successfully\n";
-    // ---------------------------------------------------
+    // Every mesh/texture upload above was recorded into one batch: one submit, one fence
+    phase.emplace(startupTimer, "Upload flush");
+    UploadContext::get().flush();
 
+    phase.emplace(startupTimer, "Frame sync & testing");
     createCommandBuffers();
     createSyncObjects();
 
     // --------- WATER TESTING SYSTEM INIT ---------
     initializeWaterTestingSystem();
     // ---------------------------------------------
+
+#ifdef XERENDER_SHADER_SOURCE_DIR
+    // Benchmarks measure the shaders they were built with
+    if (!headless)
+    {
+        shaderHotReload = std::make_unique<ShaderHotReload>(XERENDER_SHADER_SOURCE_DIR, "shaders", XERENDER_GLSLANG_VALIDATOR);
+    }
+#endif
 }
 
 void VulkanBase::initImGui()
 {
+    StartupTimer::Scope phase(startupTimer, "ImGui");
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO &io = ImGui::GetIO();
@@ -337,6 +642,17 @@ void VulkanBase::initImGui()
 
     ImGui::StyleColorsDark();
 
+    if (headless)
+    {
+        // No backends: the UI is still built every frame (it drives state), but never drawn
+        io.IniFilename = nullptr;
+        io.DisplaySize = ImVec2(static_cast<float>(headlessOptions.extent.width), static_cast<float>(headlessOptions.extent.height));
+        unsigned char *pixels = nullptr;
+        int width = 0, height = 0;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+        return;
+    }
+
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForVulkan(window, true);
 
@@ -347,8 +663,8 @@ void VulkanBase::initImGui()
     init_info.Device = device;
     init_info.QueueFamily = VkUtils::FindQueueFamilies(physicalDevice, surface).graphicsFamily.value();
     init_info.Queue = graphicsQueue;
-    init_info.PipelineCache = VK_NULL_HANDLE;
-    init_info.DescriptorPool = descriptorPool->getDescriptorPool();
+    init_info.PipelineCache = PipelineCache::get().handle();
+    init_info.DescriptorPool = imguiDescriptorPool;
     init_info.Subpass = 0;
     init_info.MinImageCount = 2;
     init_info.ImageCount = swapChainManager->getSwapChainImages().size();
@@ -391,66 +707,178 @@ void VulkanBase::mainLoop()
 {
     float deltaTime = 0.0f;
     float lastFrame = 0.0f;
+    CPU_THREAD_NAME("Main");
 
-    while (!glfwWindowShouldClose(window))
+    // Headless runs until the test queue (or the pass replay, or the tiled capture) has drained
+    while (headless ? isTestModeActive || passReplay || tiledCapture || shaderBenchFramesLeft > 0 || autoTuner || requestedAutoTuneMs > 0.0
+                    : !glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
+        if (!headless)
+        {
+            glfwPollEvents();
+        }
+
+        // Asked for by the Render Graph panel while the last frame recorded
+        if (!requestedReplayPass.empty())
+        {
+            if (lastFrameCapture && !isTestModeActive && !passReplay)
+            {
+                startPassReplay(*lastFrameCapture, {requestedReplayPass}, replayRepeat, replayFrames);
+            }
+            requestedReplayPass.clear();
+        }
+        if (requestedAutoTuneMs > 0.0)
+        {
+            if (!isTestModeActive && !passReplay && !tiledCapture && !autoTuner)
+            {
+                startAutoTune(requestedAutoTuneMs);
+            }
+            requestedAutoTuneMs = 0.0;
+        }
 
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        if (headless && deltaTime > 0.0f)
+        {
+            ImGui::GetIO().DeltaTime = deltaTime; // Set by the GLFW backend otherwise
+        }
 
-        // Pre-frame update for water testing (camera positioning only)
-        if (isTestModeActive)
+        if (requestedFramesInFlight != framesInFlight)
+        {
+            setFramesInFlight(requestedFramesInFlight);
+        }
+        if (requestedMsaaSamples != msaaSamples)
         {
-            preFrameWaterTestUpdate();
+            setMsaaSamples(requestedMsaaSamples);
+        }
 
-            // START timing BEFORE drawFrame - this is when the frame begins
-            frameStartTimePoint = std::chrono::high_resolution_clock::now();
+        // Low-latency pacing: hold the frame until the last one is on screen, so the input below is fresh.
+        // Before the frame's start time, which would otherwise count the wait as frame time
+        if (presentPacer)
+        {
+            if (presentPacing)
+                presentPacer->waitForDisplay(swapChainManager->getSwapChain(), kPresentWaitTimeoutNs);
+            else
+                presentPacer->poll(swapChainManager->getSwapChain());
         }
-        else if (isBenchmarkActive)
+
+        // START timing BEFORE drawFrame - this is when the frame begins
+        frameStartTimePoint = std::chrono::high_resolution_clock::now();
+
+        // A test run's (and a replay's, a tiled capture's, an auto-tune's) camera follows its path on the simulation thread
+        if (!isTestModeActive && !passReplay && !tiledCapture && !autoTuner)
         {
-            // For Quick Benchmark, also measure GPU-synced time
-            frameStartTimePoint = std::chrono::high_resolution_clock::now();
             processInput(deltaTime);
         }
-        else
+        simulationInput.deltaTime = deltaTime;
+
+        // Tests pick their clock; benchmarks step it fixed so every run renders the same frames
+        FrameClock::Mode clockMode = isBenchmarkActive ? FrameClock::Mode::FixedStep : FrameClock::Mode::RealTime;
+        if (isTestModeActive && waterTestingSystem)
         {
-            processInput(deltaTime);
+            clockMode = waterTestingSystem->getCurrentConfig().clockMode;
+        }
+        else if (passReplay || tiledCapture || autoTuner)
+        {
+            clockMode = FrameClock::Mode::Replay; // Held at the capture's (or the search's) time
         }
 
-        drawFrame();
+        // The frame renders the simulation's snapshot, while the next step runs beside its recording
+        simulation->setPipelined(threadedSimulation);
+        simulation->setClockMode(clockMode, kFixedSimulationStep);
+        const FrameSnapshot &snapshot = simulation->advance(simulationInput);
+        simulationInput = SimulationInput{};
+        camera = snapshot.camera;
+        simulationTime = snapshot.time;
+        simulationFrame = snapshot.frame;
+        if (cameraPathRecorder.isRecording())
+        {
+            cameraPathRecorder.sample(camera.position, camera.getYaw(), camera.getPitch(), simulationTime);
+        }
 
-        // During testing, force GPU synchronization to get accurate frame timing
-        // Without this, the GPU has multiple frames in flight and we only measure CPU submission time
-        if (isTestModeActive)
+        drawFrame();
+        observeFrameCompletions();
+
+        // Synced timing serialises CPU and GPU: the frame just submitted completes in this iteration and
+        // its start-to-idle time is the frame time. Pipelined timing keeps framesInFlight frames
+        // queued and uses the interval between completions instead, which is the real throughput
+        bool pipelined = isTestModeActive && waterTestingSystem ? waterTestingSystem->getCurrentConfig().pipelinedTiming
+                                                                : pipelinedTiming;
+        if ((isTestModeActive || isBenchmarkActive) && !pipelined)
         {
-            // Wait for GPU to finish ALL work - this is critical for accurate timing
-            vkQueueWaitIdle(graphicsQueue);
+            frameTimeline->waitIdle(); // The frames only: uploads on the same queue keep running
+            observeFrameCompletions();
+        }
 
-            // Fetch GPU timing results AFTER GPU has finished (timestamps are now valid)
-            if (waterTestingSystem)
+        for (const CompletedFrameTiming &completed : completedFrameTimings)
+        {
+            const double frameTimeMs = pipelined ? completed.intervalMs : completed.latencyMs;
+            if (telemetry)
+            {
+                pushTelemetry(completed);
+            }
+            if (hitchDetector)
             {
-                waterTestingSystem->readGpuTimestamps();
+                hitchDetector->addFrame(completed.frameNumber, completed.completedNs, completed.intervalMs,
+                                        completed.latencyMs, completed.cpuMs, gpuProfiler->getLastFrame());
             }
 
-            // NOW measure time - from before drawFrame to after GPU is done
-            auto frameEndTime = std::chrono::high_resolution_clock::now();
-            lastCpuTimeMs = std::chrono::duration<double, std::milli>(frameEndTime - frameStartTimePoint).count();
+            if (isTestModeActive && waterTestingSystem)
+            {
+                // GPU times of the latest frame the profiler has read back (a frame or two behind)
+                const double waterMs = gpuProfiler->getScopeMs("Water") + gpuProfiler->getScopeMs("Reflection") +
+                                       gpuProfiler->getScopeMs("Refraction");
+                const double sceneMs = gpuProfiler->getScopeMs("Main") - gpuProfiler->getScopeMs("Water") +
+                                       gpuProfiler->getScopeMs("Cull");
+                const double postMs = gpuProfiler->getScopeMs("HiZ") + gpuProfiler->getScopeMs("ImGui") +
+                                       gpuProfiler->getScopeMs("Readback") + gpuProfiler->getScopeMs("ImageCompare");
+                waterTestingSystem->setGpuTimings(gpuProfiler->getScopeMs("Frame"), waterMs, sceneMs, postMs);
+                waterTestingSystem->setCpuTimings(completed.cpuMs, completed.latencyMs);
+                // Zero unless the config captures them; trails the frame like the GPU times
+                waterTestingSystem->setGpuCounters(gpuCounters->getFrameStatistics(), gpuCounters->getFrameCounters());
+
+                lastFrameTimeMs = frameTimeMs;
+                postFrameWaterTestUpdate();
+            }
+            if (isTestModeActive || isBenchmarkActive)
+            {
+                benchmarkFrameTimeMs = frameTimeMs;
+            }
+        }
+        completedFrameTimings.clear();
 
-            postFrameWaterTestUpdate();
+        if (passReplay)
+        {
+            passReplay->addFrame(gpuProfiler->getLastFrame());
+            if (passReplay->isDone())
+            {
+                endPassReplay();
+            }
         }
-        else if (isBenchmarkActive)
+        if (tiledCapture && tiledCapture->isDone())
         {
-            // Wait for GPU to finish ALL work - critical for accurate benchmark timing
-            vkQueueWaitIdle(graphicsQueue);
-
-            // Measure GPU-synced frame time
-            auto frameEndTime = std::chrono::high_resolution_clock::now();
-            gpuSyncedFrameTimeMs = std::chrono::duration<double, std::milli>(frameEndTime - frameStartTimePoint).count();
+            endTiledCapture();
+            startNextReferenceRender();
+        }
+        if (autoTuner)
+        {
+            updateAutoTune();
         }
 
-        takeScreenshot();
+        if (cpuTraceFramesLeft > 0 && --cpuTraceFramesLeft == 0)
+        {
+            CpuProfiler::stop();
+            CpuProfiler::writeChromeTrace(cpuTracePath);
+            if (hitchDetector)
+            {
+                CpuProfiler::start(); // Back to the hitch detector's always-on capture
+            }
+        }
+        if (shaderBenchFramesLeft > 0)
+        {
+            shaderBenchFramesLeft--;
+        }
     }
 
     vkDeviceWaitIdle(device);
@@ -462,35 +890,44 @@ void VulkanBase::cleanup()
     // Wait for the device to be idle before starting the cleanup process
     vkDeviceWaitIdle(device);
 
+    // Deliver copies still in flight (a screenshot taken on the last frame)
+    frameReadback->collectAll();
+
     // Cleanup water testing system first
     cleanupWaterTestingSystem();
 
     ImGui::DestroyContext();
 
-    vkDestroyBuffer(device, vertexBuffer, nullptr);
-    vkFreeMemory(device, vertexBufferMemory, nullptr);
+    rayQueryScene.reset(); // Built over the geometry buffers
+    VkUtils::DestroyBuffer(vertexBuffer);
+    VkUtils::DestroyBuffer(indexBuffer);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
         vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device, inFlightFences[i], nullptr);
     }
 
+    secondaryRecorder.reset();
+    jobSystem.reset();
     vkDestroyCommandPool(device, commandPool.getVkCommandPool(), nullptr);
-
-    for (auto framebuffer : swapChainFramebuffers)
-    {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
-
-    for (size_t i = 0; i < lightInfoBuffers.size(); i++)
-    {
-        vkDestroyBuffer(device, lightInfoBuffers[i], nullptr);
-        vkFreeMemory(device, lightInfoBuffersMemory[i], nullptr);
-    }
-
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    asyncCompute.reset();
+    frameTimeline.reset();
+
+    renderGraph.reset(); // Render passes, framebuffers and transient images
+    gpuProfiler.reset();
+    gpuCounters.reset();
+    frameReadback.reset(); // Finishes queued encodes
+    imageCompare.reset();
+
+    gpuCulling.reset(); // Holds a reference to the uniform arena
+    uniformArena.reset();
+    waterParamsBuffer.reset();
+
+    destroyMainPipelines();
+    shader3D.reset();
+    indirectShader3D.reset();
+    lodShader3D.reset();
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     vkDestroyRenderPass(device, renderPass, nullptr);
 
@@ -499,138 +936,127 @@ void VulkanBase::cleanup()
         vkDestroyImageView(device, imageView, nullptr);
     }
 
-    vkDestroySwapchainKHR(device, swapChainManager->getSwapChain(), nullptr);
+    // Swapchain (or the headless images) and its views
+    swapChainManager.reset();
 
     vkDestroySampler(device, textureSampler, nullptr);
-    vkDestroyImageView(device, textureImageView, nullptr);
-
-    vkDestroyDevice(device, nullptr);
+    materialTable.reset();   // Frees its bindless slots, so before the table
+    textureStreamer.reset(); // Material images, views and placeholders
+    imageBasedLighting.reset();
+    atmosphereSky.reset();
+    bindlessTable.reset();
+    descriptorAllocator.reset(); // Scene, water and skybox sets
+    vkDestroyDescriptorPool(device, imguiDescriptorPool, nullptr);
 
-    vkDestroyImage(device, textureImage, nullptr);
-    vkFreeMemory(device, textureImageMemory, nullptr);
-
-    if (sceneFramebuffer != VK_NULL_HANDLE)
+    // Reflection cleanup
+    if (sceneReflectionSampler != VK_NULL_HANDLE)
     {
-        vkDestroyFramebuffer(device, sceneFramebuffer, nullptr);
-        sceneFramebuffer = VK_NULL_HANDLE;
+        vkDestroySampler(device, sceneReflectionSampler, nullptr);
+        sceneReflectionSampler = VK_NULL_HANDLE;
     }
-    if (sceneRenderPass != VK_NULL_HANDLE)
+    if (sceneReflectionImageView != VK_NULL_HANDLE)
     {
-        vkDestroyRenderPass(device, sceneRenderPass, nullptr);
-        sceneRenderPass = VK_NULL_HANDLE;
+        vkDestroyImageView(device, sceneReflectionImageView, nullptr);
+        sceneReflectionImageView = VK_NULL_HANDLE;
     }
-
-    // Refraction cleanup
-    if (sceneRefractionFramebuffer != VK_NULL_HANDLE)
+    if (sceneReflectionImage != VK_NULL_HANDLE)
     {
-        vkDestroyFramebuffer(device, sceneRefractionFramebuffer, nullptr);
-        sceneRefractionFramebuffer = VK_NULL_HANDLE;
+        GpuMemoryAllocator::get().destroyImage(sceneReflectionImage);
+        sceneReflectionImage = VK_NULL_HANDLE;
     }
-    if (sceneRefractionRenderPass != VK_NULL_HANDLE)
+
+    // Water cleanup (if created)
+    if (waterSampler != VK_NULL_HANDLE)
     {
-        vkDestroyRenderPass(device, sceneRefractionRenderPass, nullptr);
-        sceneRefractionRenderPass = VK_NULL_HANDLE;
+        vkDestroySampler(device, waterSampler, nullptr);
+        waterSampler = VK_NULL_HANDLE;
     }
-    if (sceneRefractionSampler != VK_NULL_HANDLE)
+    if (waterDescriptorSetLayout != VK_NULL_HANDLE)
     {
-        vkDestroySampler(device, sceneRefractionSampler, nullptr);
-        sceneRefractionSampler = VK_NULL_HANDLE;
+        vkDestroyDescriptorSetLayout(device, waterDescriptorSetLayout, nullptr);
+        waterDescriptorSetLayout = VK_NULL_HANDLE;
     }
-    if (sceneRefractionImageView != VK_NULL_HANDLE)
-    {
-        vkDestroyImageView(device, sceneRefractionImageView, nullptr);
-        sceneRefractionImageView = VK_NULL_HANDLE;
-    }
-    if (sceneRefractionImage != VK_NULL_HANDLE)
-    {
-        vkDestroyImage(device, sceneRefractionImage, nullptr);
-        vkFreeMemory(device, sceneRefractionImageMemory, nullptr);
-        sceneRefractionImage = VK_NULL_HANDLE;
-    }
-
-    // Reflection cleanup
-    if (sceneReflectionFramebuffer != VK_NULL_HANDLE)
-    {
-        vkDestroyFramebuffer(device, sceneReflectionFramebuffer, nullptr);
-        sceneReflectionFramebuffer = VK_NULL_HANDLE;
-    }
-    if (sceneReflectionRenderPass != VK_NULL_HANDLE)
-    {
-        vkDestroyRenderPass(device, sceneReflectionRenderPass, nullptr);
-        sceneReflectionRenderPass = VK_NULL_HANDLE;
-    }
-    if (sceneReflectionSampler != VK_NULL_HANDLE)
-    {
-        vkDestroySampler(device, sceneReflectionSampler, nullptr);
-        sceneReflectionSampler = VK_NULL_HANDLE;
-    }
-    if (sceneReflectionImageView != VK_NULL_HANDLE)
-    {
-        vkDestroyImageView(device, sceneReflectionImageView, nullptr);
-        sceneReflectionImageView = VK_NULL_HANDLE;
-    }
-    if (sceneReflectionImage != VK_NULL_HANDLE)
-    {
-        vkDestroyImage(device, sceneReflectionImage, nullptr);
-        vkFreeMemory(device, sceneReflectionImageMemory, nullptr);
-        sceneReflectionImage = VK_NULL_HANDLE;
-    }
-
-    // Water cleanup (if created)
-    if (waterSampler != VK_NULL_HANDLE)
-    {
-        vkDestroySampler(device, waterSampler, nullptr);
-        waterSampler = VK_NULL_HANDLE;
-    }
-    if (waterDescriptorSetLayout != VK_NULL_HANDLE)
-    {
-        vkDestroyDescriptorSetLayout(device, waterDescriptorSetLayout, nullptr);
-        waterDescriptorSetLayout = VK_NULL_HANDLE;
-    }
-    if (waterNormalImageView != VK_NULL_HANDLE)
+    if (waterNormalImageView != VK_NULL_HANDLE)
     {
         vkDestroyImageView(device, waterNormalImageView, nullptr);
         waterNormalImageView = VK_NULL_HANDLE;
     }
     if (waterNormalImage != VK_NULL_HANDLE)
     {
-        vkDestroyImage(device, waterNormalImage, nullptr);
-        vkFreeMemory(device, waterNormalImageMemory, nullptr);
+        GpuMemoryAllocator::get().destroyImage(waterNormalImage);
     }
     if (waterPipeline)
     {
         waterPipeline->destroy(device);
         waterPipeline.reset();
     }
+    if (waterTessPipeline)
+    {
+        waterTessPipeline->destroy(device);
+        waterTessPipeline.reset();
+    }
     if (waterMesh)
     {
         waterMesh->destroy(device);
         waterMesh.reset();
     }
+    froxelVolume.reset();
+    oceanCaustics.reset();
+    waterHeights.reset();
+    oceanFFT.reset();
     if (underwaterWaterPipeline)
     {
         underwaterWaterPipeline->destroy(device);
         underwaterWaterPipeline.reset();
     }
+    if (lowResUnderwaterPipeline)
+    {
+        lowResUnderwaterPipeline->destroy(device);
+        lowResUnderwaterPipeline.reset();
+    }
+    if (lowResSunraysPipeline)
+    {
+        lowResSunraysPipeline->destroy(device);
+        lowResSunraysPipeline.reset();
+    }
+    temporalUpscaler.reset();
+    godRayUpsampler.reset();
+    marineSnow.reset();
+    tileClassifier.reset();
+    shadingRates.reset();
+    shadowCascades.reset();
+    clusteredLights.reset();
+    screenSpaceReflections.reset();
     if (oceanBottomMesh)
     {
         oceanBottomMesh->destroy(device);
         oceanBottomMesh.reset();
     }
-    for (auto fb : imguiFramebuffers)
-        vkDestroyFramebuffer(device, fb, nullptr);
-
     vkDestroyRenderPass(device, imguiRenderPass, nullptr);
 
+    UploadContext::get().cleanup();
+    PipelineCache::get().cleanup(); // Saves to disk for the next start
+
+    // Frees every remaining pool block (textures, render targets, skybox)
+    GpuMemoryAllocator::get().cleanup();
+
+    vkDestroyDevice(device, nullptr);
+
     if (VkUtils::enableValidationLayers)
     {
         VkUtils::DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (!headless)
+    {
+        vkDestroySurfaceKHR(instance, surface, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
 
-    glfwDestroyWindow(window);
+    if (window)
+    {
+        glfwDestroyWindow(window);
+    }
     glfwTerminate();
 }
 
@@ -647,7 +1073,8 @@ void VulkanBase::createInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // Descriptor indexing (BindlessTable) is core in 1.2
+    appInfo.apiVersion = VK_API_VERSION_1_2;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -712,7 +1139,7 @@ void VulkanBase::mouseMove(GLFWwindow *window, double xpos, double ypos)
         lastX = xpos;
         lastY = ypos;
 
-        camera.processMouseMovement(xoffset, yoffset);
+        simulationInput.look += glm::vec2(xoffset, yoffset);
     }
     else
     {
@@ -735,7 +1162,7 @@ void VulkanBase::mouseEvent(GLFWwindow *window, int button, int action, int mods
 
 void VulkanBase::mouseScroll(GLFWwindow *window, double xoffset, double yoffset)
 {
-    camera.processMouseScroll(static_cast<float>(yoffset));
+    simulationInput.scroll += static_cast<float>(yoffset);
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -783,6 +1210,9 @@ void VulkanBase::setupDebugMessenger()
     }
 }
 
+// Frames are recorded through the render graph, which builds its own passes. This one is the
+// compatibility reference every scene pipeline is created against: the graph's Reflection,
+// Refraction and Main passes use the same attachment formats, samples and order.
 void VulkanBase::createRenderPass()
 {
     VkAttachmentDescription colorAttachment{};
@@ -799,7 +1229,7 @@ void VulkanBase::createRenderPass()
     depthAttachment.format = findDepthFormat();
     depthAttachment.samples = msaaSamples;
     depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // Read back by the Hi-Z build
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -852,10 +1282,18 @@ void VulkanBase::createRenderPass()
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
 
+    // Stereo: every pipeline built against the main pass draws both eyes (Multiview.h)
+    VkRenderPassMultiviewCreateInfo multiviewInfo{};
+    if (stereoRendering)
+    {
+        Multiview::chainRenderPass(renderPassInfo, multiviewInfo);
+    }
+
     if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create render pass!");
     }
+    DynamicRendering::registerRenderPass(renderPass, renderPassInfo);
 
     // DEBUG: Verify render pass was created successfully
     // std::cout << "[DEBUG] createRenderPass: Main render pass created with handle: " << renderPass << "\n";
@@ -863,6 +1301,8 @@ void VulkanBase::createRenderPass()
     // std::cout << "[DEBUG] createRenderPass: Depth attachment samples: " << msaaSamples << "\n";
 }
 
+// Compatibility reference for the ImGui pipeline: the graph's ImGui pass, and any single-colour swapchain
+// pass it is merged into (RenderGraph::addOverlay)
 void VulkanBase::createImGuiRenderPass()
 {
     VkAttachmentDescription colorAttachment{};
@@ -873,7 +1313,7 @@ void VulkanBase::createImGuiRenderPass()
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = getSwapchainFinalLayout();
 
     VkAttachmentReference colorRef{};
     colorRef.attachment = 0;
@@ -900,28 +1340,6 @@ void VulkanBase::createImGuiRenderPass()
     //   std::cout << "[DEBUG] Main renderPass handle: " << renderPass << "\n";
 }
 
-void VulkanBase::createImGuiFramebuffers()
-{
-    imguiFramebuffers.resize(swapChainManager->getSwapChainImageViews().size());
-
-    for (size_t i = 0; i < imguiFramebuffers.size(); i++)
-    {
-        VkImageView attachment = swapChainManager->getSwapChainImageViews()[i];
-
-        VkFramebufferCreateInfo fbInfo{};
-        fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        fbInfo.renderPass = imguiRenderPass;
-        fbInfo.attachmentCount = 1;
-        fbInfo.pAttachments = &attachment;
-        fbInfo.width = swapChainManager->getSwapChainExtent().width;
-        fbInfo.height = swapChainManager->getSwapChainExtent().height;
-        fbInfo.layers = 1;
-
-        if (vkCreateFramebuffer(device, &fbInfo, nullptr, &imguiFramebuffers[i]) != VK_SUCCESS)
-            throw std::runtime_error("failed to create ImGui framebuffer!");
-    }
-}
-
 void VulkanBase::createSurface()
 {
     VkWin32SurfaceCreateInfoKHR createInfo{};
@@ -948,65 +1366,71 @@ void VulkanBase::pickPhysicalDevice()
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-    VkPhysicalDevice selectedDevice = VK_NULL_HANDLE;
-    int highestScore = 0;
+    // Scored, discrete first, unless --gpu or XERENDER_GPU names one (DeviceSelection.h)
+    const std::vector<DeviceSelection::Candidate> candidates = DeviceSelection::rank(
+        devices, surface, [this](VkPhysicalDevice candidate) { return isDeviceSuitable(candidate); });
+    VkPhysicalDevice selectedDevice = DeviceSelection::select(candidates, DeviceSelection::getOverride(gpuOverride));
 
-    for (const auto &device : devices)
-    {
-        VkPhysicalDeviceProperties deviceProperties;
-        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    physicalDevice = selectedDevice;
+    msaaSamples = getMaxUsableSampleCount();
+    maxMsaaSamples = msaaSamples;
+    requestedMsaaSamples = msaaSamples;
 
-        std::cout << "Found GPU: " << deviceProperties.deviceName << std::endl;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    usableSampleCounts = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+}
 
-        // Check if the device is an NVIDIA RTX GPU
-        bool isNvidiaRTX = (std::string(deviceProperties.deviceName).find("NVIDIA") != std::string::npos) &&
-                           (std::string(deviceProperties.deviceName).find("RTX") != std::string::npos);
+void VulkanBase::createLogicalDevice()
+{
+    VkUtils::QueueFamilyIndices indices = VkUtils::FindQueueFamilies(physicalDevice, surface);
 
-        if (isNvidiaRTX && isDeviceSuitable(device))
+    // Experimental alternate-frame rendering over the GPU's device group (DeviceGroup.h); headless only
+    std::vector<VkPhysicalDevice> groupDevices = {physicalDevice};
+    if (headless && headlessOptions.deviceGroup)
+    {
+        groupDevices = DeviceGroup::find(instance, physicalDevice);
+        if (groupDevices.size() < 2)
         {
-            selectedDevice = device;
-            std::cout << "Selected NVIDIA RTX GPU: " << deviceProperties.deviceName << std::endl;
-            break; // Since we found an RTX, we can stop searching
+            std::cout << "[DeviceGroup] The selected GPU has no peers, running on it alone\n";
         }
     }
+    const bool multiDevice = groupDevices.size() > 1;
 
-    // Fallback: If no NVIDIA RTX device was found, pick the first suitable device
-    if (selectedDevice == VK_NULL_HANDLE)
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    if (indices.transferFamily.has_value())
     {
-        for (const auto &device : devices)
-        {
-            if (isDeviceSuitable(device))
-            {
-                selectedDevice = device;
-                break;
-            }
-        }
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
     }
 
-    if (selectedDevice == VK_NULL_HANDLE)
+    // Optional async compute (AsyncCompute.h). Uploads may submit from other threads, so when the
+    // compute family is also the transfer family it needs a second queue of its own
+    uint32_t computeQueueIndex = 0;
+    // Not on a device group: the compute submissions would need device masks of their own
+    asyncComputeSupported = indices.computeFamily.has_value() && !multiDevice;
+    if (asyncComputeSupported && indices.computeFamily == indices.transferFamily)
     {
-        throw std::runtime_error("failed to find a suitable GPU!");
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+        asyncComputeSupported = families[indices.computeFamily.value()].queueCount > 1;
+        computeQueueIndex = 1;
+    }
+    if (asyncComputeSupported)
+    {
+        uniqueQueueFamilies.insert(indices.computeFamily.value());
     }
 
-    physicalDevice = selectedDevice;
-    msaaSamples = getMaxUsableSampleCount();
-}
-
-void VulkanBase::createLogicalDevice()
-{
-    VkUtils::QueueFamilyIndices indices = VkUtils::FindQueueFamilies(physicalDevice, surface);
-
-    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
-
-    float queuePriority = 1.0f;
+    const std::array<float, 2> queuePriorities = {1.0f, 1.0f};
     for (uint32_t queueFamily : uniqueQueueFamilies)
     {
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.queueCount = asyncComputeSupported && queueFamily == indices.computeFamily ? computeQueueIndex + 1 : 1;
+        queueCreateInfo.pQueuePriorities = queuePriorities.data();
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
@@ -1015,21 +1439,167 @@ void VulkanBase::createLogicalDevice()
     deviceFeatures.sampleRateShading = VK_TRUE;
     deviceFeatures.fillModeNonSolid = VK_TRUE; // Enable non-solid fill modes
 
+    // Optional GPU-driven scene path: indirect draws select the object through firstInstance
+    gpuDrivenSupported = GpuCulling::isSupported(physicalDevice);
+    if (gpuDrivenSupported)
+    {
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    }
+
+    // Optional tessellated water surface; without it the CDLOD grid alone sets the detail
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    tessellationSupported = supportedFeatures.tessellationShader == VK_TRUE;
+    deviceFeatures.tessellationShader = tessellationSupported ? VK_TRUE : VK_FALSE;
+
+    // Cooked KTX2 textures (XeTexCook) in formats the device cannot sample fall back to the source image
+    textureCompressionBCSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
+    textureCompressionASTCSupported = supportedFeatures.textureCompressionASTC_LDR == VK_TRUE;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
+    // Optional hardware counters for test runs (GpuCounters.h)
+    pipelineStatisticsSupported = GpuCounters::isSupported(physicalDevice);
+    if (pipelineStatisticsSupported)
+    {
+        GpuCounters::enableFeatures(deviceFeatures);
+    }
+
+    // Headless never presents, so it needs no swapchain
+    std::vector<const char *> enabledExtensions;
+    if (!headless)
+    {
+        enabledExtensions.assign(deviceExtensions.begin(), deviceExtensions.end());
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    for (const auto &extension : availableExtensions)
+    {
+        if (std::strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0)
+        {
+            drawIndirectCountSupported = true;
+        }
+    }
+    // The bindless table's descriptor indexing features; with this struct chained, every
+    // enabled extension promoted to 1.2 needs its feature bit set here as well
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    BindlessTable::enableFeatures(vulkan12Features);
+    TimelineSemaphore::enableFeatures(vulkan12Features); // Frame pacing, uploads and async compute
+
+    if (gpuDrivenSupported && drawIndirectCountSupported)
+    {
+        enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        vulkan12Features.drawIndirectCount = VK_TRUE;
+    }
+
+    // Optional present pacing and latency measurement (PresentPacer.h)
+    PresentPacer::Features presentFeatures{};
+    presentWaitSupported = !headless && PresentPacer::isSupported(physicalDevice);
+    if (presentWaitSupported)
+    {
+        enabledExtensions.insert(enabledExtensions.end(), PresentPacer::kExtensions.begin(), PresentPacer::kExtensions.end());
+        vulkan12Features.pNext = PresentPacer::enableFeatures(presentFeatures, vulkan12Features.pNext);
+    }
+
+    // Vendor counters next to the pipeline statistics, where the driver exposes them
+    GpuCounters::PerformanceQueryFeatures performanceQueryFeatures{};
+    performanceQuerySupported = pipelineStatisticsSupported && GpuCounters::isPerformanceQuerySupported(physicalDevice);
+    if (performanceQuerySupported)
+    {
+        enabledExtensions.push_back(VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME);
+        GpuCounters::enablePerformanceQuery(performanceQueryFeatures, vulkan12Features);
+    }
+
+    // Heap budgets for the Memory panel and the texture streamer's mip drops (GpuMemoryAllocator.h)
+    memoryBudgetSupported = GpuMemoryAllocator::isBudgetSupported(physicalDevice);
+    if (memoryBudgetSupported)
+    {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    // Graph passes begun without render passes or framebuffers; the bench can keep render passes to compare
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingEnabled = !(headless && headlessOptions.renderPasses) && DynamicRendering::isSupported(physicalDevice);
+    if (dynamicRenderingEnabled)
+    {
+        enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        vulkan12Features.pNext = DynamicRendering::enableFeatures(dynamicRenderingFeatures, vulkan12Features.pNext);
+    }
+
+    // Coarser shading of the underwater effects where the fog hides detail (VariableRateShading.h)
+    VkPhysicalDeviceFragmentShadingRateFeaturesKHR shadingRateFeatures{};
+    variableRateShadingSupported = VariableRateShading::isSupported(physicalDevice);
+    if (variableRateShadingSupported)
+    {
+        enabledExtensions.push_back(VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME);
+        vulkan12Features.pNext = VariableRateShading::enableFeatures(shadingRateFeatures, vulkan12Features.pNext);
+    }
+
+    // Reflections and refractions traced through the scene (RayQueryScene.h); device addresses are per GPU of a group
+    RayQueryScene::Features rayQueryFeatures{};
+    rayQuerySupported = !multiDevice && RayQueryScene::isSupported(physicalDevice);
+    if (rayQuerySupported)
+    {
+        enabledExtensions.insert(enabledExtensions.end(), RayQueryScene::extensions().begin(), RayQueryScene::extensions().end());
+        vulkan12Features.bufferDeviceAddress = VK_TRUE;
+        vulkan12Features.pNext = RayQueryScene::enableFeatures(rayQueryFeatures, vulkan12Features.pNext);
+    }
+
+    // The scene and water shaders read gl_ViewIndex whether or not the main pass is stereo (Multiview.h)
+    if (!Multiview::isSupported(physicalDevice))
+    {
+        throw std::runtime_error("failed to create logical device: multiview is not supported!");
+    }
+    VkPhysicalDeviceMultiviewFeatures multiviewFeatures{};
+    vulkan12Features.pNext = Multiview::enableFeatures(multiviewFeatures, vulkan12Features.pNext);
+
+    DeviceGroup::CreateInfo groupInfo{};
+    if (multiDevice)
+    {
+        vulkan12Features.pNext = DeviceGroup::enable(groupInfo, groupDevices, vulkan12Features.pNext);
+    }
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &vulkan12Features;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create logical device!");
     }
+    if (multiDevice)
+    {
+        deviceGroup = std::make_unique<DeviceGroup>(device, groupDevices);
+    }
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+    if (dynamicRenderingEnabled)
+    {
+        DynamicRendering::enable(device);
+    }
+
+    // Uploads fall back to the graphics queue when there is no transfer-only family
+    graphicsQueueFamily = indices.graphicsFamily.value();
+    transferQueueFamily = indices.transferFamily.value_or(graphicsQueueFamily);
+    vkGetDeviceQueue(device, transferQueueFamily, 0, &transferQueue);
+
+    if (asyncComputeSupported)
+    {
+        computeQueueFamily = indices.computeFamily.value();
+        vkGetDeviceQueue(device, computeQueueFamily, computeQueueIndex, &computeQueue);
+    }
 }
 
 void VulkanBase::framebufferResizeCallback(GLFWwindow *window, int width, int height)
@@ -1045,38 +1615,29 @@ void VulkanBase::framebufferResizeCallback(GLFWwindow *window, int width, int he
     }
 }
 
-void VulkanBase::createFrameBuffers()
+void VulkanBase::createCommandPool()
 {
-    swapChainFramebuffers.resize(swapChainManager->getSwapChainImageViews().size());
-
-    for (size_t i = 0; i < swapChainManager->getSwapChainImageViews().size(); i++)
-    {
-        std::array<VkImageView, 3> attachments = {
-            colorImageView,
-            depthImageView,
-            swapChainManager->getSwapChainImageViews()[i]};
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapChainManager->getSwapChainExtent().width;
-        framebufferInfo.height = swapChainManager->getSwapChainExtent().height;
-        framebufferInfo.layers = 1;
+    VkUtils::QueueFamilyIndices queueFamilyIndices = VkUtils::FindQueueFamilies(physicalDevice, surface);
 
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create framebuffer!");
-        }
-    }
+    commandPool.create(device, queueFamilyIndices.graphicsFamily.value());
 }
 
-void VulkanBase::createCommandPool()
+void VulkanBase::createSecondaryRecorder()
 {
     VkUtils::QueueFamilyIndices queueFamilyIndices = VkUtils::FindQueueFamilies(physicalDevice, surface);
 
-    commandPool.create(device, queueFamilyIndices.graphicsFamily.value());
+    jobSystem = std::make_unique<JobSystem>(JobSystem::defaultWorkerCount());
+    secondaryRecorder = std::make_unique<SecondaryCommandRecorder>(device, queueFamilyIndices.graphicsFamily.value(),
+                                                                   MAX_FRAMES_IN_FLIGHT, *jobSystem);
+    // The scene and water passes execute secondaries inside a pass whose statistics are being counted
+    if (pipelineStatisticsSupported)
+    {
+        secondaryRecorder->setInheritedStatistics(GpuCounters::kStatistics);
+    }
+
+    // A lone thread gains nothing from secondaries, record inline instead
+    parallelRecording = jobSystem->getThreadCount() > 1;
+    std::cout << "[Recorder] " << jobSystem->getThreadCount() << " recording threads\n";
 }
 
 void printCurrentWorkingDirectory()
@@ -1086,6 +1647,7 @@ void printCurrentWorkingDirectory()
 
 void VulkanBase::loadModel()
 {
+    CPU_ZONE("VulkanBase::loadModel");
     // printCurrentWorkingDirectory();
 
     std::string modelPath = "Res/Model.obj";
@@ -1100,22 +1662,13 @@ void VulkanBase::loadModel()
 
     SceneObject modelObject;
 
-    if (!ModelLoader::loadOBJ(modelPath, modelObject.vertices, modelObject.indices))
+    if (!ModelLoader::loadMesh(modelPath, modelObject.vertices, modelObject.indices, &modelObject.meshlets, &modelObject.lods))
     {
         throw std::runtime_error("Failed to load model!");
     }
 
-    sceneObjects.push_back(modelObject); // Store the model as a SceneObject
-
-    // Aggregate the vertex and index data
-    uint32_t indexOffset = static_cast<uint32_t>(vertices.size());
-
-    vertices.insert(vertices.end(), modelObject.vertices.begin(), modelObject.vertices.end());
-
-    for (const auto &index : modelObject.indices)
-    {
-        indices.push_back(index + indexOffset);
-    }
+    scene.addObject(modelObject); // Store the model as a scene object
+    scene.updateBvh();             // Build the culling BVH now rather than on the first frame
 
     createVertexBuffer();
     createIndexBuffer();
@@ -1124,29 +1677,16 @@ void VulkanBase::loadModel()
 void VulkanBase::createVertexBuffer()
 {
     // std::cout << "Creating vertex buffer..." << std::endl;
+    const std::vector<PackedVertex> &vertices = scene.getVertices();
     VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    std::tie(stagingBuffer, stagingBufferMemory) = VkUtils::CreateBuffer(
-        device, physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    void *data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), (size_t)bufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
-
     std::tie(vertexBuffer, vertexBufferMemory) = VkUtils::CreateBuffer(
         device, physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+            (rayQuerySupported ? RayQueryScene::kGeometryUsage : 0),
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    VkUtils::CopyBuffer(stagingBuffer, vertexBuffer, bufferSize, device, commandPool.getVkCommandPool(), graphicsQueue);
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    UploadContext::get().uploadBuffer(vertexBuffer, vertices.data(), bufferSize);
 
     // std::cout << "Vertex buffer created: " << vertexBuffer << std::endl;
 }
@@ -1154,35 +1694,23 @@ void VulkanBase::createVertexBuffer()
 void VulkanBase::createIndexBuffer()
 {
     // std::cout << "Creating index buffer..." << std::endl;
+    const std::vector<uint32_t> &indices = scene.getIndices();
     VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    std::tie(stagingBuffer, stagingBufferMemory) = VkUtils::CreateBuffer(
-        device, physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    void *data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), (size_t)bufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
-
     std::tie(indexBuffer, indexBufferMemory) = VkUtils::CreateBuffer(
         device, physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+            (rayQuerySupported ? RayQueryScene::kGeometryUsage : 0),
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    VkUtils::CopyBuffer(stagingBuffer, indexBuffer, bufferSize, device, commandPool.getVkCommandPool(), graphicsQueue);
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    UploadContext::get().uploadBuffer(indexBuffer, indices.data(), bufferSize);
 
     // std::cout << "Index buffer created: " << indexBuffer << std::endl;
 }
 
 void VulkanBase::recordCommandBuffer(CommandBuffer &commandBuffer, uint32_t imageIndex)
 {
+    CPU_ZONE("VulkanBase::recordCommandBuffer");
     // SAFETY: Skip command buffer recording entirely during swap chain recreation
     // to prevent accessing destroyed resources (images, descriptor sets, etc.)
     if (isRecreatingSwapChain)
@@ -1190,69 +1718,49 @@ void VulkanBase::recordCommandBuffer(CommandBuffer &commandBuffer, uint32_t imag
         return;
     }
 
-    if (imageIndex >= commandBuffers.size() || imageIndex >= swapChainFramebuffers.size() || imageIndex >= descriptorSets.size())
+    if (imageIndex >= commandBuffers.size() || imageIndex >= swapChainManager->getSwapChainImageViews().size() || imageIndex >= descriptorSets.size())
     {
         throw std::out_of_range("imageIndex is out of range.");
     }
 
     // ==============================================================================
+    // Per-draw values only (16 bytes); the tuning goes through WaterParams (WaterParamsBuffer.h)
     struct alignas(16) WaterPushConstant
     {
         float time;
         float scale;
         float debugRays;
-        float renderingMode;  // 0=BL, 1=PB, 2=OPT
-        glm::vec4 baseColor;  // Used for SHALLOW Color
-        glm::vec4 lightColor; // Used for DEEP Color (repurposed)
-        float ambient;
-        float shininess;
-        float causticIntensity;
-        float distortionStrength;
-        float godRayIntensity;
-        float scatteringIntensity;
-        float opacity;
-        float fogDensity;
-        // God-ray tuning parameters (added to match shader push-constant expectations)
-        float godExposure;
-        float godDecay;
-        float godDensity;
-        float godSampleScale;
+        float renderingMode; // 0=BL, 1=PB, 2=OPT
     };
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    commandBuffer.begin(&beginInfo);
-
-    // === START GPU TIMER (for accurate GPU timing during tests) ===
-    if (waterTestingSystem && isTestModeActive)
+    // On a device group, the whole frame runs on one GPU
+    VkDeviceGroupCommandBufferBeginInfo deviceGroupBegin{};
+    if (deviceGroup)
     {
-        waterTestingSystem->resetTimestampQueries(commandBuffer.getVkCommandBuffer());
-        waterTestingSystem->writeTimestampStart(commandBuffer.getVkCommandBuffer());
+        beginInfo.pNext = deviceGroup->chainBegin(deviceGroupBegin, frameDevice, beginInfo.pNext);
     }
+    commandBuffer.begin(&beginInfo);
 
-    static glm::vec3 underwaterShallowColor = {0.0f, 0.6f, 0.8f}; // Bright Teal
-    static glm::vec3 underwaterDeepColor = {0.0f, 0.1f, 0.25f};   // Dark Blue
+    // === START GPU TIMER (the graph's passes and the water draws are scopes inside it) ===
+    gpuProfiler->resetQueries(commandBuffer.getVkCommandBuffer());
+    gpuCounters->resetQueries(commandBuffer.getVkCommandBuffer());
+    const uint32_t frameScope = gpuProfiler->beginScope(commandBuffer.getVkCommandBuffer(), "Frame");
+
+    // Every pass of the frame reads the snapshot; the panel built below edits renderSettings for the next
+    const RenderSettings &settings = frameSettings;
 
     // Determine if camera is underwater
-    float waterHeight = 0.0f;
-    bool isUnderwater = camera.position.y < waterHeight - 0.1f;
-    static bool showDebugRays = false;
-    // Persistent tuning controls (editable in ImGui; values persist between frames)
-    static float godExposure = 0.6f;
-    static float godDecay = 0.96f;
-    static float godDensity = 0.5f;
-    static float godSampleScale = 1.0f;
-
-    // Underwater rendering mode selection
-    static int currentRenderingMode = 0; // 0=BL, 1=PB, 2=OPT
-    static const char *renderingModes[] = {"BL (Baseline)", "PB (Physically-Based)", "OPT (Optimized)"};
+    bool isUnderwater = isCameraUnderwater();
+
     // --- 1. SET CLEAR COLOR TO DEEP COLOR IF UNDERWATER ---
     // This is CRITICAL. The background must match the deep fog to hide seams.
     if (isUnderwater)
     {
-        clearColor.color = {{underwaterDeepColor.r, underwaterDeepColor.g, underwaterDeepColor.b, 1.0f}};
+        clearColor.color = {{settings.underwaterDeepColor.r, settings.underwaterDeepColor.g, settings.underwaterDeepColor.b, 1.0f}};
     }
     else if (useSolidBackground)
     {
@@ -1263,27 +1771,324 @@ void VulkanBase::recordCommandBuffer(CommandBuffer &commandBuffer, uint32_t imag
         clearColor.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
     }
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapChainManager->getSwapChainExtent();
+    // ==============================================================================
+    // FRAME GRAPH: IMAGES
+    // ==============================================================================
+    // Passes are declared in execution order; the graph culls the unused ones and
+    // records every layout transition and hazard barrier between them (RenderGraph.h)
+    const VkExtent2D extent = swapChainManager->getSwapChainExtent();
+    const VkFormat colorFormat = swapChainManager->getSwapChainImageFormat();
+    const bool secondaryContents = parallelRecording && secondaryRecorder;
+    // In stereo the camera both eyes are culled with (Multiview.h)
+    const glm::mat4 viewProjection = frameUBO.proj * frameUBO.view;
+    // Stereo: the main pass renders one eye per layer, each half the frame's width, and copies them into it
+    const VkExtent2D viewExtent = getViewExtent();
+    const uint32_t viewLayers = stereoRendering ? Multiview::kViewCount : 1;
+    const uint32_t viewMask = stereoRendering ? Multiview::kViewMask : 0;
+
+    RenderGraphImageDesc msaaColorDesc{colorFormat, viewExtent, msaaSamples,
+                                       VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, viewLayers};
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(depthFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+    RenderGraphImageDesc depthDesc{depthFormat, viewExtent, msaaSamples, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthAspect, viewLayers};
+    RenderGraphImageDesc offscreenDepthDesc = depthDesc;
+    offscreenDepthDesc.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    RenderGraphImageDesc resolvedDesc{colorFormat, extent, VK_SAMPLE_COUNT_1_BIT,
+                                      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT};
+
+    RenderGraphResource swapchain = renderGraph->importImage(
+        "Swapchain", swapChainManager->getSwapChainImages()[imageIndex], swapChainManager->getSwapChainImageViews()[imageIndex], resolvedDesc,
+        {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0}, // Acquire semaphore waits at this stage
+        {getSwapchainFinalLayout(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0});
+    renderGraph->markOutput(swapchain);
+
+    // Written by last frame's main pass and read by its Hi-Z build; contents are not needed across frames.
+    // When neither the Hi-Z build nor the god ray upsample can sample it, it is a transient attachment
+    // like the MSAA colour, lazily allocated where the device allows (it then never leaves tile memory)
+    const bool depthSampled = halfResGodRays || (mainView.gpuDriven && gpuOcclusionCulling && gpuCulling->isHiZAvailable());
+    RenderGraphResource depth = depthSampled
+                                    ? renderGraph->importImage(
+                                          "Depth", depthImage, depthImageView, depthDesc,
+                                          {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                           VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT},
+                                          {})
+                                    : renderGraph->createImage("Depth", offscreenDepthDesc);
+
+    // Bound in the water set, so they stay shader-readable whether or not the offscreen passes run
+    const RenderGraphImageState shaderRead{VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0};
+    RenderGraphResource reflection = renderGraph->importImage("Reflection", sceneReflectionImage, sceneReflectionImageView, resolvedDesc, shaderRead, shaderRead);
+    RenderGraphResource refraction = renderGraph->importImage("Refraction", sceneColorImage, sceneColorImageView, resolvedDesc, shaderRead, shaderRead);
+
+    RenderGraphResource mainColor = renderGraph->createImage("MainColor", msaaColorDesc);
+
+    // ==============================================================================
+    // FRAME GRAPH: PASSES BEFORE THE MAIN PASS
+    // ==============================================================================
+    // GPU-driven scene: cull into indirect commands before any pass consumes them
+    if (mainView.gpuDriven)
+    {
+        gpuCulling->setOcclusionEnabled(gpuOcclusionCulling);
+        renderGraph->addPass("Cull", [this, viewProjection](const RenderGraphPassContext &pass)
+                             { gpuCulling->recordCull(pass.cmd, static_cast<uint32_t>(currentFrame), viewProjection); })
+            .sideEffect();
+    }
+
+    // Point lights into the cluster grid, read by every pass shading the scene or the water
+    if (clusteredLights->needsCull(static_cast<uint32_t>(currentFrame)))
+    {
+        renderGraph->addPass("LightCull", [this](const RenderGraphPassContext &pass)
+                             { clusteredLights->recordCull(pass.cmd, static_cast<uint32_t>(currentFrame)); })
+            .sideEffect();
+    }
 
-    std::array<VkClearValue, 3> clearValues{};
-    clearValues[0] = clearColor;
-    clearValues[1].depthStencil = {1.0f, 0};
-    clearValues[2] = clearColor;
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
+    // The procedural sky, only when the sun has moved: every sky draw this frame reads it
+    if (atmosphericSky && atmosphereSky->needsUpdate(glm::normalize(light0Position)))
+    {
+        const glm::vec3 toSun = glm::normalize(light0Position);
+        renderGraph->addPass("AtmosphereSky", [this, toSun](const RenderGraphPassContext &pass)
+                             { atmosphereSky->recordUpdate(pass.cmd, toSun); })
+            .sideEffect();
+    }
+
+    // The floor's bathymetry page table, when tiles came or went: every floor draw this frame reads it
+    if (oceanBottomMesh->needsPageUpload())
+    {
+        renderGraph->addPass("Bathymetry", [this](const RenderGraphPassContext &pass)
+                             { oceanBottomMesh->recordPageUpload(pass.cmd, static_cast<uint32_t>(currentFrame)); })
+            .sideEffect();
+    }
+
+    // Sun shadow cascades: the ones due this frame are re-rendered from the shared caster list, and
+    // every pass drawing the scene samples all of them (3d_shader.frag)
+    const uint32_t shadowCascadeCount = shadowCascades->getCascadeCount();
+    static const char *const kShadowPassNames[ShadowCascades::kMaxCascades] = {"Shadow0", "Shadow1", "Shadow2", "Shadow3"};
+    std::array<RenderGraphResource, ShadowCascades::kMaxCascades> shadowMaps{};
+    for (uint32_t cascade = 0; cascade < shadowCascadeCount; cascade++)
+    {
+        shadowMaps[cascade] = shadowCascades->importCascade(*renderGraph, cascade);
+        if (!shadowCascades->isDue(cascade))
+            continue;
+        renderGraph->addPass(kShadowPassNames[cascade], [this, cascade](const RenderGraphPassContext &pass)
+                             {
+            SecondaryCommandRecorder::setViewport(pass.cmd, pass.extent);
+            shadowCascades->recordCascade(pass.cmd, cascade, scene, shadowDrawList, vertexBuffer, indexBuffer, uniformArena->getBuffer()); })
+            .depth(shadowMaps[cascade], VK_ATTACHMENT_LOAD_OP_CLEAR);
+    }
+    auto sampleShadowMaps = [&](RenderGraph::PassBuilder &pass)
+    {
+        for (uint32_t cascade = 0; cascade < shadowCascadeCount; cascade++)
+        {
+            pass.sampled(shadowMaps[cascade], VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        }
+    };
+
+    // Mirrored scene and the scene below the surface, for the water shader. Both resolve into the
+    // sampled targets; the MSAA colour/depth they render into are transients that share memory with
+    // each other and with the main pass' colour. Only kept alive if the main pass samples them.
+    // Screen-space reflections replace the mirrored scene with a trace through the refraction pass,
+    // whose depth then outlives the pass (ScreenSpaceReflections.h).
+    const bool traceReflections = useScreenSpaceReflections() && !isUnderwater;
+    // The refraction pass draws the same scene from the same camera as the main pass: at full scale
+    // it renders straight into the main pass' colour and depth, and the main pass loads them and only
+    // adds what lies on top. water.frag reads the refraction at wave-distorted offsets rather than its
+    // own pixel, so it keeps sampling the resolved copy instead of an input attachment. Screen-space
+    // reflections need their own refraction depth for the pyramid and still draw the scene twice.
+    const bool sharedSceneCapture = sharesSceneCapture();
+
+    // Depth pre-pass: the main scene's depth alone, into the main pass' depth (clearing its colour too).
+    // Whichever pass then shades that scene, the refraction pass when shared and the main pass otherwise,
+    // loads both and runs 3d_shader.frag only where a fragment matches the depth already there
+    if (depthPrePass)
+    {
+        auto prePassJobs = makeFrameVector<SecondaryCommandRecorder::RecordJob>(frameArena);
+        appendSceneJobs(prePassJobs, imageIndex, mainView, ScenePass::DepthPrePass);
+        renderGraph->addPass("DepthPrePass", [this, jobs = std::move(prePassJobs)](const RenderGraphPassContext &pass)
+                             { recordPassJobs(pass, jobs); })
+            .color(mainColor, VK_ATTACHMENT_LOAD_OP_CLEAR, clearColor.color)
+            .depth(depth, VK_ATTACHMENT_LOAD_OP_CLEAR)
+            .secondaryContents(secondaryContents)
+            .viewMask(viewMask);
+    }
+    const ScenePass mainScenePass = depthPrePass ? ScenePass::AfterPrePass : ScenePass::Shaded;
+
+    // Async compute: the water simulation, caustics and froxel volume are recorded for the compute
+    // queue, and everything from the first pass reading them on waits for it (AsyncCompute.h). Underwater
+    // the scene shaders sample the caustics and the volume, so only the shadows and the pre-pass overlap
+    const bool asyncFrame = asyncCompute && asyncComputeEnabled;
+    if (asyncFrame && isUnderwater)
+    {
+        renderGraph->splitSubmission();
+    }
+
+    // Ray-query reflections: the scene's acceleration structures brought up to date, traced by the main
+    // pass instead of rendering either offscreen pass (RayQueryScene.h)
+    const bool traceScene = tracesSceneRays();
+    if (traceScene)
+    {
+        renderGraph->addPass("AccelerationStructures", [this, frameIndex = static_cast<uint32_t>(currentFrame)](const RenderGraphPassContext &pass)
+                             { rayQueryScene->recordUpdate(pass.cmd, frameIndex, scene); })
+            .sideEffect();
+    }
+
+    // Throttled, the targets keep an earlier render that water.frag reprojects (OffscreenThrottle.h)
+    if (waterOffscreenPasses && offscreenThrottle.isDue() && !traceScene)
+    {
+        const VkClearColorValue black = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+        // Same scale the frame UBO hands water.frag (updateUniformBuffer)
+        const float renderScale = offscreenThrottle.getScale();
+
+        if (!useScreenSpaceReflections())
+        {
+            auto reflectionJobs = makeFrameVector<SecondaryCommandRecorder::RecordJob>(frameArena);
+            appendSceneJobs(reflectionJobs, imageIndex, reflectionView);
+            RenderGraph::PassBuilder reflectionPass =
+                renderGraph->addPass("Reflection", [this, jobs = std::move(reflectionJobs), renderScale](const RenderGraphPassContext &pass)
+                                     { recordPassJobs(pass, jobs, renderScale); });
+            reflectionPass.color(renderGraph->createImage("ReflectionColor", msaaColorDesc), VK_ATTACHMENT_LOAD_OP_CLEAR, black)
+                .depth(renderGraph->createImage("ReflectionDepth", offscreenDepthDesc), VK_ATTACHMENT_LOAD_OP_CLEAR)
+                .resolve(reflection)
+                .secondaryContents(secondaryContents);
+            sampleShadowMaps(reflectionPass);
+        }
+
+        RenderGraphResource refractionColor = sharedSceneCapture ? mainColor : renderGraph->createImage("RefractionColor", msaaColorDesc);
+        RenderGraphResource refractionDepth = sharedSceneCapture ? depth
+                                              : traceReflections ? screenSpaceReflections->importDepth(*renderGraph)
+                                                                 : renderGraph->createImage("RefractionDepth", offscreenDepthDesc);
+        auto refractionJobs = makeFrameVector<SecondaryCommandRecorder::RecordJob>(frameArena);
+        appendSceneJobs(refractionJobs, imageIndex, refractionHasOwnView() ? refractionView : mainView,
+                        sharedSceneCapture ? mainScenePass : ScenePass::Shaded);
+        RenderGraph::PassBuilder refractionPass =
+            renderGraph->addPass("Refraction", [this, jobs = std::move(refractionJobs), renderScale](const RenderGraphPassContext &pass)
+                                 { recordPassJobs(pass, jobs, renderScale); });
+        const VkAttachmentLoadOp refractionLoadOp = sharedSceneCapture && depthPrePass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        refractionPass.color(refractionColor, refractionLoadOp, sharedSceneCapture ? clearColor.color : black)
+            .depth(refractionDepth, refractionLoadOp)
+            .resolve(refraction)
+            .secondaryContents(secondaryContents);
+        sampleShadowMaps(refractionPass);
+
+        if (traceReflections)
+        {
+            renderGraph->addPass("SsrPyramid", [this](const RenderGraphPassContext &pass)
+                                 { screenSpaceReflections->recordPyramidBuild(pass.cmd); })
+                .sampled(refractionDepth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL)
+                .sideEffect();
+        }
+    }
+
+    // ==============================================================================
+    // FRAME GRAPH: MAIN PASS
+    // ==============================================================================
+    // The pass is built as a list of jobs: recorded into per-thread secondaries when
+    // parallel recording is on, otherwise inline in the same order (recordPassJobs)
+    auto mainPassJobs = makeFrameVector<SecondaryCommandRecorder::RecordJob>(frameArena);
+    const float waterTime = static_cast<float>(simulationTime) * settings.waterSpeed;
+    const uint32_t frameIndex = static_cast<uint32_t>(currentFrame); // Per-frame slot: CDLOD tiles, compare, readback
 
-    commandBuffer.beginRenderPass(renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // Above water the reflection and refraction passes overlap the compute queue as well
+    if (asyncFrame)
+    {
+        renderGraph->splitSubmission();
+    }
 
-    // DEBUG: Verify we're in the correct render pass
-    //  std::cout << "[DEBUG] Main render pass started. renderPass handle: " << renderPass
-    //            << " (should be non-null)\n";
+    // Once per frame, however many passes draw the surface; orders itself against the water draws
+    if (oceanFFT && waterMesh && waterMesh->getValid())
+    {
+        if (asyncFrame)
+        {
+            // Blits need a graphics queue: the mip chain is built once the simulation arrived
+            oceanFFT->recordSimulation(asyncCompute->computeCommands(), waterTime, true);
+            renderGraph->addPass("OceanMips", [this, frameIndex](const RenderGraphPassContext &pass)
+                                 {
+                oceanFFT->recordMipChain(pass.cmd);
+                waterHeights->recordReadback(pass.cmd, frameIndex, *oceanFFT); })
+                .sideEffect();
+        }
+        else
+        {
+            renderGraph->addPass("OceanFFT", [this, waterTime, frameIndex](const RenderGraphPassContext &pass)
+                                 {
+                oceanFFT->recordSimulation(pass.cmd, waterTime);
+                waterHeights->recordReadback(pass.cmd, frameIndex, *oceanFFT); })
+                .sideEffect();
+        }
 
-    // ------------------------------------------------------------------
+        // Only the ocean bottom and the surface seen from below show caustics, and not in BL mode
+        if (computedCaustics && isUnderwater && settings.renderingMode != 0)
+        {
+            const glm::vec3 toSun = glm::normalize(light0Position);
+            if (asyncFrame)
+            {
+                oceanCaustics->recordGeneration(asyncCompute->computeCommands(), toSun, true);
+            }
+            else
+            {
+                renderGraph->addPass("Caustics", [this, toSun](const RenderGraphPassContext &pass)
+                                     { oceanCaustics->recordGeneration(pass.cmd, toSun); })
+                    .sideEffect();
+            }
+        }
+    }
+    // Written from the water job, possibly on a worker thread's secondary buffer, inside the main pass: one
+    // query per view when that pass is multiview
+    const uint32_t waterScope = gpuProfiler->reserveScope("Water", stereoRendering ? Multiview::kViewCount : 1);
+    // Underwater fog and rays rendered at half resolution; the main pass composites the resolved result
+    bool temporalEffects = false;
+    RenderGraphResource temporalResolved = 0;
+    // OPT tier: sunrays at quarter area, added to the resolved frame once the main pass has written depth
+    bool halfResRays = false;
+    RenderGraphResource godRayLowRes = 0;
+    // The full-resolution fog tiles and sunrays at this frame's per-tile rates; the frame then becomes the next one's history
+    bool shadingRateEffects = false;
+    RenderGraphResource shadingRateHistory = 0;
+    // Both branches fill it; only rewritten into this frame's copy if the tuning changed
+    WaterParams waterParams{};
+    waterParams.underwater.waterlineHeight = cameraWaterHeight;
+    // Fog and light shafts integrated once per frame in the froxel volume; BL mode keeps the analytic fog
+    const bool froxelFog = froxelVolumetrics && isUnderwater && settings.renderingMode != 0;
+    if (!froxelFog)
+    {
+        froxelVolume->invalidate();
+    }
+
+    // The fog's tiles for the main view: what the horizon band and the waterline leave of the screen
+    auto addTileClassifyPass = [this]
+    {
+        const glm::mat4 tileView = frameUBO.view;
+        const glm::mat4 tileProjection = frameUBO.proj;
+        const float cameraAboveWater = camera.position.y - cameraWaterHeight;
+        renderGraph->addPass("TileClassify", [this, tileView, tileProjection, cameraAboveWater](const RenderGraphPassContext &pass)
+                             { tileClassifier->recordClassification(pass.cmd, tileView, tileProjection, cameraAboveWater, kCameraNear); })
+            .sideEffect();
+    };
+    // Inside the main pass: the fog full screen, or over the classified tiles one pipeline per class
+    auto recordFog = [this, imageIndex](VkCommandBuffer cmd, UnderwaterWaterPipeline *fog, const WaterPushConstant &push, bool tiled)
+    {
+        // The tile pipelines share the fog's layout: the sets and push constants stay bound across them
+        if (!tiled)
+            fog->bind(cmd);
+        std::array<VkDescriptorSet, 2> effectSets = {descriptorSets[imageIndex], waterDescriptorSet};
+        const std::array<uint32_t, 4> setOffsets = withWaterParamsOffset(mainView.uniformOffsets);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                fog->layout, 0, static_cast<uint32_t>(effectSets.size()),
+                                effectSets.data(), static_cast<uint32_t>(setOffsets.size()), setOffsets.data());
+        vkCmdPushConstants(cmd, fog->layout,
+                           VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                           0, sizeof(WaterPushConstant), &push);
+        if (tiled)
+        {
+            for (TileClassifier::TileClass tileClass : {TileClassifier::TileClass::Waterline, TileClassifier::TileClass::Below})
+            {
+                fog->bindTiles(cmd, tileClass);
+                tileClassifier->recordDraw(cmd, tileClass);
+            }
+        }
+        else
+        {
+            vkCmdDraw(cmd, 3, 1, 0, 0);
+        }
+    };
 
     if (isUnderwater)
     {
@@ -1292,7 +2097,7 @@ void VulkanBase::recordCommandBuffer(CommandBuffer &commandBuffer, uint32_t imag
         bool enableAdvancedEffects = true;
         bool skipOceanBottom = false;
 
-        switch (currentRenderingMode)
+        switch (settings.renderingMode)
         {
         case 0: // BL (Baseline) - Simple performance mode
             qualityMultiplier = 0.4f;
@@ -1309,620 +2114,1512 @@ void VulkanBase::recordCommandBuffer(CommandBuffer &commandBuffer, uint32_t imag
             break;
         }
 
-        // Push constant struct (Aligned to 16 bytes for GPU)
+        // Push constant struct (Aligned to 16 bytes for GPU); the rest goes to the underwater block
         WaterPushConstant underwaterWaterPushData{};
-        underwaterWaterPushData.time = static_cast<float>(glfwGetTime()) * waterSpeed;
+        WaterParamBlock &underwaterParams = waterParams.underwater;
+        underwaterWaterPushData.time = waterTime;
         underwaterWaterPushData.scale = 1.0f;
-        underwaterWaterPushData.renderingMode = static_cast<float>(currentRenderingMode);
-        underwaterWaterPushData.baseColor = glm::vec4(underwaterShallowColor, 1.0f);
-        underwaterWaterPushData.lightColor = glm::vec4(underwaterDeepColor, 1.0f);
+        underwaterWaterPushData.renderingMode = static_cast<float>(settings.renderingMode);
+        underwaterParams.baseColor = glm::vec4(settings.underwaterShallowColor, 1.0f);
+        underwaterParams.lightColor = glm::vec4(settings.underwaterDeepColor, 1.0f);
 
         // Repurpose ambient for chromatic aberration strength
-        underwaterWaterPushData.ambient = chromaticAberrationStrength;
+        underwaterParams.ambient = settings.chromaticAberrationStrength;
         // Repurpose shininess for marine snow size (multiply by 100 to get reasonable range in shader)
-        underwaterWaterPushData.shininess = marineSnowSize * 100.0f;
+        underwaterParams.shininess = settings.marineSnowSize * 100.0f;
 
-        underwaterWaterPushData.causticIntensity = enableAdvancedEffects ? oceanBottomCausticIntensity * qualityMultiplier : 0.0f;
-        underwaterWaterPushData.distortionStrength = waterDistortionStrength * (enableAdvancedEffects ? 1.0f : 0.5f);
+        underwaterParams.causticIntensity = enableAdvancedEffects ? settings.oceanBottomCausticIntensity * qualityMultiplier : 0.0f;
+        underwaterParams.distortionStrength = settings.waterDistortionStrength * (enableAdvancedEffects ? 1.0f : 0.5f);
         // Respect user setting; allow zero intensity to truly disable rays
-        underwaterWaterPushData.godRayIntensity = underwaterGodRayIntensity * qualityMultiplier;
+        underwaterParams.godRayIntensity = settings.underwaterGodRayIntensity * qualityMultiplier;
 
         // Repurpose scatteringIntensity for marine snow intensity
-        underwaterWaterPushData.scatteringIntensity = marineSnowIntensity * qualityMultiplier;
+        underwaterParams.scatteringIntensity = settings.marineSnowIntensity * qualityMultiplier;
 
         // Underwater volumetric strength (do not clamp; user may want subtle fog)
-        underwaterWaterPushData.opacity = underwaterOpacity;
-        underwaterWaterPushData.fogDensity = underwaterFogDensity * (enableAdvancedEffects ? 1.0f : 0.7f);
+        underwaterParams.opacity = settings.underwaterOpacity;
+        underwaterParams.fogDensity = settings.underwaterFogDensity * (enableAdvancedEffects ? 1.0f : 0.7f);
+        underwaterParams.sceneFog = 1.0f;
         // God-ray tuning with performance adjustments
-        underwaterWaterPushData.godExposure = godExposure * qualityMultiplier;
-        underwaterWaterPushData.godDecay = currentRenderingMode == 0 ? 0.98f : godDecay; // Faster decay for baseline
-        underwaterWaterPushData.godDensity = godDensity * qualityMultiplier;
-        underwaterWaterPushData.godSampleScale = godSampleScale * (currentRenderingMode == 0 ? 0.5f : 1.0f);
+        underwaterParams.godExposure = settings.godExposure * qualityMultiplier;
+        underwaterParams.godDecay = settings.renderingMode == 0 ? 0.98f : settings.godDecay; // Faster decay for baseline
+        underwaterParams.godDensity = settings.godDensity * qualityMultiplier;
+        underwaterParams.godSampleScale = settings.godSampleScale * (settings.renderingMode == 0 ? 0.5f : 1.0f);
+        // The map covers one ocean patch, sampled by world xz
+        underwaterParams.causticMapScale = computedCaustics ? 1.0f / OceanFFT::kPatchSize : 0.0f;
 
         // Debug flags encoded in debugRays: 0=off, 1=rays, 2=snow, 3=both, 4+=chromatic
         float debugValue = 0.0f;
-        if (showDebugRays)
+        if (settings.showDebugRays)
             debugValue = 1.0f;
-        if (showMarineSnowDebug)
+        if (settings.showMarineSnowDebug)
             debugValue = 2.0f;
-        if (showDebugRays && showMarineSnowDebug)
+        if (settings.showDebugRays && settings.showMarineSnowDebug)
             debugValue = 3.0f;
-        if (showChromaticDebug)
+        if (settings.showChromaticDebug)
             debugValue = 4.0f;
         underwaterWaterPushData.debugRays = debugValue;
-
-        // 1. Draw ocean bottom first (skip for baseline mode for performance)
-        if (!skipOceanBottom)
+        selectWaterVariants(static_cast<uint32_t>(settings.renderingMode), static_cast<uint32_t>(debugValue));
+
+        WaterPushConstant waterData{};
+        WaterParamBlock &surfaceParams = waterParams.surface;
+        waterData.time = waterTime;
+        waterData.scale = 1.0f;
+        waterData.renderingMode = static_cast<float>(settings.renderingMode);
+        surfaceParams.baseColor = glm::vec4(settings.waterBaseColor, 1.0f);
+        surfaceParams.lightColor = glm::vec4(settings.waterLightColor, 1.0f);
+        surfaceParams.ambient = settings.waterAmbient;
+        surfaceParams.shininess = settings.waterShininess;
+        surfaceParams.causticIntensity = enableAdvancedEffects ? settings.waterCausticIntensity * qualityMultiplier : 0.0f;
+        surfaceParams.distortionStrength = settings.waterDistortionStrength * (enableAdvancedEffects ? 1.0f : 0.6f);
+        surfaceParams.godRayIntensity = 0.0f;
+        surfaceParams.scatteringIntensity = 0.0f;
+        surfaceParams.opacity = settings.waterSurfaceOpacity;
+        surfaceParams.fogDensity = settings.underwaterFogDensity; // used for underside absorption
+        waterData.debugRays = 0.0f;
+        surfaceParams.godExposure = settings.godExposure;
+        surfaceParams.godDecay = settings.godDecay;
+        surfaceParams.godDensity = settings.godDensity;
+        surfaceParams.godSampleScale = settings.godSampleScale;
+        surfaceParams.causticMapScale = underwaterParams.causticMapScale; // getCaustics on the underside
+
+        if (froxelFog)
         {
-            vkCmdBindPipeline(commandBuffer.getVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+            FroxelVolume::Medium medium{};
+            medium.toSun = glm::normalize(light0Position);
+            medium.extinction = underwaterParams.fogDensity;
+            medium.ambient = settings.underwaterDeepColor; // What the analytic fog fades to
+            // HG at g = 0.6 peaks at 10x isotropic looking into the sun
+            medium.sunRadiance = glm::vec3(0.6f, 0.85f, 1.0f) * underwaterParams.godRayIntensity * 0.25f;
+            medium.causticMapScale = underwaterParams.causticMapScale;
+            medium.receiverDepth = oceanCaustics->getReceiverDepth();
+            froxelVolume->update(frameIndex, frameUBO.view, glm::radians(camera.zoom), viewExtent.width / (float)viewExtent.height, medium);
+
+            if (asyncFrame)
+            {
+                froxelVolume->recordVolume(asyncCompute->computeCommands(), frameIndex, true);
+            }
+            else
+            {
+                renderGraph->addPass("FroxelVolume", [this, frameIndex](const RenderGraphPassContext &pass)
+                                     { froxelVolume->recordVolume(pass.cmd, frameIndex); })
+                    .sideEffect();
+            }
 
-            std::array<VkDescriptorSet, 2> oceanBottomSets = {descriptorSets[imageIndex], waterDescriptorSet};
-            vkCmdBindDescriptorSets(commandBuffer.getVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    pipelineLayout, 0, 2, oceanBottomSets.data(), 0, nullptr);
+            underwaterParams.froxelNear = FroxelVolume::kNear;
+            underwaterParams.froxelDepthScale = FroxelVolume::getDepthScale();
+            surfaceParams.froxelNear = underwaterParams.froxelNear; // The underside's fog
+            surfaceParams.froxelDepthScale = underwaterParams.froxelDepthScale;
+        }
 
-            vkCmdPushConstants(commandBuffer.getVkCommandBuffer(), pipelineLayout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0, sizeof(WaterPushConstant), &underwaterWaterPushData);
+        // Marine snow as particles around the camera, simulated here and drawn after the water effects.
+        // BL mode never had snow
+        const bool snowParticles = settings.marineSnowParticles && settings.renderingMode != 0 && underwaterParams.scatteringIntensity > 0.01f;
+        MarineSnow::Appearance snowAppearance{};
+        if (snowParticles)
+        {
+            marineSnow->setParticleCount(static_cast<uint32_t>(settings.marineSnowIntensity * 16384.0f));
+            snowAppearance.color *= underwaterParams.scatteringIntensity * 0.8f;
+            snowAppearance.size *= settings.marineSnowSize;
+            snowAppearance.fogDensity = underwaterParams.fogDensity;
+
+            const glm::vec3 cameraPos = camera.position;
+            const float snowTime = static_cast<float>(simulationTime);
+            const float drift = settings.marineSnowSpeed;
+            renderGraph->addPass("MarineSnow", [this, cameraPos, snowTime, drift](const RenderGraphPassContext &pass)
+                                 { marineSnow->recordSimulation(pass.cmd, cameraPos, snowTime, drift); })
+                .sideEffect();
+
+            underwaterParams.snowParticles = 1.0f;
+        }
+
+        // Jobs may run on worker threads after this scope: capture by value
+        // 1. Draw ocean bottom first (skip for baseline mode for performance)
+        if (!skipOceanBottom)
+        {
+            mainPassJobs.push_back([this, imageIndex, frameIndex, underwaterWaterPushData](VkCommandBuffer cmd)
+                                   {
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, oceanBottomPipeline);
+
+                std::array<VkDescriptorSet, 2> oceanBottomSets = {descriptorSets[imageIndex], waterDescriptorSet};
+                const std::array<uint32_t, 4> setOffsets = withWaterParamsOffset(mainView.uniformOffsets);
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        pipelineLayout, 0, 2, oceanBottomSets.data(), static_cast<uint32_t>(setOffsets.size()), setOffsets.data());
+
+                vkCmdPushConstants(cmd, pipelineLayout,
+                                   VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   0, sizeof(WaterPushConstant), &underwaterWaterPushData);
+                bindMaterialTable(cmd);
+                bindShadowSet(cmd);
+
+                oceanBottomMesh->draw(cmd, frameIndex); });
+        }
 
-            oceanBottomMesh->draw(commandBuffer.getVkCommandBuffer());
+        // 2. Draw scene objects, unless the refraction pass already did
+        if (!sharedSceneCapture)
+        {
+            appendSceneJobs(mainPassJobs, imageIndex, mainView, mainScenePass);
         }
 
-        // 2. Draw scene objects
-        this->DrawSceneObjects(commandBuffer, imageIndex);
+        // 4-5. Volumetric fog (alpha blended) then god rays (additive), full-screen over what the pass holds
+        // The froxel volume replaces the fog overlay; sunrays.frag then only draws marine snow
+        const bool drawUnderwaterFog = !froxelFog && (enableAdvancedEffects || settings.renderingMode == 0);
+        // With the froxel volume and particles both on, the sunrays pass would have nothing left to draw
+        const bool drawGodRays = settings.underwaterGodRayIntensity > 0.01f && !(froxelFog && snowParticles);
 
-        // 3. Draw Water Surface (always use the water surface shader)
-        if (waterPipeline && waterMesh && waterMesh->getValid())
+        // The fog only over the tiles below or across the waterline, one pipeline per class
+        const bool tiledFog = tiledEffects && drawUnderwaterFog;
+        if (tiledFog)
         {
-            waterPipeline->bind(commandBuffer.getVkCommandBuffer());
+            addTileClassifyPass();
+        }
 
-            std::array<VkDescriptorSet, 2> waterSets = {descriptorSets[imageIndex], waterDescriptorSet};
-            vkCmdBindDescriptorSets(commandBuffer.getVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    waterPipeline->layout, 0, static_cast<uint32_t>(waterSets.size()),
-                                    waterSets.data(), 0, nullptr);
-
-            WaterPushConstant waterData{};
-            waterData.time = static_cast<float>(glfwGetTime()) * waterSpeed;
-            waterData.scale = 1.0f;
-            waterData.renderingMode = static_cast<float>(currentRenderingMode);
-            waterData.baseColor = glm::vec4(waterBaseColor, 1.0f);
-            waterData.lightColor = glm::vec4(waterLightColor, 1.0f);
-            waterData.ambient = waterAmbient;
-            waterData.shininess = waterShininess;
-            waterData.causticIntensity = enableAdvancedEffects ? waterCausticIntensity * qualityMultiplier : 0.0f;
-            waterData.distortionStrength = waterDistortionStrength * (enableAdvancedEffects ? 1.0f : 0.6f);
-            waterData.godRayIntensity = 0.0f;
-            waterData.scatteringIntensity = 0.0f;
-            waterData.opacity = waterSurfaceOpacity;
-            waterData.fogDensity = underwaterFogDensity; // used for underside absorption
-            waterData.debugRays = 0.0f;
-            waterData.godExposure = godExposure;
-            waterData.godDecay = godDecay;
-            waterData.godDensity = godDensity;
-            waterData.godSampleScale = godSampleScale;
-
-            vkCmdPushConstants(commandBuffer.getVkCommandBuffer(), waterPipeline->layout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0, sizeof(WaterPushConstant), &waterData);
+        // selectWaterVariants gave the full-resolution sunrays their tile-grid variant
+        const bool rateGrid = variableRateShading && shadingRates;
+        auto recordUnderwaterEffects = [this, imageIndex, underwaterWaterPushData, tiledFog, rateGrid, recordFog](VkCommandBuffer cmd, UnderwaterWaterPipeline *fog, WaterPipeline *rays)
+        {
+            if (fog)
+            {
+                recordFog(cmd, fog, underwaterWaterPushData, tiledFog);
+            }
+            if (rays)
+            {
+                std::array<VkDescriptorSet, 2> effectSets = {descriptorSets[imageIndex], waterDescriptorSet};
+                const std::array<uint32_t, 4> setOffsets = withWaterParamsOffset(mainView.uniformOffsets);
+                rays->bind(cmd);
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        rays->layout, 0, static_cast<uint32_t>(effectSets.size()),
+                                        effectSets.data(), static_cast<uint32_t>(setOffsets.size()), setOffsets.data());
+                vkCmdPushConstants(cmd, rays->layout,
+                                   VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   0, sizeof(WaterPushConstant), &underwaterWaterPushData);
+                if (rateGrid && rays == sunraysPipeline.get())
+                    shadingRates->recordGridDraw(cmd);
+                else
+                    vkCmdDraw(cmd, 3, 1, 0, 0);
+            }
+        };
 
-            waterMesh->draw(commandBuffer.getVkCommandBuffer());
+        // Jittered half-res copy of both effects, resolved against last frame's result (TemporalUpscaler.h)
+        temporalEffects = temporalUnderwaterEffects && temporalUpscaler && (drawUnderwaterFog || drawGodRays);
+        if (temporalEffects)
+        {
+            temporalUpscaler->beginFrame(viewProjection);
+            RenderGraphResource lowRes = temporalUpscaler->importLowRes(*renderGraph);
+            RenderGraphResource history = temporalUpscaler->importHistory(*renderGraph);
+            temporalResolved = temporalUpscaler->importResolved(*renderGraph);
+
+            UnderwaterWaterPipeline *fog = drawUnderwaterFog ? lowResUnderwaterPipeline.get() : nullptr;
+            WaterPipeline *rays = drawGodRays ? lowResSunraysPipeline.get() : nullptr;
+            renderGraph->addPass("UnderwaterEffects", [this, recordUnderwaterEffects, fog, rays](const RenderGraphPassContext &pass)
+                                 {
+                temporalUpscaler->setLowResViewport(pass.cmd);
+                recordUnderwaterEffects(pass.cmd, fog, rays); })
+                .color(lowRes, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.0f, 0.0f, 0.0f, 0.0f}});
+
+            renderGraph->addPass("TemporalResolve", [this](const RenderGraphPassContext &pass)
+                                 { temporalUpscaler->recordResolve(pass.cmd); })
+                .sampled(lowRes, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+                .sampled(history, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_IMAGE_LAYOUT_GENERAL)
+                .storage(temporalResolved, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, true);
         }
 
-        // 4. Underwater volumetric fog/scattering pass (fullscreen, alpha blended)
-        if (underwaterWaterPipeline && (enableAdvancedEffects || currentRenderingMode == 0))
+        halfResRays = !temporalEffects && halfResGodRays && settings.renderingMode == 2 && drawGodRays &&
+                      godRayUpsampler && godRayUpsampler->isAvailable();
+        if (halfResRays)
         {
-            underwaterWaterPipeline->bind(commandBuffer.getVkCommandBuffer());
-            std::array<VkDescriptorSet, 2> uwSets = {descriptorSets[imageIndex], waterDescriptorSet};
-            vkCmdBindDescriptorSets(commandBuffer.getVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    underwaterWaterPipeline->layout, 0, static_cast<uint32_t>(uwSets.size()),
-                                    uwSets.data(), 0, nullptr);
-            vkCmdPushConstants(commandBuffer.getVkCommandBuffer(), underwaterWaterPipeline->layout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0, sizeof(WaterPushConstant), &underwaterWaterPushData);
-            vkCmdDraw(commandBuffer.getVkCommandBuffer(), 3, 1, 0, 0);
+            godRayLowRes = godRayUpsampler->importLowRes(*renderGraph);
+            WaterPipeline *rays = lowResSunraysPipeline.get();
+            renderGraph->addPass("GodRaysHalfRes", [recordUnderwaterEffects, rays](const RenderGraphPassContext &pass)
+                                 {
+                SecondaryCommandRecorder::setViewport(pass.cmd, pass.extent);
+                recordUnderwaterEffects(pass.cmd, nullptr, rays); })
+                .color(godRayLowRes, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.0f, 0.0f, 0.0f, 0.0f}});
         }
 
-        // 5. God rays pass (fullscreen additive) - Quality based on mode
-        if (sunraysPipeline && underwaterGodRayIntensity > 0.01f)
+        // Rates for what the main pass draws at full resolution: the fog's tiles and the sunrays
+        shadingRateEffects = rateGrid && !temporalEffects && (tiledFog || (drawGodRays && !halfResRays));
+        if (shadingRateEffects)
         {
-            sunraysPipeline->bind(commandBuffer.getVkCommandBuffer());
-            std::array<VkDescriptorSet, 2> sunraySets = {descriptorSets[imageIndex], waterDescriptorSet};
-            vkCmdBindDescriptorSets(commandBuffer.getVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    sunraysPipeline->layout, 0, static_cast<uint32_t>(sunraySets.size()),
-                                    sunraySets.data(), 0, nullptr);
-            vkCmdPushConstants(commandBuffer.getVkCommandBuffer(), sunraysPipeline->layout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0, sizeof(WaterPushConstant), &underwaterWaterPushData);
-            vkCmdDraw(commandBuffer.getVkCommandBuffer(), 3, 1, 0, 0);
+            const glm::mat4 rateView = frameUBO.view;
+            const glm::mat4 rateProjection = frameUBO.proj;
+            const float depthBelowSurface = std::max(0.0f, -camera.position.y);
+            // The slowest wavelength's absorption in underwater_water.frag, which leaves the most showing
+            const float fogAbsorption = settings.renderingMode == 0 ? 0.08f * underwaterParams.fogDensity
+                                                                  : 0.03f * underwaterParams.fogDensity * (settings.renderingMode == 1 ? 1.2f : 1.0f);
+            shadingRateHistory = shadingRates->importHistory(*renderGraph);
+            renderGraph->addPass("ShadingRate", [this, rateView, rateProjection, depthBelowSurface, fogAbsorption](const RenderGraphPassContext &pass)
+                                 { shadingRates->recordRates(pass.cmd, rateView, rateProjection, depthBelowSurface, fogAbsorption); })
+                .sampled(shadingRateHistory, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+                .sideEffect();
         }
+
+        // 3-5. Water surface, then the effects or their resolved composite: a handful of draws, kept in one job
+        mainPassJobs.push_back([this, imageIndex, frameIndex, waterData, recordUnderwaterEffects, drawUnderwaterFog, drawGodRays, temporalEffects, halfResRays, waterScope,
+                                snowParticles, snowAppearance, snowView = frameUBO.view, snowProjection = frameUBO.proj](VkCommandBuffer cmd)
+                               {
+            gpuProfiler->writeBegin(cmd, waterScope);
+
+            // 3. Draw Water Surface (always use the water surface shader)
+            WaterPipeline *surface = getWaterSurfacePipeline();
+            if (surface && waterMesh && waterMesh->getValid())
+            {
+                surface->bind(cmd);
+
+                std::array<VkDescriptorSet, 2> waterSets = {descriptorSets[imageIndex], waterDescriptorSet};
+                const std::array<uint32_t, 4> setOffsets = withWaterParamsOffset(mainView.uniformOffsets);
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        surface->layout, 0, static_cast<uint32_t>(waterSets.size()),
+                                        waterSets.data(), static_cast<uint32_t>(setOffsets.size()), setOffsets.data());
+
+                vkCmdPushConstants(cmd, surface->layout,
+                                   VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   0, sizeof(WaterPushConstant), &waterData);
+
+                waterMesh->draw(cmd, frameIndex);
+            }
+
+            if (temporalEffects)
+            {
+                temporalUpscaler->recordComposite(cmd);
+            }
+            else
+            {
+                recordUnderwaterEffects(cmd, drawUnderwaterFog ? underwaterWaterPipeline.get() : nullptr,
+                                        drawGodRays && !halfResRays ? sunraysPipeline.get() : nullptr);
+            }
+
+            if (snowParticles)
+            {
+                marineSnow->recordDraw(cmd, snowView, snowProjection, snowAppearance);
+            }
+
+            gpuProfiler->writeEnd(cmd, waterScope); });
     }
     else
     {
         // === ABOVE WATER RENDERING ===
 
-        // 1. Draw Scene
-        this->DrawSceneObjects(commandBuffer, imageIndex);
+        // 1. Draw Scene, unless the refraction pass already did
+        if (!sharedSceneCapture)
+        {
+            appendSceneJobs(mainPassJobs, imageIndex, mainView, mainScenePass);
+        }
 
         // 2. Draw Water Surface (skip if mesh is invalid during resize)
-        if (waterPipeline && waterMesh && waterMesh->getValid())
+        // The surface has always shaded above water as BL: renderingMode is left at 0 below
+        selectWaterVariants(0, 0, false);
+        // The underwater block stays zeroed but for the waterline's fog: no fog or caustics on the scene above the surface
+        WaterPushConstant waterData{};
+        WaterParamBlock &surfaceParams = waterParams.surface;
+        waterData.time = waterTime;
+        waterData.scale = 1.0f;
+        surfaceParams.baseColor = glm::vec4(settings.waterBaseColor, 1.0f);
+        surfaceParams.lightColor = glm::vec4(settings.waterLightColor, 1.0f);
+        surfaceParams.ambient = settings.waterAmbient;
+        surfaceParams.shininess = settings.waterShininess;
+        surfaceParams.causticIntensity = settings.waterCausticIntensity;
+        surfaceParams.distortionStrength = settings.waterDistortionStrength;
+        surfaceParams.godRayIntensity = 0.0f;
+        surfaceParams.scatteringIntensity = 0.0f;
+        surfaceParams.opacity = settings.waterSurfaceOpacity;
+        surfaceParams.fogDensity = 0.0f;
+        waterData.debugRays = settings.showDebugRays ? 1.0f : 0.0f;
+        // Above-water god-ray tuning
+        surfaceParams.godExposure = settings.godExposure;
+        surfaceParams.godDecay = settings.godDecay;
+        surfaceParams.godDensity = settings.godDensity;
+        surfaceParams.godSampleScale = settings.godSampleScale;
+
+        // 3. With the near plane across the surface, the part of the screen in the water gets the
+        // underwater fog, as BL draws it; the rest skips it, and the scene stays unfogged (sceneFog 0)
+        const bool waterlineFog = cameraCrossesWaterline() && underwaterWaterPipeline;
+        WaterPushConstant waterlineFogData{};
+        if (waterlineFog)
         {
-            waterPipeline->bind(commandBuffer.getVkCommandBuffer());
+            WaterParamBlock &underwaterParams = waterParams.underwater;
+            underwaterParams.baseColor = glm::vec4(settings.underwaterShallowColor, 1.0f);
+            underwaterParams.lightColor = glm::vec4(settings.underwaterDeepColor, 1.0f);
+            underwaterParams.opacity = settings.underwaterOpacity;
+            underwaterParams.fogDensity = settings.underwaterFogDensity * 0.7f;
+            waterlineFogData.time = waterTime;
+            waterlineFogData.scale = 1.0f;
+            if (tiledEffects)
+            {
+                addTileClassifyPass();
+            }
+        }
+
+        mainPassJobs.push_back([this, imageIndex, frameIndex, waterData, waterScope, waterlineFog, waterlineFogData, recordFog,
+                                tiledFog = tiledEffects](VkCommandBuffer cmd)
+                               {
+            WaterPipeline *surface = getWaterSurfacePipeline();
+            if (!surface || !waterMesh || !waterMesh->getValid())
+                return; // Scope left unwritten: dropped at readback
+
+            gpuProfiler->writeBegin(cmd, waterScope);
+            surface->bind(cmd);
 
             std::array<VkDescriptorSet, 2> waterSets = {descriptorSets[imageIndex], waterDescriptorSet};
-            vkCmdBindDescriptorSets(commandBuffer.getVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    waterPipeline->layout, 0, static_cast<uint32_t>(waterSets.size()),
-                                    waterSets.data(), 0, nullptr);
-
-            WaterPushConstant waterData{};
-            waterData.time = static_cast<float>(glfwGetTime()) * waterSpeed;
-            waterData.scale = 1.0f;
-            waterData.baseColor = glm::vec4(waterBaseColor, 1.0f);
-            waterData.lightColor = glm::vec4(waterLightColor, 1.0f);
-            waterData.ambient = waterAmbient;
-            waterData.shininess = waterShininess;
-            waterData.causticIntensity = waterCausticIntensity;
-            waterData.distortionStrength = waterDistortionStrength;
-            waterData.godRayIntensity = 0.0f;
-            waterData.scatteringIntensity = 0.0f;
-            waterData.opacity = waterSurfaceOpacity;
-            waterData.fogDensity = 0.0f;
-            waterData.debugRays = showDebugRays ? 1.0f : 0.0f;
-            // Above-water god-ray tuning (kept in push constants too)
-            waterData.godExposure = godExposure;
-            waterData.godDecay = godDecay;
-            waterData.godDensity = godDensity;
-            waterData.godSampleScale = godSampleScale;
-
-            vkCmdPushConstants(commandBuffer.getVkCommandBuffer(), waterPipeline->layout,
+            const std::array<uint32_t, 4> setOffsets = withWaterParamsOffset(mainView.uniformOffsets);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    surface->layout, 0, static_cast<uint32_t>(waterSets.size()),
+                                    waterSets.data(), static_cast<uint32_t>(setOffsets.size()), setOffsets.data());
+
+            vkCmdPushConstants(cmd, surface->layout,
                                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
                                0, sizeof(WaterPushConstant), &waterData);
 
-            waterMesh->draw(commandBuffer.getVkCommandBuffer());
-        }
+            waterMesh->draw(cmd, frameIndex);
+            if (waterlineFog)
+            {
+                recordFog(cmd, underwaterWaterPipeline.get(), waterlineFogData, tiledFog);
+            }
+            gpuProfiler->writeEnd(cmd, waterScope); });
+    }
+
+    // A pass replay holds every frame to the captured tuning
+    if (passReplay)
+    {
+        waterParams = passReplay->getCapture().waterParams;
     }
+    frameWaterParams = waterParams;
+    // The jobs above read the offset when they record
+    waterParamsOffset = waterParamsBuffer->update(frameIndex, waterParams);
 
-    // End render pass before ImGui setup (shared for both underwater and above water)
-    commandBuffer.endRenderPass();
-
-    // Now setup ImGui frame (outside of render pass)
-    ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
-
-    // =========================================================================
-    // COLLAPSIBLE PANEL STATE & ANIMATION
-    // =========================================================================
-    static bool panelOpen = true;
-    static float panelAnim = 1.0f;
-    static bool keyPressed = false;
-    const float PANEL_WIDTH = 260.0f;
-    const float COLLAPSED_WIDTH = 42.0f;
-
-    // Toggle with ` key (grave accent / tilde)
-    if (glfwGetKey(window, GLFW_KEY_GRAVE_ACCENT) == GLFW_PRESS && !keyPressed)
-    {
-        panelOpen = !panelOpen;
-        keyPressed = true;
-    }
-    if (glfwGetKey(window, GLFW_KEY_GRAVE_ACCENT) == GLFW_RELEASE)
-        keyPressed = false;
-
-    // Smooth animation
-    float target = panelOpen ? 1.0f : 0.0f;
-    panelAnim += (target - panelAnim) * ImGui::GetIO().DeltaTime * 12.0f;
-    float ease = panelAnim * panelAnim * (3.0f - 2.0f * panelAnim);
-    float currentWidth = COLLAPSED_WIDTH + (PANEL_WIDTH - COLLAPSED_WIDTH) * ease;
-
-    // =========================================================================
-    // MODERN DARK THEME
-    // =========================================================================
-    ImGuiStyle &style = ImGui::GetStyle();
-    style.WindowRounding = 0.0f;
-    style.FrameRounding = 6.0f;
-    style.GrabRounding = 6.0f;
-    style.ScrollbarRounding = 6.0f;
-    style.TabRounding = 6.0f;
-    style.WindowPadding = ImVec2(12, 10);
-    style.FramePadding = ImVec2(10, 5);
-    style.ItemSpacing = ImVec2(8, 5);
-    style.ScrollbarSize = 10.0f;
-    style.GrabMinSize = 10.0f;
-
-    // Colors
-    ImVec4 bg = ImVec4(0.07f, 0.07f, 0.09f, 0.97f);
-    ImVec4 bgLight = ImVec4(0.12f, 0.12f, 0.15f, 1.0f);
-    ImVec4 accent = ImVec4(0.40f, 0.70f, 1.0f, 1.0f);
-    ImVec4 accentDim = ImVec4(0.25f, 0.50f, 0.80f, 0.7f);
-    ImVec4 text = ImVec4(0.92f, 0.92f, 0.94f, 1.0f);
-    ImVec4 textDim = ImVec4(0.50f, 0.50f, 0.55f, 1.0f);
-    ImVec4 green = ImVec4(0.35f, 0.90f, 0.50f, 1.0f);
-    ImVec4 yellow = ImVec4(1.0f, 0.85f, 0.35f, 1.0f);
-
-    ImGui::PushStyleColor(ImGuiCol_WindowBg, bg);
-    ImGui::PushStyleColor(ImGuiCol_Border, ImVec4(0.2f, 0.2f, 0.25f, 0.5f));
-    ImGui::PushStyleColor(ImGuiCol_Text, text);
-    ImGui::PushStyleColor(ImGuiCol_TextDisabled, textDim);
-    ImGui::PushStyleColor(ImGuiCol_FrameBg, bgLight);
-    ImGui::PushStyleColor(ImGuiCol_FrameBgHovered, ImVec4(0.18f, 0.18f, 0.22f, 1.0f));
-    ImGui::PushStyleColor(ImGuiCol_FrameBgActive, accentDim);
-    ImGui::PushStyleColor(ImGuiCol_Header, bgLight);
-    ImGui::PushStyleColor(ImGuiCol_HeaderHovered, accentDim);
-    ImGui::PushStyleColor(ImGuiCol_HeaderActive, accent);
-    ImGui::PushStyleColor(ImGuiCol_Button, bgLight);
-    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, accentDim);
-    ImGui::PushStyleColor(ImGuiCol_ButtonActive, accent);
-    ImGui::PushStyleColor(ImGuiCol_SliderGrab, accent);
-    ImGui::PushStyleColor(ImGuiCol_SliderGrabActive, ImVec4(0.55f, 0.80f, 1.0f, 1.0f));
-    ImGui::PushStyleColor(ImGuiCol_CheckMark, accent);
-    ImGui::PushStyleColor(ImGuiCol_Tab, ImVec4(0, 0, 0, 0));
-    ImGui::PushStyleColor(ImGuiCol_TabHovered, accentDim);
-    ImGui::PushStyleColor(ImGuiCol_TabActive, accent);
-    ImGui::PushStyleColor(ImGuiCol_Separator, ImVec4(0.25f, 0.25f, 0.30f, 0.5f));
-    ImGui::PushStyleColor(ImGuiCol_ScrollbarBg, ImVec4(0, 0, 0, 0));
-    ImGui::PushStyleColor(ImGuiCol_ScrollbarGrab, bgLight);
-    ImGui::PushStyleColor(ImGuiCol_PlotHistogram, accent);
-    const int COLOR_COUNT = 23;
-
-    ImGui::SetNextWindowPos(ImVec2(0, 0));
-    ImGui::SetNextWindowSize(ImVec2(currentWidth, ImGui::GetIO().DisplaySize.y));
-
-    ImGui::Begin("##Panel", nullptr,
-                 ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize |
-                     ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse);
-
-    // =========================================================================
-    // HEADER WITH TOGGLE
-    // =========================================================================
-    {
-        // Toggle button
-        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0, 0, 0, 0));
-        if (ImGui::Button(panelOpen ? "<<" : ">>", ImVec2(28, 28)))
+    // Shared for both underwater and above water
+    RenderGraph::PassBuilder mainPass = renderGraph->addPass("Main", [this, jobs = std::move(mainPassJobs)](const RenderGraphPassContext &pass)
+                                                             { recordPassJobs(pass, jobs); });
+    // Continues on the refraction pass' scene when it was shared, on the pre-pass' depth otherwise
+    const VkAttachmentLoadOp mainLoadOp = sharedSceneCapture || depthPrePass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    RenderGraphResource stereoFrame = 0;
+    if (stereoRendering)
+    {
+        RenderGraphImageDesc stereoDesc{colorFormat, viewExtent, VK_SAMPLE_COUNT_1_BIT,
+                                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, viewLayers};
+        stereoFrame = renderGraph->createImage("StereoFrame", stereoDesc);
+    }
+    mainPass.color(mainColor, mainLoadOp, clearColor.color)
+        .depth(depth, mainLoadOp)
+        .resolve(stereoRendering ? stereoFrame : swapchain)
+        .secondaryContents(secondaryContents)
+        .viewMask(viewMask);
+    sampleShadowMaps(mainPass);
+    if (temporalEffects)
+    {
+        mainPass.sampled(temporalResolved, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    else if (temporalUpscaler)
+    {
+        temporalUpscaler->resetHistory();
+    }
+    if (waterOffscreenPasses && !traceScene)
+    {
+        // No reflection from below the surface: culling the reflection pass underwater follows from this
+        mainPass.sampled(refraction, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        if (!isUnderwater && !useScreenSpaceReflections())
         {
-            panelOpen = !panelOpen;
+            mainPass.sampled(reflection, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
         }
-        ImGui::PopStyleColor();
+    }
 
-        if (panelOpen && ease > 0.5f)
-        {
-            ImGui::SameLine();
-            ImGui::PushStyleColor(ImGuiCol_Text, accent);
-            ImGui::Text("XeRender");
-            ImGui::PopStyleColor();
+    // The eyes side by side, left eye on the left; an odd frame width leaves its last column out
+    if (stereoRendering)
+    {
+        renderGraph->addPass("StereoCompose", [this, stereoFrame, swapchainImage = swapChainManager->getSwapChainImages()[imageIndex], viewExtent](const RenderGraphPassContext &pass)
+                             {
+            std::array<VkImageCopy, Multiview::kViewCount> regions{};
+            for (uint32_t eye = 0; eye < Multiview::kViewCount; eye++)
+            {
+                regions[eye].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, eye, 1};
+                regions[eye].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                regions[eye].dstOffset = {static_cast<int32_t>(eye * viewExtent.width), 0, 0};
+                regions[eye].extent = {viewExtent.width, viewExtent.height, 1};
+            }
+            vkCmdCopyImage(pass.cmd, renderGraph->getImage(stereoFrame), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           swapchainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data()); })
+            .transferSource(stereoFrame)
+            .transferDestination(swapchain);
+    }
 
-            ImGui::SameLine(currentWidth - 70);
-            float fps = (isBenchmarkActive || isTestModeActive) && gpuSyncedFrameTimeMs > 0
-                            ? static_cast<float>(1000.0 / gpuSyncedFrameTimeMs)
-                            : ImGui::GetIO().Framerate;
-            ImGui::PushStyleColor(ImGuiCol_Text, (isBenchmarkActive || isTestModeActive) ? green : textDim);
-            ImGui::Text("%.0f", fps);
-            ImGui::PopStyleColor();
-        }
+    // Additive, so adding to the resolved frame matches adding to the samples before the resolve
+    if (halfResRays)
+    {
+        const glm::mat4 projection = frameUBO.proj;
+        renderGraph->addPass("GodRayUpsample", [this, projection](const RenderGraphPassContext &pass)
+                             {
+            SecondaryCommandRecorder::setViewport(pass.cmd, pass.extent);
+            godRayUpsampler->recordUpsample(pass.cmd, projection); })
+            .color(swapchain, VK_ATTACHMENT_LOAD_OP_LOAD)
+            .sampled(godRayLowRes, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
+            .sampled(depth, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    }
+
+    // Next frame's rates read this frame's contrast, once the effects are in it
+    if (shadingRateEffects && shadingRates->canCaptureHistory())
+    {
+        renderGraph->addPass("ShadingRateHistory", [this, swapchainImage = swapChainManager->getSwapChainImages()[imageIndex]](const RenderGraphPassContext &pass)
+                             { shadingRates->recordHistory(pass.cmd, swapchainImage); })
+            .transferSource(swapchain)
+            .transferDestination(shadingRateHistory)
+            .sideEffect();
+    }
+    else if (shadingRates)
+    {
+        shadingRates->resetHistory();
     }
 
-    // Only render content when panel is mostly open
-    if (ease > 0.3f)
+    // Next frame's occlusion test reads this frame's depth
+    if (mainView.gpuDriven && gpuOcclusionCulling && gpuCulling->isHiZAvailable())
     {
-        ImGui::Spacing();
-        ImGui::Separator();
-        ImGui::Spacing();
+        renderGraph->addPass("HiZ", [this, viewProjection](const RenderGraphPassContext &pass)
+                             { gpuCulling->recordHiZBuild(pass.cmd, viewProjection); })
+            .sampled(depth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL)
+            .sideEffect();
+    }
 
-        // =====================================================================
-        // SCENE SECTION
-        // =====================================================================
-        if (ImGui::CollapsingHeader("Scene", ImGuiTreeNodeFlags_DefaultOpen))
+    // Building the UI records nothing, the ImGui pass draws it. The panel is rebuilt every uiUpdateInterval
+    // frames, and every frame while it has the mouse or keyboard; in between the pass draws the last build's
+    // draw data again (ImGui keeps it until the next NewFrame). Hidden (kiosk mode, headless) it is neither
+    // built nor drawn, except that the panel's benchmark steps inside the build, so it is built while that runs
+    const auto buildUi = [&]()
+    {
+        if (!headless)
+        {
+            ImGui_ImplVulkan_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+        }
+        ImGui::NewFrame();
+
+        // =========================================================================
+        // COLLAPSIBLE PANEL STATE & ANIMATION
+        // =========================================================================
+        static bool panelOpen = true;
+        static float panelAnim = 1.0f;
+        static bool keyPressed = false;
+        const float PANEL_WIDTH = 260.0f;
+        const float COLLAPSED_WIDTH = 42.0f;
+
+        // Toggle with ` key (grave accent / tilde)
+        if (window && glfwGetKey(window, GLFW_KEY_GRAVE_ACCENT) == GLFW_PRESS && !keyPressed)
+        {
+            panelOpen = !panelOpen;
+            keyPressed = true;
+        }
+        if (window && glfwGetKey(window, GLFW_KEY_GRAVE_ACCENT) == GLFW_RELEASE)
+            keyPressed = false;
+
+        // Smooth animation
+        float target = panelOpen ? 1.0f : 0.0f;
+        panelAnim += (target - panelAnim) * ImGui::GetIO().DeltaTime * 12.0f;
+        float ease = panelAnim * panelAnim * (3.0f - 2.0f * panelAnim);
+        float currentWidth = COLLAPSED_WIDTH + (PANEL_WIDTH - COLLAPSED_WIDTH) * ease;
+
+        // =========================================================================
+        // MODERN DARK THEME
+        // =========================================================================
+        ImGuiStyle &style = ImGui::GetStyle();
+        style.WindowRounding = 0.0f;
+        style.FrameRounding = 6.0f;
+        style.GrabRounding = 6.0f;
+        style.ScrollbarRounding = 6.0f;
+        style.TabRounding = 6.0f;
+        style.WindowPadding = ImVec2(12, 10);
+        style.FramePadding = ImVec2(10, 5);
+        style.ItemSpacing = ImVec2(8, 5);
+        style.ScrollbarSize = 10.0f;
+        style.GrabMinSize = 10.0f;
+
+        // Colors
+        ImVec4 bg = ImVec4(0.07f, 0.07f, 0.09f, 0.97f);
+        ImVec4 bgLight = ImVec4(0.12f, 0.12f, 0.15f, 1.0f);
+        ImVec4 accent = ImVec4(0.40f, 0.70f, 1.0f, 1.0f);
+        ImVec4 accentDim = ImVec4(0.25f, 0.50f, 0.80f, 0.7f);
+        ImVec4 text = ImVec4(0.92f, 0.92f, 0.94f, 1.0f);
+        ImVec4 textDim = ImVec4(0.50f, 0.50f, 0.55f, 1.0f);
+        ImVec4 green = ImVec4(0.35f, 0.90f, 0.50f, 1.0f);
+        ImVec4 yellow = ImVec4(1.0f, 0.85f, 0.35f, 1.0f);
+
+        ImGui::PushStyleColor(ImGuiCol_WindowBg, bg);
+        ImGui::PushStyleColor(ImGuiCol_Border, ImVec4(0.2f, 0.2f, 0.25f, 0.5f));
+        ImGui::PushStyleColor(ImGuiCol_Text, text);
+        ImGui::PushStyleColor(ImGuiCol_TextDisabled, textDim);
+        ImGui::PushStyleColor(ImGuiCol_FrameBg, bgLight);
+        ImGui::PushStyleColor(ImGuiCol_FrameBgHovered, ImVec4(0.18f, 0.18f, 0.22f, 1.0f));
+        ImGui::PushStyleColor(ImGuiCol_FrameBgActive, accentDim);
+        ImGui::PushStyleColor(ImGuiCol_Header, bgLight);
+        ImGui::PushStyleColor(ImGuiCol_HeaderHovered, accentDim);
+        ImGui::PushStyleColor(ImGuiCol_HeaderActive, accent);
+        ImGui::PushStyleColor(ImGuiCol_Button, bgLight);
+        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, accentDim);
+        ImGui::PushStyleColor(ImGuiCol_ButtonActive, accent);
+        ImGui::PushStyleColor(ImGuiCol_SliderGrab, accent);
+        ImGui::PushStyleColor(ImGuiCol_SliderGrabActive, ImVec4(0.55f, 0.80f, 1.0f, 1.0f));
+        ImGui::PushStyleColor(ImGuiCol_CheckMark, accent);
+        ImGui::PushStyleColor(ImGuiCol_Tab, ImVec4(0, 0, 0, 0));
+        ImGui::PushStyleColor(ImGuiCol_TabHovered, accentDim);
+        ImGui::PushStyleColor(ImGuiCol_TabActive, accent);
+        ImGui::PushStyleColor(ImGuiCol_Separator, ImVec4(0.25f, 0.25f, 0.30f, 0.5f));
+        ImGui::PushStyleColor(ImGuiCol_ScrollbarBg, ImVec4(0, 0, 0, 0));
+        ImGui::PushStyleColor(ImGuiCol_ScrollbarGrab, bgLight);
+        ImGui::PushStyleColor(ImGuiCol_PlotHistogram, accent);
+        const int COLOR_COUNT = 23;
+
+        ImGui::SetNextWindowPos(ImVec2(0, 0));
+        ImGui::SetNextWindowSize(ImVec2(currentWidth, ImGui::GetIO().DisplaySize.y));
+
+        ImGui::Begin("##Panel", nullptr,
+                     ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize |
+                         ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse);
+
+        // =========================================================================
+        // HEADER WITH TOGGLE
+        // =========================================================================
         {
-            ImGui::Checkbox("Rotate", &rotationEnabled);
-            ImGui::SameLine(120);
-            ImGui::Checkbox("Wireframe", &wireframeEnabled);
+            // Toggle button
+            ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0, 0, 0, 0));
+            if (ImGui::Button(panelOpen ? "<<" : ">>", ImVec2(28, 28)))
+            {
+                panelOpen = !panelOpen;
+            }
+            ImGui::PopStyleColor();
+
+            if (panelOpen && ease > 0.5f)
+            {
+                ImGui::SameLine();
+                ImGui::PushStyleColor(ImGuiCol_Text, accent);
+                ImGui::Text("XeRender");
+                ImGui::PopStyleColor();
+
+                ImGui::SameLine(currentWidth - 70);
+                float fps = (isBenchmarkActive || isTestModeActive) && benchmarkFrameTimeMs > 0
+                                ? static_cast<float>(1000.0 / benchmarkFrameTimeMs)
+                                : ImGui::GetIO().Framerate;
+                ImGui::PushStyleColor(ImGuiCol_Text, (isBenchmarkActive || isTestModeActive) ? green : textDim);
+                ImGui::Text("%.0f", fps);
+                ImGui::PopStyleColor();
+            }
+        }
 
+        // Only render content when panel is mostly open
+        if (ease > 0.3f)
+        {
+            ImGui::Spacing();
+            ImGui::Separator();
             ImGui::Spacing();
 
-            if (ImGui::TreeNode("Materials"))
+            // =====================================================================
+            // SCENE SECTION
+            // =====================================================================
+            if (ImGui::CollapsingHeader("Scene", ImGuiTreeNodeFlags_DefaultOpen))
             {
-                ImGui::Checkbox("Normal", (bool *)&currentToggleInfo.applyNormalMap);
-                ImGui::SameLine(100);
-                ImGui::Checkbox("Metal", (bool *)&currentToggleInfo.applyMetalnessMap);
-                ImGui::Checkbox("Specular", (bool *)&currentToggleInfo.applySpecularMap);
+                ImGui::Checkbox("Rotate", &rotationEnabled);
+                ImGui::SameLine(120);
+                ImGui::Checkbox("Wireframe", &wireframeEnabled);
 
                 ImGui::Spacing();
-                ImGui::TextDisabled("Debug Views");
-                ImGui::Checkbox("Normal##V", (bool *)&currentToggleInfo.viewNormalOnly);
-                ImGui::SameLine(100);
-                ImGui::Checkbox("Metal##V", (bool *)&currentToggleInfo.viewMetalnessOnly);
-                ImGui::Checkbox("Spec##V", (bool *)&currentToggleInfo.viewSpecularOnly);
-                ImGui::TreePop();
-            }
 
-            if (ImGui::TreeNode("Background"))
-            {
-                ImGui::Checkbox("Solid Color", &useSolidBackground);
-                if (useSolidBackground)
+                if (ImGui::TreeNode("Materials"))
                 {
-                    ImGui::ColorEdit3("##BgCol", (float *)&backgroundColor, ImGuiColorEditFlags_NoInputs);
+                    ImGui::Checkbox("Normal", (bool *)&currentToggleInfo.applyNormalMap);
+                    ImGui::SameLine(100);
+                    ImGui::Checkbox("Metal", (bool *)&currentToggleInfo.applyMetalnessMap);
+                    ImGui::Checkbox("Specular", (bool *)&currentToggleInfo.applySpecularMap);
+
+                    ImGui::Spacing();
+                    ImGui::TextDisabled("Debug Views");
+                    ImGui::Checkbox("Normal##V", (bool *)&currentToggleInfo.viewNormalOnly);
+                    ImGui::SameLine(100);
+                    ImGui::Checkbox("Metal##V", (bool *)&currentToggleInfo.viewMetalnessOnly);
+                    ImGui::Checkbox("Spec##V", (bool *)&currentToggleInfo.viewSpecularOnly);
+                    ImGui::TreePop();
                 }
-                ImGui::TreePop();
-            }
 
-            if (ImGui::TreeNode("Camera"))
-            {
-                glm::vec3 camPos = camera.getPosition();
-                ImGui::TextDisabled("%.1f, %.1f, %.1f", camPos.x, camPos.y, camPos.z);
-                ImGui::SliderFloat("Sens", &camera.mouseSensitivity, 0.025f, 1.5f, "%.2f");
-                ImGui::SliderFloat("Speed", &camera.movementSpeed, 0.001f, 0.050f, "%.3f");
-                if (ImGui::Button("Screenshot", ImVec2(-1, 0)))
-                    captureScreenshot = true;
-                ImGui::TreePop();
-            }
-        }
+                if (ImGui::TreeNode("Background"))
+                {
+                    ImGui::Checkbox("Solid Color", &useSolidBackground);
+                    ImGui::Checkbox("Atmospheric Sky", &atmosphericSky);
+                    if (atmosphericSky)
+                    {
+                        float exposure = atmosphereSky->getExposure();
+                        if (ImGui::SliderFloat("Sky Exposure", &exposure, 1.0f, 40.0f, "%.1f"))
+                            atmosphereSky->setExposure(exposure);
+                    }
+                    if (useSolidBackground)
+                    {
+                        ImGui::ColorEdit3("##BgCol", (float *)&backgroundColor, ImGuiColorEditFlags_NoInputs);
+                    }
+                    ImGui::TreePop();
+                }
 
-        // =====================================================================
-        // LIGHTING SECTION
-        // =====================================================================
-        if (ImGui::CollapsingHeader("Lighting"))
-        {
-            if (ImGui::TreeNode("Sun"))
-            {
-                ImGui::ColorEdit3("##SunCol", (float *)&light0Color, ImGuiColorEditFlags_NoInputs);
-                ImGui::SameLine();
-                ImGui::SliderFloat("##SunInt", &light0Intensity, 0.0f, 20.0f, "%.1f");
-                ImGui::SliderFloat("X##Sun", &light0Position.x, -500.0f, 500.0f);
-                ImGui::SliderFloat("Y##Sun", &light0Position.y, 0.0f, 1000.0f);
-                ImGui::SliderFloat("Z##Sun", &light0Position.z, -500.0f, 500.0f);
-                ImGui::TreePop();
-            }
+                if (ImGui::TreeNode("Camera"))
+                {
+                    glm::vec3 camPos = camera.getPosition();
+                    ImGui::TextDisabled("%.1f, %.1f, %.1f", camPos.x, camPos.y, camPos.z);
+                    ImGui::SliderFloat("Sens", &camera.mouseSensitivity, 0.025f, 1.5f, "%.2f");
+                    ImGui::SliderFloat("Speed", &camera.movementSpeed, 0.001f, 0.050f, "%.3f");
+                    if (ImGui::Button("Screenshot", ImVec2(-1, 0)))
+                        captureScreenshot = true;
+                    // One large image in frame-sized tiles, written as it renders (TiledCapture.h)
+                    if (tiledCapture)
+                    {
+                        ImGui::ProgressBar(tiledCapture->getProgress(), ImVec2(-1, 0), "Tiled capture");
+                    }
+                    else if (!stereoRendering && ImGui::TreeNode("Tiled Capture"))
+                    {
+                        int size[2] = {static_cast<int>(tiledCaptureSettings.size.width),
+                                       static_cast<int>(tiledCaptureSettings.size.height)};
+                        if (ImGui::InputInt2("Size", size))
+                        {
+                            tiledCaptureSettings.size = {static_cast<uint32_t>(std::clamp(size[0], 1, 65536)),
+                                                         static_cast<uint32_t>(std::clamp(size[1], 1, 65536))};
+                        }
+                        int samples = static_cast<int>(tiledCaptureSettings.samples);
+                        if (ImGui::SliderInt("Samples", &samples, 1, static_cast<int>(TiledCapture::kMaxSamples)))
+                            tiledCaptureSettings.samples = static_cast<uint32_t>(samples);
+                        if (ImGui::Button("Capture", ImVec2(-1, 0)))
+                        {
+                            static int tiledCaptureCount = 0;
+                            TiledCaptureSettings settings = tiledCaptureSettings;
+                            settings.path = "ScreenShots/tiled_" + std::to_string(++tiledCaptureCount) + ".ppm";
+                            startTiledCapture(settings, {camera.getPosition(), camera.getYaw(), camera.getPitch()}, simulationTime);
+                        }
+                        ImGui::TreePop();
+                    }
+                    ImGui::TreePop();
+                }
 
-            if (ImGui::TreeNode("Secondary"))
-            {
-                ImGui::ColorEdit3("##L2Col", (float *)&light1Color, ImGuiColorEditFlags_NoInputs);
-                ImGui::SameLine();
-                ImGui::SliderFloat("##L2Int", &light1Intensity, 0.0f, 20.0f, "%.1f");
-                ImGui::SliderFloat3("Pos##L2", (float *)&light1Position[0], -100.0f, 100.0f);
-                ImGui::TreePop();
+                if (gpuCulling)
+                {
+                    ImGui::Checkbox("GPU Culling", &gpuDrivenScene);
+                    if (gpuDrivenScene && gpuCulling->isHiZAvailable())
+                    {
+                        ImGui::SameLine(120);
+                        ImGui::Checkbox("Hi-Z", &gpuOcclusionCulling);
+                    }
+                }
+                if (ImGui::Checkbox("Depth Pre-Pass", &depthPrePass))
+                    updatePipelineIfNeeded();
+                if (asyncCompute)
+                {
+                    ImGui::Checkbox("Async Compute", &asyncComputeEnabled);
+                }
+                int framesInFlightSetting = static_cast<int>(requestedFramesInFlight);
+                if (ImGui::SliderInt("Frames In Flight", &framesInFlightSetting, 2, MAX_FRAMES_IN_FLIGHT))
+                    requestedFramesInFlight = static_cast<uint32_t>(framesInFlightSetting);
+                const std::string msaaLabel = std::to_string(requestedMsaaSamples) + "x";
+                if (ImGui::BeginCombo("MSAA", msaaLabel.c_str()))
+                {
+                    for (uint32_t samples = 2; samples <= maxMsaaSamples; samples <<= 1)
+                    {
+                        const std::string label = std::to_string(samples) + "x";
+                        if ((usableSampleCounts & samples) && ImGui::Selectable(label.c_str(), samples == requestedMsaaSamples))
+                            requestedMsaaSamples = static_cast<VkSampleCountFlagBits>(samples);
+                    }
+                    ImGui::EndCombo();
+                }
+                ImGui::Checkbox("Threaded Simulation", &threadedSimulation);
+                if (ImGui::IsItemHovered())
+                {
+                    ImGui::SetTooltip("Step the camera and clock beside command recording, a frame ahead");
+                }
+
+                if (jobSystem->getThreadCount() > 1)
+                {
+                    ImGui::Checkbox("Parallel Recording", &parallelRecording);
+                    if (parallelRecording)
+                    {
+                        ImGui::TextDisabled("%u secondaries on %u threads, %u reused", secondaryRecorder->getRecordedCount(),
+                                            secondaryRecorder->getThreadCount(), secondaryRecorder->getReusedCount());
+                    }
+                    ImGui::TextDisabled("%llu jobs stolen", static_cast<unsigned long long>(jobSystem->getStealCount()));
+                }
+                if (FrameArena::kCountsHeapAllocations)
+                {
+                    ImGui::TextDisabled("Recording: %llu heap allocations, %zu KB frame scratch",
+                                        static_cast<unsigned long long>(recordHeapAllocations), frameArena.getFrameBytes() / 1024);
+                }
+
+                if (gpuDrivenScene && gpuCulling)
+                {
+                    ImGui::TextDisabled("Drawn %u / %u  (GPU%s)", gpuCulling->getVisibleCount(static_cast<uint32_t>(currentFrame)),
+                                        gpuCulling->getObjectCount(), gpuCulling->hasDrawIndirectCount() ? ", count" : "");
+                }
+                else
+                {
+                    const SceneCullStats &cull = scene.getLastCullStats();
+                    ImGui::TextDisabled("Drawn %u / %u  (%u nodes)", cull.objectsVisible, scene.getObjectCount(), cull.nodesVisited);
+                    ImGui::Checkbox("Mesh LODs", &meshLods);
+                    if (meshLods)
+                    {
+                        ImGui::SameLine();
+                        ImGui::SetNextItemWidth(100.0f);
+                        ImGui::SliderFloat("Max Error (px)", &lodPixelError, 0.25f, 8.0f, "%.2f");
+                    }
+                    ImGui::TextDisabled("%u triangles", cull.trianglesVisible);
+                    ImGui::Checkbox("Instanced Draws", &instancedDraws);
+                    if (mainView.instanced)
+                    {
+                        ImGui::SameLine();
+                        ImGui::TextDisabled("%zu draws, %u meshes", mainView.drawList.size(), scene.getMeshCount());
+                    }
+                }
             }
 
-            if (ImGui::TreeNode("Ambient"))
+            // =====================================================================
+            // LIGHTING SECTION
+            // =====================================================================
+            if (ImGui::CollapsingHeader("Lighting"))
             {
-                ImGui::ColorEdit3("##AmbCol", (float *)&ambientColor, ImGuiColorEditFlags_NoInputs);
-                ImGui::SameLine();
-                ImGui::SliderFloat("##AmbInt", &ambientIntensity, 0.0f, 20.0f, "%.1f");
-                ImGui::TreePop();
-            }
+                if (ImGui::TreeNode("Sun"))
+                {
+                    ImGui::ColorEdit3("##SunCol", (float *)&light0Color, ImGuiColorEditFlags_NoInputs);
+                    ImGui::SameLine();
+                    ImGui::SliderFloat("##SunInt", &light0Intensity, 0.0f, 20.0f, "%.1f");
+                    ImGui::SliderFloat("X##Sun", &light0Position.x, -500.0f, 500.0f);
+                    ImGui::SliderFloat("Y##Sun", &light0Position.y, 0.0f, 1000.0f);
+                    ImGui::SliderFloat("Z##Sun", &light0Position.z, -500.0f, 500.0f);
+                    static const char *shadowTiers[] = {"Off", "Low", "Medium", "High"};
+                    int shadowTier = static_cast<int>(shadowQuality);
+                    if (ImGui::Combo("Shadows", &shadowTier, shadowTiers, IM_ARRAYSIZE(shadowTiers)))
+                        shadowQuality = static_cast<ShadowQuality>(shadowTier);
+                    if (shadowQuality != ShadowQuality::Off)
+                    {
+                        ImGui::Checkbox("Round-Robin Cascades", &shadowRoundRobin);
+                        ImGui::TextDisabled("%u/%u cascades, %zu casters", shadowCascades->getDueCount(),
+                                            shadowCascades->getCascadeCount(), shadowCasterCount);
+                    }
+                    ImGui::TreePop();
+                }
 
-            ImGui::Checkbox("Rim Light", (bool *)&currentToggleInfo.RimLight);
-        }
+                if (ImGui::TreeNode("Secondary"))
+                {
+                    ImGui::ColorEdit3("##L2Col", (float *)&light1Color, ImGuiColorEditFlags_NoInputs);
+                    ImGui::SameLine();
+                    ImGui::SliderFloat("##L2Int", &light1Intensity, 0.0f, 20.0f, "%.1f");
+                    ImGui::SliderFloat3("Pos##L2", (float *)&light1Position[0], -100.0f, 100.0f);
+                    ImGui::SliderFloat("Radius##L2", &light1Radius, 1.0f, 200.0f, "%.0f");
+                    ImGui::TreePop();
+                }
 
-        // =====================================================================
-        // WATER SECTION
-        // =====================================================================
-        if (ImGui::CollapsingHeader("Water", ImGuiTreeNodeFlags_DefaultOpen))
-        {
-            // Rendering mode at top
-            ImGui::Combo("Mode", &currentRenderingMode, renderingModes, IM_ARRAYSIZE(renderingModes));
+                if (ImGui::TreeNode("Point Lights"))
+                {
+                    int scattered = static_cast<int>(scatteredLightCount);
+                    bool changed = ImGui::SliderInt("Scattered", &scattered, 0, static_cast<int>(ClusteredLights::kMaxLights) - 1);
+                    changed |= ImGui::SliderFloat("Radius##Scattered", &scatteredLightRadius, 1.0f, 50.0f, "%.1f");
+                    changed |= ImGui::SliderFloat("Intensity##Scattered", &scatteredLightIntensity, 0.0f, 20.0f, "%.1f");
+                    if (changed)
+                    {
+                        scatteredLightCount = static_cast<uint32_t>(scattered);
+                        scatterPointLights();
+                    }
+                    ImGui::Checkbox("Clustered", &clusteredLighting);
+                    ImGui::TextDisabled("%u lights, %s", clusteredLights->getLightCount(static_cast<uint32_t>(currentFrame)),
+                                        clusteredLighting ? "16x9x24 clusters" : "every light per fragment");
+                    ImGui::TreePop();
+                }
 
-            ImGui::Spacing();
+                if (ImGui::TreeNode("Ambient"))
+                {
+                    ImGui::ColorEdit3("##AmbCol", (float *)&ambientColor, ImGuiColorEditFlags_NoInputs);
+                    ImGui::SameLine();
+                    ImGui::SliderFloat("##AmbInt", &ambientIntensity, 0.0f, 20.0f, "%.1f");
+                    ImGui::TreePop();
+                }
 
-            if (ImGui::TreeNode("Surface"))
-            {
-                ImGui::ColorEdit3("Color##Surf", (float *)&waterBaseColor, ImGuiColorEditFlags_NoInputs);
-                ImGui::SliderFloat("Opacity", &waterSurfaceOpacity, 0.0f, 1.0f);
-                ImGui::SliderFloat("Speed", &waterSpeed, 0.0f, 5.0f);
-                ImGui::SliderFloat("Distort", &waterDistortionStrength, 0.0f, 0.1f);
-                ImGui::TreePop();
+                ImGui::Checkbox("Rim Light", (bool *)&currentToggleInfo.RimLight);
             }
 
-            if (ImGui::TreeNode("Underwater"))
+            // =====================================================================
+            // WATER SECTION
+            // =====================================================================
+            if (ImGui::CollapsingHeader("Water", ImGuiTreeNodeFlags_DefaultOpen))
             {
-                ImGui::ColorEdit3("Shallow", (float *)&underwaterShallowColor, ImGuiColorEditFlags_NoInputs);
-                ImGui::SameLine();
-                ImGui::ColorEdit3("Deep", (float *)&underwaterDeepColor, ImGuiColorEditFlags_NoInputs);
-                ImGui::SliderFloat("God Rays", &underwaterGodRayIntensity, 0.0f, 3.0f);
-                ImGui::SliderFloat("Caustics", &oceanBottomCausticIntensity, 0.0f, 5.0f);
-                ImGui::SliderFloat("Fog", &underwaterFogDensity, 0.0f, 0.2f);
-                ImGui::TreePop();
-            }
+                // Rendering mode at top
+                const char *const renderingModes[] = {"BL (Baseline)", "PB (Physically-Based)", "OPT (Optimized)"};
+                ImGui::Combo("Mode", &renderSettings.renderingMode, renderingModes, IM_ARRAYSIZE(renderingModes));
+                ImGui::Checkbox("Specialized Shaders", &specializedWaterShaders);
+                ImGui::Checkbox("Reflection/Refraction", &waterOffscreenPasses);
+                if (waterOffscreenPasses)
+                {
+                    // Chosen for the current mode; each mode keeps its own. Only what the device can do is offered
+                    auto offeredModes = makeFrameVector<ReflectionMode>(frameArena);
+                    auto offeredNames = makeFrameVector<const char *>(frameArena);
+                    offeredModes.push_back(ReflectionMode::Planar);
+                    offeredNames.push_back("Planar");
+                    if (screenSpaceReflections->isAvailable())
+                    {
+                        offeredModes.push_back(ReflectionMode::ScreenSpace);
+                        offeredNames.push_back("Screen-Space");
+                    }
+                    if (rayQueryScene)
+                    {
+                        offeredModes.push_back(ReflectionMode::RayQuery);
+                        offeredNames.push_back("Ray Query");
+                    }
+                    if (offeredModes.size() > 1)
+                    {
+                        const auto current = std::find(offeredModes.begin(), offeredModes.end(), reflectionModes[renderSettings.renderingMode]);
+                        int reflectionMode = current != offeredModes.end() ? static_cast<int>(current - offeredModes.begin()) : 0;
+                        if (ImGui::Combo("Reflections", &reflectionMode, offeredNames.data(), static_cast<int>(offeredNames.size())))
+                            reflectionModes[renderSettings.renderingMode] = offeredModes[reflectionMode];
+                    }
+                    // 0 only re-renders on camera movement; in between water.frag reprojects the last render
+                    int interval = static_cast<int>(offscreenThrottle.getInterval());
+                    if (ImGui::SliderInt("Update Interval", &interval, 0, 8))
+                        offscreenThrottle.setInterval(static_cast<uint32_t>(interval));
+                    if (interval != 1)
+                    {
+                        float moveThreshold = offscreenThrottle.getMoveThreshold();
+                        if (ImGui::SliderFloat("Move Threshold", &moveThreshold, 0.0f, 10.0f, "%.2f"))
+                            offscreenThrottle.setMoveThreshold(moveThreshold);
+                        float turnThreshold = offscreenThrottle.getTurnThresholdDegrees();
+                        if (ImGui::SliderFloat("Turn Threshold (deg)", &turnThreshold, 0.0f, 30.0f, "%.1f"))
+                            offscreenThrottle.setTurnThresholdDegrees(turnThreshold);
+                        ImGui::Text("Reused for %u frames", offscreenThrottle.getReusedFrames());
+                    }
+                    bool dynamicRes = dynamicResolution.isEnabled();
+                    if (ImGui::Checkbox("Dynamic Resolution", &dynamicRes))
+                        dynamicResolution.setEnabled(dynamicRes);
+                    if (dynamicRes)
+                    {
+                        float targetMs = static_cast<float>(dynamicResolution.getTargetFrameMs());
+                        if (ImGui::SliderFloat("GPU Target (ms)", &targetMs, 2.0f, 50.0f, "%.1f"))
+                            dynamicResolution.setTargetFrameMs(targetMs);
+                        float minScale = dynamicResolution.getMinScale();
+                        if (ImGui::SliderFloat("Min Scale", &minScale, 0.25f, 1.0f, "%.2f"))
+                            dynamicResolution.setMinScale(minScale);
+                        ImGui::Text("Scale %.2f (GPU %.2f ms)", dynamicResolution.getScale(), dynamicResolution.getFilteredFrameMs());
+                    }
+                }
 
-            if (ImGui::TreeNode("Particles"))
-            {
-                ImGui::SliderFloat("Amount", &marineSnowIntensity, 0.0f, 2.0f);
-                ImGui::SliderFloat("Size", &marineSnowSize, 0.2f, 3.0f);
-                ImGui::SliderFloat("Drift", &marineSnowSpeed, 0.0f, 3.0f);
-                ImGui::TreePop();
-            }
+                if (ImGui::TreeNode("Auto-Tune (OPT)"))
+                {
+                    ImGui::SliderFloat("GPU Budget (ms)", &autoTunePanelBudgetMs, 2.0f, 50.0f, "%.1f");
+                    if (autoTuner)
+                    {
+                        ImGui::Text("Searching: trial %u", autoTuner->getTrialCount());
+                    }
+                    else if (ImGui::Button("Tune From Here"))
+                    {
+                        requestAutoTune(autoTunePanelBudgetMs);
+                    }
+                    if (ImGui::IsItemHovered())
+                    {
+                        ImGui::SetTooltip("Holds the camera and the clock and searches OPT's settings for the\n"
+                                          "best SSIM within the budget; the preset is cached for this GPU");
+                    }
+                    if (autoTunePreset)
+                    {
+                        ImGui::Text("Preset for %.1f ms: %.2f ms, SSIM %.3f%s", autoTunePreset->budgetMs, autoTunePreset->gpuMs,
+                                    autoTunePreset->ssim, autoTunePreset->metBudget ? "" : " (over budget)");
+                    }
+                    ImGui::TreePop();
+                }
 
-            if (ImGui::TreeNode("Effects"))
-            {
-                ImGui::SliderFloat("Chromatic", &chromaticAberrationStrength, 0.0f, 0.5f);
-                ImGui::TextDisabled("God Ray Tuning");
-                ImGui::SliderFloat("Exposure", &godExposure, 0.0f, 3.0f);
-                ImGui::SliderFloat("Decay", &godDecay, 0.7f, 1.0f);
-                ImGui::SliderFloat("Density", &godDensity, 0.1f, 2.0f);
-                ImGui::SliderFloat("Scale", &godSampleScale, 0.25f, 2.0f);
-                ImGui::TreePop();
-            }
+                ImGui::Spacing();
 
-            if (ImGui::TreeNode("Debug"))
-            {
-                ImGui::Checkbox("Rays", &showDebugRays);
-                ImGui::SameLine();
-                ImGui::Checkbox("Snow", &showMarineSnowDebug);
-                ImGui::SameLine();
-                ImGui::Checkbox("CA", &showChromaticDebug);
-                if (showDebugRays || showMarineSnowDebug || showChromaticDebug)
+                if (ImGui::TreeNode("Surface"))
                 {
-                    ImGui::TextColored(yellow, "Debug ON");
+                    ImGui::ColorEdit3("Color##Surf", (float *)&renderSettings.waterBaseColor, ImGuiColorEditFlags_NoInputs);
+                    ImGui::SliderFloat("Opacity", &renderSettings.waterSurfaceOpacity, 0.0f, 1.0f);
+                    ImGui::SliderFloat("Speed", &renderSettings.waterSpeed, 0.0f, 5.0f);
+                    float choppiness = oceanFFT->getChoppiness();
+                    if (ImGui::SliderFloat("Choppiness", &choppiness, 0.0f, 2.5f))
+                        oceanFFT->setChoppiness(choppiness);
+                    ImGui::SliderFloat("Distort", &renderSettings.waterDistortionStrength, 0.0f, 0.1f);
+                    ImGui::Checkbox("Cull Tiles", &waterTileCulling);
+                    ImGui::SameLine();
+                    ImGui::TextDisabled("%u tiles, %u culled", waterMesh->getTileCount(static_cast<uint32_t>(currentFrame)),
+                                        waterMesh->getCulledCount(static_cast<uint32_t>(currentFrame)));
+                    if (waterTessPipeline)
+                    {
+                        ImGui::Checkbox("Tessellation", &waterTessellation);
+                        if (waterTessellation)
+                            ImGui::SliderFloat("Edge (px)", &waterTessEdgePixels, 4.0f, 64.0f, "%.0f");
+                    }
+                    ImGui::TreePop();
                 }
-                ImGui::TreePop();
-            }
-        }
 
-        // =====================================================================
-        // BENCHMARK SECTION
-        // =====================================================================
-        if (ImGui::CollapsingHeader("Benchmark"))
-        {
-            static bool runningBenchmark = false;
-            static float benchmarkTime = 0.0f;
-            static float benchmarkFps[3] = {0.0f, 0.0f, 0.0f};
-            static float benchmarkFpsSum[3] = {0.0f, 0.0f, 0.0f};
-            static int benchmarkFrameCount[3] = {0, 0, 0};
-            static int savedRenderingMode = 0;
-            static bool firstBenchmarkFrame = false;
-            static glm::vec3 savedCameraPos;
-            static float savedCameraYaw, savedCameraPitch;
-
-            if (!runningBenchmark)
-            {
-                if (ImGui::Button("Run Benchmark", ImVec2(-1, 28)))
+                if (ImGui::TreeNode("Underwater"))
                 {
-                    runningBenchmark = true;
-                    isBenchmarkActive = true;
-                    firstBenchmarkFrame = true;
-                    benchmarkTime = 0.0f;
-                    gpuSyncedFrameTimeMs = 0.0;
-                    savedRenderingMode = currentRenderingMode;
-                    savedCameraPos = camera.position;
-                    savedCameraYaw = camera.yaw;
-                    savedCameraPitch = camera.pitch;
-                    camera.position = glm::vec3(0.0f, -25.0f, 30.0f);
-                    camera.setYaw(-90.0f);
-                    camera.setPitch(15.0f);
-                    for (int i = 0; i < 3; ++i)
+                    ImGui::ColorEdit3("Shallow", (float *)&renderSettings.underwaterShallowColor, ImGuiColorEditFlags_NoInputs);
+                    ImGui::SameLine();
+                    ImGui::ColorEdit3("Deep", (float *)&renderSettings.underwaterDeepColor, ImGuiColorEditFlags_NoInputs);
+                    ImGui::SliderFloat("God Rays", &renderSettings.underwaterGodRayIntensity, 0.0f, 3.0f);
+                    ImGui::SliderFloat("Caustics", &renderSettings.oceanBottomCausticIntensity, 0.0f, 5.0f);
+                    ImGui::Checkbox("Traced Caustics", &computedCaustics);
+                    if (computedCaustics)
+                    {
+                        int rayCount = static_cast<int>(oceanCaustics->getRayCount());
+                        if (ImGui::SliderInt("Caustic Rays", &rayCount, 16, 256))
+                            oceanCaustics->setRayCount(static_cast<uint32_t>(rayCount));
+                    }
+                    ImGui::SliderFloat("Fog", &renderSettings.underwaterFogDensity, 0.0f, 0.2f);
+                    ImGui::Checkbox("Froxel Volumetrics", &froxelVolumetrics);
+                    if (!froxelVolumetrics)
+                    {
+                        ImGui::SameLine();
+                        ImGui::Checkbox("Tiled Fog", &tiledEffects);
+                    }
+                    if (variableRateShadingSupported)
                     {
-                        benchmarkFps[i] = 0.0f;
-                        benchmarkFpsSum[i] = 0.0f;
-                        benchmarkFrameCount[i] = 0;
+                        ImGui::Checkbox("Variable Rate Shading", &variableRateShading);
                     }
+                    ImGui::Checkbox("Half-Res + Temporal", &temporalUnderwaterEffects);
+                    if (temporalUnderwaterEffects)
+                    {
+                        float currentWeight = temporalUpscaler->getCurrentWeight();
+                        if (ImGui::SliderFloat("Frame Weight", &currentWeight, 0.02f, 1.0f, "%.2f"))
+                            temporalUpscaler->setCurrentWeight(currentWeight);
+                    }
+                    else if (renderSettings.renderingMode == 2 && godRayUpsampler->isAvailable())
+                    {
+                        ImGui::Checkbox("Half-Res God Rays", &halfResGodRays);
+                    }
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Particles"))
+                {
+                    ImGui::SliderFloat("Amount", &renderSettings.marineSnowIntensity, 0.0f, 2.0f);
+                    ImGui::SliderFloat("Size", &renderSettings.marineSnowSize, 0.2f, 3.0f);
+                    ImGui::SliderFloat("Drift", &renderSettings.marineSnowSpeed, 0.0f, 3.0f);
+                    ImGui::Checkbox("GPU Particles", &renderSettings.marineSnowParticles);
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Effects"))
+                {
+                    ImGui::SliderFloat("Chromatic", &renderSettings.chromaticAberrationStrength, 0.0f, 0.5f);
+                    ImGui::TextDisabled("God Ray Tuning");
+                    ImGui::SliderFloat("Exposure", &renderSettings.godExposure, 0.0f, 3.0f);
+                    ImGui::SliderFloat("Decay", &renderSettings.godDecay, 0.7f, 1.0f);
+                    ImGui::SliderFloat("Density", &renderSettings.godDensity, 0.1f, 2.0f);
+                    ImGui::SliderFloat("Scale", &renderSettings.godSampleScale, 0.25f, 2.0f);
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Debug"))
+                {
+                    ImGui::Checkbox("Rays", &renderSettings.showDebugRays);
+                    ImGui::SameLine();
+                    ImGui::Checkbox("Snow", &renderSettings.showMarineSnowDebug);
+                    ImGui::SameLine();
+                    ImGui::Checkbox("CA", &renderSettings.showChromaticDebug);
+                    if (renderSettings.showDebugRays || renderSettings.showMarineSnowDebug || renderSettings.showChromaticDebug)
+                    {
+                        ImGui::TextColored(yellow, "Debug ON");
+                    }
+                    ImGui::TreePop();
                 }
             }
-            else
+
+            // =====================================================================
+            // BENCHMARK SECTION
+            // =====================================================================
+            if (ImGui::CollapsingHeader("Benchmark"))
             {
-                if (firstBenchmarkFrame)
+                static bool runningBenchmark = false;
+                static float benchmarkTime = 0.0f;
+                static float benchmarkFps[3] = {0.0f, 0.0f, 0.0f};
+                static float benchmarkFpsSum[3] = {0.0f, 0.0f, 0.0f};
+                static int benchmarkFrameCount[3] = {0, 0, 0};
+                static int savedRenderingMode = 0;
+                static bool firstBenchmarkFrame = false;
+                static glm::vec3 savedCameraPos;
+                static float savedCameraYaw, savedCameraPitch;
+
+                if (!runningBenchmark)
                 {
-                    firstBenchmarkFrame = false;
-                    ImGui::TextColored(yellow, "Warming up...");
+                    ImGui::Checkbox("Pipelined timing##Bench", &pipelinedTiming);
+                    if (ImGui::IsItemHovered())
+                    {
+                        ImGui::SetTooltip("On: frames stay in flight, frame time = interval between completions\n"
+                                          "Off: vkQueueWaitIdle after every frame");
+                    }
+
+                    if (ImGui::Button("Run Benchmark", ImVec2(-1, 28)))
+                    {
+                        runningBenchmark = true;
+                        isBenchmarkActive = true;
+                        firstBenchmarkFrame = true;
+                        benchmarkTime = 0.0f;
+                        benchmarkFrameTimeMs = 0.0;
+                        savedRenderingMode = renderSettings.renderingMode;
+                        savedCameraPos = camera.position;
+                        savedCameraYaw = camera.yaw;
+                        savedCameraPitch = camera.pitch;
+                        simulation->setCameraPath([](uint64_t)
+                                                  { return CameraPose{glm::vec3(0.0f, -25.0f, 30.0f), -90.0f, 15.0f}; });
+                        simulation->restartClock();
+                        for (int i = 0; i < 3; ++i)
+                        {
+                            benchmarkFps[i] = 0.0f;
+                            benchmarkFpsSum[i] = 0.0f;
+                            benchmarkFrameCount[i] = 0;
+                        }
+                    }
                 }
-                else if (gpuSyncedFrameTimeMs > 0.1)
+                else
                 {
-                    float gpuSyncedDeltaTime = static_cast<float>(gpuSyncedFrameTimeMs / 1000.0);
-                    benchmarkTime += gpuSyncedDeltaTime;
-                    float gpuSyncedFps = static_cast<float>(1000.0 / gpuSyncedFrameTimeMs);
+                    if (firstBenchmarkFrame)
+                    {
+                        firstBenchmarkFrame = false;
+                        ImGui::TextColored(yellow, "Warming up...");
+                    }
+                    else if (benchmarkFrameTimeMs > 0.1)
+                    {
+                        float benchmarkDeltaTime = static_cast<float>(benchmarkFrameTimeMs / 1000.0);
+                        benchmarkTime += benchmarkDeltaTime;
+                        float benchmarkFrameFps = static_cast<float>(1000.0 / benchmarkFrameTimeMs);
 
-                    ImGui::ProgressBar(benchmarkTime / 6.0f, ImVec2(-1, 0));
+                        ImGui::ProgressBar(benchmarkTime / 6.0f, ImVec2(-1, 0));
 
-                    float warmupTime = 0.5f;
-                    float testDuration = 2.0f;
+                        float warmupTime = 0.5f;
+                        float testDuration = 2.0f;
 
-                    if (benchmarkTime < testDuration)
-                    {
-                        if (currentRenderingMode != 0)
-                            currentRenderingMode = 0;
-                        if (benchmarkTime > warmupTime)
+                        if (benchmarkTime < testDuration)
+                        {
+                            if (renderSettings.renderingMode != 0)
+                                renderSettings.renderingMode = 0;
+                            if (benchmarkTime > warmupTime)
+                            {
+                                benchmarkFpsSum[0] += benchmarkFrameFps;
+                                benchmarkFrameCount[0]++;
+                            }
+                        }
+                        else if (benchmarkTime < testDuration * 2)
                         {
-                            benchmarkFpsSum[0] += gpuSyncedFps;
-                            benchmarkFrameCount[0]++;
+                            if (renderSettings.renderingMode != 1)
+                                renderSettings.renderingMode = 1;
+                            if (benchmarkTime > testDuration + warmupTime)
+                            {
+                                benchmarkFpsSum[1] += benchmarkFrameFps;
+                                benchmarkFrameCount[1]++;
+                            }
                         }
+                        else if (benchmarkTime < testDuration * 3)
+                        {
+                            if (renderSettings.renderingMode != 2)
+                                renderSettings.renderingMode = 2;
+                            if (benchmarkTime > testDuration * 2 + warmupTime)
+                            {
+                                benchmarkFpsSum[2] += benchmarkFrameFps;
+                                benchmarkFrameCount[2]++;
+                            }
+                        }
+                        else
+                        {
+                            for (int i = 0; i < 3; ++i)
+                            {
+                                if (benchmarkFrameCount[i] > 0)
+                                    benchmarkFps[i] = benchmarkFpsSum[i] / benchmarkFrameCount[i];
+                            }
+                            runningBenchmark = false;
+                            isBenchmarkActive = false;
+                            renderSettings.renderingMode = savedRenderingMode;
+                            simulation->setCameraPath({});
+                            simulationInput.cameraPose = CameraPose{savedCameraPos, savedCameraYaw, savedCameraPitch};
+                        }
+                    }
+                }
+
+                // Results
+                if (!runningBenchmark && (benchmarkFps[0] > 0 || benchmarkFps[1] > 0 || benchmarkFps[2] > 0))
+                {
+                    ImGui::TextColored(green, "BL: %.0f", benchmarkFps[0]);
+                    ImGui::SameLine(90);
+                    ImGui::TextColored(yellow, "PB: %.0f", benchmarkFps[1]);
+                    ImGui::SameLine(170);
+                    ImGui::TextColored(accent, "OPT: %.0f", benchmarkFps[2]);
+
+                    if (ImGui::Button("Clear##Bench", ImVec2(-1, 0)))
+                    {
+                        for (int i = 0; i < 3; ++i)
+                            benchmarkFps[i] = 0.0f;
+                    }
+                }
+
+                // Presentation: input latency against throughput. Changes recreate the swapchain after this frame
+                if (!headless)
+                {
+                    ImGui::Separator();
+                    static const VkPresentModeKHR presentModes[] = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+                                                                    VK_PRESENT_MODE_IMMEDIATE_KHR};
+                    static const char *presentModeNames[] = {"FIFO (VSync)", "Mailbox", "Immediate"};
+                    const VkPresentModeKHR activeMode = swapChainManager->getPresentMode();
+                    int presentMode = static_cast<int>(std::find(std::begin(presentModes), std::end(presentModes), activeMode) -
+                                                       std::begin(presentModes));
+                    if (ImGui::Combo("Present Mode", &presentMode, presentModeNames, IM_ARRAYSIZE(presentModeNames)))
+                    {
+                        swapChainManager->setPreferredPresentMode(presentModes[presentMode]);
+                        framebufferResized = true;
                     }
-                    else if (benchmarkTime < testDuration * 2)
+                    if (ImGui::IsItemHovered())
                     {
-                        if (currentRenderingMode != 1)
-                            currentRenderingMode = 1;
-                        if (benchmarkTime > testDuration + warmupTime)
+                        ImGui::SetTooltip("Falls back Immediate -> Mailbox -> FIFO when the surface lacks a mode");
+                    }
+
+                    int imageCount = static_cast<int>(swapChainManager->getSwapChainImages().size());
+                    if (ImGui::InputInt("Swapchain Images", &imageCount, 1, 1, ImGuiInputTextFlags_EnterReturnsTrue))
+                    {
+                        const uint32_t maxImages = swapChainManager->getMaxImageCount();
+                        uint32_t requested = std::max(static_cast<uint32_t>(std::max(imageCount, 1)), swapChainManager->getMinImageCount());
+                        requested = maxImages > 0 ? std::min(requested, maxImages) : requested;
+                        if (requested != swapChainManager->getSwapChainImages().size())
                         {
-                            benchmarkFpsSum[1] += gpuSyncedFps;
-                            benchmarkFrameCount[1]++;
+                            swapChainManager->setPreferredImageCount(requested);
+                            framebufferResized = true;
                         }
                     }
-                    else if (benchmarkTime < testDuration * 3)
+
+                    if (presentPacer)
                     {
-                        if (currentRenderingMode != 2)
-                            currentRenderingMode = 2;
-                        if (benchmarkTime > testDuration * 2 + warmupTime)
+                        ImGui::Checkbox("Present Wait Pacing", &presentPacing);
+                        if (ImGui::IsItemHovered())
                         {
-                            benchmarkFpsSum[2] += gpuSyncedFps;
-                            benchmarkFrameCount[2]++;
+                            ImGui::SetTooltip("Start each frame once the previous one is on screen (VK_KHR_present_wait):\n"
+                                              "fresher input for less throughput");
+                        }
+                        if (presentPacer->getLatencyMs() > 0.0)
+                        {
+                            ImGui::Text("Motion-to-photon: %.1f ms (last %.1f)", presentPacer->getLatencyMs(),
+                                        presentPacer->getLastLatencyMs());
                         }
                     }
                     else
                     {
-                        for (int i = 0; i < 3; ++i)
+                        ImGui::TextDisabled("Motion-to-photon: needs VK_KHR_present_wait");
+                    }
+                }
+
+                // The panel's own CPU cost: rebuilt every N frames, the draw data reused in between
+                ImGui::Separator();
+                int uiInterval = static_cast<int>(uiUpdateInterval);
+                if (ImGui::SliderInt("UI Update Interval", &uiInterval, 1, 30))
+                {
+                    uiUpdateInterval = static_cast<uint32_t>(uiInterval);
+                }
+                if (ImGui::IsItemHovered())
+                {
+                    ImGui::SetTooltip("Frames between panel rebuilds; every frame while the panel is in use. F1 hides it entirely");
+                }
+            }
+
+            // =====================================================================
+            // GPU MEMORY SECTION
+            // =====================================================================
+            if (ImGui::CollapsingHeader("Memory"))
+            {
+                auto showPoolStats = [&](const char *label, const GpuMemoryStats &stats)
+                {
+                    const double MB = 1024.0 * 1024.0;
+                    ImGui::TextColored(accent, "%s", label);
+                    ImGui::Text("  Blocks: %u (%u dedicated)", stats.blockCount, stats.dedicatedBlockCount);
+                    ImGui::Text("  Allocations: %u", stats.allocationCount);
+                    ImGui::Text("  Used: %.1f / %.1f MB", stats.bytesUsed / MB, stats.bytesReserved / MB);
+                    ImGui::TextColored(textDim, "  Fragmentation: %.0f%%", stats.fragmentation() * 100.0f);
+                    if (stats.bytesReserved > 0)
+                    {
+                        ImGui::ProgressBar(static_cast<float>(stats.bytesUsed) / static_cast<float>(stats.bytesReserved), ImVec2(-1, 0));
+                    }
+                };
+
+                const double MB = 1024.0 * 1024.0;
+                const GpuMemoryAllocator &allocator = GpuMemoryAllocator::get();
+
+                // Per heap: the process' use against its budget, ours within it
+                const std::vector<GpuHeapBudget> heaps = allocator.getHeapBudgets();
+                ImGui::TextColored(accent, "Heaps");
+                ImGui::SameLine();
+                ImGui::TextColored(textDim, allocator.isBudgetMeasured() ? "(VK_EXT_memory_budget)" : "(estimated budget)");
+                for (size_t i = 0; i < heaps.size(); i++)
+                {
+                    const GpuHeapBudget &heap = heaps[i];
+                    const float fill = heap.budget > 0 ? static_cast<float>(heap.usage) / static_cast<float>(heap.budget) : 0.0f;
+                    ImGui::Text("  Heap %zu (%s, %.0f MB)", i, heap.deviceLocal ? "device" : "host", heap.size / MB);
+                    ImGui::TextColored(fill > GpuMemoryAllocator::kBudgetTarget ? yellow : textDim,
+                                       "    Usage %.1f / %.1f MB, ours %.1f MB", heap.usage / MB, heap.budget / MB, heap.reserved / MB);
+                    char overlay[32];
+                    snprintf(overlay, sizeof(overlay), "%.0f%%", fill * 100.0f);
+                    ImGui::ProgressBar(std::min(fill, 1.0f), ImVec2(-1, 0), overlay);
+                }
+                const VkDeviceSize overrun = allocator.getBudgetOverrun();
+                if (overrun > 0)
+                {
+                    ImGui::TextColored(yellow, "Over budget by %.1f MB", overrun / MB);
+                }
+                ImGui::Text("Texture levels dropped: %u", textureStreamer ? textureStreamer->getDroppedLevelCount() : 0u);
+                if (const BathymetryField *bathymetry = oceanBottomMesh ? oceanBottomMesh->getBathymetry() : nullptr; bathymetry && bathymetry->isLoaded())
+                {
+                    ImGui::Text("Bathymetry tiles: %u resident, %u pending", bathymetry->getResidentTileCount(), bathymetry->getPendingTileCount());
+                }
+
+                ImGui::Spacing();
+                ImGui::TextColored(accent, "Categories");
+                for (uint32_t i = 0; i < static_cast<uint32_t>(GpuMemoryCategory::Count); i++)
+                {
+                    const GpuMemoryCategory category = static_cast<GpuMemoryCategory>(i);
+                    const GpuCategoryStats stats = allocator.getCategoryStats(category);
+                    ImGui::Text("  %-15s %8.1f MB  (%u)", toString(category), stats.bytes / MB, stats.allocationCount);
+                }
+
+                ImGui::Spacing();
+                showPoolStats("Device Local", allocator.getDeviceLocalStats());
+                ImGui::Spacing();
+                showPoolStats("Host Visible", allocator.getHostVisibleStats());
+            }
+
+            // =====================================================================
+            // GPU PROFILER SECTION
+            // =====================================================================
+            if (ImGui::CollapsingHeader("GPU Profiler"))
+            {
+                const GpuProfiler::History *frameHistory = gpuProfiler->getHistory("Frame");
+                if (!gpuProfiler->isSupported())
+                {
+                    ImGui::TextColored(textDim, "Timestamps not supported on this device");
+                }
+                else if (frameHistory)
+                {
+                    ImGui::Text("GPU Frame: %.3f ms (avg %.3f ms)", gpuProfiler->getScopeMs("Frame"), frameHistory->average());
+                    // Until the ring wraps the samples are [0, count), oldest first
+                    int historyOffset = frameHistory->count < GpuProfiler::kHistorySize ? 0 : static_cast<int>(frameHistory->next);
+                    ImGui::PlotLines("##GpuFrameHistory", frameHistory->values.data(), static_cast<int>(frameHistory->count),
+                                     historyOffset, nullptr, 0.0f, FLT_MAX, ImVec2(-1.0f, 50.0f));
+
+                    // Flame graph of the latest completed frame: x = time, one row per nesting depth
+                    const std::vector<GpuProfileScope> &scopes = gpuProfiler->getLastFrame();
+                    double spanMs = 0.0;
+                    uint32_t maxDepth = 0;
+                    for (const GpuProfileScope &scope : scopes)
+                    {
+                        spanMs = std::max(spanMs, scope.startMs + scope.durationMs);
+                        maxDepth = std::max(maxDepth, scope.depth);
+                    }
+
+                    if (spanMs > 0.0)
+                    {
+                        const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+                        const float graphWidth = ImGui::GetContentRegionAvail().x;
+                        const ImVec2 graphOrigin = ImGui::GetCursorScreenPos();
+                        ImGui::InvisibleButton("##GpuFlameGraph", ImVec2(graphWidth, rowHeight * static_cast<float>(maxDepth + 1)));
+
+                        ImDrawList *drawList = ImGui::GetWindowDrawList();
+                        for (const GpuProfileScope &scope : scopes)
                         {
-                            if (benchmarkFrameCount[i] > 0)
-                                benchmarkFps[i] = benchmarkFpsSum[i] / benchmarkFrameCount[i];
+                            ImVec2 barMin(graphOrigin.x + static_cast<float>(scope.startMs / spanMs) * graphWidth,
+                                          graphOrigin.y + static_cast<float>(scope.depth) * rowHeight);
+                            ImVec2 barMax(barMin.x + std::max(1.0f, static_cast<float>(scope.durationMs / spanMs) * graphWidth),
+                                          barMin.y + rowHeight - 1.0f);
+
+                            // Same hue for the same scope every frame
+                            float hue = static_cast<float>(std::hash<std::string>{}(scope.name) % 360) / 360.0f;
+                            drawList->AddRectFilled(barMin, barMax, ImColor::HSV(hue, 0.5f, 0.65f));
+                            if (ImGui::CalcTextSize(scope.name.c_str()).x + 4.0f < barMax.x - barMin.x)
+                            {
+                                drawList->AddText(ImVec2(barMin.x + 2.0f, barMin.y), IM_COL32_WHITE, scope.name.c_str());
+                            }
+                            if (ImGui::IsMouseHoveringRect(barMin, barMax))
+                            {
+                                ImGui::SetTooltip("%s: %.3f ms", scope.name.c_str(), scope.durationMs);
+                            }
+                        }
+
+                        for (const GpuProfileScope &scope : scopes)
+                        {
+                            const GpuProfiler::History *history = gpuProfiler->getHistory(scope.name);
+                            ImGui::Text("%*s%-10s %6.3f ms  (avg %6.3f)", static_cast<int>(scope.depth * 2), "", scope.name.c_str(),
+                                        scope.durationMs, history ? history->average() : 0.0f);
                         }
-                        runningBenchmark = false;
-                        isBenchmarkActive = false;
-                        currentRenderingMode = savedRenderingMode;
-                        camera.position = savedCameraPos;
-                        camera.setYaw(savedCameraYaw);
-                        camera.setPitch(savedCameraPitch);
                     }
                 }
             }
 
-            // Results
-            if (!runningBenchmark && (benchmarkFps[0] > 0 || benchmarkFps[1] > 0 || benchmarkFps[2] > 0))
+            // =====================================================================
+            // RENDER GRAPH SECTION
+            // =====================================================================
+            if (ImGui::CollapsingHeader("Render Graph"))
             {
-                ImGui::TextColored(green, "BL: %.0f", benchmarkFps[0]);
-                ImGui::SameLine(90);
-                ImGui::TextColored(yellow, "PB: %.0f", benchmarkFps[1]);
-                ImGui::SameLine(170);
-                ImGui::TextColored(accent, "OPT: %.0f", benchmarkFps[2]);
+                // Built before this frame's graph executes: figures are from the previous frame
+                const double MB = 1024.0 * 1024.0;
+                const RenderGraphStats &graphStats = renderGraph->getStats();
+                ImGui::Text("Passes: %u (%u culled, %u merged)", graphStats.passes, graphStats.culledPasses, graphStats.mergedPasses);
+                ImGui::TextDisabled("Begun with %s", dynamicRenderingEnabled ? "dynamic rendering" : "render passes");
+                ImGui::Text("Barriers: %u", graphStats.barriers);
+                ImGui::Text("Transients: %u on %u images", graphStats.transientImages, graphStats.physicalImages);
+                ImGui::TextColored(textDim, "  %.1f MB, %.1f MB saved by aliasing into %u memory slots", graphStats.transientBytes / MB,
+                                   graphStats.aliasedBytes / MB, graphStats.memorySlots);
+                if (graphStats.lazyBytes > 0)
+                    ImGui::TextColored(textDim, "  %.1f MB lazily allocated", graphStats.lazyBytes / MB);
+
+                ImGui::Spacing();
+                for (const RenderGraphPassTiming &timing : renderGraph->getPassTimings())
+                {
+                    if (timing.culled)
+                    {
+                        ImGui::TextColored(textDim, "%-10s culled", timing.name.c_str());
+                    }
+                    else
+                    {
+                        if (timing.merged)
+                        ImGui::Text("%-10s %6.3f ms  merged", timing.name.c_str(), timing.gpuMs);
+                    else
+                        ImGui::Text("%-10s %6.3f ms  %u barriers", timing.name.c_str(), timing.gpuMs, timing.barriers);
+                        if (lastFrameCapture && !passReplay && !isTestModeActive)
+                        {
+                            ImGui::SameLine();
+                            ImGui::PushID(timing.name.c_str());
+                            if (ImGui::SmallButton("Replay"))
+                            {
+                                requestedReplayPass = timing.name;
+                            }
+                            ImGui::PopID();
+                        }
+                    }
+                }
+
+                // Isolated pass timings: the captured frame is held while the pass is recorded again and again
+                ImGui::Spacing();
+                if (ImGui::Button("Capture Frame"))
+                {
+                    captureFrame();
+                }
+                if (lastFrameCapture)
+                {
+                    ImGui::SameLine();
+                    ImGui::TextColored(textDim, "%s", lastFrameCapturePath.c_str());
+                }
+                int repeat = static_cast<int>(replayRepeat);
+                if (ImGui::SliderInt("Replay Repeats", &repeat, 1, static_cast<int>(PassReplay::kMaxScopes)))
+                {
+                    replayRepeat = static_cast<uint32_t>(repeat);
+                }
+                if (passReplay)
+                {
+                    ImGui::ProgressBar(passReplay->getProgress(), ImVec2(-1, 0), passReplay->getPasses().front().c_str());
+                }
+                for (const PassReplay::PassResult &result : lastReplayResults)
+                {
+                    ImGui::Text("%-10s %6.3f ms median  %6.3f min  %6.3f p99", result.name.c_str(), result.medianMs, result.minMs, result.p99Ms);
+                }
 
-                if (ImGui::Button("Clear##Bench", ImVec2(-1, 0)))
+                // CPU zones of the next frames as a Chrome trace (CpuProfiler.h)
+                ImGui::Spacing();
+                if (!CpuProfiler::kEnabled)
+                {
+                    ImGui::TextColored(textDim, "CPU trace: build with XERENDER_CPU_PROFILING");
+                }
+                else if (cpuTraceFramesLeft > 0)
+                {
+                    ImGui::Text("CPU trace: %u frames left", cpuTraceFramesLeft);
+                }
+                else if (ImGui::Button("Record CPU Trace"))
                 {
-                    for (int i = 0; i < 3; ++i)
-                        benchmarkFps[i] = 0.0f;
+                    std::filesystem::create_directories("traces");
+                    cpuTracePath = "traces/cpu_" + std::to_string(simulationFrame) + ".json";
+                    cpuTraceFramesLeft = kCpuTraceFrames;
+                    CpuProfiler::start();
+                }
+
+                // Frames over the threshold write the frames around them to hitches/ (HitchDetector.h)
+                if (hitchDetector)
+                {
+                    ImGui::Spacing();
+                    if (ImGui::SliderFloat("Hitch Threshold", &hitchPanelThresholdMs, 20.0f, 200.0f, "%.0f ms"))
+                    {
+                        hitchDetector->setThresholdMs(hitchPanelThresholdMs);
+                    }
+                    ImGui::Text("Hitches: %u, worst %.1f ms", hitchDetector->getHitchCount(), hitchDetector->getWorstMs());
+                    if (hitchDetector->getTraceCount() > 0)
+                    {
+                        ImGui::TextColored(textDim, "%s", hitchDetector->getLastTracePath().c_str());
+                    }
                 }
             }
-        }
 
-        // =====================================================================
-        // TESTING SECTION
-        // =====================================================================
-        if (ImGui::CollapsingHeader("Testing"))
-        {
-            renderTestingUI();
-        }
+            // =====================================================================
+            // TESTING SECTION
+            // =====================================================================
+            if (ImGui::CollapsingHeader("Testing"))
+            {
+                renderTestingUI();
+            }
 
-        // =====================================================================
-        // HELP (Collapsed by default)
-        // =====================================================================
-        if (ImGui::CollapsingHeader("Controls"))
-        {
-            ImGui::TextDisabled("LMB + WASD = Move");
-            ImGui::TextDisabled("Q/E = Up/Down");
-            ImGui::TextDisabled("Scroll = Speed");
-            ImGui::TextDisabled("P = Screenshot");
-            ImGui::TextDisabled("R = Rotate");
-            ImGui::TextDisabled("` = Toggle Panel");
-        }
-    } // end if (ease > 0.3f)
+            // =====================================================================
+            // HELP (Collapsed by default)
+            // =====================================================================
+            if (ImGui::CollapsingHeader("Controls"))
+            {
+                ImGui::TextDisabled("LMB + WASD = Move");
+                ImGui::TextDisabled("Q/E = Up/Down");
+                ImGui::TextDisabled("Scroll = Speed");
+                ImGui::TextDisabled("P = Screenshot");
+                ImGui::TextDisabled("R = Rotate");
+                ImGui::TextDisabled("` = Toggle Panel");
+                ImGui::TextDisabled("F1 = Hide UI (kiosk)");
+            }
+        } // end if (ease > 0.3f)
 
-    ImGui::PopStyleColor(COLOR_COUNT);
-    ImGui::End();
-    ImGui::Render();
+        ImGui::PopStyleColor(COLOR_COUNT);
+        ImGui::End();
+        ImGui::Render();
+    };
+    const ImGuiIO &imguiIO = ImGui::GetIO();
+    const bool uiInteracting = imguiIO.WantCaptureMouse || imguiIO.WantCaptureKeyboard || ImGui::IsAnyItemActive();
+    const bool drawUi = !headless && !uiHidden;
+    if (isBenchmarkActive || (drawUi && (++uiFramesSinceBuild >= uiUpdateInterval || uiInteracting || !ImGui::GetDrawData())))
+    {
+        CPU_ZONE("ImGui build");
+        buildUi();
+        uiFramesSinceBuild = 0;
+    }
 
-    VkRenderPassBeginInfo rpInfo{};
-    rpInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    rpInfo.renderPass = imguiRenderPass;
-    rpInfo.framebuffer = imguiFramebuffers[imageIndex];
-    rpInfo.renderArea.offset = {0, 0};
-    rpInfo.renderArea.extent = swapChainManager->getSwapChainExtent();
-    rpInfo.clearValueCount = 0; // <--- NO CLEARING
-    rpInfo.pClearValues = nullptr;
+    // Compared without the UI, like the captures below
+    if (gpuImageCompare)
+    {
+        const VkImage swapchainImage = swapChainManager->getSwapChainImages()[imageIndex];
+        const bool testRunning = isTestModeActive && waterTestingSystem && waterTestingSystem->isTestRunning();
+        const uint32_t tag = testRunning ? static_cast<uint32_t>(simulationFrame) : static_cast<uint32_t>(submittedFrameCount);
+        renderGraph->addPass("ImageCompare", [this, swapchainImage, frameIndex, tag](const RenderGraphPassContext &pass)
+                             { imageCompare->recordCompare(pass.cmd, frameIndex, swapchainImage, tag); })
+            .transferSource(swapchain)
+            .sideEffect();
+    }
 
-    commandBuffer.beginRenderPass(rpInfo, VK_SUBPASS_CONTENTS_INLINE);
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer.getVkCommandBuffer(), 0);
-    commandBuffer.endRenderPass();
+    // Captures leave the UI out; the copy goes into this frame's readback buffer
+    requestFrameReadbacks();
+    if (frameReadback->hasRequests())
+    {
+        const VkImage swapchainImage = swapChainManager->getSwapChainImages()[imageIndex];
+        renderGraph->addPass("Readback", [this, swapchainImage, frameIndex, colorFormat, extent](const RenderGraphPassContext &pass)
+                             { frameReadback->recordCopy(pass.cmd, frameIndex, swapchainImage, colorFormat, extent); })
+            .transferSource(swapchain)
+            .sideEffect();
+    }
 
-    // === END GPU TIMER (before ending command buffer) ===
-    if (waterTestingSystem && isTestModeActive)
+    // Drawn inside the last pass on the swapchain when that pass fits the UI pipeline (imguiRenderPass),
+    // saving a load and store of the frame; after an MSAA resolve or a capture it is a pass of its own
+    if (drawUi && ImGui::GetDrawData())
     {
-        waterTestingSystem->writeTimestampEnd(commandBuffer.getVkCommandBuffer());
+        renderGraph->addOverlay("ImGui", swapchain, [](const RenderGraphPassContext &pass)
+                                { ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), pass.cmd, 0); })
+            .renderPassOnly(); // The backend builds its pipeline for imguiRenderPass
     }
 
-    updateToggleInfo(currentFrame, currentToggleInfo);
+    // Split frames end in the second command buffer, submitted after the first (drawFrame)
+    VkCommandBuffer lastCommands = asyncFrame ? asyncCompute->graphicsCommands() : commandBuffer.getVkCommandBuffer();
+    renderGraph->execute(commandBuffer.getVkCommandBuffer(), asyncFrame ? lastCommands : VK_NULL_HANDLE);
+
+    // === END GPU TIMER (before ending command buffer) ===
+    gpuProfiler->endScope(lastCommands, frameScope);
 
     commandBuffer.end();
+    if (asyncFrame)
+    {
+        asyncCompute->endGraphics();
+    }
 }
 
 void VulkanBase::beginRenderPass(const CommandBuffer &buffer, VkFramebuffer currentBuffer, VkExtent2D extent)
@@ -1950,6 +3647,7 @@ void VulkanBase::recreateSwapChain()
 {
     // Set flag immediately to prevent any command buffer recording
     isRecreatingSwapChain = true;
+    markHitchEvent("Swapchain recreate");
 
     int width = 0, height = 0;
     glfwGetFramebufferSize(window, &width, &height);
@@ -1959,111 +3657,105 @@ void VulkanBase::recreateSwapChain()
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(device);
+    // Only this renderer's frames reference what is replaced below: drain them rather than
+    // idling the whole device (uploads and readbacks on other queues keep running)
+    frameTimeline->waitIdle();
 
-    // ===== MARK WATER MESH AS INVALID DURING RECREATION =====
-    if (waterMesh)
-    {
-        waterMesh->setValid(false);
-    }
+    const VkExtent2D oldExtent = swapChainManager->getSwapChainExtent();
+    const VkFormat oldFormat = swapChainManager->getSwapChainImageFormat();
+    const size_t oldImageCount = swapChainManager->getSwapChainImages().size();
 
-    // ===== CLEANUP SCENE/OFFSCREEN RESOURCES BEFORE SWAP CHAIN RECREATION =====
+    // Framebuffers on the old swapchain views; transients are reallocated on demand at a new extent
+    renderGraph->invalidate();
+    secondaryRecorder->invalidateCache(); // Their render pass, pipelines and scene sets may be replaced below
 
-    // Cleanup scene color texture resources
-    if (sceneColorSampler != VK_NULL_HANDLE)
+    swapChainManager->recreateSwapChain();
+    retiredSwapChainFrames = framesInFlight;
+    if (presentPacer)
     {
-        vkDestroySampler(device, sceneColorSampler, nullptr);
-        sceneColorSampler = VK_NULL_HANDLE;
-    }
-    if (sceneColorImageView != VK_NULL_HANDLE)
-    {
-        vkDestroyImageView(device, sceneColorImageView, nullptr);
-        sceneColorImageView = VK_NULL_HANDLE;
-    }
-    if (sceneColorImage != VK_NULL_HANDLE)
-    {
-        vkDestroyImage(device, sceneColorImage, nullptr);
-        vkFreeMemory(device, sceneColorImageMemory, nullptr);
-        sceneColorImage = VK_NULL_HANDLE;
-        sceneColorImageMemory = VK_NULL_HANDLE;
+        presentPacer->reset();
     }
 
-    if (sceneReflectionFramebuffer != VK_NULL_HANDLE)
-    {
-        vkDestroyFramebuffer(device, sceneReflectionFramebuffer, nullptr);
-        sceneReflectionFramebuffer = VK_NULL_HANDLE;
-    }
-    if (sceneReflectionRenderPass != VK_NULL_HANDLE)
-    {
-        vkDestroyRenderPass(device, sceneReflectionRenderPass, nullptr);
-        sceneReflectionRenderPass = VK_NULL_HANDLE;
-    }
-    if (sceneReflectionImageView != VK_NULL_HANDLE)
-    {
-        vkDestroyImageView(device, sceneReflectionImageView, nullptr);
-        sceneReflectionImageView = VK_NULL_HANDLE;
-    }
-    if (sceneReflectionImage != VK_NULL_HANDLE)
-    {
-        vkDestroyImage(device, sceneReflectionImage, nullptr);
-        sceneReflectionImage = VK_NULL_HANDLE;
-    }
-    if (sceneReflectionImageMemory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(device, sceneReflectionImageMemory, nullptr);
-        sceneReflectionImageMemory = VK_NULL_HANDLE;
-    }
+    const VkExtent2D extent = swapChainManager->getSwapChainExtent();
+    const bool formatChanged = swapChainManager->getSwapChainImageFormat() != oldFormat;
+    const bool extentChanged = extent.width != oldExtent.width || extent.height != oldExtent.height;
 
-    if (sceneRefractionFramebuffer != VK_NULL_HANDLE)
-    {
-        vkDestroyFramebuffer(device, sceneRefractionFramebuffer, nullptr);
-        sceneRefractionFramebuffer = VK_NULL_HANDLE;
-    }
-    if (sceneRefractionRenderPass != VK_NULL_HANDLE)
-    {
-        vkDestroyRenderPass(device, sceneRefractionRenderPass, nullptr);
-        sceneRefractionRenderPass = VK_NULL_HANDLE;
-    }
-    if (sceneRefractionImageView != VK_NULL_HANDLE)
+    // ===== EXTENT-DEPENDENT TARGETS =====
+    // Render passes, pipelines (dynamic viewport/scissor), samplers and the water mesh stay
+    if (extentChanged || formatChanged)
     {
-        vkDestroyImageView(device, sceneRefractionImageView, nullptr);
-        sceneRefractionImageView = VK_NULL_HANDLE;
+        // Release the previous depth target before allocating a new one; the MSAA colour is a graph transient
+        vkDestroyImageView(device, depthImageView, nullptr);
+        GpuMemoryAllocator::get().destroyImage(depthImage);
+        createDepthResources();
+
+        if (gpuCulling)
+        {
+            gpuCulling->createHiZ(depthImageView, extent, msaaSamples, depthSampleable);
+        }
+        if (imageCompare)
+        {
+            imageCompare->resize(extent, swapChainManager->getSwapChainImageFormat());
+        }
+        if (temporalUpscaler)
+        {
+            temporalUpscaler->resize(extent);
+        }
+        if (godRayUpsampler)
+        {
+            godRayUpsampler->resize(extent, depthImageView, msaaSamples, depthSampleable);
+        }
+        if (tileClassifier)
+        {
+            tileClassifier->resize(extent);
+        }
+        if (shadingRates)
+        {
+            shadingRates->resize(extent, swapChainManager->getSwapChainImageFormat());
+            shadingRates->writeDescriptor(waterDescriptorSet);
+        }
+
+        destroySceneTargets();
+        createSceneColorTexture();
+        createSceneReflectionTexture();
+        screenSpaceReflections->resize(extent);
+        offscreenThrottle.invalidate(); // New targets hold nothing to reproject
+
+        // Update water descriptors to point at the newly-created image views
+        // so descriptor sets don't reference destroyed handles.
+        updateWaterDescriptors();
     }
-    if (sceneRefractionImage != VK_NULL_HANDLE)
+
+    // ===== FORMAT-DEPENDENT STATE =====
+    // The render pass is built for the colour format; every scene pipeline is created against it
+    if (formatChanged)
     {
-        vkDestroyImage(device, sceneRefractionImage, nullptr);
-        sceneRefractionImage = VK_NULL_HANDLE;
+        recreateMainPassPipelines();
     }
-    if (sceneRefractionImageMemory != VK_NULL_HANDLE)
+
+    // Render-target layout transitions recorded above
+    UploadContext::get().flush();
+
+    if (swapChainManager->getSwapChainImages().size() != oldImageCount)
     {
-        vkFreeMemory(device, sceneRefractionImageMemory, nullptr);
-        sceneRefractionImageMemory = VK_NULL_HANDLE;
+        createCommandBuffers();
+        createDescriptorSets(); // Indexed by image
     }
 
-    swapChainManager->cleanupSwapChain();
+    std::cout << "[Swapchain] Recreated at " << extent.width << "x" << extent.height
+              << (formatChanged ? ", format changed" : extentChanged ? "" : ", same extent") << "\n";
 
-    swapChainManager->createSwapChain();
-    swapChainManager->createImageViews();
+    // Clear the flag - swap chain recreation is complete
+    isRecreatingSwapChain = false;
+}
 
-    // IMPORTANT: Recreate render passes before recreating resources that depend on them
+// The main render pass and everything drawn in it, for a new colour format or sample count
+void VulkanBase::recreateMainPassPipelines()
+{
+    secondaryRecorder->invalidateCache();
     vkDestroyRenderPass(device, renderPass, nullptr);
     createRenderPass();
 
-    createColorResources();
-    createDepthResources();
-    createFrameBuffers();
-
-    // ===== RECREATE SCENE/OFFSCREEN RESOURCES AFTER SWAP CHAIN =====
-    createSceneColorTexture();
-    createSceneRenderPassAndFramebuffer();
-    createSceneReflectionTexture();
-    createSceneReflectionRenderPassAndFramebuffer();
-    createSceneRefractionRenderPassAndFramebuffer();
-
-    // Update water descriptors to point at the newly-created image views/samplers
-    // so descriptor sets don't reference destroyed handles.
-    updateWaterDescriptors();
-
     createGraphicsPipeline();
 
     // IMPORTANT: Recreate skybox and water pipelines with the new render pass
@@ -2074,7 +3766,6 @@ void VulkanBase::recreateSwapChain()
         skyboxPipeline->destroy(device);
         skyboxPipeline->create(
             device,
-            swapChainManager->getSwapChainExtent(),
             renderPass,
             descriptorSetLayout,
             skyboxDescriptorSetLayout,
@@ -2089,19 +3780,22 @@ void VulkanBase::recreateSwapChain()
         waterPipeline->destroy(device);
         waterPipeline->create(
             device,
-            swapChainManager->getSwapChainExtent(),
             renderPass,
             descriptorSetLayout,
             waterDescriptorSetLayout,
             msaaSamples,
             false);
     }
+    if (waterTessPipeline)
+    {
+        waterTessPipeline->destroy(device);
+        waterTessPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples, false, true);
+    }
     if (underwaterWaterPipeline)
     {
         underwaterWaterPipeline->destroy(device);
         underwaterWaterPipeline->create(
             device,
-            swapChainManager->getSwapChainExtent(),
             renderPass,
             descriptorSetLayout,
             waterDescriptorSetLayout,
@@ -2110,13 +3804,12 @@ void VulkanBase::recreateSwapChain()
         //    std::cout << "[DEBUG] recreateSwapChain: Water pipeline recreated\n";
     }
 
-    // Recreate sunrays pipeline with new swap chain extent
+    // Sunrays full-screen pipeline
     if (sunraysPipeline)
     {
         sunraysPipeline->destroy(device);
         sunraysPipeline->create(
             device,
-            swapChainManager->getSwapChainExtent(),
             renderPass,
             descriptorSetLayout,
             waterDescriptorSetLayout,
@@ -2124,24 +3817,101 @@ void VulkanBase::recreateSwapChain()
             true); // isSunraysPipeline = true
     }
 
-    // Recreate ImGui framebuffers with new swapchain images
-    for (auto fb : imguiFramebuffers)
+    // The half-res effect pipelines use the upscaler's own render pass; only the composite draws in this one
+    if (temporalUpscaler)
+    {
+        temporalUpscaler->createCompositePipeline(renderPass, msaaSamples);
+    }
+    if (godRayUpsampler)
+    {
+        godRayUpsampler->createPipeline(swapChainManager->getSwapChainImageFormat());
+    }
+    if (marineSnow)
+    {
+        marineSnow->createPipelines(renderPass, msaaSamples);
+    }
+}
+
+void VulkanBase::setMsaaSamples(VkSampleCountFlagBits samples)
+{
+    requestedMsaaSamples = samples;
+    if (samples == msaaSamples)
+        return;
+
+    // Everything below is built for the sample count; only this renderer's frames use it
+    frameTimeline->waitIdle();
+    msaaSamples = samples;
+    renderGraph->invalidate(); // The transient MSAA colour at the old count
+
+    vkDestroyImageView(device, depthImageView, nullptr);
+    GpuMemoryAllocator::get().destroyImage(depthImage);
+    createDepthResources();
+
+    const VkExtent2D extent = swapChainManager->getSwapChainExtent();
+    if (gpuCulling)
+    {
+        gpuCulling->createHiZ(depthImageView, extent, msaaSamples, depthSampleable);
+    }
+    if (godRayUpsampler)
     {
-        vkDestroyFramebuffer(device, fb, nullptr);
+        godRayUpsampler->resize(extent, depthImageView, msaaSamples, depthSampleable);
     }
-    imguiFramebuffers.clear();
-    createImGuiFramebuffers();
+    screenSpaceReflections = std::make_unique<ScreenSpaceReflections>(device, extent, depthFormat, msaaSamples, depthSampleable);
+    updateWaterDescriptors(); // The reflection pyramid was replaced
 
-    createCommandBuffers();
+    // Scene pipeline variants are kept per sample count (MainPipelineKey), so switching back reuses them
+    recreateMainPassPipelines();
+    UploadContext::get().flush();
 
-    // ===== MARK WATER MESH AS VALID AFTER RECREATION =====
-    if (waterMesh)
+    std::cout << "[VulkanBase] MSAA " << msaaSamples << "x\n";
+}
+
+// The most samples at or below 'requested' (0: the maximum) the colour and depth attachments both support.
+// Never fewer than 2: the main pass always resolves into the swapchain
+VkSampleCountFlagBits VulkanBase::getUsableSampleCount(uint32_t requested) const
+{
+    if (requested == 0)
+        return maxMsaaSamples;
+
+    VkSampleCountFlagBits usable = maxMsaaSamples;
+    for (uint32_t samples = maxMsaaSamples; samples >= 2; samples >>= 1)
     {
-        waterMesh->setValid(true);
+        if (usableSampleCounts & samples)
+        {
+            usable = static_cast<VkSampleCountFlagBits>(samples);
+            if (samples <= requested)
+                break;
+        }
     }
+    return usable;
+}
 
-    // Clear the flag - swap chain recreation is complete
-    isRecreatingSwapChain = false;
+void VulkanBase::destroySceneTargets()
+{
+    // Images and views only: the samplers do not depend on the extent
+    if (sceneColorImageView != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(device, sceneColorImageView, nullptr);
+        sceneColorImageView = VK_NULL_HANDLE;
+    }
+    if (sceneColorImage != VK_NULL_HANDLE)
+    {
+        GpuMemoryAllocator::get().destroyImage(sceneColorImage);
+        sceneColorImage = VK_NULL_HANDLE;
+        sceneColorImageMemory = VK_NULL_HANDLE;
+    }
+
+    if (sceneReflectionImageView != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(device, sceneReflectionImageView, nullptr);
+        sceneReflectionImageView = VK_NULL_HANDLE;
+    }
+    if (sceneReflectionImage != VK_NULL_HANDLE)
+    {
+        GpuMemoryAllocator::get().destroyImage(sceneReflectionImage);
+        sceneReflectionImage = VK_NULL_HANDLE;
+    }
+    sceneReflectionImageMemory = VK_NULL_HANDLE;
 }
 
 bool VulkanBase::checkValidationLayerSupport()
@@ -2186,11 +3956,11 @@ bool VulkanBase::isDeviceSuitable(VkPhysicalDevice device)
     VkUtils::QueueFamilyIndices indices = VkUtils::FindQueueFamilies(device, surface);
 
     // Check if the required device extensions are supported
-    bool extensionsSupported = checkDeviceExtensionSupport(device);
+    bool extensionsSupported = headless || checkDeviceExtensionSupport(device);
 
     // Verify if the swap chain is adequate (non-empty formats and present modes)
-    bool swapChainAdequate = false;
-    if (extensionsSupported)
+    bool swapChainAdequate = headless;
+    if (extensionsSupported && !headless)
     {
         VkUtils::SwapChainSupportDetails swapChainSupport = VkUtils::QuerySwapChainSupport(device, surface);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -2206,13 +3976,15 @@ bool VulkanBase::isDeviceSuitable(VkPhysicalDevice device)
     // std::cout << "  Anisotropy Support: " << (deviceFeatures.samplerAnisotropy ? "Yes" : "No") << std::endl;
 
     // Return true if the device is suitable for use
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && deviceFeatures.samplerAnisotropy;
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && deviceFeatures.samplerAnisotropy &&
+           BindlessTable::isSupported(device) && TimelineSemaphore::isSupported(device);
 }
 
 std::vector<const char *> VulkanBase::getRequiredExtensions()
 {
+    // Headless needs no surface extensions
     uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    const char **glfwExtensions = headless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
     std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
 
@@ -2242,91 +4014,124 @@ bool VulkanBase::checkDeviceExtensionSupport(VkPhysicalDevice device)
     return requiredExtensions.empty();
 }
 
-void VulkanBase::createAdditionalTextures()
+void VulkanBase::createMaterialTable()
 {
-    // Load and create Metalness Texture
-    loadTexture("textures/vehicle_metalness.png", metalnessImage, metalnessImageMemory);
-    metalnessImageView = createImageView(metalnessImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
+    materialTable = std::make_unique<MaterialTable>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT, *bindlessTable,
+                                                    *textureStreamer, textureSampler);
+
+    // Material 0: the vehicle's maps, what objects without a material of their own are drawn with
+    MaterialDescription vehicle;
+    vehicle.maps[MaterialTable::MapBase] = "textures/texture.png";
+    vehicle.maps[MaterialTable::MapMetalness] = "textures/vehicle_metalness.png";
+    vehicle.maps[MaterialTable::MapNormal] = "textures/vehicle_normal.png";
+    vehicle.maps[MaterialTable::MapSpecular] = "textures/vehicle_specular.png";
+    materialTable->add(vehicle);
+}
 
-    // Load and create Normal Texture
-    loadTexture("textures/vehicle_normal.png", normalImage, normalImageMemory);
-    normalImageView = createImageView(normalImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
+void VulkanBase::addSceneDescription(SceneDescription description)
+{
+    // File ids: 0 the default, n the file's material n - 1; unknown ids fall back to the default
+    std::vector<uint32_t> remap(description.materials.size() + 1, 0);
+    for (size_t i = 0; i < description.materials.size(); i++)
+    {
+        remap[i + 1] = materialTable->add(description.materials[i]);
+    }
+    for (SceneInstance &instance : description.instances)
+    {
+        instance.materialId = instance.materialId < remap.size() ? remap[instance.materialId] : 0;
+    }
+    scene.add(description);
+}
 
-    // Load and create Specular Texture
-    loadTexture("textures/vehicle_specular.png", specularImage, specularImageMemory);
-    specularImageView = createImageView(specularImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
+bool VulkanBase::isTextureFormatUsable(VkFormat format) const
+{
+    if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !textureCompressionBCSupported)
+    {
+        return false;
+    }
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK && !textureCompressionASTCSupported)
+    {
+        return false;
+    }
 
-    // If using a common sampler for these textures:
-    createTextureSampler();
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+VkFormat VulkanBase::uploadCookedTexture(const Ktx2::Image &image, VkImage &textureImage, VkDeviceMemory &textureImageMemory)
+{
+    const VkFormat format = image.format;
+    mipLevels = static_cast<uint32_t>(image.levels.size());
+    createImage(image.width, image.height, mipLevels, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+
+    // Every level is already in the file: one copy per level, no blits
+    std::vector<VkBufferImageCopy> regions(mipLevels);
+    for (uint32_t level = 0; level < mipLevels; level++)
+    {
+        VkBufferImageCopy &region = regions[level];
+        region = {};
+        region.bufferOffset = image.levels[level].offset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {std::max(image.width >> level, 1u), std::max(image.height >> level, 1u), 1};
+    }
+    UploadContext::get().uploadImage(textureImage, image.bytes(), image.byteSize(), regions, mipLevels, 1);
+    UploadContext::get().transitionToShaderRead(textureImage, mipLevels);
+    return format;
 }
 
-void VulkanBase::loadTexture(const std::string &filePath, VkImage &textureImage, VkDeviceMemory &textureImageMemory)
+VkFormat VulkanBase::loadTexture(const std::string &filePath, VkImage &textureImage, VkDeviceMemory &textureImageMemory,
+                                 TextureCompressor::Kind kind)
 {
-    int texWidth, texHeight, texChannels;
-    stbi_uc *pixels = stbi_load(filePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    if (!pixels)
+    CPU_ZONE("VulkanBase::loadTexture");
+    // Usually already decoded by prefetchTextures
+    TextureDecoder::Decoded decoded = textureDecoder.take(filePath);
+    if (decoded.isCooked())
     {
-        throw std::runtime_error("failed to load texture image: " + filePath);
+        if (isTextureFormatUsable(decoded.cooked.format))
+        {
+            return uploadCookedTexture(decoded.cooked, textureImage, textureImageMemory);
+        }
+        std::cout << "[Texture] " << filePath << ": cooked format " << decoded.cooked.format << " not supported, using the source\n";
+        decoded = TextureDecoder::decodeSource(filePath);
     }
 
+    const int texWidth = static_cast<int>(decoded.width);
+    const int texHeight = static_cast<int>(decoded.height);
     VkDeviceSize imageSize = texWidth * texHeight * 4;
     mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
-
-    stbi_image_free(pixels);
-
-    createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+    // Normal and dudv maps hold vectors: no sRGB decode on sampling, and mips blitted on the stored values
+    const VkFormat format = kind == TextureCompressor::Kind::Color ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
 
-    transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-    copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-    generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+    // Copy on the transfer stream, mips + final transition on graphics, both in the open upload batch
+    UploadContext::get().uploadImage(textureImage, decoded.pixels.get(), imageSize, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), mipLevels);
+    generateMipmaps(textureImage, format, texWidth, texHeight, mipLevels);
+    return format;
 }
 
-void VulkanBase::createTextureImage()
+void VulkanBase::prefetchTextures()
 {
-    int texWidth, texHeight, texChannels;
-    stbi_uc *pixels = stbi_load("textures/texture.png", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-    mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-
-    if (!pixels)
-    {
-        throw std::runtime_error("failed to load texture image!");
-    }
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
-
-    stbi_image_free(pixels);
-
-    createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-
-    transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-    copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    // transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    // Everything initVulkan loads through loadTexture, plus the skybox cross; the material maps stream instead
+    textureDecoder.prefetch({"textures/water_normal.jpg", "textures/water_dudv.jpg", "textures/water_caustic.jpg",
+                             "textures/skybox.jpg"},
+                            jobSystem.get());
+}
 
-    generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+void VulkanBase::createTextureImage()
+{
+    // Decoded on the streamer's thread and uploaded over the first frames; sampled as a placeholder until then
+    textureStreamer = std::make_unique<TextureStreamer>(device, MAX_FRAMES_IN_FLIGHT, [this](VkFormat format)
+                                                        { return isTextureFormatUsable(format); });
 }
 
 void VulkanBase::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory)
@@ -2351,43 +4156,9 @@ void VulkanBase::createImage(uint32_t width, uint32_t height, uint32_t mipLevels
         throw std::runtime_error("failed to create image!");
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device, image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = VkUtils::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    vkBindImageMemory(device, image, imageMemory, 0);
-}
-
-void VulkanBase::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-{
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {
-        width,
-        height,
-        1};
-
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    endSingleTimeCommands(commandBuffer);
+    // Sub-allocated from the shared pool; release with destroyImage, not vkFreeMemory
+    imageMemory = GpuMemoryAllocator::get().allocateImage(image, properties, tiling == VK_IMAGE_TILING_LINEAR,
+                                                         GpuMemoryAllocator::categorize(usage));
 }
 
 void VulkanBase::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory)
@@ -2403,25 +4174,8 @@ void VulkanBase::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMem
         throw std::runtime_error("failed to create buffer!");
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = VkUtils::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    }
-
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
-}
-
-void VulkanBase::createTextureImageView()
-{
-    textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
+    // Sub-allocated from the shared pool; release with VkUtils::DestroyBuffer, not vkFreeMemory
+    bufferMemory = GpuMemoryAllocator::get().allocateBuffer(buffer, properties, GpuMemoryAllocator::categorize(usage, properties));
 }
 
 VkImageView VulkanBase::createCubemapImageView(VkImage image, VkFormat format)
@@ -2448,9 +4202,20 @@ VkImageView VulkanBase::createCubemapImageView(VkImage image, VkFormat format)
 
 void VulkanBase::createDepthResources()
 {
-    VkFormat depthFormat = findDepthFormat();
+    depthFormat = findDepthFormat();
+
+    // Sampled by the Hi-Z build and the god ray upsample when the format allows it
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, depthFormat, &formatProperties);
+    depthSampleable = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+
+    VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (depthSampleable)
+    {
+        depthUsage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+    }
 
-    createImage(swapChainManager->getSwapChainExtent().width, swapChainManager->getSwapChainExtent().height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+    createImage(swapChainManager->getSwapChainExtent().width, swapChainManager->getSwapChainExtent().height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, depthUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
     depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1, false);
 }
 
@@ -2513,44 +4278,14 @@ VkSampleCountFlagBits VulkanBase::getMaxUsableSampleCount()
     return VK_SAMPLE_COUNT_1_BIT;
 }
 
-void VulkanBase::createColorResources()
-{
-    VkFormat colorFormat = swapChainManager->getSwapChainImageFormat();
-
-    createImage(swapChainManager->getSwapChainExtent().width, swapChainManager->getSwapChainExtent().height, 1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
-    colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1, false);
-}
-
-void VulkanBase::createLightInfoBuffers()
+void VulkanBase::updateLightInfoBuffer()
 {
-    VkDeviceSize bufferSize = sizeof(LightInfo);
+    LightInfo lightInfo{};
 
-    lightInfoBuffers.resize(swapChainManager->getSwapChainImages().size());
-    lightInfoBuffersMemory.resize(swapChainManager->getSwapChainImages().size());
-
-    for (size_t i = 0; i < swapChainManager->getSwapChainImages().size(); i++)
-    {
-        createBuffer(bufferSize,
-                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     lightInfoBuffers[i],
-                     lightInfoBuffersMemory[i]);
-    }
-}
-
-void VulkanBase::updateLightInfoBuffer(uint32_t currentImage)
-{
-    LightInfo lightInfo;
-
-    // Update light 1
-    lightInfo.lights[0].position = light0Position;
-    lightInfo.lights[0].color = light0Color;
-    lightInfo.lights[0].intensity = light0Intensity;
-
-    // Update light 2
-    lightInfo.lights[1].position = light1Position;
-    lightInfo.lights[1].color = light1Color;
-    lightInfo.lights[1].intensity = light1Intensity;
+    // The sun (light 0), directional
+    lightInfo.sun.position = light0Position;
+    lightInfo.sun.color = light0Color;
+    lightInfo.sun.intensity = light0Intensity;
 
     // Set ambient light properties
     lightInfo.ambientColor = ambientColor;
@@ -2559,11 +4294,46 @@ void VulkanBase::updateLightInfoBuffer(uint32_t currentImage)
     // Update the camera/view position
     lightInfo.viewPos = camera.getPosition();
 
+    // Point lights: the secondary light, the scattered ones, then the scene's for this frame only, binned
+    // against this frame's camera
+    if (pointLights.size() != scatteredLightCount + 1)
+    {
+        scatterPointLights();
+    }
+    pointLights[0] = {light1Position, light1Radius, light1Color, light1Intensity};
+    scene.gatherLights(pointLights);
+    const VkExtent2D viewExtent = getViewExtent();
+    clusteredLights->setClustering(clusteredLighting);
+    clusteredLights->update(static_cast<uint32_t>(currentFrame), pointLights, frameUBO.view, glm::radians(camera.zoom),
+                            viewExtent.width / (float)viewExtent.height, 1000.0f, lightInfo);
+    pointLights.resize(scatteredLightCount + 1);
+
     // Update the uniform buffer with this data
-    void *data;
-    vkMapMemory(device, lightInfoBuffersMemory[currentImage], 0, sizeof(LightInfo), 0, &data);
-    memcpy(data, &lightInfo, sizeof(LightInfo));
-    vkUnmapMemory(device, lightInfoBuffersMemory[currentImage]);
+    mainView.uniformOffsets[1] = uniformArena->push(lightInfo);
+}
+
+void VulkanBase::scatterPointLights()
+{
+    // Fixed seed: the same field of lights for a given count, run to run
+    std::mt19937 rng(20240611u);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    pointLights.resize(1);
+    pointLights.reserve(scatteredLightCount + 1);
+    for (uint32_t i = 0; i < scatteredLightCount; i++)
+    {
+        // Over the sea floor (OceanBottomMesh: 200 units wide, 50 deep), hanging above it
+        PointLight light{};
+        light.position.x = unit(rng) * 200.0f - 100.0f;
+        light.position.y = -48.0f + unit(rng) * 40.0f;
+        light.position.z = unit(rng) * 200.0f - 100.0f;
+        light.radius = scatteredLightRadius * (0.6f + 0.6f * unit(rng));
+        // Cyan to green, the odd one deep blue
+        light.color = unit(rng) < 0.15f ? glm::vec3(0.2f, 0.35f, 1.0f)
+                                        : glm::mix(glm::vec3(0.1f, 0.85f, 1.0f), glm::vec3(0.35f, 1.0f, 0.45f), unit(rng));
+        light.intensity = scatteredLightIntensity * (0.5f + unit(rng));
+        pointLights.push_back(light);
+    }
 }
 
 void VulkanBase::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
@@ -2577,7 +4347,8 @@ void VulkanBase::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t te
         throw std::runtime_error("texture image format does not support linear blitting!");
     }
 
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    // Recorded after the texture's copy in the same upload batch
+    VkCommandBuffer commandBuffer = UploadContext::get().graphicsCommands();
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -2654,8 +4425,6 @@ void VulkanBase::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t te
                          0, nullptr,
                          0, nullptr,
                          1, &barrier);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
 VkFormat VulkanBase::findDepthFormat()
@@ -2668,22 +4437,17 @@ VkFormat VulkanBase::findDepthFormat()
 
 void VulkanBase::createSyncObjects()
 {
+    // Completion is tracked by frameTimeline; these binary semaphores only order acquire and present
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
         if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
@@ -2692,7 +4456,8 @@ void VulkanBase::createSyncObjects()
 
 void VulkanBase::createCommandBuffers()
 {
-    commandBuffers.resize(swapChainFramebuffers.size());
+    // Recorded per frame slot, not per image
+    commandBuffers.resize(std::max<size_t>(swapChainManager->getSwapChainImageViews().size(), MAX_FRAMES_IN_FLIGHT));
     // std::cout << "Resized commandBuffers to " << commandBuffers.size() << std::endl; //uncommnet to see the command buffer size
 
     for (size_t i = 0; i < commandBuffers.size(); i++)
@@ -2703,18 +4468,26 @@ void VulkanBase::createCommandBuffers()
 
 void VulkanBase::createUniformBuffers()
 {
-    VkDeviceSize bufferSize = sizeof(UBO);
-
-    uniformBuffers.resize(swapChainManager->getSwapChainImages().size());
-    uniformBuffersMemory.resize(swapChainManager->getSwapChainImages().size());
+    // UBO, LightInfo and ToggleInfo for every frame in flight, with headroom for per-object blocks
+    uniformArena = std::make_unique<UniformArena>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT, 256 * 1024);
+    waterParamsBuffer = std::make_unique<WaterParamsBuffer>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT);
+}
 
-    for (size_t i = 0; i < swapChainManager->getSwapChainImages().size(); i++)
+void VulkanBase::createGpuCulling()
+{
+    if (!gpuDrivenSupported)
     {
-        std::tie(uniformBuffers[i], uniformBuffersMemory[i]) = VkUtils::CreateBuffer(
-            device, physicalDevice, bufferSize,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        std::cout << "[GpuCulling] multiDrawIndirect/drawIndirectFirstInstance unsupported, CPU submission only\n";
+        return;
     }
+
+    gpuCulling = std::make_unique<GpuCulling>(device, physicalDevice, *uniformArena, MAX_FRAMES_IN_FLIGHT,
+                                              scene.getObjectCount(), drawIndirectCountSupported);
+    gpuCulling->createHiZ(depthImageView, swapChainManager->getSwapChainExtent(), msaaSamples, depthSampleable);
+
+    std::cout << "[GpuCulling] Ready: " << scene.getObjectCount() << " objects, "
+              << (gpuCulling->hasDrawIndirectCount() ? "vkCmdDrawIndexedIndirectCount" : "vkCmdDrawIndexedIndirect fallback")
+              << (gpuCulling->isHiZAvailable() ? ", Hi-Z available" : ", no Hi-Z") << "\n";
 }
 
 void VulkanBase::createDescriptorSetLayout()
@@ -2722,67 +4495,63 @@ void VulkanBase::createDescriptorSetLayout()
     // UBO for the transformation matrices
     VkDescriptorSetLayoutBinding uboLayoutBinding1{};
     uboLayoutBinding1.binding = 0;
-    uboLayoutBinding1.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboLayoutBinding1.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     uboLayoutBinding1.descriptorCount = 1;
-    uboLayoutBinding1.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    uboLayoutBinding1.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | getTessellationStages();
     uboLayoutBinding1.pImmutableSamplers = nullptr;
 
-    // Sampler for the base texture (albedo/diffuse)
-    VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-    samplerLayoutBinding.binding = 1;
-    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.descriptorCount = 1;
-    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    samplerLayoutBinding.pImmutableSamplers = nullptr;
-
     // UBO for the light information
     VkDescriptorSetLayoutBinding uboLayoutBinding2{};
     uboLayoutBinding2.binding = 2;
-    uboLayoutBinding2.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboLayoutBinding2.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     uboLayoutBinding2.descriptorCount = 1;
     uboLayoutBinding2.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     uboLayoutBinding2.pImmutableSamplers = nullptr;
 
-    // Sampler for the metalness texture
-    VkDescriptorSetLayoutBinding metalnessLayoutBinding{};
-    metalnessLayoutBinding.binding = 3;
-    metalnessLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    metalnessLayoutBinding.descriptorCount = 1;
-    metalnessLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    metalnessLayoutBinding.pImmutableSamplers = nullptr;
-
-    // Sampler for the normal texture
-    VkDescriptorSetLayoutBinding normalLayoutBinding{};
-    normalLayoutBinding.binding = 4;
-    normalLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    normalLayoutBinding.descriptorCount = 1;
-    normalLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    normalLayoutBinding.pImmutableSamplers = nullptr;
-
-    // Sampler for the specular texture
-    VkDescriptorSetLayoutBinding specularLayoutBinding{};
-    specularLayoutBinding.binding = 5;
-    specularLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    specularLayoutBinding.descriptorCount = 1;
-    specularLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    specularLayoutBinding.pImmutableSamplers = nullptr;
+    // Bindings 1 and 3-5 (the material maps) and 7 (irradiance SH) moved to the bindless table
 
     VkDescriptorSetLayoutBinding toggleInfoLayoutBinding{};
     toggleInfoLayoutBinding.binding = 6;
-    toggleInfoLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    toggleInfoLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     toggleInfoLayoutBinding.descriptorCount = 1;
     toggleInfoLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     toggleInfoLayoutBinding.pImmutableSamplers = nullptr;
 
+    // Image-based lighting: prefiltered sky, split-sum BRDF LUT
+    VkDescriptorSetLayoutBinding prefilteredLayoutBinding{};
+    prefilteredLayoutBinding.binding = 8;
+    prefilteredLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    prefilteredLayoutBinding.descriptorCount = 1;
+    prefilteredLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    prefilteredLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding brdfLutLayoutBinding{};
+    brdfLutLayoutBinding.binding = 9;
+    brdfLutLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    brdfLutLayoutBinding.descriptorCount = 1;
+    brdfLutLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    brdfLutLayoutBinding.pImmutableSamplers = nullptr;
+
+    // Point lights and their cluster lists (ClusteredLights.h), whole buffers; LightInfo has the frame's offsets
+    VkDescriptorSetLayoutBinding pointLightLayoutBinding{};
+    pointLightLayoutBinding.binding = ClusteredLights::kLightBinding;
+    pointLightLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pointLightLayoutBinding.descriptorCount = 1;
+    pointLightLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pointLightLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding lightClusterLayoutBinding = pointLightLayoutBinding;
+    lightClusterLayoutBinding.binding = ClusteredLights::kClusterBinding;
+
     // Combine all bindings into a single array
     std::array<VkDescriptorSetLayoutBinding, 7> bindings = {
         uboLayoutBinding1,
-        samplerLayoutBinding,
         uboLayoutBinding2,
-        metalnessLayoutBinding,
-        normalLayoutBinding,
-        specularLayoutBinding,
-        toggleInfoLayoutBinding};
+        toggleInfoLayoutBinding,
+        prefilteredLayoutBinding,
+        brdfLutLayoutBinding,
+        pointLightLayoutBinding,
+        lightClusterLayoutBinding};
 
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -2793,6 +4562,7 @@ void VulkanBase::createDescriptorSetLayout()
     {
         throw std::runtime_error("failed to create descriptor set layout!");
     }
+    descriptorAllocator->registerLayout(descriptorSetLayout, bindings.data(), static_cast<uint32_t>(bindings.size()));
 }
 
 void VulkanBase::createGraphicsPipeline()
@@ -2807,14 +4577,85 @@ void VulkanBase::createGraphicsPipeline()
         throw std::runtime_error("createGraphicsPipeline: renderPass is imguiRenderPass! This is a critical bug.");
     }
 
+    // Variants bake the render pass: a change of swapchain format rebuilds them all
+    destroyMainPipelines();
+
     shader3D = std::make_unique<Shader3D>(device, "shaders/3d_shader.vert.spv", "shaders/3d_shader.frag.spv");
+    // Instanced draws need no device feature; only the GPU-culled indirect draws do
+    indirectShader3D = std::make_unique<Shader3D>(device, "shaders/3d_shader_indirect.vert.spv", "shaders/3d_shader.frag.spv");
+    lodShader3D = std::make_unique<Shader3D>(device, "shaders/3d_shader_lod.vert.spv", "shaders/3d_shader.frag.spv");
+
+    // The layout outlives the variants: it does not depend on the swapchain
+    if (pipelineLayout == VK_NULL_HANDLE)
+    {
+        std::array<VkDescriptorSetLayout, 4> setLayouts = {descriptorSetLayout, waterDescriptorSetLayout,
+                                                           bindlessTable->getLayout(), shadowCascades->getSetLayout()};
+
+        // --- CRITICAL FIX START ---
+        // Define the Push Constant Range for the MAIN pipeline (Ocean Floor)
+        // This must match the WaterPipeline range (16 bytes, Vertex + Fragment)
+        VkPushConstantRange pushRange{};
+        pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushRange.offset = 0;
+        pushRange.size = kMaterialPushOffset;
+        // Material table indices follow, fragment only (3d_shader.frag)
+        std::array<VkPushConstantRange, 2> pushRanges = {pushRange, {}};
+        pushRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushRanges[1].offset = kMaterialPushOffset;
+        pushRanges[1].size = sizeof(MaterialPush);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+
+        // Enable the push constant range
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = pushRanges.data();
+        // --- CRITICAL FIX END ---
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+    }
+
+    // Every variant the UI can reach, compiled in parallel (the pipeline cache is internally synchronised)
+    std::vector<MainPipelineKey> keys;
+    for (VkPolygonMode polygonMode : {VK_POLYGON_MODE_FILL, VK_POLYGON_MODE_LINE})
+    {
+        keys.push_back({polygonMode, msaaSamples, false, true});
+        keys.push_back({polygonMode, msaaSamples, false, true, true});
+        keys.push_back({polygonMode, msaaSamples, true, true});
+    }
+    std::vector<VkPipeline> built(keys.size(), VK_NULL_HANDLE);
+    jobSystem->run(static_cast<uint32_t>(keys.size()), [&](uint32_t jobIndex, uint32_t)
+                   { built[jobIndex] = buildMainPipeline(keys[jobIndex]); });
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        mainPipelines[keys[i]] = built[i];
+    }
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptionsArray = Vertex::getAttributeDescriptions();
-    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(
-        attributeDescriptionsArray.begin(), attributeDescriptionsArray.end());
+    updatePipelineIfNeeded();
+    std::cout << "[Pipeline] Built " << keys.size() << " main pipeline variants\n";
+}
+
+VkPipeline VulkanBase::buildMainPipeline(const MainPipelineKey &key) const
+{
+    // Scene meshes are packed (PackedVertex); the ocean bottom's CDLOD tile carries only cell corners
+    auto bindingDescription = key.lodGrid ? CdlodGrid::getVertexBindingDescription() : PackedVertex::getBindingDescription();
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    if (key.lodGrid)
+    {
+        attributeDescriptions.push_back(CdlodGrid::getVertexAttributeDescription());
+    }
+    else
+    {
+        auto attributeDescriptionsArray = PackedVertex::getAttributeDescriptions();
+        attributeDescriptions.assign(attributeDescriptionsArray.begin(), attributeDescriptionsArray.end());
+    }
 
-    if (wireframeEnabled)
+    if (key.polygonMode != VK_POLYGON_MODE_FILL)
     {
         attributeDescriptions.erase(
             std::remove_if(attributeDescriptions.begin(), attributeDescriptions.end(),
@@ -2825,10 +4666,25 @@ void VulkanBase::createGraphicsPipeline()
             attributeDescriptions.end());
     }
 
+    // GPU-driven variant: same state and layout, model matrix from the per-instance object table
+    std::vector<VkVertexInputBindingDescription> bindings = {bindingDescription};
+    if (key.indirect)
+    {
+        bindings.push_back(GpuCulling::getInstanceBindingDescription());
+        auto instanceAttributes = GpuCulling::getInstanceAttributeDescriptions();
+        attributeDescriptions.insert(attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+    }
+    else if (key.lodGrid)
+    {
+        bindings.push_back(CdlodGrid::getInstanceBindingDescription());
+        auto tileAttributes = CdlodGrid::getInstanceAttributeDescriptions();
+        attributeDescriptions.insert(attributeDescriptions.end(), tileAttributes.begin(), tileAttributes.end());
+    }
+
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindings.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -2837,30 +4693,23 @@ void VulkanBase::createGraphicsPipeline()
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChainManager->getSwapChainExtent().width);
-    viewport.height = static_cast<float>(swapChainManager->getSwapChainExtent().height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChainManager->getSwapChainExtent();
-
+    // Viewport & scissor are set per pass (recordPassJobs), so variants survive a resize
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = wireframeEnabled ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
+    rasterizer.polygonMode = key.polygonMode;
     rasterizer.lineWidth = 1.0f;
     rasterizer.cullMode = VK_CULL_MODE_NONE;
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
@@ -2868,20 +4717,21 @@ void VulkanBase::createGraphicsPipeline()
 
     VkPipelineMultisampleStateCreateInfo multisampling{};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_TRUE;
+    multisampling.sampleShadingEnable = key.depthOnly ? VK_FALSE : VK_TRUE;
     multisampling.minSampleShading = .25f;
-    multisampling.rasterizationSamples = msaaSamples;
+    multisampling.rasterizationSamples = key.samples;
 
+    // Without depth writes the depth is the pre-pass', from the same vertex shader: equal depth passes
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
     depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthWriteEnable = key.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = key.depthWrite ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_LESS_OR_EQUAL;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.stencilTestEnable = VK_FALSE;
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.colorWriteMask = key.depthOnly ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
     colorBlendAttachment.blendEnable = VK_FALSE;
 
     VkPipelineColorBlendStateCreateInfo colorBlending{};
@@ -2891,33 +4741,12 @@ void VulkanBase::createGraphicsPipeline()
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
 
-    std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, waterDescriptorSetLayout};
-
-    // --- CRITICAL FIX START ---
-    // Define the Push Constant Range for the MAIN pipeline (Ocean Floor)
-    // This must match the WaterPipeline range (96 bytes, Vertex + Fragment)
-    VkPushConstantRange pushRange{};
-    pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushRange.offset = 0;
-    pushRange.size = 96;
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
-
-    // Enable the push constant range
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
-    // --- CRITICAL FIX END ---
-
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    auto shaderStages = (key.indirect ? indirectShader3D : key.lodGrid ? lodShader3D : shader3D)->getShaderStages();
+    if (key.depthOnly)
     {
-        throw std::runtime_error("failed to create pipeline layout!");
+        shaderStages.resize(1); // Vertex stage only
     }
 
-    auto shaderStages = shader3D->getShaderStages();
-
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
@@ -2925,6 +4754,7 @@ void VulkanBase::createGraphicsPipeline()
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &inputAssembly;
     pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
@@ -2934,281 +4764,329 @@ void VulkanBase::createGraphicsPipeline()
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    DynamicRendering::apply(pipelineInfo, renderingInfo);
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
     {
-        throw std::runtime_error("failed to create graphics pipeline!");
+        throw std::runtime_error(key.indirect ? "failed to create indirect graphics pipeline!" : "failed to create graphics pipeline!");
     }
-
-    std::cout << "[DEBUG] createGraphicsPipeline: Created graphics pipeline with Push Constants (Size 80)\n";
+    return pipeline;
 }
 
-void VulkanBase::updatePipelineIfNeeded()
+VkPipeline VulkanBase::getMainPipeline(const MainPipelineKey &key)
 {
-    if (currentWireframeState != wireframeEnabled)
-    {
-        vkDeviceWaitIdle(device);
-        // std::cout << "[DEBUG] updatePipelineIfNeeded: Destroying graphics pipeline: " << graphicsPipeline << "\n";
-        // std::cout << "[DEBUG] updatePipelineIfNeeded: Current renderPass: " << renderPass << "\n";
-        // std::cout << "[DEBUG] updatePipelineIfNeeded: ImGui renderPass: " << imguiRenderPass << "\n";
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        createGraphicsPipeline();
-        // std::cout << "[DEBUG] updatePipelineIfNeeded: Recreated graphics pipeline: " << graphicsPipeline << "\n";
-        currentWireframeState = wireframeEnabled;
-    }
+    auto it = mainPipelines.find(key);
+    if (it != mainPipelines.end())
+        return it->second;
+
+    // Not prebuilt: compile now; creating a pipeline never needs the device idle
+    markHitchEvent("Pipeline compile");
+    VkPipeline pipeline = buildMainPipeline(key);
+    mainPipelines[key] = pipeline;
+    return pipeline;
 }
 
-void VulkanBase::createToggleInfoBuffers()
+void VulkanBase::destroyMainPipelines()
 {
-    VkDeviceSize bufferSize = sizeof(ToggleInfo);
-
-    toggleInfoBuffers.resize(swapChainManager->getSwapChainImages().size());
-    toggleInfoBuffersMemory.resize(swapChainManager->getSwapChainImages().size());
-
-    for (size_t i = 0; i < toggleInfoBuffers.size(); i++)
-    {
-        createBuffer(bufferSize,
-                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     toggleInfoBuffers[i], toggleInfoBuffersMemory[i]);
-    }
+    for (auto &entry : mainPipelines)
+    {
+        vkDestroyPipeline(device, entry.second, nullptr);
+    }
+    mainPipelines.clear();
+    graphicsPipeline = VK_NULL_HANDLE;
+    indirectGraphicsPipeline = VK_NULL_HANDLE;
+    oceanBottomPipeline = VK_NULL_HANDLE;
+    prePassPipeline = VK_NULL_HANDLE;
+    prePassIndirectPipeline = VK_NULL_HANDLE;
+    afterPrePassPipeline = VK_NULL_HANDLE;
+    afterPrePassIndirectPipeline = VK_NULL_HANDLE;
 }
 
-void VulkanBase::updateToggleInfo(uint32_t currentImage, const ToggleInfo &toggleInfo)
+void VulkanBase::updatePipelineIfNeeded()
 {
-    void *data;
-    vkMapMemory(device, toggleInfoBuffersMemory[currentImage], 0, sizeof(ToggleInfo), 0, &data);
-    memcpy(data, &toggleInfo, sizeof(ToggleInfo));
-    vkUnmapMemory(device, toggleInfoBuffersMemory[currentImage]);
+    // Frames in flight keep the variant they recorded; switching only changes what the next frame binds
+    const VkPolygonMode polygonMode = wireframeEnabled ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
+    graphicsPipeline = getMainPipeline({polygonMode, msaaSamples, false, true});
+    oceanBottomPipeline = getMainPipeline({polygonMode, msaaSamples, false, true, true});
+    indirectGraphicsPipeline = getMainPipeline({polygonMode, msaaSamples, true, true});
+
+    // Not prebuilt: compiled the first time the pre-pass is switched on
+    prePassPipeline = depthPrePass ? getMainPipeline({polygonMode, msaaSamples, false, true, false, true}) : VK_NULL_HANDLE;
+    afterPrePassPipeline = depthPrePass ? getMainPipeline({polygonMode, msaaSamples, false, false}) : VK_NULL_HANDLE;
+    prePassIndirectPipeline = depthPrePass ? getMainPipeline({polygonMode, msaaSamples, true, true, false, true}) : VK_NULL_HANDLE;
+    afterPrePassIndirectPipeline = depthPrePass ? getMainPipeline({polygonMode, msaaSamples, true, false}) : VK_NULL_HANDLE;
 }
 
-void VulkanBase::loadSceneFromJson(const std::string &sceneFilePath)
+void VulkanBase::applyShaderReloads()
 {
-    // Load the scene objects from the JSON file
-    std::vector<SceneObject> sceneObjects = ModelLoader::loadSceneFromJson(sceneFilePath);
-
-    uint32_t indexOffset = static_cast<uint32_t>(vertices.size()); // Offset for indices
-
-    for (const auto &obj : sceneObjects)
+    if (!shaderHotReload)
+    {
+        return;
+    }
+    const std::vector<std::string> compiled = shaderHotReload->takeCompiled();
+    if (compiled.empty())
+    {
+        return;
+    }
+    for (const std::string &name : compiled)
+    {
+        ShaderRegistry::preferDisk(name); // The embedded copy is what the build compiled
+    }
+    auto uses = [&compiled](std::initializer_list<const char *> modules)
     {
-        // Append the object's vertices to the main vertices vector
-        vertices.insert(vertices.end(), obj.vertices.begin(), obj.vertices.end());
+        return std::any_of(compiled.begin(), compiled.end(), [&](const std::string &name)
+                           { return std::find(modules.begin(), modules.end(), name) != modules.end(); });
+    };
 
-        // Append the object's indices to the main indices vector with the offset applied
-        for (const auto &index : obj.indices)
-        {
-            indices.push_back(index + indexOffset);
-        }
+    // The other frames in flight may still bind the pipelines replaced below; this one's slot is free
+    markHitchEvent("Shader reload");
+    frameTimeline->waitIdle();
+    secondaryRecorder->invalidateCache();
 
-        // Update the index offset for the next object
-        indexOffset += static_cast<uint32_t>(obj.vertices.size());
+    // Rebuilt through the pipeline cache: state the new modules share with the old ones is not recompiled
+    uint32_t rebuilt = 0;
+    if (uses({"3d_shader.vert.spv", "3d_shader_indirect.vert.spv", "3d_shader_lod.vert.spv", "3d_shader.frag.spv"}))
+    {
+        createGraphicsPipeline(); // Every main variant, ocean bottom included
+        rebuilt++;
+    }
+    if (skyboxPipeline && uses({"skybox.vert.spv", "skybox.frag.spv"}))
+    {
+        skyboxPipeline->destroy(device);
+        skyboxPipeline->create(device, renderPass, descriptorSetLayout, skyboxDescriptorSetLayout, msaaSamples);
+        rebuilt++;
+    }
+    if (waterPipeline && uses({"water.vert.spv", "water.frag.spv", "water_rq.frag.spv"}))
+    {
+        waterPipeline->destroy(device);
+        waterPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples, false);
+        rebuilt++;
+    }
+    if (waterTessPipeline && uses({"water_tess.vert.spv", "water.tesc.spv", "water.tese.spv", "water.frag.spv", "water_rq.frag.spv"}))
+    {
+        waterTessPipeline->destroy(device);
+        waterTessPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples, false, true);
+        rebuilt++;
+    }
+    if (uses({"underwater_water.vert.spv", "underwater_tile.vert.spv", "underwater_tile_vrs.vert.spv", "underwater_water.frag.spv"}))
+    {
+        underwaterWaterPipeline->destroy(device);
+        underwaterWaterPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples, true);
+        lowResUnderwaterPipeline->destroy(device);
+        lowResUnderwaterPipeline->create(device, temporalUpscaler->getLowResRenderPass(), descriptorSetLayout,
+                                         waterDescriptorSetLayout, VK_SAMPLE_COUNT_1_BIT, true);
+        rebuilt += 2;
+    }
+    if (uses({"sunrays.vert.spv", "sunrays_tile_vrs.vert.spv", "sunrays.frag.spv"}))
+    {
+        sunraysPipeline->destroy(device);
+        sunraysPipeline->create(device, renderPass, descriptorSetLayout, waterDescriptorSetLayout, msaaSamples, true);
+        lowResSunraysPipeline->destroy(device);
+        lowResSunraysPipeline->create(device, temporalUpscaler->getLowResRenderPass(), descriptorSetLayout,
+                                      waterDescriptorSetLayout, VK_SAMPLE_COUNT_1_BIT, true);
+        rebuilt += 2;
+    }
+    // The full-screen triangle of sunrays.vert also draws the upscaler composite and the god-ray upsample
+    if (uses({"sunrays.vert.spv", "temporal_composite.frag.spv"}))
+    {
+        temporalUpscaler->createCompositePipeline(renderPass, msaaSamples);
+        rebuilt++;
+    }
+    if (uses({"sunrays.vert.spv", "godray_upsample.frag.spv"}))
+    {
+        godRayUpsampler->createPipeline(swapChainManager->getSwapChainImageFormat());
+        rebuilt++;
+    }
+    if (uses({"shadow_depth.vert.spv"}))
+    {
+        shadowCascades->createPipeline();
+        rebuilt++;
+    }
+    if (uses({"light_cluster.comp.spv"}))
+    {
+        clusteredLights->createPipeline();
+        rebuilt++;
+    }
+    // GpuCulling builds its Hi-Z pipelines once; the reflection pyramid's specializations are live
+    if (uses({"hiz_depth.comp.spv", "hiz_reduce.comp.spv"}))
+    {
+        screenSpaceReflections->createPipelines();
+        rebuilt += 2;
+    }
+    if (uses({"atmosphere_transmittance.comp.spv", "atmosphere_multiscatter.comp.spv", "atmosphere.comp.spv"}))
+    {
+        atmosphereSky->createPipelines();
+        rebuilt += 3;
+    }
+    if (uses({"caustics_splat.comp.spv", "caustics_resolve.comp.spv"}))
+    {
+        oceanCaustics->createPipelines();
+        rebuilt += 2;
+    }
+    if (uses({"froxel_inject.comp.spv", "froxel_integrate.comp.spv"}))
+    {
+        froxelVolume->createPipelines();
+        rebuilt += 2;
+    }
+    if (uses({"marine_snow_update.comp.spv", "marine_snow.vert.spv", "marine_snow.frag.spv"}))
+    {
+        marineSnow->createPipelines(renderPass, msaaSamples);
+        rebuilt += 2;
+    }
+    if (uses({"tile_classify.comp.spv"}))
+    {
+        tileClassifier->createPipeline();
+        rebuilt++;
+    }
+    if (shadingRates && uses({"shading_rate.comp.spv"}))
+    {
+        shadingRates->createPipeline();
+        rebuilt++;
     }
 
-    // After aggregating all vertices and indices, you can create buffers
-    createVertexBuffer();
-    createIndexBuffer();
+    if (rebuilt > 0)
+    {
+        std::cout << "[Shaders] Rebuilt " << rebuilt << " pipeline(s)\n";
+    }
+    else
+    {
+        // Compute passes and one-off filters build their pipelines once, at startup
+        std::cout << "[Shaders] No live pipeline reloads these modules; restart to apply them\n";
+    }
 }
 
-void VulkanBase::createScreenshotImage(VkExtent2D extent, VkFormat format)
+void VulkanBase::updateToggleInfo(const ToggleInfo &toggleInfo)
 {
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = extent.width;
-    imageInfo.extent.height = extent.height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = format;
-    imageInfo.tiling = VK_IMAGE_TILING_LINEAR; // Important for CPU access
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    vkCreateImage(device, &imageInfo, nullptr, &screenshotImage);
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device, screenshotImage, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = VkUtils::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    vkAllocateMemory(device, &allocInfo, nullptr, &screenshotImageMemory);
-    vkBindImageMemory(device, screenshotImage, screenshotImageMemory, 0);
+    mainView.uniformOffsets[2] = uniformArena->push(toggleInfo);
 }
 
-void VulkanBase::blitImage(VkImage srcImage, VkImage dstImage, VkExtent2D extent)
+void VulkanBase::loadSceneFromJson(const std::string &sceneFilePath)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = dstImage;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    CPU_ZONE("VulkanBase::loadSceneFromJson");
+    // Load the scene's meshes and their instances from the JSON file
+    addSceneDescription(ModelLoader::loadSceneFromJson(sceneFilePath, jobSystem.get()));
+    scene.updateBvh();
 
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-    VkImageBlit blit{};
-    blit.srcOffsets[0] = {0, 0, 0};
-    blit.srcOffsets[1] = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
-    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    blit.srcSubresource.mipLevel = 0;
-    blit.srcSubresource.baseArrayLayer = 0;
-    blit.srcSubresource.layerCount = 1;
-
-    blit.dstOffsets[0] = {0, 0, 0};
-    blit.dstOffsets[1] = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
-    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    blit.dstSubresource.mipLevel = 0;
-    blit.dstSubresource.baseArrayLayer = 0;
-    blit.dstSubresource.layerCount = 1;
-
-    vkCmdBlitImage(
-        commandBuffer,
-        srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-        dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1, &blit,
-        VK_FILTER_NEAREST);
+    // After aggregating all vertices and indices, you can create buffers
+    createVertexBuffer();
+    createIndexBuffer();
 
-    endSingleTimeCommands(commandBuffer);
+    // The acceleration structures cover the old buffers and objects
+    if (rayQueryScene)
+    {
+        vkDeviceWaitIdle(device);
+        rayQueryScene->setGeometry(scene, *materialTable, vertexBuffer, indexBuffer);
+        rayQueryScene->writeDescriptors(waterDescriptorSet);
+    }
 }
 
-void VulkanBase::saveScreenshot(VkImage image, VkExtent2D extent, const std::string &filename)
+void VulkanBase::requestFrameReadbacks()
 {
-    VkImageSubresource subResource{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0};
-    VkSubresourceLayout subResourceLayout;
-    vkGetImageSubresourceLayout(device, image, &subResource, &subResourceLayout);
+    if (captureScreenshot)
+    {
+        static int screenshotCount = 0;
+        std::filesystem::create_directories("ScreenShots");
+        frameReadback->request({"ScreenShots/screenshot_" + std::to_string(++screenshotCount) + ".jpg", nullptr});
+        captureScreenshot = false;
+    }
 
-    const char *data;
-    vkMapMemory(device, screenshotImageMemory, 0, VK_WHOLE_SIZE, 0, (void **)&data);
-    data += subResourceLayout.offset;
+    FrameReadbackRequest tileRequest;
+    if (tiledCapture && tiledCapture->takeRequest(tileRequest))
+    {
+        frameReadback->request(std::move(tileRequest));
+    }
 
-    // Calculate the exact number of bytes per row
-    int rowSize = extent.width * 4; // Assuming 4 bytes per pixel (RGBA)
-    std::vector<unsigned char> pixels(rowSize * extent.height);
+    // Every frame of a run: temporal stability and the representative frames written by captureScreenshot
+    if (captureTestScreenshots && isTestModeActive && waterTestingSystem && waterTestingSystem->isTestRunning())
+    {
+        const uint32_t testFrame = static_cast<uint32_t>(simulationFrame); // The run's clock frame this image shows
+        const int configIndex = currentTestConfigIndex;
+        const int runIndex = currentTestRunIndex;
+        frameReadback->request({"", [this, testFrame, configIndex, runIndex](const FrameReadbackImage &image)
+                                {
+                                    // The run may have moved on while the copy was in flight
+                                    if (waterTestingSystem && isTestModeActive && currentTestConfigIndex == configIndex &&
+                                        currentTestRunIndex == runIndex)
+                                    {
+                                        waterTestingSystem->captureScreenshot(testFrame, image.pixels, image.width, image.height);
+                                    }
+                                }});
+    }
 
-    for (int y = 0; y < extent.height; y++)
+    // A reference frame of the run against its ground truth, if that is resident (ReferenceImageCache.h)
+    if (isTestModeActive && waterTestingSystem && waterTestingSystem->isTestRunning() &&
+        ReferenceImageCache::isReferenceFrame(waterTestingSystem->getCurrentConfig(), static_cast<uint32_t>(simulationFrame)))
     {
-        for (int x = 0; x < extent.width; x++)
+        const uint32_t testFrame = static_cast<uint32_t>(simulationFrame);
+        const ReferenceKey key = ReferenceImageCache::makeKey(testReferenceScene, waterTestingSystem->getCameraPath(), testFrame,
+                                                              waterTestingSystem->getCurrentConfig().totalFrames);
+        if (std::shared_ptr<const FrameReadbackImage> reference = referenceCache->find(key))
         {
-            unsigned char r = data[x * 4 + 0];
-            unsigned char g = data[x * 4 + 1];
-            unsigned char b = data[x * 4 + 2];
-            unsigned char a = data[x * 4 + 3];
-
-            // Swap R and B channels (convert RGBA to BGRA)
-            pixels[y * rowSize + x * 4 + 0] = b;
-            pixels[y * rowSize + x * 4 + 1] = g;
-            pixels[y * rowSize + x * 4 + 2] = r;
-            pixels[y * rowSize + x * 4 + 3] = a;
+            const int configIndex = currentTestConfigIndex;
+            const int runIndex = currentTestRunIndex;
+            frameReadback->request({"", [this, reference, testFrame, configIndex, runIndex](const FrameReadbackImage &image)
+                                    {
+                                        if (waterTestingSystem && isTestModeActive && currentTestConfigIndex == configIndex &&
+                                            currentTestRunIndex == runIndex && image.width == reference->width &&
+                                            image.height == reference->height)
+                                        {
+                                            waterTestingSystem->compareWithReference(testFrame, image.pixels, reference->pixels,
+                                                                                     image.width, image.height);
+                                        }
+                                    }});
         }
-        data += subResourceLayout.rowPitch; // Move to the next row (considering padding)
     }
-
-    vkUnmapMemory(device, screenshotImageMemory);
-
-    // Write to a JPEG file using stb_image_write
-    stbi_write_jpg(filename.c_str(), extent.width, extent.height, 4, pixels.data(), 100);
 }
 
-void VulkanBase::takeScreenshot()
+void VulkanBase::collectImageCompare()
 {
-    if (!captureScreenshot)
+    GpuImageCompareResult result;
+    if (!imageCompare->collect(static_cast<uint32_t>(currentFrame), result))
+        return;
+    lastImageCompare = result;
+    if (autoTuner)
     {
-        return; // Only take a screenshot if requested
+        autoTuner->addQuality(result.ssim);
     }
 
-    VkExtent2D extent = swapChainManager->getSwapChainExtent();
-    VkFormat format = swapChainManager->getSwapChainImageFormat();
-    const auto &swapChainImages = swapChainManager->getSwapChainImages();
-
-    std::cout << "currentFrame: " << currentFrame << ", swapChainImages size: " << swapChainImages.size() << std::endl;
-
-    if (currentFrame >= swapChainImages.size())
+    if (isTestModeActive && waterTestingSystem)
     {
-        std::cerr << "Error: currentFrame index out of range!" << std::endl;
-        captureScreenshot = false; // Reset the flag
-        return;
+        ImageQualityMetrics metrics{};
+        metrics.frameIndex = result.tag;
+        metrics.mse = result.mse;
+        metrics.psnr = result.psnr;
+        metrics.ssim = result.ssim;
+        metrics.deltaE = result.deltaE;
+        waterTestingSystem->recordImageQuality(metrics);
     }
-
-    createScreenshotImage(extent, format);
-
-    // Transition the swapchain image to TRANSFER_SRC layout before copying
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = swapChainImages[currentFrame];
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.srcAccessMask = 0; // Or appropriate access mask
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0, 0, nullptr, 0, nullptr, 1, &barrier);
-    endSingleTimeCommands(commandBuffer);
-
-    // Blit the swapchain image to the screenshot image
-    blitImage(swapChainImages[currentFrame], screenshotImage, extent);
-
-    // Transition the swapchain image back to PRESENT_SRC layout
-    commandBuffer = beginSingleTimeCommands();
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT; // Or appropriate access mask
-    barrier.dstAccessMask = 0;
-
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-        0, 0, nullptr, 0, nullptr, 1, &barrier);
-    endSingleTimeCommands(commandBuffer);
-
-    static int screenshotCount = 0;
-    std::string filename = "ScreenShots/screenshot_" + std::to_string(++screenshotCount) + ".jpg";
-    saveScreenshot(screenshotImage, extent, filename);
-
-    // Reset the flag
-    captureScreenshot = false;
-
-    // Cleanup
-    vkDestroyImage(device, screenshotImage, nullptr);
-    vkFreeMemory(device, screenshotImageMemory, nullptr);
 }
 
-void VulkanBase::createDescriptorPool()
+void VulkanBase::createImGuiDescriptorPool()
 {
-    descriptorPool = std::make_unique<DAEDescriptorPool<UBO>>(device, swapChainManager->getSwapChainImages().size());
-    VkUtils::VulkanContext context{device, physicalDevice};
-    descriptorPool->initialize(context);
+    // ImGui allocates and frees its own sets (the font atlas, user textures), so it keeps a plain pool
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = kImGuiDescriptorCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = kImGuiDescriptorCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &imguiDescriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create ImGui descriptor pool!");
+    }
 }
 
 void VulkanBase::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    // Batched with the other uploads; submitted by the next UploadContext flush
+    VkCommandBuffer commandBuffer = UploadContext::get().graphicsCommands();
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -3264,8 +5142,6 @@ void VulkanBase::transitionImageLayout(VkImage image, VkFormat format, VkImageLa
         0, nullptr,
         0, nullptr,
         1, &barrier);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
 VkCommandBuffer VulkanBase::beginSingleTimeCommands()
@@ -3297,89 +5173,66 @@ void VulkanBase::endSingleTimeCommands(VkCommandBuffer commandBuffer)
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
+    // Wait on this submission only, not on everything else queued on graphicsQueue
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    vkCreateFence(device, &fenceInfo, nullptr, &fence);
+
+    vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence);
+    vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkDestroyFence(device, fence, nullptr);
 
     vkFreeCommandBuffers(device, commandPool.getVkCommandPool(), 1, &commandBuffer);
 }
 
 void VulkanBase::createDescriptorSets()
 {
-    std::vector<VkDescriptorSetLayout> layouts(swapChainManager->getSwapChainImages().size(), descriptorSetLayout);
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool->getDescriptorPool();
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-    allocInfo.pSetLayouts = layouts.data();
-
-    descriptorSets.resize(swapChainManager->getSwapChainImages().size());
-    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+    // Only grows (a swapchain recreated with more images); existing sets are rewritten in place
+    const size_t allocatedCount = descriptorSets.size();
+    descriptorSets.resize(std::max(allocatedCount, swapChainManager->getSwapChainImages().size()));
+    for (size_t i = allocatedCount; i < descriptorSets.size(); i++)
     {
-        throw std::runtime_error("failed to allocate descriptor sets!");
+        descriptorSets[i] = descriptorAllocator->allocate(descriptorSetLayout);
     }
 
     for (size_t i = 0; i < descriptorSets.size(); i++)
     {
+        // Offsets are supplied per frame as dynamic offsets into the uniform arena
         VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = uniformBuffers[i];
+        bufferInfo.buffer = uniformArena->getBuffer();
         bufferInfo.offset = 0;
         bufferInfo.range = sizeof(UBO);
 
-        if (i >= lightInfoBuffers.size())
-        {
-            throw std::runtime_error("lightInfoBuffers is out of range!");
-        }
-
         VkDescriptorBufferInfo lightInfoBufferInfo{};
-        lightInfoBufferInfo.buffer = lightInfoBuffers[i];
+        lightInfoBufferInfo.buffer = uniformArena->getBuffer();
         lightInfoBufferInfo.offset = 0;
         lightInfoBufferInfo.range = sizeof(LightInfo);
 
-        VkDescriptorImageInfo baseImageInfo{};
-        baseImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        baseImageInfo.imageView = textureImageView;
-        baseImageInfo.sampler = textureSampler;
-
-        // ImageInfo for Metalness Texture
-        VkDescriptorImageInfo metalnessImageInfo{};
-        metalnessImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        metalnessImageInfo.imageView = metalnessImageView;
-        metalnessImageInfo.sampler = textureSampler;
-
-        // ImageInfo for Normal Texture
-        VkDescriptorImageInfo normalImageInfo{};
-        normalImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        normalImageInfo.imageView = normalImageView;
-        normalImageInfo.sampler = textureSampler;
-
-        // ImageInfo for Specular Texture
-        VkDescriptorImageInfo specularImageInfo{};
-        specularImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        specularImageInfo.imageView = specularImageView;
-        specularImageInfo.sampler = textureSampler;
-
-        if (i >= toggleInfoBuffers.size())
-        {
-            throw std::runtime_error("toggleInfoBuffers is out of range!");
-        }
+        VkDescriptorBufferInfo toggleInfoBufferInfo{};
+        toggleInfoBufferInfo.buffer = uniformArena->getBuffer();
+        toggleInfoBufferInfo.offset = 0;
+        toggleInfoBufferInfo.range = sizeof(ToggleInfo);
 
-        if (!swapChainManager)
-        {
-            throw std::runtime_error("swapChainManager is not initialized!");
-        }
+        VkDescriptorImageInfo prefilteredImageInfo{};
+        prefilteredImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        prefilteredImageInfo.imageView = imageBasedLighting->getPrefilteredView();
+        prefilteredImageInfo.sampler = imageBasedLighting->getSampler();
 
-        auto swapChainImagesSize = swapChainManager->getSwapChainImages().size();
-        if (swapChainImagesSize == 0)
-        {
-            throw std::runtime_error("swapChainImages has no elements!");
-        }
+        VkDescriptorImageInfo brdfLutImageInfo{};
+        brdfLutImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        brdfLutImageInfo.imageView = imageBasedLighting->getBrdfLutView();
+        brdfLutImageInfo.sampler = imageBasedLighting->getSampler();
 
-        toggleInfoBuffers.resize(swapChainImagesSize);
+        VkDescriptorBufferInfo pointLightBufferInfo{};
+        pointLightBufferInfo.buffer = clusteredLights->getLightBuffer();
+        pointLightBufferInfo.offset = 0;
+        pointLightBufferInfo.range = clusteredLights->getLightBufferSize();
 
-        VkDescriptorBufferInfo toggleInfoBufferInfo{};
-        toggleInfoBufferInfo.buffer = toggleInfoBuffers[i];
-        toggleInfoBufferInfo.offset = 0;
-        toggleInfoBufferInfo.range = sizeof(ToggleInfo);
+        VkDescriptorBufferInfo lightClusterBufferInfo{};
+        lightClusterBufferInfo.buffer = clusteredLights->getClusterBuffer();
+        lightClusterBufferInfo.offset = 0;
+        lightClusterBufferInfo.range = clusteredLights->getClusterBufferSize();
 
         std::array<VkWriteDescriptorSet, 7> descriptorWrites{};
 
@@ -3387,62 +5240,84 @@ void VulkanBase::createDescriptorSets()
         descriptorWrites[0].dstSet = descriptorSets[i];
         descriptorWrites[0].dstBinding = 0;
         descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         descriptorWrites[0].descriptorCount = 1;
         descriptorWrites[0].pBufferInfo = &bufferInfo;
 
         descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[1].dstSet = descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstBinding = 2; // Binding index for LightInfo
         descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &baseImageInfo;
+        descriptorWrites[1].pBufferInfo = &lightInfoBufferInfo;
 
         descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[2].dstSet = descriptorSets[i];
-        descriptorWrites[2].dstBinding = 2; // Binding index for LightInfo
+        descriptorWrites[2].dstBinding = 6; // Binding index for ToggleInfo
         descriptorWrites[2].dstArrayElement = 0;
-        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         descriptorWrites[2].descriptorCount = 1;
-        descriptorWrites[2].pBufferInfo = &lightInfoBufferInfo;
+        descriptorWrites[2].pBufferInfo = &toggleInfoBufferInfo;
 
         descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[3].dstSet = descriptorSets[i];
-        descriptorWrites[3].dstBinding = 3; // Binding index for Metalness texture
+        descriptorWrites[3].dstBinding = 8; // Binding index for the prefiltered sky
         descriptorWrites[3].dstArrayElement = 0;
         descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         descriptorWrites[3].descriptorCount = 1;
-        descriptorWrites[3].pImageInfo = &metalnessImageInfo;
+        descriptorWrites[3].pImageInfo = &prefilteredImageInfo;
 
         descriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[4].dstSet = descriptorSets[i];
-        descriptorWrites[4].dstBinding = 4; // Binding index for Normal texture
+        descriptorWrites[4].dstBinding = 9; // Binding index for the BRDF LUT
         descriptorWrites[4].dstArrayElement = 0;
         descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         descriptorWrites[4].descriptorCount = 1;
-        descriptorWrites[4].pImageInfo = &normalImageInfo;
+        descriptorWrites[4].pImageInfo = &brdfLutImageInfo;
 
         descriptorWrites[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[5].dstSet = descriptorSets[i];
-        descriptorWrites[5].dstBinding = 5; // Binding index for Specular texture
+        descriptorWrites[5].dstBinding = ClusteredLights::kLightBinding;
         descriptorWrites[5].dstArrayElement = 0;
-        descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
         descriptorWrites[5].descriptorCount = 1;
-        descriptorWrites[5].pImageInfo = &specularImageInfo;
+        descriptorWrites[5].pBufferInfo = &pointLightBufferInfo;
 
         descriptorWrites[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[6].dstSet = descriptorSets[i];
-        descriptorWrites[6].dstBinding = 6; // Binding index for ToggleInfo
+        descriptorWrites[6].dstBinding = ClusteredLights::kClusterBinding;
         descriptorWrites[6].dstArrayElement = 0;
-        descriptorWrites[6].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
         descriptorWrites[6].descriptorCount = 1;
-        descriptorWrites[6].pBufferInfo = &toggleInfoBufferInfo;
+        descriptorWrites[6].pBufferInfo = &lightClusterBufferInfo;
 
         vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
 }
 
+void VulkanBase::registerBindlessResources()
+{
+    // The material table registers its own buffers and maps
+    materialPush.irradianceBuffer = bindlessTable->addBuffer(imageBasedLighting->getIrradianceBuffer(), 0,
+                                                             imageBasedLighting->getIrradianceSize());
+}
+
+void VulkanBase::refreshMaterialTable()
+{
+    bindlessTable->beginFrame();
+    materialPush.materialBuffer = materialTable->update(currentFrame);
+}
+
+void VulkanBase::bindMaterialTable(VkCommandBuffer cmd) const
+{
+    VkDescriptorSet table = bindlessTable->getSet();
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                            BindlessTable::kSetIndex, 1, &table, 0, nullptr);
+    vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                       kMaterialPushOffset, sizeof(MaterialPush), &materialPush);
+}
+
 VkImageView VulkanBase::createImageView(
     VkImage image,
     VkFormat format,
@@ -3502,7 +5377,8 @@ void VulkanBase::createTextureSampler()
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = static_cast<float>(mipLevels);
+    // The views bound with it bound the levels: streamed materials cover fewer levels than they will
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
     samplerInfo.mipLodBias = 0.0f;
 
     if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
@@ -3513,6 +5389,7 @@ void VulkanBase::createTextureSampler()
 
 void VulkanBase::drawFrame()
 {
+    CPU_ZONE("VulkanBase::drawFrame");
     // SAFETY: Skip entire frame if swap chain recreation is in progress or framebuffer was resized
     if (isRecreatingSwapChain || framebufferResized)
     {
@@ -3525,10 +5402,17 @@ void VulkanBase::drawFrame()
         return;
     }
 
-    // Wait for the frame's fence to ensure the GPU has finished
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    // Wait for the value the slot's previous frame signalled: everything tagged with it is free again
+    frameTimeline->wait(frameSlotValues[currentFrame]);
+    observeFrameCompletions();
+
+    // Every frame since the last recreation has completed: presents on the old swapchain are done
+    if (retiredSwapChainFrames > 0 && --retiredSwapChainFrames == 0)
+    {
+        swapChainManager->destroyRetired();
+    }
 
-    // Double-check after fence wait - resize callback could have fired during wait
+    // Double-check after the wait - resize callback could have fired during wait
     if (isRecreatingSwapChain || framebufferResized)
     {
         if (framebufferResized)
@@ -3539,16 +5423,27 @@ void VulkanBase::drawFrame()
         return;
     }
 
+    applyShaderReloads();
     updatePipelineIfNeeded();
+    if (stereoRendering)
+    {
+        applyStereoLimits();
+    }
+    snapshotRenderSettings();
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(
-        device,
-        swapChainManager->getSwapChain(),
-        UINT64_MAX,
-        imageAvailableSemaphores[currentFrame],
-        VK_NULL_HANDLE,
-        &imageIndex);
+    // Headless: one offscreen image per frame slot, free once the slot's value has been reached
+    uint32_t imageIndex = static_cast<uint32_t>(currentFrame);
+    VkResult result = VK_SUCCESS;
+    if (!headless)
+    {
+        result = vkAcquireNextImageKHR(
+            device,
+            swapChainManager->getSwapChain(),
+            UINT64_MAX,
+            imageAvailableSemaphores[currentFrame],
+            VK_NULL_HANDLE,
+            &imageIndex);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
@@ -3566,50 +5461,164 @@ void VulkanBase::drawFrame()
         return;
     }
 
-    // Reset the fence so we can use it for the next submission
-    vkResetFences(device, 1, &inFlightFences[currentFrame]);
-
     //  UPDATE UNIFORMS FIRST (before recording command buffer)
-    updateUniformBuffer(imageIndex);
-    updateLightInfoBuffer(imageIndex);
-    updateToggleInfo(imageIndex, currentToggleInfo);
+    // The slot's value has been reached, so its arena region is free to overwrite
+    uniformArena->beginFrame(currentFrame);
+    frameArena.beginFrame(static_cast<uint32_t>(currentFrame));
+    descriptorAllocator->beginFrame(static_cast<uint32_t>(currentFrame));
+    secondaryRecorder->beginFrame(static_cast<uint32_t>(currentFrame));
+    gpuProfiler->beginFrame(static_cast<uint32_t>(currentFrame));
+    gpuCounters->beginFrame(static_cast<uint32_t>(currentFrame));
+    dynamicResolution.update(gpuProfiler->getScopeMs("Frame"), framesInFlight);
+    if (autoTuner)
+    {
+        autoTuner->addFrame(gpuProfiler->getScopeMs("Frame"));
+    }
+    frameReadback->collect(static_cast<uint32_t>(currentFrame));
+    waterHeights->collect(static_cast<uint32_t>(currentFrame));
+    cameraWaterHeight = waterHeights->sampleHeight(glm::vec2(camera.position.x, camera.position.z));
+    collectImageCompare();
+    renderGraph->beginFrame(static_cast<uint32_t>(currentFrame));
+    if (asyncCompute)
+    {
+        asyncCompute->beginFrame(static_cast<uint32_t>(currentFrame));
+    }
+    updateUniformBuffer();
+    updateLightInfoBuffer();
+    updateToggleInfo(currentToggleInfo);
+    // New cascade images: the other frame in flight may still sample the old ones
+    if (shadowCascades->getQuality() != shadowQuality)
+    {
+        vkDeviceWaitIdle(device);
+        shadowCascades->setQuality(shadowQuality);
+    }
+    buildSceneDrawList();
+    // Water and sea floor tiles around this frame's camera; the water's culled to the view (both eyes in stereo)
+    const Frustum waterFrustum = Frustum::fromViewProjection(frameUBO.proj * frameUBO.view);
+    const glm::vec2 waveMargin = waterHeights->hasData() ? waterHeights->getMaxDisplacement() * kWaveMarginScale
+                                                         : glm::vec2(kWaveMarginFallback);
+    waterMesh->update(static_cast<uint32_t>(currentFrame), camera.getPosition(), kOceanViewDistance,
+                      waterTileCulling ? &waterFrustum : nullptr, waveMargin);
+    oceanBottomMesh->update(static_cast<uint32_t>(currentFrame), camera.getPosition(), kOceanViewDistance);
+    // Next material mips under the upload budget; levels that landed get new table slots
+    const uint64_t textureVersion = textureStreamer->getVersion();
+    textureStreamer->update();
+    if (textureStreamer->getVersion() != textureVersion)
+    {
+        markHitchEvent("Texture upload");
+    }
+    refreshMaterialTable();
 
     //  THEN reset and record the command buffer for this frame (use currentFrame, not imageIndex)
     vkResetCommandBuffer(commandBuffers[currentFrame].getVkCommandBuffer(), 0);
+    frameDevice = deviceGroup ? deviceGroup->getFrameDevice(submittedFrameCount) : 0;
+    const uint64_t heapAllocations = FrameArena::getHeapAllocations();
     recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+    recordHeapAllocations = FrameArena::getHeapAllocations() - heapAllocations;
 
-    // Submit the command buffer
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    // Async compute frames (AsyncCompute.h): the compute work goes first, then the graphics work
+    // before the render graph's split, then the rest, which waits for the compute
+    const bool computeSubmitted = asyncCompute && asyncCompute->submitCompute();
+    const bool splitFrame = asyncCompute && asyncCompute->hasGraphicsWork();
 
+    // Submit the command buffer(s); the swapchain image is only touched after the split
+    std::array<VkSubmitInfo, 2> submits{};
     VkCommandBuffer commandBuffer = commandBuffers[currentFrame].getVkCommandBuffer();
+    VkCommandBuffer lastCommandBuffer = splitFrame ? asyncCompute->graphicsCommands() : commandBuffer;
+    submits[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submits[0].commandBufferCount = 1;
+    submits[0].pCommandBuffers = &commandBuffer;
+
+    // Nothing to acquire or present when headless, so no binary semaphores either
+    std::array<VkSemaphore, 2> waitSemaphores{};
+    std::array<VkPipelineStageFlags, 2> waitStages{};
+    std::array<uint64_t, 2> waitValues{}; // Ignored for binary semaphores
+    uint32_t waitCount = 0;
+    std::array<VkSemaphore, 2> signalSemaphores{};
+    std::array<uint64_t, 2> signalValues{};
+    uint32_t signalCount = 0;
+    if (!headless)
+    {
+        waitSemaphores[waitCount] = imageAvailableSemaphores[currentFrame];
+        waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        signalSemaphores[signalCount++] = renderFinishedSemaphores[currentFrame];
+    }
+    if (computeSubmitted)
+    {
+        waitSemaphores[waitCount] = asyncCompute->getComputeTimeline();
+        waitValues[waitCount] = asyncCompute->getComputeValue();
+        waitStages[waitCount++] = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    // Every frame, split or not: the slot's tag, and what the next compute submission waits for
+    const uint64_t frameValue = frameTimeline->nextValue();
+    signalSemaphores[signalCount] = frameTimeline->getHandle();
+    signalValues[signalCount++] = frameValue;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = waitCount;
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = signalCount;
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo &submitInfo = submits[1];
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = waitCount;
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    submitInfo.pCommandBuffers = &lastCommandBuffer;
+    submitInfo.signalSemaphoreCount = signalCount;
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+    // Never split on a device group: async compute is off there
+    DeviceGroup::SubmitChain deviceGroupSubmit{};
+    if (deviceGroup)
+    {
+        deviceGroup->chainSubmit(deviceGroupSubmit, submitInfo, frameDevice);
+    }
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+    // One batch unless split; the second signals the timeline, after the first on the same queue
+    const uint32_t firstSubmit = splitFrame ? 0 : 1;
+    if (vkQueueSubmit(graphicsQueue, 2 - firstSubmit, submits.data() + firstSubmit, VK_NULL_HANDLE) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
+    frameSlotValues[currentFrame] = frameValue;
+
+    InFlightFrameTiming &frameTiming = inFlightFrameTimings[currentFrame];
+    frameTiming.start = frameStartTimePoint;
+    frameTiming.submitted = std::chrono::high_resolution_clock::now();
+    frameTiming.frameNumber = submittedFrameCount++;
+    frameTiming.timelineValue = frameValue;
+    frameTiming.pending = true;
+
+    // Time to first frame: construction to the first submit, phase by phase (StartupTimer.h)
+    if (startupTimer.markFirstFrame())
+    {
+        startupTimer.writeReport(std::cout);
+    }
+
+    if (headless)
+    {
+        currentFrame = (currentFrame + 1) % framesInFlight;
+        return;
+    }
 
     // Present
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
     VkSwapchainKHR swapChains[] = {swapChainManager->getSwapChain()};
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &imageIndex;
+    if (presentPacer)
+    {
+        presentPacer->attach(presentInfo, frameStartTimePoint); // Input is sampled right after the frame starts
+    }
 
     result = vkQueuePresentKHR(presentQueue, &presentInfo);
 
@@ -3633,27 +5642,135 @@ void VulkanBase::drawFrame()
     }
 
     // Move to next frame
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % framesInFlight;
 }
 
-void VulkanBase::updateUniformBuffer(uint32_t currentImage)
+void VulkanBase::setFramesInFlight(uint32_t count)
 {
-    // Standard UBO struct (used for Refraction and Main Pass)
-    static auto startTime = std::chrono::high_resolution_clock::now();
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    count = std::clamp<uint32_t>(count, 2, MAX_FRAMES_IN_FLIGHT);
+    requestedFramesInFlight = count;
+    if (count == framesInFlight)
+        return;
+
+    // A slot dropped here would never be waited on or collected again: drain and collect them all
+    frameTimeline->waitIdle();
+    observeFrameCompletions();
+    frameReadback->collectAll();
+    for (currentFrame = 0; currentFrame < framesInFlight; currentFrame++)
+    {
+        collectImageCompare();
+    }
 
+    framesInFlight = count;
+    currentFrame = 0;
+}
+
+void VulkanBase::observeFrameCompletions()
+{
+    const auto now = std::chrono::high_resolution_clock::now();
+    const uint64_t nowNs = CpuProfiler::nowNs();
+
+    // One queue retires frames in submission order: stop at the oldest one still running
+    while (true)
+    {
+        InFlightFrameTiming *oldest = nullptr;
+        for (InFlightFrameTiming &timing : inFlightFrameTimings)
+        {
+            if (timing.pending && (!oldest || timing.frameNumber < oldest->frameNumber))
+                oldest = &timing;
+        }
+        if (!oldest || !frameTimeline->isComplete(oldest->timelineValue))
+            break;
+
+        // The signal happened at or before 'now': polled every iteration and after every frame wait
+        CompletedFrameTiming completed{};
+        completed.latencyMs = std::chrono::duration<double, std::milli>(now - oldest->start).count();
+        completed.cpuMs = std::chrono::duration<double, std::milli>(oldest->submitted - oldest->start).count();
+        completed.intervalMs = lastFrameCompletion != std::chrono::high_resolution_clock::time_point{}
+                                   ? std::chrono::duration<double, std::milli>(now - lastFrameCompletion).count()
+                                   : completed.latencyMs;
+        completed.frameNumber = oldest->frameNumber;
+        completed.completedNs = nowNs;
+        completedFrameTimings.push_back(completed);
+
+        lastFrameCompletion = now;
+        oldest->pending = false;
+    }
+}
+
+VkExtent2D VulkanBase::getViewExtent() const
+{
+    VkExtent2D extent = swapChainManager->getSwapChainExtent();
+    if (stereoRendering)
+    {
+        extent.width = std::max(extent.width / Multiview::kViewCount, 1u);
+    }
+    return extent;
+}
+
+void VulkanBase::snapshotRenderSettings()
+{
+    const uint64_t hash = renderSettings.hash();
+    if (frameSettingsVersion > 0 && hash == frameSettingsHash)
+        return;
+    frameSettings = renderSettings;
+    frameSettingsHash = hash;
+    frameSettingsVersion++;
+    offscreenThrottle.invalidate(); // Its targets were rendered with the old settings
+}
+
+void VulkanBase::applyStereoLimits()
+{
+    // Each of these renders from the one camera, or into targets with one layer, so the eyes would disagree
+    waterOffscreenPasses = false;      // The reflection/refraction targets (and screen-space reflections)
+    temporalUnderwaterEffects = false; // Low-res effects target and history
+    halfResGodRays = false;
+    tiledEffects = false;              // Tiles classified on one screen
+    variableRateShading = false;       // Rates and history from one screen
+    renderSettings.marineSnowParticles = false; // Drawn with the centre camera's matrices
+    gpuOcclusionCulling = false;       // The Hi-Z pyramid is built from one depth layer
+    // Multiview with tessellation is an optional feature of its own (multiviewTessellationShader)
+    waterTessellation = false;
+}
+
+void VulkanBase::updateUniformBuffer()
+{
+    CPU_ZONE("VulkanBase::updateUniformBuffer");
+    // Standard UBO struct (used for Refraction and Main Pass)
     // 1. NORMAL CAMERA (Refraction Pass / Main Pass)
     UBO ubo{};
     // Use standard camera view/projection
     ubo.view = camera.getViewMatrix();
-    ubo.proj = glm::perspective(glm::radians(camera.zoom), swapChainManager->getSwapChainExtent().width / (float)swapChainManager->getSwapChainExtent().height, 0.1f, 1000.0f);
+    const VkExtent2D viewExtent = getViewExtent(); // One eye's in stereo
+    const float aspect = tiledCapture ? tiledCapture->getAspect() : viewExtent.width / (float)viewExtent.height;
+    ubo.proj = glm::perspective(glm::radians(camera.zoom), aspect, kCameraNear, 1000.0f);
     ubo.proj[1][1] *= -1; // Flip Y for Vulkan
+    if (tiledCapture)
+    {
+        ubo.proj = tiledCapture->tileProjection(ubo.proj); // This frame's tile of the large image
+    }
     ubo.model = glm::mat4(1.0f);
     ubo.lightPos = glm::vec4(light0Position, 1.0f);
     // ==========================================
 
     ubo.viewPos = glm::vec4(camera.getPosition(), 1.0f);
+
+    // A target the passes did not fill last frame holds nothing current: the reflection is skipped
+    // underwater and under screen-space reflections, the pyramid under planar ones. A tiled capture's
+    // last frame was another tile
+    const uint32_t targetsKey = (useScreenSpaceReflections() ? 1u : 0u) | (isCameraUnderwater() ? 2u : 0u) | (tracesSceneRays() ? 4u : 0u);
+    if (!waterOffscreenPasses || targetsKey != offscreenTargetsKey || tiledCapture)
+    {
+        offscreenThrottle.invalidate();
+        offscreenTargetsKey = targetsKey;
+    }
+    offscreenThrottle.update(camera.getPosition(), camera.front, ubo.proj, ubo.view, dynamicResolution.getScale());
+    // What the targets hold, which may be an earlier frame's (OffscreenThrottle.h)
+    ubo.offscreenScale = glm::vec4(offscreenThrottle.getScale(), useScreenSpaceReflections() ? 1.0f : 0.0f,
+                                   tracesSceneRays() ? 1.0f : 0.0f, 0.0f);
+    ubo.offscreenViewProj = offscreenThrottle.getViewProjection();
+    ubo.ocean = oceanFFT->getShaderParams();
+    ubo.viewport = glm::vec4(viewExtent.width, viewExtent.height, waterTessEdgePixels, 0.0f);
     // 2. REFLECTION CAMERA (Reflection Pass)
     UBO uboRefl{};
     uboRefl.proj = ubo.proj;
@@ -3682,14 +5799,26 @@ void VulkanBase::updateUniformBuffer(uint32_t currentImage)
     );
     uboRefl.model = glm::mat4(1.0f);
 
+    // Stereo (Multiview.h): each eye's matrix for the shaders, and for everything else (culling, LOD,
+    // light clusters) the one camera whose frustum contains both
+    if (stereoRendering)
+    {
+        const Multiview::Eyes eyes = Multiview::computeEyes(ubo.view, glm::radians(camera.zoom), aspect, kCameraNear, 1000.0f, eyeSeparation);
+        ubo.views = glm::uvec4(Multiview::kViewCount, 0u, 0u, 0u);
+        for (uint32_t eye = 0; eye < Multiview::kViewCount; eye++)
+        {
+            ubo.eyeViewProj[eye] = ubo.proj * eyes.view[eye];
+            ubo.eyePos[eye] = glm::vec4(eyes.position[eye], 1.0f);
+        }
+        ubo.view = eyes.cullView;
+        ubo.proj = eyes.cullProjection;
+    }
+
     // Update the NORMAL UBO for the Main Pass
-    void *data;
-    vkMapMemory(device, uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
-    memcpy(data, &ubo, sizeof(ubo));
-    vkUnmapMemory(device, uniformBuffersMemory[currentImage]);
+    frameUBO = ubo;
+    mainView.uniformOffsets[0] = uniformArena->push(ubo);
 
-    // Store the reflection view matrix for use in recordCommandBuffer
-    // (Ensure you have 'glm::mat4 reflectionViewMatrix;' as a member variable in VulkanBase.h)
+    // Store the reflection view matrix for the reflection view (buildSceneDrawList)
     reflectionViewMatrix = uboRefl.view;
 }
 
@@ -3709,6 +5838,7 @@ void VulkanBase::createSkyboxDescriptorSetLayout()
 
     if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &skyboxDescriptorSetLayout) != VK_SUCCESS)
         throw std::runtime_error("Failed to create skybox descriptor set layout!");
+    descriptorAllocator->registerLayout(skyboxDescriptorSetLayout, &samplerBinding, 1);
 }
 
 void VulkanBase::createSkyboxDescriptorSet()
@@ -3724,14 +5854,7 @@ void VulkanBase::createSkyboxDescriptorSet()
     }
 
     // ---- Allocate descriptor set ----
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = skyboxDescriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &skyboxDescriptorSetLayout;
-
-    if (vkAllocateDescriptorSets(device, &allocInfo, &skyboxDescriptorSet) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate skybox descriptor set!");
+    skyboxDescriptorSet = descriptorAllocator->allocate(skyboxDescriptorSetLayout);
 
     // ---- Descriptor for cubemap ----
     VkDescriptorImageInfo imageInfo{};
@@ -3756,20 +5879,21 @@ void VulkanBase::createSkyboxDescriptorSet()
     //           << ", Sampler = " << skyboxSampler << "\n";
 }
 
-void VulkanBase::createSkyboxDescriptorPool()
+void VulkanBase::createAtmosphereSkyDescriptorSet()
 {
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSize.descriptorCount = 1;
+    // Same layout as the skybox's: DrawSkybox binds either
+    atmosphereSkyDescriptorSet = descriptorAllocator->allocate(skyboxDescriptorSetLayout);
 
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.maxSets = 1;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
+    VkDescriptorImageInfo imageInfo{atmosphereSky->getSampler(), atmosphereSky->getCubeView(), VK_IMAGE_LAYOUT_GENERAL};
 
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &skyboxDescriptorPool) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create skybox descriptor pool!");
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = atmosphereSkyDescriptorSet;
+    write.dstBinding = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
 }
 
 void VulkanBase::createWaterResources()
@@ -3783,9 +5907,9 @@ void VulkanBase::createWaterResources()
     // Ensure "textures/water_normal.png" exists.
     try
     {
-        loadTexture("textures/water_normal.jpg", waterNormalImage, waterNormalImageMemory);
+        VkFormat format = loadTexture("textures/water_normal.jpg", waterNormalImage, waterNormalImageMemory, TextureCompressor::Kind::TwoChannel);
         // loadTexture updates 'mipLevels', use it to create the view
-        waterNormalImageView = createImageView(waterNormalImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
+        waterNormalImageView = createImageView(waterNormalImage, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
         std::cout << "[Water] Loaded water_normal.jpg\n";
     }
     catch (const std::exception &e)
@@ -3800,8 +5924,8 @@ void VulkanBase::createWaterResources()
     // Ensure "textures/water_dudv.png" exists.
     try
     {
-        loadTexture("textures/water_dudv.jpg", waterDudvImage, waterDudvImageMemory);
-        waterDudvImageView = createImageView(waterDudvImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
+        VkFormat format = loadTexture("textures/water_dudv.jpg", waterDudvImage, waterDudvImageMemory, TextureCompressor::Kind::TwoChannel);
+        waterDudvImageView = createImageView(waterDudvImage, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
         std::cout << "[Water] Loaded water_dudv.jpg\n";
     }
     catch (const std::exception &e)
@@ -3815,8 +5939,8 @@ void VulkanBase::createWaterResources()
     // Ensure "textures/water_caustics.png" exists.
     try
     {
-        loadTexture("textures/water_caustic.jpg", waterCausticImage, waterCausticImageMemory);
-        waterCausticImageView = createImageView(waterCausticImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
+        VkFormat format = loadTexture("textures/water_caustic.jpg", waterCausticImage, waterCausticImageMemory);
+        waterCausticImageView = createImageView(waterCausticImage, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
         std::cout << "[Water] Loaded water_caustic.jpg\n";
     }
     catch (const std::exception &e)
@@ -3826,10 +5950,33 @@ void VulkanBase::createWaterResources()
     }
 }
 
+void VulkanBase::selectWaterVariants(uint32_t renderingMode, uint32_t debugView, bool effectRates)
+{
+    WaterVariant variant;
+    variant.renderingMode = specializedWaterShaders ? renderingMode : WaterVariant::kRuntime;
+    variant.debugView = specializedWaterShaders ? debugView : WaterVariant::kRuntime;
+
+    // Only the full-resolution effects shade at variable rates
+    const bool shadingRate = effectRates && variableRateShading && shadingRates;
+    // The surface traces the scene in the ray-query mode; the sunrays ignore it
+    const bool rayQuery = useRayQueryReflections();
+    for (WaterPipeline *pipeline : {waterPipeline.get(), waterTessPipeline.get(), sunraysPipeline.get(), lowResSunraysPipeline.get()})
+    {
+        if (pipeline)
+            pipeline->select(variant, shadingRate && pipeline == sunraysPipeline.get(), rayQuery);
+    }
+    for (UnderwaterWaterPipeline *pipeline : {underwaterWaterPipeline.get(), lowResUnderwaterPipeline.get()})
+    {
+        if (pipeline)
+            pipeline->select(variant, tiledEffects, shadingRate && pipeline == underwaterWaterPipeline.get());
+    }
+}
+
 void VulkanBase::createWaterDescriptorSetLayout()
 {
-    // We have 5 bindings (0-4)
-    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    // 12 bindings (0-11), then the ray-query mode's four (12-15) where the device has it, then the floor's bathymetry (16-17)
+    const uint32_t rayQueryBindings = rayQuerySupported ? RayQueryScene::kWaterBindingCount : 0;
+    std::vector<VkDescriptorSetLayoutBinding> bindings(12 + rayQueryBindings + 2);
 
     // binding 0 ? scene color texture (RENAMED to Refraction)
     bindings[0].binding = 0;
@@ -3861,6 +6008,66 @@ void VulkanBase::createWaterDescriptorSetLayout()
     bindings[4].descriptorCount = 1;
     bindings[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+    // binding 5-6 ? FFT ocean displacement and normal/foam maps (OceanFFT.h)
+    for (uint32_t i = 5; i < 7; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | getTessellationStages();
+    }
+
+    // binding 7 ? WaterParams, one copy per frame in flight (WaterParamsBuffer.h)
+    bindings[7].binding = 7;
+    bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[7].descriptorCount = 1;
+    bindings[7].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // binding 8 ? screen-space reflection depth pyramid (ScreenSpaceReflections.h)
+    bindings[8].binding = ScreenSpaceReflections::kWaterBinding;
+    bindings[8].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[8].descriptorCount = 1;
+    bindings[8].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // binding 9 ? caustics traced through the ocean surface (OceanCaustics.h)
+    bindings[9].binding = OceanCaustics::kWaterBinding;
+    bindings[9].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[9].descriptorCount = 1;
+    bindings[9].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // binding 10 ? underwater fog and light shafts integrated in a froxel volume (FroxelVolume.h)
+    bindings[10].binding = FroxelVolume::kWaterBinding;
+    bindings[10].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[10].descriptorCount = 1;
+    bindings[10].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // binding 11 ? per-tile shading rates, written only where the device has them (VariableRateShading.h)
+    bindings[11].binding = VariableRateShading::kWaterBinding;
+    bindings[11].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[11].descriptorCount = 1;
+    bindings[11].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    // bindings 12-15 ? the scene's top-level structure, its objects and its geometry, for water_rq.frag (RayQueryScene.h)
+    for (uint32_t i = 12; i < 12 + rayQueryBindings; i++)
+    {
+        bindings[i].binding = RayQueryScene::kWaterBinding + (i - 12);
+        bindings[i].descriptorType = i == 12 ? VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    // bindings 16-17 ? streamed sea-floor elevation tiles and their page table, for 3d_shader_lod.vert (BathymetryField.h)
+    VkDescriptorSetLayoutBinding &bathymetryAtlas = bindings[12 + rayQueryBindings];
+    bathymetryAtlas.binding = BathymetryField::kAtlasBinding;
+    bathymetryAtlas.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bathymetryAtlas.descriptorCount = 1;
+    bathymetryAtlas.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    VkDescriptorSetLayoutBinding &bathymetryPages = bindings[12 + rayQueryBindings + 1];
+    bathymetryPages.binding = BathymetryField::kPagesBinding;
+    bathymetryPages.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bathymetryPages.descriptorCount = 1;
+    bathymetryPages.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
     VkDescriptorSetLayoutCreateInfo info{};
     info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     info.bindingCount = (uint32_t)bindings.size();
@@ -3868,34 +6075,7 @@ void VulkanBase::createWaterDescriptorSetLayout()
 
     if (vkCreateDescriptorSetLayout(device, &info, nullptr, &waterDescriptorSetLayout) != VK_SUCCESS)
         throw std::runtime_error("Failed to create water descriptor set layout!");
-}
-
-void VulkanBase::createWaterDescriptorPool()
-{
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSize.descriptorCount = 4; // we use 4 bindings
-
-    VkDescriptorPoolCreateInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    info.maxSets = 1;
-    info.poolSizeCount = 1;
-    info.pPoolSizes = &poolSize;
-
-    if (vkCreateDescriptorPool(device, &info, nullptr, &waterDescriptorPool) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create water descriptor pool!");
-}
-
-void VulkanBase::createWaterDescriptors()
-{
-    VkDescriptorSetAllocateInfo alloc{};
-    alloc.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    alloc.descriptorPool = waterDescriptorPool;
-    alloc.descriptorSetCount = 1;
-    alloc.pSetLayouts = &waterDescriptorSetLayout;
-
-    if (vkAllocateDescriptorSets(device, &alloc, &waterDescriptorSet) != VK_SUCCESS)
-        throw std::runtime_error("Failed allocating water descriptor set!");
+    descriptorAllocator->registerLayout(waterDescriptorSetLayout, bindings.data(), static_cast<uint32_t>(bindings.size()));
 }
 
 void VulkanBase::updateWaterDescriptors()
@@ -3997,11 +6177,14 @@ void VulkanBase::updateWaterDescriptors()
     reflectionInfo.sampler = sceneReflectionSampler;
     reflectionInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
+    // Image info for the SSR depth pyramid, recreated with the targets
+    VkDescriptorImageInfo ssrPyramidInfo{screenSpaceReflections->getSampler(), screenSpaceReflections->getPyramidView(), VK_IMAGE_LAYOUT_GENERAL};
+
     // ------------------------------
     // Write all descriptor bindings
     // ------------------------------
 
-    std::array<VkWriteDescriptorSet, 5> writes{};
+    std::array<VkWriteDescriptorSet, 6> writes{};
 
     // Binding 0 ? scene color (refraction)
     writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -4048,6 +6231,11 @@ void VulkanBase::updateWaterDescriptors()
     writes[4].descriptorCount = 1;
     writes[4].pImageInfo = &reflectionInfo;
 
+    // Binding 8 ? SSR depth pyramid
+    writes[5] = writes[4];
+    writes[5].dstBinding = ScreenSpaceReflections::kWaterBinding;
+    writes[5].pImageInfo = &ssrPyramidInfo;
+
     // Update all descriptors
     vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 
@@ -4124,7 +6312,7 @@ void VulkanBase::createSceneColorTexture()
     samplerInfo.minLod = 0.0f;
     samplerInfo.maxLod = 1.0f;
 
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &sceneColorSampler) != VK_SUCCESS)
+    if (sceneColorSampler == VK_NULL_HANDLE && vkCreateSampler(device, &samplerInfo, nullptr, &sceneColorSampler) != VK_SUCCESS)
     {
         throw std::runtime_error("createSceneColorTexture: failed to create sampler!");
     }
@@ -4138,169 +6326,24 @@ void VulkanBase::createSceneColorTexture()
 void VulkanBase::createSceneReflectionTexture()
 {
     VkExtent2D extent = swapChainManager->getSwapChainExtent();
-    uint32_t mipLevels = 1; // no mips needed for render target
-
-    createImage(
-        extent.width,
-        extent.height,
-        mipLevels,
-        VK_SAMPLE_COUNT_1_BIT,
-        swapChainManager->getSwapChainImageFormat(),
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        sceneReflectionImage,
-        sceneReflectionImageMemory);
-
-    // create image view
-    sceneReflectionImageView = createImageView(sceneReflectionImage, swapChainManager->getSwapChainImageFormat(), VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
-
-    // create sampler
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.anisotropyEnable = VK_FALSE;
-    samplerInfo.maxAnisotropy = 1.0f;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
-
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &sceneReflectionSampler) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create scene reflection sampler!");
-    }
-
-    // Ensure the reflection image is transitioned to a shader-readable layout so
-    // it can be sampled even if the offscreen reflection pass is not executed.
-    VkFormat format = swapChainManager->getSwapChainImageFormat();
-    transitionImageLayout(sceneReflectionImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
-}
-
-void VulkanBase::createSceneRefractionTexture()
-{
-    VkExtent2D extent = swapChainManager->getSwapChainExtent();
-    uint32_t mipLevels = 1; // no mips needed for render target
-
-    createImage(
-        extent.width,
-        extent.height,
-        mipLevels,
-        VK_SAMPLE_COUNT_1_BIT,
-        swapChainManager->getSwapChainImageFormat(),
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        sceneRefractionImage,
-        sceneRefractionImageMemory);
-
-    sceneRefractionImageView = createImageView(sceneRefractionImage, swapChainManager->getSwapChainImageFormat(), VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
-
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    samplerInfo.anisotropyEnable = VK_FALSE;
-    samplerInfo.maxAnisotropy = 1.0f;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
-
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &sceneRefractionSampler) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create scene refraction sampler!");
-    }
-}
-
-void VulkanBase::createSceneReflectionRenderPassAndFramebuffer()
-{
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChainManager->getSwapChainImageFormat();
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; // we'll transition to SHADER_READ after rendering
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = nullptr; // No depth attachment for offscreen reflection pass
-
-    std::array<VkAttachmentDescription, 1> attachments = {colorAttachment};
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &sceneReflectionRenderPass) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create reflection render pass!");
-    }
-
-    std::array<VkImageView, 1> attachmentsViews = {sceneReflectionImageView};
-
-    VkFramebufferCreateInfo fbInfo{};
-    fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    fbInfo.renderPass = sceneReflectionRenderPass;
-    fbInfo.attachmentCount = static_cast<uint32_t>(attachmentsViews.size());
-    fbInfo.pAttachments = attachmentsViews.data();
-    fbInfo.width = swapChainManager->getSwapChainExtent().width;
-    fbInfo.height = swapChainManager->getSwapChainExtent().height;
-    fbInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device, &fbInfo, nullptr, &sceneReflectionFramebuffer) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create reflection framebuffer!");
-    }
-}
-
-void VulkanBase::createSceneRefractionRenderPassAndFramebuffer()
-{
-    if (refractionExtent.width == 0 || refractionExtent.height == 0)
-    {
-        refractionExtent = swapChainManager->getSwapChainExtent();
-    }
-
-    VkExtent2D extent = refractionExtent;
-    VkFormat format = swapChainManager->getSwapChainImageFormat();
+    uint32_t mipLevels = 1; // no mips needed for render target
 
     createImage(
         extent.width,
         extent.height,
-        1,
+        mipLevels,
         VK_SAMPLE_COUNT_1_BIT,
-        format,
+        swapChainManager->getSwapChainImageFormat(),
         VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        sceneRefractionImage,
-        sceneRefractionImageMemory);
+        sceneReflectionImage,
+        sceneReflectionImageMemory);
 
-    sceneRefractionImageView = createImageView(sceneRefractionImage, format, VK_IMAGE_ASPECT_COLOR_BIT, 1, false);
+    // create image view
+    sceneReflectionImageView = createImageView(sceneReflectionImage, swapChainManager->getSwapChainImageFormat(), VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, false);
 
+    // create sampler
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -4313,139 +6356,19 @@ void VulkanBase::createSceneRefractionRenderPassAndFramebuffer()
     samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
     samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 1.0f;
-
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &sceneRefractionSampler) != VK_SUCCESS)
-    {
-        throw std::runtime_error("createSceneRefractionRenderPassAndFramebuffer: failed to create sampler!");
-    }
-
-    // If the refraction pass is not executed before sampling, make sure the image
-    // is at least transitioned to SHADER_READ_ONLY_OPTIMAL so shaders can sample it.
-    transitionImageLayout(sceneRefractionImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
-
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = format;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    VkAttachmentReference colorRef{};
-    colorRef.attachment = 0;
-    colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorRef;
-    subpass.pDepthStencilAttachment = nullptr; // No depth attachment for offscreen refraction pass
-
-    std::array<VkAttachmentDescription, 1> attachments = {colorAttachment};
-
-    VkRenderPassCreateInfo rpInfo{};
-    rpInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    rpInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    rpInfo.pAttachments = attachments.data();
-    rpInfo.subpassCount = 1;
-    rpInfo.pSubpasses = &subpass;
-
-    if (vkCreateRenderPass(device, &rpInfo, nullptr, &sceneRefractionRenderPass) != VK_SUCCESS)
-    {
-        throw std::runtime_error("createSceneRefractionRenderPassAndFramebuffer: failed to create render pass");
-    }
-
-    // Ensure the image views exist
-    if (sceneRefractionImageView == VK_NULL_HANDLE)
-    {
-        throw std::runtime_error("createSceneRefractionRenderPassAndFramebuffer: sceneRefractionImageView is VK_NULL_HANDLE");
-    }
-
-    std::array<VkImageView, 1> attachmentsViews = {sceneRefractionImageView};
-
-    VkFramebufferCreateInfo fbInfo{};
-    fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    fbInfo.renderPass = sceneRefractionRenderPass;
-    fbInfo.attachmentCount = static_cast<uint32_t>(attachmentsViews.size());
-    fbInfo.pAttachments = attachmentsViews.data();
-    fbInfo.width = extent.width;
-    fbInfo.height = extent.height;
-    fbInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device, &fbInfo, nullptr, &sceneRefractionFramebuffer) != VK_SUCCESS)
-    {
-        throw std::runtime_error("createSceneRefractionRenderPassAndFramebuffer: failed to create framebuffer");
-    }
-
-    // std::cout << "[DEBUG] createSceneRefractionRenderPassAndFramebuffer: created\n";
-}
-
-void VulkanBase::createSceneRenderPassAndFramebuffer()
-{
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChainManager->getSwapChainImageFormat();
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // we want to keep data so we can sample it
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    // final layout must be SHADER_READ_ONLY_OPTIMAL so we can sample it in subsequent pass
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    VkAttachmentReference colorRef{};
-    colorRef.attachment = 0;
-    colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorRef;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependency.dependencyFlags = 0;
-
-    VkRenderPassCreateInfo rpInfo{};
-    rpInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    rpInfo.attachmentCount = 1;
-    rpInfo.pAttachments = &colorAttachment;
-    rpInfo.subpassCount = 1;
-    rpInfo.pSubpasses = &subpass;
-    rpInfo.dependencyCount = 1;
-    rpInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(device, &rpInfo, nullptr, &sceneRenderPass) != VK_SUCCESS)
-    {
-        throw std::runtime_error("createSceneRenderPassAndFramebuffer: failed to create render pass");
-    }
-
-    VkImageView attachments[1] = {sceneColorImageView};
-
-    VkFramebufferCreateInfo fbInfo{};
-    fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    fbInfo.renderPass = sceneRenderPass;
-    fbInfo.attachmentCount = 1;
-    fbInfo.pAttachments = attachments;
-    fbInfo.width = swapChainManager->getSwapChainExtent().width;
-    fbInfo.height = swapChainManager->getSwapChainExtent().height;
-    fbInfo.layers = 1;
+    samplerInfo.maxLod = 0.0f;
 
-    if (vkCreateFramebuffer(device, &fbInfo, nullptr, &sceneFramebuffer) != VK_SUCCESS)
+    if (sceneReflectionSampler == VK_NULL_HANDLE && vkCreateSampler(device, &samplerInfo, nullptr, &sceneReflectionSampler) != VK_SUCCESS)
     {
-        throw std::runtime_error("createSceneRenderPassAndFramebuffer: failed to create framebuffer");
+        throw std::runtime_error("failed to create scene reflection sampler!");
     }
 
-    // std::cout << "[DEBUG] createSceneRenderPassAndFramebuffer: created\n";
+    // Ensure the reflection image is transitioned to a shader-readable layout so
+    // it can be sampled even if the offscreen reflection pass is not executed.
+    VkFormat format = swapChainManager->getSwapChainImageFormat();
+    transitionImageLayout(sceneReflectionImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
 }
 
 void VulkanBase::createWaterDescriptorSet()
@@ -4464,18 +6387,7 @@ void VulkanBase::createWaterDescriptorSet()
     // std::cout << "sceneReflectionSampler: " << sceneReflectionSampler << "\n";
     // std::cout << "=========================================\n\n";
 
-    VkDescriptorPool pool = descriptorPool->getDescriptorPool();
-
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = pool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &waterDescriptorSetLayout;
-
-    if (vkAllocateDescriptorSets(device, &allocInfo, &waterDescriptorSet) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate water descriptor set!");
-    }
+    waterDescriptorSet = descriptorAllocator->allocate(waterDescriptorSetLayout);
 
     // Binding 0: refractionTex (sceneColorImageView)
     VkDescriptorImageInfo sceneColorInfo{};
@@ -4508,7 +6420,23 @@ void VulkanBase::createWaterDescriptorSet()
     reflectionInfo.imageView = sceneReflectionImageView;
     reflectionInfo.sampler = sceneReflectionSampler;
 
-    std::array<VkWriteDescriptorSet, 5> descriptorWrites{};
+    // Binding 5-6: FFT ocean maps, kept in GENERAL
+    VkDescriptorImageInfo oceanDisplacementInfo{oceanFFT->getSampler(), oceanFFT->getDisplacementView(), VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo oceanNormalFoamInfo{oceanFFT->getSampler(), oceanFFT->getNormalFoamView(), VK_IMAGE_LAYOUT_GENERAL};
+
+    // Binding 7: WaterParams, the frame's copy picked by the dynamic offset
+    VkDescriptorBufferInfo waterParamsInfo{waterParamsBuffer->getBuffer(), 0, waterParamsBuffer->getRange()};
+
+    // Binding 8: SSR depth pyramid, kept in GENERAL
+    VkDescriptorImageInfo ssrPyramidInfo{screenSpaceReflections->getSampler(), screenSpaceReflections->getPyramidView(), VK_IMAGE_LAYOUT_GENERAL};
+
+    // Binding 9: computed caustics, kept in GENERAL
+    VkDescriptorImageInfo causticsMapInfo{oceanCaustics->getSampler(), oceanCaustics->getMapView(), VK_IMAGE_LAYOUT_GENERAL};
+
+    // Binding 10: integrated froxel volume, kept in GENERAL
+    VkDescriptorImageInfo froxelVolumeInfo{froxelVolume->getSampler(), froxelVolume->getVolumeView(), VK_IMAGE_LAYOUT_GENERAL};
+
+    std::array<VkWriteDescriptorSet, 11> descriptorWrites{};
 
     //  Binding 0 (Refraction)
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -4555,194 +6483,405 @@ void VulkanBase::createWaterDescriptorSet()
     descriptorWrites[4].descriptorCount = 1;
     descriptorWrites[4].pImageInfo = &reflectionInfo;
 
+    //  Binding 5-6 (FFT ocean)
+    descriptorWrites[5] = descriptorWrites[4];
+    descriptorWrites[5].dstBinding = 5;
+    descriptorWrites[5].pImageInfo = &oceanDisplacementInfo;
+    descriptorWrites[6] = descriptorWrites[4];
+    descriptorWrites[6].dstBinding = 6;
+    descriptorWrites[6].pImageInfo = &oceanNormalFoamInfo;
+
+    //  Binding 7 (WaterParams)
+    descriptorWrites[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[7].dstSet = waterDescriptorSet;
+    descriptorWrites[7].dstBinding = 7;
+    descriptorWrites[7].dstArrayElement = 0;
+    descriptorWrites[7].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrites[7].descriptorCount = 1;
+    descriptorWrites[7].pBufferInfo = &waterParamsInfo;
+
+    //  Binding 8 (SSR pyramid)
+    descriptorWrites[8] = descriptorWrites[4];
+    descriptorWrites[8].dstBinding = ScreenSpaceReflections::kWaterBinding;
+    descriptorWrites[8].pImageInfo = &ssrPyramidInfo;
+
+    //  Binding 9 (Computed caustics)
+    descriptorWrites[9] = descriptorWrites[4];
+    descriptorWrites[9].dstBinding = OceanCaustics::kWaterBinding;
+    descriptorWrites[9].pImageInfo = &causticsMapInfo;
+
+    //  Binding 10 (Froxel volume)
+    descriptorWrites[10] = descriptorWrites[4];
+    descriptorWrites[10].dstBinding = FroxelVolume::kWaterBinding;
+    descriptorWrites[10].pImageInfo = &froxelVolumeInfo;
+
     vkUpdateDescriptorSets(device,
                            static_cast<uint32_t>(descriptorWrites.size()),
                            descriptorWrites.data(),
                            0, nullptr);
 }
 
-glm::mat4 VulkanBase::calculateProjectionMatrix()
+void VulkanBase::DrawSkybox(VkCommandBuffer cmd, uint32_t imageIndex, const SceneView &view, float lod)
 {
-    VkExtent2D extent = swapChainManager->getSwapChainExtent();
-    float aspectRatio = (float)extent.width / (float)extent.height;
+    //  std::cout << "[DEBUG] About to bind skybox pipeline: " << skyboxPipeline->pipeline << "\n";
+    skyboxPipeline->bind(cmd);
 
-    glm::mat4 proj = glm::perspective(
-        glm::radians(camera.zoom),
-        aspectRatio,
-        0.1f,
-        1000.0f);
-
-    proj[1][1] *= -1;
-
-    return proj;
+    const VkDescriptorSet skySet = atmosphericSky ? atmosphereSkyDescriptorSet : skyboxDescriptorSet;
+    std::array<VkDescriptorSet, 2> sets = {descriptorSets[imageIndex], skySet};
+    vkCmdBindDescriptorSets(
+        cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        skyboxPipeline->layout,
+        0,
+        static_cast<uint32_t>(sets.size()),
+        sets.data(),
+        static_cast<uint32_t>(view.uniformOffsets.size()), view.uniformOffsets.data());
+
+    // Push constant: skybox scale and level
+    SkyboxPipeline::PushConstants push{500.0f, lod};
+    vkCmdPushConstants(cmd,
+                       skyboxPipeline->layout,
+                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0,
+                       sizeof(push),
+                       &push);
+
+    skyboxMesh->draw(cmd);
 }
-// ==============================================================================
-// 1. REFLECTION PASS IMPLEMENTATION
-// ==============================================================================
-void VulkanBase::recordReflectionPass(CommandBuffer &commandBuffer, uint32_t imageIndex)
+
+void VulkanBase::DrawSceneObjects(VkCommandBuffer cmd, uint32_t imageIndex, const SceneView &view, size_t firstDraw, size_t drawCount,
+                                  ScenePass pass)
 {
-    // --- TEMPORARILY MANIPULATE CAMERA STATE ---
-    // Store original state to restore later
-    glm::vec3 originalPos = this->camera.position;
-    float originalPitch = this->camera.pitch;
+    // std::cout << "[DEBUG] DrawSceneObjects: About to bind graphics pipeline: " << graphicsPipeline << "\n";
+    // std::cout << "[DEBUG] DrawSceneObjects: Main renderPass: " << renderPass << "\n";
+    // std::cout << "[DEBUG] DrawSceneObjects: ImGui renderPass: " << imguiRenderPass << "\n";
+
+    const VkPipeline pipeline = pass == ScenePass::DepthPrePass   ? prePassPipeline
+                                : pass == ScenePass::AfterPrePass ? afterPrePassPipeline
+                                                                  : graphicsPipeline;
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+    VkBuffer vertexBuffers[] = {vertexBuffer};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(cmd, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // Bind both descriptor sets: set 0 (scene) and set 1 (water - needed for caustic texture in shader)
+    // Even when not underwater, we need to bind set 1 because the shader declares it
+    std::array<VkDescriptorSet, 2> sceneSets = {descriptorSets[imageIndex], waterDescriptorSet};
+    // Sets 2-3 and the material indices stay bound across the per-object rebinds of sets 0-1
+    bindMaterialTable(cmd);
+    bindShadowSet(cmd);
+
+    if (view.gpuDriven)
+    {
+        // One indirect draw for the whole scene; the frame UBO supplies view/proj only
+        const VkPipeline indirectPipeline = pass == ScenePass::DepthPrePass   ? prePassIndirectPipeline
+                                            : pass == ScenePass::AfterPrePass ? afterPrePassIndirectPipeline
+                                                                              : indirectGraphicsPipeline;
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, indirectPipeline);
+        const std::array<uint32_t, 4> setOffsets = withWaterParamsOffset(view.uniformOffsets);
+        vkCmdBindDescriptorSets(
+            cmd,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0, 2,
+            sceneSets.data(),
+            static_cast<uint32_t>(setOffsets.size()), setOffsets.data());
+        gpuCulling->recordDraw(cmd, static_cast<uint32_t>(currentFrame));
+        return;
+    }
+
+    std::array<uint32_t, 4> objectOffsets = withWaterParamsOffset(view.uniformOffsets);
 
-    glm::mat4 currentProj = this->calculateProjectionMatrix();
+    size_t lastDraw = std::min(firstDraw + drawCount, view.drawList.size());
+    if (view.instanced)
+    {
+        // The per-instance pipelines take the model matrices from binding 1; the UBO is the view's only
+        const VkPipeline instancedPipeline = pass == ScenePass::DepthPrePass   ? prePassIndirectPipeline
+                                             : pass == ScenePass::AfterPrePass ? afterPrePassIndirectPipeline
+                                                                               : indirectGraphicsPipeline;
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, instancedPipeline);
+        const VkBuffer instanceBuffer = uniformArena->getBuffer();
+        uint32_t boundOffset = UINT32_MAX;
+        for (size_t i = firstDraw; i < lastDraw; i++)
+        {
+            const SceneDraw &draw = view.drawList[i];
 
-    glm::vec3 reflectedPos = originalPos;
-    reflectedPos.y = -originalPos.y + 0.5f;
+            // Every batch of a view shares its UBO: bound once
+            if (draw.uniformOffset != boundOffset)
+            {
+                objectOffsets[0] = boundOffset = draw.uniformOffset;
+                vkCmdBindDescriptorSets(
+                    cmd,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipelineLayout,
+                    0, 2,
+                    sceneSets.data(),
+                    static_cast<uint32_t>(objectOffsets.size()), objectOffsets.data());
+            }
 
-    this->camera.position = reflectedPos;
-    this->camera.pitch = -originalPitch; // Flip pitch angle for reflection
+            const VkDeviceSize instanceOffset = draw.instanceOffset;
+            vkCmdBindVertexBuffers(cmd, GpuCulling::kInstanceBinding, 1, &instanceBuffer, &instanceOffset);
+            vkCmdDrawIndexed(cmd, draw.range.indexCount, draw.instanceCount,
+                             draw.range.firstIndex, draw.range.vertexOffset, 0);
+        }
+        return;
+    }
 
-    glm::mat4 reflectedView = this->camera.getViewMatrix();
+    for (size_t i = firstDraw; i < lastDraw; i++)
+    {
+        const SceneDraw &draw = view.drawList[i];
 
-    this->camera.position = originalPos;
-    this->camera.pitch = originalPitch;
-    // --------------------------------------------------
+        // Only the UBO offset changes per object; LightInfo/ToggleInfo/WaterParams stay shared
+        objectOffsets[0] = draw.uniformOffset;
+        vkCmdBindDescriptorSets(
+            cmd,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0, 2,
+            sceneSets.data(),
+            static_cast<uint32_t>(objectOffsets.size()), objectOffsets.data());
 
-    // CRITICAL: Update UBO with the reflected view matrix for this draw call
-    // You MUST call your UBO update function here!
-    // Example: this->updateGlobalUBO(imageIndex, reflectedView, originalProj);
+        vkCmdDrawIndexed(cmd, draw.range.indexCount, 1,
+                         draw.range.firstIndex, draw.range.vertexOffset, 0);
+    }
+}
 
-    // --------------------------------------------------
+void VulkanBase::appendSceneJobs(SecondaryCommandRecorder::RecordJobs &jobs, uint32_t imageIndex, const SceneView &view,
+                                 ScenePass pass)
+{
+    // Views are members, so the pointer outlives the frame's recording
+    const SceneView *viewPtr = &view;
 
-    // 2. BEGIN REFLECTION RENDER PASS
-    VkClearValue reflectionClearValue{};
-    reflectionClearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    // The GPU path is a single indirect draw; only the CPU draw list is worth splitting
+    size_t drawCount = view.gpuDriven ? 1 : view.drawList.size();
+    size_t threadCount = secondaryRecorder ? secondaryRecorder->getThreadCount() : 1;
+    size_t chunk = std::max(kMinDrawsPerJob, (drawCount + threadCount - 1) / threadCount);
+    for (size_t first = 0; first < drawCount; first += chunk)
+    {
+        jobs.push_back([this, imageIndex, viewPtr, first, chunk, pass](VkCommandBuffer cmd)
+                       { DrawSceneObjects(cmd, imageIndex, *viewPtr, first, chunk, pass); });
+    }
 
-    VkRenderPassBeginInfo reflectionPassInfo{};
-    reflectionPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    reflectionPassInfo.renderPass = this->sceneReflectionRenderPass;
-    reflectionPassInfo.framebuffer = this->sceneReflectionFramebuffer;
-    reflectionPassInfo.renderArea.offset = {0, 0};
-    reflectionPassInfo.renderArea.extent = this->reflectionExtent;
-    reflectionPassInfo.clearValueCount = 1;
-    reflectionPassInfo.pClearValues = &reflectionClearValue;
+    // The sky sits at the far plane, after the opaques: only what they left uncovered is shaded.
+    // Nothing for the pre-pass to reject; the reflection samples a coarse level of the cube. Its commands
+    // change only with what the key covers: recorded once per frame in flight and executed again until
+    // then (SecondaryCommandRecorder.h)
+    if (!useSolidBackground && pass != ScenePass::DepthPrePass)
+    {
+        const float skyLod = viewPtr == &reflectionView ? kReflectionSkyLod : -1.0f;
+        const VkDescriptorSet skySet = atmosphericSky ? atmosphereSkyDescriptorSet : skyboxDescriptorSet;
+        const uint64_t skyKey = SecondaryCommandRecorder::cacheKey(skyboxPipeline->pipeline, descriptorSets[imageIndex], skySet,
+                                                                   view.uniformOffsets, skyLod);
+        jobs.emplace_back([this, imageIndex, viewPtr, skyLod](VkCommandBuffer cmd)
+                          { DrawSkybox(cmd, imageIndex, *viewPtr, skyLod); },
+                          skyKey);
+    }
+}
 
-    vkCmdBeginRenderPass(commandBuffer.getVkCommandBuffer(), &reflectionPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+void VulkanBase::recordPassJobs(const RenderGraphPassContext &pass, const SecondaryCommandRecorder::RecordJobs &jobs,
+                                float renderScale)
+{
+    VkExtent2D extent = pass.extent;
+    if (renderScale < 1.0f)
+    {
+        extent.width = std::max(1u, static_cast<uint32_t>(extent.width * renderScale + 0.5f));
+        extent.height = std::max(1u, static_cast<uint32_t>(extent.height * renderScale + 0.5f));
+    }
 
-    // 3. DRAW SCENE
-    this->DrawSceneObjects(commandBuffer, imageIndex);
-    // --- 4. END PASS ---
-    vkCmdEndRenderPass(commandBuffer.getVkCommandBuffer());
+    if (pass.contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+    {
+        if (pass.renderPass == VK_NULL_HANDLE)
+            secondaryRecorder->record(pass.formats, extent, jobs, secondaryBuffers); // Dynamic rendering
+        else
+            secondaryRecorder->record(pass.renderPass, 0, pass.framebuffer, extent, jobs, secondaryBuffers);
+        if (!secondaryBuffers.empty())
+        {
+            vkCmdExecuteCommands(pass.cmd, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+        }
+        return;
+    }
 
-    // Restore UBO to the original view matrix after the pass is done
-    // this->updateUniformBuffer(imageIndex, camera.getViewMatrix(), camera.getProjectionMatrix());
+    SecondaryCommandRecorder::setViewport(pass.cmd, extent);
+    for (const auto &job : jobs)
+    {
+        job(pass.cmd);
+    }
 }
 
-// ==============================================================================
-// 2. REFRACTION PASS IMPLEMENTATION
-// ==============================================================================
-void VulkanBase::recordRefractionPass(CommandBuffer &commandBuffer, uint32_t imageIndex)
+void VulkanBase::buildSceneDrawList()
 {
-    updateUniformBuffer(imageIndex);
+    // First, so the cull statistics shown are the main view's
+    buildShadowDrawList();
+
+    mainView.gpuDriven = gpuDrivenScene && gpuCulling;
+    if (mainView.gpuDriven)
+    {
+        // Culled on the GPU from the object table instead
+        mainView.drawList.clear();
+        gpuCulling->updateObjects(static_cast<uint32_t>(currentFrame), scene);
+    }
+    else
+    {
+        buildViewDrawList(mainView, frameUBO);
+    }
 
-    VkClearValue refractionClearValue{};
-    refractionClearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    // Only built when the reflection pass will be kept alive (culled underwater and with screen-space
+    // reflections, not declared on throttled frames or when the scene is traced)
+    reflectionView.drawList.clear();
+    if (waterOffscreenPasses && offscreenThrottle.isDue() && !isCameraUnderwater() && !useScreenSpaceReflections() &&
+        !tracesSceneRays())
+    {
+        UBO reflectionUBO = frameUBO;
+        reflectionUBO.view = reflectionViewMatrix;
+        reflectionUBO.viewPos.y = -reflectionUBO.viewPos.y; // Mirrored across the water plane (y = 0)
 
-    VkRenderPassBeginInfo refractionPassInfo{};
-    refractionPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    refractionPassInfo.renderPass = this->sceneRefractionRenderPass;
-    refractionPassInfo.framebuffer = this->sceneRefractionFramebuffer;
-    refractionPassInfo.renderArea.offset = {0, 0};
-    refractionPassInfo.renderArea.extent = this->refractionExtent;
-    refractionPassInfo.clearValueCount = 1;
-    refractionPassInfo.pClearValues = &refractionClearValue;
+        reflectionView.uniformOffsets = mainView.uniformOffsets;
+        reflectionView.uniformOffsets[0] = uniformArena->push(reflectionUBO);
+        // The indirect commands are culled for the main camera, so the mirrored view draws from the CPU list
+        buildViewDrawList(reflectionView, reflectionUBO, kOffscreenLodScale, offscreenThrottle.getScale());
+    }
 
-    vkCmdBeginRenderPass(commandBuffer.getVkCommandBuffer(), &refractionPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    refractionView.drawList.clear();
+    if (refractionHasOwnView())
+    {
+        refractionView.uniformOffsets = mainView.uniformOffsets;
+        buildViewDrawList(refractionView, frameUBO, kOffscreenLodScale, offscreenThrottle.getScale());
+    }
+}
 
-    this->DrawSceneObjects(commandBuffer, imageIndex);
+bool VulkanBase::sharesSceneCapture() const
+{
+    const bool traceReflections = useScreenSpaceReflections() && !isCameraUnderwater();
+    return waterOffscreenPasses && offscreenThrottle.isDue() && !traceReflections && !tracesSceneRays() &&
+           offscreenThrottle.getScale() >= 1.0f;
+}
 
-    vkCmdEndRenderPass(commandBuffer.getVkCommandBuffer());
+bool VulkanBase::cameraCrossesWaterline() const
+{
+    // The near plane's corners are its highest and lowest points; the surface is taken as flat across it
+    const VkExtent2D extent = getViewExtent();
+    const float halfHeight = kCameraNear * std::tan(glm::radians(camera.zoom) * 0.5f);
+    const float halfWidth = halfHeight * extent.width / (float)extent.height;
+    const float centre = camera.position.y + camera.front.y * kCameraNear - cameraWaterHeight;
+    const float reach = std::abs(camera.up.y) * halfHeight + std::abs(camera.right.y) * halfWidth + TileClassifier::kWaterlineEdge;
+    return centre - reach < 0.0f && centre + reach > 0.0f;
 }
 
-// ==============================================================================
-// 3. IMAGE BARRIERS IMPLEMENTATION
-// ==============================================================================
-void VulkanBase::insertWaterTextureBarriers(CommandBuffer &commandBuffer)
+bool VulkanBase::refractionHasOwnView() const
 {
-    VkImageMemoryBarrier barrierReflection{};
-    barrierReflection.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrierReflection.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    barrierReflection.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrierReflection.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrierReflection.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrierReflection.image = sceneReflectionImage;
-    barrierReflection.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrierReflection.subresourceRange.baseMipLevel = 0;
-    barrierReflection.subresourceRange.levelCount = 1;
-    barrierReflection.subresourceRange.baseArrayLayer = 0;
-    barrierReflection.subresourceRange.layerCount = 1;
-    barrierReflection.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    barrierReflection.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    return waterOffscreenPasses && offscreenThrottle.isDue() && meshLods && !mainView.gpuDriven && !sharesSceneCapture() &&
+           !tracesSceneRays();
+}
 
-    VkImageMemoryBarrier barrierRefraction = barrierReflection;
-    barrierRefraction.image = sceneRefractionImage;
-    std::array<VkImageMemoryBarrier, 2> barriers = {barrierReflection, barrierRefraction};
-    vkCmdPipelineBarrier(
-        commandBuffer.getVkCommandBuffer(),
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        0,
-        0, nullptr,
-        0, nullptr,
-        static_cast<uint32_t>(barriers.size()), barriers.data());
+void VulkanBase::buildShadowDrawList()
+{
+    // Same projection as updateUniformBuffer: the cascades split its frustum
+    const VkExtent2D extent = getViewExtent();
+    shadowCascades->setRoundRobin(shadowRoundRobin);
+    shadowCascades->update(camera.getPosition(), camera.front, camera.up, camera.right, glm::radians(camera.zoom),
+                           extent.width / (float)extent.height, kCameraNear, light0Position);
+    shadowUniformOffset = shadowCascades->writeUniforms(static_cast<uint32_t>(currentFrame));
+
+    // One cull against every cascade due; each of them draws the whole list
+    shadowDrawList.clear();
+    if (shadowCascades->getDueCount() > 0)
+    {
+        // Levels picked from the camera, which is where the shadows are looked at from
+        shadowLod.cameraPosition = camera.getPosition();
+        shadowLod.pixelsPerUnit = extent.height * 0.5f / std::tan(glm::radians(camera.zoom) * 0.5f);
+        shadowLod.maxPixelError = lodPixelError * kOffscreenLodScale;
+        scene.buildDrawList(shadowCascades->getCasterViewProjection(), shadowDrawList, meshLods ? &shadowLod : nullptr);
+    }
+    shadowCasterCount = static_cast<uint32_t>(shadowDrawList.size());
+    batchInstances(shadowDrawList);
+    orderDraws(shadowDrawList);
 }
 
-void VulkanBase::DrawSceneObjects(CommandBuffer &commandBuffer, uint32_t imageIndex)
+void VulkanBase::bindShadowSet(VkCommandBuffer cmd) const
 {
-    if (!useSolidBackground)
-    {
-        //  std::cout << "[DEBUG] About to bind skybox pipeline: " << skyboxPipeline->pipeline << "\n";
-        skyboxPipeline->bind(commandBuffer.getVkCommandBuffer());
+    VkDescriptorSet shadowSet = shadowCascades->getSet();
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                            ShadowCascades::kSetIndex, 1, &shadowSet, 1, &shadowUniformOffset);
+}
 
-        std::array<VkDescriptorSet, 2> sets = {descriptorSets[imageIndex], skyboxDescriptorSet};
-        vkCmdBindDescriptorSets(
-            commandBuffer.getVkCommandBuffer(),
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            skyboxPipeline->layout,
-            0,
-            static_cast<uint32_t>(sets.size()),
-            sets.data(),
-            0,
-            nullptr);
+void VulkanBase::buildViewDrawList(SceneView &view, const UBO &viewUBO, float lodBudgetScale, float targetScale)
+{
+    view.gpuDriven = false;
+    view.instanced = instancedDraws;
 
-        // Push constant: skybox scale
-        float skyboxScale = 500.0f;
-        vkCmdPushConstants(commandBuffer.getVkCommandBuffer(),
-                           skyboxPipeline->layout,
-                           VK_SHADER_STAGE_VERTEX_BIT,
-                           0,
-                           sizeof(float),
-                           &skyboxScale);
+    // proj[1][1] is negative: the projection flips Y for Vulkan
+    view.lod.cameraPosition = viewUBO.viewPos;
+    view.lod.pixelsPerUnit = swapChainManager->getSwapChainExtent().height * targetScale * 0.5f * std::abs(viewUBO.proj[1][1]);
+    view.lod.maxPixelError = lodPixelError * lodBudgetScale;
+    scene.buildDrawList(viewUBO.proj * viewUBO.view, view.drawList, meshLods ? &view.lod : nullptr);
 
-        skyboxMesh->draw(commandBuffer.getVkCommandBuffer());
+    if (!view.instanced)
+    {
+        // One UBO per drawn object: the view's camera/light data with the object's model matrix
+        for (SceneDraw &draw : view.drawList)
+        {
+            UBO objectUBO = viewUBO;
+            objectUBO.model = scene.getModelMatrix(draw.objectIndex);
+            objectUBO.material = glm::uvec4(scene.getMaterialId(draw.objectIndex), 0, 0, 0);
+            draw.uniformOffset = uniformArena->push(objectUBO);
+        }
+        orderDraws(view.drawList);
+        return;
     }
 
-    // std::cout << "[DEBUG] DrawSceneObjects: About to bind graphics pipeline: " << graphicsPipeline << "\n";
-    // std::cout << "[DEBUG] DrawSceneObjects: Main renderPass: " << renderPass << "\n";
-    // std::cout << "[DEBUG] DrawSceneObjects: ImGui renderPass: " << imguiRenderPass << "\n";
+    // The UBO is the view's only: the batches carry the model matrices
+    const uint32_t viewOffset = uniformArena->push(viewUBO);
+    batchInstances(view.drawList);
+    for (SceneDraw &draw : view.drawList)
+    {
+        draw.uniformOffset = viewOffset;
+    }
+    orderDraws(view.drawList);
+}
 
-    vkCmdBindPipeline(commandBuffer.getVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+void VulkanBase::orderDraws(std::vector<SceneDraw> &draws)
+{
+    // The list came grouped by mesh for batching; once batched, depth goes first: front to back
+    // across the whole list. Each view draws with a single pipeline, so those fields stay 0
+    for (SceneDraw &draw : draws)
+    {
+        draw.sortKey = DrawKey::make(DrawKey::Layer::Opaque, 0, 0, DrawKey::quantizeDepth(draw.depth), 0);
+    }
+    scene.sortDraws(draws);
+}
 
-    VkBuffer vertexBuffers[] = {vertexBuffer};
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer.getVkCommandBuffer(), 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer.getVkCommandBuffer(), indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+void VulkanBase::batchInstances(std::vector<SceneDraw> &draws)
+{
+    // Sorted by mesh then level: each run of one mesh at one level becomes a single draw whose model
+    // matrices and materials go to the arena as per-instance data, in the GPU-driven object table's layout
+    size_t batchCount = 0;
+    for (size_t first = 0; first < draws.size();)
+    {
+        const uint32_t meshIndex = scene.getMeshIndex(draws[first].objectIndex);
+        const uint32_t lod = draws[first].lod;
+        size_t last = first + 1;
+        while (last < draws.size() && scene.getMeshIndex(draws[last].objectIndex) == meshIndex && draws[last].lod == lod)
+        {
+            last++;
+        }
 
-    // Bind both descriptor sets: set 0 (scene) and set 1 (water - needed for caustic texture in shader)
-    // Even when not underwater, we need to bind set 1 because the shader declares it
-    std::array<VkDescriptorSet, 2> sceneSets = {descriptorSets[imageIndex], waterDescriptorSet};
-    vkCmdBindDescriptorSets(
-        commandBuffer.getVkCommandBuffer(),
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        0, 2,
-        sceneSets.data(),
-        0, nullptr);
+        instanceScratch.resize(last - first);
+        for (size_t i = first; i < last; i++)
+        {
+            GpuCullObject &instance = instanceScratch[i - first];
+            instance.model = scene.getModelMatrix(draws[i].objectIndex);
+            instance.materialId = scene.getMaterialId(draws[i].objectIndex);
+        }
 
-    // std::cout << "[DEBUG] DrawSceneObjects: About to call vkCmdDrawIndexed with " << indices.size() << " indices\n";
-    vkCmdDrawIndexed(commandBuffer.getVkCommandBuffer(), static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+        SceneDraw batch = draws[first];
+        batch.instanceCount = static_cast<uint32_t>(last - first);
+        batch.instanceOffset = uniformArena->push(instanceScratch.data(), instanceScratch.size() * sizeof(GpuCullObject));
+        draws[batchCount++] = batch;
+        first = last;
+    }
+    draws.resize(batchCount);
 }
 void VulkanBase::printMatrix(const glm::mat4 &mat, const std::string &name)
 {
@@ -4759,20 +6898,14 @@ void VulkanBase::printMatrix(const glm::mat4 &mat, const std::string &name)
 
 void VulkanBase::processInput(float deltaTime)
 {
+    // Movement is applied by the simulation step, scaled by its delta time
     if (lmbPressed)
     {
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-            camera.processKeyboard(GLFW_KEY_W, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-            camera.processKeyboard(GLFW_KEY_S, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-            camera.processKeyboard(GLFW_KEY_A, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-            camera.processKeyboard(GLFW_KEY_D, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-            camera.processKeyboard(GLFW_KEY_Q, deltaTime);
-        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-            camera.processKeyboard(GLFW_KEY_E, deltaTime);
+        for (uint32_t i = 0; i < std::size(SimulationInput::kMoveKeys); i++)
+        {
+            if (glfwGetKey(window, SimulationInput::kMoveKeys[i]) == GLFW_PRESS)
+                simulationInput.heldMoveKeys |= 1u << i;
+        }
     }
 
     if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !rKeyPressed)
@@ -4795,6 +6928,17 @@ void VulkanBase::processInput(float deltaTime)
     {
         screenshotRequested = false; // Reset the request flag
     }
+
+    // Kiosk mode: no UI at all
+    if (glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS && !f1KeyPressed)
+    {
+        uiHidden = !uiHidden;
+        f1KeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F1) == GLFW_RELEASE)
+    {
+        f1KeyPressed = false;
+    }
 }
 
 // ============================================================================
@@ -4807,6 +6951,9 @@ void VulkanBase::initializeWaterTestingSystem()
 
     VkUtils::QueueFamilyIndices indices = VkUtils::FindQueueFamilies(physicalDevice, surface);
     waterTestingSystem->initialize(device, physicalDevice, graphicsQueue, indices.graphicsFamily.value());
+    waterTestingSystem->setJobSystem(jobSystem.get());
+    waterTestingSystem->setGpuCounterNames(gpuCounters->getCounterNames());
+    referenceCache = std::make_unique<ReferenceImageCache>(headless ? headlessOptions.referenceDirectory : "references");
 
     // Set default camera path
     waterTestingSystem->setCameraPath(DeterministicCameraPath::createUnderwaterPath());
@@ -4833,6 +6980,103 @@ void VulkanBase::cleanupWaterTestingSystem()
     }
 }
 
+void VulkanBase::startTestSuite(std::vector<WaterTestConfig> configs)
+{
+    if (configs.empty() || !waterTestingSystem || isTestModeActive)
+        return;
+
+    pendingTestConfigs = reorderTestConfigs ? WaterTestingSystem::orderByStateChanges(std::move(configs)) : std::move(configs);
+    currentTestConfigIndex = 0;
+    prebuildTestPipelines(pendingTestConfigs);
+    startWaterTest(pendingTestConfigs[0]);
+}
+
+void VulkanBase::prebuildTestPipelines(const std::vector<WaterTestConfig> &configs)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    // Scene variants the suite switches to; the pre-pass ones are otherwise compiled when a config turns it on
+    std::set<MainPipelineKey> mainKeys;
+    std::set<std::tuple<WaterVariant, bool, bool>> waterVariants; // With the fog's tiled flag and the shading-rate flag
+    for (const WaterTestConfig &config : configs)
+    {
+        if (config.depthPrePass)
+        {
+            mainKeys.insert({VK_POLYGON_MODE_FILL, msaaSamples, false, true, false, true});
+            mainKeys.insert({VK_POLYGON_MODE_FILL, msaaSamples, false, false});
+            mainKeys.insert({VK_POLYGON_MODE_FILL, msaaSamples, true, true, false, true});
+            mainKeys.insert({VK_POLYGON_MODE_FILL, msaaSamples, true, false});
+        }
+
+        // As selectWaterVariants picks them with the debug views off: the config's mode underwater, BL above
+        // (where the effects never shade at variable rates)
+        const bool shadingRate = config.variableRateShading && shadingRates;
+        for (auto [mode, rates] : {std::make_pair(static_cast<uint32_t>(config.renderingMode), shadingRate), std::make_pair(0u, false)})
+        {
+            WaterVariant variant;
+            variant.renderingMode = config.specializedShaders ? mode : WaterVariant::kRuntime;
+            variant.debugView = config.specializedShaders ? 0 : WaterVariant::kRuntime;
+            waterVariants.insert({variant, config.tilingEnabled, rates});
+        }
+    }
+
+    // Scene pipelines in parallel (buildMainPipeline is thread-safe); the water pipelines keep their maps themselves
+    std::vector<MainPipelineKey> keys;
+    for (const MainPipelineKey &key : mainKeys)
+    {
+        if (mainPipelines.find(key) == mainPipelines.end())
+            keys.push_back(key);
+    }
+    std::vector<VkPipeline> built(keys.size(), VK_NULL_HANDLE);
+    jobSystem->run(static_cast<uint32_t>(keys.size()), [&](uint32_t jobIndex, uint32_t)
+                   { built[jobIndex] = buildMainPipeline(keys[jobIndex]); });
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        mainPipelines[keys[i]] = built[i];
+    }
+
+    for (const auto &[variant, tiled, shadingRate] : waterVariants)
+    {
+        for (WaterPipeline *pipeline : {waterPipeline.get(), waterTessPipeline.get(), sunraysPipeline.get(), lowResSunraysPipeline.get()})
+        {
+            if (pipeline)
+                pipeline->prebuild(variant, shadingRate && pipeline == sunraysPipeline.get());
+        }
+        for (UnderwaterWaterPipeline *pipeline : {underwaterWaterPipeline.get(), lowResUnderwaterPipeline.get()})
+        {
+            if (pipeline)
+                pipeline->prebuild(variant, tiled, shadingRate && pipeline == underwaterWaterPipeline.get());
+        }
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "[VulkanBase] Prebuilt " << keys.size() << " scene pipelines and " << waterVariants.size()
+              << " water variants for " << configs.size() << " configs in " << ms << " ms\n";
+}
+
+void VulkanBase::beginTestConfig(const WaterTestConfig &config)
+{
+    applyTestConfiguration(config);
+    // The run's references decoded while it warms up; compared at its reference frames if they exist
+    testReferenceScene = ReferenceImageCache::hashScene(config, waterTestingSystem->getCameraPath(), getViewExtent(), kFixedSimulationStep);
+    for (uint32_t frame : ReferenceImageCache::referenceFrames(config))
+    {
+        const ReferenceKey key = ReferenceImageCache::makeKey(testReferenceScene, waterTestingSystem->getCameraPath(), frame, config.totalFrames);
+        if (referenceCache->exists(key))
+            referenceCache->prefetch(key);
+    }
+    if (config.adaptiveWarmup)
+    {
+        // Flown along the run's path until frame times settle; the first run then restarts the clock
+        waterTestingSystem->beginWarmup(config);
+    }
+    else
+    {
+        waterTestingSystem->startTestRun(config, currentTestRunIndex);
+    }
+    restartTestClock(config, currentTestRunIndex);
+}
+
 void VulkanBase::startWaterTest(const WaterTestConfig &config)
 {
     if (!waterTestingSystem || isTestModeActive)
@@ -4840,39 +7084,39 @@ void VulkanBase::startWaterTest(const WaterTestConfig &config)
 
     isTestModeActive = true;
     currentTestRunIndex = 0;
+    waterTestingSystem->resetConfigSummaries();
 
     // Reset frame timing for accurate measurement from the start
     lastFrameTime = std::chrono::high_resolution_clock::now();
-    lastCpuTimeMs = 0.0;
+    lastFrameTimeMs = 0.0;
 
-    // Apply test configuration to rendering
-    applyTestConfiguration(config);
+    // Soak runs keep memory flat: every run of the queue appends to one log next to the CSV
+    const std::string frameLogPath = std::filesystem::path(testOutputFilePath).replace_extension(".xrfm").string();
+    waterTestingSystem->setFrameLogPath(streamFrameLog ? frameLogPath : "");
 
-    // Start the test run
-    waterTestingSystem->startTestRun(config, currentTestRunIndex);
+    // Apply the configuration, then warm it up or start its first run
+    beginTestConfig(config);
 
     std::cout << "[VulkanBase] Started water test: " << config.name << "\n";
 }
 
-void VulkanBase::preFrameWaterTestUpdate()
+void VulkanBase::restartTestClock(const WaterTestConfig &config, int runIndex)
 {
-    if (!waterTestingSystem || !isTestModeActive)
-        return;
-
-    // Get camera state for deterministic path
-    const auto &config = waterTestingSystem->getCurrentConfig();
-    uint32_t currentFrame = waterTestingSystem->getCurrentFrameIndex();
-
-    // Apply deterministic camera if test is running (before rendering)
-    if (waterTestingSystem->isTestRunning())
+    // Replay: run 0 goes in real time while the clock records, the later runs replay its times
+    const bool replay = config.clockMode == FrameClock::Mode::Replay;
+    if (replay && runIndex == 1)
     {
-        CameraKeyframe keyframe = waterTestingSystem->getCameraStateForFrame(currentFrame);
-
-        // Apply camera state (override user input during test)
-        camera.position = keyframe.position;
-        camera.setYaw(keyframe.yaw);
-        camera.setPitch(keyframe.pitch);
+        replayFrameTimes = simulation->getClockRecording();
     }
+
+    // A copy of the path: the simulation thread evaluates it while the test system moves on
+    simulation->setCameraPath([path = waterTestingSystem->getCameraPath(), totalFrames = config.totalFrames](uint64_t frame)
+                              {
+                                  const CameraKeyframe keyframe = path.atFrame(frame, totalFrames);
+                                  return CameraPose{keyframe.position, keyframe.yaw, keyframe.pitch}; });
+
+    // Every run animates from frame 0 at time 0
+    simulation->restartClock(replay && runIndex > 0 ? replayFrameTimes : std::vector<double>{});
 }
 
 void VulkanBase::postFrameWaterTestUpdate()
@@ -4880,21 +7124,29 @@ void VulkanBase::postFrameWaterTestUpdate()
     if (!waterTestingSystem || !isTestModeActive)
         return;
 
-    // Frame timing (lastCpuTimeMs) is now calculated in mainLoop:
-    // - Timer starts BEFORE drawFrame()
-    // - Timer ends AFTER vkQueueWaitIdle()
-    // This gives us the TRUE frame time including all GPU work
+    // Frame timing (lastFrameTimeMs) is calculated in mainLoop, once per completed frame:
+    // - Pipelined: interval between consecutive frames' timeline values being seen reached
+    // - Synced: from BEFORE drawFrame() to AFTER the frame timeline's wait
 
     // Get current state
     const auto &config = waterTestingSystem->getCurrentConfig();
     uint32_t currentFrame = waterTestingSystem->getCurrentFrameIndex();
 
-    if (waterTestingSystem->isTestRunning())
+    if (waterTestingSystem->isWarmingUp())
+    {
+        if (waterTestingSystem->recordWarmupFrame(lastFrameTimeMs))
+        {
+            const WaterTestConfig warmConfig = config; // startTestRun replaces the current config
+            waterTestingSystem->startTestRun(warmConfig, currentTestRunIndex);
+            restartTestClock(warmConfig, currentTestRunIndex);
+        }
+    }
+    else if (waterTestingSystem->isTestRunning())
     {
         // Record frame metrics with accurate timing
         waterTestingSystem->recordFrame(
             currentFrame,
-            lastCpuTimeMs,
+            lastFrameTimeMs,
             camera.position,
             camera.getYaw(),
             camera.getPitch());
@@ -4909,6 +7161,13 @@ void VulkanBase::postFrameWaterTestUpdate()
             if (autoExportResults)
             {
                 waterTestingSystem->appendRunToCSV(result, testOutputFilePath);
+                // Per-frame counters, with the vendor ones the run CSV has no fixed columns for
+                if (result.config.captureGpuCounters && !result.frameMetrics.empty())
+                {
+                    const std::filesystem::path framesPath = std::filesystem::path(testOutputFilePath).parent_path() /
+                                                             (result.config.name + "_run" + std::to_string(result.runIndex) + "_frames.csv");
+                    waterTestingSystem->exportRunToCSV(result, framesPath.string());
+                }
             }
 
             // Store result
@@ -4920,6 +7179,7 @@ void VulkanBase::postFrameWaterTestUpdate()
             {
                 // Start next run
                 waterTestingSystem->startTestRun(config, currentTestRunIndex);
+                restartTestClock(config, currentTestRunIndex);
             }
             else
             {
@@ -4929,8 +7189,7 @@ void VulkanBase::postFrameWaterTestUpdate()
                 {
                     // Start next config
                     currentTestRunIndex = 0;
-                    applyTestConfiguration(pendingTestConfigs[currentTestConfigIndex]);
-                    waterTestingSystem->startTestRun(pendingTestConfigs[currentTestConfigIndex], 0);
+                    beginTestConfig(pendingTestConfigs[currentTestConfigIndex]);
                 }
                 else
                 {
@@ -4942,13 +7201,6 @@ void VulkanBase::postFrameWaterTestUpdate()
     }
 }
 
-// Legacy function - kept for compatibility, now split into pre/post frame updates
-void VulkanBase::updateWaterTest()
-{
-    preFrameWaterTestUpdate();
-    // Note: postFrameWaterTestUpdate() is now called after drawFrame() in mainLoop()
-}
-
 void VulkanBase::endWaterTest()
 {
     if (!waterTestingSystem)
@@ -4958,6 +7210,9 @@ void VulkanBase::endWaterTest()
     currentTestConfigIndex = 0;
     currentTestRunIndex = 0;
     pendingTestConfigs.clear();
+    replayFrameTimes.clear();
+    simulation->setCameraPath({}); // The camera stays where the path left it
+    gpuCounters->setEnabled(false);
 
     std::cout << "[VulkanBase] Water testing completed. Total runs: " << completedTestResults.size() << "\n";
 
@@ -4969,26 +7224,495 @@ void VulkanBase::endWaterTest()
         {
             summaryMetrics.push_back(r.aggregated);
         }
-        waterTestingSystem->exportSummaryToCSV(summaryMetrics, "test_results/summary.csv");
+        std::filesystem::path summaryPath = std::filesystem::path(testOutputFilePath).parent_path() / "summary.csv";
+        waterTestingSystem->exportSummaryToCSV(summaryMetrics, summaryPath.string());
+
+        // Repeats of each config merged through their quantile sketches
+        std::filesystem::path configSummaryPath = summaryPath.parent_path() / "summary_by_config.csv";
+        waterTestingSystem->exportConfigSummaryToCSV(waterTestingSystem->getConfigSummaries(), configSummaryPath.string());
+
+        // A parameter sweep's configs: GPU time against reference SSIM, the undominated ones marked
+        if (std::any_of(completedTestResults.begin(), completedTestResults.end(), [](const TestRunResult &r)
+                        { return !r.config.sweptParameters.empty(); }))
+        {
+            std::filesystem::path paretoPath = summaryPath.parent_path() / "pareto.csv";
+            const size_t frontSize = ParameterSweep::writeParetoFront(completedTestResults, paretoPath.string());
+            std::cout << "[VulkanBase] " << frontSize << " configs on the Pareto front, written to " << paretoPath.string() << "\n";
+        }
+
+        compareAgainstBaseline();
+    }
+}
+
+void VulkanBase::compareAgainstBaseline()
+{
+    regressionCompared = false;
+    if (regressionBaselinePath.empty())
+        return;
+
+    FrameTimeSamples baseline;
+    if (!RegressionCompare::loadFrameTimes(regressionBaselinePath, baseline))
+        return;
+
+    // Streamed suites have no frames in memory: read the log back (every run it holds)
+    FrameTimeSamples candidate;
+    if (waterTestingSystem->isStreamingFrames())
+    {
+        waterTestingSystem->closeFrameLog();
+        const std::string logPath = std::filesystem::path(testOutputFilePath).replace_extension(".xrfm").string();
+        if (!RegressionCompare::loadFrameTimes(logPath, candidate))
+            return;
+    }
+    else
+    {
+        candidate = RegressionCompare::collectFrameTimes(completedTestResults);
+    }
+
+    const RegressionReport report = RegressionCompare::compare(baseline, candidate, regressionThresholds);
+    RegressionCompare::printReport(report);
+    const std::filesystem::path reportPath = std::filesystem::path(testOutputFilePath).parent_path() / "regression.csv";
+    RegressionCompare::writeReport(report, reportPath.string());
+
+    regressionCompared = true;
+    regressionPassed = report.passed();
+    regressionFailures = report.failureCount();
+}
+
+WaterTestConfig VulkanBase::currentSettingsConfig(const std::string &name) const
+{
+    WaterTestConfig config;
+    config.name = name;
+    config.sceneSubmission = gpuDrivenScene ? SceneSubmission::GPU : SceneSubmission::CPU;
+    config.occlusionCulling = gpuOcclusionCulling;
+    config.renderingMode = static_cast<RenderingMode>(renderSettings.renderingMode);
+    config.halfResGodRays = halfResGodRays;
+    config.specializedShaders = specializedWaterShaders;
+    config.shadowQuality = static_cast<ShadowTier>(shadowQuality);
+    config.shadowRoundRobin = shadowRoundRobin;
+    config.pointLightCount = scatteredLightCount;
+    config.clusteredLighting = clusteredLighting;
+    config.reflections = getReflectionTier();
+    config.depthPrePass = depthPrePass;
+    config.froxelVolumetrics = froxelVolumetrics;
+    config.asyncEnabled = asyncComputeEnabled;
+    config.tilingEnabled = tiledEffects;
+    config.variableRateShading = variableRateShading;
+    config.alternateFrameDevices = deviceGroup && deviceGroup->getAlternateFrames();
+    config.framesInFlight = framesInFlight;
+    config.msaaSamples = msaaSamples;
+    config.offscreenUpdateInterval = offscreenThrottle.getInterval();
+    config.cameraPathFile = recordedCameraPathFile;
+    return config;
+}
+
+// ============================================================================
+// FRAME CAPTURE / PASS REPLAY
+// ============================================================================
+
+void VulkanBase::captureFrame()
+{
+    FrameCapture capture;
+    capture.frame = simulationFrame;
+    capture.time = simulationTime;
+    capture.cameraPosition = camera.position;
+    capture.cameraYaw = camera.getYaw();
+    capture.cameraPitch = camera.getPitch();
+    capture.extent = swapChainManager->getSwapChainExtent();
+    capture.config = currentSettingsConfig("Capture_" + std::to_string(simulationFrame));
+    capture.config.cameraPathFile.clear(); // The captured pose replaces any path
+    capture.waterParams = frameWaterParams;
+    for (const RenderGraphPassTiming &timing : renderGraph->getPassTimings())
+    {
+        capture.passes.push_back({timing.name, timing.culled, timing.barriers, timing.gpuMs});
+    }
+
+    std::filesystem::create_directories("captures");
+    const std::string path = "captures/frame_" + std::to_string(simulationFrame) + ".json";
+    if (capture.save(path))
+    {
+        std::cout << "[VulkanBase] Captured frame " << simulationFrame << " to " << path << "\n";
+        lastFrameCapture = std::move(capture);
+        lastFrameCapturePath = path;
+    }
+}
+
+void VulkanBase::runShaderBench()
+{
+    if (stereoRendering)
+    {
+        throw std::runtime_error("the shader bench draws one view: run it without --stereo!");
+    }
+    const ShaderBench::PushConstants &push = headlessOptions.shaderBenchPush;
+    renderSettings.renderingMode = static_cast<int>(push.renderingMode);
+    ShaderBench bench(device, physicalDevice, descriptorSetLayout, waterDescriptorSetLayout);
+
+    std::vector<ShaderBench::Result> results;
+    for (ShaderBench::Shader shader : headlessOptions.shaderBench)
+    {
+        // The surface seen from above; the underwater effects from below, looking up towards the sun
+        const CameraPose pose = shader == ShaderBench::Shader::Water ? CameraPose{glm::vec3(0.0f, 12.0f, 55.0f), -90.0f, -20.0f}
+                                                                     : CameraPose{glm::vec3(0.0f, -12.0f, 55.0f), -90.0f, 25.0f};
+        simulation->setCameraPath([pose](uint64_t)
+                                  { return pose; });
+        shaderBenchFramesLeft = kShaderBenchWarmupFrames;
+        mainLoop(); // Ends idle
+
+        // The last frame's sets and offsets: its uniforms and water parameters stay in place while idle
+        const uint32_t lastFrame = static_cast<uint32_t>((currentFrame + framesInFlight - 1) % framesInFlight);
+        auto bindSets = [this](VkCommandBuffer cmd, VkPipelineLayout layout)
+        {
+            const std::array<VkDescriptorSet, 2> sets = {descriptorSets[0], waterDescriptorSet};
+            const std::array<uint32_t, 4> setOffsets = withWaterParamsOffset(mainView.uniformOffsets);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, static_cast<uint32_t>(sets.size()), sets.data(),
+                                    static_cast<uint32_t>(setOffsets.size()), setOffsets.data());
+        };
+        auto drawGrid = [this, lastFrame](VkCommandBuffer cmd)
+        { waterMesh->draw(cmd, lastFrame); };
+
+        for (const ShaderBench::Result &result : bench.run(shader, headlessOptions.shaderBenchSizes, headlessOptions.shaderBenchRepeat,
+                                                          headlessOptions.shaderBenchSamples, push, bindSets, drawGrid))
+        {
+            std::cout << "[ShaderBench] " << ShaderBench::shaderName(result.shader) << " " << result.extent.width << "x"
+                      << result.extent.height << ": " << result.nsPerPixel << " ns/pixel (median " << result.medianMs << " ms for "
+                      << result.repeat << " draws, min " << result.minMs << " ms)\n";
+            results.push_back(result);
+        }
+    }
+    simulation->setCameraPath({});
+
+    std::filesystem::path outputPath(headlessOptions.outputPath);
+    if (outputPath.has_parent_path())
+    {
+        std::filesystem::create_directories(outputPath.parent_path());
+    }
+    if (!ShaderBench::writeCsv(results, headlessOptions.outputPath))
+    {
+        throw std::runtime_error("failed to write shader bench results!");
+    }
+}
+
+void VulkanBase::startPassReplay(FrameCapture capture, std::vector<std::string> passes, uint32_t repeat, uint32_t frames)
+{
+    if (isTestModeActive || passReplay || passes.empty())
+        return;
+
+    const VkExtent2D extent = swapChainManager->getSwapChainExtent();
+    if (extent.width != capture.extent.width || extent.height != capture.extent.height)
+    {
+        std::cout << "[VulkanBase] Replaying a " << capture.extent.width << "x" << capture.extent.height << " capture at "
+                  << extent.width << "x" << extent.height << ": times will not match the capture's\n";
+    }
+
+    // The capture's settings, pose and time held for every frame; the replay clock's {t, t} stays at t
+    applyTestConfiguration(capture.config);
+    prebuildTestPipelines({capture.config});
+    const CameraPose pose{capture.cameraPosition, capture.cameraYaw, capture.cameraPitch};
+    simulation->setCameraPath([pose](uint64_t)
+                              { return pose; });
+    simulation->restartClock({capture.time, capture.time});
+
+    passReplay = std::make_unique<PassReplay>(std::move(capture), std::move(passes), repeat, frames);
+    renderGraph->setReplay(passReplay->getPasses(), passReplay->getRepeat());
+    lastReplayResults.clear();
+
+    std::cout << "[VulkanBase] Replaying " << passReplay->getPasses().size() << " passes x" << passReplay->getRepeat()
+              << " for " << frames << " frames\n";
+}
+
+void VulkanBase::endPassReplay()
+{
+    if (!passReplay)
+        return;
+
+    lastReplayResults = passReplay->getResults();
+    std::filesystem::path outputPath(replayOutputPath);
+    if (outputPath.has_parent_path())
+    {
+        std::filesystem::create_directories(outputPath.parent_path());
+    }
+    passReplay->writeCsv(replayOutputPath);
+
+    std::cout << "[VulkanBase] Pass replay complete (" << replayOutputPath << "):\n";
+    for (const PassReplay::PassResult &result : lastReplayResults)
+    {
+        std::cout << "  " << result.name << ": median " << result.medianMs << " ms, min " << result.minMs << " ms, 99th "
+                  << result.p99Ms << " ms over " << result.samples << " repeats (captured " << result.capturedMs << " ms)\n";
+    }
+
+    renderGraph->setReplay({}, 0);
+    simulation->setCameraPath({}); // The camera stays at the captured pose
+    passReplay.reset();
+}
+
+// ============================================================================
+// TILED CAPTURE
+// ============================================================================
+
+void VulkanBase::startTiledCapture(const TiledCaptureSettings &settings, const CameraPose &pose, double time)
+{
+    if (isTestModeActive || passReplay || tiledCapture)
+        return;
+    if (stereoRendering)
+    {
+        std::cout << "[VulkanBase] Tiled capture is not available in stereo\n";
+        return;
+    }
+
+    const VkExtent2D tileExtent = getViewExtent();
+    std::unique_ptr<TiledCapture> capture = std::make_unique<TiledCapture>(settings, tileExtent);
+    if (capture->failed())
+    {
+        std::cout << "[VulkanBase] Tiled capture failed: " << capture->getError() << "\n";
+        return;
+    }
+    tiledCapture = std::move(capture);
+
+    // Held for every tile; the clock's {t, t} stays at t
+    simulation->setCameraPath([pose](uint64_t)
+                              { return pose; });
+    simulation->restartClock({time, time});
+
+    tiledCaptureRestore.occlusionCulling = gpuOcclusionCulling;
+    tiledCaptureRestore.temporalEffects = temporalUnderwaterEffects;
+    tiledCaptureRestore.variableRateShading = variableRateShading;
+    tiledCaptureRestore.dynamicResolution = dynamicResolution.isEnabled();
+    applyCaptureLimits();
+    // Every texture at full resolution in every tile
+    textureStreamer->finishAll();
+
+    if (settings.onImage)
+        return; // A reference, one of many
+    std::cout << "[VulkanBase] Tiled capture of " << settings.size.width << "x" << settings.size.height << " in "
+              << tiledCapture->getTileCount() << " tiles of " << tileExtent.width << "x" << tileExtent.height << ", "
+              << settings.samples << " samples each, to " << settings.path << "\n";
+}
+
+std::string VulkanBase::autoTuneDeviceKey() const
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkExtent2D extent = getViewExtent();
+    std::ostringstream key;
+    key << properties.deviceName << " [" << std::hex << properties.vendorID << ":" << properties.deviceID << "] driver 0x"
+        << properties.driverVersion << std::dec << " " << extent.width << "x" << extent.height;
+    return key.str();
+}
+
+void VulkanBase::startAutoTune(double budgetMs)
+{
+    if (stereoRendering)
+    {
+        std::cout << "[VulkanBase] Auto-tuning is not available in stereo\n";
+        return;
+    }
+    autoTuner = std::make_unique<AutoTuner>(budgetMs);
+
+    // Every trial renders the same frame: the camera where it is, the clock stopped
+    const CameraPose pose{camera.position, camera.getYaw(), camera.getPitch()};
+    simulation->setCameraPath([pose](uint64_t)
+                              { return pose; });
+    simulation->restartClock({simulationTime, simulationTime});
+
+    autoTuneRestore.gpuImageCompare = gpuImageCompare;
+    autoTuneRestore.referenceMode = imageCompare->getReferenceMode();
+    gpuImageCompare = true;
+    imageCompare->setReferenceMode(GpuImageCompare::Reference::Captured);
+    std::cout << "[VulkanBase] Auto-tuning OPT for " << budgetMs << " ms of GPU time\n";
+}
+
+void VulkanBase::updateAutoTune()
+{
+    if (autoTuner->takeLevelsChanged())
+    {
+        applyAutoTuneLevels(autoTuner->getLevels());
+    }
+    if (autoTuner->takeReferenceRequest())
+    {
+        imageCompare->captureReference();
+    }
+    if (autoTuner->isDone())
+    {
+        endAutoTune();
+    }
+}
+
+void VulkanBase::endAutoTune()
+{
+    const AutoTuner::Preset &result = autoTuner->getResult();
+    if (autoTuner->isFailed())
+    {
+        std::cout << "[VulkanBase] Auto-tune failed: no GPU frame times to measure, nothing cached\n";
+    }
+    else
+    {
+        std::cout << "[VulkanBase] Auto-tune " << (result.metBudget ? "met" : "missed") << " " << result.budgetMs << " ms after "
+                  << autoTuner->getTrialCount() << " trials: " << result.gpuMs << " ms GPU, SSIM " << result.ssim << ", "
+                  << AutoTuner::describe(result.levels) << "\n";
+        autoTunePreset = result;
+        AutoTuner::savePreset(autoTuneCachePath, autoTuneDeviceKey(), result);
+    }
+
+    gpuImageCompare = autoTuneRestore.gpuImageCompare;
+    imageCompare->setReferenceMode(autoTuneRestore.referenceMode);
+    simulation->setCameraPath({}); // The camera stays where the search held it
+    autoTuner.reset();
+}
+
+void VulkanBase::applyAutoTuneLevels(const AutoTuner::Levels &levels)
+{
+    renderSettings.renderingMode = static_cast<int>(RenderingMode::OPT);
+    const std::vector<AutoTuner::Knob> &knobs = AutoTuner::knobs();
+    for (size_t k = 0; k < knobs.size(); k++)
+    {
+        const std::string name = knobs[k].name;
+        const double value = AutoTuner::value(levels, k);
+        if (name == "msaaSamples")
+            requestedMsaaSamples = getUsableSampleCount(static_cast<uint32_t>(value)); // Applied before the next frame
+        else if (name == "resolutionScale")
+            dynamicResolution.setFixedScale(static_cast<float>(value));
+        else if (name == "offscreenUpdateInterval")
+            offscreenThrottle.setInterval(static_cast<uint32_t>(value));
+        else if (name == "halfResGodRays")
+            halfResGodRays = value != 0.0;
+        else if (name == "godSampleScale")
+            renderSettings.godSampleScale = static_cast<float>(value);
+        else if (name == "causticRayCount")
+            oceanCaustics->setRayCount(static_cast<uint32_t>(value));
+    }
+}
+
+void VulkanBase::endTiledCapture()
+{
+    if (!tiledCapture)
+        return;
+
+    // The readbacks still in flight call into the capture
+    vkDeviceWaitIdle(device);
+    frameReadback->collectAll();
+    tiledCaptureWritten = !tiledCapture->failed();
+    if (tiledCapture->failed())
+    {
+        std::cout << "[VulkanBase] Tiled capture failed: " << tiledCapture->getError() << "\n";
+    }
+
+    gpuOcclusionCulling = tiledCaptureRestore.occlusionCulling;
+    temporalUnderwaterEffects = tiledCaptureRestore.temporalEffects;
+    variableRateShading = tiledCaptureRestore.variableRateShading;
+    dynamicResolution.setEnabled(tiledCaptureRestore.dynamicResolution);
+    simulation->setCameraPath({}); // The camera stays at the captured pose
+    tiledCapture.reset();
+}
+
+void VulkanBase::queueReferenceRenders(const std::vector<WaterTestConfig> &configs)
+{
+    const VkExtent2D extent = getViewExtent();
+    std::vector<WaterTestConfig> referenceConfigs;
+    for (const WaterTestConfig &config : configs)
+    {
+        const DeterministicCameraPath path = WaterTestingSystem::cameraPathFor(config);
+        const uint64_t scene = ReferenceImageCache::hashScene(config, path, extent, kFixedSimulationStep);
+        bool queued = false;
+        for (uint32_t frame : ReferenceImageCache::referenceFrames(config))
+        {
+            const ReferenceKey key = ReferenceImageCache::makeKey(scene, path, frame, config.totalFrames);
+            // Configs of one scene share their references: rendered once
+            const bool pending = std::any_of(pendingReferences.begin(), pendingReferences.end(), [&key](const ReferenceRender &render)
+                                             { return !(render.key < key) && !(key < render.key); });
+            if (pending || referenceCache->exists(key))
+                continue;
+            pendingReferences.push_back({ReferenceImageCache::referenceConfig(config), frame, key});
+            queued = true;
+        }
+        if (queued)
+            referenceConfigs.push_back(ReferenceImageCache::referenceConfig(config));
+    }
+    if (!referenceConfigs.empty())
+    {
+        prebuildTestPipelines(referenceConfigs);
+    }
+}
+
+void VulkanBase::startNextReferenceRender()
+{
+    while (!tiledCapture && !pendingReferences.empty())
+    {
+        const ReferenceRender render = pendingReferences.front();
+        pendingReferences.pop_front();
+
+        // The frame of a FixedStep run: its path's pose, frame / 60 seconds into the animation
+        applyTestConfiguration(render.config);
+        const CameraKeyframe keyframe = WaterTestingSystem::cameraPathFor(render.config).atFrame(render.frame, render.config.totalFrames);
+        TiledCaptureSettings settings;
+        settings.size = getViewExtent();
+        settings.samples = headless ? headlessOptions.referenceSamples : ReferenceImageCache::kDefaultSamples;
+        settings.onImage = [this, key = render.key](const FrameReadbackImage &image)
+        {
+            referenceCache->store(key, image);
+            renderedReferences++;
+        };
+        startTiledCapture(settings, {keyframe.position, keyframe.yaw, keyframe.pitch}, render.frame * kFixedSimulationStep);
+        if (tiledCapture)
+        {
+            std::cout << "[VulkanBase] Reference " << renderedReferences + 1 << ": frame " << render.frame << " of "
+                      << render.config.name << ", " << pendingReferences.size() << " to go\n";
+        }
     }
 }
 
+void VulkanBase::applyCaptureLimits()
+{
+    // Each of these carries the last frame into this one, which was another tile
+    gpuOcclusionCulling = false;       // Last frame's Hi-Z pyramid
+    temporalUnderwaterEffects = false; // Low-res effects history
+    variableRateShading = false;       // Rates from last frame's history
+    dynamicResolution.setEnabled(false); // Scales from last frame's GPU time; every tile at full resolution
+}
+
+float *VulkanBase::shaderTuningValue(const std::string &name)
+{
+    if (name == "godExposure")
+        return &renderSettings.godExposure;
+    if (name == "godDecay")
+        return &renderSettings.godDecay;
+    if (name == "godDensity")
+        return &renderSettings.godDensity;
+    if (name == "godSampleScale")
+        return &renderSettings.godSampleScale;
+    if (name == "fogDensity")
+        return &renderSettings.underwaterFogDensity;
+    if (name == "distortionStrength")
+        return &renderSettings.waterDistortionStrength;
+    if (name == "godRayIntensity")
+        return &renderSettings.underwaterGodRayIntensity;
+    if (name == "causticIntensity")
+        return &renderSettings.oceanBottomCausticIntensity;
+    if (name == "opacity")
+        return &renderSettings.underwaterOpacity;
+    return nullptr;
+}
+
 void VulkanBase::applyTestConfiguration(const WaterTestConfig &config)
 {
+    // A previous config's tuning overrides back to what they replaced
+    for (const auto &saved : shaderTuningDefaults)
+    {
+        *shaderTuningValue(saved.first) = saved.second;
+    }
+
     // Apply turbidity
     switch (config.turbidity)
     {
     case TurbidityLevel::Low:
-        underwaterFogDensity = 0.02f;
-        underwaterScatteringIntensity = 0.3f;
+        renderSettings.underwaterFogDensity = 0.02f;
+        renderSettings.underwaterScatteringIntensity = 0.3f;
         break;
     case TurbidityLevel::Medium:
-        underwaterFogDensity = 0.01f;
-        underwaterScatteringIntensity = 0.5f;
+        renderSettings.underwaterFogDensity = 0.01f;
+        renderSettings.underwaterScatteringIntensity = 0.5f;
         break;
     case TurbidityLevel::High:
-        underwaterFogDensity = 0.1f;
-        underwaterScatteringIntensity = 0.8f;
+        renderSettings.underwaterFogDensity = 0.1f;
+        renderSettings.underwaterScatteringIntensity = 0.8f;
         break;
     }
 
@@ -4997,10 +7721,10 @@ void VulkanBase::applyTestConfiguration(const WaterTestConfig &config)
     {
     case DepthLevel::Shallow:
         // Camera path will handle positioning
-        underwaterDeepColor = glm::vec3(0.0f, 0.2f, 0.4f);
+        renderSettings.underwaterDeepColor = glm::vec3(0.0f, 0.2f, 0.4f);
         break;
     case DepthLevel::Deep:
-        underwaterDeepColor = glm::vec3(0.0f, 0.05f, 0.15f);
+        renderSettings.underwaterDeepColor = glm::vec3(0.0f, 0.05f, 0.15f);
         break;
     }
 
@@ -5015,16 +7739,89 @@ void VulkanBase::applyTestConfiguration(const WaterTestConfig &config)
         break;
     }
 
-    // Set camera path based on config
-    switch (config.depth)
+    // Rendering mode, and the god-ray tier it gates (OPT only)
+    renderSettings.renderingMode = static_cast<int>(config.renderingMode);
+    halfResGodRays = config.halfResGodRays;
+    specializedWaterShaders = config.specializedShaders;
+    // Traced caustics at the config's ray count; 0 traces none, so the bottom gets no caustics at all
+    computedCaustics = true;
+    oceanCaustics->setRayCount(static_cast<uint32_t>(std::max(config.causticRayCount, 0)));
+    froxelVolumetrics = config.froxelVolumetrics;
+    // Ignored without a compute-only queue: the sweep then measures the same path twice
+    asyncComputeEnabled = config.asyncEnabled && asyncCompute;
+    tiledEffects = config.tilingEnabled;
+    // Ignored without the device's support, like the async queue
+    variableRateShading = config.variableRateShading && variableRateShadingSupported;
+    // Likewise without a device group: every frame on the one GPU
+    if (deviceGroup)
+    {
+        deviceGroup->setAlternateFrames(config.alternateFrameDevices);
+    }
+    requestedFramesInFlight = config.framesInFlight; // Applied before the next frame
+    requestedMsaaSamples = getUsableSampleCount(config.msaaSamples); // Likewise; rebuilds the main pass' pipelines
+    // Hardware counters from the next frame on; without device support the columns stay zero
+    gpuCounters->setEnabled(config.captureGpuCounters);
+    // Variants compiled now if this is the first config with the pre-pass
+    depthPrePass = config.depthPrePass;
+    updatePipelineIfNeeded();
+    // Sun shadow tier (applied before the next frame records)
+    shadowQuality = static_cast<ShadowQuality>(config.shadowQuality);
+    shadowRoundRobin = config.shadowRoundRobin;
+    // Point lights over the sea floor, and whether they are clustered
+    scatteredLightCount = std::min(config.pointLightCount, ClusteredLights::kMaxLights - 1);
+    clusteredLighting = config.clusteredLighting;
+    scatterPointLights();
+    // Water reflection/refraction passes, the reflection mode set for the config's rendering mode
+    waterOffscreenPasses = config.reflections != ReflectionTier::Off;
+    reflectionModes[renderSettings.renderingMode] = config.reflections == ReflectionTier::ScreenSpace ? ReflectionMode::ScreenSpace
+                                            : config.reflections == ReflectionTier::RayQuery  ? ReflectionMode::RayQuery
+                                                                                              : ReflectionMode::Planar;
+    if (config.reflections == ReflectionTier::ScreenSpace && !screenSpaceReflections->isAvailable())
     {
-    case DepthLevel::Shallow:
-        waterTestingSystem->setCameraPath(DeterministicCameraPath::createSurfacePath());
-        break;
-    case DepthLevel::Deep:
-        waterTestingSystem->setCameraPath(DeterministicCameraPath::createDepthTransitionPath());
-        break;
+        std::cout << "[VulkanBase] Screen-space reflections unsupported on this device, running planar reflections\n";
+    }
+    if (config.reflections == ReflectionTier::RayQuery && !rayQueryScene)
+    {
+        std::cout << "[VulkanBase] Ray queries unsupported on this device, running planar reflections\n";
+    }
+    offscreenThrottle.setInterval(config.offscreenUpdateInterval);
+    offscreenThrottle.invalidate();
+
+    // Scene submission path (falls back to CPU when the device lacks the GPU-driven features)
+    gpuDrivenScene = config.sceneSubmission == SceneSubmission::GPU && gpuCulling != nullptr;
+    gpuOcclusionCulling = gpuDrivenScene && config.occlusionCulling;
+    if (config.sceneSubmission == SceneSubmission::GPU && !gpuCulling)
+    {
+        std::cout << "[VulkanBase] GPU submission unsupported on this device, running on the CPU path\n";
+    }
+
+    // Swept tuning values over the defaults and the turbidity's fog; each remembers what it replaced once
+    for (const auto &param : config.shaderParams)
+    {
+        float *value = shaderTuningValue(param.first);
+        if (!value)
+        {
+            std::cout << "[VulkanBase] Unknown shader parameter " << param.first << ", ignored\n";
+            continue;
+        }
+        if (param.first != "fogDensity")
+        {
+            shaderTuningDefaults.emplace(param.first, *value);
+        }
+        *value = param.second;
+    }
+    // Reflection/refraction scale held for the config, or dynamic resolution left as the user set it
+    if (config.resolutionScale > 0.0f)
+    {
+        dynamicResolution.setFixedScale(config.resolutionScale);
     }
+    else if (!dynamicResolution.isEnabled())
+    {
+        dynamicResolution.setEnabled(false); // Drops a previous config's fixed scale
+    }
+
+    // Set camera path based on config
+    waterTestingSystem->setCameraPath(WaterTestingSystem::cameraPathFor(config));
 
     std::cout << "[VulkanBase] Applied test configuration: " << config.toString() << "\n";
 }
@@ -5040,17 +7837,66 @@ void VulkanBase::renderTestingUI()
     ImGui::Spacing();
 
     // Test type selection
-    const char *testTypes[] = {"Performance", "Image Quality", "Trade-Off Sweep", "Custom"};
+    const char *testTypes[] = {"Performance", "Image Quality", "Trade-Off Sweep", "Custom", "Submission"};
     ImGui::Combo("Test Type", &selectedTestType, testTypes, IM_ARRAYSIZE(testTypes));
 
     ImGui::Checkbox("Auto-Export to CSV", &autoExportResults);
     ImGui::Checkbox("Capture Screenshots", &captureTestScreenshots);
+    ImGui::Checkbox("Stream Frame Log", &streamFrameLog);
+    if (ImGui::IsItemHovered())
+    {
+        ImGui::SetTooltip("Appends every frame to a binary .xrfm log next to the output file\n"
+                          "instead of keeping it in memory (long soak runs).\n"
+                          "Medians and percentiles come from streaming sketches (~0.5%% error).\n"
+                          "Convert with: XeRenderBench --convert <log> [--out <csv|json>]");
+    }
+    ImGui::Checkbox("GPU Image Compare", &gpuImageCompare);
+    if (ImGui::IsItemHovered())
+    {
+        ImGui::SetTooltip("SSIM/PSNR/Delta E of every frame, computed on the GPU\n"
+                          "Recorded per run (measured frames) and exported as averages");
+    }
+    if (gpuImageCompare)
+    {
+        int referenceMode = imageCompare->getReferenceMode() == GpuImageCompare::Reference::Captured ? 1 : 0;
+        const char *referenceModes[] = {"Previous Frame", "Captured Frame"};
+        if (ImGui::Combo("Reference", &referenceMode, referenceModes, IM_ARRAYSIZE(referenceModes)))
+        {
+            imageCompare->setReferenceMode(referenceMode == 1 ? GpuImageCompare::Reference::Captured
+                                                              : GpuImageCompare::Reference::PreviousFrame);
+        }
+        if (referenceMode == 1)
+        {
+            if (ImGui::Button("Capture Reference"))
+            {
+                imageCompare->captureReference();
+            }
+            ImGui::SameLine();
+            ImGui::TextDisabled(imageCompare->hasReference() ? "(set)" : "(none)");
+        }
+        if (imageCompare->hasReference())
+        {
+            ImGui::Text("SSIM %.4f  PSNR %.2f dB  dE %.2f", lastImageCompare.ssim, lastImageCompare.psnr, lastImageCompare.deltaE);
+        }
+    }
 
     // Output file path
     static char outputPath[256] = "test_results/water_test_results.csv";
     ImGui::InputText("Output File", outputPath, sizeof(outputPath));
     testOutputFilePath = outputPath;
 
+    // Frame log (.xrfm) or its CSV conversion from an earlier suite
+    static char baselinePath[256] = "";
+    ImGui::InputText("Baseline", baselinePath, sizeof(baselinePath));
+    regressionBaselinePath = baselinePath;
+    if (regressionCompared)
+    {
+        if (regressionPassed)
+            ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Regression check: PASS");
+        else
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Regression check: FAIL (%d configs)", regressionFailures);
+    }
+
     ImGui::Spacing();
 
     // Test status
@@ -5064,8 +7910,24 @@ void VulkanBase::renderTestingUI()
 
         ImGui::Text("Config: %d/%d", currentTestConfigIndex + 1, (int)pendingTestConfigs.size());
         ImGui::Text("Run: %d/%d", currentTestRunIndex + 1, waterTestingSystem->getCurrentConfig().repeatCount);
-        ImGui::Text("Frame: %u/%u", waterTestingSystem->getCurrentFrameIndex(),
-                    waterTestingSystem->getTotalFrames());
+        if (waterTestingSystem->isWarmingUp())
+        {
+            const WarmupDetector &warmup = waterTestingSystem->getWarmup();
+            ImGui::Text("Warming up: %u frames, variation %.1f%%", warmup.getFrameCount(), warmup.getVariation() * 100.0);
+        }
+        else
+        {
+            ImGui::Text("Frame: %u/%u", waterTestingSystem->getCurrentFrameIndex(),
+                        waterTestingSystem->getTotalFrames());
+        }
+
+        const LiveRunStatistics live = waterTestingSystem->getLiveStatistics();
+        if (live.validFrameCount > 0)
+        {
+            ImGui::Text("Median %.2f ms  p99 %.2f ms", live.medianFrameTime, live.percentile99);
+            ImGui::Text("FPS median %.1f  1%% low %.1f", live.medianFPS, live.fps1Low);
+            ImGui::TextDisabled("GPU median %.2f ms  outliers %d", live.medianGpuTime, live.outlierCount);
+        }
 
         if (ImGui::Button("Stop Test"))
         {
@@ -5074,6 +7936,66 @@ void VulkanBase::renderTestingUI()
     }
     else
     {
+        ImGui::Checkbox("Pipelined timing", &pipelinedTiming);
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::SetTooltip("On: frames stay in flight, frame time = interval between completions\n"
+                              "Off: vkQueueWaitIdle after every frame (image-quality runs are always synced)");
+        }
+        ImGui::Checkbox("Capture GPU counters", &captureGpuCounters);
+        if (ImGui::IsItemHovered())
+        {
+            if (!gpuCounters->isSupported())
+            {
+                ImGui::SetTooltip("Pipeline statistics queries are not supported on this device");
+            }
+            else
+            {
+                ImGui::SetTooltip("Vertex/fragment/compute invocations and clipped primitives per frame in the CSVs\n"
+                                  "%zu vendor counters (VK_KHR_performance_query). Adds a little GPU overhead",
+                                  gpuCounters->getCounterNames().size());
+            }
+        }
+        ImGui::Checkbox("Reorder configs", &reorderTestConfigs);
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::SetTooltip("Runs the suite in the order that switches the fewest pipelines and queue setups");
+        }
+
+        // A flythrough recorded from this session, for the custom and quick runs
+        if (!cameraPathRecorder.isRecording())
+        {
+            if (ImGui::Button("Record Camera Path"))
+            {
+                cameraPathRecorder.start();
+            }
+        }
+        else
+        {
+            if (ImGui::Button("Stop Recording"))
+            {
+                const std::string name = "Recorded_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count() % 100000);
+                const DeterministicCameraPath path = cameraPathRecorder.stop(name);
+                std::filesystem::create_directories("CameraPaths");
+                const std::string file = "CameraPaths/" + name + ".json";
+                if (path.getKeyframes().size() >= 2 && path.saveToJson(file))
+                {
+                    recordedCameraPathFile = file;
+                }
+            }
+            ImGui::SameLine();
+            ImGui::Text("%zu keys", cameraPathRecorder.getKeyCount());
+        }
+        if (!recordedCameraPathFile.empty())
+        {
+            ImGui::TextDisabled("Custom/quick path: %s", recordedCameraPathFile.c_str());
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Use Preset"))
+            {
+                recordedCameraPathFile.clear();
+            }
+        }
+
         // Generate and run test configurations
         if (ImGui::Button("Run Selected Test Suite"))
         {
@@ -5093,20 +8015,25 @@ void VulkanBase::renderTestingUI()
                 break;
             case 3: // Custom - single config with current settings
             {
-                WaterTestConfig custom;
-                custom.name = "Custom_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+                WaterTestConfig custom = currentSettingsConfig("Custom_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()));
                 custom.totalFrames = 300;
                 custom.warmupFrames = 10;
                 custom.repeatCount = 1;
                 pendingTestConfigs = {custom};
             }
             break;
+            case 4: // CPU vs GPU-driven scene submission
+                pendingTestConfigs = WaterTestingSystem::generateSubmissionTestConfigs();
+                break;
             }
 
-            if (!pendingTestConfigs.empty())
+            for (WaterTestConfig &config : pendingTestConfigs)
             {
-                startWaterTest(pendingTestConfigs[0]);
+                config.pipelinedTiming = config.pipelinedTiming && pipelinedTiming;
+                config.captureGpuCounters = captureGpuCounters;
             }
+
+            startTestSuite(pendingTestConfigs);
         }
 
         ImGui::SameLine();
@@ -5116,18 +8043,17 @@ void VulkanBase::renderTestingUI()
         {
             completedTestResults.clear();
 
-            WaterTestConfig quickConfig;
-            quickConfig.name = "QuickTest_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count() % 10000);
+            WaterTestConfig quickConfig = currentSettingsConfig("QuickTest_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count() % 10000));
             quickConfig.totalFrames = 300;
             quickConfig.warmupFrames = 10;
             quickConfig.repeatCount = 1;
             quickConfig.turbidity = TurbidityLevel::Medium;
             quickConfig.depth = DepthLevel::Shallow;
             quickConfig.lightMotion = LightMotion::Static;
+            quickConfig.pipelinedTiming = pipelinedTiming;
+            quickConfig.captureGpuCounters = captureGpuCounters;
 
-            pendingTestConfigs = {quickConfig};
-            currentTestConfigIndex = 0;
-            startWaterTest(quickConfig);
+            startTestSuite({quickConfig});
         }
     }
 
@@ -5144,6 +8070,9 @@ void VulkanBase::renderTestingUI()
         ImGui::Text("  1%% Low FPS: %.2f", last.fps1Low);
         ImGui::Text("  Mean Frame Time: %.3f ms", last.meanFrameTime);
         ImGui::Text("  Std Dev: %.3f ms", last.stddevFrameTime);
+        ImGui::Text("  Latency: %.3f ms mean, %.3f ms 99th (%s)", last.meanLatency, last.latency99,
+                    last.pipelinedTiming ? "pipelined" : "synced");
+        ImGui::Text("  Mean CPU Time: %.3f ms", last.meanCpuTime);
         ImGui::Text("  Valid Frames: %d", last.validFrameCount);
         ImGui::Text("  Outliers: %d", last.outlierCount);
 
@@ -0,0 +1,45 @@
+#include "WarmupDetector.h"
+#include <cmath>
+
+void WarmupDetector::reset(uint32_t maxFrames)
+{
+    m_maxFrames = maxFrames;
+    m_frameCount = 0;
+    m_window.clear();
+    m_window.reserve(kWindow);
+    m_previousMean = 0.0;
+    m_variation = 0.0;
+    m_done = false;
+    m_converged = false;
+}
+
+bool WarmupDetector::addFrame(double frameTimeMs)
+{
+    if (m_done)
+        return true;
+
+    m_frameCount++;
+    m_window.push_back(frameTimeMs);
+    if (m_window.size() == kWindow)
+    {
+        double mean = 0.0;
+        for (double value : m_window)
+            mean += value;
+        mean /= kWindow;
+
+        double variance = 0.0;
+        for (double value : m_window)
+            variance += (value - mean) * (value - mean);
+        variance /= kWindow - 1;
+
+        m_variation = mean > 0.0 ? std::sqrt(variance) / mean : 0.0;
+        const bool steady = m_variation < kMaxVariation;
+        const bool settled = m_previousMean > 0.0 && std::abs(mean - m_previousMean) / m_previousMean < kMaxDrift;
+        m_converged = steady && settled;
+        m_previousMean = mean;
+        m_window.clear();
+    }
+
+    m_done = m_converged || m_frameCount >= m_maxFrames;
+    return m_done;
+}
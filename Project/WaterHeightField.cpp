@@ -0,0 +1,236 @@
+#include "WaterHeightField.h"
+#include "OceanFFT.h"
+#include "CpuProfiler.h"
+#include "VulkanUtil.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WATER_HEIGHT_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) // vcvtmq (round down) is AArch64 only
+#define WATER_HEIGHT_NEON 1
+#include <arm_neon.h>
+#endif
+
+WaterHeightField::WaterHeightField(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount)
+    : m_frames(frameCount),
+      m_size(std::max(OceanFFT::kSize >> kLevel, 1u)),
+      m_texelsPerUnit(m_size / OceanFFT::kPatchSize)
+{
+    const VkDeviceSize bufferSize = VkDeviceSize(m_size) * m_size * 4 * sizeof(uint16_t);
+    for (Frame &frame : m_frames)
+    {
+        frame.buffer = std::get<0>(VkUtils::CreateBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+        frame.mapped = static_cast<const uint16_t *>(VkUtils::MapBuffer(frame.buffer));
+    }
+    m_dx.assign(size_t(m_size) * m_size, 0.0f);
+    m_dy.assign(size_t(m_size) * m_size, 0.0f);
+    m_dz.assign(size_t(m_size) * m_size, 0.0f);
+}
+
+WaterHeightField::~WaterHeightField()
+{
+    for (Frame &frame : m_frames)
+    {
+        VkUtils::DestroyBuffer(frame.buffer);
+    }
+}
+
+// ============================================================================
+// READBACK
+// ============================================================================
+
+void WaterHeightField::recordReadback(VkCommandBuffer cmd, uint32_t frameIndex, const OceanFFT &ocean)
+{
+    if (ocean.getMipLevels() <= kLevel)
+        return;
+    Frame &frame = m_frames[frameIndex];
+
+    // The level was written by the mip chain's blits; the map stays in GENERAL
+    VkMemoryBarrier toCopy{};
+    toCopy.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toCopy.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    toCopy.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &toCopy, 0, nullptr, 0, nullptr);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, kLevel, 0, 1};
+    region.imageExtent = {m_size, m_size, 1};
+    vkCmdCopyImageToBuffer(cmd, ocean.getDisplacementImage(), VK_IMAGE_LAYOUT_GENERAL, frame.buffer, 1, &region);
+
+    VkMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, nullptr, 0, nullptr);
+    frame.pending = true;
+}
+
+void WaterHeightField::collect(uint32_t frameIndex)
+{
+    Frame &frame = m_frames[frameIndex];
+    if (!frame.pending)
+        return;
+    frame.pending = false;
+
+    CPU_ZONE("WaterHeightField::collect");
+    const size_t texelCount = size_t(m_size) * m_size;
+    glm::vec2 maxDisplacement(0.0f);
+    for (size_t i = 0; i < texelCount; i++)
+    {
+        const uint16_t *texel = frame.mapped + i * 4;
+        m_dx[i] = glm::unpackHalf1x16(texel[0]);
+        m_dy[i] = glm::unpackHalf1x16(texel[1]);
+        m_dz[i] = glm::unpackHalf1x16(texel[2]);
+        maxDisplacement.x = std::max(maxDisplacement.x, std::max(std::abs(m_dx[i]), std::abs(m_dz[i])));
+        maxDisplacement.y = std::max(maxDisplacement.y, std::abs(m_dy[i]));
+    }
+    m_maxDisplacement = maxDisplacement;
+    m_valid = true;
+}
+
+// ============================================================================
+// QUERIES
+// ============================================================================
+
+float WaterHeightField::sampleHeight(const glm::vec2 &position) const
+{
+    float height = 0.0f;
+    sampleHeights(&position.x, &position.y, &height, 1);
+    return height;
+}
+
+void WaterHeightField::sampleHeights(const float *x, const float *z, float *outHeights, size_t count) const
+{
+    if (!m_valid)
+    {
+        std::fill(outHeights, outHeights + count, 0.0f);
+        return;
+    }
+
+    for (size_t first = 0; first < count; first += 4)
+    {
+        // A partial last group repeats its last point
+        const size_t lanes = std::min<size_t>(4, count - first);
+        alignas(16) float targetX[4], targetZ[4];
+        for (size_t lane = 0; lane < 4; lane++)
+        {
+            const size_t point = first + std::min(lane, lanes - 1);
+            targetX[lane] = x[point];
+            targetZ[lane] = z[point];
+        }
+
+        // The undisplaced point p with p + D(p) = target: start at the target, then p = target - D(p)
+        alignas(16) float sourceX[4], sourceZ[4], dx[4], dy[4], dz[4];
+        std::copy(targetX, targetX + 4, sourceX);
+        std::copy(targetZ, targetZ + 4, sourceZ);
+        for (uint32_t step = 0; step < kInversionSteps; step++)
+        {
+            sampleDisplacement4(sourceX, sourceZ, dx, dy, dz);
+            for (size_t lane = 0; lane < 4; lane++)
+            {
+                sourceX[lane] = targetX[lane] - dx[lane];
+                sourceZ[lane] = targetZ[lane] - dz[lane];
+            }
+        }
+        sampleDisplacement4(sourceX, sourceZ, dx, dy, dz);
+        std::copy(dy, dy + lanes, outHeights + first);
+    }
+}
+
+void WaterHeightField::sampleDisplacement4(const float *x, const float *z, float *outX, float *outY, float *outZ) const
+{
+    // Texel centres sit at half-texel offsets, as the GPU's bilinear filter sees them
+    alignas(16) int32_t column[4], row[4];
+    alignas(16) float fractionX[4], fractionZ[4];
+    const int32_t mask = static_cast<int32_t>(m_size - 1); // kSize is a power of two
+#if WATER_HEIGHT_SSE2
+    const __m128 scale = _mm_set1_ps(m_texelsPerUnit);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    auto floorOf = [one](__m128 value)
+    {
+        const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(value));
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, value), one));
+    };
+    const __m128 u = _mm_sub_ps(_mm_mul_ps(_mm_load_ps(x), scale), half);
+    const __m128 v = _mm_sub_ps(_mm_mul_ps(_mm_load_ps(z), scale), half);
+    const __m128 floorU = floorOf(u);
+    const __m128 floorV = floorOf(v);
+    _mm_store_ps(fractionX, _mm_sub_ps(u, floorU));
+    _mm_store_ps(fractionZ, _mm_sub_ps(v, floorV));
+    const __m128i wrap = _mm_set1_epi32(mask);
+    _mm_store_si128(reinterpret_cast<__m128i *>(column), _mm_and_si128(_mm_cvttps_epi32(floorU), wrap));
+    _mm_store_si128(reinterpret_cast<__m128i *>(row), _mm_and_si128(_mm_cvttps_epi32(floorV), wrap));
+#elif WATER_HEIGHT_NEON
+    const float32x4_t u = vsubq_f32(vmulq_n_f32(vld1q_f32(x), m_texelsPerUnit), vdupq_n_f32(0.5f));
+    const float32x4_t v = vsubq_f32(vmulq_n_f32(vld1q_f32(z), m_texelsPerUnit), vdupq_n_f32(0.5f));
+    const int32x4_t floorU = vcvtmq_s32_f32(u);
+    const int32x4_t floorV = vcvtmq_s32_f32(v);
+    vst1q_f32(fractionX, vsubq_f32(u, vcvtq_f32_s32(floorU)));
+    vst1q_f32(fractionZ, vsubq_f32(v, vcvtq_f32_s32(floorV)));
+    vst1q_s32(column, vandq_s32(floorU, vdupq_n_s32(mask)));
+    vst1q_s32(row, vandq_s32(floorV, vdupq_n_s32(mask)));
+#else
+    for (int lane = 0; lane < 4; lane++)
+    {
+        const float u = x[lane] * m_texelsPerUnit - 0.5f;
+        const float v = z[lane] * m_texelsPerUnit - 0.5f;
+        const float floorU = std::floor(u);
+        const float floorV = std::floor(v);
+        fractionX[lane] = u - floorU;
+        fractionZ[lane] = v - floorV;
+        column[lane] = static_cast<int32_t>(floorU) & mask;
+        row[lane] = static_cast<int32_t>(floorV) & mask;
+    }
+#endif
+
+    // The four corners of every lane, per component: [corner][lane]
+    const std::vector<float> *planes[3] = {&m_dx, &m_dy, &m_dz};
+    float *outputs[3] = {outX, outY, outZ};
+    for (int component = 0; component < 3; component++)
+    {
+        const float *plane = planes[component]->data();
+        alignas(16) float corners[4][4];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            const size_t row0 = size_t(row[lane]) * m_size;
+            const size_t row1 = size_t((row[lane] + 1) & mask) * m_size;
+            const int32_t column1 = (column[lane] + 1) & mask;
+            corners[0][lane] = plane[row0 + column[lane]];
+            corners[1][lane] = plane[row0 + column1];
+            corners[2][lane] = plane[row1 + column[lane]];
+            corners[3][lane] = plane[row1 + column1];
+        }
+#if WATER_HEIGHT_SSE2
+        const __m128 fx = _mm_load_ps(fractionX);
+        const __m128 fz = _mm_load_ps(fractionZ);
+        const __m128 c00 = _mm_load_ps(corners[0]);
+        const __m128 c10 = _mm_load_ps(corners[1]);
+        const __m128 c01 = _mm_load_ps(corners[2]);
+        const __m128 c11 = _mm_load_ps(corners[3]);
+        const __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), fx));
+        const __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), fx));
+        _mm_store_ps(outputs[component], _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fz)));
+#elif WATER_HEIGHT_NEON
+        const float32x4_t fx = vld1q_f32(fractionX);
+        const float32x4_t fz = vld1q_f32(fractionZ);
+        const float32x4_t c00 = vld1q_f32(corners[0]);
+        const float32x4_t c01 = vld1q_f32(corners[2]);
+        const float32x4_t top = vmlaq_f32(c00, vsubq_f32(vld1q_f32(corners[1]), c00), fx);
+        const float32x4_t bottom = vmlaq_f32(c01, vsubq_f32(vld1q_f32(corners[3]), c01), fx);
+        vst1q_f32(outputs[component], vmlaq_f32(top, vsubq_f32(bottom, top), fz));
+#else
+        for (int lane = 0; lane < 4; lane++)
+        {
+            const float top = corners[0][lane] + (corners[1][lane] - corners[0][lane]) * fractionX[lane];
+            const float bottom = corners[2][lane] + (corners[3][lane] - corners[2][lane]) * fractionX[lane];
+            outputs[component][lane] = top + (bottom - top) * fractionZ[lane];
+        }
+#endif
+    }
+}
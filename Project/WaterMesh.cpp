@@ -1,128 +1,13 @@
 ﻿#include "WaterMesh.h"
-#include <stdexcept>
 
 void WaterMesh::create(VkDevice device,
                        VkPhysicalDevice gpu,
-                       VkCommandPool commandPool,
-                       VkQueue graphicsQueue,
-                       int resolution,
-                       float worldSize)
+                       uint32_t frameCount,
+                       float worldSize,
+                       uint32_t lodLevels)
 {
-    const int N = resolution;
-    const float half = worldSize * 0.5f;
-
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-
-    vertices.reserve((N + 1) * (N + 1));
-
-    // -------------------------
-    // Generate vertices
-    // -------------------------
-    for (int y = 0; y <= N; y++)
-    {
-        for (int x = 0; x <= N; x++)
-        {
-            float px = ((float)x / N) * worldSize - half;
-            float pz = ((float)y / N) * worldSize - half;
-
-            Vertex v{};
-            v.pos = {px, 0.0f, pz};
-            v.normal = {0.0f, 1.0f, 0.0f};
-            v.texCoord = {x / float(N), y / float(N)};
-            v.color = {1.0f, 1.0f, 1.0f};
-            v.tangent = {1.0f, 0.0f, 0.0f};
-            v.bitangent = {0.0f, 0.0f, 1.0f};
-
-            vertices.push_back(v);
-        }
-    }
-
-    // -------------------------
-    // Generate indices
-    // -------------------------
-    for (int y = 0; y < N; y++)
-    {
-        for (int x = 0; x < N; x++)
-        {
-            uint32_t i0 = y * (N + 1) + x;
-            uint32_t i1 = i0 + 1;
-            uint32_t i2 = i0 + (N + 1);
-            uint32_t i3 = i2 + 1;
-
-            indices.push_back(i0);
-            indices.push_back(i2);
-            indices.push_back(i1);
-
-            indices.push_back(i1);
-            indices.push_back(i2);
-            indices.push_back(i3);
-        }
-    }
-
-    indexCount = indices.size();
-
-    // =============================================================
-    // CREATE VERTEX BUFFER (WITH STAGING)
-    // =============================================================
-
-    VkDeviceSize vertexSize = vertices.size() * sizeof(Vertex);
-
-    // Create staging buffer
-    auto [stagingVB, stagingVBMem] = VkUtils::CreateBuffer(
-        device, gpu, vertexSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    // Upload data
-    void *data = nullptr;
-    vkMapMemory(device, stagingVBMem, 0, vertexSize, 0, &data);
-    memcpy(data, vertices.data(), vertexSize);
-    vkUnmapMemory(device, stagingVBMem);
-
-    // Create actual GPU buffer
-    auto [vb, vbMem] = VkUtils::CreateBuffer(
-        device, gpu, vertexSize,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    vertexBuffer = vb;
-    vertexMemory = vbMem;
-
-    // Copy Staging → GPU
-    VkUtils::CopyBuffer(stagingVB, vertexBuffer, vertexSize, device, commandPool, graphicsQueue);
-
-    // Clean up staging
-    vkDestroyBuffer(device, stagingVB, nullptr);
-    vkFreeMemory(device, stagingVBMem, nullptr);
-
-    // =============================================================
-    // CREATE INDEX BUFFER (WITH STAGING)
-    // =============================================================
-
-    VkDeviceSize indexSize = indices.size() * sizeof(uint32_t);
-
-    auto [stagingIB, stagingIBMem] = VkUtils::CreateBuffer(
-        device, gpu, indexSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    vkMapMemory(device, stagingIBMem, 0, indexSize, 0, &data);
-    memcpy(data, indices.data(), indexSize);
-    vkUnmapMemory(device, stagingIBMem);
-
-    auto [ib, ibMem] = VkUtils::CreateBuffer(
-        device, gpu, indexSize,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    indexBuffer = ib;
-    indexMemory = ibMem;
-
-    VkUtils::CopyBuffer(stagingIB, indexBuffer, indexSize, device, commandPool, graphicsQueue);
-
-    vkDestroyBuffer(device, stagingIB, nullptr);
-    vkFreeMemory(device, stagingIBMem, nullptr);
+    // Tile geometry goes out with the UploadContext batch
+    grid = std::make_unique<CdlodGrid>(device, gpu, frameCount, worldSize, 0.0f, lodLevels);
 
     isValid.store(true, std::memory_order_release);
 }
@@ -130,33 +15,20 @@ void WaterMesh::create(VkDevice device,
 void WaterMesh::destroy(VkDevice device)
 {
     isValid.store(false, std::memory_order_release);
+    grid.reset();
+}
 
-    if (vertexBuffer != VK_NULL_HANDLE)
-    {
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vertexBuffer = VK_NULL_HANDLE;
-    }
-    if (vertexMemory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(device, vertexMemory, nullptr);
-        vertexMemory = VK_NULL_HANDLE;
-    }
-
-    if (indexBuffer != VK_NULL_HANDLE)
-    {
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        indexBuffer = VK_NULL_HANDLE;
-    }
-    if (indexMemory != VK_NULL_HANDLE)
+void WaterMesh::update(uint32_t frameIndex, const glm::vec3 &cameraPos, float viewDistance, const Frustum *frustum,
+                       const glm::vec2 &waveMargin)
+{
+    if (grid)
     {
-        vkFreeMemory(device, indexMemory, nullptr);
-        indexMemory = VK_NULL_HANDLE;
+        // Blended over the scene: far tiles first
+        grid->select(frameIndex, cameraPos, viewDistance, DrawKey::Order::BackToFront, frustum, waveMargin);
     }
-
-    indexCount = 0;
 }
 
-void WaterMesh::draw(VkCommandBuffer cmd)
+void WaterMesh::draw(VkCommandBuffer cmd, uint32_t frameIndex)
 {
     // ABSOLUTE SAFETY: Do not draw anything if mesh is marked invalid
     // This completely prevents any Vulkan calls during resource recreation
@@ -167,13 +39,7 @@ void WaterMesh::draw(VkCommandBuffer cmd)
     }
 
     // ABSOLUTE SAFETY: Do not proceed with any invalid handles
-    if (cmd == VK_NULL_HANDLE ||
-        vertexBuffer == VK_NULL_HANDLE ||
-        indexBuffer == VK_NULL_HANDLE ||
-        vertexMemory == VK_NULL_HANDLE ||
-        indexMemory == VK_NULL_HANDLE ||
-        indexCount == 0 ||
-        indexCount > 10000000)
+    if (cmd == VK_NULL_HANDLE || !grid)
     {
         // Mark as invalid if any resources are bad to prevent future calls
         isValid.store(false, std::memory_order_release);
@@ -186,11 +52,5 @@ void WaterMesh::draw(VkCommandBuffer cmd)
         return;
     }
 
-    // Only execute if ALL validation passes - no try-catch needed
-    VkBuffer buffers[] = {vertexBuffer};
-    VkDeviceSize offsets[] = {0};
-
-    vkCmdBindVertexBuffers(cmd, 0, 1, buffers, offsets);
-    vkCmdBindIndexBuffer(cmd, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed(cmd, indexCount, 1, 0, 0, 0);
+    grid->draw(cmd, frameIndex);
 }
\ No newline at end of file
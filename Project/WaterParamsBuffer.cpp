@@ -0,0 +1,50 @@
+#include "WaterParamsBuffer.h"
+#include "VulkanUtil.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(sizeof(WaterParamBlock) == 96, "WaterParamBlock must match the std140 block in the water shaders");
+
+WaterParamsBuffer::WaterParamsBuffer(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount)
+    : m_written(frameCount), m_valid(frameCount, false)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(16, properties.limits.minUniformBufferOffsetAlignment);
+    m_stride = (sizeof(WaterParams) + alignment - 1) & ~(alignment - 1);
+
+    auto [buffer, memory] = VkUtils::CreateBuffer(
+        device, physicalDevice, m_stride * frameCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_buffer = buffer;
+    m_mapped = static_cast<uint8_t *>(VkUtils::MapBuffer(buffer));
+}
+
+WaterParamsBuffer::~WaterParamsBuffer()
+{
+    if (m_buffer != VK_NULL_HANDLE)
+    {
+        VkUtils::DestroyBuffer(m_buffer);
+    }
+}
+
+uint32_t WaterParamsBuffer::update(uint32_t frameIndex, const WaterParams &params)
+{
+    if (frameIndex >= m_written.size())
+    {
+        throw std::out_of_range("WaterParamsBuffer frame index out of range!");
+    }
+
+    const VkDeviceSize offset = static_cast<VkDeviceSize>(frameIndex) * m_stride;
+    // Only floats: no padding bytes for the comparison to trip over
+    if (!m_valid[frameIndex] || memcmp(&m_written[frameIndex], &params, sizeof(WaterParams)) != 0)
+    {
+        memcpy(m_mapped + offset, &params, sizeof(WaterParams));
+        m_written[frameIndex] = params;
+        m_valid[frameIndex] = true;
+        m_writeCount++;
+    }
+    return static_cast<uint32_t>(offset);
+}
@@ -1,17 +1,34 @@
 #include "WaterPipeline.h"
+#include "DynamicRendering.h"
+#include "VariableRateShading.h"
+#include "PipelineCache.h"
+#include "CdlodGrid.h"
+#include "ShaderRegistry.h"
 #include <stdexcept>
 #include <cstring>
 #include <algorithm>
+#include <cstddef>
 
-static VkVertexInputBindingDescription getBindingDescription()
+// Every module the surface and sun-ray variants specialize is in the build: a rename fails here, not at launch
+static_assert(!ShaderRegistry::kEmbedded ||
+                  (ShaderRegistry::contains("water.vert.spv") && ShaderRegistry::contains("water_tess.vert.spv") &&
+                   ShaderRegistry::contains("water.tesc.spv") && ShaderRegistry::contains("water.tese.spv") &&
+                   ShaderRegistry::contains("water.frag.spv") && ShaderRegistry::contains("water_rq.frag.spv") &&
+                   ShaderRegistry::contains("sunrays.vert.spv") && ShaderRegistry::contains("sunrays.frag.spv") &&
+                   ShaderRegistry::contains("sunrays_tile_vrs.vert.spv")),
+              "a water pipeline module is missing from shaders/");
+
+// The shared CDLOD tile's cell corners (binding 0) and the per-instance tile placement (binding 1)
+static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions()
 {
-    return Vertex::getBindingDescription();
+    return {CdlodGrid::getVertexBindingDescription(), CdlodGrid::getInstanceBindingDescription()};
 }
 
 static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions()
 {
-    auto arr = Vertex::getAttributeDescriptions();
-    std::vector<VkVertexInputAttributeDescription> vec(arr.begin(), arr.end());
+    auto tileArr = CdlodGrid::getInstanceAttributeDescriptions();
+    std::vector<VkVertexInputAttributeDescription> vec = {CdlodGrid::getVertexAttributeDescription()};
+    vec.insert(vec.end(), tileArr.begin(), tileArr.end());
     return vec;
 }
 
@@ -30,49 +47,144 @@ VkShaderModule WaterPipeline::createShaderModule(VkDevice device, const std::vec
     return shaderModule;
 }
 
+const std::array<VkSpecializationMapEntry, 2> &WaterVariant::mapEntries()
+{
+    static const std::array<VkSpecializationMapEntry, 2> entries = {{
+        {0, offsetof(WaterVariant, renderingMode), sizeof(uint32_t)},
+        {1, offsetof(WaterVariant, debugView), sizeof(uint32_t)},
+    }};
+    return entries;
+}
+
 void WaterPipeline::create(
     VkDevice device,
-    VkExtent2D extent,
     VkRenderPass renderPass,
     VkDescriptorSetLayout globalDescriptorSetLayout,
     VkDescriptorSetLayout waterDescriptorSetLayout,
     VkSampleCountFlagBits msaaSamples,
-    bool isSunraysPipeline)
+    bool isSunraysPipeline,
+    bool tessellated)
 {
-    // 1. Select correct shaders
+    m_device = device;
+    m_renderPass = renderPass;
+    m_samples = msaaSamples;
+    m_sunrays = isSunraysPipeline;
+    m_tessellated = tessellated;
+
+    // 1. Select correct shaders; every variant specializes the same modules
     std::vector<char> vertCode;
     std::vector<char> fragCode;
 
     if (isSunraysPipeline)
     {
-        vertCode = VkUtils::readFile("shaders/sunrays.vert.spv");
-        fragCode = VkUtils::readFile("shaders/sunrays.frag.spv");
+        vertCode = ShaderRegistry::load("shaders/sunrays.vert.spv");
+        fragCode = ShaderRegistry::load("shaders/sunrays.frag.spv");
+    }
+    else if (tessellated)
+    {
+        vertCode = ShaderRegistry::load("shaders/water_tess.vert.spv");
+        fragCode = ShaderRegistry::load("shaders/water.frag.spv");
     }
     else
     {
-        vertCode = VkUtils::readFile("shaders/water.vert.spv");
-        fragCode = VkUtils::readFile("shaders/water.frag.spv");
+        vertCode = ShaderRegistry::load("shaders/water.vert.spv");
+        fragCode = ShaderRegistry::load("shaders/water.frag.spv");
+    }
+
+    m_vertModule = createShaderModule(device, vertCode);
+    m_fragModule = createShaderModule(device, fragCode);
+    if (tessellated)
+    {
+        m_tescModule = createShaderModule(device, ShaderRegistry::load("shaders/water.tesc.spv"));
+        m_teseModule = createShaderModule(device, ShaderRegistry::load("shaders/water.tese.spv"));
+    }
+
+    // Pipeline layout
+    std::array<VkDescriptorSetLayout, 2> setLayouts = {globalDescriptorSetLayout, waterDescriptorSetLayout};
+
+    // Push constants: time, scale, debug flags and mode; the tuning is in WaterParams (set 1, binding 7)
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushRange.offset = 0;
+    pushRange.size = 16;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
+    {
+        destroy(device);
+        throw std::runtime_error("Failed to create water pipeline layout.");
+    }
+
+    // The mode switch is the common one; debug views are built when first shown
+    try
+    {
+        for (uint32_t mode = 0; mode < WaterVariant::kRenderingModeCount; mode++)
+        {
+            WaterVariant variant;
+            variant.renderingMode = mode;
+            const VariantKey key{variant, false, false};
+            m_variants[key] = buildVariant(key);
+        }
+    }
+    catch (...)
+    {
+        destroy(device);
+        throw;
     }
+    select(WaterVariant{});
+}
+
+VkPipeline WaterPipeline::buildVariant(const VariantKey &key) const
+{
+    const auto &[variant, shadingRate, rayQuery] = key;
+    const bool isSunraysPipeline = m_sunrays;
+    const bool tessellated = m_tessellated;
 
-    VkShaderModule vertModule = createShaderModule(device, vertCode);
-    VkShaderModule fragModule = createShaderModule(device, fragCode);
+    VkSpecializationInfo specialization{};
+    specialization.mapEntryCount = static_cast<uint32_t>(WaterVariant::mapEntries().size());
+    specialization.pMapEntries = WaterVariant::mapEntries().data();
+    specialization.dataSize = sizeof(WaterVariant);
+    specialization.pData = &variant;
 
     VkPipelineShaderStageCreateInfo vertStage{};
     vertStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertStage.module = vertModule;
+    vertStage.module = shadingRate ? m_rateTileVertModule : m_vertModule;
     vertStage.pName = "main";
 
     VkPipelineShaderStageCreateInfo fragStage{};
     fragStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragStage.module = fragModule;
+    fragStage.module = rayQuery ? m_rayQueryFragModule : m_fragModule;
     fragStage.pName = "main";
+    fragStage.pSpecializationInfo = &specialization;
+
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages = {vertStage, fragStage};
 
-    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {vertStage, fragStage};
+    // Tessellation: the CDLOD triangles become 3-point patches, displaced after subdivision
+    if (tessellated)
+    {
+        VkPipelineShaderStageCreateInfo tescStage{};
+        tescStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        tescStage.stage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        tescStage.module = m_tescModule;
+        tescStage.pName = "main";
+
+        VkPipelineShaderStageCreateInfo teseStage = tescStage;
+        teseStage.stage = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        teseStage.module = m_teseModule;
+
+        shaderStages.insert(shaderStages.begin() + 1, {tescStage, teseStage});
+    }
 
     // Vertex input
-    auto bindingDescription = getBindingDescription();
+    auto bindingDescriptions = getBindingDescriptions();
     auto attributeDescriptions = getAttributeDescriptions();
 
     VkPipelineVertexInputStateCreateInfo vertexInput{};
@@ -87,36 +199,32 @@ void WaterPipeline::create(
     }
     else
     {
-        vertexInput.vertexBindingDescriptionCount = 1;
-        vertexInput.pVertexBindingDescriptions = &bindingDescription;
+        vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+        vertexInput.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
         vertexInput.pVertexAttributeDescriptions = attributeDescriptions.data();
     }
     // Input assembly
     VkPipelineInputAssemblyStateCreateInfo assembly{};
     assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    assembly.topology = tessellated ? VK_PRIMITIVE_TOPOLOGY_PATCH_LIST : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     assembly.primitiveRestartEnable = VK_FALSE;
 
-    // Viewport & scissor
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(extent.width);
-    viewport.height = static_cast<float>(extent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = extent;
+    VkPipelineTessellationStateCreateInfo tessellation{};
+    tessellation.sType = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO;
+    tessellation.patchControlPoints = 3;
 
+    // Viewport & scissor: dynamic state, the pass sets them
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     // Rasterizer
     VkPipelineRasterizationStateCreateInfo rasterizer{};
@@ -129,11 +237,11 @@ void WaterPipeline::create(
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rasterizer.depthBiasEnable = VK_FALSE;
 
-    // Multisampling
+    // Multisampling; sample shading would hold coarse tiles to one pixel per fragment
     VkPipelineMultisampleStateCreateInfo multisampling{};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_TRUE;
-    multisampling.rasterizationSamples = msaaSamples;
+    multisampling.sampleShadingEnable = shadingRate ? VK_FALSE : VK_TRUE;
+    multisampling.rasterizationSamples = m_samples;
     multisampling.minSampleShading = 0.25f;
 
     // Depth stencil
@@ -191,27 +299,6 @@ void WaterPipeline::create(
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
 
-    // Pipeline layout
-    std::array<VkDescriptorSetLayout, 2> setLayouts = {globalDescriptorSetLayout, waterDescriptorSetLayout};
-
-    // --- CRITICAL FIX: Ensure Push Constant size is 96 bytes (extended for god-ray params) ---
-    VkPushConstantRange pushRange{};
-    pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushRange.offset = 0;
-    pushRange.size = 96; // Size extended for God Rays/Fog data + extra floats
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
-
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create water pipeline layout.");
-    }
-
     // Create graphics pipeline
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -219,38 +306,88 @@ void WaterPipeline::create(
     pipelineInfo.pStages = shaderStages.data();
     pipelineInfo.pVertexInputState = &vertexInput;
     pipelineInfo.pInputAssemblyState = &assembly;
+    pipelineInfo.pTessellationState = tessellated ? &tessellation : nullptr;
     pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.layout = layout;
-    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.renderPass = m_renderPass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    DynamicRendering::apply(pipelineInfo, renderingInfo);
+    VkPipelineFragmentShadingRateStateCreateInfoKHR shadingRateState{};
+    if (shadingRate)
     {
-        vkDestroyPipelineLayout(device, layout, nullptr);
-        throw std::runtime_error("Failed to create water graphics pipeline.");
+        VariableRateShading::chainPipeline(pipelineInfo, shadingRateState);
     }
 
-    vkDestroyShaderModule(device, vertModule, nullptr);
-    vkDestroyShaderModule(device, fragModule, nullptr);
+    VkPipeline built = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(m_device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &built) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create water graphics pipeline.");
+    }
+    return built;
 }
 
 void WaterPipeline::destroy(VkDevice device)
 {
-    if (pipeline != VK_NULL_HANDLE)
+    for (auto &entry : m_variants)
     {
-        vkDestroyPipeline(device, pipeline, nullptr);
-        pipeline = VK_NULL_HANDLE;
+        vkDestroyPipeline(device, entry.second, nullptr);
     }
+    m_variants.clear();
+    pipeline = VK_NULL_HANDLE;
     if (layout != VK_NULL_HANDLE)
     {
         vkDestroyPipelineLayout(device, layout, nullptr);
         layout = VK_NULL_HANDLE;
     }
+    for (VkShaderModule *module : {&m_vertModule, &m_fragModule, &m_tescModule, &m_teseModule, &m_rateTileVertModule, &m_rayQueryFragModule})
+    {
+        vkDestroyShaderModule(device, *module, nullptr);
+        *module = VK_NULL_HANDLE;
+    }
+}
+
+void WaterPipeline::select(WaterVariant variant, bool shadingRate, bool rayQuery)
+{
+    // water.frag has no debug views: one pipeline per mode; the sunrays trace nothing
+    if (!m_sunrays)
+    {
+        variant.debugView = 0;
+        shadingRate = false;
+    }
+    else
+    {
+        rayQuery = false;
+    }
+    if (shadingRate && m_rateTileVertModule == VK_NULL_HANDLE)
+    {
+        m_rateTileVertModule = createShaderModule(m_device, ShaderRegistry::load("shaders/sunrays_tile_vrs.vert.spv"));
+    }
+    if (rayQuery && m_rayQueryFragModule == VK_NULL_HANDLE)
+    {
+        m_rayQueryFragModule = createShaderModule(m_device, ShaderRegistry::load("shaders/water_rq.frag.spv"));
+    }
+    const VariantKey key{variant, shadingRate, rayQuery};
+    auto it = m_variants.find(key);
+    if (it == m_variants.end())
+    {
+        it = m_variants.emplace(key, buildVariant(key)).first;
+    }
+    pipeline = it->second;
+}
+
+void WaterPipeline::prebuild(WaterVariant variant, bool shadingRate, bool rayQuery)
+{
+    const VkPipeline selected = pipeline;
+    select(variant, shadingRate, rayQuery);
+    pipeline = selected;
 }
 
 void WaterPipeline::bind(VkCommandBuffer cmd)
@@ -6,6 +6,9 @@
 #endif
 
 #include "WaterTestingSystem.h"
+#include "CpuProfiler.h"
+#include "FrameMetricsLog.h"
+#include "ImageMetrics.h"
 #include <filesystem>
 #include <iostream>
 #include <cstring>
@@ -14,6 +17,9 @@
 // INITIALIZATION AND CLEANUP
 // ============================================================================
 
+WaterTestingSystem::WaterTestingSystem() = default;
+WaterTestingSystem::~WaterTestingSystem() = default;
+
 void WaterTestingSystem::initialize(VkDevice device, VkPhysicalDevice physicalDevice,
                                     VkQueue graphicsQueue, uint32_t queueFamilyIndex)
 {
@@ -27,9 +33,6 @@ void WaterTestingSystem::initialize(VkDevice device, VkPhysicalDevice physicalDe
     vkGetPhysicalDeviceProperties(physicalDevice, &props);
     m_timestampPeriod = props.limits.timestampPeriod;
 
-    // Create timestamp query pool for GPU timing
-    createTimestampQueryPool();
-
     // Create output directory
     std::filesystem::create_directories(m_outputDirectory);
 
@@ -38,175 +41,122 @@ void WaterTestingSystem::initialize(VkDevice device, VkPhysicalDevice physicalDe
 
 void WaterTestingSystem::cleanup()
 {
-    if (m_timestampQueryPool != VK_NULL_HANDLE && m_device != VK_NULL_HANDLE)
-    {
-        vkDestroyQueryPool(m_device, m_timestampQueryPool, nullptr);
-        m_timestampQueryPool = VK_NULL_HANDLE;
-    }
-}
-
-void WaterTestingSystem::createTimestampQueryPool()
-{
-    if (m_device == VK_NULL_HANDLE)
-        return;
-
-    VkQueryPoolCreateInfo queryPoolInfo{};
-    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
-    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
-    queryPoolInfo.queryCount = 2; // QUERY_START and QUERY_END
-
-    if (vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &m_timestampQueryPool) != VK_SUCCESS)
-    {
-        std::cerr << "[WaterTestingSystem] Warning: Failed to create timestamp query pool\n";
-        m_timestampQueryPool = VK_NULL_HANDLE;
-    }
-    else
-    {
-        std::cout << "[WaterTestingSystem] Created timestamp query pool for GPU timing\n";
-        m_queryPoolNeedsReset = true; // Mark that we need to reset before first use
-    }
+    // GPU timings come from the renderer's GpuProfiler; nothing Vulkan-side is owned here
+    m_device = VK_NULL_HANDLE;
+    m_frameLog.reset(); // Writes what is still queued
 }
 
 // ============================================================================
 // GPU TIMING IMPLEMENTATION
 // ============================================================================
 
-void WaterTestingSystem::resetTimestampQueries(VkCommandBuffer cmd)
+void WaterTestingSystem::setGpuTimings(double gpuTimeMs, double waterPassTimeMs, double scenePassTimeMs, double postProcessTimeMs)
 {
-    if (m_timestampQueryPool == VK_NULL_HANDLE || cmd == VK_NULL_HANDLE)
-        return;
+    m_lastGpuTimeMs = gpuTimeMs;
+    m_lastWaterPassTimeMs = waterPassTimeMs;
+    m_lastScenePassTimeMs = scenePassTimeMs;
+    m_lastPostProcessTimeMs = postProcessTimeMs;
+}
 
-    // Reset the timestamp queries before writing new ones
-    vkCmdResetQueryPool(cmd, m_timestampQueryPool, 0, 2);
-    m_timestampsWritten = false;
-    m_startTimestampWritten = false;
-    m_queryPoolNeedsReset = false; // Reset has been issued in this command buffer
+void WaterTestingSystem::setCpuTimings(double cpuTimeMs, double latencyMs)
+{
+    m_lastCpuTimeMs = cpuTimeMs;
+    m_lastLatencyMs = latencyMs;
 }
 
-void WaterTestingSystem::writeTimestampStart(VkCommandBuffer cmd)
+void WaterTestingSystem::setGpuCounters(const GpuPassStatistics &statistics, const std::vector<double> &counters)
 {
-    if (m_timestampQueryPool == VK_NULL_HANDLE || cmd == VK_NULL_HANDLE)
-        return;
+    m_lastPipelineStatistics = statistics;
+    m_lastGpuCounters = counters;
+}
 
-    // Only write if reset has been issued (reset must come first in the same command buffer)
-    if (m_queryPoolNeedsReset)
-    {
-        // Reset wasn't called yet - skip this frame's timing
-        m_startTimestampWritten = false;
-        return;
-    }
+// ============================================================================
+// TEST EXECUTION
+// ============================================================================
 
-    // Write timestamp at the TOP of the pipeline (before any GPU work)
-    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampQueryPool, QUERY_START);
-    m_startTimestampWritten = true;
+void WaterTestingSystem::beginWarmup(const WaterTestConfig &config)
+{
+    m_isRunning = false;
+    m_isWarmingUp = true;
+    m_currentConfig = config;
+    m_warmup.reset(TestParams::WARMUP_MAX_FRAMES);
 }
 
-void WaterTestingSystem::writeTimestampEnd(VkCommandBuffer cmd)
+bool WaterTestingSystem::recordWarmupFrame(double frameTimeMs)
 {
-    if (m_timestampQueryPool == VK_NULL_HANDLE || cmd == VK_NULL_HANDLE)
-        return;
+    if (!m_isWarmingUp || !m_warmup.addFrame(frameTimeMs))
+        return false;
+
+    m_isWarmingUp = false;
+    std::cout << "[WaterTestingSystem] " << m_currentConfig.name << (m_warmup.hasConverged() ? " settled after " : " did not settle in ")
+              << m_warmup.getFrameCount() << " warm-up frames (variation " << std::fixed << std::setprecision(1)
+              << m_warmup.getVariation() * 100.0 << "%)\n"
+              << std::defaultfloat;
+    return true;
+}
 
-    // Only write if start timestamp was written (prevents writing end without start)
-    // This handles the case where test mode is activated mid-frame
-    if (!m_startTimestampWritten)
+void WaterTestingSystem::startTestRun(const WaterTestConfig &config, int runIndex)
+{
+    m_isRunning = true;
+    m_isWarmingUp = false;
+    m_currentFrameIndex = 0;
+    m_currentConfig = config;
+    if (config.adaptiveWarmup)
     {
-        // Start wasn't written - skip end timestamp to avoid validation error
-        return;
+        m_currentConfig.warmupFrames = 0; // Warmed up before the config's first run
     }
 
-    // Write timestamp at the BOTTOM of the pipeline (after all GPU work)
-    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampQueryPool, QUERY_END);
-    m_timestampsWritten = true;
-}
+    // Reset GPU timing state for new test run
+    setGpuTimings(0.0, 0.0, 0.0, 0.0);
+    setCpuTimings(0.0, 0.0);
+    setGpuCounters({}, {});
 
-void WaterTestingSystem::readGpuTimestamps()
-{
-    if (m_timestampQueryPool == VK_NULL_HANDLE)
+    m_currentResult = TestRunResult{};
+    m_currentResult.config = m_currentConfig;
+    m_currentResult.runIndex = runIndex;
+    if (config.captureGpuCounters)
     {
-        m_lastGpuTimeMs = 0.0;
-        return;
+        m_currentResult.gpuCounterNames = m_gpuCounterNames;
     }
+    m_currentResult.startTime = std::chrono::system_clock::now();
+    m_currentResult.frameMetrics.clear();
 
-    if (!m_timestampsWritten)
+    // Streaming: (re)open the log if the path changed, else buffer the run's frames
+    if (m_frameLogPath.empty())
     {
-        // Timestamps weren't written this frame - keep previous value or set to 0
-        // Don't overwrite m_lastGpuTimeMs if we have a valid previous value
-        return;
+        m_frameLog.reset();
     }
-
-    uint64_t timestamps[2] = {0, 0};
-
-    // Read the timestamp results
-    // VK_QUERY_RESULT_64_BIT: results are 64-bit values
-    // VK_QUERY_RESULT_WAIT_BIT: wait for results to be available (GPU must have finished)
-    VkResult result = vkGetQueryPoolResults(
-        m_device,
-        m_timestampQueryPool,
-        0,                  // firstQuery
-        2,                  // queryCount
-        sizeof(timestamps), // dataSize
-        timestamps,         // pData
-        sizeof(uint64_t),   // stride
-        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
-
-    if (result == VK_SUCCESS)
+    else if (!m_frameLog || m_frameLog->getPath() != m_frameLogPath)
     {
-        // Calculate GPU time in milliseconds
-        // timestampPeriod is in nanoseconds per tick
-        if (timestamps[QUERY_END] > timestamps[QUERY_START])
+        try
         {
-            uint64_t timestampDiff = timestamps[QUERY_END] - timestamps[QUERY_START];
-            double nanoseconds = static_cast<double>(timestampDiff) * m_timestampPeriod;
-            m_lastGpuTimeMs = nanoseconds / 1000000.0; // Convert ns to ms
+            m_frameLog = std::make_unique<FrameMetricsLog>(m_frameLogPath);
         }
-        else
+        catch (const std::exception &e)
         {
-            // Invalid timestamps (end <= start), keep previous value
-            std::cerr << "[WaterTestingSystem] Warning: Invalid timestamps (end <= start)\n";
+            std::cerr << "[WaterTestingSystem] " << e.what() << " - keeping frames in memory\n";
+            m_frameLog.reset();
+            m_frameLogPath.clear();
         }
     }
+    if (m_frameLog)
+    {
+        m_frameLog->beginRun(config.name, runIndex, config.totalFrames, m_currentConfig.warmupFrames);
+    }
     else
     {
-        // Query failed - could be VK_NOT_READY if GPU hasn't finished
-        if (result != VK_NOT_READY)
-        {
-            std::cerr << "[WaterTestingSystem] Warning: vkGetQueryPoolResults failed with code " << result << "\n";
-        }
+        m_currentResult.frameMetrics.reserve(config.totalFrames);
     }
 
-    m_timestampsWritten = false;
-}
-
-// ============================================================================
-// TEST EXECUTION
-// ============================================================================
-
-void WaterTestingSystem::startTestRun(const WaterTestConfig &config, int runIndex)
-{
-    m_isRunning = true;
-    m_currentFrameIndex = 0;
-    m_currentConfig = config;
-
-    // Reset GPU timing state for new test run
-    m_queryPoolNeedsReset = true;
-    m_timestampsWritten = false;
-    m_startTimestampWritten = false;
-    m_lastGpuTimeMs = 0.0;
-
-    m_currentResult = TestRunResult{};
-    m_currentResult.config = config;
-    m_currentResult.runIndex = runIndex;
-    m_currentResult.startTime = std::chrono::system_clock::now();
-    m_currentResult.frameMetrics.clear();
-    m_currentResult.frameMetrics.reserve(config.totalFrames);
-
     m_frameBuffer.clear();
+    m_live = RunStatistics{};
+    m_live.gpuCounters.resize(m_currentResult.gpuCounterNames.size());
 
     m_testStartTime = std::chrono::high_resolution_clock::now();
     m_frameStartTime = m_testStartTime;
 
     // Set default camera path if not set
-    if (m_cameraPath.keyframes.empty())
+    if (m_cameraPath.getKeyframes().empty())
     {
         m_cameraPath = DeterministicCameraPath::createUnderwaterPath();
     }
@@ -218,30 +168,84 @@ void WaterTestingSystem::startTestRun(const WaterTestConfig &config, int runInde
 void WaterTestingSystem::recordFrame(uint32_t frameIndex, double frameTimeMs,
                                      const glm::vec3 &camPos, float yaw, float pitch)
 {
+    CPU_ZONE("WaterTestingSystem::recordFrame");
     if (!m_isRunning)
         return;
 
     auto now = std::chrono::high_resolution_clock::now();
 
-    // NOTE: readGpuTimestamps() should be called BEFORE this function in the mainLoop
-    // (after vkQueueWaitIdle). Do NOT call it here as it would reset m_lastGpuTimeMs to 0.
+    // NOTE: setGpuTimings() should be called BEFORE this function in the mainLoop. The
+    // profiler reads back without waiting, so the GPU times trail the frame by a frame or two.
 
     FrameMetrics metrics{};
     metrics.frameIndex = m_currentFrameIndex;
-    metrics.frameTimeMs = frameTimeMs;                 // Total frame time (CPU + GPU + present)
-    metrics.gpuTimeMs = m_lastGpuTimeMs;               // Actual GPU time from timestamp queries
-    metrics.cpuTimeMs = frameTimeMs - m_lastGpuTimeMs; // Approximate CPU time (may be negative if GPU > total)
-    if (metrics.cpuTimeMs < 0.0)
-        metrics.cpuTimeMs = 0.0; // Clamp to 0
+    metrics.frameTimeMs = frameTimeMs;   // Completion interval (pipelined) or start-to-idle time (synced)
+    metrics.gpuTimeMs = m_lastGpuTimeMs; // Actual GPU time from timestamp queries
+    metrics.cpuTimeMs = m_lastCpuTimeMs;
+    metrics.latencyMs = m_lastLatencyMs;
     metrics.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
                               now.time_since_epoch())
                               .count();
+    metrics.waterPassTimeMs = m_lastWaterPassTimeMs;
+    metrics.scenePassTimeMs = m_lastScenePassTimeMs;
+    metrics.postProcessTimeMs = m_lastPostProcessTimeMs;
+    if (m_currentConfig.captureGpuCounters)
+    {
+        metrics.pipelineStatistics = m_lastPipelineStatistics;
+        metrics.gpuCounters = m_lastGpuCounters;
+        metrics.gpuCounters.resize(m_currentResult.gpuCounterNames.size(), 0.0);
+    }
     metrics.cameraPosition = camPos;
     metrics.cameraYaw = yaw;
     metrics.cameraPitch = pitch;
     metrics.isWarmupFrame = (m_currentFrameIndex < static_cast<uint32_t>(m_currentConfig.warmupFrames));
 
-    m_currentResult.frameMetrics.push_back(metrics);
+    if (!metrics.isWarmupFrame)
+    {
+        // Judged against every frame so far, as aggregateMetrics judges against the whole run: a lasting shift in
+        // frame time soon moves the band with it instead of being rejected for the rest of the run
+        const bool judged = m_live.frameTimeBand.count >= kOnlineOutlierMinSamples;
+        const bool outlier = judged && isOutlier(frameTimeMs, m_live.frameTimeBand.mean, m_live.frameTimeBand.stddev(), 5.0);
+        m_live.frameTimeBand.add(frameTimeMs);
+        if (outlier)
+        {
+            m_live.outliers++;
+        }
+        else
+        {
+            m_live.frameTime.add(frameTimeMs);
+            m_live.frameTimeQuantiles.add(frameTimeMs);
+            if (frameTimeMs > 0.0)
+            {
+                m_live.fps.add(1000.0 / frameTimeMs);
+                m_live.fpsQuantiles.add(1000.0 / frameTimeMs);
+            }
+            m_live.gpuTime.add(metrics.gpuTimeMs);
+            m_live.gpuTimeQuantiles.add(metrics.gpuTimeMs);
+            m_live.latency.add(metrics.latencyMs);
+            m_live.latencyQuantiles.add(metrics.latencyMs);
+            m_live.cpuTime.add(metrics.cpuTimeMs);
+            m_live.vertexInvocations.add(static_cast<double>(metrics.pipelineStatistics.vertexInvocations));
+            m_live.clippingPrimitives.add(static_cast<double>(metrics.pipelineStatistics.clippingPrimitives));
+            m_live.fragmentInvocations.add(static_cast<double>(metrics.pipelineStatistics.fragmentInvocations));
+            m_live.computeInvocations.add(static_cast<double>(metrics.pipelineStatistics.computeInvocations));
+            for (size_t c = 0; c < m_live.gpuCounters.size(); c++)
+            {
+                m_live.gpuCounters[c].add(metrics.gpuCounters[c]);
+            }
+        }
+        // Buffered runs flag outliers against the whole run in aggregateMetrics instead
+        metrics.isOutlier = m_frameLog && outlier;
+    }
+
+    if (m_frameLog)
+    {
+        m_frameLog->append(metrics, m_currentResult.runIndex);
+    }
+    else
+    {
+        m_currentResult.frameMetrics.push_back(metrics);
+    }
     m_currentFrameIndex++;
 
     // Progress logging every 50 frames
@@ -262,7 +266,72 @@ TestRunResult WaterTestingSystem::endTestRun()
     m_currentResult.endTime = std::chrono::system_clock::now();
 
     // Aggregate metrics
-    m_currentResult.aggregated = aggregateMetrics(m_currentResult.frameMetrics, m_currentConfig);
+    if (m_frameLog)
+    {
+        m_frameLog->flush();
+        m_currentResult.aggregated = aggregateStreamedMetrics(m_currentConfig);
+    }
+    else
+    {
+        m_currentResult.aggregated = aggregateMetrics(m_currentResult.frameMetrics, m_currentConfig);
+    }
+    // Counters barely vary between frames: the online statistics do for both modes
+    if (m_currentConfig.captureGpuCounters)
+    {
+        AggregatedRunMetrics &a = m_currentResult.aggregated;
+        a.meanVertexInvocations = m_live.vertexInvocations.mean;
+        a.meanClippingPrimitives = m_live.clippingPrimitives.mean;
+        a.meanFragmentInvocations = m_live.fragmentInvocations.mean;
+        a.meanComputeInvocations = m_live.computeInvocations.mean;
+        for (const RunningStats &counter : m_live.gpuCounters)
+        {
+            a.meanGpuCounters.push_back(counter.mean);
+        }
+    }
+    // Frames captured during the run (VulkanBase: "Capture Screenshots")
+    if (m_frameBuffer.size() >= 2)
+    {
+        m_currentResult.temporalMetrics = analyzeTemporalStability(m_frameBuffer, m_frameBufferWidth, m_frameBufferHeight);
+        m_currentResult.aggregated.temporalStability = m_currentResult.temporalMetrics.avgFrameToFrameSSIM;
+    }
+    const std::vector<ImageQualityMetrics> &quality = m_currentResult.imageQualityMetrics;
+    if (!quality.empty())
+    {
+        AggregatedRunMetrics &a = m_currentResult.aggregated;
+        for (const ImageQualityMetrics &q : quality)
+        {
+            a.avgSSIM += q.ssim;
+            a.avgPSNR += q.psnr;
+            a.avgDeltaE += q.deltaE;
+        }
+        a.imageQualityFrameCount = static_cast<int>(quality.size());
+        a.avgSSIM /= quality.size();
+        a.avgPSNR /= quality.size();
+        a.avgDeltaE /= quality.size();
+    }
+    const std::vector<ImageQualityMetrics> &reference = m_currentResult.referenceQualityMetrics;
+    if (!reference.empty())
+    {
+        AggregatedRunMetrics &a = m_currentResult.aggregated;
+        for (const ImageQualityMetrics &q : reference)
+        {
+            a.referenceSSIM += q.ssim;
+            a.referencePSNR += q.psnr;
+        }
+        a.referenceFrameCount = static_cast<int>(reference.size());
+        a.referenceSSIM /= reference.size();
+        a.referencePSNR /= reference.size();
+    }
+
+    ConfigAccumulator &summary = m_configSummaries[m_currentConfig.name];
+    summary.runCount++;
+    summary.outliers += m_live.outliers;
+    summary.frameTimeSum += m_live.frameTime.mean * m_live.frameTime.count;
+    summary.fpsSum += m_live.fps.mean * m_live.fps.count;
+    summary.frameTimeQuantiles.merge(m_live.frameTimeQuantiles);
+    summary.fpsQuantiles.merge(m_live.fpsQuantiles);
+    summary.gpuTimeQuantiles.merge(m_live.gpuTimeQuantiles);
+    summary.latencyQuantiles.merge(m_live.latencyQuantiles);
 
     std::cout << "[WaterTestingSystem] Test run completed.\n";
     std::cout << "  Mean FPS: " << std::fixed << std::setprecision(2)
@@ -270,16 +339,109 @@ TestRunResult WaterTestingSystem::endTestRun()
     std::cout << "  Mean Frame Time: " << m_currentResult.aggregated.meanFrameTime << " ms\n";
     std::cout << "  1% Low FPS: " << m_currentResult.aggregated.fps1Low << "\n";
     std::cout << "  Outliers removed: " << m_currentResult.aggregated.outlierCount << "\n";
+    if (m_frameBuffer.size() >= 2)
+    {
+        std::cout << "  Frame-to-frame SSIM: " << std::setprecision(4) << m_currentResult.temporalMetrics.avgFrameToFrameSSIM
+                  << " (min " << m_currentResult.temporalMetrics.minFrameToFrameSSIM << ")\n";
+    }
+    if (!quality.empty())
+    {
+        std::cout << "  GPU image quality (" << quality.size() << " frames): SSIM " << std::setprecision(4)
+                  << m_currentResult.aggregated.avgSSIM << ", PSNR " << std::setprecision(2)
+                  << m_currentResult.aggregated.avgPSNR << " dB, Delta E " << m_currentResult.aggregated.avgDeltaE << "\n";
+    }
+    if (!reference.empty())
+    {
+        std::cout << "  Against references (" << reference.size() << " frames): SSIM " << std::setprecision(4)
+                  << m_currentResult.aggregated.referenceSSIM << ", PSNR " << std::setprecision(2)
+                  << m_currentResult.aggregated.referencePSNR << " dB\n";
+    }
 
     return m_currentResult;
 }
 
 CameraKeyframe WaterTestingSystem::getCameraStateForFrame(uint32_t frameIndex) const
 {
-    if (m_currentConfig.totalFrames == 0)
-        return {};
-    float t = static_cast<float>(frameIndex) / static_cast<float>(m_currentConfig.totalFrames);
-    return m_cameraPath.interpolate(t);
+    return m_cameraPath.atFrame(frameIndex, m_currentConfig.totalFrames);
+}
+
+DeterministicCameraPath WaterTestingSystem::cameraPathFor(const WaterTestConfig &config)
+{
+    if (!config.cameraPathFile.empty())
+    {
+        // A path that fails to load leaves the preset in place
+        if (std::optional<DeterministicCameraPath> path = DeterministicCameraPath::loadFromJson(config.cameraPathFile))
+            return *path;
+    }
+    return config.depth == DepthLevel::Deep ? DeterministicCameraPath::createDepthTransitionPath()
+                                            : DeterministicCameraPath::createSurfacePath();
+}
+
+// ============================================================================
+// SCHEDULING
+// ============================================================================
+
+namespace
+{
+    // What switching from one config to the next costs, roughly in pipeline compiles and queue drains
+    int stateChangeCost(const WaterTestConfig &a, const WaterTestConfig &b)
+    {
+        int cost = 0;
+        cost += a.framesInFlight != b.framesInFlight ? 8 : 0; // Drains the frame timeline
+        cost += a.msaaSamples != b.msaaSamples ? 8 : 0;       // Drains it too, and rebuilds the depth and pipelines
+        cost += a.renderingMode != b.renderingMode ? 4 : 0;   // Water pipeline variants
+        cost += a.specializedShaders != b.specializedShaders ? 4 : 0;
+        cost += a.sceneSubmission != b.sceneSubmission || a.occlusionCulling != b.occlusionCulling ? 4 : 0;
+        cost += a.depthPrePass != b.depthPrePass ? 4 : 0; // Pre-pass scene pipelines
+        cost += a.asyncEnabled != b.asyncEnabled ? 4 : 0;
+        cost += a.tilingEnabled != b.tilingEnabled ? 4 : 0; // Tile-class fog pipelines
+        cost += a.variableRateShading != b.variableRateShading ? 4 : 0; // Shading-rate fog and sunrays pipelines
+        cost += a.alternateFrameDevices != b.alternateFrameDevices ? 1 : 0; // Device masks only
+        cost += a.reflections != b.reflections ? 2 : 0;
+        cost += a.froxelVolumetrics != b.froxelVolumetrics ? 2 : 0;
+        cost += a.halfResGodRays != b.halfResGodRays ? 2 : 0;
+        cost += a.shadowQuality != b.shadowQuality ? 2 : 0;
+        cost += a.pointLightCount != b.pointLightCount || a.clusteredLighting != b.clusteredLighting ? 2 : 0; // Light re-upload
+        // Parameters only: one each
+        cost += a.turbidity != b.turbidity ? 1 : 0;
+        cost += a.depth != b.depth ? 1 : 0;
+        cost += a.lightMotion != b.lightMotion ? 1 : 0;
+        cost += a.sampleCount != b.sampleCount ? 1 : 0;
+        cost += a.causticRayCount != b.causticRayCount ? 1 : 0;
+        cost += a.shadowRoundRobin != b.shadowRoundRobin ? 1 : 0;
+        cost += a.offscreenUpdateInterval != b.offscreenUpdateInterval ? 1 : 0;
+        return cost;
+    }
+}
+
+std::vector<WaterTestConfig> WaterTestingSystem::orderByStateChanges(std::vector<WaterTestConfig> configs)
+{
+    // Greedy nearest neighbour: suites are tens of configs, and an exact tour would not be worth it
+    std::vector<WaterTestConfig> ordered;
+    ordered.reserve(configs.size());
+    std::vector<bool> taken(configs.size(), false);
+    size_t current = 0;
+    for (size_t step = 0; step < configs.size(); step++)
+    {
+        taken[current] = true;
+        ordered.push_back(configs[current]);
+
+        size_t best = configs.size();
+        int bestCost = 0;
+        for (size_t i = 0; i < configs.size(); i++)
+        {
+            if (taken[i])
+                continue;
+            const int cost = stateChangeCost(configs[current], configs[i]);
+            if (best == configs.size() || cost < bestCost)
+            {
+                best = i;
+                bestCost = cost;
+            }
+        }
+        current = best;
+    }
+    return ordered;
 }
 
 // ============================================================================
@@ -417,6 +579,7 @@ std::vector<WaterTestConfig> WaterTestingSystem::generateImageQualityTestConfigs
         config.totalFrames = TestParams::IQ_TOTAL_FRAMES;
         config.warmupFrames = TestParams::IQ_WARMUP_FRAMES;
         config.repeatCount = 1; // Single run for image quality
+        config.pipelinedTiming = false; // Camera and captures must line up frame for frame
         configs.push_back(config);
     }
 
@@ -496,6 +659,205 @@ std::vector<WaterTestConfig> WaterTestingSystem::generateTradeOffSweepConfigs()
         config.name = "Sweep_Async" + std::to_string(async) + "_Tiling" + std::to_string(tiling);
         config.asyncEnabled = async;
         config.tilingEnabled = tiling;
+        config.froxelVolumetrics = false; // Tiling applies to the analytic fog the froxel volume replaces
+        config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+        config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+        config.renderingMode = RenderingMode::PB;
+        config.turbidity = TurbidityLevel::Low;
+        config.depth = DepthLevel::Shallow;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // Frames in flight: 2 vs 3 slots, pipelined so the extra queued frame shows as throughput
+    for (uint32_t frames : {2u, 3u})
+    {
+        WaterTestConfig config;
+        config.name = "Sweep_FramesInFlight" + std::to_string(frames);
+        config.framesInFlight = frames;
+        config.pipelinedTiming = true;
+        config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+        config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+        config.renderingMode = RenderingMode::PB;
+        config.turbidity = TurbidityLevel::Low;
+        config.depth = DepthLevel::Shallow;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // MSAA: main pass sample count, resolved in-pass; counts the device lacks clamp down to the largest it has
+    for (uint32_t samples : {2u, 4u, 8u})
+    {
+        WaterTestConfig config;
+        config.name = "Sweep_MSAA" + std::to_string(samples) + "x";
+        config.msaaSamples = samples;
+        config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+        config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+        config.renderingMode = RenderingMode::PB;
+        config.turbidity = TurbidityLevel::Low;
+        config.depth = DepthLevel::Shallow;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // Clock: fixed step vs replaying run 0's real-time cadence; every run of either renders the same frames
+    for (FrameClock::Mode clockMode : {FrameClock::Mode::FixedStep, FrameClock::Mode::Replay})
+    {
+        WaterTestConfig config;
+        config.name = std::string("Sweep_Clock") + FrameClock::modeName(clockMode);
+        config.clockMode = clockMode;
+        config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+        config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+        config.renderingMode = RenderingMode::PB;
+        config.turbidity = TurbidityLevel::Low;
+        config.depth = DepthLevel::Shallow;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // God-ray tier: full vs half resolution under OPT, on the underwater path where the rays draw
+    for (bool halfRes : {false, true})
+    {
+        WaterTestConfig config;
+        config.name = std::string("Sweep_GodRays") + (halfRes ? "Half" : "Full");
+        config.halfResGodRays = halfRes;
+        config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+        config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+        config.renderingMode = RenderingMode::OPT;
+        config.turbidity = TurbidityLevel::Low;
+        config.depth = DepthLevel::Deep;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // Shader variants: each mode's specialized pipelines against the runtime-branching baseline, underwater
+    for (RenderingMode mode : {RenderingMode::BL, RenderingMode::PB, RenderingMode::OPT})
+    {
+        for (bool specialized : {false, true})
+        {
+            WaterTestConfig config;
+            config.name = "Sweep_Variant" + std::to_string(static_cast<int>(mode)) + (specialized ? "_Specialized" : "_Runtime");
+            config.specializedShaders = specialized;
+            config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+            config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+            config.renderingMode = mode;
+            config.turbidity = TurbidityLevel::Low;
+            config.depth = DepthLevel::Deep;
+            config.lightMotion = LightMotion::Moving;
+            config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+            config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    // Sun shadow tiers above water, round-robin; High once more with every cascade re-rendered each frame
+    for (ShadowTier tier : {ShadowTier::Off, ShadowTier::Low, ShadowTier::Medium, ShadowTier::High})
+    {
+        for (bool roundRobin : {true, false})
+        {
+            if (!roundRobin && tier != ShadowTier::High)
+                continue;
+            WaterTestConfig config;
+            config.name = "Sweep_Shadows" + std::to_string(static_cast<int>(tier)) + (roundRobin ? "" : "_EveryFrame");
+            config.shadowQuality = tier;
+            config.shadowRoundRobin = roundRobin;
+            config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+            config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+            config.renderingMode = RenderingMode::PB;
+            config.turbidity = TurbidityLevel::Low;
+            config.depth = DepthLevel::Shallow;
+            config.lightMotion = LightMotion::Moving;
+            config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+            config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    // Point lights over the sea floor, seen from below the surface: clustered at rising counts, and the
+    // largest once more with every light shaded at every fragment
+    for (uint32_t lights : {0u, 256u, 1023u})
+    {
+        for (bool clustered : {true, false})
+        {
+            if (!clustered && lights != 1023u)
+                continue;
+            WaterTestConfig config;
+            config.name = "Sweep_Lights" + std::to_string(lights) + (clustered ? "" : "_BruteForce");
+            config.pointLightCount = lights;
+            config.clusteredLighting = clustered;
+            config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+            config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+            config.renderingMode = RenderingMode::PB;
+            config.turbidity = TurbidityLevel::Low;
+            config.depth = DepthLevel::Deep;
+            config.lightMotion = LightMotion::Moving;
+            config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+            config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    // Water reflections over the surface path: the planar pass against the screen-space and ray-query traces
+    for (ReflectionTier tier : {ReflectionTier::Planar, ReflectionTier::ScreenSpace, ReflectionTier::RayQuery})
+    {
+        WaterTestConfig config;
+        config.name = std::string("Sweep_Reflections_") +
+                      (tier == ReflectionTier::Planar ? "Planar" : tier == ReflectionTier::ScreenSpace ? "ScreenSpace" : "RayQuery");
+        config.reflections = tier;
+        config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+        config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+        config.renderingMode = RenderingMode::PB;
+        config.turbidity = TurbidityLevel::Low;
+        config.depth = DepthLevel::Shallow;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // Planar reflections re-rendered every 4th frame, reprojected in between
+    {
+        WaterTestConfig config;
+        config.name = "Sweep_OffscreenInterval_4";
+        config.reflections = ReflectionTier::Planar;
+        config.offscreenUpdateInterval = 4;
+        config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+        config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+        config.renderingMode = RenderingMode::PB;
+        config.turbidity = TurbidityLevel::Low;
+        config.depth = DepthLevel::Shallow;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // Depth pre-pass against shading the scene in one pass, with the refraction pass sharing it
+    {
+        WaterTestConfig config;
+        config.name = "Sweep_DepthPrePass";
+        config.depthPrePass = true;
+        config.reflections = ReflectionTier::Planar;
         config.sampleCount = TestParams::SAMPLE_COUNT_MID;
         config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
         config.renderingMode = RenderingMode::PB;
@@ -508,8 +870,25 @@ std::vector<WaterTestConfig> WaterTestingSystem::generateTradeOffSweepConfigs()
         configs.push_back(config);
     }
 
+    // Full-screen fog and ray-marched god rays against the froxel volume, in murky water
+    {
+        WaterTestConfig config;
+        config.name = "Sweep_AnalyticFog";
+        config.froxelVolumetrics = false;
+        config.sampleCount = TestParams::SAMPLE_COUNT_MID;
+        config.causticRayCount = TestParams::CAUSTIC_RAYS_MID;
+        config.renderingMode = RenderingMode::PB;
+        config.turbidity = TurbidityLevel::High;
+        config.depth = DepthLevel::Shallow;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
     std::cout << "[WaterTestingSystem] FAST_TEST_MODE: Generated " << configs.size()
-              << " trade-off sweep configs (reduced from 14)\n";
+              << " trade-off sweep configs (reduced from 50)\n";
 
 #else
     // =========================================================================
@@ -562,6 +941,26 @@ std::vector<WaterTestConfig> WaterTestingSystem::generateTradeOffSweepConfigs()
         config.name = "Sweep_Async" + std::to_string(async) + "_Tiling" + std::to_string(tiling);
         config.asyncEnabled = async;
         config.tilingEnabled = tiling;
+        config.froxelVolumetrics = false; // Tiling applies to the analytic fog the froxel volume replaces
+        config.sampleCount = 8;
+        config.causticRayCount = 64;
+        config.renderingMode = RenderingMode::PB;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // Variable-rate fog and sunrays against full rate, in thick fog where coarse tiles are likely;
+    // the SSIM column shows what the coarse tiles cost against the full-rate run's image
+    for (bool rates : {false, true})
+    {
+        WaterTestConfig config;
+        config.name = "Sweep_VRS" + std::to_string(rates);
+        config.variableRateShading = rates;
+        config.tilingEnabled = true;      // The fog is shaded at rates through its tile quads
+        config.froxelVolumetrics = false; // So the fog and sunrays are the full-screen passes
+        config.turbidity = TurbidityLevel::High;
         config.sampleCount = 8;
         config.causticRayCount = 64;
         config.renderingMode = RenderingMode::PB;
@@ -571,6 +970,159 @@ std::vector<WaterTestConfig> WaterTestingSystem::generateTradeOffSweepConfigs()
         configs.push_back(config);
     }
 
+    // Half-res god rays under OPT against full res, both underwater
+    for (bool halfRes : {false, true})
+    {
+        WaterTestConfig config;
+        config.name = std::string("Sweep_GodRays") + (halfRes ? "Half" : "Full");
+        config.halfResGodRays = halfRes;
+        config.sampleCount = 8;
+        config.causticRayCount = 64;
+        config.renderingMode = RenderingMode::OPT;
+        config.turbidity = TurbidityLevel::Medium;
+        config.depth = DepthLevel::Deep;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // Shader variants: each mode's specialized pipelines against the runtime-branching baseline, underwater
+    for (RenderingMode mode : {RenderingMode::BL, RenderingMode::PB, RenderingMode::OPT})
+    {
+        for (bool specialized : {false, true})
+        {
+            WaterTestConfig config;
+            config.name = "Sweep_Variant" + std::to_string(static_cast<int>(mode)) + (specialized ? "_Specialized" : "_Runtime");
+            config.specializedShaders = specialized;
+            config.sampleCount = 8;
+            config.causticRayCount = 64;
+            config.renderingMode = mode;
+            config.turbidity = TurbidityLevel::Medium;
+            config.depth = DepthLevel::Deep;
+            config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+            config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    // Sun shadow tiers above water, each with and without round-robin cascade updates
+    for (ShadowTier tier : {ShadowTier::Off, ShadowTier::Low, ShadowTier::Medium, ShadowTier::High})
+    {
+        for (bool roundRobin : {true, false})
+        {
+            if (!roundRobin && tier == ShadowTier::Off)
+                continue;
+            WaterTestConfig config;
+            config.name = "Sweep_Shadows" + std::to_string(static_cast<int>(tier)) + (roundRobin ? "" : "_EveryFrame");
+            config.shadowQuality = tier;
+            config.shadowRoundRobin = roundRobin;
+            config.sampleCount = 8;
+            config.causticRayCount = 64;
+            config.renderingMode = RenderingMode::PB;
+            config.turbidity = TurbidityLevel::Medium;
+            config.depth = DepthLevel::Shallow;
+            config.lightMotion = LightMotion::Moving;
+            config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+            config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    // Point lights over the sea floor, seen from below the surface: clustered at rising counts,
+    // each against the brute-force loop over every light
+    for (uint32_t lights : {0u, 64u, 256u, 1023u})
+    {
+        for (bool clustered : {true, false})
+        {
+            if (!clustered && lights == 0u)
+                continue;
+            WaterTestConfig config;
+            config.name = "Sweep_Lights" + std::to_string(lights) + (clustered ? "" : "_BruteForce");
+            config.pointLightCount = lights;
+            config.clusteredLighting = clustered;
+            config.sampleCount = 8;
+            config.causticRayCount = 64;
+            config.renderingMode = RenderingMode::PB;
+            config.turbidity = TurbidityLevel::Medium;
+            config.depth = DepthLevel::Deep;
+            config.lightMotion = LightMotion::Moving;
+            config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+            config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    // Water reflections over the surface path, in both modes that can afford the offscreen passes:
+    // none, the planar pass, the screen-space trace and the ray-query trace
+    static const char *const kReflectionNames[] = {"Off", "Planar", "ScreenSpace", "RayQuery"};
+    for (RenderingMode mode : {RenderingMode::PB, RenderingMode::OPT})
+    {
+        for (ReflectionTier tier : {ReflectionTier::Off, ReflectionTier::Planar, ReflectionTier::ScreenSpace, ReflectionTier::RayQuery})
+        {
+            WaterTestConfig config;
+            config.name = std::string("Sweep_Reflections_") + kReflectionNames[static_cast<int>(tier)] +
+                          (mode == RenderingMode::PB ? "_PB" : "_OPT");
+            config.reflections = tier;
+            config.sampleCount = 8;
+            config.causticRayCount = 64;
+            config.renderingMode = mode;
+            config.turbidity = TurbidityLevel::Medium;
+            config.depth = DepthLevel::Shallow;
+            config.lightMotion = LightMotion::Moving;
+            config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+            config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    // Reflection/refraction update rate with planar reflections: every frame is the sweep above,
+    // 0 re-renders only when the camera moves past the thresholds
+    for (uint32_t interval : {2u, 4u, 8u, 0u})
+    {
+        WaterTestConfig config;
+        config.name = "Sweep_OffscreenInterval_" + std::to_string(interval);
+        config.reflections = ReflectionTier::Planar;
+        config.offscreenUpdateInterval = interval;
+        config.sampleCount = 8;
+        config.causticRayCount = 64;
+        config.renderingMode = RenderingMode::PB;
+        config.turbidity = TurbidityLevel::Medium;
+        config.depth = DepthLevel::Shallow;
+        config.lightMotion = LightMotion::Moving;
+        config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+        config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+        config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+        configs.push_back(config);
+    }
+
+    // Depth pre-pass above and below the surface, without and with the shared refraction render
+    for (ReflectionTier tier : {ReflectionTier::Off, ReflectionTier::Planar})
+    {
+        for (DepthLevel depth : {DepthLevel::Shallow, DepthLevel::Deep})
+        {
+            WaterTestConfig config;
+            config.name = std::string("Sweep_DepthPrePass_") + kReflectionNames[static_cast<int>(tier)] +
+                          (depth == DepthLevel::Shallow ? "_Shallow" : "_Deep");
+            config.depthPrePass = true;
+            config.reflections = tier;
+            config.sampleCount = 8;
+            config.causticRayCount = 64;
+            config.renderingMode = RenderingMode::PB;
+            config.turbidity = TurbidityLevel::Medium;
+            config.depth = depth;
+            config.lightMotion = LightMotion::Moving;
+            config.totalFrames = TestParams::SWEEP_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::SWEEP_WARMUP_FRAMES;
+            config.repeatCount = TestParams::SWEEP_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
     std::cout << "[WaterTestingSystem] FULL_TEST_MODE: Generated " << configs.size()
               << " trade-off sweep configs (exhaustive sweep)\n";
 #endif
@@ -578,6 +1130,79 @@ std::vector<WaterTestConfig> WaterTestingSystem::generateTradeOffSweepConfigs()
     return configs;
 }
 
+std::vector<WaterTestConfig> WaterTestingSystem::generateSubmissionTestConfigs()
+{
+    std::vector<WaterTestConfig> configs;
+
+    // CPU draw list vs GPU culling (with and without Hi-Z) under every rendering mode,
+    // everything else fixed so only the submission path differs between runs
+    struct SubmissionVariant
+    {
+        SceneSubmission submission;
+        bool occlusion;
+        const char *tag;
+    };
+    const SubmissionVariant variants[] = {
+        {SceneSubmission::CPU, false, "CPU"},
+        {SceneSubmission::GPU, false, "GPU"},
+        {SceneSubmission::GPU, true, "GPUHiZ"}};
+
+    std::vector<RenderingMode> modes = {RenderingMode::BL, RenderingMode::PB, RenderingMode::OPT};
+
+    for (auto mode : modes)
+    {
+        for (const auto &variant : variants)
+        {
+            WaterTestConfig config;
+            config.name = std::string("Submit_") + variant.tag + "_Mode" + std::to_string(static_cast<int>(mode));
+            config.renderingMode = mode;
+            config.sceneSubmission = variant.submission;
+            config.occlusionCulling = variant.occlusion;
+            config.turbidity = TurbidityLevel::Medium;
+            config.depth = DepthLevel::Shallow;
+            config.lightMotion = LightMotion::Static;
+            config.totalFrames = TestParams::PERF_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::PERF_WARMUP_FRAMES;
+            config.repeatCount = TestParams::PERF_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    std::cout << "[WaterTestingSystem] Generated " << configs.size() << " submission test configs\n";
+    return configs;
+}
+
+std::vector<WaterTestConfig> WaterTestingSystem::generateDeviceGroupTestConfigs()
+{
+    std::vector<WaterTestConfig> configs;
+
+    // The same frames on one GPU and alternating over the group; three in flight so every
+    // GPU of a pair has a frame queued while the other renders
+    std::vector<RenderingMode> modes = {RenderingMode::BL, RenderingMode::PB, RenderingMode::OPT};
+
+    for (auto mode : modes)
+    {
+        for (bool alternate : {false, true})
+        {
+            WaterTestConfig config;
+            config.name = std::string(alternate ? "Group_AFR" : "Group_Single") + "_Mode" + std::to_string(static_cast<int>(mode));
+            config.renderingMode = mode;
+            config.alternateFrameDevices = alternate;
+            config.framesInFlight = 3;
+            config.turbidity = TurbidityLevel::Medium;
+            config.depth = DepthLevel::Shallow;
+            config.lightMotion = LightMotion::Static;
+            config.totalFrames = TestParams::PERF_TOTAL_FRAMES;
+            config.warmupFrames = TestParams::PERF_WARMUP_FRAMES;
+            config.repeatCount = TestParams::PERF_REPEAT_COUNT;
+            configs.push_back(config);
+        }
+    }
+
+    std::cout << "[WaterTestingSystem] Generated " << configs.size() << " device group test configs\n";
+    return configs;
+}
+
 // ============================================================================
 // IMAGE QUALITY METRICS
 // ============================================================================
@@ -588,6 +1213,14 @@ void WaterTestingSystem::captureScreenshot(uint32_t frameIndex, const std::vecto
     if (pixels.empty())
         return;
 
+    // A resize mid-run would make the stored frames incomparable
+    if (width != m_frameBufferWidth || height != m_frameBufferHeight)
+    {
+        m_frameBuffer.clear();
+        m_frameBufferWidth = width;
+        m_frameBufferHeight = height;
+    }
+
     // Store for temporal analysis
     if (m_frameBuffer.size() < 30)
     { // Keep last 30 frames for temporal analysis
@@ -615,6 +1248,24 @@ void WaterTestingSystem::captureScreenshot(uint32_t frameIndex, const std::vecto
     }
 }
 
+void WaterTestingSystem::recordImageQuality(const ImageQualityMetrics &metrics)
+{
+    if (!m_isRunning || metrics.frameIndex < static_cast<uint32_t>(m_currentConfig.warmupFrames) || metrics.frameIndex > m_currentFrameIndex)
+        return;
+    m_currentResult.imageQualityMetrics.push_back(metrics);
+}
+
+void WaterTestingSystem::compareWithReference(uint32_t frameIndex, const std::vector<uint8_t> &pixels,
+                                              const std::vector<uint8_t> &referenceImage, uint32_t width, uint32_t height)
+{
+    if (!m_isRunning || frameIndex > m_currentFrameIndex || pixels.size() != referenceImage.size() || pixels.empty())
+        return;
+
+    ImageQualityMetrics metrics = computeImageQuality(pixels, referenceImage, width, height);
+    metrics.frameIndex = frameIndex;
+    m_currentResult.referenceQualityMetrics.push_back(metrics);
+}
+
 ImageQualityMetrics WaterTestingSystem::computeImageQuality(
     const std::vector<uint8_t> &testImage,
     const std::vector<uint8_t> &referenceImage,
@@ -665,12 +1316,7 @@ TemporalMetrics WaterTestingSystem::analyzeTemporalStability(
         ssimValues.push_back(ssim);
 
         // Compute frame difference for flicker detection
-        double totalDiff = 0.0;
-        for (size_t j = 0; j < frames[i].size(); ++j)
-        {
-            totalDiff += std::abs(static_cast<int>(frames[i][j]) - static_cast<int>(frames[i - 1][j]));
-        }
-        diffValues.push_back(totalDiff / frames[i].size());
+        diffValues.push_back(ImageMetrics::meanAbsoluteDifference(frames[i - 1].data(), frames[i].data(), width, height, m_jobSystem));
     }
 
     metrics.avgFrameToFrameSSIM = calculateMean(ssimValues);
@@ -697,10 +1343,13 @@ AggregatedRunMetrics WaterTestingSystem::aggregateMetrics(
 
     AggregatedRunMetrics agg{};
     agg.configName = config.name;
+    agg.pipelinedTiming = config.pipelinedTiming;
 
     // Step 1: Remove warmup frames
     std::vector<double> frameTimes;
     std::vector<double> gpuTimes;
+    std::vector<double> latencies;
+    std::vector<double> cpuTimes;
 
     for (const auto &m : rawMetrics)
     {
@@ -708,6 +1357,8 @@ AggregatedRunMetrics WaterTestingSystem::aggregateMetrics(
         {
             frameTimes.push_back(m.frameTimeMs);
             gpuTimes.push_back(m.gpuTimeMs);
+            latencies.push_back(m.latencyMs);
+            cpuTimes.push_back(m.cpuTimeMs);
         }
     }
 
@@ -721,6 +1372,8 @@ AggregatedRunMetrics WaterTestingSystem::aggregateMetrics(
     // Step 3: Remove outliers (> mean + 5σ)
     std::vector<double> cleanFrameTimes;
     std::vector<double> cleanGpuTimes;
+    std::vector<double> cleanLatencies;
+    std::vector<double> cleanCpuTimes;
     int outlierCount = 0;
 
     for (size_t i = 0; i < frameTimes.size(); ++i)
@@ -729,6 +1382,8 @@ AggregatedRunMetrics WaterTestingSystem::aggregateMetrics(
         {
             cleanFrameTimes.push_back(frameTimes[i]);
             cleanGpuTimes.push_back(gpuTimes[i]);
+            cleanLatencies.push_back(latencies[i]);
+            cleanCpuTimes.push_back(cpuTimes[i]);
         }
         else
         {
@@ -768,9 +1423,104 @@ AggregatedRunMetrics WaterTestingSystem::aggregateMetrics(
     agg.medianGpuTime = calculateMedian(cleanGpuTimes);
     agg.stddevGpuTime = calculateStdDev(cleanGpuTimes, agg.meanGpuTime);
 
+    // Latency statistics: with frames in flight these exceed the frame time
+    agg.meanLatency = calculateMean(cleanLatencies);
+    agg.medianLatency = calculateMedian(cleanLatencies);
+    agg.latency99 = calculatePercentile(cleanLatencies, 99.0);
+    agg.meanCpuTime = calculateMean(cleanCpuTimes);
+
     return agg;
 }
 
+void WaterTestingSystem::RunningStats::add(double value)
+{
+    count++;
+    const double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+    min = count == 1 ? value : std::min(min, value);
+    max = count == 1 ? value : std::max(max, value);
+}
+
+AggregatedRunMetrics WaterTestingSystem::aggregateStreamedMetrics(const WaterTestConfig &config) const
+{
+    AggregatedRunMetrics agg{};
+    agg.configName = config.name;
+    agg.pipelinedTiming = config.pipelinedTiming;
+    agg.validFrameCount = static_cast<int>(m_live.frameTime.count);
+    agg.outlierCount = m_live.outliers;
+
+    // Medians and percentiles from the sketches, within QuantileSketch::kDefaultAccuracy
+    agg.meanFrameTime = m_live.frameTime.mean;
+    agg.medianFrameTime = m_live.frameTimeQuantiles.quantile(0.5);
+    agg.stddevFrameTime = m_live.frameTime.stddev();
+    agg.minFrameTime = m_live.frameTime.min;
+    agg.maxFrameTime = m_live.frameTime.max;
+    agg.percentile1Low = m_live.frameTimeQuantiles.quantile(0.99); // Worst 1%, as aggregateMetrics
+    agg.percentile99 = m_live.frameTimeQuantiles.quantile(0.99);
+    agg.meanFPS = m_live.fps.mean;
+    agg.medianFPS = m_live.fpsQuantiles.quantile(0.5);
+    agg.fps1Low = m_live.fpsQuantiles.quantile(0.01);
+    agg.meanGpuTime = m_live.gpuTime.mean;
+    agg.medianGpuTime = m_live.gpuTimeQuantiles.quantile(0.5);
+    agg.stddevGpuTime = m_live.gpuTime.stddev();
+    agg.meanLatency = m_live.latency.mean;
+    agg.medianLatency = m_live.latencyQuantiles.quantile(0.5);
+    agg.latency99 = m_live.latencyQuantiles.quantile(0.99);
+    agg.meanCpuTime = m_live.cpuTime.mean;
+    return agg;
+}
+
+LiveRunStatistics WaterTestingSystem::getLiveStatistics() const
+{
+    LiveRunStatistics stats;
+    stats.validFrameCount = m_live.frameTime.count;
+    stats.outlierCount = m_live.outliers;
+    stats.meanFrameTime = m_live.frameTime.mean;
+    stats.medianFrameTime = m_live.frameTimeQuantiles.quantile(0.5);
+    stats.percentile99 = m_live.frameTimeQuantiles.quantile(0.99);
+    stats.medianFPS = m_live.fpsQuantiles.quantile(0.5);
+    stats.fps1Low = m_live.fpsQuantiles.quantile(0.01);
+    stats.medianGpuTime = m_live.gpuTimeQuantiles.quantile(0.5);
+    return stats;
+}
+
+std::vector<ConfigSummaryMetrics> WaterTestingSystem::getConfigSummaries() const
+{
+    std::vector<ConfigSummaryMetrics> summaries;
+    for (const auto &[name, acc] : m_configSummaries)
+    {
+        ConfigSummaryMetrics s;
+        s.configName = name;
+        s.runCount = acc.runCount;
+        s.validFrameCount = acc.frameTimeQuantiles.count();
+        s.outlierCount = acc.outliers;
+        if (acc.frameTimeQuantiles.count() > 0)
+            s.meanFrameTime = acc.frameTimeSum / acc.frameTimeQuantiles.count();
+        if (acc.fpsQuantiles.count() > 0)
+            s.meanFPS = acc.fpsSum / acc.fpsQuantiles.count();
+        s.medianFrameTime = acc.frameTimeQuantiles.quantile(0.5);
+        s.percentile99 = acc.frameTimeQuantiles.quantile(0.99);
+        s.medianFPS = acc.fpsQuantiles.quantile(0.5);
+        s.fps1Low = acc.fpsQuantiles.quantile(0.01);
+        s.medianGpuTime = acc.gpuTimeQuantiles.quantile(0.5);
+        s.medianLatency = acc.latencyQuantiles.quantile(0.5);
+        s.latency99 = acc.latencyQuantiles.quantile(0.99);
+        summaries.push_back(s);
+    }
+    return summaries;
+}
+
+void WaterTestingSystem::setFrameLogPath(const std::string &path)
+{
+    m_frameLogPath = path;
+}
+
+void WaterTestingSystem::closeFrameLog()
+{
+    m_frameLog.reset();
+}
+
 // ============================================================================
 // DATA EXPORT (CSV / Excel Compatible)
 // ============================================================================
@@ -792,7 +1542,27 @@ void WaterTestingSystem::exportToCSV(const TestSuiteResult &results, const std::
     file << "Config,Run,ValidFrames,Outliers,MeanFPS,MedianFPS,1%LowFPS,"
          << "MeanFrameTime_ms,MedianFrameTime_ms,StdDevFrameTime_ms,"
          << "MinFrameTime_ms,MaxFrameTime_ms,99thPercentile_ms,"
-         << "MeanGpuTime_ms,MedianGpuTime_ms,StdDevGpuTime_ms\n";
+         << "MeanGpuTime_ms,MedianGpuTime_ms,StdDevGpuTime_ms,"
+         << "Timing,MeanLatency_ms,MedianLatency_ms,99thLatency_ms,MeanCpuTime_ms,"
+         << "MeanVertexInvocations,MeanClippingPrimitives,MeanFragmentInvocations,MeanComputeInvocations";
+    // Vendor counters as the first run that captured them named them; one device per suite
+    const std::vector<std::string> *counterNames = nullptr;
+    for (const auto &run : results.runs)
+    {
+        if (!run.gpuCounterNames.empty())
+        {
+            counterNames = &run.gpuCounterNames;
+            break;
+        }
+    }
+    if (counterNames)
+    {
+        for (const std::string &name : *counterNames)
+        {
+            file << ",Mean " << name;
+        }
+    }
+    file << "\n";
 
     for (const auto &run : results.runs)
     {
@@ -813,7 +1583,25 @@ void WaterTestingSystem::exportToCSV(const TestSuiteResult &results, const std::
              << a.percentile99 << ","
              << a.meanGpuTime << ","
              << a.medianGpuTime << ","
-             << a.stddevGpuTime << "\n";
+             << a.stddevGpuTime << ","
+             << (a.pipelinedTiming ? "Pipelined" : "Synced") << ","
+             << a.meanLatency << ","
+             << a.medianLatency << ","
+             << a.latency99 << ","
+             << a.meanCpuTime << ","
+             << std::setprecision(0)
+             << a.meanVertexInvocations << ","
+             << a.meanClippingPrimitives << ","
+             << a.meanFragmentInvocations << ","
+             << a.meanComputeInvocations;
+        if (counterNames)
+        {
+            for (size_t c = 0; c < counterNames->size(); c++)
+            {
+                file << "," << (c < a.meanGpuCounters.size() ? a.meanGpuCounters[c] : 0.0);
+            }
+        }
+        file << "\n";
     }
 
     file.close();
@@ -827,9 +1615,16 @@ void WaterTestingSystem::exportRunToCSV(const TestRunResult &run, const std::str
         return;
 
     // Per-frame data header
-    file << "FrameIndex,FrameTime_ms,GpuTime_ms,CpuTime_ms,Timestamp_ns,"
+    file << "FrameIndex,FrameTime_ms,GpuTime_ms,CpuTime_ms,Latency_ms,Timestamp_ns,"
+         << "WaterPass_ms,ScenePass_ms,PostProcess_ms,"
          << "CameraX,CameraY,CameraZ,CameraYaw,CameraPitch,"
-         << "IsWarmup,IsOutlier\n";
+         << "IsWarmup,IsOutlier,"
+         << "VertexInvocations,ClippingInvocations,ClippingPrimitives,FragmentInvocations,ComputeInvocations";
+    for (const std::string &name : run.gpuCounterNames)
+    {
+        file << "," << name;
+    }
+    file << "\n";
 
     for (const auto &m : run.frameMetrics)
     {
@@ -838,14 +1633,28 @@ void WaterTestingSystem::exportRunToCSV(const TestRunResult &run, const std::str
              << m.frameTimeMs << ","
              << m.gpuTimeMs << ","
              << m.cpuTimeMs << ","
+             << m.latencyMs << ","
              << m.timestampNs << ","
+             << m.waterPassTimeMs << ","
+             << m.scenePassTimeMs << ","
+             << m.postProcessTimeMs << ","
              << m.cameraPosition.x << ","
              << m.cameraPosition.y << ","
              << m.cameraPosition.z << ","
              << m.cameraYaw << ","
              << m.cameraPitch << ","
              << (m.isWarmupFrame ? 1 : 0) << ","
-             << (m.isOutlier ? 1 : 0) << "\n";
+             << (m.isOutlier ? 1 : 0) << ","
+             << m.pipelineStatistics.vertexInvocations << ","
+             << m.pipelineStatistics.clippingInvocations << ","
+             << m.pipelineStatistics.clippingPrimitives << ","
+             << m.pipelineStatistics.fragmentInvocations << ","
+             << m.pipelineStatistics.computeInvocations;
+        for (size_t c = 0; c < run.gpuCounterNames.size(); c++)
+        {
+            file << "," << (c < m.gpuCounters.size() ? m.gpuCounters[c] : 0.0);
+        }
+        file << "\n";
     }
 
     file.close();
@@ -869,7 +1678,11 @@ void WaterTestingSystem::appendRunToCSV(const TestRunResult &run, const std::str
              << "MeanFrameTime_ms,MedianFrameTime_ms,StdDevFrameTime_ms,"
              << "MinFrameTime_ms,MaxFrameTime_ms,99thPercentile_ms,"
              << "MeanGpuTime_ms,MedianGpuTime_ms,StdDevGpuTime_ms,"
-             << "Turbidity,Depth,LightMotion,RenderMode,SampleCount,CausticRays\n";
+             << "Turbidity,Depth,LightMotion,RenderMode,SampleCount,CausticRays,HalfResGodRays,SpecializedShaders,ShadowQuality,ShadowRoundRobin,PointLights,ClusteredLighting,Reflections,OffscreenInterval,DepthPrePass,FroxelVolumetrics,AsyncCompute,TiledFog,VariableRateShading,FramesInFlight,MSAA,AlternateFrames,Clock,CameraPath,AdaptiveWarmup,GpuCounters,Submission,OcclusionCulling,"
+             << "Timing,MeanLatency_ms,MedianLatency_ms,99thLatency_ms,MeanCpuTime_ms,"
+             << "IQFrames,AvgSSIM,AvgPSNR_dB,AvgDeltaE,"
+             << "MeanVertexInvocations,MeanClippingPrimitives,MeanFragmentInvocations,MeanComputeInvocations,"
+             << "RefFrames,RefSSIM,RefPSNR_dB\n";
     }
 
     const auto &a = run.aggregated;
@@ -898,7 +1711,46 @@ void WaterTestingSystem::appendRunToCSV(const TestRunResult &run, const std::str
          << static_cast<int>(c.lightMotion) << ","
          << static_cast<int>(c.renderingMode) << ","
          << c.sampleCount << ","
-         << c.causticRayCount << "\n";
+         << c.causticRayCount << ","
+         << (c.halfResGodRays ? 1 : 0) << ","
+         << (c.specializedShaders ? 1 : 0) << ","
+         << static_cast<int>(c.shadowQuality) << ","
+         << (c.shadowRoundRobin ? 1 : 0) << ","
+         << c.pointLightCount << ","
+         << (c.clusteredLighting ? 1 : 0) << ","
+         << static_cast<int>(c.reflections) << ","
+         << c.offscreenUpdateInterval << ","
+         << (c.depthPrePass ? 1 : 0) << ","
+         << (c.froxelVolumetrics ? 1 : 0) << ","
+         << (c.asyncEnabled ? 1 : 0) << ","
+         << (c.tilingEnabled ? 1 : 0) << ","
+         << (c.variableRateShading ? 1 : 0) << ","
+         << c.framesInFlight << ","
+         << c.msaaSamples << ","
+         << (c.alternateFrameDevices ? 1 : 0) << ","
+         << FrameClock::modeName(c.clockMode) << ","
+         << (c.cameraPathFile.empty() ? "Preset" : c.cameraPathFile) << ","
+         << (c.adaptiveWarmup ? 1 : 0) << ","
+         << (c.captureGpuCounters ? 1 : 0) << ","
+         << static_cast<int>(c.sceneSubmission) << ","
+         << (c.occlusionCulling ? 1 : 0) << ","
+         << (c.pipelinedTiming ? "Pipelined" : "Synced") << ","
+         << a.meanLatency << ","
+         << a.medianLatency << ","
+         << a.latency99 << ","
+         << a.meanCpuTime << ","
+         << a.imageQualityFrameCount << ","
+         << std::setprecision(4) << a.avgSSIM << ","
+         << std::setprecision(2) << a.avgPSNR << ","
+         << a.avgDeltaE << ","
+         << std::setprecision(0)
+         << a.meanVertexInvocations << ","
+         << a.meanClippingPrimitives << ","
+         << a.meanFragmentInvocations << ","
+         << a.meanComputeInvocations << ","
+         << a.referenceFrameCount << ","
+         << std::setprecision(4) << a.referenceSSIM << ","
+         << std::setprecision(2) << a.referencePSNR << "\n";
 
     file.close();
     std::cout << "[WaterTestingSystem] Appended run to: " << filepath << "\n";
@@ -911,7 +1763,7 @@ void WaterTestingSystem::exportSummaryToCSV(const std::vector<AggregatedRunMetri
     if (!file.is_open())
         return;
 
-    file << "Config,ValidFrames,MeanFPS,MedianFPS,1%LowFPS,MeanFrameTime_ms,StdDevFrameTime_ms\n";
+    file << "Config,ValidFrames,MeanFPS,MedianFPS,1%LowFPS,MeanFrameTime_ms,StdDevFrameTime_ms,MeanLatency_ms\n";
 
     for (const auto &m : metrics)
     {
@@ -922,12 +1774,45 @@ void WaterTestingSystem::exportSummaryToCSV(const std::vector<AggregatedRunMetri
              << m.medianFPS << ","
              << m.fps1Low << ","
              << m.meanFrameTime << ","
-             << m.stddevFrameTime << "\n";
+             << m.stddevFrameTime << ","
+             << m.meanLatency << "\n";
     }
 
     file.close();
 }
 
+void WaterTestingSystem::exportConfigSummaryToCSV(const std::vector<ConfigSummaryMetrics> &summaries,
+                                                  const std::string &filepath)
+{
+    std::ofstream file(filepath);
+    if (!file.is_open())
+        return;
+
+    file << "Config,Runs,ValidFrames,Outliers,MeanFPS,MedianFPS,1%LowFPS,MeanFrameTime_ms,MedianFrameTime_ms,"
+         << "99thPercentile_ms,MedianGpuTime_ms,MedianLatency_ms,99thLatency_ms\n";
+
+    for (const auto &s : summaries)
+    {
+        file << s.configName << ","
+             << s.runCount << ","
+             << s.validFrameCount << ","
+             << s.outlierCount << ","
+             << std::fixed << std::setprecision(2)
+             << s.meanFPS << ","
+             << s.medianFPS << ","
+             << s.fps1Low << ","
+             << s.meanFrameTime << ","
+             << s.medianFrameTime << ","
+             << s.percentile99 << ","
+             << s.medianGpuTime << ","
+             << s.medianLatency << ","
+             << s.latency99 << "\n";
+    }
+
+    file.close();
+    std::cout << "[WaterTestingSystem] Exported per-config summary to: " << filepath << "\n";
+}
+
 // ============================================================================
 // HELPER FUNCTIONS
 // ============================================================================
@@ -937,7 +1822,7 @@ double WaterTestingSystem::getTimestampMs(uint64_t timestamp) const
     return static_cast<double>(timestamp) * m_timestampPeriod / 1000000.0;
 }
 
-bool WaterTestingSystem::isOutlier(double value, double mean, double stddev, double threshold) const
+bool WaterTestingSystem::isOutlier(double value, double mean, double stddev, double threshold)
 {
     return std::abs(value - mean) > threshold * stddev;
 }
@@ -945,67 +1830,20 @@ bool WaterTestingSystem::isOutlier(double value, double mean, double stddev, dou
 double WaterTestingSystem::computeSSIM(const uint8_t *img1, const uint8_t *img2,
                                        uint32_t width, uint32_t height)
 {
-    // Simplified SSIM implementation (luminance channel only for speed)
-    const double C1 = 6.5025;  // (0.01 * 255)^2
-    const double C2 = 58.5225; // (0.03 * 255)^2
-
-    size_t pixelCount = width * height;
-    if (pixelCount == 0)
-        return 0.0;
-
-    // Assume RGBA format, use only R channel for speed
-    double mean1 = 0.0, mean2 = 0.0;
-    for (size_t i = 0; i < pixelCount; ++i)
-    {
-        mean1 += img1[i * 4];
-        mean2 += img2[i * 4];
-    }
-    mean1 /= pixelCount;
-    mean2 /= pixelCount;
-
-    double var1 = 0.0, var2 = 0.0, covar = 0.0;
-    for (size_t i = 0; i < pixelCount; ++i)
-    {
-        double d1 = img1[i * 4] - mean1;
-        double d2 = img2[i * 4] - mean2;
-        var1 += d1 * d1;
-        var2 += d2 * d2;
-        covar += d1 * d2;
-    }
-    var1 /= pixelCount;
-    var2 /= pixelCount;
-    covar /= pixelCount;
-
-    double ssim = ((2 * mean1 * mean2 + C1) * (2 * covar + C2)) /
-                  ((mean1 * mean1 + mean2 * mean2 + C1) * (var1 + var2 + C2));
-
-    return ssim;
+    // Windowed SSIM on luminance (ImageMetrics.h)
+    return ImageMetrics::ssim(img1, img2, width, height, m_jobSystem);
 }
 
 double WaterTestingSystem::computePSNR(const uint8_t *img1, const uint8_t *img2,
                                        uint32_t width, uint32_t height)
 {
-    double mse = computeMSE(img1, img2, width, height);
-    if (mse < 1e-10)
-        return 100.0; // Perfect match
-    return 10.0 * std::log10(255.0 * 255.0 / mse);
+    return ImageMetrics::psnrFromMse(computeMSE(img1, img2, width, height));
 }
 
 double WaterTestingSystem::computeMSE(const uint8_t *img1, const uint8_t *img2,
                                       uint32_t width, uint32_t height)
 {
-    size_t pixelCount = width * height * 4; // RGBA
-    if (pixelCount == 0)
-        return 0.0;
-
-    double sum = 0.0;
-    for (size_t i = 0; i < pixelCount; ++i)
-    {
-        double diff = static_cast<double>(img1[i]) - static_cast<double>(img2[i]);
-        sum += diff * diff;
-    }
-
-    return sum / pixelCount;
+    return ImageMetrics::meanSquaredError(img1, img2, width, height, m_jobSystem);
 }
 
 double WaterTestingSystem::calculateMean(const std::vector<double> &values) const
@@ -1019,13 +1857,16 @@ double WaterTestingSystem::calculateMedian(std::vector<double> values) const
 {
     if (values.empty())
         return 0.0;
-    std::sort(values.begin(), values.end());
+    // Partial selection instead of a full sort
     size_t n = values.size();
+    auto upper = values.begin() + n / 2;
+    std::nth_element(values.begin(), upper, values.end());
     if (n % 2 == 0)
     {
-        return (values[n / 2 - 1] + values[n / 2]) / 2.0;
+        // The lower middle is the largest value left of the upper one
+        return (*std::max_element(values.begin(), upper) + *upper) / 2.0;
     }
-    return values[n / 2];
+    return *upper;
 }
 
 double WaterTestingSystem::calculateStdDev(const std::vector<double> &values, double mean) const
@@ -1045,8 +1886,8 @@ double WaterTestingSystem::calculatePercentile(std::vector<double> values, doubl
 {
     if (values.empty())
         return 0.0;
-    std::sort(values.begin(), values.end());
     size_t index = static_cast<size_t>((percentile / 100.0) * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
     return values[index];
 }
 
@@ -1122,13 +1963,33 @@ void TestReportGenerator::generateTradeOffCurveData(
         return;
 
     // For trade-off curves: quality metric vs performance
-    file << "Config,SampleCount,CausticRays,MeanFPS,FrameTime_ms,SSIM,PSNR\n";
+    file << "Config,SampleCount,CausticRays,HalfResGodRays,SpecializedShaders,ShadowQuality,ShadowRoundRobin,PointLights,ClusteredLighting,Reflections,OffscreenInterval,DepthPrePass,FroxelVolumetrics,AsyncCompute,TiledFog,VariableRateShading,FramesInFlight,MSAA,AlternateFrames,Clock,CameraPath,AdaptiveWarmup,GpuCounters,MeanFPS,FrameTime_ms,SSIM,PSNR\n";
 
     for (const auto &r : results)
     {
         file << r.config.name << ","
              << r.config.sampleCount << ","
              << r.config.causticRayCount << ","
+             << (r.config.halfResGodRays ? 1 : 0) << ","
+             << (r.config.specializedShaders ? 1 : 0) << ","
+             << static_cast<int>(r.config.shadowQuality) << ","
+             << (r.config.shadowRoundRobin ? 1 : 0) << ","
+             << r.config.pointLightCount << ","
+             << (r.config.clusteredLighting ? 1 : 0) << ","
+             << static_cast<int>(r.config.reflections) << ","
+             << r.config.offscreenUpdateInterval << ","
+             << (r.config.depthPrePass ? 1 : 0) << ","
+             << (r.config.froxelVolumetrics ? 1 : 0) << ","
+             << (r.config.asyncEnabled ? 1 : 0) << ","
+             << (r.config.tilingEnabled ? 1 : 0) << ","
+             << (r.config.variableRateShading ? 1 : 0) << ","
+             << r.config.framesInFlight << ","
+             << r.config.msaaSamples << ","
+             << (r.config.alternateFrameDevices ? 1 : 0) << ","
+             << FrameClock::modeName(r.config.clockMode) << ","
+             << (r.config.cameraPathFile.empty() ? "Preset" : r.config.cameraPathFile) << ","
+             << (r.config.adaptiveWarmup ? 1 : 0) << ","
+             << (r.config.captureGpuCounters ? 1 : 0) << ","
              << std::fixed << std::setprecision(2)
              << r.aggregated.meanFPS << ","
              << r.aggregated.meanFrameTime << ","
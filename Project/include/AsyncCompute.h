@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "Command/CommandPool.h"
+#include "TimelineSemaphore.h"
+
+// ============================================================================
+// ASYNC COMPUTE
+// ============================================================================
+// Water simulation and volume work on a compute-only queue family, running
+// alongside the rasterization that does not depend on it.
+//
+//  - Per frame, the compute work (OceanFFT, OceanCaustics, FroxelVolume, in
+//    their computeQueue variants) is recorded into computeCommands() and
+//    submitted before the frame's graphics work.
+//  - The graphics work is split in two submissions (RenderGraph::
+//    splitSubmission): the first, shadows and whatever else reads nothing the
+//    compute queue writes, runs concurrently; the second waits for the compute
+//    timeline at the stages that consume its results. Its command buffer is
+//    graphicsCommands().
+//  - Every graphics frame signals the renderer's frame timeline when it
+//    completes, and the next compute submission waits for it: last frame's
+//    draws still read the images the compute queue is about to overwrite.
+//
+// The images both queues touch are created CONCURRENT over both families
+// (getQueueFamilies), so no ownership transfers are needed. Two timeline
+// semaphores carry the whole ordering; waiting for a frame's value covers its
+// compute too, which the graphics submission waited for.
+
+class AsyncCompute
+{
+public:
+    // Needs a compute family without graphics (VkUtils::QueueFamilyIndices::computeFamily).
+    // frameTimeline: signalled by every graphics frame (TimelineSemaphore::nextValue), outlives this
+    AsyncCompute(VkDevice device, uint32_t graphicsFamily, uint32_t computeFamily, VkQueue computeQueue, uint32_t frameCount,
+                 const TimelineSemaphore &frameTimeline);
+    ~AsyncCompute(); // The device must be idle
+
+    AsyncCompute(const AsyncCompute &) = delete;
+    AsyncCompute &operator=(const AsyncCompute &) = delete;
+
+    // Graphics and compute, for images created CONCURRENT between them (VkUtils::SetImageSharing)
+    const std::vector<uint32_t> &getQueueFamilies() const { return m_queueFamilies; }
+
+    // Once the frame slot's last value has been reached: nothing is recorded for it yet
+    void beginFrame(uint32_t frameIndex);
+    // The frame's buffers, begun on first use
+    VkCommandBuffer computeCommands();
+    VkCommandBuffer graphicsCommands(); // Graphics work after the split
+    bool hasComputeWork() const { return m_computeBegun; }
+    bool hasGraphicsWork() const { return m_graphicsBegun; }
+
+    // Ends and submits the compute work recorded this frame, after last frame's graphics work (the
+    // frame timeline's last value: call before this frame takes its own). Returns false, submitting
+    // nothing, if none was recorded
+    bool submitCompute();
+    // Ends the graphics work after the split; the graphics submission waits for getComputeValue() of
+    // getComputeTimeline()
+    void endGraphics();
+
+    VkSemaphore getComputeTimeline() const { return m_computeTimeline.getHandle(); }
+    uint64_t getComputeValue() const { return m_computeTimeline.getLastValue(); }
+
+private:
+    static void begin(VkCommandBuffer cmd);
+
+    VkQueue m_computeQueue;
+    std::vector<uint32_t> m_queueFamilies;
+
+    CommandPool m_computePool;
+    CommandPool m_graphicsPool;
+    std::vector<CommandBuffer> m_computeBuffers; // One per frame in flight
+    std::vector<CommandBuffer> m_graphicsBuffers;
+    uint32_t m_frameIndex = 0;
+    bool m_computeBegun = false;
+    bool m_graphicsBegun = false;
+
+    TimelineSemaphore m_computeTimeline; // One value per compute submission
+    const TimelineSemaphore &m_frameTimeline;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// ============================================================================
+// ATMOSPHERE SKY
+// ============================================================================
+// A physically based sky that follows the sun, in place of the static
+// skybox cube (Hillaire's LUT approach, all in atmosphere.comp):
+//
+//  - Transmittance LUT (kTransmittanceWidth x kTransmittanceHeight): how much
+//    light survives from a height towards a direction up to space.
+//  - Multiple scattering LUT (kMultiScatterSize square): the light every
+//    further bounce adds, per unit of sun and per height and sun angle.
+//  - The sky cube (kCubeSize faces): single scattering raymarched per texel
+//    with the sun's transmittance from the first LUT, plus the second LUT.
+//
+// Both LUTs depend on the atmosphere only and are computed once, with the
+// first update. The cube depends on the sun: update() re-renders it only when
+// the sun has turned more than kUpdateAngle since the last time, so a static
+// sun costs one dot product a frame. The cube replaces the skybox for the sky
+// draws (SkyboxPipeline, main and reflection passes); it is written in GENERAL
+// and stays there.
+
+class AtmosphereSky
+{
+public:
+    static constexpr uint32_t kTransmittanceWidth = 256;
+    static constexpr uint32_t kTransmittanceHeight = 64;
+    static constexpr uint32_t kMultiScatterSize = 32;
+    static constexpr uint32_t kCubeSize = 128;
+    static constexpr VkFormat kFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr float kUpdateAngle = 0.002f; // Radians the sun turns before the cube is re-rendered
+
+    explicit AtmosphereSky(VkDevice device);
+    ~AtmosphereSky(); // The device must be idle
+
+    AtmosphereSky(const AtmosphereSky &) = delete;
+    AtmosphereSky &operator=(const AtmosphereSky &) = delete;
+
+    // The cube is out of date for this sun ('toSun' normalised)
+    bool needsUpdate(const glm::vec3 &toSun) const;
+    // Outside any render pass, before the frame's sky draws; computes the LUTs the first time
+    void recordUpdate(VkCommandBuffer cmd, const glm::vec3 &toSun);
+
+    // Scale of the sky's radiance before the roll-off to display range
+    void setExposure(float exposure);
+    float getExposure() const { return m_exposure; }
+
+    // Cube view, GENERAL layout
+    VkImageView getCubeView() const { return m_cubeView; }
+    VkSampler getSampler() const { return m_sampler; }
+
+    // Shader hot reload; everything is recomputed with the next update
+    void createPipelines();
+
+private:
+    static constexpr uint32_t kGroupSize = 8; // atmosphere.comp local size
+
+    struct AtmospherePush
+    {
+        glm::vec4 toSun;
+        float exposure;
+    };
+
+    void createImages();
+    void createDescriptors();
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    float m_exposure = 10.0f;
+    bool m_lutsValid = false;
+    bool m_cubeValid = false;
+    glm::vec3 m_cubeSun{0.0f}; // The sun the cube was rendered for
+
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_transmittancePipeline = VK_NULL_HANDLE;
+    VkPipeline m_multiScatterPipeline = VK_NULL_HANDLE;
+    VkPipeline m_skyPipeline = VK_NULL_HANDLE;
+
+    VkImage m_transmittance = VK_NULL_HANDLE;
+    VkImageView m_transmittanceView = VK_NULL_HANDLE;
+    VkImage m_multiScatter = VK_NULL_HANDLE;
+    VkImageView m_multiScatterView = VK_NULL_HANDLE;
+    VkImage m_cube = VK_NULL_HANDLE;
+    VkImageView m_cubeView = VK_NULL_HANDLE;      // Sampled
+    VkImageView m_cubeArrayView = VK_NULL_HANDLE; // Storage, six layers
+};
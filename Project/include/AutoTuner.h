@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// AUTO TUNER
+// ============================================================================
+// Searches the OPT rendering mode's quality settings, online, for the best
+// image that fits a GPU frame-time budget on this device. The renderer holds
+// the camera and the clock still and renders the settings getLevels() names.
+// The tuner times them from the GPU profiler's frame scope, and rates them
+// by the GPU image compare's SSIM against a reference frame rendered at the
+// highest settings.
+//
+//  - Each knob is a ladder of values, highest quality first. The search
+//    starts with every knob at the top. While over budget, it tries stepping
+//    each knob down one level from the current settings. It accepts the
+//    in-budget trial with the best SSIM. If no trial fits, it accepts the
+//    one that saves the most time per SSIM lost, and searches on from
+//    there. The search stops over budget only when every knob is at its
+//    bottom or no step saves time.
+//  - A trial renders kSettleFrames first, then measures kMeasureFrames.
+//    The settle frames cover the profiler's and the image compare's delay,
+//    so every measured GPU time and SSIM belongs to the trial's settings.
+//    A trial with no GPU time yet measures on, up to kMaxMeasureFrames; one
+//    that still has none fails the search (isFailed) rather than passing
+//    as 0 ms, and nothing is cached.
+//  - The result is cached per device (loadPreset/savePreset), keyed by the
+//    GPU and driver version. Every later start on that machine applies it
+//    without searching again.
+
+class AutoTuner
+{
+public:
+    static constexpr uint32_t kSettleFrames = 8;
+    static constexpr uint32_t kMeasureFrames = 16;
+    static constexpr uint32_t kMaxMeasureFrames = kMeasureFrames * 8; // Waiting for a first GPU time
+    static constexpr double kMinSsimLoss = 1e-3; // Floor of the per-step quality cost
+
+    struct Knob
+    {
+        const char *name;
+        std::vector<double> values; // Highest quality first
+    };
+
+    // Per knob of knobs(), an index into its values
+    using Levels = std::vector<uint32_t>;
+
+    struct Preset
+    {
+        double budgetMs = 0.0;
+        Levels levels;
+        double gpuMs = 0.0;
+        double ssim = 1.0; // Against the top settings
+        bool metBudget = false;
+    };
+
+    // msaaSamples, resolutionScale, offscreenUpdateInterval, halfResGodRays, godSampleScale, causticRayCount
+    static const std::vector<Knob> &knobs();
+    static double value(const Levels &levels, size_t knob) { return knobs()[knob].values[levels[knob]]; }
+    static std::string describe(const Levels &levels);
+
+    explicit AutoTuner(double budgetMs);
+
+    // The settings to render from now on; true once after each change
+    const Levels &getLevels() const { return m_trial; }
+    bool takeLevelsChanged();
+    // The next frame rendered should become the image compare's reference; true once
+    bool takeReferenceRequest();
+
+    // Once per completed frame, with its GPU time (<= 0: no timestamps for it, not a sample)
+    void addFrame(double gpuMs);
+    // Each image compare result against the reference
+    void addQuality(double ssim);
+
+    bool isDone() const { return m_done; }
+    // Done without a result: a trial got no GPU times (no timestamp support). The top settings are back
+    bool isFailed() const { return m_failed; }
+    const Preset &getResult() const { return m_result; }
+    uint32_t getTrialCount() const { return m_trialCount; }
+    double getBudgetMs() const { return m_result.budgetMs; }
+
+    // The device's preset from the cache file; nullopt if it has none (or the file is missing)
+    static std::optional<Preset> loadPreset(const std::string &filePath, const std::string &deviceKey);
+    // Adds or replaces the device's preset, keeping the other devices'
+    static bool savePreset(const std::string &filePath, const std::string &deviceKey, const Preset &preset);
+
+private:
+    struct Trial
+    {
+        Levels levels;
+        double gpuMs = 0.0;
+        double ssim = 0.0;
+    };
+
+    void startTrial(const Levels &levels);
+    void finishTrial();
+    // Candidates one step down from m_current; finishes the search when there are none
+    void nextRound();
+    void decide();
+    void finish(bool metBudget);
+    void fail();
+
+    Levels m_trial;
+    bool m_levelsChanged = true;
+    bool m_baseline = true; // The trial at the top settings
+    bool m_referencePending = false;
+    bool m_measuring = false;
+    uint32_t m_frames = 0;
+    std::vector<double> m_gpuSamples;
+    std::vector<double> m_ssimSamples;
+
+    Trial m_current;
+    std::vector<Trial> m_candidates; // This round's, measured up to m_candidateIndex
+    size_t m_candidateIndex = 0;
+    uint32_t m_trialCount = 0;
+    bool m_done = false;
+    bool m_failed = false;
+    Preset m_result;
+};
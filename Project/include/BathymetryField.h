@@ -0,0 +1,181 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "UploadContext.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// BATHYMETRY FIELD
+// ============================================================================
+// The sea floor's elevation from survey data, streamed around the camera so
+// that heightmaps of many kilometres (and gigabytes) never have to be loaded
+// whole. The source is a .bathy file (cook()): 16-bit tiles of kTileSamples
+// square, a quadtree pyramid of them from the finest level up to a single
+// tile for the whole field. Neighbouring tiles repeat their shared edge, so
+// each tile filters on its own. The file is memory mapped: a tile costs I/O
+// only when it is streamed in.
+//
+//  - Tiles are resident in an atlas (an R16_UNORM array, one tile per
+//    layer, kAtlasSlots layers) listed by a page table: an atlas layer or
+//    kNotResident per tile of every level. The coarsest tile is always
+//    resident, so every point of the field has some height.
+//  - 3d_shader_lod.vert picks the level from the distance to the camera,
+//    blending two levels like the CDLOD morph, and falls back to coarser
+//    levels where a tile is not resident. Both depend on the world position
+//    only, so vertices shared by two CDLOD tiles agree and no skirts are
+//    needed.
+//  - update() wants every tile within the distance its level is sampled at,
+//    coarse levels first, then nearest first; at most kUploadsPerUpdate tiles
+//    go up through the UploadContext ring per frame. A tile joins the page
+//    table once its upload has completed. Tiles no longer wanted are evicted
+//    least recently wanted first when the atlas is full, and their layer is
+//    reused 'frameCount' updates later, when no frame can still read it.
+//  - When the page table changed, recordPageUpload() writes it whole into
+//    the frame's host-visible copy and copies that to the device buffer.
+//
+// Without a file the field is flat and the floor keeps the grid's height.
+
+// Mirrors BathymetryPages in 3d_shader_lod.vert (std430), followed by the page table
+struct BathymetryPageHeader
+{
+    glm::vec4 field;     // xy: world XZ of the min corner, z: world size, w: tiles per side at level 0
+    glm::vec4 elevation; // x: elevation at sample 0, y: range over the samples, z: samples per tile side, w: levels
+    glm::vec4 detail;    // x: distance where level 0 gives way to level 1, y: 1 with a field, 0 when flat
+    glm::uvec4 levelOffsets[4]; // Of each level's first tile in the page table, finest first
+};
+
+class BathymetryField
+{
+public:
+    static constexpr uint32_t kTileCells = 64;
+    static constexpr uint32_t kTileSamples = kTileCells + 1;
+    static constexpr uint32_t kMaxLevels = 16;
+    static constexpr uint32_t kAtlasSlots = 384;
+    static constexpr uint32_t kUploadsPerUpdate = 8;
+    static constexpr uint32_t kNotResident = 0xFFFFFFFFu;
+    static constexpr float kDetailSamples = 48.0f; // Level 0 is sampled out to this many of its sample spacings
+    static constexpr uint32_t kAtlasBinding = 16;  // Water set: the atlas
+    static constexpr uint32_t kPagesBinding = 17;  // Water set: header and page table
+
+    struct CookSettings
+    {
+        float sampleSpacing = 1.0f; // World units between source samples
+        float minElevation = -100.0f; // At sample value 0
+        float maxElevation = 0.0f;    // At sample value 65535
+    };
+
+    // Writes a .bathy file from a square raw heightmap ('width' x 'width' little-endian uint16), centred on
+    // the origin. The source is memory mapped, so it may be larger than memory. Throws on failure.
+    static void cook(const std::string &rawPath, uint32_t width, const CookSettings &settings, const std::string &outPath);
+
+    // A missing 'path' gives the flat field; a file that is not a valid .bathy throws
+    BathymetryField(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, const std::string &path);
+    ~BathymetryField(); // The device must be idle
+
+    BathymetryField(const BathymetryField &) = delete;
+    BathymetryField &operator=(const BathymetryField &) = delete;
+
+    bool isLoaded() const { return m_file.isOpen(); }
+
+    // Once per frame, after the frame's fence: adopts finished tiles, streams the next ones
+    void update(const glm::vec3 &cameraPos);
+    // The page table changed since the device last got it
+    bool needsPageUpload() const { return m_deviceVersion != m_version; }
+    // Outside any render pass, before the frame's floor draws
+    void recordPageUpload(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    // Points the water set's kAtlasBinding and kPagesBinding at the atlas and the page table
+    void writeDescriptors(VkDescriptorSet waterSet) const;
+
+    uint32_t getResidentTileCount() const { return static_cast<uint32_t>(m_resident.size()); }
+    uint32_t getPendingTileCount() const { return static_cast<uint32_t>(m_pending.size()); }
+
+private:
+    // On disk: the header, then a uint64 offset per tile (level-major, rows of tiles; 0: absent), then the tiles
+    struct FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t tileSamples;
+        uint32_t levelCount;
+        uint32_t tilesPerSide; // At level 0
+        uint32_t reserved;
+        float originX;
+        float originZ;
+        float size;
+        float minElevation;
+        float elevationRange;
+        float padding;
+    };
+    static constexpr uint32_t kFileVersion = 1;
+
+    struct Frame
+    {
+        VkBuffer staging = VK_NULL_HANDLE; // Host-visible header + page table
+        void *mapped = nullptr;
+    };
+
+    struct PendingTile
+    {
+        uint32_t tile;
+        uint32_t slot;
+        UploadTicket ticket;
+    };
+
+    struct WantedTile
+    {
+        uint32_t rank; // Coarsest level first
+        float distance;
+        uint32_t tile;
+    };
+
+    struct RetiredSlot
+    {
+        uint32_t slot;
+        uint64_t update; // Free from this update on
+    };
+
+    void openFile(const std::string &path);
+    void createResources(VkPhysicalDevice physicalDevice);
+    uint32_t tilesPerSide(uint32_t level) const { return std::max(m_tilesPerSide >> level, 1u); }
+    uint32_t tileIndex(uint32_t level, uint32_t x, uint32_t z) const { return m_levelOffsets[level] + z * tilesPerSide(level) + x; }
+    const uint16_t *tileSamples(uint32_t tile) const; // nullptr when absent
+    // Records the copy of 'tile' into 'slot' into the open upload batch
+    void stageTile(uint32_t tile, uint32_t slot);
+    // Drops the least recently wanted tile not wanted now; its layer comes free 'frameCount' updates later
+    bool evictOne();
+    void writePageTable(void *dst) const;
+
+    VkDevice m_device;
+    MappedFile m_file;
+    BathymetryPageHeader m_header{};
+    uint32_t m_levelCount = 1;
+    uint32_t m_tilesPerSide = 1;
+    uint32_t m_tileCount = 1; // Over all levels
+    std::vector<uint32_t> m_levelOffsets;
+    const uint64_t *m_tileOffsets = nullptr; // Into the mapped file
+
+    // CPU page table (the device copy's entries) and when each tile was last wanted
+    std::vector<uint32_t> m_pages;
+    std::vector<uint64_t> m_lastWanted;
+    std::vector<uint32_t> m_resident; // Tiles in the atlas
+    std::vector<PendingTile> m_pending;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<RetiredSlot> m_retired;
+    std::vector<WantedTile> m_wanted; // Scratch
+    uint64_t m_updateCount = 0;
+    uint64_t m_version = 1;
+    uint64_t m_deviceVersion = 0;
+
+    std::vector<Frame> m_frames;
+    VkDeviceSize m_pageBytes = 0;
+    VkBuffer m_pageBuffer = VK_NULL_HANDLE; // Device-local header + page table
+    VkImage m_atlas = VK_NULL_HANDLE;
+    VkImageView m_atlasView = VK_NULL_HANDLE;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// BINDLESS TABLE
+// ============================================================================
+// One global descriptor set of large arrays (descriptor indexing, core in
+// Vulkan 1.2), bound once per command buffer at set kSetIndex. Shaders address
+// its entries by index, passed in push constants, instead of each material or
+// pass owning a set that has to be rewritten whenever a view changes:
+//
+//   binding 0: combined image samplers, sampler2D textures[]
+//   binding 1: storage buffers, readonly buffer { vec4 data[]; } buffers[]
+//
+// The bindings are UPDATE_AFTER_BIND and PARTIALLY_BOUND, so adding an entry
+// never waits on the GPU: a new entry goes into a free slot no recorded frame
+// reads. Removed slots are reused 'framesInFlight' beginFrame() calls later,
+// once no frame in flight can still index them; replacing a view is therefore
+// add + remove, and the caller pushes the new index from then on.
+//
+// Not thread-safe: add, remove and beginFrame from the render thread.
+
+class BindlessTable
+{
+public:
+    static constexpr uint32_t kSetIndex = 2; // After the scene (0) and water (1) sets
+    static constexpr uint32_t kTextureBinding = 0;
+    static constexpr uint32_t kBufferBinding = 1;
+    static constexpr uint32_t kMaxTextures = 4096;
+    static constexpr uint32_t kMaxBuffers = 1024;
+
+    // Vulkan 1.2 with runtime descriptor arrays, partially bound and update-after-bind
+    // sampled images and storage buffers, and room for the arrays above
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+    // Sets the features the table uses; chain into VkDeviceCreateInfo
+    static void enableFeatures(VkPhysicalDeviceVulkan12Features &features);
+
+    BindlessTable(VkDevice device, uint32_t framesInFlight);
+    ~BindlessTable(); // The device must be idle
+
+    BindlessTable(const BindlessTable &) = delete;
+    BindlessTable &operator=(const BindlessTable &) = delete;
+
+    // Index for the shaders. Throws when the array is full.
+    uint32_t addTexture(VkImageView view, VkSampler sampler,
+                        VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+    void removeTexture(uint32_t index);
+    void removeBuffer(uint32_t index);
+
+    // Once per frame, after the frame's fence: recycles the slots no frame in flight can read
+    void beginFrame();
+
+    VkDescriptorSetLayout getLayout() const { return m_layout; }
+    VkDescriptorSet getSet() const { return m_set; }
+
+private:
+    struct Slots
+    {
+        uint32_t capacity = 0;
+        uint32_t next = 0;           // Never used below this
+        std::vector<uint32_t> free;  // Recycled
+        std::deque<std::pair<uint32_t, uint64_t>> retired; // Index, frame it becomes free
+
+        uint32_t allocate(const char *kind);
+    };
+
+    void retire(Slots &slots, uint32_t index);
+
+    VkDevice m_device;
+    uint32_t m_framesInFlight;
+    uint64_t m_frame = 0;
+
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkDescriptorPool m_pool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+
+    Slots m_textures;
+    Slots m_buffers;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include "DrawKey.h"
+#include "GpuMesh.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// ============================================================================
+// CDLOD GRID
+// ============================================================================
+// Camera-centred level of detail for the flat planes (water surface, ocean
+// bottom), after Strugar's Continuous Distance-Dependent LOD. A quadtree over
+// the plane is walked every frame: a node is split while the camera is within
+// the range of the next finer level, so cells double in size with every
+// range. Each selected node is one instance of a single shared tile of
+// kTileCells x kTileCells quads; the vertex count stays constant however large
+// the plane gets.
+//
+// Near the outer edge of its range a tile morphs its odd vertices onto the
+// next coarser grid, so where two levels meet both sides lie on the same
+// vertices: no cracks and no popping. The morph factor depends only on the
+// distance to the camera, so the CPU selection and the vertex shader agree.
+//
+// Tiles are per-instance vertex data (binding 1); the tile's own vertices
+// (CdlodVertex, 4 bytes) hold only their cell coordinates and are placed by
+// the vertex shader. Each instanced draw's tiles are sorted by distance to the
+// camera: front to back for the opaque sea floor, back to front for the
+// blended water surface.
+//
+// With a frustum, select() also culls: a node whose bounds lie outside it is
+// dropped with everything under it, so the quadtree walk stops there and the
+// vertex work follows the visible part of the plane only. The bounds are the
+// node's square padded by the caller's margin (horizontal, vertical), which
+// must cover whatever the vertex shader displaces the plane by.
+
+// Shared tile vertex: cell corner, 0..kTileCells on each axis (R16G16_UINT)
+struct Frustum;
+
+struct CdlodVertex
+{
+    uint16_t x;
+    uint16_t z;
+};
+
+// Mirrors the instance attributes of water.vert and 3d_shader_lod.vert
+struct CdlodTile
+{
+    glm::vec4 node;  // xy: world XZ of the min corner, z: node size, w: plane height
+    glm::vec4 morph; // x: end / (end - start), y: 1 / (end - start), z: 1 / plane size, w: level
+};
+
+class CdlodGrid
+{
+public:
+    static constexpr uint32_t kTileCells = 32; // water.vert / 3d_shader_lod.vert LOD_TILE_CELLS
+    static constexpr uint32_t kInstanceBinding = 1;
+    static constexpr uint32_t kInstanceFirstLocation = 3;
+
+    // 'size' square centred on the origin at 'height'; 'levels' quadtree depths, the finest node
+    // spans size / 2^(levels - 1)
+    CdlodGrid(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, float size, float height,
+              uint32_t levels);
+    ~CdlodGrid(); // The device must be idle
+
+    CdlodGrid(const CdlodGrid &) = delete;
+    CdlodGrid &operator=(const CdlodGrid &) = delete;
+
+    static VkVertexInputBindingDescription getVertexBindingDescription();
+    static VkVertexInputAttributeDescription getVertexAttributeDescription();
+    static VkVertexInputBindingDescription getInstanceBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 2> getInstanceAttributeDescriptions();
+
+    // Writes the frame's tiles in 'order'; the frame's fence must have signalled. Nodes entirely
+    // beyond 'viewDistance' (the far plane) are dropped, and with a 'frustum' those outside it.
+    // 'margin': x pads the nodes' bounds horizontally, y vertically
+    void select(uint32_t frameIndex, const glm::vec3 &cameraPos, float viewDistance,
+                DrawKey::Order order = DrawKey::Order::FrontToBack, const Frustum *frustum = nullptr,
+                const glm::vec2 &margin = glm::vec2(0.0f));
+
+    // Inside the render pass, with a pipeline taking the instance binding
+    void draw(VkCommandBuffer cmd, uint32_t frameIndex) const;
+
+    // Instances drawn by the frame, quarters included
+    uint32_t getTileCount(uint32_t frameIndex) const
+    {
+        return m_frames[frameIndex].tileCount + m_frames[frameIndex].quarterCount;
+    }
+    // Nodes the frame's selection dropped outside the frustum
+    uint32_t getCulledCount(uint32_t frameIndex) const { return m_frames[frameIndex].culledCount; }
+
+private:
+    static constexpr uint32_t kMaxTiles = 1024;
+    static constexpr float kRangeScale = 3.0f;  // Range of a level in node sizes; keeps morphs within one level
+    static constexpr float kMorphStart = 0.75f; // Fraction of the range where the morph begins
+
+    struct FrameResources
+    {
+        VkBuffer tileBuffer = VK_NULL_HANDLE; // Host-visible per-instance data
+        CdlodTile *tiles = nullptr;
+        uint32_t tileCount = 0;    // Full tiles, from tiles[0]
+        uint32_t quarterCount = 0; // Min-corner quarters, from tiles[kMaxTiles]
+        uint32_t culledCount = 0;
+    };
+
+    // False when the node lies outside its level's range, so the caller covers it instead
+    bool selectNode(FrameResources &frame, const glm::vec2 &origin, float size, uint32_t level,
+                    const glm::vec3 &cameraPos, float viewDistance);
+    // 'size' is the node's; a quarter covers the min-corner quarter of a node of that size at 'origin'
+    void addTile(FrameResources &frame, const glm::vec2 &origin, float size, uint32_t level, bool quarter);
+    float distanceTo(const glm::vec2 &origin, float size, const glm::vec3 &cameraPos) const;
+    bool isCulled(const glm::vec2 &origin, float size) const;
+    // Sorts m_selection[first, first + count) by distance and writes it to 'out'
+    void writeSorted(CdlodTile *out, uint32_t first, uint32_t count, bool quarter, const glm::vec3 &cameraPos,
+                     DrawKey::Order order);
+
+    float m_size;
+    float m_height;
+    uint32_t m_levels;
+    std::vector<float> m_ranges; // Per level, finest first
+
+    std::unique_ptr<GpuMesh> m_tile;
+    uint32_t m_indexCount = 0; // Full tile; the quarter's indices follow
+
+    std::vector<FrameResources> m_frames;
+
+    // The current select()'s
+    const Frustum *m_frustum = nullptr;
+    glm::vec2 m_margin = glm::vec2(0.0f);
+
+    // Tiles as selected, in the per-frame buffer's layout, before they are sorted into it
+    std::vector<CdlodTile> m_selection;
+    std::vector<DrawKey::Entry> m_sortEntries;
+    std::vector<DrawKey::Entry> m_sortScratch;
+};
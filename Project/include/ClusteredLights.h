@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+struct LightInfo;
+
+// ============================================================================
+// CLUSTERED LIGHTS
+// ============================================================================
+// Clustered forward shading for the point lights (divers' torches,
+// bioluminescence). The main camera's frustum is cut into a 16x9 grid of
+// screen tiles times 24 depth slices, exponentially spaced so clusters stay
+// roughly cubic. Every frame a compute pass tests each light's sphere against
+// each cluster's view-space box and writes the cluster's light list; a shaded
+// fragment finds its cluster from its world position and only iterates that
+// list, so its cost follows the light density around it rather than the total.
+//
+//  - Lights: one copy per frame in flight in a host-visible storage buffer.
+//  - Clusters: one list per cluster, kClusterStride words each (the count,
+//    then up to kMaxLightsPerCluster light indices); lights past that are
+//    dropped from the cluster.
+//  - Set 0, bindings 10 and 11 hold both buffers whole; LightInfo carries the
+//    grid's camera and the frame's offsets into them (3d_shader.frag, water.frag).
+//    Fragments outside the grid (the mirrored reflection pass) get no point light.
+//
+// With clustering off no grid is built and every fragment loops over every
+// light: the brute-force reference the trade-off sweep compares against.
+
+// Mirrors PointLight in light_cluster.comp, 3d_shader.frag and water.frag (std430)
+struct PointLight
+{
+    glm::vec3 position;
+    float radius; // Light reaches zero here; the cluster test uses it
+    glm::vec3 color;
+    float intensity;
+};
+
+class ClusteredLights
+{
+public:
+    static constexpr uint32_t kTilesX = 16;
+    static constexpr uint32_t kTilesY = 9;
+    static constexpr uint32_t kSlices = 24;
+    static constexpr uint32_t kClusterCount = kTilesX * kTilesY * kSlices;
+    static constexpr uint32_t kMaxLights = 1024;
+    static constexpr uint32_t kMaxLightsPerCluster = 127;
+    static constexpr uint32_t kClusterStride = kMaxLightsPerCluster + 1;
+    static constexpr float kGridNear = 1.0f; // Slice 0 also covers everything nearer
+    static constexpr uint32_t kLightBinding = 10;
+    static constexpr uint32_t kClusterBinding = 11;
+
+    ClusteredLights(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount);
+    ~ClusteredLights(); // The device must be idle
+
+    ClusteredLights(const ClusteredLights &) = delete;
+    ClusteredLights &operator=(const ClusteredLights &) = delete;
+
+    // Built at construction; call again to rebuild it from shaders/light_cluster.comp.spv
+    void createPipeline();
+
+    void setClustering(bool clustering) { m_clustering = clustering; }
+    bool getClustering() const { return m_clustering; }
+
+    // Once the frame's fence has signalled: copies the lights (at most kMaxLights) into the frame's
+    // copy and fills the point light part of lightInfo. view/fovY/aspect/farPlane: the main camera
+    void update(uint32_t frameIndex, const std::vector<PointLight> &lights, const glm::mat4 &view, float fovY, float aspect,
+                float farPlane, LightInfo &lightInfo);
+    uint32_t getLightCount(uint32_t frameIndex) const { return m_frames[frameIndex].push.info.x; }
+    // Whether the frame's grid must be built (clustering on and any light)
+    bool needsCull(uint32_t frameIndex) const { return m_clustering && getLightCount(frameIndex) > 0; }
+
+    // Outside a render pass; leaves the frame's grid visible to fragment shaders
+    void recordCull(VkCommandBuffer cmd, uint32_t frameIndex) const;
+
+    // For set 0: the whole buffers, every frame's copy
+    VkBuffer getLightBuffer() const { return m_lightBuffer; }
+    VkDeviceSize getLightBufferSize() const { return m_lightBufferSize; }
+    VkBuffer getClusterBuffer() const { return m_clusterBuffer; }
+    VkDeviceSize getClusterBufferSize() const { return m_clusterBufferSize; }
+
+private:
+    static constexpr uint32_t kGroupSize = 64;
+
+    // Mirrors ClusterPush in light_cluster.comp, and the cluster fields of LightInfo
+    struct ClusterPush
+    {
+        glm::mat4 view;
+        glm::vec4 projection; // x: 1 / (tan(fovY / 2) * aspect), y: 1 / tan(fovY / 2), z: kGridNear, w: kSlices / log(far / near)
+        glm::uvec4 info;      // x: light count, y: first light, z: first cluster word, w: 1 if clustered
+    };
+
+    struct FrameResources
+    {
+        PointLight *lights = nullptr; // Into the mapped light buffer
+        ClusterPush push{};
+    };
+
+    VkDevice m_device;
+    bool m_clustering = true;
+    std::vector<FrameResources> m_frames;
+
+    VkBuffer m_lightBuffer = VK_NULL_HANDLE;
+    VkDeviceSize m_lightBufferSize = 0;
+    VkBuffer m_clusterBuffer = VK_NULL_HANDLE; // Device-local, written by the cull pass only
+    VkDeviceSize m_clusterBufferSize = 0;
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+
+// ============================================================================
+// CPU PROFILER
+// ============================================================================
+// Scoped CPU zones on the hot paths (frame, command recording, uniforms, UI,
+// test bookkeeping, loaders and the worker threads), the CPU counterpart of
+// the GpuProfiler. A zone is two clock reads and a store into its thread's
+// ring buffer: each thread owns one, writes it alone and publishes with a
+// release store, so recording takes no lock. Only the first zone a thread
+// records registers the thread (under a mutex).
+//
+// Zones record only between start() and stop(); writeChromeTrace() exports
+// what the rings still hold (the last kEventsPerThread zones of each thread)
+// as Chrome trace event JSON, which chrome://tracing, Perfetto and Tracy's
+// import-chrome tool open. Export copies each ring and then re-reads how far
+// its thread has written, dropping the copied events that thread may have
+// overwritten meanwhile; so it is safe while capturing (HitchDetector exports
+// mid-run), at the cost of the oldest zones of a busy thread.
+//
+// The CPU_ZONE macros compile to nothing unless the build defines
+// XERENDER_CPU_PROFILING (the CMake option of the same name).
+
+#if defined(XERENDER_CPU_PROFILING)
+#define XR_CPU_CONCAT_INNER(a, b) a##b
+#define XR_CPU_CONCAT(a, b) XR_CPU_CONCAT_INNER(a, b)
+// name: a string literal (the pointer is kept until export)
+#define CPU_ZONE(name) CpuProfiler::Zone XR_CPU_CONCAT(cpuZone, __LINE__)(name)
+#define CPU_ZONE_FUNCTION() CPU_ZONE(__func__)
+// A zone that ends before its scope does
+#define CPU_ZONE_BEGIN(var, name) std::optional<CpuProfiler::Zone> var(std::in_place, name)
+#define CPU_ZONE_END(var) var.reset()
+#define CPU_THREAD_NAME(name) CpuProfiler::setThreadName(name)
+#else
+#define CPU_ZONE(name) ((void)0)
+#define CPU_ZONE_FUNCTION() ((void)0)
+#define CPU_ZONE_BEGIN(var, name) ((void)0)
+#define CPU_ZONE_END(var) ((void)0)
+#define CPU_THREAD_NAME(name) ((void)0)
+#endif
+
+class CpuProfiler
+{
+public:
+#if defined(XERENDER_CPU_PROFILING)
+    static constexpr bool kEnabled = true;
+#else
+    static constexpr bool kEnabled = false;
+#endif
+    static constexpr uint32_t kEventsPerThread = 1u << 16;
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char *name);
+        ~Zone();
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        const char *m_name;
+        uint64_t m_startNs = 0;
+        bool m_active;
+    };
+
+    // The calling thread's row in the trace; a copy is kept
+    static void setThreadName(const std::string &name);
+
+    // Drops what was recorded before and records from now on
+    static void start();
+    static void stop();
+    static bool isCapturing();
+
+    // Every thread's zones since start(), timestamps relative to it
+    static bool writeChromeTrace(const std::string &filePath);
+    // The zones the rings still hold that start in [fromNs, toNs), as trace events relative to originNs, each
+    // preceded by ",\n" (thread names first). For traces that embed them (HitchDetector.h); returns the zone count.
+    // Safe while capturing: zones overwritten during the copy are left out rather than written torn
+    static size_t writeTraceEvents(std::ostream &out, uint64_t originNs, uint64_t fromNs, uint64_t toNs);
+
+    // The steady clock the zones are stamped with
+    static uint64_t nowNs();
+};
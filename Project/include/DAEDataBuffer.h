@@ -19,18 +19,14 @@ public:
 
     void upload(VkDeviceSize size, void* data);
     void update();
-    void map(VkDeviceSize size, void* data);
+    void* map();
     void destroy();
-    void bindAsVertexBuffer(VkCommandBuffer commandBuffer);
-    void bindAsIndexBuffer(VkCommandBuffer commandBuffer);
     VkBuffer getVkBuffer();
     VkDeviceSize getSizeInBytes();
     VkDevice getDevice() const { return m_VkDevice; }
     VkDeviceMemory getMemory() const { return m_VkBufferMemory; }
 
 private:
-    uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
-
     VkDevice m_VkDevice;
     VkDeviceSize m_Size;
     VkBuffer m_VkBuffer;
@@ -44,16 +44,10 @@ void DAEUniformBufferObject<UBO>::initialize(const VulkanContext& context) {
         bufferSize
     );
 
-    void* data;
-    vkMapMemory(context.device, m_UBOBuffer->getMemory(), 0, bufferSize, 0, &data);
-    memcpy(data, &m_UBOSrc, sizeof(UBO));
-    vkUnmapMemory(context.device, m_UBOBuffer->getMemory());
+    m_UBOBuffer->upload(bufferSize, &m_UBOSrc);
 }
 
 template <class UBO>
 void DAEUniformBufferObject<UBO>::upload() {
-    void* data;
-    vkMapMemory(m_UBOBuffer->getDevice(), m_UBOBuffer->getMemory(), 0, sizeof(UBO), 0, &data);
-    memcpy(data, &m_UBOSrc, sizeof(UBO));
-    vkUnmapMemory(m_UBOBuffer->getDevice(), m_UBOBuffer->getMemory());
+    m_UBOBuffer->upload(sizeof(UBO), &m_UBOSrc);
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// DESCRIPTOR ALLOCATOR
+// ============================================================================
+// Descriptor sets without hand-sized pools. Each registered layout belongs to
+// a layout class, the descriptor counts one of its sets needs; layouts with
+// equal counts share the class. A class keeps a list of pools sized for whole
+// sets of it, and a pool that reports VK_ERROR_OUT_OF_POOL_MEMORY (or
+// FRAGMENTED_POOL) is closed and a new one twice its size, up to
+// kMaxSetsPerPool sets, takes over.
+//
+// Two lifetimes:
+//  - allocate(): persistent, the set lives as long as the allocator.
+//  - allocateTransient(): the frame's pools, reset in bulk by beginFrame() on
+//    the same slot 'framesInFlight' frames later, once its timeline value is reached.
+//    For per-object or per-pass sets written every frame.
+//
+// Not thread-safe: allocate, allocateTransient and beginFrame from the render thread.
+
+class DescriptorAllocator
+{
+public:
+    static constexpr uint32_t kInitialSetsPerPool = 16;
+    static constexpr uint32_t kMaxSetsPerPool = 1024;
+
+    DescriptorAllocator(VkDevice device, uint32_t framesInFlight);
+    ~DescriptorAllocator(); // The device must be idle
+
+    DescriptorAllocator(const DescriptorAllocator &) = delete;
+    DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+    // The bindings and flags 'layout' was created with; call once per layout before allocating from it
+    void registerLayout(VkDescriptorSetLayout layout, const VkDescriptorSetLayoutBinding *bindings,
+                        uint32_t bindingCount, VkDescriptorSetLayoutCreateFlags flags = 0);
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    // Valid until the allocator reaches this frame slot again; rewrite it every frame
+    VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout);
+
+    // Once per frame, after the frame's fence: resets the transient pools of 'frameIndex'
+    void beginFrame(uint32_t frameIndex);
+
+    uint32_t getPoolCount() const;
+
+private:
+    struct PoolList
+    {
+        std::vector<VkDescriptorPool> pools; // Persistent: the back one is open
+        size_t open = 0;                     // Transient: the open pool; those after it were reset
+        uint32_t nextSetsPerPool = kInitialSetsPerPool;
+    };
+
+    struct LayoutClass
+    {
+        std::vector<VkDescriptorPoolSize> perSet; // Sorted by type
+        VkDescriptorPoolCreateFlags poolFlags = 0;
+
+        PoolList persistent;
+        std::vector<PoolList> transient; // Per frame slot
+    };
+
+    LayoutClass &classOf(VkDescriptorSetLayout layout);
+    VkDescriptorPool createPool(const LayoutClass &layoutClass, PoolList &list);
+    bool tryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet &set) const;
+
+    VkDevice m_device;
+    uint32_t m_framesInFlight;
+    uint32_t m_frameIndex = 0;
+
+    std::vector<LayoutClass> m_classes;
+    std::unordered_map<VkDescriptorSetLayout, size_t> m_layoutClasses;
+};
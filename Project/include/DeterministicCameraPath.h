@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// DETERMINISTIC CAMERA PATH
+// ============================================================================
+// The camera flythrough a test run follows: keyframes at normalized times,
+// joined by a centripetal Catmull-Rom spline through the positions (no cusps
+// or loops where keys bunch up) and a uniform one through yaw and pitch, so
+// the camera is C1 across keyframes instead of stopping at each. Yaw is
+// unwrapped between keys: 170 to -170 turns 20 degrees, not 340.
+//
+// setKeyframes() builds the segments and an arc-length table once; a query
+// finds its segment by binary search, after trying the one the previous
+// query landed in - a run asks for increasing times, so a path of hundreds
+// of keys costs the same per frame as one of ten. With constantSpeed the
+// keyframe times are ignored and the camera covers equal distances in equal
+// time, which suits recorded paths with uneven pauses.
+//
+// Paths load from and save to JSON; CameraPathRecorder turns a live session
+// into one. A path object is used by one thread at a time (the segment cache).
+
+struct CameraKeyframe
+{
+    glm::vec3 position{0.0f};
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+    float timestamp = 0.0f; // normalized 0-1
+};
+
+class DeterministicCameraPath
+{
+public:
+    std::string name;
+    float totalDuration = 10.0f; // seconds
+    bool constantSpeed = false;  // true: arc-length parameterized, keyframe times ignored
+
+    // Keyframes in increasing timestamp order (sorted if not); rebuilds the spline
+    void setKeyframes(std::vector<CameraKeyframe> keyframes);
+    const std::vector<CameraKeyframe> &getKeyframes() const { return m_keyframes; }
+    float getLength() const { return m_arcLength.empty() ? 0.0f : m_arcLength.back(); }
+
+    // Camera state at normalized time t (0-1)
+    CameraKeyframe interpolate(float t) const;
+
+    // Camera state at frame 'frame' of a run 'totalFrames' long
+    CameraKeyframe atFrame(uint64_t frame, int totalFrames) const
+    {
+        if (totalFrames <= 0)
+            return {};
+        return interpolate(static_cast<float>(frame) / static_cast<float>(totalFrames));
+    }
+
+    // nullopt (and a message on stderr) if the file is missing or malformed
+    static std::optional<DeterministicCameraPath> loadFromJson(const std::string &filePath);
+    bool saveToJson(const std::string &filePath) const;
+
+    static DeterministicCameraPath createUnderwaterPath();
+    static DeterministicCameraPath createSurfacePath();
+    static DeterministicCameraPath createDepthTransitionPath();
+
+private:
+    static constexpr uint32_t kArcSamplesPerSegment = 16;
+
+    // Control points of the segment from key i to key i + 1, with the centripetal knots
+    struct Segment
+    {
+        glm::vec3 points[4];
+        float knots[4];
+        float yaw[4];
+        float pitch[4];
+    };
+
+    void build();
+    CameraKeyframe evaluate(size_t segment, float u) const;
+    size_t findSegment(float t) const;
+
+    std::vector<CameraKeyframe> m_keyframes;
+    std::vector<Segment> m_segments;
+    std::vector<float> m_arcLength;   // Cumulative: the start, then kArcSamplesPerSegment entries per segment
+    mutable size_t m_segmentHint = 0; // Where the previous query landed
+};
+
+// ============================================================================
+// CAMERA PATH RECORDER
+// ============================================================================
+// Samples the camera of a live session into keyframes, one per kInterval of
+// clock time, and hands them back as a path timed like the session was.
+
+class CameraPathRecorder
+{
+public:
+    static constexpr double kInterval = 0.2; // Seconds between keyframes
+
+    void start();
+    bool isRecording() const { return m_recording; }
+    size_t getKeyCount() const { return m_samples.size(); }
+
+    // Once per frame while recording; 'time' is the frame clock's
+    void sample(const glm::vec3 &position, float yaw, float pitch, double time);
+
+    // Ends the recording; the path spans the first to the last sample
+    DeterministicCameraPath stop(const std::string &name);
+
+private:
+    struct Sample
+    {
+        CameraKeyframe keyframe;
+        double time = 0.0;
+    };
+
+    bool m_recording = false;
+    std::vector<Sample> m_samples;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// DEVICE GROUP
+// ============================================================================
+// Experimental alternate-frame rendering over identical GPUs linked in a
+// Vulkan device group (core since 1.1, VK_KHR_device_group): one logical
+// device spans every GPU of the group, and each frame's command buffer runs on
+// one of them in turn, so while one GPU renders frame N the next renders N + 1.
+//
+// Everything outside the frame stays as it was: uploads, one-off command
+// buffers and the allocator's device-local memory run and live on every GPU
+// of the group (their default device mask), so textures, meshes and
+// pipelines are replicated and a frame finds its inputs wherever it runs.
+// Host-visible memory is single-instance (GpuMemoryAllocator keeps it off
+// multi-instance heaps), so the per-frame uniforms the CPU writes and the
+// readbacks are reached by each GPU over the bus.
+//
+// What a frame renders stays on its GPU: temporal history (reprojected
+// reflections, upscaler history, last frame's depth for Hi-Z) is the one its
+// GPU made the last time it ran, and the GPU timestamps and counters cannot
+// be told apart by device. The throughput measured from the frame timeline is
+// the number to compare. Async compute is left off on a group. Headless only: presenting from several GPUs needs the group
+// present modes, which the swapchain does not set up.
+//
+// Splitting the reflection/refraction passes off to a second GPU inside one
+// frame would need them in their own submission, a cross-device semaphore and
+// the results bound or copied into device 0's instance over peer memory;
+// hasPeerCopy() reports whether the group could, nothing uses it yet.
+
+class DeviceGroup
+{
+public:
+    static constexpr uint32_t kMaxDevices = 4; // Devices beyond this are left out of the group
+
+    // The group holding 'physicalDevice', itself first; just itself when it has no peers
+    static std::vector<VkPhysicalDevice> find(VkInstance instance, VkPhysicalDevice physicalDevice);
+
+    // Chained into device creation; must outlive vkCreateDevice
+    struct CreateInfo
+    {
+        VkDeviceGroupDeviceCreateInfo group{};
+        std::vector<VkPhysicalDevice> devices;
+    };
+    // Puts every device of the group in front of 'next'; returns the new head of the chain
+    static void *enable(CreateInfo &info, const std::vector<VkPhysicalDevice> &devices, void *next);
+
+    DeviceGroup(VkDevice device, const std::vector<VkPhysicalDevice> &devices);
+
+    DeviceGroup(const DeviceGroup &) = delete;
+    DeviceGroup &operator=(const DeviceGroup &) = delete;
+
+    uint32_t getDeviceCount() const { return m_deviceCount; }
+    uint32_t getAllDevicesMask() const { return (1u << m_deviceCount) - 1u; }
+    // Device 1 can copy into device 0's instances of images and buffers
+    bool hasPeerCopy() const { return m_peerCopy; }
+
+    // Off: every frame on device 0, as a single GPU would
+    void setAlternateFrames(bool enabled) { m_alternateFrames = enabled; }
+    bool getAlternateFrames() const { return m_alternateFrames; }
+    // The device that renders frame 'frameNumber'
+    uint32_t getFrameDevice(uint64_t frameNumber) const;
+
+    // Restricts a primary command buffer to 'deviceIndex'; returns the new head of the chain
+    const void *chainBegin(VkDeviceGroupCommandBufferBeginInfo &info, uint32_t deviceIndex, const void *next) const;
+
+    // Runs a submission's command buffers, waits and signals on 'deviceIndex'; valid while 'chain' lives
+    struct SubmitChain
+    {
+        VkDeviceGroupSubmitInfo info{};
+        std::array<uint32_t, 8> waitIndices{};
+        std::array<uint32_t, 8> commandBufferMasks{};
+        std::array<uint32_t, 8> signalIndices{};
+    };
+    void chainSubmit(SubmitChain &chain, VkSubmitInfo &submit, uint32_t deviceIndex) const;
+
+private:
+    uint32_t m_deviceCount = 1;
+    bool m_peerCopy = false;
+    bool m_alternateFrames = false;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// DEVICE SELECTION
+// ============================================================================
+// Picks the physical device among those the renderer can run on, by score
+// rather than enumeration order, so dual-GPU laptops and servers land on the
+// discrete GPU instead of whichever the loader listed first. The score ranks,
+// most significant first:
+//
+//   device type     discrete, integrated, virtual, CPU
+//   VRAM            the device-local heaps, in MiB
+//   optional paths  async compute family, multi-draw indirect, tessellation,
+//                   ray queries
+//
+// An override, by enumeration index or by a case-insensitive part of the
+// name, replaces the scoring: "--gpu <index|name>" on the command line or
+// the XERENDER_GPU environment variable, the command line winning. An
+// override that matches no suitable device is an error, not a fallback.
+
+namespace DeviceSelection
+{
+    constexpr const char *kOverrideVariable = "XERENDER_GPU";
+
+    struct Candidate
+    {
+        VkPhysicalDevice device = VK_NULL_HANDLE;
+        uint32_t index = 0; // Enumeration order
+        std::string name;
+        uint64_t score = 0;
+        bool suitable = false;
+    };
+
+    // The command line's value when non-empty, else the environment's
+    std::string getOverride(const std::string &commandLine);
+
+    uint64_t score(VkPhysicalDevice device, VkSurfaceKHR surface);
+
+    // Every device scored and checked, in enumeration order, each logged
+    std::vector<Candidate> rank(const std::vector<VkPhysicalDevice> &devices, VkSurfaceKHR surface,
+                                const std::function<bool(VkPhysicalDevice)> &isSuitable);
+
+    // The override's device, or the best suitable one. Throws when none qualifies.
+    VkPhysicalDevice select(const std::vector<Candidate> &candidates, const std::string &override);
+
+    // Name, type, driver and the limits the renderer depends on
+    void logDevice(VkPhysicalDevice device, bool asyncCompute);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// DRAW KEYS
+// ============================================================================
+// Draw lists are put in submission order by one 64-bit key per draw, its
+// fields packed most significant first, and a stable LSD radix sort over
+// them: one pass per byte, skipping the bytes every key agrees on (the layer
+// and pipeline, mostly), so a typical list costs three or four linear passes.
+//
+//   63..62  layer: opaque before transparent
+//   61..56  pipeline variant
+//   55..32  state that must stay adjacent, e.g. mesh and level for instanced
+//           batches; 0 when the order is depth first
+//   31..16  depth (quantizeDepth), inverted for back to front
+//   15..0   tie-break, e.g. material
+//
+// Equal keys keep their input order.
+
+namespace DrawKey
+{
+    enum class Layer : uint32_t
+    {
+        Opaque = 0,
+        Transparent = 1
+    };
+
+    enum class Order
+    {
+        FrontToBack,
+        BackToFront
+    };
+
+    constexpr uint32_t kPipelineBits = 6;
+    constexpr uint32_t kStateBits = 24;
+
+    // Non-negative depths (view distance, clip w or z) keep their order in the top 16 bits of their
+    // float encoding: relative precision, like the depth itself, rather than a fixed range
+    uint16_t quantizeDepth(float depth, Order order = Order::FrontToBack);
+
+    // Fields wider than their bits are truncated
+    uint64_t make(Layer layer, uint32_t pipeline, uint32_t state, uint16_t depth, uint16_t tieBreak);
+
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t index; // Of the draw the key was built for
+    };
+
+    // Stable; 'scratch' is resized as needed and keeps its storage between calls
+    void sort(std::vector<Entry> &entries, std::vector<Entry> &scratch);
+}
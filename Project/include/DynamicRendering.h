@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+// ============================================================================
+// DYNAMIC RENDERING
+// ============================================================================
+// Optional VK_KHR_dynamic_rendering backend for the render graph. With it,
+// attachment passes bind their image views per frame in vkCmdBeginRenderingKHR
+// instead of through a VkRenderPass and a VkFramebuffer. Nothing is cached per
+// swapchain image or transient view, so a resize rebuilds no framebuffers, and
+// load/store ops come straight from the frame's declarations (DONT_CARE for a
+// depth buffer nothing reads afterwards).
+//
+// A pipeline drawn in such a pass must be created without a render pass,
+// from the attachment formats instead. The modules keep building theirs
+// against the hand-made compatibility render passes: those register their
+// create info here, and apply() swaps the render pass for its registered
+// formats while the backend is enabled. Without it nothing changes, so
+// render passes remain the fallback.
+
+struct RenderingFormats
+{
+    std::vector<VkFormat> colorFormats;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED; // Depth only; the graph never binds stencil
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    uint32_t viewMask = 0; // Multiview passes (Multiview.h)
+};
+
+class DynamicRendering
+{
+public:
+    // The extension and its dynamicRendering feature
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+    // Enables the feature in front of 'next'; returns the new head of the chain. 'features' must outlive vkCreateDevice
+    static void *enableFeatures(VkPhysicalDeviceDynamicRenderingFeaturesKHR &features, void *next);
+
+    // On a device created with the extension, before any pipeline is built
+    static void enable(VkDevice device);
+    static bool isEnabled();
+
+    // Subpass 0's attachment formats and view mask, for apply(); right after creating a render pass pipelines are built against
+    static void registerRenderPass(VkRenderPass renderPass, const VkRenderPassCreateInfo &info);
+    // While enabled: clears info.renderPass and chains 'rendering' (filled here, kept alive by the caller)
+    // with the formats registered for it. A render pass never registered is left as it is
+    static void apply(VkGraphicsPipelineCreateInfo &info, VkPipelineRenderingCreateInfoKHR &rendering);
+
+    static void begin(VkCommandBuffer cmd, const VkRenderingInfoKHR &info);
+    static void end(VkCommandBuffer cmd);
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// ============================================================================
+// DYNAMIC RESOLUTION
+// ============================================================================
+// Picks the render scale of the water's reflection and refraction passes so
+// the GPU frame time stays at a target. Those targets are allocated at the
+// swapchain extent; a scaled pass renders into their top-left corner through
+// its viewport and water.frag scales its UVs to match, so changing the scale
+// never reallocates anything.
+//
+// Fed the GPU frame time from the timestamp profiler, which lags by the
+// frames in flight: the filtered time is compared against a dead band around
+// the target, and after a change the scale holds until frames rendered at it
+// have been measured.
+
+class DynamicResolution
+{
+public:
+    void setEnabled(bool enabled);
+    // Disabled, rendering at 'scale' (to a multiple of the step) until the next setEnabled
+    void setFixedScale(float scale);
+    bool isEnabled() const { return m_enabled; }
+
+    void setTargetFrameMs(double targetMs) { m_targetMs = targetMs; }
+    double getTargetFrameMs() const { return m_targetMs; }
+    void setMinScale(float minScale);
+    float getMinScale() const { return m_minScale; }
+
+    // Once per frame with the latest completed GPU frame; <= 0 (no timestamps yet) is ignored
+    void update(double gpuFrameMs, uint32_t framesInFlight);
+
+    // 1 when disabled, unless fixed
+    float getScale() const { return m_scale; }
+    double getFilteredFrameMs() const { return m_filteredMs; }
+
+private:
+    static constexpr float kStep = 1.0f / 32.0f; // Scales are multiples of this
+    static constexpr double kSmoothing = 0.1;    // Weight of the newest frame in the filtered time
+    static constexpr double kHeadroom = 0.9;     // Grow only below this fraction of the target
+    static constexpr uint32_t kSettleSamples = 8; // Frames measured at a new scale before the next change
+
+    bool m_enabled = false;
+    double m_targetMs = 1000.0 / 60.0;
+    float m_minScale = 0.5f;
+    float m_scale = 1.0f;
+    double m_filteredMs = 0.0;
+    uint32_t m_staleFrames = 0;  // Still measure the previous scale
+    uint32_t m_sampleFrames = 0; // Filling the filter at the current scale
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// ============================================================================
+// FRAME ARENA
+// ============================================================================
+// Bump allocator for CPU data that lives for one frame: the pass job lists
+// of recordCommandBuffer, the panel's scratch lists. The CPU counterpart of
+// the UniformArena: a region per frame in flight, rewound by beginFrame once
+// the frame's slot is free again, so data handed to the GPU side of a frame
+// (a pass' job list captured by the render graph) stays valid until then.
+//
+//  - Allocating is an aligned pointer bump; freeing does nothing. Blocks are
+//    kept from frame to frame: once the regions have grown to a frame's
+//    needs, a frame allocates nothing from the heap.
+//  - FrameAllocator adapts it to the standard containers (FrameVector). A
+//    vector that outgrows its storage leaves the old copy behind until the
+//    region is rewound; reserve where the size is known.
+//  - One thread: the one recording the frame.
+//
+// Builds without NDEBUG count every heap allocation per thread
+// (getHeapAllocations), to find what a frame still allocates.
+
+class FrameArena
+{
+public:
+    static constexpr size_t kBlockSize = 64 * 1024;
+#if !defined(NDEBUG)
+    static constexpr bool kCountsHeapAllocations = true;
+#else
+    static constexpr bool kCountsHeapAllocations = false;
+#endif
+
+    explicit FrameArena(uint32_t frameCount);
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // Rewinds the frame's region; everything allocated in it last time is released
+    void beginFrame(uint32_t frameIndex);
+
+    void *allocate(size_t size, size_t alignment);
+
+    size_t getFrameBytes() const { return m_frames[m_current].used; } // This frame's so far
+    size_t getCapacity() const;                                       // Every region's blocks
+
+    // operator new calls on the calling thread so far; always 0 when kCountsHeapAllocations is false
+    static uint64_t getHeapAllocations();
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size = 0;
+    };
+
+    struct Region
+    {
+        std::vector<Block> blocks;
+        size_t block = 0;  // Being filled
+        size_t offset = 0; // Into it
+        size_t used = 0;
+    };
+
+    std::vector<Region> m_frames;
+    uint32_t m_current = 0;
+};
+
+template <class T>
+class FrameAllocator
+{
+public:
+    using value_type = T;
+
+    explicit FrameAllocator(FrameArena &arena) noexcept : m_arena(&arena) {}
+    template <class U>
+    FrameAllocator(const FrameAllocator<U> &other) noexcept : m_arena(other.getArena()) {}
+
+    T *allocate(size_t count) { return static_cast<T *>(m_arena->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) noexcept {}
+
+    FrameArena *getArena() const { return m_arena; }
+
+    template <class U>
+    bool operator==(const FrameAllocator<U> &other) const { return m_arena == other.getArena(); }
+    template <class U>
+    bool operator!=(const FrameAllocator<U> &other) const { return m_arena != other.getArena(); }
+
+private:
+    FrameArena *m_arena;
+};
+
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+template <class T>
+FrameVector<T> makeFrameVector(FrameArena &arena)
+{
+    return FrameVector<T>(FrameAllocator<T>(arena));
+}
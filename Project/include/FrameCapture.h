@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "GpuProfiler.h"
+#include "WaterParamsBuffer.h"
+#include "WaterTestingSystem.h"
+
+// ============================================================================
+// FRAME CAPTURE
+// ============================================================================
+// One frame's worth of what its commands were recorded from, saved as JSON:
+// the clock time, the camera, the render settings (as a WaterTestConfig) and
+// the water tuning block exactly as uploaded, plus the graph's pass list with
+// the times it had. Vulkan handles do not outlive the process, so a capture
+// keeps the inputs rather than the command stream; replaying one re-records
+// the same draws, push constants and descriptor bindings from them.
+
+struct FrameCapturePass
+{
+    std::string name;
+    bool culled = false;
+    uint32_t barriers = 0;
+    float gpuMs = 0.0f; // At capture, from the profiler (a frame or two behind)
+};
+
+struct FrameCapture
+{
+    uint64_t frame = 0; // Clock frame at capture
+    double time = 0.0;  // Clock time, seconds
+    glm::vec3 cameraPosition{0.0f};
+    float cameraYaw = 0.0f;
+    float cameraPitch = 0.0f;
+    VkExtent2D extent{};
+    WaterTestConfig config;
+    WaterParams waterParams{};
+    std::vector<FrameCapturePass> passes;
+
+    bool save(const std::string &filePath) const;
+    // nullopt (and a message on stderr) if the file is missing or malformed
+    static std::optional<FrameCapture> load(const std::string &filePath);
+};
+
+// ============================================================================
+// PASS REPLAY
+// ============================================================================
+// Micro-benchmark harness over a capture: while it runs, the renderer holds
+// every frame to the captured state and the render graph records each
+// selected pass kMaxScopes / passes more times behind full barriers
+// (RenderGraph::setReplay), each repeat its own profiler scope. The repeats'
+// GPU times are collected here after a warm-up, so one pass - the sunrays,
+// say - is timed thousands of times in isolation from the rest of the frame.
+
+class PassReplay
+{
+public:
+    static constexpr uint32_t kMaxScopes = 64;     // Repeats per frame over all passes; on top of the profiler's own scopes
+    static constexpr uint32_t kWarmupFrames = 30;  // Not measured: clocks settle, the capture's state takes effect
+
+    struct PassResult
+    {
+        std::string name;
+        size_t samples = 0;
+        double meanMs = 0.0;
+        double medianMs = 0.0;
+        double minMs = 0.0;
+        double p99Ms = 0.0;
+        double capturedMs = 0.0; // The pass in the captured frame, for comparison
+    };
+
+    // repeat is clamped so the frame's repeats fit kMaxScopes
+    PassReplay(FrameCapture capture, std::vector<std::string> passes, uint32_t repeat, uint32_t frames);
+
+    const FrameCapture &getCapture() const { return m_capture; }
+    const std::vector<std::string> &getPasses() const { return m_passes; }
+    uint32_t getRepeat() const { return m_repeat; }
+
+    // Once per frame, with the profiler's latest completed frame
+    void addFrame(const std::vector<GpuProfileScope> &scopes);
+    bool isDone() const { return m_frameCount >= kWarmupFrames + m_measuredFrames; }
+    float getProgress() const;
+
+    std::vector<PassResult> getResults() const;
+    bool writeCsv(const std::string &filePath) const;
+
+private:
+    FrameCapture m_capture;
+    std::vector<std::string> m_passes;
+    uint32_t m_repeat;
+    uint32_t m_measuredFrames;
+    uint32_t m_frameCount = 0;
+    std::vector<std::vector<double>> m_samples; // Per pass, ms
+};
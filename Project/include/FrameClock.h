@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// FRAME CLOCK
+// ============================================================================
+// The one time source behind everything a frame animates: water, particles
+// and the test camera path all read the frame number and time it hands out.
+//  - RealTime: advances by the sampled wall time, for interactive use.
+//  - FixedStep: advances by the same step every frame, so frame k is always
+//    at time k * step and two runs render identical frames. The time is
+//    computed from the frame number rather than summed, so it does not drift
+//    over long runs; switching into it mid-run steps on from the current time.
+//  - Replay: steps through the times a previous run went through, so a run
+//    keeps that run's real-time cadence and still reproduces it exactly.
+//    While no times are set it runs in real time and records them instead.
+//
+// Not thread-safe: owned by the simulation step.
+
+class FrameClock
+{
+public:
+    enum class Mode
+    {
+        RealTime = 0,
+        FixedStep = 1,
+        Replay = 2
+    };
+
+    static const char *modeName(Mode mode);
+
+    // Takes effect at the next advance(); the frame and time carry on
+    void setMode(Mode mode, double fixedStep);
+    Mode getMode() const { return m_mode; }
+
+    // Back to frame 0 at time 0. Replay mode steps through 'replayTimes' (frame k at replayTimes[k]),
+    // or records if it is empty
+    void restart(std::vector<double> replayTimes = {});
+
+    // One frame on; wallDelta is the wall time since the previous frame. Returns the new time
+    double advance(double wallDelta);
+
+    uint64_t getFrame() const { return m_frame; }
+    double getTime() const { return m_time; }
+    double getDeltaTime() const { return m_deltaTime; }
+
+    // Frame k's time at index k since the last restart; filled only while Replay mode records
+    const std::vector<double> &getRecording() const { return m_recording; }
+
+private:
+    Mode m_mode = Mode::RealTime;
+    double m_fixedStep = 1.0 / 60.0;
+
+    uint64_t m_frame = 0;
+    double m_time = 0.0;
+    double m_deltaTime = 0.0;
+
+    // FixedStep time is m_stepOriginTime + (m_frame - m_stepOriginFrame) * m_fixedStep
+    uint64_t m_stepOriginFrame = 0;
+    double m_stepOriginTime = 0.0;
+
+    std::vector<double> m_replay;
+    std::vector<double> m_recording;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FrameMetrics;
+
+// ============================================================================
+// FRAME METRICS LOG
+// ============================================================================
+// Append-only binary log of per-frame test metrics for soak runs, where
+// buffering every FrameMetrics until endTestRun would grow without bound.
+// The render thread fills fixed-size blocks of records; a background thread
+// writes full blocks and hands them back for reuse, so memory stays at a few
+// blocks and append() never touches the file.
+//
+// File layout (little endian, natural alignment):
+//   FrameLogFileHeader, then 64-byte records. A FrameLogRunRecord starts each
+//   run; the FrameLogFrameRecords that follow belong to it. Opening an
+//   existing log appends to it.
+
+struct FrameLogFileHeader
+{
+    char magic[8]; // "XRFMLOG"
+    uint32_t version;
+    uint32_t recordSize;
+};
+
+enum class FrameLogRecordKind : uint8_t
+{
+    Frame = 0,
+    Run = 1
+};
+
+struct FrameLogFrameRecord
+{
+    uint32_t frameIndex;
+    uint16_t runIndex;
+    FrameLogRecordKind kind; // Frame
+    uint8_t flags;           // kFlag*
+    uint64_t timestampNs;
+    float frameTimeMs;
+    float gpuTimeMs;
+    float cpuTimeMs;
+    float latencyMs;
+    float waterPassTimeMs;
+    float scenePassTimeMs;
+    float postProcessTimeMs;
+    float cameraPosition[3];
+    float cameraYaw;
+    float cameraPitch;
+
+    static constexpr uint8_t kFlagWarmup = 1u << 0;
+    static constexpr uint8_t kFlagOutlier = 1u << 1;
+};
+
+struct FrameLogRunRecord
+{
+    uint32_t totalFrames;
+    uint16_t runIndex;
+    FrameLogRecordKind kind; // Run
+    uint8_t warmupFrames;    // Clamped to 255
+    char configName[56];     // Truncated, always null-terminated
+};
+
+static_assert(sizeof(FrameLogFrameRecord) == 64, "frame log records must stay 64 bytes");
+static_assert(sizeof(FrameLogRunRecord) == sizeof(FrameLogFrameRecord), "frame log records must share one size");
+
+class FrameMetricsLog
+{
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    explicit FrameMetricsLog(const std::string &path); // Throws if the file cannot be opened
+    ~FrameMetricsLog();                                // Writes everything appended so far
+
+    FrameMetricsLog(const FrameMetricsLog &) = delete;
+    FrameMetricsLog &operator=(const FrameMetricsLog &) = delete;
+
+    // Render thread
+    void beginRun(const std::string &configName, int runIndex, int totalFrames, int warmupFrames);
+    void append(const FrameMetrics &metrics, int runIndex);
+    // Queues the partly filled block (end of a run)
+    void flush();
+
+    const std::string &getPath() const { return m_path; }
+    uint64_t getRecordCount() const { return m_recordCount; }
+
+    // Converts a log to CSV or, for a ".json" output, JSON. Returns false if either file
+    // cannot be opened or the log's header does not match this version
+    static bool convert(const std::string &logPath, const std::string &outputPath);
+
+    // Calls onFrame for every frame record, with the config of the run it belongs to (frames
+    // before any run record have an empty name). Returns false for the same reasons as convert
+    static bool read(const std::string &logPath,
+                     const std::function<void(const std::string &configName, const FrameLogFrameRecord &record)> &onFrame);
+
+private:
+    static constexpr size_t kBlockRecords = 1024;
+    using Block = std::vector<FrameLogFrameRecord>;
+
+    // Opens 'in' past a valid header
+    static bool openLog(std::ifstream &in, const std::string &logPath);
+
+    void push(const FrameLogFrameRecord &record);
+    void writerLoop();
+
+    std::string m_path;
+    std::FILE *m_file = nullptr;
+    Block m_active;
+    uint64_t m_recordCount = 0;
+
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Block> m_pending; // Full blocks waiting for the writer
+    std::vector<Block> m_free;   // Written blocks, capacity kept
+    bool m_stop = false;
+};
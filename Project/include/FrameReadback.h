@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// FRAME READBACK
+// ============================================================================
+// Copies a frame's image into a host-visible buffer from inside the frame's
+// own command buffer. Every frame in flight owns one buffer, mapped once its
+// timeline value is reached (collect(), a frame or two later), so nothing waits on
+// the GPU. Delivered pixels are tightly packed RGBA8 regardless of the source
+// format.
+//
+// Consumers of one frame share a single copy: a callback runs on the thread
+// calling collect(), and/or the image is encoded to disk (.png, otherwise
+// JPEG) by a background thread that owns the pixels from then on.
+
+struct FrameReadbackImage
+{
+    std::vector<uint8_t> pixels; // RGBA8, width * 4 bytes per row
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+struct FrameReadbackRequest
+{
+    std::string encodePath;                                // Empty: not written to disk
+    std::function<void(const FrameReadbackImage &)> onReady; // Optional
+};
+
+class FrameReadback
+{
+public:
+    FrameReadback(VkDevice device, uint32_t frameCount);
+    ~FrameReadback(); // Finishes queued encodes; the device must be idle
+
+    FrameReadback(const FrameReadback &) = delete;
+    FrameReadback &operator=(const FrameReadback &) = delete;
+
+    // Recording thread. Requests gather until the next recordCopy
+    void request(FrameReadbackRequest request);
+    bool hasRequests() const { return !m_requests.empty(); }
+
+    // Copies 'image' (already in TRANSFER_SRC_OPTIMAL) for this frame's requests. Record outside any render pass
+    void recordCopy(VkCommandBuffer cmd, uint32_t frameIndex, VkImage image, VkFormat format, VkExtent2D extent);
+
+    // Delivers the slot's copy, if it has one; the slot's fence must have signalled
+    void collect(uint32_t frameIndex);
+    // Delivers every slot; the device must be idle
+    void collectAll();
+
+    // Encodes queued or in progress on the background thread
+    uint32_t getPendingEncodes() const;
+
+private:
+    struct FrameSlot
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        const uint8_t *mapped = nullptr;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent{};
+        std::vector<FrameReadbackRequest> requests; // Non-empty while a copy is in flight
+    };
+
+    struct EncodeJob
+    {
+        std::string path;
+        std::shared_ptr<const FrameReadbackImage> image;
+    };
+
+    void ensureCapacity(FrameSlot &slot, VkDeviceSize size);
+    void encoderLoop();
+
+    VkDevice m_device;
+    std::vector<FrameSlot> m_slots;
+    std::vector<FrameReadbackRequest> m_requests;
+
+    std::thread m_encoder;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<EncodeJob> m_encodeQueue;
+    uint32_t m_encoding = 0; // Jobs taken off the queue and not yet written
+    bool m_stop = false;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class OceanCaustics;
+
+// ============================================================================
+// FROXEL VOLUME
+// ============================================================================
+// Underwater fog and light shafts as participating media in a camera-aligned
+// volume of 160x90 screen tiles times 64 depth slices, exponentially spaced
+// like ClusteredLights' grid. Two compute passes per underwater frame:
+//
+//  - froxel_inject.comp: per froxel, the water's extinction and the light it
+//    scatters towards the camera. That is the ambient water color plus the sun,
+//    refracted at the surface, attenuated on the way down, focused into shafts
+//    by the traced caustics (OceanCaustics) and weighted by a forward-peaked
+//    phase function. Each froxel samples a different depth within its slice
+//    every frame and is blended with last frame's volume, reprojected through
+//    last frame's camera, so the jitter averages out.
+//  - froxel_integrate.comp: one march per tile, front to back, storing for
+//    each froxel the light scattered in front of it (rgb) and the
+//    transmittance to it (a, the green channel's; the other channels follow
+//    from the fixed absorption ratios of water).
+//
+// Shaders shading an underwater point (3d_shader.frag, water.frag) then fog it
+// with one lookup at its position (set 1, kWaterBinding): color * T + scatter.
+// The cost depends on the volume's size, not the screen's, and the passes
+// that used to fog and ray-march full-screen overlays draw no fog. Past kFar the
+// far slice's values apply. Everything stays in GENERAL. Both passes may run on
+// a compute-only queue (AsyncCompute.h).
+
+class FroxelVolume
+{
+public:
+    static constexpr uint32_t kWidth = 160;
+    static constexpr uint32_t kHeight = 90;
+    static constexpr uint32_t kSlices = 64;
+    static constexpr float kNear = 0.5f; // Slice 0 also covers everything nearer
+    static constexpr float kFar = 256.0f;
+    static constexpr uint32_t kWaterBinding = 10; // Water set: the integrated volume
+    static constexpr VkFormat kFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    // What the water holds and how it is lit this frame
+    struct Medium
+    {
+        glm::vec3 toSun{0.0f, 1.0f, 0.0f}; // Normalised, above the surface
+        float extinction = 0.0f;           // Per world unit, green channel
+        glm::vec3 ambient{0.0f};           // Radiance fully fogged water converges to
+        float anisotropy = 0.6f;           // Henyey-Greenstein g: water scatters forwards
+        glm::vec3 sunRadiance{0.0f};       // Scattered sun relative to an isotropic medium
+        float waterHeight = 0.0f;
+        float causticMapScale = 0.0f; // OceanCaustics map per world unit; 0: unfocused light
+        float receiverDepth = 50.0f;  // OceanCaustics::getReceiverDepth
+    };
+
+    // 'queueFamilies': as OceanFFT's
+    FroxelVolume(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, const OceanCaustics &caustics,
+                 std::vector<uint32_t> queueFamilies = {});
+    ~FroxelVolume(); // The device must be idle
+
+    FroxelVolume(const FroxelVolume &) = delete;
+    FroxelVolume &operator=(const FroxelVolume &) = delete;
+
+    // Shader hot reload
+    void createPipelines();
+
+    // Once the frame's fence has signalled: the frame's camera (as ClusteredLights::update) and medium
+    void update(uint32_t frameIndex, const glm::mat4 &view, float fovY, float aspect, const Medium &medium);
+    // Outside a render pass, after the caustics; leaves the volume visible to fragment shaders.
+    // 'computeQueue': recorded for a compute-only queue, where the semaphores do that
+    void recordVolume(VkCommandBuffer cmd, uint32_t frameIndex, bool computeQueue = false);
+    // The next frame starts without history (frames were skipped, or the medium jumped)
+    void invalidate() { m_historyValid = false; }
+
+    // For the water shaders: slice coordinate = log(depth / kNear) * getDepthScale()
+    static float getDepthScale();
+
+    // Filtered, clamped, GENERAL layout
+    VkSampler getSampler() const { return m_sampler; }
+    VkImageView getVolumeView() const { return m_integrated.view; }
+
+private:
+    static constexpr uint32_t kGroupSize = 8;        // froxel_*.comp local size (x, y)
+    static constexpr float kHistoryWeight = 0.9f;   // Of last frame's volume, when it is valid
+
+    // Mirrors FroxelFrame in froxel_inject.comp / froxel_integrate.comp (std140)
+    struct FrameUniforms
+    {
+        glm::mat4 invView;
+        glm::mat4 prevView;
+        glm::vec4 projection; // x, y: view to NDC scale, z: kNear, w: getDepthScale()
+        glm::vec4 toSun;      // xyz; w: anisotropy
+        glm::vec4 medium;     // x: extinction, y: depth jitter within the slice, z: history weight, w: water height
+        glm::vec4 ambient;    // rgb; w: caustic map scale
+        glm::vec4 sun;        // rgb; w: receiver depth
+    };
+
+    struct Volume
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+    };
+
+    void createImages();
+    void createDescriptors(const OceanCaustics &caustics);
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    std::vector<uint32_t> m_queueFamilies;
+    VkDeviceSize m_uniformStride = 0;
+    VkBuffer m_uniformBuffer = VK_NULL_HANDLE; // One FrameUniforms per frame in flight, mapped
+    uint8_t *m_uniforms = nullptr;
+
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    std::array<VkDescriptorSet, 2> m_sets{}; // Writes m_injected[i], reads m_injected[1 - i] as history
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_injectPipeline = VK_NULL_HANDLE;
+    VkPipeline m_integratePipeline = VK_NULL_HANDLE;
+
+    std::array<Volume, 2> m_injected{}; // rgb: scattered light, a: extinction; alternate frames
+    Volume m_integrated;
+    uint32_t m_current = 0; // m_injected index the next recordVolume writes
+
+    bool m_historyValid = false;
+    uint32_t m_frameNumber = 0; // Picks the depth jitter
+    glm::mat4 m_prevView{1.0f};
+    glm::vec4 m_prevProjection{0.0f};
+};
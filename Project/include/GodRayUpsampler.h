@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include "RenderGraph.h"
+
+// ============================================================================
+// GOD RAY UPSAMPLER
+// ============================================================================
+// Half-resolution tier for the underwater sunrays: the rays march into a
+// quarter-area RGBA16F target and a full-screen pass after the main pass adds
+// them to the resolved frame with a depth-aware bilateral upsample. Each
+// full-res pixel blends the four nearest low-res texels with bilinear weights
+// scaled down where the scene depth behind a texel differs from its own, so
+// rays do not bleed across silhouettes.
+//
+// The low-res rays use a 1-sample RGBA16F pipeline (TemporalUpscaler's
+// low-res render pass is compatible). Needs a multisampled depth attachment
+// that can be sampled, as the Hi-Z build does; isAvailable() is false otherwise
+// and the rays stay at full resolution.
+
+class GodRayUpsampler
+{
+public:
+    static constexpr VkFormat kFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    // extent/depthView: the main pass' depth attachment
+    GodRayUpsampler(VkDevice device, VkExtent2D extent, VkImageView depthView, VkSampleCountFlagBits depthSamples,
+                    bool depthSampleable);
+    ~GodRayUpsampler(); // The device must be idle
+
+    GodRayUpsampler(const GodRayUpsampler &) = delete;
+    GodRayUpsampler &operator=(const GodRayUpsampler &) = delete;
+
+    // Device idle; after the depth attachment was recreated
+    void resize(VkExtent2D extent, VkImageView depthView, VkSampleCountFlagBits depthSamples, bool depthSampleable);
+    // For the frame's colour format (the swapchain); call again when it changes
+    void createPipeline(VkFormat colorFormat);
+
+    bool isAvailable() const { return m_available; }
+    VkExtent2D getLowResExtent() const { return m_lowResExtent; }
+
+    // Written by the low-res rays pass, read by the upsample
+    RenderGraphResource importLowRes(RenderGraph &graph) const;
+
+    // Inside the upsample pass (attachment: the resolved frame, loaded), viewport set; 'projection' linearises depth
+    void recordUpsample(VkCommandBuffer cmd, const glm::mat4 &projection) const;
+
+private:
+    struct UpsamplePush
+    {
+        glm::vec2 depthParams; // proj[2][2], proj[3][2]: view distance = y / (depth + x)
+    };
+
+    void createTargets(VkExtent2D extent);
+    void destroyTargets();
+    void writeSet(VkImageView depthView);
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    bool m_available = false;
+    VkExtent2D m_lowResExtent{};
+
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE; // Pipeline compatibility only
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+    VkImage m_lowResImage = VK_NULL_HANDLE;
+    VkImageView m_lowResView = VK_NULL_HANDLE;
+};
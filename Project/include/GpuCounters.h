@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// GPU COUNTERS
+// ============================================================================
+// Hardware counters per render graph pass, next to the GpuProfiler's times:
+// what a pass did rather than how long it took.
+//  - Pipeline statistics queries: vertex, clipping and fragment shader
+//    invocations and clipped primitives, plus compute invocations for the
+//    compute passes. These need the pipelineStatisticsQuery and
+//    inheritedQueries features, the latter because the scene and water passes
+//    execute secondary command buffers while the query is active.
+//  - Vendor counters (VK_KHR_performance_query), where the driver has them.
+//    Only counters that fit in a single submission pass are used, and only
+//    additive ones (counts, bytes, cycles, time) - a frame total of a
+//    percentage means nothing. Performance queries may not be active around
+//    secondary command buffers, so passes recorded that way get none.
+//
+// Like the profiler, each frame in flight owns a range of queries read back
+// without waiting when the slot comes round again. Capturing is off until
+// setEnabled(true) and takes effect at the next beginFrame, so a toggle made
+// while a frame records never leaves a query begun but not reset. Pipeline
+// statistics slow the GPU down slightly, which is why a test config opts in.
+
+struct GpuPassStatistics
+{
+    uint64_t vertexInvocations = 0;
+    uint64_t clippingInvocations = 0; // Primitives reaching the clipping stage
+    uint64_t clippingPrimitives = 0;  // Primitives leaving it, to the rasterizer
+    uint64_t fragmentInvocations = 0;
+    uint64_t computeInvocations = 0;
+
+    GpuPassStatistics &operator+=(const GpuPassStatistics &other);
+};
+
+class GpuCounters
+{
+public:
+    // In result order (ascending bits)
+    static constexpr VkQueryPipelineStatisticFlags kStatistics =
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+    static constexpr uint32_t kMaxVendorCounters = 16;
+
+    // Pipeline statistics: the pipelineStatisticsQuery and inheritedQueries features
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+    static void enableFeatures(VkPhysicalDeviceFeatures &features);
+
+    // Vendor counters: VK_KHR_performance_query with performanceCounterQueryPools, and hostQueryReset
+    // (a performance query may not be reset in the command buffer that begins it)
+    static bool isPerformanceQuerySupported(VkPhysicalDevice physicalDevice);
+
+    // Chained into device creation; must outlive vkCreateDevice
+    struct PerformanceQueryFeatures
+    {
+        VkPhysicalDevicePerformanceQueryFeaturesKHR performanceQuery{};
+    };
+    // Enables performanceCounterQueryPools and hostQueryReset; add VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME too
+    static void enablePerformanceQuery(PerformanceQueryFeatures &features, VkPhysicalDeviceVulkan12Features &vulkan12Features);
+
+    // Begins a pass's queries in the constructor and ends them in the destructor
+    class Scope
+    {
+    public:
+        // secondaryContents: the pass executes secondary command buffers (no vendor counters)
+        Scope(GpuCounters *counters, VkCommandBuffer cmd, const char *name, bool secondaryContents);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        GpuCounters *m_counters;
+        VkCommandBuffer m_cmd;
+        uint32_t m_scope;
+    };
+
+    static constexpr uint32_t kInvalidScope = UINT32_MAX;
+
+    // Without the statistics features every call is a no-op; the vendor counters need the extension enabled
+    // on 'device' as well. queueFamily: the graphics queue's, the one the passes are submitted to
+    GpuCounters(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount,
+                bool statistics, bool performanceQuery, uint32_t maxScopesPerFrame = 64);
+    ~GpuCounters(); // The device must be idle
+
+    GpuCounters(const GpuCounters &) = delete;
+    GpuCounters &operator=(const GpuCounters &) = delete;
+
+    bool isSupported() const { return m_statisticsPool != VK_NULL_HANDLE; }
+    // Empty when the device exposes none (or no performance query support)
+    const std::vector<std::string> &getCounterNames() const { return m_counterNames; }
+
+    // Takes effect at the next beginFrame
+    void setEnabled(bool enabled) { m_requested = enabled; }
+    bool isEnabled() const { return m_requested; }
+
+    // Reads back the slot's previous frame; the frame's fence must have signalled.
+    // The first frame captured takes the profiling lock, held until destruction
+    void beginFrame(uint32_t frameIndex);
+    // Resets the slot's statistics queries: record first, outside any render pass
+    void resetQueries(VkCommandBuffer cmd);
+
+    // Recording thread only, around a whole pass: begin and end in the same command buffer, outside render passes
+    uint32_t beginScope(VkCommandBuffer cmd, const char *name, bool secondaryContents);
+    void endScope(VkCommandBuffer cmd, uint32_t scope);
+
+    // Latest completed frame: the passes with this name, or all of them; zero if not captured
+    GpuPassStatistics getStatistics(const std::string &name) const;
+    GpuPassStatistics getFrameStatistics() const;
+    // getCounterNames() order, summed over the frame's passes that had them
+    std::vector<double> getFrameCounters() const;
+
+private:
+    struct PassResult
+    {
+        std::string name;
+        GpuPassStatistics statistics;
+        std::vector<double> counters; // Empty: the pass had none
+    };
+
+    struct FrameSlot
+    {
+        std::vector<std::string> names;      // Index = scope
+        std::vector<bool> performanceScopes; // Scope began a vendor counter query
+    };
+
+    void selectCounters(VkInstance instance, VkPhysicalDevice physicalDevice, uint32_t queueFamily);
+    void collect(uint32_t frameIndex);
+
+    VkDevice m_device;
+    uint32_t m_frameCount;
+    uint32_t m_maxScopes;
+    uint32_t m_frameIndex = 0;
+    bool m_requested = false;
+    bool m_active = false; // This frame records queries
+
+    VkQueryPool m_statisticsPool = VK_NULL_HANDLE;
+
+    VkQueryPool m_performancePool = VK_NULL_HANDLE;
+    std::vector<uint32_t> m_counterIndices; // Into the queue family's counters
+    std::vector<VkPerformanceCounterStorageKHR> m_counterStorage;
+    std::vector<std::string> m_counterNames;
+    PFN_vkAcquireProfilingLockKHR m_acquireProfilingLock = nullptr;
+    PFN_vkReleaseProfilingLockKHR m_releaseProfilingLock = nullptr;
+    bool m_profilingLocked = false;
+
+    std::vector<FrameSlot> m_slots;
+    std::vector<PassResult> m_lastFrame;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class Scene;
+class UniformArena;
+
+// ============================================================================
+// GPU CULLING
+// ============================================================================
+// GPU-driven alternative to the CPU draw list. Every frame the scene's objects
+// (model matrix, world bounding sphere, index range) are written to a table;
+// a compute pass tests the spheres against the frustum and, optionally,
+// against a Hi-Z pyramid built from the previous frame's depth, and writes one
+// VkDrawIndexedIndirectCommand per surviving object. The scene is then drawn
+// with a single vkCmdDrawIndexedIndirectCount (VK_KHR_draw_indirect_count) or,
+// without the extension, one vkCmdDrawIndexedIndirect over all objects whose
+// culled entries have instanceCount = 0.
+//
+// firstInstance carries the object index, and the object table doubles as a
+// per-instance vertex buffer (binding 1) from which the vertex shader reads
+// the model matrix and material, so no descriptor changes per object. The CPU
+// path's instanced draws and the shadow cascades use the same instance layout.
+//
+// Requires the multiDrawIndirect and drawIndirectFirstInstance features.
+
+// Mirrors CullObject in scene_cull.comp (std430) and the instance attributes of 3d_shader_indirect.vert
+struct GpuCullObject
+{
+    glm::mat4 model;
+    glm::vec4 boundingSphere; // World-space centre (xyz) and radius (w)
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t visible;
+    uint32_t materialId; // Scene::getMaterialId
+    uint32_t pad[3];     // std430 array stride: a multiple of 16
+};
+
+class GpuCulling
+{
+public:
+    static constexpr uint32_t kInstanceBinding = 1;
+    static constexpr uint32_t kInstanceFirstLocation = 3; // mat4 model takes 4 locations, the material the next
+
+    GpuCulling(VkDevice device, VkPhysicalDevice physicalDevice, UniformArena &uniformArena,
+               uint32_t frameCount, uint32_t maxObjects, bool drawIndirectCount);
+    ~GpuCulling();
+
+    GpuCulling(const GpuCulling &) = delete;
+    GpuCulling &operator=(const GpuCulling &) = delete;
+
+    // multiDrawIndirect + drawIndirectFirstInstance
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+
+    static VkVertexInputBindingDescription getInstanceBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 5> getInstanceAttributeDescriptions();
+
+    // Pyramid over the depth attachment; call again whenever that attachment is recreated.
+    // The initial layout transition is recorded into the UploadContext batch.
+    void createHiZ(VkImageView depthView, VkExtent2D extent, VkSampleCountFlagBits samples, bool depthSampleable);
+    void destroyHiZ();
+
+    // Writes the frame's object table; the frame's fence must have signalled. A scene that outgrew the
+    // slot's table gets a larger one (the slot's buffers are idle then; the others grow on their turn)
+    void updateObjects(uint32_t frameIndex, const Scene &scene);
+
+    // Outside a render pass, before the draws that consume the commands
+    void recordCull(VkCommandBuffer cmd, uint32_t frameIndex, const glm::mat4 &viewProjection);
+
+    // Inside the render pass, with the indirect pipeline, sets and vertex/index buffers bound
+    void recordDraw(VkCommandBuffer cmd, uint32_t frameIndex) const;
+
+    // After the render pass that wrote the depth attachment, with the depth already in
+    // DEPTH_STENCIL_READ_ONLY_OPTIMAL and visible to compute; feeds next frame's occlusion test
+    void recordHiZBuild(VkCommandBuffer cmd, const glm::mat4 &viewProjection);
+
+    // Disabling drops the pyramid so re-enabling never tests against a stale camera
+    void setOcclusionEnabled(bool enabled)
+    {
+        m_occlusionEnabled = enabled;
+        m_hiZValid = m_hiZValid && enabled;
+    }
+    bool isOcclusionEnabled() const { return m_occlusionEnabled; }
+    bool isHiZAvailable() const { return m_hiZAvailable; }
+    bool hasDrawIndirectCount() const { return m_drawIndirectCount; }
+
+    // Visible objects written by the frame's last cull; valid once its fence has signalled
+    uint32_t getVisibleCount(uint32_t frameIndex) const;
+    uint32_t getObjectCount() const { return m_objectCount; }
+
+private:
+    struct CullParams
+    {
+        glm::vec4 frustumPlanes[6];
+        glm::mat4 hiZViewProjection; // Camera the current pyramid was rendered with
+        glm::vec2 hiZSize;
+        uint32_t objectCount;
+        uint32_t flags;
+        uint32_t hiZMipCount;
+        uint32_t _pad[3];
+    };
+
+    static constexpr uint32_t kFlagCompact = 1u << 0;
+    static constexpr uint32_t kFlagOcclusion = 1u << 1;
+    static constexpr uint32_t kCullGroupSize = 64;
+    static constexpr uint32_t kHiZGroupSize = 8;
+    static constexpr uint32_t kMaxHiZMips = 16;
+
+    struct FrameResources
+    {
+        VkBuffer objectBuffer = VK_NULL_HANDLE; // Host-visible: storage + per-instance vertex data
+        GpuCullObject *objects = nullptr;
+        VkBuffer drawBuffer = VK_NULL_HANDLE;  // Device-local indirect commands
+        VkBuffer countBuffer = VK_NULL_HANDLE; // Host-visible so the count can be read back
+        uint32_t *count = nullptr;
+        VkDescriptorSet cullSet = VK_NULL_HANDLE;
+        uint32_t capacity = 0; // Objects the object and draw buffers hold
+    };
+
+    void createCullPipeline();
+    void createHiZPipelines();
+    // Object and draw buffers for 'capacity' objects, replacing the frame's current ones
+    void createObjectBuffers(FrameResources &frame, uint32_t capacity);
+    void writeCullSets();
+    void writeCullSet(FrameResources &frame);
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    VkPhysicalDevice m_physicalDevice;
+    UniformArena &m_uniformArena;
+    uint32_t m_maxObjects; // Initial capacity of every frame's table
+    uint32_t m_objectCount = 0;
+    bool m_drawIndirectCount;
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount = nullptr;
+
+    std::vector<FrameResources> m_frames;
+
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_cullSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_cullPipeline = VK_NULL_HANDLE;
+
+    // Hi-Z pyramid: R32F, max depth per texel, always in GENERAL layout
+    VkDescriptorPool m_hiZDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_hiZSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_hiZPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_hiZDepthPipeline = VK_NULL_HANDLE;  // Multisampled depth -> mip 0
+    VkPipeline m_hiZReducePipeline = VK_NULL_HANDLE; // Mip n-1 -> mip n
+    VkSampler m_hiZSampler = VK_NULL_HANDLE;
+    VkImage m_hiZImage = VK_NULL_HANDLE;
+    VkImageView m_hiZView = VK_NULL_HANDLE; // All mips, sampled by the cull pass
+    std::vector<VkImageView> m_hiZMipViews;
+    std::vector<VkDescriptorSet> m_hiZSets;
+    VkExtent2D m_hiZExtent{};
+    uint32_t m_hiZMipCount = 0;
+
+    bool m_hiZAvailable = false; // Depth can be sampled: the pyramid can be built
+    bool m_hiZValid = false;     // A pyramid has been recorded since the last resize
+    glm::mat4 m_hiZViewProjection = glm::mat4(1.0f);
+    bool m_occlusionEnabled = false;
+};
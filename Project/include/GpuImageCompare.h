@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// GPU IMAGE COMPARE
+// ============================================================================
+// Compute-shader counterpart of ImageMetrics for per-frame quality tracking
+// during performance runs. The frame is copied into an image that stays on
+// the GPU and compared against a reference there: image_compare.comp writes
+// one partial sum (squared error, CIE76 delta E, SSIM) per 16x16 tile and
+// image_compare_reduce.comp folds them into a single vec4, which is all the
+// host reads back, a frame or two later once the frame's fence has signalled.
+//
+// The reference is either a frame captured on request or, for temporal
+// stability, the previous compared frame (the two images swap roles every
+// frame, so nothing is copied twice).
+//
+// MSE, PSNR and SSIM match ImageMetrics on the same pixels up to float
+// rounding; delta E has no CPU equivalent.
+
+struct GpuImageCompareResult
+{
+    uint32_t tag = 0; // Passed to recordCompare
+    double mse = 0.0;
+    double psnr = 0.0;
+    double ssim = 0.0;   // 0 for images smaller than one 11x11 window
+    double deltaE = 0.0; // Mean CIE76 delta E
+};
+
+class GpuImageCompare
+{
+public:
+    enum class Reference
+    {
+        PreviousFrame,
+        Captured
+    };
+
+    // extent/format: the frames to compare (the swapchain)
+    GpuImageCompare(VkDevice device, uint32_t frameCount, VkExtent2D extent, VkFormat format);
+    ~GpuImageCompare(); // The device must be idle
+
+    GpuImageCompare(const GpuImageCompare &) = delete;
+    GpuImageCompare &operator=(const GpuImageCompare &) = delete;
+
+    // Device idle; drops the reference and any results in flight
+    void resize(VkExtent2D extent, VkFormat format);
+
+    // Switching drops the reference
+    void setReferenceMode(Reference mode);
+    Reference getReferenceMode() const { return m_mode; }
+    // Captured mode: the next recorded frame becomes the reference
+    void captureReference() { m_captureRequested = true; }
+    bool hasReference() const { return m_referenceValid; }
+
+    // 'source' already in TRANSFER_SRC_OPTIMAL. Record outside any render pass
+    void recordCompare(VkCommandBuffer cmd, uint32_t frameIndex, VkImage source, uint32_t tag);
+
+    // The slot's result, if it recorded a comparison; the slot's fence must have signalled
+    bool collect(uint32_t frameIndex, GpuImageCompareResult &result);
+
+private:
+    static constexpr uint32_t kTileSize = 16; // image_compare.comp local size
+
+    struct FrameSlot
+    {
+        VkBuffer totalsBuffer = VK_NULL_HANDLE; // Host-visible vec4
+        const float *totals = nullptr;
+        // [i]: images[i] is the frame, images[1 - i] the reference
+        std::array<VkDescriptorSet, 2> sets{};
+        uint32_t tag = 0;
+        bool pending = false;
+    };
+
+    void createPipelines();
+    void createTargets();
+    void destroyTargets();
+    void writeSets();
+    void recordCopy(VkCommandBuffer cmd, VkImage source, uint32_t image);
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    std::vector<FrameSlot> m_slots;
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_comparePipeline = VK_NULL_HANDLE;
+    VkPipeline m_reducePipeline = VK_NULL_HANDLE;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+
+    // Copies of the source, reinterpreted as UNORM so the shaders see the stored bytes
+    VkExtent2D m_extent{};
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    std::array<VkImage, 2> m_images{};
+    std::array<VkImageView, 2> m_views{};
+    std::array<bool, 2> m_written{}; // In SHADER_READ_ONLY_OPTIMAL; UNDEFINED until first copied into
+    VkBuffer m_partialsBuffer = VK_NULL_HANDLE;
+    uint32_t m_groupsX = 0;
+    uint32_t m_groupsY = 0;
+
+    Reference m_mode = Reference::PreviousFrame;
+    uint32_t m_target = 0; // Image the next frame is copied into
+    bool m_referenceValid = false;
+    bool m_captureRequested = false;
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// ============================================================================
+// GPU MEMORY ALLOCATOR
+// ============================================================================
+// Pools VkDeviceMemory into large blocks and sub-allocates buffers/images by
+// offset. One pool per memory type, split again into linear (buffers, linear
+// images) and optimal (tiled images) resources so bufferImageGranularity never
+// has to be honoured inside a block. Host-visible blocks stay persistently
+// mapped; use mapBuffer/mapImage instead of vkMapMemory on pooled memory.
+// On a logical device spanning a device group (DeviceGroup.h), host-visible
+// memory comes only from heaps with a single instance, the ones it can map.
+//
+// Every allocation is counted under a category, for the Memory panel, and
+// the heaps are measured against a budget: VK_EXT_memory_budget's where the
+// device has it (the process' use of the heap, as the driver sees it),
+// otherwise kFallbackBudget of the heap with only our own blocks as its use.
+// getBudgetOverrun() is what the texture streamer drops mip levels to get
+// back under (TextureStreamer.h). A shared block the heap has no room for
+// left is retried at the size of the request before it fails.
+
+enum class GpuMemoryCategory : uint32_t
+{
+    Texture,
+    Mesh,
+    RenderTarget, // Also the other images the GPU writes: shadow maps, simulation fields, histories
+    Staging,      // Host-visible transfer sources and readback targets
+    Other,
+    Count
+};
+
+const char *toString(GpuMemoryCategory category);
+
+struct GpuAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr; // Already offset, nullptr if not host-visible
+
+    uint32_t poolIndex = UINT32_MAX;
+    uint32_t blockId = 0;
+    uint32_t memoryTypeIndex = UINT32_MAX;
+    GpuMemoryCategory category = GpuMemoryCategory::Other;
+};
+
+struct GpuMemoryStats
+{
+    uint32_t blockCount = 0;
+    uint32_t dedicatedBlockCount = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize bytesReserved = 0; // Sum of all block sizes
+    VkDeviceSize bytesUsed = 0;     // Sum of live sub-allocations
+    VkDeviceSize largestFreeRange = 0;
+
+    // 0 = all free space is one contiguous range, 1 = totally fragmented
+    float fragmentation() const
+    {
+        VkDeviceSize freeBytes = bytesReserved - bytesUsed;
+        if (freeBytes == 0)
+            return 0.0f;
+        return 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes);
+    }
+};
+
+struct GpuCategoryStats
+{
+    uint32_t allocationCount = 0;
+    VkDeviceSize bytes = 0; // Sum of the category's sub-allocations
+};
+
+struct GpuHeapBudget
+{
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0;   // What this process can use before the driver starts paging or failing
+    VkDeviceSize usage = 0;    // This process' use, our blocks included
+    VkDeviceSize reserved = 0; // Our blocks on the heap
+    VkDeviceSize used = 0;     // Our live sub-allocations in them
+    bool deviceLocal = false;
+    bool measured = false; // From VK_EXT_memory_budget rather than estimated
+};
+
+class GpuMemoryAllocator
+{
+public:
+    // Process-wide instance, initialised once the logical device exists
+    static GpuMemoryAllocator &get();
+
+    // Share of a device-local heap taken as the budget without VK_EXT_memory_budget
+    static constexpr float kFallbackBudget = 0.8f;
+    // Share of the budget getBudgetOverrun() keeps the device-local heaps under, for allocations in flight
+    static constexpr float kBudgetTarget = 0.9f;
+
+    // VK_EXT_memory_budget, for the device to enable so initialize can measure the heaps
+    static bool isBudgetSupported(VkPhysicalDevice physicalDevice);
+
+    // 'deviceCount': physical devices the logical device spans. 'deviceAddress': every block is allocated
+    // for buffer device addresses (the device enabled bufferDeviceAddress). 'memoryBudget': the device
+    // enabled VK_EXT_memory_budget
+    void initialize(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t deviceCount = 1, bool deviceAddress = false,
+                    bool memoryBudget = false);
+    void cleanup();
+    bool isInitialized() const { return m_device != VK_NULL_HANDLE; }
+
+    GpuAllocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear,
+                           GpuMemoryCategory category = GpuMemoryCategory::Other);
+    // Whether a memory type allowed by typeFilter has all the properties (lazily allocated memory is optional)
+    bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    void free(const GpuAllocation &allocation);
+
+    // Allocate + bind in one call. Returns the backing block so existing
+    // VkDeviceMemory members keep a meaningful (non-null) value.
+    VkDeviceMemory allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties,
+                                  GpuMemoryCategory category = GpuMemoryCategory::Other);
+    VkDeviceMemory allocateImage(VkImage image, VkMemoryPropertyFlags properties, bool linear = false,
+                                 GpuMemoryCategory category = GpuMemoryCategory::RenderTarget);
+
+    // The category of a buffer from what it is created for: geometry, transfers through host memory, or other
+    static GpuMemoryCategory categorize(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+    // Sampled-only images are textures, anything the GPU renders or writes to is a render target
+    static GpuMemoryCategory categorize(VkImageUsageFlags usage);
+
+    // Release the sub-allocation and destroy the resource
+    void destroyBuffer(VkBuffer buffer);
+    void destroyImage(VkImage image);
+
+    // Persistent mapping of a host-visible resource (pointer already offset)
+    void *mapBuffer(VkBuffer buffer);
+    void *mapImage(VkImage image);
+
+    GpuMemoryStats getDeviceLocalStats() const;
+    GpuMemoryStats getHostVisibleStats() const;
+    GpuCategoryStats getCategoryStats(GpuMemoryCategory category) const;
+
+    // One per memory heap, queried when called
+    std::vector<GpuHeapBudget> getHeapBudgets() const;
+    bool isBudgetMeasured() const { return m_memoryBudget; }
+    // Bytes the device-local heap (the one textures and render targets live in) is over kBudgetTarget of
+    // its budget; the free space inside our blocks counts as available, since new allocations go there
+    // first. 0 within budget
+    VkDeviceSize getBudgetOverrun() const;
+    // Bytes that heap can still take before getBudgetOverrun() is non-zero
+    VkDeviceSize getBudgetHeadroom() const;
+
+private:
+    GpuMemoryAllocator() = default;
+    GpuMemoryAllocator(const GpuMemoryAllocator &) = delete;
+    GpuMemoryAllocator &operator=(const GpuMemoryAllocator &) = delete;
+
+    struct FreeRange
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block
+    {
+        uint32_t id = 0;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceSize used = 0;
+        void *mapped = nullptr;
+        uint32_t allocationCount = 0;
+        bool dedicated = false;
+        std::vector<FreeRange> freeRanges; // Sorted by offset, coalesced on free
+    };
+
+    struct Pool
+    {
+        uint32_t memoryTypeIndex = 0;
+        bool linear = true;
+        bool hostVisible = false;
+        bool deviceLocal = false;
+        VkDeviceSize blockSize = 0;
+        std::vector<std::unique_ptr<Block>> blocks;
+    };
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    VkDeviceSize chooseBlockSize(uint32_t memoryTypeIndex) const;
+    // nullptr instead of throwing when the heap is out of memory and 'mayFail'
+    Block *createBlock(Pool &pool, VkDeviceSize size, bool dedicated, bool mayFail = false);
+    bool suballocate(Block &block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &outOffset);
+    void release(Block &block, VkDeviceSize offset, VkDeviceSize size);
+    GpuMemoryStats collectStats(bool hostVisible) const;
+    // Signed: negative when over kBudgetTarget
+    int64_t budgetRemaining() const;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    uint32_t m_deviceCount = 1;
+    bool m_deviceAddress = false;
+    bool m_memoryBudget = false;
+    uint32_t m_primaryHeap = 0; // The heap of the first device-local memory type
+
+    std::vector<Pool> m_pools; // [memoryTypeIndex * 2 + (linear ? 0 : 1)]
+    uint32_t m_nextBlockId = 1;
+
+    std::unordered_map<VkBuffer, GpuAllocation> m_bufferAllocations;
+    std::unordered_map<VkImage, GpuAllocation> m_imageAllocations;
+    std::array<GpuCategoryStats, static_cast<size_t>(GpuMemoryCategory::Count)> m_categories{};
+
+    mutable std::mutex m_mutex;
+};
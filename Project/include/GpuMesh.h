@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// GPU MESH
+// ============================================================================
+// A vertex and an index buffer in device-local memory, sub-allocated from the
+// shared pool (GpuMemoryAllocator.h) and filled through the UploadContext
+// batch. The index width follows the vertex count: 16-bit whenever every index
+// fits below the primitive restart value, halving the index fetch of the small
+// meshes (skybox cube, CDLOD tile), 32-bit otherwise. Callers always hand in
+// uint32_t indices and draw without knowing which one was picked.
+//
+// The scene's shared vertex/index buffers are not GpuMeshes: their draws are
+// ranges of one buffer, see Scene.h.
+
+class GpuMesh
+{
+public:
+    GpuMesh(VkDevice device, VkPhysicalDevice physicalDevice, const void *vertices, VkDeviceSize vertexStride,
+            uint32_t vertexCount, const std::vector<uint32_t> &indices);
+
+    template <class V>
+    GpuMesh(VkDevice device, VkPhysicalDevice physicalDevice, const std::vector<V> &vertices,
+            const std::vector<uint32_t> &indices)
+        : GpuMesh(device, physicalDevice, vertices.data(), sizeof(V), static_cast<uint32_t>(vertices.size()), indices)
+    {
+    }
+
+    ~GpuMesh();
+
+    GpuMesh(const GpuMesh &) = delete;
+    GpuMesh &operator=(const GpuMesh &) = delete;
+
+    // 16-bit when the largest index stays below 0xFFFF
+    static VkIndexType selectIndexType(uint32_t vertexCount);
+
+    // Vertex binding 0 and the index buffer
+    void bind(VkCommandBuffer cmd) const;
+    // Every index, once bound
+    void draw(VkCommandBuffer cmd, uint32_t instanceCount = 1) const;
+
+    VkBuffer getVertexBuffer() const { return m_vertexBuffer; }
+    VkBuffer getIndexBuffer() const { return m_indexBuffer; }
+    VkIndexType getIndexType() const { return m_indexType; }
+    uint32_t getIndexCount() const { return m_indexCount; }
+    uint32_t getVertexCount() const { return m_vertexCount; }
+
+private:
+    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+    VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
+    uint32_t m_indexCount = 0;
+    uint32_t m_vertexCount = 0;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// GPU PROFILER
+// ============================================================================
+// Named timestamp scopes recorded into the frame's command buffers. Every
+// frame in flight owns its own range of queries, so a slot's results are read
+// back when that slot comes round again - after its timeline value, one
+// or two frames later - and never wait on the GPU.
+//
+// Scopes only need a name: nesting (for the flame graph) is recovered from the
+// timestamps at readback, so a scope can be reserved on the recording thread
+// and written later from a secondary command buffer on a worker thread.
+// Scopes whose timestamps were never written (a skipped job, a frame that was
+// recorded but not submitted) are dropped.
+//
+// Inside a multiview render pass a timestamp fills one query per view (the
+// first holds the time, the rest zero), so a scope written there must be
+// reserved with the pass's view count: it then takes that many consecutive
+// begin and end queries instead of one each.
+
+struct GpuProfileScope
+{
+    std::string name;
+    uint32_t depth = 0;     // 0 = not inside any other scope
+    double startMs = 0.0;   // From the frame's first timestamp
+    double durationMs = 0.0;
+};
+
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t kHistorySize = 240;
+
+    // Rolling per-name history, oldest first from 'next'
+    struct History
+    {
+        std::array<float, kHistorySize> values{};
+        uint32_t next = 0;
+        uint32_t count = 0;
+
+        void push(float value);
+        float average() const;
+    };
+
+    // Begins a scope in the constructor and ends it in the destructor
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler *profiler, VkCommandBuffer cmd, const char *name);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        GpuProfiler *m_profiler;
+        VkCommandBuffer m_cmd;
+        uint32_t m_scope;
+    };
+
+    static constexpr uint32_t kInvalidScope = UINT32_MAX;
+
+    GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, uint32_t maxScopesPerFrame = 64);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    // False when the graphics queue cannot write timestamps; every call is then a no-op
+    bool isSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+
+    // Reads back the slot's previous frame and rewinds it; the frame's fence must have signalled
+    void beginFrame(uint32_t frameIndex);
+    // Resets the slot's queries: record first, outside any render pass
+    void resetQueries(VkCommandBuffer cmd);
+
+    // Recording thread only. 'viewCount' is the multiview pass's view count when the scope is written inside
+    // one. Returns kInvalidScope once the frame's queries run out
+    uint32_t reserveScope(const char *name, uint32_t viewCount = 1);
+    // Any thread, into any command buffer of the frame that runs after resetQueries
+    void writeBegin(VkCommandBuffer cmd, uint32_t scope, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    void writeEnd(VkCommandBuffer cmd, uint32_t scope, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    uint32_t beginScope(VkCommandBuffer cmd, const char *name);
+    void endScope(VkCommandBuffer cmd, uint32_t scope);
+
+    // Latest read-back frame, in start order; empty when none of its scopes had completed
+    const std::vector<GpuProfileScope> &getLastFrame() const { return m_lastFrame; }
+    // Sum of the latest completed frame's scopes with this name; 0 if it had none
+    double getScopeMs(const std::string &name) const;
+    // nullptr until a scope with this name has completed
+    const History *getHistory(const std::string &name) const;
+
+private:
+    struct FrameSlot
+    {
+        std::vector<std::string> names; // Index = scope; the extra views of a multiview scope are left unnamed
+    };
+
+    void collect(uint32_t frameIndex);
+
+    VkDevice m_device;
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    float m_timestampPeriod = 0.0f; // ns per tick
+    uint32_t m_frameCount;
+    uint32_t m_maxScopes;
+    uint32_t m_frameIndex = 0;
+
+    std::vector<FrameSlot> m_slots;
+    std::vector<GpuProfileScope> m_lastFrame;
+    std::map<std::string, History> m_history;
+};
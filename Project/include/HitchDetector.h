@@ -0,0 +1,112 @@
+#pragma once
+
+#include "GpuProfiler.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// HITCH DETECTOR
+// ============================================================================
+// Always-on flight recorder for frame-time spikes. The test system's outlier
+// flag says that a frame was slow; this says why. The last kFrames completed
+// frames are kept in a ring: their completion intervals, latencies and CPU
+// times to submission, and the GPU profiler's pass timings. Next to them is
+// a ring of the last kEvents notable events the renderer marks (swapchain
+// recreation, pipeline compiles, shader reloads, texture uploads). A frame
+// whose completion interval exceeds the threshold is a hitch. kFramesAfter
+// frames later the whole ring goes to a Chrome trace (chrome://tracing,
+// Perfetto). The trace holds the frames, their GPU passes, the events and the
+// CPU profiler's zones over the same span, plus a summary of each hitch and
+// the events inside it.
+//
+//  - GPU passes are the profiler's latest read-back frame when a frame
+//    completes, which trails it by up to the frames in flight. They are drawn
+//    ending at the completion they arrived with.
+//  - CPU zones need an XERENDER_CPU_PROFILING build with the profiler
+//    capturing. Without them the trace has frames, passes and events only.
+//  - Writing a trace stalls the render thread: the next kSuppressFrames are
+//    not judged. At most kMaxTraces are written per run; later hitches are
+//    only counted.
+//  - The first kIgnoreFrames are startup (StartupTimer.h) and not judged.
+//
+// Render thread only. Recording a frame copies into preallocated slots.
+
+class HitchDetector
+{
+public:
+    static constexpr uint32_t kFrames = 300;
+    static constexpr uint32_t kFramesAfter = 30;
+    static constexpr uint32_t kEvents = 512;
+    static constexpr uint32_t kMaxPasses = 32;
+    static constexpr uint32_t kNameLength = 24;
+    static constexpr uint32_t kSuppressFrames = 4;
+    static constexpr uint32_t kIgnoreFrames = 60;
+    static constexpr uint32_t kMaxTraces = 16;
+    static constexpr double kDefaultThresholdMs = 50.0;
+
+    explicit HitchDetector(std::string outputDirectory = "hitches", double thresholdMs = kDefaultThresholdMs);
+
+    void setThresholdMs(double ms) { m_thresholdMs = ms; }
+    double getThresholdMs() const { return m_thresholdMs; }
+
+    // 'what' is a string literal (the pointer is kept), stamped with CpuProfiler::nowNs()
+    void markEvent(const char *what);
+    // Each completed frame in order; 'completedNs' on CpuProfiler::nowNs()'s clock
+    void addFrame(uint64_t frameNumber, uint64_t completedNs, double intervalMs, double latencyMs, double cpuMs,
+                  const std::vector<GpuProfileScope> &gpuScopes);
+
+    uint32_t getHitchCount() const { return m_hitchCount; } // Traced or not
+    double getWorstMs() const { return m_worstMs; }
+    uint32_t getTraceCount() const { return m_traceCount; }
+    const std::string &getLastTracePath() const { return m_lastTracePath; }
+
+private:
+    struct Pass
+    {
+        std::array<char, kNameLength> name{}; // Truncated, NUL-terminated
+        uint32_t depth = 0;
+        float startMs = 0.0f;
+        float durationMs = 0.0f;
+    };
+
+    struct Frame
+    {
+        uint64_t number = 0;
+        uint64_t completedNs = 0;
+        double intervalMs = 0.0;
+        double latencyMs = 0.0;
+        double cpuMs = 0.0;
+        uint32_t passCount = 0;
+        std::array<Pass, kMaxPasses> passes{};
+    };
+
+    struct Event
+    {
+        const char *what = nullptr;
+        uint64_t ns = 0;
+    };
+
+    const Frame &frameAt(uint64_t index) const { return m_frames[index % kFrames]; }
+    // The events from the start of the previous frame to the completion of this one
+    std::vector<const char *> eventsAround(const Frame &frame) const;
+    void writeTrace();
+
+    std::string m_outputDirectory;
+    double m_thresholdMs;
+
+    std::vector<Frame> m_frames; // kFrames slots
+    uint64_t m_frameCount = 0;
+    std::array<Event, kEvents> m_events{};
+    uint64_t m_eventCount = 0;
+
+    std::vector<uint64_t> m_pendingHitches; // Ring indices of the hitches the next trace covers
+    uint32_t m_framesUntilTrace = 0;
+    uint32_t m_suppressFrames = 0;
+
+    uint32_t m_hitchCount = 0;
+    double m_worstMs = 0.0;
+    uint32_t m_traceCount = 0;
+    std::string m_lastTracePath;
+};
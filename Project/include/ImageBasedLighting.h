@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// IMAGE-BASED LIGHTING
+// ============================================================================
+// Ambient light from the skybox, replacing the flat ambient term of the scene
+// shader. Three products, all computed on the GPU from the environment cube:
+//
+//  - ibl_irradiance.comp: diffuse irradiance as nine L2 spherical harmonics
+//    (a buffer of 9 vec4, already divided by pi).
+//  - ibl_prefilter.comp: the GGX-prefiltered radiance cube, one mip per
+//    roughness step (level = roughness * (kPrefilteredLevels - 1)).
+//  - ibl_brdf_lut.comp: the split-sum scale/bias LUT, (NdotV, roughness).
+//
+// Filtering takes a few hundred milliseconds, so the results are cached next to
+// the sky as <source>.ibl, keyed by a hash of the source file: a later run with
+// the same sky uploads the cache instead of dispatching anything. A changed sky
+// or a newer kCacheVersion misses and rewrites it.
+//
+// Everything is recorded into the open UploadContext batch; the constructor
+// flushes it when it has to read results back for the cache. The environment
+// must be in SHADER_READ_ONLY with its mips built earlier in that batch.
+
+class ImageBasedLighting
+{
+public:
+    static constexpr uint32_t kPrefilteredSize = 128;
+    static constexpr uint32_t kPrefilteredLevels = 6; // Roughness 0, 0.2, ... 1
+    static constexpr uint32_t kBrdfLutSize = 128;
+    static constexpr VkFormat kFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr uint32_t kShCoefficients = 9;
+
+    ImageBasedLighting(VkDevice device, VkPhysicalDevice physicalDevice, VkImageView environment,
+                       uint32_t environmentSize, uint32_t environmentLevels, const std::string &sourcePath);
+    ~ImageBasedLighting(); // The device must be idle
+
+    ImageBasedLighting(const ImageBasedLighting &) = delete;
+    ImageBasedLighting &operator=(const ImageBasedLighting &) = delete;
+
+    // kShCoefficients vec4 (rgb used); storage and uniform usage
+    VkBuffer getIrradianceBuffer() const { return m_irradiance; }
+    VkDeviceSize getIrradianceSize() const { return kShCoefficients * 4 * sizeof(float); }
+
+    // Shader-read layout; sampled with getSampler() (linear, clamped, every mip)
+    VkImageView getPrefilteredView() const { return m_prefilteredView; }
+    VkImageView getBrdfLutView() const { return m_brdfLutView; }
+    VkSampler getSampler() const { return m_sampler; }
+
+    bool wasCached() const { return m_cached; }
+
+private:
+    static constexpr uint32_t kCacheVersion = 1; // Bump whenever a filter shader changes its output
+    static constexpr uint32_t kGroupSize = 8;    // ibl_prefilter.comp / ibl_brdf_lut.comp local size
+    static constexpr uint32_t kIrradianceSourceSize = 32; // Face size of the mip the SH project
+    static constexpr uint32_t kSampleCount = 512;
+
+    struct FilterPush
+    {
+        float roughness;
+        float environmentSize;
+        float sourceLod;
+        uint32_t sampleCount;
+    };
+
+    // Byte layout shared by the readback buffer and the cache file: SH, prefiltered levels
+    // (level-major, six faces each), LUT
+    static VkDeviceSize prefilteredBytes();
+    static VkDeviceSize brdfLutBytes();
+    static std::vector<VkBufferImageCopy> prefilteredRegions(VkDeviceSize baseOffset);
+
+    void createResources();
+    bool loadCache(const std::string &cachePath, uint64_t sourceHash);
+    void filter(VkImageView environment, uint32_t environmentSize, uint32_t environmentLevels,
+                const std::string &cachePath, uint64_t sourceHash);
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    VkPhysicalDevice m_physicalDevice;
+    bool m_cached = false;
+
+    VkBuffer m_irradiance = VK_NULL_HANDLE;
+    VkImage m_prefiltered = VK_NULL_HANDLE;
+    VkImageView m_prefilteredView = VK_NULL_HANDLE;
+    VkImage m_brdfLut = VK_NULL_HANDLE;
+    VkImageView m_brdfLutView = VK_NULL_HANDLE;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+class JobSystem;
+
+// ============================================================================
+// IMAGE METRICS
+// ============================================================================
+// Full-reference image comparisons for the image-quality tests. Inputs are
+// two tightly packed RGBA8 images of the same size. Work is split into row
+// bands run across the job system (single-threaded when jobs is null), and
+// the inner loops use SSE2 on x86-64 or NEON on ARM64, with a scalar tail
+// and fallback.
+
+namespace ImageMetrics
+{
+    // Over all four channels
+    double meanSquaredError(const uint8_t *a, const uint8_t *b, uint32_t width, uint32_t height, JobSystem *jobs = nullptr);
+    double meanAbsoluteDifference(const uint8_t *a, const uint8_t *b, uint32_t width, uint32_t height, JobSystem *jobs = nullptr);
+    // 100 for identical images
+    double psnrFromMse(double mse);
+
+    // Mean SSIM over 11x11 Gaussian windows (sigma 1.5) on BT.601 luma, valid region only.
+    // Images smaller than one window fall back to a single global window
+    double ssim(const uint8_t *a, const uint8_t *b, uint32_t width, uint32_t height, JobSystem *jobs = nullptr);
+
+    // "SSE2", "NEON" or "Scalar"
+    const char *simdPath();
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+// ============================================================================
+// JOB SYSTEM
+// ============================================================================
+// A fixed pool of worker threads shared by every subsystem that splits CPU
+// work (loading, command recording, pipeline builds, image metrics). Each
+// thread owns a deque of tasks: it pushes and pops its own at the back, so
+// the work it just split off stays hot in its cache, and an idle thread
+// steals from the front of the others', taking the largest, oldest pieces.
+//
+//  - Tasks are counted by a JobCounter. wait() does not block while tasks
+//    are queued anywhere: the waiting thread runs them, so a task may itself
+//    split work and wait for it without tying up a worker.
+//  - Dependencies are continuations: submitAfter() holds a task back until a
+//    counter drains, then queues it on the thread that finished the last task.
+//  - parallelFor() cuts a range into chunks of at least 'grain' items; run()
+//    is the one-index-per-job form the older callers use.
+//  - Every task runs inside a CPU profiler zone, on threads named "Job N".
+//
+// Thread indices are stable (0 = any thread outside the pool, 1..N = workers):
+// per-thread resources such as command pools are simply indexed by them. Only
+// one thread outside the pool should wait on the system at a time.
+//
+// Long-lived service threads that block on I/O or sleep (readback encoder,
+// texture streamer, metrics writer, shader watcher) keep their own threads.
+
+class JobSystem
+{
+public:
+    using Job = std::function<void(uint32_t jobIndex, uint32_t threadIndex)>;
+    using Task = std::function<void(uint32_t threadIndex)>;
+    using RangeJob = std::function<void(uint32_t begin, uint32_t end, uint32_t threadIndex)>;
+
+    explicit JobSystem(uint32_t workerCount);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Hardware threads minus the caller (or the placed worker cores), capped so small jobs are not split too finely
+    static uint32_t defaultWorkerCount();
+
+    // Queues the task on the calling thread's deque; 'counter' (optional) counts it until it has run
+    void submit(Task task, JobCounter *counter = nullptr);
+    // Queues the task once 'dependency' has drained (at once if it already has)
+    void submitAfter(JobCounter &dependency, Task task, JobCounter *counter = nullptr);
+    // Runs queued tasks until the counter drains; the first exception thrown by its tasks is rethrown here
+    void wait(JobCounter &counter);
+
+    // Blocks until all of [0, count) is done, in chunks of at least 'grain' items
+    void parallelFor(uint32_t count, uint32_t grain, const RangeJob &job);
+    // Blocks until all jobs are done; the first exception thrown by a job is rethrown here
+    void run(uint32_t jobCount, const Job &job);
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+    // The calling thread's index: 1..N on a worker, 0 anywhere else
+    uint32_t getThreadIndex() const;
+    uint64_t getStealCount() const { return m_steals.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t kMaxWorkers = 7;
+    // Chunks parallelFor aims for per thread: enough slack for stealing to even out uneven chunks
+    static constexpr uint32_t kChunksPerThread = 4;
+
+    struct QueuedTask
+    {
+        Task task;
+        JobCounter *counter = nullptr;
+    };
+
+    struct alignas(64) WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<QueuedTask> tasks;
+    };
+
+    void workerLoop(uint32_t threadIndex);
+    void push(uint32_t threadIndex, QueuedTask task);
+    // Own deque's back first, then the others' fronts
+    bool take(uint32_t threadIndex, QueuedTask &task);
+    void execute(uint32_t threadIndex, QueuedTask &task);
+    void finish(uint32_t threadIndex, JobCounter &counter, std::exception_ptr error);
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<WorkQueue>> m_queues; // One per thread index
+
+    // Sleeping threads wait here for queued tasks or a drained counter
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<uint32_t> m_queued{0};
+    std::atomic<uint64_t> m_steals{0};
+    bool m_stop = false;
+};
+
+// Tasks outstanding on behalf of one waiter. Reusable once drained; must outlive its tasks' wait()
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter &) = delete;
+    JobCounter &operator=(const JobCounter &) = delete;
+
+    bool isDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_pending{0};
+    std::mutex m_mutex; // Continuations and the error; the last task releases it before anything else
+    std::vector<std::pair<JobSystem::Task, JobCounter *>> m_continuations;
+    std::exception_ptr m_error;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// KTX2
+// ============================================================================
+// Reader and writer for the subset of KTX 2.0 the renderer uses: one 2D image,
+// one layer, one face, a full or partial mip chain, no supercompression. The
+// payload is whatever vkFormat says (BC7, BC5, ASTC, or plain RGBA8) and goes
+// to the GPU as is. Levels are stored smallest first, as the specification
+// requires, but the level index makes the order irrelevant to readers.
+//
+// Written by XeTexCook (TextureCookMain.cpp); read by TextureDecoder for
+// VulkanBase::loadTexture and the TextureStreamer when a .ktx2 sits next to
+// the source image.
+//
+// read() maps the file rather than reading it: when every level sits on a
+// 16-byte boundary (always, for files XeTexCook wrote) the levels stay in
+// the mapping and the uploads copy them from the page cache straight into
+// staging. Other files are packed into 'data' as before. Either way, take
+// the bytes from bytes()/byteSize(), not from 'data'.
+
+namespace Ktx2
+{
+    struct Level
+    {
+        uint64_t offset; // Into Image::data
+        uint64_t size;
+    };
+
+    struct Image
+    {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<Level> levels; // Level 0 is the full resolution
+        std::vector<uint8_t> data; // All levels, unless 'file' holds them
+
+        std::shared_ptr<const MappedFile> file; // read() in place: the levels are in the mapping, 'data' is empty
+        uint64_t fileOffset = 0;                // Of Level::offset 0 within 'file'
+        uint64_t fileBytes = 0;                 // From there to the end of the last level
+
+        // Level::offset is relative to this
+        const uint8_t *bytes() const
+        {
+            return file ? reinterpret_cast<const uint8_t *>(file->data()) + fileOffset : data.data();
+        }
+        uint64_t byteSize() const { return file ? fileBytes : data.size(); }
+    };
+
+    // False with a message on stderr for anything outside the subset above
+    bool read(const std::string &path, Image &image);
+    // BC7 (UNORM or SRGB) and BC5 UNORM only: the formats the cook produces
+    bool write(const std::string &path, const Image &image);
+}
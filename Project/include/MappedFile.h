@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// ============================================================================
+// MAPPED FILE
+// ============================================================================
+// A read-only file mapped into the address space: its bytes are paged in by
+// the OS as they are touched instead of being read up front, so a file of
+// several gigabytes costs only what is actually looked at, and pages not
+// touched for a while are simply dropped again under memory pressure.
+//
+// open() reports a missing or unreadable file by returning false. An empty
+// file opens fine and maps to no data: isOpen(), data() null, size() 0.
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return m_open; }
+    const std::byte *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const std::byte *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_open = false;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
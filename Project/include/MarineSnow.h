@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// ============================================================================
+// MARINE SNOW
+// ============================================================================
+// Suspended particulates as GPU particles instead of a pattern synthesised at
+// every pixel of the full-screen underwater passes.
+//
+//  - marine_snow_update.comp: one invocation per particle, in a persistent
+//    storage buffer. Particles sink slowly and swirl with a flow that varies
+//    smoothly through the water (drift scales both), and wrap within a box of
+//    kBoxSize centred on the camera, so the camera never runs out of them.
+//  - marine_snow.vert/.frag: one instanced camera-facing quad per particle in
+//    the main pass, depth tested against the scene but not written, added to
+//    what the pass holds. Additive blending needs no sorting. Particles fade
+//    out towards the box edges (hiding the wrap), near the camera, with the
+//    water's extinction, and above the surface.
+//
+// The cost follows the particle count, not the resolution. The buffer is
+// seeded on the first simulation and whenever reset() is called.
+
+class MarineSnow
+{
+public:
+    static constexpr uint32_t kMaxParticles = 65536;
+    static constexpr float kBoxSize = 24.0f; // World units the particles wrap within
+
+    struct Appearance
+    {
+        glm::vec3 color{0.65f, 0.82f, 0.95f}; // Premultiplied by the intensity
+        float size = 0.04f;                   // Quad half-width, world units
+        float fogDensity = 0.0f;              // Extinction per world unit towards the camera
+    };
+
+    MarineSnow(VkDevice device, VkPhysicalDevice physicalDevice);
+    ~MarineSnow(); // The device must be idle
+
+    MarineSnow(const MarineSnow &) = delete;
+    MarineSnow &operator=(const MarineSnow &) = delete;
+
+    // Against the pass the particles are drawn in; call again when it is rebuilt, and for shader hot reload
+    void createPipelines(VkRenderPass renderPass, VkSampleCountFlagBits samples);
+
+    void setParticleCount(uint32_t count);
+    uint32_t getParticleCount() const { return m_particleCount; }
+    // The next simulation scatters every particle around the camera again
+    void reset() { m_seeded = false; }
+
+    // Outside any render pass; 'time' in seconds, 'drift' scales the motion
+    void recordSimulation(VkCommandBuffer cmd, const glm::vec3 &cameraPos, float time, float drift);
+    // Inside the main pass, viewport set
+    void recordDraw(VkCommandBuffer cmd, const glm::mat4 &view, const glm::mat4 &projection, const Appearance &appearance) const;
+
+private:
+    static constexpr uint32_t kGroupSize = 64; // marine_snow_update.comp local size
+
+    // Mirrors Particle in marine_snow_update.comp / marine_snow.vert (std430)
+    struct Particle
+    {
+        glm::vec4 position; // xyz; w: per-particle seed
+        glm::vec4 scale;    // x: size multiplier, y: brightness multiplier
+    };
+
+    struct SimulationPush
+    {
+        glm::vec4 camera; // xyz; w: box size
+        glm::vec4 motion; // x: time, y: delta time, z: drift
+        uint32_t count;
+        uint32_t seed; // 1: scatter instead of moving
+    };
+
+    struct DrawPush
+    {
+        glm::mat4 viewProjection;
+        glm::vec4 right;  // Camera right; w: size
+        glm::vec4 up;     // Camera up; w: box size
+        glm::vec4 camera; // xyz; w: fog density
+        glm::vec4 color;
+    };
+
+    void createDescriptors();
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    uint32_t m_particleCount = 8192;
+    bool m_seeded = false;
+    float m_lastTime = -1.0f;
+
+    VkBuffer m_particleBuffer = VK_NULL_HANDLE; // kMaxParticles, device local
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_simulationLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_drawLayout = VK_NULL_HANDLE;
+    VkPipeline m_simulationPipeline = VK_NULL_HANDLE;
+    VkPipeline m_drawPipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class BindlessTable;
+class TextureStreamer;
+
+// A material as scene files and the code describe it (MaterialTable::add)
+struct MaterialDescription
+{
+    std::array<std::string, 4> maps; // Texture paths in MaterialTable::Map order, empty: no map
+    glm::vec3 baseColor = glm::vec3(1.0f);
+    float metalness = 0.0f;          // Without a metalness map
+    float roughness = 1.0f;          // Without a specular map
+
+    bool operator==(const MaterialDescription &other) const
+    {
+        return maps == other.maps && baseColor == other.baseColor && metalness == other.metalness &&
+               roughness == other.roughness;
+    }
+};
+
+// ============================================================================
+// MATERIAL TABLE
+// ============================================================================
+// Every material's parameters and map indices in one storage buffer, read by
+// 3d_shader.frag through the bindless table (BindlessTable.h) at the index
+// each draw carries: the per-instance material of instanced and GPU-driven
+// draws, UBO::material otherwise. Objects differ in material without a
+// descriptor set each, and a material is one more entry, not more state.
+//
+// The maps stream in through TextureStreamer; a promoted level is a new view,
+// so update() swaps its bindless slot and rewrites the materials using it.
+// There is one copy of the table per frame in flight, each its own bindless
+// buffer, and a frame's copy is only rewritten when it is out of date.
+//
+// Material 0 is the default; the others are numbered in the order added.
+// Identical descriptions share one entry.
+
+class MaterialTable
+{
+public:
+    enum Map
+    {
+        MapBase,
+        MapMetalness,
+        MapNormal,
+        MapSpecular,
+        MapCount
+    };
+
+    static constexpr uint32_t kMaxMaterials = 256;
+
+    // std430 mirror of loadMaterial in 3d_shader.frag, read as four vec4s
+    struct GpuMaterial
+    {
+        glm::vec4 baseColor; // rgb: multiplies the base map
+        glm::vec4 factors;   // x: metalness without a map, y: roughness without a specular map, zw unused
+        glm::uvec4 textures; // Bindless indices, in Map order
+        glm::uvec4 flags;    // x: bit i set when the material has map i
+    };
+
+    MaterialTable(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, BindlessTable &bindless,
+                  TextureStreamer &streamer, VkSampler sampler);
+    ~MaterialTable(); // The device must be idle
+
+    MaterialTable(const MaterialTable &) = delete;
+    MaterialTable &operator=(const MaterialTable &) = delete;
+
+    // Index for the draws. Throws when the table is full.
+    uint32_t add(const MaterialDescription &description);
+
+    // Once per frame, after the streamer's update and the bindless table's beginFrame: takes in
+    // promoted views and brings the frame's copy up to date. Returns its bindless buffer index.
+    uint32_t update(uint32_t frameIndex);
+
+    uint32_t getCount() const { return static_cast<uint32_t>(m_materials.size()); }
+    const MaterialDescription &getDescription(uint32_t index) const { return m_descriptions[index]; }
+
+private:
+    struct Texture
+    {
+        uint32_t handle;   // TextureStreamer
+        VkImageView view;  // The one 'slot' samples
+        uint32_t slot;     // Bindless texture index
+    };
+
+    uint32_t getTexture(const std::string &path, Map map);
+
+    BindlessTable &m_bindless;
+    TextureStreamer &m_streamer;
+    VkSampler m_sampler;
+
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    uint8_t *m_mapped = nullptr;
+    VkDeviceSize m_stride = 0;
+    std::vector<uint32_t> m_frameSlots;    // Bindless buffer index of each frame's copy
+    std::vector<uint64_t> m_frameVersions; // m_version each frame's copy was written at
+
+    std::vector<MaterialDescription> m_descriptions;
+    std::vector<GpuMaterial> m_materials;
+    std::vector<std::array<uint32_t, MapCount>> m_materialTextures; // Into m_textures, UINT32_MAX: no map
+    std::vector<Texture> m_textures;
+    std::unordered_map<std::string, uint32_t> m_texturesByPath;
+    uint64_t m_version = 1; // Bumped whenever m_materials changes
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// MESH OPTIMIZER
+// ============================================================================
+// Import-time reordering of indexed triangle lists, run before a mesh goes
+// into the binary mesh cache (ModelLoader::loadMesh) so the cost is paid once:
+//
+//  - optimizeVertexCache: Tipsify (Sander, Nehab & Barczak 2007). Fans
+//    around recently used vertices so the post-transform cache hits more.
+//  - optimizeOverdraw: splits that order where the cache runs cold anyway
+//    (all three corners miss) and sorts the pieces so outward-facing ones
+//    draw first, occluding the rest of the mesh from most viewpoints.
+//  - optimizeVertexFetch: renumbers vertices in first-use order so the
+//    vertex fetches walk memory forwards; unreferenced vertices are dropped.
+//  - buildMeshlets: greedy clusters of kMaxMeshletVertices /
+//    kMaxMeshletTriangles along the optimized order, each with a bounding
+//    sphere and a normal cone for backface culling whole clusters.
+//  - buildLodChain: coarser levels by quadric error edge collapse (Garland &
+//    Heckbert 1997), each about half the triangles of the one before. They
+//    index the same vertices, so a level costs only its indices.
+
+namespace MeshOptimizer
+{
+    constexpr uint32_t kCacheSize = 16; // Post-transform cache entries assumed
+    constexpr uint32_t kMaxMeshletVertices = 64;
+    constexpr uint32_t kMaxMeshletTriangles = 124;
+    constexpr uint32_t kMaxLods = 4;          // Level 0 included
+    constexpr uint32_t kMinLodTriangles = 32; // No level is built below this
+
+    // The three stages below, in order
+    void optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+    // Expects the output of optimizeVertexCache
+    void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices);
+    void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+    MeshletData buildMeshlets(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+
+    // Collapses edges, cheapest quadric error first, until at most targetIndexCount indices are left or
+    // nothing more can go. Vertices only move onto a neighbour, so the result indexes the same vertex
+    // array. Open borders and UV/normal seams are kept. outError: the worst collapse's error, as a distance
+    std::vector<uint32_t> simplify(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                   size_t targetIndexCount, float &outError);
+    // Appends up to kMaxLods - 1 coarser levels to 'indices' (level 0 is what it holds now), each
+    // simplified from the previous one and reordered for the vertex cache
+    std::vector<MeshLod> buildLodChain(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+}
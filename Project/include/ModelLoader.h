@@ -11,13 +11,36 @@ struct CubemapTexture {
     VkDeviceMemory memory;
     VkImageView view;
     VkSampler sampler;
+    uint32_t size;      // Face size of level 0
+    uint32_t mipLevels;
 };
 
+class JobSystem;
+
 class ModelLoader {
 public:
     static bool loadOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
 
-    static std::vector<SceneObject> loadSceneFromJson(const std::string& filePath);
+    // loadOBJ plus the MeshOptimizer passes, behind a binary cache next to the source
+    // (<model>.xmesh) that is rebuilt whenever the source's size or modification time no longer
+    // match its header. The cache is mapped, not streamed, and always holds the meshlets and the LOD chain;
+    // they are copied out of the mapping when asked for. With 'lods', 'indices' holds every level
+    // (MeshLod ranges); without, level 0's only.
+    static bool loadMesh(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                         MeshletData* meshlets = nullptr, std::vector<MeshLod>* lods = nullptr);
+
+    // Scene file: {"scene": {"name", "binary", "materials": [...], "meshes": [...], "objects": [...]}}, read with a streaming
+    // parser that handles each object as it goes. Meshes are named, and are either a "model" path, a
+    // "type" of sphere (radius) or cube (scale), or "vertices"/"indices" ranges ({"offset": bytes,
+    // "count"}) of the optional binary sidecar named by "binary" (vertices: position, normal, uv as
+    // 8 floats; indices: uint32). Objects place a "mesh" by name with position, rotation (degrees)
+    // and scale, and may add "instances": a sidecar range of column-major mat4 placements, one
+    // instance each. Version 1 objects (inline "type"/"model") are still read, and share a mesh
+    // with every other object describing the same one. Materials have "base", "metalness", "normal"
+    // and "specular" map paths, each optional, a "color" multiplying the base map and the "metallic"
+    // and "roughness" used without their maps; an object's "material" n > 0 is the file's n-th, 0 the default.
+    // Each distinct mesh is built once, on the job system's threads when one is given
+    static SceneDescription loadSceneFromJson(const std::string& filePath, JobSystem* jobSystem = nullptr);
 
     static void generateCube(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const glm::vec3& position, const glm::vec3& scale);
     static void generateSphere(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const glm::vec3& position, float radius, int sectorCount = 36, int stackCount = 18);
@@ -28,4 +51,14 @@ public:
         VkCommandPool cmdPool,
         VkQueue queue,
         const std::string& path);
+    // Same, from an already decoded RGBA8 image; 'path' only names it in messages
+    static CubemapTexture CreateCubemapFromHorizontalCross(
+        VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        VkCommandPool cmdPool,
+        VkQueue queue,
+        const uint8_t* pixels,
+        int width,
+        int height,
+        const std::string& path);
 };
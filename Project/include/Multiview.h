@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+
+// ============================================================================
+// MULTIVIEW
+// ============================================================================
+// Stereo rendering through VK_KHR_multiview (core since Vulkan 1.1). The main
+// pass draws both eyes at once: its attachments are two-layer arrays and its
+// render pass carries a view mask of both layers, so every command is
+// recorded once and the device runs each draw for both views, gl_ViewIndex
+// telling the shaders which eye's matrix to use (UBO::eyeViewProj). Culling,
+// the draw lists, the LOD selection and the recording are shared between the
+// eyes; only the vertex and pixel work is paid twice.
+//
+// The eyes look in parallel, offset along the camera's right axis by half the
+// separation each, with the same symmetric projection. They are culled with
+// one frustum containing both: the centre camera pulled back until its side
+// planes pass through the eyes' (Eyes::cullView), which the frame UBO hands
+// everything that is not drawn per eye (the CPU and GPU culls, the LOD
+// selection, the light clusters). The full-screen underwater fog needs
+// nothing per eye: parallel eyes see the same ray direction through the same
+// pixel.
+//
+// The eyes are resolved into a two-layer image and copied side by side into
+// the frame. What renders from one camera into one-layer targets stays off
+// in stereo (VulkanBase::applyStereoLimits): the reflection/refraction
+// passes, the half-resolution and tiled underwater effects, the marine snow
+// particles, Hi-Z occlusion and the tessellated water surface.
+//
+// Every shader reading gl_ViewIndex needs the multiview feature, stereo or
+// not; Vulkan 1.1 requires every device to support it.
+
+class Multiview
+{
+public:
+    static constexpr uint32_t kViewCount = 2;
+    static constexpr uint32_t kViewMask = (1u << kViewCount) - 1;
+    static constexpr float kDefaultEyeSeparation = 0.064f; // World units (metres), a typical interpupillary distance
+
+    // The multiview feature, with at least kViewCount views per pass
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+    // Enables the feature in front of 'next'; returns the new head of the chain. 'features' must outlive vkCreateDevice
+    static void *enableFeatures(VkPhysicalDeviceMultiviewFeatures &features, void *next);
+
+    // Gives a hand-made single-subpass render pass the stereo view mask, so pipelines built against it
+    // fit the graph's stereo passes; 'multiview' must outlive vkCreateRenderPass and registerRenderPass
+    static void chainRenderPass(VkRenderPassCreateInfo &info, VkRenderPassMultiviewCreateInfo &multiview);
+
+    struct Eyes
+    {
+        std::array<glm::mat4, kViewCount> view;
+        std::array<glm::vec3, kViewCount> position;
+        glm::mat4 cullView; // With cullProjection: a frustum containing both eyes' from near to far
+        glm::mat4 cullProjection;
+    };
+    // view: the centre camera. fovY, aspect, near and far are one eye's, as given to glm::perspective;
+    // cullProjection is flipped for Vulkan like the frame's projection
+    static Eyes computeEyes(const glm::mat4 &view, float fovY, float aspect, float nearPlane, float farPlane, float separation);
+};
@@ -1,38 +1,50 @@
 #pragma once
 
-#include <vector>
+#include <memory>
+#include <string>
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
-#include "Vertex.h"      
-#include "VulkanUtil.h"  
+#include "BathymetryField.h"
+#include "CdlodGrid.h"
 
+// Sea floor: CDLOD tiles around the camera (CdlodGrid.h), drawn with the
+// scene pipeline's 3d_shader_lod.vert variant. With a .bathy file the shader
+// takes the elevation from the streamed survey tiles (BathymetryField.h);
+// without, the floor is flat at 'depth'.
 class OceanBottomMesh
 {
 public:
+    // With survey data the floor needs cells as fine as the water's (~1.2 units over 20000), not a flat floor's
+    static constexpr uint32_t kSurveyLodLevels = 10;
+
     OceanBottomMesh() = default;
     ~OceanBottomMesh() = default;
 
     void create(VkDevice device,
         VkPhysicalDevice gpu,
-        VkCommandPool commandPool,
-        VkQueue graphicsQueue,
-        int resolution = 256,
+        uint32_t frameCount,
         float worldSize = 200.0f,
-        float depth = -50.0f);
+        float depth = -50.0f,
+        uint32_t lodLevels = 6,
+        const std::string &bathymetryPath = std::string());
 
     void destroy(VkDevice device);
 
-    void draw(VkCommandBuffer cmd);
-
-    uint32_t getIndexCount() const { return indexCount; }
+    // Once per frame, before recording; the frame's fence must have signalled
+    void update(uint32_t frameIndex, const glm::vec3 &cameraPos, float viewDistance);
 
-private:
-    VkBuffer vertexBuffer = VK_NULL_HANDLE;
-    VkBuffer indexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
-    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+    // Points the water set's bathymetry bindings at the streamed tiles
+    void writeDescriptors(VkDescriptorSet waterSet) const;
+    bool needsPageUpload() const { return bathymetry && bathymetry->needsPageUpload(); }
+    // Outside any render pass, before draw()
+    void recordPageUpload(VkCommandBuffer cmd, uint32_t frameIndex);
 
-    uint32_t indexCount = 0;
-};
+    void draw(VkCommandBuffer cmd, uint32_t frameIndex);
 
+    uint32_t getTileCount(uint32_t frameIndex) const { return grid ? grid->getTileCount(frameIndex) : 0; }
+    const BathymetryField *getBathymetry() const { return bathymetry.get(); }
 
+private:
+    std::unique_ptr<CdlodGrid> grid;
+    std::unique_ptr<BathymetryField> bathymetry;
+};
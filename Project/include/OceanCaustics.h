@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class OceanFFT;
+
+// ============================================================================
+// OCEAN CAUSTICS
+// ============================================================================
+// Caustics traced through the simulated surface once per frame, replacing the
+// static caustic texture the ocean bottom and the water's underside tiled.
+//
+//  - caustics_splat.comp: a grid of sun rays over one ocean patch. Each ray
+//    hits the displaced surface (OceanFFT maps), refracts through its normal,
+//    loses what Fresnel reflects, and travels down to the receiver plane. Its
+//    energy is added bilinearly into an r32ui accumulation map (fixed point,
+//    atomics) where it lands, wrapped so the map tiles like the ocean.
+//  - caustics_resolve.comp: a tent filter wide enough to cover the ray
+//    spacing, normalised so flat water gives 1 everywhere. Focused light
+//    reads above 1, the gaps between the caustic lines below.
+//
+// The map covers OceanFFT::kPatchSize world units at the receiver depth and
+// is sampled with world xz / kPatchSize (set 1, kWaterBinding). The cost
+// follows the ray count (setRayCount): the splat runs one invocation per ray.
+// Both images stay in GENERAL; recordGeneration() orders itself against the
+// simulation it reads and last frame's fragment reads of the map, or leaves
+// the fragment reads to the semaphores on a compute-only queue (AsyncCompute.h).
+
+class OceanCaustics
+{
+public:
+    static constexpr uint32_t kWaterBinding = 9; // Water set: the map
+    static constexpr uint32_t kMapSize = 256;
+    static constexpr VkFormat kMapFormat = VK_FORMAT_R32_SFLOAT;
+
+    // 'queueFamilies': as OceanFFT's
+    OceanCaustics(VkDevice device, const OceanFFT &ocean, std::vector<uint32_t> queueFamilies = {});
+    ~OceanCaustics(); // The device must be idle
+
+    OceanCaustics(const OceanCaustics &) = delete;
+    OceanCaustics &operator=(const OceanCaustics &) = delete;
+
+    // WaterTestConfig::causticRayCount: rays per map row / 4, so 64 gives one ray per texel; 0 traces none
+    void setRayCount(uint32_t rayCount);
+    uint32_t getRayCount() const { return m_raysPerSide / 4; }
+    // World units from the water surface down to where the caustics are sharpest (the ocean bottom)
+    void setReceiverDepth(float depth) { m_receiverDepth = depth; }
+    float getReceiverDepth() const { return m_receiverDepth; }
+
+    // Outside any render pass, after OceanFFT::recordSimulation; 'toSun' normalised.
+    // 'computeQueue': recorded for a compute-only queue, as the simulation was
+    void recordGeneration(VkCommandBuffer cmd, const glm::vec3 &toSun, bool computeQueue = false);
+
+    // Filtered, repeating, GENERAL layout
+    VkSampler getSampler() const { return m_sampler; }
+    VkImageView getMapView() const { return m_mapView; }
+
+    // Shader hot reload
+    void createPipelines();
+
+private:
+    static constexpr uint32_t kGroupSize = 8; // caustics_*.comp local size
+
+    struct GenerationPush
+    {
+        glm::vec4 toSun;
+        float patchSize;
+        float receiverDepth;
+        uint32_t raysPerSide;
+        float normalization; // Resolve: 1 / (fixed-point scale * rays per texel)
+        int32_t filterRadius; // Resolve: tent half-width in texels
+    };
+
+    void createDescriptors(const OceanFFT &ocean);
+    void createImages();
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    std::vector<uint32_t> m_queueFamilies;
+    uint32_t m_raysPerSide = 256;
+    float m_receiverDepth = 50.0f;
+
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_splatPipeline = VK_NULL_HANDLE;
+    VkPipeline m_resolvePipeline = VK_NULL_HANDLE;
+
+    VkImage m_accumulation = VK_NULL_HANDLE; // R32_UINT, fixed-point energy
+    VkImageView m_accumulationView = VK_NULL_HANDLE;
+    VkImage m_map = VK_NULL_HANDLE;
+    VkImageView m_mapView = VK_NULL_HANDLE;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// ============================================================================
+// OCEAN FFT
+// ============================================================================
+// Tessendorf ocean simulated on the GPU once per frame, replacing the analytic
+// waves water.vert used to evaluate per vertex for every pass drawing water.
+//
+//  - Initial spectrum: Phillips spectrum with Gaussian noise, built on the CPU
+//    at creation and uploaded once (xy = h0(k), zw = conj(h0(-k))).
+//  - ocean_spectrum.comp: advances every wave by its deep-water dispersion
+//    and writes eight spectra packed as four complex pairs (height, horizontal
+//    displacement, slopes, displacement derivatives). Each pair holds two real
+//    signals, so one complex inverse FFT yields both.
+//  - ocean_fft.comp: inverse FFT in shared memory, one workgroup per row,
+//    then one per column, in place.
+//  - ocean_combine.comp: writes the displacement map (xyz, w = Jacobian) and
+//    the normal/foam map (xyz normal, w = foam). Foam is seeded where the
+//    choppy displacement folds the surface (Jacobian < 1) and fades over time.
+//  - Both maps get a mip chain by blits so the coarse water grid and distant
+//    pixels sample them filtered.
+//
+// The maps cover kPatchSize world units and tile (repeat sampler). They stay in
+// GENERAL; recordSimulation() orders itself against last frame's shader reads
+// and makes its writes visible to the vertex and fragment stages. On a
+// compute-only queue (AsyncCompute.h) the semaphores between the queues do
+// that instead, and the blits, which need a graphics queue, are left to
+// recordMipChain().
+
+class OceanFFT
+{
+public:
+    static constexpr uint32_t kSize = 256;       // Grid resolution; ocean_*.comp OCEAN_SIZE
+    static constexpr float kPatchSize = 256.0f;  // World units one tile of the maps covers
+    static constexpr VkFormat kMapFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    struct Spectrum
+    {
+        float windSpeed = 18.0f;              // m/s; the largest waves are windSpeed^2 / g long
+        glm::vec2 windDirection{1.0f, 0.35f}; // XZ, normalised on use
+        float amplitude = 6.0e-4f;            // Phillips constant
+        uint32_t seed = 1337;
+    };
+
+    // 'queueFamilies': every family recording the simulation, for CONCURRENT images (AsyncCompute::getQueueFamilies)
+    explicit OceanFFT(VkDevice device, std::vector<uint32_t> queueFamilies = {}); // Default spectrum
+    OceanFFT(VkDevice device, const Spectrum &spectrum, std::vector<uint32_t> queueFamilies = {});
+    ~OceanFFT(); // The device must be idle
+
+    OceanFFT(const OceanFFT &) = delete;
+    OceanFFT &operator=(const OceanFFT &) = delete;
+
+    // Horizontal displacement scale; 0 gives round crests and no foam
+    void setChoppiness(float choppiness) { m_choppiness = choppiness; }
+    float getChoppiness() const { return m_choppiness; }
+
+    // Outside any render pass, before the frame's water draws. 'computeQueue': recorded for a
+    // compute-only queue, without the mip chain
+    void recordSimulation(VkCommandBuffer cmd, float time, bool computeQueue = false);
+    // On the graphics queue, after a computeQueue simulation it waited for
+    void recordMipChain(VkCommandBuffer cmd) const;
+
+    // Filtered, repeating, GENERAL layout
+    VkSampler getSampler() const { return m_mapSampler; }
+    VkImageView getDisplacementView() const { return m_maps[0].sampledView; }
+    VkImageView getNormalFoamView() const { return m_maps[1].sampledView; }
+    // For copies out of the displacement map (WaterHeightField)
+    VkImage getDisplacementImage() const { return m_maps[0].image; }
+    uint32_t getMipLevels() const { return m_mipLevels; }
+
+    // For the water shaders: x = 1 / patch size, y = log2 of map texels per world unit, so the
+    // displacement mip matching a cell of 's' units is log2(s) + y (the CDLOD cells vary per tile)
+    glm::vec4 getShaderParams() const;
+
+private:
+    static constexpr uint32_t kGroupSize = 8;  // ocean_spectrum.comp / ocean_combine.comp local size
+    static constexpr float kFoamLifetime = 2.5f; // Seconds for foam to fade to ~37%
+
+    struct SimulationPush
+    {
+        float time;
+        float patchSize;
+        float choppiness;
+        float foamDecay; // Fraction of last frame's foam kept
+        uint32_t direction; // ocean_fft.comp: 0 rows, 1 columns
+    };
+
+    struct Map
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView sampledView = VK_NULL_HANDLE; // Whole mip chain
+        VkImageView storageView = VK_NULL_HANDLE; // Level 0
+    };
+
+    void createPipelines();
+    void createImages(const Spectrum &spectrum);
+    void writeSet();
+    void recordMips(VkCommandBuffer cmd) const;
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    std::vector<uint32_t> m_queueFamilies;
+    uint32_t m_mipLevels = 1;
+
+    VkSampler m_spectrumSampler = VK_NULL_HANDLE;
+    VkSampler m_mapSampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_spectrumPipeline = VK_NULL_HANDLE;
+    VkPipeline m_fftPipeline = VK_NULL_HANDLE;
+    VkPipeline m_combinePipeline = VK_NULL_HANDLE;
+
+    VkImage m_initialSpectrum = VK_NULL_HANDLE; // RGBA32F, SHADER_READ_ONLY_OPTIMAL
+    VkImageView m_initialSpectrumView = VK_NULL_HANDLE;
+    std::array<VkImage, 2> m_fields{}; // RGBA32F spectra, transformed in place
+    std::array<VkImageView, 2> m_fieldViews{};
+    std::array<Map, 2> m_maps{}; // Displacement, normal/foam
+
+    float m_choppiness = 1.2f;
+    float m_lastTime = -1.0f;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// ============================================================================
+// OFFSCREEN THROTTLE
+// ============================================================================
+// Decides per frame whether the water's reflection and refraction passes
+// render, or the main pass reuses what their targets already hold. Both passes
+// re-render the scene for an image the waves distort anyway, so one a few
+// frames old rarely shows; what does show is that image sliding with the
+// camera. water.frag therefore reprojects: it looks each surface point up
+// through the view-projection the targets were rendered with
+// (getViewProjection), so a reused frame stays put on the water.
+//
+// A render is due every interval-th frame, as soon as the camera has moved or
+// turned past a threshold since the last one (reprojection cannot show what
+// the old view never saw), on a projection change and after invalidate().
+// Interval 0 renders on camera movement only: a still camera then keeps stale
+// lighting and animation in the reflection. Dynamic resolution takes effect
+// at renders; getScale() is the scale the targets were rendered at.
+
+class OffscreenThrottle
+{
+public:
+    // 1: every frame, 0: only when the camera moves
+    void setInterval(uint32_t frames) { m_interval = frames; }
+    uint32_t getInterval() const { return m_interval; }
+    // World units
+    void setMoveThreshold(float distance) { m_moveThreshold = distance; }
+    float getMoveThreshold() const { return m_moveThreshold; }
+    void setTurnThresholdDegrees(float degrees) { m_turnThresholdDegrees = degrees; }
+    float getTurnThresholdDegrees() const { return m_turnThresholdDegrees; }
+
+    // The next update() renders: targets reallocated, or what fills them changed
+    void invalidate() { m_valid = false; }
+
+    // Once per frame before the passes are declared, with the main camera and the dynamic-resolution scale
+    void update(const glm::vec3 &position, const glm::vec3 &front, const glm::mat4 &projection, const glm::mat4 &view,
+                float scale);
+
+    bool isDue() const { return m_due; }
+    // Of the last render: what the targets hold
+    const glm::mat4 &getViewProjection() const { return m_viewProjection; }
+    float getScale() const { return m_scale; }
+    // Frames since the last render
+    uint32_t getReusedFrames() const { return m_reusedFrames; }
+
+private:
+    uint32_t m_interval = 1;
+    float m_moveThreshold = 0.5f;
+    float m_turnThresholdDegrees = 2.0f;
+
+    bool m_valid = false;
+    bool m_due = true;
+    uint32_t m_reusedFrames = 0;
+    glm::vec3 m_position{0.0f};
+    glm::vec3 m_front{0.0f, 0.0f, -1.0f};
+    glm::mat4 m_projection{1.0f};
+    glm::mat4 m_viewProjection{1.0f};
+    float m_scale = 1.0f;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "WaterTestingSystem.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// PARAMETER SWEEP
+// ============================================================================
+// Test configs generated from a JSON spec instead of compiled-in lists: any of
+// the parameters below varied over a full grid or a Latin hypercube, on top of
+// a base config. After the suite, writeParetoFront() keeps the configs no
+// other config beats on both GPU time and SSIM against the reference images,
+// to pick production defaults from.
+//
+//   {
+//     "name": "GodRays",
+//     "sampling": "grid" | "latin-hypercube",
+//     "points": 24, "seed": 1,                  (latin-hypercube only)
+//     "base": {"renderingMode": 1, "turbidity": 0, "totalFrames": 200, "repeatCount": 3, "godDecay": 0.95},
+//     "parameters": {
+//       "godDensity": [0.25, 0.5, 1.0],          the values themselves
+//       "fogDensity": {"min": 0.01, "max": 0.1, "steps": 4}
+//     }
+//   }
+//
+//  - A grid takes every combination; a range gives it 'steps' evenly spaced
+//    values. A Latin hypercube takes 'points' configs, each parameter's range
+//    (or value list) cut into that many strata and every stratum used once,
+//    in an order shuffled per parameter by 'seed'.
+//  - Integer parameters are rounded. "base" takes the enums as their values
+//    in WaterTestingSystem.h, the run length, and any sweep parameter.
+//  - Shader parameters replace the renderer's tuning values of the same name
+//    (WaterTestConfig::shaderParams); the turbidity's fog density is
+//    overridden too. Config parameters set the WaterTestConfig field.
+
+class ParameterSweep
+{
+public:
+    enum class Sampling
+    {
+        Grid,
+        LatinHypercube
+    };
+
+    // Renderer tuning values a config may override by name (VulkanBase::shaderTuningValue)
+    static constexpr const char *kShaderParameters[] = {
+        "godExposure", "godDecay", "godDensity", "godSampleScale", "fogDensity",
+        "distortionStrength", "godRayIntensity", "causticIntensity", "opacity"};
+    // WaterTestConfig fields a sweep may set
+    static constexpr const char *kConfigParameters[] = {
+        "sampleCount", "causticRayCount", "msaaSamples", "pointLightCount",
+        "offscreenUpdateInterval", "framesInFlight", "resolutionScale"};
+
+    struct Axis
+    {
+        std::string name;
+        std::vector<double> values; // A list; empty for a range
+        double min = 0.0;
+        double max = 0.0;
+        uint32_t steps = 2; // Grid values of a range
+    };
+
+    std::string name = "Sweep";
+    Sampling sampling = Sampling::Grid;
+    uint32_t points = 16;
+    uint32_t seed = 1;
+    WaterTestConfig base;
+    std::vector<Axis> axes;
+
+    // nullopt (and a message on stderr) if the file is missing or malformed, or names an unknown parameter
+    static std::optional<ParameterSweep> load(const std::string &filePath);
+
+    // One config per grid combination or hypercube point, named <name>_<index>
+    std::vector<WaterTestConfig> generateConfigs() const;
+
+    static bool isParameter(const std::string &name);
+    // A config field or shader parameter as the sweep set it; NaN if the config leaves a shader parameter alone
+    static double getValue(const WaterTestConfig &config, const std::string &name);
+    static void setValue(WaterTestConfig &config, const std::string &name, double value);
+
+    // One row per config of the results (repeats averaged): its swept values, GPU time, reference SSIM and
+    // frame-to-frame SSIM, and whether it is on the Pareto front. The front ranks reference SSIM only: the
+    // frame-to-frame SSIM measures temporal stability, not fidelity, and is not comparable with it. Configs
+    // without references are listed but never on the front. Returns the front's size.
+    static size_t writeParetoFront(const std::vector<TestRunResult> &results, const std::string &filePath);
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+
+// ============================================================================
+// PIPELINE CACHE
+// ============================================================================
+// One VkPipelineCache shared by every graphics and compute pipeline, loaded
+// from disk at startup and written back on shutdown. The file starts with our
+// own header (vendor, device, driver version, pipeline cache UUID); a file
+// written by another GPU or driver is ignored and the cache starts empty.
+// Vulkan synchronises access to the cache internally, so pipelines may be
+// created from any thread.
+
+class PipelineCache
+{
+public:
+    // Process-wide instance, initialised once the logical device exists
+    static PipelineCache &get();
+
+    void initialize(VkDevice device, VkPhysicalDevice physicalDevice, const std::string &path = "pipeline_cache.bin");
+    // Writes the cache to disk and destroys it
+    void cleanup();
+
+    // VK_NULL_HANDLE before initialize(): pipeline creation then runs uncached
+    VkPipelineCache handle() const { return m_cache; }
+    bool save() const;
+
+private:
+    struct FileHeader
+    {
+        char magic[8]; // "XRPCACH"
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+    };
+
+    PipelineCache() = default;
+    PipelineCache(const PipelineCache &) = delete;
+    PipelineCache &operator=(const PipelineCache &) = delete;
+
+    bool matchesDevice(const FileHeader &header) const;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_properties{};
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    std::string m_path;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// ============================================================================
+// PRESENT PACER
+// ============================================================================
+// Tags every present with an id (VK_KHR_present_id) and asks when each id
+// reached the display (VK_KHR_present_wait). That gives two things:
+//  - Pacing: waitForDisplay() holds the CPU until the latest present is on
+//    screen, so the next frame samples its input as late as the display
+//    allows instead of queueing behind images the swapchain has not shown
+//    yet. The frame timeline still bounds the GPU work in flight; this bounds
+//    how far ahead of the display the frames are started.
+//  - Motion-to-photon latency: from a frame's input sample to its present
+//    being seen displayed, filtered over frames.
+//
+// Present ids only need to increase per swapchain; after recreation the
+// outstanding ones may never be reported, so reset() drops them.
+
+class PresentPacer
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    static constexpr std::array<const char *, 2> kExtensions = {VK_KHR_PRESENT_ID_EXTENSION_NAME,
+                                                                VK_KHR_PRESENT_WAIT_EXTENSION_NAME};
+
+    // Both extensions, and their presentId / presentWait features
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+
+    // Chained into device creation; must outlive vkCreateDevice
+    struct Features
+    {
+        VkPhysicalDevicePresentIdFeaturesKHR presentId{};
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWait{};
+    };
+    // Enables both features in front of 'next'; returns the new head of the chain
+    static void *enableFeatures(Features &features, void *next);
+
+    explicit PresentPacer(VkDevice device);
+
+    PresentPacer(const PresentPacer &) = delete;
+    PresentPacer &operator=(const PresentPacer &) = delete;
+
+    // Chains the next id into a single-swapchain present; valid until the next call.
+    // inputTime: when the frame sampled its input
+    void attach(VkPresentInfoKHR &presentInfo, Clock::time_point inputTime);
+
+    // Blocks until the latest attached present is displayed or timeoutNs passes, then measures
+    void waitForDisplay(VkSwapchainKHR swapchain, uint64_t timeoutNs);
+    // Measures the presents displayed so far without blocking
+    void poll(VkSwapchainKHR swapchain);
+    // After the swapchain was recreated
+    void reset();
+
+    // 0 until a present has been seen displayed
+    double getLatencyMs() const { return m_filteredMs; }
+    double getLastLatencyMs() const { return m_lastMs; }
+
+private:
+    static constexpr double kSmoothing = 0.1;   // Weight of the newest frame in the filtered latency
+    static constexpr uint32_t kMaxPending = 8;  // Presents tracked until seen displayed
+
+    struct Pending
+    {
+        uint64_t id = 0;
+        Clock::time_point inputTime;
+    };
+
+    void recordDisplayed(const Pending &pending, Clock::time_point now);
+
+    VkDevice m_device;
+    PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+
+    VkPresentIdKHR m_presentIdInfo{};
+    uint64_t m_presentId = 0; // Latest id handed out; pointed to by m_presentIdInfo
+
+    std::array<Pending, kMaxPending> m_pending{};
+    uint32_t m_pendingFirst = 0;
+    uint32_t m_pendingCount = 0;
+
+    double m_filteredMs = 0.0;
+    double m_lastMs = 0.0;
+};
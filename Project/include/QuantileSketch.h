@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// QUANTILE SKETCH
+// ============================================================================
+// Streaming quantile estimate with bounded relative error (DDSketch-style):
+// positive values are counted in logarithmic buckets whose bounds grow by
+// gamma = (1 + a) / (1 - a), so any quantile is within a fraction 'a' of the
+// exact sample at that rank. Memory depends on the range of values seen, not
+// how many: frame times between 1 and 100 ms take ~460 buckets at a = 0.5%.
+// Sketches with the same accuracy merge by adding counts, so repeats of one
+// config aggregate without keeping their samples.
+
+class QuantileSketch
+{
+public:
+    static constexpr double kDefaultAccuracy = 0.005;
+
+    explicit QuantileSketch(double relativeAccuracy = kDefaultAccuracy);
+
+    // Values at or below kMinValue (zero, negative) are counted as zero
+    void add(double value);
+    // 'other' must use the same accuracy
+    void merge(const QuantileSketch &other);
+    void clear();
+
+    // q in [0, 1], nearest rank below q * (count - 1), like WaterTestingSystem::calculatePercentile.
+    // 0 when empty; q = 0 and q = 1 are the exact min and max
+    double quantile(double q) const;
+
+    uint64_t count() const { return m_count; }
+    double min() const { return m_min; }
+    double max() const { return m_max; }
+
+private:
+    static constexpr double kMinValue = 1e-9;
+
+    int32_t bucketIndex(double value) const;
+
+    double m_accuracy;
+    double m_gamma;
+    double m_logGamma;
+
+    std::vector<uint64_t> m_buckets; // m_buckets[i] counts bucket m_firstIndex + i
+    int32_t m_firstIndex = 0;
+    uint64_t m_zeroCount = 0;
+    uint64_t m_count = 0;
+    double m_min = 0.0;
+    double m_max = 0.0;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Scene;
+class MaterialTable;
+
+// ============================================================================
+// RAY-QUERY SCENE
+// ============================================================================
+// The scene as acceleration structures, for the ray-traced reflection tier:
+// water_rq.frag (water.frag built with RAY_QUERY) traces the reflected and the
+// refracted ray from each surface fragment through VK_KHR_ray_query, so the
+// planar Reflection pass and the Refraction pass are not rendered at all above
+// water and the scene is drawn once, by the main pass.
+//
+//  - One bottom-level structure per mesh, over its level 0 in the shared
+//    vertex/index buffers, built once: the packed positions (Vertex.h) are
+//    used as they are, and each instance's transform is its modelMatrix(),
+//    which undoes the quantisation like the draws do.
+//  - One top-level structure over every object, invisible ones masked out,
+//    mirroring the scene's culling BVH: rebuilt when objects are added, and
+//    only refit (updated in place) when transforms or visibility change. A
+//    refit loses trace quality as objects move, so every kRefitsPerRebuild-th
+//    change rebuilds it instead.
+//  - Hits are shaded from the material's base colour and the interpolated
+//    vertex normal, lit by the sun and the sky's ambient: the reflection
+//    shows the scene's shapes and colours, not its textures or shadows.
+//
+// Water set bindings kWaterBinding..+3: the top-level structure, the objects'
+// shading data (RayObject), and the scene's vertex and index buffers as
+// storage buffers. They only exist in the layout on devices with the tier.
+// Underwater the surface shows Snell's window from the refraction target and
+// nothing is traced.
+//
+// Needs the acceleration structure and ray query extensions, buffer device
+// addresses, and R16G16B16A16_UNORM as a build vertex format. Not with a
+// device group: device addresses across its GPUs are a feature of their own.
+
+class RayQueryScene
+{
+public:
+    static constexpr uint32_t kWaterBinding = 12; // Then RayObjects, vertices, indices
+    static constexpr uint32_t kWaterBindingCount = 4;
+    static constexpr uint32_t kRefitsPerRebuild = 64;
+    // What the scene's vertex and index buffers need on top of their own usage
+    static constexpr VkBufferUsageFlags kGeometryUsage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+                                                         VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    static const std::vector<const char *> &extensions();
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+    struct Features
+    {
+        VkPhysicalDeviceAccelerationStructureFeaturesKHR accelerationStructure{};
+        VkPhysicalDeviceRayQueryFeaturesKHR rayQuery{};
+    };
+    // Enables the features in front of 'next'; returns the new head of the chain. 'features' must outlive
+    // vkCreateDevice, which must also enable VkPhysicalDeviceVulkan12Features::bufferDeviceAddress
+    static void *enableFeatures(Features &features, void *next);
+
+    RayQueryScene(VkDevice device, VkPhysicalDevice physicalDevice);
+    ~RayQueryScene(); // The device must be idle
+
+    RayQueryScene(const RayQueryScene &) = delete;
+    RayQueryScene &operator=(const RayQueryScene &) = delete;
+
+    // The device must be idle. After the scene's geometry buffers were (re)created, with kGeometryUsage:
+    // sizes and creates every structure, built by the next recordUpdate. Write the descriptors again
+    void setGeometry(const Scene &scene, const MaterialTable &materials, VkBuffer vertexBuffer, VkBuffer indexBuffer);
+    // Points the water set's bindings at the structures and buffers; after setGeometry
+    void writeDescriptors(VkDescriptorSet waterSet) const;
+    bool hasGeometry() const { return m_tlas.handle != VK_NULL_HANDLE; }
+
+    // Outside any render pass, before the first trace of the frame: builds what setGeometry created,
+    // then rebuilds or refits the top level if the objects moved. frameIndex picks the instance buffer
+    void recordUpdate(VkCommandBuffer cmd, uint32_t frameIndex, const Scene &scene);
+
+    uint32_t getRefitCount() const { return m_refitCount; }
+    uint32_t getRebuildCount() const { return m_rebuildCount; }
+
+private:
+    static constexpr uint32_t kFramesInFlight = 3; // Instance buffers, at least MAX_FRAMES_IN_FLIGHT
+
+    // Mirrors RayObject in water.frag
+    struct RayObject
+    {
+        glm::vec4 baseColor;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t pad[2];
+    };
+
+    struct Structure
+    {
+        VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceAddress address = 0;
+    };
+
+    void loadFunctions();
+    Structure createStructure(VkAccelerationStructureTypeKHR type, VkDeviceSize size);
+    void destroyStructure(Structure &structure);
+    void destroyGeometry();
+    VkDeviceAddress getAddress(VkBuffer buffer) const;
+    void writeInstances(uint32_t frameIndex, const Scene &scene);
+
+    VkDevice m_device;
+    VkPhysicalDevice m_physicalDevice;
+    VkDeviceSize m_scratchAlignment = 1;
+
+    PFN_vkCreateAccelerationStructureKHR m_createStructure = nullptr;
+    PFN_vkDestroyAccelerationStructureKHR m_destroyStructure = nullptr;
+    PFN_vkGetAccelerationStructureBuildSizesKHR m_getBuildSizes = nullptr;
+    PFN_vkGetAccelerationStructureDeviceAddressKHR m_getStructureAddress = nullptr;
+    PFN_vkCmdBuildAccelerationStructuresKHR m_cmdBuild = nullptr;
+
+    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+
+    // Per mesh; each build's scratch at its own offset, so they all run at once
+    std::vector<Structure> m_blas;
+    std::vector<VkAccelerationStructureGeometryKHR> m_blasGeometry;
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR> m_blasRanges;
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> m_blasBuilds;
+    bool m_blasBuilt = false;
+
+    // Per object
+    Structure m_tlas;
+    uint32_t m_instanceCount = 0;
+    VkBuffer m_instanceBuffers[kFramesInFlight] = {};
+    VkAccelerationStructureInstanceKHR *m_instances[kFramesInFlight] = {};
+    VkDeviceAddress m_instanceAddresses[kFramesInFlight] = {};
+    VkBuffer m_objectBuffer = VK_NULL_HANDLE;
+    VkBuffer m_scratchBuffer = VK_NULL_HANDLE; // The bottom-level builds', then reused by the top level's at 0
+    VkDeviceAddress m_scratchAddress = 0;
+
+    bool m_tlasBuilt = false;
+    uint64_t m_builtTransformVersion = 0;
+    uint32_t m_refitsSinceRebuild = 0;
+    uint32_t m_refitCount = 0;
+    uint32_t m_rebuildCount = 0;
+};
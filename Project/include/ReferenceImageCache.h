@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "FrameReadback.h"
+#include "WaterTestingSystem.h"
+
+// ============================================================================
+// REFERENCE IMAGE CACHE
+// ============================================================================
+// Ground truth for the image-quality runs: what the scene of a test frame
+// looks like rendered with every quality setting at its highest and many
+// jittered samples per pixel (TiledCapture.h), stored once as lossless PNG and
+// compared against the frames a run renders at its own settings.
+//
+//  - Keyed by the scene (hashScene: what decides the picture and not how it
+//    is rendered - turbidity, depth, light motion, the camera path, the run's
+//    length and the frame size), the camera keyframe the frame falls after
+//    and the clock frame. A config's rendering tier is not in the key: every
+//    tier of one scene compares against the same references.
+//  - Only FixedStep runs have references: the clock frame alone then fixes
+//    the animation time, as the renderer reproduces it when rendering them.
+//  - Files live under <directory>/<scene hash>/; a background thread decodes
+//    them ahead of a run (prefetch) and encodes new ones, and decoded images
+//    stay resident up to kMaxResidentBytes, least recently used dropped first.
+//
+// find() never touches the disk, so the comparison at a test frame never
+// waits on a decode; a reference not yet resident is skipped for that frame.
+
+struct ReferenceKey
+{
+    uint64_t sceneHash = 0;
+    uint32_t keyframe = 0;
+    uint32_t frame = 0;
+
+    bool operator<(const ReferenceKey &other) const
+    {
+        return std::tie(sceneHash, keyframe, frame) < std::tie(other.sceneHash, other.keyframe, other.frame);
+    }
+};
+
+class ReferenceImageCache
+{
+public:
+    static constexpr uint32_t kFrameInterval = 10;           // Every kFrameInterval-th measured frame has a reference
+    static constexpr uint32_t kDefaultSamples = 16;          // Jittered frames averaged per reference
+    static constexpr size_t kMaxResidentBytes = 256ull << 20; // Decoded RGBA8
+
+    explicit ReferenceImageCache(std::string directory = "references");
+    ~ReferenceImageCache(); // Finishes queued writes
+
+    ReferenceImageCache(const ReferenceImageCache &) = delete;
+    ReferenceImageCache &operator=(const ReferenceImageCache &) = delete;
+
+    // fixedStep: the FixedStep clock's seconds per frame, which the animation at a frame depends on
+    static uint64_t hashScene(const WaterTestConfig &config, const DeterministicCameraPath &path, VkExtent2D extent,
+                              double fixedStep);
+    static ReferenceKey makeKey(uint64_t sceneHash, const DeterministicCameraPath &path, uint32_t frame, int totalFrames);
+    // The config's scene at the highest quality of every setting; the device clamps what it lacks
+    static WaterTestConfig referenceConfig(const WaterTestConfig &config);
+    // The clock frames of a run of 'config' that are compared, none unless it runs on the FixedStep clock
+    static std::vector<uint32_t> referenceFrames(const WaterTestConfig &config);
+    static bool isReferenceFrame(const WaterTestConfig &config, uint32_t frame);
+
+    const std::string &getDirectory() const { return m_directory; }
+    std::string getPath(const ReferenceKey &key) const;
+    bool exists(const ReferenceKey &key) const; // On disk or waiting to be written
+
+    // Queues the decode of a stored reference that is not resident
+    void prefetch(const ReferenceKey &key);
+    // Resident references only; null otherwise
+    std::shared_ptr<const FrameReadbackImage> find(const ReferenceKey &key);
+    // Resident at once; written to disk by the background thread
+    void store(const ReferenceKey &key, FrameReadbackImage image);
+
+    uint32_t getPendingJobs() const;
+    size_t getResidentBytes() const;
+
+private:
+    struct Job
+    {
+        ReferenceKey key;
+        std::shared_ptr<const FrameReadbackImage> image; // Non-null: encode, else decode
+    };
+
+    struct Entry
+    {
+        std::shared_ptr<const FrameReadbackImage> image;
+        std::list<ReferenceKey>::iterator lru;
+    };
+
+    void workerLoop();
+    void insertLocked(const ReferenceKey &key, std::shared_ptr<const FrameReadbackImage> image);
+
+    std::string m_directory;
+
+    std::thread m_worker;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Job> m_jobs;
+    uint32_t m_working = 0;
+    bool m_stop = false;
+
+    std::map<ReferenceKey, Entry> m_resident;
+    std::list<ReferenceKey> m_lru; // Most recently used first
+    std::map<ReferenceKey, bool> m_queued; // Decodes and encodes not yet done; true: an encode
+    size_t m_residentBytes = 0;
+};
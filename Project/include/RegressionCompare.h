@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+struct TestRunResult;
+
+// ============================================================================
+// REGRESSION COMPARE
+// ============================================================================
+// Compares the frame times of a candidate suite against a baseline, config by
+// config (matched on WaterTestConfig::name). Warmup frames are dropped and
+// outliers removed per run with the rule aggregateMetrics uses; the remaining
+// frames of all repeats are pooled. A config regresses when a one-sided
+// Mann-Whitney U test says the candidate is slower (p below the significance
+// level) and its mean or p99 grew beyond the thresholds. Configs the
+// candidate lost fail the comparison; new ones are reported only.
+//
+// Frame times come from a frame log (.xrfm), the log's CSV conversion, or the
+// runs of a suite still in memory.
+
+// Cleaned frame times per config name
+using FrameTimeSamples = std::map<std::string, std::vector<double>>;
+
+struct RegressionThresholds
+{
+    double maxMeanIncreasePct = 5.0;
+    double maxP99IncreasePct = 10.0;
+    double significance = 0.01; // One-sided p-value below which the slowdown counts
+};
+
+enum class RegressionVerdict
+{
+    Pass,
+    Regressed,
+    MissingInCandidate, // Fails
+    NewInCandidate      // Informational
+};
+
+struct RegressionResult
+{
+    std::string configName;
+    RegressionVerdict verdict = RegressionVerdict::Pass;
+    size_t baselineFrames = 0;
+    size_t candidateFrames = 0;
+    double baselineMean = 0.0;
+    double candidateMean = 0.0;
+    double meanChangePct = 0.0;
+    double baselineP99 = 0.0;
+    double candidateP99 = 0.0;
+    double p99ChangePct = 0.0;
+    double pValue = 1.0; // Candidate slower than baseline
+};
+
+struct RegressionReport
+{
+    RegressionThresholds thresholds;
+    std::vector<RegressionResult> results;
+
+    bool passed() const;
+    int failureCount() const;
+};
+
+namespace RegressionCompare
+{
+    // .xrfm frame log, or a CSV with Config, Run, FrameTime_ms and IsWarmup columns (its
+    // conversion). Appends to 'samples'; false if the file cannot be read
+    bool loadFrameTimes(const std::string &path, FrameTimeSamples &samples);
+    FrameTimeSamples collectFrameTimes(const std::vector<TestRunResult> &runs);
+
+    // One-sided p-value that 'candidate' tends to be larger than 'baseline'
+    // (normal approximation with tie and continuity correction)
+    double mannWhitneyGreater(const std::vector<double> &baseline, const std::vector<double> &candidate);
+
+    RegressionReport compare(const FrameTimeSamples &baseline, const FrameTimeSamples &candidate,
+                             const RegressionThresholds &thresholds = {});
+
+    // One row per config plus a final PASS/FAIL row
+    bool writeReport(const RegressionReport &report, const std::string &csvPath);
+    void printReport(const RegressionReport &report);
+}
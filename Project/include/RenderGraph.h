@@ -0,0 +1,350 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "DynamicRendering.h"
+#include "GpuCounters.h"
+#include "GpuMemoryAllocator.h"
+#include "GpuProfiler.h"
+
+// ============================================================================
+// RENDER GRAPH
+// ============================================================================
+// Frame graph rebuilt every frame: passes are declared in execution order
+// together with the images they read and write, then execute() records the
+// whole frame into one primary command buffer.
+//
+//  - Culling: a pass is only recorded if something alive consumes what it
+//    writes (an image marked as output, or a later pass reading it), or if it
+//    is flagged as having side effects (buffer writes, next frame's data).
+//  - Barriers: every image's layout, last write and readers are tracked, and
+//    the graph emits one batched vkCmdPipelineBarrier before each pass with
+//    only the transitions and hazards that actually occur. Render passes are
+//    created with initialLayout == finalLayout, so all synchronisation is in
+//    those barriers.
+//  - Transients: images created with createImage() are owned by the graph and
+//    drawn from a pool. Logical images with identical descriptions whose
+//    lifetimes do not overlap share one physical image (and its memory);
+//    their store ops become DONT_CARE once nothing reads them afterwards.
+//    Those with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT (MSAA colour, depth
+//    no later pass samples) go in lazily allocated memory where the device
+//    has it: on tile-based GPUs they then live in tile memory only.
+//  - Memory aliasing: the other physical images are placed in memory slots,
+//    one allocation each, and images of any description whose uses in the
+//    frame do not overlap share a slot large enough for them: a target the
+//    frame is done with early lends its memory to one only needed later.
+//    The image using a slot first after another starts from UNDEFINED,
+//    behind a barrier on everything the other did to the memory, in this
+//    frame or the last.
+//  - Render passes and framebuffers are built from the declared attachments
+//    and cached. They are compatible with hand-made render passes using the
+//    same attachment formats, samples and order, so pipelines can still be
+//    created against those. With dynamic rendering enabled
+//    (DynamicRendering.h) attachment passes are begun with
+//    vkCmdBeginRenderingKHR instead, from the same declarations and the same
+//    store-op rules, and no render pass or framebuffer is built for them;
+//    passes whose pipelines only exist for render passes opt out.
+//  - Timings: each alive pass is a GpuProfiler scope named after it, and a
+//    GpuCounters scope when hardware counters are captured.
+//  - Split submissions: splitSubmission() sends the passes declared after it
+//    to a second command buffer, submitted separately on the same queue (so
+//    it can wait on a semaphore the first submission does not, AsyncCompute.h).
+//    Barriers still cover both, as submission order is preserved.
+//  - Overlays: addOverlay() declares a pass that only draws onto one image
+//    (the UI over the frame). When the last pass before it on that image
+//    renders to it as its sole attachment, inline, the overlay is recorded
+//    inside that render pass instead of loading and storing the image again
+//    in one of its own. Its pipelines must then fit that render pass, which
+//    they do if built against a single-colour-attachment pass of the image's
+//    format. Anything else on the image in between (an MSAA resolve, a copy),
+//    or a host begun the other way (dynamic rendering), keeps it a pass of its
+//    own.
+//  - Multiview: a pass given a viewMask (Multiview.h) renders each of its
+//    attachments' layers as one view, in a render pass built with that mask
+//    or vkCmdBeginRenderingKHR's. Transient images get the array layers their
+//    description asks for; barriers always cover every layer.
+//  - Replay: setReplay() records chosen passes again right after themselves,
+//    each repeat behind a full barrier and in its own profiler scope named
+//    after the pass plus kReplaySuffix, for micro-benchmarks (FrameCapture.h).
+//    Passes that execute secondary command buffers are not repeated, as those
+//    may only be executed once per primary.
+
+using RenderGraphResource = uint32_t;
+
+struct RenderGraphImageDesc
+{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent{};
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImageUsageFlags usage = 0;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT; // Depth formats with stencil need both bits
+    uint32_t layers = 1; // More than one: a 2D array, one layer per view of a multiview pass
+
+    bool operator==(const RenderGraphImageDesc &other) const
+    {
+        return format == other.format && extent.width == other.extent.width && extent.height == other.extent.height &&
+               samples == other.samples && usage == other.usage && aspect == other.aspect && layers == other.layers;
+    }
+};
+
+// Last access to an imported image before the frame (initial) or required after it (final).
+// A final layout of UNDEFINED means the contents are not needed once the frame is over.
+struct RenderGraphImageState
+{
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags stages = 0;
+    VkAccessFlags access = 0;
+};
+
+struct RenderGraphPassContext
+{
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE; // Null for compute/transfer passes and under dynamic rendering
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    RenderingFormats formats; // Under dynamic rendering: what secondaries recorded for the pass inherit
+    VkExtent2D extent{};
+    VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE;
+};
+
+struct RenderGraphPassTiming
+{
+    std::string name;
+    bool culled = false;
+    bool merged = false; // An overlay recorded inside the previous pass on its image
+    uint32_t barriers = 0;
+    float gpuMs = 0.0f; // Latest completed frame, from the profiler
+};
+
+struct RenderGraphStats
+{
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t mergedPasses = 0; // Overlays that needed no render pass of their own
+    uint32_t barriers = 0;
+    uint32_t transientImages = 0; // Logical
+    uint32_t physicalImages = 0;  // Backing them this frame
+    VkDeviceSize transientBytes = 0;
+    VkDeviceSize aliasedBytes = 0; // Saved by sharing physical images and memory slots
+    uint32_t memorySlots = 0;      // Backing the physical images outside lazily allocated memory
+    VkDeviceSize lazyBytes = 0;    // Of the physical images' bytes, lazily allocated (committed only if needed)
+};
+
+class RenderGraph
+{
+public:
+    using ExecuteFn = std::function<void(const RenderGraphPassContext &)>;
+
+    static constexpr const char *kReplaySuffix = " #replay";
+
+    class PassBuilder
+    {
+    public:
+        // Attachments, in attachment order: colours, depth, then resolves
+        PassBuilder &color(RenderGraphResource image, VkAttachmentLoadOp loadOp, VkClearColorValue clear = {});
+        PassBuilder &depth(RenderGraphResource image, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clear = {1.0f, 0});
+        PassBuilder &resolve(RenderGraphResource image);
+
+        PassBuilder &sampled(RenderGraphResource image, VkPipelineStageFlags stages,
+                             VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        PassBuilder &storage(RenderGraphResource image, VkPipelineStageFlags stages, bool write);
+        // Copied from by the pass (readbacks); a pass with no attachments records no render pass
+        PassBuilder &transferSource(RenderGraphResource image);
+        // Copied into by the pass, which overwrites all of what it keeps of the image
+        PassBuilder &transferDestination(RenderGraphResource image);
+
+        // Begin the render pass with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+        PassBuilder &secondaryContents(bool secondary);
+        // Never culled
+        PassBuilder &sideEffect();
+        // Begun with a render pass even under dynamic rendering, for pipelines only built against one (ImGui's)
+        PassBuilder &renderPassOnly();
+        // Renders every view in the mask at once; the pipelines drawn must be built with the same mask
+        PassBuilder &viewMask(uint32_t mask);
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph &graph, uint32_t passIndex) : m_graph(graph), m_passIndex(passIndex) {}
+
+        RenderGraph &m_graph;
+        uint32_t m_passIndex;
+    };
+
+    // Passes go untimed without a profiler, and uncounted without counters
+    RenderGraph(VkDevice device, uint32_t frameCount, GpuProfiler *profiler, GpuCounters *counters = nullptr);
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph &) = delete;
+    RenderGraph &operator=(const RenderGraph &) = delete;
+
+    // Drops last frame's declarations; the frame's fence must have signalled
+    void beginFrame(uint32_t frameIndex);
+
+    RenderGraphResource importImage(const char *name, VkImage image, VkImageView view, const RenderGraphImageDesc &desc,
+                                    const RenderGraphImageState &initial, const RenderGraphImageState &final);
+    // Graph-owned, valid for this frame only; must be written before it is read
+    RenderGraphResource createImage(const char *name, const RenderGraphImageDesc &desc);
+    // Whatever writes the image is kept alive
+    void markOutput(RenderGraphResource image);
+
+    PassBuilder addPass(const char *name, ExecuteFn execute);
+    // Draws onto 'target' (loaded, then stored), merged into the previous pass on it where possible
+    PassBuilder addOverlay(const char *name, RenderGraphResource target, ExecuteFn execute);
+    // Passes declared from here on are recorded into execute()'s second command buffer; later calls are ignored
+    void splitSubmission();
+
+    // Culls, allocates transients and records every alive pass with its barriers. Without a
+    // second command buffer everything, including the passes after a split, goes into 'cmd'
+    void execute(VkCommandBuffer cmd, VkCommandBuffer afterSplit = VK_NULL_HANDLE);
+
+    // While a pass executes: the image behind a resource (a transient's is only assigned by execute())
+    VkImage getImage(RenderGraphResource image) { return resource(image).image; }
+
+    // Every frame until changed, each named pass is recorded 'repeat' more times; an empty list stops it
+    void setReplay(std::vector<std::string> passes, uint32_t repeat);
+
+    // Releases cached render passes, framebuffers and transient images; the device must be idle
+    void invalidate();
+
+    const std::vector<RenderGraphPassTiming> &getPassTimings() const { return m_timings; }
+    const RenderGraphStats &getStats() const { return m_stats; }
+
+private:
+    enum class UseType
+    {
+        Color,
+        Depth,
+        Resolve,
+        Sampled,
+        Storage,
+        Transfer
+    };
+
+    struct ImageUse
+    {
+        RenderGraphResource image;
+        UseType type;
+        VkImageLayout layout;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        bool read;
+        bool write;
+        VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        VkClearValue clear{};
+    };
+
+    struct Pass
+    {
+        std::string name;
+        ExecuteFn execute;
+        std::vector<ImageUse> uses;
+        bool secondary = false;
+        bool sideEffect = false;
+        bool renderPassOnly = false;
+        uint32_t viewMask = 0;
+        bool alive = false;
+        bool overlay = false;
+        uint32_t mergedInto = UINT32_MAX; // Overlays: the pass recording them this frame
+        std::vector<uint32_t> overlays;   // Merged into this one, in order
+    };
+
+    // Synchronisation state of one image between uses
+    struct ImageTrack
+    {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags visibleStages = 0; // Stages the last write has been made visible to
+        VkAccessFlags visibleAccess = 0;
+        VkPipelineStageFlags readStages = 0; // Reads since the last write
+    };
+
+    struct PhysicalImage
+    {
+        RenderGraphImageDesc desc;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        bool lazy = false; // In lazily allocated memory
+        int32_t slot = -1; // Its memory slot; lazy images have memory of their own
+        ImageTrack track; // Persists across frames: next frame's first use waits on this one's last
+        uint32_t busyUntil = 0; // Last pass using it this frame, +1; 0 = free
+        uint32_t idleFrames = 0;
+    };
+
+    struct MemorySlot
+    {
+        GpuAllocation allocation; // Null memory: free for a new allocation
+        uint32_t images = 0;      // Physical images bound to it
+        int32_t occupant = -1;    // Physical image that used the memory last, across frames
+        std::vector<std::pair<uint32_t, uint32_t>> busy; // This frame: [first pass, last pass + 1) of each use
+    };
+
+    struct Resource
+    {
+        std::string name;
+        RenderGraphImageDesc desc;
+        bool imported = false;
+        bool output = false;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        RenderGraphImageState final;
+        ImageTrack track;            // Imported images only
+        int32_t physical = -1;       // Transient images only
+        uint32_t firstUse = UINT32_MAX;
+        uint32_t lastUse = 0;
+        uint32_t lastRead = 0;       // Last alive pass reading it, +1; 0 = never read
+    };
+
+    void cullPasses();
+    void assignTransients();
+    void mergeOverlays();
+    uint32_t recordBarriers(VkCommandBuffer cmd, uint32_t passIndex);
+    void recordFinalTransitions(VkCommandBuffer cmd);
+    void recordPass(VkCommandBuffer cmd, uint32_t passIndex);
+    void beginRendering(VkCommandBuffer cmd, uint32_t passIndex, RenderGraphPassContext &context);
+    bool usesDynamicRendering(const Pass &pass) const { return DynamicRendering::isEnabled() && !pass.renderPassOnly; }
+    // Whether an attachment's contents must be stored: a later pass, the next frame or the caller needs them
+    bool keepsContents(uint32_t passIndex, const ImageUse &use) const;
+    void recordReplay(VkCommandBuffer cmd, uint32_t passIndex);
+
+    ImageTrack &trackOf(Resource &resource);
+    bool addBarrier(Resource &resource, const ImageUse &use, std::vector<VkImageMemoryBarrier> &barriers,
+                    VkPipelineStageFlags &srcStages, VkPipelineStageFlags &dstStages);
+
+    VkRenderPass getRenderPass(const Pass &pass);
+    VkFramebuffer getFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView> &views, VkExtent2D extent);
+    // Places it in a slot free over passes [first, end), allocating one if none fits
+    void createPhysicalImage(PhysicalImage &physical, uint32_t first, uint32_t end);
+    void destroyPhysicalImage(PhysicalImage &physical);
+    bool isSlotFree(int32_t slot, uint32_t first, uint32_t end) const;
+    // Before a physical image's use: if another used its memory last, its track starts over from that one's
+    void claimMemory(uint32_t physicalIndex);
+
+    Resource &resource(RenderGraphResource image);
+
+    VkDevice m_device;
+    uint32_t m_frameCount;
+    uint32_t m_frameIndex = 0;
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    uint32_t m_splitPass = UINT32_MAX; // First pass of the second command buffer
+    std::vector<PhysicalImage> m_physicalImages;
+    std::vector<MemorySlot> m_memorySlots;
+
+    std::map<std::vector<uint32_t>, VkRenderPass> m_renderPasses;
+    std::map<std::vector<uint64_t>, VkFramebuffer> m_framebuffers;
+
+    GpuProfiler *m_profiler;
+    GpuCounters *m_counters;
+    std::vector<RenderGraphPassTiming> m_timings;
+
+    std::vector<std::string> m_replayPasses;
+    uint32_t m_replayRepeat = 0;
+
+    RenderGraphStats m_stats;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// ============================================================================
+// RENDER SETTINGS
+// ============================================================================
+// The water and underwater tuning values in one place: what the panel, the
+// test configurations, parameter sweeps and the auto-tuner edit, and what a
+// frame's passes read. VulkanBase keeps a live copy that is edited at any
+// time. Once per frame, before anything is recorded, it takes a snapshot
+// of it. Every pass of the frame reads the snapshot, on whichever thread
+// records it, so an edit made while a frame records (the panel is built
+// then) reaches the next frame whole and never half of this one.
+//
+// hash() covers every field. The snapshot's version moves only when the
+// hash changes, so work derived from the settings is redone only then.
+// Plain values only; a new field must be added to hash() as well.
+
+struct RenderSettings
+{
+    int renderingMode = 0; // Underwater shading: 0=BL, 1=PB, 2=OPT
+
+    // Water surface
+    float waterSpeed = 1.0f;
+    glm::vec3 waterBaseColor = glm::vec3(0.0f, 0.3f, 0.5f);  // Deep blue/cyan base
+    glm::vec3 waterLightColor = glm::vec3(1.0f, 1.0f, 1.0f); // White directional light
+    float waterAmbient = 0.2f;
+    float waterShininess = 512.0f;
+    float waterCausticIntensity = 2.0f;
+    float waterDistortionStrength = 0.04f;
+    float waterFresnelR0 = 0.02f;
+    float waterSurfaceOpacity = 0.55f;
+
+    // Underwater
+    glm::vec3 underwaterShallowColor = glm::vec3(0.0f, 0.6f, 0.8f); // Bright teal
+    glm::vec3 underwaterDeepColor = glm::vec3(0.0f, 0.1f, 0.25f);   // Dark blue; the clear color underwater
+    float oceanBottomCausticIntensity = 1.0f;
+    float underwaterGodRayIntensity = 1.0f;
+    float underwaterScatteringIntensity = 0.5f;
+    float underwaterOpacity = 0.9f;
+    float underwaterFogDensity = 0.05f;
+    // Underwater light shafts (water params' god* fields)
+    float godExposure = 0.6f;
+    float godDecay = 0.96f;
+    float godDensity = 0.5f;
+    float godSampleScale = 1.0f;
+
+    // Marine snow: suspended particles for scale reference
+    float marineSnowIntensity = 0.5f; // 0 = off, 1 = heavy particulates
+    float marineSnowSize = 1.0f;      // Particle size multiplier
+    float marineSnowSpeed = 1.0f;     // Drift speed
+    bool marineSnowParticles = true;  // GPU particles around the camera; off: synthesised by the full-screen passes
+
+    // Chromatic aberration: underwater lens effect
+    float chromaticAberrationStrength = 0.15f;
+
+    // Debug views
+    bool showDebugRays = false;
+    bool showMarineSnowDebug = false; // Highlight particles
+    bool showChromaticDebug = false;  // Exaggerate CA
+
+    // FNV-1a over every field
+    uint64_t hash() const;
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Vertex.h"
+#include "DrawKey.h"
+#include "TransformHierarchy.h"
+#include "ClusteredLights.h"
+
+// ============================================================================
+// SCENE
+// ============================================================================
+// Every scene object's geometry is appended to one shared (mega) vertex/index
+// array that is uploaded once. Objects keep their own transform and material
+// (SceneComponents), so they are drawn, culled and moved one by one: changing
+// a transform never touches the geometry buffers.
+//
+// Draw lists are culled against a view frustum through a BVH over the
+// objects' world-space AABBs. The tree is rebuilt when objects are added and
+// only refit (bounds recomputed, topology kept) when transforms change.
+//
+// The shared vertices are stored packed (PackedVertex, Vertex.h), quantised
+// over each object's bounds; draws use modelMatrix(), which undoes that.
+//
+// Geometry is stored per mesh, and objects are instances of a mesh: objects
+// sharing one have the same index range, quantisation and local bounds, so
+// the sorted draw list puts them next to each other for instanced draws,
+// which carry each instance's model matrix and material.
+//
+// A mesh may carry coarser levels of detail (SceneObject::lods). A view that
+// passes a SceneLodView picks one per drawn object: the coarsest whose error,
+// projected from the object's distance, stays under the view's pixel budget.
+// The view keeps each object's level, and moves to a coarser one only once it
+// fits with some margin, so objects near a threshold do not pop back and forth.
+//
+// Transforms are parent-relative: every object is a node of a
+// TransformHierarchy, a root unless parented to a group (a node drawing
+// nothing) or another object's node. setTransform only flags the node; the
+// world transforms and bounds of the moved subtrees are resolved together by
+// updateTransforms, which updateBvh (and so buildDrawList) calls first.
+// Point lights can hang off nodes as well, carried along with them.
+
+struct Aabb
+{
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    static Aabb empty();
+    void expand(const glm::vec3 &point);
+    void expand(const Aabb &other);
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    Aabb transformed(const glm::mat4 &transform) const;
+};
+
+// Six planes (xyz = inward normal, w = distance) from a view-projection matrix
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    static Frustum fromViewProjection(const glm::mat4 &viewProjection);
+    bool intersects(const Aabb &box) const;
+};
+
+struct SceneCullStats
+{
+    uint32_t nodesVisited = 0;
+    uint32_t objectsTested = 0; // Leaf entries tested individually
+    uint32_t objectsVisible = 0;
+    uint32_t trianglesVisible = 0; // At the levels drawn
+};
+
+// LOD selection state of one view (Scene::buildDrawList)
+struct SceneLodView
+{
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float pixelsPerUnit = 0.0f;  // Pixels covered by one unit at distance one: viewport height * |proj[1][1]| / 2
+    float maxPixelError = 1.0f;  // Budget for a level's projected error
+    std::vector<uint8_t> levels; // Each object's level last frame, for the hysteresis
+};
+
+struct MeshRange
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+};
+
+// Scene objects as dense component arrays, all indexed by object index. What the instances of a mesh
+// share (index range, local bounds, dequantize, levels) lives once with the mesh, not per object; the
+// culling, LOD and draw list passes each stream through only the arrays they read
+struct SceneComponents
+{
+    std::vector<glm::mat4> transforms; // World, resolved from the hierarchy
+    std::vector<Aabb> worldBounds;
+    std::vector<uint32_t> meshes;
+    std::vector<uint32_t> materials;
+    std::vector<uint8_t> visible;
+    std::vector<uint32_t> nodes; // In the scene's TransformHierarchy
+
+    uint32_t size() const { return static_cast<uint32_t>(meshes.size()); }
+};
+
+// One entry of the per-frame draw list
+struct SceneDraw
+{
+    uint32_t objectIndex = 0;
+    uint32_t uniformOffset = 0; // Dynamic offset of the object's UBO in the uniform arena
+    // Instanced draws: objectIndex is the first of instanceCount visible objects of the same mesh, whose
+    // per-instance data (GpuCullObject layout) starts at instanceOffset in the uniform arena
+    uint32_t instanceCount = 1;
+    uint32_t instanceOffset = 0;
+    // Indices of the level drawn: the object's mesh range unless a LOD was selected
+    MeshRange range;
+    uint32_t lod = 0;
+    float depth = 0.0f;   // Of the object's centre in the view (buildDrawList); a batch keeps its nearest instance's
+    uint64_t sortKey = 0; // DrawKey layout
+};
+
+class Scene
+{
+public:
+    // Appends the object's geometry to the shared arrays as a mesh of its own, returns the object's index
+    uint32_t addObject(const SceneObject &object);
+
+    // Appends the geometry only (its transform and material are ignored), returns the mesh index
+    uint32_t addMesh(const SceneObject &geometry);
+    // A new object drawing an already added mesh, returns its index
+    uint32_t addInstance(uint32_t meshIndex, const glm::mat4 &transform, uint32_t materialId);
+    // Every mesh of the description, then its instances
+    void add(const SceneDescription &description);
+    void clear();
+
+    // Relative to the object's parent node; takes effect at the next updateTransforms
+    void setTransform(uint32_t objectIndex, const glm::mat4 &transform);
+    void setVisible(uint32_t objectIndex, bool visible);
+
+    // A hierarchy node drawing nothing, for moving the objects parented to it together; returns the node
+    uint32_t addGroup(const glm::mat4 &transform, uint32_t parentNode = TransformHierarchy::kNoParent);
+    // parentNode: a group's or another object's node, or kNoParent for a root
+    void setParent(uint32_t objectIndex, uint32_t parentNode);
+    uint32_t getObjectNode(uint32_t objectIndex) const { return m_objects.nodes[objectIndex]; }
+    // Local transforms of groups can be set here directly; objects go through setTransform
+    TransformHierarchy &getHierarchy() { return m_transforms; }
+    // Writes the world transform and bounds of every object whose node moved; called by updateBvh
+    void updateTransforms();
+
+    // A light following the node: its position is in the node's space. Returns the light's index
+    uint32_t addLight(uint32_t node, const PointLight &light);
+    void setLight(uint32_t lightIndex, const PointLight &light);
+    // Appends every light, positioned in world space, for ClusteredLights
+    void gatherLights(std::vector<PointLight> &outLights);
+
+    // Visible objects inside the frustum, sorted by mesh and level, then front to back: the instances of
+    // a mesh drawn at the same level are adjacent, ready to be merged into instanced draws. Without
+    // 'lod' every object draws level 0
+    void buildDrawList(const glm::mat4 &viewProjection, std::vector<SceneDraw> &outDraws, SceneLodView *lod = nullptr);
+    // Stable radix sort on SceneDraw::sortKey
+    void sortDraws(std::vector<SceneDraw> &draws);
+
+    // Called lazily by buildDrawList; exposed so loading code can pay the cost up front
+    void updateBvh();
+    const SceneCullStats &getLastCullStats() const { return m_lastCullStats; }
+
+    const std::vector<PackedVertex> &getVertices() const { return m_vertices; }
+    const std::vector<uint32_t> &getIndices() const { return m_indices; }
+    const SceneComponents &getComponents() const { return m_objects; }
+    const glm::mat4 &getTransform(uint32_t objectIndex) const { return m_objects.transforms[objectIndex]; }
+    // The world transform with the mesh's dequantize: packed positions to world space, what draws use
+    glm::mat4 getModelMatrix(uint32_t objectIndex) const { return m_objects.transforms[objectIndex] * m_meshes[m_objects.meshes[objectIndex]].dequantize; }
+    const Aabb &getWorldBounds(uint32_t objectIndex) const { return m_objects.worldBounds[objectIndex]; }
+    uint32_t getMeshIndex(uint32_t objectIndex) const { return m_objects.meshes[objectIndex]; }
+    uint32_t getMaterialId(uint32_t objectIndex) const { return m_objects.materials[objectIndex]; }
+    bool isVisible(uint32_t objectIndex) const { return m_objects.visible[objectIndex] != 0; }
+    uint32_t getObjectCount() const { return m_objects.size(); }
+    uint32_t getMeshCount() const { return static_cast<uint32_t>(m_meshes.size()); }
+    uint32_t getLodCount(uint32_t meshIndex) const { return static_cast<uint32_t>(m_meshes[meshIndex].lods.size()); }
+    const MeshRange &getMeshRange(uint32_t meshIndex) const { return m_meshes[meshIndex].range; } // Level 0
+    bool empty() const { return m_objects.size() == 0; }
+    // Changes whenever updateTransforms moves an object and on every change of visibility, for consumers keeping their own copy
+    uint64_t getTransformVersion() const { return m_transformVersion; }
+
+private:
+    // What the instances of one mesh share
+    struct SceneMesh
+    {
+        MeshRange range;
+        Aabb localBounds;
+        glm::mat4 dequantize = glm::mat4(1.0f);
+        std::vector<MeshLod> lods; // At least level 0 (range); firstIndex into m_indices
+    };
+
+    struct BvhNode
+    {
+        Aabb bounds;
+        uint32_t left = 0;      // Interior: left child; right child follows its subtree
+        uint32_t right = 0;
+        uint32_t firstItem = 0; // Leaf: first entry in m_bvhItems
+        uint32_t itemCount = 0; // 0 for interior nodes
+    };
+
+    static constexpr uint32_t kBvhLeafSize = 2;
+    // A coarser level is only taken once its projected error is this fraction of the budget
+    static constexpr float kLodHysteresis = 0.75f;
+
+    void buildBvh();
+    uint32_t buildBvhNode(uint32_t first, uint32_t count);
+    void refitBvh();
+    uint32_t selectLod(uint32_t objectIndex, const SceneLodView &view, uint32_t current) const;
+
+    std::vector<PackedVertex> m_vertices;
+    std::vector<uint32_t> m_indices;
+    std::vector<SceneMesh> m_meshes;
+    SceneComponents m_objects;
+
+    static constexpr uint32_t kNoObject = ~0u;
+    TransformHierarchy m_transforms;
+    std::vector<uint32_t> m_nodeObjects; // Per node, kNoObject for groups
+
+    // Light components, dense: the node each one follows, and the light in its space
+    std::vector<uint32_t> m_lightNodes;
+    std::vector<PointLight> m_lights;
+
+    std::vector<BvhNode> m_bvhNodes;  // Children always stored after their parent
+    std::vector<uint32_t> m_bvhItems; // Object indices, grouped by leaf
+    bool m_bvhNeedsBuild = true;
+    bool m_bvhNeedsRefit = false;
+    uint64_t m_transformVersion = 0;
+
+    SceneCullStats m_lastCullStats;
+
+    std::vector<DrawKey::Entry> m_sortEntries;
+    std::vector<DrawKey::Entry> m_sortScratch;
+    std::vector<SceneDraw> m_drawScratch;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "RenderGraph.h"
+
+// How the water surface finds what it reflects, chosen per rendering mode
+enum class ReflectionMode
+{
+    Planar = 0,      // The Reflection pass re-renders the scene from the mirrored camera
+    ScreenSpace = 1, // water.frag traces the refraction pass' depth/colour, the sky where rays miss
+    RayQuery = 2     // water_rq.frag traces both rays through the scene's acceleration structures (RayQueryScene.h)
+};
+
+// ============================================================================
+// SCREEN-SPACE REFLECTIONS
+// ============================================================================
+// Replaces the planar Reflection pass, a second full render of the scene, with
+// a trace through the scene the Refraction pass already renders from the main
+// camera (everything but the water). That pass renders into the depth target
+// owned here instead of a transient; a compute pass after it reduces the depth
+// into a pyramid of the *nearest* depth per texel (GpuCulling's Hi-Z keeps the
+// farthest, for occlusion). water.frag marches the reflected ray in screen
+// space over the pyramid: a coarse texel whose nearest surface lies behind the
+// ray is skipped whole, so a ray crossing open screen takes a handful of steps.
+// A hit reads the refraction colour; rays leaving the screen, passing behind
+// everything or running out of steps fall back to the prefiltered sky.
+//
+//  - Pyramid: r32f, full extent, kept in GENERAL; sampled by water.frag
+//    through set 1, binding kWaterBinding.
+//  - Dynamic resolution renders the refraction pass into the top-left corner;
+//    the unrendered rest is cleared to the far plane, which only reads as sky.
+//  - Underwater the surface shows Snell's window instead and nothing is traced.
+//
+// Same requirement as the Hi-Z build: a multisampled depth format that can be
+// sampled. isAvailable() is false otherwise and every mode stays planar.
+
+class ScreenSpaceReflections
+{
+public:
+    static constexpr uint32_t kWaterBinding = 8;
+
+    // extent/depthFormat/samples: those of the main pass' depth attachment
+    ScreenSpaceReflections(VkDevice device, VkExtent2D extent, VkFormat depthFormat, VkSampleCountFlagBits samples,
+                           bool depthSampleable);
+    ~ScreenSpaceReflections(); // The device must be idle
+
+    ScreenSpaceReflections(const ScreenSpaceReflections &) = delete;
+    ScreenSpaceReflections &operator=(const ScreenSpaceReflections &) = delete;
+
+    // Device idle; the water set must be rewritten afterwards (getPyramidView() changes)
+    void resize(VkExtent2D extent);
+    // Built at construction; call again to rebuild them from shaders/hiz_depth.comp.spv and hiz_reduce.comp.spv
+    void createPipelines();
+
+    bool isAvailable() const { return m_available; }
+
+    // For the water set: all mips, GENERAL
+    VkImageView getPyramidView() const { return m_pyramidView; }
+    VkSampler getSampler() const { return m_sampler; }
+
+    // The refraction pass' depth attachment, read by the pyramid build
+    RenderGraphResource importDepth(RenderGraph &graph) const;
+    // Outside a render pass, depth in DEPTH_STENCIL_READ_ONLY_OPTIMAL; leaves the pyramid visible to fragment shaders
+    void recordPyramidBuild(VkCommandBuffer cmd) const;
+
+private:
+    static constexpr uint32_t kGroupSize = 8;
+    static constexpr uint32_t kMaxMips = 16;
+
+    void createTargets(VkExtent2D extent);
+    void destroyTargets();
+
+    VkDevice m_device;
+    VkFormat m_depthFormat;
+    VkSampleCountFlagBits m_samples;
+    bool m_available = false;
+
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_depthPipeline = VK_NULL_HANDLE;  // Multisampled depth -> mip 0
+    VkPipeline m_reducePipeline = VK_NULL_HANDLE; // Mip n-1 -> mip n
+
+    VkExtent2D m_extent{};
+    VkImage m_depthImage = VK_NULL_HANDLE;
+    VkImageView m_depthView = VK_NULL_HANDLE;
+    VkImage m_pyramidImage = VK_NULL_HANDLE;
+    VkImageView m_pyramidView = VK_NULL_HANDLE;
+    std::vector<VkImageView> m_mipViews;
+    std::vector<VkDescriptorSet> m_sets; // One per mip: source, destination
+    uint32_t m_mipCount = 0;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Command/CommandPool.h"
+#include "DynamicRendering.h"
+#include "FrameArena.h"
+
+class JobSystem;
+
+// ============================================================================
+// SECONDARY COMMAND RECORDER
+// ============================================================================
+// Records the contents of a render pass as independent jobs on the job
+// system's threads. Each thread owns one command pool per frame in flight
+// (command pools are externally synchronised, so they can never be shared
+// across threads), and secondary buffers are allocated from it on demand and
+// reused every frame. The primary buffer begins the pass with
+// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS and executes the returned
+// buffers in job order, so the draw order is the same as when recorded inline.
+//
+// No state is inherited by a secondary: every job binds its own pipeline,
+// descriptor sets and buffers. Only the viewport and scissor, dynamic in every
+// scene pipeline, are set here to cover the pass extent.
+//
+// A job may carry a cache key: a hash (cacheKey()) of every handle, dynamic
+// offset and constant its commands use. Such a job is recorded once per frame
+// in flight into a secondary of its own, kept across frames, and executed
+// again as long as later frames ask for the same key in a pass with the same
+// formats and extent. Static passes (the skybox) then cost nothing to record
+// in steady state. A cached secondary is re-recorded on the calling thread
+// when its key changes, and only after that frame slot's fence has
+// signalled, so it is never pending while it is recorded. Anything that
+// destroys or rewrites what a cached secondary references without changing
+// its key (swapchain recreation, pipeline rebuilds) must call invalidateCache().
+
+class SecondaryCommandRecorder
+{
+public:
+    static constexpr uint32_t kMaxCached = 8; // Cached secondaries per frame in flight
+
+    using RecordFn = std::function<void(VkCommandBuffer)>;
+
+    // One job; a non-zero cacheKey keeps its secondary across frames (see above)
+    struct RecordJob
+    {
+        template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, RecordJob>>>
+        RecordJob(Fn &&fn, uint64_t cacheKey = 0) : record(std::forward<Fn>(fn)), cacheKey(cacheKey) {}
+
+        void operator()(VkCommandBuffer cmd) const { record(cmd); }
+
+        RecordFn record;
+        uint64_t cacheKey = 0;
+    };
+    // A pass' jobs, built in the frame's FrameArena
+    using RecordJobs = FrameVector<RecordJob>;
+
+    // FNV-1a over the bytes of each value (handles, offsets, constants); never 0
+    template <typename... T>
+    static uint64_t cacheKey(const T &...values)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        (hashBytes(hash, values), ...);
+        return hash != 0 ? hash : 1;
+    }
+
+    SecondaryCommandRecorder(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, JobSystem &jobSystem);
+    ~SecondaryCommandRecorder();
+
+    SecondaryCommandRecorder(const SecondaryCommandRecorder &) = delete;
+    SecondaryCommandRecorder &operator=(const SecondaryCommandRecorder &) = delete;
+
+    // Resets the frame's pools; everything recorded for it last time is released. The frame's fence must have signalled
+    void beginFrame(uint32_t frameIndex);
+
+    // Records jobs[i] into outBuffers[i] for the given subpass, in parallel; blocks until all are recorded
+    void record(VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer, VkExtent2D extent,
+                const RecordJobs &jobs, std::vector<VkCommandBuffer> &outBuffers);
+    // The same, for a pass begun with vkCmdBeginRenderingKHR on attachments of these formats
+    void record(const RenderingFormats &formats, VkExtent2D extent, const RecordJobs &jobs,
+                std::vector<VkCommandBuffer> &outBuffers);
+
+    // Statistics a pipeline statistics query active in the primary may count (GpuCounters.h);
+    // 0 unless the device enabled pipelineStatisticsQuery and inheritedQueries
+    void setInheritedStatistics(VkQueryPipelineStatisticFlags statistics) { m_inheritedStatistics = statistics; }
+
+    // Full-extent viewport and scissor; inline passes call it before their jobs
+    static void setViewport(VkCommandBuffer cmd, VkExtent2D extent);
+
+    uint32_t getThreadCount() const { return m_threadCount; }
+
+    // Drops every cached secondary; each is recorded again the next time its job runs. Render thread
+    void invalidateCache();
+
+    // Secondaries recorded since beginFrame(), for the stats overlay; cached ones count when (re)recorded
+    uint32_t getRecordedCount() const;
+    // Cached secondaries executed since beginFrame() without being recorded again
+    uint32_t getReusedCount() const { return m_reusedCount; }
+
+private:
+    struct ThreadPool
+    {
+        CommandPool pool;
+        std::vector<CommandBuffer> buffers;
+        uint32_t used = 0; // Buffers handed out this frame; only touched by the owning thread
+    };
+
+    struct CachedBuffer
+    {
+        CommandBuffer buffer;
+        uint64_t key = 0;      // 0: free
+        uint64_t lastUsed = 0; // m_frameSerial of the last frame that executed it
+    };
+
+    template <typename T>
+    static void hashBytes(uint64_t &hash, const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "cache keys hash plain values");
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (unsigned char byte : bytes)
+        {
+            hash = (hash ^ byte) * 1099511628211ull;
+        }
+    }
+
+    ThreadPool &threadPool(uint32_t threadIndex) { return m_pools[m_frameIndex * m_threadCount + threadIndex]; }
+    void recordJobs(const VkCommandBufferInheritanceInfo &inheritance, uint64_t inheritanceKey, VkExtent2D extent,
+                    const RecordJobs &jobs, std::vector<VkCommandBuffer> &outBuffers);
+    // The frame's secondary for 'key', recorded now unless it already holds it; null when every slot is in use
+    VkCommandBuffer cachedBuffer(uint64_t key, const VkCommandBufferInheritanceInfo &inheritance, VkExtent2D extent,
+                                 const RecordFn &record);
+    static void begin(CommandBuffer &buffer, const VkCommandBufferInheritanceInfo &inheritance,
+                      VkCommandBufferUsageFlags flags, VkExtent2D extent);
+
+    VkDevice m_device;
+    JobSystem &m_jobSystem;
+    uint32_t m_frameCount;
+    uint32_t m_threadCount;
+    uint32_t m_frameIndex = 0;
+    VkQueryPipelineStatisticFlags m_inheritedStatistics = 0;
+
+    std::vector<ThreadPool> m_pools; // [frame * threadCount + thread]
+
+    // Never reset as a whole: a cached secondary outlives the frame that recorded it
+    std::vector<CommandPool> m_cachePools;           // [frame]
+    std::vector<std::vector<CachedBuffer>> m_cached; // [frame], up to kMaxCached each
+    uint64_t m_frameSerial = 0;
+    uint32_t m_reusedCount = 0;
+    uint32_t m_cacheRecordedCount = 0;
+};
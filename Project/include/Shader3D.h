@@ -17,7 +17,6 @@ public:
 
 private:
     VkShaderModule createShaderModule(const std::vector<char>& code);
-    std::vector<char> readFile(const std::string& filename);
 
     VkDevice device;
     VkShaderModule vertShaderModule;
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "UnderwaterWaterPipeline.h"
+#include "WaterPipeline.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// SHADER BENCH
+// ============================================================================
+// Times one water fragment shader at a time, away from the rest of the frame:
+// water.frag over the surface's CDLOD grid, sunrays.frag or underwater_water.frag
+// full screen. The draw is repeated into an offscreen RGBA16F target of each
+// size, between two timestamps, and the result is reported per target pixel.
+//
+//  - The pipelines are the renderer's own WaterPipeline and
+//    UnderwaterWaterPipeline, built by their create() against a single-sample,
+//    colour-only render pass. The low-res effect pipelines are built the same
+//    way. Shaders, specialisation and fixed-function state are the frame's;
+//    the depth test has no attachment and is off.
+//  - The caller binds sets 0 and 1 through BindSets. Ordinary frames
+//    rendered beforehand fill them with the pose and parameters wanted.
+//  - Each sample is one submit through the UploadContext, waited on, of
+//    'repeat' draws. The median sample is the result. Blending makes every
+//    repeat read the pixels the previous one wrote, as the frame's
+//    blended effects do.
+//
+// The surface grid covers only part of the target, so its ns per pixel is per
+// target pixel, not per shaded one. Compare it only against itself.
+
+class ShaderBench
+{
+public:
+    enum class Shader
+    {
+        Water,
+        Sunrays,
+        Underwater
+    };
+
+    // Mirrors WaterPushConstant in VulkanBase::recordCommandBuffer
+    struct alignas(16) PushConstants
+    {
+        float time = 0.0f;
+        float scale = 1.0f;
+        float debugRays = 0.0f;
+        float renderingMode = 1.0f; // 0=BL, 1=PB, 2=OPT; also picks the specialised variant
+    };
+
+    struct Result
+    {
+        Shader shader;
+        VkExtent2D extent;
+        uint32_t repeat = 0;
+        uint32_t samples = 0;
+        double medianMs = 0.0; // All repeats of a sample
+        double minMs = 0.0;
+        double nsPerPixel = 0.0; // Median, per repeat and target pixel
+    };
+
+    static constexpr VkFormat kFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    // Binds sets 0 and 1 with 'layout', their dynamic offsets included
+    using BindSets = std::function<void(VkCommandBuffer cmd, VkPipelineLayout layout)>;
+    // The surface's CDLOD tiles, with water.vert's vertex and instance bindings
+    using DrawGrid = std::function<void(VkCommandBuffer cmd)>;
+
+    static const char *shaderName(Shader shader);
+    // "water", "sunrays" or "underwater"; false for anything else
+    static bool parseShader(const std::string &name, Shader &shader);
+
+    ShaderBench(VkDevice device, VkPhysicalDevice physicalDevice, VkDescriptorSetLayout globalSetLayout,
+                VkDescriptorSetLayout waterSetLayout);
+    ~ShaderBench(); // The device must be idle
+
+    ShaderBench(const ShaderBench &) = delete;
+    ShaderBench &operator=(const ShaderBench &) = delete;
+
+    // One result per size; blocks until every sample has completed
+    std::vector<Result> run(Shader shader, const std::vector<VkExtent2D> &sizes, uint32_t repeat, uint32_t samples,
+                            const PushConstants &push, const BindSets &bindSets, const DrawGrid &drawGrid);
+
+    static bool writeCsv(const std::vector<Result> &results, const std::string &filePath);
+
+private:
+    struct Target
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    };
+
+    void createRenderPass();
+    Target createTarget(VkExtent2D extent) const;
+    void destroyTarget(Target &target) const;
+
+    VkDevice m_device;
+    float m_timestampPeriod = 1.0f; // ns per tick
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    WaterPipeline m_water;
+    WaterPipeline m_sunrays;
+    UnderwaterWaterPipeline m_underwater;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// SHADER HOT RELOAD
+// ============================================================================
+// Watches the GLSL sources and recompiles the ones that change, off the render
+// thread: a watcher polls their write times every kPollInterval and runs the
+// same glslangValidator the `shaders` target uses on each edited file. Output
+// goes to a temporary file that replaces the .spv only when compilation
+// succeeded, so a shader with errors leaves the running one in place (the
+// compiler's messages are on the console). Variants compiled from a source
+// with a define (SHADER_VARIANTS, shaders/CMakeLists.txt) are rebuilt with it.
+//
+// takeCompiled() hands the render thread the .spv names rebuilt since its last
+// call; it rebuilds the pipelines that read them at a frame boundary.
+//
+// Sources are compared with the write times seen at construction, so what the
+// build just compiled is not compiled again.
+
+class ShaderHotReload
+{
+public:
+    static constexpr std::chrono::milliseconds kPollInterval{250};
+
+    // 'outputDir' is where the pipelines read their .spv from
+    ShaderHotReload(std::filesystem::path sourceDir, std::filesystem::path outputDir, std::string compiler);
+    ~ShaderHotReload(); // Joins the watcher; a compile in progress finishes first
+
+    ShaderHotReload(const ShaderHotReload &) = delete;
+    ShaderHotReload &operator=(const ShaderHotReload &) = delete;
+
+    // SPIR-V file names (e.g. "water.frag.spv") written since the last call
+    std::vector<std::string> takeCompiled();
+
+private:
+    static bool isShaderSource(const std::filesystem::path &path);
+
+    void watchLoop();
+    // Sources whose write time differs from the recorded one; records the new times
+    std::vector<std::filesystem::path> findChanged();
+    // 'arguments': extra compiler options, a variant's define and target
+    bool compile(const std::filesystem::path &source, const std::filesystem::path &spirv, const std::string &arguments) const;
+
+    std::filesystem::path m_sourceDir;
+    std::filesystem::path m_outputDir;
+    std::string m_compiler;
+
+    // Watcher only
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_writeTimes;
+
+    std::thread m_watcher;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<std::string> m_compiled;
+    bool m_stop = false;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef XERENDER_EMBED_SHADERS
+#include "EmbeddedShaderNames.h" // Generated by shaders/EmbedShaders.cmake
+#endif
+
+// ============================================================================
+// SHADER REGISTRY
+// ============================================================================
+// Every SPIR-V module the `shaders` target builds, define variants included
+// (SHADER_VARIANTS, shaders/CMakeLists.txt), compiled into the executables
+// (XERENDER_EMBED_SHADERS, on by default). Pipelines ask load() for
+// "shaders/<name>.spv" as they used to ask VkUtils::readFile, and startup
+// reads no shader files. A shader whose source is missing or does not
+// compile fails the build, not the launch.
+//
+// The module names are a sorted constexpr table, so a pipeline can check the
+// modules it is built from at compile time:
+//     static_assert(!ShaderRegistry::kEmbedded || ShaderRegistry::contains("water.frag.spv"));
+//
+// The water pipelines' per-mode variants are specialization constants over
+// one module (WaterVariant), not separate SPIR-V; they need no entries here.
+//
+// Shader hot reload writes new .spv files next to the executable. Once a
+// module has been rebuilt (preferDisk), load() reads it from disk again.
+// Without embedding, load() is VkUtils::readFile.
+
+namespace ShaderRegistry
+{
+#ifdef XERENDER_EMBED_SHADERS
+    inline constexpr bool kEmbedded = true;
+    inline constexpr const auto &kNames = EmbeddedShaders::kNames;
+#else
+    inline constexpr bool kEmbedded = false;
+    inline constexpr std::array<std::string_view, 0> kNames{};
+#endif
+
+    inline constexpr size_t kNotFound = SIZE_MAX;
+
+    // Position of 'name' (e.g. "water.frag.spv") in kNames, or kNotFound; a binary search usable in
+    // constant expressions
+    constexpr size_t indexOf(std::string_view name)
+    {
+        size_t low = 0;
+        size_t high = kNames.size();
+        while (low < high)
+        {
+            const size_t mid = low + (high - low) / 2;
+            if (kNames[mid] < name)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low < kNames.size() && kNames[low] == name ? low : kNotFound;
+    }
+
+    constexpr bool contains(std::string_view name) { return indexOf(name) != kNotFound; }
+
+    // The module at 'path': the embedded copy for "shaders/<name>" unless it was rebuilt since, else the file.
+    // Throws like VkUtils::readFile when neither exists. Any thread
+    std::vector<char> load(const std::string &path);
+
+    // Hot reload wrote a newer 'name' (e.g. "water.frag.spv") to shaders/; load() reads that file from now on
+    void preferDisk(const std::string &name);
+}
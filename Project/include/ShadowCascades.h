@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "RenderGraph.h"
+#include "Scene.h"
+
+// ============================================================================
+// SHADOW CASCADES
+// ============================================================================
+// Cascaded shadow maps for the sun (light 0, treated as a directional light).
+// The camera frustum up to kShadowDistance is split into slices, nearest
+// first, and each slice gets a depth-only orthographic rendering from the sun:
+//
+//  - Fitting: the light volume bounds the slice's bounding sphere, whose size
+//    does not change as the camera turns, and is moved in whole shadow-map
+//    texels so the maps do not shimmer as the camera moves. The volume is
+//    extended towards the sun so casters outside the view still shadow it.
+//  - Round-robin: each cascade keeps the matrix it was last rendered with, so
+//    one can be sampled without being re-rendered. With round-robin on, one
+//    cascade is re-rendered per frame (all of them after a tier or sun change);
+//    3d_shader.frag shades with the first cascade a fragment falls inside.
+//  - Casters are culled once per frame against the union of the cascades due,
+//    and that one draw list is drawn into each of them, as instanced draws of
+//    one mesh each (model matrices as per-instance data, GpuCulling.h).
+//
+// Set 3 of the main pipeline layout: binding 0 the cascade matrices (dynamic
+// uniform buffer, one copy per frame in flight), binding 1 the maps behind a
+// comparison sampler. Each cascade is its own image, imported into the graph.
+
+enum class ShadowQuality
+{
+    Off = 0,
+    Low = 1,    // 2 cascades, 1024^2, one filtered tap
+    Medium = 2, // 3 cascades, 2048^2, 3x3 PCF
+    High = 3    // 4 cascades, 2048^2, 5x5 PCF
+};
+
+class ShadowCascades
+{
+public:
+    static constexpr uint32_t kSetIndex = 3;
+    static constexpr uint32_t kMaxCascades = 4;
+    static constexpr float kShadowDistance = 250.0f;  // Beyond it the sun is unoccluded
+    static constexpr float kCasterExtrusion = 600.0f; // Towards the sun, past the slice's sphere
+
+    ShadowCascades(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount);
+    ~ShadowCascades(); // The device must be idle
+
+    ShadowCascades(const ShadowCascades &) = delete;
+    ShadowCascades &operator=(const ShadowCascades &) = delete;
+
+    // Device idle when the tier changes the cascade count or resolution; every cascade is re-rendered
+    void setQuality(ShadowQuality quality);
+    ShadowQuality getQuality() const { return m_quality; }
+    void setRoundRobin(bool roundRobin) { m_roundRobin = roundRobin; }
+    bool getRoundRobin() const { return m_roundRobin; }
+    // Built at construction; call again to rebuild it from shaders/shadow_depth.vert.spv
+    void createPipeline();
+
+    // Once per frame: fits the slices to the camera and picks the cascades re-rendered this frame.
+    // sunPosition: light 0, the direction towards the sun
+    void update(const glm::vec3 &cameraPosition, const glm::vec3 &front, const glm::vec3 &up, const glm::vec3 &right,
+                float fovY, float aspect, float nearPlane, const glm::vec3 &sunPosition);
+    // Bounds every cascade due this frame: cull the casters with it
+    const glm::mat4 &getCasterViewProjection() const { return m_casterViewProjection; }
+    uint32_t getCascadeCount() const { return m_cascadeCount; }
+    bool isDue(uint32_t cascade) const { return m_due[cascade]; }
+    uint32_t getDueCount() const;
+
+    // After update(): this frame's matrices, returns their dynamic offset for set 3
+    uint32_t writeUniforms(uint32_t frameIndex);
+    VkDescriptorSetLayout getSetLayout() const { return m_setLayout; }
+    VkDescriptorSet getSet() const { return m_set; }
+
+    // Written by the cascade's pass if it is due, sampled by every pass drawing the scene
+    RenderGraphResource importCascade(RenderGraph &graph, uint32_t cascade);
+    // Inside the cascade's depth-only pass, viewport set; the draws' instance data is in instanceBuffer
+    void recordCascade(VkCommandBuffer cmd, uint32_t cascade, const Scene &scene, const std::vector<SceneDraw> &draws,
+                       VkBuffer vertexBuffer, VkBuffer indexBuffer, VkBuffer instanceBuffer) const;
+
+private:
+    struct Tier
+    {
+        uint32_t cascades;
+        uint32_t resolution;
+        uint32_t filterRadius; // PCF kernel half-width in texels
+    };
+    static Tier getTier(ShadowQuality quality);
+
+    // std140 mirror of ShadowInfo in 3d_shader.frag
+    struct ShadowUniforms
+    {
+        glm::mat4 viewProjection[kMaxCascades];
+        glm::vec4 params; // x: cascade count, y: PCF radius, z: texel size in uv
+    };
+
+    struct Cascade
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        glm::mat4 viewProjection = glm::mat4(1.0f); // The one it was last rendered with
+        bool written = false;                       // Holds a rendering: imported as shader-readable
+    };
+
+    void createTargets(uint32_t count, uint32_t resolution);
+    void destroyTargets();
+    void writeSet();
+
+    VkDevice m_device;
+    VkFormat m_format = VK_FORMAT_D16_UNORM;
+
+    ShadowQuality m_quality = ShadowQuality::Off;
+    bool m_roundRobin = true;
+    uint32_t m_cascadeCount = 0;
+    uint32_t m_resolution = 1;
+    uint32_t m_filterRadius = 0;
+    uint32_t m_nextCascade = 0;             // Round-robin cursor
+    glm::vec3 m_lightDirection{0.0f};       // Of the last update; a change re-renders every cascade
+    std::array<Cascade, kMaxCascades> m_cascades{};
+    std::array<bool, kMaxCascades> m_due{};
+    glm::mat4 m_casterViewProjection = glm::mat4(1.0f);
+
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE; // Pipeline compatibility only
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+    VkBuffer m_uniformBuffer = VK_NULL_HANDLE;
+    uint8_t *m_uniformMapped = nullptr;
+    VkDeviceSize m_uniformStride = 0;
+    uint32_t m_frameCount;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "FrameClock.h"
+
+// ============================================================================
+// SIMULATION THREAD
+// ============================================================================
+// Advances the state frames are rendered from - the camera and the simulation
+// clock - on a thread of its own, one step per frame. A step turns the input
+// the main thread sampled (GLFW input can only be read there) into an
+// immutable FrameSnapshot. The render thread copies what it needs out of the
+// snapshot and never writes simulation state back: a camera placed by a test
+// path or the benchmark travels as input like the keys do.
+//
+// Pipelined, step N+1 runs while frame N is recorded from snapshot N, for one
+// frame of extra input latency; otherwise advance() steps inline. Each step
+// advances the FrameClock one frame; a camera path is evaluated at that same
+// frame, so with a fixed or replayed clock frame k of a test run or benchmark
+// always animates at the same time from the same camera, pipelined or not.
+
+struct CameraPose
+{
+    glm::vec3 position{0.0f};
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+};
+
+// Sampled on the main thread, consumed by one step
+struct SimulationInput
+{
+    // Camera::processKeyboard keys, in heldMoveKeys bit order
+    static constexpr int kMoveKeys[6] = {GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E};
+
+    float deltaTime = 0.0f;               // Wall seconds since the previous sample
+    uint32_t heldMoveKeys = 0;            // Bit i: kMoveKeys[i] held
+    glm::vec2 look{0.0f};                 // Mouse movement accumulated since the previous sample
+    float scroll = 0.0f;                  // Likewise the wheel
+    std::optional<CameraPose> cameraPose; // Replaces the camera; the keys and mouse are ignored
+};
+
+// The camera at a clock frame; called on the simulation thread
+using CameraPath = std::function<CameraPose(uint64_t frame)>;
+
+struct FrameSnapshot
+{
+    uint64_t frame = 0;     // Clock frame: steps since the clock was restarted
+    double time = 0.0;      // Clock time, seconds
+    float deltaTime = 0.0f; // The last step's advance
+    Camera camera{glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f};
+};
+
+class SimulationThread
+{
+public:
+    explicit SimulationThread(const Camera &camera);
+    ~SimulationThread(); // Finishes the step in flight
+
+    SimulationThread(const SimulationThread &) = delete;
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    // Both take effect at the next advance()
+    void setPipelined(bool pipelined);
+    // fixedStep: seconds per frame in FixedStep mode (and Replay past the end of its times)
+    void setClockMode(FrameClock::Mode mode, double fixedStep);
+
+    // Once per frame on the render thread: the snapshot to render, valid until the next call.
+    // Starts the next step from 'input'; pipelined, the snapshot is the one stepped from the
+    // previous call's input. Rethrows what a step threw
+    const FrameSnapshot &advance(const SimulationInput &input);
+
+    // Drives the camera from now on, input poses and keys ignored; empty hands it back
+    void setCameraPath(CameraPath path);
+
+    // The next snapshot is clock frame 0 at time 0 (a test run or benchmark starting).
+    // replayTimes: see FrameClock::restart
+    void restartClock(std::vector<double> replayTimes = {});
+    // The times the clock recorded since the last restart (Replay mode without times)
+    std::vector<double> getClockRecording();
+
+private:
+    void run();
+    void step(const SimulationInput &input, FrameClock::Mode clockMode, double fixedStep);
+    void waitForStepLocked(std::unique_lock<std::mutex> &lock);
+    static void applyPose(Camera &camera, const CameraPose &pose);
+
+    // Stepped by the worker while a step is requested, by advance() otherwise
+    FrameSnapshot m_state;
+    FrameClock m_clock;
+    CameraPath m_cameraPath;
+    bool m_restarted = false;  // m_state is frame 0, not yet published
+    FrameSnapshot m_published; // Returned by advance()
+
+    bool m_pipelined = true;
+    FrameClock::Mode m_clockMode = FrameClock::Mode::RealTime;
+    double m_fixedStep = 1.0 / 60.0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_stepped;
+    SimulationInput m_input;
+    FrameClock::Mode m_inputClockMode = FrameClock::Mode::RealTime;
+    double m_inputFixedStep = 0.0;
+    bool m_stepRequested = false;
+    bool m_quit = false;
+    std::exception_ptr m_error;
+    std::thread m_thread;
+};
@@ -1,7 +1,9 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include <memory>
 #include <vector>
 #include <glm/glm.hpp>
+#include "GpuMesh.h"
 
 class SkyboxMesh
 {
@@ -19,23 +21,9 @@ public:
     void draw(VkCommandBuffer cmd) const;
 
 private:
-    VkBuffer vertexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
-
-    VkBuffer indexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
-
-    uint32_t indexCount = 0;
+    std::unique_ptr<GpuMesh> mesh; // 8 corners: 16-bit indices
 
 private:
-    void createCubeData(std::vector<float>& v,
+    void createCubeData(std::vector<glm::vec3>& v,
         std::vector<uint32_t>& i);
-
-    void createBuffer(VkDevice device,
-        VkPhysicalDevice physicalDevice,
-        VkDeviceSize size,
-        VkBufferUsageFlags usage,
-        VkMemoryPropertyFlags properties,
-        VkBuffer& buffer,
-        VkDeviceMemory& memory);
 };
@@ -2,14 +2,24 @@
 #include <vulkan/vulkan.h>
 #include <string>
 
+// The sky is drawn after the opaque scene, at the far plane (z = w) with a
+// LESS_OR_EQUAL test and no depth write: only the pixels nothing covered are
+// shaded. A non-negative lod samples that level of the cube instead of the
+// one the footprint picks: the reflection pass' blurry, cheaper copy.
 class SkyboxPipeline
 {
 public:
+    // Mirrors the Push block of skybox.vert and skybox.frag
+    struct PushConstants
+    {
+        float scale;
+        float lod; // < 0: the implicit level
+    };
+
     SkyboxPipeline() = default;
     ~SkyboxPipeline() = default;
 
     void create(VkDevice device,
-        VkExtent2D swapchainExtent,
         VkRenderPass renderPass,
         VkDescriptorSetLayout globalDescriptorSetLayout,  // set 0
         VkDescriptorSetLayout skyboxDescriptorSetLayout,  // set 1
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// ============================================================================
+// STARTUP TIMER
+// ============================================================================
+// Wall-clock phases of startup, from the renderer's construction to its first
+// presented frame, for the report printed then. initVulkan runs as a short
+// serial chain of phases while the pipeline compiles run on the job system
+// beside them; each of those compiles is a phase of its own, timed on the
+// thread that ran it.
+//
+//  - Scope times one phase. Scopes may overlap and may be opened on any
+//    thread: recording takes a mutex, which startup can afford.
+//  - markFirstFrame() ends the timeline; only the first call counts.
+//  - writeReport() lists the phases in start order with their thread, then
+//    the main thread's and the jobs' totals and the time to the first frame.
+//    Main-thread phases should not nest, so the totals add up.
+
+class StartupTimer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Scope
+    {
+    public:
+        // name: a string literal (the pointer is kept until the report)
+        Scope(StartupTimer &timer, const char *name, uint32_t threadIndex = 0);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        StartupTimer &m_timer;
+        const char *m_name;
+        uint32_t m_threadIndex;
+        Clock::time_point m_start;
+    };
+
+    StartupTimer() : m_start(Clock::now()) {}
+
+    // True the first time only
+    bool markFirstFrame();
+    bool hasFirstFrame() const { return m_firstFrameMs >= 0.0; }
+    double getFirstFrameMs() const { return m_firstFrameMs; }
+
+    void writeReport(std::ostream &out) const;
+
+private:
+    struct Phase
+    {
+        const char *name;
+        uint32_t threadIndex; // JobSystem::getThreadIndex(): 0 for the main thread
+        double startMs;
+        double durationMs;
+    };
+
+    void record(const char *name, uint32_t threadIndex, Clock::time_point start, Clock::time_point end);
+    double sinceStart(Clock::time_point time) const { return std::chrono::duration<double, std::milli>(time - m_start).count(); }
+
+    Clock::time_point m_start;
+    mutable std::mutex m_mutex;
+    std::vector<Phase> m_phases;
+    double m_firstFrameMs = -1.0;
+};
@@ -14,12 +14,20 @@ struct SwapChainSupportDetails {
 class SwapChainManager {
 public:
     SwapChainManager(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, GLFWwindow* window);
+    // Headless: plain images stand in for the swapchain, nothing is presented; getSwapChain() is VK_NULL_HANDLE
+    SwapChainManager(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, uint32_t imageCount);
     ~SwapChainManager();
 
     void createSwapChain();
     void createImageViews();
     void cleanupSwapChain();
 
+    // New swapchain at the current surface extent, created with the old one as oldSwapchain.
+    // The old swapchain and its views are retired, not destroyed: presents queued on them may
+    // still be in flight, so destroyRetired() is called once the frames after it have completed
+    void recreateSwapChain();
+    void destroyRetired();
+
     VkSwapchainKHR getSwapChain() const;
     std::vector<VkImage> getSwapChainImages() const;
     std::vector<VkImageView> getSwapChainImageViews() const;
@@ -27,6 +35,16 @@ public:
     VkExtent2D getSwapChainExtent() const;
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device); 
 
+    // Latency against throughput, taken by the next (re)creation. The preferred mode falls back
+    // IMMEDIATE -> MAILBOX -> FIFO when the surface lacks it; an image count of 0 is minImageCount + 1
+    void setPreferredPresentMode(VkPresentModeKHR mode) { m_preferredPresentMode = mode; }
+    void setPreferredImageCount(uint32_t count) { m_preferredImageCount = count; }
+    VkPresentModeKHR getPresentMode() const { return m_presentMode; }
+    const std::vector<VkPresentModeKHR> &getAvailablePresentModes() const { return m_availablePresentModes; }
+    // The surface's limits at the last creation; max is 0 when unbounded
+    uint32_t getMinImageCount() const { return m_minImageCount; }
+    uint32_t getMaxImageCount() const { return m_maxImageCount; }
+
 private:
     VkDevice m_device;
     VkPhysicalDevice m_physicalDevice;
@@ -34,12 +52,24 @@ private:
     GLFWwindow* m_window;
 
     VkSwapchainKHR m_swapChain;
+    VkSwapchainKHR m_retiredSwapChain = VK_NULL_HANDLE;
+    std::vector<VkImageView> m_retiredImageViews;
+    bool m_offscreen = false;
+    uint32_t m_offscreenImageCount = 0;
     std::vector<VkImage> m_swapChainImages;
     std::vector<VkImageView> m_swapChainImageViews;
     VkFormat m_swapChainImageFormat;
     VkExtent2D m_swapChainExtent;
 
+    VkPresentModeKHR m_preferredPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    std::vector<VkPresentModeKHR> m_availablePresentModes;
+    uint32_t m_preferredImageCount = 0;
+    uint32_t m_minImageCount = 0;
+    uint32_t m_maxImageCount = 0;
+
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
+    void createOffscreenImages();
 };
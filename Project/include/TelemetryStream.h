@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// ============================================================================
+// TELEMETRY STREAM
+// ============================================================================
+// Live frame metrics for machines nobody is looking at: once a second, one UDP
+// datagram of JSON to a collector, with that second's frame, GPU and CPU time
+// histograms, the top-level GPU passes' mean times and the device-local memory
+// budget. UDP sends never block and need no connection, so a missing collector
+// costs nothing.
+//
+//  - The render thread only push()es a fixed-size sample into a single-producer
+//    single-consumer ring: a copy and two atomics, no locks and no allocation.
+//    When the ring is full the sample is dropped and counted.
+//  - A worker thread drains the ring every kDrainMs, aggregates, and sends.
+//  - Memory budgets are queried once a second: wantsMemory() says when the
+//    next sample should carry them.
+//
+// Datagram: {"t": seconds since start, "frames": n, "dropped": n,
+//            "frameMs"/"gpuMs"/"cpuMs": {"mean", "max", "histogram": [counts per kHistogramEdgesMs bucket]},
+//            "passes": {name: mean ms}, "memory": {"usage", "budget"} (bytes, when sampled)}
+
+struct TelemetrySample
+{
+    static constexpr uint32_t kMaxPasses = 24;
+    static constexpr uint32_t kNameLength = 24;
+
+    double frameMs = 0.0; // Completion interval
+    double gpuMs = 0.0;
+    double cpuMs = 0.0;
+    uint32_t passCount = 0;
+    std::array<std::array<char, kNameLength>, kMaxPasses> passNames{}; // Truncated, NUL-terminated
+    std::array<float, kMaxPasses> passMs{};
+    bool hasMemory = false;
+    uint64_t memoryUsage = 0;  // Device-local heaps
+    uint64_t memoryBudget = 0;
+
+    void addPass(const std::string &name, double ms);
+};
+
+class TelemetryStream
+{
+public:
+    static constexpr uint32_t kRingSize = 512; // Seconds of frames at 500 Hz; a power of two
+    static constexpr uint32_t kDrainMs = 100;
+    static constexpr uint32_t kSendIntervalMs = 1000;
+    // Upper bucket edges; the last bucket takes everything above
+    static constexpr std::array<double, 12> kHistogramEdgesMs = {2.0, 4.0, 6.0, 8.0, 10.0, 12.0, 14.0, 16.7, 20.0, 25.0, 33.3, 50.0};
+
+    // 'endpoint' is "host:port"; the worker starts at once. isOpen() is false if the host did not resolve
+    explicit TelemetryStream(const std::string &endpoint);
+    ~TelemetryStream(); // Sends what it has, then stops the worker
+
+    TelemetryStream(const TelemetryStream &) = delete;
+    TelemetryStream &operator=(const TelemetryStream &) = delete;
+
+    bool isOpen() const { return m_socket != kInvalidSocket; }
+    const std::string &getEndpoint() const { return m_endpoint; }
+
+    // Render thread only
+    void push(const TelemetrySample &sample);
+    // The next sample should carry the memory budget; true once per send interval
+    bool wantsMemory() { return m_wantMemory.exchange(false, std::memory_order_relaxed); }
+
+    uint64_t getSentCount() const { return m_sent.load(std::memory_order_relaxed); }
+    uint64_t getDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+#ifdef _WIN32
+    using Socket = uintptr_t;
+    static constexpr Socket kInvalidSocket = ~static_cast<uintptr_t>(0);
+#else
+    using Socket = int;
+    static constexpr Socket kInvalidSocket = -1;
+#endif
+
+    void run();
+
+    std::string m_endpoint;
+    Socket m_socket = kInvalidSocket;
+    std::array<uint8_t, 128> m_address{}; // sockaddr_storage of the resolved endpoint
+    uint32_t m_addressLength = 0;
+
+    std::array<TelemetrySample, kRingSize> m_ring{};
+    alignas(64) std::atomic<uint64_t> m_head{0}; // Next slot the producer writes
+    alignas(64) std::atomic<uint64_t> m_tail{0}; // Next slot the consumer reads
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_sent{0};
+    std::atomic<bool> m_wantMemory{true};
+    std::atomic<bool> m_quit{false};
+    std::thread m_thread;
+};
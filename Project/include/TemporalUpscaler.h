@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "RenderGraph.h"
+
+// ============================================================================
+// TEMPORAL UPSCALER
+// ============================================================================
+// Renders the underwater full-screen effects (volumetric fog, god rays) at half
+// resolution and reconstructs them at full resolution over several frames.
+//
+//  - Low-res pass: the effects draw into an RGBA16F target cleared to zero with
+//    their usual blend states, which leaves a premultiplied overlay
+//    (rgb = fog * alpha + rays, alpha = fog coverage). The viewport is offset by
+//    a sub-pixel Halton jitter each frame; the effects build their view rays
+//    from the interpolated screen UV, so this is the same as jittering the
+//    projection without touching the frame UBO the scene is drawn with.
+//  - Resolve (temporal_resolve.comp): every full-res pixel takes the jittered
+//    low-res sample, reprojects into the previous frame with the previous
+//    view-projection (the effects live at the far plane, so camera motion is
+//    the only motion), clamps that history to the low-res 3x3 neighbourhood
+//    and blends the two. Two history images alternate as source and target.
+//  - Composite: one full-screen draw in the main pass blends the result over
+//    the scene (ONE, ONE_MINUS_SRC_ALPHA), replacing the two full-res draws.
+//
+// History is dropped on resize, on resetHistory() and whenever the previous
+// view-projection would reproject off screen.
+
+class TemporalUpscaler
+{
+public:
+    static constexpr VkFormat kFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    // extent: the resolution the effects are composited at (the swapchain)
+    TemporalUpscaler(VkDevice device, VkExtent2D extent);
+    ~TemporalUpscaler(); // The device must be idle
+
+    TemporalUpscaler(const TemporalUpscaler &) = delete;
+    TemporalUpscaler &operator=(const TemporalUpscaler &) = delete;
+
+    // Device idle; drops the history
+    void resize(VkExtent2D extent);
+    // Against the pass the composite is drawn in; call again when that render pass is rebuilt
+    void createCompositePipeline(VkRenderPass renderPass, VkSampleCountFlagBits samples);
+
+    // Compatible with the graph's low-res pass: effect pipelines are created against it, 1 sample
+    VkRenderPass getLowResRenderPass() const { return m_lowResRenderPass; }
+
+    // Weight of the current frame in the resolve; lower is smoother but slower to react
+    void setCurrentWeight(float weight) { m_currentWeight = weight; }
+    float getCurrentWeight() const { return m_currentWeight; }
+    // The next frame starts from the low-res image alone (a frame without the effects)
+    void resetHistory() { m_historyValid = false; }
+
+    // Once per frame that uses the stage, before its passes are declared
+    void beginFrame(const glm::mat4 &viewProjection);
+
+    // This frame's images for the graph: the low-res target and the history read / written
+    RenderGraphResource importLowRes(RenderGraph &graph) const;
+    RenderGraphResource importHistory(RenderGraph &graph) const;
+    RenderGraphResource importResolved(RenderGraph &graph) const;
+
+    // Inside the low-res pass, before the effect draws
+    void setLowResViewport(VkCommandBuffer cmd) const;
+    // Outside any render pass
+    void recordResolve(VkCommandBuffer cmd) const;
+    // Inside the main pass; the viewport must cover the full extent
+    void recordComposite(VkCommandBuffer cmd) const;
+
+private:
+    static constexpr uint32_t kGroupSize = 8;    // temporal_resolve.comp local size
+    static constexpr uint32_t kJitterPhases = 8; // Halton(2, 3) points before the pattern repeats
+
+    struct ResolvePush
+    {
+        glm::mat4 reprojection; // Current far-plane clip -> previous clip
+        glm::vec2 jitter;       // Low-res pixels
+        float currentWeight;
+        float historyValid;
+    };
+
+    void createLowResRenderPass();
+    void createResolvePipeline();
+    void createTargets();
+    void destroyTargets();
+    void writeSets();
+    VkShaderModule loadShader(const char *path) const;
+
+    VkDevice m_device;
+    VkExtent2D m_extent{};
+    VkExtent2D m_lowResExtent{};
+
+    VkRenderPass m_lowResRenderPass = VK_NULL_HANDLE;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout m_resolveSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_resolveLayout = VK_NULL_HANDLE;
+    VkPipeline m_resolvePipeline = VK_NULL_HANDLE;
+    // [i]: writes history[i], reads history[1 - i]
+    std::array<VkDescriptorSet, 2> m_resolveSets{};
+
+    VkDescriptorSetLayout m_compositeSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_compositeLayout = VK_NULL_HANDLE;
+    VkPipeline m_compositePipeline = VK_NULL_HANDLE;
+    // [i]: samples history[i]
+    std::array<VkDescriptorSet, 2> m_compositeSets{};
+
+    VkImage m_lowResImage = VK_NULL_HANDLE;
+    VkImageView m_lowResView = VK_NULL_HANDLE;
+    std::array<VkImage, 2> m_historyImages{};
+    std::array<VkImageView, 2> m_historyViews{}; // Kept in GENERAL
+
+    // Current frame
+    uint32_t m_target = 0; // History image written this frame
+    uint32_t m_phase = 0;
+    ResolvePush m_push{};
+
+    glm::mat4 m_prevViewProjection{1.0f};
+    bool m_historyValid = false;
+    float m_currentWeight = 0.1f;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Ktx2.h"
+#include <cstdint>
+
+// ============================================================================
+// TEXTURE COMPRESSOR
+// ============================================================================
+// The offline half of the compressed texture path (XeTexCook): builds the mip
+// chain of an RGBA8 image and block-compresses every level into a Ktx2::Image.
+//
+//  - Color: BC7_SRGB, single-subset mode 6 with endpoints on the block's
+//    principal axis. Mips are filtered in linear light, as the runtime
+//    sRGB blits were.
+//  - TwoChannel: BC5_UNORM of red and green, for the normal and dudv maps
+//    whose shaders read only .rg (and rebuild a normal's z). These hold
+//    vectors, not colors: no sRGB decode, mips filtered on the stored values,
+//    the same values the uncooked map samples as R8G8B8A8_UNORM.
+//
+// ASTC is accepted by the loader (it is whatever the KTX2 says) but not
+// produced here; cook those with an external encoder.
+//
+// buildMips is the same chain without the compression, for the texture
+// streamer when an image has no cook: RGBA8 levels (SRGB for Color, UNORM for
+// TwoChannel) it can upload a level at a time instead of blitting them from
+// level 0 on the GPU.
+
+namespace TextureCompressor
+{
+    enum class Kind
+    {
+        Color,
+        TwoChannel,
+    };
+
+    // 'pixels' is width * height RGBA8
+    Ktx2::Image compress(const uint8_t *pixels, uint32_t width, uint32_t height, Kind kind);
+    Ktx2::Image buildMips(const uint8_t *pixels, uint32_t width, uint32_t height, Kind kind = Kind::Color);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Ktx2.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+
+// ============================================================================
+// TEXTURE DECODER
+// ============================================================================
+// CPU half of texture loading, split from the uploads so startup can decode
+// every image at once: prefetch() reads the cooked KTX2 (if up to date) or
+// decodes the source with stb_image for each path on the job system's
+// threads, and the loaders later take() the results in whatever order they
+// run. The uploads still go into the one open UploadContext batch.
+//
+// Not thread-safe itself: prefetch and take from the thread that owns it.
+
+class TextureDecoder
+{
+public:
+    struct Decoded
+    {
+        Ktx2::Image cooked; // format VK_FORMAT_UNDEFINED unless an up-to-date cook was read
+        std::unique_ptr<uint8_t, void (*)(void *)> pixels{nullptr, &freePixels}; // Source as RGBA8
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        bool isCooked() const { return cooked.format != VK_FORMAT_UNDEFINED; }
+    };
+
+    void prefetch(const std::vector<std::string> &paths, JobSystem *jobs);
+
+    // The prefetched result, or decoded now. Throws when neither the cook nor the source loads.
+    // 'allowCooked' false wants the source pixels (the skybox cross is cut into faces on the CPU).
+    Decoded take(const std::string &path, bool allowCooked = true);
+
+    // The source image only, for a cook the device cannot sample. Throws on failure.
+    static Decoded decodeSource(const std::string &path);
+    // take() without the prefetch; touches no decoder state, so any thread may call it
+    static Decoded decode(const std::string &path, bool allowCooked);
+
+private:
+    static void freePixels(void *pixels);
+
+    std::unordered_map<std::string, Decoded> m_prefetched;
+};
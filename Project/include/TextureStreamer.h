@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Ktx2.h"
+#include "TextureCompressor.h"
+#include "UploadContext.h"
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// TEXTURE STREAMER
+// ============================================================================
+// Material textures without the startup stall: request() returns at once with
+// a 1x1 placeholder view, a worker thread decodes the cook (or the source plus
+// CPU-built mips), and update() then streams the levels smallest first through
+// the UploadContext ring, at most 'uploadBudget' bytes per frame. Large levels
+// go up in bands of block rows.
+//
+// A level is resident once the upload batch that finished it has signalled;
+// the texture then gets a new view whose base is that level, getVersion()
+// changes, and the caller rewrites the descriptors it bound the old view to.
+// Replaced views and placeholders are destroyed 'framesInFlight' updates later,
+// when no recorded frame can still reference them.
+//
+// The streamer keeps the textures inside the GPU memory budget
+// (GpuMemoryAllocator::getBudgetOverrun) instead of letting an allocation
+// fail: a texture decoded while there is no room is created without its
+// finest levels, and while the budget is overrun, update() drops the finest
+// level of the textures whose finest level is largest. A drop copies the
+// remaining levels into a smaller image and swaps the view once the copy has
+// completed, like a streamed level. Dropped levels stay dropped; no texture
+// goes below kMinDropSize.
+//
+// Not thread-safe itself: request, update and getView from the render thread.
+
+class TextureStreamer
+{
+public:
+    static constexpr VkDeviceSize kDefaultUploadBudget = 4ull * 1024 * 1024;
+    static constexpr uint32_t kMinDropSize = 256; // Texels along the larger side no drop goes below
+
+    // 'formatUsable' rejects cooks the device cannot sample; those stream from the source instead
+    TextureStreamer(VkDevice device, uint32_t framesInFlight, std::function<bool(VkFormat)> formatUsable,
+                    VkDeviceSize uploadBudget = kDefaultUploadBudget);
+    ~TextureStreamer(); // Device must be idle
+
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // Handle for getView. The placeholder is one texel of 'placeholderRGBA' (R in the low byte). 'kind' is what
+    // the map holds: TwoChannel (normal maps) is sampled UNORM, without the sRGB decode of Color
+    uint32_t request(const std::string &path, uint32_t placeholderRGBA,
+                     TextureCompressor::Kind kind = TextureCompressor::Kind::Color);
+
+    // Once per frame, after the frame's fence: adopts decoded images, promotes
+    // completed levels, stages the next ones and submits them
+    void update();
+
+    // Blocks until every requested texture is fully resident (headless runs measure no streaming)
+    void finishAll();
+
+    VkImageView getView(uint32_t handle) const { return m_textures[handle].view; }
+    uint64_t getVersion() const { return m_version; }
+    bool isFullyResident() const;
+
+    void setUploadBudget(VkDeviceSize bytes) { m_uploadBudget = bytes; }
+    VkDeviceSize getUploadBudget() const { return m_uploadBudget; }
+
+    // Levels left out of or dropped from the textures for the memory budget, over all of them
+    uint32_t getDroppedLevelCount() const { return m_droppedLevels; }
+
+private:
+    struct PendingLevel
+    {
+        uint32_t level;
+        UploadTicket ticket;
+    };
+
+    struct Texture
+    {
+        std::string path;
+        TextureCompressor::Kind kind = TextureCompressor::Kind::Color;
+
+        VkImage placeholder = VK_NULL_HANDLE;
+        VkImage image = VK_NULL_HANDLE;
+        VkImage replaced = VK_NULL_HANDLE; // Before the last drop: sampled until the copy completes
+        VkImageView view = VK_NULL_HANDLE; // Placeholder's, then the resident levels'
+        Ktx2::Image source;                // CPU levels still to upload; freed once all are staged
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0; // Level 0's, kept once the source is freed
+        uint32_t height = 0;
+
+        uint32_t levelCount = 0;
+        uint32_t firstLevel = 0;             // Finest level the image holds, its own level 0
+        uint32_t residentLevel = UINT32_MAX; // Finest level the view covers
+        uint32_t stagingLevel = UINT32_MAX;  // Next level to stage (counts down to firstLevel)
+        uint32_t stagingRow = 0;             // Next block row within it
+        std::vector<PendingLevel> pending;   // Fully staged levels waiting on their batch
+        bool loaded = false;                 // Decode finished (or failed: placeholder for good)
+    };
+
+    struct DecodeResult
+    {
+        uint32_t handle;
+        Ktx2::Image image;
+        bool ok;
+    };
+
+    struct Retired
+    {
+        VkImageView view = VK_NULL_HANDLE;
+        VkImage image = VK_NULL_HANDLE;
+        uint64_t update = 0; // Safe to destroy from this update on
+    };
+
+    void workerLoop();
+    Ktx2::Image decode(const std::string &path, TextureCompressor::Kind kind) const;
+
+    void adoptDecoded();
+    void promoteCompleted(bool wait);
+    // Stages the rest of the next level, or the block rows of it 'budget' affords (0: no limit); returns the bytes
+    VkDeviceSize stageLevel(Texture &texture, VkDeviceSize budget);
+    void submitStaged(); // Submits the open upload batch and hands its ticket to the levels just staged
+    void createImage(Texture &texture); // Levels firstLevel.. in TRANSFER_DST
+    VkDeviceSize levelBytes(const Texture &texture, uint32_t level) const;
+    bool canDrop(const Texture &texture) const;
+    // Drops the finest levels of the textures with the largest until about 'bytes' are freed
+    void dropLevels(VkDeviceSize bytes);
+    void dropFinestLevel(Texture &texture);
+    VkImageView createView(VkImage image, VkFormat format, uint32_t baseLevel, uint32_t levelCount) const;
+    void retire(VkImageView view, VkImage image);
+    void destroyRetired(bool all);
+
+    VkDevice m_device;
+    uint32_t m_framesInFlight;
+    std::function<bool(VkFormat)> m_formatUsable;
+    VkDeviceSize m_uploadBudget;
+
+    std::vector<Texture> m_textures;
+    std::deque<Retired> m_retired;
+    uint64_t m_updateCount = 0;
+    uint64_t m_version = 1;
+    uint64_t m_nextDrop = 0; // Once the last drop's images are destroyed, so the budget shows what it freed
+    uint32_t m_droppedLevels = 0;
+
+    // Worker: paths in, decoded images out
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_decoded;
+    std::deque<uint32_t> m_decodeQueue;
+    std::vector<DecodeResult> m_decodeResults;
+    uint32_t m_decodesInFlight = 0; // Queued or being decoded
+    bool m_stop = false;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// THREAD AFFINITY
+// ============================================================================
+// Pins the renderer's threads to the cores a placement file names, so that on
+// multi-socket machines they stop migrating between sockets and benchmark
+// runs land on the same cores every time. Without a file nothing is pinned.
+//
+//   {
+//     "numaNode": 0,            // Optional: the default cores of every role, this node's
+//     "main": [0],              // Render thread (the one that calls configure())
+//     "simulation": [1],
+//     "workers": [2, 3, 4, 5],  // Job system: one core per worker, in order; also sets the worker count
+//     "textureStreamer": [6],   // Texture decode and upload staging
+//     "readback": [7],          // Readback encoder
+//     "services": [7]           // Metrics writer, reference images, telemetry, shader watcher
+//   }
+//
+// A role that is not listed runs on the NUMA node's cores, or anywhere
+// without one. Memory follows the threads: the OS places pages on the node of
+// the thread that first touches them, and every arena, staging copy and
+// metrics buffer is filled by the thread that uses it, so keeping all roles
+// on one node keeps their allocations node-local without a NUMA allocator.
+//
+// configure() must run before any of these threads start (the placement is
+// read unsynchronised afterwards); each thread pins itself as it starts.
+// Core numbers are logical processors; on Windows, processor groups of 64.
+
+enum class ThreadRole
+{
+    Main,
+    Simulation,
+    Worker,
+    TextureStreamer,
+    Readback,
+    Service,
+};
+
+class ThreadAffinity
+{
+public:
+    static constexpr const char *kEnvironmentVariable = "XERENDER_AFFINITY";
+
+    // Reads the placement file ('path', else XERENDER_AFFINITY; neither leaves every thread unpinned) and pins
+    // the calling thread as Main. False when a file was named but could not be read
+    static bool configure(const std::string &path);
+    static bool isConfigured();
+
+    // Pins the calling thread to its role's cores; 'workerIndex' is the job system's 1..N. No-op unconfigured
+    static void pinCurrentThread(ThreadRole role, uint32_t workerIndex = 0);
+
+    // Worker cores the file lists, 0 if none: the job system starts one worker per core
+    static uint32_t getWorkerCoreCount();
+
+    // Logical processors of NUMA node 'node'; empty where the OS does not say
+    static std::vector<uint32_t> getNumaNodeCores(uint32_t node);
+
+private:
+    static bool pin(const std::vector<uint32_t> &cores);
+};
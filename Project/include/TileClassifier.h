@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// ============================================================================
+// TILE CLASSIFIER
+// ============================================================================
+// Splits the full-screen underwater fog into 16x16 screen tiles by how much of
+// it each one needs, so pixels the fog cannot touch skip it.
+//
+//  - tile_classify.comp: one workgroup per tile finds the range of its pixels'
+//    view-ray heights, the only input of the fog's horizon mask. Tiles wholly
+//    above the waterline band (looking up at the surface and the sky through
+//    it) are dropped: the mask is 0 there. The rest are appended to one of two
+//    lists, with their instance count in an indirect draw: Waterline (the band
+//    crosses the tile) and Below (the mask is 1 throughout).
+//  - The second mask is the water surface itself: with the camera across it,
+//    part of the screen looks out of the water from the near plane on. Each
+//    ray is tested where it leaves the near plane against the surface height
+//    at the camera; tiles wholly out of the water are dropped, tiles the
+//    waterline crosses go to the Waterline list. Above water the same lists
+//    fog just the submerged part of the screen.
+//  - underwater_tile.vert: one quad per listed tile, drawn with the fog pipeline
+//    specialized for the class (UnderwaterWaterPipeline::bindTiles).
+//
+// Tiles are in UV, so the same lists serve the full-resolution and the
+// temporal half-resolution fog. The god rays march towards the sun whatever a
+// pixel looks at; they stay full screen.
+
+class TileClassifier
+{
+public:
+    static constexpr uint32_t kTileSize = 16; // tile_classify.comp local size
+
+    enum class TileClass : uint32_t
+    {
+        Waterline = 0, // The horizon mask varies across the tile
+        Below = 1      // The mask is 1 throughout
+    };
+    static constexpr uint32_t kClassCount = 2;
+
+    // underwater_water.frag's horizon mask: smoothstep from 0 at kBandTop to 1 at kBandBottom
+    static constexpr float kBandTop = 0.0f;
+    static constexpr float kBandBottom = -0.08f;
+    // underwater_water.frag's waterline mask: smoothstep over this far either side of the surface
+    static constexpr float kWaterlineEdge = 0.01f;
+
+    TileClassifier(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent);
+    ~TileClassifier(); // The device must be idle
+
+    TileClassifier(const TileClassifier &) = delete;
+    TileClassifier &operator=(const TileClassifier &) = delete;
+
+    // The screen the tiles cover; the device must be idle
+    void resize(VkExtent2D extent);
+    // For shader hot reload
+    void createPipeline();
+
+    // Outside any render pass, before the draws; the view and projection the fog is drawn with,
+    // the camera's height above the surface and the projection's near plane distance
+    void recordClassification(VkCommandBuffer cmd, const glm::mat4 &view, const glm::mat4 &projection,
+                              float cameraAboveWater, float nearPlane) const;
+    // Inside the pass, with the class's fog pipeline, descriptor sets and push constants bound
+    void recordDraw(VkCommandBuffer cmd, TileClass tileClass) const;
+
+private:
+    // Mirrors ClassifyPush in tile_classify.comp
+    struct ClassifyPush
+    {
+        glm::mat4 inverseProjection;
+        glm::vec4 worldUp;
+        glm::uvec4 extent; // xy: pixels, z: tiles per list
+        glm::vec4 band;
+        glm::vec4 waterline; // x: camera above the surface, y: near plane, z: kWaterlineEdge
+    };
+
+    void createDescriptors();
+    void createTileBuffer();
+
+    VkDevice m_device;
+    VkPhysicalDevice m_physicalDevice;
+    VkExtent2D m_extent;
+    uint32_t m_tilesX = 0;
+    uint32_t m_tilesY = 0;
+
+    VkBuffer m_tileBuffer = VK_NULL_HANDLE; // kClassCount lists of every tile's rect; vertex input, per instance
+    VkBuffer m_drawBuffer = VK_NULL_HANDLE; // kClassCount VkDrawIndirectCommand
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
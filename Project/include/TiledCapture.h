@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "FrameReadback.h"
+
+// ============================================================================
+// TILED CAPTURE
+// ============================================================================
+// Renders one image larger than the frame as a grid of frame-sized tiles. The
+// camera keeps the full image's field of view and aspect; each tile's frame
+// draws it through a sub-frustum, the projection scaled and offset in clip
+// space so the tile's part of the image fills the viewport (tileProjection).
+// Nothing the size of the whole image ever exists on the GPU.
+//
+//  - Every tile can average several frames, each jittered by a sub-pixel
+//    Halton(2,3) offset: supersampled edges without a larger frame.
+//  - Tiles come back through FrameReadback in frame order, are averaged in a
+//    float buffer of one tile, and written into their rows of a binary PPM
+//    that is sized up front: only one tile's pixels are ever held in memory.
+//  - The renderer holds the pose and the clock for the whole capture, so the
+//    tiles show the same instant. What carries state from frame to frame
+//    would be carried across tile edges and is switched off meanwhile
+//    (VulkanBase::applyCaptureLimits).
+//
+// Screen-space effects (reflections, sunrays, fog reconstruction) only see
+// their own tile and may show seams where they reach across its edges.
+
+struct TiledCaptureSettings
+{
+    VkExtent2D size{3840, 2160}; // The whole image
+    uint32_t samples = 1;        // Jittered frames averaged per tile
+    std::string path;            // Binary PPM
+    // Set: the image is handed over in memory instead of written to 'path'; it must fit one tile
+    std::function<void(const FrameReadbackImage &)> onImage;
+};
+
+class TiledCapture
+{
+public:
+    static constexpr uint32_t kSettleFrames = 8; // Rendered and discarded first: the capture's settings take effect
+    static constexpr uint32_t kMaxSamples = 64;
+
+    // tileExtent: the frame's. Check failed() for the output file
+    TiledCapture(const TiledCaptureSettings &settings, VkExtent2D tileExtent);
+
+    TiledCapture(const TiledCapture &) = delete;
+    TiledCapture &operator=(const TiledCapture &) = delete;
+
+    // The full image's, for the camera's projection
+    float getAspect() const { return m_size.width / static_cast<float>(m_size.height); }
+    // projection: the full image's, flipped for Vulkan; narrowed to this frame's tile and jitter
+    glm::mat4 tileProjection(const glm::mat4 &projection) const;
+
+    // Once per frame, after tileProjection: false while settling or once every frame is asked for.
+    // Otherwise fills 'request' with this frame's tile and moves on to the next frame
+    bool takeRequest(FrameReadbackRequest &request);
+
+    bool isDone() const { return m_tilesWritten == m_tileCount || failed(); }
+    bool failed() const { return !m_error.empty(); }
+    const std::string &getError() const { return m_error; }
+    float getProgress() const;
+    const TiledCaptureSettings &getSettings() const { return m_settings; }
+    uint32_t getTileCount() const { return m_tileCount; }
+
+private:
+    struct Tile
+    {
+        uint32_t x = 0; // Top-left pixel in the image
+        uint32_t y = 0;
+        uint32_t width = 0; // Clipped at the image's edges
+        uint32_t height = 0;
+    };
+
+    Tile getTile(uint32_t index) const;
+    glm::vec2 getJitter(uint32_t sample) const; // Pixels
+    void addSample(uint32_t tileIndex, uint32_t sample, const FrameReadbackImage &image);
+    void writeTile(const Tile &tile);
+
+    TiledCaptureSettings m_settings;
+    VkExtent2D m_size;
+    VkExtent2D m_tileExtent;
+    uint32_t m_tilesX;
+    uint32_t m_tileCount;
+    uint32_t m_samples;
+
+    uint32_t m_settleFrames = kSettleFrames;
+    uint32_t m_nextFrame = 0; // tile * samples + sample
+    uint32_t m_tilesWritten = 0;
+
+    std::vector<float> m_accumulated; // RGB, one tile
+    std::fstream m_file;
+    std::streamoff m_headerSize = 0;
+    std::string m_error;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// ============================================================================
+// TIMELINE SEMAPHORE
+// ============================================================================
+// A 64-bit counter that submissions signal in increasing order and that the
+// host and other submissions wait on for a value. Work is tagged with the value
+// its submission signals (nextValue()); whatever it used may be reused once
+// that value is reached. One semaphore replaces a fence per batch or frame:
+// nothing to reset, and a wait names exactly the work it needs.
+
+class TimelineSemaphore
+{
+public:
+    // timelineSemaphore is core in Vulkan 1.2, but still a feature to check and enable
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+    static void enableFeatures(VkPhysicalDeviceVulkan12Features &features);
+
+    explicit TimelineSemaphore(VkDevice device);
+    ~TimelineSemaphore(); // Nothing may still wait on or signal it
+
+    TimelineSemaphore(const TimelineSemaphore &) = delete;
+    TimelineSemaphore &operator=(const TimelineSemaphore &) = delete;
+
+    VkSemaphore getHandle() const { return m_semaphore; }
+
+    // The value the next submission signals; they must be submitted in the order they were taken
+    uint64_t nextValue() { return ++m_lastValue; }
+    // The latest value handed out: reached once everything tagged so far has completed
+    uint64_t getLastValue() const { return m_lastValue; }
+
+    uint64_t getCompletedValue() const;
+    bool isComplete(uint64_t value) const { return value == 0 || getCompletedValue() >= value; }
+    // Blocks until 'value' is reached; 0 (never tagged) returns at once
+    void wait(uint64_t value) const;
+    void waitIdle() const { wait(m_lastValue); }
+
+private:
+    VkDevice m_device;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    uint64_t m_lastValue = 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// TRANSFORM HIERARCHY
+// ============================================================================
+// Parent-relative transforms of scene nodes, resolved to world matrices only
+// where something changed. Node ids are stable handles; the data itself is
+// kept as structure-of-arrays in depth-first order: local positions,
+// rotations and scales, world matrices and parents each in their own packed
+// array, every node's subtree the contiguous slots [slot, subtreeEnd).
+//
+//  - Setting a local transform flags the node. update() visits the flagged
+//    slots in order and recomputes each one's subtree range front to back -
+//    a parent always sits before its children, so its world matrix is ready
+//    when they need it. A flagged node inside a range already recomputed is
+//    skipped; clean subtrees are never touched, so moving a few objects out
+//    of thousands costs those few and their descendants.
+//  - Adding a child or reparenting breaks the depth-first order; the next
+//    update() restores it in one pass before resolving the flags.
+//  - World matrices are composed parent * T * R * S with SSE where the
+//    target has it.
+//
+// Locals are translation, rotation and scale: a matrix given as a local is
+// decomposed, and shear it may hold is lost.
+
+class TransformHierarchy
+{
+public:
+    static constexpr uint32_t kNoParent = ~0u;
+
+    // A node with an identity local transform, flagged; its world matrix is valid after the next update()
+    uint32_t addNode(uint32_t parent = kNoParent);
+    // Moves the node's subtree under 'parent' (kNoParent: a root); the local transform is kept
+    void setParent(uint32_t node, uint32_t parent);
+    void clear();
+
+    void setLocal(uint32_t node, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale);
+    void setLocalMatrix(uint32_t node, const glm::mat4 &local);
+    void setLocalPosition(uint32_t node, const glm::vec3 &position);
+    void setLocalRotation(uint32_t node, const glm::quat &rotation);
+    void setLocalScale(uint32_t node, const glm::vec3 &scale);
+
+    const glm::vec3 &getLocalPosition(uint32_t node) const { return m_positions[slot(node)]; }
+    const glm::quat &getLocalRotation(uint32_t node) const { return m_rotations[slot(node)]; }
+    const glm::vec3 &getLocalScale(uint32_t node) const { return m_scales[slot(node)]; }
+    // As of the last update()
+    const glm::mat4 &getWorld(uint32_t node) const { return m_world[slot(node)]; }
+    uint32_t getParent(uint32_t node) const { return m_parentOf[node]; }
+    uint32_t getNodeCount() const { return static_cast<uint32_t>(m_slotOf.size()); }
+
+    // Resolves every flagged node's subtree; returns the nodes whose world matrix was recomputed,
+    // valid until the next call
+    const std::vector<uint32_t> &update();
+    bool needsUpdate() const { return !m_flagged.empty() || m_layoutDirty; }
+
+private:
+    uint32_t slot(uint32_t node) const { return m_slotOf[node]; }
+    void flag(uint32_t node);
+    void relayout();
+    void updateRange(uint32_t first, uint32_t end);
+
+    // Per slot, depth-first
+    std::vector<uint32_t> m_parentSlot; // kNoParent for roots
+    std::vector<uint32_t> m_subtreeEnd;
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::quat> m_rotations;
+    std::vector<glm::vec3> m_scales;
+    std::vector<glm::mat4> m_world;
+    std::vector<uint8_t> m_flags; // Non-zero: in m_flagged
+    std::vector<uint32_t> m_nodeAt;
+
+    // Per node id
+    std::vector<uint32_t> m_slotOf;
+    std::vector<uint32_t> m_parentOf;
+
+    std::vector<uint32_t> m_flagged; // Node ids
+    std::vector<uint32_t> m_flaggedSlots;
+    std::vector<uint32_t> m_updated;
+    bool m_layoutDirty = false;
+};
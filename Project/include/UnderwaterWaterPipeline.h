@@ -5,16 +5,18 @@
 #include <array>
 #include "Vertex.h"
 #include "VulkanUtil.h"
+#include "WaterPipeline.h" // WaterVariant
+#include "TileClassifier.h"
 
 class UnderwaterWaterPipeline {
 public:
     UnderwaterWaterPipeline() = default;
     ~UnderwaterWaterPipeline() = default;
 
-    // create: device, swap extent, renderPass, global descriptor set layout, water descriptor set layout, msaa samples
+    // create: device, renderPass, global descriptor set layout, water descriptor set layout, msaa samples.
+    // Builds the debug-off variant of every rendering mode; the others are built on first select()
     void create(
         VkDevice device,
-        VkExtent2D extent,
         VkRenderPass renderPass,
         VkDescriptorSetLayout globalDescriptorSetLayout,
         VkDescriptorSetLayout waterDescriptorSetLayout,
@@ -24,13 +26,36 @@ public:
 
     void destroy(VkDevice device);
 
+    // Render thread, before recording; as WaterPipeline::select. tiled: also the per-class tile
+    // variants (bindTiles), drawn over TileClassifier's lists instead of the full-screen triangle.
+    // shadingRate: the tiles shaded at VariableRateShading's rates (needs the device feature)
+    void select(WaterVariant variant, bool tiled = false, bool shadingRate = false);
+    // As WaterPipeline::prebuild
+    void prebuild(WaterVariant variant, bool tiled, bool shadingRate = false);
+
     void bind(VkCommandBuffer cmd);
+    // The selected variant specialized for one tile class; select() must have been given tiled
+    void bindTiles(VkCommandBuffer cmd, TileClassifier::TileClass tileClass);
 
     VkPipeline pipeline = VK_NULL_HANDLE;
     VkPipelineLayout layout = VK_NULL_HANDLE;
 
 private:
     VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code);
+    // tileClass 0: the full-screen triangle; otherwise TILE_CLASS, 1 + TileClassifier::TileClass
+    VkPipeline buildVariant(const WaterVariant &variant, uint32_t tileClass = 0, bool shadingRate = false) const;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkSampleCountFlagBits m_samples = VK_SAMPLE_COUNT_1_BIT;
+    VkShaderModule m_vertModule = VK_NULL_HANDLE;
+    VkShaderModule m_fragModule = VK_NULL_HANDLE;
+    VkShaderModule m_tileVertModule = VK_NULL_HANDLE;
+    VkShaderModule m_rateTileVertModule = VK_NULL_HANDLE; // Loaded with the first shadingRate variant
+    std::map<WaterVariant, VkPipeline> m_variants;
+    // With the shadingRate flag
+    std::map<std::pair<WaterVariant, bool>, std::array<VkPipeline, TileClassifier::kClassCount>> m_tileVariants;
+    std::array<VkPipeline, TileClassifier::kClassCount> m_tilePipelines{};
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
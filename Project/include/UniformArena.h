@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// UNIFORM ARENA
+// ============================================================================
+// One persistently mapped uniform buffer split into a region per frame in
+// flight. Every per-frame uniform block (UBO, LightInfo, ToggleInfo, and later
+// per-object data) is pushed into the current frame's region and addressed
+// through a dynamic offset, so an update is a single memcpy and the
+// descriptor sets never have to be rewritten. The buffer is also bindable as
+// a vertex buffer, for the per-instance data of instanced draws.
+//
+// beginFrame() must only be called once the timeline value the frame's slot
+// was last tagged with has been reached (VulkanBase::frameSlotValues).
+
+class UniformArena
+{
+public:
+    UniformArena(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount, VkDeviceSize frameCapacity);
+    ~UniformArena();
+
+    UniformArena(const UniformArena &) = delete;
+    UniformArena &operator=(const UniformArena &) = delete;
+
+    // Rewinds the frame's region; everything pushed for it last time is overwritten
+    void beginFrame(uint32_t frameIndex);
+
+    // Copies data into the current frame's region, returns its dynamic offset
+    uint32_t push(const void *data, VkDeviceSize size);
+
+    template <class T>
+    uint32_t push(const T &value)
+    {
+        return push(&value, sizeof(T));
+    }
+
+    VkBuffer getBuffer() const { return m_buffer; }
+    VkDeviceSize getAlignment() const { return m_alignment; }
+    VkDeviceSize getFrameCapacity() const { return m_frameCapacity; }
+    VkDeviceSize getBytesUsed() const { return m_cursor; } // Current frame
+
+private:
+    VkDevice m_device;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    uint8_t *m_mapped = nullptr;
+
+    uint32_t m_frameCount;
+    VkDeviceSize m_frameCapacity;
+    VkDeviceSize m_alignment = 256; // minUniformBufferOffsetAlignment
+
+    uint32_t m_frameIndex = 0;
+    VkDeviceSize m_cursor = 0;
+};
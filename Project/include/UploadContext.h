@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include "Command/CommandPool.h"
+#include "TimelineSemaphore.h"
+
+// ============================================================================
+// UPLOAD CONTEXT
+// ============================================================================
+// Batches staging copies and layout transitions into one command buffer per
+// queue and submits them together with one timeline signal, instead of a
+// submit + vkQueueWaitIdle round-trip per copy.
+//
+// When the device exposes a dedicated transfer queue family, copies are
+// recorded on it and ownership is handed to the graphics family (release on
+// transfer, acquire on graphics, ordered by a semaphore). Graphics-only work
+// such as mip generation and the final SHADER_READ_ONLY transition goes into
+// graphicsCommands(), which always executes after the batch's copies.
+//
+// Source data is staged in one persistently mapped ring buffer sized at
+// startup. Each batch owns the ring span written since the previous submit,
+// and that span is recycled when the batch's timeline value is reached, so uploads during
+// play never create, map or destroy a buffer.
+
+struct StagingAllocation
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    void *mapped = nullptr; // Already offset
+};
+
+struct UploadTicket
+{
+    uint64_t id = 0;
+    bool valid() const { return id != 0; }
+};
+
+class UploadContext
+{
+public:
+    static UploadContext &get();
+
+    void initialize(VkDevice device, VkPhysicalDevice physicalDevice,
+                    uint32_t graphicsFamily, VkQueue graphicsQueue,
+                    uint32_t transferFamily, VkQueue transferQueue);
+    void cleanup();
+
+    bool hasDedicatedTransferQueue() const { return m_transferFamily != m_graphicsFamily; }
+
+    // ---- Staging (ring sub-allocation, valid until the open batch retires) ----
+    // Record the copy that reads the allocation before allocating again: a full
+    // ring submits the open batch to make room.
+    StagingAllocation allocateStaging(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    // Stage + copy in one call
+    void uploadBuffer(VkBuffer dst, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+    void uploadImage(VkImage dst, const void *pixels, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevels = 1);
+    // Region bufferOffsets are relative to pixels
+    void uploadImage(VkImage dst, const void *pixels, VkDeviceSize size, std::vector<VkBufferImageCopy> regions,
+                     uint32_t mipLevels, uint32_t layerCount);
+
+    // ---- Recording (all calls go into the currently open batch) ----
+    void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size,
+                    VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+
+    // Transitions the whole image UNDEFINED -> TRANSFER_DST, copies, and leaves
+    // it in TRANSFER_DST_OPTIMAL owned by the graphics family.
+    void copyBufferToImage(VkBuffer src, VkImage dst, uint32_t width, uint32_t height, uint32_t mipLevels = 1);
+    void copyBufferToImage(VkBuffer src, VkImage dst, const std::vector<VkBufferImageCopy> &regions,
+                           uint32_t mipLevels, uint32_t layerCount);
+
+    // TRANSFER_DST -> SHADER_READ_ONLY on the graphics stream
+    void transitionToShaderRead(VkImage image, uint32_t mipLevels, uint32_t layerCount = 1);
+
+    // Graphics-queue command buffer of the open batch (blits, layout changes)
+    VkCommandBuffer graphicsCommands();
+
+    // Staging buffer is destroyed once the batch that reads it has completed
+    void destroyAfterUpload(VkBuffer stagingBuffer);
+
+    // ---- Submission ----
+    UploadTicket submit();                 // No-op ticket if nothing was recorded
+    void wait(UploadTicket ticket);
+    bool isComplete(UploadTicket ticket);
+    void flush() { wait(submit()); }       // submit + wait, one timeline value for the whole batch
+
+private:
+    UploadContext() = default;
+    UploadContext(const UploadContext &) = delete;
+    UploadContext &operator=(const UploadContext &) = delete;
+
+    struct Batch
+    {
+        uint64_t id = 0;
+        VkCommandBuffer transferCmd = VK_NULL_HANDLE; // Same as graphicsCmd without a dedicated queue
+        VkCommandBuffer graphicsCmd = VK_NULL_HANDLE;
+        uint64_t timelineValue = 0; // Signalled by the graphics submit
+        VkSemaphore transferDone = VK_NULL_HANDLE;
+        std::vector<VkBuffer> stagingBuffers;
+        VkDeviceSize ringEnd = 0;  // Ring head at submit; tail moves here on retire
+        bool recording = false;
+    };
+
+    VkCommandBuffer transferCommandsLocked();
+    VkCommandBuffer graphicsCommandsLocked();
+    void beginBatchLocked();
+    UploadTicket submitLocked();
+    bool tryAllocateRingLocked(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &outOffset);
+    void retireCompletedLocked();
+    void releaseBatchLocked(Batch &batch);
+
+    void releaseBufferOwnership(VkBuffer buffer);
+    void releaseImageOwnership(VkImage image, uint32_t mipLevels, uint32_t layerCount);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    uint32_t m_graphicsFamily = 0;
+    uint32_t m_transferFamily = 0;
+    VkQueue m_graphicsQueue = VK_NULL_HANDLE;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+
+    static constexpr VkDeviceSize kStagingRingSize = 64ull * 1024 * 1024;
+
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkBuffer m_ringBuffer = VK_NULL_HANDLE;
+    uint8_t *m_ringMapped = nullptr;
+    VkDeviceSize m_ringHead = 0; // Next write
+    VkDeviceSize m_ringTail = 0; // Oldest byte still read by an in-flight batch
+    VkDeviceSize m_copyAlignment = 16;
+
+    CommandPool m_graphicsPool;
+    CommandPool m_transferPool;
+
+    std::unique_ptr<TimelineSemaphore> m_timeline; // Batches signal it in submission order
+
+    Batch m_current;
+    std::deque<Batch> m_inFlight;
+    uint64_t m_nextTicket = 1;
+    uint64_t m_completedTicket = 0;
+
+    std::mutex m_mutex;
+};
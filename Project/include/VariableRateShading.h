@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "RenderGraph.h"
+#include "TileClassifier.h"
+
+// ============================================================================
+// VARIABLE RATE SHADING
+// ============================================================================
+// Shades the underwater fog and sunrays coarsely where they cannot show detail,
+// through VK_KHR_fragment_shading_rate. Most of the underwater frame is thick,
+// low-frequency fog; a tile behind enough of it, and flat last frame, shades
+// at 2x2 or 4x4 pixels per fragment instead of one.
+//
+//  - shading_rate.comp: one workgroup per 16x16 screen tile (the classifier's)
+//    takes the thinnest fog over its pixels, as underwater_water.frag absorbs
+//    it at its slowest wavelength, and the luminance contrast (standard
+//    deviation) of the same tile in last frame's history. Both past their
+//    thresholds give the tile its rate, written to a per-tile rate map.
+//  - The history is the previous frame blitted to half resolution after the
+//    main pass, unreprojected: the fog only ever changes slowly across it.
+//    Without one (first frame, resize, a frame format that cannot be blitted)
+//    the fog alone decides.
+//  - The rate map is applied per primitive, not as a rate attachment: the fog
+//    is already drawn as one quad per tile (TileClassifier.h), and the main
+//    pass and every pipeline built against it stay as they are. The tile quads
+//    read their tile's rate in underwater_tile_vrs.vert; the sunrays draw one
+//    quad per tile of the whole screen instead of their full-screen triangle
+//    (sunrays_tile_vrs.vert, recordGridDraw). Only the fog's full-resolution
+//    tile draws and the full-resolution sunrays are shaded this way.
+//
+// Rates go through the pipeline as the primitive's own (combiner REPLACE) with
+// sample shading off: sample-rate shading would force every fragment back to
+// one pixel. The device clamps rates it cannot do at the pass' sample count.
+
+class VariableRateShading
+{
+public:
+    static constexpr uint32_t kTileSize = TileClassifier::kTileSize; // shading_rate.comp local size
+    static constexpr uint32_t kWaterBinding = 11;                    // The rate map, in the water set
+
+    // gl_PrimitiveShadingRateEXT flags; the same encoding as a rate attachment's texels
+    static constexpr uint32_t kRate1x1 = 0;
+    static constexpr uint32_t kRate2x2 = 5;  // 2 pixels horizontally and vertically
+    static constexpr uint32_t kRate4x4 = 10; // 4 pixels horizontally and vertically
+
+    // The thinnest fog opacity over a tile, and the most luminance contrast, each rate allows
+    static constexpr float kFogOpacity2x2 = 0.6f;
+    static constexpr float kFogOpacity4x4 = 0.85f;
+    static constexpr float kContrast2x2 = 0.06f;
+    static constexpr float kContrast4x4 = 0.03f;
+
+    // The extension with per-primitive rates
+    static bool isSupported(VkPhysicalDevice physicalDevice);
+    // Enables the features in front of 'next'; returns the new head of the chain. 'features' must outlive vkCreateDevice
+    static void *enableFeatures(VkPhysicalDeviceFragmentShadingRateFeaturesKHR &features, void *next);
+    // Makes a pipeline shade at its primitives' rates; after DynamicRendering::apply, 'state' must outlive the create call
+    static void chainPipeline(VkGraphicsPipelineCreateInfo &info, VkPipelineFragmentShadingRateStateCreateInfoKHR &state);
+
+    // extent and frameFormat: the frame's, which the rate map covers and the history is blitted from
+    VariableRateShading(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, VkFormat frameFormat);
+    ~VariableRateShading(); // The device must be idle
+
+    VariableRateShading(const VariableRateShading &) = delete;
+    VariableRateShading &operator=(const VariableRateShading &) = delete;
+
+    // The device must be idle; drops the history. The rate map is recreated: write the descriptor again
+    void resize(VkExtent2D extent, VkFormat frameFormat);
+    // For shader hot reload
+    void createPipeline();
+    // Points the water set's kWaterBinding at the rate map
+    void writeDescriptor(VkDescriptorSet waterSet) const;
+
+    // The next frame's rates come from the fog alone (a frame without the effects)
+    void resetHistory() { m_historyValid = false; }
+    // Whether recordHistory can blit the frame
+    bool canCaptureHistory() const { return m_historySupported; }
+    // This frame's view of the history: read by recordRates, written by recordHistory
+    RenderGraphResource importHistory(RenderGraph &graph) const;
+
+    // Outside any render pass, before the draws; the view and projection the effects are drawn with,
+    // the camera's depth below the surface and the fog's slowest absorption per unit distance
+    void recordRates(VkCommandBuffer cmd, const glm::mat4 &view, const glm::mat4 &projection,
+                     float depthBelowSurface, float fogAbsorption) const;
+    // Outside any render pass, once the frame is complete; 'frame' in TRANSFER_SRC_OPTIMAL
+    void recordHistory(VkCommandBuffer cmd, VkImage frame);
+    // Inside the pass, with the sunrays' tile pipeline, descriptor sets and push constants bound: one quad per tile
+    void recordGridDraw(VkCommandBuffer cmd) const;
+
+private:
+    // Mirrors RatePush in shading_rate.comp
+    struct RatePush
+    {
+        glm::mat4 inverseProjection;
+        glm::vec4 worldUp;
+        glm::uvec4 extent; // xy: pixels, z: tiles per row, w: non-zero with a history
+        glm::vec4 fog;
+        glm::vec4 thresholds;
+    };
+
+    void createDescriptors();
+    void createTargets();
+    void destroyTargets();
+
+    VkDevice m_device;
+    VkPhysicalDevice m_physicalDevice;
+    VkExtent2D m_extent;
+    VkExtent2D m_historyExtent{};
+    uint32_t m_tilesX = 0;
+    uint32_t m_tilesY = 0;
+    bool m_historySupported = false;
+    bool m_historyValid = false;
+
+    VkBuffer m_rateBuffer = VK_NULL_HANDLE; // uvec4 grid (tiles, pixels), then one rate per tile
+    VkImage m_historyImage = VK_NULL_HANDLE;
+    VkImageView m_historyView = VK_NULL_HANDLE;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
@@ -5,10 +5,14 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <vulkan/vulkan.h>
+#include "MaterialTable.h"
 #include <array>
 #include <vector>
+#include <cmath>
+#include <cstdint>
 
 struct Vertex {
     glm::vec3 pos;
@@ -62,12 +66,83 @@ namespace std {
     };
 }
 
+// Scene geometry as the main pipeline reads it: 16 bytes instead of Vertex's 68, only what
+// 3d_shader*.vert use. Positions are quantised over a cube around the object, which its model
+// matrix maps back (Scene::getModelMatrix); normals are octahedral, UVs half floats.
+struct PackedVertex {
+    uint16_t pos[4];      // R16G16B16A16_UNORM over the cube, w unused
+    int16_t normal[2];    // R16G16_SNORM, octahedral
+    uint16_t texCoord[2]; // R16G16_SFLOAT
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(PackedVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescription;
+    }
+
+    // Same locations as Vertex::getAttributeDescriptions
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(PackedVertex, pos);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[1].offset = offsetof(PackedVertex, normal);
+
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(PackedVertex, texCoord);
+        return attributeDescriptions;
+    }
+
+    // 'origin'/'extent': min corner and edge length of the cube the position is quantised over
+    static PackedVertex pack(const Vertex &vertex, const glm::vec3 &origin, float extent) {
+        PackedVertex packed{};
+        const glm::vec3 unit = glm::clamp((vertex.pos - origin) / extent, 0.0f, 1.0f);
+        for (int i = 0; i < 3; i++) {
+            packed.pos[i] = glm::packUnorm1x16(unit[i]);
+        }
+
+        // Octahedral: project onto |x| + |y| + |z| = 1, fold the lower half over the diagonals
+        glm::vec3 n = vertex.normal;
+        const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        n = l1 > 0.0f ? n / l1 : glm::vec3(0.0f, 0.0f, 1.0f);
+        glm::vec2 oct(n.x, n.y);
+        if (n.z < 0.0f) {
+            oct = (1.0f - glm::abs(glm::vec2(n.y, n.x))) *
+                  glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        packed.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(oct.x));
+        packed.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(oct.y));
+
+        packed.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+        packed.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+        return packed;
+    }
+};
+
 struct UBO {
     alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
     alignas(16) glm::vec3 lightPos;
     alignas(16) glm::vec3 viewPos;
+    alignas(16) glm::vec4 offscreenScale; // x: render scale of the reflection/refraction targets (DynamicResolution.h), y: 1 for screen-space reflections, z: 1 when water_rq.frag traces the scene
+    alignas(16) glm::vec4 ocean;          // OceanFFT::getShaderParams
+    alignas(16) glm::vec4 viewport;       // xy: extent in pixels, z: water tessellation edge target in pixels
+    alignas(16) glm::mat4 offscreenViewProj; // Main camera when the reflection/refraction targets were rendered (OffscreenThrottle.h)
+    alignas(16) glm::uvec4 material;         // x: MaterialTable index of the object drawn (3d_shader.vert)
+    // Stereo passes (Multiview.h): view and proj above are then the camera both eyes are culled with
+    alignas(16) glm::uvec4 views;            // x: 2 in a stereo pass
+    alignas(16) glm::mat4 eyeViewProj[2];    // Per view, by gl_ViewIndex
+    alignas(16) glm::vec4 eyePos[2];
 };
 
 struct ToggleInfo {
@@ -92,18 +167,68 @@ struct Light {
     float intensity;          // 4 bytes
 };
 
+// std140 mirror of LightInfo in 3d_shader.frag and water.frag
 struct LightInfo {
-    Light lights[2];            // Two lights, each properly aligned
+    Light sun;                      // Light 0: position is the direction towards the sun
     alignas(16) glm::vec3 viewPos;  // Camera/viewer position
     alignas(16) glm::vec3 ambientColor;  // Ambient light color
     float ambientIntensity;         // Ambient light intensity
-    alignas(16) float padding[3];  // Padding for alignment (optional, for future-proofing)
+    // Point lights, filled by ClusteredLights::update
+    alignas(16) glm::mat4 clusterView;   // Main camera: the cluster grid is built in its view space
+    glm::vec4 clusterProjection;    // x, y: view to NDC scale, z: grid near, w: slices / log(far / near)
+    glm::uvec4 clusterInfo;         // x: light count, y: first light, z: first cluster word, w: 1 if clustered
 };
 
 
+// A cluster of at most 64 vertices / 124 triangles (MeshOptimizer::buildMeshlets). The cone
+// culls the whole cluster: it faces away when dot(normalize(apex - camera), axis) >= cutoff.
+struct Meshlet {
+    uint32_t vertexOffset;   // Into MeshletData::vertices
+    uint32_t triangleOffset; // Into MeshletData::triangles, 3 bytes per triangle
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    glm::vec4 sphere;        // Object space: xyz centre, w radius
+    glm::vec4 coneApex;      // xyz apex, w cutoff (1 never culls)
+    glm::vec4 coneAxis;      // xyz axis, w unused
+};
+
+struct MeshletData {
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;  // Indices into the object's vertices
+    std::vector<uint8_t> triangles;  // Corners as indices into the meshlet's own vertices
+};
+
+// One detail level of a mesh (MeshOptimizer::buildLodChain): a range of its indices over the shared
+// vertices. 'error' bounds how far the level's surface strays from the full mesh, in object space.
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;             // 0 for level 0
+};
+
 struct SceneObject {
     std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    std::vector<uint32_t> indices;      // Relative to this object's vertices; every level's, finest first
+    MeshletData meshlets;               // Built on import, over the same vertices and level 0's order
+    std::vector<MeshLod> lods;          // Empty: 'indices' is the only level
+    glm::mat4 transform = glm::mat4(1.0f);
+    uint32_t materialId = 0;
+};
+
+// One placement of a shared mesh
+struct SceneInstance {
+    uint32_t mesh = 0;                  // Into SceneDescription::meshes
+    glm::mat4 transform = glm::mat4(1.0f);
+    uint32_t materialId = 0;            // 0: the default material, else SceneDescription::materials[materialId - 1]
+};
+
+// A loaded scene file: every distinct mesh once (their transform and material are unused), then the
+// instances placing them; Scene::add uploads each mesh's geometry once however many instances it has.
+// The materials still need adding to the MaterialTable, and the instances' ids mapping to its indices.
+struct SceneDescription {
+    std::vector<SceneObject> meshes;
+    std::vector<SceneInstance> instances;
+    std::vector<MaterialDescription> materials;
 };
 
 #endif // VERTEX_H
@@ -4,9 +4,13 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <memory>
+#include <array>
+#include <map>
+#include <tuple>
+#include <deque>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include "DAEDescriptorPool.h"
+#include "DescriptorAllocator.h"
 #include "DAEUniformBufferObject.h"
 #include "Vertex.h"
 #include "VulkanUtil.h"
@@ -22,6 +26,58 @@
 #include "UnderwaterWaterPipeline.h"
 #include "OceanBottomMesh.h"
 #include "WaterTestingSystem.h"
+#include "UniformArena.h"
+#include "FrameArena.h"
+#include "WaterParamsBuffer.h"
+#include "Scene.h"
+#include "GpuCulling.h"
+#include "JobSystem.h"
+#include "SecondaryCommandRecorder.h"
+#include "RenderGraph.h"
+#include "GpuCounters.h"
+#include "FrameCapture.h"
+#include "GpuProfiler.h"
+#include "FrameReadback.h"
+#include "GpuImageCompare.h"
+#include "RegressionCompare.h"
+#include "DynamicResolution.h"
+#include "OffscreenThrottle.h"
+#include "TemporalUpscaler.h"
+#include "GodRayUpsampler.h"
+#include "ShadowCascades.h"
+#include "ClusteredLights.h"
+#include "ScreenSpaceReflections.h"
+#include "OceanCaustics.h"
+#include "AtmosphereSky.h"
+#include "FroxelVolume.h"
+#include "MarineSnow.h"
+#include "TileClassifier.h"
+#include "VariableRateShading.h"
+#include "RayQueryScene.h"
+#include "TiledCapture.h"
+#include "ReferenceImageCache.h"
+#include "TimelineSemaphore.h"
+#include "PresentPacer.h"
+#include "SimulationThread.h"
+#include "OceanFFT.h"
+#include "WaterHeightField.h"
+#include "AsyncCompute.h"
+#include "TextureCompressor.h"
+#include "TextureDecoder.h"
+#include "TextureStreamer.h"
+#include "ImageBasedLighting.h"
+#include "BindlessTable.h"
+#include "DeviceGroup.h"
+#include "Multiview.h"
+#include "MaterialTable.h"
+#include "ShaderHotReload.h"
+#include "StartupTimer.h"
+#include "ShaderBench.h"
+#include "ParameterSweep.h"
+#include "AutoTuner.h"
+#include "TelemetryStream.h"
+#include "HitchDetector.h"
+#include "RenderSettings.h"
 
 // Forward declarations
 class SwapChainManager;
@@ -30,16 +86,125 @@ class Shader2D;
 class Shader3D;
 class xrxsPipeline;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// Per-frame resources are allocated for this many frames; VulkanBase::framesInFlight picks how many are used
+const int MAX_FRAMES_IN_FLIGHT = 3;
+
+// Fixed-function state that differs between main scene pipeline variants. Rendering mode and
+// the lighting toggles are push constant / UBO data and select no variant
+struct MainPipelineKey
+{
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    bool indirect = false; // Per-instance model matrix: GPU-driven path and instanced draws
+    bool depthWrite = true; // false: shades over the depth pre-pass, LESS_OR_EQUAL
+    bool lodGrid = false;   // Ocean bottom: CDLOD tiles per instance (CdlodGrid.h)
+    bool depthOnly = false; // Depth pre-pass: vertex stage only, no colour writes
+
+    bool operator<(const MainPipelineKey &other) const
+    {
+        return std::tie(polygonMode, samples, indirect, depthWrite, lodGrid, depthOnly) <
+               std::tie(other.polygonMode, other.samples, other.indirect, other.depthWrite, other.lodGrid, other.depthOnly);
+    }
+};
+
+// What DrawSceneObjects records the scene for
+enum class ScenePass
+{
+    Shaded,       // Depth tested and written
+    DepthPrePass, // Depth only
+    AfterPrePass  // Shaded where the pre-pass left the fragment's own depth, no depth writes
+};
+
+// Offscreen benchmark run (BenchmarkMain.cpp): no window, surface or swapchain; the frame renders
+// into plain images, the configs run back to back and run() returns once the last one is exported
+struct HeadlessOptions
+{
+    VkExtent2D extent{VkUtils::WIDTH, VkUtils::HEIGHT};
+    std::vector<WaterTestConfig> configs;
+    std::string outputPath = "test_results/water_test_results.csv"; // Per-run CSV; summary.csv goes next to it
+    bool gpuImageCompare = false; // Frame-to-frame quality of every measured frame, on the GPU
+    bool streamFrameLog = false;  // Per-frame metrics to <outputPath stem>.xrfm instead of memory
+    std::string baselinePath;     // Non-empty: compare the suite against it (RegressionCompare.h)
+    RegressionThresholds regressionThresholds;
+    // Non-empty: replay the passes of this capture (FrameCapture.h) instead of running configs
+    std::string replayCapturePath;
+    std::vector<std::string> replayPasses; // Empty: every pass the capture recorded
+    uint32_t replayRepeat = 16;
+    uint32_t replayFrames = 300;
+    std::string cpuTracePath; // Non-empty: CPU zones of the whole run as a Chrome trace (CpuProfiler.h)
+    bool renderPasses = false; // Render passes and framebuffers even where dynamic rendering is supported
+    std::string gpu;           // Device index or part of its name, empty: by score (DeviceSelection.h)
+    bool deviceGroup = false;  // Span the GPU's device group, for configs with alternateFrameDevices (DeviceGroup.h)
+    bool stereo = false;       // Both eyes in one multiview main pass, side by side in the frame (Multiview.h)
+    // Non-empty: render this capture's frame as one large image in tiles (TiledCapture.h) instead of running configs
+    std::string renderCapturePath;
+    VkExtent2D renderSize{3840, 2160};
+    uint32_t renderSamples = 1;
+    // Render the configs' missing references (ReferenceImageCache.h) instead of running them
+    bool renderReferences = false;
+    uint32_t referenceSamples = ReferenceImageCache::kDefaultSamples;
+    std::string referenceDirectory = "references";
+    // Non-empty: time these shaders alone (ShaderBench.h) instead of running configs; results to outputPath
+    std::vector<ShaderBench::Shader> shaderBench;
+    std::vector<VkExtent2D> shaderBenchSizes{{1280, 720}, {1920, 1080}, {3840, 2160}};
+    uint32_t shaderBenchRepeat = 32;
+    uint32_t shaderBenchSamples = 16;
+    ShaderBench::PushConstants shaderBenchPush;
+    // > 0: search the OPT settings for this GPU frame time (AutoTuner.h) instead of running configs; cached per device
+    double autoTuneBudgetMs = 0.0;
+    double hitchThresholdMs = 0.0; // > 0: frames slower than this write hitch traces (HitchDetector.h)
+    std::string telemetryEndpoint; // host:port to stream frame metrics to (TelemetryStream.h); empty: XERENDER_TELEMETRY
+};
 
 class VulkanBase
 {
 public:
-    VulkanBase();
+    // 'gpu': device index or part of its name, empty to pick by score (DeviceSelection.h)
+    // 'stereo': both eyes in one multiview main pass, side by side in the window (Multiview.h)
+    explicit VulkanBase(const std::string &gpu = std::string(), bool stereo = false);
+    explicit VulkanBase(const HeadlessOptions &options);
     ~VulkanBase();
     void run();
 
+    // Runs completed by the test queue so far (the headless runner's exit status)
+    size_t getCompletedTestRunCount() const { return completedTestResults.size(); }
+    // The last suite was compared against a baseline and regressed
+    bool hasRegressionFailure() const { return regressionCompared && !regressionPassed; }
+    // Passes timed by the last pass replay
+    size_t getReplayResultCount() const { return lastReplayResults.size(); }
+    // The last tiled capture wrote its whole image
+    bool isTiledCaptureWritten() const { return tiledCaptureWritten; }
+    // References rendered by a renderReferences run
+    uint32_t getRenderedReferenceCount() const { return renderedReferences; }
+    // Searches the OPT settings for a GPU frame-time budget from the next frame on (AutoTuner.h). A windowed
+    // run skips the search if this device's cached preset already has that budget
+    void requestAutoTune(double budgetMs) { requestedAutoTuneMs = budgetMs; }
+    // The preset in use: the last search's, or the device's cached one
+    const std::optional<AutoTuner::Preset> &getAutoTunePreset() const { return autoTunePreset; }
+    // host:port that run() streams frame metrics to over UDP (TelemetryStream.h); empty: XERENDER_TELEMETRY, if set
+    void setTelemetryEndpoint(const std::string &endpoint) { telemetryEndpoint = endpoint; }
+
 private:
+    // First member: startup is timed from construction to the first frame (StartupTimer.h)
+    StartupTimer startupTimer;
+    bool headless = false;
+    HeadlessOptions headlessOptions;
+    std::string gpuOverride; // Command line; XERENDER_GPU is the fallback
+    // Set when the logical device spans more than one GPU (HeadlessOptions::deviceGroup)
+    std::unique_ptr<DeviceGroup> deviceGroup;
+    uint32_t frameDevice = 0; // Group device index the frame being recorded runs on
+    // Both eyes in one multiview main pass (Multiview.h). Fixed for the run: the main render pass
+    // every scene and water pipeline is built against carries the view mask
+    bool stereoRendering = false;
+    float eyeSeparation = Multiview::kDefaultEyeSeparation;
+    // One eye's half of the frame in stereo, else the whole frame: what the main camera projects onto
+    VkExtent2D getViewExtent() const;
+    // Turns off what a stereo frame cannot draw per eye; every frame, as the panel and configs may turn it on
+    void applyStereoLimits();
+    void runHeadless();
+    // Where the frame leaves the swapchain image: presented, or read back when headless
+    VkImageLayout getSwapchainFinalLayout() const { return headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+
     void initWindow();
     void initVulkan();
     void initImGui();
@@ -52,19 +217,18 @@ private:
     void createLogicalDevice();
     void createRenderPass();
     void createGraphicsPipeline();
-    void createFrameBuffers();
     void createCommandPool();
     void createVertexBuffer();
     void createIndexBuffer();
     void createUniformBuffers();
     void createDescriptorSetLayout();
-    void createDescriptorPool();
+    void createImGuiDescriptorPool();
     void createDescriptorSets();
     void createCommandBuffers();
     void createSyncObjects();
     void drawFrame();
     void recreateSwapChain();
-    void updateUniformBuffer(uint32_t currentImage);
+    void updateUniformBuffer();
     void processInput(float deltaTime);
 
     void keyEvent(int key, int scancode, int action, int mods);
@@ -74,7 +238,21 @@ private:
     void endRenderPass(const CommandBuffer &buffer);
     void recordCommandBuffer(CommandBuffer &commandBuffer, uint32_t imageIndex);
 
-    void DrawSceneObjects(CommandBuffer &commandBuffer, uint32_t imageIndex);
+    // Camera-dependent draw state for one rendering of the scene
+    struct SceneView
+    {
+        std::array<uint32_t, 3> uniformOffsets{}; // UBO, LightInfo, ToggleInfo (bindings 0, 2, 6)
+        std::vector<SceneDraw> drawList;
+        bool gpuDriven = false; // Whole scene as one GPU-culled indirect draw; drawList unused
+        bool instanced = false; // drawList entries are instanced batches, drawn with the per-instance pipelines
+        SceneLodView lod;       // Levels the CPU draw list picked, kept for the hysteresis
+    };
+
+    // lod < 0: the cube's implicit level; else that level (SkyboxPipeline.h)
+    void DrawSkybox(VkCommandBuffer cmd, uint32_t imageIndex, const SceneView &view, float lod = -1.0f);
+    // Draws view.drawList[firstDraw, firstDraw + drawCount), or the whole GPU-culled scene
+    void DrawSceneObjects(VkCommandBuffer cmd, uint32_t imageIndex, const SceneView &view, size_t firstDraw, size_t drawCount,
+                          ScenePass pass);
 
     void printMatrix(const glm::mat4 &mat, const std::string &name);
     void loadModel();
@@ -87,20 +265,33 @@ private:
     VkDevice device;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
-    VkSurfaceKHR surface;
+    VkQueue transferQueue;          // Same as graphicsQueue without a transfer-only family
+    uint32_t graphicsQueueFamily = 0;
+    uint32_t transferQueueFamily = 0;
+    VkQueue computeQueue = VK_NULL_HANDLE; // Async compute only
+    uint32_t computeQueueFamily = 0;
+    VkSurfaceKHR surface = VK_NULL_HANDLE; // Stays null when headless
     VkSwapchainKHR swapChain;
 
-    Camera camera;
+    Camera camera; // The render thread's copy of the snapshot's camera: written only by mainLoop
+
+    // Camera and clock stepped on their own thread, one immutable snapshot per frame (SimulationThread.h)
+    std::unique_ptr<SimulationThread> simulation;
+    SimulationInput simulationInput; // Gathered by the GLFW callbacks, processInput and the test path until the frame takes it
+    double simulationTime = 0.0;     // The snapshot's clock time: every shader time input
+    uint64_t simulationFrame = 0;    // The snapshot's clock frame: tags a test run's captures
+    bool threadedSimulation = true;  // Off: the step runs inline, without the frame of input latency
+    static constexpr double kFixedSimulationStep = 1.0 / 60.0; // FixedStep clock: frame k is at time k / 60
+    std::vector<double> replayFrameTimes; // Replay clock: run 0's frame times, replayed by the config's later runs
 
     std::unique_ptr<SwapChainManager> swapChainManager;
 
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
-    std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkRenderPass renderPass;
+    VkRenderPass renderPass; // Pipeline compatibility only; the render graph begins the real passes
     VkDescriptorSetLayout descriptorSetLayout;
-    VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline graphicsPipeline = VK_NULL_HANDLE; // Active variant, picked per frame by updatePipelineIfNeeded
     CommandPool commandPool;
     std::vector<CommandBuffer> commandBuffers;
 
@@ -108,16 +299,137 @@ private:
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-
-    std::unique_ptr<DAEDescriptorPool<UBO>> descriptorPool;
-
-    std::vector<VkBuffer> uniformBuffers;
-    std::vector<VkDeviceMemory> uniformBuffersMemory;
+    // Frame pacing: every frame's last submission signals the timeline's next value, and a frame slot
+    // (command buffers, arena region, descriptor pools, readback buffers...) is reused once the value
+    // tagged on it is reached
+    std::unique_ptr<TimelineSemaphore> frameTimeline;
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> frameSlotValues{};
+    // Slots in use, 2 or 3: one more frame queued trades latency for throughput
+    uint32_t framesInFlight = 2;
+    uint32_t requestedFramesInFlight = 2;   // Set by the UI and test configs, applied between frames
+    void setFramesInFlight(uint32_t count); // Drains the frames in flight first
+
+    std::unique_ptr<DescriptorAllocator> descriptorAllocator;
+    static constexpr uint32_t kImGuiDescriptorCount = 16;
+    VkDescriptorPool imguiDescriptorPool = VK_NULL_HANDLE;
+
+    // Per-frame uniform blocks for the frame being recorded
+    std::unique_ptr<UniformArena> uniformArena;
+    // Per-frame CPU scratch (pass job lists, panel lists), rewound alongside the uniform arena
+    FrameArena frameArena{MAX_FRAMES_IN_FLIGHT};
+    uint64_t recordHeapAllocations = 0; // By the last recordCommandBuffer, where FrameArena counts them
     std::vector<VkDescriptorSet> descriptorSets;
-
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    // Water tuning (set 1, binding 7), rewritten only when it changes; offset of this frame's copy
+    std::unique_ptr<WaterParamsBuffer> waterParamsBuffer;
+    uint32_t waterParamsOffset = 0;
+    // Dynamic offsets for sets 0 and 1 bound together: set 0's, then WaterParams
+    std::array<uint32_t, 4> withWaterParamsOffset(const std::array<uint32_t, 3> &offsets) const { return {offsets[0], offsets[1], offsets[2], waterParamsOffset}; }
+
+    // All scene geometry lives in one vertex/index buffer pair; objects draw by range
+    Scene scene;
+    SceneView mainView;       // Camera: main pass, and the refraction pass unless it has its own
+    SceneView reflectionView; // Camera mirrored in the water plane: reflection pass
+    SceneView refractionView; // Main camera at the offscreen LOD budget (refractionHasOwnView)
+    UBO frameUBO{}; // Camera/light part shared by every per-object UBO this frame
+    void buildSceneDrawList();
+    // CPU-culled, one UBO per drawn object or per view when instanced. Levels of detail are picked
+    // against lodPixelError * lodBudgetScale, over a target 'targetScale' of the swapchain's size
+    void buildViewDrawList(SceneView &view, const UBO &viewUBO, float lodBudgetScale = 1.0f, float targetScale = 1.0f);
+    // Merges each run of one mesh and level into an instanced draw, its instance data pushed to the uniform arena
+    void batchInstances(std::vector<SceneDraw> &draws);
+    // Final submission order of a built list: front to back (DrawKey.h)
+    void orderDraws(std::vector<SceneDraw> &draws);
+    // Mesh levels of detail (MeshOptimizer::buildLodChain): the coarsest whose error projects under
+    // lodPixelError pixels. The GPU-driven path always draws level 0
+    bool meshLods = true;
+    float lodPixelError = 1.0f;
+    static constexpr float kOffscreenLodScale = 4.0f; // Reflection, refraction and shadow passes get a coarser budget
+    SceneLodView shadowLod;
+    // The refraction pass renders the main pass' own scene at full scale; otherwise, without GPU
+    // culling, it draws a list of its own at the offscreen LOD budget
+    bool sharesSceneCapture() const;
+    bool refractionHasOwnView() const;
+    std::vector<GpuCullObject> instanceScratch;
+
+    // Sun shadows: set 3 of the main pipeline layout (ShadowCascades.h); a tier change is applied between frames
+    std::unique_ptr<ShadowCascades> shadowCascades;
+    ShadowQuality shadowQuality = ShadowQuality::Medium;
+    bool shadowRoundRobin = true;
+    std::vector<SceneDraw> shadowDrawList; // Casters of every cascade due this frame, culled once, as instanced draws
+    uint32_t shadowCasterCount = 0;
+    uint32_t shadowUniformOffset = 0;
+    void buildShadowDrawList();
+    void bindShadowSet(VkCommandBuffer cmd) const;
+
+    // Point lights, binned into clusters by a compute pass each frame (ClusteredLights.h): the
+    // secondary light first, then the bioluminescent ones scattered over the sea floor
+    std::unique_ptr<ClusteredLights> clusteredLights;
+    std::vector<PointLight> pointLights;
+    uint32_t scatteredLightCount = 0;
+    float scatteredLightRadius = 12.0f;
+    float scatteredLightIntensity = 4.0f;
+    bool clusteredLighting = true; // false: every fragment loops over every light
+    void scatterPointLights();
+
+    // GPU-driven alternative: compute culling into indirect draws (GpuCulling.h)
+    std::unique_ptr<GpuCulling> gpuCulling;
+    VkPipeline indirectGraphicsPipeline = VK_NULL_HANDLE; // graphicsPipeline + per-instance model matrix and material (also instanced draws)
+    std::unique_ptr<Shader3D> indirectShader3D;
+    VkPipeline oceanBottomPipeline = VK_NULL_HANDLE; // graphicsPipeline drawing CdlodGrid tiles
+    // Optional depth pre-pass of the main scene: the pass shading it then runs 3d_shader.frag only for
+    // the visible sample of each pixel. Variants are null while it is off
+    bool depthPrePass = false;
+    VkPipeline prePassPipeline = VK_NULL_HANDLE;
+    VkPipeline prePassIndirectPipeline = VK_NULL_HANDLE;
+    VkPipeline afterPrePassPipeline = VK_NULL_HANDLE;
+    VkPipeline afterPrePassIndirectPipeline = VK_NULL_HANDLE;
+    std::unique_ptr<Shader3D> lodShader3D;
+    bool gpuDrivenSupported = false;         // multiDrawIndirect + drawIndirectFirstInstance
+    bool drawIndirectCountSupported = false; // VK_KHR_draw_indirect_count
+    bool tessellationSupported = false;      // tessellationShader: the tessellated water surface
+    bool asyncComputeSupported = false;      // Compute family without graphics + timeline semaphores
+    bool presentWaitSupported = false;       // VK_KHR_present_id + VK_KHR_present_wait, never headless
+    bool pipelineStatisticsSupported = false; // pipelineStatisticsQuery + inheritedQueries: GpuCounters
+    bool performanceQuerySupported = false;   // VK_KHR_performance_query + hostQueryReset: GpuCounters vendor counters
+    bool dynamicRenderingEnabled = false;     // VK_KHR_dynamic_rendering: graph passes without render passes (DynamicRendering.h)
+    bool memoryBudgetSupported = false;       // VK_EXT_memory_budget: the heaps' budgets as the driver sees them
+    bool textureCompressionBCSupported = false;   // Cooked BC7/BC5 textures
+    bool textureCompressionASTCSupported = false; // Cooked ASTC textures (LDR)
+    bool depthSampleable = false;            // Depth attachment can feed the Hi-Z build and the god ray upsample
+    bool gpuDrivenScene = false;             // Submission path selected in the UI / test config
+    bool gpuOcclusionCulling = false;
+    bool instancedDraws = true;              // CPU path: objects sharing a mesh in one instanced draw
+    void createGpuCulling();
+
+    // Pass contents recorded as jobs into per-thread secondaries (SecondaryCommandRecorder.h)
+    std::unique_ptr<JobSystem> jobSystem;
+    std::unique_ptr<SecondaryCommandRecorder> secondaryRecorder;
+    std::vector<VkCommandBuffer> secondaryBuffers; // Scratch for recordPassJobs
+    bool parallelRecording = true;
+    static constexpr size_t kMinDrawsPerJob = 64; // Smaller chunks cost more in secondaries than they save
+    void createSecondaryRecorder();
+    // The view's draw list, split into chunks across the recording threads, then the skybox
+    void appendSceneJobs(SecondaryCommandRecorder::RecordJobs &jobs, uint32_t imageIndex, const SceneView &view,
+                         ScenePass pass = ScenePass::Shaded);
+    // Records the jobs in order inside a graph pass: into secondaries if the pass was declared with them, else inline
+    // renderScale < 1 draws into the top-left of the pass' attachments (dynamic resolution)
+    void recordPassJobs(const RenderGraphPassContext &pass, const SecondaryCommandRecorder::RecordJobs &jobs,
+                        float renderScale = 1.0f);
+
+    // Declares and records the frame's passes (RenderGraph.h)
+    std::unique_ptr<RenderGraph> renderGraph;
+    // Per-pass GPU timestamps, one query range per frame in flight (GpuProfiler.h)
+    std::unique_ptr<GpuProfiler> gpuProfiler;
+    // Per-pass pipeline statistics and vendor counters while a test run captures them (GpuCounters.h)
+    std::unique_ptr<GpuCounters> gpuCounters;
+    // Screenshots and image-quality captures, copied inside the frame and encoded off the main thread (FrameReadback.h)
+    std::unique_ptr<FrameReadback> frameReadback;
+    void requestFrameReadbacks();
+    // Per-frame SSIM/PSNR/delta E against a reference kept on the GPU (GpuImageCompare.h)
+    std::unique_ptr<GpuImageCompare> imageCompare;
+    bool gpuImageCompare = false;
+    GpuImageCompareResult lastImageCompare{};
+    void collectImageCompare();
 
     // Mouse var
     bool lmbPressed = false;
@@ -129,6 +441,7 @@ private:
 
     bool framebufferResized = false;
     bool isRecreatingSwapChain = false;
+    uint32_t retiredSwapChainFrames = 0; // Frames left before the swapchain replaced by a resize is destroyed
     bool isDeviceSuitable(VkPhysicalDevice device);
     bool checkValidationLayerSupport();
 
@@ -157,14 +470,38 @@ private:
 
     void createTextureImage();
     void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
     void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory);
-    void createTextureImageView();
     VkImageView createCubemapImageView(VkImage image, VkFormat format);
-    void loadTexture(const std::string &filePath, VkImage &textureImage, VkDeviceMemory &textureImageMemory);
-    VkImageView textureImageView;
+    // Uses <filePath stem>.ktx2 when it is up to date and sampleable, else decodes the image and blits
+    // mips (R8G8B8A8_SRGB, or UNORM for a TwoChannel normal/dudv map). Sets mipLevels; returns the
+    // format to create the view with.
+    VkFormat loadTexture(const std::string &filePath, VkImage &textureImage, VkDeviceMemory &textureImageMemory,
+                         TextureCompressor::Kind kind = TextureCompressor::Kind::Color);
+    VkFormat uploadCookedTexture(const Ktx2::Image &image, VkImage &textureImage, VkDeviceMemory &textureImageMemory);
+    bool isTextureFormatUsable(VkFormat format) const;
+    // Decodes every startup texture at once on the job system; loadTexture then only uploads
+    void prefetchTextures();
+    TextureDecoder textureDecoder;
+    // Material maps: placeholders until their mips stream in
+    std::unique_ptr<TextureStreamer> textureStreamer;
+
+    // Set 2: the material table and the irradiance SH, addressed by the indices in MaterialPush
+    std::unique_ptr<BindlessTable> bindlessTable;
+    struct MaterialPush
+    {
+        uint32_t materialBuffer; // This frame's copy of the material table
+        uint32_t irradianceBuffer;
+    };
+    static constexpr uint32_t kMaterialPushOffset = 16; // After WaterPushConstant
+    MaterialPush materialPush{};
+    // Every object's material, indexed per draw (MaterialTable.h); material 0 is the vehicle's maps
+    std::unique_ptr<MaterialTable> materialTable;
+    void createMaterialTable();
+    void registerBindlessResources();
+    void refreshMaterialTable(); // Once per frame, after textureStreamer->update()
+    void bindMaterialTable(VkCommandBuffer cmd) const;
+    // Adds the scene's materials to the table, then its meshes and instances with the table's indices
+    void addSceneDescription(SceneDescription description);
     VkSampler textureSampler;
     VkSamplerCreateInfo samplerInfo;
 
@@ -173,58 +510,47 @@ private:
     VkImage depthImage;
     VkDeviceMemory depthImageMemory;
     VkImageView depthImageView;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
     void createDepthResources();
     VkFormat findDepthFormat();
     VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
     bool hasStencilComponent(VkFormat format);
 
-    VkImage metalnessImage;
-    VkDeviceMemory metalnessImageMemory;
-    VkImageView metalnessImageView;
-
-    // Normal texture
-    VkImage normalImage;
-    VkDeviceMemory normalImageMemory;
-    VkImageView normalImageView;
-
-    // Specular texture
-    VkImage specularImage;
-    VkDeviceMemory specularImageMemory;
-    VkImageView specularImageView;
-
-    void createAdditionalTextures();
-
     uint32_t mipLevels;
     void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 
     VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkSampleCountFlagBits maxMsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkSampleCountFlags usableSampleCounts = 0;                         // Colour and depth attachments alike
+    VkSampleCountFlagBits requestedMsaaSamples = VK_SAMPLE_COUNT_1_BIT; // Set by the UI and test configs, applied between frames
+    // Drains the frames in flight, then rebuilds the depth target, the main render pass and its pipelines
+    void setMsaaSamples(VkSampleCountFlagBits samples);
+    void recreateMainPassPipelines();
 
     VkSampleCountFlagBits getMaxUsableSampleCount();
-    VkImage colorImage;
-    VkDeviceMemory colorImageMemory;
-    VkImageView colorImageView;
-    void createColorResources();
+    VkSampleCountFlagBits getUsableSampleCount(uint32_t requested) const;
 
     // light
-
-    std::vector<VkBuffer> lightInfoBuffers;
-    std::vector<VkDeviceMemory> lightInfoBuffersMemory;
-    void createLightInfoBuffers();
-
-    void updateLightInfoBuffer(uint32_t currentImage);
+    void updateLightInfoBuffer();
     bool rotationEnabled = false;
     bool rKeyPressed = false;
     ImVec4 backgroundColor = ImVec4(0.04f, 0.1f, 0.09f, 0.1f); // Initial background color for ImGui
     VkClearValue clearColor;                                   // Clear value used by Vulkan
     bool wireframeEnabled = false;
-    bool currentWireframeState = false; // Store the last known wireframe state
     void updatePipelineIfNeeded();
 
+    // Main scene pipeline variants, prebuilt in createGraphicsPipeline; a missing one is built on first use
+    std::map<MainPipelineKey, VkPipeline> mainPipelines;
+    VkPipeline buildMainPipeline(const MainPipelineKey &key) const; // Thread-safe
+    VkPipeline getMainPipeline(const MainPipelineKey &key);
+    void destroyMainPipelines();
+
+    // Interactive builds: edited GLSL is recompiled in the background and its pipelines rebuilt between frames
+    std::unique_ptr<ShaderHotReload> shaderHotReload;
+    void applyShaderReloads();
+
     // toggleInfo
-    std::vector<VkBuffer> toggleInfoBuffers;
-    std::vector<VkDeviceMemory> toggleInfoBuffersMemory;
-    void createToggleInfoBuffers();
-    void updateToggleInfo(uint32_t currentImage, const ToggleInfo &toggleInfo);
+    void updateToggleInfo(const ToggleInfo &toggleInfo);
 
     ToggleInfo currentToggleInfo;
 
@@ -238,23 +564,20 @@ private:
 
     glm::vec3 light0Position = glm::vec3(50.0f, 500.0f, -100.0f); // Sun position - high in sky
     glm::vec3 light1Position = glm::vec3(10.0f, 40.0f, 0.0f);     // White light position
+    float light1Radius = 80.0f;                                     // Point light: no light past it
 
     glm::vec3 ambientColor = glm::vec3(1.0f, 1.0f, 1.0f); // White light default color
     float ambientIntensity = 3.0f;
 
     void loadSceneFromJson(const std::string &sceneFilePath);
-    std::vector<SceneObject> sceneObjects;
-
-    // screenshot image
-    VkImage screenshotImage;
-    VkDeviceMemory screenshotImageMemory;
-
-    void createScreenshotImage(VkExtent2D extent, VkFormat format);
-    void blitImage(VkImage srcImage, VkImage dstImage, VkExtent2D extent);
-    void saveScreenshot(VkImage image, VkExtent2D extent, const std::string &filename);
-    void takeScreenshot();
 
+    // screenshot (taken through frameReadback)
     bool screenshotRequested = false;
+    // Control panel cost: rebuilt every uiUpdateInterval frames; hidden (F1, kiosk mode) it is not built or drawn
+    uint32_t uiUpdateInterval = 1;
+    uint32_t uiFramesSinceBuild = 0;
+    bool uiHidden = false;
+    bool f1KeyPressed = false;
     bool captureScreenshot = false;
     std::string lastScreenshotFilename = "";
     ImTextureID screenshotTextureID = nullptr;
@@ -264,47 +587,100 @@ private:
     // SKYBOX
     std::unique_ptr<SkyboxMesh> skyboxMesh;
     std::unique_ptr<SkyboxPipeline> skyboxPipeline;
+    static constexpr float kReflectionSkyLod = 2.0f; // The reflection pass' sky: a quarter-size level of the cube
 
-    VkDescriptorPool skyboxDescriptorPool = VK_NULL_HANDLE;
     VkDescriptorSetLayout skyboxDescriptorSetLayout = VK_NULL_HANDLE;
     VkDescriptorSet skyboxDescriptorSet = VK_NULL_HANDLE;
+    // Procedural sky following the sun; drawn instead of the cube when atmosphericSky is on
+    std::unique_ptr<AtmosphereSky> atmosphereSky;
+    VkDescriptorSet atmosphereSkyDescriptorSet = VK_NULL_HANDLE;
+    bool atmosphericSky = false;
 
     VkImage skyboxImage = VK_NULL_HANDLE;
     VkDeviceMemory skyboxImageMemory = VK_NULL_HANDLE;
     VkImageView skyboxImageView = VK_NULL_HANDLE;
     VkSampler skyboxSampler = VK_NULL_HANDLE;
+    // Ambient light filtered from the sky, cached as textures/skybox.jpg.ibl (scene set bindings 8-9, SH in the bindless table)
+    std::unique_ptr<ImageBasedLighting> imageBasedLighting;
 
     // ---- SKYBOX DESCRIPTORS ----
     void createSkyboxDescriptorSetLayout();
     void createSkyboxDescriptorSet();
-
-    void createSkyboxDescriptorPool();
+    void createAtmosphereSkyDescriptorSet();
 
     bool useSolidBackground = false; // default ON
 
     // Water rendering members
     std::unique_ptr<WaterMesh> waterMesh;
     std::unique_ptr<WaterPipeline> waterPipeline;
+    // Optional surface subdivided on the GPU by edge length (water.tesc); null without tessellationShader
+    std::unique_ptr<WaterPipeline> waterTessPipeline;
+    bool waterTessellation = false;
+    float waterTessEdgePixels = 12.0f; // Target projected length of a subdivided edge
+    WaterPipeline *getWaterSurfacePipeline() const { return waterTessellation && waterTessPipeline ? waterTessPipeline.get() : waterPipeline.get(); }
+    // Added to the stages of the descriptors water.tesc/water.tese read
+    VkShaderStageFlags getTessellationStages() const { return tessellationSupported ? VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT : 0; }
+    // Displacement/normal/foam maps water.vert and water.frag sample (set 1, bindings 5-6)
+    std::unique_ptr<OceanFFT> oceanFFT;
+    // Its surface read back for the CPU; the camera's underwater test asks it once per frame
+    std::unique_ptr<WaterHeightField> waterHeights;
+    float cameraWaterHeight = 0.0f;
+    // Caustics traced through those maps each underwater frame (set 1, binding 9); off: the static caustic texture
+    std::unique_ptr<OceanCaustics> oceanCaustics;
+    bool computedCaustics = true;
+    // Underwater fog and light shafts from a froxel volume (set 1, binding 10); off: the full-screen fog and ray-march passes
+    std::unique_ptr<FroxelVolume> froxelVolume;
+    bool froxelVolumetrics = true;
+    // The three above on a compute-only queue, overlapping the shadow and reflection passes; null without one
+    std::unique_ptr<AsyncCompute> asyncCompute;
+    bool asyncComputeEnabled = false;
+    // CDLOD planes (CdlodGrid.h): the finest water tiles span 20000 / 2^9 ~ 39 units, 1.2-unit cells
+    static constexpr float kWaterGridSize = 20000.0f;
+    static constexpr uint32_t kWaterLodLevels = 10;
+    static constexpr uint32_t kOceanBottomLodLevels = 7; // Flat: coarse cells suffice
+    static constexpr const char *kBathymetryPath = "res/bathymetry.bathy"; // Optional survey data for the floor (BathymetryField.h)
+    static constexpr float kOceanViewDistance = 1000.0f; // The projection's far plane; tiles beyond are dropped
+    static constexpr float kCameraNear = 0.1f;           // The projection's near plane
+    // Water tiles outside the main view are culled, their bounds padded by the waves' reach (WaterHeightField)
+    static constexpr float kWaveMarginScale = 1.5f;     // Its level is filtered and a frame or two old
+    static constexpr float kWaveMarginFallback = 20.0f; // Until its first readback
+    bool waterTileCulling = true;
 
     // Underwater rendering members
     std::unique_ptr<UnderwaterWaterPipeline> underwaterWaterPipeline;
     std::unique_ptr<OceanBottomMesh> oceanBottomMesh;
     // Full-screen volumetric sunrays pipeline
     std::unique_ptr<WaterPipeline> sunraysPipeline;
+    // Fog and sunrays at half resolution, reconstructed over frames and composited by the upscaler
+    std::unique_ptr<TemporalUpscaler> temporalUpscaler;
+    std::unique_ptr<UnderwaterWaterPipeline> lowResUnderwaterPipeline;
+    std::unique_ptr<WaterPipeline> lowResSunraysPipeline;
+    bool temporalUnderwaterEffects = false;
+    // OPT mode tier: sunrays at quarter area, upsampled onto the resolved frame after the main pass
+    std::unique_ptr<GodRayUpsampler> godRayUpsampler;
+    bool halfResGodRays = false;
+    // The analytic fog over the screen tiles it can reach (TileClassifier.h) instead of a full-screen triangle
+    std::unique_ptr<TileClassifier> tileClassifier;
+    bool tiledEffects = false;
+    // The tiled fog and the sunrays at coarser rates behind thick, flat fog (VariableRateShading.h)
+    std::unique_ptr<VariableRateShading> shadingRates;
+    bool variableRateShading = false;
+    bool variableRateShadingSupported = false;
+    // false: every water pipeline uses the WaterVariant::kRuntime variant (the branching baseline)
+    bool specializedWaterShaders = true;
+    // Before recording: points each water pipeline at the variant for this mode and debug view;
+    // effectRates false keeps the effects off the shading-rate variants (no ShadingRate pass this frame)
+    void selectWaterVariants(uint32_t renderingMode, uint32_t debugView, bool effectRates = true);
 
     void createWaterResources();
     void createWaterDescriptorSetLayout();
     void createWaterDescriptorSet();
-    void createWaterDescriptorPool();
-    void createWaterDescriptors();
     void updateWaterDescriptors();
     VkImageView loadWaterTexture(const std::string &fileName);
     void createSceneColorTexture();
     void createWaterSampler();
     void createSceneReflectionTexture();
-    void createSceneReflectionRenderPassAndFramebuffer();
-    void createSceneRefractionRenderPassAndFramebuffer();
-    void createSceneRenderPassAndFramebuffer();
+    void destroySceneTargets(); // Refraction/reflection images and views, samplers kept
 
     // ============================================================================
     // WATER RESOURCES — IMAGES / VIEWS / SAMPLERS
@@ -329,84 +705,74 @@ private:
 
     VkDescriptorSet waterDescriptorSet = VK_NULL_HANDLE;
     VkDescriptorSetLayout waterDescriptorSetLayout = VK_NULL_HANDLE;
-    VkDescriptorPool waterDescriptorPool = VK_NULL_HANDLE;
 
     VkImage sceneColorImage = VK_NULL_HANDLE;
     VkDeviceMemory sceneColorImageMemory = VK_NULL_HANDLE;
     VkImageView sceneColorImageView = VK_NULL_HANDLE;
     VkSampler sceneColorSampler = VK_NULL_HANDLE;
 
-    VkRenderPass sceneRenderPass = VK_NULL_HANDLE;
-    VkFramebuffer sceneFramebuffer = VK_NULL_HANDLE;
-
     bool sceneOffscreenReady = false;
 
-    float waterSpeed = 1.0f;
-    bool showDebugRays = false;
-    // === WATER COLOR AND SETTINGS ===
-    glm::vec3 waterBaseColor = glm::vec3(0.0f, 0.3f, 0.5f);  // Deep blue/cyan base
-    glm::vec3 waterLightColor = glm::vec3(1.0f, 1.0f, 1.0f); // White directional light
-    float waterAmbient = 0.2f;
-    float waterShininess = 512.0f;
-    float waterCausticIntensity = 2.0f;
-    float waterDistortionStrength = 0.04f;
-    float waterFresnelR0 = 0.02f;
-    float waterSurfaceOpacity = 0.55f;
-
-    // Underwater specific settings
-    float oceanBottomCausticIntensity = 1.0f;
-    float underwaterGodRayIntensity = 1.0f;
-    float underwaterScatteringIntensity = 0.5f;
-    float underwaterOpacity = 0.9f;
-    float underwaterFogDensity = 0.05f;
-
-    // Marine Snow - suspended particles for scale reference
-    float marineSnowIntensity = 0.5f; // 0 = off, 1 = heavy particulates
-    float marineSnowSize = 1.0f;      // Particle size multiplier
-    float marineSnowSpeed = 1.0f;     // Drift speed
-
-    // Chromatic Aberration - underwater lens effect
-    float chromaticAberrationStrength = 0.15f; // Color separation intensity
-    bool showMarineSnowDebug = false;          // Debug: highlight particles
-    bool showChromaticDebug = false;           // Debug: exaggerate CA
-
-    glm::vec3 underwaterShallowColor = {0.0f, 0.6f, 0.8f};
-    glm::vec3 underwaterDeepColor = {0.0f, 0.1f, 0.25f};
+    // Water and underwater tuning (RenderSettings.h): the live values the panel and the tests edit, and
+    // the frame's snapshot every pass reads, taken by snapshotRenderSettings() before anything is recorded
+    RenderSettings renderSettings;
+    RenderSettings frameSettings;
+    uint64_t frameSettingsHash = 0;
+    uint64_t frameSettingsVersion = 0; // Moves when the snapshot's values change
+    void snapshotRenderSettings();
+
+    // Marine snow as GPU particles around the camera (RenderSettings::marineSnowParticles)
+    std::unique_ptr<MarineSnow> marineSnow;
 
     VkDeviceMemory sceneReflectionImageMemory;
     VkImageView sceneReflectionImageView;
     VkSampler sceneReflectionSampler;
 
-    VkDeviceMemory sceneRefractionImageMemory;
-    VkImageView sceneRefractionImageView;
-    VkSampler sceneRefractionSampler;
-
-    VkRenderPass sceneReflectionRenderPass;
-    VkRenderPass sceneRefractionRenderPass;
-
-    VkFramebuffer sceneReflectionFramebuffer;
-    VkFramebuffer sceneRefractionFramebuffer;
-
     VkImage sceneReflectionImage;
-    VkImage sceneRefractionImage;
-
-    // Extents (Resolution) for the off-screen textures
-    VkExtent2D reflectionExtent = {800, 600};
-    VkExtent2D refractionExtent = {800, 600};
     glm::mat4 reflectionViewMatrix;
 
-    glm::mat4 calculateProjectionMatrix();
-
-    void recordReflectionPass(CommandBuffer &commandBuffer, uint32_t imageIndex);
-    void recordRefractionPass(CommandBuffer &commandBuffer, uint32_t imageIndex);
-    void insertWaterTextureBarriers(CommandBuffer &commandBuffer);
+    // Render the reflection into sceneReflectionImage and the refraction into sceneColorImage
+    // (every frame unless throttled); off, the water samples whatever those targets hold
+    bool waterOffscreenPasses = false;
+    // Scales both passes to hold a GPU frame time target
+    DynamicResolution dynamicResolution;
+    // Skips both passes on frames where water.frag can reproject their last render instead
+    OffscreenThrottle offscreenThrottle;
+    uint32_t offscreenTargetsKey = 0; // Which targets the passes fill (updateUniformBuffer); a change re-renders
+    // Water plane at y = 0
+    bool isCameraUnderwater() const { return camera.position.y < cameraWaterHeight - 0.1f; }
+    // The near plane reaches both above and below that surface: the frame is split at the waterline,
+    // the underwater fog drawn only over the part of the screen in the water (TileClassifier.h)
+    bool cameraCrossesWaterline() const;
+    // Per rendering mode: screen-space drops the reflection pass and traces the refraction pass instead
+    std::unique_ptr<ScreenSpaceReflections> screenSpaceReflections;
+    std::array<ReflectionMode, 3> reflectionModes = {ReflectionMode::Planar, ReflectionMode::Planar, ReflectionMode::Planar};
+    bool useScreenSpaceReflections() const
+    {
+        return waterOffscreenPasses && screenSpaceReflections->isAvailable() &&
+               reflectionModes[frameSettings.renderingMode] == ReflectionMode::ScreenSpace;
+    }
+    // Ray-query mode: the scene's acceleration structures, null without device support (RayQueryScene.h)
+    std::unique_ptr<RayQueryScene> rayQueryScene;
+    bool rayQuerySupported = false;
+    bool useRayQueryReflections() const
+    {
+        return waterOffscreenPasses && rayQueryScene && rayQueryScene->hasGeometry() &&
+               reflectionModes[frameSettings.renderingMode] == ReflectionMode::RayQuery;
+    }
+    // Above water the ray-query mode renders neither pass; underwater it keeps the planar ones
+    bool tracesSceneRays() const { return useRayQueryReflections() && !isCameraUnderwater(); }
+    ReflectionTier getReflectionTier() const
+    {
+        return !waterOffscreenPasses         ? ReflectionTier::Off
+               : useScreenSpaceReflections() ? ReflectionTier::ScreenSpace
+               : useRayQueryReflections()    ? ReflectionTier::RayQuery
+                                             : ReflectionTier::Planar;
+    }
 
-    void createSceneRefractionTexture();
     void createImGuiRenderPass();
-    void createImGuiFramebuffers();
 
-    VkRenderPass imguiRenderPass = VK_NULL_HANDLE;
-    std::vector<VkFramebuffer> imguiFramebuffers;
+    VkRenderPass imguiRenderPass = VK_NULL_HANDLE; // Pipeline compatibility only, like renderPass
 
     // ============================================================================
     // WATER TESTING SYSTEM
@@ -424,26 +790,167 @@ private:
     // Test timing - for accurate frame time measurement
     std::chrono::high_resolution_clock::time_point lastFrameTime;
     std::chrono::high_resolution_clock::time_point frameStartTimePoint; // Set BEFORE drawFrame
-    double lastCpuTimeMs = 0.0;
+    double lastFrameTimeMs = 0.0;
 
-    // Benchmark timing - GPU-synchronized frame timing
+    // Benchmark timing - frame time of the latest completed frame
     bool isBenchmarkActive = false;
-    double gpuSyncedFrameTimeMs = 16.67; // GPU-synchronized frame time in ms (default ~60fps)
+    double benchmarkFrameTimeMs = 16.67; // In ms (default ~60fps)
+    bool pipelinedTiming = true;         // Keep frames in flight while measuring (WaterTestConfig::pipelinedTiming)
+
+    // Present pacing and motion-to-photon latency (PresentPacer.h); null without present wait
+    std::unique_ptr<PresentPacer> presentPacer;
+    bool presentPacing = false; // Start each frame once the previous one is displayed
+    static constexpr uint64_t kPresentWaitTimeoutNs = 100'000'000; // A hidden window displays nothing
+
+    // Frame completion tracking: a frame is done once its timeline value is seen reached, polled without waiting
+    struct InFlightFrameTiming
+    {
+        std::chrono::high_resolution_clock::time_point start;     // frameStartTimePoint of the frame
+        std::chrono::high_resolution_clock::time_point submitted; // After vkQueueSubmit
+        uint64_t frameNumber = 0;
+        uint64_t timelineValue = 0; // What the frame's submission signals on frameTimeline
+        bool pending = false;
+    };
+    struct CompletedFrameTiming
+    {
+        double intervalMs; // Since the previous frame completed: throughput
+        double latencyMs;  // Start to completion
+        double cpuMs;      // Start to submission
+        uint64_t frameNumber;
+        uint64_t completedNs; // CpuProfiler::nowNs() when observed
+    };
+    std::array<InFlightFrameTiming, MAX_FRAMES_IN_FLIGHT> inFlightFrameTimings{};
+    std::vector<CompletedFrameTiming> completedFrameTimings; // Observed since mainLoop last consumed them
+    std::chrono::high_resolution_clock::time_point lastFrameCompletion;
+    uint64_t submittedFrameCount = 0;
+    void observeFrameCompletions();
 
     // Test UI state
-    int selectedTestType = 0; // 0=Performance, 1=ImageQuality, 2=TradeOff, 3=Custom
+    int selectedTestType = 0; // 0=Performance, 1=ImageQuality, 2=TradeOff, 3=Custom, 4=Submission
     bool autoExportResults = true;
     bool captureTestScreenshots = false;
+    bool streamFrameLog = false; // Soak runs: frames go to a binary log next to the CSV (FrameMetricsLog.h)
+    bool reorderTestConfigs = true; // WaterTestingSystem::orderByStateChanges
+    bool captureGpuCounters = false; // WaterTestConfig::captureGpuCounters of the suites started from the UI
+    CameraPathRecorder cameraPathRecorder; // Fed the snapshot camera each frame while recording
+    std::string recordedCameraPathFile;    // The custom and quick runs follow it instead of the preset path
+
+    // Baseline comparison at the end of a suite (RegressionCompare.h)
+    std::string regressionBaselinePath;
+    RegressionThresholds regressionThresholds;
+    bool regressionCompared = false;
+    bool regressionPassed = false;
+    int regressionFailures = 0;
+    void compareAgainstBaseline();
+
+    // Frame capture and pass replay (FrameCapture.h)
+    std::unique_ptr<PassReplay> passReplay; // Non-null while replaying: every frame is the capture's
+    WaterParams frameWaterParams{};          // As the last recorded frame uploaded it
+    std::optional<FrameCapture> lastFrameCapture;
+    std::string lastFrameCapturePath;
+    std::string requestedReplayPass;         // From the Render Graph panel; started before the next frame
+    std::vector<PassReplay::PassResult> lastReplayResults;
+    std::string replayOutputPath = "test_results/pass_replay.csv";
+    uint32_t replayRepeat = 16;
+    uint32_t replayFrames = 300;
+    void captureFrame();
+    // Shader bench (ShaderBench.h): ordinary frames at a fixed pose fill the sets, then each shader is timed alone
+    static constexpr uint32_t kShaderBenchWarmupFrames = 16;
+    uint32_t shaderBenchFramesLeft = 0; // Keeps a headless mainLoop running
+    void runShaderBench();
+    void startPassReplay(FrameCapture capture, std::vector<std::string> passes, uint32_t repeat, uint32_t frames);
+    void endPassReplay(); // Writes replayOutputPath
+
+    // High-resolution tiled capture (TiledCapture.h); the pose, the clock and the settings are held until it ends
+    std::unique_ptr<TiledCapture> tiledCapture;
+    TiledCaptureSettings tiledCaptureSettings; // The Camera panel's
+    // What applyCaptureLimits switched off, put back by endTiledCapture
+    struct CaptureRestore
+    {
+        bool occlusionCulling = false;
+        bool temporalEffects = false;
+        bool variableRateShading = false;
+        bool dynamicResolution = false;
+    };
+    CaptureRestore tiledCaptureRestore;
+    bool tiledCaptureWritten = false;
+
+    // Image-quality references (ReferenceImageCache.h): compared at a run's reference frames, and
+    // rendered one after another, each as a one-tile capture, by a headless renderReferences run
+    struct ReferenceRender
+    {
+        WaterTestConfig config; // ReferenceImageCache::referenceConfig
+        uint32_t frame = 0;
+        ReferenceKey key;
+    };
+    std::unique_ptr<ReferenceImageCache> referenceCache;
+    uint64_t testReferenceScene = 0; // The running config's ReferenceImageCache::hashScene
+    std::deque<ReferenceRender> pendingReferences;
+    uint32_t renderedReferences = 0;
+    void queueReferenceRenders(const std::vector<WaterTestConfig> &configs);
+    void startNextReferenceRender();
+    // Held at 'pose' and 'time' until endTiledCapture
+    void startTiledCapture(const TiledCaptureSettings &settings, const CameraPose &pose, double time);
+    void endTiledCapture();
+
+    // Remote telemetry (TelemetryStream.h): open for the whole run when an endpoint is set
+    std::string telemetryEndpoint;
+    std::unique_ptr<TelemetryStream> telemetry;
+    void startTelemetry();
+    // One completed frame: the times, the GPU profiler's top-level passes, the memory budget when due
+    void pushTelemetry(const CompletedFrameTiming &completed);
+
+    // OPT auto-tuning (AutoTuner.h): the camera and the clock held while the search renders its trials, the
+    // image compare against a frame at the top settings. Presets are cached per GPU, driver and extent
+    std::unique_ptr<AutoTuner> autoTuner;
+    double requestedAutoTuneMs = 0.0; // > 0: a search starts before the next frame
+    float autoTunePanelBudgetMs = 8.3f;
+    std::optional<AutoTuner::Preset> autoTunePreset;
+    std::string autoTuneCachePath = "autotune_cache.json";
+    struct AutoTuneRestore
+    {
+        bool gpuImageCompare = false;
+        GpuImageCompare::Reference referenceMode = GpuImageCompare::Reference::PreviousFrame;
+    };
+    AutoTuneRestore autoTuneRestore;
+    std::string autoTuneDeviceKey() const;
+    void startAutoTune(double budgetMs);
+    void updateAutoTune(); // After each frame: applies the trial's settings, ends the search when done
+    void endAutoTune();    // Caches the result
+    void applyAutoTuneLevels(const AutoTuner::Levels &levels);
+    void applyCaptureLimits();
+
+    // CPU trace recorded from the Render Graph panel
+    static constexpr uint32_t kCpuTraceFrames = 300;
+    uint32_t cpuTraceFramesLeft = 0;
+    std::string cpuTracePath;
+
+    // Hitch traces (HitchDetector.h): always on in windowed runs, headless ones opt in
+    std::unique_ptr<HitchDetector> hitchDetector;
+    float hitchPanelThresholdMs = static_cast<float>(HitchDetector::kDefaultThresholdMs);
+    void markHitchEvent(const char *what)
+    {
+        if (hitchDetector)
+            hitchDetector->markEvent(what);
+    }
 
     // Methods for testing
     void initializeWaterTestingSystem();
     void cleanupWaterTestingSystem();
     void startWaterTest(const WaterTestConfig &config);
-    void updateWaterTest();
-    void preFrameWaterTestUpdate();  // Camera setup before rendering
-    void postFrameWaterTestUpdate(); // Timing measurement after GPU sync
+    void restartTestClock(const WaterTestConfig &config, int runIndex); // Camera path and clock for a run starting
+    // Orders the suite (reorderTestConfigs), compiles every pipeline it will switch to, then starts it
+    void startTestSuite(std::vector<WaterTestConfig> configs);
+    void prebuildTestPipelines(const std::vector<WaterTestConfig> &configs);
+    void beginTestConfig(const WaterTestConfig &config); // Applied, then warmed up or started
+    void postFrameWaterTestUpdate(); // Records one completed frame
     void endWaterTest();
     void applyTestConfiguration(const WaterTestConfig &config);
+    // The member behind a WaterTestConfig::shaderParams name; nullptr if there is none
+    float *shaderTuningValue(const std::string &name);
+    std::map<std::string, float> shaderTuningDefaults; // Values the current config's shaderParams replaced
+    // The live render settings as a config (the custom and quick runs, frame captures)
+    WaterTestConfig currentSettingsConfig(const std::string &name) const;
     void renderTestingUI();
     void exportTestResults();
 };
@@ -1,6 +1,7 @@
 #include "VulkanUtil.h"
 #include "Command/CommandBuffer.h" 
 #include "VulkanBase.h"
+#include "GpuMemoryAllocator.h"
 
 namespace VkUtils {
 
@@ -58,8 +59,11 @@ namespace VkUtils {
                 indices.graphicsFamily = i;
             }
 
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            // Headless (no surface): nothing is presented, the graphics family stands in
+            VkBool32 presentSupport = surface == VK_NULL_HANDLE && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+            if (surface != VK_NULL_HANDLE) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
            // std::cout << "Queue Family " << i << " Present Support: " << (presentSupport ? "Supported" : "Not Supported") << std::endl;
 
             if (presentSupport) {
@@ -73,6 +77,28 @@ namespace VkUtils {
             i++;
         }
 
+        // Dedicated transfer family for async uploads, preferring one without compute as well
+        for (uint32_t f = 0; f < queueFamilyCount; f++) {
+            VkQueueFlags flags = queueFamilies[f].queueFlags;
+            if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+                continue;
+            }
+            if (!indices.transferFamily.has_value() || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+                indices.transferFamily = f;
+            }
+        }
+
+        // Dedicated compute family for async compute, preferring one the transfer queue does not use
+        for (uint32_t f = 0; f < queueFamilyCount; f++) {
+            VkQueueFlags flags = queueFamilies[f].queueFlags;
+            if (!(flags & VK_QUEUE_COMPUTE_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+                continue;
+            }
+            if (!indices.computeFamily.has_value() || indices.computeFamily == indices.transferFamily) {
+                indices.computeFamily = f;
+            }
+        }
+
         return indices;
     }
 
@@ -148,56 +174,32 @@ namespace VkUtils {
             throw std::runtime_error("failed to create buffer!");
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory!");
-        }
-
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        // Sub-allocated from the shared pool; release with DestroyBuffer, not vkFreeMemory
+        bufferMemory = GpuMemoryAllocator::get().allocateBuffer(buffer, properties, GpuMemoryAllocator::categorize(usage, properties));
 
         return std::make_tuple(buffer, bufferMemory);
     }
 
 
 
-    void VkUtils::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue) {
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-        VkBufferCopy copyRegion{};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-        vkEndCommandBuffer(commandBuffer);
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
+    void DestroyBuffer(VkBuffer buffer) {
+        GpuMemoryAllocator::get().destroyBuffer(buffer);
+    }
 
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
+    void* MapBuffer(VkBuffer buffer) {
+        return GpuMemoryAllocator::get().mapBuffer(buffer);
+    }
 
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    void SetImageSharing(VkImageCreateInfo& imageInfo, const std::vector<uint32_t>& families) {
+        if (families.size() < 2) {
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.queueFamilyIndexCount = 0;
+            imageInfo.pQueueFamilyIndices = nullptr;
+            return;
+        }
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        imageInfo.pQueueFamilyIndices = families.data();
     }
 
 
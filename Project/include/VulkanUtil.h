@@ -39,6 +39,8 @@ namespace VkUtils {
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily; // Transfer-only family (no graphics), if the device has one
+        std::optional<uint32_t> computeFamily;  // Compute family without graphics (async compute), if the device has one
 
         bool isComplete() const {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -59,7 +61,14 @@ namespace VkUtils {
 
     std::tuple<VkBuffer, VkDeviceMemory> CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
 
-    void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue);
+    // Buffers from CreateBuffer live in pooled memory: destroy/map them through these
+    void DestroyBuffer(VkBuffer buffer);
+
+    void* MapBuffer(VkBuffer buffer);
+
+    // Images several queue families access without ownership transfers: CONCURRENT over the given
+    // (distinct) families, EXCLUSIVE for one or none. 'families' must outlive the create call
+    void SetImageSharing(VkImageCreateInfo& imageInfo, const std::vector<uint32_t>& families);
 
 
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// WARMUP DETECTOR
+// ============================================================================
+// Decides when a config has warmed up from its frame times instead of after a
+// fixed count. Frames are taken in windows of kWindow; the config is warm once
+// a window is steady (coefficient of variation under kMaxVariation) and its
+// mean agrees with the previous window's to within kMaxDrift - pipeline
+// compiles, cache misses and clock ramp-up show as spikes or a trend and keep
+// it warming. A config that never settles is cut off at maxFrames and flagged.
+
+class WarmupDetector
+{
+public:
+    static constexpr uint32_t kWindow = 8;
+    static constexpr double kMaxVariation = 0.05; // Window stddev / mean
+    static constexpr double kMaxDrift = 0.03;     // |mean - previous mean| / previous mean
+
+    // Starts over; at least two windows are taken, at most maxFrames frames
+    void reset(uint32_t maxFrames);
+
+    // True once warm (or cut off); later frames are ignored
+    bool addFrame(double frameTimeMs);
+
+    bool isDone() const { return m_done; }
+    bool hasConverged() const { return m_converged; }
+    uint32_t getFrameCount() const { return m_frameCount; }
+    // The latest full window's variation; 0 before one is full
+    double getVariation() const { return m_variation; }
+
+private:
+    uint32_t m_maxFrames = 0;
+    uint32_t m_frameCount = 0;
+    std::vector<double> m_window;
+    double m_previousMean = 0.0;
+    double m_variation = 0.0;
+    bool m_done = false;
+    bool m_converged = false;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class OceanFFT;
+
+// ============================================================================
+// WATER HEIGHT FIELD
+// ============================================================================
+// The FFT ocean's surface on the CPU, for whatever must know where the water
+// actually is rather than where the flat plane lies: the camera's underwater
+// test, buoys, particles. Every frame copies one coarse level of the
+// displacement map (kLevel, a texel per two world units) into the frame's
+// host-visible buffer; collect() unpacks it once the frame's slot is free
+// again, so queries see the surface of a frame or two ago and nothing ever
+// waits for the GPU. Until the first copy arrives the surface is flat at 0.
+//
+//  - The map displaces horizontally as well (choppy waves): the height at a
+//    world position is found by walking back from it to the undisplaced
+//    point that moves there (a few fixed-point steps), as water.vert moves it.
+//  - sampleHeights() answers many points at once, four per step with SSE2
+//    or NEON: wrapping, weights and blends are vectorised, the texel fetches
+//    are not.
+//
+// The water plane is y = 0 and displaced at scale 1, as the water draws do.
+
+class WaterHeightField
+{
+public:
+    static constexpr uint32_t kLevel = 1; // Of the displacement map's mips
+    static constexpr uint32_t kInversionSteps = 3;
+
+    WaterHeightField(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount);
+    ~WaterHeightField(); // The device must be idle
+
+    WaterHeightField(const WaterHeightField &) = delete;
+    WaterHeightField &operator=(const WaterHeightField &) = delete;
+
+    // After the ocean's mip chain in the same command buffer (recordSimulation or recordMipChain)
+    void recordReadback(VkCommandBuffer cmd, uint32_t frameIndex, const OceanFFT &ocean);
+    // Once the frame's slot is free again: takes what its last readback copied
+    void collect(uint32_t frameIndex);
+
+    bool hasData() const { return m_valid; }
+
+    // Surface height at world xz
+    float sampleHeight(const glm::vec2 &position) const;
+    // Heights for 'count' points given as separate x and z arrays
+    void sampleHeights(const float *x, const float *z, float *outHeights, size_t count) const;
+    // Largest displacement anywhere on the map: x horizontal (per axis), y vertical. At kLevel, so
+    // filtered: level 0's crests reach a little further
+    glm::vec2 getMaxDisplacement() const { return m_maxDisplacement; }
+
+private:
+    struct Frame
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        const uint16_t *mapped = nullptr; // RGBA16F
+        bool pending = false;
+    };
+
+    // Displacement (x, y, z) at world xz, bilinear over the repeating map; four points per call
+    void sampleDisplacement4(const float *x, const float *z, float *outX, float *outY, float *outZ) const;
+
+    std::vector<Frame> m_frames;
+    uint32_t m_size = 0;    // Texels per side at kLevel
+    float m_texelsPerUnit = 0.0f;
+
+    // Unpacked, one plane per component
+    std::vector<float> m_dx;
+    std::vector<float> m_dy;
+    std::vector<float> m_dz;
+    glm::vec2 m_maxDisplacement = glm::vec2(0.0f);
+    bool m_valid = false;
+};
@@ -1,12 +1,13 @@
 #pragma once
 
-#include <vector>
+#include <memory>
 #include <atomic>
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
-#include "Vertex.h"
-#include "VulkanUtil.h"
+#include "CdlodGrid.h"
 
+// Water surface plane: CDLOD tiles around the camera (CdlodGrid.h), displaced by
+// the ocean maps in water.vert
 class WaterMesh
 {
 public:
@@ -15,26 +16,26 @@ public:
 
     void create(VkDevice device,
                 VkPhysicalDevice gpu,
-                VkCommandPool commandPool,
-                VkQueue graphicsQueue,
-                int resolution = 256,
-                float worldSize = 200.0f);
+                uint32_t frameCount,
+                float worldSize = 200.0f,
+                uint32_t lodLevels = 6);
 
     void destroy(VkDevice device);
 
-    void draw(VkCommandBuffer cmd);
+    // Once per frame, before recording; the frame's fence must have signalled. With a 'frustum', only the
+    // tiles inside it are drawn; 'waveMargin' (horizontal, vertical) must cover the ocean's displacement
+    void update(uint32_t frameIndex, const glm::vec3 &cameraPos, float viewDistance,
+                const Frustum *frustum = nullptr, const glm::vec2 &waveMargin = glm::vec2(0.0f));
+
+    void draw(VkCommandBuffer cmd, uint32_t frameIndex);
 
     void setValid(bool valid) { isValid.store(valid, std::memory_order_release); }
     bool getValid() const { return isValid.load(std::memory_order_acquire); }
 
-    uint32_t getIndexCount() const { return indexCount; }
+    uint32_t getTileCount(uint32_t frameIndex) const { return grid ? grid->getTileCount(frameIndex) : 0; }
+    uint32_t getCulledCount(uint32_t frameIndex) const { return grid ? grid->getCulledCount(frameIndex) : 0; }
 
 private:
-    VkBuffer vertexBuffer = VK_NULL_HANDLE;
-    VkBuffer indexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
-    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
-
-    uint32_t indexCount = 0;
+    std::unique_ptr<CdlodGrid> grid;
     std::atomic_bool isValid = ATOMIC_VAR_INIT(false);
 };
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// WATER PARAMETERS
+// ============================================================================
+// The water tuning values (colors, fog, god-ray settings) used to be pushed as
+// 96 bytes of push constants before every water, underwater and sunrays draw.
+// They only change when the UI does, so they live in a uniform block instead
+// (set 1, binding 7) and the push constants keep time, scale and the mode.
+//
+// std140 mirror of WaterParamBlock / WaterParams in water.frag,
+// underwater_water.frag, sunrays.frag and 3d_shader.frag.
+
+struct alignas(16) WaterParamBlock
+{
+    glm::vec4 baseColor;  // Surface color, or the shallow color underwater
+    glm::vec4 lightColor; // Light color, or the deep color underwater
+    float ambient;        // Underwater: chromatic aberration strength
+    float shininess;      // Underwater: marine snow size * 100
+    float causticIntensity;
+    float distortionStrength;
+    float godRayIntensity;
+    float scatteringIntensity; // Underwater: marine snow intensity
+    float opacity;
+    float fogDensity;
+    float godExposure;
+    float godDecay;
+    float godDensity;
+    float godSampleScale;
+    float causticMapScale; // 1 / world units the computed caustics map covers, 0: the static caustic texture
+    float froxelNear;       // Underwater: FroxelVolume::kNear
+    float froxelDepthScale; // Underwater: FroxelVolume::getDepthScale(), 0: analytic fog instead of the volume
+    float snowParticles;    // Underwater: non-zero when MarineSnow draws the snow, so the full-screen passes skip it
+    float waterlineHeight;  // Underwater: the surface's height at the camera (WaterHeightField), where the fog starts
+    float sceneFog;         // Underwater: non-zero when the scene is drawn in the water, so it is fogged as well
+};
+
+struct WaterParams
+{
+    WaterParamBlock surface;    // water.frag
+    WaterParamBlock underwater; // Fog, sunrays, and the ocean bottom and scene's fog and caustics
+};
+
+// One copy of WaterParams per frame in flight in a persistently mapped buffer,
+// addressed through a dynamic offset like UniformArena. A frame's copy is only
+// rewritten when the values differ from what it already holds.
+class WaterParamsBuffer
+{
+public:
+    WaterParamsBuffer(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount);
+    ~WaterParamsBuffer();
+
+    WaterParamsBuffer(const WaterParamsBuffer &) = delete;
+    WaterParamsBuffer &operator=(const WaterParamsBuffer &) = delete;
+
+    // Once the frame's fence has signalled: brings its copy up to date, returns its dynamic offset
+    uint32_t update(uint32_t frameIndex, const WaterParams &params);
+
+    VkBuffer getBuffer() const { return m_buffer; }
+    VkDeviceSize getRange() const { return sizeof(WaterParams); }
+    uint64_t getWriteCount() const { return m_writeCount; } // Copies rewritten since creation
+
+private:
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    uint8_t *m_mapped = nullptr;
+    VkDeviceSize m_stride = 0;
+
+    std::vector<WaterParams> m_written; // What each frame's copy holds
+    std::vector<bool> m_valid;          // false until a frame's copy is first written
+    uint64_t m_writeCount = 0;
+};
@@ -3,34 +3,86 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <array>
+#include <map>
+#include <tuple>
 #include "Vertex.h"
 #include "VulkanUtil.h"
 
+// Fragment specialization constants of water.frag, sunrays.frag and underwater_water.frag. Each
+// combination is its own pipeline, so the driver compiles out the paths a mode does not take
+struct WaterVariant
+{
+    uint32_t renderingMode = 1; // constant_id 0: 0=BL, 1=PB, 2=OPT
+    uint32_t debugView = 0;     // constant_id 1: 0=off, 1=rays, 2=snow, 3=both, 4=chromatic
+
+    static constexpr uint32_t kRenderingModeCount = 3;
+    static constexpr uint32_t kDebugViewCount = 5;
+    // Either constant: read the push constant at run time instead, the unspecialized baseline
+    static constexpr uint32_t kRuntime = ~0u;
+
+    bool operator<(const WaterVariant &other) const
+    {
+        return renderingMode != other.renderingMode ? renderingMode < other.renderingMode : debugView < other.debugView;
+    }
+
+    // Map entries for both constants; the variant itself is the specialization data
+    static const std::array<VkSpecializationMapEntry, 2> &mapEntries();
+};
+
 class WaterPipeline {
 public:
     WaterPipeline() = default;
     ~WaterPipeline() = default;
 
-    // create: device, swap extent, renderPass, global descriptor set layout, water descriptor set layout, msaa samples
+    // create: device, renderPass, global descriptor set layout, water descriptor set layout, msaa samples
+    // tessellated: the surface subdivided by water.tesc/water.tese (needs the tessellationShader feature and
+    // both set layouts visible to the tessellation stages); same layout and draws as the plain surface.
+    // Builds the debug-off variant of every rendering mode; the others are built on first select()
     void create(
         VkDevice device,
-        VkExtent2D extent,
         VkRenderPass renderPass,
         VkDescriptorSetLayout globalDescriptorSetLayout,
         VkDescriptorSetLayout waterDescriptorSetLayout,
         VkSampleCountFlagBits msaaSamples,
-        bool isSunraysPipeline = false
+        bool isSunraysPipeline = false,
+        bool tessellated = false
     );
 
     void destroy(VkDevice device);
 
+    // Render thread, before recording: 'pipeline' becomes this variant's. Frames in flight keep the
+    // variant they recorded; variants live until destroy(). shadingRate, sunrays only: drawn as one quad
+    // per screen tile at VariableRateShading's rates (recordGridDraw) instead of the full-screen triangle.
+    // rayQuery, surface only: water_rq.frag, tracing the reflections and refractions (RayQueryScene.h)
+    void select(WaterVariant variant, bool shadingRate = false, bool rayQuery = false);
+    // Builds the variant if it is missing, leaving the selection alone (a test suite compiling ahead)
+    void prebuild(WaterVariant variant, bool shadingRate = false, bool rayQuery = false);
+
     void bind(VkCommandBuffer cmd);
 
     VkPipeline pipeline = VK_NULL_HANDLE;
     VkPipelineLayout layout = VK_NULL_HANDLE;
 
 private:
+    // The specialization, shadingRate and rayQuery of select()
+    using VariantKey = std::tuple<WaterVariant, bool, bool>;
+
     VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code);
+    VkPipeline buildVariant(const VariantKey &key) const;
+
+    // What create() was given, for variants built later
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkSampleCountFlagBits m_samples = VK_SAMPLE_COUNT_1_BIT;
+    bool m_sunrays = false;
+    bool m_tessellated = false;
+    VkShaderModule m_vertModule = VK_NULL_HANDLE;
+    VkShaderModule m_fragModule = VK_NULL_HANDLE;
+    VkShaderModule m_tescModule = VK_NULL_HANDLE;
+    VkShaderModule m_teseModule = VK_NULL_HANDLE;
+    VkShaderModule m_rateTileVertModule = VK_NULL_HANDLE; // Loaded with the first shadingRate variant
+    VkShaderModule m_rayQueryFragModule = VK_NULL_HANDLE; // Loaded with the first rayQuery variant
+    std::map<VariantKey, VkPipeline> m_variants;
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -10,6 +10,7 @@
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <chrono>
@@ -22,6 +23,11 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include "QuantileSketch.h"
+#include "FrameClock.h"
+#include "GpuCounters.h"
+#include "DeterministicCameraPath.h"
+#include "WarmupDetector.h"
 
 // ============================================================================
 // TEST MODE CONFIGURATION
@@ -60,6 +66,9 @@ namespace TestParams
     constexpr int SWEEP_REPEAT_COUNT = 5;
 #endif
 
+    // Adaptive warm-up: frames a config may take to settle before it is measured anyway
+    constexpr int WARMUP_MAX_FRAMES = 240;
+
     // Sample count levels for trade-off sweep
     // FAST: MIN (performance-bound) and MID (balanced)
     // FULL: Full sweep from 1 to 16
@@ -115,6 +124,34 @@ enum class RenderingMode
     OPT = 2
 };
 
+// Scene draw submission path, orthogonal to the rendering mode
+enum class SceneSubmission
+{
+    CPU = 0, // BVH-culled draw list, one vkCmdDrawIndexed per object
+    GPU = 1  // Compute culling into indirect draws
+};
+
+// Sun shadow tier; same values as ShadowQuality (ShadowCascades.h)
+enum class ShadowTier
+{
+    Off = 0,
+    Low = 1,    // 2 cascades, 1024^2
+    Medium = 2, // 3 cascades, 2048^2, 3x3 PCF
+    High = 3    // 4 cascades, 2048^2, 5x5 PCF
+};
+
+// Water reflection/refraction passes; ScreenSpace traces the refraction pass in place of the
+// planar reflection pass (ScreenSpaceReflections.h) and falls back to Planar where unsupported.
+// RayQuery traces the scene itself in place of both passes above water (RayQueryScene.h), also
+// falling back to Planar
+enum class ReflectionTier
+{
+    Off = 0, // Neither pass: the water samples whatever the targets last held
+    Planar = 1,
+    ScreenSpace = 2,
+    RayQuery = 3
+};
+
 // Test configuration structure
 struct WaterTestConfig
 {
@@ -123,17 +160,65 @@ struct WaterTestConfig
     DepthLevel depth = DepthLevel::Shallow;
     LightMotion lightMotion = LightMotion::Static;
     RenderingMode renderingMode = RenderingMode::PB;
+    SceneSubmission sceneSubmission = SceneSubmission::CPU;
+    bool occlusionCulling = false; // GPU submission only: Hi-Z test against last frame's depth
 
     // Trade-off sweep parameters
     int sampleCount = 8;
     int causticRayCount = 64;
+    // OPT mode quality tier: underwater sunrays at quarter area with a depth-aware upsample
+    bool halfResGodRays = false;
+    // false: water shaders branch on the push-constant mode instead of a specialized pipeline per mode
+    bool specializedShaders = true;
+    // Cascaded sun shadows; round-robin re-renders one cascade per frame instead of all of them
+    ShadowTier shadowQuality = ShadowTier::Medium;
+    bool shadowRoundRobin = true;
+    // Bioluminescent point lights over the sea floor; false shades every light at every fragment
+    uint32_t pointLightCount = 0;
+    bool clusteredLighting = true;
+    // Applied to the config's rendering mode
+    ReflectionTier reflections = ReflectionTier::Off;
+    // Frames between reflection/refraction renders, reprojected in between; 0 only on camera movement
+    uint32_t offscreenUpdateInterval = 1;
+    // Main scene depth laid down first, then shaded only where visible
+    bool depthPrePass = false;
+    // Underwater fog and light shafts from the froxel volume; false: the full-screen fog and ray-march passes
+    bool froxelVolumetrics = true;
+    // Water simulation, caustics and froxel volume on a compute-only queue (AsyncCompute.h), when the device has one
     bool asyncEnabled = false;
+    // Analytic underwater fog drawn only over the screen tiles below or across the waterline (TileClassifier.h)
     bool tilingEnabled = false;
+    // The tiled fog and the sunrays shaded coarser behind thick fog (VariableRateShading.h); needs the device's support
+    bool variableRateShading = false;
+    // Frame slots in use (VulkanBase::framesInFlight): 3 queues one more frame, more throughput for more latency
+    uint32_t framesInFlight = 2;
+    // Main pass MSAA (VulkanBase::msaaSamples, clamped to what the device supports, at least 2); 0: the maximum
+    uint32_t msaaSamples = 0;
+    // Frames alternate over the GPUs of a device group (DeviceGroup.h); needs a --device-group run, else one GPU
+    bool alternateFrameDevices = false;
+    // Time source for the run's animation (FrameClock.h). Replay: run 0 goes in real time, the others replay its times
+    FrameClock::Mode clockMode = FrameClock::Mode::FixedStep;
+    // JSON camera path (DeterministicCameraPath.h) flown instead of the depth's preset; empty: the preset
+    std::string cameraPathFile;
+    // Renderer tuning values by name (ParameterSweep::kShaderParameters), set over the defaults and the turbidity's
+    std::vector<std::pair<std::string, float>> shaderParams;
+    // Reflection/refraction passes held at this render scale (DynamicResolution::setFixedScale); 0: as the user set it
+    float resolutionScale = 0.0f;
+    // What a ParameterSweep varied to make this config: the columns of its Pareto front
+    std::vector<std::string> sweptParameters;
 
     // Test parameters - use centralized constants
     int totalFrames = TestParams::PERF_TOTAL_FRAMES;
     int warmupFrames = TestParams::PERF_WARMUP_FRAMES;
+    // true: the config warms up once, before its first run, until frame times settle (WarmupDetector.h),
+    // and every run is measured from its first frame; warmupFrames is then unused
+    bool adaptiveWarmup = true;
+    // Pipeline statistics and vendor counters of every frame (GpuCounters.h), at a small GPU cost
+    bool captureGpuCounters = false;
     int repeatCount = TestParams::PERF_REPEAT_COUNT;
+    // true: frames stay pipelined (framesInFlight) and frame time is the interval between
+    // observed timeline signals; false: wait for each frame to complete (per-frame deterministic)
+    bool pipelinedTiming = true;
 
     std::string toString() const
     {
@@ -143,143 +228,34 @@ struct WaterTestConfig
            << " Depth=" << static_cast<int>(depth)
            << " Light=" << static_cast<int>(lightMotion)
            << " Mode=" << static_cast<int>(renderingMode)
+           << " Submit=" << static_cast<int>(sceneSubmission) << (occlusionCulling ? "+HiZ" : "")
            << " Samples=" << sampleCount
-           << " Caustics=" << causticRayCount;
-        return ss.str();
-    }
-};
-
-// ============================================================================
-// CAMERA PATH DEFINITIONS
-// ============================================================================
-
-struct CameraKeyframe
-{
-    glm::vec3 position;
-    float yaw;
-    float pitch;
-    float timestamp; // normalized 0-1
-};
-
-struct DeterministicCameraPath
-{
-    std::string name;
-    std::vector<CameraKeyframe> keyframes;
-    float totalDuration = 10.0f; // seconds
-
-    // Interpolate camera state at time t (0-1)
-    CameraKeyframe interpolate(float t) const
-    {
-        if (keyframes.empty())
-            return {};
-        if (keyframes.size() == 1)
-            return keyframes[0];
-
-        t = glm::clamp(t, 0.0f, 1.0f);
-
-        // Find surrounding keyframes
-        size_t i = 0;
-        for (; i < keyframes.size() - 1; ++i)
+           << " Caustics=" << causticRayCount
+           << (halfResGodRays ? " Rays=Half" : "")
+           << (specializedShaders ? "" : " Shaders=Runtime")
+           << " Shadows=" << static_cast<int>(shadowQuality) << (shadowRoundRobin ? "" : "+EveryFrame")
+           << " Lights=" << pointLightCount << (clusteredLighting ? "" : "+BruteForce")
+           << " Refl=" << static_cast<int>(reflections)
+           << (offscreenUpdateInterval != 1 ? " Every=" + std::to_string(offscreenUpdateInterval) : "")
+           << (depthPrePass ? " PrePass" : "")
+           << (froxelVolumetrics ? "" : " Fog=Analytic")
+           << (asyncEnabled ? " Async" : "")
+           << (tilingEnabled ? " Tiled" : "")
+           << (variableRateShading ? " VRS" : "")
+           << (framesInFlight != 2 ? " InFlight=" + std::to_string(framesInFlight) : "")
+           << (msaaSamples ? " MSAA=" + std::to_string(msaaSamples) + "x" : "")
+           << (alternateFrameDevices ? " AFR" : "")
+           << (clockMode != FrameClock::Mode::FixedStep ? std::string(" Clock=") + FrameClock::modeName(clockMode) : "")
+           << (cameraPathFile.empty() ? "" : " Path=" + cameraPathFile)
+           << (resolutionScale > 0.0f ? " Scale=" + std::to_string(resolutionScale) : "")
+           << (adaptiveWarmup ? "" : " Warmup=" + std::to_string(warmupFrames))
+           << (captureGpuCounters ? " Counters" : "")
+           << " Timing=" << (pipelinedTiming ? "Pipelined" : "Synced");
+        for (const auto &param : shaderParams)
         {
-            if (keyframes[i + 1].timestamp >= t)
-                break;
+            ss << " " << param.first << "=" << param.second;
         }
-
-        const auto &k0 = keyframes[i];
-        size_t nextIdx = (i + 1 < keyframes.size()) ? (i + 1) : (keyframes.size() - 1);
-        const auto &k1 = keyframes[nextIdx];
-
-        float segmentT = (k1.timestamp > k0.timestamp)
-                             ? (t - k0.timestamp) / (k1.timestamp - k0.timestamp)
-                             : 0.0f;
-
-        // Smooth interpolation
-        float smoothT = segmentT * segmentT * (3.0f - 2.0f * segmentT);
-
-        CameraKeyframe result;
-        result.position = glm::mix(k0.position, k1.position, smoothT);
-        result.yaw = k0.yaw + (k1.yaw - k0.yaw) * smoothT;
-        result.pitch = k0.pitch + (k1.pitch - k0.pitch) * smoothT;
-        result.timestamp = t;
-
-        return result;
-    }
-
-    static DeterministicCameraPath createUnderwaterPath()
-    {
-        DeterministicCameraPath path;
-        path.name = "UnderwaterSweep";
-        path.totalDuration = 10.0f;
-
-        // Full 360° smooth circular orbit around object at center (0,0,0)
-        // Radius = 55, constant depth Y = -25 (underwater), 8 keyframes for smooth interpolation
-        constexpr float R = 55.0f;
-        constexpr float Y = -25.0f;
-        constexpr float R45 = 38.89f; // R * sin(45°) ≈ R * 0.7071
-
-        path.keyframes = {
-            {glm::vec3(0.0f, Y, R), 0.0f, 5.0f, 0.0f},         // Back (positive Z), looking at center
-            {glm::vec3(R45, Y, R45), 45.0f, 5.0f, 0.125f},     // Back-right
-            {glm::vec3(R, Y, 0.0f), 90.0f, 5.0f, 0.25f},       // Right side
-            {glm::vec3(R45, Y, -R45), 135.0f, 5.0f, 0.375f},   // Front-right
-            {glm::vec3(0.0f, Y, -R), 180.0f, 5.0f, 0.5f},      // Front (negative Z)
-            {glm::vec3(-R45, Y, -R45), -135.0f, 5.0f, 0.625f}, // Front-left
-            {glm::vec3(-R, Y, 0.0f), -90.0f, 5.0f, 0.75f},     // Left side
-            {glm::vec3(-R45, Y, R45), -45.0f, 5.0f, 0.875f},   // Back-left
-            {glm::vec3(0.0f, Y, R), 0.0f, 5.0f, 1.0f}};        // Back (complete loop)
-
-        return path;
-    }
-
-    static DeterministicCameraPath createSurfacePath()
-    {
-        DeterministicCameraPath path;
-        path.name = "SurfaceSweep";
-        path.totalDuration = 10.0f;
-
-        // Full 360° smooth circular orbit around object at center (0,0,0)
-        // Radius = 55, constant depth Y = -5, 8 keyframes for smooth interpolation
-        constexpr float R = 55.0f;
-        constexpr float Y = -5.0f;
-        constexpr float R45 = 38.89f; // R * sin(45°) ≈ R * 0.7071
-
-        path.keyframes = {
-            {glm::vec3(0.0f, Y, R), 0.0f, 5.0f, 0.0f},         // Back (positive Z), looking at center
-            {glm::vec3(R45, Y, R45), 45.0f, 5.0f, 0.125f},     // Back-right
-            {glm::vec3(R, Y, 0.0f), 90.0f, 5.0f, 0.25f},       // Right side
-            {glm::vec3(R45, Y, -R45), 135.0f, 5.0f, 0.375f},   // Front-right
-            {glm::vec3(0.0f, Y, -R), 180.0f, 5.0f, 0.5f},      // Front (negative Z)
-            {glm::vec3(-R45, Y, -R45), -135.0f, 5.0f, 0.625f}, // Front-left
-            {glm::vec3(-R, Y, 0.0f), -90.0f, 5.0f, 0.75f},     // Left side
-            {glm::vec3(-R45, Y, R45), -45.0f, 5.0f, 0.875f},   // Back-left
-            {glm::vec3(0.0f, Y, R), -90.0f, 5.0f, 1.0f}};      // Back (complete loop)
-
-        return path;
-    }
-
-    static DeterministicCameraPath createDepthTransitionPath()
-    {
-        DeterministicCameraPath path;
-        path.name = "DepthTransition";
-        path.totalDuration = 10.0f;
-
-        // Full 360° smooth circular orbit around object at center (0,0,0)
-        // Radius = 55, depth transitions from Y=-5 to Y=-35 while orbiting
-        constexpr float R = 55.0f;
-        constexpr float R45 = 38.89f; // R * sin(45°) ≈ R * 0.7071
-
-        path.keyframes = {
-            {glm::vec3(0.0f, -5.0f, R), 0.0f, 5.0f, 0.0f},           // Back, shallow
-            {glm::vec3(R45, -9.0f, R45), 45.0f, 3.0f, 0.125f},       // Back-right
-            {glm::vec3(R, -13.0f, 0.0f), 90.0f, 1.0f, 0.25f},        // Right side
-            {glm::vec3(R45, -17.0f, -R45), 135.0f, -1.0f, 0.375f},   // Front-right
-            {glm::vec3(0.0f, -21.0f, -R), 180.0f, -3.0f, 0.5f},      // Front
-            {glm::vec3(-R45, -25.0f, -R45), -135.0f, -3.0f, 0.625f}, // Front-left
-            {glm::vec3(-R, -29.0f, 0.0f), -90.0f, -1.0f, 0.75f},     // Left side
-            {glm::vec3(-R45, -53.0f, R45), -45.0f, 1.0f, 0.875f},    // Back-left
-            {glm::vec3(0.0f, -55.0f, R), 0.0f, 3.0f, 1.0f}};         // Back, deep
-
-        return path;
+        return ss.str();
     }
 };
 
@@ -292,16 +268,22 @@ struct FrameMetrics
     uint32_t frameIndex;
     double frameTimeMs;
     double gpuTimeMs;
-    double cpuTimeMs;
+    double cpuTimeMs;   // Recording + submission on the CPU
+    double latencyMs = 0.0; // Frame start to its timeline value being seen reached
     uint64_t timestampNs;
 
     // GPU memory usage (if available)
     uint64_t gpuMemoryUsedBytes = 0;
 
-    // Additional timing breakdown
-    double waterPassTimeMs = 0.0;
-    double scenePassTimeMs = 0.0;
-    double postProcessTimeMs = 0.0;
+    // Additional timing breakdown (GPU, from the profiler scopes)
+    double waterPassTimeMs = 0.0;   // Water surface draws + reflection/refraction passes
+    double scenePassTimeMs = 0.0;   // Main pass minus the water, + GPU culling
+    double postProcessTimeMs = 0.0; // Everything after the main pass (Hi-Z build, readback, image compare, UI)
+
+    // Hardware counters summed over the frame's passes (WaterTestConfig::captureGpuCounters), trailing
+    // like the GPU times; gpuCounters in TestRunResult::gpuCounterNames order
+    GpuPassStatistics pipelineStatistics;
+    std::vector<double> gpuCounters;
 
     // Camera state at this frame
     glm::vec3 cameraPosition;
@@ -358,12 +340,33 @@ struct AggregatedRunMetrics
     double medianGpuTime;
     double stddevGpuTime;
 
-    // Image quality (if applicable)
-    double avgSSIM;
-    double avgPSNR;
-
-    // Temporal stability
-    double temporalStability;
+    // Latency statistics (frame start to completion); equal to the frame time when synced
+    bool pipelinedTiming = false;
+    double meanLatency = 0.0;
+    double medianLatency = 0.0;
+    double latency99 = 0.0;
+    double meanCpuTime = 0.0;
+
+    // Hardware counters per frame, means over the measured frames (zero unless captured)
+    double meanVertexInvocations = 0.0;
+    double meanClippingPrimitives = 0.0;
+    double meanFragmentInvocations = 0.0;
+    double meanComputeInvocations = 0.0;
+    std::vector<double> meanGpuCounters; // TestRunResult::gpuCounterNames order
+
+    // Image quality (if applicable): per-frame GPU comparisons recorded during the run
+    int imageQualityFrameCount = 0;
+    double avgSSIM = 0.0;
+    double avgPSNR = 0.0;
+    double avgDeltaE = 0.0;
+
+    // Against the stored references (ReferenceImageCache.h), if the run's frames have them
+    int referenceFrameCount = 0;
+    double referenceSSIM = 0.0;
+    double referencePSNR = 0.0;
+
+    // Temporal stability (frame-to-frame SSIM of captured frames)
+    double temporalStability = 0.0;
 };
 
 // ============================================================================
@@ -376,13 +379,47 @@ struct TestRunResult
     int runIndex;
     std::vector<FrameMetrics> frameMetrics;
     std::vector<ImageQualityMetrics> imageQualityMetrics;
+    std::vector<ImageQualityMetrics> referenceQualityMetrics; // Frames compared against their reference
     TemporalMetrics temporalMetrics;
     AggregatedRunMetrics aggregated;
+    std::vector<std::string> gpuCounterNames; // Vendor counters captured, empty if none
 
     std::chrono::system_clock::time_point startTime;
     std::chrono::system_clock::time_point endTime;
 };
 
+// One config over all of its repeats in the current suite, from the merged per-run sketches
+struct ConfigSummaryMetrics
+{
+    std::string configName;
+    int runCount = 0;
+    uint64_t validFrameCount = 0;
+    int outlierCount = 0;
+
+    double meanFrameTime = 0.0;
+    double medianFrameTime = 0.0;
+    double percentile99 = 0.0;
+    double meanFPS = 0.0;
+    double medianFPS = 0.0;
+    double fps1Low = 0.0;
+    double medianGpuTime = 0.0;
+    double medianLatency = 0.0;
+    double latency99 = 0.0;
+};
+
+// The running test's statistics so far (Testing panel)
+struct LiveRunStatistics
+{
+    uint64_t validFrameCount = 0;
+    int outlierCount = 0;
+    double meanFrameTime = 0.0;
+    double medianFrameTime = 0.0;
+    double percentile99 = 0.0;
+    double medianFPS = 0.0;
+    double fps1Low = 0.0;
+    double medianGpuTime = 0.0;
+};
+
 struct TestSuiteResult
 {
     std::string suiteName;
@@ -395,18 +432,31 @@ struct TestSuiteResult
 // WATER TESTING SYSTEM CLASS
 // ============================================================================
 
+class JobSystem;
+class FrameMetricsLog;
+
 class WaterTestingSystem
 {
 public:
-    WaterTestingSystem() = default;
-    ~WaterTestingSystem() = default;
+    WaterTestingSystem();
+    ~WaterTestingSystem();
 
     // Initialize with Vulkan handles for GPU timing
     void initialize(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue graphicsQueue, uint32_t queueFamilyIndex);
     void cleanup();
 
+    // Image metrics split their row bands across these threads; null runs them on the caller
+    void setJobSystem(JobSystem *jobs) { m_jobSystem = jobs; }
+
     // ========== TEST EXECUTION ==========
 
+    // Adaptive warm-up of a config about to run (WaterTestConfig::adaptiveWarmup): it becomes the current
+    // config, and frames go to recordWarmupFrame until that returns true
+    void beginWarmup(const WaterTestConfig &config);
+    bool recordWarmupFrame(double frameTimeMs);
+    bool isWarmingUp() const { return m_isWarmingUp; }
+    const WarmupDetector &getWarmup() const { return m_warmup; }
+
     // Start a new test run with given configuration
     void startTestRun(const WaterTestConfig &config, int runIndex = 0);
 
@@ -432,20 +482,33 @@ public:
         return m_isRunning ? (float)m_currentFrameIndex / m_currentConfig.totalFrames * 100.0f : 0.0f;
     }
 
+    // ========== SCHEDULING ==========
+
+    // The suite reordered so consecutive configs differ in as little costly state as possible (pipeline
+    // variants, frames in flight, queue setup); the first config stays first, ties keep suite order
+    static std::vector<WaterTestConfig> orderByStateChanges(std::vector<WaterTestConfig> configs);
+
     // ========== CAMERA PATH ==========
 
     // Set camera path for deterministic testing
     void setCameraPath(const DeterministicCameraPath &path) { m_cameraPath = path; }
+    const DeterministicCameraPath &getCameraPath() const { return m_cameraPath; }
 
     // Get interpolated camera state for current test frame
     CameraKeyframe getCameraStateForFrame(uint32_t frameIndex) const;
 
+    // The path a config flies: its depth's preset, or its cameraPathFile if that loads
+    static DeterministicCameraPath cameraPathFor(const WaterTestConfig &config);
+
     // ========== CONFIGURATION PRESETS ==========
 
     // Generate all test configurations for comprehensive testing
     static std::vector<WaterTestConfig> generatePerformanceTestConfigs();
     static std::vector<WaterTestConfig> generateImageQualityTestConfigs();
     static std::vector<WaterTestConfig> generateTradeOffSweepConfigs();
+    static std::vector<WaterTestConfig> generateSubmissionTestConfigs();
+    // One GPU vs alternate frames over the device group, per rendering mode
+    static std::vector<WaterTestConfig> generateDeviceGroupTestConfigs();
 
     // ========== IMAGE QUALITY ==========
 
@@ -453,11 +516,20 @@ public:
     void captureScreenshot(uint32_t frameIndex, const std::vector<uint8_t> &pixels,
                            uint32_t width, uint32_t height);
 
+    // Per-frame metrics computed elsewhere (GpuImageCompare). Ignored outside a run, for warmup
+    // frames and for frames ahead of the current one (left over from the previous run)
+    void recordImageQuality(const ImageQualityMetrics &metrics);
+
     // Compute image quality metrics against reference
     ImageQualityMetrics computeImageQuality(const std::vector<uint8_t> &testImage,
                                             const std::vector<uint8_t> &referenceImage,
                                             uint32_t width, uint32_t height);
 
+    // A frame of the run against its stored reference (ReferenceImageCache.h), both RGBA8 of one size.
+    // Ignored outside a run and for frames ahead of the current one
+    void compareWithReference(uint32_t frameIndex, const std::vector<uint8_t> &pixels,
+                              const std::vector<uint8_t> &referenceImage, uint32_t width, uint32_t height);
+
     // ========== TEMPORAL ANALYSIS ==========
 
     // Compute frame-to-frame SSIM for temporal stability
@@ -483,8 +555,14 @@ public:
     // Export aggregated summary
     void exportSummaryToCSV(const std::vector<AggregatedRunMetrics> &metrics, const std::string &filepath);
 
+    // One row per config, its repeats merged (getConfigSummaries)
+    void exportConfigSummaryToCSV(const std::vector<ConfigSummaryMetrics> &summaries, const std::string &filepath);
+
     // ========== STATISTICS ==========
 
+    // Outlier rule of aggregateMetrics (|value - mean| > threshold * stddev); also used by RegressionCompare
+    static bool isOutlier(double value, double mean, double stddev, double threshold = 5.0);
+
     // Remove warmup frames and outliers, compute aggregated metrics
     AggregatedRunMetrics aggregateMetrics(const std::vector<FrameMetrics> &rawMetrics,
                                           const WaterTestConfig &config);
@@ -492,6 +570,14 @@ public:
     // Get current test results
     const TestRunResult &getCurrentResult() const { return m_currentResult; }
 
+    // Streaming quantiles of the running test (warmup excluded, outliers judged against the
+    // frames so far); cheap enough to call every frame
+    LiveRunStatistics getLiveStatistics() const;
+
+    // Every run ended since the last reset, merged per config without keeping samples
+    void resetConfigSummaries() { m_configSummaries.clear(); }
+    std::vector<ConfigSummaryMetrics> getConfigSummaries() const;
+
     // Set output directory for screenshots and exports
     void setOutputDirectory(const std::string &dir) { m_outputDirectory = dir; }
 
@@ -500,40 +586,102 @@ public:
 
     // ========== GPU TIMING ==========
 
-    // Reset timestamp queries - call at the START of command buffer recording
-    void resetTimestampQueries(VkCommandBuffer cmd);
+    // Latest GPU times from the renderer's GpuProfiler - call BEFORE recordFrame
+    void setGpuTimings(double gpuTimeMs, double waterPassTimeMs, double scenePassTimeMs, double postProcessTimeMs);
 
-    // Write start timestamp - call AFTER vkBeginCommandBuffer, BEFORE any rendering
-    void writeTimestampStart(VkCommandBuffer cmd);
+    // CPU time and latency of the frame being recorded - call BEFORE recordFrame
+    void setCpuTimings(double cpuTimeMs, double latencyMs);
 
-    // Write end timestamp - call AFTER all rendering, BEFORE vkEndCommandBuffer
-    void writeTimestampEnd(VkCommandBuffer cmd);
-
-    // Read GPU timestamps and compute gpuTimeMs - call AFTER frame is complete (after vkWaitForFences)
-    void readGpuTimestamps();
+    // Latest hardware counters (GpuCounters.h) - call BEFORE recordFrame; kept only if the config captures them
+    void setGpuCounters(const GpuPassStatistics &statistics, const std::vector<double> &counters);
+    // The device's vendor counters, in setGpuCounters order
+    void setGpuCounterNames(const std::vector<std::string> &names) { m_gpuCounterNames = names; }
 
     // Get the last computed GPU time in milliseconds
     double getLastGpuTimeMs() const { return m_lastGpuTimeMs; }
 
+    // ========== STREAMING LOG ==========
+
+    // Non-empty: frames are appended to a binary log (FrameMetricsLog.h) instead of being kept in
+    // TestRunResult::frameMetrics, and runs are aggregated from running statistics, with outliers
+    // judged against the frames seen so far. Takes effect at the next startTestRun
+    void setFrameLogPath(const std::string &path);
+    bool isStreamingFrames() const { return m_frameLog != nullptr; }
+    // Writes out and closes the log so it can be read back; the next streamed run reopens it
+    void closeFrameLog();
+
 private:
+    // Welford accumulator for streamed runs
+    struct RunningStats
+    {
+        uint64_t count = 0;
+        double mean = 0.0;
+        double m2 = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+
+        void add(double value);
+        double stddev() const { return count > 1 ? std::sqrt(m2 / (count - 1)) : 0.0; }
+    };
+
+    // Fed by recordFrame in both modes: live panel figures, streamed aggregation, config summaries
+    struct RunStatistics
+    {
+        RunningStats frameTimeBand; // Every measured frame, outliers included: the band outliers are judged against
+        RunningStats frameTime;     // The rest exclude the outliers, as the reported statistics do
+        RunningStats fps;
+        RunningStats gpuTime;
+        RunningStats latency;
+        RunningStats cpuTime;
+        RunningStats vertexInvocations;
+        RunningStats clippingPrimitives;
+        RunningStats fragmentInvocations;
+        RunningStats computeInvocations;
+        std::vector<RunningStats> gpuCounters;
+        QuantileSketch frameTimeQuantiles;
+        QuantileSketch fpsQuantiles;
+        QuantileSketch gpuTimeQuantiles;
+        QuantileSketch latencyQuantiles;
+        int outliers = 0;
+    };
+
+    struct ConfigAccumulator
+    {
+        int runCount = 0;
+        int outliers = 0;
+        double frameTimeSum = 0.0;
+        double fpsSum = 0.0;
+        QuantileSketch frameTimeQuantiles;
+        QuantileSketch fpsQuantiles;
+        QuantileSketch gpuTimeQuantiles;
+        QuantileSketch latencyQuantiles;
+    };
+
+    // Frames before online outlier rejection starts
+    static constexpr uint64_t kOnlineOutlierMinSamples = 30;
+
     // Vulkan handles for GPU timing
     VkDevice m_device = VK_NULL_HANDLE;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
     VkQueue m_graphicsQueue = VK_NULL_HANDLE;
-    VkQueryPool m_timestampQueryPool = VK_NULL_HANDLE;
     uint32_t m_queueFamilyIndex = 0;
     float m_timestampPeriod = 1.0f; // nanoseconds per timestamp tick
 
     // GPU timing state
-    bool m_timestampsWritten = false;     // True if timestamps were written this frame
-    bool m_queryPoolNeedsReset = true;    // True if query pool needs reset before first use
-    bool m_startTimestampWritten = false; // True if start timestamp was written this frame
-    double m_lastGpuTimeMs = 0.0;         // Last computed GPU time
-    static constexpr uint32_t QUERY_START = 0;
-    static constexpr uint32_t QUERY_END = 1;
+    double m_lastGpuTimeMs = 0.0; // Last computed GPU time
+    double m_lastWaterPassTimeMs = 0.0;
+    double m_lastScenePassTimeMs = 0.0;
+    double m_lastPostProcessTimeMs = 0.0;
+    double m_lastCpuTimeMs = 0.0;
+    double m_lastLatencyMs = 0.0;
+    GpuPassStatistics m_lastPipelineStatistics;
+    std::vector<double> m_lastGpuCounters;
+    std::vector<std::string> m_gpuCounterNames;
 
     // Test state
     bool m_isRunning = false;
+    bool m_isWarmingUp = false;
+    WarmupDetector m_warmup;
     uint32_t m_currentFrameIndex = 0;
     WaterTestConfig m_currentConfig;
     TestRunResult m_currentResult;
@@ -548,11 +696,22 @@ private:
 
     // Frame buffer for temporal analysis
     std::vector<std::vector<uint8_t>> m_frameBuffer;
+    uint32_t m_frameBufferWidth = 0;
+    uint32_t m_frameBufferHeight = 0;
+
+    JobSystem *m_jobSystem = nullptr;
+
+    // Streaming (setFrameLogPath)
+    std::unique_ptr<FrameMetricsLog> m_frameLog;
+    std::string m_frameLogPath;
+
+    RunStatistics m_live;
+    std::map<std::string, ConfigAccumulator> m_configSummaries;
+
+    AggregatedRunMetrics aggregateStreamedMetrics(const WaterTestConfig &config) const;
 
     // Helper functions
-    void createTimestampQueryPool();
     double getTimestampMs(uint64_t timestamp) const;
-    bool isOutlier(double value, double mean, double stddev, double threshold = 5.0) const;
     double computeSSIM(const uint8_t *img1, const uint8_t *img2, uint32_t width, uint32_t height);
     double computePSNR(const uint8_t *img1, const uint8_t *img2, uint32_t width, uint32_t height);
     double computeMSE(const uint8_t *img1, const uint8_t *img2, uint32_t width, uint32_t height);
@@ -1,14 +1,77 @@
+#include "ThreadAffinity.h"
 #include "VulkanBase.h"
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
-int main() {
+// XeRender [--gpu <index|name>] [--stereo] [--auto-tune <ms>] [--telemetry <host:port>] [--affinity <placement.json>]
+//   --gpu: the device by enumeration index or part of its name, else XERENDER_GPU, else the best scoring one (DeviceSelection.h)
+//   --stereo: both eyes in one multiview main pass, side by side in the window (Multiview.h)
+//   --auto-tune: search OPT's settings for this GPU frame time at startup, unless the device's cached preset has it (AutoTuner.h)
+//   --telemetry: stream live frame metrics to a UDP collector once a second, else XERENDER_TELEMETRY (TelemetryStream.h)
+//   --affinity: pin the render, simulation, job and service threads to the file's cores, else XERENDER_AFFINITY (ThreadAffinity.h)
+// XeRender --cook-bathymetry <in.r16> <width> <spacing> <minElevation> <maxElevation> <out.bathy>
+//   Writes the sea floor's streamed tiles from a square raw 16-bit heightmap, then exits (BathymetryField.h)
+int main(int argc, char** argv) {
 	// DISABLE_LAYER_AMD_SWITCHABLE_GRAPHICS_1 = 1
 	//DISABLE_LAYER_NV_OPTIMUS_1 = 1
 	//_putenv_s("DISABLE_LAYER_AMD_SWITCHABLE_GRAPHICS_1", "1");
 	//_putenv_s("DISABLE_LAYER_NV_OPTIMUS_1", "1");
-	VulkanBase app;
+	std::string gpu;
+	bool stereo = false;
+	double autoTuneMs = 0.0;
+	std::string telemetry;
+	std::string affinity;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--cook-bathymetry" && i + 6 < argc) {
+			try {
+				BathymetryField::CookSettings settings;
+				const std::string raw = argv[++i];
+				const uint32_t width = static_cast<uint32_t>(std::stoul(argv[++i]));
+				settings.sampleSpacing = std::stof(argv[++i]);
+				settings.minElevation = std::stof(argv[++i]);
+				settings.maxElevation = std::stof(argv[++i]);
+				BathymetryField::cook(raw, width, settings, argv[++i]);
+			}
+			catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+				return EXIT_FAILURE;
+			}
+			return EXIT_SUCCESS;
+		}
+		else if (arg == "--gpu" && i + 1 < argc) {
+			gpu = argv[++i];
+		}
+		else if (arg == "--stereo") {
+			stereo = true;
+		}
+		else if (arg == "--auto-tune" && i + 1 < argc) {
+			autoTuneMs = std::atof(argv[++i]);
+		}
+		else if (arg == "--telemetry" && i + 1 < argc) {
+			telemetry = argv[++i];
+		}
+		else if (arg == "--affinity" && i + 1 < argc) {
+			affinity = argv[++i];
+		}
+		else {
+			std::cerr << "Unknown or incomplete argument: " << arg << "\n"
+				<< "Usage: XeRender [--gpu <index|name>] [--stereo] [--auto-tune <ms>] [--telemetry <host:port>] [--affinity <placement.json>]\n"
+				<< "       XeRender --cook-bathymetry <in.r16> <width> <spacing> <minElevation> <maxElevation> <out.bathy>\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Before the renderer starts its threads: each pins itself as it starts
+	if (!ThreadAffinity::configure(affinity))
+		return EXIT_FAILURE;
 
 	try {
+		VulkanBase app(gpu, stereo);
+		if (autoTuneMs > 0.0)
+			app.requestAutoTune(autoTuneMs);
+		app.setTelemetryEndpoint(telemetry);
 		app.run();
 	}
 	catch (const std::exception& e) {
@@ -16,4 +79,4 @@ int main() {
 		return EXIT_FAILURE;
 	}
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
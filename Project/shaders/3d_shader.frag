@@ -1,72 +1,270 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragNormal;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragPosition;
+layout(location = 3) flat in uint fragMaterial; // MaterialTable index
 
 layout(location = 0) out vec4 FragColor;
 
-layout(binding = 1) uniform sampler2D baseTexture;
-layout(binding = 3) uniform sampler2D metalnessTexture;
-layout(binding = 4) uniform sampler2D normalTexture;
-layout(binding = 5) uniform sampler2D specularTexture;
+// No discard or depth writes: depth is tested before shading, so after the depth pre-pass only the
+// visible fragment of each sample runs this shader
+layout(early_fragment_tests) in;
+
+// Bindless table (BindlessTable.h): the material table, its maps and the irradiance SH by index
+layout(set = 2, binding = 0) uniform sampler2D bindlessTextures[];
+layout(set = 2, binding = 1, std430) readonly buffer BindlessBuffer { vec4 data[]; } bindlessBuffers[];
 layout(set = 1, binding = 3) uniform sampler2D causticTex;
+layout(set = 1, binding = 9) uniform sampler2D causticsMap; // Traced through the ocean surface, 1 = flat water (OceanCaustics.h)
+layout(set = 1, binding = 10) uniform sampler3D froxelVolume; // rgb: light scattered in front, a: green transmittance (FroxelVolume.h)
 
-#define MAX_LIGHTS 2
 struct Light { vec3 position; vec3 color; float intensity; };
-layout(binding = 2) uniform LightInfo { Light lights[MAX_LIGHTS]; vec3 viewPos; vec3 ambientColor; float ambientIntensity; } lightInfo;
+layout(binding = 2) uniform LightInfo {
+    Light sun; vec3 viewPos; vec3 ambientColor; float ambientIntensity;
+    // Point lights (ClusteredLights.h)
+    mat4 clusterView;       // Main camera
+    vec4 clusterProjection; // x, y: view to NDC scale, z: grid near, w: slices / log(far / near)
+    uvec4 clusterInfo;      // x: light count, y: first light, z: first cluster word, w: 1 if clustered
+} lightInfo;
 layout(binding = 6) uniform ToggleInfo { bool applyNormalMap; bool applyMetalnessMap; bool applySpecularMap; bool viewNormalOnly; bool viewMetalnessOnly; bool viewSpecularOnly; bool applyRimLight; } toggleInfo;
 
+// Image-based lighting (ImageBasedLighting.h): irradiance / pi as L2 SH (bindless), GGX-prefiltered sky, split-sum LUT
+layout(binding = 8) uniform samplerCube prefilteredSky;
+layout(binding = 9) uniform sampler2D brdfLut;
+const float PREFILTERED_MAX_LOD = 5.0; // ImageBasedLighting::kPrefilteredLevels - 1
+
 layout(push_constant) uniform WaterPush {
     float time; float scale; vec2 _pad;
+    // VulkanBase::MaterialPush, after the 16 bytes the water shaders share
+    layout(offset = 16) uint materialBuffer; uint irradianceBuffer;
+} pc;
+
+// Underwater block of WaterParams (WaterParamsBuffer.h): zeroed above the surface, but for the
+// fog a view across the waterline draws under it (sceneFog 0 then)
+struct WaterParamBlock {
     vec4 baseColor;  // ImGui: Shallow Color
     vec4 lightColor; // ImGui: Deep Color
-    float ambient; float shininess; float causticIntensity; 
-    float distortionStrength; float godRayIntensity; float scatteringIntensity; 
-    float opacity; float fogDensity;
-} pc;
+    float ambient; float shininess; float causticIntensity; float distortionStrength;
+    float godRayIntensity; float scatteringIntensity; float opacity; float fogDensity;
+    float godExposure; float godDecay; float godDensity; float godSampleScale;
+    float causticMapScale; // 1 / world units the computed caustics map covers, 0: static texture (OceanCaustics.h)
+    float froxelNear; float froxelDepthScale; // Underwater fog from the froxel volume (FroxelVolume.h); depth scale 0: analytic fog
+    float snowParticles; // Non-zero: marine snow is drawn as particles (MarineSnow.h)
+    float waterlineHeight; float sceneFog; // Surface height at the camera; non-zero: the scene is drawn in the water
+};
+layout(std140, set = 1, binding = 7) uniform WaterParams { WaterParamBlock surface; WaterParamBlock underwater; } water;
+
+// Clustered point lights (ClusteredLights.h): this frame's lights, and per cluster the count then the indices
+#define CLUSTER_TILES_X 16u
+#define CLUSTER_TILES_Y 9u
+#define CLUSTER_SLICES 24u
+#define CLUSTER_STRIDE 128u
+struct PointLight { vec4 positionRadius; vec4 colorIntensity; };
+layout(std430, binding = 10) readonly buffer PointLights { PointLight pointLights[]; };
+layout(std430, binding = 11) readonly buffer LightClusters { uint clusterWords[]; };
+
+// Sun shadow cascades (ShadowCascades.h): the matrix each map was last rendered with, nearest first
+#define MAX_SHADOW_CASCADES 4
+layout(set = 3, binding = 0) uniform ShadowInfo {
+    mat4 viewProjection[MAX_SHADOW_CASCADES];
+    vec4 params; // x: cascade count, y: PCF radius in texels, z: texel size in uv
+} shadowInfo;
+layout(set = 3, binding = 1) uniform sampler2DShadow shadowMaps[MAX_SHADOW_CASCADES];
+
+// MaterialTable::GpuMaterial, four vec4s per material
+#define MAP_BASE 0
+#define MAP_METALNESS 1
+#define MAP_NORMAL 2
+#define MAP_SPECULAR 3
+struct Material { vec3 baseColor; float metalness; float roughness; uvec4 textures; uint maps; };
+Material loadMaterial(uint index) {
+    uint base = index * 4u;
+    Material m;
+    m.baseColor = bindlessBuffers[pc.materialBuffer].data[base].rgb;
+    vec4 factors = bindlessBuffers[pc.materialBuffer].data[base + 1u];
+    m.metalness = factors.x;
+    m.roughness = factors.y;
+    m.textures = floatBitsToUint(bindlessBuffers[pc.materialBuffer].data[base + 2u]);
+    m.maps = floatBitsToUint(bindlessBuffers[pc.materialBuffer].data[base + 3u].x);
+    return m;
+}
+bool hasMap(Material m, int map) { return (m.maps & (1u << map)) != 0u; }
+
+vec3 evaluateIrradiance(vec3 n) {
+    vec3 result = bindlessBuffers[pc.irradianceBuffer].data[0].rgb * 0.282095;
+    result += bindlessBuffers[pc.irradianceBuffer].data[1].rgb * 0.488603 * n.y;
+    result += bindlessBuffers[pc.irradianceBuffer].data[2].rgb * 0.488603 * n.z;
+    result += bindlessBuffers[pc.irradianceBuffer].data[3].rgb * 0.488603 * n.x;
+    result += bindlessBuffers[pc.irradianceBuffer].data[4].rgb * 1.092548 * n.x * n.y;
+    result += bindlessBuffers[pc.irradianceBuffer].data[5].rgb * 1.092548 * n.y * n.z;
+    result += bindlessBuffers[pc.irradianceBuffer].data[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0);
+    result += bindlessBuffers[pc.irradianceBuffer].data[7].rgb * 1.092548 * n.x * n.z;
+    result += bindlessBuffers[pc.irradianceBuffer].data[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
+// Constant indices: neighbouring fragments can pick different cascades
+float shadowTap(int cascade, vec3 coord) {
+    switch (cascade) {
+    case 0: return textureLod(shadowMaps[0], coord, 0.0);
+    case 1: return textureLod(shadowMaps[1], coord, 0.0);
+    case 2: return textureLod(shadowMaps[2], coord, 0.0);
+    default: return textureLod(shadowMaps[3], coord, 0.0);
+    }
+}
+
+// 1 = lit. The first cascade the position falls inside, with room for the filter kernel
+float sunShadow(vec3 worldPos) {
+    int count = int(shadowInfo.params.x);
+    int radius = int(shadowInfo.params.y);
+    float texel = shadowInfo.params.z;
+    float margin = texel * float(radius + 1);
+    for (int i = 0; i < MAX_SHADOW_CASCADES; i++) {
+        if (i >= count) break;
+        vec4 clip = shadowInfo.viewProjection[i] * vec4(worldPos, 1.0);
+        vec3 coord = vec3(clip.xy * 0.5 + 0.5, clip.z);
+        if (any(lessThan(coord.xy, vec2(margin))) || any(greaterThan(coord.xy, vec2(1.0 - margin))) || coord.z > 1.0) continue;
+
+        float lit = 0.0;
+        for (int y = -radius; y <= radius; y++)
+            for (int x = -radius; x <= radius; x++)
+                lit += shadowTap(i, coord + vec3(vec2(x, y) * texel, 0.0));
+        return lit / float((2 * radius + 1) * (2 * radius + 1));
+    }
+    return 1.0;
+}
+
+// Diffuse and Blinn-Phong specular from the point lights of the fragment's cluster, or from every
+// light with clustering off. Outside the main camera's grid (the reflection pass) there are none.
+vec3 pointLighting(vec3 worldPos, vec3 n, vec3 v, vec3 albedo, float shininess) {
+    uint count = lightInfo.clusterInfo.x;
+    if (count == 0u) return vec3(0.0);
+
+    bool clustered = lightInfo.clusterInfo.w != 0u;
+    uint listStart = 0u;
+    if (clustered) {
+        vec3 viewPos = (lightInfo.clusterView * vec4(worldPos, 1.0)).xyz;
+        float depth = -viewPos.z;
+        vec2 ndc = viewPos.xy / max(depth, 1e-4) * lightInfo.clusterProjection.xy;
+        if (depth <= 0.0 || any(greaterThan(abs(ndc), vec2(1.0)))) return vec3(0.0);
+
+        uvec2 tile = min(uvec2((ndc * 0.5 + 0.5) * vec2(CLUSTER_TILES_X, CLUSTER_TILES_Y)), uvec2(CLUSTER_TILES_X - 1u, CLUSTER_TILES_Y - 1u));
+        float sliceF = log(max(depth, lightInfo.clusterProjection.z) / lightInfo.clusterProjection.z) * lightInfo.clusterProjection.w;
+        uint slice = min(uint(sliceF), CLUSTER_SLICES - 1u);
+        listStart = lightInfo.clusterInfo.z + ((slice * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x) * CLUSTER_STRIDE;
+        count = clusterWords[listStart];
+    }
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < count; i++) {
+        uint index = clustered ? clusterWords[listStart + 1u + i] : i;
+        PointLight light = pointLights[lightInfo.clusterInfo.y + index];
+        vec3 toLight = light.positionRadius.xyz - worldPos;
+        float dist2 = dot(toLight, toLight);
+        float radius2 = light.positionRadius.w * light.positionRadius.w;
+        if (dist2 >= radius2) continue;
+
+        // Inverse square, windowed to reach zero at the radius the light was binned with
+        float ratio = dist2 / radius2;
+        float window = 1.0 - ratio * ratio;
+        float attenuation = window * window / (dist2 + 1.0);
+        vec3 l = toLight * inversesqrt(max(dist2, 1e-4));
+        float nDotL = max(dot(n, l), 0.0);
+        float specular = pow(max(dot(n, normalize(l + v)), 0.0), shininess) * nDotL;
+        result += light.colorIntensity.rgb * (light.colorIntensity.w * attenuation) * (albedo * nDotL + vec3(specular));
+    }
+    return result;
+}
+
+// Underwater fog and light shafts between the camera and worldPos, one froxel volume lookup (FroxelVolume.h)
+#define FROXEL_SLICES 64.0
+const vec3 FROXEL_ABSORPTION_RATIO = vec3(0.18, 0.07, 0.03) / 0.07; // Per channel, relative to green
+vec3 froxelFog(vec3 color, vec3 worldPos) {
+    vec3 viewPos = (lightInfo.clusterView * vec4(worldPos, 1.0)).xyz;
+    float depth = max(-viewPos.z, 1e-4);
+    vec2 uv = viewPos.xy / depth * lightInfo.clusterProjection.xy * 0.5 + 0.5;
+    float near = water.underwater.froxelNear;
+    // Each froxel holds the values at its far edge
+    float slice = log(max(depth, near) / near) * water.underwater.froxelDepthScale - 0.5 / FROXEL_SLICES;
+    vec4 fog = textureLod(froxelVolume, vec3(uv, slice), 0.0);
+    return color * pow(vec3(clamp(fog.a, 0.0, 1.0)), FROXEL_ABSORPTION_RATIO) + fog.rgb;
+}
 
 void main() {
-    vec3 baseColor = texture(baseTexture, fragTexCoord).rgb;
+    // The index differs per draw, not per fragment, but instanced draws mix materials
+    Material material = loadMaterial(fragMaterial);
+    vec3 baseColor = material.baseColor;
+    if (hasMap(material, MAP_BASE)) {
+        baseColor *= texture(bindlessTextures[nonuniformEXT(material.textures[MAP_BASE])], fragTexCoord).rgb;
+    }
     vec3 norm = normalize(fragNormal);
-    if (toggleInfo.applyNormalMap) {
-        vec3 normalMapColor = texture(normalTexture, fragTexCoord).rgb;
-        norm = normalize(normalMapColor * 2.0 - 1.0);
+    if (toggleInfo.applyNormalMap && hasMap(material, MAP_NORMAL)) {
+        // Sampled UNORM (MaterialTable); z rebuilt from .rg so a two-channel (BC5) cook works too
+        vec2 normalXY = texture(bindlessTextures[nonuniformEXT(material.textures[MAP_NORMAL])], fragTexCoord).rg * 2.0 - 1.0;
+        norm = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
     }
 
     // Colors
-    vec3 deepColor = pc.lightColor.rgb; // Dark Blue
+    vec3 deepColor = water.underwater.lightColor.rgb; // Dark Blue
     
     // Lighting
     // If light position is 0, default to overhead
-    vec3 lightPos = lightInfo.lights[0].position;
+    vec3 lightPos = lightInfo.sun.position;
     if (length(lightPos) < 0.1) lightPos = vec3(0.0, 100.0, 0.0);
     
     vec3 sunDir = normalize(lightPos);
-    float diff = max(dot(norm, sunDir), 0.0);
+    // Occludes the direct sun and the caustics it focuses, not the sky
+    float shadow = sunShadow(fragPosition);
+    float diff = max(dot(norm, sunDir), 0.0) * shadow;
     
-    // Ambient - Make it brighter and blue-ish
-    vec3 ambient = vec3(0.2, 0.4, 0.5) * 0.5; 
+    // Ambient from the sky: diffuse SH plus the split-sum specular, tinted by the ambient color.
+    // The material's factors unless it has the metalness/specular maps and they are on.
+    float metallic = material.metalness;
+    if (toggleInfo.applyMetalnessMap && hasMap(material, MAP_METALNESS)) {
+        metallic = texture(bindlessTextures[nonuniformEXT(material.textures[MAP_METALNESS])], fragTexCoord).r;
+    }
+    float roughness = material.roughness;
+    if (toggleInfo.applySpecularMap && hasMap(material, MAP_SPECULAR)) {
+        roughness = 1.0 - texture(bindlessTextures[nonuniformEXT(material.textures[MAP_SPECULAR])], fragTexCoord).r;
+    }
+    vec3 viewDir = normalize(lightInfo.viewPos - fragPosition);
+    float nDotV = max(dot(norm, viewDir), 1e-3);
+    vec3 f0 = mix(vec3(0.04), baseColor, metallic);
+    vec2 brdf = texture(brdfLut, vec2(nDotV, roughness)).rg;
+    vec3 skySpecular = textureLod(prefilteredSky, reflect(-viewDir, norm), roughness * PREFILTERED_MAX_LOD).rgb;
+    vec3 ambient = evaluateIrradiance(norm) * (1.0 - metallic) * lightInfo.ambientColor;
+    vec3 ambientSpecular = skySpecular * (f0 * brdf.x + brdf.y) * lightInfo.ambientColor;
     
-    // Caustics
-    vec2 causticUV = fragPosition.xz * 0.05 + vec2(pc.time * 0.05);
-    float caustic = texture(causticTex, causticUV).r;
-    caustic += texture(causticTex, causticUV * 0.7 - vec2(pc.time * 0.02)).r;
-    caustic = pow(caustic, 3.0) * 3.0; // Sharpen
+    // Caustics: the light the waves focus here this frame, or the scrolling texture
+    float caustic;
+    if (water.underwater.causticMapScale > 0.0) {
+        caustic = max(texture(causticsMap, fragPosition.xz * water.underwater.causticMapScale).r - 1.0, 0.0) * 3.0;
+    } else {
+        vec2 causticUV = fragPosition.xz * 0.05 + vec2(pc.time * 0.05);
+        caustic = texture(causticTex, causticUV).r;
+        caustic += texture(causticTex, causticUV * 0.7 - vec2(pc.time * 0.02)).r;
+        caustic = pow(caustic, 3.0) * 3.0; // Sharpen
+    }
     
-    vec3 causticColor = vec3(0.8, 0.9, 1.0) * caustic * pc.causticIntensity;
+    vec3 causticColor = vec3(0.8, 0.9, 1.0) * caustic * water.underwater.causticIntensity * shadow;
 
     // Combine
-    vec3 finalColor = baseColor * (ambient + diff) + (causticColor * baseColor);
+    vec3 finalColor = baseColor * (ambient + diff) + ambientSpecular + (causticColor * baseColor);
+    finalColor += pointLighting(fragPosition, norm, viewDir, baseColor * (1.0 - metallic), mix(8.0, 128.0, 1.0 - roughness));
 
-    // === SEAM FIX: DISTANCE FOG ===
-    // This must match the surface shader's Deep Color blend
-    float dist = length(fragPosition - lightInfo.viewPos);
-    float fogFactor = 1.0 - exp(-dist * pc.fogDensity);
-    fogFactor = clamp(fogFactor, 0.0, 1.0);
+    if (water.underwater.froxelDepthScale > 0.0) {
+        finalColor = froxelFog(finalColor, fragPosition);
+    } else if (water.underwater.sceneFog != 0.0) {
+        // === SEAM FIX: DISTANCE FOG ===
+        // This must match the surface shader's Deep Color blend
+        float dist = length(fragPosition - lightInfo.viewPos);
+        float fogFactor = 1.0 - exp(-dist * water.underwater.fogDensity);
+        fogFactor = clamp(fogFactor, 0.0, 1.0);
 
-    // Fade floor into the deep water color
-    finalColor = mix(finalColor, deepColor, fogFactor);
+        // Fade floor into the deep water color
+        finalColor = mix(finalColor, deepColor, fogFactor);
+    }
 
     FragColor = vec4(finalColor, 1.0);
 }
\ No newline at end of file
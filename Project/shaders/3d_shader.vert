@@ -1,15 +1,31 @@
 #version 450
+#extension GL_EXT_multiview : require
 
+// PackedVertex (Vertex.h): the position is 0..1 over the object's quantisation
+// cube, which ubo.model (SceneDrawRecord::modelMatrix) maps back
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
+layout(location = 1) in vec2 inNormal; // Octahedral
 layout(location = 2) in vec2 inTexCoord;
 
 layout(binding = 0) uniform UBO {
     mat4 model;
     mat4 view;
     mat4 proj;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 offscreenScale;
+    vec4 ocean;
+    vec4 viewport;
+    mat4 offscreenViewProj;
+    uvec4 material; // x: MaterialTable index (MaterialTable.h)
+    uvec4 views;    // x: 2 in a stereo pass (Multiview.h)
+    mat4 eyeViewProj[2]; // Per view of a stereo pass, by gl_ViewIndex
+    vec4 eyePos[2];
 } ubo;
 
+// A stereo pass draws both eyes at once (Multiview.h); ubo.view/proj are then the camera both are culled with
+mat4 viewProjection() { return ubo.views.x > 1u ? ubo.eyeViewProj[gl_ViewIndex] : ubo.proj * ubo.view; }
+
 // ADDED: Push Constants to match the Pipeline Layout (80 bytes)
 // This must be present because we set VK_SHADER_STAGE_VERTEX_BIT in C++
 layout(push_constant) uniform WaterPush {
@@ -31,11 +47,21 @@ layout(push_constant) uniform WaterPush {
 layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragPosition;
+layout(location = 3) flat out uint fragMaterial;
+
+// PackedVertex (Vertex.h): octahedral normal
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main() {
-    fragNormal = mat3(ubo.model) * inNormal; // Transform the normal to world space
+    fragNormal = mat3(ubo.model) * octDecode(inNormal); // Transform the normal to world space
     fragTexCoord = inTexCoord;
+    fragMaterial = ubo.material.x;
     fragPosition = vec3(ubo.model * vec4(inPosition, 1.0)); // World space position
 
-    gl_Position = ubo.proj * ubo.view * vec4(fragPosition, 1.0);
+    gl_Position = viewProjection() * vec4(fragPosition, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+#version 450
+#extension GL_EXT_multiview : require
+
+// Instanced variant of 3d_shader.vert: the model matrix comes from per-instance
+// data instead of ubo.model, the GPU-culled object table (firstInstance = object
+// index) or a CPU batch of instances of one mesh (GpuCulling.h).
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal; // Octahedral, see 3d_shader.vert
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in mat4 inModel; // Locations 3-6
+layout(location = 7) in uint inMaterial; // SceneDrawRecord::materialId
+
+layout(binding = 0) uniform UBO {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 offscreenScale;
+    vec4 ocean;
+    vec4 viewport;
+    mat4 offscreenViewProj;
+    uvec4 material;
+    uvec4 views; // x: 2 in a stereo pass (Multiview.h)
+    mat4 eyeViewProj[2]; // Per view of a stereo pass, by gl_ViewIndex
+    vec4 eyePos[2];
+} ubo;
+
+// A stereo pass draws both eyes at once (Multiview.h); ubo.view/proj are then the camera both are culled with
+mat4 viewProjection() { return ubo.views.x > 1u ? ubo.eyeViewProj[gl_ViewIndex] : ubo.proj * ubo.view; }
+
+// Must match the pipeline layout, see 3d_shader.vert
+layout(push_constant) uniform WaterPush {
+    float time;
+    float scale;
+    vec2 _pad;
+    vec4 baseColor;
+    vec4 lightColor;
+    float ambient;
+    float shininess;
+    float causticIntensity;
+    float distortionStrength;
+    float godRayIntensity;
+    float scatteringIntensity;
+    float opacity;
+    float fogDensity;
+} pc;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragPosition;
+layout(location = 3) flat out uint fragMaterial;
+
+// PackedVertex (Vertex.h): octahedral normal
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    fragNormal = mat3(inModel) * octDecode(inNormal);
+    fragTexCoord = inTexCoord;
+    fragMaterial = inMaterial;
+    fragPosition = vec3(inModel * vec4(inPosition, 1.0));
+
+    gl_Position = viewProjection() * vec4(fragPosition, 1.0);
+}
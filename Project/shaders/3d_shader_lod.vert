@@ -0,0 +1,121 @@
+#version 450
+#extension GL_EXT_multiview : require
+
+// CDLOD variant of 3d_shader.vert for the ocean bottom: the vertices are one
+// shared tile placed and morphed per instance (CdlodGrid.h), as in water.vert.
+// With survey data loaded (BathymetryField.h) each vertex takes its elevation
+// from the streamed tiles; without, the floor stays flat at the grid's height.
+
+layout(location = 0) in uvec2 inCell;    // The shared tile's cell corner (CdlodVertex)
+layout(location = 3) in vec4 inTileNode;  // xy: world XZ min corner, z: node size, w: plane height
+layout(location = 4) in vec4 inTileMorph; // x, y: morph range constants, z: 1 / plane size, w: level
+
+const float LOD_TILE_CELLS = 32.0; // CdlodGrid::kTileCells
+const uint NOT_RESIDENT = 0xFFFFFFFFu; // BathymetryField::kNotResident
+
+layout(binding = 0) uniform UBO {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 offscreenScale;
+    vec4 ocean;
+    vec4 viewport;
+    mat4 offscreenViewProj;
+    uvec4 material;
+    uvec4 views; // x: 2 in a stereo pass (Multiview.h)
+    mat4 eyeViewProj[2]; // Per view of a stereo pass, by gl_ViewIndex
+    vec4 eyePos[2];
+} ubo;
+
+// Streamed elevation tiles, one per layer, and the page table listing them (BathymetryField.h)
+layout(set = 1, binding = 16) uniform sampler2DArray bathymetryAtlas;
+layout(std430, set = 1, binding = 17) readonly buffer BathymetryPages {
+    vec4 field;     // xy: world XZ of the min corner, z: world size, w: tiles per side at level 0
+    vec4 elevation; // x: elevation at sample 0, y: range over the samples, z: samples per tile side, w: levels
+    vec4 detail;    // x: distance where level 0 gives way to level 1, y: 1 with a field, 0 when flat
+    uvec4 levelOffsets[4];
+    uint slots[];   // Atlas layer per tile, rows of tiles per level, finest level first
+} bathymetry;
+
+// A stereo pass draws both eyes at once (Multiview.h); ubo.view/proj are then the camera both are culled with
+mat4 viewProjection() { return ubo.views.x > 1u ? ubo.eyeViewProj[gl_ViewIndex] : ubo.proj * ubo.view; }
+
+// Must match the pipeline layout, see 3d_shader.vert
+layout(push_constant) uniform WaterPush {
+    float time;
+    float scale;
+    vec2 _pad;
+    vec4 baseColor;
+    vec4 lightColor;
+    float ambient;
+    float shininess;
+    float causticIntensity;
+    float distortionStrength;
+    float godRayIntensity;
+    float scatteringIntensity;
+    float opacity;
+    float fogDensity;
+} pc;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragPosition;
+layout(location = 3) flat out uint fragMaterial;
+
+// Elevation at xz from 'level', or the finest coarser level resident there; outside the field its edge repeats
+float levelElevation(vec2 xz, int level) {
+    vec2 fieldUv = clamp((xz - bathymetry.field.xy) / bathymetry.field.z, 0.0, 1.0);
+    float samples = bathymetry.elevation.z;
+    int levels = int(bathymetry.elevation.w);
+    for (int l = level; l < levels; l++) {
+        uint tiles = max(uint(bathymetry.field.w) >> l, 1u);
+        vec2 tileCoord = fieldUv * float(tiles);
+        uvec2 tile = min(uvec2(tileCoord), uvec2(tiles - 1u));
+        uint slot = bathymetry.slots[bathymetry.levelOffsets[l / 4][l % 4] + tile.y * tiles + tile.x];
+        if (slot != NOT_RESIDENT) {
+            vec2 uv = ((tileCoord - vec2(tile)) * (samples - 1.0) + 0.5) / samples;
+            return bathymetry.elevation.x + textureLod(bathymetryAtlas, vec3(uv, float(slot)), 0.0).r * bathymetry.elevation.y;
+        }
+    }
+    return bathymetry.elevation.x; // The coarsest tile is always resident
+}
+
+// The level follows the distance, blended between two like the CDLOD morph, so vertices two tiles share agree
+float bathymetryElevation(vec2 xz, float level) {
+    int lower = int(level);
+    float blend = level - float(lower);
+    float height = levelElevation(xz, lower);
+    return blend > 0.0 ? mix(height, levelElevation(xz, lower + 1), blend) : height;
+}
+
+void main() {
+    vec2 cell = vec2(inCell);
+    float cellSize = inTileNode.z / LOD_TILE_CELLS;
+    vec3 gridPoint = vec3(inTileNode.x + cell.x * cellSize, inTileNode.w, inTileNode.y + cell.y * cellSize);
+    float morph = 1.0 - clamp(inTileMorph.x - distance(gridPoint, ubo.viewPos.xyz) * inTileMorph.y, 0.0, 1.0);
+    gridPoint.xz -= mod(cell, 2.0) * cellSize * morph;
+
+    vec3 normal = vec3(0.0, 1.0, 0.0); // Flat floor
+    if (bathymetry.detail.y > 0.0) {
+        float levels = bathymetry.elevation.w;
+        float level = clamp(log2(max(distance(gridPoint, ubo.viewPos.xyz) / bathymetry.detail.x, 1.0)), 0.0, levels - 1.0);
+        gridPoint.y = inTileNode.w + bathymetryElevation(gridPoint.xz, level);
+
+        // Central differences one sample of the level apart
+        float spacing = bathymetry.field.z / (max(bathymetry.field.w / exp2(floor(level)), 1.0) * (bathymetry.elevation.z - 1.0));
+        float left = bathymetryElevation(gridPoint.xz - vec2(spacing, 0.0), level);
+        float right = bathymetryElevation(gridPoint.xz + vec2(spacing, 0.0), level);
+        float back = bathymetryElevation(gridPoint.xz - vec2(0.0, spacing), level);
+        float front = bathymetryElevation(gridPoint.xz + vec2(0.0, spacing), level);
+        normal = normalize(vec3(left - right, 2.0 * spacing, back - front));
+    }
+
+    fragNormal = mat3(ubo.model) * normal;
+    fragTexCoord = gridPoint.xz * inTileMorph.z + 0.5;
+    fragMaterial = 0u; // The default material
+    fragPosition = vec3(ubo.model * vec4(gridPoint, 1.0));
+
+    gl_Position = viewProjection() * vec4(fragPosition, 1.0);
+}
@@ -0,0 +1,39 @@
+# Writes the compiled shaders as C++ data for ShaderRegistry (ShaderRegistry.h).
+#   cmake -DSPIRV_FILES=<a.spv|b.spv|...> -DOUTPUT_DIR=<dir> -P EmbedShaders.cmake
+# SPIRV_FILES is sorted by name (the registry binary-searches the table).
+#   EmbeddedShaderNames.h   EmbeddedShaders::kNames, a constexpr table of the module names
+#   EmbeddedShaderData.inc  kSpirv: each module's words, in the same order
+
+string(REPLACE "|" ";" SPIRV_FILES "${SPIRV_FILES}")
+list(LENGTH SPIRV_FILES SPIRV_COUNT)
+
+set(NAMES "// Generated by shaders/EmbedShaders.cmake from the shaders target's outputs. Do not edit.\n")
+string(APPEND NAMES "#pragma once\n\n#include <array>\n#include <string_view>\n\n")
+string(APPEND NAMES "namespace EmbeddedShaders\n{\n")
+string(APPEND NAMES "    inline constexpr std::array<std::string_view, ${SPIRV_COUNT}> kNames = {\n")
+
+set(DATA "// Generated by shaders/EmbedShaders.cmake from the shaders target's outputs. Do not edit.\n\n")
+set(TABLE "const EmbeddedSpirv kSpirv[] = {\n")
+
+set(INDEX 0)
+foreach(SPIRV ${SPIRV_FILES})
+    get_filename_component(NAME ${SPIRV} NAME)
+    string(APPEND NAMES "        \"${NAME}\",\n")
+
+    file(READ ${SPIRV} HEX HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+    set(ROW "0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,")
+    string(REGEX REPLACE "(${ROW})" "\\1\n    " BYTES "${BYTES}")
+    string(APPEND DATA "// ${NAME}\nalignas(4) const unsigned char kSpirv${INDEX}[] = {\n    ${BYTES}\n};\n")
+    string(APPEND TABLE "    {kSpirv${INDEX}, sizeof(kSpirv${INDEX})},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+string(APPEND NAMES "    };\n}\n")
+string(APPEND DATA "\n${TABLE}};\n")
+
+# The names only change when a module is added or removed: keep the header's time stamp otherwise
+file(WRITE ${OUTPUT_DIR}/EmbeddedShaderNames.h.tmp "${NAMES}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT_DIR}/EmbeddedShaderNames.h.tmp ${OUTPUT_DIR}/EmbeddedShaderNames.h)
+file(REMOVE ${OUTPUT_DIR}/EmbeddedShaderNames.h.tmp)
+file(WRITE ${OUTPUT_DIR}/EmbeddedShaderData.inc "${DATA}")
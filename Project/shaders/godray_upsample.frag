@@ -0,0 +1,58 @@
+#version 450
+
+// Half-res god rays added to the resolved frame (GodRayUpsampler.h): bilinear over the four
+// nearest low-res texels, each weighted down by how far the depth behind it is from this pixel's
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D raysTex;   // Quarter area
+layout(set = 0, binding = 1) uniform sampler2DMS depthTex; // Main pass depth
+
+layout(push_constant) uniform UpsamplePush {
+    vec2 depthParams; // proj[2][2], proj[3][2]
+} pc;
+
+// Relative view-distance difference at which a texel stops contributing
+const float DEPTH_TOLERANCE = 0.1;
+
+float viewDistance(ivec2 p) {
+    return pc.depthParams.y / (texelFetch(depthTex, p, 0).r + pc.depthParams.x);
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 fullSize = textureSize(depthTex);
+    ivec2 lowSize = textureSize(raysTex, 0);
+    float pixelDistance = viewDistance(p);
+
+    // Low-res texel centres sit on the corners between full-res pixel pairs
+    vec2 lowPos = (vec2(p) + 0.5) * 0.5 - 0.5;
+    ivec2 base = ivec2(floor(lowPos));
+    vec2 f = lowPos - vec2(base);
+
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+    vec3 closest = vec3(0.0);
+    float closestDiff = 1e30;
+    for (int y = 0; y <= 1; y++) {
+        for (int x = 0; x <= 1; x++) {
+            ivec2 q = clamp(base + ivec2(x, y), ivec2(0), lowSize - 1);
+            vec3 rays = texelFetch(raysTex, q, 0).rgb;
+
+            float diff = abs(viewDistance(min(q * 2, fullSize - 1)) - pixelDistance) / max(pixelDistance, 1e-4);
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+            float w = bilinear * (1.0 - smoothstep(0.0, DEPTH_TOLERANCE, diff));
+            sum += rays * w;
+            weightSum += w;
+
+            if (diff < closestDiff) {
+                closestDiff = diff;
+                closest = rays;
+            }
+        }
+    }
+
+    // Every texel across a depth edge: take the one nearest in depth
+    vec3 rays = weightSum > 1e-4 ? sum / weightSum : closest;
+    outColor = vec4(rays, 0.0);
+}
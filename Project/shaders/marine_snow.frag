@@ -0,0 +1,14 @@
+#version 450
+
+// Marine snow billboards (MarineSnow.h): a soft disc, added to the pass
+
+layout(location = 0) in vec2 vCorner;
+layout(location = 1) in vec3 vColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float disc = 1.0 - smoothstep(0.3, 1.0, length(vCorner));
+    if (disc <= 0.0) discard;
+    outColor = vec4(vColor * disc, 0.0);
+}
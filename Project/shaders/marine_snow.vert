@@ -0,0 +1,50 @@
+#version 450
+
+// Marine snow billboards (MarineSnow.h): six vertices per instance, one instance per particle.
+// The brightness fades towards the box edges, near the camera, with the water's extinction
+// and to nothing above the surface.
+
+struct Particle {
+    vec4 position; // xyz; w: seed
+    vec4 scale;    // x: size multiplier, y: brightness multiplier
+};
+layout(std430, set = 0, binding = 0) readonly buffer Particles { Particle particles[]; };
+
+layout(push_constant) uniform DrawPush {
+    mat4 viewProjection;
+    vec4 right;  // xyz; w: size
+    vec4 up;     // xyz; w: box size
+    vec4 camera; // xyz; w: fog density
+    vec4 color;
+} pc;
+
+layout(location = 0) out vec2 vCorner;
+layout(location = 1) out vec3 vColor;
+
+const float WATER_HEIGHT = 0.0;
+const vec2 CORNERS[6] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+                               vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+    Particle particle = particles[gl_InstanceIndex];
+    vec2 corner = CORNERS[gl_VertexIndex];
+    vec3 center = particle.position.xyz;
+
+    float dist = distance(center, pc.camera.xyz);
+    float halfBox = 0.5 * pc.up.w;
+    float fade = (1.0 - smoothstep(0.6 * halfBox, halfBox, dist)) * smoothstep(0.2, 0.8, dist) *
+                 exp(-pc.camera.w * dist) * step(center.y, WATER_HEIGHT);
+
+    // Invisible: outside the clip volume, so nothing rasterises
+    if (fade <= 0.0) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        vCorner = corner;
+        vColor = vec3(0.0);
+        return;
+    }
+
+    vec3 worldPos = center + (pc.right.xyz * corner.x + pc.up.xyz * corner.y) * pc.right.w * particle.scale.x;
+    gl_Position = pc.viewProjection * vec4(worldPos, 1.0);
+    vCorner = corner;
+    vColor = pc.color.rgb * particle.scale.y * fade;
+}
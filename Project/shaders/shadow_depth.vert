@@ -0,0 +1,16 @@
+#version 450
+
+// Depth-only rendering of the scene into a sun shadow cascade (ShadowCascades.h)
+
+// PackedVertex (Vertex.h): 0..1 over the object's quantisation cube
+layout(location = 0) in vec3 inPosition;
+// Instances of one mesh (GpuCullObject layout): SceneDrawRecord::modelMatrix
+layout(location = 3) in mat4 inModel; // Locations 3-6
+
+layout(push_constant) uniform ShadowPush {
+    mat4 viewProjection; // The cascade's
+} pc;
+
+void main() {
+    gl_Position = pc.viewProjection * (inModel * vec4(inPosition, 1.0));
+}
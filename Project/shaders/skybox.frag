@@ -6,6 +6,12 @@ layout(location = 0) out vec4 outColor;
 // cubemap sampler in set 1 binding 0
 layout(set = 1, binding = 0) uniform samplerCube skyboxTex;
 
+layout(push_constant) uniform Push {
+    float skyboxScale;
+    float lod; // >= 0: this level of the cube (the reflection pass' low-res sky), else the implicit one
+} pushConsts;
+
 void main() {
-    outColor = texture(skyboxTex, normalize(vTexDir));
+    vec3 dir = normalize(vTexDir);
+    outColor = pushConsts.lod >= 0.0 ? textureLod(skyboxTex, dir, pushConsts.lod) : texture(skyboxTex, dir);
 }
@@ -8,6 +8,7 @@ layout(std140, set = 0, binding = 0) uniform CameraUBO {
 
 layout(push_constant) uniform Push {
     float skyboxScale;
+    float lod; // Read by skybox.frag
 } pushConsts;
 
 layout(location = 0) in vec3 inPos;
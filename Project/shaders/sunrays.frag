@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_multiview : require
 
 // Input from vertex shader
 layout(location = 0) in vec2 vScreenUV;
@@ -9,6 +10,8 @@ layout(location = 0) out vec4 outColor;
 layout(std140, set = 0, binding = 0) uniform UBO {
     mat4 model; mat4 view; mat4 proj;
     vec4 lightPos; vec4 viewPos;
+    vec4 offscreenScale; vec4 ocean; vec4 viewport; mat4 offscreenViewProj; uvec4 material;
+    uvec4 views; mat4 eyeViewProj[2]; vec4 eyePos[2]; // Stereo passes (Multiview.h)
 } ubo;
 
 // Textures
@@ -16,32 +19,51 @@ layout(set = 1, binding = 1) uniform sampler2D waterNormalMap;
 layout(set = 1, binding = 2) uniform sampler2D waterDudvMap;
 layout(set = 1, binding = 3) uniform sampler2D causticTex; // Used for ray noise
 layout(set = 1, binding = 0) uniform sampler2D refractionTex; // The Scene Background
+layout(set = 1, binding = 10) uniform sampler3D froxelVolume; // Light scattered in front of each froxel (FroxelVolume.h)
 
-// Push Constants - using existing fields efficiently
-// debugRays: 0=off, 1=rays, 2=snow, 3=both, 4+=chromatic debug
+// Specialization constants (WaterVariant in WaterPipeline.h): one pipeline per mode and debug view;
+// -1 (WaterVariant::kRuntime) reads the push constant instead
+layout(constant_id = 0) const int RENDERING_MODE = 1; // 0=BL, 1=PB, 2=OPT
+layout(constant_id = 1) const int DEBUG_VIEW = 0;     // 0=off, 1=rays, 2=snow, 3=both, 4=chromatic
+
+// WaterParams (WaterParamsBuffer.h): the tuning, rewritten only when the UI changes it.
+// The underwater block uses existing fields efficiently:
 // scatteringIntensity: repurposed lower bits for marine snow intensity
 // ambient: repurposed for chromatic aberration strength
 // shininess: repurposed for marine snow size
+struct WaterParamBlock {
+    vec4 baseColor; vec4 lightColor;
+    float ambient; float shininess; float causticIntensity; float distortionStrength;
+    float godRayIntensity; float scatteringIntensity; float opacity; float fogDensity;
+    float godExposure; float godDecay; float godDensity; float godSampleScale;
+    float causticMapScale; // 1 / world units the computed caustics map covers, 0: static texture (OceanCaustics.h)
+    float froxelNear; float froxelDepthScale; // Underwater fog from the froxel volume (FroxelVolume.h); depth scale 0: analytic fog
+    float snowParticles; // Non-zero: marine snow is drawn as particles (MarineSnow.h)
+    float waterlineHeight; float sceneFog; // Surface height at the camera; non-zero: the scene is drawn in the water
+};
+layout(std140, set = 1, binding = 7) uniform WaterParams { WaterParamBlock surface; WaterParamBlock underwater; } water;
+
+// Push Constants - per-draw values only
+// debugRays, renderingMode: read only by the kRuntime variant
 layout(push_constant) uniform WaterPush {
     float time; float scale; float debugRays; float renderingMode; // 0=BL, 1=PB, 2=OPT
-    vec4 baseColor; vec4 lightColor; 
-    float ambient; float shininess; float causticIntensity; 
-    float distortionStrength; float godRayIntensity; float scatteringIntensity; 
-    float opacity; float fogDensity;
-    float godExposure; float godDecay; float godDensity; float godSampleScale;
 } pc;
 
-// Extract packed values from push constants
-float getMarineSnowIntensity() { return pc.scatteringIntensity; }
-float getMarineSnowSize() { return max(0.5, pc.shininess * 0.01); } // shininess/100 for reasonable range
-float getChromaticStrength() { return pc.ambient; }  // ambient repurposed for CA
-bool isSnowDebugOn() { return pc.debugRays >= 2.0 && pc.debugRays < 4.0; }
-bool isChromaticDebugOn() { return pc.debugRays >= 4.0; }
+// Extract packed values from the push constants and the underwater block
+int getRenderingMode() { return RENDERING_MODE >= 0 ? RENDERING_MODE : int(pc.renderingMode); }
+int getDebugView() { return DEBUG_VIEW >= 0 ? DEBUG_VIEW : min(int(pc.debugRays), 4); }
+float getMarineSnowIntensity() { return water.underwater.scatteringIntensity; }
+float getMarineSnowSize() { return max(0.5, water.underwater.shininess * 0.01); } // shininess/100 for reasonable range
+float getChromaticStrength() { return water.underwater.ambient; }  // ambient repurposed for CA
+bool isSnowDebugOn() { return getDebugView() == 2 || getDebugView() == 3; }
+bool isChromaticDebugOn() { return getDebugView() >= 4; }
 
 // ============================================================================
 // MARINE SNOW - Suspended particulates for scale reference
 // Without particles, viewer can't tell if scene is bathtub or ocean
 // ============================================================================
+#define SNOW_DEPTH 4.0 // World units: where marine snow is lit from in the froxel volume
+
 float quickHash(vec2 p) {
     return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453);
 }
@@ -100,7 +122,7 @@ void main() {
     }
 
     // Performance optimizations based on rendering mode
-    int renderMode = int(pc.renderingMode);
+    int renderMode = getRenderingMode();
     int samples;
     float qualityScale;
     
@@ -120,8 +142,9 @@ void main() {
     vec3 SUN_POS = ubo.lightPos.xyz;
     if (length(SUN_POS) < 0.1) SUN_POS = vec3(0.0, 100.0, -10.0);
 
-    // Project sun to screen space
-    vec4 sunClip = ubo.proj * ubo.view * vec4(SUN_POS, 1.0);
+    // Project sun to screen space, this eye's in a stereo pass
+    mat4 viewProj = ubo.views.x > 1u ? ubo.eyeViewProj[gl_ViewIndex] : ubo.proj * ubo.view;
+    vec4 sunClip = viewProj * vec4(SUN_POS, 1.0);
     vec2 sunScreen = sunClip.xy / sunClip.w * 0.5 + 0.5;
     
     // Check if sun is roughly in front of camera (FIXED: allow negative W for underwater sun above)
@@ -134,9 +157,9 @@ void main() {
     float distToSun = length(toSun);
     
     // Ray Marching Settings
-    float density = max(0.5, pc.godDensity * qualityScale);
-    float decay = clamp(pc.godDecay, 0.85, 0.99); 
-    float exposure = max(0.2, pc.godExposure * qualityScale);
+    float density = max(0.5, water.underwater.godDensity * qualityScale);
+    float decay = clamp(water.underwater.godDecay, 0.85, 0.99); 
+    float exposure = max(0.2, water.underwater.godExposure * qualityScale);
 
     vec2 rayStep = toSun / float(samples) * density;
     
@@ -148,10 +171,14 @@ void main() {
     float illum = 1.0;
     vec2 sampleUV = vScreenUV;
 
-    float stepScale = pc.godSampleScale;
+    float stepScale = water.underwater.godSampleScale;
+
+    // The froxel volume already holds the shafts (FroxelVolume.h): no march
+    bool froxelFog = water.underwater.froxelDepthScale > 0.0;
+    int marchSamples = froxelFog ? 0 : samples;
 
     // OPTIMIZED LOOP - single interference call per sample
-    for (int i = 0; i < samples; ++i) {
+    for (int i = 0; i < marchSamples; ++i) {
         sampleUV += rayStep * stepScale;
         vec2 clampedUV = clamp(sampleUV, vec2(0.001), vec2(0.999));
         
@@ -163,10 +190,10 @@ void main() {
         illum *= decay; 
     }
     
-    vec3 godRays = (accum / float(samples)) * exposure * pc.godRayIntensity * sunFacing * sunAboveWater;
+    vec3 godRays = (accum / float(samples)) * exposure * water.underwater.godRayIntensity * sunFacing * sunAboveWater;
     
     // Attenuate rays by fog (but not too aggressively)
-    float raysFog = exp(-pc.fogDensity * distToSun);
+    float raysFog = exp(-water.underwater.fogDensity * distToSun);
     godRays *= raysFog;
     
     // =========================================================================
@@ -199,12 +226,18 @@ void main() {
     float snowSize = getMarineSnowSize();
     
     vec3 snowColor = vec3(0.0);
-    if (snowIntensity > 0.01 && renderMode >= 1) {
+    if (snowIntensity > 0.01 && renderMode >= 1 && water.underwater.snowParticles == 0.0) {
         // Layered marine snow with controllable size
         float snow = marineSnowLayered(vScreenUV, pc.time, snowSize, 1.0);
         
         // Particles are illuminated by god rays (catch the light)
         float rayIllumination = length(godRays) * 2.0 + 0.1;
+        if (froxelFog) {
+            // The light scattered over the first few metres along this pixel; the volume's y points up
+            float slice = log(SNOW_DEPTH / water.underwater.froxelNear) * water.underwater.froxelDepthScale;
+            vec3 shaft = textureLod(froxelVolume, vec3(vScreenUV.x, 1.0 - vScreenUV.y, slice), 0.0).rgb;
+            rayIllumination = length(shaft) * 2.0 + 0.1;
+        }
         snow *= rayIllumination * snowIntensity * qualityScale;
         
         // Depth-based density (more particles visible deeper)
@@ -224,7 +257,7 @@ void main() {
     vec3 finalRays = godRays + snowColor;
     
     // DEBUG MODE: Show purple outline where rays exist
-    if (pc.debugRays > 0.5 && pc.debugRays < 2.0) {
+    if (getDebugView() == 1) {
         float rayPresence = length(godRays);
         // Purple outline for ray presence
         vec3 debugColor = vec3(0.8, 0.2, 1.0) * rayPresence * 2.0;
@@ -0,0 +1,28 @@
+#version 450
+#extension GL_EXT_fragment_shading_rate : require
+
+// sunrays.vert as one quad per 16x16 screen tile, each shaded at the rate VariableRateShading
+// chose for it: instance i covers tile i, row by row
+layout(location = 0) out vec2 vScreenUV;
+
+layout(std430, set = 1, binding = 11) readonly buffer ShadingRates {
+    uvec4 grid;   // xy: tiles, zw: pixels
+    uint rates[];
+} shadingRates;
+
+const vec2 CORNERS[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+                               vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+void main() {
+    uint index = uint(gl_InstanceIndex);
+    uvec2 tile = uvec2(index % shadingRates.grid.x, index / shadingRates.grid.x);
+
+    // Edges from whole pixels, so neighbouring tiles meet exactly and nothing is added twice
+    uvec2 tileMin = tile * 16u;
+    uvec2 tileMax = min(tileMin + 16u, shadingRates.grid.zw);
+    vec2 uv = mix(vec2(tileMin), vec2(tileMax), CORNERS[gl_VertexIndex]) / vec2(shadingRates.grid.zw);
+    vScreenUV = uv;
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+
+    gl_PrimitiveShadingRateEXT = int(shadingRates.rates[index]);
+}
@@ -0,0 +1,13 @@
+#version 450
+
+// Resolved underwater effects over the scene; premultiplied (blend ONE, ONE_MINUS_SRC_ALPHA)
+
+layout(location = 0) in vec2 vScreenUV;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D resolvedTex;
+
+void main() {
+    outColor = texture(resolvedTex, vScreenUV);
+}
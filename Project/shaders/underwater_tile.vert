@@ -0,0 +1,15 @@
+#version 450
+
+// Underwater fog over the tiles TileClassifier listed for one class: one quad per instance.
+layout(location = 0) in vec4 inRect; // Per instance: UV min.xy, max.zw
+
+layout(location = 0) out vec2 vScreenUV;
+
+const vec2 CORNERS[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+                               vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+void main() {
+    vec2 uv = mix(inRect.xy, inRect.zw, CORNERS[gl_VertexIndex]);
+    vScreenUV = uv;
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
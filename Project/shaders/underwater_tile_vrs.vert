@@ -0,0 +1,25 @@
+#version 450
+#extension GL_EXT_fragment_shading_rate : require
+
+// underwater_tile.vert, each tile shaded at the rate VariableRateShading chose for it
+layout(location = 0) in vec4 inRect; // Per instance: UV min.xy, max.zw
+
+layout(location = 0) out vec2 vScreenUV;
+
+layout(std430, set = 1, binding = 11) readonly buffer ShadingRates {
+    uvec4 grid;   // xy: tiles, zw: pixels
+    uint rates[];
+} shadingRates;
+
+const vec2 CORNERS[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+                               vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+void main() {
+    vec2 uv = mix(inRect.xy, inRect.zw, CORNERS[gl_VertexIndex]);
+    vScreenUV = uv;
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+
+    // The rect's corner is a whole pixel (tile_classify.comp) on the same 16-pixel grid
+    uvec2 tile = uvec2(round(inRect.xy * vec2(shadingRates.grid.zw))) / 16u;
+    gl_PrimitiveShadingRateEXT = int(shadingRates.rates[tile.y * shadingRates.grid.x + tile.x]);
+}
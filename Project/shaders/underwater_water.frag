@@ -11,22 +11,43 @@ layout(std140, set = 0, binding = 0) uniform UBO {
 // Underwater volumetric pass: fog/scattering only (fullscreen)
 layout(set = 1, binding = 3) uniform sampler2D causticTex;
 
+// Specialization constants (WaterVariant in WaterPipeline.h): one pipeline per mode and debug view;
+// -1 (WaterVariant::kRuntime) reads the push constant instead
+layout(constant_id = 0) const int RENDERING_MODE = 1; // 0=BL, 1=PB, 2=OPT
+layout(constant_id = 1) const int DEBUG_VIEW = 0;     // 0=off, 1=rays, 2=snow, 3=both, 4=chromatic
+// Tiled draws (TileClassifier.h): 0=full screen, 1=tiles across the horizon band or the waterline, 2=tiles below both
+layout(constant_id = 2) const int TILE_CLASS = 0;
+
+const float CAMERA_NEAR = 0.1;     // VulkanBase::kCameraNear
+const float WATERLINE_EDGE = 0.01; // TileClassifier::kWaterlineEdge: half the width of the fog's edge at the waterline
+
+// WaterParams (WaterParamsBuffer.h): the tuning, rewritten only when the UI changes it
+struct WaterParamBlock {
+    vec4 baseColor; vec4 lightColor;
+    float ambient; float shininess; float causticIntensity; float distortionStrength;
+    float godRayIntensity; float scatteringIntensity; float opacity; float fogDensity;
+    float godExposure; float godDecay; float godDensity; float godSampleScale;
+    float causticMapScale; // 1 / world units the computed caustics map covers, 0: static texture (OceanCaustics.h)
+    float froxelNear; float froxelDepthScale; // Underwater fog from the froxel volume (FroxelVolume.h); depth scale 0: analytic fog
+    float snowParticles; // Non-zero: marine snow is drawn as particles (MarineSnow.h)
+    float waterlineHeight; float sceneFog; // Surface height at the camera; non-zero: the scene is drawn in the water
+};
+layout(std140, set = 1, binding = 7) uniform WaterParams { WaterParamBlock surface; WaterParamBlock underwater; } water;
+
+// debugRays, renderingMode: read only by the kRuntime variant
 layout(push_constant) uniform WaterPush {
     float time; 
     float scale; 
     float debugRays; 
     float renderingMode; // 0=BL, 1=PB, 2=OPT
-    vec4 baseColor; vec4 lightColor; 
-    float ambient; float shininess; float causticIntensity; 
-    float distortionStrength; float godRayIntensity; float scatteringIntensity; 
-    float opacity; float fogDensity; 
-    float godExposure; float godDecay; float godDensity; float godSampleScale; 
 } pc;
 
-// Extract packed values from push constants (same encoding as sunrays.frag)
-float getMarineSnowIntensity() { return pc.scatteringIntensity; }
-float getMarineSnowSize() { return max(0.5, pc.shininess * 0.01); }
-bool isSnowDebugOn() { return pc.debugRays >= 2.0 && pc.debugRays < 4.0; }
+// Extract packed values from the push constants and the underwater block (same encoding as sunrays.frag)
+int getRenderingMode() { return RENDERING_MODE >= 0 ? RENDERING_MODE : int(pc.renderingMode); }
+int getDebugView() { return DEBUG_VIEW >= 0 ? DEBUG_VIEW : min(int(pc.debugRays), 4); }
+float getMarineSnowIntensity() { return water.underwater.scatteringIntensity; }
+float getMarineSnowSize() { return max(0.5, water.underwater.shininess * 0.01); }
+bool isSnowDebugOn() { return getDebugView() == 2 || getDebugView() == 3; }
 
 // ============================================================================
 // MARINE SNOW - Multi-layer particles for scale reference
@@ -67,15 +88,24 @@ float scatteringInterferenceFast(vec2 uv, float phase, float frequency) {
 }
 
 void main() {
-    const float waterHeight = 0.0; // TODO: wire from CPU
-    bool cameraUnderwater = (ubo.viewPos.y < waterHeight);
-    if (!cameraUnderwater) {
+    // Compute world ray direction for this pixel to create a "cut" at the horizon.
+    vec2 ndc = vScreenUV * 2.0 - 1.0;
+    vec4 viewRay = inverse(ubo.proj) * vec4(ndc, 1.0, 1.0);
+    vec3 viewDirVS = normalize(viewRay.xyz / max(viewRay.w, 1e-6));
+    vec3 rayDirWS = normalize((inverse(ubo.view) * vec4(viewDirVS, 0.0)).xyz);
+
+    // The pixel is in the water where its ray leaves the near plane below the surface: a camera
+    // across the waterline fogs only the lower part of the screen (TileClassifier.h)
+    float waterHeight = water.underwater.waterlineHeight;
+    float nearHeight = ubo.viewPos.y + rayDirWS.y * CAMERA_NEAR / max(-viewDirVS.z, 1e-3);
+    float waterlineMask = TILE_CLASS == 2 ? 1.0 : smoothstep(WATERLINE_EDGE, -WATERLINE_EDGE, nearHeight - waterHeight);
+    if (waterlineMask <= 0.0) {
         outColor = vec4(0.0);
         return;
     }
 
     // Performance optimizations based on rendering mode
-    int renderMode = int(pc.renderingMode);
+    int renderMode = getRenderingMode();
     float qualityScale = 1.0;
     bool useAdvancedScattering = true;
     bool useWavelengthDependent = true;
@@ -97,38 +127,33 @@ void main() {
         useWavelengthDependent = true;
     }
 
-    // Compute world ray direction for this pixel to create a "cut" at the horizon.
-    vec2 ndc = vScreenUV * 2.0 - 1.0;
-    vec4 viewRay = inverse(ubo.proj) * vec4(ndc, 1.0, 1.0);
-    vec3 viewDirVS = normalize(viewRay.xyz / max(viewRay.w, 1e-6));
-    vec3 rayDirWS = normalize((inverse(ubo.view) * vec4(viewDirVS, 0.0)).xyz);
-
     // Hard cut above the water surface: this pass must NOT cover the surface/sky.
     // (The water surface shader handles the "looking up" case.)
-    float horizonMask = smoothstep(0.00, -0.08, rayDirWS.y);
+    // Tiles wholly below the band were classified as fully unmasked
+    float horizonMask = TILE_CLASS == 2 ? 1.0 : smoothstep(0.00, -0.08, rayDirWS.y);
 
-    // Depth below water surface at camera; cheap approximation for fog thickness.
-    float depthBelow = max(0.0, waterHeight - ubo.viewPos.y);
+    // Depth below water surface where the ray enters it; cheap approximation for fog thickness.
+    float depthBelow = max(0.0, waterHeight - nearHeight);
     float fogDist = depthBelow / max(0.18, -rayDirWS.y);
 
-    vec3 shallowColor = pc.baseColor.rgb;
-    vec3 deepColor = pc.lightColor.rgb;
+    vec3 shallowColor = water.underwater.baseColor.rgb;
+    vec3 deepColor = water.underwater.lightColor.rgb;
     vec3 fogColor = mix(deepColor, shallowColor, 0.35);
 
     // Different absorption models based on rendering mode
     vec3 transmittance;
     if (useWavelengthDependent) {
         // Beer–Lambert wavelength absorption: R absorbed fastest, G medium, B slowest
-        vec3 sigma = vec3(0.18, 0.07, 0.03) * max(0.0, pc.fogDensity) * qualityScale;
+        vec3 sigma = vec3(0.18, 0.07, 0.03) * max(0.0, water.underwater.fogDensity) * qualityScale;
         transmittance = exp(-sigma * fogDist);
     } else {
         // Simple uniform absorption for baseline
-        float sigma = 0.08 * max(0.0, pc.fogDensity);
+        float sigma = 0.08 * max(0.0, water.underwater.fogDensity);
         transmittance = vec3(exp(-sigma * fogDist));
     }
 
     // Fog amount used for alpha blending; keep subtle and let surface remain visible.
-    float fogAmount = (1.0 - max(transmittance.r, max(transmittance.g, transmittance.b))) * horizonMask;
+    float fogAmount = (1.0 - max(transmittance.r, max(transmittance.g, transmittance.b))) * horizonMask * waterlineMask;
 
     // Vertical light falloff (darker with depth)
     float depthFalloff = exp(-0.06 * depthBelow * qualityScale);
@@ -150,17 +175,17 @@ void main() {
         float noise = scatteringInterferenceFast(vScreenUV, phase, frequency);
         
         // Multi-scattering approximation
-        float scatter = pc.scatteringIntensity * max(0.0, dot(-rayDirWS, SUN_DIR)) * (0.6 + 0.4 * noise);
+        float scatter = water.underwater.scatteringIntensity * max(0.0, dot(-rayDirWS, SUN_DIR)) * (0.6 + 0.4 * noise);
         if (renderMode == 1) {
             // Rayleigh scattering for PB mode
             float rayleighPhase = 0.75 * (1.0 + dot(-rayDirWS, SUN_DIR) * dot(-rayDirWS, SUN_DIR));
-            scatter += rayleighPhase * 0.3 * pc.scatteringIntensity;
+            scatter += rayleighPhase * 0.3 * water.underwater.scatteringIntensity;
         }
         
         scatterCol = fogColor * scatter * fogAmount * qualityScale;
     } else {
         // Simple scattering for baseline mode
-        float scatter = pc.scatteringIntensity * 0.3;
+        float scatter = water.underwater.scatteringIntensity * 0.3;
         scatterCol = fogColor * scatter * fogAmount;
     }
 
@@ -173,7 +198,7 @@ void main() {
     float snowIntensity = getMarineSnowIntensity();
     float snowSize = getMarineSnowSize();
     
-    if (snowIntensity > 0.01 && renderMode >= 1) {
+    if (snowIntensity > 0.01 && renderMode >= 1 && water.underwater.snowParticles == 0.0) {
         float snow = marineSnowLayered(vScreenUV, pc.time, snowSize);
         
         // Visible in foggy areas
@@ -188,10 +213,10 @@ void main() {
             snowColor = vec3(0.0, 1.0, 0.3) * snowAmount * 4.0;
         }
         
-        finalColor += snowColor;
+        finalColor += snowColor * waterlineMask;
     }
 
     // Use user-controlled opacity to avoid full-screen solid fill
-    float alpha = clamp(fogAmount, 0.0, 1.0) * clamp(pc.opacity, 0.0, 1.0);
+    float alpha = clamp(fogAmount, 0.0, 1.0) * clamp(water.underwater.opacity, 0.0, 1.0);
     outColor = vec4(finalColor, alpha);
 }
\ No newline at end of file
@@ -1,12 +1,20 @@
 #version 450
+#extension GL_EXT_multiview : require
+#ifdef RAY_QUERY
+#extension GL_EXT_ray_query : require
+#endif
 
 layout(location = 0) in vec3 vWorldPos;
 layout(location = 1) in vec3 vNormal;
 layout(location = 2) in vec2 vUV;
 layout(location = 3) in vec2 vScreenUV;
+layout(location = 4) in vec2 vOceanUV;
 
 layout(location = 0) out vec4 outColor;
 
+// No discard or depth writes: hidden surface never reaches the shading below
+layout(early_fragment_tests) in;
+
 // GLOBAL UBO (set=0 binding=0) - same as vert
 layout(std140, set = 0, binding = 0) uniform UBO {
     mat4 model;
@@ -15,13 +23,23 @@ layout(std140, set = 0, binding = 0) uniform UBO {
     // match C++ UBO (lightPos, viewPos) — use vec4 in std140 for proper alignment
     vec4 lightPos;
     vec4 viewPos;
+    vec4 offscreenScale; // x: reflection/refraction were rendered into this fraction of their targets,
+                         // y: 1 to trace reflections in screen space instead of sampling reflectionTex
+                         // z: 1 to trace the scene instead of sampling either target (RAY_QUERY)
+    vec4 ocean;          // x: 1 / ocean patch size, y: displacement mip for the water grid
+    vec4 viewport;
+    mat4 offscreenViewProj; // Camera the reflection/refraction targets were rendered with, maybe frames ago
+    uvec4 material;
+    uvec4 views; // x: 2 in a stereo pass (Multiview.h)
+    mat4 eyeViewProj[2]; // Per view of a stereo pass, by gl_ViewIndex
+    vec4 eyePos[2];
 } ubo;
 
 // Explicit uniforms per requirements (aliased to existing UBO data where possible)
-// NOTE: `cameraPosition` is sourced from `ubo.viewPos.xyz`.
+// NOTE: `cameraPosition` is sourced from `ubo.viewPos.xyz`, or this view's eye in a stereo pass (Multiview.h).
 //       `waterHeight` is currently a constant; wire from CPU when available.
 const float u_waterHeight_const = 0.0; // TODO: replace with uniform when descriptor is wired
-vec3 cameraPosition() { return ubo.viewPos.xyz; }
+vec3 cameraPosition() { return ubo.views.x > 1u ? ubo.eyePos[gl_ViewIndex].xyz : ubo.viewPos.xyz; }
 float waterHeight() { return u_waterHeight_const; }
 
 // WATER-SPECIFIC TEXTURES in set 1
@@ -30,44 +48,252 @@ layout(set = 1, binding = 1) uniform sampler2D waterNormalMap; // normal map (ti
 layout(set = 1, binding = 2) uniform sampler2D waterDudvMap;   // dudv/distortion map (animated)
 layout(set = 1, binding = 3) uniform sampler2D causticTex;     // optional (caustic map)
 layout(set = 1, binding = 4) uniform sampler2D reflectionTex;   // Reflection (what's above)
+layout(set = 1, binding = 6) uniform sampler2D oceanNormalFoam; // FFT ocean: xyz normal, w foam (OceanFFT.h)
+layout(set = 1, binding = 8) uniform sampler2D ssrPyramid;      // Nearest refraction depth per mip (ScreenSpaceReflections.h)
+layout(set = 1, binding = 9) uniform sampler2D causticsMap;     // Traced caustics, 1 = flat water (OceanCaustics.h)
+layout(set = 1, binding = 10) uniform sampler3D froxelVolume;   // Underwater fog, in front of each froxel (FroxelVolume.h)
+
+// What screen-space reflections fall back to (ImageBasedLighting.h)
+layout(set = 0, binding = 8) uniform samplerCube prefilteredSky;
+
+// Tangent-space normal from .rg alone, so a two-channel (BC5) cook samples like the RGBA source; both are
+// UNORM (loadTexture's TwoChannel), so .rg * 2 - 1 is the stored x and y, not their sRGB decode
+vec3 sampleWaterNormal(vec2 uv) {
+    vec2 xy = texture(waterNormalMap, uv).rg * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
 
-// push constant layout must match pipeline (64 bytes total)
+// Specialization constant (WaterVariant in WaterPipeline.h): one pipeline per mode;
+// -1 (WaterVariant::kRuntime) reads the push constant instead
+layout(constant_id = 0) const int RENDERING_MODE = 1; // 0=BL, 1=PB, 2=OPT
+
+// WaterParams (WaterParamsBuffer.h): the tuning, rewritten only when the UI changes it
+struct WaterParamBlock {
+    vec4 baseColor; vec4 lightColor;
+    float ambient; float shininess; float causticIntensity; float distortionStrength;
+    float godRayIntensity; float scatteringIntensity; float opacity; float fogDensity;
+    float godExposure; float godDecay; float godDensity; float godSampleScale;
+    float causticMapScale; // 1 / world units the computed caustics map covers, 0: static texture (OceanCaustics.h)
+    float froxelNear; float froxelDepthScale; // Underwater fog from the froxel volume (FroxelVolume.h); depth scale 0: analytic fog
+    float snowParticles; // Non-zero: marine snow is drawn as particles (MarineSnow.h)
+    float waterlineHeight; float sceneFog; // Surface height at the camera; non-zero: the scene is drawn in the water
+};
+layout(std140, set = 1, binding = 7) uniform WaterParams { WaterParamBlock surface; WaterParamBlock underwater; } water;
+
+// Point lights (ClusteredLights.h), mirrors 3d_shader.frag: the sun is unused here
+struct Light { vec3 position; vec3 color; float intensity; };
+layout(std140, set = 0, binding = 2) uniform LightInfo {
+    Light sun; vec3 viewPos; vec3 ambientColor; float ambientIntensity;
+    mat4 clusterView;       // Main camera
+    vec4 clusterProjection; // x, y: view to NDC scale, z: grid near, w: slices / log(far / near)
+    uvec4 clusterInfo;      // x: light count, y: first light, z: first cluster word, w: 1 if clustered
+} lightInfo;
+#define CLUSTER_TILES_X 16u
+#define CLUSTER_TILES_Y 9u
+#define CLUSTER_SLICES 24u
+#define CLUSTER_STRIDE 128u
+struct PointLight { vec4 positionRadius; vec4 colorIntensity; };
+layout(std430, set = 0, binding = 10) readonly buffer PointLights { PointLight pointLights[]; };
+layout(std430, set = 0, binding = 11) readonly buffer LightClusters { uint clusterWords[]; };
+
+// push constant layout must match pipeline (16 bytes total); renderingMode is read only by the kRuntime variant
 layout(push_constant) uniform WaterPush {
     float time;
     float scale;
     float debugRays;
     float renderingMode; // 0=BL, 1=PB, 2=OPT
-    vec4 baseColor;     // RGB color + alpha padding
-    vec4 lightColor;    // RGB color + alpha padding
-    float ambient;
-    float shininess;
-    float causticIntensity;
-    float distortionStrength;
-    float godRayIntensity;
-    float scatteringIntensity;
-    float opacity;
-    float fogDensity;
-    float godExposure;
-    float godDecay;
-    float godDensity;
-    float godSampleScale;
 } pc;
 
+int getRenderingMode() { return RENDERING_MODE >= 0 ? RENDERING_MODE : int(pc.renderingMode); }
+
+// Screen UV in [0,1] to the rendered corner of the reflection/refraction targets, kept half a
+// texel inside it so filtering never reads the unrendered border (dynamic resolution)
+vec2 offscreenUV(vec2 uv) {
+    float s = ubo.offscreenScale.x;
+    vec2 halfTexel = 0.5 / vec2(textureSize(refractionTex, 0));
+    return min(uv * s, vec2(s) - halfTexel);
+}
+
+// Screen UV a surface point had when the reflection/refraction targets were rendered: the current
+// one unless they are being reused (OffscreenThrottle.h), when this keeps the old image on the water
+vec2 offscreenScreenUV(vec3 worldPos) {
+    vec4 clip = ubo.offscreenViewProj * vec4(worldPos, 1.0);
+    return clip.xy / clip.w * 0.5 + 0.5;
+}
+
+// Screen-space reflections (ScreenSpaceReflections.h)
+#define SSR_MAX_STEPS 64
+const float SSR_MAX_DISTANCE = 300.0; // View-space length of the traced ray
+const float SSR_THICKNESS = 1.5;      // How far behind a surface the ray may be and still hit it
+
+// Ray parameter at which start + t * delta leaves the pyramid texel holding p, at a level of levelSize
+// texels; nudge carries it a fraction of a level-0 texel past the crossed edge
+float ssrCellExit(vec3 start, vec3 delta, vec2 p, vec2 levelSize, vec2 nudge) {
+    vec2 boundary = (floor(p * levelSize) + step(0.0, delta.xy)) / levelSize + nudge;
+    float tx = delta.x != 0.0 ? (boundary.x - start.x) / delta.x : 1e30;
+    float ty = delta.y != 0.0 ? (boundary.y - start.y) / delta.y : 1e30;
+    return min(tx, ty);
+}
+
+// View distance of a depth-buffer value, as the god-ray upsample linearises it
+float ssrViewDistance(float depth) {
+    return ubo.proj[3][2] / (depth + ubo.proj[2][2]);
+}
+
+// Reflection of the scene the refraction pass rendered: the reflected ray is marched in screen space,
+// where its depth is linear, over the nearest-depth pyramid. A texel whose nearest surface lies behind
+// the ray is crossed in one step and the next step looks one level coarser; otherwise the march
+// descends. The sky fills in where the ray leaves the screen, passes behind everything or runs out.
+vec3 screenSpaceReflection(vec3 worldPos, vec3 n, vec3 v) {
+    vec3 r = reflect(-v, n);
+    vec3 sky = textureLod(prefilteredSky, r, 0.0).rgb;
+
+    // Traced from the camera the refraction pass was rendered with; clip w is the view distance
+    vec4 startClip = ubo.offscreenViewProj * vec4(worldPos, 1.0);
+    vec4 endClip = ubo.offscreenViewProj * vec4(worldPos + r * SSR_MAX_DISTANCE, 1.0);
+    float towardsCamera = (startClip.w - endClip.w) / SSR_MAX_DISTANCE;
+    // Towards the camera the ray stops short of the near plane (0.1) so its end projects
+    if (endClip.w < 0.2) {
+        if (startClip.w <= 0.2)
+            return sky;
+        endClip = mix(startClip, endClip, (startClip.w - 0.2) / (startClip.w - endClip.w));
+    }
+
+    // Target uv (the rendered corner under dynamic resolution) and depth of both ends
+    float s = ubo.offscreenScale.x;
+    vec3 start = vec3((startClip.xy / startClip.w * 0.5 + 0.5) * s, startClip.z / startClip.w);
+    vec3 end = vec3((endClip.xy / endClip.w * 0.5 + 0.5) * s, endClip.z / endClip.w);
+    vec3 delta = end - start;
+
+    vec2 baseSize = vec2(textureSize(ssrPyramid, 0));
+    int maxLevel = textureQueryLevels(ssrPyramid) - 1;
+    vec2 nudge = sign(delta.xy) * 0.25 / baseSize;
+
+    // From the next texel: the water's own one holds what lies below it
+    float t = ssrCellExit(start, delta, start.xy, baseSize, nudge);
+    int level = 0;
+    bool hit = false;
+    for (int i = 0; i < SSR_MAX_STEPS && t < 1.0; i++) {
+        vec3 p = start + delta * t;
+        if (any(lessThan(p.xy, vec2(0.0))) || any(greaterThan(p.xy, vec2(s))))
+            break;
+
+        float cellDepth = textureLod(ssrPyramid, p.xy, float(level)).r;
+        float tExit = min(ssrCellExit(start, delta, p.xy, vec2(textureSize(ssrPyramid, level)), nudge), 1.0);
+        float exitDepth = start.z + delta.z * tExit;
+
+        if (max(p.z, exitDepth) < cellDepth) {
+            // In front of everything in the texel all the way across
+            t = tExit;
+            level = min(level + 1, maxLevel);
+            continue;
+        }
+
+        // The ray reaches the texel's nearest depth inside it: move to where it does
+        bool crosses = p.z < cellDepth;
+        if (crosses)
+            t = (cellDepth - start.z) / delta.z;
+        if (level > 0) {
+            level--;
+            continue;
+        }
+
+        // Level 0: a hit unless the ray was already well behind the surface (passing behind an object)
+        if (crosses || ssrViewDistance(p.z) - ssrViewDistance(cellDepth) < SSR_THICKNESS) {
+            hit = true;
+            break;
+        }
+        t = tExit;
+    }
+    if (!hit)
+        return sky;
+
+    vec2 hitUV = (start + delta * t).xy;
+    vec2 halfTexel = 0.5 / vec2(textureSize(refractionTex, 0));
+    vec3 hitColor = textureLod(refractionTex, clamp(hitUV, halfTexel, vec2(s) - halfTexel), 0.0).rgb;
+
+    // Faded into the sky towards the screen edges, the end of the ray and rays coming back at the camera
+    vec2 screenUV = hitUV / s;
+    float edgeFade = smoothstep(0.0, 0.08, min(min(screenUV.x, screenUV.y), min(1.0 - screenUV.x, 1.0 - screenUV.y)));
+    float distanceFade = 1.0 - smoothstep(0.8, 1.0, t);
+    float facingFade = 1.0 - smoothstep(0.2, 0.6, towardsCamera);
+    return mix(sky, hitColor, edgeFade * distanceFade * facingFade);
+}
+
 // Water properties for photorealistic rendering
 const float R_0 = 0.02; // Schlick's approximation base reflectivity for water
 const vec3 DEEP_WATER_COLOR = vec3(0.05, 0.2, 0.4); // Deep, darker blue
 const vec3 SHALLOW_WATER_COLOR = vec3(0.2, 0.5, 0.8); // Lighter blue-green
 
+#ifdef RAY_QUERY
+// Ray-traced reflections and refractions (RayQueryScene.h): water_rq.frag.spv is this shader built with
+// RAY_QUERY. A hit is lit like 3d_shader.frag lights its objects, from the material's base colour and the
+// interpolated vertex normal, with the sky's coarsest level standing in for its irradiance and no shadow
+struct RayObject { vec4 baseColor; uint firstIndex; int vertexOffset; uvec2 pad; };
+layout(set = 1, binding = 12) uniform accelerationStructureEXT sceneTlas;
+layout(std430, set = 1, binding = 13) readonly buffer RayObjects { RayObject rayObjects[]; };
+layout(std430, set = 1, binding = 14) readonly buffer SceneVertices { uvec4 sceneVertices[]; }; // PackedVertex
+layout(std430, set = 1, binding = 15) readonly buffer SceneIndices { uint sceneIndices[]; };
+
+#define RAY_MAX_DISTANCE 500.0
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// The lit scene along a ray, or 'missColor'; hitDistance is RAY_MAX_DISTANCE on a miss
+vec3 traceScene(vec3 origin, vec3 dir, vec3 missColor, out float hitDistance) {
+    rayQueryEXT query;
+    rayQueryInitializeEXT(query, sceneTlas, gl_RayFlagsOpaqueEXT, 0xFF, origin, 0.01, dir, RAY_MAX_DISTANCE);
+    while (rayQueryProceedEXT(query)) {}
+    if (rayQueryGetIntersectionTypeEXT(query, true) != gl_RayQueryCommittedIntersectionTriangleEXT) {
+        hitDistance = RAY_MAX_DISTANCE;
+        return missColor;
+    }
+    hitDistance = rayQueryGetIntersectionTEXT(query, true);
+
+    RayObject object = rayObjects[rayQueryGetIntersectionInstanceCustomIndexEXT(query, true)];
+    uint first = object.firstIndex + 3u * uint(rayQueryGetIntersectionPrimitiveIndexEXT(query, true));
+    vec2 bary = rayQueryGetIntersectionBarycentricsEXT(query, true);
+    vec3 weights = vec3(1.0 - bary.x - bary.y, bary);
+    vec3 n = vec3(0.0);
+    for (uint i = 0u; i < 3u; i++) {
+        uvec4 v = sceneVertices[int(sceneIndices[first + i]) + object.vertexOffset];
+        n += weights[i] * octDecode(unpackSnorm2x16(v.z));
+    }
+    // Object to world includes the (uniform) dequantisation, like ubo.model in 3d_shader.vert
+    n = normalize(mat3(rayQueryGetIntersectionObjectToWorldEXT(query, true)) * n);
+    n = dot(n, dir) > 0.0 ? -n : n; // Whichever side the ray hit
+
+    vec3 lightPos = lightInfo.sun.position;
+    if (length(lightPos) < 0.1) lightPos = vec3(0.0, 100.0, 0.0);
+    float diff = max(dot(n, normalize(lightPos)), 0.0);
+    vec3 ambient = textureLod(prefilteredSky, n, float(textureQueryLevels(prefilteredSky) - 1)).rgb * lightInfo.ambientColor;
+    return object.baseColor.rgb * (ambient + diff);
+}
+#endif
 
 vec3 getCaustics(vec3 worldPos) {
     // Performance optimization based on rendering mode
-    int renderMode = int(pc.renderingMode);
+    int renderMode = getRenderingMode();
     
     // Skip caustics for baseline mode for performance
     if (renderMode == 0) {
         return vec3(0.0);
     }
     
+    // Mask by height (fade out as we go deeper or above water)
+    float heightMask = clamp((waterHeight() - worldPos.y) * 0.2, 0.0, 1.0);
+
+    // Traced caustics: the focused light above flat water's, the same for every channel
+    if (water.surface.causticMapScale > 0.0) {
+        float focus = max(texture(causticsMap, worldPos.xz * water.surface.causticMapScale).r - 1.0, 0.0);
+        return vec3(focus * 2.0) * water.surface.causticIntensity * heightMask;
+    }
+
     // 1. Project downwards (XZ plane)
     vec2 causticUV = worldPos.xz * 0.5; // Scale texture
     
@@ -87,15 +313,65 @@ vec3 getCaustics(vec3 worldPos) {
         caustics = min(c1, c2) * 2.0;
     }
     
-    // 4. Mask by height (fade out as we go deeper or above water)
-    float heightMask = clamp((waterHeight() - worldPos.y) * 0.2, 0.0, 1.0); 
-    
-    return caustics * pc.causticIntensity * heightMask;
+    return caustics * water.surface.causticIntensity * heightMask;
+}
+
+// Same as 3d_shader.frag: the lights of the fragment's cluster, or every light with clustering off
+vec3 pointLighting(vec3 worldPos, vec3 n, vec3 v, vec3 albedo, float shininess) {
+    uint count = lightInfo.clusterInfo.x;
+    if (count == 0u) return vec3(0.0);
+
+    bool clustered = lightInfo.clusterInfo.w != 0u;
+    uint listStart = 0u;
+    if (clustered) {
+        vec3 viewPos = (lightInfo.clusterView * vec4(worldPos, 1.0)).xyz;
+        float depth = -viewPos.z;
+        vec2 ndc = viewPos.xy / max(depth, 1e-4) * lightInfo.clusterProjection.xy;
+        if (depth <= 0.0 || any(greaterThan(abs(ndc), vec2(1.0)))) return vec3(0.0);
+
+        uvec2 tile = min(uvec2((ndc * 0.5 + 0.5) * vec2(CLUSTER_TILES_X, CLUSTER_TILES_Y)), uvec2(CLUSTER_TILES_X - 1u, CLUSTER_TILES_Y - 1u));
+        float sliceF = log(max(depth, lightInfo.clusterProjection.z) / lightInfo.clusterProjection.z) * lightInfo.clusterProjection.w;
+        uint slice = min(uint(sliceF), CLUSTER_SLICES - 1u);
+        listStart = lightInfo.clusterInfo.z + ((slice * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x) * CLUSTER_STRIDE;
+        count = clusterWords[listStart];
+    }
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < count; i++) {
+        uint index = clustered ? clusterWords[listStart + 1u + i] : i;
+        PointLight light = pointLights[lightInfo.clusterInfo.y + index];
+        vec3 toLight = light.positionRadius.xyz - worldPos;
+        float dist2 = dot(toLight, toLight);
+        float radius2 = light.positionRadius.w * light.positionRadius.w;
+        if (dist2 >= radius2) continue;
+
+        float ratio = dist2 / radius2;
+        float window = 1.0 - ratio * ratio;
+        float attenuation = window * window / (dist2 + 1.0);
+        vec3 l = toLight * inversesqrt(max(dist2, 1e-4));
+        float nDotL = max(dot(n, l), 0.0);
+        float specular = pow(max(dot(n, normalize(l + v)), 0.0), shininess) * nDotL;
+        result += light.colorIntensity.rgb * (light.colorIntensity.w * attenuation) * (albedo * nDotL + vec3(specular));
+    }
+    return result;
+}
+
+// Same as 3d_shader.frag: the froxel volume's fog between the camera and worldPos
+#define FROXEL_SLICES 64.0
+const vec3 FROXEL_ABSORPTION_RATIO = vec3(0.18, 0.07, 0.03) / 0.07;
+vec3 froxelFog(vec3 color, vec3 worldPos) {
+    vec3 viewPos = (lightInfo.clusterView * vec4(worldPos, 1.0)).xyz;
+    float depth = max(-viewPos.z, 1e-4);
+    vec2 uv = viewPos.xy / depth * lightInfo.clusterProjection.xy * 0.5 + 0.5;
+    float near = water.surface.froxelNear;
+    float slice = log(max(depth, near) / near) * water.surface.froxelDepthScale - 0.5 / FROXEL_SLICES;
+    vec4 fog = textureLod(froxelVolume, vec3(uv, slice), 0.0);
+    return color * pow(vec3(clamp(fog.a, 0.0, 1.0)), FROXEL_ABSORPTION_RATIO) + fog.rgb;
 }
 
 void main() {
     // Performance optimizations based on rendering mode
-    int renderMode = int(pc.renderingMode);
+    int renderMode = getRenderingMode();
     float qualityScale = 1.0;
     bool useAdvancedWaves = true;
     bool usePhysicallyBasedReflection = true;
@@ -117,26 +393,29 @@ void main() {
         usePhysicallyBasedReflection = true;
     }
 
-    // Get water color from push constant or use realistic defaults
-    vec3 waterBaseColor = pc.baseColor.rgb;
+    // Get water color from WaterParams or use realistic defaults
+    vec3 waterBaseColor = water.surface.baseColor.rgb;
     if (length(waterBaseColor - vec3(1.0)) < 0.1) {
         waterBaseColor = SHALLOW_WATER_COLOR; // Realistic shallow water
     }
     
-    vec3 waterLightColor = pc.lightColor.rgb;
+    vec3 waterLightColor = water.surface.lightColor.rgb;
     if (length(waterLightColor - vec3(1.0)) < 0.1) {
         waterLightColor = vec3(0.9, 0.95, 1.0); // Nearly white light
     }
     
-    float waterAmbient = pc.ambient;
-    float waterShininess = pc.shininess * qualityScale;
-    float causticIntensity = pc.causticIntensity * qualityScale;
-    float distortionStrength = pc.distortionStrength * (useAdvancedWaves ? 1.0 : 0.5);
+    float waterAmbient = water.surface.ambient;
+    float waterShininess = water.surface.shininess * qualityScale;
+    float causticIntensity = water.surface.causticIntensity * qualityScale;
+    float distortionStrength = water.surface.distortionStrength * (useAdvancedWaves ? 1.0 : 0.5);
 
     // View direction
-    vec3 N = normalize(vNormal); // Base normal (y-up)
+    // Base normal per pixel from the FFT ocean, finer than the grid can displace
+    vec4 oceanSample = texture(oceanNormalFoam, vOceanUV);
+    vec3 N = normalize(oceanSample.xyz);
+    float foam = oceanSample.w;
     // Use actual camera/world position from UBO for correct Fresnel
-    vec3 V = normalize(ubo.viewPos.xyz - vWorldPos); // Vector from fragment to camera
+    vec3 V = normalize(cameraPosition() - vWorldPos); // Vector from fragment to camera
     float VdotN = max(0.01, dot(V, N)); // Clamp to avoid division by zero
 
     // === DYNAMIC WAVE NORMAL PERTURBATION ===
@@ -149,8 +428,8 @@ void main() {
         vec2 wave2_uv = mapUV + vec2(-pc.time * 0.05, pc.time * 0.09) * 0.7;
         
         // Sample and blend two normal maps for more complex waves
-        vec3 normal1 = normalize(texture(waterNormalMap, wave1_uv).rgb * 2.0 - 1.0);
-        vec3 normal2 = normalize(texture(waterNormalMap, wave2_uv * 0.8).rgb * 2.0 - 1.0);
+        vec3 normal1 = normalize(sampleWaterNormal(wave1_uv));
+        vec3 normal2 = normalize(sampleWaterNormal(wave2_uv * 0.8));
         vec3 perturbedNormal = normalize(normal1 + normal2) * 0.5;
         
         // Apply distortion strength and blend with base normal
@@ -158,7 +437,7 @@ void main() {
     } else {
         // Simple wave animation for baseline mode
         vec2 simpleUV = vUV * 2.0 + vec2(pc.time * 0.05, pc.time * 0.03);
-        vec3 simpleNormal = normalize(texture(waterNormalMap, simpleUV).rgb * 2.0 - 1.0);
+        vec3 simpleNormal = normalize(sampleWaterNormal(simpleUV));
         N = normalize(mix(N, simpleNormal.xzy, distortionStrength * 0.4));
     }
 
@@ -207,6 +486,7 @@ void main() {
     
     // === COMBINE LIGHTING ===
     vec3 color = ambient + diffuse + specular;
+    color += pointLighting(vWorldPos, N, V, depthAdjustedColor, waterShininess);
     
     // === DYNAMIC WAVE ANIMATION ===
     if (useAdvancedWaves) {
@@ -227,11 +507,32 @@ void main() {
         distortion = vec2(sin(pc.time + vUV.x * 10.0), cos(pc.time + vUV.y * 10.0)) * distortionStrength * 0.01;
     }
     
-    vec2 reflUV = clamp(vScreenUV + distortion, vec2(0.0), vec2(1.0));
-    vec2 refrUV = clamp(vScreenUV - distortion * 0.5, vec2(0.0), vec2(1.0));
+    vec2 screenUV = offscreenScreenUV(vWorldPos);
+    vec2 reflUV = clamp(screenUV + distortion, vec2(0.0), vec2(1.0));
+    vec2 refrUV = clamp(screenUV - distortion * 0.5, vec2(0.0), vec2(1.0));
 
-    vec3 reflectionCol = texture(reflectionTex, reflUV).rgb;
-    vec3 refractionCol = texture(refractionTex, refrUV).rgb;
+#ifdef RAY_QUERY
+    // Above water nothing rendered the targets: both rays go into the scene. The refracted one fades into
+    // the water's colour with the distance it travels under the surface
+    vec3 reflectionCol;
+    vec3 refractionCol;
+    if (ubo.offscreenScale.z > 0.5) {
+        vec3 reflectDir = reflect(-V, N);
+        float reflectDistance;
+        reflectionCol = traceScene(vWorldPos, reflectDir, textureLod(prefilteredSky, reflectDir, 0.0).rgb, reflectDistance);
+        vec3 refractDir = refract(-V, N, 1.0 / 1.33);
+        float refractDistance;
+        refractionCol = traceScene(vWorldPos, refractDir, depthAdjustedColor, refractDistance);
+        refractionCol = mix(depthAdjustedColor, refractionCol, exp(-0.05 * refractDistance));
+    } else {
+        reflectionCol = texture(reflectionTex, offscreenUV(reflUV)).rgb;
+        refractionCol = texture(refractionTex, offscreenUV(refrUV)).rgb;
+    }
+#else
+    vec3 reflectionCol = ubo.offscreenScale.y > 0.5 ? screenSpaceReflection(vWorldPos, N, V)
+                                                     : texture(reflectionTex, offscreenUV(reflUV)).rgb;
+    vec3 refractionCol = texture(refractionTex, offscreenUV(refrUV)).rgb;
+#endif
 
     // Combine reflection/refraction using Fresnel term
     vec3 reflRefr = mix(refractionCol, reflectionCol, fresnel);
@@ -245,7 +546,7 @@ void main() {
     bool cameraUnder = (cameraPosition().y < waterHeightVal);
     if (cameraUnder) {
         // When looking up from underwater, we see the underside of the water surface
-        vec3 V = normalize(ubo.viewPos.xyz - vWorldPos);
+        vec3 V = normalize(cameraPosition() - vWorldPos);
         
         // Calculate viewing angle - use surface normal dot view for proper underwater Fresnel
         // For underwater: looking "up" at the surface from below
@@ -254,13 +555,13 @@ void main() {
         
         // === DISTANCE-BASED DETAIL FADE (minimal fading to preserve sky visibility) ===
         // FIX #3: Relax distance fading to prevent sky reflection from being suppressed
-        float viewDistance = length(vWorldPos - ubo.viewPos.xyz);
+        float viewDistance = length(vWorldPos - cameraPosition());
         // Only apply very subtle fading at extreme distances
         float patternFade = 1.0 - smoothstep(200.0, 500.0, viewDistance); // Much larger range
         float detailFade = max(0.8, patternFade) * qualityScale; // Minimum 80% detail always
         
         // === PROJECTIVE TEXTURE COORDINATES (Screen Space) ===
-        vec2 projTexCoord = vScreenUV;
+        vec2 projTexCoord = offscreenScreenUV(vWorldPos);
         
         // === ANIMATED DUDV DISTORTION (always active) ===
         // FIX #1: Use world-space coordinates (vWorldPos.xz) instead of vUV to anchor waves to world
@@ -276,7 +577,7 @@ void main() {
         vec2 dudv3 = texture(waterDudvMap, dudvUV3).rg * 2.0 - 1.0;
         
         // Combine distortion layers - make them more pronounced
-        float distortionScale = pc.distortionStrength * 0.8; // Doubled from 0.04
+        float distortionScale = water.surface.distortionStrength * 0.8; // Doubled from 0.04
         vec2 totalDistortion = (dudv1 + dudv2 * 0.6 + dudv3 * 0.3) * distortionScale;
         
         // Apply distortion to projective texture coordinates
@@ -284,8 +585,8 @@ void main() {
         vec2 distortedRefrUV = clamp(projTexCoord - totalDistortion * 0.5, vec2(0.001), vec2(0.999));
         
         // === SAMPLE REFLECTION AND REFRACTION WITH DISTORTED COORDINATES ===
-        vec3 reflectionSample = texture(reflectionTex, distortedReflUV).rgb;
-        vec3 refractionSample = texture(refractionTex, distortedRefrUV).rgb;
+        vec3 reflectionSample = texture(reflectionTex, offscreenUV(distortedReflUV)).rgb;
+        vec3 refractionSample = texture(refractionTex, offscreenUV(distortedRefrUV)).rgb;
         
         // === WATER NORMAL MAP (always sampled, complexity based on mode) ===
         // FIX #1 (continued): Use world-space coordinates for normal maps too
@@ -295,23 +596,23 @@ void main() {
         if (useAdvancedWaves) {
             // Advanced multi-layer normal blending
             vec2 uv1 = baseUV + vec2(pc.time * 0.03, pc.time * 0.02);
-            vec3 norm1 = texture(waterNormalMap, uv1).rgb * 2.0 - 1.0;
+            vec3 norm1 = sampleWaterNormal(uv1);
             
             vec2 uv2 = baseUV * 0.7 + vec2(-pc.time * 0.025, pc.time * 0.03);
-            vec3 norm2 = texture(waterNormalMap, uv2).rgb * 2.0 - 1.0;
+            vec3 norm2 = sampleWaterNormal(uv2);
             
             vec2 uv3 = baseUV * 1.3 + vec2(pc.time * 0.02, -pc.time * 0.025);
-            vec3 norm3 = texture(waterNormalMap, uv3).rgb * 2.0 - 1.0;
+            vec3 norm3 = sampleWaterNormal(uv3);
             
             blendedNormal = normalize(norm1 + norm2 * 0.7 + norm3 * 0.5);
         } else {
             vec2 uv1 = baseUV + vec2(pc.time * 0.025, pc.time * 0.02);
-            blendedNormal = normalize(texture(waterNormalMap, uv1).rgb * 2.0 - 1.0);
+            blendedNormal = normalize(sampleWaterNormal(uv1));
         }
         
         // Apply normal strength - underwater surface normal points DOWN
         // Increase normal strength for more visible wave patterns
-        float normalStrength = pc.distortionStrength * 40.0 * qualityScale;
+        float normalStrength = water.surface.distortionStrength * 40.0 * qualityScale;
         vec3 N_under = normalize(vec3(
             blendedNormal.x * normalStrength + totalDistortion.x * 12.0,
             -1.0, // Surface normal pointing down
@@ -360,11 +661,11 @@ void main() {
         
         // FIX #2: Add strong specular sun highlight for bright sparkle on surface
         vec3 H = normalize(L + V);
-        float spec = pow(max(0.0, dot(-N_under, H)), pc.shininess * 0.5 * qualityScale);
+        float spec = pow(max(0.0, dot(-N_under, H)), water.surface.shininess * 0.5 * qualityScale);
         vec3 specular = vec3(1.0, 0.98, 0.95) * spec * 3.5; // Strong sun highlight
         
         // Secondary softer specular for additional brightness
-        float spec2 = pow(max(0.0, dot(-N_under, H)), pc.shininess * 0.2 * qualityScale);
+        float spec2 = pow(max(0.0, dot(-N_under, H)), water.surface.shininess * 0.2 * qualityScale);
         specular += vec3(0.6, 0.75, 0.9) * spec2 * 2.0; // Increased for more brightness
         
         // Ambient - increased to prevent darkness
@@ -373,6 +674,8 @@ void main() {
         // === COMBINE BASE LIGHTING ===
         // This contains all surface details: normals, dudv patterns, caustics, speculars
         vec3 litColor = ambient + diffuse + specular;
+        // Lights below the surface, facing its underside
+        litColor += pointLighting(vWorldPos, N_under, V, surfaceBaseColor, water.surface.shininess * 0.5 * qualityScale);
         
         // === REFLECTION/REFRACTION MIXING ===
         // FIX #3: Simplified Snell's window - clear separation between sky view and underwater reflection
@@ -400,17 +703,23 @@ void main() {
         finalColor += vec3(0.35, 0.55, 0.7) * windowEdge * 0.8;
         
         // === DISTANCE FOG (minimal, preserve sky visibility) ===
-        // FIX #3: Reduce fog intensity to prevent obscuring sky reflection
-        float fogStrength = max(0.2, pc.fogDensity * 0.5); // Reduced fog strength
-        float distFog = 1.0 - exp(-fogStrength * viewDistance * 0.004); // Reduced fog rate
-        float horizonFog = smoothstep(0.15, 0.0, cosTheta) * 0.2; // Reduced horizon fog
-        float totalFog = clamp(distFog + horizonFog, 0.0, 0.4); // Lower cap to preserve sky
-        
-        vec3 fogColor = mix(vec3(0.04, 0.12, 0.22), pc.baseColor.rgb * 0.4, 0.25);
-        finalColor = mix(finalColor, fogColor, totalFog);
+        // The froxel volume fogs the way to the surface like everything else underwater
+        float totalFog = 0.0;
+        if (water.surface.froxelDepthScale > 0.0) {
+            finalColor = froxelFog(finalColor, vWorldPos);
+        } else {
+            // FIX #3: Reduce fog intensity to prevent obscuring sky reflection
+            float fogStrength = max(0.2, water.surface.fogDensity * 0.5); // Reduced fog strength
+            float distFog = 1.0 - exp(-fogStrength * viewDistance * 0.004); // Reduced fog rate
+            float horizonFog = smoothstep(0.15, 0.0, cosTheta) * 0.2; // Reduced horizon fog
+            totalFog = clamp(distFog + horizonFog, 0.0, 0.4); // Lower cap to preserve sky
+
+            vec3 fogColor = mix(vec3(0.04, 0.12, 0.22), water.surface.baseColor.rgb * 0.4, 0.25);
+            finalColor = mix(finalColor, fogColor, totalFog);
+        }
         
         // === FINAL ALPHA ===
-        float underwaterAlpha = clamp(pc.opacity, 0.0, 1.0) * (1.0 - totalFog * 0.3);
+        float underwaterAlpha = clamp(water.surface.opacity, 0.0, 1.0) * (1.0 - totalFog * 0.3);
         
         outColor = vec4(finalColor, underwaterAlpha);
         return;
@@ -421,10 +730,15 @@ void main() {
     // Increase reflection contribution and keep water tint subtle
     color = mix(color, waterBaseColor, 0.2);
 
+    // Whitecaps where the simulation folds the surface; foam is opaque
+    vec3 foamColor = waterLightColor * (0.75 + 0.25 * LdotN);
+    color = mix(color, foamColor, foam);
+
     // Apply Fresnel-based transparency: ensure visible transparency
     // Lower base opacity and cap maximum to avoid a "solid" look
-    // Reduce default surface opacity range (user controls via pc.opacity / ImGui)
-    float finalAlpha = mix(0.04, 0.65, fresnel) * clamp(pc.opacity, 0.0, 1.0);
+    // Reduce default surface opacity range (user controls via water.surface.opacity / ImGui)
+    float finalAlpha = mix(0.04, 0.65, fresnel) * clamp(water.surface.opacity, 0.0, 1.0);
+    finalAlpha = mix(finalAlpha, 1.0, foam);
 
     outColor = vec4(color, finalAlpha);
 }
\ No newline at end of file
@@ -1,37 +1,45 @@
 #version 450
+#extension GL_EXT_multiview : require
 
-// Vertex inputs
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec2 inTexCoord;
+// Vertex input: the shared tile's cell corner (CdlodVertex)
+layout(location = 0) in uvec2 inCell;
+
+// CDLOD tile (CdlodGrid.h), per instance
+layout(location = 3) in vec4 inTileNode;  // xy: world XZ min corner, z: node size, w: plane height
+layout(location = 4) in vec4 inTileMorph; // x, y: morph range constants, z: 1 / plane size, w: level
+
+const float LOD_TILE_CELLS = 32.0; // CdlodGrid::kTileCells
 
 // Global UBO (set 0, binding 0) - match your C++ UBO layout
 layout(std140, set = 0, binding = 0) uniform UBO {
     mat4 model;
     mat4 view;
     mat4 proj;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 offscreenScale;
+    vec4 ocean; // x: 1 / ocean patch size, y: log2(texels per world unit) of the maps
+    vec4 viewport;
+    mat4 offscreenViewProj;
+    uvec4 material;
+    uvec4 views; // x: 2 in a stereo pass (Multiview.h)
+    mat4 eyeViewProj[2]; // Per view of a stereo pass, by gl_ViewIndex
+    vec4 eyePos[2];
 } ubo;
 
-// push constant: time, scale, colors, and lighting parameters (64 bytes total with std140 layout)
+// A stereo pass draws both eyes at once (Multiview.h); ubo.view/proj are then the camera both are culled with
+mat4 viewProjection() { return ubo.views.x > 1u ? ubo.eyeViewProj[gl_ViewIndex] : ubo.proj * ubo.view; }
+
+// FFT ocean maps (set 1, shared with water.frag)
+layout(set = 1, binding = 5) uniform sampler2D oceanDisplacement; // xyz: displacement, w: Jacobian
+layout(set = 1, binding = 6) uniform sampler2D oceanNormalFoam;   // xyz: normal, w: foam
+
+// push constant: time, scale and the fragment-side flags (16 bytes); the tuning is in WaterParams
 layout(push_constant) uniform WaterPush {
     float time;
     float scale;
     float debugRays;
     float _pad1;
-    vec4 baseColor;     // RGB color + alpha padding
-    vec4 lightColor;    // RGB color + alpha padding
-    float ambient;
-    float shininess;
-    float causticIntensity;
-    float distortionStrength;
-    float godRayIntensity;
-    float scatteringIntensity;
-    float opacity;
-    float fogDensity;
-    float godExposure;
-    float godDecay;
-    float godDensity;
-    float godSampleScale;
 } pc;
 
 // Outputs to fragment
@@ -39,78 +47,36 @@ layout(location = 0) out vec3 vWorldPos;
 layout(location = 1) out vec3 vNormal;
 layout(location = 2) out vec2 vUV;
 layout(location = 3) out vec2 vScreenUV; // for sampling scene texture
-
-// Gerstner wave function for realistic water displacement
-vec3 GerstnerWave(vec4 wave, vec3 p) {
-    float steepness = wave.z;
-    float wavelength = wave.w;
-    float k = 2.0 * 3.14159 / wavelength;
-    float c = sqrt(9.8 / k);
-    vec2 d = normalize(wave.xy);
-    float f = k * (dot(d, p.xz) - c * pc.time);
-    float a = steepness / k;
-
-    return vec3(
-        d.x * (a * cos(f)),
-        a * sin(f),
-        d.y * (a * cos(f))
-    );
-}
+layout(location = 4) out vec2 vOceanUV;  // undisplaced position on the ocean maps
 
 void main() {
-    // === REALISTIC GERSTNER WAVES ===
-    // Multiple waves with different frequencies for complex water surface
-    vec3 gridPoint = inPosition;
-    vec3 displacedPos = gridPoint;
-    vec3 normal = inNormal;
+    // === CDLOD TILE ===
+    // Odd vertices slide onto the next coarser grid as the camera distance nears the end of
+    // the tile's range, so neighbouring levels meet on the same vertices
+    vec2 cell = vec2(inCell);
+    float cellSize = inTileNode.z / LOD_TILE_CELLS;
+    vec3 gridPoint = vec3(inTileNode.x + cell.x * cellSize, inTileNode.w, inTileNode.y + cell.y * cellSize);
+    float morph = 1.0 - clamp(inTileMorph.x - distance(gridPoint, ubo.viewPos.xyz) * inTileMorph.y, 0.0, 1.0);
+    gridPoint.xz -= mod(cell, 2.0) * cellSize * morph;
 
-    // Wave 1: Long wavelength (swell-like)
-    vec4 wave1 = vec4(1.0, 0.0, 0.25, 60.0);
-    displacedPos += GerstnerWave(wave1, gridPoint);
-    
-    // Wave 2: Medium wavelength
-    vec4 wave2 = vec4(0.2, 0.4, 0.15, 31.0);
-    displacedPos += GerstnerWave(wave2, gridPoint);
-    
-    // Wave 3: Short wavelength (ripples)
-    vec4 wave3 = vec4(-0.3, 0.25, 0.1, 18.0);
-    displacedPos += GerstnerWave(wave3, gridPoint);
+    // === FFT OCEAN (OceanFFT.h) ===
+    // The maps are simulated once per frame; the grid only looks the surface up, at the
+    // mip whose texels match its cell size so waves shorter than a cell are filtered out
+    vOceanUV = (ubo.model * vec4(gridPoint, 1.0)).xz * ubo.ocean.x;
+    float oceanLod = max(log2(cellSize) + morph + ubo.ocean.y, 0.0);
+
+    vec3 displacement = textureLod(oceanDisplacement, vOceanUV, oceanLod).xyz;
+    vec3 displacedPos = gridPoint + displacement * pc.scale;
+    vec3 normal = textureLod(oceanNormalFoam, vOceanUV, oceanLod).xyz;
 
-    // Scale the overall displacement
-    float heightScale = pc.scale * 0.5; // Moderate wave height
-    displacedPos = vec3(
-        gridPoint.x + (displacedPos.x - gridPoint.x) * heightScale,
-        gridPoint.y + (displacedPos.y - gridPoint.y) * heightScale,
-        gridPoint.z + (displacedPos.z - gridPoint.z) * heightScale
-    );
-    
-    // === NORMAL CALCULATION ===
-    // Calculate approximate normal from wave displacement
-    float epsilon = 0.1;
-    vec3 pos1 = displacedPos;
-    
-    vec3 pos2 = gridPoint + vec3(epsilon, 0.0, 0.0);
-    pos2 += GerstnerWave(wave1, pos2) * heightScale;
-    pos2 += GerstnerWave(wave2, pos2) * heightScale;
-    pos2 += GerstnerWave(wave3, pos2) * heightScale;
-    
-    vec3 pos3 = gridPoint + vec3(0.0, 0.0, epsilon);
-    pos3 += GerstnerWave(wave1, pos3) * heightScale;
-    pos3 += GerstnerWave(wave2, pos3) * heightScale;
-    pos3 += GerstnerWave(wave3, pos3) * heightScale;
-    
-    vec3 tangent = normalize(pos2 - pos1);
-    vec3 bitangent = normalize(pos3 - pos1);
-    normal = normalize(cross(bitangent, tangent));
-    
     vWorldPos = (ubo.model * vec4(displacedPos, 1.0)).xyz;
-    vNormal = mat3(transpose(inverse(ubo.model))) * normal;
-    vUV = inTexCoord;
+    vNormal = normalize(mat3(transpose(inverse(ubo.model))) * normal);
+    vUV = gridPoint.xz * inTileMorph.z + 0.5;
 
     // Calculate clip space position
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(displacedPos, 1.0);
+    gl_Position = viewProjection() * ubo.model * vec4(displacedPos, 1.0);
 
     // Calculate screen space UV (for sampling scene color/depth)
     // Convert NDC [-1, 1] to UV [0, 1]
     vScreenUV = gl_Position.xy / gl_Position.w * 0.5 + 0.5;
-}
\ No newline at end of file
+}
@@ -0,0 +1,44 @@
+#version 450
+
+// Tessellated variant of water.vert: places and morphs the CDLOD tile vertex
+// (CdlodGrid.h) but leaves the displacement to water.tese, which samples the
+// ocean maps at the subdivided points instead.
+
+layout(location = 0) in uvec2 inCell;    // The shared tile's cell corner (CdlodVertex)
+layout(location = 3) in vec4 inTileNode;  // xy: world XZ min corner, z: node size, w: plane height
+layout(location = 4) in vec4 inTileMorph; // x, y: morph range constants, z: 1 / plane size, w: level
+
+const float LOD_TILE_CELLS = 32.0; // CdlodGrid::kTileCells
+
+layout(std140, set = 0, binding = 0) uniform UBO {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 lightPos;
+    vec4 viewPos;
+} ubo;
+
+// Must match the water pipeline layout, see water.vert; read here only, the
+// tessellation stages are not in the push constant range
+layout(push_constant) uniform WaterPush {
+    float time;
+    float scale;
+} pc;
+
+layout(location = 0) out vec3 vGridPos;   // Undisplaced, model space
+layout(location = 1) out float vCellSize; // World units between tile vertices
+layout(location = 2) out float vScale;    // pc.scale
+layout(location = 3) out float vInvPlaneSize;
+
+void main() {
+    vec2 cell = vec2(inCell);
+    float cellSize = inTileNode.z / LOD_TILE_CELLS;
+    vec3 gridPoint = vec3(inTileNode.x + cell.x * cellSize, inTileNode.w, inTileNode.y + cell.y * cellSize);
+    float morph = 1.0 - clamp(inTileMorph.x - distance(gridPoint, ubo.viewPos.xyz) * inTileMorph.y, 0.0, 1.0);
+    gridPoint.xz -= mod(cell, 2.0) * cellSize * morph;
+
+    vGridPos = gridPoint;
+    vCellSize = cellSize * (1.0 + morph);
+    vScale = pc.scale;
+    vInvPlaneSize = inTileMorph.z;
+}
@@ -1,4 +1,6 @@
 #include "xrxsPipeline.h"
+#include "DynamicRendering.h"
+#include "PipelineCache.h"
 #include "VulkanUtil.h"
 #include "Vertex.h"
 #include <stdexcept>
@@ -49,7 +51,10 @@ void xrxsPipeline::initialize(VkPhysicalDevice physicalDevice, VkDevice device,
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    DynamicRendering::apply(pipelineInfo, renderingInfo);
+
+    if (vkCreateGraphicsPipelines(device, PipelineCache::get().handle(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 }